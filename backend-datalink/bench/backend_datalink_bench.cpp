@@ -0,0 +1,449 @@
+// Micro-benchmarks for the backend-datalink hot paths.
+//
+// Build with -DBUILD_BENCHMARKS=ON, then for results that can be compared
+// between releases:
+//   ./backend_datalink_bench --benchmark_format=json --benchmark_out=bench.json
+//
+// BENCH_WS_PORT sets the loopback port of the WebSocket benchmarks
+// (default 19002).
+
+#include <benchmark/benchmark.h>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "websocket_server.h"
+#include "database_manager.h"
+#include "metrics_history.h"
+#include "SystemDataCollector.h"
+#include "NetworkPriorityManager.h"
+#include "rpc_client.h"
+#include "rpc_method_registry.h"
+#include "inbound_message.h"
+#include "ur-concurrency/ur_concurrency.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+typedef websocketpp::client<websocketpp::config::asio_client> ws_client;
+
+// Dashboard-sized message, shaped like a system metrics update
+json makeDashboardMessage(int sequence) {
+    json cores = json::array();
+    for (int i = 0; i < 4; ++i) {
+        cores.push_back({{"usage_percent", 12.5 + i}, {"user_percent", 8.0}, {"system_percent", 3.5}});
+    }
+    return {
+        {"type", "dashboard_update"},
+        {"category", "system"},
+        {"timestamp", sequence},
+        {"data", {
+            {"cpu", {{"usage_percent", 23.4}, {"cores", 4}, {"temperature_celsius", 51.0},
+                     {"frequency_ghz", 1.8}, {"per_core", cores}}},
+            {"ram", {{"usage_percent", 41.2}, {"used_gb", 1.6}, {"total_gb", 3.8}}},
+            {"swap", {{"usage_percent", 0.0}, {"used_mb", 0.0}, {"total_gb", 1.0}, {"status", "Normal"}}}
+        }}
+    };
+}
+
+int benchPort() {
+    const char* port = std::getenv("BENCH_WS_PORT");
+    return port ? std::atoi(port) : 19002;
+}
+
+// Temporary database shared by the benchmarks that need one
+DatabaseManager& benchDatabase() {
+    static std::string dir;
+    static DatabaseManager database;
+    if (dir.empty()) {
+        char path[] = "/tmp/backend-datalink-bench-XXXXXX";
+        if (!mkdtemp(path)) {
+            std::cerr << "Failed to create a temporary directory" << std::endl;
+            std::exit(1);
+        }
+        dir = path;
+        ConfigLoader::DatabaseConfig config;
+        config.path = dir + "/bench.db";
+        config.log_connections = false;
+        if (!database.initialize(config)) {
+            std::cerr << "Failed to initialize the benchmark database" << std::endl;
+            std::exit(1);
+        }
+    }
+    return database;
+}
+
+// N real clients on loopback, each reading and discarding what the server sends
+class LoopbackClients {
+public:
+    explicit LoopbackClients(int port) : port_(port), received_(0) {
+        client_.clear_access_channels(websocketpp::log::alevel::all);
+        client_.clear_error_channels(websocketpp::log::elevel::all);
+        client_.init_asio();
+        client_.set_message_handler([this](websocketpp::connection_hdl, ws_client::message_ptr) {
+            received_.fetch_add(1, std::memory_order_relaxed);
+        });
+        client_.start_perpetual();
+        thread_ = std::thread([this]() { client_.run(); });
+    }
+
+    ~LoopbackClients() {
+        client_.stop_perpetual();
+        for (auto& hdl : connections_) {
+            websocketpp::lib::error_code ec;
+            client_.close(hdl, websocketpp::close::status::going_away, "", ec);
+        }
+        client_.stop();
+        thread_.join();
+    }
+
+    void connect(int count) {
+        for (int i = 0; i < count; ++i) {
+            websocketpp::lib::error_code ec;
+            auto con = client_.get_connection("ws://127.0.0.1:" + std::to_string(port_), ec);
+            if (ec) {
+                std::cerr << "Client connection failed: " << ec.message() << std::endl;
+                return;
+            }
+            connections_.push_back(con->get_handle());
+            client_.connect(con);
+        }
+    }
+
+    uint64_t received() const { return received_.load(std::memory_order_relaxed); }
+
+private:
+    int port_;
+    ws_client client_;
+    std::thread thread_;
+    std::vector<websocketpp::connection_hdl> connections_;
+    std::atomic<uint64_t> received_;
+};
+
+bool waitFor(const std::function<bool()>& condition, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+// Cost of one broadcast to range(0) connections: encoding, framing and
+// queueing the writes. Delivery is awaited outside the timed region.
+static void BM_WebSocketBroadcast(benchmark::State& state) {
+    const int connections = static_cast<int>(state.range(0));
+
+    ConfigLoader::WebSocketConfig config;
+    config.host = "127.0.0.1";
+    config.port = benchPort();
+    config.enable_logging = false;
+    config.max_connections = connections + 1;
+    config.max_send_buffer_kb = 16 * 1024;
+
+    WebSocketServer server;
+    if (!server.start(config)) {
+        state.SkipWithError("WebSocket server failed to start");
+        return;
+    }
+
+    {
+        LoopbackClients clients(config.port);
+        clients.connect(connections);
+        if (!waitFor([&]() { return server.getConnectionCount() == static_cast<size_t>(connections); },
+                     std::chrono::seconds(10))) {
+            state.SkipWithError("Clients failed to connect");
+        } else {
+            int sequence = 0;
+            for (auto _ : state) {
+                server.broadcast(makeDashboardMessage(sequence++));
+
+                state.PauseTiming();
+                uint64_t expected = static_cast<uint64_t>(sequence) * connections;
+                waitFor([&]() { return clients.received() >= expected; }, std::chrono::seconds(5));
+                state.ResumeTiming();
+            }
+
+            SendQueueStats stats = server.getSendQueueStats();
+            state.counters["connections"] = connections;
+            state.counters["messages_sent"] = static_cast<double>(stats.messages_sent);
+            state.counters["messages_dropped"] = static_cast<double>(stats.messages_dropped);
+            state.counters["deliveries_per_second"] =
+                benchmark::Counter(static_cast<double>(state.iterations()) * connections, benchmark::Counter::kIsRate);
+        }
+    }
+
+    server.stop();
+}
+BENCHMARK(BM_WebSocketBroadcast)->Arg(1)->Arg(10)->Arg(50)->Arg(100)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// Write-through with a value that changes every time, so each call persists
+static void BM_DatabaseUpdateDashboardData(benchmark::State& state) {
+    DatabaseManager& database = benchDatabase();
+    int sequence = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(database.updateDashboardData("bench_system", makeDashboardMessage(sequence++)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DatabaseUpdateDashboardData)->Unit(benchmark::kMicrosecond);
+
+// Write-through with the cached value, which skips SQLite
+static void BM_DatabaseUpdateDashboardDataUnchanged(benchmark::State& state) {
+    DatabaseManager& database = benchDatabase();
+    json message = makeDashboardMessage(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(database.updateDashboardData("bench_static", message));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DatabaseUpdateDashboardDataUnchanged)->Unit(benchmark::kMicrosecond);
+
+static void BM_DatabaseGetDashboardData(benchmark::State& state) {
+    DatabaseManager& database = benchDatabase();
+    database.updateDashboardData("bench_read", makeDashboardMessage(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(database.getDashboardData("bench_read"));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DatabaseGetDashboardData)->Unit(benchmark::kMicrosecond);
+
+static void BM_DatabaseGetDashboardDataJson(benchmark::State& state) {
+    DatabaseManager& database = benchDatabase();
+    database.updateDashboardData("bench_read", makeDashboardMessage(0));
+    json data;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(database.getDashboardDataJson("bench_read", data));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DatabaseGetDashboardDataJson)->Unit(benchmark::kMicrosecond);
+
+// A 24 hour chart of 1 s samples: every field, 300 buckets, from memory
+static void BM_MetricsHistoryAggregate(benchmark::State& state) {
+    ConfigLoader::MetricsHistoryConfig config;
+    config.ring_capacity = 86400;
+    MetricsHistory history(nullptr, config);
+    for (int i = 0; i < config.ring_capacity; ++i) {
+        MetricsSample sample;
+        sample.timestamp = i;
+        sample.cpu_percent = (i * 37) % 100;
+        sample.latency_ms = 20.0 + (i * 13) % 50;
+        history.record(sample);
+    }
+
+    std::vector<std::string> fields;
+    if (state.range(0) == 1) {
+        fields.push_back("cpu_percent");
+    }
+    HistoryAggregate aggregate;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(history.aggregate(0, config.ring_capacity - 1, 300, fields, aggregate));
+    }
+    state.SetItemsProcessed(state.iterations() * aggregate.count);
+}
+BENCHMARK(BM_MetricsHistoryAggregate)->Arg(1)->Arg(0)->Unit(benchmark::kMicrosecond);
+
+// Readers of the published snapshot, with the collector running
+static void BM_SystemDataGetMetricsAsJson(benchmark::State& state) {
+    SystemDataCollector collector;
+    if (!collector.start(1)) {
+        state.SkipWithError("System data collector failed to start");
+        return;
+    }
+    waitFor([&]() { return collector.getSnapshot()->generation > 0; }, std::chrono::seconds(5));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(collector.getMetricsAsJson());
+    }
+    state.SetItemsProcessed(state.iterations());
+    collector.stop();
+}
+BENCHMARK(BM_SystemDataGetMetricsAsJson)->Unit(benchmark::kMicrosecond);
+
+// A by-value copy of the snapshot, which holds no heap storage
+static void BM_SystemDataGetCurrentMetrics(benchmark::State& state) {
+    SystemDataCollector collector;
+    if (!collector.start(1)) {
+        state.SkipWithError("System data collector failed to start");
+        return;
+    }
+    waitFor([&]() { return collector.getSnapshot()->generation > 0; }, std::chrono::seconds(5));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(collector.getCurrentMetrics());
+    }
+    state.SetItemsProcessed(state.iterations());
+    collector.stop();
+}
+BENCHMARK(BM_SystemDataGetCurrentMetrics)->Unit(benchmark::kMicrosecond);
+
+static void BM_NetworkPriorityGetAllDataAsJson(benchmark::State& state) {
+    NetworkPriorityManager manager(&benchDatabase());
+    if (!manager.start(60)) {
+        state.SkipWithError("Network priority manager failed to start");
+        return;
+    }
+    waitFor([&]() { return manager.getSnapshot()->generation > 0; }, std::chrono::seconds(5));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(manager.getAllDataAsJson());
+    }
+    state.counters["interfaces"] = static_cast<double>(manager.getSnapshot()->interfaces.size());
+    state.SetItemsProcessed(state.iterations());
+    manager.stop();
+}
+BENCHMARK(BM_NetworkPriorityGetAllDataAsJson)->Unit(benchmark::kMicrosecond);
+
+// Requests per second through parsing, the bounded queue, the executor and
+// the method registry. Each iteration submits a batch and waits for it; the
+// responses are built but go nowhere since no broker is connected.
+static void BM_RpcProcessRequest(benchmark::State& state) {
+    const int batch = static_cast<int>(state.range(0));
+    std::atomic<uint64_t> handled(0);
+
+    BackendDatalink::RpcMethodRegistry registry;
+    registry.add("bench.echo", [&handled](const json& params) {
+        handled.fetch_add(1, std::memory_order_relaxed);
+        return params;
+    });
+    registry.freeze();
+
+    BackendDatalink::RpcOperationProcessor processor(false, 4, static_cast<size_t>(batch));
+    processor.setMethodRegistry(&registry);
+    processor.setResponseTopic("bench/response");
+
+    std::vector<std::string> requests;
+    for (int i = 0; i < batch; ++i) {
+        requests.push_back(json{
+            {"jsonrpc", "2.0"},
+            {"id", "bench-" + std::to_string(i)},
+            {"method", "bench.echo"},
+            {"params", {{"category", "system"}, {"limit", 10}}}
+        }.dump());
+    }
+
+    uint64_t expected = 0;
+    for (auto _ : state) {
+        for (const auto& request : requests) {
+            processor.processRequest(request.data(), request.size());
+        }
+        expected += batch;
+        while (handled.load(std::memory_order_relaxed) + processor.getRejectedCount() < expected) {
+            std::this_thread::yield();
+        }
+    }
+
+    processor.shutdown();
+    state.counters["rejected"] = static_cast<double>(processor.getRejectedCount());
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_RpcProcessRequest)->Arg(1)->Arg(64)->Arg(256)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// Parse and read one inbound request the way WebSocketServer::onMessage
+// does, on the heap and in the per-thread message arena
+const char kInboundRequest[] =
+    "{\"type\":\"get_metrics_history\",\"categories\":[\"system\",\"ram\",\"signal\"],"
+    "\"resolution\":60,\"from\":1700000000,\"to\":1700003600,\"limit\":500}";
+
+static void BM_ParseInboundMessageHeap(benchmark::State& state) {
+    for (auto _ : state) {
+        json message = json::parse(kInboundRequest);
+        benchmark::DoNotOptimize(message.value("type", ""));
+    }
+}
+BENCHMARK(BM_ParseInboundMessageHeap)->Unit(benchmark::kMicrosecond);
+
+static void BM_ParseInboundMessageArena(benchmark::State& state) {
+    for (auto _ : state) {
+        BackendDatalink::MessageArena::Scope scope;
+        BackendDatalink::message_json message = BackendDatalink::message_json::parse(kInboundRequest);
+        benchmark::DoNotOptimize(message.value("type", ""));
+    }
+}
+BENCHMARK(BM_ParseInboundMessageArena)->Unit(benchmark::kMicrosecond);
+
+// Routing fields only, as onMessage gets them before any handler runs
+static void BM_ScanInboundMessage(benchmark::State& state) {
+    const std::string payload = kInboundRequest;
+    for (auto _ : state) {
+        BackendDatalink::InboundMessage message(payload, WireEncoding::Json);
+        message.scan(10000);
+        benchmark::DoNotOptimize(message.type());
+    }
+}
+BENCHMARK(BM_ScanInboundMessage)->Unit(benchmark::kMicrosecond);
+
+// Queue handoff, each thread pushing then popping one item, against the
+// mutex-guarded deque the rings replace
+static void BM_MutexDequePushPop(benchmark::State& state) {
+    static std::mutex mutex;
+    static std::deque<uint64_t> queue;
+    uint64_t value = 0;
+    for (auto _ : state) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(value);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        value = queue.front();
+        queue.pop_front();
+    }
+    benchmark::DoNotOptimize(value);
+}
+BENCHMARK(BM_MutexDequePushPop)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_MpmcRingPushPop(benchmark::State& state) {
+    static UrConcurrency::MpmcRing<uint64_t> ring(1024);
+    uint64_t value = 0;
+    for (auto _ : state) {
+        while (!ring.push(value)) {
+            std::this_thread::yield();
+        }
+        while (!ring.pop(value)) {
+            std::this_thread::yield();
+        }
+    }
+    benchmark::DoNotOptimize(value);
+}
+BENCHMARK(BM_MpmcRingPushPop)->Threads(1)->Threads(4)->UseRealTime();
+
+// Thread 0 produces, thread 1 consumes; items per second is the throughput.
+// Waits yield, so the figures stay meaningful on single-core devices.
+static void BM_SpscRingTransfer(benchmark::State& state) {
+    static UrConcurrency::SpscRing<uint64_t> ring(1024);
+    uint64_t value = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            while (!ring.push(value)) {
+                std::this_thread::yield();
+            }
+            ++value;
+        } else {
+            while (!ring.pop(value)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    benchmark::DoNotOptimize(value);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SpscRingTransfer)->Threads(2)->UseRealTime();
+
+BENCHMARK_MAIN();
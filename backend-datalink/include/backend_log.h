@@ -0,0 +1,98 @@
+#ifndef BACKEND_LOG_H
+#define BACKEND_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include "logger.h"
+
+namespace BackendDatalink {
+namespace Log {
+
+// Lets one message through per interval and counts the ones it holds back.
+// One limiter per call site (BACKEND_LOG_EVERY declares it), shared by every
+// thread that reaches it.
+class RateLimiter {
+public:
+    explicit RateLimiter(int64_t interval_ms) : interval_ns_(interval_ms * 1000000) {}
+
+    // True when the caller should log; suppressed is then the number of
+    // messages dropped since the previous one
+    bool allow(uint64_t& suppressed) {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t last = last_ns_.load(std::memory_order_relaxed);
+        if ((last != 0 && now - last < interval_ns_) ||
+            !last_ns_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    const int64_t interval_ns_;
+    std::atomic<int64_t> last_ns_{0};
+    std::atomic<uint64_t> suppressed_{0};
+};
+
+// "DEBUG", "INFO", "WARN", "ERROR" or "FATAL"; anything else is INFO
+inline log_level_t levelFromName(const std::string& name) {
+    if (name == "DEBUG") return LOG_DEBUG;
+    if (name == "WARN") return LOG_WARN;
+    if (name == "ERROR") return LOG_ERROR;
+    if (name == "FATAL") return LOG_FATAL;
+    return LOG_INFO;
+}
+
+inline void write(log_level_t level, const char* file, int line, const char* func, const std::string& message) {
+    logger_log(level, file, line, func, "%s", message.c_str());
+}
+
+} // namespace Log
+} // namespace BackendDatalink
+
+// Stream-style logging through ur-logger-api, so backend lines share its
+// level filter and async writer. The message is only built when the level
+// is enabled:
+//
+//   BACKEND_LOG_INFO("Connection opened: " << connection_id);
+#define BACKEND_LOG(level, stream)                                                              \
+    do {                                                                                        \
+        if (logger_is_enabled(level)) {                                                         \
+            std::ostringstream backend_log_message_;                                            \
+            backend_log_message_ << stream;                                                     \
+            ::BackendDatalink::Log::write(level, __FILE__, __LINE__, __func__,                  \
+                                          backend_log_message_.str());                          \
+        }                                                                                       \
+    } while (0)
+
+// At most one line per interval_ms from this call site; the next line that
+// gets through reports how many were dropped in between
+#define BACKEND_LOG_EVERY(level, interval_ms, stream)                                           \
+    do {                                                                                        \
+        if (logger_is_enabled(level)) {                                                         \
+            static ::BackendDatalink::Log::RateLimiter backend_log_limiter_(interval_ms);       \
+            uint64_t backend_log_suppressed_ = 0;                                               \
+            if (backend_log_limiter_.allow(backend_log_suppressed_)) {                          \
+                std::ostringstream backend_log_message_;                                        \
+                backend_log_message_ << stream;                                                 \
+                if (backend_log_suppressed_ > 0) {                                              \
+                    backend_log_message_ << " (" << backend_log_suppressed_                     \
+                                         << " similar suppressed)";                             \
+                }                                                                               \
+                ::BackendDatalink::Log::write(level, __FILE__, __LINE__, __func__,              \
+                                              backend_log_message_.str());                      \
+            }                                                                                   \
+        }                                                                                       \
+    } while (0)
+
+#define BACKEND_LOG_DEBUG(stream) BACKEND_LOG(LOG_DEBUG, stream)
+#define BACKEND_LOG_INFO(stream) BACKEND_LOG(LOG_INFO, stream)
+#define BACKEND_LOG_WARN(stream) BACKEND_LOG(LOG_WARN, stream)
+#define BACKEND_LOG_ERROR(stream) BACKEND_LOG(LOG_ERROR, stream)
+
+#endif // BACKEND_LOG_H
@@ -0,0 +1,14 @@
+#ifndef BOUNDED_MPMC_QUEUE_H
+#define BOUNDED_MPMC_QUEUE_H
+
+#include "ur-concurrency/ur_concurrency.hpp"
+
+// Fixed-capacity ring buffer with lock-free producers and consumers
+// (Vyukov's bounded queue, see BoundedMpscQueue for the single-consumer
+// variant). Neither push() nor pop() blocks: push() returns false when the
+// ring is full, pop() when it is empty. Shared with the C libraries
+// through ur-concurrency.
+template <typename T>
+using BoundedMpmcQueue = UrConcurrency::MpmcRing<T>;
+
+#endif // BOUNDED_MPMC_QUEUE_H
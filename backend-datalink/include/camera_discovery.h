@@ -0,0 +1,121 @@
+#ifndef CAMERA_DISCOVERY_H
+#define CAMERA_DISCOVERY_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "config_loader.h"
+
+using json = nlohmann::json;
+
+namespace BackendDatalink {
+
+// IP cameras on the local /24 networks, found by ONVIF WS-Discovery and mDNS
+// (_rtsp._tcp, _axis-video._tcp) and kept in a cache that outlives scans.
+//   - One thread runs every probe on a single poll() loop: multicast
+//     WS-Discovery and mDNS queries go out on each interface, and a
+//     unicast WS-Discovery probe goes to every host of each scanned /24 for
+//     cameras that ignore multicast. At most probe_window unicast probes
+//     per subnet await an answer, sent at no more than
+//     probe_rate_per_second.
+//   - A subnet scanned within cache_ttl_seconds is not scanned again unless
+//     forced; callers get the cache instead. A device that has not answered
+//     for cache_ttl_seconds is dropped.
+//   - Every cache change is reported to the update handler, at most every
+//     kUpdateInterval, as the whole "cameras" category value:
+//       {"scanning", "last_scan", "subnets": [...], "devices": {address: {...}}}
+class CameraDiscovery {
+public:
+    typedef std::function<void(const json& cameras)> UpdateHandler;
+
+    CameraDiscovery(const ConfigLoader::CameraDiscoveryConfig& config, UpdateHandler on_update);
+    ~CameraDiscovery();
+
+    CameraDiscovery(const CameraDiscovery&) = delete;
+    CameraDiscovery& operator=(const CameraDiscovery&) = delete;
+
+    // False if the sockets cannot be opened
+    bool start();
+    void stop();
+
+    // subnet is "a.b.c.0/24" (the /24 is implied if missing) and must be
+    // private; empty means the /24 of every local interface. Returns false
+    // when every requested subnet is already being scanned or was scanned
+    // within cache_ttl_seconds and force is not set. Throws
+    // std::invalid_argument for a bad subnet and std::runtime_error when
+    // the engine is not running or there is nothing to scan.
+    bool requestScan(const std::string& subnet, bool force);
+
+    // The cached "cameras" value
+    json getCameras() const;
+
+private:
+    struct Device {
+        std::string name;
+        std::string hardware;           // ONVIF hardware scope
+        std::string xaddrs;             // ONVIF device service URLs
+        std::string endpoint;           // WS-Discovery endpoint reference
+        std::string rtsp_url;           // From an _rtsp._tcp SRV record
+        bool onvif = false;
+        bool mdns = false;
+        int64_t first_seen = 0;         // Unix seconds
+        int64_t last_seen = 0;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    struct SubnetScan {
+        uint32_t network = 0;           // Host byte order, last octet zero
+        uint32_t next_host = 1;         // 1..254, then done
+        double tokens = 0.0;            // Rate limiter
+        std::chrono::steady_clock::time_point refilled;
+        // Unicast probes awaiting an answer, with their deadline
+        std::deque<std::pair<uint32_t, std::chrono::steady_clock::time_point>> in_flight;
+    };
+
+    static constexpr std::chrono::milliseconds kUpdateInterval{250};
+
+    ConfigLoader::CameraDiscoveryConfig config_;
+    UpdateHandler on_update_;
+
+    int wsd_fd_ = -1;                   // WS-Discovery probes and matches
+    int mdns_fd_ = -1;                  // mDNS queries and legacy unicast answers
+    int wake_fd_ = -1;                  // eventfd
+
+    mutable std::mutex mutex_;
+    bool running_ = false;
+    std::thread thread_;
+    std::vector<uint8_t> buffer_;       // Datagrams, loop thread only
+
+    // Guarded by mutex_
+    std::map<std::string, Device> devices_;          // By IPv4 address
+    std::vector<SubnetScan> scans_;
+    std::map<uint32_t, std::chrono::steady_clock::time_point> scanned_;  // Network -> last completed scan
+    bool scanning_ = false;
+    bool multicast_pending_ = false;
+    std::chrono::steady_clock::time_point listen_until_;
+    std::string probe_message_;         // WS-Discovery Probe of the current scan
+    int64_t last_scan_ = 0;             // Unix seconds the last scan finished
+    bool dirty_ = false;
+    std::chrono::steady_clock::time_point last_update_;
+
+    void run();
+    void wake();
+    void tick(std::chrono::steady_clock::time_point now);
+    void sendMulticastProbes();
+    void receive(int fd, bool mdns);
+    void handleProbeMatch(const std::string& message, uint32_t from);
+    void handleMdnsAnswer(const uint8_t* packet, size_t size, uint32_t from);
+    Device& deviceFor(uint32_t address);
+    json toJsonLocked() const;
+};
+
+} // namespace BackendDatalink
+
+#endif // CAMERA_DISCOVERY_H
@@ -0,0 +1,172 @@
+#ifndef CHUNKED_RESPONSES_H
+#define CHUNKED_RESPONSES_H
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace BackendDatalink {
+
+// Responses too large for one MQTT message, sent as a run of chunks the
+// requester joins back together. A chunk reads
+//   {"jsonrpc": "2.0", "id": ..., "transaction_id": ...,
+//    "chunk": {"seq": i, "count": n, "size": bytes, "window": w, "ack_topic": t},
+//    "data": "<next piece of the response's JSON text>"}
+// in the encoding of the request; joined, the data is the response as it
+// would have been sent whole, in JSON.
+//   - Flow control: the requester acks with a "rpc.chunk_ack" request,
+//     params {"id": ..., "received": chunks received in order}, published
+//     to ack_topic. No more than window chunks are ever unacked.
+//   - A stream not acked for idleTimeout is dropped; the requester's own
+//     timeout then answers its caller. So is the least recently acked
+//     stream once maxStreams are open.
+// Only requests that ask for it ("chunk_window" > 0) get chunks; others
+// get the whole response, however large.
+class ChunkedResponses {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // Pieces are cut at chunkBytes of response, or just before, so as not
+    // to split a UTF-8 sequence
+    ChunkedResponses(size_t chunkBytes, size_t maxWindow, std::string ackTopic, size_t maxStreams = 64,
+                     std::chrono::milliseconds idleTimeout = std::chrono::seconds(30))
+        : chunkBytes_(std::max<size_t>(chunkBytes, 16)), maxWindow_(maxWindow == 0 ? 1 : maxWindow),
+          ackTopic_(std::move(ackTopic)), maxStreams_(maxStreams == 0 ? 1 : maxStreams), idleTimeout_(idleTimeout) {}
+
+    ChunkedResponses(const ChunkedResponses&) = delete;
+    ChunkedResponses& operator=(const ChunkedResponses&) = delete;
+
+    bool needsChunks(size_t responseBytes) const { return responseBytes > chunkBytes_; }
+
+    // Opens the stream for id, replacing one still open, and returns its
+    // first chunks, encoded; text is the response's JSON text
+    std::vector<std::string> start(const std::string& id, std::string text, bool cbor, size_t window,
+                                   Clock::time_point now) {
+        Stream stream;
+        stream.cbor = cbor;
+        stream.window = std::min(std::max<size_t>(window, 1), maxWindow_);
+        stream.lastActivity = now;
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = std::min(begin + chunkBytes_, text.size());
+            // Back off UTF-8 continuation bytes so each piece is valid text
+            while (end < text.size() && end > begin + 1 &&
+                   (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+                --end;
+            }
+            stream.ends.push_back(end);
+            begin = end;
+        }
+        stream.text = std::move(text);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        expire(now);
+        if (streams_.size() >= maxStreams_ && streams_.find(id) == streams_.end()) {
+            auto oldest = std::min_element(streams_.begin(), streams_.end(), [](const auto& a, const auto& b) {
+                return a.second.lastActivity < b.second.lastActivity;
+            });
+            streams_.erase(oldest);
+            abandoned_.fetch_add(1, std::memory_order_relaxed);
+        }
+        started_.fetch_add(1, std::memory_order_relaxed);
+        Stream& open = streams_[id] = std::move(stream);
+        return release(id, open);
+    }
+
+    // The chunks an ack makes room for; none for a stream not open here
+    std::vector<std::string> ack(const std::string& id, size_t received, Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        expire(now);
+        auto found = streams_.find(id);
+        if (found == streams_.end()) {
+            return {};
+        }
+        Stream& stream = found->second;
+        stream.acked = std::max(stream.acked, std::min(received, stream.sent));
+        stream.lastActivity = now;
+        if (stream.acked == stream.ends.size()) {
+            streams_.erase(found);
+            return {};
+        }
+        return release(id, stream);
+    }
+
+    uint64_t startedCount() const { return started_.load(std::memory_order_relaxed); }
+    uint64_t abandonedCount() const { return abandoned_.load(std::memory_order_relaxed); }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return streams_.size();
+    }
+
+private:
+    struct Stream {
+        std::string text;
+        std::vector<size_t> ends;   // Where each chunk's piece of text ends
+        bool cbor = false;
+        size_t window = 1;
+        size_t sent = 0;
+        size_t acked = 0;
+        Clock::time_point lastActivity;
+    };
+
+    // Caller holds mutex_
+    std::vector<std::string> release(const std::string& id, Stream& stream) {
+        std::vector<std::string> chunks;
+        while (stream.sent < stream.ends.size() && stream.sent - stream.acked < stream.window) {
+            size_t seq = stream.sent++;
+            size_t begin = seq == 0 ? 0 : stream.ends[seq - 1];
+            nlohmann::json chunk;
+            chunk["jsonrpc"] = "2.0";
+            chunk["id"] = id;
+            chunk["transaction_id"] = id;
+            chunk["chunk"] = {{"seq", seq},
+                              {"count", stream.ends.size()},
+                              {"size", stream.text.size()},
+                              {"window", stream.window},
+                              {"ack_topic", ackTopic_}};
+            chunk["data"] = stream.text.substr(begin, stream.ends[seq] - begin);
+            chunks.emplace_back();
+            if (stream.cbor) {
+                nlohmann::json::to_cbor(chunk, chunks.back());
+            } else {
+                chunks.back() = chunk.dump();
+            }
+        }
+        return chunks;
+    }
+
+    // Caller holds mutex_
+    void expire(Clock::time_point now) {
+        for (auto it = streams_.begin(); it != streams_.end();) {
+            if (now - it->second.lastActivity >= idleTimeout_) {
+                it = streams_.erase(it);
+                abandoned_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Stream> streams_;
+    size_t chunkBytes_;
+    size_t maxWindow_;
+    std::string ackTopic_;
+    size_t maxStreams_;
+    std::chrono::milliseconds idleTimeout_;
+    std::atomic<uint64_t> started_{0};
+    std::atomic<uint64_t> abandoned_{0};
+};
+
+} // namespace BackendDatalink
+
+#endif // CHUNKED_RESPONSES_H
@@ -0,0 +1,78 @@
+#ifndef COLLECTOR_GOVERNOR_H
+#define COLLECTOR_GOVERNOR_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "dashboard_categories.h"
+
+namespace BackendDatalink {
+
+// Paces the collectors by demand and by system load, as a slowdown factor
+// on each one's configured period:
+//   - A collector none of whose categories has a subscriber, or was asked
+//     for (dashboard_data) in the last demandHold, runs idleSlowdown times
+//     slower; a new subscriber brings it back on the next evaluate().
+//   - While the load average per CPU or the CPU pressure (PSI "some"
+//     avg10) is over its limit, every collector runs loadSlowdown times
+//     slower as well, until both are back under 80% of their limits.
+// evaluate() reads two procfs files and is meant for a periodic timer.
+class CollectorGovernor {
+public:
+    typedef std::chrono::steady_clock Clock;
+    // Clients a publish to the category would reach
+    typedef std::function<size_t(const std::string& category)> DemandSource;
+    // Applies a slowdown factor; 1 is the configured period
+    typedef std::function<void(int slowdown)> Pace;
+
+    struct Settings {
+        int idleSlowdown = 4;                   // 1 keeps idle collectors at full rate
+        int loadSlowdown = 2;                   // 1 ignores load
+        double loadPerCpu = 1.5;                // 1-minute load average per CPU; 0 ignores it
+        double cpuPressurePercent = 25.0;       // 0 ignores PSI
+        std::chrono::milliseconds demandHold = std::chrono::seconds(30);
+    };
+
+    explicit CollectorGovernor(DemandSource demand);
+
+    CollectorGovernor(const CollectorGovernor&) = delete;
+    CollectorGovernor& operator=(const CollectorGovernor&) = delete;
+
+    // Before the first evaluate()
+    void addCollector(const std::string& name, std::vector<DashboardCategory> categories, Pace pace);
+    // Live; takes effect on the next evaluate()
+    void setSettings(const Settings& settings);
+
+    // A one-off read of the category counts as demand for demandHold
+    void noteRequest(DashboardCategory category, Clock::time_point now);
+
+    void evaluate(Clock::time_point now);
+
+    bool isUnderLoad() const;
+
+private:
+    struct Collector {
+        std::string name;
+        std::vector<DashboardCategory> categories;
+        Pace pace;
+        int slowdown = 1;               // Last applied
+    };
+
+    DemandSource demand_;
+    mutable std::mutex mutex_;
+    Settings settings_;
+    std::vector<Collector> collectors_;
+    std::array<Clock::time_point, kDashboardCategoryCount> last_request_{};
+    bool under_load_ = false;
+
+    // Caller holds mutex_
+    bool loaded();
+};
+
+} // namespace BackendDatalink
+
+#endif // COLLECTOR_GOVERNOR_H
@@ -3,6 +3,9 @@
 
 #include <string>
 #include <stdexcept>
+#include <vector>
+#include <map>
+#include <memory>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -12,9 +15,29 @@ public:
     struct WebSocketConfig {
         std::string host = "0.0.0.0";
         int port = 9002;
-        int max_connections = 100;
-        int timeout_ms = 5000;
+        int max_connections = 100; // Open connections plus handshakes in progress
+        int timeout_ms = 5000; // Open and close handshake limit
+        int ping_interval_ms = 30000; // Keepalive ping period; 0 disables pings
+        int pong_timeout_ms = 10000; // A ping unanswered this long closes the connection
+        int idle_timeout_ms = 0; // Close after this long without a frame from the client; 0 disables
+        int max_message_elements = 10000; // Values in one inbound message; 0 disables the limit
         bool enable_logging = true;
+        bool snapshot_on_connect = true; // Follow the welcome with a full dashboard_data reply
+        int io_threads = 1; // Threads running the asio io_service
+        // Handlers that can block (database reads, route changes) run at
+        // once on the shared executor, off the io threads; 0 runs them on
+        // the io threads
+        int handler_threads = 2;
+        int handler_queue = 64; // Requests waiting for a handler thread before clients get busy
+        int max_send_buffer_kb = 1024; // Per-connection outbound buffer limit
+        std::string slow_consumer_policy = "drop"; // "drop" or "disconnect"
+        bool compression_enabled = false; // permessage-deflate, when built with zlib
+        int compression_min_size_bytes = 512; // Smaller messages go out uncompressed
+        std::string unix_socket_path; // Also accept on this AF_UNIX socket when set
+        // SO_REUSEPORT, so the next process can listen before this one stops.
+        // Sockets passed by systemd (LISTEN_FDS) are used instead when present.
+        bool reuse_port = false;
+        int drain_seconds = 10; // On SIGTERM, close clients over this long before stopping; 0 stops at once
     };
 
     struct DatabaseConfig {
@@ -22,16 +45,247 @@ public:
         bool enabled = true;
         bool log_connections = true;
         bool log_messages = false;
+        // Connection tuning applied at open; defaults suit flash storage
+        std::string journal_mode = "WAL";
+        std::string synchronous = "NORMAL";
+        int cache_size_kb = 2048;
+        long long mmap_size_bytes = 0;
+        std::string temp_store = "MEMORY";
+        int busy_timeout_ms = 2000;
+        // Read-only connections for queries when journal_mode is WAL (0 = share the writer)
+        int reader_pool_size = 2;
+        // Connection/message log entries buffered for the background writer
+        int log_queue_capacity = 4096;
+        // Background maintenance of connections_log and messages
+        int maintenance_interval_seconds = 3600;
+        int log_retention_days = 30;
+        int max_connection_rows = 50000;
+        int max_message_rows = 100000;
+        // Schema check plus a write/read round trip on every boot (slow on flash)
+        bool self_test_on_startup = false;
     };
 
     struct SystemDataConfig {
         bool enabled = true;
         int poll_interval_seconds = 2;
-        int database_update_interval_seconds = 5;
+        int database_update_interval_seconds = 5; // Least time between two persisted snapshots
+        int broadcast_min_interval_ms = 250; // Least time between two dashboard broadcasts
         bool log_collection_progress = true;
         bool log_database_updates = true;
         int collection_progress_log_interval = 30; // Log every N collections
         int database_update_log_interval = 6; // Log every N database updates
+        std::map<std::string, int> collector_intervals_ms; // Per-collector sampling periods
+        std::vector<std::string> latency_targets = {"8.8.8.8:53", "1.1.1.1:53"}; // host:port, TCP connect
+        int latency_timeout_ms = 2000;
+        int latency_window = 10; // Probes per target in the rolling statistics
+        std::vector<std::string> external_ip_endpoints = {"https://ifconfig.me", "https://api.ipify.org"};
+        std::string modem_device = "/dev/ttyUSB2";     // AT port; empty disables the signal collector
+        std::string modem_data_interface = "wwan0";    // Counted for data usage
+        int process_top_count = 5;                     // Length of the top CPU and memory lists
+        std::vector<std::string> watched_processes = {"backend-datalink", "mosquitto"}; // Always reported
+        std::vector<std::string> storage_mounts = {"/"}; // Mount points whose usage is reported
+        std::string shared_memory_name = "/backend-datalink-metrics"; // Local readers' segment; empty disables
+        // Demand and load pacing (see CollectorGovernor)
+        int idle_slowdown = 4;                         // Collectors no client watches run this many times slower
+        int load_slowdown = 2;                         // All collectors, while the system is loaded
+        double load_backoff_per_cpu = 1.5;             // 1-minute load average per CPU counted as loaded; 0 ignores it
+        double cpu_pressure_backoff_percent = 25.0;    // CPU PSI "some avg10" counted as loaded; 0 ignores it
+    };
+
+    struct MetricsHistoryConfig {
+        bool enabled = true;
+        int ring_capacity = 3600; // Raw samples kept in memory
+        int flush_interval_seconds = 60;
+        int raw_retention_seconds = 86400; // 1 day
+        int minute_retention_seconds = 604800; // 7 days of 1-minute rollups
+        int hour_retention_seconds = 7776000; // 90 days of 1-hour rollups
+    };
+
+    // Downsampled metrics sent as RPC notifications (see TelemetryPublisher)
+    struct TelemetryConfig {
+        bool enabled = false;
+        int window_seconds = 60; // min/avg/max window; at most one notification each
+        int sample_interval_ms = 1000; // Least time between two samples of a window
+        int full_report_windows = 15; // Send every field at least this often; 0 = only on change
+        std::string method = "telemetry";
+        std::string service = "backend-datalink";
+        // Least move of a field's window average that is sent again, in the
+        // field's unit; fields not listed are sent on any change
+        std::map<std::string, double> deadbands = {
+            {"cpu_percent", 5.0}, {"cpu_temperature_c", 2.0}, {"ram_percent", 2.0}, {"swap_percent", 2.0},
+            {"latency_ms", 10.0}, {"rssi_dbm", 3.0}, {"sinr_db", 2.0}
+        };
+    };
+
+    struct RpcConfig {
+        int worker_threads = 4; // MQTT requests served at once on the shared executor
+        int queue_capacity = 64; // Requests waiting for a worker; beyond this they get "busy"
+        int outbound_queue_capacity = 256; // Messages per QoS lane waiting for the publisher thread
+        int log_queue_capacity = 1024;     // Async log ring shared with the backend; 0 logs synchronously
+        int log_flush_interval_ms = 200;   // Longest a queued log line waits to be written
+        // Responses kept to answer QoS 1 redeliveries without running the
+        // request again; 0 disables. The TTL should outlast the broker's
+        // redelivery after a reconnect.
+        int replay_cache_size = 1024;
+        int replay_ttl_seconds = 120;
+        // Responses larger than this go out in chunks to requests that ask
+        // for them ("chunk_window"); 0 sends every response whole. The
+        // requester's acks come in on the request topic, so with a shared
+        // subscription group they can reach another instance and stall
+        // the stream.
+        int response_chunk_bytes = 65536;
+        int response_chunk_window = 8;     // Most chunks of one response unacked
+    };
+
+    // Prometheus scrape endpoint; loopback only by default
+    struct MetricsConfig {
+        bool enabled = true;
+        std::string host = "127.0.0.1";
+        int port = 9102;
+    };
+
+    // Trace spans kept in per-thread rings, served as Chrome JSON at
+    // /trace on the metrics endpoint
+    struct TraceConfig {
+        bool enabled = true;
+        int buffer_events = 2048; // Most recent spans kept per thread
+    };
+
+    // Network diagnostics run for WebSocket clients (ping, traceroute, DNS,
+    // iperf3); a job still running after max_duration_seconds is stopped
+    struct DiagnosticsConfig {
+        bool enabled = true;
+        int max_concurrent_jobs = 2;
+        int max_duration_seconds = 300;
+    };
+
+    // IP camera discovery (WS-Discovery and mDNS) for the cameras page. A
+    // /24 sweep keeps at most probe_window unicast probes unanswered, sent
+    // at up to probe_rate_per_second; results are cached for
+    // cache_ttl_seconds, and a subnet scanned within that time is served
+    // from the cache.
+    struct CameraDiscoveryConfig {
+        bool enabled = true;
+        int probe_window = 32;
+        int probe_rate_per_second = 50;
+        int probe_timeout_ms = 1500;
+        int listen_seconds = 3;        // How long multicast answers are awaited
+        int cache_ttl_seconds = 600;
+    };
+
+    // MAVLink telemetry ingest for the MAVLink pages: frames arrive on
+    // udp_port and, when serial_device is set, on a serial link at baud.
+    // The last ring_size frames of each message type are kept, and a
+    // subscriber asks for at most max_rate_hz updates per second.
+    struct MavlinkConfig {
+        bool enabled = true;
+        int udp_port = 14550;
+        std::string serial_device;     // Empty: UDP only
+        int baud = 57600;
+        int ring_size = 64;
+        int max_rate_hz = 50;
+    };
+
+    // Wi-Fi site survey over nl80211. Scan results younger than
+    // cache_ttl_seconds are served without scanning again; a scan that has
+    // not reported back after scan_timeout_seconds is given up.
+    struct WirelessScanConfig {
+        bool enabled = true;
+        std::string interface;         // Empty: every wireless station interface
+        int cache_ttl_seconds = 30;
+        int scan_timeout_seconds = 10;
+    };
+
+    // Internet reachability of each uplink (a link with a default route),
+    // probed every reachability_interval_ms with TCP connects bound to the
+    // link; an uplink is reported unreachable after reachability_down_after
+    // failed rounds and reachable again after reachability_up_after good
+    // ones. No targets disables probing. With failover_enabled an uplink
+    // that is down, unreachable or slower than failover_max_latency_ms (0:
+    // any) is moved below the healthy ones at once, and back after
+    // failover_restore_hold_ms of good health.
+    struct NetworkPriorityConfig {
+        std::vector<std::string> reachability_targets = {"8.8.8.8:53", "1.1.1.1:53"}; // Numeric address:port
+        int reachability_interval_ms = 5000;
+        int reachability_timeout_ms = 1500;
+        int reachability_down_after = 3;
+        int reachability_up_after = 2;
+        bool failover_enabled = true;
+        int failover_restore_hold_ms = 30000;
+        int failover_max_latency_ms = 0;
+    };
+
+    // Tunnel state and byte counters for the VPN page. WireGuard devices
+    // are read over generic netlink every wireguard_refresh_ms (WireGuard
+    // has no notifications) and re-listed when links come and go. Each
+    // OpenVPN management endpoint, a Unix socket path or "host:port", is
+    // kept connected with state and bytecount pushes every
+    // bytecount_interval_seconds.
+    struct VpnMonitorConfig {
+        bool enabled = true;
+        std::vector<std::string> openvpn_management;
+        int bytecount_interval_seconds = 2;
+        int wireguard_refresh_ms = 2000;
+    };
+
+    // Live log tail for WebSocket "logs" subscribers. Each path is a log
+    // file or a directory of *.log files (frontendpp logs/, ur-logger-api
+    // log files). Lines are filtered per subscriber, limited to
+    // max_lines_per_second each and sent every batch_interval_ms; a new
+    // subscriber first gets up to backlog_lines earlier lines.
+    struct LogTailConfig {
+        bool enabled = true;
+        std::vector<std::string> paths;
+        int batch_interval_ms = 250;
+        int max_lines_per_second = 200;
+        int backlog_lines = 100;
+    };
+
+    // Fleet aggregator mode: this backend follows the dashboards of other
+    // nodes' backend-datalink over WebSocket and serves them to "fleet"
+    // subscribers as one stream. Each node is {"name", "url"} with a ws://
+    // URL. Only the listed categories are followed; a node's stored values
+    // are capped at max_node_kb. A frame of what changed goes to each
+    // subscriber at most every publish_interval_ms, and a lost node is
+    // reconnected with exponential backoff up to reconnect_max_seconds.
+    struct FleetConfig {
+        struct Node {
+            std::string name;
+            std::string url;
+        };
+        bool enabled = false;
+        std::vector<Node> nodes;
+        std::vector<std::string> categories = {"system", "ram", "network", "signal"};
+        int publish_interval_ms = 1000;
+        int max_node_kb = 256;
+        int reconnect_max_seconds = 60;
+    };
+
+    // Memory budget of the process, on its resident set; 0 disables a
+    // limit. Over soft_limit_mb the metrics history ring shrinks to
+    // history_ring_percent of ring_capacity and broadcasts go out
+    // broadcast_slowdown times less often; over hard_limit_mb new WebSocket
+    // clients are refused as well. Both recover under 90% of the limit.
+    struct MemoryBudgetConfig {
+        int soft_limit_mb = 0;
+        int hard_limit_mb = 0;
+        int history_ring_percent = 25;
+        int broadcast_slowdown = 4;
+    };
+
+    // Backend and RPC library log threshold: DEBUG, INFO, WARN, ERROR or
+    // FATAL (any case). Per-connection and per-message lines are DEBUG.
+    struct LoggingConfig {
+        std::string level = "INFO";
+    };
+
+    // Placement of the long-running threads: objects with the optional
+    // "name", "cpus", "policy", "priority" and "nice" keys of
+    // thread_create_from_json. Real-time policies need CAP_SYS_NICE.
+    struct ThreadsConfig {
+        json websocket = {{"name", "ws-server"}};
+        json mqtt = {{"name", "mqtt-loop"}};
+        json network_priority = {{"name", "net-priority"}, {"policy", "batch"}, {"nice", 10}};
     };
 
     ConfigLoader() = default;
@@ -42,16 +296,83 @@ public:
     const WebSocketConfig& getWebSocketConfig() const { return ws_config_; }
     const DatabaseConfig& getDatabaseConfig() const { return db_config_; }
     const SystemDataConfig& getSystemDataConfig() const { return system_data_config_; }
+    const MetricsHistoryConfig& getMetricsHistoryConfig() const { return metrics_history_config_; }
+    const TelemetryConfig& getTelemetryConfig() const { return telemetry_config_; }
+    const RpcConfig& getRpcConfig() const { return rpc_config_; }
+    const ThreadsConfig& getThreadsConfig() const { return threads_config_; }
+    const MetricsConfig& getMetricsConfig() const { return metrics_config_; }
+    const TraceConfig& getTraceConfig() const { return trace_config_; }
+    const DiagnosticsConfig& getDiagnosticsConfig() const { return diagnostics_config_; }
+    const CameraDiscoveryConfig& getCameraDiscoveryConfig() const { return camera_discovery_config_; }
+    const MavlinkConfig& getMavlinkConfig() const { return mavlink_config_; }
+    const WirelessScanConfig& getWirelessScanConfig() const { return wireless_scan_config_; }
+    const NetworkPriorityConfig& getNetworkPriorityConfig() const { return network_priority_config_; }
+    const VpnMonitorConfig& getVpnMonitorConfig() const { return vpn_monitor_config_; }
+    const LogTailConfig& getLogTailConfig() const { return log_tail_config_; }
+    const FleetConfig& getFleetConfig() const { return fleet_config_; }
+    const MemoryBudgetConfig& getMemoryBudgetConfig() const { return memory_budget_config_; }
+    const LoggingConfig& getLoggingConfig() const { return logging_config_; }
 
 private:
     WebSocketConfig ws_config_;
     DatabaseConfig db_config_;
     SystemDataConfig system_data_config_;
+    MetricsHistoryConfig metrics_history_config_;
+    TelemetryConfig telemetry_config_;
+    RpcConfig rpc_config_;
+    ThreadsConfig threads_config_;
+    MetricsConfig metrics_config_;
+    TraceConfig trace_config_;
+    DiagnosticsConfig diagnostics_config_;
+    CameraDiscoveryConfig camera_discovery_config_;
+    MavlinkConfig mavlink_config_;
+    WirelessScanConfig wireless_scan_config_;
+    NetworkPriorityConfig network_priority_config_;
+    VpnMonitorConfig vpn_monitor_config_;
+    LogTailConfig log_tail_config_;
+    FleetConfig fleet_config_;
+    MemoryBudgetConfig memory_budget_config_;
+    LoggingConfig logging_config_;
     
     void parseWebSocketConfig(const json& config);
     void parseDatabaseConfig(const json& config);
     void parseSystemDataConfig(const json& config);
+    void parseMetricsHistoryConfig(const json& config);
+    void parseTelemetryConfig(const json& config);
+    void parseRpcConfig(const json& config);
+    void parseThreadsConfig(const json& config);
+    void parseMetricsConfig(const json& config);
+    void parseTraceConfig(const json& config);
+    void parseDiagnosticsConfig(const json& config);
+    void parseCameraDiscoveryConfig(const json& config);
+    void parseMavlinkConfig(const json& config);
+    void parseWirelessScanConfig(const json& config);
+    void parseNetworkPriorityConfig(const json& config);
+    void parseVpnMonitorConfig(const json& config);
+    void parseLogTailConfig(const json& config);
+    void parseFleetConfig(const json& config);
+    void parseMemoryBudgetConfig(const json& config);
+    void parseLoggingConfig(const json& config);
     void validateConfig() const;
+    static std::string parseChoice(const json& config, const std::string& key, const std::string& path,
+                                   const std::vector<std::string>& choices);
+};
+
+// The configuration in effect, replaced as a whole by reload(). A snapshot
+// from current() never changes, so holders read it without locking.
+class ConfigStore {
+public:
+    explicit ConfigStore(std::string config_path) : config_path_(std::move(config_path)) {}
+
+    // Parses the file into a new snapshot and publishes it. On error the
+    // previous snapshot stays in effect and ConfigException is thrown.
+    std::shared_ptr<const ConfigLoader> reload();
+    std::shared_ptr<const ConfigLoader> current() const { return std::atomic_load(&current_); }
+    const std::string& path() const { return config_path_; }
+
+private:
+    std::string config_path_;
+    std::shared_ptr<const ConfigLoader> current_;
 };
 
 class ConfigException : public std::runtime_error {
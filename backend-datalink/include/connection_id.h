@@ -0,0 +1,41 @@
+#ifndef CONNECTION_ID_H
+#define CONNECTION_ID_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace BackendDatalink {
+
+// Identifies a WebSocket connection for as long as the process runs. The
+// low 32 bits are the connection's slot in WebSocketServer's table, the
+// high 32 bits the admission serial (from 1), so an id is never reused and
+// a stale one (its connection closed, the slot taken again) never matches.
+// Handlers, subscriber maps and the handler executor pass and hash it as a
+// plain integer; the string form is only built at the edges (database
+// rows, log lines, messages to the client).
+typedef uint64_t ConnectionId;
+
+constexpr ConnectionId kNoConnection = 0;
+
+inline ConnectionId makeConnectionId(uint32_t serial, uint32_t slot) {
+    return (static_cast<uint64_t>(serial) << 32) | slot;
+}
+
+inline uint32_t connectionSlot(ConnectionId id) {
+    return static_cast<uint32_t>(id);
+}
+
+// "conn_<epoch ms>_<serial>", the epoch being taken once per process, so
+// the form stays unique across restarts for the connections_log and
+// messages tables
+inline std::string connectionIdString(ConnectionId id) {
+    static const std::string prefix = "conn_" + std::to_string(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()) + "_";
+    return prefix + std::to_string(id >> 32);
+}
+
+} // namespace BackendDatalink
+
+#endif // CONNECTION_ID_H
@@ -0,0 +1,77 @@
+#ifndef DASHBOARD_CATEGORIES_H
+#define DASHBOARD_CATEGORIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Every dashboard category, indexed by DashboardCategory. The name is the
+// WebSocket topic, the dashboard_data table key and the key in
+// dashboard_data replies. Adding a category is one enumerator and one row.
+enum class DashboardCategory : uint8_t {
+    System,
+    Ram,
+    Swap,
+    Network,
+    UltimaServer,
+    Signal,
+    Processes,
+    Storage,
+    Threads,
+    NetworkPriority,
+    Cameras,
+    Wireless,
+    Vpn
+};
+
+struct DashboardCategoryInfo {
+    DashboardCategory id;
+    const char* name;
+    const char* section;      // Top-level section of the collector JSON it is cut from; nullptr if fed elsewhere
+    bool in_full_reply;       // Sent when dashboard_data names no categories
+};
+
+constexpr DashboardCategoryInfo kDashboardCategories[] = {
+    {DashboardCategory::System, "system", "cpu", true},
+    {DashboardCategory::Ram, "ram", "ram", true},
+    {DashboardCategory::Swap, "swap", "swap", true},
+    {DashboardCategory::Network, "network", "network", true},
+    {DashboardCategory::UltimaServer, "ultima_server", "ultima_server", true},
+    {DashboardCategory::Signal, "signal", "signal", true},
+    {DashboardCategory::Processes, "processes", "processes", true},
+    {DashboardCategory::Storage, "storage", "storage", true},
+    {DashboardCategory::Threads, "threads", nullptr, true},
+    {DashboardCategory::NetworkPriority, "network_priority", nullptr, false},
+    {DashboardCategory::Cameras, "cameras", nullptr, false},
+    {DashboardCategory::Wireless, "wireless", nullptr, false},
+    {DashboardCategory::Vpn, "vpn", nullptr, false}
+};
+
+constexpr size_t kDashboardCategoryCount = sizeof(kDashboardCategories) / sizeof(kDashboardCategories[0]);
+
+constexpr bool dashboardCategoriesInOrder(size_t index = 0) {
+    return index == kDashboardCategoryCount ||
+           (static_cast<size_t>(kDashboardCategories[index].id) == index && dashboardCategoriesInOrder(index + 1));
+}
+static_assert(dashboardCategoriesInOrder(), "kDashboardCategories rows must follow the DashboardCategory order");
+
+constexpr size_t categoryIndex(DashboardCategory category) {
+    return static_cast<size_t>(category);
+}
+
+constexpr const char* categoryName(DashboardCategory category) {
+    return kDashboardCategories[categoryIndex(category)].name;
+}
+
+// False for a name that is not a dashboard category
+inline bool parseDashboardCategory(const char* name, DashboardCategory& category) {
+    for (const auto& info : kDashboardCategories) {
+        if (std::strcmp(info.name, name) == 0) {
+            category = info.id;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // DASHBOARD_CATEGORIES_H
@@ -0,0 +1,55 @@
+#ifndef DASHBOARD_DELTA_H
+#define DASHBOARD_DELTA_H
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "dashboard_categories.h"
+
+using json = nlohmann::json;
+
+// Keeps the last broadcast value per dashboard category and turns each new
+// sample into the smallest message the clients need:
+//   - nothing, when the category is unchanged
+//   - "dashboard_delta" with an RFC 7386 merge patch against the previous value
+//   - "dashboard_update" with the full value on first use, when a merge patch
+//     cannot express the change (null values) or every full_snapshot_interval
+//     sequence numbers so clients that missed a frame converge again
+// Every emitted frame carries a per-category "seq"; a client that sees a gap
+// re-requests dashboard_data for that category. Frames are stamped with
+// "timestamp" (seconds) and "timestamp_ms" so delivery delay can be measured.
+class DashboardDeltaEngine {
+public:
+    explicit DashboardDeltaEngine(uint64_t full_snapshot_interval = 30);
+
+    // Returns false if the category is unchanged and nothing should be sent
+    bool buildUpdate(DashboardCategory category, const json& data, json& message);
+
+    // Sequence number of the last frame emitted for a category (0 if none)
+    uint64_t getSequence(DashboardCategory category) const;
+
+    // Changes with every emitted frame and every reset(), across all
+    // categories; never goes backwards
+    uint64_t getVersion() const { return version_.load(std::memory_order_acquire); }
+
+    // Forget all state so the next sample of every category is sent in full
+    void reset();
+
+private:
+    struct CategoryState {
+        json last_data;
+        uint64_t seq = 0;           // 0 until the first frame
+        uint64_t last_full_seq = 0;
+    };
+
+    static bool createMergePatch(const json& source, const json& target, json& patch);
+
+    mutable std::mutex state_mutex_;
+    std::array<CategoryState, kDashboardCategoryCount> states_;
+    uint64_t full_snapshot_interval_;
+    std::atomic<uint64_t> version_{0};
+};
+
+#endif // DASHBOARD_DELTA_H
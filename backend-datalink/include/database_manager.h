@@ -4,9 +4,19 @@
 #include <string>
 #include <sqlite3.h>
 #include <mutex>
+#include <condition_variable>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include <utility>
 #include <memory>
 #include <chrono>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <cstdint>
 #include "config_loader.h"
+#include "bounded_mpsc_queue.h"
 
 class DatabaseManager {
 public:
@@ -18,7 +28,8 @@ public:
     
     bool isInitialized() const { return db_ != nullptr; }
     
-    // Connection logging
+    // Connection logging. Entries are queued for the background log writer;
+    // false means the queue was full and the entry was dropped.
     bool logConnection(const std::string& connection_id, const std::string& client_ip, 
                       const std::string& status = "connected");
     bool logDisconnection(const std::string& connection_id);
@@ -27,32 +38,155 @@ public:
     bool logMessage(const std::string& connection_id, const std::string& direction, 
                    const std::string& message_text);
     
-    // Query methods
+    // Log entries dropped because the write-behind queue was full
+    uint64_t getDroppedLogCount() const { return dropped_log_entries_.load(std::memory_order_relaxed); }
+    
+    // Query methods. The active count is tracked in memory from
+    // logConnection/logDisconnection rather than counted in SQL.
     int getActiveConnectionCount() const;
     std::vector<std::string> getRecentConnections(int limit = 10) const;
     
     // Dashboard data methods
     bool updateDashboardData(const std::string& category, const std::string& data_json);
     std::string getDashboardData(const std::string& category) const;
+    
+    // Write-through variants backed by the in-memory latest-value cache;
+    // reads are served from RAM and only fall back to SQLite on a miss.
+    // Values are persisted as MessagePack in dashboard_data.data_msgpack and
+    // only rewritten when they change.
+    bool updateDashboardData(const std::string& category, const json& data);
+    bool getDashboardDataJson(const std::string& category, json& data) const;
+    // Bumped whenever a cached category changes or is dropped; equal values
+    // mean every category still reads the same
+    uint64_t getDashboardGeneration() const { return dashboard_generation_.load(std::memory_order_acquire); }
+    
+    // Writes all categories in a single BEGIN IMMEDIATE ... COMMIT
+    bool updateDashboardDataBatch(const std::vector<std::pair<std::string, json>>& entries);
     bool initializeDashboardTables();
     
-    // Database verification methods
+    // Generic statement execution through the prepared statement cache, for
+    // components that keep their own tables in this database
+    bool execute(const std::string& sql);
+    bool executeWithParams(const std::string& sql, const std::vector<std::string>& params);
+    // Runs one statement per parameter row inside a single transaction
+    bool executeBatch(const std::string& sql, const std::vector<std::vector<std::string>>& rows);
+    // Runs statements of different shapes (SQL and parameters) inside a
+    // single transaction; an empty list touches nothing
+    typedef std::pair<std::string, std::vector<std::string>> Statement;
+    bool executeTransaction(const std::vector<Statement>& statements);
+    bool query(const std::string& sql, const std::vector<std::string>& params,
+               const std::function<void(sqlite3_stmt*)>& row_handler) const;
+    
+    // Deep checks, only run at startup when self_test_on_startup is set
     bool verifyDatabaseSchema();
     bool testDatabaseOperations();
 
 private:
+    typedef std::unordered_map<std::string, sqlite3_stmt*> StatementCache;
+    
     sqlite3* db_ = nullptr;
     ConfigLoader::DatabaseConfig config_;
     mutable std::mutex db_mutex_;
     
-    // Database initialization
+    // Prepared statements keyed by SQL text, guarded by db_mutex_. Each is
+    // prepared once and reset/cleared after use; finalized on shutdown.
+    mutable StatementCache statement_cache_;
+    
+    // Read-only connection with its own prepared statements. In WAL mode a
+    // reader sees the last committed snapshot without waiting on db_mutex_.
+    struct ReaderConnection {
+        sqlite3* db = nullptr;
+        StatementCache statements;
+    };
+    
+    // Checks a reader out of the pool for the lifetime of the lease; when the
+    // pool is empty (disabled or not in WAL mode) it locks db_mutex_ and
+    // borrows the writer connection instead
+    class ReaderLease {
+    public:
+        explicit ReaderLease(const DatabaseManager& manager);
+        ~ReaderLease();
+        
+        ReaderLease(const ReaderLease&) = delete;
+        ReaderLease& operator=(const ReaderLease&) = delete;
+        
+        sqlite3_stmt* statement(const std::string& sql);
+        
+    private:
+        const DatabaseManager& manager_;
+        ReaderConnection* reader_ = nullptr;
+        std::unique_lock<std::mutex> writer_lock_;
+    };
+    
+    std::vector<std::unique_ptr<ReaderConnection>> readers_;
+    mutable std::vector<ReaderConnection*> idle_readers_;
+    mutable std::mutex reader_mutex_;
+    mutable std::condition_variable reader_cv_;
+    
+    // Latest value per dashboard category, kept separate from db_mutex_ so
+    // readers never wait on a write in progress
+    mutable std::shared_mutex cache_mutex_;
+    mutable std::unordered_map<std::string, json> dashboard_cache_;
+    std::atomic<uint64_t> dashboard_generation_{0};
+    
+    // Write-behind log queue: lock-free producers on the websocket threads,
+    // drained by log_writer_thread_ in batched transactions. The same thread
+    // runs the periodic retention job.
+    struct LogEntry {
+        enum class Kind { Connect, Disconnect, Message };
+        Kind kind = Kind::Message;
+        std::string connection_id;
+        std::string field1;     // client_ip or direction
+        std::string field2;     // status or message_text
+        std::string timestamp;
+    };
+    
+    std::unique_ptr<BoundedMpscQueue<LogEntry>> log_queue_;
+    std::thread log_writer_thread_;
+    std::atomic<bool> log_writer_running_{false};
+    std::mutex log_wake_mutex_;
+    std::condition_variable log_wake_cv_;
+    std::atomic<uint64_t> dropped_log_entries_{0};
+    std::atomic<int> active_connections_{0};
+    std::chrono::steady_clock::time_point last_maintenance_;
+    
+    void startLogWriter();
+    void stopLogWriter();
+    void logWriterLoop();
+    bool enqueueLogEntry(LogEntry entry);
+    size_t flushLogEntries();
+    bool writeLogEntry(const LogEntry& entry);
+    
+    // Retention: age and row-cap pruning followed by an incremental vacuum
+    void runMaintenance();
+    int deleteInChunks(const std::string& sql, const std::vector<std::string>& params);
+    void closeStaleConnections();
+    bool upgradeDashboardTable();
+    
+    // Database initialization. The schema version lives in PRAGMA user_version;
+    // migrateSchema() applies the steps newer than it, each in its own
+    // transaction, so an up-to-date database costs a single PRAGMA read.
     bool createDatabase();
     bool createTables();
+    bool migrateSchema();
+    bool rebuildMessagesTable();
+    void applyConnectionTuning();
+    bool openReaderPool();
+    void closeReaderPool();
+    
+    // Statement cache (caller holds db_mutex_ or owns the reader)
+    sqlite3_stmt* getStatement(const std::string& sql) const;
+    sqlite3_stmt* prepareCached(sqlite3* db, StatementCache& cache, const std::string& sql) const;
+    static void finalizeStatements(StatementCache& cache);
     
     // Utility methods
     std::string getCurrentTimestamp() const;
     bool executeSQL(const std::string& sql);
     bool executeSQLWithParams(const std::string& sql, const std::vector<std::string>& params);
+    bool persistDashboardDataLocked(const std::string& category, const std::string& data_json,
+                                    const std::vector<uint8_t>& data_msgpack, const std::string& timestamp);
+    bool persistDashboardBatch(const std::vector<const std::pair<std::string, json>*>& changed);
+    bool loadDashboardData(const std::string& category, json& data) const;
     
     // Error handling
     void logError(const std::string& message) const;
@@ -0,0 +1,128 @@
+#ifndef DEADLINE_SCHEDULER_H
+#define DEADLINE_SCHEDULER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace BackendDatalink {
+
+// Work queue with priority lanes, each served earliest deadline first.
+// Lane 0 goes first; a lower lane still gets one item after starvationLimit
+// in a row were taken ahead of it, so bulk work slows down under control
+// traffic but never stops. Each lane has its own capacity, so a flood in
+// one lane cannot push out another. An item whose deadline has passed is
+// handed to the caller's onExpired instead of being returned by pop().
+template <typename T>
+class DeadlineScheduler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    DeadlineScheduler(size_t lanes, size_t laneCapacity, unsigned starvationLimit = 8)
+        : lanes_(lanes == 0 ? 1 : lanes), laneCapacity_(laneCapacity == 0 ? 1 : laneCapacity),
+          starvationLimit_(starvationLimit == 0 ? 1 : starvationLimit) {}
+
+    DeadlineScheduler(const DeadlineScheduler&) = delete;
+    DeadlineScheduler& operator=(const DeadlineScheduler&) = delete;
+
+    // deadline orders the lane; only an item that expires is ever dropped
+    // for being late. False when the lane is full.
+    bool push(size_t lane, Clock::time_point deadline, bool expires, T value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Lane& target = lanes_[std::min(lane, lanes_.size() - 1)];
+        if (target.heap.size() >= laneCapacity_) {
+            return false;
+        }
+        target.heap.push_back(Entry{deadline, nextSequence_++, expires, std::move(value)});
+        std::push_heap(target.heap.begin(), target.heap.end(), Later());
+        ++size_;
+        return true;
+    }
+
+    // onExpired(lane, item) runs, with the lock held, for each late item
+    // met before the one returned
+    template <typename OnExpired>
+    bool pop(T& out, Clock::time_point now, OnExpired&& onExpired) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (size_ > 0) {
+            size_t lane = nextLane();
+            std::vector<Entry>& heap = lanes_[lane].heap;
+            std::pop_heap(heap.begin(), heap.end(), Later());
+            Entry entry = std::move(heap.back());
+            heap.pop_back();
+            --size_;
+            if (entry.expires && entry.deadline <= now) {
+                onExpired(lane, std::move(entry.value));
+                continue;
+            }
+            out = std::move(entry.value);
+            return true;
+        }
+        return false;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+
+    size_t laneCapacity() const { return laneCapacity_; }
+
+private:
+    struct Entry {
+        Clock::time_point deadline;
+        uint64_t sequence;      // Equal deadlines go first come, first served
+        bool expires;
+        T value;
+    };
+
+    // Heap order: the top is the earliest deadline
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.deadline != b.deadline ? a.deadline > b.deadline : a.sequence > b.sequence;
+        }
+    };
+
+    struct Lane {
+        std::vector<Entry> heap;
+        unsigned skipped = 0;   // Items taken from higher lanes while this one waited
+    };
+
+    // Caller holds mutex_ and size_ > 0
+    size_t nextLane() {
+        size_t chosen = lanes_.size();
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            if (lanes_[i].heap.empty()) {
+                continue;
+            }
+            if (chosen == lanes_.size()) {
+                chosen = i;
+            } else if (lanes_[i].skipped >= starvationLimit_) {
+                chosen = i;
+                break;
+            }
+        }
+        for (size_t i = chosen + 1; i < lanes_.size(); ++i) {
+            if (!lanes_[i].heap.empty()) {
+                ++lanes_[i].skipped;
+            }
+        }
+        lanes_[chosen].skipped = 0;
+        return chosen;
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<Lane> lanes_;
+    size_t laneCapacity_;
+    unsigned starvationLimit_;
+    size_t size_ = 0;
+    uint64_t nextSequence_ = 0;
+};
+
+} // namespace BackendDatalink
+
+#endif // DEADLINE_SCHEDULER_H
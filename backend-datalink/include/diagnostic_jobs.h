@@ -0,0 +1,107 @@
+#ifndef DIAGNOSTIC_JOBS_H
+#define DIAGNOSTIC_JOBS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "connection_id.h"
+
+using json = nlohmann::json;
+
+namespace ThreadMgr {
+class ThreadManager;
+}
+
+namespace BackendDatalink {
+
+// Network diagnostics (ping, traceroute, DNS lookup, iperf3 throughput) run
+// as child processes on behalf of one WebSocket connection. Each output line
+// goes to that connection as soon as the tool prints it:
+//   {"type": "diagnostic_output", "job_id", "stream": "stdout" | "stderr", "line", "seq"}
+// and the job ends with
+//   {"type": "diagnostic_done", "job_id", "tool", "exit_status", "cancelled", "timed_out", "lines", "duration_ms"}
+// Tools are exec'd with an argument vector built from validated fields,
+// never through a shell. Output is read by the ThreadManager's I/O thread;
+// a supervisor thread enforces cancellation, the duration limit and the
+// cap on concurrent jobs.
+class DiagnosticJobs {
+public:
+    typedef std::function<void(ConnectionId connection_id, const json& message)> Sender;
+
+    DiagnosticJobs(Sender sender, size_t max_jobs, std::chrono::seconds max_duration);
+    ~DiagnosticJobs();
+
+    DiagnosticJobs(const DiagnosticJobs&) = delete;
+    DiagnosticJobs& operator=(const DiagnosticJobs&) = delete;
+
+    void start();
+    // Kills the running jobs without sending diagnostic_done
+    void stop();
+
+    // request: {"tool": "ping" | "traceroute" | "dns" | "throughput", tool
+    // fields}. Returns the diagnostic_started message. Throws
+    // std::invalid_argument for a bad request and std::runtime_error when
+    // max_jobs are running or the tool cannot be started.
+    json startJob(ConnectionId connection_id, const json& request);
+
+    // False if the connection has no such job
+    bool cancelJob(ConnectionId connection_id, const std::string& job_id);
+    // On disconnect; the jobs' remaining output is dropped
+    void cancelConnection(ConnectionId connection_id);
+
+    size_t activeJobs() const;
+
+private:
+    struct Job {
+        std::string id;
+        ConnectionId connection_id = kNoConnection;
+        std::string tool;
+        unsigned int thread_id = 0;     // 0 while launching; manager ids start at 1
+        std::chrono::steady_clock::time_point started;
+        std::chrono::steady_clock::time_point deadline;
+        std::chrono::steady_clock::time_point stop_sent_at;
+
+        // Guarded by DiagnosticJobs::mutex_
+        bool cancelled = false;
+        bool timed_out = false;
+        bool stop_sent = false;
+        bool muted = false;             // Connection gone
+        int open_streams = 2;
+        std::string partial[2];         // Unterminated tail of stdout, stderr (I/O thread)
+        uint64_t lines = 0;             // Output lines sent (I/O thread)
+    };
+
+    // Longer lines are split; a tool without newlines cannot grow the buffer
+    static const size_t kMaxLineLength = 1024;
+    // After SIGTERM/SIGKILL, how long to wait for the pipes to close before
+    // giving up on a job whose descendants hold them open
+    static constexpr std::chrono::seconds kStopGrace{5};
+
+    Sender sender_;
+    const size_t max_jobs_;
+    const std::chrono::seconds max_duration_;
+    std::unique_ptr<ThreadMgr::ThreadManager> processes_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, std::shared_ptr<Job>> jobs_;
+    uint64_t next_id_ = 1;
+    bool running_ = false;
+    std::thread supervisor_;
+
+    void onOutput(const std::weak_ptr<Job>& weak_job, int stream, const char* data, size_t size);
+    void finish(const std::shared_ptr<Job>& job);
+    void supervise();
+};
+
+} // namespace BackendDatalink
+
+#endif // DIAGNOSTIC_JOBS_H
@@ -0,0 +1,138 @@
+#ifndef FLEET_AGGREGATOR_H
+#define FLEET_AGGREGATOR_H
+
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "config_loader.h"
+#include "connection_id.h"
+
+using json = nlohmann::json;
+
+namespace BackendDatalink {
+
+// Aggregator mode: one stream for a fleet dashboard instead of one browser
+// tab per device.
+//   - Each configured node is a WebSocket client of that node's
+//     backend-datalink, asking for MessagePack. On connect it subscribes
+//     to the followed categories and reads them once with
+//     get_dashboard_data; after that dashboard_update and dashboard_delta
+//     frames keep a latest-value store per node current. A delta that does
+//     not follow the stored seq asks for that category again.
+//   - A node's values are held to max_node_kb: a category that would go
+//     over is stored as null and listed in "oversize", and bigger frames
+//     close the connection.
+//   - A node that fails, closes or stays silent for 30 s is reconnected
+//     after 1, 2, 4, ... seconds up to reconnect_max_seconds, with jitter.
+//     Its last values stay in the store, marked by its "state".
+//   - Subscribers get at most one frame per publish_interval_ms, with only
+//     the node states and categories that changed since their last frame:
+//       {"type": "fleet_update", "epoch", "generation", "full",
+//        "nodes": {name: {"state", "error", "oversize", "categories": {category: value}}}}
+//     A client that reconnects passes back the epoch and generation it has
+//     and continues from there; with an unknown epoch (this process was
+//     restarted) it gets everything.
+class FleetAggregator {
+public:
+    typedef std::function<void(ConnectionId connection_id, const json& message)> Sender;
+
+    FleetAggregator(const ConfigLoader::FleetConfig& config, Sender sender);
+    ~FleetAggregator();
+
+    FleetAggregator(const FleetAggregator&) = delete;
+    FleetAggregator& operator=(const FleetAggregator&) = delete;
+
+    bool start();
+    void stop();
+
+    // Replaces the connection's subscription. nodes narrows it to those
+    // names (empty: every node); epoch and generation come from the last
+    // frame the client received, or 0. Throws std::invalid_argument for an
+    // unknown node.
+    void subscribe(ConnectionId connection_id, const std::vector<std::string>& nodes,
+                   uint64_t epoch, uint64_t generation);
+    // False if the connection had no subscription
+    bool unsubscribe(ConnectionId connection_id);
+
+    // Link state and counters per node
+    json getStatus() const;
+    // Serialized size of the values held for every node
+    size_t heldBytes() const;
+
+private:
+    typedef websocketpp::client<websocketpp::config::asio_client> Client;
+
+    struct Value {
+        json data;
+        uint64_t seq = 0;
+        uint64_t generation = 0;        // Of the last change
+        size_t bytes = 0;               // Serialized size of data
+        bool oversize = false;
+    };
+
+    struct Node {
+        std::string name;
+        std::string url;
+        websocketpp::connection_hdl connection;
+        uint64_t attempt = 0;           // Tells stale handler calls apart
+        bool connected = false;
+        int failures = 0;               // Since the last successful connect
+        std::string state = "connecting";
+        std::string error;
+        uint64_t state_generation = 0;
+        std::chrono::steady_clock::time_point last_message;
+        std::map<std::string, Value> values;    // By category
+        std::set<std::string> resyncing;        // Deltas ignored until a full value
+        size_t bytes = 0;
+        uint64_t messages = 0;
+        uint64_t resyncs = 0;
+        uint64_t reconnects = 0;
+    };
+
+    struct Subscriber {
+        std::set<std::string> nodes;    // Empty: every node
+        uint64_t generation = 0;        // Everything up to this was sent
+    };
+
+    static constexpr std::chrono::seconds kStaleTimeout{30};
+    static constexpr std::chrono::seconds kConnectTimeout{10};
+
+    ConfigLoader::FleetConfig config_;
+    Sender sender_;
+    const uint64_t epoch_;
+    size_t max_node_bytes_;
+
+    Client client_;
+    std::thread thread_;
+
+    mutable std::mutex mutex_;
+    bool running_ = false;
+    std::vector<Node> nodes_;                        // Guarded by mutex_
+    std::map<ConnectionId, Subscriber> subscribers_;  // Guarded by mutex_
+    uint64_t generation_ = 0;                        // Guarded by mutex_
+
+    // All on the client's io thread
+    void connect(size_t index);
+    void onOpen(size_t index, uint64_t attempt);
+    void onClosed(size_t index, uint64_t attempt, const std::string& error);
+    void onMessage(size_t index, uint64_t attempt, Client::message_ptr message);
+    void sendToNode(websocketpp::connection_hdl connection, const json& message);
+    void publish();
+    // Stores a full category value; false if it does not fit the node's budget
+    bool storeValue(Node& node, const std::string& category, json data, uint64_t seq);
+    void setState(Node& node, const std::string& state, const std::string& error);
+    bool followed(const std::string& category) const;
+};
+
+} // namespace BackendDatalink
+
+#endif // FLEET_AGGREGATOR_H
@@ -0,0 +1,72 @@
+#ifndef HANDLER_EXECUTOR_H
+#define HANDLER_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include "connection_id.h"
+#include "TaskExecutor.hpp"
+
+namespace BackendDatalink {
+
+// Runs the WebSocket handlers that can block (database reads, route
+// changes) off the io threads, which keep reading frames, answering pings
+// and flushing sends meanwhile. Jobs are posted under a key, the
+// connection id: those of one key run one at a time in posting order, as
+// on a strand, so a client's replies keep the order of its requests, while
+// different keys share the workers. The workers are those of the
+// process-wide TaskExecutor, which the MQTT RPC requests run on too, so
+// dashboard and cloud load share one pool: at most `workers` drain tasks
+// run there at once, each taking one job of a key and then moving on to
+// the next key, so one busy client cannot hold a worker. At most capacity
+// jobs wait; post() refuses more and the caller answers busy.
+class HandlerExecutor {
+public:
+    typedef std::function<void()> Job;
+
+    HandlerExecutor(size_t workers, size_t capacity);
+    ~HandlerExecutor();
+
+    HandlerExecutor(const HandlerExecutor&) = delete;
+    HandlerExecutor& operator=(const HandlerExecutor&) = delete;
+
+    // False when capacity jobs are waiting or the executor stopped
+    bool post(ConnectionId key, Job job);
+    // Drops the key's waiting jobs (its client went away); one already
+    // running finishes
+    void cancel(ConnectionId key);
+    // Runs the jobs already waiting, then returns once none is running
+    void stop();
+
+    size_t getPendingCount() const;
+    uint64_t getRejectedCount() const { return rejected_.load(); }
+
+private:
+    struct Strand {
+        std::deque<Job> jobs;
+        bool running = false;           // A worker holds its next job
+    };
+
+    ThreadMgr::TaskExecutor& executor_;
+    const size_t max_drains_;
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable idle_cv_;
+    std::unordered_map<ConnectionId, Strand> strands_;
+    std::deque<ConnectionId> ready_;    // Keys with a job and no worker
+    size_t pending_ = 0;
+    size_t active_drains_ = 0;          // Drain tasks queued or running on the executor
+    bool stopping_ = false;
+    std::atomic<uint64_t> rejected_{0};
+
+    void drain();
+};
+
+} // namespace BackendDatalink
+
+#endif // HANDLER_EXECUTOR_H
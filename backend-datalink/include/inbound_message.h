@@ -0,0 +1,81 @@
+#ifndef INBOUND_MESSAGE_H
+#define INBOUND_MESSAGE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "message_arena.h"
+
+// Wire encoding negotiated through Sec-WebSocket-Protocol ("json",
+// "msgpack" or "cbor"); binary encodings go out as binary frames
+enum class WireEncoding {
+    Json = 0,
+    MessagePack = 1,
+    Cbor = 2
+};
+
+namespace BackendDatalink {
+
+// One request received on a WebSocket, read lazily. scan() makes a single
+// SAX pass over the payload that validates it, counts its values and pulls
+// out the top-level routing fields ("type", "action" and the strings of a
+// "categories" array) without building a tree. Handlers that need more ask
+// for body(), which parses the DOM into the thread's MessageArena on first
+// use. Dashboard and subscription requests, the bulk of the traffic, never
+// get that far.
+//
+// The payload is referenced, not copied: the message is only valid while
+// the frame it was read from is.
+class InboundMessage {
+public:
+    enum class ScanResult {
+        Ok,
+        Malformed,  // Not valid JSON / MessagePack / CBOR
+        TooLarge    // More values than the element limit
+    };
+
+    InboundMessage(const std::string& payload, WireEncoding encoding);
+
+    InboundMessage(const InboundMessage&) = delete;
+    InboundMessage& operator=(const InboundMessage&) = delete;
+
+    // max_elements of 0 means no limit. A payload over the limit is
+    // abandoned as soon as the limit is crossed.
+    ScanResult scan(size_t max_elements);
+
+    // Empty when the field is missing or not a string
+    const std::string& type() const { return type_; }
+    const std::string& action() const { return action_; }
+
+    // True when "categories" is an array; non-string entries are skipped
+    bool hasCategories() const { return has_categories_; }
+    const std::vector<std::string>& categories() const { return categories_; }
+
+    size_t elementCount() const { return element_count_; }
+    size_t payloadSize() const { return payload_.size(); }
+    // To copy the message for handling after the frame is gone
+    const std::string& payload() const { return payload_; }
+    WireEncoding encoding() const { return encoding_; }
+
+    // Full document; parsed once, inside the caller's MessageArena scope
+    const message_json& body() const;
+
+private:
+    class ScanHandler;
+
+    const std::string& payload_;
+    const WireEncoding encoding_;
+
+    std::string type_;
+    std::string action_;
+    bool has_categories_ = false;
+    std::vector<std::string> categories_;
+    size_t element_count_ = 0;
+
+    mutable bool body_parsed_ = false;
+    mutable message_json body_;
+};
+
+} // namespace BackendDatalink
+
+#endif // INBOUND_MESSAGE_H
@@ -0,0 +1,150 @@
+#ifndef LOG_TAIL_H
+#define LOG_TAIL_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <regex>
+#include <functional>
+#include <cstdint>
+#include <sys/types.h>
+#include <nlohmann/json.hpp>
+#include "config_loader.h"
+#include "connection_id.h"
+
+using json = nlohmann::json;
+
+namespace BackendDatalink {
+
+// `tail -f` of the device logs for WebSocket clients.
+//   - Each configured path is a log file or a directory whose *.log files
+//     are all followed. Directories (a file's parent directory) are watched
+//     with inotify, so appends, truncation and rotation are seen without
+//     polling; a path that does not exist yet is looked for again every
+//     few seconds.
+//   - New bytes are read with pread from the last offset, and only while
+//     someone is subscribed: otherwise the offset just moves to the end.
+//   - Every line is matched against each subscriber's filter here (minimum
+//     level, components, regex) so only matching lines leave the device.
+//     The level is the first bracketed level word ("[WARN]", "[ERROR]",
+//     ...), INFO if there is none; the component is the file name without
+//     ".log".
+//   - Each subscriber has a max_lines_per_second token bucket. Matching
+//     lines go out every batch_interval_ms as
+//       {"type": "logs", "lines": [{"component", "level", "text"}], "dropped": n}
+//     with lines over the rate counted in "dropped" instead.
+//   - On subscribe, up to backlog_lines matching lines from the end of
+//     each file are sent first.
+class LogTail {
+public:
+    typedef std::function<void(ConnectionId connection_id, const json& message)> Sender;
+
+    struct Filter {
+        std::string min_level = "DEBUG";
+        std::vector<std::string> components;   // Empty: every file
+        std::string pattern;                    // ECMAScript regex, empty: every line
+    };
+
+    LogTail(const ConfigLoader::LogTailConfig& config, Sender sender);
+    ~LogTail();
+
+    LogTail(const LogTail&) = delete;
+    LogTail& operator=(const LogTail&) = delete;
+
+    // False if inotify is not available
+    bool start();
+    void stop();
+
+    // Replaces the connection's filter. Throws std::invalid_argument for an
+    // unknown level or a pattern that does not compile.
+    void subscribe(ConnectionId connection_id, const Filter& filter);
+    // False if the connection was not subscribed
+    bool unsubscribe(ConnectionId connection_id);
+
+    // Followed files and subscribers
+    json getStatus() const;
+
+private:
+    struct WatchedDirectory {
+        std::string path;
+        bool all_logs = false;          // Follow every *.log file
+        std::set<std::string> names;    // Otherwise only these
+    };
+
+    struct TailedFile {
+        std::string path;
+        std::string component;
+        int fd = -1;
+        ino_t inode = 0;
+        off_t offset = 0;
+        std::string partial;            // Unterminated last line
+    };
+
+    struct Subscriber {
+        Filter filter;
+        int min_level = 0;
+        std::set<std::string> components;
+        bool has_pattern = false;
+        std::regex pattern;
+        bool backlog_due = true;
+        double tokens = 0;
+        std::chrono::steady_clock::time_point refilled;
+        json lines = json::array();
+        uint64_t dropped = 0;           // Since the last batch
+        uint64_t dropped_total = 0;
+    };
+
+    static constexpr std::chrono::seconds kRescanInterval{5};
+    // More than this appended between two reads is skipped to its last part
+    static const off_t kMaxReadBytes = 4 * 1024 * 1024;
+    static const off_t kBacklogBytes = 64 * 1024;
+    static const size_t kReadChunk = 64 * 1024;
+    static const size_t kMaxLineLength = 4096;
+    static const size_t kMaxPatternLength = 256;
+
+    ConfigLoader::LogTailConfig config_;
+    Sender sender_;
+
+    int inotify_fd_ = -1;
+    int wake_fd_ = -1;
+
+    std::thread thread_;
+    // Loop thread only
+    std::map<int, WatchedDirectory> watches_;   // By watch descriptor
+    std::map<std::string, TailedFile> files_;   // By path
+    std::vector<std::string> missing_;          // Configured paths not found yet
+    std::chrono::steady_clock::time_point rescan_at_;
+    std::vector<char> buffer_;
+
+    mutable std::mutex mutex_;
+    bool running_ = false;
+    std::map<ConnectionId, Subscriber> subscribers_;  // Guarded by mutex_
+    std::vector<std::string> followed_;             // Guarded by mutex_
+    uint64_t lines_read_ = 0;                       // Guarded by mutex_
+
+    void run();
+    void wake();
+    // Files created after start are read from their beginning
+    void addPath(const std::string& path, bool from_start);
+    void watchDirectory(const std::string& directory, const std::string& name);
+    void follow(const std::string& path, bool from_start);
+    void handleEvents();
+    void readFile(TailedFile& file);
+    // Calls on_line for each complete line in [from, to); an unterminated
+    // last line is left in partial for the next call
+    void readLines(int fd, off_t from, off_t to, std::string& partial,
+                   const std::function<void(const std::string& line)>& on_line);
+    void matchLine(const TailedFile& file, const std::string& line);
+    void sendBacklog();
+    void flush();
+    void publishFollowed();
+    static int parseLevel(const std::string& line);
+};
+
+} // namespace BackendDatalink
+
+#endif // LOG_TAIL_H
@@ -4,41 +4,63 @@
 #include "websocket_server.h"
 #include "ThreadManager.hpp"
 #include <memory>
+#include <chrono>
 #include <string>
 #include <functional>
 
 class ManagedWebSocketServer {
 public:
-    typedef std::function<void(const std::string&, const nlohmann::json&)> MessageHandler;
-    typedef std::function<void(const std::string&)> ConnectionHandler;
+    typedef WebSocketServer::MessageHandler MessageHandler;
+    typedef WebSocketServer::ConnectionHandler ConnectionHandler;
 
     ManagedWebSocketServer();
     ~ManagedWebSocketServer();
 
     bool start(const ConfigLoader::WebSocketConfig& config);
     void stop();
+    // WebSocketServer::drain(), then stop()
+    void drain(std::chrono::seconds window);
     bool isRunning() const { return is_running_; }
 
     void setMessageHandler(MessageHandler handler) { message_handler_ = handler; }
     void setConnectionOpenHandler(ConnectionHandler handler) { connection_open_handler_ = handler; }
     void setConnectionCloseHandler(ConnectionHandler handler) { connection_close_handler_ = handler; }
+    // Name, CPUs and scheduling of the server thread, from the next start()
+    void setThreadAttributes(const thread_attr_t& attr) { thread_attr_ = attr; }
 
     void broadcast(const nlohmann::json& message);
-    void sendToClient(const std::string& connection_id, const nlohmann::json& message);
+    void broadcast(const std::string& payload);
+    void publish(const std::string& category, const nlohmann::json& message);
+    bool setSubscriptions(BackendDatalink::ConnectionId connection_id, const std::vector<std::string>& categories);
+    void sendToClient(BackendDatalink::ConnectionId connection_id, const nlohmann::json& message);
+    void sendToClient(BackendDatalink::ConnectionId connection_id, const std::shared_ptr<const SharedMessage>& message);
+    void sendBinaryToClient(BackendDatalink::ConnectionId connection_id, const std::string& payload,
+                            const std::string& key);
+    // Live settings go to the running server; the rest apply on restart()
+    void applyConfig(const ConfigLoader::WebSocketConfig& config);
     size_t getConnectionCount() const;
+    size_t getSubscriberCount(const std::string& category) const;
+    SendQueueStats getSendQueueStats() const;
+    size_t getQueuedBytes() const;
+    // See WebSocketServer::setAdmissionClosed(); kept across restart()
+    void setAdmissionClosed(bool closed);
 
-    // Thread management via ur-threadder-api
+    // The server runs on a thread of ur-threadder-api, as one of its io
+    // threads. pause() sheds load (see WebSocketServer::pause()) rather
+    // than suspending that thread; resume() sends the held updates.
     bool pause();
     bool resume();
     bool restart();
     ThreadMgr::ThreadState getState() const;
     unsigned int getThreadId() const { return thread_id_; }
+    ThreadMgr::ThreadStats getThreadStats() const { return thread_manager_->getThreadStats(thread_id_); }
 
 private:
     std::unique_ptr<WebSocketServer> websocket_server_;
     std::unique_ptr<ThreadMgr::ThreadManager> thread_manager_;
     ConfigLoader::WebSocketConfig config_;
     unsigned int thread_id_;
+    thread_attr_t thread_attr_{};
     bool is_running_;
 
     MessageHandler message_handler_;
@@ -0,0 +1,135 @@
+#ifndef MAVLINK_BRIDGE_H
+#define MAVLINK_BRIDGE_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "config_loader.h"
+#include "connection_id.h"
+#include "mavlink_frame.h"
+
+using json = nlohmann::json;
+
+namespace BackendDatalink {
+
+// Vehicle telemetry from MAVLink on UDP and, optionally, a serial link,
+// handed to WebSocket clients at the rate they ask for.
+//   - One thread polls the inputs. Frames are parsed in place in the
+//     receive buffer and copied once, into the ring of their stream (one
+//     message type from one system/component). The newest entry of a ring
+//     is the stream's latest value.
+//   - Each subscriber has a rate and an optional message id filter. On its
+//     tick, the latest frame of every stream that changed since its last
+//     tick goes out, raw and back to back, in one binary WebSocket frame:
+//     the payload is a valid MAVLink byte stream for any client parser.
+//     Intermediate frames are skipped, so a 200 Hz ATTITUDE reaches a
+//     10 Hz subscriber at 10 Hz. Nothing is converted to JSON.
+class MavlinkBridge {
+public:
+    typedef std::function<void(ConnectionId connection_id, const std::string& frames)> BinarySender;
+
+    MavlinkBridge(const ConfigLoader::MavlinkConfig& config, BinarySender sender);
+    ~MavlinkBridge();
+
+    MavlinkBridge(const MavlinkBridge&) = delete;
+    MavlinkBridge& operator=(const MavlinkBridge&) = delete;
+
+    // False if the UDP port cannot be bound. A serial device that cannot be
+    // opened is retried while running.
+    bool start();
+    void stop();
+
+    // Replaces the connection's subscription. rate_hz must be 1 to
+    // max_rate_hz; empty message_ids means every message type. The first
+    // tick sends the latest frame of every matching stream. Throws
+    // std::invalid_argument for a bad rate.
+    void subscribe(ConnectionId connection_id, int rate_hz, const std::vector<uint32_t>& message_ids);
+    // False if the connection had no subscription
+    bool unsubscribe(ConnectionId connection_id);
+
+    // Up to count of the most recent frames of message_id, oldest first per
+    // stream, back to back; frames is set to how many there are
+    std::vector<uint8_t> history(uint32_t message_id, size_t count, size_t& frames) const;
+
+    // Link counters, per-stream rates and subscribers
+    json getStatus() const;
+
+private:
+    struct StoredFrame {
+        std::chrono::steady_clock::time_point received;
+        uint16_t size = 0;
+        std::array<uint8_t, Mavlink::kMaxFrameSize> bytes;
+    };
+
+    struct Stream {
+        uint8_t system_id = 0;
+        uint8_t component_id = 0;
+        uint32_t message_id = 0;
+        uint64_t count = 0;             // Frames stored; the newest is ring[(count - 1) % ring.size()]
+        std::vector<StoredFrame> ring;
+    };
+
+    struct Subscriber {
+        std::chrono::nanoseconds interval{0};
+        std::chrono::steady_clock::time_point next_due;
+        std::unordered_set<uint32_t> message_ids;    // Empty: all
+        std::unordered_map<uint64_t, uint64_t> sent; // Stream key -> its count when last sent
+        uint64_t frames_sent = 0;
+        uint64_t frames_skipped = 0;    // Decimated away
+    };
+
+    // Garbage on the UDP port cannot grow the stream table without bound
+    static const size_t kMaxStreams = 256;
+    static constexpr std::chrono::seconds kSerialRetry{5};
+
+    ConfigLoader::MavlinkConfig config_;
+    BinarySender sender_;
+
+    int udp_fd_ = -1;
+    int serial_fd_ = -1;                // Loop thread only
+    int wake_fd_ = -1;                  // eventfd
+    std::chrono::steady_clock::time_point serial_retry_at_;
+
+    std::thread thread_;
+    // Loop thread only
+    std::vector<uint8_t> datagram_;
+    std::vector<uint8_t> serial_buffer_;
+    size_t serial_fill_ = 0;
+
+    mutable std::mutex mutex_;
+    bool running_ = false;
+    // Guarded by mutex_
+    std::unordered_map<uint64_t, Stream> streams_;
+    std::map<ConnectionId, Subscriber> subscribers_;
+    Mavlink::ScanCounters udp_counters_;
+    Mavlink::ScanCounters serial_counters_;
+    uint64_t frames_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t streams_dropped_ = 0;      // Frames of new streams past kMaxStreams
+    bool serial_connected_ = false;
+
+    static uint64_t streamKey(const Mavlink::FrameView& frame);
+
+    void run();
+    void wake();
+    void openSerial();
+    void closeSerial();
+    void receiveUdp();
+    void receiveSerial();
+    void storeLocked(const Mavlink::FrameView& frame, std::chrono::steady_clock::time_point now);
+    // Sends to the subscribers that are due; returns when the next one is
+    std::chrono::steady_clock::time_point publish(std::chrono::steady_clock::time_point now);
+};
+
+} // namespace BackendDatalink
+
+#endif // MAVLINK_BRIDGE_H
@@ -0,0 +1,219 @@
+#ifndef MAVLINK_FRAME_H
+#define MAVLINK_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BackendDatalink {
+namespace Mavlink {
+
+const uint8_t kMagicV1 = 0xFE;
+const uint8_t kMagicV2 = 0xFD;
+const size_t kHeaderSizeV1 = 6;
+const size_t kHeaderSizeV2 = 10;
+const size_t kChecksumSize = 2;
+const size_t kSignatureSize = 13;
+const uint8_t kIncompatSigned = 0x01;
+// A v2 frame with a full payload and a signature
+const size_t kMaxFrameSize = kHeaderSizeV2 + 255 + kChecksumSize + kSignatureSize;
+
+// One frame inside a receive buffer. Nothing is copied: the pointers stay
+// valid only as long as the buffer does.
+struct FrameView {
+    const uint8_t* data = nullptr;      // First byte is the magic
+    size_t size = 0;                    // Header, payload, checksum and signature
+    uint8_t version = 0;                // 1 or 2
+    uint8_t sequence = 0;
+    uint8_t system_id = 0;
+    uint8_t component_id = 0;
+    uint32_t message_id = 0;
+    const uint8_t* payload = nullptr;
+    uint8_t payload_length = 0;         // v2 payloads arrive with trailing zeros trimmed
+    bool verified = false;              // Checksum checked against a known CRC_EXTRA
+};
+
+struct ScanCounters {
+    uint64_t bad_frames = 0;            // Checksum mismatch, unsupported v2 flags, rejected unverified
+    uint64_t skipped_bytes = 0;         // Line noise between frames
+    uint64_t unverified = 0;            // Frames of a type without a known CRC_EXTRA
+};
+
+// X.25 / MCRF4XX checksum step used by MAVLink
+inline uint16_t crcAccumulate(uint8_t byte, uint16_t crc) {
+    uint8_t tmp = byte ^ static_cast<uint8_t>(crc & 0xFF);
+    tmp ^= static_cast<uint8_t>(tmp << 4);
+    return static_cast<uint16_t>((crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4));
+}
+
+// CRC_EXTRA seeds of the common.xml messages an autopilot streams; a frame
+// of any other type cannot be verified. Sorted by message id.
+struct CrcExtra {
+    uint32_t message_id;
+    uint8_t extra;
+};
+
+constexpr CrcExtra kCrcExtras[] = {
+    {0, 50},    // HEARTBEAT
+    {1, 124},   // SYS_STATUS
+    {2, 137},   // SYSTEM_TIME
+    {4, 237},   // PING
+    {22, 220},  // PARAM_VALUE
+    {24, 24},   // GPS_RAW_INT
+    {25, 23},   // GPS_STATUS
+    {26, 170},  // SCALED_IMU
+    {27, 144},  // RAW_IMU
+    {28, 67},   // RAW_PRESSURE
+    {29, 115},  // SCALED_PRESSURE
+    {30, 39},   // ATTITUDE
+    {31, 246},  // ATTITUDE_QUATERNION
+    {32, 185},  // LOCAL_POSITION_NED
+    {33, 104},  // GLOBAL_POSITION_INT
+    {34, 237},  // RC_CHANNELS_SCALED
+    {35, 244},  // RC_CHANNELS_RAW
+    {36, 222},  // SERVO_OUTPUT_RAW
+    {42, 28},   // MISSION_CURRENT
+    {62, 183},  // NAV_CONTROLLER_OUTPUT
+    {65, 118},  // RC_CHANNELS
+    {74, 20},   // VFR_HUD
+    {77, 143},  // COMMAND_ACK
+    {83, 22},   // ATTITUDE_TARGET
+    {85, 140},  // POSITION_TARGET_LOCAL_NED
+    {87, 150},  // POSITION_TARGET_GLOBAL_INT
+    {109, 185}, // RADIO_STATUS
+    {111, 34},  // TIMESYNC
+    {116, 76},  // SCALED_IMU2
+    {125, 203}, // POWER_STATUS
+    {132, 85},  // DISTANCE_SENSOR
+    {141, 47},  // ALTITUDE
+    {147, 154}, // BATTERY_STATUS
+    {148, 178}, // AUTOPILOT_VERSION
+    {230, 163}, // ESTIMATOR_STATUS
+    {241, 90},  // VIBRATION
+    {242, 104}, // HOME_POSITION
+    {245, 130}, // EXTENDED_SYS_STATE
+    {253, 83}   // STATUSTEXT
+};
+
+inline bool findCrcExtra(uint32_t message_id, uint8_t& extra) {
+    size_t low = 0;
+    size_t high = sizeof(kCrcExtras) / sizeof(kCrcExtras[0]);
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (kCrcExtras[mid].message_id < message_id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < sizeof(kCrcExtras) / sizeof(kCrcExtras[0]) && kCrcExtras[low].message_id == message_id) {
+        extra = kCrcExtras[low].extra;
+        return true;
+    }
+    return false;
+}
+
+enum class ParseStatus {
+    Complete,
+    Incomplete,     // A frame starts here but its end has not arrived
+    Invalid
+};
+
+// Parses the frame starting at data[0], which must be a magic byte
+inline ParseStatus parseFrame(const uint8_t* data, size_t size, FrameView& frame) {
+    const bool v2 = data[0] == kMagicV2;
+    const size_t header_size = v2 ? kHeaderSizeV2 : kHeaderSizeV1;
+    if (size < header_size) {
+        return ParseStatus::Incomplete;
+    }
+
+    const uint8_t payload_length = data[1];
+    size_t frame_size = header_size + payload_length + kChecksumSize;
+    if (v2) {
+        const uint8_t incompat = data[2];
+        if (incompat & ~kIncompatSigned) {
+            return ParseStatus::Invalid;
+        }
+        if (incompat & kIncompatSigned) {
+            frame_size += kSignatureSize;
+        }
+    }
+    if (size < frame_size) {
+        return ParseStatus::Incomplete;
+    }
+
+    frame.data = data;
+    frame.size = frame_size;
+    frame.version = v2 ? 2 : 1;
+    frame.payload = data + header_size;
+    frame.payload_length = payload_length;
+    if (v2) {
+        frame.sequence = data[4];
+        frame.system_id = data[5];
+        frame.component_id = data[6];
+        frame.message_id = static_cast<uint32_t>(data[7]) |
+                           (static_cast<uint32_t>(data[8]) << 8) |
+                           (static_cast<uint32_t>(data[9]) << 16);
+    } else {
+        frame.sequence = data[2];
+        frame.system_id = data[3];
+        frame.component_id = data[4];
+        frame.message_id = data[5];
+    }
+
+    uint8_t extra = 0;
+    frame.verified = findCrcExtra(frame.message_id, extra);
+    if (frame.verified) {
+        uint16_t crc = 0xFFFF;
+        const size_t checked = header_size + payload_length;
+        for (size_t i = 1; i < checked; ++i) {
+            crc = crcAccumulate(data[i], crc);
+        }
+        crc = crcAccumulate(extra, crc);
+        const uint16_t received = static_cast<uint16_t>(data[checked] | (data[checked + 1] << 8));
+        if (crc != received) {
+            return ParseStatus::Invalid;
+        }
+    }
+    return ParseStatus::Complete;
+}
+
+// Finds the next frame in data[0, size). Returns how many bytes the caller
+// is done with: up to the end of the frame when one was found
+// (frame.data set), otherwise the noise before a partial frame that needs
+// more bytes. A false magic byte costs one byte of resync. Without
+// accept_unverified, frames that cannot be checked are treated as noise:
+// on a byte stream a false magic byte followed by an unknown message id
+// would otherwise swallow the real frames behind it.
+inline size_t nextFrame(const uint8_t* data, size_t size, FrameView& frame, ScanCounters& counters,
+                        bool accept_unverified) {
+    size_t offset = 0;
+    frame.data = nullptr;
+    while (offset < size) {
+        if (data[offset] != kMagicV1 && data[offset] != kMagicV2) {
+            ++offset;
+            ++counters.skipped_bytes;
+            continue;
+        }
+        ParseStatus status = parseFrame(data + offset, size - offset, frame);
+        if (status == ParseStatus::Complete && (frame.verified || accept_unverified)) {
+            if (!frame.verified) {
+                ++counters.unverified;
+            }
+            return offset + frame.size;
+        }
+        if (status == ParseStatus::Incomplete) {
+            frame.data = nullptr;
+            return offset;
+        }
+        frame.data = nullptr;
+        ++counters.bad_frames;
+        ++counters.skipped_bytes;
+        ++offset;
+    }
+    return offset;
+}
+
+} // namespace Mavlink
+} // namespace BackendDatalink
+
+#endif // MAVLINK_FRAME_H
@@ -0,0 +1,76 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace BackendDatalink {
+
+// Keeps the process under a memory budget before the OOM killer has to.
+//   - Usage is the resident set (/proc/self/statm), broken down by the
+//     subsystems whose memory grows with use: each source reports the
+//     bytes it holds from its own counters (queued sends, rings, caches).
+//   - Over the soft limit the process degrades (Soft): the owner sheds
+//     what can be rebuilt, such as history and broadcast rate. Over the
+//     hard limit (Hard) it also stops taking new clients.
+//   - A level is left once the resident set is back under 90% of its
+//     limit, so usage hovering at a limit does not flip the modes.
+// evaluate() reads one procfs file and is meant for a periodic timer.
+class MemoryBudget {
+public:
+    enum class Level { Normal = 0, Soft = 1, Hard = 2 };
+
+    // Bytes a subsystem holds right now
+    typedef std::function<size_t()> Source;
+    // Applies the degrade mode of a new level
+    typedef std::function<void(Level level)> Degrade;
+
+    struct Settings {
+        size_t softLimitBytes = 0;      // 0 disables the limit
+        size_t hardLimitBytes = 0;
+    };
+
+    explicit MemoryBudget(Degrade degrade);
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    // Before the first evaluate()
+    void addSource(const std::string& name, Source source);
+    // Live; takes effect on the next evaluate()
+    void setSettings(const Settings& settings);
+
+    void evaluate();
+
+    Level level() const;
+    // As of the last evaluate()
+    size_t residentBytes() const;
+    std::vector<std::string> sourceNames() const;
+    size_t sourceBytes(const std::string& name) const;
+
+    static const char* toString(Level level);
+
+private:
+    struct Entry {
+        std::string name;
+        Source source;
+        size_t bytes = 0;
+    };
+
+    Degrade degrade_;
+    mutable std::mutex mutex_;
+    Settings settings_;
+    std::vector<Entry> sources_;
+    size_t resident_bytes_ = 0;
+    Level level_ = Level::Normal;
+
+    // Caller holds mutex_
+    Level classify(size_t resident) const;
+};
+
+} // namespace BackendDatalink
+
+#endif // MEMORY_BUDGET_H
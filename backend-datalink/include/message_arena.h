@@ -0,0 +1,107 @@
+#ifndef MESSAGE_ARENA_H
+#define MESSAGE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace BackendDatalink {
+
+// Monotonic bump allocator for the short-lived json trees of one inbound
+// WebSocket message. Every io thread owns one; a Scope around the handling
+// of a message makes it the thread's active arena and rewinds it afterwards,
+// so parsing and dispatching a request costs no malloc/free pairs once the
+// first block is warm. Deallocation is a no-op; memory comes back on reset().
+class MessageArena {
+public:
+    explicit MessageArena(size_t block_size = 16 * 1024);
+    ~MessageArena();
+
+    MessageArena(const MessageArena&) = delete;
+    MessageArena& operator=(const MessageArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment);
+    bool owns(const void* pointer) const;
+
+    // Rewinds to an empty first block; blocks added for a large message are
+    // released so one big request does not pin memory forever
+    void reset();
+
+    // The calling thread's arena while a Scope is open, otherwise nullptr
+    static MessageArena* current();
+
+    // Activates the calling thread's arena for its lifetime. Nothing
+    // allocated from it may outlive the scope: copy into a plain json first.
+    // Nested scopes share the outer one.
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        bool outermost_;
+    };
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    const size_t block_size_;
+    std::vector<Block> blocks_;
+    size_t used_ = 0;  // Bytes taken from blocks_.back()
+
+    void addBlock(size_t min_size);
+};
+
+// Stateless allocator for basic_json: draws from the thread's active arena
+// and falls back to the heap outside a Scope. Pointers are told apart on
+// deallocation, so a tree built before a scope can be read or shrunk inside
+// it, but must not grow there.
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator() noexcept = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t count) {
+        MessageArena* arena = MessageArena::current();
+        if (arena) {
+            return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+        }
+        return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept {
+        MessageArena* arena = MessageArena::current();
+        if (arena && arena->owns(pointer)) {
+            return;
+        }
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+};
+
+// Inbound message as handed to WebSocket message handlers. Converts to and
+// from json by copy (json copy(message)); anything kept past the handler
+// must be such a copy.
+typedef nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double,
+                             ArenaAllocator> message_json;
+
+} // namespace BackendDatalink
+
+#endif // MESSAGE_ARENA_H
@@ -0,0 +1,38 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <string>
+#include <atomic>
+#include <thread>
+
+namespace BackendDatalink {
+
+// Scrape endpoint for the process-wide UrMetrics registry. A single thread
+// accepts connections one at a time and answers GET requests with the
+// Prometheus text rendering (or, for /trace, the UrTrace spans as Chrome
+// trace-event JSON), then closes the connection; scrapes are rare enough
+// that nothing more is needed.
+class MetricsExporter {
+public:
+    MetricsExporter() = default;
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    bool start(const std::string& host, int port);
+    void stop();
+
+private:
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;  // eventfd, readable once stopping
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    void run();
+    void serve(int client_fd);
+};
+
+} // namespace BackendDatalink
+
+#endif // METRICS_EXPORTER_H
@@ -0,0 +1,140 @@
+#ifndef METRICS_HISTORY_H
+#define METRICS_HISTORY_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "config_loader.h"
+
+using json = nlohmann::json;
+
+class DatabaseManager;
+
+// One point of the numeric dashboard metrics that are worth graphing
+struct MetricsSample {
+    int64_t timestamp = 0; // Unix seconds (bucket start for rollups)
+    double cpu_percent = 0.0;
+    double cpu_temperature_c = 0.0;
+    double ram_percent = 0.0;
+    double swap_percent = 0.0;
+    double latency_ms = 0.0;
+    double rssi_dbm = 0.0;
+    double sinr_db = 0.0;
+};
+
+// Aggregates of one field over a window, overall and per time bucket
+struct HistorySeries {
+    std::string field;
+    double min = 0.0;
+    double max = 0.0;
+    double avg = 0.0;
+    double p95 = 0.0;                  // Nearest rank
+    std::vector<double> bucket_min;    // Zero for empty buckets
+    std::vector<double> bucket_avg;
+    std::vector<double> bucket_max;
+};
+
+// Answer of MetricsHistory::aggregate()
+struct HistoryAggregate {
+    int64_t from = 0;
+    int64_t to = 0;
+    int64_t covered_from = 0;          // Oldest sample in memory; the window is clipped to it
+    size_t count = 0;                  // Samples in the window
+    int64_t bucket_seconds = 0;
+    std::vector<int64_t> bucket_start;
+    std::vector<uint32_t> bucket_count;
+    std::vector<HistorySeries> series;
+};
+
+// Time-series history for the dashboard metrics.
+//   - Raw samples go into a fixed-size in-memory ring, which answers recent
+//     raw queries and window aggregates without touching flash. The ring is
+//     columnar (one array per field) so aggregates run over contiguous
+//     values.
+//   - Every sample also feeds 1-minute and 1-hour averages; closed buckets
+//     are queued as rollup rows.
+//   - flushIfDue() writes new raw and rollup rows to metrics_history in one
+//     transaction and prunes each resolution to its retention window.
+class MetricsHistory {
+public:
+    enum Resolution { Raw = 0, Minute = 60, Hour = 3600 };
+
+    MetricsHistory(DatabaseManager* database, const ConfigLoader::MetricsHistoryConfig& config);
+    ~MetricsHistory() = default;
+
+    // Creates the metrics_history table if it does not exist
+    bool initialize();
+
+    // Takes the output of SystemDataCollector::getMetricsAsJson()
+    void record(const json& metrics);
+    void record(const MetricsSample& sample);
+
+    bool flushIfDue();
+    bool flush();
+
+    // Re-allocates the raw ring for capacity samples (0: the configured
+    // ring_capacity), keeping the newest that fit. Shrinking under memory
+    // pressure drops samples not flushed yet along with the oldest ones.
+    void resizeRing(size_t capacity);
+    // Heap held by the ring, the percentile scratch and queued rollups
+    size_t memoryBytes() const;
+
+    // Samples with from <= timestamp <= to, oldest first, at most limit
+    // (the most recent ones are kept when the range holds more)
+    std::vector<MetricsSample> query(int resolution, int64_t from, int64_t to, size_t limit) const;
+
+    // Min/max/avg/p95 of each field (all when fields is empty) over the
+    // raw samples with from <= timestamp <= to, and the same split into
+    // buckets equal-width buckets for charts. False for an unknown field.
+    bool aggregate(int64_t from, int64_t to, size_t buckets, const std::vector<std::string>& fields,
+                   HistoryAggregate& result) const;
+
+    // Columnar JSON: {"timestamp": [...], "cpu_percent": [...], ...}
+    static json toJson(const std::vector<MetricsSample>& samples);
+    static json toJson(const HistoryAggregate& aggregate);
+
+    // Accepts "raw", "1m", "1h" or the bucket width in seconds
+    static bool parseResolution(const json& value, int& resolution);
+    static std::string resolutionName(int resolution);
+
+private:
+    struct Bucket {
+        int64_t start = -1;
+        size_t count = 0;
+        MetricsSample sum;
+    };
+
+    static const size_t kFieldCount = 7;
+
+    DatabaseManager* database_;
+    ConfigLoader::MetricsHistoryConfig config_;
+    mutable std::mutex mutex_;
+
+    // Ring of raw samples, one column per field
+    size_t ring_capacity_;
+    std::vector<int64_t> ring_timestamps_;
+    std::vector<double> ring_columns_[kFieldCount];
+    size_t ring_head_ = 0; // Next slot to write
+    size_t ring_size_ = 0;
+    mutable std::vector<double> scratch_; // Percentile selection, under mutex_
+    int64_t persisted_until_ = 0; // Newest raw timestamp written to the database
+
+    Bucket minute_bucket_;
+    Bucket hour_bucket_;
+    std::vector<std::pair<int, MetricsSample>> pending_rollups_;
+
+    std::chrono::steady_clock::time_point last_flush_;
+
+    void accumulate(Bucket& bucket, int width, const MetricsSample& sample);
+    size_t ringSlot(size_t index) const; // 0 = oldest
+    MetricsSample ringAt(size_t index) const;
+    size_t firstAtOrAfter(int64_t timestamp) const;
+    template <typename Function>
+    void forEachSpan(size_t begin, size_t end, Function function) const;
+    void log(const std::string& message) const;
+};
+
+#endif // METRICS_HISTORY_H
@@ -0,0 +1,198 @@
+#ifndef NETLINK_MESSAGE_H
+#define NETLINK_MESSAGE_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace BackendDatalink {
+namespace Netlink {
+
+// Large enough for one message of any dump the backend reads: a BSS with
+// all of its information elements, a WireGuard device with its peers
+const size_t kReceiveBufferSize = 64 * 1024;
+
+// A generic netlink request with room for a few attributes
+struct Request {
+    nlmsghdr header;
+    genlmsghdr genl;
+    char attributes[256];
+};
+
+inline void initRequest(Request& request, uint16_t family, uint8_t command, uint16_t flags, uint32_t sequence) {
+    std::memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+    request.header.nlmsg_type = family;
+    request.header.nlmsg_flags = NLM_F_REQUEST | flags;
+    request.header.nlmsg_seq = sequence;
+    request.genl.cmd = command;
+    request.genl.version = 1;
+}
+
+// Appends an attribute to any request that starts with an nlmsghdr named
+// header; the caller makes sure it fits
+template <typename Message>
+void addAttribute(Message& request, uint16_t type, const void* data, size_t length) {
+    nlattr* attribute = reinterpret_cast<nlattr*>(reinterpret_cast<char*>(&request) +
+                                                  NLMSG_ALIGN(request.header.nlmsg_len));
+    attribute->nla_type = type;
+    attribute->nla_len = static_cast<uint16_t>(NLA_HDRLEN + length);
+    std::memcpy(reinterpret_cast<char*>(attribute) + NLA_HDRLEN, data, length);
+    request.header.nlmsg_len = NLMSG_ALIGN(request.header.nlmsg_len) + NLA_ALIGN(attribute->nla_len);
+}
+
+template <typename Message>
+void addU32(Message& request, uint16_t type, uint32_t value) {
+    addAttribute(request, type, &value, sizeof(value));
+}
+
+// Calls visit(type, data, length) for each attribute in [data, data + length)
+template <typename Visit>
+void forEachAttribute(const void* data, size_t length, Visit visit) {
+    const char* cursor = static_cast<const char*>(data);
+    while (length >= NLA_HDRLEN) {
+        const nlattr* attribute = reinterpret_cast<const nlattr*>(cursor);
+        if (attribute->nla_len < NLA_HDRLEN || attribute->nla_len > length) {
+            return;
+        }
+        visit(attribute->nla_type & NLA_TYPE_MASK, cursor + NLA_HDRLEN,
+              static_cast<size_t>(attribute->nla_len - NLA_HDRLEN));
+        size_t step = NLA_ALIGN(attribute->nla_len);
+        if (step >= length) {
+            return;
+        }
+        cursor += step;
+        length -= step;
+    }
+}
+
+// The attributes after the fixed header of a message: genlmsghdr for
+// generic netlink, ifinfomsg for RTM_*LINK and so on
+template <typename Visit>
+void forEachMessageAttribute(const nlmsghdr* header, size_t fixed_size, Visit visit) {
+    if (header->nlmsg_len < NLMSG_LENGTH(fixed_size)) {
+        return;
+    }
+    forEachAttribute(static_cast<const char*>(NLMSG_DATA(header)) + NLMSG_ALIGN(fixed_size),
+                     header->nlmsg_len - NLMSG_SPACE(fixed_size), visit);
+}
+
+template <typename Visit>
+void forEachMessageAttribute(const nlmsghdr* header, Visit visit) {
+    forEachMessageAttribute(header, GENL_HDRLEN, visit);
+}
+
+inline uint32_t readU32(const char* data, size_t length) {
+    uint32_t value = 0;
+    std::memcpy(&value, data, std::min(length, sizeof(value)));
+    return value;
+}
+
+inline uint64_t readU64(const char* data, size_t length) {
+    uint64_t value = 0;
+    std::memcpy(&value, data, std::min(length, sizeof(value)));
+    return value;
+}
+
+// groups is a bitmask of legacy multicast groups (RTMGRP_*); generic
+// netlink groups are joined with NETLINK_ADD_MEMBERSHIP instead
+inline int openSocket(int protocol = NETLINK_GENERIC, uint32_t groups = 0) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_nl address{};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = groups;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Sends the request and passes each reply message to handle until the
+// acknowledgement or the end of the dump. Returns 0 or a negative errno.
+// The socket needs SO_RCVTIMEO for a silent kernel not to block forever.
+template <typename Message, typename Handle>
+int transact(int fd, Message& request, Handle handle) {
+    if (send(fd, &request, request.header.nlmsg_len, 0) < 0) {
+        return -errno;
+    }
+
+    std::vector<char> buffer(kReceiveBufferSize);
+    for (;;) {
+        ssize_t length = recv(fd, buffer.data(), buffer.size(), 0);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? -ETIMEDOUT : -errno;
+        }
+
+        int remaining = static_cast<int>(length);
+        for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(buffer.data());
+             NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_seq != request.header.nlmsg_seq) {
+                continue;
+            }
+            if (header->nlmsg_type == NLMSG_DONE) {
+                return 0;
+            }
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                return static_cast<const nlmsgerr*>(NLMSG_DATA(header))->error;
+            }
+            handle(header);
+        }
+    }
+}
+
+// Looks up a generic netlink family id and, when groups is given, its
+// multicast groups by name. Returns 0 or a negative errno; -ENOENT when
+// the family is not registered (module not loaded).
+inline int resolveFamily(int fd, const char* name, uint32_t sequence, uint16_t& family,
+                         std::map<std::string, uint32_t>* groups = nullptr) {
+    Request request;
+    initRequest(request, GENL_ID_CTRL, CTRL_CMD_GETFAMILY, NLM_F_ACK, sequence);
+    addAttribute(request, CTRL_ATTR_FAMILY_NAME, name, std::strlen(name) + 1);
+
+    family = 0;
+    int result = transact(fd, request, [&](const nlmsghdr* header) {
+        forEachMessageAttribute(header, [&](uint16_t type, const char* data, size_t length) {
+            if (type == CTRL_ATTR_FAMILY_ID && length >= sizeof(uint16_t)) {
+                std::memcpy(&family, data, sizeof(uint16_t));
+            } else if (type == CTRL_ATTR_MCAST_GROUPS && groups) {
+                forEachAttribute(data, length, [&](uint16_t, const char* group, size_t group_length) {
+                    std::string group_name;
+                    uint32_t id = 0;
+                    forEachAttribute(group, group_length, [&](uint16_t field, const char* value, size_t value_length) {
+                        if (field == CTRL_ATTR_MCAST_GRP_NAME) {
+                            group_name.assign(value, strnlen(value, value_length));
+                        } else if (field == CTRL_ATTR_MCAST_GRP_ID) {
+                            id = readU32(value, value_length);
+                        }
+                    });
+                    (*groups)[group_name] = id;
+                });
+            }
+        });
+    });
+    if (result == 0 && family == 0) {
+        return -ENOENT;
+    }
+    return result;
+}
+
+} // namespace Netlink
+} // namespace BackendDatalink
+
+#endif // NETLINK_MESSAGE_H
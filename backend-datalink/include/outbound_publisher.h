@@ -0,0 +1,79 @@
+#ifndef OUTBOUND_PUBLISHER_H
+#define OUTBOUND_PUBLISHER_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "bounded_mpsc_queue.h"
+
+namespace BackendDatalink {
+
+// Single thread that makes every MQTT publish on behalf of the RPC side.
+// Any thread may publish(); messages wait in bounded lock-free lanes and the
+// publisher drains them in batches, QoS 1/2 ahead of QoS 0, so workers that
+// finish at the same moment never queue on the MQTT client lock. Publishes
+// respect the client's publish_window: while the broker is behind, the
+// publisher holds the next message and the lanes fill up instead of the MQTT
+// client's queue.
+class OutboundPublisher {
+public:
+    // QoS 1/2 and the configured default go to the reliable lane
+    enum Lane { kReliableLane = 0, kBestEffortLane, kLaneCount };
+
+    // laneCapacity is per lane, rounded up to a power of two
+    explicit OutboundPublisher(size_t laneCapacity);
+    ~OutboundPublisher();
+
+    OutboundPublisher(const OutboundPublisher&) = delete;
+    OutboundPublisher& operator=(const OutboundPublisher&) = delete;
+
+    void start();
+    // Publishes whatever is still queued, then joins the thread
+    void stop();
+
+    // qos < 0 uses the MQTT client's configured QoS. Returns false, and
+    // counts the drop, when the lane is full.
+    bool publish(std::string topic, std::string payload, int qos = -1);
+
+    size_t getPendingCount() const { return pending_.load(std::memory_order_relaxed); }
+    uint64_t getDroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t getFailedCount() const { return failed_.load(std::memory_order_relaxed); }
+
+private:
+    struct Message {
+        std::string topic;
+        std::string payload;
+        int qos = -1;
+    };
+
+    std::unique_ptr<BoundedMpscQueue<Message>> lanes_[kLaneCount];
+
+    // Popped but refused by a full publish window; retried before the lanes.
+    // Only the publisher thread touches it, and stop() after the join.
+    Message held_;
+    bool hasHeld_ = false;
+
+    // pending_ is raised before a push and lowered once the message is
+    // handed to the MQTT client, so the publisher that sees zero can safely
+    // sleep on wakeCv_
+    std::atomic<size_t> pending_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<bool> running_{false};
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+    std::thread thread_;
+
+    void run();
+    size_t drainBatch();
+    // False when the publish window stayed full and message is to be held
+    bool send(const Message& message);
+};
+
+} // namespace BackendDatalink
+
+#endif // OUTBOUND_PUBLISHER_H
@@ -0,0 +1,64 @@
+#ifndef PIPELINE_STAGE_H
+#define PIPELINE_STAGE_H
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+namespace BackendDatalink {
+
+// One consumer of the collector's snapshots, run on its own thread. Producers
+// call notify() when a new snapshot is published; the stage runs its action
+// at most once per min interval, and notifications that arrive while it waits
+// or runs coalesce into a single run that reads the latest snapshot. A slow
+// stage therefore never delays the collector or the other stages.
+class PipelineStage {
+public:
+    typedef std::function<void()> Action;
+
+    PipelineStage(std::string name, Action action);
+    ~PipelineStage();
+
+    PipelineStage(const PipelineStage&) = delete;
+    PipelineStage& operator=(const PipelineStage&) = delete;
+
+    void start(std::chrono::milliseconds min_interval);
+    // Waits for a run in progress, drops a pending one
+    void stop();
+
+    // Cheap and non-blocking enough for the collector's publish path
+    void notify();
+
+    // Takes effect from the next run
+    void setMinInterval(std::chrono::milliseconds min_interval);
+
+    const std::string& getName() const { return name_; }
+    uint64_t getRunCount() const { return runs_.load(std::memory_order_relaxed); }
+    // Notifications folded into a later run instead of getting their own
+    uint64_t getCoalescedCount() const;
+
+private:
+    const std::string name_;
+    const Action action_;
+
+    std::atomic<int64_t> min_interval_ms_{0};
+    std::atomic<uint64_t> notified_{0};
+    std::atomic<uint64_t> runs_{0};
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool pending_ = false;   // Guarded by mutex_
+    bool running_ = false;   // Guarded by mutex_
+    std::thread thread_;
+
+    void run();
+};
+
+} // namespace BackendDatalink
+
+#endif // PIPELINE_STAGE_H
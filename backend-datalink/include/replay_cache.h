@@ -0,0 +1,105 @@
+#ifndef REPLAY_CACHE_H
+#define REPLAY_CACHE_H
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace BackendDatalink {
+
+// Requests seen recently, by key, and the response each got, so a request
+// delivered twice (QoS 1 redelivery after a reconnect) is answered from
+// here instead of running again.
+//   - begin() marks a key in flight; a second delivery while it runs is
+//     told so, and is dropped, as the first one will answer.
+//   - complete() stores the response, which is replayed for ttl.
+//   - abandon() forgets a key whose request did not run (queue full, say),
+//     so a redelivery gets its chance.
+// At most capacity keys are kept; the least recently used goes first.
+class ReplayCache {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum class Seen { New, InFlight, Answered };
+
+    ReplayCache(size_t capacity, std::chrono::milliseconds ttl)
+        : capacity_(capacity == 0 ? 1 : capacity), ttl_(ttl) {}
+
+    ReplayCache(const ReplayCache&) = delete;
+    ReplayCache& operator=(const ReplayCache&) = delete;
+
+    // response gets the stored response when the result is Answered
+    Seen begin(const std::string& key, std::string& response, Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = index_.find(key);
+        if (found != index_.end()) {
+            Entry& entry = *found->second;
+            if (!entry.answered) {
+                return Seen::InFlight;
+            }
+            if (now < entry.expiresAt) {
+                entries_.splice(entries_.begin(), entries_, found->second);
+                response = entry.response;
+                return Seen::Answered;
+            }
+            entries_.erase(found->second);
+            index_.erase(found);
+        }
+
+        entries_.push_front(Entry{key, false, std::string(), Clock::time_point()});
+        index_[key] = entries_.begin();
+        while (entries_.size() > capacity_) {
+            index_.erase(entries_.back().key);
+            entries_.pop_back();
+        }
+        return Seen::New;
+    }
+
+    void complete(const std::string& key, std::string response, Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = index_.find(key);
+        if (found == index_.end()) {
+            return;     // Evicted while it ran
+        }
+        Entry& entry = *found->second;
+        entry.answered = true;
+        entry.response = std::move(response);
+        entry.expiresAt = now + ttl_;
+    }
+
+    void abandon(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = index_.find(key);
+        if (found != index_.end() && !found->second->answered) {
+            entries_.erase(found->second);
+            index_.erase(found);
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+private:
+    struct Entry {
+        std::string key;
+        bool answered;
+        std::string response;       // As published, JSON or CBOR
+        Clock::time_point expiresAt;
+    };
+
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;      // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    size_t capacity_;
+    std::chrono::milliseconds ttl_;
+};
+
+} // namespace BackendDatalink
+
+#endif // REPLAY_CACHE_H
@@ -0,0 +1,88 @@
+#ifndef REQUEST_ROUTER_H
+#define REQUEST_ROUTER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "rpc_method_registry.h"
+#include "single_flight.h"
+
+namespace BackendDatalink {
+
+enum class Transport {
+    WebSocket,
+    Mqtt
+};
+
+constexpr size_t kTransportCount = 2;
+
+const char* transportName(Transport transport);
+
+// The request core both front doors feed: the WebSocket handlers and the
+// MQTT RpcOperationProcessor call methods through it instead of through the
+// registry, so coalescing and the request counts apply to both. Each
+// transport keeps its own parsing, queueing and encoder (WebSocket "type"
+// replies, JSON-RPC responses in JSON or CBOR); a failed call reaches it as
+// the exception and describe() gives the code and text it reports.
+class RequestRouter {
+public:
+    static constexpr int kMethodNotFoundCode = -32601;
+    static constexpr int kHandlerErrorCode = -1;
+
+    struct Failure {
+        int code;
+        std::string message;
+    };
+
+    explicit RequestRouter(const RpcMethodRegistry& methods);
+
+    RequestRouter(const RequestRouter&) = delete;
+    RequestRouter& operator=(const RequestRouter&) = delete;
+
+    // Calls of method with the same params share one run of its handler
+    // while version() returns the same value, whichever transport they come
+    // in on; a dashboard poll from the cloud and a reconnecting browser read
+    // the database once between them. Set up before the first invoke().
+    void coalesce(const std::string& method, std::function<uint64_t()> version);
+
+    // Runs the method and returns its result. Throws UnknownMethodError, or
+    // whatever the handler threw.
+    json invoke(Transport transport, std::string_view method, const json& params) const;
+
+    static Failure describe(std::string_view method, const std::exception& e);
+
+    // Per transport: calls routed, calls that failed, and calls answered by
+    // another caller's run of a coalesced method
+    uint64_t getCallCount(Transport transport) const;
+    uint64_t getErrorCount(Transport transport) const;
+    uint64_t getCoalescedCount(Transport transport) const;
+
+private:
+    struct Coalesced {
+        std::function<uint64_t()> version;
+        std::unique_ptr<SingleFlight<json>> results;
+    };
+
+    struct TransportStats {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> errors{0};
+        std::atomic<uint64_t> coalesced{0};
+    };
+
+    const RpcMethodRegistry& methods_;
+    std::map<std::string, Coalesced, std::less<>> coalesced_;
+    mutable std::array<TransportStats, kTransportCount> stats_;
+
+    void record(Transport transport, bool failed, bool shared) const;
+};
+
+} // namespace BackendDatalink
+
+#endif // REQUEST_ROUTER_H
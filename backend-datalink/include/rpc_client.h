@@ -2,17 +2,26 @@
 #define RPC_CLIENT_H
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <functional>
 #include <atomic>
 #include <thread>
 #include <mutex>
-#include <set>
-#include <future>
+#include <condition_variable>
+#include <vector>
+#include <array>
+#include <chrono>
 #include <nlohmann/json.hpp>
+#include "deadline_scheduler.h"
+#include "replay_cache.h"
+#include "chunked_responses.h"
+#include "outbound_publisher.h"
+#include "request_router.h"
 #include "ur-rpc-template.h"
 #include "direct_template.h"
 #include "ThreadManager.hpp"
+#include "TaskExecutor.hpp"
 
 namespace BackendDatalink {
 
@@ -29,8 +38,9 @@ public:
      * @brief Constructor
      * @param configPath Path to RPC configuration JSON file
      * @param clientId Unique client identifier for MQTT connection
+     * @param outboundCapacity Messages each outbound QoS lane may hold
      */
-    RpcClient(const std::string& configPath, const std::string& clientId);
+    RpcClient(const std::string& configPath, const std::string& clientId, size_t outboundCapacity = 256);
     
     /**
      * @brief Destructor - ensures proper cleanup
@@ -60,11 +70,31 @@ public:
      */
     bool isConnected() const;
     
+    /**
+     * @brief Handler for incoming messages
+     *
+     * Topic and payload are views into the received MQTT message and are
+     * only valid during the call; copy whatever must outlive it.
+     */
+    typedef std::function<void(std::string_view topic, std::string_view payload)> MessageHandler;
+
     /**
      * @brief Set message handler for incoming RPC messages
      * @param handler Function to handle incoming messages
      */
-    void setMessageHandler(std::function<void(const std::string&, const std::string&)> handler);
+    void setMessageHandler(MessageHandler handler);
+    
+    /**
+     * @brief Handler for timed heartbeat echoes, on the MQTT loop thread
+     */
+    typedef std::function<void(double rtt_ms)> HeartbeatRttHandler;
+    
+    /**
+     * @brief Receive the round trip of every echoed heartbeat ("echo" in
+     * the heartbeat configuration); set before start()
+     * @param handler Function to handle round trips; must not block
+     */
+    void setHeartbeatRttHandler(HeartbeatRttHandler handler) { heartbeatRttHandler_ = std::move(handler); }
     
     /**
      * @brief Send response to RPC request
@@ -73,6 +103,24 @@ public:
      */
     void sendResponse(const std::string& topic, const std::string& response);
     
+    /**
+     * @brief Queue a message for the outbound publisher thread
+     * @param topic MQTT topic
+     * @param payload Message payload
+     * @param qos MQTT QoS, or -1 for the configured one
+     * @return false if the client is not running or the lane is full
+     */
+    bool queueMessage(std::string topic, std::string payload, int qos = -1);
+    
+    /**
+     * @brief Send an RPC notification on the notification topic of service
+     * @param method Notification method
+     * @param service Service the topic is generated for
+     * @param params Notification parameters
+     * @return false if the client is not connected or the publish failed
+     */
+    bool sendNotification(const std::string& method, const std::string& service, const nlohmann::json& params);
+    
     /**
      * @brief Send raw message to MQTT topic
      * @param topic MQTT topic
@@ -88,6 +136,16 @@ public:
      */
     direct_client_statistics_t getStatistics() const;
     
+    /**
+     * @brief Messages waiting for the outbound publisher thread
+     */
+    size_t getOutboundPendingCount() const { return outbound_.getPendingCount(); }
+    
+    /**
+     * @brief Messages dropped because an outbound lane was full
+     */
+    uint64_t getOutboundDroppedCount() const { return outbound_.getDroppedCount(); }
+    
     /**
      * @brief Get the client ID
      * @return The client ID string
@@ -99,6 +157,27 @@ public:
      * @return The configuration path string
      */
     const std::string& getConfigPath() const { return configPath_; }
+    
+    /**
+     * @brief Broker and heartbeat settings of the loaded configuration,
+     * known once start() succeeded
+     */
+    const std::string& getBrokerHost() const { return brokerHost_; }
+    int getBrokerPort() const { return brokerPort_; }
+    bool usesTls() const { return brokerTls_; }
+    int getHeartbeatIntervalSeconds() const { return heartbeatIntervalSeconds_; }
+    bool isHeartbeatEchoEnabled() const { return heartbeatEcho_; }
+    
+    /**
+     * @brief Set name, CPUs and scheduling of the MQTT thread
+     * @param attr Attributes, used from the next start()
+     */
+    void setThreadAttributes(const thread_attr_t& attr) { threadAttr_ = attr; }
+    
+    /**
+     * @brief CPU time, context switches and activity of the MQTT thread
+     */
+    ThreadMgr::ThreadStats getThreadStats() const { return threadManager_->getThreadStats(rpcThreadId_); }
 
 private:
     // Configuration
@@ -108,22 +187,43 @@ private:
     // Thread management
     std::unique_ptr<ThreadMgr::ThreadManager> threadManager_;
     unsigned int rpcThreadId_{0};
+    thread_attr_t threadAttr_{};
     
     // RPC client context
     direct_client_thread_t* rpcContext_{nullptr};
     
+    // Every response goes through here rather than publishing from the
+    // thread that produced it
+    OutboundPublisher outbound_;
+    
     // Internal state
     std::atomic<bool> running_{false};
     std::atomic<bool> connected_{false};
-    std::function<void(const std::string&, const std::string&)> messageHandler_;
+    MessageHandler messageHandler_;
     mutable std::mutex handlerMutex_;
+    HeartbeatRttHandler heartbeatRttHandler_;
+    
+    // Copied from the client configuration before start() returns
+    std::string brokerHost_;
+    int brokerPort_{0};
+    bool brokerTls_{false};
+    int heartbeatIntervalSeconds_{0};
+    bool heartbeatEcho_{false};
+    
+    // start() and the RPC thread wait on these instead of polling
+    std::mutex stateMutex_;
+    std::condition_variable stateCv_;
+    bool startupDone_{false};
     
     // Core thread function
     void rpcClientThreadFunc();
+    void finishStartup();
     
-    // Static callback for C interoperability
+    // Static callbacks for C interoperability
     static void staticMessageHandler(const char* topic, const char* payload, 
                                    size_t payload_len, void* user_data);
+    static void staticConnectionHandler(bool connected, void* user_data);
+    static void staticHeartbeatRttHandler(double rtt_ms, void* user_data);
     
     // Internal methods
     void updateConnectionStatus(bool connected);
@@ -134,16 +234,52 @@ private:
 /**
  * @brief RPC Operation Processor for handling concurrent requests
  * 
- * This class processes incoming RPC requests using thread pools for
- * concurrent execution, following the patterns from the integration guide.
+ * This class processes incoming RPC requests on the shared TaskExecutor,
+ * at most workerCount at a time, fed through a bounded queue. When the
+ * queue is full the request is answered right away with a JSON-RPC
+ * "server busy" error instead of growing the backlog.
+ *
+ * The queue has a lane per request "authority": admin and system requests
+ * run ahead of user ones, and those ahead of guest (bulk) ones. Within a
+ * lane the request with the earliest deadline runs first. A request with
+ * "timeout_ms" (counted from its "timestamp" when present) whose caller
+ * has given up by the time a worker reaches it is dropped unanswered and
+ * counted in getExpiredCount().
+ *
+ * A request delivered again (same method and id, as after a QoS 1
+ * redelivery) is not run twice: while the first delivery runs the copy is
+ * dropped, and afterwards it gets the stored response, for as long as the
+ * replay window set with setReplayWindow() keeps it.
+ *
+ * A request with "chunk_window" gets a response larger than the size set
+ * with setChunking() as a run of chunks, paced by the requester's
+ * "rpc.chunk_ack" requests (see ChunkedResponses).
  */
 class RpcOperationProcessor {
 public:
+    // JSON-RPC error code (implementation-defined server error range) sent
+    // when the work queue is full
+    static constexpr int kServerBusyCode = -32000;
+    static constexpr int kMethodNotFoundCode = RequestRouter::kMethodNotFoundCode;
+    // Method of the acks that pace a chunked response; never dispatched
+    static constexpr const char* kChunkAckMethod = "rpc.chunk_ack";
+    
+    // Queue lanes, served in this order
+    static constexpr size_t kControlLane = 0;       // admin and system authority
+    static constexpr size_t kInteractiveLane = 1;   // user, and requests without an authority
+    static constexpr size_t kBulkLane = 2;          // guest
+    static constexpr size_t kLaneCount = 3;
+    static const char* laneName(size_t lane);
+    // Deadline, for ordering only, of a request that gives no timeout_ms
+    static constexpr std::chrono::seconds kDefaultRequestBudget{30};
+    
     /**
      * @brief Constructor
      * @param verbose Enable verbose logging
+     * @param workerCount Requests processed concurrently
+     * @param queueCapacity Requests that may wait for a worker, in each lane
      */
-    explicit RpcOperationProcessor(bool verbose = false);
+    explicit RpcOperationProcessor(bool verbose = false, size_t workerCount = 4, size_t queueCapacity = 64);
     
     /**
      * @brief Destructor - ensures proper cleanup
@@ -164,45 +300,137 @@ public:
     void setResponseTopic(const std::string& topic);
     
     /**
-     * @brief Shutdown the processor and clean up threads
+     * @brief Set the router requests are dispatched through
+     * @param router Router over a frozen registry; must outlive the processor
+     */
+    void setRouter(const RequestRouter* router) { router_ = router; }
+    
+    /**
+     * @brief Set the client whose outbound queue carries the responses
+     * @param client Client that outlives the processor; without one
+     * responses are published directly
+     */
+    void setPublisher(RpcClient* client) { publisher_ = client; }
+    
+    /**
+     * @brief Keep the responses of the last capacity requests for ttl, to
+     * answer redeliveries; capacity 0 runs every delivery. Set before
+     * requests arrive.
+     */
+    void setReplayWindow(size_t capacity, std::chrono::seconds ttl);
+    
+    /**
+     * @brief Send responses over chunkBytes in chunks to requests that take
+     * them, at most maxWindow unacked; chunkBytes 0 sends every response
+     * whole. Set before requests arrive.
+     * @param ackTopic Where requesters publish their acks, a topic this
+     * instance receives requests on
+     */
+    void setChunking(size_t chunkBytes, size_t maxWindow, const std::string& ackTopic);
+    
+    /**
+     * @brief Shutdown the processor: queued requests are still answered
+     * before this returns
      */
     void shutdown();
-
-private:
-    // Thread management
-    std::shared_ptr<ThreadMgr::ThreadManager> threadManager_;
-    std::set<unsigned int> activeThreads_;
-    std::mutex threadsMutex_;
-    std::atomic<bool> isShuttingDown_{false};
-    bool verbose_;
     
-    // Response handling
-    std::string responseTopic_;
+    /**
+     * @brief Number of requests rejected because the queue was full
+     */
+    uint64_t getRejectedCount() const { return rejectedRequests_.load(std::memory_order_relaxed); }
     
-    // Request context for thread-safe data passing
+    /**
+     * @brief Number of requests queued or waiting for a worker
+     */
+    size_t getPendingCount() const { return pendingRequests_.load(std::memory_order_relaxed); }
+    
+    /**
+     * @brief Number of requests in a lane dropped because their caller had timed out
+     */
+    uint64_t getExpiredCount(size_t lane) const {
+        return lane < kLaneCount ? expiredRequests_[lane].load(std::memory_order_relaxed) : 0;
+    }
+    
+    /**
+     * @brief Redelivered requests answered from the replay window, and
+     * those dropped because the first delivery was still running
+     */
+    uint64_t getReplayedCount() const { return replayedRequests_.load(std::memory_order_relaxed); }
+    uint64_t getDuplicateInFlightCount() const { return duplicateInFlight_.load(std::memory_order_relaxed); }
+    
+    /**
+     * @brief Responses sent in chunks, and those dropped unfinished because
+     * the requester stopped acking
+     */
+    uint64_t getChunkedCount() const { return chunks_ ? chunks_->startedCount() : 0; }
+    uint64_t getAbandonedChunkedCount() const { return chunks_ ? chunks_->abandonedCount() : 0; }
+
+private:
+    // Request context for thread-safe data passing: the validated request,
+    // already parsed
     struct RequestContext {
-        std::string requestJson;
+        std::string method;
+        nlohmann::json params;
         std::string transactionId;
         std::string responseTopic;
+        bool cbor;  // Request arrived as CBOR; answered the same way
         bool verbose;
-        std::shared_ptr<std::promise<unsigned int>> threadIdPromise;
-        std::shared_future<unsigned int> threadIdFuture;
+        size_t lane;
+        std::string replayKey;  // Empty when the request is not remembered
+        size_t chunkWindow;     // Chunks the requester takes unacked; 0 for whole responses
+        std::chrono::steady_clock::time_point queuedAt;
     };
     
+    // Drain tasks on the shared executor. pendingRequests_ is raised before
+    // a push and lowered after a pop; activeDrains_ never exceeds
+    // maxDrains_, and a drain that sees pending work after giving up its
+    // slot takes one again so no request is stranded.
+    ThreadMgr::TaskExecutor& executor_;
+    size_t maxDrains_;
+    std::atomic<size_t> activeDrains_{0};
+    DeadlineScheduler<std::shared_ptr<RequestContext>> queue_;
+    std::atomic<size_t> pendingRequests_{0};
+    std::atomic<uint64_t> rejectedRequests_{0};
+    std::array<std::atomic<uint64_t>, kLaneCount> expiredRequests_{};
+    std::unique_ptr<ReplayCache> replay_;
+    std::atomic<uint64_t> replayedRequests_{0};
+    std::atomic<uint64_t> duplicateInFlight_{0};
+    std::unique_ptr<ChunkedResponses> chunks_;
+    std::mutex idleMutex_;
+    std::condition_variable idleCv_;
+    std::atomic<bool> isShuttingDown_{false};
+    bool verbose_;
+    
+    // Response handling
+    std::string responseTopic_;
+    const RequestRouter* router_ = nullptr;
+    RpcClient* publisher_ = nullptr;
+    
     // Processing methods
-    void processOperationThread(std::shared_ptr<RequestContext> context);
+    bool acquireDrainSlot();
+    void scheduleDrain();
+    void drainQueue();
     static void processOperationThreadStatic(std::shared_ptr<RequestContext> context, RpcOperationProcessor* processor);
     
     // Response handling
-    void sendResponse(const std::string& transactionId, bool success, 
-                      const std::string& result, const std::string& error = "");
-    static void sendResponseStatic(const std::string& transactionId, bool success,
-                                   const std::string& result, const std::string& error,
-                                   const std::string& responseTopic);
+    void sendResponse(const std::string& transactionId, bool success, nlohmann::json result,
+                      const std::string& error = "", int errorCode = -1, bool cbor = false);
+    static void sendResponseStatic(RpcClient* publisher, const std::string& transactionId, bool success,
+                                   nlohmann::json result, const std::string& error,
+                                   const std::string& responseTopic, int errorCode = -1, bool cbor = false);
+    static std::string encodeResponse(const std::string& transactionId, bool success, nlohmann::json result,
+                                      const std::string& error, int errorCode, bool cbor);
+    // Publishes an encoded response whole, or in chunks when it is large
+    // and the requester takes them
+    void deliverResponse(const std::string& responseTopic, std::string payload, const std::string& transactionId,
+                         bool cbor, size_t chunkWindow);
+    void handleChunkAck(const nlohmann::json& params);
+    static void publishResponse(RpcClient* publisher, const std::string& responseTopic, std::string payload,
+                                const std::string& transactionId);
     
     // Utility methods
     std::string extractTransactionId(const nlohmann::json& request);
-    void cleanupThreadTracking(unsigned int threadId, std::shared_ptr<RequestContext> context);
+    static size_t laneFor(const nlohmann::json& request);
     
     // Logging methods
     void logInfo(const std::string& message) const;
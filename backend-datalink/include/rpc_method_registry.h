@@ -0,0 +1,70 @@
+#ifndef RPC_METHOD_REGISTRY_H
+#define RPC_METHOD_REGISTRY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+namespace BackendDatalink {
+
+using json = nlohmann::json;
+
+// Thrown by invoke() for a method nobody registered
+class UnknownMethodError : public std::runtime_error {
+public:
+    explicit UnknownMethodError(const std::string& method)
+        : std::runtime_error("Unknown method: " + method) {}
+};
+
+// Method name -> handler table shared by every front door (MQTT RPC, the
+// WebSocket actions). Subsystems add their methods at startup, then freeze()
+// sorts the table; from then on lookups are a binary search over
+// string_views with no locking or allocation, and each method keeps call
+// count, error count and timing.
+class RpcMethodRegistry {
+public:
+    typedef std::function<json(const json& params)> Handler;
+
+    RpcMethodRegistry() = default;
+
+    RpcMethodRegistry(const RpcMethodRegistry&) = delete;
+    RpcMethodRegistry& operator=(const RpcMethodRegistry&) = delete;
+
+    // Returns false for a duplicate name or once frozen
+    bool add(const std::string& name, Handler handler);
+    void freeze();
+
+    bool contains(std::string_view name) const;
+
+    // Runs the handler and returns its result. Throws UnknownMethodError, or
+    // whatever the handler threw (counted as an error).
+    json invoke(std::string_view name, const json& params) const;
+
+    // {"<method>": {"calls", "errors", "avg_ms", "max_ms"}, ...}
+    json getStats() const;
+
+private:
+    struct Entry {
+        std::string name;
+        Handler handler;
+        mutable std::atomic<uint64_t> calls{0};
+        mutable std::atomic<uint64_t> errors{0};
+        mutable std::atomic<uint64_t> total_ns{0};
+        mutable std::atomic<uint64_t> max_ns{0};
+    };
+
+    const Entry* find(std::string_view name) const;
+
+    std::vector<std::unique_ptr<Entry>> entries_; // Sorted by name after freeze()
+    bool frozen_ = false;
+};
+
+} // namespace BackendDatalink
+
+#endif // RPC_METHOD_REGISTRY_H
@@ -0,0 +1,43 @@
+#ifndef RPC_METHODS_H
+#define RPC_METHODS_H
+
+#include "rpc_method_registry.h"
+
+namespace BackendDatalink {
+
+// Method tables of each subsystem. Handlers look up the subsystem when
+// called and throw if it is not running, so they can be registered before
+// the subsystems start.
+
+// "dashboard.get_data": {"categories": [...]} -> {"data", "sequence"}
+void registerDashboardMethods(RpcMethodRegistry& registry);
+
+// "network_priority.<action>" for each WebSocket network priority action;
+// parameters are the fields of the WebSocket request
+void registerNetworkPriorityMethods(RpcMethodRegistry& registry);
+
+// "collector.get_metrics", "collector.get_status", "collector.start",
+// "collector.stop"
+void registerCollectorMethods(RpcMethodRegistry& registry);
+
+// "metrics_history.get_history": {"from", "to", "buckets", "fields"} ->
+// min/max/avg/p95 per field over the window and per bucket (see
+// MetricsHistory::aggregate)
+void registerHistoryMethods(RpcMethodRegistry& registry);
+
+// "cameras.scan": {"subnet", "force"} -> {"scan_started", "sequence",
+// "data"}, and "cameras.get" -> {"sequence", "data"}; data is the cached
+// "cameras" category (see CameraDiscovery)
+void registerCameraMethods(RpcMethodRegistry& registry);
+
+// "wireless.scan": {"force"} -> {"scan_started", "sequence", "data"}, and
+// "wireless.get" -> {"sequence", "data"}; data is the cached "wireless"
+// category (see WirelessScanner)
+void registerWirelessMethods(RpcMethodRegistry& registry);
+
+// "rpc.get_stats": per-method call counts and timing of this registry
+void registerRegistryMethods(RpcMethodRegistry& registry);
+
+} // namespace BackendDatalink
+
+#endif // RPC_METHODS_H
@@ -0,0 +1,101 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <string>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <exception>
+#include <cstddef>
+#include <cstdint>
+
+namespace BackendDatalink {
+
+// Coalesces identical requests: callers asking for the same key at the same
+// version share one build of the value. The first caller runs the build on
+// its own thread; the others block on its result instead of building their
+// own, and later callers at that version get the finished value straight
+// away. A newer version replaces the key's entry. A build that throws hands
+// the exception to everyone waiting on it and is not kept, so the next
+// caller retries.
+template <typename Value>
+class SingleFlight {
+public:
+    typedef std::shared_ptr<const Value> ValuePtr;
+
+    // Past max_keys distinct keys the table starts over, which bounds it
+    // against clients inventing keys
+    explicit SingleFlight(size_t max_keys = 64) : max_keys_(max_keys) {}
+
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    // build() returns a ValuePtr. shared, when given, tells whether the
+    // value came from another caller's build.
+    template <typename Build>
+    ValuePtr get(const std::string& key, uint64_t version, Build build, bool* shared = nullptr) {
+        std::promise<ValuePtr> promise;
+        std::shared_future<ValuePtr> in_flight;
+        uint64_t token = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(key);
+            if (it != entries_.end() && it->second.version == version) {
+                in_flight = it->second.result;
+            } else {
+                if (it == entries_.end() && entries_.size() >= max_keys_) {
+                    entries_.clear();
+                }
+                token = ++next_token_;
+                entries_[key] = Entry{version, token, promise.get_future().share()};
+            }
+        }
+
+        if (in_flight.valid()) {
+            // Waited on outside the lock: the build may still be running
+            if (shared) {
+                *shared = true;
+            }
+            return in_flight.get();
+        }
+
+        if (shared) {
+            *shared = false;
+        }
+        try {
+            ValuePtr value = build();
+            promise.set_value(value);
+            return value;
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(key);
+            if (it != entries_.end() && it->second.token == token) {
+                entries_.erase(it);
+            }
+            throw;
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+private:
+    struct Entry {
+        uint64_t version;
+        uint64_t token;     // Identifies the build, so a failure only drops its own entry
+        std::shared_future<ValuePtr> result;
+    };
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    uint64_t next_token_ = 0;
+    const size_t max_keys_;
+};
+
+} // namespace BackendDatalink
+
+#endif // SINGLE_FLIGHT_H
@@ -0,0 +1,64 @@
+#ifndef STARTUP_ORCHESTRATOR_H
+#define STARTUP_ORCHESTRATOR_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace BackendDatalink {
+
+// Brings subsystems up in parallel, each as soon as the phases it needs are
+// ready, so a slow one (a broker that does not answer, a network probe)
+// only delays what actually depends on it.
+//   - A phase is a name, the phases it runs after and a task returning
+//     whether it succeeded. Every ready phase gets its own thread.
+//   - A phase that fails or throws fails startup; the phases after it are
+//     skipped, the others still finish.
+//   - Each phase's start offset and duration are logged as it ends, and
+//     kept for report().
+class StartupOrchestrator {
+public:
+    typedef std::function<bool()> Task;
+
+    // after must name phases added earlier
+    void add(const std::string& name, const std::vector<std::string>& after, Task task);
+
+    // Runs every phase and waits for them; false if any failed or was skipped
+    bool run();
+
+    // [{"phase", "after", "state", "start_ms", "duration_ms", "error"}] in
+    // the order the phases were added
+    json report() const;
+
+private:
+    enum class State { Pending, Running, Succeeded, Failed, Skipped };
+
+    struct Phase {
+        std::string name;
+        std::vector<size_t> after;
+        Task task;
+        State state = State::Pending;
+        std::chrono::steady_clock::duration start{};
+        std::chrono::steady_clock::duration duration{};
+        std::string error;
+    };
+
+    std::vector<Phase> phases_;
+    std::chrono::steady_clock::time_point started_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable finished_;
+
+    void runPhase(size_t index);
+    static const char* stateName(State state);
+};
+
+} // namespace BackendDatalink
+
+#endif // STARTUP_ORCHESTRATOR_H
@@ -0,0 +1,70 @@
+#ifndef TELEMETRY_PUBLISHER_H
+#define TELEMETRY_PUBLISHER_H
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "config_loader.h"
+#include "SystemDataCollector.h"
+
+namespace BackendDatalink {
+
+class RpcClient;
+
+// Downsampled metrics for fleet monitoring, sent as RPC notifications over
+// MQTT so devices need not be polled.
+//   - Every recorded snapshot feeds min/avg/max aggregates of the numeric
+//     dashboard fields over a fixed window.
+//   - When the window closes, only the fields whose average moved at least
+//     their deadband since it was last published go out, as one notification
+//     of {"window_s", "samples", "ts", "fields": {name: [min, avg, max]}}.
+//     A window with no such field sends nothing, except that every field is
+//     sent again after full_report_windows windows.
+class TelemetryPublisher {
+public:
+    TelemetryPublisher(const ConfigLoader::TelemetryConfig& config, RpcClient* client);
+
+    // Adds one sample; publishes when it closes the current window
+    void record(const SystemDataCollector::SystemMetrics& metrics);
+
+    uint64_t getPublishedCount() const { return published_.load(std::memory_order_relaxed); }
+    // Fields left out of a notification because they stayed in their deadband
+    uint64_t getSuppressedCount() const { return suppressed_.load(std::memory_order_relaxed); }
+    // Windows whose notification could not be sent
+    uint64_t getFailedCount() const { return failed_.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t kFieldCount = 7;
+
+    struct Aggregate {
+        double min = 0.0;
+        double max = 0.0;
+        double sum = 0.0;
+    };
+
+    ConfigLoader::TelemetryConfig config_;
+    RpcClient* client_;
+    double deadbands_[kFieldCount];
+
+    std::mutex mutex_;
+    Aggregate window_[kFieldCount];
+    size_t samples_ = 0;
+    std::chrono::steady_clock::time_point window_start_;
+    double last_published_[kFieldCount];
+    bool has_published_ = false;
+    int windows_since_full_ = 0;
+
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> suppressed_{0};
+    std::atomic<uint64_t> failed_{0};
+
+    // Called with mutex_ held; resets the window
+    void closeWindow();
+};
+
+} // namespace BackendDatalink
+
+#endif // TELEMETRY_PUBLISHER_H
@@ -0,0 +1,57 @@
+#ifndef ULTIMA_HEALTH_PROBE_H
+#define ULTIMA_HEALTH_PROBE_H
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "SystemDataCollector.h"
+
+namespace BackendDatalink {
+
+class RpcClient;
+
+// Health of the upstream Ultima server, measured on the RPC client's MQTT
+// session instead of a connection of its own. With heartbeat echo on, every
+// heartbeat comes back through the broker and its round trip is recorded
+// here; the collector then samples the result into ultima_server:
+//   - last, EWMA and p50/p95/p99 ping over the last kWindow echoes
+//   - status "Connected", "Degraded" (connected, but no echo for
+//     kStaleBeats heartbeat intervals) or "Disconnected"
+//   - session "Active", "Reconnecting" after a lost connection, or "N/A"
+class UltimaHealthProbe {
+public:
+    explicit UltimaHealthProbe(const RpcClient* client);
+
+    // One echoed heartbeat; runs on the MQTT loop thread
+    void recordRtt(double rtt_ms);
+
+    // Fills server from the client state and the recorded echoes
+    void sample(SystemDataCollector::SystemMetrics::UltimaServer& server);
+
+    uint64_t getEchoCount() const { return echoes_.load(std::memory_order_relaxed); }
+    double getAverageMs() const;
+
+private:
+    static const size_t kWindow = 128;
+    static const int kStaleBeats = 3;
+    static constexpr double kEwmaWeight = 0.2;
+
+    const RpcClient* client_;
+    std::atomic<uint64_t> echoes_{0};
+
+    mutable std::mutex mutex_;
+    std::vector<double> window_;        // Ring of the latest round trips
+    size_t next_ = 0;
+    double last_ms_ = 0.0;
+    double ewma_ms_ = 0.0;
+    std::chrono::steady_clock::time_point last_echo_;
+    bool was_connected_ = false;        // Collector thread only
+
+    static double percentile(const std::vector<double>& sorted, double fraction);
+};
+
+} // namespace BackendDatalink
+
+#endif // ULTIMA_HEALTH_PROBE_H
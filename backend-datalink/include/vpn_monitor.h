@@ -0,0 +1,132 @@
+#ifndef VPN_MONITOR_H
+#define VPN_MONITOR_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "config_loader.h"
+
+using json = nlohmann::json;
+
+struct nlmsghdr;
+
+namespace BackendDatalink {
+
+// Tunnel state and byte counters for the VPN page, without running wg or
+// parsing OpenVPN status files.
+//   - WireGuard: links of kind "wireguard" are listed once over rtnetlink
+//     and tracked from RTM_NEWLINK/RTM_DELLINK events. Each device is read
+//     with WG_CMD_GET_DEVICE over generic netlink; WireGuard sends no
+//     notifications, so that dump repeats every wireguard_refresh_ms while
+//     a device exists. It needs CAP_NET_ADMIN.
+//   - OpenVPN: one connection per management endpoint with "state on" and
+//     "bytecount N", so state changes and counters are pushed by OpenVPN.
+//     A lost endpoint is reconnected every few seconds.
+//   - Every change is reported to the update handler as the whole "vpn"
+//     category value:
+//       {"tunnels": {name: {"type", "state", "connected", "rx_bytes", "tx_bytes", ...}}}
+//     WireGuard tunnels are named by interface, OpenVPN tunnels
+//     "openvpn:<endpoint>". WireGuard peers are keyed by public key.
+class VpnMonitor {
+public:
+    typedef std::function<void(const json& vpn)> UpdateHandler;
+
+    VpnMonitor(const ConfigLoader::VpnMonitorConfig& config, UpdateHandler on_update);
+    ~VpnMonitor();
+
+    VpnMonitor(const VpnMonitor&) = delete;
+    VpnMonitor& operator=(const VpnMonitor&) = delete;
+
+    // False if the rtnetlink sockets cannot be opened. A WireGuard module
+    // loaded later is picked up with its first device.
+    bool start();
+    void stop();
+
+    // The cached "vpn" value
+    json getStatus() const;
+
+private:
+    struct Peer {
+        std::string endpoint;
+        int64_t last_handshake = 0;     // Unix seconds, 0 if never
+        uint64_t rx_bytes = 0;
+        uint64_t tx_bytes = 0;
+        std::vector<std::string> allowed_ips;
+    };
+
+    struct WireguardDevice {
+        std::string name;
+        bool up = false;
+        int listen_port = 0;
+        std::string public_key;
+        std::map<std::string, Peer> peers;  // By base64 public key
+        std::string error;
+    };
+
+    struct OpenvpnEndpoint {
+        std::string address;            // Socket path or "host:port"
+        int fd = -1;
+        bool connecting = false;        // Non-blocking connect in progress
+        std::string buffer;             // Unterminated input
+        std::chrono::steady_clock::time_point retry_at;
+        std::string state = "UNREACHABLE";
+        std::string description;
+        std::string local_ip;
+        std::string remote_ip;
+        int64_t since = 0;              // Unix seconds of the last state change
+        uint64_t rx_bytes = 0;
+        uint64_t tx_bytes = 0;
+        std::string error;
+    };
+
+    static constexpr std::chrono::seconds kReconnectInterval{5};
+    // A line longer than this is not from OpenVPN's management interface
+    static const size_t kMaxLineLength = 4096;
+
+    ConfigLoader::VpnMonitorConfig config_;
+    UpdateHandler on_update_;
+
+    int link_events_fd_ = -1;           // Member of RTNLGRP_LINK
+    int route_fd_ = -1;                 // Link dumps, loop thread only
+    int genl_fd_ = -1;                  // WireGuard requests, loop thread only
+    int wake_fd_ = -1;                  // eventfd
+    uint16_t wireguard_family_ = 0;
+    uint32_t sequence_ = 1;
+
+    std::thread thread_;
+    // Loop thread only
+    std::map<int, WireguardDevice> devices_;    // By interface index
+    std::vector<OpenvpnEndpoint> endpoints_;
+    std::chrono::steady_clock::time_point refresh_at_;
+    json published_;
+
+    mutable std::mutex mutex_;
+    bool running_ = false;
+    json status_;                       // Guarded by mutex_
+
+    void run();
+    void wake();
+    void listLinks();
+    void handleLinkEvents();
+    void handleLink(const nlmsghdr* header, std::map<int, WireguardDevice>& devices);
+    void refreshWireguard();
+    void readDevice(int index, WireguardDevice& device);
+    void connectEndpoint(OpenvpnEndpoint& endpoint);
+    void finishConnect(OpenvpnEndpoint& endpoint);
+    void closeEndpoint(OpenvpnEndpoint& endpoint, const std::string& error);
+    void receiveEndpoint(OpenvpnEndpoint& endpoint);
+    void handleLine(OpenvpnEndpoint& endpoint, const std::string& line);
+    void setState(OpenvpnEndpoint& endpoint, const std::string& fields);
+    void publish();
+    json toJson() const;
+};
+
+} // namespace BackendDatalink
+
+#endif // VPN_MONITOR_H
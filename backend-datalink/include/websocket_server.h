@@ -8,71 +8,360 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <chrono>
+#include <sys/types.h>
 #include "config_loader.h"
+#include "inbound_message.h"
+#include "connection_id.h"
 
 using json = nlohmann::json;
 
-typedef websocketpp::server<websocketpp::config::asio> server;
+#ifdef HAVE_PERMESSAGE_DEFLATE
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+
+#ifndef WS_DEFLATE_MIN_WINDOW_BITS
+#define WS_DEFLATE_MIN_WINDOW_BITS 8
+#endif
+
+// The stock extension, but only accepted during the handshake while
+// websocket.compression.enabled is set; otherwise the client's offer is
+// declined and the connection runs without deflate, as in a build without it
+template <typename config>
+class gated_permessage_deflate : public websocketpp::extensions::permessage_deflate::enabled<config> {
+public:
+    // Shared by every connection; set by WebSocketServer::start()
+    static std::atomic<bool>& offered() {
+        static std::atomic<bool> flag(false);
+        return flag;
+    }
+
+    websocketpp::err_str_pair negotiate(websocketpp::http::attribute_list const& offer) {
+        if (!offered().load(std::memory_order_relaxed)) {
+            return websocketpp::err_str_pair(
+                websocketpp::extensions::error::make_error_code(websocketpp::extensions::error::disabled),
+                std::string());
+        }
+        return websocketpp::extensions::permessage_deflate::enabled<config>::negotiate(offer);
+    }
+};
+
+// asio config with the permessage-deflate extension compiled in. Whether a
+// message is actually compressed is decided per send (see shouldCompress()).
+struct deflate_asio_config : public websocketpp::config::asio {
+    typedef deflate_asio_config type;
+    typedef websocketpp::config::asio base;
+
+    typedef base::concurrency_type concurrency_type;
+    typedef base::request_type request_type;
+    typedef base::response_type response_type;
+    typedef base::message_type message_type;
+    typedef base::con_msg_manager_type con_msg_manager_type;
+    typedef base::endpoint_msg_manager_type endpoint_msg_manager_type;
+    typedef base::alog_type alog_type;
+    typedef base::elog_type elog_type;
+    typedef base::rng_type rng_type;
+    typedef base::transport_type transport_type;
+
+    struct permessage_deflate_config {
+        typedef base::request_type request_type;
+        static const bool allow_disabling_context_takeover = true;
+        static const uint8_t minimum_outgoing_window_bits = WS_DEFLATE_MIN_WINDOW_BITS;
+    };
+
+    typedef gated_permessage_deflate<permessage_deflate_config> permessage_deflate_type;
+};
+
+typedef deflate_asio_config ws_config;
+#else
+typedef websocketpp::config::asio ws_config;
+#endif
+
+typedef websocketpp::server<ws_config> server;
 typedef server::message_ptr message_ptr;
 typedef websocketpp::connection_hdl connection_hdl;
 
-// Custom hash functor for connection_hdl to fix GCC 11 compatibility
-struct connection_hdl_hash {
-    size_t operator()(const connection_hdl& hdl) const {
-        // Use the raw pointer value - expired connections will be nullptr which is fine
-        return std::hash<void*>()(hdl.lock().get());
-    }
+// A snapshot held back by backpressure, already encoded for its connection
+struct PendingMessage {
+    std::string payload;
+    WireEncoding encoding = WireEncoding::Json;
 };
 
-// Custom equal_to functor for connection_hdl to fix GCC 11 compatibility
-struct connection_hdl_equal {
-    bool operator()(const connection_hdl& a, const connection_hdl& b) const {
-        // Use owner_before which works properly with weak_ptr<void>
-        return !a.owner_before(b) && !b.owner_before(a);
-    }
+// A reply built once for many connections (coalesced requests): each wire
+// encoding is produced on first use and then shared by every send.
+// supersedes names the categories the message carries in full; snapshots
+// of those parked for the connection are older and dropped when it goes out.
+class SharedMessage {
+public:
+    explicit SharedMessage(json message, std::vector<std::string> supersedes = {})
+        : message_(std::move(message)), supersedes_(std::move(supersedes)) {}
+
+    const json& message() const { return message_; }
+    const std::vector<std::string>& supersedes() const { return supersedes_; }
+    const std::string& payload(WireEncoding encoding) const;
+
+private:
+    json message_;
+    std::vector<std::string> supersedes_;
+    mutable std::once_flag encoded_[3];
+    mutable std::string payloads_[3];
+};
+
+// Per-connection bookkeeping kept alongside the handle, one slot of the
+// connection table
+struct ConnectionInfo {
+    enum class State {
+        Free,
+        Handshake,              // Admitted, id bound to its handlers, not open yet
+        Open,
+        Gone                    // A send failed; waits for the close handler
+    };
+
+    BackendDatalink::ConnectionId id = BackendDatalink::kNoConnection;
+    State state = State::Free;
+    connection_hdl hdl;
+    bool hybi_framing = true;   // RFC 6455 framing, can share pre-framed broadcast buffers
+    WireEncoding encoding = WireEncoding::Json;
+    bool subscribe_all = true;  // No explicit subscription yet: receive every category
+    uint64_t categories = 0;    // Bits of WebSocketServer's category table
+    // Latest snapshot per category held back while the socket is over its
+    // buffer limit; a newer update for the same category replaces it
+    std::unordered_map<std::string, PendingMessage> pending;
+    // Bumped by each reply that supersedes parked snapshots, so a flush
+    // already holding them can tell they went stale
+    uint64_t snapshot_epoch = 0;
+    // Last frame (message or pong) received, for the idle timeout
+    std::chrono::steady_clock::time_point last_activity;
+};
+
+// Outbound backpressure counters
+struct SendQueueStats {
+    uint64_t messages_sent = 0;
+    uint64_t messages_coalesced = 0;
+    uint64_t messages_dropped = 0;
+    uint64_t connections_evicted = 0;
+    uint64_t connections_rejected = 0;  // Refused at the handshake: over max_connections or admission closed
+    uint64_t connections_timed_out = 0; // Closed for a missed pong or the idle timeout
 };
 
 class WebSocketServer {
 public:
-    typedef std::function<void(const std::string&, const json&)> MessageHandler;
-    typedef std::function<void(const std::string&)> ConnectionHandler;
+    // The message is already scanned and only valid for the duration of the
+    // call; its body() is parsed into the io thread's MessageArena
+    typedef std::function<void(BackendDatalink::ConnectionId, const BackendDatalink::InboundMessage&)> MessageHandler;
+    typedef std::function<void(BackendDatalink::ConnectionId)> ConnectionHandler;
 
     WebSocketServer();
     ~WebSocketServer();
 
-    bool start(const ConfigLoader::WebSocketConfig& config);
+    // With caller_runs_io one of the io_threads is left to the caller, who
+    // lends its thread through run()
+    bool start(const ConfigLoader::WebSocketConfig& config, bool caller_runs_io = false);
+    // Runs the io loop on the calling thread until stop()
+    void run();
     void stop();
+    // Sheds load without dropping clients: stops accepting, drops
+    // broadcasts and holds the latest publish per category, while
+    // connections stay open, requests are answered and keepalives go on.
+    // resume() listens again and sends the held updates. Not from an io
+    // thread.
+    void pause();
+    bool resume();
+    bool isPaused() const { return paused_.load(); }
+    // While closed, new clients are answered 503 at the handshake; open
+    // connections are left alone (memory pressure, see MemoryBudget)
+    void setAdmissionClosed(bool closed) { admission_closed_.store(closed); }
+    bool isAdmissionClosed() const { return admission_closed_.load(); }
+    // Graceful stop for a restart: stops accepting, so new clients reach
+    // the next process (SO_REUSEPORT) or wait in systemd's socket, closes
+    // the connections with 1012 (service restart) spread over the first
+    // half of window so they do not all reconnect at once, waits out the
+    // rest of it for their close handshakes, then stops
+    void drain(std::chrono::seconds window);
     bool isRunning() const { return running_.load(); }
 
     void setMessageHandler(MessageHandler handler) { message_handler_ = handler; }
     void setConnectionOpenHandler(ConnectionHandler handler) { connection_open_handler_ = handler; }
     void setConnectionCloseHandler(ConnectionHandler handler) { connection_close_handler_ = handler; }
 
+    // String payloads must be JSON text; MessagePack/CBOR connections get
+    // it re-encoded
     void broadcast(const json& message);
-    void sendToClient(const std::string& connection_id, const json& message);
-    size_t getConnectionCount() const { return connections_.size(); }
+    void broadcast(const std::string& payload);
+    
+    // Topic fan-out: only connections subscribed to the category (or to
+    // everything) receive the message
+    void publish(const std::string& category, const json& message);
+    void publish(const std::string& category, const std::string& payload);
+    
+    // Replaces the connection's subscription set; an empty list subscribes
+    // it to every category again. Past kMaxCategories distinct names,
+    // further ones are left out of the set.
+    bool setSubscriptions(BackendDatalink::ConnectionId connection_id, const std::vector<std::string>& categories);
+    // Connections a publish to category would reach
+    size_t getSubscriberCount(const std::string& category) const;
+    
+    void sendToClient(BackendDatalink::ConnectionId connection_id, const json& message);
+    void sendToClient(BackendDatalink::ConnectionId connection_id, const std::shared_ptr<const SharedMessage>& message);
+    // Raw bytes in a binary frame. Over the send buffer limit the newest
+    // payload per key is held back, like category snapshots; without a
+    // key it is dropped.
+    void sendBinaryToClient(BackendDatalink::ConnectionId connection_id, const std::string& payload,
+                            const std::string& key);
+    
+    // Takes the settings that can change while running (logging, send
+    // buffer limit, slow consumer policy, compression threshold, connection
+    // cap, idle timeout, message element limit); the endpoint, thread count, handshake and
+    // keepalive timings keep their values until the next start()
+    void applyConfig(const ConfigLoader::WebSocketConfig& config);
+    
+    size_t getConnectionCount() const;
+    SendQueueStats getSendQueueStats() const;
+    // Outbound bytes held for clients: websocketpp's send buffers plus the
+    // snapshots parked by backpressure
+    size_t getQueuedBytes() const;
 
 private:
     server server_;
-    std::thread server_thread_;
+    // Local consumers (frontendpp's proxy) connect here without the TCP stack
+    std::unique_ptr<websocketpp::lib::asio::local::stream_protocol::acceptor> unix_acceptor_;
+    ino_t unix_socket_inode_ = 0;   // Of the socket file bound here; 0 when systemd owns it
+    // Used instead of websocketpp's own listener for a socket passed by
+    // systemd or one bound with SO_REUSEPORT
+    std::unique_ptr<websocketpp::lib::asio::ip::tcp::acceptor> tcp_acceptor_;
+    std::vector<std::thread> server_threads_;
     std::atomic<bool> running_;
+    std::atomic<bool> paused_;
+    std::atomic<bool> admission_closed_;
+
+    // The latest publish per category while paused, as given
+    struct HeldUpdate {
+        json message;
+        std::string payload;
+        bool raw;               // payload was given instead of message
+    };
+    std::unordered_map<std::string, HeldUpdate> held_updates_;
+    std::mutex paused_mutex_;
     ConfigLoader::WebSocketConfig config_;
 
-    std::unordered_map<connection_hdl, std::string, 
-                       connection_hdl_hash, 
-                       connection_hdl_equal> connections_;
-    std::mutex connections_mutex_;
+    // Categories a subscription bitmap can name
+    static constexpr size_t kMaxCategories = 64;
+
+    // Connection table, a slab indexed by the slot in the low bits of the
+    // id. websocketpp callbacks are bound per connection with their id at
+    // handshake time, so callbacks and sendToClient find their slot by
+    // index and one compare, without hashing strings or handles. Freed
+    // slots are reused; the serial in the id tells the new connection from
+    // the old one.
+    std::vector<ConnectionInfo> slots_;
+    std::vector<uint32_t> free_slots_;
+    uint32_t next_serial_ = 1;
+    size_t open_connections_ = 0;
+    mutable std::mutex connections_mutex_;
+    // Category name -> its bit in ConnectionInfo::categories, guarded by
+    // connections_mutex_. Looked up once per publish; the fan-out then
+    // tests one bit per connection.
+    std::unordered_map<std::string, int> category_bits_;
+
+    // Backpressure; read on the io threads, replaced by applyConfig()
+    std::atomic<size_t> max_send_buffer_bytes_;
+    std::atomic<bool> disconnect_slow_consumers_;
+    bool compression_enabled_;
+    std::atomic<size_t> compression_min_size_;
+    std::atomic<bool> logging_enabled_;
+    std::atomic<uint64_t> messages_sent_;
+    std::atomic<uint64_t> messages_coalesced_;
+    std::atomic<uint64_t> messages_dropped_;
+    std::atomic<uint64_t> connections_evicted_;
+
+    // Admission and liveness; admitted_connections_ counts every connection
+    // past validateHandshake() until its close or fail handler runs
+    std::atomic<size_t> max_connections_;
+    std::atomic<size_t> admitted_connections_;
+    std::atomic<int> idle_timeout_ms_;
+    std::atomic<size_t> max_message_elements_;
+    std::atomic<uint64_t> connections_rejected_;
+    std::atomic<uint64_t> connections_timed_out_;
 
     MessageHandler message_handler_;
     ConnectionHandler connection_open_handler_;
     ConnectionHandler connection_close_handler_;
 
-    void onOpen(connection_hdl hdl);
-    void onClose(connection_hdl hdl);
-    void onMessage(connection_hdl hdl, message_ptr msg);
-    void onError(connection_hdl hdl);
+    bool listen();
+    void stopListening();
+    bool holdWhilePaused(const std::string& category, HeldUpdate update);
+    bool listenUnix(const std::string& path);
+    void acceptUnix();
+    bool listenTcp(const websocketpp::lib::asio::ip::tcp::endpoint& endpoint);
+    void acceptTcp();
+    // Runs fn on an io thread and waits for it
+    void runOnIoThread(const std::function<void()>& fn);
+    void onOpen(connection_hdl hdl, BackendDatalink::ConnectionId connection_id);
+    void onClose(BackendDatalink::ConnectionId connection_id);
+    void onMessage(BackendDatalink::ConnectionId connection_id, message_ptr msg);
+    void onError(BackendDatalink::ConnectionId connection_id);
+    void onPong(BackendDatalink::ConnectionId connection_id);
+    void onPongTimeout(connection_hdl hdl, BackendDatalink::ConnectionId connection_id);
+
+    // Callers hold connections_mutex_
+    ConnectionInfo* findLocked(BackendDatalink::ConnectionId connection_id);
+    ConnectionInfo* findOpenLocked(BackendDatalink::ConnectionId connection_id);
+    BackendDatalink::ConnectionId reserveSlotLocked();
+    void releaseSlotLocked(ConnectionInfo& info);
+    // -1 for a category no connection subscribed to yet (or past
+    // kMaxCategories when adding)
+    int categoryBitLocked(const std::string& category, bool add);
+
+    struct SendTarget {
+        connection_hdl hdl;
+        BackendDatalink::ConnectionId id;
+        bool hybi_framing;
+        WireEncoding encoding;
+    };
+
+    // One outgoing message, encoded and framed lazily at most once per wire
+    // encoding so a broadcast shares buffers between connections that
+    // negotiated the same format. Raw payloads only exist in one encoding;
+    // JSON text is parsed once if a binary-encoding connection needs it.
+    struct Outbound {
+        const json* message = nullptr;
+        const SharedMessage* shared = nullptr;  // Encodings owned by the caller
+        bool has_fixed_encoding = false;
+        WireEncoding fixed_encoding = WireEncoding::Json;
+        std::string payloads[3];
+        bool encoded[3] = {false, false, false};
+        message_ptr frames[3];
+        json parsed;                            // JSON text, once re-encoded
+
+        explicit Outbound(const json& msg) : message(&msg) {}
+        explicit Outbound(const SharedMessage& msg) : shared(&msg) {}
+        explicit Outbound(const std::string& json_text);
+        Outbound(const std::string& payload, WireEncoding encoding);
+
+        WireEncoding encodingFor(const SendTarget& target) const;
+        const std::string& payload(WireEncoding encoding);
+    };
 
-    std::string generateConnectionId() const;
+    std::vector<SendTarget> snapshotAllTargets();
+    std::vector<SendTarget> snapshotSubscribers(const std::string& category);
+    static SendTarget makeTarget(const ConnectionInfo& info);
+    void sendToTargets(const std::vector<SendTarget>& targets, Outbound& outbound,
+                       const std::string& category = "");
+    bool sendWithBackpressure(const SendTarget& target, Outbound& outbound,
+                              const std::string& category);
+    bool shouldCompress(size_t payload_size) const;
+    void handleSlowConsumer(const SendTarget& target);
+    void scheduleFlush();
+    void scheduleKeepalive();
+    void sweepConnections();
+    void flushPending();
+    bool snapshotsSuperseded(BackendDatalink::ConnectionId connection_id, uint64_t epoch);
+    message_ptr prepareFrame(const std::string& payload, websocketpp::frame::opcode::value opcode) const;
+    bool validateHandshake(connection_hdl hdl);
     void log(const std::string& message) const;
 };
 
@@ -0,0 +1,118 @@
+#ifndef WIRELESS_SCANNER_H
+#define WIRELESS_SCANNER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "config_loader.h"
+
+using json = nlohmann::json;
+
+namespace BackendDatalink {
+
+// Nearby access points from nl80211, for the wireless page's site survey.
+//   - One thread owns the generic netlink sockets. A scan is triggered
+//     with NL80211_CMD_TRIGGER_SCAN (low priority where the driver supports
+//     it, so it yields to traffic) and does not block anyone: the results
+//     are dumped when the scan multicast group reports
+//     NL80211_CMD_NEW_SCAN_RESULTS. Scans started by anyone else
+//     (wpa_supplicant) refresh the cache the same way.
+//   - Requests while a scan runs join it, and results younger than
+//     cache_ttl_seconds are served from the cache, so any number of
+//     clients cost at most one scan per interface.
+//   - Without CAP_NET_ADMIN no scan can be triggered; the cache then holds
+//     the kernel's results from other scans and "error" says why.
+//   - Every cache change is reported to the update handler as the whole
+//     "wireless" category value:
+//       {"scanning", "last_scan", "interfaces": [...], "error", "networks": {bssid: {...}}}
+class WirelessScanner {
+public:
+    typedef std::function<void(const json& wireless)> UpdateHandler;
+
+    WirelessScanner(const ConfigLoader::WirelessScanConfig& config, UpdateHandler on_update);
+    ~WirelessScanner();
+
+    WirelessScanner(const WirelessScanner&) = delete;
+    WirelessScanner& operator=(const WirelessScanner&) = delete;
+
+    // False if nl80211 is not available (no wireless driver loaded)
+    bool start();
+    void stop();
+
+    // Returns false when the request joined a scan in progress or the
+    // cache is younger than cache_ttl_seconds and force is not set. Throws
+    // std::runtime_error when the scanner is not running.
+    bool requestScan(bool force);
+
+    // The cached "wireless" value
+    json getNetworks() const;
+
+private:
+    struct Network {
+        std::string bssid;
+        std::string ssid;
+        std::string interface;
+        int frequency = 0;              // MHz
+        int channel = 0;
+        int signal_dbm = 0;
+        std::string security;           // "None", "WEP", "WPA", "WPA2", "WPA3", "WPA2/WPA3", "OWE", "...-Enterprise"
+        bool associated = false;
+        int64_t last_seen = 0;          // Unix milliseconds
+    };
+
+    struct Interface {
+        int index = 0;
+        std::string name;
+    };
+
+    ConfigLoader::WirelessScanConfig config_;
+    UpdateHandler on_update_;
+
+    int event_fd_ = -1;                 // Member of the nl80211 "scan" group
+    int command_fd_ = -1;               // Requests and dumps, loop thread only
+    int wake_fd_ = -1;                  // eventfd
+    uint16_t family_ = 0;               // nl80211 generic netlink family id
+    uint32_t scan_group_ = 0;
+    uint32_t sequence_ = 1;
+
+    std::thread thread_;
+    json published_;                    // Last value given to on_update_, loop thread only
+
+    mutable std::mutex mutex_;
+    bool running_ = false;
+    // Guarded by mutex_
+    bool scan_requested_ = false;
+    bool scanning_ = false;
+    std::set<int> pending_;             // Interfaces whose results are awaited
+    std::chrono::steady_clock::time_point deadline_;
+    std::chrono::steady_clock::time_point last_scan_steady_;
+    int64_t last_scan_ = 0;             // Unix seconds the last scan finished
+    std::vector<Interface> interfaces_;
+    std::map<std::string, Network> networks_;   // By BSSID
+    std::string error_;
+
+    bool resolveFamily();
+    void run();
+    void wake();
+    void startScan();
+    void handleEvents();
+    void finishScan(int index);
+    std::vector<Interface> listInterfaces();
+    int triggerScan(int index, bool low_priority);
+    bool dumpResults(const Interface& interface, std::vector<Network>& networks);
+    void replaceNetworks(const Interface& interface, std::vector<Network> networks);
+    bool findInterface(int index, Interface& interface) const;
+    void publish();
+    json toJsonLocked() const;
+};
+
+} // namespace BackendDatalink
+
+#endif // WIRELESS_SCANNER_H
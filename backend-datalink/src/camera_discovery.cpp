@@ -0,0 +1,701 @@
+#include "camera_discovery.h"
+#include "backend_log.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace BackendDatalink {
+
+namespace {
+
+const uint16_t kWsDiscoveryPort = 3702;
+const char* const kWsDiscoveryGroup = "239.255.255.250";
+const uint16_t kMdnsPort = 5353;
+const char* const kMdnsGroup = "224.0.0.251";
+const char* const kMdnsServices[] = {"_rtsp._tcp.local", "_axis-video._tcp.local"};
+
+// Subnets scanned at once
+const size_t kMaxScans = 8;
+
+int64_t unixSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string addressString(uint32_t address) {
+    in_addr value;
+    value.s_addr = htonl(address);
+    char text[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &value, text, sizeof(text));
+    return text;
+}
+
+sockaddr_in endpoint(uint32_t address, uint16_t port) {
+    sockaddr_in destination;
+    std::memset(&destination, 0, sizeof(destination));
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(port);
+    destination.sin_addr.s_addr = htonl(address);
+    return destination;
+}
+
+uint32_t groupAddress(const char* group) {
+    in_addr value;
+    inet_pton(AF_INET, group, &value);
+    return ntohl(value.s_addr);
+}
+
+// RFC 1918 and link-local; nothing else is swept
+bool isPrivate(uint32_t address) {
+    return (address >> 24) == 10 ||
+           (address >> 20) == ((172u << 4) | 1) ||
+           (address >> 16) == ((192u << 8) | 168) ||
+           (address >> 16) == ((169u << 8) | 254);
+}
+
+// IPv4 addresses of the interfaces that are up, loopback excluded
+std::vector<uint32_t> localAddresses() {
+    std::vector<uint32_t> addresses;
+    ifaddrs* list = nullptr;
+    if (getifaddrs(&list) != 0) {
+        return addresses;
+    }
+    for (ifaddrs* entry = list; entry; entry = entry->ifa_next) {
+        if (!entry->ifa_addr || entry->ifa_addr->sa_family != AF_INET ||
+            !(entry->ifa_flags & IFF_UP) || (entry->ifa_flags & IFF_LOOPBACK)) {
+            continue;
+        }
+        uint32_t address = ntohl(reinterpret_cast<const sockaddr_in*>(entry->ifa_addr)->sin_addr.s_addr);
+        if (std::find(addresses.begin(), addresses.end(), address) == addresses.end()) {
+            addresses.push_back(address);
+        }
+    }
+    freeifaddrs(list);
+    return addresses;
+}
+
+uint32_t parseSubnet(const std::string& subnet) {
+    std::string address = subnet;
+    size_t slash = subnet.find('/');
+    if (slash != std::string::npos) {
+        if (subnet.compare(slash + 1, std::string::npos, "24") != 0) {
+            throw std::invalid_argument("Only /24 subnets can be scanned");
+        }
+        address = subnet.substr(0, slash);
+    }
+
+    in_addr parsed;
+    if (inet_pton(AF_INET, address.c_str(), &parsed) != 1) {
+        throw std::invalid_argument("subnet must be an IPv4 /24, e.g. 192.168.1.0/24");
+    }
+    uint32_t network = ntohl(parsed.s_addr) & 0xFFFFFF00u;
+    if (!isPrivate(network)) {
+        throw std::invalid_argument("subnet must be a private or link-local network");
+    }
+    return network;
+}
+
+std::string randomUuid() {
+    std::random_device device;
+    std::mt19937_64 generator((static_cast<uint64_t>(device()) << 32) | device());
+    uint64_t high = (generator() & ~0xF000ULL) | 0x4000ULL;               // Version 4
+    uint64_t low = (generator() & ~(3ULL << 62)) | (2ULL << 62);          // RFC 4122 variant
+    char text[37];
+    std::snprintf(text, sizeof(text), "%08x-%04x-%04x-%04x-%012llx",
+                  static_cast<unsigned>(high >> 32), static_cast<unsigned>((high >> 16) & 0xFFFF),
+                  static_cast<unsigned>(high & 0xFFFF), static_cast<unsigned>(low >> 48),
+                  static_cast<unsigned long long>(low & 0xFFFFFFFFFFFFULL));
+    return text;
+}
+
+// WS-Discovery Probe for ONVIF video transmitters
+std::string probeMessage(const std::string& message_id) {
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+           "<e:Envelope xmlns:e=\"http://www.w3.org/2003/05/soap-envelope\""
+           " xmlns:w=\"http://schemas.xmlsoap.org/ws/2004/08/addressing\""
+           " xmlns:d=\"http://schemas.xmlsoap.org/ws/2005/04/discovery\""
+           " xmlns:dn=\"http://www.onvif.org/ver10/network/wsdl\">"
+           "<e:Header>"
+           "<w:MessageID>uuid:" + message_id + "</w:MessageID>"
+           "<w:To e:mustUnderstand=\"true\">urn:schemas-xmlsoap-org:ws:2005:04:discovery</w:To>"
+           "<w:Action e:mustUnderstand=\"true\">http://schemas.xmlsoap.org/ws/2005/04/discovery/Probe</w:Action>"
+           "</e:Header>"
+           "<e:Body><d:Probe><d:Types>dn:NetworkVideoTransmitter</d:Types></d:Probe></e:Body>"
+           "</e:Envelope>";
+}
+
+// PTR questions for every service, asking for unicast answers (QU)
+std::vector<uint8_t> mdnsQuery() {
+    std::vector<uint8_t> packet = {0, 0, 0, 0, 0, static_cast<uint8_t>(sizeof(kMdnsServices) / sizeof(kMdnsServices[0])),
+                                   0, 0, 0, 0, 0, 0};
+    for (const char* service : kMdnsServices) {
+        const char* label = service;
+        while (*label) {
+            const char* dot = std::strchr(label, '.');
+            size_t length = dot ? static_cast<size_t>(dot - label) : std::strlen(label);
+            packet.push_back(static_cast<uint8_t>(length));
+            packet.insert(packet.end(), label, label + length);
+            label += length + (dot ? 1 : 0);
+        }
+        packet.insert(packet.end(), {0, 0, 12, 0x80, 1});   // Root, type PTR, QU + class IN
+    }
+    return packet;
+}
+
+// Text of the first element with this local name, whatever its namespace
+// prefix. Enough for the flat fields of a ProbeMatch.
+std::string elementText(const std::string& xml, const std::string& local_name) {
+    for (size_t pos = xml.find(local_name); pos != std::string::npos; pos = xml.find(local_name, pos + 1)) {
+        size_t end = pos + local_name.size();
+        size_t open = xml.rfind('<', pos);
+        if (open == std::string::npos || end >= xml.size() || (xml[end] != '>' && !std::isspace(static_cast<unsigned char>(xml[end])))) {
+            continue;
+        }
+        std::string prefix = xml.substr(open + 1, pos - open - 1);
+        if (!prefix.empty() && (prefix.back() != ':' || prefix.find_first_of(" \t\r\n/>\"") != std::string::npos)) {
+            continue;
+        }
+
+        size_t content = xml.find('>', end);
+        size_t close = content == std::string::npos ? std::string::npos : xml.find('<', content + 1);
+        if (close == std::string::npos) {
+            return "";
+        }
+        size_t first = xml.find_first_not_of(" \t\r\n", content + 1);
+        size_t last = xml.find_last_not_of(" \t\r\n", close - 1);
+        return (first == std::string::npos || first >= close) ? "" : xml.substr(first, last - first + 1);
+    }
+    return "";
+}
+
+std::string percentDecode(const std::string& text) {
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() &&
+            std::isxdigit(static_cast<unsigned char>(text[i + 1])) && std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            decoded += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            decoded += text[i];
+        }
+    }
+    return decoded;
+}
+
+// DNS name at offset as labels, following compression pointers; offset
+// moves past the name as written at its original position
+bool readName(const uint8_t* packet, size_t size, size_t& offset, std::vector<std::string>& labels) {
+    labels.clear();
+    size_t pos = offset;
+    bool jumped = false;
+    for (int jumps = 0; jumps < 32;) {
+        if (pos >= size) {
+            return false;
+        }
+        uint8_t length = packet[pos];
+        if ((length & 0xC0) == 0xC0) {
+            if (pos + 1 >= size) {
+                return false;
+            }
+            if (!jumped) {
+                offset = pos + 2;
+                jumped = true;
+            }
+            pos = (static_cast<size_t>(length & 0x3F) << 8) | packet[pos + 1];
+            ++jumps;
+            continue;
+        }
+        if (length & 0xC0) {
+            return false;
+        }
+        if (length == 0) {
+            if (!jumped) {
+                offset = pos + 1;
+            }
+            return true;
+        }
+        if (pos + 1 + length > size) {
+            return false;
+        }
+        labels.emplace_back(reinterpret_cast<const char*>(packet) + pos + 1, length);
+        pos += 1 + length;
+    }
+    return false;
+}
+
+std::string joinLower(const std::vector<std::string>& labels, size_t first = 0) {
+    std::string name;
+    for (size_t i = first; i < labels.size(); ++i) {
+        if (!name.empty()) {
+            name += '.';
+        }
+        for (char c : labels[i]) {
+            name += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    return name;
+}
+
+int openSocket(int multicast_ttl) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unsigned char ttl = static_cast<unsigned char>(multicast_ttl);
+    sockaddr_in any = endpoint(INADDR_ANY, 0);
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0 ||
+        bind(fd, reinterpret_cast<const sockaddr*>(&any), sizeof(any)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+constexpr std::chrono::milliseconds CameraDiscovery::kUpdateInterval;
+
+CameraDiscovery::CameraDiscovery(const ConfigLoader::CameraDiscoveryConfig& config, UpdateHandler on_update)
+    : config_(config), on_update_(std::move(on_update)) {
+}
+
+CameraDiscovery::~CameraDiscovery() {
+    stop();
+}
+
+bool CameraDiscovery::start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+
+    // mDNS answers are only trusted with a hop limit of 255
+    wsd_fd_ = openSocket(1);
+    mdns_fd_ = openSocket(255);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wsd_fd_ < 0 || mdns_fd_ < 0 || wake_fd_ < 0) {
+        BACKEND_LOG_ERROR("[CameraDiscovery] Cannot open discovery sockets: " << std::strerror(errno));
+        for (int* fd : {&wsd_fd_, &mdns_fd_, &wake_fd_}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    thread_ = std::thread(&CameraDiscovery::run, this);
+    return true;
+}
+
+void CameraDiscovery::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake();
+    thread_.join();
+
+    for (int* fd : {&wsd_fd_, &mdns_fd_, &wake_fd_}) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+bool CameraDiscovery::requestScan(const std::string& subnet, bool force) {
+    std::vector<uint32_t> networks;
+    if (subnet.empty()) {
+        for (uint32_t address : localAddresses()) {
+            uint32_t network = address & 0xFFFFFF00u;
+            if (isPrivate(address) && std::find(networks.begin(), networks.end(), network) == networks.end()) {
+                networks.push_back(network);
+            }
+        }
+        if (networks.empty()) {
+            throw std::runtime_error("No private IPv4 network to scan");
+        }
+    } else {
+        networks.push_back(parseSubnet(subnet));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            throw std::runtime_error("Camera discovery is not running");
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        bool started = false;
+        for (uint32_t network : networks) {
+            bool in_progress = std::any_of(scans_.begin(), scans_.end(),
+                                           [network](const SubnetScan& scan) { return scan.network == network; });
+            auto scanned = scanned_.find(network);
+            if (in_progress || (!force && scanned != scanned_.end() &&
+                                now - scanned->second < std::chrono::seconds(config_.cache_ttl_seconds))) {
+                continue;
+            }
+            if (scans_.size() >= kMaxScans) {
+                throw std::runtime_error("Too many subnets are being scanned; try again later");
+            }
+
+            SubnetScan scan;
+            scan.network = network;
+            scan.tokens = 1.0;
+            scan.refilled = now;
+            scans_.push_back(std::move(scan));
+            started = true;
+            BACKEND_LOG_INFO("[CameraDiscovery] Scanning " << addressString(network) << "/24");
+        }
+        if (!started) {
+            return false;
+        }
+
+        if (!scanning_) {
+            probe_message_ = probeMessage(randomUuid());
+        }
+        multicast_pending_ = true;
+        listen_until_ = now + std::chrono::seconds(config_.listen_seconds);
+        scanning_ = true;
+        dirty_ = true;
+    }
+    wake();
+    return true;
+}
+
+json CameraDiscovery::getCameras() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return toJsonLocked();
+}
+
+void CameraDiscovery::wake() {
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        // Counter already pending; the loop wakes anyway
+    }
+}
+
+void CameraDiscovery::run() {
+    buffer_.resize(65536);
+    pollfd fds[3] = {
+        {wake_fd_, POLLIN, 0},
+        {wsd_fd_, POLLIN, 0},
+        {mdns_fd_, POLLIN, 0}
+    };
+
+    for (;;) {
+        int timeout_ms;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) {
+                return;
+            }
+            // While scanning, wake often enough to keep the probe rate
+            timeout_ms = scanning_ ? std::max(1, 1000 / config_.probe_rate_per_second) : 1000;
+        }
+
+        int ready = poll(fds, 3, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            BACKEND_LOG_EVERY(LOG_ERROR, 60000, "[CameraDiscovery] poll failed: " << std::strerror(errno));
+        } else if (ready > 0) {
+            if (fds[0].revents & POLLIN) {
+                uint64_t count;
+                if (read(wake_fd_, &count, sizeof(count)) < 0) {
+                    // Spurious wakeup
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                receive(wsd_fd_, false);
+            }
+            if (fds[2].revents & POLLIN) {
+                receive(mdns_fd_, true);
+            }
+        }
+
+        json update;
+        bool publish = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = std::chrono::steady_clock::now();
+            tick(now);
+            if (dirty_ && now - last_update_ >= kUpdateInterval) {
+                update = toJsonLocked();
+                dirty_ = false;
+                last_update_ = now;
+                publish = true;
+            }
+        }
+        if (publish && on_update_) {
+            on_update_(update);
+        }
+    }
+}
+
+void CameraDiscovery::tick(std::chrono::steady_clock::time_point now) {
+    if (multicast_pending_) {
+        sendMulticastProbes();
+        multicast_pending_ = false;
+    }
+
+    // Unicast sweep: a token bucket per subnet caps the rate, the in-flight
+    // queue caps the probes awaiting an answer
+    const size_t window = static_cast<size_t>(config_.probe_window);
+    const auto probe_timeout = std::chrono::milliseconds(config_.probe_timeout_ms);
+    for (auto it = scans_.begin(); it != scans_.end();) {
+        SubnetScan& scan = *it;
+        double elapsed = std::chrono::duration<double>(now - scan.refilled).count();
+        scan.tokens = std::min(static_cast<double>(window), scan.tokens + elapsed * config_.probe_rate_per_second);
+        scan.refilled = now;
+
+        while (!scan.in_flight.empty() && scan.in_flight.front().second <= now) {
+            scan.in_flight.pop_front();
+        }
+        while (scan.next_host <= 254 && scan.in_flight.size() < window && scan.tokens >= 1.0) {
+            uint32_t host = scan.network | scan.next_host++;
+            sockaddr_in destination = endpoint(host, kWsDiscoveryPort);
+            sendto(wsd_fd_, probe_message_.data(), probe_message_.size(), MSG_DONTWAIT,
+                   reinterpret_cast<const sockaddr*>(&destination), sizeof(destination));
+            scan.tokens -= 1.0;
+            scan.in_flight.emplace_back(host, now + probe_timeout);
+        }
+
+        if (scan.next_host > 254 && scan.in_flight.empty()) {
+            scanned_[scan.network] = now;
+            it = scans_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    bool scanning = !scans_.empty() || now < listen_until_;
+    if (scanning_ && !scanning) {
+        scanning_ = false;
+        last_scan_ = unixSeconds();
+        dirty_ = true;
+        BACKEND_LOG_INFO("[CameraDiscovery] Scan finished, " << devices_.size() << " camera(s) known");
+    }
+
+    for (auto it = devices_.begin(); it != devices_.end();) {
+        if (it->second.expires <= now) {
+            it = devices_.erase(it);
+            dirty_ = true;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CameraDiscovery::sendMulticastProbes() {
+    static const std::vector<uint8_t> query = mdnsQuery();
+    sockaddr_in wsd_group = endpoint(groupAddress(kWsDiscoveryGroup), kWsDiscoveryPort);
+    sockaddr_in mdns_group = endpoint(groupAddress(kMdnsGroup), kMdnsPort);
+
+    // Once per interface, so every attached network hears them
+    for (uint32_t address : localAddresses()) {
+        if (!isPrivate(address)) {
+            continue;
+        }
+        in_addr interface_address;
+        interface_address.s_addr = htonl(address);
+        setsockopt(wsd_fd_, IPPROTO_IP, IP_MULTICAST_IF, &interface_address, sizeof(interface_address));
+        setsockopt(mdns_fd_, IPPROTO_IP, IP_MULTICAST_IF, &interface_address, sizeof(interface_address));
+        sendto(wsd_fd_, probe_message_.data(), probe_message_.size(), MSG_DONTWAIT,
+               reinterpret_cast<const sockaddr*>(&wsd_group), sizeof(wsd_group));
+        sendto(mdns_fd_, query.data(), query.size(), MSG_DONTWAIT,
+               reinterpret_cast<const sockaddr*>(&mdns_group), sizeof(mdns_group));
+    }
+}
+
+void CameraDiscovery::receive(int fd, bool mdns) {
+    for (;;) {
+        sockaddr_in from;
+        socklen_t from_length = sizeof(from);
+        ssize_t size = recvfrom(fd, buffer_.data(), buffer_.size(), MSG_DONTWAIT,
+                                reinterpret_cast<sockaddr*>(&from), &from_length);
+        if (size < 0) {
+            return;
+        }
+
+        uint32_t address = ntohl(from.sin_addr.s_addr);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (mdns) {
+            handleMdnsAnswer(buffer_.data(), static_cast<size_t>(size), address);
+        } else {
+            handleProbeMatch(std::string(reinterpret_cast<const char*>(buffer_.data()), static_cast<size_t>(size)),
+                             address);
+        }
+    }
+}
+
+void CameraDiscovery::handleProbeMatch(const std::string& message, uint32_t from) {
+    if (message.find("ProbeMatch") == std::string::npos) {
+        return;
+    }
+    std::string xaddrs = elementText(message, "XAddrs");
+    if (xaddrs.empty()) {
+        return;
+    }
+
+    // An answer frees the host's slot in the probe window at once
+    for (auto& scan : scans_) {
+        if (scan.network == (from & 0xFFFFFF00u)) {
+            auto it = std::find_if(scan.in_flight.begin(), scan.in_flight.end(),
+                                   [from](const std::pair<uint32_t, std::chrono::steady_clock::time_point>& probe) {
+                                       return probe.first == from;
+                                   });
+            if (it != scan.in_flight.end()) {
+                scan.in_flight.erase(it);
+            }
+        }
+    }
+
+    Device& device = deviceFor(from);
+    device.onvif = true;
+    device.xaddrs = xaddrs;
+    device.endpoint = elementText(message, "Address");
+
+    // Scopes are space-separated URIs such as onvif://www.onvif.org/name/Gate%20Cam
+    std::string scopes = elementText(message, "Scopes");
+    size_t pos = 0;
+    while (pos < scopes.size()) {
+        size_t end = scopes.find_first_of(" \t\r\n", pos);
+        std::string scope = scopes.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        static const std::string kName = "onvif://www.onvif.org/name/";
+        static const std::string kHardware = "onvif://www.onvif.org/hardware/";
+        if (scope.compare(0, kName.size(), kName) == 0) {
+            device.name = percentDecode(scope.substr(kName.size()));
+        } else if (scope.compare(0, kHardware.size(), kHardware) == 0) {
+            device.hardware = percentDecode(scope.substr(kHardware.size()));
+        }
+        pos = end == std::string::npos ? scopes.size() : end + 1;
+    }
+}
+
+void CameraDiscovery::handleMdnsAnswer(const uint8_t* packet, size_t size, uint32_t from) {
+    if (size < 12 || !(packet[2] & 0x80)) {
+        return;   // Not a response
+    }
+    size_t questions = (static_cast<size_t>(packet[4]) << 8) | packet[5];
+    size_t records = ((static_cast<size_t>(packet[6]) << 8) | packet[7]) +
+                     ((static_cast<size_t>(packet[8]) << 8) | packet[9]) +
+                     ((static_cast<size_t>(packet[10]) << 8) | packet[11]);
+
+    size_t offset = 12;
+    std::vector<std::string> labels;
+    for (size_t i = 0; i < questions; ++i) {
+        if (!readName(packet, size, offset, labels) || offset + 4 > size) {
+            return;
+        }
+        offset += 4;
+    }
+
+    std::string instance_name;         // First label of the service instance
+    std::string rtsp_instance;         // Full instance name of an _rtsp._tcp answer
+    std::map<std::string, uint16_t> ports;
+    for (size_t i = 0; i < records; ++i) {
+        if (!readName(packet, size, offset, labels) || offset + 10 > size) {
+            break;
+        }
+        std::string owner = joinLower(labels);
+        uint16_t type = static_cast<uint16_t>((packet[offset] << 8) | packet[offset + 1]);
+        size_t length = (static_cast<size_t>(packet[offset + 8]) << 8) | packet[offset + 9];
+        size_t rdata = offset + 10;
+        if (rdata + length > size) {
+            break;
+        }
+
+        if (type == 12) {   // PTR: service -> instance
+            for (const char* service : kMdnsServices) {
+                size_t target = rdata;
+                if (owner == service && readName(packet, size, target, labels) && !labels.empty()) {
+                    instance_name = labels[0];
+                    if (owner == kMdnsServices[0]) {
+                        rtsp_instance = joinLower(labels);
+                    }
+                }
+            }
+        } else if (type == 33 && length >= 6) {   // SRV: instance -> port
+            ports[owner] = static_cast<uint16_t>((packet[rdata + 4] << 8) | packet[rdata + 5]);
+        }
+        offset = rdata + length;
+    }
+    if (instance_name.empty()) {
+        return;
+    }
+
+    Device& device = deviceFor(from);
+    device.mdns = true;
+    if (!device.onvif || device.name.empty()) {
+        device.name = instance_name;
+    }
+    auto port = ports.find(rtsp_instance);
+    if (!rtsp_instance.empty() && port != ports.end()) {
+        device.rtsp_url = "rtsp://" + addressString(from) + ":" + std::to_string(port->second) + "/";
+    }
+}
+
+CameraDiscovery::Device& CameraDiscovery::deviceFor(uint32_t address) {
+    int64_t now = unixSeconds();
+    auto inserted = devices_.emplace(addressString(address), Device());
+    Device& device = inserted.first->second;
+    if (inserted.second) {
+        device.first_seen = now;
+        BACKEND_LOG_INFO("[CameraDiscovery] Found " << inserted.first->first);
+    }
+    device.last_seen = now;
+    device.expires = std::chrono::steady_clock::now() + std::chrono::seconds(config_.cache_ttl_seconds);
+    dirty_ = true;
+    return device;
+}
+
+json CameraDiscovery::toJsonLocked() const {
+    json devices = json::object();
+    for (const auto& entry : devices_) {
+        const Device& device = entry.second;
+        devices[entry.first] = {
+            {"address", entry.first},
+            {"name", device.name},
+            {"hardware", device.hardware},
+            {"xaddrs", device.xaddrs},
+            {"endpoint", device.endpoint},
+            {"rtsp_url", device.rtsp_url},
+            {"onvif", device.onvif},
+            {"mdns", device.mdns},
+            {"first_seen", device.first_seen},
+            {"last_seen", device.last_seen}
+        };
+    }
+
+    json subnets = json::array();
+    for (const auto& scan : scans_) {
+        subnets.push_back(addressString(scan.network) + "/24");
+    }
+
+    return {
+        {"scanning", scanning_},
+        {"last_scan", last_scan_},
+        {"subnets", std::move(subnets)},
+        {"devices", std::move(devices)}
+    };
+}
+
+} // namespace BackendDatalink
@@ -0,0 +1,102 @@
+#include "collector_governor.h"
+#include "backend_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+
+namespace BackendDatalink {
+
+namespace {
+
+// PSI "some avg10" of the CPU, in percent; negative without PSI
+double cpuPressure() {
+    FILE* file = std::fopen("/proc/pressure/cpu", "re");
+    if (!file) {
+        return -1.0;
+    }
+    double avg10 = -1.0;
+    if (std::fscanf(file, "some avg10=%lf", &avg10) != 1) {
+        avg10 = -1.0;
+    }
+    std::fclose(file);
+    return avg10;
+}
+
+} // namespace
+
+CollectorGovernor::CollectorGovernor(DemandSource demand)
+    : demand_(std::move(demand)) {
+}
+
+void CollectorGovernor::addCollector(const std::string& name, std::vector<DashboardCategory> categories, Pace pace) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    collectors_.push_back(Collector{name, std::move(categories), std::move(pace), 1});
+}
+
+void CollectorGovernor::setSettings(const Settings& settings) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    settings_ = settings;
+}
+
+void CollectorGovernor::noteRequest(DashboardCategory category, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_request_[categoryIndex(category)] = now;
+}
+
+bool CollectorGovernor::isUnderLoad() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return under_load_;
+}
+
+void CollectorGovernor::evaluate(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int load_factor = loaded() ? std::max(1, settings_.loadSlowdown) : 1;
+
+    for (auto& collector : collectors_) {
+        bool wanted = false;
+        for (DashboardCategory category : collector.categories) {
+            const auto& requested = last_request_[categoryIndex(category)];
+            if ((requested != Clock::time_point() && now - requested < settings_.demandHold) ||
+                (demand_ && demand_(categoryName(category)) > 0)) {
+                wanted = true;
+                break;
+            }
+        }
+        int slowdown = (wanted ? 1 : std::max(1, settings_.idleSlowdown)) * load_factor;
+        if (slowdown != collector.slowdown) {
+            BACKEND_LOG_INFO("[CollectorGovernor] " << collector.name << " at 1/" << slowdown << " rate ("
+                             << (wanted ? "in demand" : "idle") << (load_factor > 1 ? ", under load)" : ")"));
+            collector.slowdown = slowdown;
+            collector.pace(slowdown);
+        }
+    }
+}
+
+// Caller holds mutex_. Backs off over either limit and recovers under 80%
+// of both, so a load hovering at the limit does not flip the rates.
+bool CollectorGovernor::loaded() {
+    double limit_scale = under_load_ ? 0.8 : 1.0;
+    bool over = false;
+
+    if (settings_.loadPerCpu > 0) {
+        double load[1];
+        unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        if (getloadavg(load, 1) == 1 && load[0] / cpus > settings_.loadPerCpu * limit_scale) {
+            over = true;
+        }
+    }
+    if (!over && settings_.cpuPressurePercent > 0) {
+        over = cpuPressure() > settings_.cpuPressurePercent * limit_scale;
+    }
+
+    if (over != under_load_) {
+        BACKEND_LOG_INFO("[CollectorGovernor] " << (over ? "System under load, collectors back off"
+                                                         : "System load back to normal"));
+        under_load_ = over;
+    }
+    return under_load_;
+}
+
+} // namespace BackendDatalink
@@ -1,6 +1,11 @@
 #include "config_loader.h"
+#include "dashboard_categories.h"
+#include "ThreadManager.hpp"
 #include <fstream>
 #include <iostream>
+#include <cctype>
+#include <algorithm>
+#include <iterator>
 
 void ConfigLoader::loadFromFile(const std::string& config_path) {
     std::ifstream file(config_path);
@@ -27,9 +32,81 @@ void ConfigLoader::loadFromFile(const std::string& config_path) {
         parseSystemDataConfig(config["system_data"]);
     }
     
+    if (config.contains("metrics_history")) {
+        parseMetricsHistoryConfig(config["metrics_history"]);
+    }
+    
+    if (config.contains("telemetry")) {
+        parseTelemetryConfig(config["telemetry"]);
+    }
+    
+    if (config.contains("rpc")) {
+        parseRpcConfig(config["rpc"]);
+    }
+    
+    if (config.contains("threads")) {
+        parseThreadsConfig(config["threads"]);
+    }
+    
+    if (config.contains("metrics")) {
+        parseMetricsConfig(config["metrics"]);
+    }
+    
+    if (config.contains("trace")) {
+        parseTraceConfig(config["trace"]);
+    }
+    
+    if (config.contains("diagnostics")) {
+        parseDiagnosticsConfig(config["diagnostics"]);
+    }
+    
+    if (config.contains("camera_discovery")) {
+        parseCameraDiscoveryConfig(config["camera_discovery"]);
+    }
+    
+    if (config.contains("mavlink")) {
+        parseMavlinkConfig(config["mavlink"]);
+    }
+    
+    if (config.contains("wireless_scan")) {
+        parseWirelessScanConfig(config["wireless_scan"]);
+    }
+    
+    if (config.contains("network_priority")) {
+        parseNetworkPriorityConfig(config["network_priority"]);
+    }
+    
+    if (config.contains("vpn_monitor")) {
+        parseVpnMonitorConfig(config["vpn_monitor"]);
+    }
+    
+    if (config.contains("log_tail")) {
+        parseLogTailConfig(config["log_tail"]);
+    }
+    
+    if (config.contains("fleet")) {
+        parseFleetConfig(config["fleet"]);
+    }
+    
+    if (config.contains("memory_budget")) {
+        parseMemoryBudgetConfig(config["memory_budget"]);
+    }
+    
+    if (config.contains("logging")) {
+        parseLoggingConfig(config["logging"]);
+    }
+    
     validateConfig();
 }
 
+std::shared_ptr<const ConfigLoader> ConfigStore::reload() {
+    auto next = std::make_shared<ConfigLoader>();
+    next->loadFromFile(config_path_);
+    std::shared_ptr<const ConfigLoader> snapshot = std::move(next);
+    std::atomic_store(&current_, snapshot);
+    return snapshot;
+}
+
 void ConfigLoader::parseDatabaseConfig(const json& db_config) {
     if (db_config.contains("path")) {
         if (!db_config["path"].is_string()) {
@@ -58,6 +135,116 @@ void ConfigLoader::parseDatabaseConfig(const json& db_config) {
         }
         db_config_.log_messages = db_config["log_messages"];
     }
+    
+    if (db_config.contains("self_test_on_startup")) {
+        if (!db_config["self_test_on_startup"].is_boolean()) {
+            throw ConfigException("database.self_test_on_startup must be a boolean");
+        }
+        db_config_.self_test_on_startup = db_config["self_test_on_startup"];
+    }
+    
+    if (db_config.contains("journal_mode")) {
+        db_config_.journal_mode = parseChoice(db_config, "journal_mode", "database.journal_mode",
+                                              {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"});
+    }
+    
+    if (db_config.contains("synchronous")) {
+        db_config_.synchronous = parseChoice(db_config, "synchronous", "database.synchronous",
+                                             {"OFF", "NORMAL", "FULL", "EXTRA"});
+    }
+    
+    if (db_config.contains("temp_store")) {
+        db_config_.temp_store = parseChoice(db_config, "temp_store", "database.temp_store",
+                                            {"DEFAULT", "FILE", "MEMORY"});
+    }
+    
+    if (db_config.contains("cache_size_kb")) {
+        if (!db_config["cache_size_kb"].is_number_integer() || db_config["cache_size_kb"] < 0) {
+            throw ConfigException("database.cache_size_kb must be a non-negative integer");
+        }
+        db_config_.cache_size_kb = db_config["cache_size_kb"];
+    }
+    
+    if (db_config.contains("mmap_size_bytes")) {
+        if (!db_config["mmap_size_bytes"].is_number_integer() || db_config["mmap_size_bytes"] < 0) {
+            throw ConfigException("database.mmap_size_bytes must be a non-negative integer");
+        }
+        db_config_.mmap_size_bytes = db_config["mmap_size_bytes"];
+    }
+    
+    if (db_config.contains("busy_timeout_ms")) {
+        if (!db_config["busy_timeout_ms"].is_number_integer() || db_config["busy_timeout_ms"] < 0) {
+            throw ConfigException("database.busy_timeout_ms must be a non-negative integer");
+        }
+        db_config_.busy_timeout_ms = db_config["busy_timeout_ms"];
+    }
+    
+    if (db_config.contains("reader_pool_size")) {
+        if (!db_config["reader_pool_size"].is_number_integer()) {
+            throw ConfigException("database.reader_pool_size must be an integer");
+        }
+        db_config_.reader_pool_size = db_config["reader_pool_size"];
+    }
+    
+    if (db_config.contains("log_queue_capacity")) {
+        if (!db_config["log_queue_capacity"].is_number_integer()) {
+            throw ConfigException("database.log_queue_capacity must be an integer");
+        }
+        db_config_.log_queue_capacity = db_config["log_queue_capacity"];
+    }
+    
+    if (db_config.contains("maintenance_interval_seconds")) {
+        if (!db_config["maintenance_interval_seconds"].is_number_integer()) {
+            throw ConfigException("database.maintenance_interval_seconds must be an integer");
+        }
+        db_config_.maintenance_interval_seconds = db_config["maintenance_interval_seconds"];
+    }
+    
+    if (db_config.contains("log_retention_days")) {
+        if (!db_config["log_retention_days"].is_number_integer()) {
+            throw ConfigException("database.log_retention_days must be an integer");
+        }
+        db_config_.log_retention_days = db_config["log_retention_days"];
+    }
+    
+    if (db_config.contains("max_connection_rows")) {
+        if (!db_config["max_connection_rows"].is_number_integer()) {
+            throw ConfigException("database.max_connection_rows must be an integer");
+        }
+        db_config_.max_connection_rows = db_config["max_connection_rows"];
+    }
+    
+    if (db_config.contains("max_message_rows")) {
+        if (!db_config["max_message_rows"].is_number_integer()) {
+            throw ConfigException("database.max_message_rows must be an integer");
+        }
+        db_config_.max_message_rows = db_config["max_message_rows"];
+    }
+}
+
+std::string ConfigLoader::parseChoice(const json& config, const std::string& key, const std::string& path,
+                                      const std::vector<std::string>& choices) {
+    std::string list;
+    for (const auto& choice : choices) {
+        list += (list.empty() ? "" : ", ") + choice;
+    }
+    
+    if (!config[key].is_string()) {
+        throw ConfigException(path + " must be one of: " + list);
+    }
+    
+    std::string value = config[key];
+    for (auto& c : value) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    
+    for (const auto& choice : choices) {
+        if (value == choice) {
+            return value;
+        }
+    }
+    
+    throw ConfigException(path + " must be one of: " + list);
 }
 
 void ConfigLoader::parseSystemDataConfig(const json& system_config) {
@@ -84,6 +271,14 @@ void ConfigLoader::parseSystemDataConfig(const json& system_config) {
         system_data_config_.database_update_interval_seconds = system_config["database_update_interval_seconds"];
     }
     
+    if (system_config.contains("broadcast_min_interval_ms")) {
+        if (!system_config["broadcast_min_interval_ms"].is_number_integer() ||
+            system_config["broadcast_min_interval_ms"] < 0) {
+            throw ConfigException("system_data.broadcast_min_interval_ms must be a non-negative integer");
+        }
+        system_data_config_.broadcast_min_interval_ms = system_config["broadcast_min_interval_ms"];
+    }
+    
     if (system_config.contains("log_collection_progress")) {
         if (!system_config["log_collection_progress"].is_boolean()) {
             throw ConfigException("system_data.log_collection_progress must be a boolean");
@@ -113,6 +308,705 @@ void ConfigLoader::parseSystemDataConfig(const json& system_config) {
         }
         system_data_config_.database_update_log_interval = system_config["database_update_log_interval"];
     }
+    
+    if (system_config.contains("collector_intervals_ms")) {
+        if (!system_config["collector_intervals_ms"].is_object()) {
+            throw ConfigException("system_data.collector_intervals_ms must be an object");
+        }
+        for (const auto& item : system_config["collector_intervals_ms"].items()) {
+            if (!item.value().is_number_integer() || item.value() < 100) {
+                throw ConfigException("system_data.collector_intervals_ms." + item.key() +
+                                      " must be an integer of at least 100");
+            }
+            system_data_config_.collector_intervals_ms[item.key()] = item.value();
+        }
+    }
+    
+    if (system_config.contains("latency_targets")) {
+        if (!system_config["latency_targets"].is_array()) {
+            throw ConfigException("system_data.latency_targets must be an array");
+        }
+        system_data_config_.latency_targets.clear();
+        for (const auto& target : system_config["latency_targets"]) {
+            if (!target.is_string()) {
+                throw ConfigException("system_data.latency_targets entries must be \"host:port\" strings");
+            }
+            system_data_config_.latency_targets.push_back(target);
+        }
+    }
+    
+    if (system_config.contains("external_ip_endpoints")) {
+        if (!system_config["external_ip_endpoints"].is_array()) {
+            throw ConfigException("system_data.external_ip_endpoints must be an array");
+        }
+        system_data_config_.external_ip_endpoints.clear();
+        for (const auto& endpoint : system_config["external_ip_endpoints"]) {
+            if (!endpoint.is_string()) {
+                throw ConfigException("system_data.external_ip_endpoints entries must be URL strings");
+            }
+            system_data_config_.external_ip_endpoints.push_back(endpoint);
+        }
+    }
+    
+    if (system_config.contains("modem_device")) {
+        if (!system_config["modem_device"].is_string()) {
+            throw ConfigException("system_data.modem_device must be a string");
+        }
+        system_data_config_.modem_device = system_config["modem_device"];
+    }
+    
+    if (system_config.contains("modem_data_interface")) {
+        if (!system_config["modem_data_interface"].is_string()) {
+            throw ConfigException("system_data.modem_data_interface must be a string");
+        }
+        system_data_config_.modem_data_interface = system_config["modem_data_interface"];
+    }
+    
+    if (system_config.contains("process_top_count")) {
+        if (!system_config["process_top_count"].is_number_integer() || system_config["process_top_count"] < 0) {
+            throw ConfigException("system_data.process_top_count must be a non-negative integer");
+        }
+        system_data_config_.process_top_count = system_config["process_top_count"];
+    }
+    
+    if (system_config.contains("watched_processes")) {
+        if (!system_config["watched_processes"].is_array()) {
+            throw ConfigException("system_data.watched_processes must be an array");
+        }
+        system_data_config_.watched_processes.clear();
+        for (const auto& name : system_config["watched_processes"]) {
+            if (!name.is_string()) {
+                throw ConfigException("system_data.watched_processes entries must be process names");
+            }
+            system_data_config_.watched_processes.push_back(name);
+        }
+    }
+    
+    if (system_config.contains("storage_mounts")) {
+        if (!system_config["storage_mounts"].is_array()) {
+            throw ConfigException("system_data.storage_mounts must be an array");
+        }
+        system_data_config_.storage_mounts.clear();
+        for (const auto& path : system_config["storage_mounts"]) {
+            if (!path.is_string() || path.get<std::string>().empty() || path.get<std::string>()[0] != '/') {
+                throw ConfigException("system_data.storage_mounts entries must be absolute paths");
+            }
+            system_data_config_.storage_mounts.push_back(path);
+        }
+    }
+    
+    if (system_config.contains("shared_memory_name")) {
+        if (!system_config["shared_memory_name"].is_string()) {
+            throw ConfigException("system_data.shared_memory_name must be a string");
+        }
+        std::string name = system_config["shared_memory_name"];
+        if (!name.empty() && (name[0] != '/' || name.find('/', 1) != std::string::npos)) {
+            throw ConfigException("system_data.shared_memory_name must be empty or \"/name\" without further slashes");
+        }
+        system_data_config_.shared_memory_name = name;
+    }
+    
+    if (system_config.contains("latency_timeout_ms")) {
+        if (!system_config["latency_timeout_ms"].is_number_integer()) {
+            throw ConfigException("system_data.latency_timeout_ms must be an integer");
+        }
+        system_data_config_.latency_timeout_ms = system_config["latency_timeout_ms"];
+    }
+    
+    if (system_config.contains("latency_window")) {
+        if (!system_config["latency_window"].is_number_integer()) {
+            throw ConfigException("system_data.latency_window must be an integer");
+        }
+        system_data_config_.latency_window = system_config["latency_window"];
+    }
+    
+    if (system_config.contains("idle_slowdown")) {
+        if (!system_config["idle_slowdown"].is_number_integer()) {
+            throw ConfigException("system_data.idle_slowdown must be an integer");
+        }
+        system_data_config_.idle_slowdown = system_config["idle_slowdown"];
+    }
+    
+    if (system_config.contains("load_slowdown")) {
+        if (!system_config["load_slowdown"].is_number_integer()) {
+            throw ConfigException("system_data.load_slowdown must be an integer");
+        }
+        system_data_config_.load_slowdown = system_config["load_slowdown"];
+    }
+    
+    if (system_config.contains("load_backoff_per_cpu")) {
+        if (!system_config["load_backoff_per_cpu"].is_number() || system_config["load_backoff_per_cpu"] < 0) {
+            throw ConfigException("system_data.load_backoff_per_cpu must be a non-negative number");
+        }
+        system_data_config_.load_backoff_per_cpu = system_config["load_backoff_per_cpu"];
+    }
+    
+    if (system_config.contains("cpu_pressure_backoff_percent")) {
+        if (!system_config["cpu_pressure_backoff_percent"].is_number() ||
+            system_config["cpu_pressure_backoff_percent"] < 0) {
+            throw ConfigException("system_data.cpu_pressure_backoff_percent must be a non-negative number");
+        }
+        system_data_config_.cpu_pressure_backoff_percent = system_config["cpu_pressure_backoff_percent"];
+    }
+}
+
+void ConfigLoader::parseMetricsHistoryConfig(const json& history_config) {
+    if (history_config.contains("enabled")) {
+        if (!history_config["enabled"].is_boolean()) {
+            throw ConfigException("metrics_history.enabled must be a boolean");
+        }
+        metrics_history_config_.enabled = history_config["enabled"];
+    }
+    
+    if (history_config.contains("ring_capacity")) {
+        if (!history_config["ring_capacity"].is_number_integer() || 
+            history_config["ring_capacity"] < 1) {
+            throw ConfigException("metrics_history.ring_capacity must be a positive integer");
+        }
+        metrics_history_config_.ring_capacity = history_config["ring_capacity"];
+    }
+    
+    if (history_config.contains("flush_interval_seconds")) {
+        if (!history_config["flush_interval_seconds"].is_number_integer() || 
+            history_config["flush_interval_seconds"] < 1) {
+            throw ConfigException("metrics_history.flush_interval_seconds must be a positive integer");
+        }
+        metrics_history_config_.flush_interval_seconds = history_config["flush_interval_seconds"];
+    }
+    
+    if (history_config.contains("raw_retention_seconds")) {
+        if (!history_config["raw_retention_seconds"].is_number_integer() || 
+            history_config["raw_retention_seconds"] < 1) {
+            throw ConfigException("metrics_history.raw_retention_seconds must be a positive integer");
+        }
+        metrics_history_config_.raw_retention_seconds = history_config["raw_retention_seconds"];
+    }
+    
+    if (history_config.contains("minute_retention_seconds")) {
+        if (!history_config["minute_retention_seconds"].is_number_integer() || 
+            history_config["minute_retention_seconds"] < 1) {
+            throw ConfigException("metrics_history.minute_retention_seconds must be a positive integer");
+        }
+        metrics_history_config_.minute_retention_seconds = history_config["minute_retention_seconds"];
+    }
+    
+    if (history_config.contains("hour_retention_seconds")) {
+        if (!history_config["hour_retention_seconds"].is_number_integer() || 
+            history_config["hour_retention_seconds"] < 1) {
+            throw ConfigException("metrics_history.hour_retention_seconds must be a positive integer");
+        }
+        metrics_history_config_.hour_retention_seconds = history_config["hour_retention_seconds"];
+    }
+}
+
+void ConfigLoader::parseTelemetryConfig(const json& telemetry_config) {
+    if (telemetry_config.contains("enabled")) {
+        if (!telemetry_config["enabled"].is_boolean()) {
+            throw ConfigException("telemetry.enabled must be a boolean");
+        }
+        telemetry_config_.enabled = telemetry_config["enabled"];
+    }
+    
+    if (telemetry_config.contains("window_seconds")) {
+        if (!telemetry_config["window_seconds"].is_number_integer()) {
+            throw ConfigException("telemetry.window_seconds must be an integer");
+        }
+        telemetry_config_.window_seconds = telemetry_config["window_seconds"];
+    }
+    
+    if (telemetry_config.contains("sample_interval_ms")) {
+        if (!telemetry_config["sample_interval_ms"].is_number_integer()) {
+            throw ConfigException("telemetry.sample_interval_ms must be an integer");
+        }
+        telemetry_config_.sample_interval_ms = telemetry_config["sample_interval_ms"];
+    }
+    
+    if (telemetry_config.contains("full_report_windows")) {
+        if (!telemetry_config["full_report_windows"].is_number_integer()) {
+            throw ConfigException("telemetry.full_report_windows must be an integer");
+        }
+        telemetry_config_.full_report_windows = telemetry_config["full_report_windows"];
+    }
+    
+    if (telemetry_config.contains("method")) {
+        if (!telemetry_config["method"].is_string() || telemetry_config["method"].get<std::string>().empty()) {
+            throw ConfigException("telemetry.method must be a non-empty string");
+        }
+        telemetry_config_.method = telemetry_config["method"];
+    }
+    
+    if (telemetry_config.contains("service")) {
+        if (!telemetry_config["service"].is_string() || telemetry_config["service"].get<std::string>().empty()) {
+            throw ConfigException("telemetry.service must be a non-empty string");
+        }
+        telemetry_config_.service = telemetry_config["service"];
+    }
+    
+    if (telemetry_config.contains("deadbands")) {
+        const json& deadbands = telemetry_config["deadbands"];
+        if (!deadbands.is_object()) {
+            throw ConfigException("telemetry.deadbands must be an object");
+        }
+        for (auto it = deadbands.begin(); it != deadbands.end(); ++it) {
+            if (telemetry_config_.deadbands.find(it.key()) == telemetry_config_.deadbands.end()) {
+                throw ConfigException("telemetry.deadbands has unknown field: " + it.key());
+            }
+            if (!it.value().is_number() || it.value().get<double>() < 0.0) {
+                throw ConfigException("telemetry.deadbands." + it.key() + " must be a non-negative number");
+            }
+            telemetry_config_.deadbands[it.key()] = it.value().get<double>();
+        }
+    }
+}
+
+void ConfigLoader::parseRpcConfig(const json& rpc_config) {
+    if (rpc_config.contains("worker_threads")) {
+        if (!rpc_config["worker_threads"].is_number_integer()) {
+            throw ConfigException("rpc.worker_threads must be an integer");
+        }
+        rpc_config_.worker_threads = rpc_config["worker_threads"];
+    }
+    
+    if (rpc_config.contains("queue_capacity")) {
+        if (!rpc_config["queue_capacity"].is_number_integer()) {
+            throw ConfigException("rpc.queue_capacity must be an integer");
+        }
+        rpc_config_.queue_capacity = rpc_config["queue_capacity"];
+    }
+    
+    if (rpc_config.contains("outbound_queue_capacity")) {
+        if (!rpc_config["outbound_queue_capacity"].is_number_integer()) {
+            throw ConfigException("rpc.outbound_queue_capacity must be an integer");
+        }
+        rpc_config_.outbound_queue_capacity = rpc_config["outbound_queue_capacity"];
+    }
+    
+    if (rpc_config.contains("log_queue_capacity")) {
+        if (!rpc_config["log_queue_capacity"].is_number_integer()) {
+            throw ConfigException("rpc.log_queue_capacity must be an integer");
+        }
+        rpc_config_.log_queue_capacity = rpc_config["log_queue_capacity"];
+    }
+    
+    if (rpc_config.contains("log_flush_interval_ms")) {
+        if (!rpc_config["log_flush_interval_ms"].is_number_integer()) {
+            throw ConfigException("rpc.log_flush_interval_ms must be an integer");
+        }
+        rpc_config_.log_flush_interval_ms = rpc_config["log_flush_interval_ms"];
+    }
+    
+    if (rpc_config.contains("replay_cache_size")) {
+        if (!rpc_config["replay_cache_size"].is_number_integer()) {
+            throw ConfigException("rpc.replay_cache_size must be an integer");
+        }
+        rpc_config_.replay_cache_size = rpc_config["replay_cache_size"];
+    }
+    
+    if (rpc_config.contains("replay_ttl_seconds")) {
+        if (!rpc_config["replay_ttl_seconds"].is_number_integer()) {
+            throw ConfigException("rpc.replay_ttl_seconds must be an integer");
+        }
+        rpc_config_.replay_ttl_seconds = rpc_config["replay_ttl_seconds"];
+    }
+    
+    if (rpc_config.contains("response_chunk_bytes")) {
+        if (!rpc_config["response_chunk_bytes"].is_number_integer()) {
+            throw ConfigException("rpc.response_chunk_bytes must be an integer");
+        }
+        rpc_config_.response_chunk_bytes = rpc_config["response_chunk_bytes"];
+    }
+    
+    if (rpc_config.contains("response_chunk_window")) {
+        if (!rpc_config["response_chunk_window"].is_number_integer()) {
+            throw ConfigException("rpc.response_chunk_window must be an integer");
+        }
+        rpc_config_.response_chunk_window = rpc_config["response_chunk_window"];
+    }
+}
+
+void ConfigLoader::parseMetricsConfig(const json& metrics_config) {
+    if (metrics_config.contains("enabled")) {
+        if (!metrics_config["enabled"].is_boolean()) {
+            throw ConfigException("metrics.enabled must be a boolean");
+        }
+        metrics_config_.enabled = metrics_config["enabled"];
+    }
+    
+    if (metrics_config.contains("host")) {
+        if (!metrics_config["host"].is_string()) {
+            throw ConfigException("metrics.host must be a string");
+        }
+        metrics_config_.host = metrics_config["host"];
+    }
+    
+    if (metrics_config.contains("port")) {
+        if (!metrics_config["port"].is_number_integer()) {
+            throw ConfigException("metrics.port must be an integer");
+        }
+        metrics_config_.port = metrics_config["port"];
+    }
+}
+
+void ConfigLoader::parseTraceConfig(const json& trace_config) {
+    if (trace_config.contains("enabled")) {
+        if (!trace_config["enabled"].is_boolean()) {
+            throw ConfigException("trace.enabled must be a boolean");
+        }
+        trace_config_.enabled = trace_config["enabled"];
+    }
+    
+    if (trace_config.contains("buffer_events")) {
+        if (!trace_config["buffer_events"].is_number_integer()) {
+            throw ConfigException("trace.buffer_events must be an integer");
+        }
+        trace_config_.buffer_events = trace_config["buffer_events"];
+    }
+}
+
+void ConfigLoader::parseDiagnosticsConfig(const json& diagnostics_config) {
+    if (diagnostics_config.contains("enabled")) {
+        if (!diagnostics_config["enabled"].is_boolean()) {
+            throw ConfigException("diagnostics.enabled must be a boolean");
+        }
+        diagnostics_config_.enabled = diagnostics_config["enabled"];
+    }
+    
+    if (diagnostics_config.contains("max_concurrent_jobs")) {
+        if (!diagnostics_config["max_concurrent_jobs"].is_number_integer()) {
+            throw ConfigException("diagnostics.max_concurrent_jobs must be an integer");
+        }
+        diagnostics_config_.max_concurrent_jobs = diagnostics_config["max_concurrent_jobs"];
+    }
+    
+    if (diagnostics_config.contains("max_duration_seconds")) {
+        if (!diagnostics_config["max_duration_seconds"].is_number_integer()) {
+            throw ConfigException("diagnostics.max_duration_seconds must be an integer");
+        }
+        diagnostics_config_.max_duration_seconds = diagnostics_config["max_duration_seconds"];
+    }
+}
+
+void ConfigLoader::parseCameraDiscoveryConfig(const json& discovery_config) {
+    if (discovery_config.contains("enabled")) {
+        if (!discovery_config["enabled"].is_boolean()) {
+            throw ConfigException("camera_discovery.enabled must be a boolean");
+        }
+        camera_discovery_config_.enabled = discovery_config["enabled"];
+    }
+    
+    const std::pair<const char*, int*> numbers[] = {
+        {"probe_window", &camera_discovery_config_.probe_window},
+        {"probe_rate_per_second", &camera_discovery_config_.probe_rate_per_second},
+        {"probe_timeout_ms", &camera_discovery_config_.probe_timeout_ms},
+        {"listen_seconds", &camera_discovery_config_.listen_seconds},
+        {"cache_ttl_seconds", &camera_discovery_config_.cache_ttl_seconds},
+    };
+    for (const auto& number : numbers) {
+        if (!discovery_config.contains(number.first)) {
+            continue;
+        }
+        if (!discovery_config[number.first].is_number_integer()) {
+            throw ConfigException(std::string("camera_discovery.") + number.first + " must be an integer");
+        }
+        *number.second = discovery_config[number.first];
+    }
+}
+
+void ConfigLoader::parseMavlinkConfig(const json& mavlink_config) {
+    if (mavlink_config.contains("enabled")) {
+        if (!mavlink_config["enabled"].is_boolean()) {
+            throw ConfigException("mavlink.enabled must be a boolean");
+        }
+        mavlink_config_.enabled = mavlink_config["enabled"];
+    }
+    
+    if (mavlink_config.contains("serial_device")) {
+        if (!mavlink_config["serial_device"].is_string()) {
+            throw ConfigException("mavlink.serial_device must be a string");
+        }
+        mavlink_config_.serial_device = mavlink_config["serial_device"];
+    }
+    
+    const std::pair<const char*, int*> numbers[] = {
+        {"udp_port", &mavlink_config_.udp_port},
+        {"baud", &mavlink_config_.baud},
+        {"ring_size", &mavlink_config_.ring_size},
+        {"max_rate_hz", &mavlink_config_.max_rate_hz},
+    };
+    for (const auto& number : numbers) {
+        if (!mavlink_config.contains(number.first)) {
+            continue;
+        }
+        if (!mavlink_config[number.first].is_number_integer()) {
+            throw ConfigException(std::string("mavlink.") + number.first + " must be an integer");
+        }
+        *number.second = mavlink_config[number.first];
+    }
+}
+
+void ConfigLoader::parseWirelessScanConfig(const json& scan_config) {
+    if (scan_config.contains("enabled")) {
+        if (!scan_config["enabled"].is_boolean()) {
+            throw ConfigException("wireless_scan.enabled must be a boolean");
+        }
+        wireless_scan_config_.enabled = scan_config["enabled"];
+    }
+    
+    if (scan_config.contains("interface")) {
+        if (!scan_config["interface"].is_string()) {
+            throw ConfigException("wireless_scan.interface must be a string");
+        }
+        wireless_scan_config_.interface = scan_config["interface"];
+    }
+    
+    const std::pair<const char*, int*> numbers[] = {
+        {"cache_ttl_seconds", &wireless_scan_config_.cache_ttl_seconds},
+        {"scan_timeout_seconds", &wireless_scan_config_.scan_timeout_seconds},
+    };
+    for (const auto& number : numbers) {
+        if (!scan_config.contains(number.first)) {
+            continue;
+        }
+        if (!scan_config[number.first].is_number_integer()) {
+            throw ConfigException(std::string("wireless_scan.") + number.first + " must be an integer");
+        }
+        *number.second = scan_config[number.first];
+    }
+}
+
+void ConfigLoader::parseNetworkPriorityConfig(const json& priority_config) {
+    if (priority_config.contains("failover_enabled")) {
+        if (!priority_config["failover_enabled"].is_boolean()) {
+            throw ConfigException("network_priority.failover_enabled must be a boolean");
+        }
+        network_priority_config_.failover_enabled = priority_config["failover_enabled"];
+    }
+    
+    if (priority_config.contains("reachability_targets")) {
+        if (!priority_config["reachability_targets"].is_array()) {
+            throw ConfigException("network_priority.reachability_targets must be an array");
+        }
+        network_priority_config_.reachability_targets.clear();
+        for (const auto& target : priority_config["reachability_targets"]) {
+            if (!target.is_string() || target.get<std::string>().find(':') == std::string::npos) {
+                throw ConfigException("network_priority.reachability_targets entries must be \"address:port\"");
+            }
+            network_priority_config_.reachability_targets.push_back(target);
+        }
+    }
+    
+    const std::pair<const char*, int*> numbers[] = {
+        {"reachability_interval_ms", &network_priority_config_.reachability_interval_ms},
+        {"reachability_timeout_ms", &network_priority_config_.reachability_timeout_ms},
+        {"reachability_down_after", &network_priority_config_.reachability_down_after},
+        {"reachability_up_after", &network_priority_config_.reachability_up_after},
+        {"failover_restore_hold_ms", &network_priority_config_.failover_restore_hold_ms},
+        {"failover_max_latency_ms", &network_priority_config_.failover_max_latency_ms},
+    };
+    for (const auto& number : numbers) {
+        if (!priority_config.contains(number.first)) {
+            continue;
+        }
+        if (!priority_config[number.first].is_number_integer()) {
+            throw ConfigException(std::string("network_priority.") + number.first + " must be an integer");
+        }
+        *number.second = priority_config[number.first];
+    }
+}
+
+void ConfigLoader::parseVpnMonitorConfig(const json& vpn_config) {
+    if (vpn_config.contains("enabled")) {
+        if (!vpn_config["enabled"].is_boolean()) {
+            throw ConfigException("vpn_monitor.enabled must be a boolean");
+        }
+        vpn_monitor_config_.enabled = vpn_config["enabled"];
+    }
+    
+    if (vpn_config.contains("openvpn_management")) {
+        if (!vpn_config["openvpn_management"].is_array()) {
+            throw ConfigException("vpn_monitor.openvpn_management must be an array");
+        }
+        vpn_monitor_config_.openvpn_management.clear();
+        for (const auto& endpoint : vpn_config["openvpn_management"]) {
+            if (!endpoint.is_string() || endpoint.get<std::string>().empty()) {
+                throw ConfigException("vpn_monitor.openvpn_management entries must be socket paths or \"host:port\"");
+            }
+            vpn_monitor_config_.openvpn_management.push_back(endpoint);
+        }
+    }
+    
+    const std::pair<const char*, int*> numbers[] = {
+        {"bytecount_interval_seconds", &vpn_monitor_config_.bytecount_interval_seconds},
+        {"wireguard_refresh_ms", &vpn_monitor_config_.wireguard_refresh_ms},
+    };
+    for (const auto& number : numbers) {
+        if (!vpn_config.contains(number.first)) {
+            continue;
+        }
+        if (!vpn_config[number.first].is_number_integer()) {
+            throw ConfigException(std::string("vpn_monitor.") + number.first + " must be an integer");
+        }
+        *number.second = vpn_config[number.first];
+    }
+}
+
+void ConfigLoader::parseLogTailConfig(const json& tail_config) {
+    if (tail_config.contains("enabled")) {
+        if (!tail_config["enabled"].is_boolean()) {
+            throw ConfigException("log_tail.enabled must be a boolean");
+        }
+        log_tail_config_.enabled = tail_config["enabled"];
+    }
+    
+    if (tail_config.contains("paths")) {
+        if (!tail_config["paths"].is_array()) {
+            throw ConfigException("log_tail.paths must be an array");
+        }
+        log_tail_config_.paths.clear();
+        for (const auto& path : tail_config["paths"]) {
+            if (!path.is_string() || path.get<std::string>().empty()) {
+                throw ConfigException("log_tail.paths entries must be file or directory paths");
+            }
+            log_tail_config_.paths.push_back(path);
+        }
+    }
+    
+    const std::pair<const char*, int*> numbers[] = {
+        {"batch_interval_ms", &log_tail_config_.batch_interval_ms},
+        {"max_lines_per_second", &log_tail_config_.max_lines_per_second},
+        {"backlog_lines", &log_tail_config_.backlog_lines},
+    };
+    for (const auto& number : numbers) {
+        if (!tail_config.contains(number.first)) {
+            continue;
+        }
+        if (!tail_config[number.first].is_number_integer()) {
+            throw ConfigException(std::string("log_tail.") + number.first + " must be an integer");
+        }
+        *number.second = tail_config[number.first];
+    }
+}
+
+void ConfigLoader::parseFleetConfig(const json& fleet_config) {
+    if (fleet_config.contains("enabled")) {
+        if (!fleet_config["enabled"].is_boolean()) {
+            throw ConfigException("fleet.enabled must be a boolean");
+        }
+        fleet_config_.enabled = fleet_config["enabled"];
+    }
+    
+    if (fleet_config.contains("nodes")) {
+        if (!fleet_config["nodes"].is_array()) {
+            throw ConfigException("fleet.nodes must be an array");
+        }
+        fleet_config_.nodes.clear();
+        for (const auto& entry : fleet_config["nodes"]) {
+            if (!entry.is_object() || !entry.contains("name") || !entry["name"].is_string() ||
+                !entry.contains("url") || !entry["url"].is_string()) {
+                throw ConfigException("fleet.nodes entries must be objects with \"name\" and \"url\" strings");
+            }
+            FleetConfig::Node node;
+            node.name = entry["name"];
+            node.url = entry["url"];
+            if (node.name.empty()) {
+                throw ConfigException("fleet.nodes names must not be empty");
+            }
+            if (node.url.compare(0, 5, "ws://") != 0) {
+                throw ConfigException("fleet.nodes url of " + node.name + " must be a ws:// URL");
+            }
+            for (const auto& other : fleet_config_.nodes) {
+                if (other.name == node.name) {
+                    throw ConfigException("fleet.nodes name " + node.name + " is used twice");
+                }
+            }
+            fleet_config_.nodes.push_back(node);
+        }
+    }
+    
+    if (fleet_config.contains("categories")) {
+        if (!fleet_config["categories"].is_array()) {
+            throw ConfigException("fleet.categories must be an array");
+        }
+        fleet_config_.categories.clear();
+        for (const auto& name : fleet_config["categories"]) {
+            DashboardCategory category;
+            if (!name.is_string() || !parseDashboardCategory(name.get_ref<const std::string&>().c_str(), category)) {
+                throw ConfigException("fleet.categories entries must be dashboard category names");
+            }
+            fleet_config_.categories.push_back(name);
+        }
+    }
+    
+    const std::pair<const char*, int*> numbers[] = {
+        {"publish_interval_ms", &fleet_config_.publish_interval_ms},
+        {"max_node_kb", &fleet_config_.max_node_kb},
+        {"reconnect_max_seconds", &fleet_config_.reconnect_max_seconds},
+    };
+    for (const auto& number : numbers) {
+        if (!fleet_config.contains(number.first)) {
+            continue;
+        }
+        if (!fleet_config[number.first].is_number_integer()) {
+            throw ConfigException(std::string("fleet.") + number.first + " must be an integer");
+        }
+        *number.second = fleet_config[number.first];
+    }
+}
+
+void ConfigLoader::parseMemoryBudgetConfig(const json& budget_config) {
+    const std::pair<const char*, int*> numbers[] = {
+        {"soft_limit_mb", &memory_budget_config_.soft_limit_mb},
+        {"hard_limit_mb", &memory_budget_config_.hard_limit_mb},
+        {"history_ring_percent", &memory_budget_config_.history_ring_percent},
+        {"broadcast_slowdown", &memory_budget_config_.broadcast_slowdown},
+    };
+    for (const auto& number : numbers) {
+        if (!budget_config.contains(number.first)) {
+            continue;
+        }
+        if (!budget_config[number.first].is_number_integer()) {
+            throw ConfigException(std::string("memory_budget.") + number.first + " must be an integer");
+        }
+        *number.second = budget_config[number.first];
+    }
+}
+
+void ConfigLoader::parseLoggingConfig(const json& logging_config) {
+    if (logging_config.contains("level")) {
+        logging_config_.level = parseChoice(logging_config, "level", "logging.level",
+                                            {"DEBUG", "INFO", "WARN", "ERROR", "FATAL"});
+    }
+}
+
+void ConfigLoader::parseThreadsConfig(const json& threads_config) {
+    if (!threads_config.is_object()) {
+        throw ConfigException("threads must be an object");
+    }
+    
+    const std::pair<const char*, json*> entries[] = {
+        {"websocket", &threads_config_.websocket},
+        {"mqtt", &threads_config_.mqtt},
+        {"network_priority", &threads_config_.network_priority},
+    };
+    for (const auto& entry : entries) {
+        if (!threads_config.contains(entry.first)) {
+            continue;
+        }
+        const json& attributes = threads_config[entry.first];
+        if (!attributes.is_object()) {
+            throw ConfigException(std::string("threads.") + entry.first + " must be an object");
+        }
+        // Keys given override the defaults, so a name survives "cpus" alone
+        json merged = *entry.second;
+        merged.update(attributes);
+        try {
+            ThreadMgr::ThreadManager::threadAttributesFromJson(merged.dump());
+        } catch (const ThreadMgr::ThreadManagerException&) {
+            throw ConfigException(std::string("threads.") + entry.first +
+                                  " has an invalid name, cpus, policy, priority or nice");
+        }
+        *entry.second = std::move(merged);
+    }
 }
 
 void ConfigLoader::parseWebSocketConfig(const json& ws_config) {
@@ -144,12 +1038,125 @@ void ConfigLoader::parseWebSocketConfig(const json& ws_config) {
         ws_config_.timeout_ms = ws_config["timeout_ms"];
     }
 
+    if (ws_config.contains("ping_interval_ms")) {
+        if (!ws_config["ping_interval_ms"].is_number_integer()) {
+            throw ConfigException("websocket.ping_interval_ms must be an integer");
+        }
+        ws_config_.ping_interval_ms = ws_config["ping_interval_ms"];
+    }
+
+    if (ws_config.contains("pong_timeout_ms")) {
+        if (!ws_config["pong_timeout_ms"].is_number_integer()) {
+            throw ConfigException("websocket.pong_timeout_ms must be an integer");
+        }
+        ws_config_.pong_timeout_ms = ws_config["pong_timeout_ms"];
+    }
+
+    if (ws_config.contains("idle_timeout_ms")) {
+        if (!ws_config["idle_timeout_ms"].is_number_integer()) {
+            throw ConfigException("websocket.idle_timeout_ms must be an integer");
+        }
+        ws_config_.idle_timeout_ms = ws_config["idle_timeout_ms"];
+    }
+
+    if (ws_config.contains("max_message_elements")) {
+        if (!ws_config["max_message_elements"].is_number_integer()) {
+            throw ConfigException("websocket.max_message_elements must be an integer");
+        }
+        ws_config_.max_message_elements = ws_config["max_message_elements"];
+    }
+
     if (ws_config.contains("enable_logging")) {
         if (!ws_config["enable_logging"].is_boolean()) {
             throw ConfigException("websocket.enable_logging must be a boolean");
         }
         ws_config_.enable_logging = ws_config["enable_logging"];
     }
+
+    if (ws_config.contains("snapshot_on_connect")) {
+        if (!ws_config["snapshot_on_connect"].is_boolean()) {
+            throw ConfigException("websocket.snapshot_on_connect must be a boolean");
+        }
+        ws_config_.snapshot_on_connect = ws_config["snapshot_on_connect"];
+    }
+
+    if (ws_config.contains("io_threads")) {
+        if (!ws_config["io_threads"].is_number_integer()) {
+            throw ConfigException("websocket.io_threads must be an integer");
+        }
+        ws_config_.io_threads = ws_config["io_threads"];
+    }
+
+    if (ws_config.contains("handler_threads")) {
+        if (!ws_config["handler_threads"].is_number_integer()) {
+            throw ConfigException("websocket.handler_threads must be an integer");
+        }
+        ws_config_.handler_threads = ws_config["handler_threads"];
+    }
+
+    if (ws_config.contains("handler_queue")) {
+        if (!ws_config["handler_queue"].is_number_integer()) {
+            throw ConfigException("websocket.handler_queue must be an integer");
+        }
+        ws_config_.handler_queue = ws_config["handler_queue"];
+    }
+
+    if (ws_config.contains("max_send_buffer_kb")) {
+        if (!ws_config["max_send_buffer_kb"].is_number_integer()) {
+            throw ConfigException("websocket.max_send_buffer_kb must be an integer");
+        }
+        ws_config_.max_send_buffer_kb = ws_config["max_send_buffer_kb"];
+    }
+
+    if (ws_config.contains("slow_consumer_policy")) {
+        if (!ws_config["slow_consumer_policy"].is_string()) {
+            throw ConfigException("websocket.slow_consumer_policy must be a string");
+        }
+        ws_config_.slow_consumer_policy = ws_config["slow_consumer_policy"];
+    }
+
+    if (ws_config.contains("unix_socket_path")) {
+        if (!ws_config["unix_socket_path"].is_string()) {
+            throw ConfigException("websocket.unix_socket_path must be a string");
+        }
+        ws_config_.unix_socket_path = ws_config["unix_socket_path"];
+    }
+
+    if (ws_config.contains("reuse_port")) {
+        if (!ws_config["reuse_port"].is_boolean()) {
+            throw ConfigException("websocket.reuse_port must be a boolean");
+        }
+        ws_config_.reuse_port = ws_config["reuse_port"];
+    }
+
+    if (ws_config.contains("drain_seconds")) {
+        if (!ws_config["drain_seconds"].is_number_integer()) {
+            throw ConfigException("websocket.drain_seconds must be an integer");
+        }
+        ws_config_.drain_seconds = ws_config["drain_seconds"];
+    }
+
+    if (ws_config.contains("compression")) {
+        const json& compression = ws_config["compression"];
+        if (!compression.is_object()) {
+            throw ConfigException("websocket.compression must be an object");
+        }
+
+        if (compression.contains("enabled")) {
+            if (!compression["enabled"].is_boolean()) {
+                throw ConfigException("websocket.compression.enabled must be a boolean");
+            }
+            ws_config_.compression_enabled = compression["enabled"];
+        }
+
+        if (compression.contains("min_size_bytes")) {
+            if (!compression["min_size_bytes"].is_number_integer() ||
+                compression["min_size_bytes"] < 0) {
+                throw ConfigException("websocket.compression.min_size_bytes must be a non-negative integer");
+            }
+            ws_config_.compression_min_size_bytes = compression["min_size_bytes"];
+        }
+    }
 }
 
 void ConfigLoader::validateConfig() const {
@@ -157,6 +1164,142 @@ void ConfigLoader::validateConfig() const {
         throw std::runtime_error("Invalid port number: " + std::to_string(ws_config_.port) + ". Must be between 1 and 65535.");
     }
     
+    if (metrics_config_.port < 1 || metrics_config_.port > 65535) {
+        throw std::runtime_error("Invalid metrics port: " + std::to_string(metrics_config_.port) + ". Must be between 1 and 65535.");
+    }
+    
+    if (trace_config_.buffer_events < 16 || trace_config_.buffer_events > 1048576) {
+        throw std::runtime_error("Invalid buffer_events: " + std::to_string(trace_config_.buffer_events) + ". Must be between 16 and 1048576.");
+    }
+    
+    if (diagnostics_config_.max_concurrent_jobs < 1 || diagnostics_config_.max_concurrent_jobs > 16) {
+        throw std::runtime_error("Invalid max_concurrent_jobs: " + std::to_string(diagnostics_config_.max_concurrent_jobs) + ". Must be between 1 and 16.");
+    }
+    
+    if (diagnostics_config_.max_duration_seconds < 5 || diagnostics_config_.max_duration_seconds > 3600) {
+        throw std::runtime_error("Invalid max_duration_seconds: " + std::to_string(diagnostics_config_.max_duration_seconds) + ". Must be between 5 and 3600.");
+    }
+    
+    if (camera_discovery_config_.probe_window < 1 || camera_discovery_config_.probe_window > 254) {
+        throw std::runtime_error("Invalid probe_window: " + std::to_string(camera_discovery_config_.probe_window) + ". Must be between 1 and 254.");
+    }
+    
+    if (camera_discovery_config_.probe_rate_per_second < 1 || camera_discovery_config_.probe_rate_per_second > 1000) {
+        throw std::runtime_error("Invalid probe_rate_per_second: " + std::to_string(camera_discovery_config_.probe_rate_per_second) + ". Must be between 1 and 1000.");
+    }
+    
+    if (camera_discovery_config_.probe_timeout_ms < 100 || camera_discovery_config_.probe_timeout_ms > 10000) {
+        throw std::runtime_error("Invalid probe_timeout_ms: " + std::to_string(camera_discovery_config_.probe_timeout_ms) + ". Must be between 100 and 10000.");
+    }
+    
+    if (camera_discovery_config_.listen_seconds < 1 || camera_discovery_config_.listen_seconds > 30) {
+        throw std::runtime_error("Invalid listen_seconds: " + std::to_string(camera_discovery_config_.listen_seconds) + ". Must be between 1 and 30.");
+    }
+    
+    if (camera_discovery_config_.cache_ttl_seconds < 10 || camera_discovery_config_.cache_ttl_seconds > 86400) {
+        throw std::runtime_error("Invalid cache_ttl_seconds: " + std::to_string(camera_discovery_config_.cache_ttl_seconds) + ". Must be between 10 and 86400.");
+    }
+    
+    if (mavlink_config_.udp_port < 1 || mavlink_config_.udp_port > 65535) {
+        throw std::runtime_error("Invalid mavlink udp_port: " + std::to_string(mavlink_config_.udp_port) + ". Must be between 1 and 65535.");
+    }
+    
+    static const int kBaudRates[] = {9600, 19200, 38400, 57600, 115200, 230400, 460800, 500000, 921600, 1000000, 1500000};
+    if (std::find(std::begin(kBaudRates), std::end(kBaudRates), mavlink_config_.baud) == std::end(kBaudRates)) {
+        throw std::runtime_error("Invalid baud: " + std::to_string(mavlink_config_.baud) + ". Must be a standard rate from 9600 to 1500000.");
+    }
+    
+    if (mavlink_config_.ring_size < 1 || mavlink_config_.ring_size > 1024) {
+        throw std::runtime_error("Invalid ring_size: " + std::to_string(mavlink_config_.ring_size) + ". Must be between 1 and 1024.");
+    }
+    
+    if (mavlink_config_.max_rate_hz < 1 || mavlink_config_.max_rate_hz > 200) {
+        throw std::runtime_error("Invalid max_rate_hz: " + std::to_string(mavlink_config_.max_rate_hz) + ". Must be between 1 and 200.");
+    }
+    
+    if (wireless_scan_config_.cache_ttl_seconds < 1 || wireless_scan_config_.cache_ttl_seconds > 3600) {
+        throw std::runtime_error("Invalid wireless_scan cache_ttl_seconds: " + std::to_string(wireless_scan_config_.cache_ttl_seconds) + ". Must be between 1 and 3600.");
+    }
+    
+    if (wireless_scan_config_.scan_timeout_seconds < 2 || wireless_scan_config_.scan_timeout_seconds > 60) {
+        throw std::runtime_error("Invalid scan_timeout_seconds: " + std::to_string(wireless_scan_config_.scan_timeout_seconds) + ". Must be between 2 and 60.");
+    }
+    
+    const auto& priority = network_priority_config_;
+    if (priority.reachability_interval_ms < 250 || priority.reachability_interval_ms > 600000) {
+        throw std::runtime_error("Invalid reachability_interval_ms: " + std::to_string(priority.reachability_interval_ms) + ". Must be between 250 and 600000.");
+    }
+    
+    if (priority.reachability_timeout_ms < 100 || priority.reachability_timeout_ms >= priority.reachability_interval_ms) {
+        throw std::runtime_error("Invalid reachability_timeout_ms: " + std::to_string(priority.reachability_timeout_ms) + ". Must be at least 100 and below reachability_interval_ms.");
+    }
+    
+    if (priority.reachability_down_after < 1 || priority.reachability_down_after > 20 ||
+        priority.reachability_up_after < 1 || priority.reachability_up_after > 20) {
+        throw std::runtime_error("Invalid reachability_down_after or reachability_up_after. Must be between 1 and 20.");
+    }
+    
+    if (priority.failover_restore_hold_ms < 0 || priority.failover_restore_hold_ms > 3600000) {
+        throw std::runtime_error("Invalid failover_restore_hold_ms: " + std::to_string(priority.failover_restore_hold_ms) + ". Must be between 0 and 3600000.");
+    }
+    
+    if (priority.failover_max_latency_ms < 0 || priority.failover_max_latency_ms > 60000) {
+        throw std::runtime_error("Invalid failover_max_latency_ms: " + std::to_string(priority.failover_max_latency_ms) + ". Must be between 0 and 60000.");
+    }
+    
+    if (vpn_monitor_config_.bytecount_interval_seconds < 1 || vpn_monitor_config_.bytecount_interval_seconds > 60) {
+        throw std::runtime_error("Invalid bytecount_interval_seconds: " + std::to_string(vpn_monitor_config_.bytecount_interval_seconds) + ". Must be between 1 and 60.");
+    }
+    
+    if (vpn_monitor_config_.wireguard_refresh_ms < 250 || vpn_monitor_config_.wireguard_refresh_ms > 60000) {
+        throw std::runtime_error("Invalid wireguard_refresh_ms: " + std::to_string(vpn_monitor_config_.wireguard_refresh_ms) + ". Must be between 250 and 60000.");
+    }
+    
+    if (log_tail_config_.batch_interval_ms < 50 || log_tail_config_.batch_interval_ms > 5000) {
+        throw std::runtime_error("Invalid log_tail batch_interval_ms: " + std::to_string(log_tail_config_.batch_interval_ms) + ". Must be between 50 and 5000.");
+    }
+    
+    if (log_tail_config_.max_lines_per_second < 1 || log_tail_config_.max_lines_per_second > 5000) {
+        throw std::runtime_error("Invalid max_lines_per_second: " + std::to_string(log_tail_config_.max_lines_per_second) + ". Must be between 1 and 5000.");
+    }
+    
+    if (log_tail_config_.backlog_lines < 0 || log_tail_config_.backlog_lines > 1000) {
+        throw std::runtime_error("Invalid backlog_lines: " + std::to_string(log_tail_config_.backlog_lines) + ". Must be between 0 and 1000.");
+    }
+    
+    if (fleet_config_.publish_interval_ms < 100 || fleet_config_.publish_interval_ms > 60000) {
+        throw std::runtime_error("Invalid fleet publish_interval_ms: " + std::to_string(fleet_config_.publish_interval_ms) + ". Must be between 100 and 60000.");
+    }
+    
+    if (fleet_config_.max_node_kb < 16 || fleet_config_.max_node_kb > 16384) {
+        throw std::runtime_error("Invalid max_node_kb: " + std::to_string(fleet_config_.max_node_kb) + ". Must be between 16 and 16384.");
+    }
+    
+    if (fleet_config_.reconnect_max_seconds < 1 || fleet_config_.reconnect_max_seconds > 3600) {
+        throw std::runtime_error("Invalid reconnect_max_seconds: " + std::to_string(fleet_config_.reconnect_max_seconds) + ". Must be between 1 and 3600.");
+    }
+    
+    const auto& budget = memory_budget_config_;
+    if (budget.soft_limit_mb < 0 || budget.soft_limit_mb > 65536) {
+        throw std::runtime_error("Invalid soft_limit_mb: " + std::to_string(budget.soft_limit_mb) + ". Must be between 0 and 65536.");
+    }
+    
+    if (budget.hard_limit_mb < 0 || budget.hard_limit_mb > 65536) {
+        throw std::runtime_error("Invalid hard_limit_mb: " + std::to_string(budget.hard_limit_mb) + ". Must be between 0 and 65536.");
+    }
+    
+    if (budget.soft_limit_mb > 0 && budget.hard_limit_mb > 0 && budget.soft_limit_mb >= budget.hard_limit_mb) {
+        throw std::runtime_error("Invalid soft_limit_mb: " + std::to_string(budget.soft_limit_mb) + ". Must be below hard_limit_mb.");
+    }
+    
+    if (budget.history_ring_percent < 1 || budget.history_ring_percent > 100) {
+        throw std::runtime_error("Invalid history_ring_percent: " + std::to_string(budget.history_ring_percent) + ". Must be between 1 and 100.");
+    }
+    
+    if (budget.broadcast_slowdown < 1 || budget.broadcast_slowdown > 20) {
+        throw std::runtime_error("Invalid broadcast_slowdown: " + std::to_string(budget.broadcast_slowdown) + ". Must be between 1 and 20.");
+    }
+    
     if (ws_config_.max_connections < 1 || ws_config_.max_connections > 10000) {
         throw std::runtime_error("Invalid max_connections: " + std::to_string(ws_config_.max_connections) + ". Must be between 1 and 10000.");
     }
@@ -164,6 +1307,145 @@ void ConfigLoader::validateConfig() const {
     if (ws_config_.timeout_ms < 100 || ws_config_.timeout_ms > 300000) {
         throw std::runtime_error("Invalid timeout_ms: " + std::to_string(ws_config_.timeout_ms) + ". Must be between 100 and 300000.");
     }
+    
+    if (ws_config_.ping_interval_ms != 0 && (ws_config_.ping_interval_ms < 1000 || ws_config_.ping_interval_ms > 3600000)) {
+        throw std::runtime_error("Invalid ping_interval_ms: " + std::to_string(ws_config_.ping_interval_ms) + ". Must be 0 or between 1000 and 3600000.");
+    }
+    
+    if (ws_config_.pong_timeout_ms < 100 || ws_config_.pong_timeout_ms > 300000) {
+        throw std::runtime_error("Invalid pong_timeout_ms: " + std::to_string(ws_config_.pong_timeout_ms) + ". Must be between 100 and 300000.");
+    }
+    
+    if (ws_config_.idle_timeout_ms != 0 && (ws_config_.idle_timeout_ms < 1000 || ws_config_.idle_timeout_ms > 86400000)) {
+        throw std::runtime_error("Invalid idle_timeout_ms: " + std::to_string(ws_config_.idle_timeout_ms) + ". Must be 0 or between 1000 and 86400000.");
+    }
+
+    if (ws_config_.max_message_elements < 0) {
+        throw std::runtime_error("Invalid max_message_elements: " + std::to_string(ws_config_.max_message_elements) + ". Must be non-negative.");
+    }
+
+    if (db_config_.reader_pool_size < 0 || db_config_.reader_pool_size > 16) {
+        throw std::runtime_error("Invalid reader_pool_size: " + std::to_string(db_config_.reader_pool_size) + ". Must be between 0 and 16.");
+    }
+    
+    if (system_data_config_.latency_timeout_ms < 100 || system_data_config_.latency_timeout_ms > 10000) {
+        throw std::runtime_error("Invalid latency_timeout_ms: " + std::to_string(system_data_config_.latency_timeout_ms) + ". Must be between 100 and 10000.");
+    }
+    
+    if (system_data_config_.latency_window < 1 || system_data_config_.latency_window > 1000) {
+        throw std::runtime_error("Invalid latency_window: " + std::to_string(system_data_config_.latency_window) + ". Must be between 1 and 1000.");
+    }
+    
+    if (system_data_config_.storage_mounts.size() > 8) {
+        throw std::runtime_error("Invalid storage_mounts: " + std::to_string(system_data_config_.storage_mounts.size()) + " entries. At most 8.");
+    }
+    
+    if (system_data_config_.idle_slowdown < 1 || system_data_config_.idle_slowdown > 60) {
+        throw std::runtime_error("Invalid idle_slowdown: " + std::to_string(system_data_config_.idle_slowdown) + ". Must be between 1 and 60.");
+    }
+    
+    if (system_data_config_.load_slowdown < 1 || system_data_config_.load_slowdown > 16) {
+        throw std::runtime_error("Invalid load_slowdown: " + std::to_string(system_data_config_.load_slowdown) + ". Must be between 1 and 16.");
+    }
+    
+    if (metrics_history_config_.ring_capacity < 60 || metrics_history_config_.ring_capacity > 86400) {
+        throw std::runtime_error("Invalid ring_capacity: " + std::to_string(metrics_history_config_.ring_capacity) + ". Must be between 60 and 86400.");
+    }
+    
+    if (telemetry_config_.window_seconds < 5 || telemetry_config_.window_seconds > 86400) {
+        throw std::runtime_error("Invalid telemetry window_seconds: " + std::to_string(telemetry_config_.window_seconds) + ". Must be between 5 and 86400.");
+    }
+    
+    if (telemetry_config_.sample_interval_ms < 100 ||
+        telemetry_config_.sample_interval_ms > telemetry_config_.window_seconds * 1000) {
+        throw std::runtime_error("Invalid telemetry sample_interval_ms: " + std::to_string(telemetry_config_.sample_interval_ms) + ". Must be between 100 and the window length.");
+    }
+    
+    if (telemetry_config_.full_report_windows < 0 || telemetry_config_.full_report_windows > 10000) {
+        throw std::runtime_error("Invalid telemetry full_report_windows: " + std::to_string(telemetry_config_.full_report_windows) + ". Must be between 0 and 10000.");
+    }
+    
+    if (db_config_.log_queue_capacity < 16 || db_config_.log_queue_capacity > 1048576) {
+        throw std::runtime_error("Invalid log_queue_capacity: " + std::to_string(db_config_.log_queue_capacity) + ". Must be between 16 and 1048576.");
+    }
+    
+    if (db_config_.maintenance_interval_seconds < 60 || db_config_.maintenance_interval_seconds > 86400) {
+        throw std::runtime_error("Invalid maintenance_interval_seconds: " + std::to_string(db_config_.maintenance_interval_seconds) + ". Must be between 60 and 86400.");
+    }
+    
+    if (db_config_.log_retention_days < 1 || db_config_.log_retention_days > 3650) {
+        throw std::runtime_error("Invalid log_retention_days: " + std::to_string(db_config_.log_retention_days) + ". Must be between 1 and 3650.");
+    }
+    
+    if (db_config_.max_connection_rows < 100 || db_config_.max_connection_rows > 10000000) {
+        throw std::runtime_error("Invalid max_connection_rows: " + std::to_string(db_config_.max_connection_rows) + ". Must be between 100 and 10000000.");
+    }
+    
+    if (db_config_.max_message_rows < 100 || db_config_.max_message_rows > 10000000) {
+        throw std::runtime_error("Invalid max_message_rows: " + std::to_string(db_config_.max_message_rows) + ". Must be between 100 and 10000000.");
+    }
+    
+    if (ws_config_.io_threads < 1 || ws_config_.io_threads > 64) {
+        throw std::runtime_error("Invalid io_threads: " + std::to_string(ws_config_.io_threads) + ". Must be between 1 and 64.");
+    }
+
+    if (ws_config_.drain_seconds < 0 || ws_config_.drain_seconds > 300) {
+        throw std::runtime_error("Invalid drain_seconds: " + std::to_string(ws_config_.drain_seconds) + ". Must be between 0 and 300.");
+    }
+    
+    if (ws_config_.handler_threads < 0 || ws_config_.handler_threads > 16) {
+        throw std::runtime_error("Invalid handler_threads: " + std::to_string(ws_config_.handler_threads) + ". Must be between 0 and 16.");
+    }
+    
+    if (ws_config_.handler_queue < 1 || ws_config_.handler_queue > 4096) {
+        throw std::runtime_error("Invalid handler_queue: " + std::to_string(ws_config_.handler_queue) + ". Must be between 1 and 4096.");
+    }
+
+    if (ws_config_.max_send_buffer_kb < 16 || ws_config_.max_send_buffer_kb > 65536) {
+        throw std::runtime_error("Invalid max_send_buffer_kb: " + std::to_string(ws_config_.max_send_buffer_kb) + ". Must be between 16 and 65536.");
+    }
+
+    if (ws_config_.slow_consumer_policy != "drop" && ws_config_.slow_consumer_policy != "disconnect") {
+        throw ConfigException("websocket.slow_consumer_policy must be \"drop\" or \"disconnect\"");
+    }
+
+    if (rpc_config_.worker_threads < 1 || rpc_config_.worker_threads > 64) {
+        throw std::runtime_error("Invalid worker_threads: " + std::to_string(rpc_config_.worker_threads) + ". Must be between 1 and 64.");
+    }
+
+    if (rpc_config_.queue_capacity < 1 || rpc_config_.queue_capacity > 65536) {
+        throw std::runtime_error("Invalid queue_capacity: " + std::to_string(rpc_config_.queue_capacity) + ". Must be between 1 and 65536.");
+    }
+
+    if (rpc_config_.outbound_queue_capacity < 16 || rpc_config_.outbound_queue_capacity > 65536) {
+        throw std::runtime_error("Invalid outbound_queue_capacity: " + std::to_string(rpc_config_.outbound_queue_capacity) + ". Must be between 16 and 65536.");
+    }
+
+    if (rpc_config_.log_queue_capacity != 0 &&
+        (rpc_config_.log_queue_capacity < 16 || rpc_config_.log_queue_capacity > 65536)) {
+        throw std::runtime_error("Invalid log_queue_capacity: " + std::to_string(rpc_config_.log_queue_capacity) + ". Must be 0 or between 16 and 65536.");
+    }
+
+    if (rpc_config_.log_flush_interval_ms < 1 || rpc_config_.log_flush_interval_ms > 10000) {
+        throw std::runtime_error("Invalid log_flush_interval_ms: " + std::to_string(rpc_config_.log_flush_interval_ms) + ". Must be between 1 and 10000.");
+    }
+    
+    if (rpc_config_.replay_cache_size < 0 || rpc_config_.replay_cache_size > 65536) {
+        throw std::runtime_error("Invalid replay_cache_size: " + std::to_string(rpc_config_.replay_cache_size) + ". Must be between 0 and 65536.");
+    }
+    
+    if (rpc_config_.replay_ttl_seconds < 1 || rpc_config_.replay_ttl_seconds > 3600) {
+        throw std::runtime_error("Invalid replay_ttl_seconds: " + std::to_string(rpc_config_.replay_ttl_seconds) + ". Must be between 1 and 3600.");
+    }
+    
+    if (rpc_config_.response_chunk_bytes != 0 &&
+        (rpc_config_.response_chunk_bytes < 1024 || rpc_config_.response_chunk_bytes > 1048576)) {
+        throw std::runtime_error("Invalid response_chunk_bytes: " + std::to_string(rpc_config_.response_chunk_bytes) + ". Must be 0 or between 1024 and 1048576.");
+    }
+    
+    if (rpc_config_.response_chunk_window < 1 || rpc_config_.response_chunk_window > 256) {
+        throw std::runtime_error("Invalid response_chunk_window: " + std::to_string(rpc_config_.response_chunk_window) + ". Must be between 1 and 256.");
+    }
 
     if (ws_config_.host.empty()) {
         throw ConfigException("websocket.host cannot be empty");
@@ -0,0 +1,109 @@
+#include "dashboard_delta.h"
+#include <chrono>
+
+DashboardDeltaEngine::DashboardDeltaEngine(uint64_t full_snapshot_interval)
+    : full_snapshot_interval_(full_snapshot_interval) {
+}
+
+bool DashboardDeltaEngine::buildUpdate(DashboardCategory category, const json& data, json& message) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+
+    CategoryState& state = states_[categoryIndex(category)];
+    bool first = state.seq == 0;
+
+    if (!first && state.last_data == data) {
+        return false;
+    }
+
+    json patch;
+    bool send_full = first ||
+                     (full_snapshot_interval_ > 0 &&
+                      state.seq + 1 - state.last_full_seq >= full_snapshot_interval_) ||
+                     !createMergePatch(state.last_data, data, patch);
+
+    state.seq++;
+    state.last_data = data;
+    version_.fetch_add(1, std::memory_order_release);
+
+    auto timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto timestamp = timestamp_ms / 1000;
+
+    if (send_full) {
+        state.last_full_seq = state.seq;
+        message = {
+            {"type", "dashboard_update"},
+            {"category", categoryName(category)},
+            {"seq", state.seq},
+            {"data", data},
+            {"timestamp", timestamp},
+            {"timestamp_ms", timestamp_ms}
+        };
+    } else {
+        message = {
+            {"type", "dashboard_delta"},
+            {"category", categoryName(category)},
+            {"seq", state.seq},
+            {"patch", std::move(patch)},
+            {"timestamp", timestamp},
+            {"timestamp_ms", timestamp_ms}
+        };
+    }
+
+    return true;
+}
+
+uint64_t DashboardDeltaEngine::getSequence(DashboardCategory category) const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return states_[categoryIndex(category)].seq;
+}
+
+void DashboardDeltaEngine::reset() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    states_.fill(CategoryState());
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+// Builds a merge patch turning source into target. Returns false when the
+// change can't be expressed as a merge patch (a null value in target would be
+// read as a deletion), in which case the caller sends the full value.
+bool DashboardDeltaEngine::createMergePatch(const json& source, const json& target, json& patch) {
+    if (!source.is_object() || !target.is_object()) {
+        if (target.is_null()) {
+            return false;
+        }
+        patch = target;
+        return true;
+    }
+
+    patch = json::object();
+
+    for (auto it = source.begin(); it != source.end(); ++it) {
+        if (!target.contains(it.key())) {
+            patch[it.key()] = nullptr;
+        }
+    }
+
+    for (auto it = target.begin(); it != target.end(); ++it) {
+        auto src = source.find(it.key());
+        if (src != source.end() && *src == it.value()) {
+            continue;
+        }
+
+        if (it.value().is_null()) {
+            return false;
+        }
+
+        if (src != source.end() && src->is_object() && it.value().is_object()) {
+            json child;
+            if (!createMergePatch(*src, it.value(), child)) {
+                return false;
+            }
+            patch[it.key()] = std::move(child);
+        } else {
+            patch[it.key()] = it.value();
+        }
+    }
+
+    return true;
+}
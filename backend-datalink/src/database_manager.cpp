@@ -1,9 +1,72 @@
 #include "database_manager.h"
-#include <iostream>
+#include "ur-metrics/ur_metrics.hpp"
+#include "ur-trace/ur_trace.hpp"
+#include "ur-clock/ur_clock.hpp"
+#include "backend_log.h"
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <iomanip>
+#include <ctime>
+#include <cerrno>
+#include <sys/stat.h>
+
+namespace {
+
+// Returns a cached statement to its initial state when the borrower is done
+class StatementReset {
+public:
+    explicit StatementReset(sqlite3_stmt* stmt) : stmt_(stmt) {}
+    ~StatementReset() {
+        if (stmt_) {
+            sqlite3_reset(stmt_);
+            sqlite3_clear_bindings(stmt_);
+        }
+    }
+    
+    StatementReset(const StatementReset&) = delete;
+    StatementReset& operator=(const StatementReset&) = delete;
+
+private:
+    sqlite3_stmt* stmt_;
+};
+
+// Equivalent of mkdir -p without spawning a shell
+bool createDirectories(const std::string& dir) {
+    size_t pos = 0;
+    while (pos != std::string::npos) {
+        pos = dir.find('/', pos + 1);
+        std::string partial = dir.substr(0, pos);
+        if (!partial.empty() && mkdir(partial.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Wall time of one SQLite operation, including the wait for its connection
+UrMetrics::Histogram& operationSeconds(const char* operation) {
+    return UrMetrics::Registry::instance().histogram(
+        "backend_db_operation_duration_seconds", "SQLite operation latency including the wait for a connection",
+        UrMetrics::latencyBuckets(), {{"operation", operation}});
+}
+
+UrMetrics::Histogram& dashboardWriteSeconds() {
+    static UrMetrics::Histogram& histogram = operationSeconds("dashboard_write");
+    return histogram;
+}
+
+UrMetrics::Histogram& dashboardReadSeconds() {
+    static UrMetrics::Histogram& histogram = operationSeconds("dashboard_read");
+    return histogram;
+}
+
+UrMetrics::Histogram& logFlushSeconds() {
+    static UrMetrics::Histogram& histogram = operationSeconds("log_flush");
+    return histogram;
+}
+
+} // namespace
 
 DatabaseManager::~DatabaseManager() {
     shutdown();
@@ -20,7 +83,7 @@ bool DatabaseManager::initialize(const ConfigLoader::DatabaseConfig& config) {
     config_ = config;
     
     if (!config_.enabled) {
-        std::cout << "[DatabaseManager] Database disabled in configuration" << std::endl;
+        BACKEND_LOG_INFO("[DatabaseManager] Database disabled in configuration");
         return true;
     }
     
@@ -28,8 +91,7 @@ bool DatabaseManager::initialize(const ConfigLoader::DatabaseConfig& config) {
     size_t last_slash = config_.path.find_last_of('/');
     if (last_slash != std::string::npos) {
         std::string db_dir = config_.path.substr(0, last_slash);
-        std::string mkdir_cmd = "mkdir -p " + db_dir;
-        if (system(mkdir_cmd.c_str()) != 0) {
+        if (!createDirectories(db_dir)) {
             logError("Failed to create database directory: " + db_dir);
             return false;
         }
@@ -50,80 +112,193 @@ bool DatabaseManager::initialize(const ConfigLoader::DatabaseConfig& config) {
     // Enable foreign keys
     executeSQL("PRAGMA foreign_keys = ON");
     
-    // Create tables if database is new
+    applyConnectionTuning();
+    
     if (!db_exists) {
-        std::cout << "[DatabaseManager] Creating new database: " << config_.path << std::endl;
-        if (!createTables()) {
-            logError("Failed to create database tables");
-            sqlite3_close(db_);
-            db_ = nullptr;
-            return false;
-        }
+        BACKEND_LOG_INFO("[DatabaseManager] Creating new database: " << config_.path);
+        // Must be set before the first table exists; lets maintenance return
+        // the pages freed by retention to the filesystem
+        executeSQL("PRAGMA auto_vacuum = INCREMENTAL");
     } else {
-        std::cout << "[DatabaseManager] Using existing database: " << config_.path << std::endl;
-        // Verify existing database has required tables
-        if (!verifyDatabaseSchema()) {
-            logError("Database schema verification failed");
-            sqlite3_close(db_);
-            db_ = nullptr;
-            return false;
-        }
+        BACKEND_LOG_INFO("[DatabaseManager] Using existing database: " << config_.path);
+    }
+    
+    if (!migrateSchema()) {
+        logError("Failed to migrate database schema");
+        finalizeStatements(statement_cache_);
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    
+    if (config_.self_test_on_startup && (!verifyDatabaseSchema() || !testDatabaseOperations())) {
+        logError("Database self-test failed");
+        finalizeStatements(statement_cache_);
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
     }
     
-    // Test database operations
-    if (!testDatabaseOperations()) {
-        logError("Database operations test failed");
+    if (!openReaderPool()) {
+        logError("Failed to open reader connections");
+        closeReaderPool();
+        finalizeStatements(statement_cache_);
         sqlite3_close(db_);
         db_ = nullptr;
         return false;
     }
     
-    std::cout << "[DatabaseManager] Database initialized successfully" << std::endl;
+    closeStaleConnections();
+    startLogWriter();
+    
+    BACKEND_LOG_INFO("[DatabaseManager] Database initialized successfully");
+    return true;
+}
+
+// Journal, sync and cache settings from DatabaseConfig. WAL lets readers and
+// the writer proceed concurrently; synchronous=NORMAL is durable across
+// application crashes and only fsyncs at checkpoints in WAL mode.
+void DatabaseManager::applyConnectionTuning() {
+    sqlite3_busy_timeout(db_, config_.busy_timeout_ms);
+    
+    executeSQL("PRAGMA journal_mode = " + config_.journal_mode);
+    executeSQL("PRAGMA synchronous = " + config_.synchronous);
+    executeSQL("PRAGMA temp_store = " + config_.temp_store);
+    // Negative cache_size is in KiB rather than pages
+    executeSQL("PRAGMA cache_size = -" + std::to_string(config_.cache_size_kb));
+    executeSQL("PRAGMA mmap_size = " + std::to_string(config_.mmap_size_bytes));
+    
+    BACKEND_LOG_INFO("[DatabaseManager] journal_mode=" << config_.journal_mode
+                     << " synchronous=" << config_.synchronous
+                     << " cache_size=" << config_.cache_size_kb << "KB"
+                     << " mmap_size=" << config_.mmap_size_bytes);
+}
+
+// Readers share the writer's file, so they are only opened once the schema
+// exists and WAL is active; rollback journals would make them block writes.
+bool DatabaseManager::openReaderPool() {
+    if (config_.reader_pool_size == 0 || config_.journal_mode != "WAL") {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> lock(reader_mutex_);
+    
+    for (int i = 0; i < config_.reader_pool_size; ++i) {
+        std::unique_ptr<ReaderConnection> reader(new ReaderConnection());
+        int result = sqlite3_open_v2(config_.path.c_str(), &reader->db,
+                                     SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+        if (result != SQLITE_OK) {
+            logError("Failed to open reader connection: " + std::string(sqlite3_errmsg(reader->db)));
+            sqlite3_close(reader->db);
+            return false;
+        }
+        
+        sqlite3_busy_timeout(reader->db, config_.busy_timeout_ms);
+        std::string pragmas = "PRAGMA temp_store = " + config_.temp_store +
+                              "; PRAGMA cache_size = -" + std::to_string(config_.cache_size_kb) +
+                              "; PRAGMA mmap_size = " + std::to_string(config_.mmap_size_bytes);
+        sqlite3_exec(reader->db, pragmas.c_str(), nullptr, nullptr, nullptr);
+        
+        idle_readers_.push_back(reader.get());
+        readers_.push_back(std::move(reader));
+    }
+    
+    BACKEND_LOG_INFO("[DatabaseManager] Opened " << readers_.size() << " reader connection(s)");
     return true;
 }
 
+void DatabaseManager::closeReaderPool() {
+    std::unique_lock<std::mutex> lock(reader_mutex_);
+    
+    // Wait for outstanding leases so no query runs on a closed handle
+    reader_cv_.wait(lock, [this] { return idle_readers_.size() == readers_.size(); });
+    
+    for (auto& reader : readers_) {
+        finalizeStatements(reader->statements);
+        sqlite3_close(reader->db);
+    }
+    readers_.clear();
+    idle_readers_.clear();
+}
+
+DatabaseManager::ReaderLease::ReaderLease(const DatabaseManager& manager) : manager_(manager) {
+    std::unique_lock<std::mutex> lock(manager_.reader_mutex_);
+    if (manager_.readers_.empty()) {
+        lock.unlock();
+        writer_lock_ = std::unique_lock<std::mutex>(manager_.db_mutex_);
+        return;
+    }
+    
+    manager_.reader_cv_.wait(lock, [this] { return !manager_.idle_readers_.empty(); });
+    reader_ = manager_.idle_readers_.back();
+    manager_.idle_readers_.pop_back();
+}
+
+DatabaseManager::ReaderLease::~ReaderLease() {
+    if (reader_) {
+        {
+            std::lock_guard<std::mutex> lock(manager_.reader_mutex_);
+            manager_.idle_readers_.push_back(reader_);
+        }
+        manager_.reader_cv_.notify_all();
+    }
+}
+
+sqlite3_stmt* DatabaseManager::ReaderLease::statement(const std::string& sql) {
+    if (reader_) {
+        return manager_.prepareCached(reader_->db, reader_->statements, sql);
+    }
+    return manager_.getStatement(sql);
+}
+
 void DatabaseManager::shutdown() {
+    stopLogWriter();
+    
+    // Drain readers before taking db_mutex_: a fallback lease may hold it
+    closeReaderPool();
+    
     std::lock_guard<std::mutex> lock(db_mutex_);
     
     if (db_ != nullptr) {
+        finalizeStatements(statement_cache_);
         sqlite3_close(db_);
         db_ = nullptr;
-        std::cout << "[DatabaseManager] Database connection closed" << std::endl;
+        BACKEND_LOG_INFO("[DatabaseManager] Database connection closed");
     }
 }
 
 bool DatabaseManager::logConnection(const std::string& connection_id, const std::string& client_ip, const std::string& status) {
+    if (status == "connected") {
+        active_connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+    
     if (!config_.enabled || !config_.log_connections || db_ == nullptr) {
         return true; // Silently ignore if disabled
     }
     
-    std::lock_guard<std::mutex> lock(db_mutex_);
-    
-    std::string sql = "INSERT INTO connections_log (connection_id, client_ip, status, connected_at) VALUES (?, ?, ?, ?)";
-    std::vector<std::string> params = {
-        connection_id,
-        client_ip,
-        status,
-        getCurrentTimestamp()
-    };
-    
-    return executeSQLWithParams(sql, params);
+    LogEntry entry;
+    entry.kind = LogEntry::Kind::Connect;
+    entry.connection_id = connection_id;
+    entry.field1 = client_ip;
+    entry.field2 = status;
+    entry.timestamp = getCurrentTimestamp();
+    return enqueueLogEntry(std::move(entry));
 }
 
 bool DatabaseManager::logDisconnection(const std::string& connection_id) {
+    int active = active_connections_.load(std::memory_order_relaxed);
+    while (active > 0 && !active_connections_.compare_exchange_weak(active, active - 1, std::memory_order_relaxed)) {
+    }
+    
     if (!config_.enabled || !config_.log_connections || db_ == nullptr) {
         return true; // Silently ignore if disabled
     }
     
-    std::lock_guard<std::mutex> lock(db_mutex_);
-    
-    std::string sql = "UPDATE connections_log SET disconnected_at = ?, status = 'disconnected' WHERE connection_id = ? AND disconnected_at IS NULL";
-    std::vector<std::string> params = {
-        getCurrentTimestamp(),
-        connection_id
-    };
-    
-    return executeSQLWithParams(sql, params);
+    LogEntry entry;
+    entry.kind = LogEntry::Kind::Disconnect;
+    entry.connection_id = connection_id;
+    entry.timestamp = getCurrentTimestamp();
+    return enqueueLogEntry(std::move(entry));
 }
 
 bool DatabaseManager::logMessage(const std::string& connection_id, const std::string& direction, const std::string& message_text) {
@@ -131,41 +306,256 @@ bool DatabaseManager::logMessage(const std::string& connection_id, const std::st
         return true; // Silently ignore if disabled
     }
     
-    std::lock_guard<std::mutex> lock(db_mutex_);
+    LogEntry entry;
+    entry.kind = LogEntry::Kind::Message;
+    entry.connection_id = connection_id;
+    entry.field1 = direction;
+    entry.field2 = message_text;
+    entry.timestamp = getCurrentTimestamp();
+    return enqueueLogEntry(std::move(entry));
+}
+
+bool DatabaseManager::enqueueLogEntry(LogEntry entry) {
+    if (!log_queue_ || !log_queue_->push(std::move(entry))) {
+        uint64_t dropped = dropped_log_entries_.fetch_add(1, std::memory_order_relaxed) + 1;
+        // Report the first drop and then every 1000th to keep the I/O thread quiet
+        if (dropped == 1 || dropped % 1000 == 0) {
+            logError("Log queue full, dropped " + std::to_string(dropped) + " entries so far");
+        }
+        return false;
+    }
     
-    std::string sql = "INSERT INTO messages (connection_id, direction, message_text, timestamp) VALUES (?, ?, ?, ?)";
-    std::vector<std::string> params = {
-        connection_id,
-        direction,
-        message_text,
-        getCurrentTimestamp()
-    };
+    log_wake_cv_.notify_one();
+    return true;
+}
+
+// Migration 3: databases created before snapshots were stored as
+// MessagePack lack the data_msgpack column
+bool DatabaseManager::upgradeDashboardTable() {
+    bool has_column = false;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, "PRAGMA table_info(dashboard_data)", -1, &stmt, nullptr) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            if (name && std::string(name) == "data_msgpack") {
+                has_column = true;
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
     
-    return executeSQLWithParams(sql, params);
+    return has_column || executeSQL("ALTER TABLE dashboard_data ADD COLUMN data_msgpack BLOB");
 }
 
-int DatabaseManager::getActiveConnectionCount() const {
-    if (!config_.enabled || db_ == nullptr) {
+// Migration 2: the original schema declared messages.connection_id as a
+// foreign key to the non-unique connections_log.connection_id, which makes
+// SQLite reject every write to either table ("foreign key mismatch")
+bool DatabaseManager::rebuildMessagesTable() {
+    bool has_foreign_key = false;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, "SELECT sql FROM sqlite_master WHERE type = 'table' AND name = 'messages'",
+                           -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* sql = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            has_foreign_key = sql && std::string(sql).find("REFERENCES connections_log") != std::string::npos;
+        }
+        sqlite3_finalize(stmt);
+    }
+    
+    if (!has_foreign_key) {
+        return true;
+    }
+    
+    finalizeStatements(statement_cache_);
+    return executeSQL("CREATE TABLE messages_rebuild ("
+                      "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                      "connection_id TEXT NOT NULL,"
+                      "direction TEXT NOT NULL,"
+                      "message_text TEXT,"
+                      "timestamp TEXT NOT NULL,"
+                      "created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+                      ")") &&
+           executeSQL("INSERT INTO messages_rebuild SELECT id, connection_id, direction, message_text, timestamp, created_at FROM messages") &&
+           executeSQL("DROP TABLE messages") &&
+           executeSQL("ALTER TABLE messages_rebuild RENAME TO messages") &&
+           executeSQL("CREATE INDEX IF NOT EXISTS idx_messages_connection_id ON messages(connection_id)") &&
+           executeSQL("CREATE INDEX IF NOT EXISTS idx_messages_timestamp ON messages(timestamp)");
+}
+
+// Rows left open by a previous run (crash, watchdog reset) can never be
+// closed by a matching logDisconnection, so close them now. This keeps
+// the in-memory active count and the table consistent.
+void DatabaseManager::closeStaleConnections() {
+    executeSQLWithParams("UPDATE connections_log SET disconnected_at = ?, status = 'disconnected' WHERE disconnected_at IS NULL",
+                         {getCurrentTimestamp()});
+}
+
+void DatabaseManager::runMaintenance() {
+    const std::string chunk = " LIMIT 1000)";
+    
+    std::time_t cutoff_time = std::time(nullptr) - static_cast<std::time_t>(config_.log_retention_days) * 86400;
+    std::string cutoff = UrClock::formatSeconds(cutoff_time);
+    
+    std::string max_messages = std::to_string(config_.max_message_rows);
+    std::string max_connections = std::to_string(config_.max_connection_rows);
+    
+    // Open connections are never pruned
+    int messages = deleteInChunks("DELETE FROM messages WHERE id IN (SELECT id FROM messages WHERE timestamp < ?" + chunk,
+                                  {cutoff});
+    messages += deleteInChunks("DELETE FROM messages WHERE id IN (SELECT id FROM messages "
+                               "WHERE id <= (SELECT MAX(id) FROM messages) - ?" + chunk,
+                               {max_messages});
+    int connections = deleteInChunks("DELETE FROM connections_log WHERE id IN (SELECT id FROM connections_log "
+                                     "WHERE disconnected_at IS NOT NULL AND connected_at < ?" + chunk,
+                                     {cutoff});
+    connections += deleteInChunks("DELETE FROM connections_log WHERE id IN (SELECT id FROM connections_log "
+                                  "WHERE disconnected_at IS NOT NULL AND id <= (SELECT MAX(id) FROM connections_log) - ?" + chunk,
+                                  {max_connections});
+    
+    if (messages == 0 && connections == 0) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(db_mutex_);
+        // No-op unless the database was created with auto_vacuum=INCREMENTAL
+        executeSQL("PRAGMA incremental_vacuum");
+        executeSQL("PRAGMA wal_checkpoint(TRUNCATE)");
+    }
+    
+    BACKEND_LOG_INFO("[DatabaseManager] Maintenance pruned " << messages << " messages and "
+                     << connections << " connection rows");
+}
+
+// Deletes in bounded chunks so db_mutex_ is released between them and live
+// writes are never held up for the whole purge
+int DatabaseManager::deleteInChunks(const std::string& sql, const std::vector<std::string>& params) {
+    int total = 0;
+    
+    while (log_writer_running_) {
+        int changes = 0;
+        {
+            std::lock_guard<std::mutex> lock(db_mutex_);
+            if (!executeSQLWithParams(sql, params)) {
+                break;
+            }
+            changes = sqlite3_changes(db_);
+        }
+        
+        total += changes;
+        if (changes < 1000) {
+            break;
+        }
+    }
+    
+    return total;
+}
+
+void DatabaseManager::startLogWriter() {
+    last_maintenance_ = std::chrono::steady_clock::now();
+    log_queue_.reset(new BoundedMpscQueue<LogEntry>(static_cast<size_t>(config_.log_queue_capacity)));
+    log_writer_running_ = true;
+    log_writer_thread_ = std::thread(&DatabaseManager::logWriterLoop, this);
+}
+
+void DatabaseManager::stopLogWriter() {
+    if (!log_writer_thread_.joinable()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(log_wake_mutex_);
+        log_writer_running_ = false;
+    }
+    log_wake_cv_.notify_one();
+    log_writer_thread_.join();
+    
+    // Anything queued after the last pass is written before the database
+    // closes, a batch at a time until the queue is empty
+    while (flushLogEntries() > 0) {
+    }
+}
+
+void DatabaseManager::logWriterLoop() {
+    while (log_writer_running_) {
+        if (flushLogEntries() > 0) {
+            continue;
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_maintenance_ >= std::chrono::seconds(config_.maintenance_interval_seconds)) {
+            last_maintenance_ = now;
+            runMaintenance();
+        }
+        
+        // Producers notify without taking the mutex, so a wakeup can be missed;
+        // the timeout bounds how long such an entry waits
+        std::unique_lock<std::mutex> lock(log_wake_mutex_);
+        log_wake_cv_.wait_for(lock, std::chrono::milliseconds(200));
+    }
+}
+
+// Drains up to one batch from the queue inside a single transaction
+size_t DatabaseManager::flushLogEntries() {
+    const size_t max_batch = 256;
+    
+    std::vector<LogEntry> batch;
+    LogEntry entry;
+    while (batch.size() < max_batch && log_queue_->pop(entry)) {
+        batch.push_back(std::move(entry));
+    }
+    
+    if (batch.empty()) {
         return 0;
     }
     
+    UR_TRACE_SPAN("db.flushLogEntries");
+    UrMetrics::ScopedTimer timer(logFlushSeconds());
     std::lock_guard<std::mutex> lock(db_mutex_);
     
-    std::string sql = "SELECT COUNT(*) FROM connections_log WHERE status = 'connected' AND disconnected_at IS NULL";
-    sqlite3_stmt* stmt = nullptr;
+    if (!executeSQL("BEGIN IMMEDIATE")) {
+        logError("Failed to begin log batch transaction, dropping " + std::to_string(batch.size()) + " entries");
+        dropped_log_entries_.fetch_add(batch.size(), std::memory_order_relaxed);
+        return batch.size();
+    }
     
-    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        logError("Failed to prepare statement for active connection count");
-        return 0;
+    for (const auto& item : batch) {
+        writeLogEntry(item);
     }
     
-    int count = 0;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        count = sqlite3_column_int(stmt, 0);
+    if (!executeSQL("COMMIT")) {
+        executeSQL("ROLLBACK");
+        logError("Failed to commit log batch of " + std::to_string(batch.size()) + " entries");
+        dropped_log_entries_.fetch_add(batch.size(), std::memory_order_relaxed);
     }
     
-    sqlite3_finalize(stmt);
-    return count;
+    return batch.size();
+}
+
+bool DatabaseManager::writeLogEntry(const LogEntry& entry) {
+    switch (entry.kind) {
+    case LogEntry::Kind::Connect:
+        return executeSQLWithParams(
+            "INSERT INTO connections_log (connection_id, client_ip, status, connected_at) VALUES (?, ?, ?, ?)",
+            {entry.connection_id, entry.field1, entry.field2, entry.timestamp});
+    case LogEntry::Kind::Disconnect:
+        return executeSQLWithParams(
+            "UPDATE connections_log SET disconnected_at = ?, status = 'disconnected' WHERE connection_id = ? AND disconnected_at IS NULL",
+            {entry.timestamp, entry.connection_id});
+    case LogEntry::Kind::Message:
+        return executeSQLWithParams(
+            "INSERT INTO messages (connection_id, direction, message_text, timestamp) VALUES (?, ?, ?, ?)",
+            {entry.connection_id, entry.field1, entry.field2, entry.timestamp});
+    }
+    return false;
+}
+
+int DatabaseManager::getActiveConnectionCount() const {
+    if (!config_.enabled || db_ == nullptr) {
+        return 0;
+    }
+    
+    return active_connections_.load(std::memory_order_relaxed);
 }
 
 std::vector<std::string> DatabaseManager::getRecentConnections(int limit) const {
@@ -175,15 +565,14 @@ std::vector<std::string> DatabaseManager::getRecentConnections(int limit) const
         return connections;
     }
     
-    std::lock_guard<std::mutex> lock(db_mutex_);
-    
-    std::string sql = "SELECT connection_id, client_ip, status, connected_at FROM connections_log ORDER BY connected_at DESC LIMIT ?";
-    sqlite3_stmt* stmt = nullptr;
+    ReaderLease reader(*this);
     
-    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    sqlite3_stmt* stmt = reader.statement("SELECT connection_id, client_ip, status, connected_at FROM connections_log ORDER BY connected_at DESC LIMIT ?");
+    if (!stmt) {
         logError("Failed to prepare statement for recent connections");
         return connections;
     }
+    StatementReset reset(stmt);
     
     sqlite3_bind_int(stmt, 1, limit);
     
@@ -196,10 +585,69 @@ std::vector<std::string> DatabaseManager::getRecentConnections(int limit) const
         connections.push_back(oss.str());
     }
     
-    sqlite3_finalize(stmt);
     return connections;
 }
 
+bool DatabaseManager::migrateSchema() {
+    struct Migration {
+        int version;
+        const char* description;
+        bool (DatabaseManager::*apply)();
+    };
+    
+    // Append new steps here; never edit or reorder released ones
+    static const Migration migrations[] = {
+        {1, "base tables", &DatabaseManager::createTables},
+        {2, "drop invalid messages foreign key", &DatabaseManager::rebuildMessagesTable},
+        {3, "dashboard_data.data_msgpack", &DatabaseManager::upgradeDashboardTable}
+    };
+    const int latest = migrations[sizeof(migrations) / sizeof(migrations[0]) - 1].version;
+    
+    int version = 0;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    
+    if (version == latest) {
+        return true;
+    }
+    
+    if (version > latest) {
+        // Written by a newer build (e.g. after a firmware rollback); the tables
+        // this build uses are a subset, so carry on
+        BACKEND_LOG_INFO("[DatabaseManager] Schema version " << version << " is newer than "
+                         << latest << ", continuing");
+        return true;
+    }
+    
+    for (const auto& migration : migrations) {
+        if (migration.version <= version) {
+            continue;
+        }
+        
+        BACKEND_LOG_INFO("[DatabaseManager] Applying schema migration " << migration.version
+                         << " (" << migration.description << ")");
+        
+        if (!executeSQL("BEGIN IMMEDIATE")) {
+            return false;
+        }
+        
+        if (!(this->*migration.apply)() ||
+            !executeSQL("PRAGMA user_version = " + std::to_string(migration.version)) ||
+            !executeSQL("COMMIT")) {
+            executeSQL("ROLLBACK");
+            logError("Schema migration " + std::to_string(migration.version) + " failed");
+            return false;
+        }
+    }
+    
+    return true;
+}
+
 bool DatabaseManager::createDatabase() {
     // This is handled in initialize() now
     return true;
@@ -225,8 +673,7 @@ bool DatabaseManager::createTables() {
         "direction TEXT NOT NULL," // 'in' or 'out'
         "message_text TEXT,"
         "timestamp TEXT NOT NULL,"
-        "created_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
-        "FOREIGN KEY (connection_id) REFERENCES connections_log(connection_id)"
+        "created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
         ")",
         
         // Dashboard data table
@@ -234,6 +681,7 @@ bool DatabaseManager::createTables() {
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "category TEXT NOT NULL UNIQUE,"
         "data_json TEXT NOT NULL,"
+        "data_msgpack BLOB,"
         "updated_at TEXT NOT NULL,"
         "created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
         ")",
@@ -257,19 +705,10 @@ bool DatabaseManager::createTables() {
     return true;
 }
 
+// Called from the websocket threads without db_mutex_; UrClock keeps its
+// cache per thread
 std::string DatabaseManager::getCurrentTimestamp() const {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::tm tm = *std::localtime(&time_t);
-    
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    oss << "." << std::setfill('0') << std::setw(3) << ms.count();
-    
-    return oss.str();
+    return UrClock::timestampMillis();
 }
 
 bool DatabaseManager::executeSQL(const std::string& sql) {
@@ -286,74 +725,222 @@ bool DatabaseManager::executeSQL(const std::string& sql) {
 }
 
 bool DatabaseManager::executeSQLWithParams(const std::string& sql, const std::vector<std::string>& params) {
-    sqlite3_stmt* stmt = nullptr;
-    
-    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        logError("Failed to prepare statement: " + sql);
+    sqlite3_stmt* stmt = getStatement(sql);
+    if (!stmt) {
         return false;
     }
+    StatementReset reset(stmt);
     
-    // Bind parameters
+    // Bind parameters; params outlives the step, so no copy is needed
     for (size_t i = 0; i < params.size(); ++i) {
-        if (sqlite3_bind_text(stmt, static_cast<int>(i + 1), params[i].c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK) {
+        if (sqlite3_bind_text(stmt, static_cast<int>(i + 1), params[i].c_str(), -1, SQLITE_STATIC) != SQLITE_OK) {
             logError("Failed to bind parameter " + std::to_string(i + 1));
-            sqlite3_finalize(stmt);
             return false;
         }
     }
     
     // Execute statement
     int result = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
     
     return (result == SQLITE_DONE || result == SQLITE_ROW);
 }
 
-void DatabaseManager::logError(const std::string& message) const {
-    std::cerr << "[DatabaseManager] ERROR: " << message << std::endl;
+sqlite3_stmt* DatabaseManager::getStatement(const std::string& sql) const {
+    return prepareCached(db_, statement_cache_, sql);
 }
 
-bool DatabaseManager::updateDashboardData(const std::string& category, const std::string& data_json) {
+sqlite3_stmt* DatabaseManager::prepareCached(sqlite3* db, StatementCache& cache, const std::string& sql) const {
+    auto it = cache.find(sql);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+        logError("Failed to prepare statement: " + sql + " - SQLite error: " + std::string(sqlite3_errmsg(db)));
+        return nullptr;
+    }
+    
+    cache.emplace(sql, stmt);
+    return stmt;
+}
+
+void DatabaseManager::finalizeStatements(StatementCache& cache) {
+    for (auto& entry : cache) {
+        sqlite3_finalize(entry.second);
+    }
+    cache.clear();
+}
+
+bool DatabaseManager::execute(const std::string& sql) {
     if (!config_.enabled || db_ == nullptr) {
-        return true; // Silently ignore if disabled
+        return false;
     }
     
     std::lock_guard<std::mutex> lock(db_mutex_);
+    return executeSQL(sql);
+}
+
+bool DatabaseManager::executeWithParams(const std::string& sql, const std::vector<std::string>& params) {
+    if (!config_.enabled || db_ == nullptr) {
+        return false;
+    }
     
-    std::string sql = "INSERT OR REPLACE INTO dashboard_data (category, data_json, updated_at) VALUES (?, ?, ?)";
-    sqlite3_stmt* stmt = nullptr;
+    std::lock_guard<std::mutex> lock(db_mutex_);
+    return executeSQLWithParams(sql, params);
+}
+
+bool DatabaseManager::executeBatch(const std::string& sql, const std::vector<std::vector<std::string>>& rows) {
+    if (!config_.enabled || db_ == nullptr) {
+        return false;
+    }
     
-    int result = sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
-    if (result != SQLITE_OK) {
-        logError("Failed to prepare statement: " + sql + " - SQLite error: " + std::string(sqlite3_errmsg(db_)));
+    if (rows.empty()) {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> lock(db_mutex_);
+    
+    if (!executeSQL("BEGIN IMMEDIATE")) {
         return false;
     }
     
+    for (const auto& params : rows) {
+        if (!executeSQLWithParams(sql, params)) {
+            executeSQL("ROLLBACK");
+            return false;
+        }
+    }
+    
+    if (!executeSQL("COMMIT")) {
+        executeSQL("ROLLBACK");
+        return false;
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::executeTransaction(const std::vector<Statement>& statements) {
+    if (!config_.enabled || db_ == nullptr) {
+        return false;
+    }
+    
+    if (statements.empty()) {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> lock(db_mutex_);
+    
+    if (!executeSQL("BEGIN IMMEDIATE")) {
+        return false;
+    }
+    
+    for (const auto& statement : statements) {
+        if (!executeSQLWithParams(statement.first, statement.second)) {
+            executeSQL("ROLLBACK");
+            return false;
+        }
+    }
+    
+    if (!executeSQL("COMMIT")) {
+        executeSQL("ROLLBACK");
+        return false;
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::query(const std::string& sql, const std::vector<std::string>& params,
+                            const std::function<void(sqlite3_stmt*)>& row_handler) const {
+    if (!config_.enabled || db_ == nullptr) {
+        return false;
+    }
+    
+    ReaderLease reader(*this);
+    
+    sqlite3_stmt* stmt = reader.statement(sql);
+    if (!stmt) {
+        return false;
+    }
+    StatementReset reset(stmt);
+    
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (sqlite3_bind_text(stmt, static_cast<int>(i + 1), params[i].c_str(), -1, SQLITE_STATIC) != SQLITE_OK) {
+            logError("Failed to bind parameter " + std::to_string(i + 1));
+            return false;
+        }
+    }
+    
+    int result;
+    while ((result = sqlite3_step(stmt)) == SQLITE_ROW) {
+        row_handler(stmt);
+    }
+    
+    return result == SQLITE_DONE;
+}
+
+void DatabaseManager::logError(const std::string& message) const {
+    // Every write that fails takes this path; a failing disk gets one line per second
+    BACKEND_LOG_EVERY(LOG_ERROR, 1000, "[DatabaseManager] " << message);
+}
+
+bool DatabaseManager::updateDashboardData(const std::string& category, const std::string& data_json) {
+    UR_TRACE_SPAN("db.updateDashboardData");
+    
+    bool persisted = true;
+    if (config_.enabled && db_ != nullptr) {
+        std::lock_guard<std::mutex> lock(db_mutex_);
+        persisted = persistDashboardDataLocked(category, data_json, std::vector<uint8_t>(), getCurrentTimestamp());
+    }
+    
+    // Raw text bypasses the cache; drop the entry only once the new row is
+    // in SQLite, so a miss in between can't reload and re-cache the old one
+    if (persisted) {
+        std::unique_lock<std::shared_mutex> lock(cache_mutex_);
+        dashboard_cache_.erase(category);
+        dashboard_generation_.fetch_add(1, std::memory_order_release);
+    }
+    
+    return persisted;
+}
+
+// Stores either the JSON text or, when data_msgpack is non-empty, the
+// MessagePack snapshot (data_json is then left empty)
+bool DatabaseManager::persistDashboardDataLocked(const std::string& category, const std::string& data_json,
+                                                 const std::vector<uint8_t>& data_msgpack,
+                                                 const std::string& timestamp) {
+    sqlite3_stmt* stmt = getStatement("INSERT OR REPLACE INTO dashboard_data (category, data_json, data_msgpack, updated_at) VALUES (?, ?, ?, ?)");
+    if (!stmt) {
+        return false;
+    }
+    StatementReset reset(stmt);
+    
     // Bind parameters
-    if (sqlite3_bind_text(stmt, 1, category.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK) {
+    if (sqlite3_bind_text(stmt, 1, category.c_str(), -1, SQLITE_STATIC) != SQLITE_OK) {
         logError("Failed to bind category parameter: " + std::string(sqlite3_errmsg(db_)));
-        sqlite3_finalize(stmt);
         return false;
     }
     
-    if (sqlite3_bind_text(stmt, 2, data_json.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK) {
+    if (sqlite3_bind_text(stmt, 2, data_json.c_str(), -1, SQLITE_STATIC) != SQLITE_OK) {
         logError("Failed to bind data_json parameter: " + std::string(sqlite3_errmsg(db_)));
-        sqlite3_finalize(stmt);
         return false;
     }
     
-    std::string timestamp = getCurrentTimestamp();
-    if (sqlite3_bind_text(stmt, 3, timestamp.c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK) {
+    int blob_result = data_msgpack.empty()
+        ? sqlite3_bind_null(stmt, 3)
+        : sqlite3_bind_blob(stmt, 3, data_msgpack.data(), static_cast<int>(data_msgpack.size()), SQLITE_STATIC);
+    if (blob_result != SQLITE_OK) {
+        logError("Failed to bind data_msgpack parameter: " + std::string(sqlite3_errmsg(db_)));
+        return false;
+    }
+    
+    if (sqlite3_bind_text(stmt, 4, timestamp.c_str(), -1, SQLITE_STATIC) != SQLITE_OK) {
         logError("Failed to bind timestamp parameter: " + std::string(sqlite3_errmsg(db_)));
-        sqlite3_finalize(stmt);
         return false;
     }
     
     // Execute statement
-    result = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    if (result != SQLITE_DONE) {
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
         logError("Failed to execute statement: " + std::string(sqlite3_errmsg(db_)));
         return false;
     }
@@ -361,33 +948,154 @@ bool DatabaseManager::updateDashboardData(const std::string& category, const std
     return true;
 }
 
-std::string DatabaseManager::getDashboardData(const std::string& category) const {
-    if (!config_.enabled || db_ == nullptr) {
-        return "{}";
+bool DatabaseManager::updateDashboardData(const std::string& category, const json& data) {
+    return updateDashboardDataBatch({{category, data}});
+}
+
+bool DatabaseManager::updateDashboardDataBatch(const std::vector<std::pair<std::string, json>>& entries) {
+    if (entries.empty()) {
+        return true;
+    }
+    UR_TRACE_SPAN("db.updateDashboardData");
+    
+    // Only categories whose value actually changed are written; most ticks
+    // leave several of them (server, connection details) untouched
+    std::vector<const std::pair<std::string, json>*> changed;
+    {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex_);
+        for (const auto& entry : entries) {
+            auto it = dashboard_cache_.find(entry.first);
+            if (it == dashboard_cache_.end() || it->second != entry.second) {
+                changed.push_back(&entry);
+            }
+        }
     }
     
+    if (changed.empty()) {
+        return true;
+    }
+    
+    if (config_.enabled && db_ != nullptr && !persistDashboardBatch(changed)) {
+        return false;
+    }
+    
+    // The cache only takes values SQLite already holds, so a failed write
+    // is retried on the next tick rather than skipped as unchanged
+    std::unique_lock<std::shared_mutex> lock(cache_mutex_);
+    for (const auto* entry : changed) {
+        dashboard_cache_[entry->first] = entry->second;
+    }
+    dashboard_generation_.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool DatabaseManager::persistDashboardBatch(const std::vector<const std::pair<std::string, json>*>& changed) {
+    // Serialize outside the lock, then write every category in one transaction
+    std::vector<std::vector<uint8_t>> payloads;
+    payloads.reserve(changed.size());
+    for (const auto* entry : changed) {
+        payloads.push_back(json::to_msgpack(entry->second));
+    }
+    std::string timestamp = getCurrentTimestamp();
+    const std::string empty_text;
+    
+    UrMetrics::ScopedTimer timer(dashboardWriteSeconds());
     std::lock_guard<std::mutex> lock(db_mutex_);
     
-    std::string sql = "SELECT data_json FROM dashboard_data WHERE category = ?";
-    sqlite3_stmt* stmt = nullptr;
+    if (!executeSQL("BEGIN IMMEDIATE")) {
+        return false;
+    }
     
-    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        logError("Failed to prepare statement for dashboard data query");
+    for (size_t i = 0; i < changed.size(); ++i) {
+        if (!persistDashboardDataLocked(changed[i]->first, empty_text, payloads[i], timestamp)) {
+            executeSQL("ROLLBACK");
+            return false;
+        }
+    }
+    
+    if (!executeSQL("COMMIT")) {
+        executeSQL("ROLLBACK");
+        return false;
+    }
+    
+    return true;
+}
+
+bool DatabaseManager::getDashboardDataJson(const std::string& category, json& data) const {
+    {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex_);
+        auto it = dashboard_cache_.find(category);
+        if (it != dashboard_cache_.end()) {
+            data = it->second;
+            return true;
+        }
+    }
+    
+    // Cache miss (e.g. first request after startup): load from SQLite once.
+    // A write landing during the load may have dropped a newer entry, so the
+    // row is only cached if the generation hasn't moved
+    uint64_t generation = dashboard_generation_.load(std::memory_order_acquire);
+    if (!loadDashboardData(category, data) || (data.is_object() && data.empty())) {
+        return false;
+    }
+    
+    std::unique_lock<std::shared_mutex> lock(cache_mutex_);
+    if (dashboard_generation_.load(std::memory_order_relaxed) == generation) {
+        dashboard_cache_.emplace(category, data);
+    }
+    return true;
+}
+
+std::string DatabaseManager::getDashboardData(const std::string& category) const {
+    json data;
+    if (!loadDashboardData(category, data)) {
         return "{}";
     }
+    return data.dump();
+}
+
+// Decodes a dashboard_data row from whichever representation it was stored in
+bool DatabaseManager::loadDashboardData(const std::string& category, json& data) const {
+    if (!config_.enabled || db_ == nullptr) {
+        return false;
+    }
     
-    sqlite3_bind_text(stmt, 1, category.c_str(), -1, SQLITE_TRANSIENT);
+    UR_TRACE_SPAN("db.loadDashboardData");
+    UrMetrics::ScopedTimer timer(dashboardReadSeconds());
+    ReaderLease reader(*this);
     
-    std::string result = "{}";
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char* data = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        if (data) {
-            result = data;
+    sqlite3_stmt* stmt = reader.statement("SELECT data_json, data_msgpack FROM dashboard_data WHERE category = ?");
+    if (!stmt) {
+        logError("Failed to prepare statement for dashboard data query");
+        return false;
+    }
+    StatementReset reset(stmt);
+    
+    sqlite3_bind_text(stmt, 1, category.c_str(), -1, SQLITE_STATIC);
+    
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        return false;
+    }
+    
+    try {
+        if (sqlite3_column_type(stmt, 1) == SQLITE_BLOB) {
+            const uint8_t* blob = static_cast<const uint8_t*>(sqlite3_column_blob(stmt, 1));
+            int size = sqlite3_column_bytes(stmt, 1);
+            data = json::from_msgpack(blob, blob + size);
+            return true;
         }
+        
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        if (!text) {
+            return false;
+        }
+        data = json::parse(text);
+    } catch (const json::exception& e) {
+        logError("Failed to decode stored data for category " + category + ": " + e.what());
+        return false;
     }
     
-    sqlite3_finalize(stmt);
-    return result;
+    return true;
 }
 
 bool DatabaseManager::initializeDashboardTables() {
@@ -430,7 +1138,7 @@ bool DatabaseManager::verifyDatabaseSchema() {
             logError("Required table missing: " + table_name);
             
             // Try to create missing table
-            std::cout << "[DatabaseManager] Attempting to create missing table: " << table_name << std::endl;
+            BACKEND_LOG_INFO("[DatabaseManager] Attempting to create missing table: " << table_name);
             if (!createTables()) {
                 logError("Failed to create missing table: " + table_name);
                 return false;
@@ -438,7 +1146,7 @@ bool DatabaseManager::verifyDatabaseSchema() {
         }
     }
     
-    std::cout << "[DatabaseManager] Database schema verification passed" << std::endl;
+    BACKEND_LOG_INFO("[DatabaseManager] Database schema verification passed");
     return true;
 }
 
@@ -489,6 +1197,6 @@ bool DatabaseManager::testDatabaseOperations() {
     std::string cleanup_sql = "DELETE FROM dashboard_data WHERE category = 'test'";
     executeSQL(cleanup_sql);
     
-    std::cout << "[DatabaseManager] Database operations test passed" << std::endl;
+    BACKEND_LOG_INFO("[DatabaseManager] Database operations test passed");
     return true;
 }
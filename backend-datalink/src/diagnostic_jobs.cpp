@@ -0,0 +1,466 @@
+#include "diagnostic_jobs.h"
+#include "backend_log.h"
+#include "ThreadManager.hpp"
+#include <stdexcept>
+#include <utility>
+
+namespace BackendDatalink {
+
+namespace {
+
+struct Command {
+    std::string program;
+    std::vector<std::string> args;
+};
+
+// Host names, IPv4 and IPv6 literals. A leading '-' would read as an option.
+std::string hostField(const json& request, const char* key, bool required) {
+    if (!request.contains(key)) {
+        if (required) {
+            throw std::invalid_argument(std::string(key) + " is required");
+        }
+        return "";
+    }
+    if (!request[key].is_string()) {
+        throw std::invalid_argument(std::string(key) + " must be a host name or address");
+    }
+
+    const std::string& host = request[key].get_ref<const std::string&>();
+    bool valid = !host.empty() && host.size() <= 253 && host[0] != '-';
+    for (char c : host) {
+        valid = valid && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                          c == '.' || c == '-' || c == ':');
+    }
+    if (!valid) {
+        throw std::invalid_argument(std::string(key) + " must be a host name or address");
+    }
+    return host;
+}
+
+int intField(const json& request, const char* key, int fallback, int min, int max) {
+    if (!request.contains(key)) {
+        return fallback;
+    }
+    if (!request[key].is_number_integer() || request[key].get<int64_t>() < min || request[key].get<int64_t>() > max) {
+        throw std::invalid_argument(std::string(key) + " must be an integer between " + std::to_string(min) +
+                                    " and " + std::to_string(max));
+    }
+    return request[key].get<int>();
+}
+
+std::string choiceField(const json& request, const char* key, const std::vector<std::string>& choices) {
+    if (!request.contains(key)) {
+        return choices.front();
+    }
+    if (request[key].is_string()) {
+        for (const auto& choice : choices) {
+            if (request[key].get_ref<const std::string&>() == choice) {
+                return choice;
+            }
+        }
+    }
+
+    std::string list;
+    for (const auto& choice : choices) {
+        list += (list.empty() ? "" : ", ") + choice;
+    }
+    throw std::invalid_argument(std::string(key) + " must be one of " + list);
+}
+
+// {"host", "count": 1-100, "interval": 1-10 s, "size": bytes, "timeout": s
+// per reply, "continuous": until cancelled or the duration limit}
+Command pingCommand(const json& request) {
+    Command command{"ping", {"-n"}};
+    bool continuous = request.contains("continuous") && request["continuous"].is_boolean() &&
+                      request["continuous"].get<bool>();
+    if (!continuous) {
+        command.args.insert(command.args.end(), {"-c", std::to_string(intField(request, "count", 4, 1, 100))});
+    }
+    command.args.insert(command.args.end(), {
+        "-i", std::to_string(intField(request, "interval", 1, 1, 10)),
+        "-s", std::to_string(intField(request, "size", 56, 0, 65507)),
+        "-W", std::to_string(intField(request, "timeout", 2, 1, 30)),
+        hostField(request, "host", true)
+    });
+    return command;
+}
+
+// {"host", "max_hops": 1-64, "timeout": s per probe, "protocol": "udp" | "icmp" | "tcp"}
+Command tracerouteCommand(const json& request) {
+    Command command{"traceroute", {"-n", "-q", "1"}};
+    std::string protocol = choiceField(request, "protocol", {"udp", "icmp", "tcp"});
+    if (protocol == "icmp") {
+        command.args.push_back("-I");
+    } else if (protocol == "tcp") {
+        command.args.push_back("-T");
+    }
+    command.args.insert(command.args.end(), {
+        "-m", std::to_string(intField(request, "max_hops", 30, 1, 64)),
+        "-w", std::to_string(intField(request, "timeout", 3, 1, 30)),
+        hostField(request, "host", true)
+    });
+    return command;
+}
+
+// {"host", "record_type": "A" | "AAAA" | ..., "server": resolver to ask}
+Command dnsCommand(const json& request) {
+    std::string type = choiceField(request, "record_type",
+                                   {"A", "AAAA", "MX", "NS", "TXT", "CNAME", "SOA", "PTR", "SRV", "ANY"});
+    Command command{"nslookup", {"-type=" + type, "-timeout=5", hostField(request, "host", true)}};
+    std::string server = hostField(request, "server", false);
+    if (!server.empty()) {
+        command.args.push_back(server);
+    }
+    return command;
+}
+
+// {"host": iperf3 server, "port", "duration": 1-60 s, "direction": "download" | "upload"}.
+// --forceflush makes iperf3 print each interval as it ends even though its
+// stdout is a pipe.
+Command throughputCommand(const json& request) {
+    Command command{"iperf3", {
+        "-c", hostField(request, "host", true),
+        "-p", std::to_string(intField(request, "port", 5201, 1, 65535)),
+        "-t", std::to_string(intField(request, "duration", 10, 1, 60)),
+        "-f", "m",
+        "--forceflush"
+    }};
+    if (choiceField(request, "direction", {"download", "upload"}) == "download") {
+        command.args.push_back("-R");
+    }
+    return command;
+}
+
+Command buildCommand(const std::string& tool, const json& request) {
+    if (tool == "ping") {
+        return pingCommand(request);
+    }
+    if (tool == "traceroute") {
+        return tracerouteCommand(request);
+    }
+    if (tool == "dns") {
+        return dnsCommand(request);
+    }
+    if (tool == "throughput") {
+        return throughputCommand(request);
+    }
+    throw std::invalid_argument("tool must be one of ping, traceroute, dns, throughput");
+}
+
+int64_t unixSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+const size_t DiagnosticJobs::kMaxLineLength;
+constexpr std::chrono::seconds DiagnosticJobs::kStopGrace;
+
+DiagnosticJobs::DiagnosticJobs(Sender sender, size_t max_jobs, std::chrono::seconds max_duration)
+    : sender_(std::move(sender)), max_jobs_(max_jobs), max_duration_(max_duration),
+      processes_(std::make_unique<ThreadMgr::ThreadManager>(static_cast<unsigned int>(max_jobs))) {
+}
+
+DiagnosticJobs::~DiagnosticJobs() {
+    stop();
+    // The manager's I/O thread calls onOutput(), which needs mutex_
+    processes_.reset();
+}
+
+void DiagnosticJobs::start() {
+    if (supervisor_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    supervisor_ = std::thread(&DiagnosticJobs::supervise, this);
+}
+
+void DiagnosticJobs::stop() {
+    if (!supervisor_.joinable()) {
+        return;
+    }
+
+    std::vector<unsigned int> launched;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        for (auto& entry : jobs_) {
+            entry.second->muted = true;
+            if (entry.second->thread_id != 0) {
+                launched.push_back(entry.second->thread_id);
+            }
+        }
+        jobs_.clear();
+    }
+    cv_.notify_one();
+    supervisor_.join();
+
+    for (unsigned int thread_id : launched) {
+        try {
+            processes_->stopThread(thread_id);
+        } catch (const ThreadMgr::ThreadManagerException& e) {
+            BACKEND_LOG_DEBUG("[Diagnostics] " << e.what());
+        }
+    }
+}
+
+json DiagnosticJobs::startJob(ConnectionId connection_id, const json& request) {
+    if (!request.is_object() || !request.contains("tool") || !request["tool"].is_string()) {
+        throw std::invalid_argument("tool must be one of ping, traceroute, dns, throughput");
+    }
+    std::string tool = request["tool"].get<std::string>();
+    Command command = buildCommand(tool, request);
+
+    // The slot is taken before launching, so concurrent starts cannot pass
+    // the cap; the launch itself runs unlocked because the manager's I/O
+    // thread may be waiting for mutex_ in onOutput()
+    auto job = std::make_shared<Job>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            throw std::runtime_error("Diagnostics are not running");
+        }
+        if (jobs_.size() >= max_jobs_) {
+            throw std::runtime_error("At most " + std::to_string(max_jobs_) +
+                                     " diagnostics can run at once; cancel one first");
+        }
+        job->id = "diag-" + std::to_string(next_id_++);
+        job->connection_id = connection_id;
+        job->tool = tool;
+        job->started = std::chrono::steady_clock::now();
+        job->deadline = job->started + max_duration_;
+        jobs_[job->id] = job;
+    }
+
+    std::weak_ptr<Job> weak_job = job;
+    unsigned int thread_id = 0;
+    try {
+        // The manager keeps the handler until it is destroyed; once the job
+        // is gone it holds only an expired weak_ptr
+        thread_id = processes_->createProcess(command.program, command.args,
+            [this, weak_job](int stream, const char* data, size_t size) {
+                onOutput(weak_job, stream, data, size);
+            });
+    } catch (const ThreadMgr::ThreadManagerException& e) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.erase(job->id);
+        throw std::runtime_error("Could not start " + command.program + ": " + e.what());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->thread_id = thread_id;
+    }
+    cv_.notify_one();
+
+    std::string command_line = command.program;
+    for (const auto& arg : command.args) {
+        command_line += " " + arg;
+    }
+    BACKEND_LOG_INFO("[Diagnostics] " << job->id << " for " << connectionIdString(connection_id) << ": " << command_line);
+
+    return {
+        {"type", "diagnostic_started"},
+        {"job_id", job->id},
+        {"tool", tool},
+        {"command", command_line},
+        {"max_duration_seconds", max_duration_.count()},
+        {"timestamp", unixSeconds()}
+    };
+}
+
+bool DiagnosticJobs::cancelJob(ConnectionId connection_id, const std::string& job_id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = jobs_.find(job_id);
+        if (it == jobs_.end() || it->second->connection_id != connection_id) {
+            return false;
+        }
+        it->second->cancelled = true;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void DiagnosticJobs::cancelConnection(ConnectionId connection_id) {
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : jobs_) {
+            if (entry.second->connection_id == connection_id) {
+                entry.second->cancelled = true;
+                entry.second->muted = true;
+                found = true;
+            }
+        }
+    }
+    if (found) {
+        cv_.notify_one();
+    }
+}
+
+size_t DiagnosticJobs::activeJobs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size();
+}
+
+void DiagnosticJobs::onOutput(const std::weak_ptr<Job>& weak_job, int stream, const char* data, size_t size) {
+    std::shared_ptr<Job> job = weak_job.lock();
+    if (!job || (stream != 1 && stream != 2)) {
+        return;
+    }
+
+    // Only this (I/O) thread touches partial and lines until the streams close
+    std::string& partial = job->partial[stream - 1];
+    std::vector<std::string> lines;
+    if (data) {
+        partial.append(data, size);
+        size_t begin = 0;
+        for (size_t end = partial.find('\n'); end != std::string::npos; end = partial.find('\n', begin)) {
+            size_t length = end - begin;
+            if (length > 0 && partial[end - 1] == '\r') {
+                --length;
+            }
+            for (size_t offset = 0; offset < length || offset == 0; offset += kMaxLineLength) {
+                lines.emplace_back(partial, begin + offset, std::min(kMaxLineLength, length - offset));
+            }
+            begin = end + 1;
+        }
+        partial.erase(0, begin);
+        while (partial.size() >= kMaxLineLength) {
+            lines.emplace_back(partial, 0, kMaxLineLength);
+            partial.erase(0, kMaxLineLength);
+        }
+    } else if (!partial.empty()) {
+        lines.push_back(std::move(partial));
+        partial.clear();
+    }
+
+    bool muted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        muted = job->muted;
+    }
+    if (!muted) {
+        for (auto& line : lines) {
+            sender_(job->connection_id, {
+                {"type", "diagnostic_output"},
+                {"job_id", job->id},
+                {"stream", stream == 1 ? "stdout" : "stderr"},
+                {"line", std::move(line)},
+                {"seq", job->lines++}
+            });
+        }
+    }
+
+    // Closed only after the stream's last line went out, so diagnostic_done
+    // always follows it
+    if (!data) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --job->open_streams;
+        }
+        cv_.notify_one();
+    }
+}
+
+void DiagnosticJobs::finish(const std::shared_ptr<Job>& job) {
+    // Meaningful only when the tool exited on its own; a job stopped by
+    // cancel or the duration limit reports cancelled or timed_out instead
+    int exit_status = -1;
+    try {
+        if (processes_->joinThread(job->thread_id, std::chrono::seconds(1))) {
+            exit_status = processes_->getProcessExitStatus(job->thread_id);
+            processes_->releaseThread(job->thread_id);
+        }
+    } catch (const ThreadMgr::ThreadManagerException& e) {
+        BACKEND_LOG_WARN("[Diagnostics] " << job->id << ": " << e.what());
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - job->started;
+    BACKEND_LOG_INFO("[Diagnostics] " << job->id << " done, exit status " << exit_status
+                     << (job->cancelled ? " (cancelled)" : job->timed_out ? " (timed out)" : ""));
+
+    bool muted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        muted = job->muted;
+    }
+    if (muted) {
+        return;
+    }
+    sender_(job->connection_id, {
+        {"type", "diagnostic_done"},
+        {"job_id", job->id},
+        {"tool", job->tool},
+        {"exit_status", exit_status},
+        {"cancelled", job->cancelled},
+        {"timed_out", job->timed_out},
+        {"lines", job->lines},
+        {"duration_ms", std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()},
+        {"timestamp", unixSeconds()}
+    });
+}
+
+void DiagnosticJobs::supervise() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(250));
+        if (!running_) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::vector<unsigned int> to_stop;
+        std::vector<std::shared_ptr<Job>> finished;
+        for (auto it = jobs_.begin(); it != jobs_.end();) {
+            Job& job = *it->second;
+            if (job.thread_id == 0) {
+                ++it;  // Still launching
+                continue;
+            }
+
+            if (!job.stop_sent && (job.cancelled || now >= job.deadline)) {
+                job.timed_out = !job.cancelled;
+                job.stop_sent = true;
+                job.stop_sent_at = now;
+                to_stop.push_back(job.thread_id);
+            }
+
+            bool abandoned = job.stop_sent && now - job.stop_sent_at >= kStopGrace;
+            if (job.open_streams == 0 || abandoned) {
+                if (abandoned && job.open_streams > 0) {
+                    BACKEND_LOG_WARN("[Diagnostics] " << job.id << " output still open after stop; dropping it");
+                }
+                finished.push_back(it->second);
+                it = jobs_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (to_stop.empty() && finished.empty()) {
+            continue;
+        }
+
+        // stopThread() may wait out the SIGTERM grace period
+        lock.unlock();
+        for (unsigned int thread_id : to_stop) {
+            try {
+                processes_->stopThread(thread_id);
+            } catch (const ThreadMgr::ThreadManagerException& e) {
+                BACKEND_LOG_DEBUG("[Diagnostics] " << e.what());
+            }
+        }
+        for (const auto& job : finished) {
+            finish(job);
+        }
+        lock.lock();
+    }
+}
+
+} // namespace BackendDatalink
@@ -0,0 +1,466 @@
+#include "fleet_aggregator.h"
+#include "backend_log.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace BackendDatalink {
+
+constexpr std::chrono::seconds FleetAggregator::kStaleTimeout;
+constexpr std::chrono::seconds FleetAggregator::kConnectTimeout;
+
+namespace {
+
+// Reconnect delay: 1 s doubled per failure up to max_seconds, +-20 % so a
+// fleet that lost the same network does not come back in step
+long backoffMs(int failures, int max_seconds) {
+    static thread_local std::minstd_rand random(std::random_device{}());
+    long delay_ms = std::min<long>(static_cast<long>(max_seconds) * 1000,
+                                   1000L << std::min(failures - 1, 12));
+    std::uniform_real_distribution<double> jitter(0.8, 1.2);
+    return static_cast<long>(delay_ms * jitter(random));
+}
+
+uint64_t newEpoch() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+FleetAggregator::FleetAggregator(const ConfigLoader::FleetConfig& config, Sender sender)
+    : config_(config), sender_(std::move(sender)), epoch_(newEpoch()),
+      max_node_bytes_(static_cast<size_t>(config.max_node_kb) * 1024) {
+    client_.clear_access_channels(websocketpp::log::alevel::all);
+    client_.clear_error_channels(websocketpp::log::elevel::all);
+    client_.init_asio();
+    client_.set_open_handshake_timeout(std::chrono::duration_cast<std::chrono::milliseconds>(kConnectTimeout).count());
+
+    for (const auto& configured : config_.nodes) {
+        Node node;
+        node.name = configured.name;
+        node.url = configured.url;
+        nodes_.push_back(std::move(node));
+    }
+}
+
+FleetAggregator::~FleetAggregator() {
+    stop();
+}
+
+bool FleetAggregator::start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+    if (nodes_.empty()) {
+        BACKEND_LOG_WARN("[Fleet] No nodes configured");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    client_.start_perpetual();
+    thread_ = std::thread([this]() {
+        for (size_t index = 0; index < nodes_.size(); ++index) {
+            connect(index);
+        }
+        client_.set_timer(config_.publish_interval_ms, [this](const websocketpp::lib::error_code& ec) {
+            if (!ec) {
+                publish();
+            }
+        });
+        client_.run();
+    });
+    return true;
+}
+
+void FleetAggregator::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    client_.stop_perpetual();
+    client_.stop();
+    thread_.join();
+}
+
+void FleetAggregator::subscribe(ConnectionId connection_id, const std::vector<std::string>& nodes,
+                                uint64_t epoch, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Subscriber subscriber;
+    for (const auto& name : nodes) {
+        bool known = std::any_of(nodes_.begin(), nodes_.end(),
+                                 [&name](const Node& node) { return node.name == name; });
+        if (!known) {
+            throw std::invalid_argument("Unknown node: " + name);
+        }
+        subscriber.nodes.insert(name);
+    }
+    // Resume only from a frame of this process
+    if (epoch == epoch_ && generation <= generation_) {
+        subscriber.generation = generation;
+    }
+    subscribers_[connection_id] = std::move(subscriber);
+}
+
+bool FleetAggregator::unsubscribe(ConnectionId connection_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscribers_.erase(connection_id) > 0;
+}
+
+size_t FleetAggregator::heldBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t bytes = 0;
+    for (const auto& node : nodes_) {
+        bytes += node.bytes;
+    }
+    return bytes;
+}
+
+json FleetAggregator::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json nodes = json::array();
+    for (const auto& node : nodes_) {
+        nodes.push_back({
+            {"name", node.name},
+            {"url", node.url},
+            {"state", node.state},
+            {"error", node.error},
+            {"categories", node.values.size()},
+            {"bytes", node.bytes},
+            {"messages", node.messages},
+            {"resyncs", node.resyncs},
+            {"reconnects", node.reconnects}
+        });
+    }
+    return {
+        {"epoch", epoch_},
+        {"generation", generation_},
+        {"nodes", nodes},
+        {"subscribers", subscribers_.size()},
+        {"publish_interval_ms", config_.publish_interval_ms}
+    };
+}
+
+void FleetAggregator::connect(size_t index) {
+    std::string url;
+    uint64_t attempt;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        Node& node = nodes_[index];
+        attempt = ++node.attempt;
+        url = node.url;
+    }
+
+    websocketpp::lib::error_code ec;
+    Client::connection_ptr connection = client_.get_connection(url, ec);
+    if (ec) {
+        onClosed(index, attempt, ec.message());
+        return;
+    }
+    // Same content as JSON in about half the bytes, and no text to parse
+    connection->add_subprotocol("msgpack", ec);
+    connection->set_max_message_size(max_node_bytes_);
+    connection->set_open_handler([this, index, attempt](websocketpp::connection_hdl) {
+        onOpen(index, attempt);
+    });
+    connection->set_fail_handler([this, index, attempt](websocketpp::connection_hdl hdl) {
+        websocketpp::lib::error_code error;
+        Client::connection_ptr failed = client_.get_con_from_hdl(hdl, error);
+        onClosed(index, attempt, failed ? failed->get_ec().message() : "connection failed");
+    });
+    connection->set_close_handler([this, index, attempt](websocketpp::connection_hdl hdl) {
+        websocketpp::lib::error_code error;
+        Client::connection_ptr closed = client_.get_con_from_hdl(hdl, error);
+        std::string reason = "closed";
+        if (closed) {
+            reason = closed->get_remote_close_reason().empty() ? closed->get_ec().message()
+                                                               : closed->get_remote_close_reason();
+        }
+        onClosed(index, attempt, reason);
+    });
+    connection->set_message_handler([this, index, attempt](websocketpp::connection_hdl, Client::message_ptr message) {
+        onMessage(index, attempt, message);
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodes_[index].connection = connection->get_handle();
+    }
+    client_.connect(connection);
+}
+
+void FleetAggregator::onOpen(size_t index, uint64_t attempt) {
+    websocketpp::connection_hdl connection;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Node& node = nodes_[index];
+        if (node.attempt != attempt) {
+            return;
+        }
+        node.connected = true;
+        node.failures = 0;
+        node.last_message = std::chrono::steady_clock::now();
+        // Deltas that arrive before the get_dashboard_data reply are covered by it
+        node.resyncing.insert(config_.categories.begin(), config_.categories.end());
+        setState(node, "connected", std::string());
+        connection = node.connection;
+    }
+    BACKEND_LOG_INFO("[Fleet] Connected to " << nodes_[index].name);
+
+    sendToNode(connection, {{"type", "subscribe_updates"}, {"categories", config_.categories}});
+    sendToNode(connection, {{"type", "get_dashboard_data"}, {"categories", config_.categories}});
+}
+
+void FleetAggregator::onClosed(size_t index, uint64_t attempt, const std::string& error) {
+    long delay_ms;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Node& node = nodes_[index];
+        if (node.attempt != attempt || !running_) {
+            return;
+        }
+        // Handlers of this attempt that are still queued are now stale
+        ++node.attempt;
+        node.connected = false;
+        node.resyncing.clear();
+        ++node.failures;
+        ++node.reconnects;
+        setState(node, "disconnected", error);
+        delay_ms = backoffMs(node.failures, config_.reconnect_max_seconds);
+    }
+    BACKEND_LOG_EVERY(LOG_WARN, 60000, "[Fleet] " << nodes_[index].name << ": " << error
+                      << "; reconnecting in " << delay_ms << " ms");
+
+    client_.set_timer(delay_ms, [this, index](const websocketpp::lib::error_code& ec) {
+        if (!ec) {
+            connect(index);
+        }
+    });
+}
+
+void FleetAggregator::onMessage(size_t index, uint64_t attempt, Client::message_ptr message) {
+    json frame;
+    try {
+        if (message->get_opcode() == websocketpp::frame::opcode::binary) {
+            frame = json::from_msgpack(message->get_payload());
+        } else {
+            frame = json::parse(message->get_payload());
+        }
+    } catch (const json::exception& e) {
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[Fleet] Unreadable frame from " << nodes_[index].name << ": " << e.what());
+        return;
+    }
+    if (!frame.is_object() || !frame.contains("type") || !frame["type"].is_string()) {
+        return;
+    }
+    const std::string& type = frame["type"].get_ref<const std::string&>();
+
+    std::vector<std::string> resync;
+    websocketpp::connection_hdl connection;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Node& node = nodes_[index];
+        if (node.attempt != attempt) {
+            return;
+        }
+        node.last_message = std::chrono::steady_clock::now();
+        ++node.messages;
+        connection = node.connection;
+
+        if (type == "dashboard_data") {
+            if (!frame.contains("data") || !frame["data"].is_object()) {
+                return;
+            }
+            const json sequence = frame.value("sequence", json::object());
+            for (auto& entry : frame["data"].items()) {
+                if (!followed(entry.key())) {
+                    continue;
+                }
+                uint64_t seq = 0;
+                if (sequence.is_object() && sequence.contains(entry.key()) && sequence[entry.key()].is_number_unsigned()) {
+                    seq = sequence[entry.key()];
+                }
+                storeValue(node, entry.key(), std::move(entry.value()), seq);
+                node.resyncing.erase(entry.key());
+            }
+        } else if (type == "dashboard_update" || type == "dashboard_delta") {
+            if (!frame.contains("category") || !frame["category"].is_string() ||
+                !frame.contains("seq") || !frame["seq"].is_number_unsigned()) {
+                return;
+            }
+            std::string category = frame["category"];
+            uint64_t seq = frame["seq"];
+            if (!followed(category)) {
+                return;
+            }
+
+            if (type == "dashboard_update") {
+                storeValue(node, category, std::move(frame["data"]), seq);
+                node.resyncing.erase(category);
+            } else if (!node.resyncing.count(category)) {
+                auto value = node.values.find(category);
+                if (value != node.values.end() && value->second.oversize) {
+                    // Waits for the next full value; a reply would not fit either
+                } else if (value != node.values.end() && seq <= value->second.seq) {
+                    // Older than what is stored
+                } else if (value == node.values.end() || seq != value->second.seq + 1) {
+                    node.resyncing.insert(category);
+                    ++node.resyncs;
+                    resync.push_back(category);
+                } else {
+                    json data = std::move(value->second.data);
+                    data.merge_patch(frame["patch"]);
+                    storeValue(node, category, std::move(data), seq);
+                }
+            }
+        }
+    }
+
+    if (!resync.empty()) {
+        sendToNode(connection, {{"type", "get_dashboard_data"}, {"categories", resync}});
+    }
+}
+
+void FleetAggregator::sendToNode(websocketpp::connection_hdl connection, const json& message) {
+    websocketpp::lib::error_code ec;
+    client_.send(connection, message.dump(), websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[Fleet] Send failed: " << ec.message());
+    }
+}
+
+// Runs every publish_interval_ms. Subscribers that are at the same
+// generation with the same node list share one frame, which after the first
+// tick is nearly all of them.
+void FleetAggregator::publish() {
+    std::vector<std::pair<ConnectionId, json>> frames;
+    std::vector<websocketpp::connection_hdl> stale;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (auto& node : nodes_) {
+            if (node.connected && now - node.last_message > kStaleTimeout) {
+                stale.push_back(node.connection);
+            }
+        }
+
+        std::map<std::pair<uint64_t, std::set<std::string>>, json> built;
+        for (auto& entry : subscribers_) {
+            Subscriber& subscriber = entry.second;
+            if (subscriber.generation >= generation_) {
+                continue;
+            }
+
+            auto key = std::make_pair(subscriber.generation, subscriber.nodes);
+            auto frame = built.find(key);
+            if (frame == built.end()) {
+                uint64_t since = subscriber.generation;
+                json nodes = json::object();
+                for (const auto& node : nodes_) {
+                    if (!subscriber.nodes.empty() && !subscriber.nodes.count(node.name)) {
+                        continue;
+                    }
+                    json categories = json::object();
+                    json oversize = json::array();
+                    for (const auto& value : node.values) {
+                        if (value.second.generation > since) {
+                            categories[value.first] = value.second.data;
+                        }
+                        if (value.second.oversize) {
+                            oversize.push_back(value.first);
+                        }
+                    }
+                    if (since > 0 && node.state_generation <= since && categories.empty()) {
+                        continue;
+                    }
+                    json& out = nodes[node.name];
+                    out = {{"state", node.state}, {"categories", std::move(categories)}};
+                    if (!node.error.empty()) {
+                        out["error"] = node.error;
+                    }
+                    if (!oversize.empty()) {
+                        out["oversize"] = std::move(oversize);
+                    }
+                }
+                frame = built.emplace(key, json{
+                    {"type", "fleet_update"},
+                    {"epoch", epoch_},
+                    {"generation", generation_},
+                    {"full", since == 0},
+                    {"nodes", std::move(nodes)}
+                }).first;
+            }
+
+            subscriber.generation = generation_;
+            if (!frame->second["nodes"].empty()) {
+                frames.emplace_back(entry.first, frame->second);
+            }
+        }
+    }
+
+    for (const auto& frame : frames) {
+        sender_(frame.first, frame.second);
+    }
+    for (const auto& connection : stale) {
+        websocketpp::lib::error_code ec;
+        client_.close(connection, websocketpp::close::status::going_away, "no updates", ec);
+    }
+
+    client_.set_timer(config_.publish_interval_ms, [this](const websocketpp::lib::error_code& ec) {
+        if (!ec) {
+            publish();
+        }
+    });
+}
+
+bool FleetAggregator::storeValue(Node& node, const std::string& category, json data, uint64_t seq) {
+    Value& value = node.values[category];
+    size_t bytes = data.dump(-1, ' ', false, json::error_handler_t::replace).size();
+    size_t others = node.bytes - value.bytes;
+    value.seq = seq;
+    value.generation = ++generation_;
+    if (others + bytes > max_node_bytes_) {
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[Fleet] " << node.name << " " << category << " is " << bytes
+                          << " bytes, over the node's max_node_kb");
+        value.data = nullptr;
+        value.bytes = 0;
+        value.oversize = true;
+        node.bytes = others;
+        return false;
+    }
+    value.data = std::move(data);
+    value.bytes = bytes;
+    value.oversize = false;
+    node.bytes = others + bytes;
+    return true;
+}
+
+void FleetAggregator::setState(Node& node, const std::string& state, const std::string& error) {
+    if (node.state == state && node.error == error) {
+        return;
+    }
+    node.state = state;
+    node.error = error;
+    node.state_generation = ++generation_;
+}
+
+bool FleetAggregator::followed(const std::string& category) const {
+    return std::find(config_.categories.begin(), config_.categories.end(), category) != config_.categories.end();
+}
+
+} // namespace BackendDatalink
@@ -0,0 +1,143 @@
+#include "handler_executor.h"
+#include "backend_log.h"
+#include <exception>
+#include <utility>
+
+namespace BackendDatalink {
+
+HandlerExecutor::HandlerExecutor(size_t workers, size_t capacity)
+    : executor_(ThreadMgr::TaskExecutor::instance()), max_drains_(workers == 0 ? 1 : workers),
+      capacity_(capacity == 0 ? 1 : capacity) {
+}
+
+HandlerExecutor::~HandlerExecutor() {
+    stop();
+}
+
+bool HandlerExecutor::post(ConnectionId key, Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || pending_ >= capacity_) {
+            rejected_++;
+            return false;
+        }
+        Strand& strand = strands_[key];
+        strand.jobs.push_back(std::move(job));
+        pending_++;
+        if (strand.running || strand.jobs.size() > 1) {
+            return true;
+        }
+        ready_.push_back(key);
+        if (active_drains_ >= max_drains_) {
+            return true;    // A running drain picks it up
+        }
+        active_drains_++;
+    }
+    try {
+        executor_.post("ws-handler", [this]() { drain(); });
+    } catch (const std::exception& e) {
+        // The executor is shutting down. Give the slot back; a drain still
+        // running takes the job, and without one nothing would ever run
+        // what is waiting, so it is dropped
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[HandlerExecutor] Cannot schedule handlers: " << e.what());
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--active_drains_ > 0) {
+            return true;
+        }
+        rejected_ += pending_;
+        strands_.clear();
+        ready_.clear();
+        pending_ = 0;
+        idle_cv_.notify_all();
+        return false;
+    }
+    return true;
+}
+
+void HandlerExecutor::cancel(ConnectionId key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = strands_.find(key);
+    if (it == strands_.end()) {
+        return;
+    }
+    pending_ -= it->second.jobs.size();
+    it->second.jobs.clear();
+    if (!it->second.running) {
+        // Its entry in ready_ is skipped by the drain that pops it
+        strands_.erase(it);
+    }
+}
+
+void HandlerExecutor::stop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_ = true;
+    idle_cv_.wait(lock, [this]() { return active_drains_ == 0; });
+}
+
+size_t HandlerExecutor::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+void HandlerExecutor::drain() {
+    // A bounded batch per task keeps the RPC requests and other executor
+    // users from starving while handlers keep arriving
+    const int kBatch = 16;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (int ran = 0; ; ++ran) {
+        if (ran == kBatch) {
+            // Keep the slot and continue in a fresh task at the back of the
+            // line; should the executor refuse it, carry on here
+            lock.unlock();
+            try {
+                executor_.post("ws-handler", [this]() { drain(); });
+                return;
+            } catch (const std::exception&) {
+            }
+            lock.lock();
+            ran = 0;
+        }
+
+        if (ready_.empty()) {
+            active_drains_--;
+            if (active_drains_ == 0) {
+                idle_cv_.notify_all();
+            }
+            return;
+        }
+
+        ConnectionId key = ready_.front();
+        ready_.pop_front();
+        auto it = strands_.find(key);
+        if (it == strands_.end() || it->second.running || it->second.jobs.empty()) {
+            continue;   // Cancelled after it was queued
+        }
+        Job job = std::move(it->second.jobs.front());
+        it->second.jobs.pop_front();
+        it->second.running = true;
+        pending_--;
+
+        lock.unlock();
+        try {
+            job();
+        } catch (const std::exception& e) {
+            BACKEND_LOG_EVERY(LOG_ERROR, 1000, "[HandlerExecutor] Handler for " << connectionIdString(key) << " failed: " << e.what());
+        }
+        lock.lock();
+
+        // unordered_map iterators may not survive a rehash meanwhile
+        it = strands_.find(key);
+        if (it == strands_.end()) {
+            continue;
+        }
+        it->second.running = false;
+        if (it->second.jobs.empty()) {
+            strands_.erase(it);
+        } else {
+            // Behind the other keys waiting, not straight back to this one
+            ready_.push_back(key);
+        }
+    }
+}
+
+} // namespace BackendDatalink
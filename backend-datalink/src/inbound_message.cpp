@@ -0,0 +1,123 @@
+#include "inbound_message.h"
+
+namespace BackendDatalink {
+
+// SAX consumer behind scan(). Depth 1 is the inside of the top-level
+// object; routing fields are only taken from there.
+class InboundMessage::ScanHandler : public nlohmann::json_sax<nlohmann::json> {
+public:
+    ScanHandler(InboundMessage& message, size_t max_elements)
+        : message_(message), max_elements_(max_elements) {}
+
+    bool too_large = false;
+
+    bool null() override { return value(); }
+    bool boolean(bool) override { return value(); }
+    bool number_integer(number_integer_t) override { return value(); }
+    bool number_unsigned(number_unsigned_t) override { return value(); }
+    bool number_float(number_float_t, const string_t&) override { return value(); }
+    bool binary(binary_t&) override { return value(); }
+
+    bool string(string_t& text) override {
+        if (depth_ == 1 && !in_categories_) {
+            if (key_ == "type") {
+                message_.type_ = std::move(text);
+            } else if (key_ == "action") {
+                message_.action_ = std::move(text);
+            }
+        } else if (in_categories_ && depth_ == 2) {
+            message_.categories_.push_back(std::move(text));
+        }
+        return value();
+    }
+
+    bool start_object(std::size_t) override {
+        ++depth_;
+        return value();
+    }
+
+    bool key(string_t& name) override {
+        if (depth_ == 1) {
+            key_ = std::move(name);
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        --depth_;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        ++depth_;
+        if (depth_ == 2 && key_ == "categories") {
+            in_categories_ = true;
+            message_.has_categories_ = true;
+            message_.categories_.clear();
+        }
+        return value();
+    }
+
+    bool end_array() override {
+        if (depth_ == 2 && in_categories_) {
+            in_categories_ = false;
+        }
+        --depth_;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override {
+        return false;
+    }
+
+private:
+    InboundMessage& message_;
+    const size_t max_elements_;
+    int depth_ = 0;
+    bool in_categories_ = false;
+    std::string key_;
+
+    bool value() {
+        if (++message_.element_count_ > max_elements_ && max_elements_ > 0) {
+            too_large = true;
+            return false;
+        }
+        return true;
+    }
+};
+
+InboundMessage::InboundMessage(const std::string& payload, WireEncoding encoding)
+    : payload_(payload), encoding_(encoding) {
+}
+
+InboundMessage::ScanResult InboundMessage::scan(size_t max_elements) {
+    ScanHandler handler(*this, max_elements);
+
+    nlohmann::json::input_format_t format = nlohmann::json::input_format_t::json;
+    if (encoding_ == WireEncoding::MessagePack) {
+        format = nlohmann::json::input_format_t::msgpack;
+    } else if (encoding_ == WireEncoding::Cbor) {
+        format = nlohmann::json::input_format_t::cbor;
+    }
+
+    if (nlohmann::json::sax_parse(payload_, &handler, format)) {
+        return ScanResult::Ok;
+    }
+    return handler.too_large ? ScanResult::TooLarge : ScanResult::Malformed;
+}
+
+const message_json& InboundMessage::body() const {
+    if (!body_parsed_) {
+        if (encoding_ == WireEncoding::MessagePack) {
+            body_ = message_json::from_msgpack(payload_);
+        } else if (encoding_ == WireEncoding::Cbor) {
+            body_ = message_json::from_cbor(payload_);
+        } else {
+            body_ = message_json::parse(payload_);
+        }
+        body_parsed_ = true;
+    }
+    return body_;
+}
+
+} // namespace BackendDatalink
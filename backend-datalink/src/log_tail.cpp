@@ -0,0 +1,647 @@
+#include "log_tail.h"
+#include "backend_log.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <utility>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace BackendDatalink {
+
+constexpr std::chrono::seconds LogTail::kRescanInterval;
+
+namespace {
+
+const char* const kLevels[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+const int kLevelCount = sizeof(kLevels) / sizeof(kLevels[0]);
+const int kDefaultLevel = 2;    // INFO
+// A level word is looked for only near the start, where the prefixes put it
+const size_t kLevelSearchLength = 96;
+
+const uint32_t kDirectoryEvents = IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_DELETE;
+
+int levelIndex(const std::string& name) {
+    std::string upper;
+    for (char c : name) {
+        if (c != ' ') {
+            upper += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+    }
+    if (upper == "WARNING") {
+        return 3;
+    }
+    if (upper == "CRITICAL") {
+        return 5;
+    }
+    for (int i = 0; i < kLevelCount; ++i) {
+        if (upper == kLevels[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() &&
+           value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string baseName(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string parentDirectory(const std::string& path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos) {
+        return ".";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+std::string joinPath(const std::string& directory, const std::string& name) {
+    return directory == "/" ? "/" + name : directory + "/" + name;
+}
+
+} // namespace
+
+LogTail::LogTail(const ConfigLoader::LogTailConfig& config, Sender sender)
+    : config_(config), sender_(std::move(sender)) {}
+
+LogTail::~LogTail() {
+    stop();
+}
+
+bool LogTail::start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || wake_fd_ < 0) {
+        BACKEND_LOG_ERROR("[LogTail] Cannot set up inotify: " << std::strerror(errno));
+        for (int* fd : {&inotify_fd_, &wake_fd_}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        return false;
+    }
+    buffer_.resize(kReadChunk);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    thread_ = std::thread(&LogTail::run, this);
+    return true;
+}
+
+void LogTail::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake();
+    thread_.join();
+
+    for (auto& entry : files_) {
+        close(entry.second.fd);
+    }
+    files_.clear();
+    watches_.clear();
+    for (int* fd : {&inotify_fd_, &wake_fd_}) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+void LogTail::subscribe(ConnectionId connection_id, const Filter& filter) {
+    Subscriber subscriber;
+    subscriber.filter = filter;
+    subscriber.min_level = levelIndex(filter.min_level);
+    if (subscriber.min_level < 0) {
+        throw std::invalid_argument("Unknown level: " + filter.min_level);
+    }
+    subscriber.components.insert(filter.components.begin(), filter.components.end());
+    if (!filter.pattern.empty()) {
+        if (filter.pattern.size() > kMaxPatternLength) {
+            throw std::invalid_argument("pattern must be at most " + std::to_string(kMaxPatternLength) +
+                                        " characters");
+        }
+        try {
+            subscriber.pattern = std::regex(filter.pattern, std::regex::ECMAScript | std::regex::optimize);
+        } catch (const std::regex_error& e) {
+            throw std::invalid_argument(std::string("Invalid pattern: ") + e.what());
+        }
+        subscriber.has_pattern = true;
+    }
+    subscriber.tokens = config_.max_lines_per_second;
+    subscriber.refilled = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers_[connection_id] = std::move(subscriber);
+    }
+    wake();
+}
+
+bool LogTail::unsubscribe(ConnectionId connection_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscribers_.erase(connection_id) > 0;
+}
+
+json LogTail::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json subscribers = json::array();
+    for (const auto& entry : subscribers_) {
+        const Filter& filter = entry.second.filter;
+        subscribers.push_back({
+            {"connection_id", connectionIdString(entry.first)},
+            {"min_level", kLevels[entry.second.min_level]},
+            {"components", filter.components},
+            {"pattern", filter.pattern},
+            {"dropped", entry.second.dropped_total}
+        });
+    }
+    return {
+        {"files", followed_},
+        {"lines_read", lines_read_},
+        {"subscribers", subscribers},
+        {"max_lines_per_second", config_.max_lines_per_second},
+        {"batch_interval_ms", config_.batch_interval_ms}
+    };
+}
+
+void LogTail::wake() {
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        // The counter is already non-zero; the loop wakes anyway
+    }
+}
+
+void LogTail::run() {
+    for (const auto& path : config_.paths) {
+        addPath(path, false);
+    }
+    publishFollowed();
+
+    auto batch_interval = std::chrono::milliseconds(config_.batch_interval_ms);
+    auto now = std::chrono::steady_clock::now();
+    auto flush_at = now + batch_interval;
+    rescan_at_ = now + kRescanInterval;
+    for (;;) {
+        bool subscribed;
+        bool backlog_due = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) {
+                return;
+            }
+            subscribed = !subscribers_.empty();
+            for (const auto& entry : subscribers_) {
+                backlog_due = backlog_due || entry.second.backlog_due;
+            }
+        }
+        // Before any new lines, so a new subscriber's backlog ends exactly
+        // where its live lines start
+        if (backlog_due) {
+            sendBacklog();
+        }
+
+        now = std::chrono::steady_clock::now();
+        // Nothing to batch without subscribers
+        auto next = subscribed ? flush_at : now + kRescanInterval;
+        if (!missing_.empty()) {
+            next = std::min(next, rescan_at_);
+        }
+        pollfd fds[] = {{wake_fd_, POLLIN, 0}, {inotify_fd_, POLLIN, 0}};
+        int timeout_ms = static_cast<int>(std::max<int64_t>(
+            0, std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count()));
+
+        int ready = poll(fds, 2, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            BACKEND_LOG_EVERY(LOG_ERROR, 60000, "[LogTail] poll failed: " << std::strerror(errno));
+        } else if (ready > 0) {
+            if (fds[0].revents & POLLIN) {
+                uint64_t count;
+                if (read(wake_fd_, &count, sizeof(count)) < 0) {
+                    // Spurious wakeup
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                handleEvents();
+            }
+        }
+
+        now = std::chrono::steady_clock::now();
+        if (!missing_.empty() && now >= rescan_at_) {
+            std::vector<std::string> paths;
+            paths.swap(missing_);
+            for (const auto& path : paths) {
+                addPath(path, true);
+            }
+            publishFollowed();
+            rescan_at_ = now + kRescanInterval;
+        }
+        if (now >= flush_at) {
+            flush();
+            flush_at = now + batch_interval;
+        }
+    }
+}
+
+void LogTail::addPath(const std::string& path, bool from_start) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        missing_.push_back(path);
+        return;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        watchDirectory(path, std::string());
+        DIR* directory = opendir(path.c_str());
+        if (!directory) {
+            BACKEND_LOG_WARN("[LogTail] Cannot list " << path << ": " << std::strerror(errno));
+            return;
+        }
+        while (dirent* entry = readdir(directory)) {
+            std::string name = entry->d_name;
+            if (endsWith(name, ".log")) {
+                follow(joinPath(path, name), from_start);
+            }
+        }
+        closedir(directory);
+    } else if (S_ISREG(st.st_mode)) {
+        watchDirectory(parentDirectory(path), baseName(path));
+        follow(path, from_start);
+    } else {
+        BACKEND_LOG_WARN("[LogTail] " << path << " is neither a file nor a directory");
+    }
+}
+
+// inotify hands out one descriptor per directory, so a directory named both
+// on its own and as a file's parent shares one entry
+void LogTail::watchDirectory(const std::string& directory, const std::string& name) {
+    int wd = inotify_add_watch(inotify_fd_, directory.c_str(), kDirectoryEvents);
+    if (wd < 0) {
+        BACKEND_LOG_WARN("[LogTail] Cannot watch " << directory << ": " << std::strerror(errno));
+        return;
+    }
+    WatchedDirectory& watch = watches_[wd];
+    watch.path = directory;
+    if (name.empty()) {
+        watch.all_logs = true;
+    } else {
+        watch.names.insert(name);
+    }
+}
+
+void LogTail::follow(const std::string& path, bool from_start) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[LogTail] Cannot open " << path << ": " << std::strerror(errno));
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return;
+    }
+
+    auto it = files_.find(path);
+    if (it != files_.end()) {
+        if (it->second.inode == st.st_ino) {
+            close(fd);
+            return;
+        }
+        // Rotated: finish what was written to the old file first
+        readFile(it->second);
+        close(it->second.fd);
+        files_.erase(it);
+    }
+
+    TailedFile& file = files_[path];
+    file.path = path;
+    file.component = baseName(path);
+    if (endsWith(file.component, ".log")) {
+        file.component.resize(file.component.size() - 4);
+    }
+    file.fd = fd;
+    file.inode = st.st_ino;
+    file.offset = from_start ? 0 : st.st_size;
+    if (from_start) {
+        readFile(file);
+    }
+}
+
+void LogTail::handleEvents() {
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    for (;;) {
+        ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+            cursor += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost; whatever changed shows in the sizes
+                for (auto& entry : files_) {
+                    readFile(entry.second);
+                }
+                continue;
+            }
+            auto watch = watches_.find(event->wd);
+            if (watch == watches_.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                // The directory is gone; look for it again later
+                if (watch->second.all_logs) {
+                    missing_.push_back(watch->second.path);
+                }
+                for (const auto& name : watch->second.names) {
+                    missing_.push_back(joinPath(watch->second.path, name));
+                }
+                watches_.erase(watch);
+                continue;
+            }
+            if (!event->len) {
+                continue;
+            }
+            std::string name = event->name;
+            if (!(watch->second.all_logs && endsWith(name, ".log")) && !watch->second.names.count(name)) {
+                continue;
+            }
+
+            std::string path = joinPath(watch->second.path, name);
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                follow(path, true);
+                changed = true;
+            } else if (event->mask & IN_MODIFY) {
+                auto file = files_.find(path);
+                if (file != files_.end()) {
+                    readFile(file->second);
+                }
+            } else if (event->mask & IN_DELETE) {
+                auto file = files_.find(path);
+                if (file != files_.end()) {
+                    close(file->second.fd);
+                    files_.erase(file);
+                    changed = true;
+                }
+            }
+        }
+    }
+    if (changed) {
+        publishFollowed();
+    }
+}
+
+// A file renamed away (rotation) keeps its entry and descriptor until a new
+// file takes the name, so lines written before the writer reopens are kept
+void LogTail::readFile(TailedFile& file) {
+    struct stat st;
+    if (fstat(file.fd, &st) != 0) {
+        return;
+    }
+    // Truncated in place (copytruncate). Truncating and writing again
+    // between two reads can leave the file longer than before, but then the
+    // byte before the offset is rarely still the end of a line.
+    char last = '\n';
+    if (st.st_size < file.offset ||
+        (file.offset > 0 && file.partial.empty() && pread(file.fd, &last, 1, file.offset - 1) == 1 &&
+         last != '\n')) {
+        file.offset = 0;
+        file.partial.clear();
+    }
+    if (st.st_size == file.offset) {
+        return;
+    }
+
+    bool subscribed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribed = !subscribers_.empty();
+    }
+    if (!subscribed) {
+        file.offset = st.st_size;
+        file.partial.clear();
+        return;
+    }
+
+    off_t from = file.offset;
+    bool mid_line = false;
+    if (st.st_size - from > kMaxReadBytes) {
+        // Too far behind to be worth sending; only the last part is read
+        from = st.st_size - kMaxReadBytes;
+        file.partial.clear();
+        mid_line = true;
+    }
+    readLines(file.fd, from, st.st_size, file.partial, [this, &file, &mid_line](const std::string& line) {
+        if (mid_line) {
+            mid_line = false;
+            return;
+        }
+        matchLine(file, line);
+    });
+    file.offset = st.st_size;
+}
+
+void LogTail::readLines(int fd, off_t from, off_t to, std::string& partial,
+                        const std::function<void(const std::string& line)>& on_line) {
+    while (from < to) {
+        size_t wanted = static_cast<size_t>(std::min<off_t>(to - from, buffer_.size()));
+        ssize_t length = pread(fd, buffer_.data(), wanted, from);
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            return;
+        }
+        from += length;
+
+        const char* start = buffer_.data();
+        const char* end = start + length;
+        while (start < end) {
+            const char* newline = static_cast<const char*>(std::memchr(start, '\n', end - start));
+            const char* stop = newline ? newline : end;
+            size_t room = partial.size() < kMaxLineLength ? kMaxLineLength - partial.size() : 0;
+            partial.append(start, std::min<size_t>(stop - start, room));
+            if (!newline) {
+                break;
+            }
+            if (!partial.empty() && partial.back() == '\r') {
+                partial.pop_back();
+            }
+            if (!partial.empty()) {
+                on_line(partial);
+            }
+            partial.clear();
+            start = newline + 1;
+        }
+    }
+}
+
+void LogTail::matchLine(const TailedFile& file, const std::string& line) {
+    int level = parseLevel(line);
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++lines_read_;
+    for (auto& entry : subscribers_) {
+        Subscriber& subscriber = entry.second;
+        // Lines before the backlog is sent will be in it
+        if (subscriber.backlog_due || level < subscriber.min_level ||
+            (!subscriber.components.empty() && !subscriber.components.count(file.component)) ||
+            (subscriber.has_pattern && !std::regex_search(line, subscriber.pattern))) {
+            continue;
+        }
+
+        double elapsed = std::chrono::duration<double>(now - subscriber.refilled).count();
+        subscriber.tokens = std::min<double>(config_.max_lines_per_second,
+                                             subscriber.tokens + elapsed * config_.max_lines_per_second);
+        subscriber.refilled = now;
+        if (subscriber.tokens < 1) {
+            ++subscriber.dropped;
+            ++subscriber.dropped_total;
+            continue;
+        }
+        subscriber.tokens -= 1;
+        subscriber.lines.push_back({
+            {"component", file.component},
+            {"level", kLevels[level]},
+            {"text", line}
+        });
+    }
+}
+
+// The last backlog_lines matching lines of each file up to where it has been
+// read, file by file, as one frame per new subscriber
+void LogTail::sendBacklog() {
+    std::vector<std::pair<ConnectionId, Subscriber*>> due;
+    std::vector<std::pair<ConnectionId, json>> frames;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : subscribers_) {
+            if (entry.second.backlog_due) {
+                due.emplace_back(entry.first, &entry.second);
+            }
+        }
+
+        std::vector<std::deque<json>> found(due.size());
+        if (config_.backlog_lines > 0) {
+            for (auto& entry : files_) {
+                TailedFile& file = entry.second;
+                off_t from = std::max<off_t>(0, file.offset - kBacklogBytes);
+                std::string partial;
+                bool mid_line = from > 0;
+                readLines(file.fd, from, file.offset, partial, [&](const std::string& line) {
+                    if (mid_line) {
+                        mid_line = false;
+                        return;
+                    }
+                    int level = parseLevel(line);
+                    for (size_t i = 0; i < due.size(); ++i) {
+                        const Subscriber& subscriber = *due[i].second;
+                        if (level < subscriber.min_level ||
+                            (!subscriber.components.empty() && !subscriber.components.count(file.component)) ||
+                            (subscriber.has_pattern && !std::regex_search(line, subscriber.pattern))) {
+                            continue;
+                        }
+                        found[i].push_back({
+                            {"component", file.component},
+                            {"level", kLevels[level]},
+                            {"text", line}
+                        });
+                        if (found[i].size() > static_cast<size_t>(config_.backlog_lines)) {
+                            found[i].pop_front();
+                        }
+                    }
+                });
+            }
+        }
+
+        for (size_t i = 0; i < due.size(); ++i) {
+            due[i].second->backlog_due = false;
+            frames.emplace_back(due[i].first, json{
+                {"type", "logs"},
+                {"backlog", true},
+                {"lines", json(std::vector<json>(found[i].begin(), found[i].end()))},
+                {"dropped", 0}
+            });
+        }
+    }
+
+    for (const auto& frame : frames) {
+        sender_(frame.first, frame.second);
+    }
+}
+
+void LogTail::flush() {
+    std::vector<std::pair<ConnectionId, json>> frames;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : subscribers_) {
+            Subscriber& subscriber = entry.second;
+            if (subscriber.lines.empty() && !subscriber.dropped) {
+                continue;
+            }
+            frames.emplace_back(entry.first, json{
+                {"type", "logs"},
+                {"lines", std::move(subscriber.lines)},
+                {"dropped", subscriber.dropped}
+            });
+            subscriber.lines = json::array();
+            subscriber.dropped = 0;
+        }
+    }
+
+    for (const auto& frame : frames) {
+        sender_(frame.first, frame.second);
+    }
+}
+
+void LogTail::publishFollowed() {
+    std::vector<std::string> followed;
+    for (const auto& entry : files_) {
+        followed.push_back(entry.first);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    followed_.swap(followed);
+}
+
+int LogTail::parseLevel(const std::string& line) {
+    size_t limit = std::min(line.size(), kLevelSearchLength);
+    for (size_t open = line.find('['); open < limit; open = line.find('[', open + 1)) {
+        size_t close = line.find(']', open + 1);
+        if (close == std::string::npos || close - open > 10) {
+            continue;
+        }
+        int level = levelIndex(line.substr(open + 1, close - open - 1));
+        if (level >= 0) {
+            return level;
+        }
+    }
+    return kDefaultLevel;
+}
+
+} // namespace BackendDatalink
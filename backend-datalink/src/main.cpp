@@ -6,6 +6,9 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <algorithm>
+#include <functional>
+#include <malloc.h>
 #include <nlohmann/json.hpp>
 #include "managed_websocket_server.h"
 #include "database_manager.h"
@@ -13,8 +16,36 @@
 #include "NetworkPriorityManager.h"
 #include "config_loader.h"
 #include "rpc_client.h"
+#include "rpc_methods.h"
+#include "ur-rpc-template.hpp"
+#include "dashboard_delta.h"
+#include "metrics_history.h"
+#include "telemetry_publisher.h"
+#include "ultima_health_probe.h"
+#include "metrics_exporter.h"
+#include "pipeline_stage.h"
+#include "single_flight.h"
+#include "diagnostic_jobs.h"
+#include "camera_discovery.h"
+#include "mavlink_bridge.h"
+#include "wireless_scanner.h"
+#include "vpn_monitor.h"
+#include "log_tail.h"
+#include "fleet_aggregator.h"
+#include "startup_orchestrator.h"
+#include "collector_governor.h"
+#include "memory_budget.h"
+#include "handler_executor.h"
+#include "ur-metrics/ur_metrics.hpp"
+#include "ur-trace/ur_trace.hpp"
+#include "backend_log.h"
 
 using json = nlohmann::json;
+using BackendDatalink::message_json;
+using BackendDatalink::InboundMessage;
+using BackendDatalink::ConnectionId;
+using BackendDatalink::connectionIdString;
+using BackendDatalink::Transport;
 
 namespace BackendDatalink {
 
@@ -24,7 +55,23 @@ std::unique_ptr<SystemDataCollector> g_system_collector;
 std::unique_ptr<NetworkPriorityManager> g_network_priority_manager;
 std::unique_ptr<BackendDatalink::RpcClient> g_rpcClient;
 std::unique_ptr<BackendDatalink::RpcOperationProcessor> g_operationProcessor;
+DashboardDeltaEngine g_dashboard_delta;
+std::unique_ptr<MetricsHistory> g_metrics_history;
+std::unique_ptr<DiagnosticJobs> g_diagnostics;
+std::unique_ptr<CameraDiscovery> g_camera_discovery;
+std::unique_ptr<MavlinkBridge> g_mavlink;
+std::unique_ptr<WirelessScanner> g_wireless_scanner;
+std::unique_ptr<VpnMonitor> g_vpn_monitor;
+std::unique_ptr<LogTail> g_log_tail;
+std::unique_ptr<FleetAggregator> g_fleet;
+std::unique_ptr<CollectorGovernor> g_collector_governor;
+std::unique_ptr<MemoryBudget> g_memory_budget;
+std::unique_ptr<HandlerExecutor> g_handler_executor;
+RpcMethodRegistry g_rpc_methods;
+RequestRouter g_request_router(g_rpc_methods);
 std::atomic<bool> g_running(true);
+std::atomic<bool> g_reload_requested(false);
+std::atomic<bool> g_snapshot_on_connect(true);
 
 } // namespace BackendDatalink
 
@@ -35,23 +82,50 @@ using BackendDatalink::g_system_collector;
 using BackendDatalink::g_network_priority_manager;
 using BackendDatalink::g_rpcClient;
 using BackendDatalink::g_operationProcessor;
+using BackendDatalink::g_dashboard_delta;
+using BackendDatalink::g_metrics_history;
+using BackendDatalink::g_diagnostics;
+using BackendDatalink::g_camera_discovery;
+using BackendDatalink::g_mavlink;
+using BackendDatalink::g_wireless_scanner;
+using BackendDatalink::g_vpn_monitor;
+using BackendDatalink::g_log_tail;
+using BackendDatalink::g_fleet;
+using BackendDatalink::g_collector_governor;
+using BackendDatalink::g_memory_budget;
+using BackendDatalink::g_handler_executor;
+using BackendDatalink::g_rpc_methods;
+using BackendDatalink::g_request_router;
 using BackendDatalink::g_running;
+using BackendDatalink::g_reload_requested;
+using BackendDatalink::g_snapshot_on_connect;
 
 // Use RPC types for convenience
 using RpcClient = BackendDatalink::RpcClient;
 using RpcOperationProcessor = BackendDatalink::RpcOperationProcessor;
 
 // Function declarations
-void onMessage(const std::string& connection_id, const json& message);
-void onConnectionOpen(const std::string& connection_id);
-void onConnectionClose(const std::string& connection_id);
-void handleDashboardDataRequest(const std::string& connection_id, const json& message);
-void handleSubscribeUpdates(const std::string& connection_id, const json& message);
-void handleNetworkPriorityRequest(const std::string& connection_id, const json& message);
-void broadcastDashboardUpdate(const std::string& category, const json& data);
-void updateSystemDataInDatabase();
-
-void handleNetworkPriorityRequest(const std::string& connection_id, const json& message) {
+void onMessage(ConnectionId connection_id, const InboundMessage& message);
+void onConnectionOpen(ConnectionId connection_id);
+void onConnectionClose(ConnectionId connection_id);
+void handleDashboardDataRequest(ConnectionId connection_id, const InboundMessage& message);
+std::shared_ptr<const SharedMessage> buildDashboardDataReply(const std::vector<std::string>* categories);
+void handleSubscribeUpdates(ConnectionId connection_id, const InboundMessage& message);
+void handleNetworkPriorityRequest(ConnectionId connection_id, const InboundMessage& message);
+void handleMetricsHistoryRequest(ConnectionId connection_id, const InboundMessage& message);
+void handleHistoryAggregateRequest(ConnectionId connection_id, const InboundMessage& message);
+void handleDiagnosticRequest(ConnectionId connection_id, const InboundMessage& message);
+void handleCameraDiscoveryRequest(ConnectionId connection_id, const InboundMessage& message);
+void handleMavlinkRequest(ConnectionId connection_id, const InboundMessage& message);
+void handleWirelessScanRequest(ConnectionId connection_id, const InboundMessage& message);
+void handleLogsRequest(ConnectionId connection_id, const InboundMessage& message);
+void handleFleetRequest(ConnectionId connection_id, const InboundMessage& message);
+void broadcastDashboardUpdate(DashboardCategory category, const json& data);
+void persistSystemData();
+void broadcastSystemData();
+void publishThreadStats();
+
+void handleNetworkPriorityRequest(ConnectionId connection_id, const InboundMessage& message) {
     if (!g_network_priority_manager) {
         json error_response = {
             {"type", "error"},
@@ -67,74 +141,13 @@ void handleNetworkPriorityRequest(const std::string& connection_id, const json&
     }
     
     try {
-        std::string action = message.value("action", "");
+        const std::string& action = message.action();
         json response_data;
         
-        if (action == "get_data") {
-            // Return all network priority data
-            response_data = g_network_priority_manager->getAllDataAsJson();
-        } else if (action == "set_interface_priority") {
-            // Set interface priority
-            std::string interface_name = message.value("interface_name", "");
-            int priority = message.value("priority", 0);
-            
-            bool success = g_network_priority_manager->setInterfacePriority(interface_name, priority);
-            response_data = {
-                {"success", success},
-                {"message", success ? "Interface priority updated" : "Failed to update interface priority"}
-            };
-        } else if (action == "add_routing_rule") {
-            // Add routing rule
-            RoutingRule rule;
-            rule.destination = message.value("destination", "");
-            rule.gateway = message.value("gateway", "");
-            rule.interface = message.value("interface", "");
-            rule.metric = message.value("metric", 100);
-            rule.priority = message.value("priority", 1);
-            
-            bool success = g_network_priority_manager->addRoutingRule(rule);
-            response_data = {
-                {"success", success},
-                {"message", success ? "Routing rule added" : "Failed to add routing rule"}
-            };
-        } else if (action == "update_routing_rule") {
-            // Update routing rule
-            std::string rule_id = message.value("rule_id", "");
-            RoutingRule rule;
-            rule.destination = message.value("destination", "");
-            rule.gateway = message.value("gateway", "");
-            rule.interface = message.value("interface", "");
-            rule.metric = message.value("metric", 100);
-            rule.priority = message.value("priority", 1);
-            
-            bool success = g_network_priority_manager->updateRoutingRule(rule_id, rule);
-            response_data = {
-                {"success", success},
-                {"message", success ? "Routing rule updated" : "Failed to update routing rule"}
-            };
-        } else if (action == "delete_routing_rule") {
-            // Delete routing rule
-            std::string rule_id = message.value("rule_id", "");
-            bool success = g_network_priority_manager->deleteRoutingRule(rule_id);
-            response_data = {
-                {"success", success},
-                {"message", success ? "Routing rule deleted" : "Failed to delete routing rule"}
-            };
-        } else if (action == "apply_configuration") {
-            // Apply all configuration changes
-            bool success = g_network_priority_manager->applyRoutingConfiguration();
-            response_data = {
-                {"success", success},
-                {"message", success ? "Configuration applied" : "Failed to apply configuration"}
-            };
-        } else if (action == "reset_to_defaults") {
-            // Reset to default configuration
-            bool success = g_network_priority_manager->resetToDefaults();
-            response_data = {
-                {"success", success},
-                {"message", success ? "Reset to defaults" : "Failed to reset to defaults"}
-            };
-        } else {
+        // Same handlers as the MQTT "network_priority.<action>" methods
+        try {
+            response_data = g_request_router.invoke(Transport::WebSocket, "network_priority." + action, json(message.body()));
+        } catch (const BackendDatalink::UnknownMethodError&) {
             response_data = {
                 {"error", "Unknown action: " + action}
             };
@@ -153,7 +166,7 @@ void handleNetworkPriorityRequest(const std::string& connection_id, const json&
         }
         
     } catch (const std::exception& e) {
-        std::cerr << "Error handling network priority request: " << e.what() << std::endl;
+        BACKEND_LOG_ERROR("Error handling network priority request: " << e.what());
         
         json error_response = {
             {"type", "error"},
@@ -191,6 +204,298 @@ void signalHandler(int signal) {
     exit(0);
 }
 
+// SIGTERM with websocket.drain_seconds set: the main loop drains the server
+// while the next process (or systemd's socket) takes new clients, then
+// shuts down as usual
+void drainSignalHandler(int) {
+    g_running.store(false);
+}
+
+// SIGHUP: the main loop reloads the configuration file
+void reloadSignalHandler(int) {
+    g_reload_requested.store(true);
+}
+
+// How often the collector governor looks at demand and load
+const uint64_t kGovernorIntervalMs = 2000;
+
+BackendDatalink::CollectorGovernor::Settings governorSettings(const ConfigLoader::SystemDataConfig& config) {
+    BackendDatalink::CollectorGovernor::Settings settings;
+    settings.idleSlowdown = config.idle_slowdown;
+    settings.loadSlowdown = config.load_slowdown;
+    settings.loadPerCpu = config.load_backoff_per_cpu;
+    settings.cpuPressurePercent = config.cpu_pressure_backoff_percent;
+    return settings;
+}
+
+ReachabilityProber::Settings reachabilitySettings(const ConfigLoader::NetworkPriorityConfig& config) {
+    ReachabilityProber::Settings settings;
+    settings.targets = config.reachability_targets;
+    settings.interval_ms = config.reachability_interval_ms;
+    settings.timeout_ms = config.reachability_timeout_ms;
+    settings.down_after = config.reachability_down_after;
+    settings.up_after = config.reachability_up_after;
+    return settings;
+}
+
+FailoverSettings failoverSettings(const ConfigLoader::NetworkPriorityConfig& config) {
+    FailoverSettings settings;
+    settings.enabled = config.failover_enabled;
+    settings.restore_hold_ms = config.failover_restore_hold_ms;
+    settings.max_latency_ms = config.failover_max_latency_ms;
+    return settings;
+}
+
+// How often the memory budget looks at the resident set
+const uint64_t kMemoryCheckIntervalMs = 1000;
+
+BackendDatalink::MemoryBudget::Settings memoryBudgetSettings(const ConfigLoader::MemoryBudgetConfig& config) {
+    BackendDatalink::MemoryBudget::Settings settings;
+    settings.softLimitBytes = static_cast<size_t>(config.soft_limit_mb) * 1024 * 1024;
+    settings.hardLimitBytes = static_cast<size_t>(config.hard_limit_mb) * 1024 * 1024;
+    return settings;
+}
+
+BackendDatalink::MemoryBudget::Level memoryLevel() {
+    return g_memory_budget ? g_memory_budget->level() : BackendDatalink::MemoryBudget::Level::Normal;
+}
+
+// The broadcast stage's pace, slowed down while memory is short
+std::chrono::milliseconds broadcastInterval(const ConfigLoader& config, BackendDatalink::MemoryBudget::Level level) {
+    int interval_ms = config.getSystemDataConfig().broadcast_min_interval_ms;
+    if (level != BackendDatalink::MemoryBudget::Level::Normal) {
+        interval_ms *= config.getMemoryBudgetConfig().broadcast_slowdown;
+    }
+    return std::chrono::milliseconds(interval_ms);
+}
+
+// The degrade modes of a memory budget level; Normal undoes them
+void applyMemoryLevel(const ConfigLoader& config, BackendDatalink::MemoryBudget::Level level,
+                      BackendDatalink::PipelineStage* broadcast_stage) {
+    bool degraded = level != BackendDatalink::MemoryBudget::Level::Normal;
+    if (g_metrics_history) {
+        int capacity = config.getMetricsHistoryConfig().ring_capacity *
+                       config.getMemoryBudgetConfig().history_ring_percent / 100;
+        g_metrics_history->resizeRing(degraded ? static_cast<size_t>(std::max(1, capacity)) : 0);
+    }
+    if (broadcast_stage) {
+        broadcast_stage->setMinInterval(broadcastInterval(config, level));
+    }
+    if (g_server) {
+        g_server->setAdmissionClosed(level == BackendDatalink::MemoryBudget::Level::Hard);
+    }
+#ifdef __GLIBC__
+    // Freed heap stays resident until glibc is asked to give it back
+    if (degraded) {
+        malloc_trim(0);
+    }
+#endif
+}
+
+// Hands the settings that can change while running to their subsystems;
+// the others are reported and wait for a restart
+void applyReloadedConfig(const ConfigLoader& previous, const ConfigLoader& next,
+                         BackendDatalink::PipelineStage* persist_stage, BackendDatalink::PipelineStage* broadcast_stage,
+                         UrRpc::Timer& thread_stats_timer, const std::function<void()>& thread_stats_tick) {
+    const auto& old_system = previous.getSystemDataConfig();
+    const auto& new_system = next.getSystemDataConfig();
+    if (g_system_collector) {
+        if (new_system.poll_interval_seconds != old_system.poll_interval_seconds) {
+            g_system_collector->setPollInterval(new_system.poll_interval_seconds);
+            std::cout << "[Config] Poll interval now " << new_system.poll_interval_seconds << "s" << std::endl;
+        }
+        g_system_collector->setCollectionProgressLogInterval(new_system.collection_progress_log_interval);
+        g_system_collector->setLatencyProbeTimeout(new_system.latency_timeout_ms);
+    }
+    if (g_collector_governor) {
+        g_collector_governor->setSettings(governorSettings(new_system));
+    }
+    if (new_system.database_update_interval_seconds != old_system.database_update_interval_seconds) {
+        uint64_t interval_ms = static_cast<uint64_t>(new_system.database_update_interval_seconds) * 1000;
+        if (persist_stage) {
+            persist_stage->setMinInterval(std::chrono::milliseconds(interval_ms));
+        }
+        thread_stats_timer.start(interval_ms, interval_ms, thread_stats_tick);
+        std::cout << "[Config] Database update interval now " << new_system.database_update_interval_seconds
+                  << "s" << std::endl;
+    }
+    if (new_system.broadcast_min_interval_ms != old_system.broadcast_min_interval_ms) {
+        if (broadcast_stage) {
+            broadcast_stage->setMinInterval(broadcastInterval(next, memoryLevel()));
+        }
+        std::cout << "[Config] Broadcast interval now " << new_system.broadcast_min_interval_ms << "ms" << std::endl;
+    }
+    if (new_system.enabled != old_system.enabled ||
+        new_system.collector_intervals_ms != old_system.collector_intervals_ms ||
+        new_system.latency_targets != old_system.latency_targets ||
+        new_system.latency_window != old_system.latency_window ||
+        new_system.external_ip_endpoints != old_system.external_ip_endpoints ||
+        new_system.modem_device != old_system.modem_device ||
+        new_system.modem_data_interface != old_system.modem_data_interface ||
+        new_system.process_top_count != old_system.process_top_count ||
+        new_system.watched_processes != old_system.watched_processes ||
+        new_system.storage_mounts != old_system.storage_mounts ||
+        new_system.shared_memory_name != old_system.shared_memory_name) {
+        std::cout << "[Config] system_data collectors, latency targets and window, external IP endpoints, modem, process lists, storage mounts and shared memory apply after a restart" << std::endl;
+    }
+    
+    if (g_memory_budget) {
+        const auto& old_budget = previous.getMemoryBudgetConfig();
+        const auto& new_budget = next.getMemoryBudgetConfig();
+        g_memory_budget->setSettings(memoryBudgetSettings(new_budget));
+        if (new_budget.soft_limit_mb != old_budget.soft_limit_mb || new_budget.hard_limit_mb != old_budget.hard_limit_mb) {
+            std::cout << "[Config] Memory budget now soft " << new_budget.soft_limit_mb << " MB, hard "
+                      << new_budget.hard_limit_mb << " MB" << std::endl;
+        }
+        // A degraded process takes the new ring share and slowdown at once
+        if (memoryLevel() != BackendDatalink::MemoryBudget::Level::Normal) {
+            applyMemoryLevel(next, memoryLevel(), broadcast_stage);
+        }
+    }
+    
+    const auto& old_telemetry = previous.getTelemetryConfig();
+    const auto& new_telemetry = next.getTelemetryConfig();
+    if (new_telemetry.enabled != old_telemetry.enabled || new_telemetry.window_seconds != old_telemetry.window_seconds ||
+        new_telemetry.sample_interval_ms != old_telemetry.sample_interval_ms ||
+        new_telemetry.full_report_windows != old_telemetry.full_report_windows ||
+        new_telemetry.method != old_telemetry.method || new_telemetry.service != old_telemetry.service ||
+        new_telemetry.deadbands != old_telemetry.deadbands) {
+        std::cout << "[Config] telemetry applies after a restart" << std::endl;
+    }
+    
+    const auto& old_ws = previous.getWebSocketConfig();
+    const auto& new_ws = next.getWebSocketConfig();
+    if (g_server) {
+        g_server->applyConfig(new_ws);
+    }
+    g_snapshot_on_connect = new_ws.snapshot_on_connect;
+    if (new_ws.host != old_ws.host || new_ws.port != old_ws.port || new_ws.io_threads != old_ws.io_threads ||
+        new_ws.unix_socket_path != old_ws.unix_socket_path || new_ws.reuse_port != old_ws.reuse_port ||
+        new_ws.compression_enabled != old_ws.compression_enabled || new_ws.handler_threads != old_ws.handler_threads ||
+        new_ws.handler_queue != old_ws.handler_queue) {
+        std::cout << "[Config] websocket endpoint, threads, handler queue and compression apply after a restart" << std::endl;
+    }
+    if (new_ws.timeout_ms != old_ws.timeout_ms || new_ws.ping_interval_ms != old_ws.ping_interval_ms ||
+        new_ws.pong_timeout_ms != old_ws.pong_timeout_ms) {
+        std::cout << "[Config] websocket handshake and keepalive timeouts apply after a restart" << std::endl;
+    }
+    
+    const auto& old_threads = previous.getThreadsConfig();
+    const auto& new_threads = next.getThreadsConfig();
+    if (new_threads.websocket != old_threads.websocket || new_threads.mqtt != old_threads.mqtt ||
+        new_threads.network_priority != old_threads.network_priority) {
+        std::cout << "[Config] threads placement applies after a restart" << std::endl;
+    }
+    
+    const auto& old_trace = previous.getTraceConfig();
+    const auto& new_trace = next.getTraceConfig();
+    if (new_trace.enabled != old_trace.enabled) {
+        UrTrace::setEnabled(new_trace.enabled);
+        std::cout << "[Config] Tracing " << (new_trace.enabled ? "enabled" : "disabled") << std::endl;
+    }
+    if (new_trace.buffer_events != old_trace.buffer_events) {
+        std::cout << "[Config] trace.buffer_events applies after a restart" << std::endl;
+    }
+    
+    const auto& old_diagnostics = previous.getDiagnosticsConfig();
+    const auto& new_diagnostics = next.getDiagnosticsConfig();
+    if (new_diagnostics.enabled != old_diagnostics.enabled ||
+        new_diagnostics.max_concurrent_jobs != old_diagnostics.max_concurrent_jobs ||
+        new_diagnostics.max_duration_seconds != old_diagnostics.max_duration_seconds) {
+        std::cout << "[Config] diagnostics apply after a restart" << std::endl;
+    }
+    
+    const auto& old_cameras = previous.getCameraDiscoveryConfig();
+    const auto& new_cameras = next.getCameraDiscoveryConfig();
+    if (new_cameras.enabled != old_cameras.enabled || new_cameras.probe_window != old_cameras.probe_window ||
+        new_cameras.probe_rate_per_second != old_cameras.probe_rate_per_second ||
+        new_cameras.probe_timeout_ms != old_cameras.probe_timeout_ms ||
+        new_cameras.listen_seconds != old_cameras.listen_seconds ||
+        new_cameras.cache_ttl_seconds != old_cameras.cache_ttl_seconds) {
+        std::cout << "[Config] camera_discovery applies after a restart" << std::endl;
+    }
+    
+    const auto& old_mavlink = previous.getMavlinkConfig();
+    const auto& new_mavlink = next.getMavlinkConfig();
+    if (new_mavlink.enabled != old_mavlink.enabled || new_mavlink.udp_port != old_mavlink.udp_port ||
+        new_mavlink.serial_device != old_mavlink.serial_device || new_mavlink.baud != old_mavlink.baud ||
+        new_mavlink.ring_size != old_mavlink.ring_size || new_mavlink.max_rate_hz != old_mavlink.max_rate_hz) {
+        std::cout << "[Config] mavlink applies after a restart" << std::endl;
+    }
+    
+    const auto& old_wireless = previous.getWirelessScanConfig();
+    const auto& new_wireless = next.getWirelessScanConfig();
+    if (new_wireless.enabled != old_wireless.enabled || new_wireless.interface != old_wireless.interface ||
+        new_wireless.cache_ttl_seconds != old_wireless.cache_ttl_seconds ||
+        new_wireless.scan_timeout_seconds != old_wireless.scan_timeout_seconds) {
+        std::cout << "[Config] wireless_scan applies after a restart" << std::endl;
+    }
+    
+    const auto& old_priority = previous.getNetworkPriorityConfig();
+    const auto& new_priority = next.getNetworkPriorityConfig();
+    if (g_network_priority_manager &&
+        (new_priority.reachability_targets != old_priority.reachability_targets ||
+         new_priority.reachability_interval_ms != old_priority.reachability_interval_ms ||
+         new_priority.reachability_timeout_ms != old_priority.reachability_timeout_ms ||
+         new_priority.reachability_down_after != old_priority.reachability_down_after ||
+         new_priority.reachability_up_after != old_priority.reachability_up_after) &&
+        !g_network_priority_manager->setReachabilitySettings(reachabilitySettings(new_priority))) {
+        std::cerr << "[Config] Invalid network_priority.reachability_targets, keeping the previous ones" << std::endl;
+    }
+    if (g_network_priority_manager &&
+        (new_priority.failover_enabled != old_priority.failover_enabled ||
+         new_priority.failover_restore_hold_ms != old_priority.failover_restore_hold_ms ||
+         new_priority.failover_max_latency_ms != old_priority.failover_max_latency_ms)) {
+        g_network_priority_manager->setFailoverSettings(failoverSettings(new_priority));
+    }
+    
+    const auto& old_vpn = previous.getVpnMonitorConfig();
+    const auto& new_vpn = next.getVpnMonitorConfig();
+    if (new_vpn.enabled != old_vpn.enabled || new_vpn.openvpn_management != old_vpn.openvpn_management ||
+        new_vpn.bytecount_interval_seconds != old_vpn.bytecount_interval_seconds ||
+        new_vpn.wireguard_refresh_ms != old_vpn.wireguard_refresh_ms) {
+        std::cout << "[Config] vpn_monitor applies after a restart" << std::endl;
+    }
+    
+    const auto& old_tail = previous.getLogTailConfig();
+    const auto& new_tail = next.getLogTailConfig();
+    if (new_tail.enabled != old_tail.enabled || new_tail.paths != old_tail.paths ||
+        new_tail.batch_interval_ms != old_tail.batch_interval_ms ||
+        new_tail.max_lines_per_second != old_tail.max_lines_per_second ||
+        new_tail.backlog_lines != old_tail.backlog_lines) {
+        std::cout << "[Config] log_tail applies after a restart" << std::endl;
+    }
+    
+    const auto& old_fleet = previous.getFleetConfig();
+    const auto& new_fleet = next.getFleetConfig();
+    bool fleet_nodes_changed = new_fleet.nodes.size() != old_fleet.nodes.size();
+    for (size_t i = 0; !fleet_nodes_changed && i < new_fleet.nodes.size(); ++i) {
+        fleet_nodes_changed = new_fleet.nodes[i].name != old_fleet.nodes[i].name ||
+                              new_fleet.nodes[i].url != old_fleet.nodes[i].url;
+    }
+    if (new_fleet.enabled != old_fleet.enabled || fleet_nodes_changed ||
+        new_fleet.categories != old_fleet.categories ||
+        new_fleet.publish_interval_ms != old_fleet.publish_interval_ms ||
+        new_fleet.max_node_kb != old_fleet.max_node_kb ||
+        new_fleet.reconnect_max_seconds != old_fleet.reconnect_max_seconds) {
+        std::cout << "[Config] fleet applies after a restart" << std::endl;
+    }
+    
+    const auto& old_logging = previous.getLoggingConfig();
+    const auto& new_logging = next.getLoggingConfig();
+    if (new_logging.level != old_logging.level) {
+        logger_set_level(BackendDatalink::Log::levelFromName(new_logging.level));
+        std::cout << "[Config] Log level now " << new_logging.level << std::endl;
+    }
+    
+    const auto& old_metrics = previous.getMetricsConfig();
+    const auto& new_metrics = next.getMetricsConfig();
+    if (new_metrics.enabled != old_metrics.enabled || new_metrics.host != old_metrics.host ||
+        new_metrics.port != old_metrics.port) {
+        std::cout << "[Config] metrics endpoint applies after a restart" << std::endl;
+    }
+}
+
 void printUsage(const char* program_name) {
     std::cout << "Usage: " << program_name << " -pkg_config <config_file_path> -rpc_config <rpc_config_file_path>" << std::endl;
     std::cout << std::endl;
@@ -203,26 +508,79 @@ void printUsage(const char* program_name) {
     std::cout << "  " << program_name << " -pkg_config config/config.json -rpc_config config/rpc_config.json" << std::endl;
 }
 
-void onMessage(const std::string& connection_id, const json& message) {
-    std::cout << "Message handler called for connection " << connection_id << std::endl;
+// Runs a handler that can block on the handler executor, with its own copy
+// of the message (the frame is gone by then); without an executor it runs
+// here. Replies go out with sendToClient(), from whichever thread.
+void offloadHandler(ConnectionId connection_id, const InboundMessage& message,
+                    void (*handler)(ConnectionId, const InboundMessage&)) {
+    if (!g_handler_executor) {
+        handler(connection_id, message);
+        return;
+    }
     
+    auto payload = std::make_shared<const std::string>(message.payload());
+    WireEncoding encoding = message.encoding();
+    bool queued = g_handler_executor->post(connection_id, [connection_id, payload, encoding, handler]() {
+        // Already scanned once on the io thread, so it scans clean again
+        BackendDatalink::MessageArena::Scope arena_scope;
+        InboundMessage copy(*payload, encoding);
+        copy.scan(0);
+        handler(connection_id, copy);
+    });
+    if (!queued && g_server) {
+        json busy = {
+            {"type", "error"},
+            {"message", "Server busy, try again"},
+            {"request_type", message.type()},
+            {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count()}
+        };
+        g_server->sendToClient(connection_id, busy);
+    }
+}
+
+void onMessage(ConnectionId connection_id, const InboundMessage& message) {
     try {
-        std::string message_type = message.value("type", "");
+        const std::string& message_type = message.type();
         
         if (message_type == "get_dashboard_data") {
-            // Handle dashboard data request
-            handleDashboardDataRequest(connection_id, message);
+            // Handle dashboard data request (reads the database)
+            offloadHandler(connection_id, message, handleDashboardDataRequest);
         } else if (message_type == "subscribe_updates") {
             // Handle subscription to real-time updates
             handleSubscribeUpdates(connection_id, message);
         } else if (message_type == "network_priority") {
-            // Handle network priority requests
-            handleNetworkPriorityRequest(connection_id, message);
+            // Handle network priority requests (may change routes)
+            offloadHandler(connection_id, message, handleNetworkPriorityRequest);
+        } else if (message_type == "get_metrics_history") {
+            // Handle time-series history queries (older ones read the database)
+            offloadHandler(connection_id, message, handleMetricsHistoryRequest);
+        } else if (message_type == "get_history") {
+            // Handle windowed aggregates for charts
+            handleHistoryAggregateRequest(connection_id, message);
+        } else if (message_type == "diagnostic") {
+            // Start or cancel a streamed network diagnostic
+            handleDiagnosticRequest(connection_id, message);
+        } else if (message_type == "camera_discovery") {
+            // Scan for IP cameras or read the discovery cache
+            handleCameraDiscoveryRequest(connection_id, message);
+        } else if (message_type == "mavlink") {
+            // Decimated telemetry subscription, link status and history
+            handleMavlinkRequest(connection_id, message);
+        } else if (message_type == "wireless_scan") {
+            // Site survey: scan for access points or read the scan cache
+            handleWirelessScanRequest(connection_id, message);
+        } else if (message_type == "logs") {
+            // Filtered live tail of the device logs
+            handleLogsRequest(connection_id, message);
+        } else if (message_type == "fleet") {
+            // Aggregator mode: one stream of many nodes' dashboards
+            handleFleetRequest(connection_id, message);
         } else {
             // Default echo response for unknown message types
             json response = {
                 {"type", "echo"},
-                {"original", message},
+                {"original", json(message.body())},
                 {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
                     std::chrono::system_clock::now().time_since_epoch()).count()},
                 {"server", "backend-datalink"}
@@ -233,7 +591,7 @@ void onMessage(const std::string& connection_id, const json& message) {
             }
         }
     } catch (const std::exception& e) {
-        std::cerr << "Error handling message: " << e.what() << std::endl;
+        BACKEND_LOG_EVERY(LOG_ERROR, 1000, "Error handling message: " << e.what());
         
         json error_response = {
             {"type", "error"},
@@ -248,7 +606,54 @@ void onMessage(const std::string& connection_id, const json& message) {
     }
 }
 
-void handleDashboardDataRequest(const std::string& connection_id, const json& message) {
+// Replies are shared per category list while neither the cached values nor
+// the delta sequences move, so a reconnect storm after a restart builds and
+// encodes one reply instead of one per client
+// categories narrows the reply as the "categories" request field does;
+// nullptr means every category
+std::shared_ptr<const SharedMessage> buildDashboardDataReply(const std::vector<std::string>* categories) {
+    static BackendDatalink::SingleFlight<SharedMessage> replies;
+    static UrMetrics::Counter& built = UrMetrics::Registry::instance().counter(
+        "backend_dashboard_data_replies_total", "dashboard_data replies by how they were produced",
+        {{"result", "built"}});
+    static UrMetrics::Counter& shared = UrMetrics::Registry::instance().counter(
+        "backend_dashboard_data_replies_total", "dashboard_data replies by how they were produced",
+        {{"result", "shared"}});
+    
+    std::string key;
+    if (categories) {
+        key = "[";
+        for (const auto& category : *categories) {
+            key += category;
+            key += '\n';
+        }
+    }
+    uint64_t version = g_database->getDashboardGeneration() + g_dashboard_delta.getVersion();
+    
+    bool reused = false;
+    std::shared_ptr<const SharedMessage> reply = replies.get(key, version, [categories]() {
+        json params = json::object();
+        if (categories) {
+            params["categories"] = *categories;
+        }
+        json result = g_request_router.invoke(Transport::WebSocket, "dashboard.get_data", params);
+        std::vector<std::string> included;
+        for (const auto& item : result["sequence"].items()) {
+            included.push_back(item.key());
+        }
+        return std::make_shared<const SharedMessage>(json{
+            {"type", "dashboard_data"},
+            {"data", std::move(result["data"])},
+            {"sequence", std::move(result["sequence"])},
+            {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count()}
+        }, std::move(included));
+    }, &reused);
+    (reused ? shared : built).inc();
+    return reply;
+}
+
+void handleDashboardDataRequest(ConnectionId connection_id, const InboundMessage& message) {
     if (!g_database || !g_database->isInitialized()) {
         json error_response = {
             {"type", "error"},
@@ -264,48 +669,15 @@ void handleDashboardDataRequest(const std::string& connection_id, const json& me
     }
     
     try {
-        // Get requested categories or default to all
-        std::vector<std::string> categories = {"system", "ram", "swap", "network", "ultima_server", "signal"};
-        
-        if (message.contains("categories") && message["categories"].is_array()) {
-            categories.clear();
-            for (const auto& cat : message["categories"]) {
-                if (cat.is_string()) {
-                    categories.push_back(cat.get<std::string>());
-                }
-            }
-        }
-        
-        // Retrieve data for each category
-        json dashboard_data = json::object();
-        
-        for (const auto& category : categories) {
-            std::string data_json = g_database->getDashboardData(category);
-            if (!data_json.empty() && data_json != "{}") {
-                try {
-                    dashboard_data[category] = json::parse(data_json);
-                } catch (const json::parse_error& e) {
-                    std::cerr << "Failed to parse JSON for category " << category << ": " << e.what() << std::endl;
-                    dashboard_data[category] = json::object();
-                }
-            } else {
-                dashboard_data[category] = json::object();
-            }
-        }
-        
-        json response = {
-            {"type", "dashboard_data"},
-            {"data", dashboard_data},
-            {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now().time_since_epoch()).count()}
-        };
+        std::shared_ptr<const SharedMessage> response = buildDashboardDataReply(
+            message.hasCategories() ? &message.categories() : nullptr);
         
         if (g_server) {
             g_server->sendToClient(connection_id, response);
         }
         
     } catch (const std::exception& e) {
-        std::cerr << "Error handling dashboard data request: " << e.what() << std::endl;
+        BACKEND_LOG_EVERY(LOG_ERROR, 1000, "Error handling dashboard data request: " << e.what());
         
         json error_response = {
             {"type", "error"},
@@ -320,12 +692,427 @@ void handleDashboardDataRequest(const std::string& connection_id, const json& me
     }
 }
 
-void handleSubscribeUpdates(const std::string& connection_id, const json& message) {
-    // For now, just acknowledge subscription
-    // Real-time updates will be broadcast to all clients
+void handleMetricsHistoryRequest(ConnectionId connection_id, const InboundMessage& message) {
+    const message_json& request = message.body();
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    int resolution = MetricsHistory::Raw;
+    if (!g_metrics_history ||
+        (request.contains("resolution") && !MetricsHistory::parseResolution(json(request["resolution"]), resolution))) {
+        json error_response = {
+            {"type", "error"},
+            {"message", g_metrics_history ? "Invalid resolution, expected raw, 1m or 1h"
+                                          : "Metrics history not available"},
+            {"timestamp", now}
+        };
+        
+        if (g_server) {
+            g_server->sendToClient(connection_id, error_response);
+        }
+        return;
+    }
+    
+    // Default window: last hour of raw samples, last day of minutes, last 30 days of hours
+    int64_t default_span = resolution == MetricsHistory::Raw ? 3600
+                         : resolution == MetricsHistory::Minute ? 86400 : 2592000;
+    int64_t to = request.contains("to") && request["to"].is_number_integer() ? request["to"].get<int64_t>() : now;
+    int64_t from = request.contains("from") && request["from"].is_number_integer() ? request["from"].get<int64_t>()
+                                                                                   : to - default_span;
+    size_t limit = 1000;
+    if (request.contains("limit") && request["limit"].is_number_unsigned()) {
+        limit = std::min<size_t>(request["limit"].get<size_t>(), 5000);
+    }
+    
+    auto samples = g_metrics_history->query(resolution, from, to, limit);
+    
+    json response = {
+        {"type", "metrics_history"},
+        {"resolution", MetricsHistory::resolutionName(resolution)},
+        {"from", from},
+        {"to", to},
+        {"count", samples.size()},
+        {"series", MetricsHistory::toJson(samples)},
+        {"timestamp", now}
+    };
+    
+    if (g_server) {
+        g_server->sendToClient(connection_id, response);
+    }
+}
+
+void handleHistoryAggregateRequest(ConnectionId connection_id, const InboundMessage& message) {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    // Same handler as the MQTT "metrics_history.get_history" method; its
+    // parameter errors go back to the client as they are
+    json response;
+    try {
+        response = {
+            {"type", "history"},
+            {"data", g_request_router.invoke(Transport::WebSocket, "metrics_history.get_history", json(message.body()))},
+            {"timestamp", now}
+        };
+    } catch (const std::exception& e) {
+        response = {
+            {"type", "error"},
+            {"message", e.what()},
+            {"timestamp", now}
+        };
+    }
+    
+    if (g_server) {
+        g_server->sendToClient(connection_id, response);
+    }
+}
+
+// {"type": "diagnostic", "action": "start", "tool": ..., tool fields} or
+// {"type": "diagnostic", "action": "cancel", "job_id": ...}. Output follows
+// as diagnostic_output and diagnostic_done messages.
+void handleDiagnosticRequest(ConnectionId connection_id, const InboundMessage& message) {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    json response;
+    try {
+        if (!g_diagnostics) {
+            throw std::runtime_error("Diagnostics are disabled");
+        }
+        
+        const std::string& action = message.action();
+        json request(message.body());
+        if (action == "start") {
+            response = g_diagnostics->startJob(connection_id, request);
+        } else if (action == "cancel") {
+            std::string job_id = request.contains("job_id") && request["job_id"].is_string()
+                                     ? request["job_id"].get<std::string>() : "";
+            response = {
+                {"type", "diagnostic_cancel"},
+                {"job_id", job_id},
+                {"success", g_diagnostics->cancelJob(connection_id, job_id)},
+                {"timestamp", now}
+            };
+        } else {
+            throw std::invalid_argument("Unknown action: " + action);
+        }
+    } catch (const std::exception& e) {
+        response = {
+            {"type", "error"},
+            {"message", e.what()},
+            {"timestamp", now}
+        };
+    }
+    
+    if (g_server) {
+        g_server->sendToClient(connection_id, response);
+    }
+}
+
+// {"type": "camera_discovery", "action": "scan" | "get", ...}: the
+// "cameras.<action>" methods. Scan progress and results follow as "cameras"
+// dashboard updates to subscribed connections.
+void handleCameraDiscoveryRequest(ConnectionId connection_id, const InboundMessage& message) {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::string& action = message.action();
+    
+    json response;
+    try {
+        json result = g_request_router.invoke(Transport::WebSocket, "cameras." + action, json(message.body()));
+        response = {
+            {"type", "camera_discovery"},
+            {"action", action},
+            {"seq", result["sequence"]},
+            {"scan_started", result.value("scan_started", false)},
+            {"data", std::move(result["data"])},
+            {"timestamp", now}
+        };
+    } catch (const BackendDatalink::UnknownMethodError&) {
+        response = {
+            {"type", "error"},
+            {"message", "Unknown action: " + action},
+            {"timestamp", now}
+        };
+    } catch (const std::exception& e) {
+        response = {
+            {"type", "error"},
+            {"message", e.what()},
+            {"timestamp", now}
+        };
+    }
+    
+    if (g_server) {
+        g_server->sendToClient(connection_id, response);
+    }
+}
+
+// {"type": "wireless_scan", "action": "scan" | "get", "force"}: the
+// "wireless.<action>" methods. Results follow as "wireless" dashboard
+// updates to subscribed connections.
+void handleWirelessScanRequest(ConnectionId connection_id, const InboundMessage& message) {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::string& action = message.action();
+    
+    json response;
+    try {
+        json result = g_request_router.invoke(Transport::WebSocket, "wireless." + action, json(message.body()));
+        response = {
+            {"type", "wireless_scan"},
+            {"action", action},
+            {"seq", result["sequence"]},
+            {"scan_started", result.value("scan_started", false)},
+            {"data", std::move(result["data"])},
+            {"timestamp", now}
+        };
+    } catch (const BackendDatalink::UnknownMethodError&) {
+        response = {
+            {"type", "error"},
+            {"message", "Unknown action: " + action},
+            {"timestamp", now}
+        };
+    } catch (const std::exception& e) {
+        response = {
+            {"type", "error"},
+            {"message", e.what()},
+            {"timestamp", now}
+        };
+    }
+    
+    if (g_server) {
+        g_server->sendToClient(connection_id, response);
+    }
+}
+
+// {"type": "logs", "action": "subscribe", "level", "components": [names],
+// "pattern"}, "unsubscribe" or "status". Matching lines arrive as "logs"
+// frames, the first one with "backlog": true.
+void handleLogsRequest(ConnectionId connection_id, const InboundMessage& message) {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::string& action = message.action();
+    
+    json response;
+    try {
+        if (!g_log_tail) {
+            throw std::runtime_error("Log tail not available");
+        }
+        
+        json request(message.body());
+        response = {
+            {"type", "logs_response"},
+            {"action", action},
+            {"timestamp", now}
+        };
+        if (action == "subscribe") {
+            BackendDatalink::LogTail::Filter filter;
+            if (request.contains("level")) {
+                if (!request["level"].is_string()) {
+                    throw std::invalid_argument("level must be a string");
+                }
+                filter.min_level = request["level"];
+            }
+            if (request.contains("components")) {
+                if (!request["components"].is_array()) {
+                    throw std::invalid_argument("components must be an array of names");
+                }
+                for (const auto& component : request["components"]) {
+                    if (!component.is_string()) {
+                        throw std::invalid_argument("components must be an array of names");
+                    }
+                    filter.components.push_back(component);
+                }
+            }
+            if (request.contains("pattern")) {
+                if (!request["pattern"].is_string()) {
+                    throw std::invalid_argument("pattern must be a string");
+                }
+                filter.pattern = request["pattern"];
+            }
+            g_log_tail->subscribe(connection_id, filter);
+            response["level"] = filter.min_level;
+            response["components"] = filter.components;
+            response["pattern"] = filter.pattern;
+        } else if (action == "unsubscribe") {
+            response["success"] = g_log_tail->unsubscribe(connection_id);
+        } else if (action == "status") {
+            response["data"] = g_log_tail->getStatus();
+        } else {
+            throw std::invalid_argument("Unknown action: " + action);
+        }
+    } catch (const std::exception& e) {
+        response = {
+            {"type", "error"},
+            {"message", e.what()},
+            {"timestamp", now}
+        };
+    }
+    
+    if (g_server) {
+        g_server->sendToClient(connection_id, response);
+    }
+}
+
+// {"type": "fleet", "action": "subscribe", "nodes": [names], "epoch",
+// "generation"}, "unsubscribe" or "status". epoch and generation resume
+// from the last fleet_update the client received.
+void handleFleetRequest(ConnectionId connection_id, const InboundMessage& message) {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::string& action = message.action();
+    
+    json response;
+    try {
+        if (!g_fleet) {
+            throw std::runtime_error("Fleet aggregator not enabled");
+        }
+        
+        json request(message.body());
+        response = {
+            {"type", "fleet_response"},
+            {"action", action},
+            {"timestamp", now}
+        };
+        if (action == "subscribe") {
+            std::vector<std::string> nodes;
+            if (request.contains("nodes")) {
+                if (!request["nodes"].is_array()) {
+                    throw std::invalid_argument("nodes must be an array of node names");
+                }
+                for (const auto& node : request["nodes"]) {
+                    if (!node.is_string()) {
+                        throw std::invalid_argument("nodes must be an array of node names");
+                    }
+                    nodes.push_back(node);
+                }
+            }
+            uint64_t epoch = 0;
+            uint64_t generation = 0;
+            if (request.contains("epoch") && request.contains("generation")) {
+                if (!request["epoch"].is_number_unsigned() || !request["generation"].is_number_unsigned()) {
+                    throw std::invalid_argument("epoch and generation must be unsigned integers");
+                }
+                epoch = request["epoch"];
+                generation = request["generation"];
+            }
+            g_fleet->subscribe(connection_id, nodes, epoch, generation);
+            response["nodes"] = nodes;
+        } else if (action == "unsubscribe") {
+            response["success"] = g_fleet->unsubscribe(connection_id);
+        } else if (action == "status") {
+            response["data"] = g_fleet->getStatus();
+        } else {
+            throw std::invalid_argument("Unknown action: " + action);
+        }
+    } catch (const std::exception& e) {
+        response = {
+            {"type", "error"},
+            {"message", e.what()},
+            {"timestamp", now}
+        };
+    }
+    
+    if (g_server) {
+        g_server->sendToClient(connection_id, response);
+    }
+}
+
+// {"type": "mavlink", "action": "subscribe", "rate_hz", "messages": [ids]},
+// "unsubscribe", "status", or "history" with "message_id" and "count".
+// Subscribed telemetry arrives as binary frames of raw MAVLink; history
+// replies carry the frames as a binary value in "data".
+void handleMavlinkRequest(ConnectionId connection_id, const InboundMessage& message) {
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::string& action = message.action();
+    
+    json response;
+    try {
+        if (!g_mavlink) {
+            throw std::runtime_error("MAVLink bridge not available");
+        }
+        
+        json request(message.body());
+        response = {
+            {"type", "mavlink"},
+            {"action", action},
+            {"timestamp", now}
+        };
+        if (action == "subscribe") {
+            int rate_hz = 10;
+            if (request.contains("rate_hz")) {
+                if (!request["rate_hz"].is_number_integer()) {
+                    throw std::invalid_argument("rate_hz must be an integer");
+                }
+                rate_hz = request["rate_hz"];
+            }
+            std::vector<uint32_t> message_ids;
+            if (request.contains("messages")) {
+                if (!request["messages"].is_array()) {
+                    throw std::invalid_argument("messages must be an array of message ids");
+                }
+                for (const auto& id : request["messages"]) {
+                    if (!id.is_number_unsigned() || id.get<uint64_t>() > 0xFFFFFF) {
+                        throw std::invalid_argument("messages must be an array of message ids");
+                    }
+                    message_ids.push_back(id.get<uint32_t>());
+                }
+            }
+            g_mavlink->subscribe(connection_id, rate_hz, message_ids);
+            response["rate_hz"] = rate_hz;
+            response["messages"] = message_ids;
+        } else if (action == "unsubscribe") {
+            response["success"] = g_mavlink->unsubscribe(connection_id);
+        } else if (action == "status") {
+            response["data"] = g_mavlink->getStatus();
+        } else if (action == "history") {
+            if (!request.contains("message_id") || !request["message_id"].is_number_unsigned()) {
+                throw std::invalid_argument("message_id must be a message id");
+            }
+            size_t count = 1;
+            if (request.contains("count")) {
+                if (!request["count"].is_number_unsigned() || request["count"].get<uint64_t>() < 1) {
+                    throw std::invalid_argument("count must be a positive integer");
+                }
+                count = request["count"].get<size_t>();
+            }
+            uint32_t message_id = request["message_id"].get<uint32_t>();
+            size_t frames = 0;
+            response["message_id"] = message_id;
+            response["data"] = json::binary(g_mavlink->history(message_id, count, frames));
+            response["frames"] = frames;
+        } else {
+            throw std::invalid_argument("Unknown action: " + action);
+        }
+    } catch (const std::exception& e) {
+        response = {
+            {"type", "error"},
+            {"message", e.what()},
+            {"timestamp", now}
+        };
+    }
+    
+    if (g_server) {
+        g_server->sendToClient(connection_id, response);
+    }
+}
+
+void handleSubscribeUpdates(ConnectionId connection_id, const InboundMessage& message) {
+    // An optional "categories" array narrows the connection to those topics;
+    // without it the connection receives every category
+    const std::vector<std::string>& categories = message.categories();
+    
+    if (g_server && !g_server->setSubscriptions(connection_id, categories)) {
+        BACKEND_LOG_WARN("Subscription request from unknown connection " << connectionIdString(connection_id));
+        return;
+    }
+    
     json response = {
         {"type", "subscription_confirmed"},
-        {"message", "Subscribed to real-time dashboard updates"},
+        {"message", categories.empty() ? "Subscribed to all real-time dashboard updates"
+                                       : "Subscribed to selected real-time dashboard updates"},
+        {"categories", categories},
         {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
             std::chrono::system_clock::now().time_since_epoch()).count()}
     };
@@ -335,88 +1122,313 @@ void handleSubscribeUpdates(const std::string& connection_id, const json& messag
     }
 }
 
-void onConnectionOpen(const std::string& connection_id) {
-    std::cout << "Connection opened: " << connection_id << std::endl;
+void onConnectionOpen(ConnectionId connection_id) {
+    // The string form is what the database and the client get
+    std::string connection_name = connectionIdString(connection_id);
+    BACKEND_LOG_DEBUG("Connection opened: " << connection_name);
     
     // Log to database
     if (g_database && g_database->isInitialized()) {
-        g_database->logConnection(connection_id, "unknown", "connected");
+        g_database->logConnection(connection_name, "unknown", "connected");
     }
     
+    // New connections start subscribed to every category, so the snapshot
+    // covers all of them. It is the same reply get_dashboard_data returns
+    // (shared with any other connection opening in this generation) and
+    // saves the client that round trip before its first paint.
+    bool send_snapshot = g_snapshot_on_connect.load(std::memory_order_relaxed) &&
+                         g_database && g_database->isInitialized();
+    
     json welcome = {
         {"type", "welcome"},
         {"message", "Connected to backend-datalink WebSocket server"},
-        {"connection_id", connection_id},
+        {"connection_id", connection_name},
+        {"snapshot", send_snapshot},
         {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
             std::chrono::system_clock::now().time_since_epoch()).count()}
     };
     
-    if (g_server) {
-        g_server->sendToClient(connection_id, welcome);
+    if (!g_server) {
+        return;
+    }
+    g_server->sendToClient(connection_id, welcome);
+    
+    if (send_snapshot) {
+        auto send = [connection_id]() {
+            try {
+                g_server->sendToClient(connection_id, buildDashboardDataReply(nullptr));
+            } catch (const std::exception& e) {
+                BACKEND_LOG_EVERY(LOG_ERROR, 1000, "Error sending connect snapshot: " << e.what());
+            }
+        };
+        // Ahead of any request the client sends next; when the queue is
+        // full the client asks with get_dashboard_data like before
+        if (!g_handler_executor) {
+            send();
+        } else if (!g_handler_executor->post(connection_id, send)) {
+            BACKEND_LOG_EVERY(LOG_WARN, 1000, "Handler queue full, no connect snapshot for " << connection_name);
+        }
     }
 }
 
-void onConnectionClose(const std::string& connection_id) {
-    std::cout << "Connection closed: " << connection_id << std::endl;
+void onConnectionClose(ConnectionId connection_id) {
+    BACKEND_LOG_DEBUG("Connection closed: " << connectionIdString(connection_id));
+    
+    // Nobody is left to read their output
+    if (g_handler_executor) {
+        g_handler_executor->cancel(connection_id);
+    }
+    if (g_diagnostics) {
+        g_diagnostics->cancelConnection(connection_id);
+    }
+    if (g_mavlink) {
+        g_mavlink->unsubscribe(connection_id);
+    }
+    if (g_log_tail) {
+        g_log_tail->unsubscribe(connection_id);
+    }
+    if (g_fleet) {
+        g_fleet->unsubscribe(connection_id);
+    }
     
     // Log to database
     if (g_database && g_database->isInitialized()) {
-        g_database->logDisconnection(connection_id);
+        g_database->logDisconnection(connectionIdString(connection_id));
     }
 }
 
-void broadcastDashboardUpdate(const std::string& category, const json& data) {
+void broadcastDashboardUpdate(DashboardCategory category, const json& data) {
     if (!g_server) {
         return;
     }
+    UR_TRACE_SPAN("dashboard.broadcast");
     
-    json update_message = {
-        {"type", "dashboard_update"},
-        {"category", category},
-        {"data", data},
-        {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count()}
+    // Only changed fields go out; unchanged categories are skipped entirely
+    json update_message;
+    if (!g_dashboard_delta.buildUpdate(category, data, update_message)) {
+        return;
+    }
+    
+    // Fan out to the connections subscribed to this category
+    g_server->publish(categoryName(category), update_message);
+}
+
+const char* threadStateName(ThreadMgr::ThreadState state) {
+    switch (state) {
+        case ThreadMgr::ThreadState::Created: return "created";
+        case ThreadMgr::ThreadState::Running: return "running";
+        case ThreadMgr::ThreadState::Paused: return "paused";
+        case ThreadMgr::ThreadState::Stopped: return "stopped";
+        case ThreadMgr::ThreadState::Error: return "error";
+    }
+    return "unknown";
+}
+
+json threadStatsToJson(const ThreadMgr::ThreadStats& stats) {
+    return {
+        {"name", stats.name},
+        {"tid", stats.tid},
+        {"state", threadStateName(stats.state)},
+        {"cpu_time_ms", std::chrono::duration_cast<std::chrono::milliseconds>(stats.cpuTime).count()},
+        {"voluntary_switches", stats.voluntarySwitches},
+        {"involuntary_switches", stats.involuntarySwitches},
+        {"iterations", stats.iterations},
+        {"last_activity", std::chrono::duration_cast<std::chrono::seconds>(
+            stats.lastActivity.time_since_epoch()).count()}
     };
+}
+
+// CPU time and activity of the long-running threads, keyed by subsystem,
+// to find the one burning CPU in the field
+void publishThreadStats() {
+    json threads = json::object();
+    try {
+        if (g_server && g_server->isRunning()) {
+            threads["websocket"] = threadStatsToJson(g_server->getThreadStats());
+        }
+        if (g_rpcClient && g_rpcClient->isRunning()) {
+            threads["mqtt"] = threadStatsToJson(g_rpcClient->getThreadStats());
+        }
+        if (g_network_priority_manager && g_network_priority_manager->isRunning()) {
+            threads["network_priority"] = threadStatsToJson(g_network_priority_manager->getThreadStats());
+        }
+    } catch (const std::exception& e) {
+        BACKEND_LOG_EVERY(LOG_ERROR, 60000, "Error collecting thread statistics: " << e.what());
+    }
     
-    // Broadcast to all connected clients
-    g_server->broadcast(update_message);
-    std::cout << "[BROADCAST] Sent dashboard update for category: " << category << std::endl;
+    if (g_database && g_database->isInitialized()) {
+        g_database->updateDashboardData(categoryName(DashboardCategory::Threads), threads);
+    }
+    broadcastDashboardUpdate(DashboardCategory::Threads, threads);
 }
 
-void updateSystemDataInDatabase() {
+// Persistence stage: the history ring and the dashboard table, written from
+// the latest snapshot at most once per database_update_interval_seconds
+void persistSystemData() {
     if (!g_database || !g_database->isInitialized() || !g_system_collector) {
         return;
     }
+    UR_TRACE_SPAN("dashboard.persist");
     
-    try {
-        // Get current system metrics as JSON
-        json metrics = g_system_collector->getMetricsAsJson();
-        
-        // Update database with different categories
-        g_database->updateDashboardData("system", metrics["cpu"].dump());
-        g_database->updateDashboardData("ram", metrics["ram"].dump());
-        g_database->updateDashboardData("swap", metrics["swap"].dump());
-        g_database->updateDashboardData("network", metrics["network"].dump());
-        g_database->updateDashboardData("ultima_server", metrics["ultima_server"].dump());
-        g_database->updateDashboardData("signal", metrics["signal"].dump());
-        
-        // Broadcast real-time updates to connected clients
-        broadcastDashboardUpdate("system", metrics["cpu"]);
-        broadcastDashboardUpdate("ram", metrics["ram"]);
-        broadcastDashboardUpdate("swap", metrics["swap"]);
-        broadcastDashboardUpdate("network", metrics["network"]);
-        broadcastDashboardUpdate("ultima_server", metrics["ultima_server"]);
-        broadcastDashboardUpdate("signal", metrics["signal"]);
-        
-        // Log successful update (only periodically to avoid spam)
-        static int update_count = 0;
-        update_count++;
-        if (update_count % 6 == 1) { // Log every 30 seconds (6 updates × 5 seconds)
-            std::cout << "[SystemDataCollector] Database updated with latest metrics (update #" << update_count << ")" << std::endl;
+    // One JSON build per collector generation, shared with the broadcast stage
+    auto snapshot = g_system_collector->getJsonSnapshot();
+    const json& metrics = snapshot->metrics();
+    
+    // Feed the history ring and persist it on its own schedule
+    if (g_metrics_history) {
+        g_metrics_history->record(metrics);
+        g_metrics_history->flushIfDue();
+    }
+    
+    // Update database with every collector category in one transaction
+    std::vector<std::pair<std::string, json>> entries;
+    entries.reserve(kDashboardCategoryCount);
+    for (const auto& info : kDashboardCategories) {
+        if (info.section) {
+            entries.emplace_back(info.name, metrics.at(info.section));
+        }
+    }
+    g_database->updateDashboardDataBatch(entries);
+}
+
+// Broadcast stage: the categories of the latest snapshot that changed, to
+// the clients subscribed to them, at most once per broadcast_min_interval_ms
+void broadcastSystemData() {
+    if (!g_server || !g_system_collector) {
+        return;
+    }
+    UR_TRACE_SPAN("dashboard.push");
+    
+    auto snapshot = g_system_collector->getJsonSnapshot();
+    const json& metrics = snapshot->metrics();
+    for (const auto& info : kDashboardCategories) {
+        if (info.section) {
+            broadcastDashboardUpdate(info.id, metrics.at(info.section));
+        }
+    }
+}
+
+// Exports the counters the subsystems already keep; read at scrape time,
+// so nothing is added to their hot paths
+void registerRuntimeMetrics() {
+    using UrMetrics::Registry;
+    Registry& registry = Registry::instance();
+    const auto counter = Registry::Type::Counter;
+    const auto gauge = Registry::Type::Gauge;
+    
+    registry.callback("backend_ws_connections", "Open WebSocket connections", gauge, []() {
+        return g_server ? static_cast<double>(g_server->getConnectionCount()) : 0.0;
+    });
+    registry.callback("backend_ws_messages_sent_total", "WebSocket messages queued to a client", counter, []() {
+        return g_server ? static_cast<double>(g_server->getSendQueueStats().messages_sent) : 0.0;
+    });
+    registry.callback("backend_ws_messages_coalesced_total",
+                      "Updates replaced by a newer one while the client was over its buffer limit", counter, []() {
+        return g_server ? static_cast<double>(g_server->getSendQueueStats().messages_coalesced) : 0.0;
+    });
+    registry.callback("backend_ws_messages_dropped_total", "WebSocket messages dropped for slow consumers", counter, []() {
+        return g_server ? static_cast<double>(g_server->getSendQueueStats().messages_dropped) : 0.0;
+    });
+    registry.callback("backend_ws_connections_evicted_total", "Slow consumers disconnected", counter, []() {
+        return g_server ? static_cast<double>(g_server->getSendQueueStats().connections_evicted) : 0.0;
+    });
+    registry.callback("backend_ws_connections_rejected_total",
+                      "Handshakes refused over max_connections or under memory pressure", counter, []() {
+        return g_server ? static_cast<double>(g_server->getSendQueueStats().connections_rejected) : 0.0;
+    });
+    registry.callback("backend_ws_connections_timed_out_total", "Connections closed for a missed pong or idling",
+                      counter, []() {
+        return g_server ? static_cast<double>(g_server->getSendQueueStats().connections_timed_out) : 0.0;
+    });
+    
+    registry.callback("backend_ws_handler_pending", "WebSocket requests waiting for a handler thread", gauge, []() {
+        return g_handler_executor ? static_cast<double>(g_handler_executor->getPendingCount()) : 0.0;
+    });
+    registry.callback("backend_ws_handler_rejected_total", "WebSocket requests answered busy because the handler queue was full",
+                      counter, []() {
+        return g_handler_executor ? static_cast<double>(g_handler_executor->getRejectedCount()) : 0.0;
+    });
+    
+    for (Transport transport : {Transport::WebSocket, Transport::Mqtt}) {
+        const char* name = BackendDatalink::transportName(transport);
+        registry.callback("backend_requests_total", "Method calls routed, by front door and outcome", counter,
+                          [transport]() {
+            return static_cast<double>(g_request_router.getCallCount(transport) - g_request_router.getErrorCount(transport));
+        }, {{"transport", name}, {"result", "ok"}});
+        registry.callback("backend_requests_total", "Method calls routed, by front door and outcome", counter,
+                          [transport]() { return static_cast<double>(g_request_router.getErrorCount(transport)); },
+                          {{"transport", name}, {"result", "error"}});
+        registry.callback("backend_requests_coalesced_total", "Method calls answered by another caller's run",
+                          counter, [transport]() {
+            return static_cast<double>(g_request_router.getCoalescedCount(transport));
+        }, {{"transport", name}});
+    }
+    
+    registry.callback("backend_rpc_pending_requests", "RPC requests queued or waiting for a worker", gauge, []() {
+        return g_operationProcessor ? static_cast<double>(g_operationProcessor->getPendingCount()) : 0.0;
+    });
+    registry.callback("backend_rpc_rejected_requests_total", "RPC requests answered busy because the queue was full",
+                      counter, []() {
+        return g_operationProcessor ? static_cast<double>(g_operationProcessor->getRejectedCount()) : 0.0;
+    });
+    for (size_t lane = 0; lane < RpcOperationProcessor::kLaneCount; ++lane) {
+        registry.callback("backend_rpc_expired_requests_total", "RPC requests dropped because their caller timed out",
+                          counter, [lane]() {
+            return g_operationProcessor ? static_cast<double>(g_operationProcessor->getExpiredCount(lane)) : 0.0;
+        }, {{"lane", RpcOperationProcessor::laneName(lane)}});
+    }
+    registry.callback("backend_rpc_redelivered_requests_total", "Redelivered RPC requests that were not run again",
+                      counter, []() {
+        return g_operationProcessor ? static_cast<double>(g_operationProcessor->getReplayedCount()) : 0.0;
+    }, {{"outcome", "replayed"}});
+    registry.callback("backend_rpc_redelivered_requests_total", "Redelivered RPC requests that were not run again",
+                      counter, []() {
+        return g_operationProcessor ? static_cast<double>(g_operationProcessor->getDuplicateInFlightCount()) : 0.0;
+    }, {{"outcome", "in_flight"}});
+    registry.callback("backend_rpc_chunked_responses_total", "RPC responses sent in chunks", counter, []() {
+        return g_operationProcessor ? static_cast<double>(g_operationProcessor->getChunkedCount()) : 0.0;
+    });
+    registry.callback("backend_rpc_chunked_responses_abandoned_total",
+                      "Chunked RPC responses dropped unfinished because the requester stopped acking", counter, []() {
+        return g_operationProcessor ? static_cast<double>(g_operationProcessor->getAbandonedChunkedCount()) : 0.0;
+    });
+    registry.callback("backend_rpc_outbound_pending", "MQTT messages waiting for the publisher thread", gauge, []() {
+        return g_rpcClient ? static_cast<double>(g_rpcClient->getOutboundPendingCount()) : 0.0;
+    });
+    registry.callback("backend_rpc_outbound_dropped_total", "MQTT messages dropped because a lane was full",
+                      counter, []() {
+        return g_rpcClient ? static_cast<double>(g_rpcClient->getOutboundDroppedCount()) : 0.0;
+    });
+    registry.callback("backend_mqtt_messages_sent_total", "Messages published by the MQTT client", counter, []() {
+        return g_rpcClient ? static_cast<double>(g_rpcClient->getStatistics().messages_sent) : 0.0;
+    });
+    registry.callback("backend_mqtt_messages_received_total", "Messages received by the MQTT client", counter, []() {
+        return g_rpcClient ? static_cast<double>(g_rpcClient->getStatistics().messages_received) : 0.0;
+    });
+    registry.callback("backend_mqtt_errors_total", "MQTT client errors", counter, []() {
+        return g_rpcClient ? static_cast<double>(g_rpcClient->getStatistics().errors_count) : 0.0;
+    });
+    registry.callback("backend_mqtt_connected", "1 while connected to the broker", gauge, []() {
+        return g_rpcClient && g_rpcClient->isConnected() ? 1.0 : 0.0;
+    });
+    
+    registry.callback("backend_db_dropped_log_entries_total",
+                      "Connection and message log entries dropped by the write-behind queue", counter, []() {
+        return g_database ? static_cast<double>(g_database->getDroppedLogCount()) : 0.0;
+    });
+    
+    registry.callback("backend_memory_resident_bytes", "Resident set of the process", gauge, []() {
+        return g_memory_budget ? static_cast<double>(g_memory_budget->residentBytes()) : 0.0;
+    });
+    registry.callback("backend_memory_degrade_level", "Memory budget level: 0 normal, 1 soft, 2 hard", gauge, []() {
+        return static_cast<double>(static_cast<int>(memoryLevel()));
+    });
+    if (g_memory_budget) {
+        for (const auto& name : g_memory_budget->sourceNames()) {
+            registry.callback("backend_memory_bytes", "Memory held by a subsystem", gauge, [name]() {
+                return g_memory_budget ? static_cast<double>(g_memory_budget->sourceBytes(name)) : 0.0;
+            }, {{"subsystem", name}});
         }
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Error updating system data in database: " << e.what() << std::endl;
     }
 }
 
@@ -471,8 +1483,10 @@ int main(int argc, char* argv[]) {
     }
     
     try {
-        ConfigLoader config_loader;
-        config_loader.loadFromFile(config_path);
+        // SIGHUP publishes a new snapshot; this one stays valid for startup
+        ConfigStore config_store(config_path);
+        std::shared_ptr<const ConfigLoader> config = config_store.reload();
+        const ConfigLoader& config_loader = *config;
         
         const auto& ws_config = config_loader.getWebSocketConfig();
         
@@ -481,125 +1495,528 @@ int main(int argc, char* argv[]) {
         std::cout << "  Host: " << ws_config.host << std::endl;
         std::cout << "  Port: " << ws_config.port << std::endl;
         std::cout << "  Max connections: " << ws_config.max_connections << std::endl;
-        std::cout << "  Timeout: " << ws_config.timeout_ms << "ms" << std::endl;
+        std::cout << "  Handshake timeout: " << ws_config.timeout_ms << "ms" << std::endl;
+        std::cout << "  Keepalive: ping every " << ws_config.ping_interval_ms << "ms, pong timeout "
+                  << ws_config.pong_timeout_ms << "ms, idle timeout " << ws_config.idle_timeout_ms << "ms" << std::endl;
         std::cout << "  Logging: " << (ws_config.enable_logging ? "enabled" : "disabled") << std::endl;
+        std::cout << "  Snapshot on connect: " << (ws_config.snapshot_on_connect ? "enabled" : "disabled") << std::endl;
         std::cout << "  RPC Config: " << rpc_config_path << std::endl;
         std::cout << std::endl;
         
         signal(SIGINT, signalHandler);
-        signal(SIGTERM, signalHandler);
+        signal(SIGTERM, ws_config.drain_seconds > 0 ? drainSignalHandler : signalHandler);
+        signal(SIGHUP, reloadSignalHandler);
+        
+        // Backend and RPC library lines share one async writer, so request
+        // paths never block on stdout
+        const auto& rpc_config = config_loader.getRpcConfig();
+        logger_init(BackendDatalink::Log::levelFromName(config_loader.getLoggingConfig().level),
+                    static_cast<log_flags_t>(LOG_FLAG_CONSOLE | LOG_FLAG_TIMESTAMP), nullptr);
+        if (rpc_config.log_queue_capacity > 0 &&
+            logger_enable_async(static_cast<size_t>(rpc_config.log_queue_capacity),
+                                static_cast<unsigned int>(rpc_config.log_flush_interval_ms)) != 0) {
+            std::cerr << "Logging synchronously" << std::endl;
+        }
+        
+        // Before any thread records its first span, so every ring gets this size
+        const auto& trace_config = config_loader.getTraceConfig();
+        UrTrace::setBufferCapacity(static_cast<size_t>(trace_config.buffer_events));
+        UrTrace::setEnabled(trace_config.enabled);
         
-        // Initialize database
+        // Subsystems are created and wired here, on the main thread, and
+        // brought up below by the startup orchestrator
         g_database = std::make_unique<DatabaseManager>();
-        if (!g_database->initialize(config_loader.getDatabaseConfig())) {
-            std::cerr << "Failed to initialize database" << std::endl;
-            return 1;
+        const auto& history_config = config_loader.getMetricsHistoryConfig();
+        if (history_config.enabled) {
+            g_metrics_history = std::make_unique<MetricsHistory>(g_database.get(), history_config);
         }
         
+        // Method table shared by the RPC processor and the WebSocket handlers;
+        // handlers find their subsystem when called, so it can be frozen now
+        BackendDatalink::registerDashboardMethods(g_rpc_methods);
+        BackendDatalink::registerNetworkPriorityMethods(g_rpc_methods);
+        BackendDatalink::registerCollectorMethods(g_rpc_methods);
+        BackendDatalink::registerHistoryMethods(g_rpc_methods);
+        BackendDatalink::registerCameraMethods(g_rpc_methods);
+        BackendDatalink::registerWirelessMethods(g_rpc_methods);
+        BackendDatalink::registerRegistryMethods(g_rpc_methods);
+        g_rpc_methods.freeze();
+        
+        // Both front doors call through the router: a dashboard read is
+        // shared between cloud and browser callers until the data moves
+        g_request_router.coalesce("dashboard.get_data", []() -> uint64_t {
+            return (g_database ? g_database->getDashboardGeneration() : 0) + g_dashboard_delta.getVersion();
+        });
+        
         // Initialize RPC client and operation processor
         std::cout << "Initializing RPC client..." << std::endl;
-        g_rpcClient = std::make_unique<RpcClient>(rpc_config_path, "backend-datalink");
-        g_operationProcessor = std::make_unique<RpcOperationProcessor>(true);
+        g_rpcClient = std::make_unique<RpcClient>(rpc_config_path, "backend-datalink",
+                                                  static_cast<size_t>(rpc_config.outbound_queue_capacity));
+        const auto& threads_config = config_loader.getThreadsConfig();
+        g_rpcClient->setThreadAttributes(ThreadMgr::ThreadManager::threadAttributesFromJson(threads_config.mqtt.dump()));
+        g_operationProcessor = std::make_unique<RpcOperationProcessor>(
+            true, static_cast<size_t>(rpc_config.worker_threads), static_cast<size_t>(rpc_config.queue_capacity));
+        g_operationProcessor->setRouter(&g_request_router);
+        g_operationProcessor->setPublisher(g_rpcClient.get());
+        g_operationProcessor->setReplayWindow(static_cast<size_t>(rpc_config.replay_cache_size),
+                                              std::chrono::seconds(rpc_config.replay_ttl_seconds));
+        g_operationProcessor->setChunking(static_cast<size_t>(rpc_config.response_chunk_bytes),
+                                          static_cast<size_t>(rpc_config.response_chunk_window),
+                                          "direct_messaging/backend-datalink/requests");
+        
+        // Ultima server health rides on the client's own heartbeats. Shared,
+        // as the client and collector threads may outlive this scope on an
+        // early return.
+        auto ultima_probe = std::make_shared<BackendDatalink::UltimaHealthProbe>(g_rpcClient.get());
+        g_rpcClient->setHeartbeatRttHandler([ultima_probe](double rtt_ms) { ultima_probe->recordRtt(rtt_ms); });
+        UrMetrics::Registry::instance().callback(
+            "backend_ultima_ping_ms", "Heartbeat round trip through the broker (EWMA)",
+            UrMetrics::Registry::Type::Gauge, [ultima_probe]() { return ultima_probe->getAverageMs(); });
+        UrMetrics::Registry::instance().callback(
+            "backend_ultima_ping_echoes_total", "Heartbeats timed on their way back from the broker",
+            UrMetrics::Registry::Type::Counter,
+            [ultima_probe]() { return static_cast<double>(ultima_probe->getEchoCount()); });
         
         // Set message handler BEFORE starting the client
-        g_rpcClient->setMessageHandler([&](const std::string &topic, const std::string &payload) {
-            // Topic filtering for selective processing
-            if (topic.find("direct_messaging/backend-datalink/requests") == std::string::npos) {
-                return;
-            }
-            
+        // Only the request topics (json_added_subs, shared across instances
+        // when shared_subscription_group is set) are subscribed, and responses
+        // to our own calls never reach this handler, so there is nothing to
+        // filter by topic here
+        g_rpcClient->setMessageHandler([&](std::string_view, std::string_view payload) {
             // Delegate to operation processor
             if (g_operationProcessor) {
-                g_operationProcessor->processRequest(payload.c_str(), payload.size());
+                g_operationProcessor->processRequest(payload.data(), payload.size());
             }
         });
         
         // Set response topic for operation processor
         g_operationProcessor->setResponseTopic("direct_messaging/backend-datalink/responses");
         
-        // Start RPC client
-        if (!g_rpcClient->start()) {
-            std::cerr << "Failed to start RPC client" << std::endl;
-            return 1;
-        }
-        
-        std::cout << "RPC client started successfully" << std::endl;
-        
-        // Initialize system data collector
+        // Collector snapshots are pushed to two stages as soon as they are
+        // published: persistence and broadcast, each with its own rate limit,
+        // coalescing whatever arrives while it waits. Log settings come from
+        // the current configuration, so a reload applies them from the next
+        // write on.
         const auto& system_config = config_loader.getSystemDataConfig();
+        std::unique_ptr<BackendDatalink::PipelineStage> persist_stage;
+        std::unique_ptr<BackendDatalink::PipelineStage> broadcast_stage;
+        std::unique_ptr<BackendDatalink::TelemetryPublisher> telemetry;
+        std::unique_ptr<BackendDatalink::PipelineStage> telemetry_stage;
         if (system_config.enabled) {
+            auto persist_count = std::make_shared<int>(0);
+            persist_stage = std::make_unique<BackendDatalink::PipelineStage>("persist", [&config_store, persist_count]() {
+                persistSystemData();
+                int count = ++*persist_count;
+                
+                auto current = config_store.current();
+                const auto& logging = current->getSystemDataConfig();
+                if (logging.log_database_updates && logging.database_update_log_interval > 0 &&
+                    count % logging.database_update_log_interval == 1) {
+                    BACKEND_LOG_INFO("[SystemDataCollector] Database updated with latest metrics (update #"
+                                     << count << ")");
+                }
+            });
+            broadcast_stage = std::make_unique<BackendDatalink::PipelineStage>("broadcast", broadcastSystemData);
+            persist_stage->start(std::chrono::seconds(system_config.database_update_interval_seconds));
+            broadcast_stage->start(std::chrono::milliseconds(system_config.broadcast_min_interval_ms));
+            
+            // Downsampled metrics over MQTT: one sample per sample_interval_ms
+            // at most, aggregated and filtered by the publisher
+            const auto& telemetry_config = config_loader.getTelemetryConfig();
+            if (telemetry_config.enabled) {
+                telemetry = std::make_unique<BackendDatalink::TelemetryPublisher>(telemetry_config, g_rpcClient.get());
+                telemetry_stage = std::make_unique<BackendDatalink::PipelineStage>("telemetry", [&telemetry]() {
+                    auto snapshot = g_system_collector ? g_system_collector->getSnapshot() : nullptr;
+                    if (snapshot) {
+                        telemetry->record(*snapshot);
+                    }
+                });
+                telemetry_stage->start(std::chrono::milliseconds(telemetry_config.sample_interval_ms));
+                
+                auto& registry = UrMetrics::Registry::instance();
+                BackendDatalink::TelemetryPublisher* publisher = telemetry.get();
+                registry.callback("backend_telemetry_published_total", "Telemetry notifications sent",
+                                  UrMetrics::Registry::Type::Counter,
+                                  [publisher]() { return static_cast<double>(publisher->getPublishedCount()); });
+                registry.callback("backend_telemetry_suppressed_total", "Telemetry fields left out within their deadband",
+                                  UrMetrics::Registry::Type::Counter,
+                                  [publisher]() { return static_cast<double>(publisher->getSuppressedCount()); });
+                registry.callback("backend_telemetry_failed_total", "Telemetry windows whose notification was not sent",
+                                  UrMetrics::Registry::Type::Counter,
+                                  [publisher]() { return static_cast<double>(publisher->getFailedCount()); });
+            }
+            
+            for (BackendDatalink::PipelineStage* stage : {persist_stage.get(), broadcast_stage.get(), telemetry_stage.get()}) {
+                if (!stage) {
+                    continue;
+                }
+                UrMetrics::Registry::instance().callback(
+                    "backend_pipeline_stage_coalesced_total", "Snapshots a pipeline stage skipped for a newer one",
+                    UrMetrics::Registry::Type::Counter,
+                    [stage]() { return static_cast<double>(stage->getCoalescedCount()); }, {{"stage", stage->getName()}});
+            }
+            
             g_system_collector = std::make_unique<SystemDataCollector>();
+            g_system_collector->addPublishListener([&persist_stage, &broadcast_stage, &telemetry_stage](uint64_t) {
+                persist_stage->notify();
+                broadcast_stage->notify();
+                if (telemetry_stage) {
+                    telemetry_stage->notify();
+                }
+            });
             g_system_collector->setPollInterval(system_config.poll_interval_seconds);
             g_system_collector->setCollectionProgressLogInterval(system_config.collection_progress_log_interval);
-            if (!g_system_collector->start(system_config.poll_interval_seconds)) {
-                std::cerr << "Failed to start system data collector" << std::endl;
-                return 1;
+            for (const auto& interval : system_config.collector_intervals_ms) {
+                if (!g_system_collector->setCollectorInterval(interval.first, interval.second)) {
+                    std::cerr << "Ignoring interval for unknown collector: " << interval.first << std::endl;
+                }
+            }
+            if (!g_system_collector->setLatencyTargets(system_config.latency_targets)) {
+                std::cerr << "Invalid system_data.latency_targets, keeping the defaults" << std::endl;
+            }
+            g_system_collector->setLatencyProbeTimeout(system_config.latency_timeout_ms);
+            g_system_collector->setLatencyWindowSize(static_cast<size_t>(system_config.latency_window));
+            if (!g_system_collector->setExternalIpEndpoints(system_config.external_ip_endpoints)) {
+                std::cerr << "Invalid system_data.external_ip_endpoints, keeping the defaults" << std::endl;
             }
-            std::cout << "System data collector started successfully with " 
-                     << system_config.poll_interval_seconds << "s interval" << std::endl;
+            g_system_collector->setModem(system_config.modem_device, system_config.modem_data_interface);
+            g_system_collector->setProcessTopCount(static_cast<size_t>(system_config.process_top_count));
+            g_system_collector->setWatchedProcesses(system_config.watched_processes);
+            g_system_collector->setStorageMounts(system_config.storage_mounts);
+            g_system_collector->setSharedMemoryName(system_config.shared_memory_name);
+            g_system_collector->setUltimaServerSource([ultima_probe](SystemDataCollector::SystemMetrics::UltimaServer& server) {
+                ultima_probe->sample(server);
+            });
         } else {
             std::cout << "System data collector disabled in configuration" << std::endl;
         }
         
         // Initialize network priority manager
         g_network_priority_manager = std::make_unique<NetworkPriorityManager>(g_database.get());
+        g_network_priority_manager->setThreadAttributes(
+            ThreadMgr::ThreadManager::threadAttributesFromJson(threads_config.network_priority.dump()));
+        if (!g_network_priority_manager->setReachabilitySettings(
+                reachabilitySettings(config_loader.getNetworkPriorityConfig()))) {
+            std::cerr << "Invalid network_priority.reachability_targets, keeping the defaults" << std::endl;
+        }
+        g_network_priority_manager->setFailoverSettings(failoverSettings(config_loader.getNetworkPriorityConfig()));
         
         // Set up data update handler to broadcast via WebSocket
         g_network_priority_manager->setDataUpdateHandler([](const nlohmann::json& data) {
-            broadcastDashboardUpdate("network_priority", data);
+            broadcastDashboardUpdate(DashboardCategory::NetworkPriority, data);
         });
-        
-        // Initialize database tables for network priority
-        if (!g_network_priority_manager->initializeDatabaseTables()) {
-            std::cerr << "Failed to initialize network priority database tables" << std::endl;
-            return 1;
-        }
-        
-        // Start network priority manager
-        if (!g_network_priority_manager->start(5)) { // 5 second poll interval
-            std::cerr << "Failed to start network priority manager" << std::endl;
-            return 1;
-        }
-        
-        std::cout << "Network priority manager started successfully" << std::endl;
-        
-        // Start database update thread for system data
-        std::thread db_update_thread([system_config]() {
-            int update_count = 0;
-            while (g_running.load()) {
-                updateSystemDataInDatabase();
-                update_count++;
-                
-                // Log database updates if enabled
-                if (system_config.log_database_updates && 
-                    update_count % system_config.database_update_log_interval == 1) {
-                    std::cout << "[SystemDataCollector] Database updated with latest metrics (update #" 
-                             << update_count << ")" << std::endl;
+        g_network_priority_manager->setTrafficSource([]() {
+            nlohmann::json traffic = nlohmann::json::object();
+            if (g_system_collector && g_system_collector->isRunning()) {
+                for (const auto& interface : g_system_collector->getJsonSnapshot()->metrics()["network"]["interfaces"]) {
+                    nlohmann::json rates = interface;
+                    rates.erase("name");
+                    traffic[interface["name"].get<std::string>()] = std::move(rates);
                 }
-                
-                std::this_thread::sleep_for(std::chrono::seconds(system_config.database_update_interval_seconds));
             }
+            return traffic;
         });
         
+        g_snapshot_on_connect = ws_config.snapshot_on_connect;
         g_server = std::make_unique<ManagedWebSocketServer>();
+        g_server->setThreadAttributes(ThreadMgr::ThreadManager::threadAttributesFromJson(threads_config.websocket.dump()));
         g_server->setMessageHandler(onMessage);
         g_server->setConnectionOpenHandler(onConnectionOpen);
         g_server->setConnectionCloseHandler(onConnectionClose);
+        if (ws_config.handler_threads > 0) {
+            g_handler_executor = std::make_unique<BackendDatalink::HandlerExecutor>(
+                static_cast<size_t>(ws_config.handler_threads), static_cast<size_t>(ws_config.handler_queue));
+        }
         
-        if (!g_server->start(ws_config)) {
-            std::cerr << "Failed to start WebSocket server" << std::endl;
+        // Collectors nobody watches, and all of them on a loaded box, slow down
+        g_collector_governor = std::make_unique<BackendDatalink::CollectorGovernor>([](const std::string& category) {
+            return g_server ? g_server->getSubscriberCount(category) : 0;
+        });
+        g_collector_governor->setSettings(governorSettings(system_config));
+        if (g_system_collector) {
+            const std::pair<const char*, std::vector<DashboardCategory>> collectors[] = {
+                {"cpu", {DashboardCategory::System}},
+                {"memory", {DashboardCategory::Ram, DashboardCategory::Swap}},
+                {"network_link", {DashboardCategory::Network}},
+                // Also the live rates network_priority replies carry
+                {"network_traffic", {DashboardCategory::Network, DashboardCategory::NetworkPriority}},
+                {"ultima_server", {DashboardCategory::UltimaServer}},
+                {"processes", {DashboardCategory::Processes}},
+                {"storage", {DashboardCategory::Storage}}
+            };
+            for (const auto& collector : collectors) {
+                std::string name = collector.first;
+                g_collector_governor->addCollector(name, collector.second, [name](int slowdown) {
+                    g_system_collector->setCollectorSlowdown(name, slowdown);
+                });
+            }
+        }
+        g_collector_governor->addCollector("network_priority", {DashboardCategory::NetworkPriority}, [](int slowdown) {
+            g_network_priority_manager->setSlowdown(slowdown);
+        });
+        
+        // Memory held by the subsystems that grow with clients and load;
+        // over budget the process sheds history and rate, then clients
+        BackendDatalink::PipelineStage* broadcast = broadcast_stage.get();
+        g_memory_budget = std::make_unique<BackendDatalink::MemoryBudget>(
+            [&config_store, broadcast](BackendDatalink::MemoryBudget::Level level) {
+                applyMemoryLevel(*config_store.current(), level, broadcast);
+            });
+        g_memory_budget->setSettings(memoryBudgetSettings(config_loader.getMemoryBudgetConfig()));
+        g_memory_budget->addSource("websocket_send", []() {
+            return g_server ? g_server->getQueuedBytes() : 0;
+        });
+        g_memory_budget->addSource("metrics_history", []() {
+            return g_metrics_history ? g_metrics_history->memoryBytes() : 0;
+        });
+        g_memory_budget->addSource("fleet", []() {
+            return g_fleet ? g_fleet->heldBytes() : 0;
+        });
+        
+        // The UI comes up as soon as the database is open and serves the
+        // cached dashboard from it; the broker connection, the collector's
+        // first probes and the routing restore proceed meanwhile. Whatever
+        // publishes to the server starts after it.
+        BackendDatalink::StartupOrchestrator startup;
+        startup.add("database", {}, [&config_loader]() {
+            return g_database->initialize(config_loader.getDatabaseConfig());
+        });
+        startup.add("metrics_history", {"database"}, []() {
+            if (g_metrics_history && !g_metrics_history->initialize()) {
+                std::cerr << "Metrics history will not be persisted" << std::endl;
+            }
+            return true;
+        });
+        startup.add("websocket", {"database", "metrics_history"}, [&ws_config]() {
+            return g_server->start(ws_config);
+        });
+        // Requests can arrive as soon as it connects, and they read the database
+        startup.add("rpc_client", {"database"}, [&config_loader]() {
+            if (!g_rpcClient->start()) {
+                return false;
+            }
+            // ur_rpc_init() resets the shared logger to INFO
+            logger_set_level(BackendDatalink::Log::levelFromName(config_loader.getLoggingConfig().level));
+            return true;
+        });
+        if (g_system_collector) {
+            startup.add("system_collector", {"websocket"}, [&system_config]() {
+                return g_system_collector->start(system_config.poll_interval_seconds);
+            });
+        }
+        startup.add("network_priority", {"websocket"}, []() {
+            return g_network_priority_manager->initializeDatabaseTables() &&
+                   g_network_priority_manager->start(5); // 5 second poll interval
+        });
+        
+        bool started = startup.run();
+        for (const auto& phase : startup.report()) {
+            double duration_ms = phase["duration_ms"];
+            UrMetrics::Registry::instance().callback(
+                "backend_startup_phase_ms", "Time a startup phase took",
+                UrMetrics::Registry::Type::Gauge, [duration_ms]() { return duration_ms; },
+                {{"phase", phase["phase"].get<std::string>()}});
+        }
+        if (!started) {
+            std::cerr << "Startup failed: " << startup.report().dump() << std::endl;
             return 1;
         }
+
+        // Thread statistics are not collector data; they are sampled on the
+        // shared timer thread, next to the MQTT heartbeats and request timeouts
+        UrRpc::Timer thread_stats_timer;
+        std::function<void()> thread_stats_tick = []() {
+            if (g_running.load()) {
+                publishThreadStats();
+            }
+        };
+        thread_stats_timer.start(0, static_cast<uint64_t>(system_config.database_update_interval_seconds) * 1000,
+                                 thread_stats_tick);
+        UrRpc::Timer governor_timer;
+        governor_timer.start(kGovernorIntervalMs, kGovernorIntervalMs, []() {
+            if (g_running.load()) {
+                g_collector_governor->evaluate(std::chrono::steady_clock::now());
+            }
+        });
+        UrRpc::Timer memory_timer;
+        memory_timer.start(kMemoryCheckIntervalMs, kMemoryCheckIntervalMs, []() {
+            if (g_running.load()) {
+                g_memory_budget->evaluate();
+            }
+        });
         
         std::cout << "WebSocket server started successfully!" << std::endl;
+        
+        const auto& diagnostics_config = config_loader.getDiagnosticsConfig();
+        if (diagnostics_config.enabled) {
+            g_diagnostics = std::make_unique<BackendDatalink::DiagnosticJobs>(
+                [](ConnectionId connection_id, const json& message) {
+                    if (g_server) {
+                        g_server->sendToClient(connection_id, message);
+                    }
+                },
+                static_cast<size_t>(diagnostics_config.max_concurrent_jobs),
+                std::chrono::seconds(diagnostics_config.max_duration_seconds));
+            g_diagnostics->start();
+        }
+        
+        // Cache changes are persisted like the other categories, so
+        // dashboard_data serves the last known cameras without a scan
+        const auto& camera_config = config_loader.getCameraDiscoveryConfig();
+        if (camera_config.enabled) {
+            g_camera_discovery = std::make_unique<BackendDatalink::CameraDiscovery>(camera_config, [](const json& cameras) {
+                if (g_database && g_database->isInitialized()) {
+                    g_database->updateDashboardData(categoryName(DashboardCategory::Cameras), cameras);
+                }
+                broadcastDashboardUpdate(DashboardCategory::Cameras, cameras);
+            });
+            if (!g_camera_discovery->start()) {
+                std::cerr << "Camera discovery will not be available" << std::endl;
+                g_camera_discovery.reset();
+            }
+        }
+        
+        // Telemetry batches are parked per connection under backpressure, so
+        // a slow client gets the newest batch rather than a backlog
+        const auto& mavlink_config = config_loader.getMavlinkConfig();
+        if (mavlink_config.enabled) {
+            g_mavlink = std::make_unique<BackendDatalink::MavlinkBridge>(
+                mavlink_config, [](ConnectionId connection_id, const std::string& frames) {
+                    if (g_server) {
+                        g_server->sendBinaryToClient(connection_id, frames, "mavlink");
+                    }
+                });
+            if (!g_mavlink->start()) {
+                std::cerr << "MAVLink telemetry will not be available" << std::endl;
+                g_mavlink.reset();
+            }
+        }
+        
+        const auto& wireless_config = config_loader.getWirelessScanConfig();
+        if (wireless_config.enabled) {
+            g_wireless_scanner = std::make_unique<BackendDatalink::WirelessScanner>(wireless_config, [](const json& wireless) {
+                if (g_database && g_database->isInitialized()) {
+                    g_database->updateDashboardData(categoryName(DashboardCategory::Wireless), wireless);
+                }
+                broadcastDashboardUpdate(DashboardCategory::Wireless, wireless);
+            });
+            if (!g_wireless_scanner->start()) {
+                std::cerr << "Wireless site survey will not be available" << std::endl;
+                g_wireless_scanner.reset();
+            }
+        }
+        
+        // Tunnel changes and byte counters arrive as events; the page reads
+        // the "vpn" category with get_dashboard_data and follows its updates
+        const auto& vpn_config = config_loader.getVpnMonitorConfig();
+        if (vpn_config.enabled) {
+            g_vpn_monitor = std::make_unique<BackendDatalink::VpnMonitor>(vpn_config, [](const json& vpn) {
+                if (g_database && g_database->isInitialized()) {
+                    g_database->updateDashboardData(categoryName(DashboardCategory::Vpn), vpn);
+                }
+                broadcastDashboardUpdate(DashboardCategory::Vpn, vpn);
+            });
+            if (!g_vpn_monitor->start()) {
+                std::cerr << "VPN status will not be available" << std::endl;
+                g_vpn_monitor.reset();
+            }
+        }
+        
+        const auto& tail_config = config_loader.getLogTailConfig();
+        if (tail_config.enabled) {
+            g_log_tail = std::make_unique<BackendDatalink::LogTail>(
+                tail_config, [](ConnectionId connection_id, const json& message) {
+                    if (g_server) {
+                        g_server->sendToClient(connection_id, message);
+                    }
+                });
+            if (!g_log_tail->start()) {
+                std::cerr << "Log tailing will not be available" << std::endl;
+                g_log_tail.reset();
+            }
+        }
+        
+        const auto& fleet_config = config_loader.getFleetConfig();
+        if (fleet_config.enabled) {
+            g_fleet = std::make_unique<BackendDatalink::FleetAggregator>(
+                fleet_config, [](ConnectionId connection_id, const json& message) {
+                    if (g_server) {
+                        g_server->sendToClient(connection_id, message);
+                    }
+                });
+            if (!g_fleet->start()) {
+                std::cerr << "Fleet aggregation will not be available" << std::endl;
+                g_fleet.reset();
+            }
+        }
+        
+        BackendDatalink::MetricsExporter metrics_exporter;
+        const auto& metrics_config = config_loader.getMetricsConfig();
+        if (metrics_config.enabled) {
+            registerRuntimeMetrics();
+            if (!metrics_exporter.start(metrics_config.host, metrics_config.port)) {
+                std::cerr << "Metrics will not be exported" << std::endl;
+            }
+        }
         std::cout << "Waiting for connections... Press Ctrl+C to stop." << std::endl;
         
         while (g_running.load() && g_server->isRunning()) {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            
+            if (g_reload_requested.exchange(false)) {
+                auto previous = config_store.current();
+                try {
+                    auto next = config_store.reload();
+                    applyReloadedConfig(*previous, *next, persist_stage.get(), broadcast_stage.get(),
+                                        thread_stats_timer, thread_stats_tick);
+                    std::cout << "[Config] Reloaded " << config_store.path() << std::endl;
+                } catch (const std::exception& e) {
+                    std::cerr << "[Config] Reload failed, keeping the running configuration: " << e.what() << std::endl;
+                }
+            }
         }
         
         std::cout << "Shutting down server..." << std::endl;
         
+        // Clients first, while everything they might still ask for is up
+        int drain_seconds = config_store.current()->getWebSocketConfig().drain_seconds;
+        if (drain_seconds > 0) {
+            std::cout << "Draining WebSocket clients for up to " << drain_seconds << "s..." << std::endl;
+            g_server->drain(std::chrono::seconds(drain_seconds));
+        } else {
+            g_server->stop();
+        }
+        
+        metrics_exporter.stop();
+        
+        // Handlers already taken finish, route changes included
+        if (g_handler_executor) {
+            g_handler_executor->stop();
+        }
+        
+        // Kill running diagnostics before the server they stream to goes
+        if (g_diagnostics) {
+            g_diagnostics->stop();
+        }
+        if (g_camera_discovery) {
+            g_camera_discovery->stop();
+        }
+        if (g_mavlink) {
+            g_mavlink->stop();
+        }
+        if (g_wireless_scanner) {
+            g_wireless_scanner->stop();
+        }
+        if (g_vpn_monitor) {
+            g_vpn_monitor->stop();
+        }
+        if (g_log_tail) {
+            g_log_tail->stop();
+        }
+        if (g_fleet) {
+            g_fleet->stop();
+        }
+        
         // Stop RPC client and operation processor
         if (g_rpcClient) {
             g_rpcClient->stop();
@@ -611,6 +2028,9 @@ int main(int argc, char* argv[]) {
             std::cout << "RPC operation processor shutdown" << std::endl;
         }
         
+        // Write out queued RPC library log lines and log synchronously again
+        logger_disable_async();
+        
         // Stop system data collector
         if (g_system_collector) {
             g_system_collector->stop();
@@ -621,9 +2041,23 @@ int main(int argc, char* argv[]) {
             g_network_priority_manager->stop();
         }
         
-        // Wait for database update threads to finish
-        if (db_update_thread.joinable()) {
-            db_update_thread.join();
+        // Stop the pipeline and thread statistics, waiting out runs in progress
+        if (persist_stage) {
+            persist_stage->stop();
+        }
+        if (broadcast_stage) {
+            broadcast_stage->stop();
+        }
+        if (telemetry_stage) {
+            telemetry_stage->stop();
+        }
+        thread_stats_timer.cancel();
+        governor_timer.cancel();
+        memory_timer.cancel();
+        
+        // Persist the history collected since the last flush
+        if (g_metrics_history) {
+            g_metrics_history->flush();
         }
         
         // Shutdown database
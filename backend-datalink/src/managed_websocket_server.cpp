@@ -1,5 +1,5 @@
 #include "managed_websocket_server.h"
-#include <iostream>
+#include "backend_log.h"
 #include <sstream>
 #include <chrono>
 
@@ -13,19 +13,19 @@ ManagedWebSocketServer::ManagedWebSocketServer()
         websocket_server_ = std::make_unique<WebSocketServer>();
         
         // Set up websocket server handlers
-        websocket_server_->setMessageHandler([this](const std::string& connection_id, const nlohmann::json& message) {
+        websocket_server_->setMessageHandler([this](BackendDatalink::ConnectionId connection_id, const BackendDatalink::InboundMessage& message) {
             if (message_handler_) {
                 message_handler_(connection_id, message);
             }
         });
         
-        websocket_server_->setConnectionOpenHandler([this](const std::string& connection_id) {
+        websocket_server_->setConnectionOpenHandler([this](BackendDatalink::ConnectionId connection_id) {
             if (connection_open_handler_) {
                 connection_open_handler_(connection_id);
             }
         });
         
-        websocket_server_->setConnectionCloseHandler([this](const std::string& connection_id) {
+        websocket_server_->setConnectionCloseHandler([this](BackendDatalink::ConnectionId connection_id) {
             if (connection_close_handler_) {
                 connection_close_handler_(connection_id);
             }
@@ -58,7 +58,7 @@ bool ManagedWebSocketServer::start(const ConfigLoader::WebSocketConfig& config)
         };
         
         // Create thread via thread manager - returns thread ID directly
-        thread_id_ = thread_manager_->createThread(thread_func);
+        thread_id_ = thread_manager_->createThreadWithAttributes(thread_func, thread_attr_);
         
         is_running_ = true;
         log("Managed WebSocket server started with thread ID: " + std::to_string(thread_id_));
@@ -88,6 +88,7 @@ void ManagedWebSocketServer::stop() {
         if (thread_manager_ && thread_id_ > 0) {
             thread_manager_->stopThread(thread_id_);
             thread_manager_->joinThread(thread_id_);
+            thread_manager_->releaseThread(thread_id_);
         }
         
         is_running_ = false;
@@ -100,34 +101,36 @@ void ManagedWebSocketServer::stop() {
     }
 }
 
+void ManagedWebSocketServer::drain(std::chrono::seconds window) {
+    if (!is_running_) {
+        return;
+    }
+    if (websocket_server_) {
+        websocket_server_->drain(window);
+    }
+    stop();
+}
+
+// The managed thread runs the io loop, so pausing it would stall every
+// connection; the server sheds its own load instead
 bool ManagedWebSocketServer::pause() {
-    if (!is_running_ || !thread_manager_ || thread_id_ == 0) {
+    if (!is_running_ || !websocket_server_ || !websocket_server_->isRunning()) {
         return false;
     }
     
-    try {
-        thread_manager_->pauseThread(thread_id_);
-        log("Managed WebSocket server paused");
-        return true;
-    } catch (const std::exception& e) {
-        log("Error pausing managed WebSocket server: " + std::string(e.what()));
-        return false;
-    }
+    websocket_server_->pause();
+    log("Managed WebSocket server paused");
+    return true;
 }
 
 bool ManagedWebSocketServer::resume() {
-    if (!is_running_ || !thread_manager_ || thread_id_ == 0) {
+    if (!is_running_ || !websocket_server_ || !websocket_server_->isPaused()) {
         return false;
     }
     
-    try {
-        thread_manager_->resumeThread(thread_id_);
-        log("Managed WebSocket server resumed");
-        return true;
-    } catch (const std::exception& e) {
-        log("Error resuming managed WebSocket server: " + std::string(e.what()));
-        return false;
-    }
+    bool listening = websocket_server_->resume();
+    log(listening ? "Managed WebSocket server resumed" : "Managed WebSocket server resumed, but not listening");
+    return listening;
 }
 
 bool ManagedWebSocketServer::restart() {
@@ -147,6 +150,7 @@ bool ManagedWebSocketServer::restart() {
         if (thread_manager_ && thread_id_ > 0) {
             thread_manager_->stopThread(thread_id_);
             thread_manager_->joinThread(thread_id_);
+            thread_manager_->releaseThread(thread_id_);
         }
         
         // Create new thread with same function
@@ -154,7 +158,7 @@ bool ManagedWebSocketServer::restart() {
             websocketServerThread();
         };
         
-        thread_id_ = thread_manager_->createThread(thread_func);
+        thread_id_ = thread_manager_->createThreadWithAttributes(thread_func, thread_attr_);
         log("Managed WebSocket server restarted successfully with thread ID: " + std::to_string(thread_id_));
         return true;
         
@@ -170,7 +174,11 @@ ThreadMgr::ThreadState ManagedWebSocketServer::getState() const {
     }
     
     try {
-        return thread_manager_->getThreadState(thread_id_);
+        ThreadMgr::ThreadState state = thread_manager_->getThreadState(thread_id_);
+        if (state == ThreadMgr::ThreadState::Running && websocket_server_->isPaused()) {
+            return ThreadMgr::ThreadState::Paused;
+        }
+        return state;
     } catch (const std::exception& e) {
         log("Error getting thread state: " + std::string(e.what()));
         return ThreadMgr::ThreadState::Error;
@@ -183,12 +191,44 @@ void ManagedWebSocketServer::broadcast(const nlohmann::json& message) {
     }
 }
 
-void ManagedWebSocketServer::sendToClient(const std::string& connection_id, const nlohmann::json& message) {
+void ManagedWebSocketServer::broadcast(const std::string& payload) {
+    if (websocket_server_) {
+        websocket_server_->broadcast(payload);
+    }
+}
+
+void ManagedWebSocketServer::publish(const std::string& category, const nlohmann::json& message) {
+    if (websocket_server_) {
+        websocket_server_->publish(category, message);
+    }
+}
+
+bool ManagedWebSocketServer::setSubscriptions(BackendDatalink::ConnectionId connection_id, const std::vector<std::string>& categories) {
+    if (websocket_server_) {
+        return websocket_server_->setSubscriptions(connection_id, categories);
+    }
+    return false;
+}
+
+void ManagedWebSocketServer::sendToClient(BackendDatalink::ConnectionId connection_id, const nlohmann::json& message) {
     if (websocket_server_) {
         websocket_server_->sendToClient(connection_id, message);
     }
 }
 
+void ManagedWebSocketServer::sendToClient(BackendDatalink::ConnectionId connection_id, const std::shared_ptr<const SharedMessage>& message) {
+    if (websocket_server_) {
+        websocket_server_->sendToClient(connection_id, message);
+    }
+}
+
+void ManagedWebSocketServer::sendBinaryToClient(BackendDatalink::ConnectionId connection_id, const std::string& payload,
+                                                const std::string& key) {
+    if (websocket_server_) {
+        websocket_server_->sendBinaryToClient(connection_id, payload, key);
+    }
+}
+
 size_t ManagedWebSocketServer::getConnectionCount() const {
     if (websocket_server_) {
         return websocket_server_->getConnectionCount();
@@ -196,18 +236,48 @@ size_t ManagedWebSocketServer::getConnectionCount() const {
     return 0;
 }
 
+size_t ManagedWebSocketServer::getSubscriberCount(const std::string& category) const {
+    if (websocket_server_) {
+        return websocket_server_->getSubscriberCount(category);
+    }
+    return 0;
+}
+
+void ManagedWebSocketServer::applyConfig(const ConfigLoader::WebSocketConfig& config) {
+    config_ = config;
+    if (websocket_server_) {
+        websocket_server_->applyConfig(config);
+    }
+}
+
+SendQueueStats ManagedWebSocketServer::getSendQueueStats() const {
+    if (websocket_server_) {
+        return websocket_server_->getSendQueueStats();
+    }
+    return SendQueueStats();
+}
+
+size_t ManagedWebSocketServer::getQueuedBytes() const {
+    if (websocket_server_) {
+        return websocket_server_->getQueuedBytes();
+    }
+    return 0;
+}
+
+void ManagedWebSocketServer::setAdmissionClosed(bool closed) {
+    if (websocket_server_) {
+        websocket_server_->setAdmissionClosed(closed);
+    }
+}
+
 void ManagedWebSocketServer::websocketServerThread() {
     try {
         log("WebSocket server thread started via thread manager");
         
-        // Start the actual websocket server
-        if (websocket_server_->start(config_)) {
+        // Start the actual websocket server; this thread is one of its io threads
+        if (websocket_server_->start(config_, true)) {
             log("WebSocket server running successfully");
-            
-            // Keep the thread alive while server is running
-            while (websocket_server_->isRunning()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
+            websocket_server_->run();
         } else {
             log("Failed to start WebSocket server in managed thread");
         }
@@ -220,17 +290,5 @@ void ManagedWebSocketServer::websocketServerThread() {
 }
 
 void ManagedWebSocketServer::log(const std::string& message) const {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::tm tm = *std::localtime(&time_t);
-    
-    std::ostringstream oss;
-    oss << "[" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    oss << "." << std::setfill('0') << std::setw(3) << ms.count() << "] ";
-    oss << "[ManagedWebSocketServer] " << message;
-    
-    std::cout << oss.str() << std::endl;
+    BACKEND_LOG_INFO("[ManagedWebSocketServer] " << message);
 }
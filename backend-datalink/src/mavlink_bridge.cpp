@@ -0,0 +1,473 @@
+#include "mavlink_bridge.h"
+#include "backend_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace BackendDatalink {
+
+namespace {
+
+// Room for several frames per read; a partial frame is at most
+// kMaxFrameSize, so a full buffer always holds at least one frame start
+const size_t kSerialBufferSize = 4096;
+
+speed_t speedFor(int baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 500000: return B500000;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 1500000: return B1500000;
+        default: return B57600;
+    }
+}
+
+} // namespace
+
+const size_t MavlinkBridge::kMaxStreams;
+constexpr std::chrono::seconds MavlinkBridge::kSerialRetry;
+
+MavlinkBridge::MavlinkBridge(const ConfigLoader::MavlinkConfig& config, BinarySender sender)
+    : config_(config), sender_(std::move(sender)) {
+}
+
+MavlinkBridge::~MavlinkBridge() {
+    stop();
+}
+
+bool MavlinkBridge::start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+
+    udp_fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    bool bound = false;
+    if (udp_fd_ >= 0 && wake_fd_ >= 0) {
+        int reuse = 1;
+        setsockopt(udp_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(config_.udp_port));
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        bound = bind(udp_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+    if (!bound) {
+        BACKEND_LOG_ERROR("[MavlinkBridge] Cannot listen on UDP port " << config_.udp_port << ": "
+                          << std::strerror(errno));
+        for (int* fd : {&udp_fd_, &wake_fd_}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        return false;
+    }
+
+    datagram_.resize(65536);
+    serial_buffer_.resize(kSerialBufferSize);
+    serial_fill_ = 0;
+    serial_retry_at_ = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    thread_ = std::thread(&MavlinkBridge::run, this);
+    BACKEND_LOG_INFO("[MavlinkBridge] Listening on UDP port " << config_.udp_port
+                     << (config_.serial_device.empty() ? "" : " and " + config_.serial_device));
+    return true;
+}
+
+void MavlinkBridge::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake();
+    thread_.join();
+
+    closeSerial();
+    for (int* fd : {&udp_fd_, &wake_fd_}) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+void MavlinkBridge::subscribe(ConnectionId connection_id, int rate_hz, const std::vector<uint32_t>& message_ids) {
+    if (rate_hz < 1 || rate_hz > config_.max_rate_hz) {
+        throw std::invalid_argument("rate_hz must be between 1 and " + std::to_string(config_.max_rate_hz));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Subscriber subscriber;
+        subscriber.interval = std::chrono::nanoseconds(1000000000LL / rate_hz);
+        subscriber.next_due = std::chrono::steady_clock::now();
+        subscriber.message_ids.insert(message_ids.begin(), message_ids.end());
+        subscribers_[connection_id] = std::move(subscriber);
+    }
+    wake();
+}
+
+bool MavlinkBridge::unsubscribe(ConnectionId connection_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscribers_.erase(connection_id) > 0;
+}
+
+std::vector<uint8_t> MavlinkBridge::history(uint32_t message_id, size_t count, size_t& frames) const {
+    std::vector<uint8_t> payload;
+    frames = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& pair : streams_) {
+        const Stream& stream = pair.second;
+        if (stream.message_id != message_id) {
+            continue;
+        }
+        uint64_t available = std::min<uint64_t>(stream.count, stream.ring.size());
+        uint64_t take = std::min<uint64_t>(available, count);
+        for (uint64_t index = stream.count - take; index < stream.count; ++index) {
+            const StoredFrame& stored = stream.ring[index % stream.ring.size()];
+            payload.insert(payload.end(), stored.bytes.begin(), stored.bytes.begin() + stored.size);
+        }
+        frames += static_cast<size_t>(take);
+    }
+    return payload;
+}
+
+json MavlinkBridge::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+
+    json streams = json::array();
+    for (const auto& pair : streams_) {
+        const Stream& stream = pair.second;
+        // Rate over the frames still in the ring
+        uint64_t held = std::min<uint64_t>(stream.count, stream.ring.size());
+        const StoredFrame& newest = stream.ring[(stream.count - 1) % stream.ring.size()];
+        double rate_hz = 0.0;
+        if (held >= 2) {
+            const StoredFrame& oldest = stream.ring[(stream.count - held) % stream.ring.size()];
+            double span = std::chrono::duration<double>(newest.received - oldest.received).count();
+            if (span > 0.0) {
+                rate_hz = static_cast<double>(held - 1) / span;
+            }
+        }
+        streams.push_back({
+            {"system_id", stream.system_id},
+            {"component_id", stream.component_id},
+            {"message_id", stream.message_id},
+            {"count", stream.count},
+            {"rate_hz", rate_hz},
+            {"age_ms", std::chrono::duration_cast<std::chrono::milliseconds>(now - newest.received).count()}
+        });
+    }
+
+    json subscribers = json::array();
+    for (const auto& pair : subscribers_) {
+        const Subscriber& subscriber = pair.second;
+        subscribers.push_back({
+            {"connection_id", connectionIdString(pair.first)},
+            {"rate_hz", 1000000000LL / subscriber.interval.count()},
+            {"messages", std::vector<uint32_t>(subscriber.message_ids.begin(), subscriber.message_ids.end())},
+            {"frames_sent", subscriber.frames_sent},
+            {"frames_skipped", subscriber.frames_skipped}
+        });
+    }
+
+    auto counters = [](const Mavlink::ScanCounters& scan) {
+        return json{
+            {"bad_frames", scan.bad_frames},
+            {"skipped_bytes", scan.skipped_bytes},
+            {"unverified", scan.unverified}
+        };
+    };
+
+    return {
+        {"udp_port", config_.udp_port},
+        {"serial_device", config_.serial_device},
+        {"serial_connected", serial_connected_},
+        {"frames", frames_},
+        {"bytes", bytes_},
+        {"streams_dropped", streams_dropped_},
+        {"udp", counters(udp_counters_)},
+        {"serial", counters(serial_counters_)},
+        {"streams", std::move(streams)},
+        {"subscribers", std::move(subscribers)}
+    };
+}
+
+uint64_t MavlinkBridge::streamKey(const Mavlink::FrameView& frame) {
+    return (static_cast<uint64_t>(frame.system_id) << 32) |
+           (static_cast<uint64_t>(frame.component_id) << 24) |
+           frame.message_id;
+}
+
+void MavlinkBridge::wake() {
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        // Counter already pending; the loop wakes anyway
+    }
+}
+
+void MavlinkBridge::run() {
+    auto next_publish = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) {
+                return;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (!config_.serial_device.empty() && serial_fd_ < 0 && now >= serial_retry_at_) {
+            openSerial();
+        }
+
+        pollfd fds[3] = {
+            {wake_fd_, POLLIN, 0},
+            {udp_fd_, POLLIN, 0},
+            {serial_fd_, POLLIN, 0}     // Ignored by poll() while closed
+        };
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_publish - now).count();
+        int timeout_ms = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(wait, 1000)));
+
+        int ready = poll(fds, 3, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            BACKEND_LOG_EVERY(LOG_ERROR, 60000, "[MavlinkBridge] poll failed: " << std::strerror(errno));
+        } else if (ready > 0) {
+            if (fds[0].revents & POLLIN) {
+                uint64_t count;
+                if (read(wake_fd_, &count, sizeof(count)) < 0) {
+                    // Spurious wakeup
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                receiveUdp();
+            }
+            if (fds[2].revents & (POLLIN | POLLERR | POLLHUP)) {
+                receiveSerial();
+            }
+        }
+
+        next_publish = publish(std::chrono::steady_clock::now());
+    }
+}
+
+void MavlinkBridge::openSerial() {
+    int fd = open(config_.serial_device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    termios tio;
+    if (fd < 0 || tcgetattr(fd, &tio) != 0) {
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[MavlinkBridge] Cannot open " << config_.serial_device << ": "
+                          << std::strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        serial_retry_at_ = std::chrono::steady_clock::now() + kSerialRetry;
+        return;
+    }
+
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~CRTSCTS;
+    // With O_NONBLOCK an empty read fails with EAGAIN; VMIN 0 would
+    // return 0 and look like a hangup
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speedFor(config_.baud));
+    cfsetospeed(&tio, speedFor(config_.baud));
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[MavlinkBridge] Cannot configure " << config_.serial_device << ": "
+                          << std::strerror(errno));
+        close(fd);
+        serial_retry_at_ = std::chrono::steady_clock::now() + kSerialRetry;
+        return;
+    }
+    tcflush(fd, TCIFLUSH);
+
+    serial_fd_ = fd;
+    serial_fill_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        serial_connected_ = true;
+    }
+    BACKEND_LOG_INFO("[MavlinkBridge] Reading " << config_.serial_device << " at " << config_.baud << " baud");
+}
+
+void MavlinkBridge::closeSerial() {
+    if (serial_fd_ < 0) {
+        return;
+    }
+    close(serial_fd_);
+    serial_fd_ = -1;
+    serial_retry_at_ = std::chrono::steady_clock::now() + kSerialRetry;
+    std::lock_guard<std::mutex> lock(mutex_);
+    serial_connected_ = false;
+}
+
+// Each datagram holds whole frames, so frames of unknown types are kept: a
+// false magic byte cannot desynchronise the next datagram
+void MavlinkBridge::receiveUdp() {
+    for (;;) {
+        ssize_t size = recv(udp_fd_, datagram_.data(), datagram_.size(), MSG_DONTWAIT);
+        if (size <= 0) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        const uint8_t* data = datagram_.data();
+        size_t remaining = static_cast<size_t>(size);
+        std::lock_guard<std::mutex> lock(mutex_);
+        bytes_ += remaining;
+        while (remaining > 0) {
+            Mavlink::FrameView frame;
+            size_t used = Mavlink::nextFrame(data, remaining, frame, udp_counters_, true);
+            if (!frame.data) {
+                // A truncated frame ends the datagram
+                udp_counters_.skipped_bytes += remaining - used;
+                break;
+            }
+            storeLocked(frame, now);
+            data += used;
+            remaining -= used;
+        }
+    }
+}
+
+void MavlinkBridge::receiveSerial() {
+    for (;;) {
+        ssize_t size = read(serial_fd_, serial_buffer_.data() + serial_fill_, serial_buffer_.size() - serial_fill_);
+        if (size < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        if (size <= 0) {
+            // Unplugged adapter; reopened after kSerialRetry
+            BACKEND_LOG_WARN("[MavlinkBridge] Lost " << config_.serial_device << ": "
+                             << (size == 0 ? "end of file" : std::strerror(errno)));
+            closeSerial();
+            return;
+        }
+        serial_fill_ += static_cast<size_t>(size);
+
+        auto now = std::chrono::steady_clock::now();
+        size_t offset = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            bytes_ += static_cast<size_t>(size);
+            while (offset < serial_fill_) {
+                Mavlink::FrameView frame;
+                offset += Mavlink::nextFrame(serial_buffer_.data() + offset, serial_fill_ - offset, frame,
+                                             serial_counters_, false);
+                if (!frame.data) {
+                    break;
+                }
+                storeLocked(frame, now);
+            }
+        }
+
+        // Keep the partial frame for the next read
+        if (offset > 0) {
+            std::memmove(serial_buffer_.data(), serial_buffer_.data() + offset, serial_fill_ - offset);
+            serial_fill_ -= offset;
+        }
+    }
+}
+
+void MavlinkBridge::storeLocked(const Mavlink::FrameView& frame, std::chrono::steady_clock::time_point now) {
+    uint64_t key = streamKey(frame);
+    auto it = streams_.find(key);
+    if (it == streams_.end()) {
+        if (streams_.size() >= kMaxStreams) {
+            streams_dropped_++;
+            return;
+        }
+        Stream stream;
+        stream.system_id = frame.system_id;
+        stream.component_id = frame.component_id;
+        stream.message_id = frame.message_id;
+        stream.ring.resize(static_cast<size_t>(config_.ring_size));
+        it = streams_.emplace(key, std::move(stream)).first;
+    }
+
+    Stream& stream = it->second;
+    StoredFrame& slot = stream.ring[stream.count % stream.ring.size()];
+    std::memcpy(slot.bytes.data(), frame.data, frame.size);
+    slot.size = static_cast<uint16_t>(frame.size);
+    slot.received = now;
+    stream.count++;
+    frames_++;
+}
+
+std::chrono::steady_clock::time_point MavlinkBridge::publish(std::chrono::steady_clock::time_point now) {
+    std::vector<std::pair<ConnectionId, std::string>> batches;
+    auto next = now + std::chrono::seconds(1);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& pair : subscribers_) {
+            Subscriber& subscriber = pair.second;
+            if (now < subscriber.next_due) {
+                next = std::min(next, subscriber.next_due);
+                continue;
+            }
+
+            std::string payload;
+            for (const auto& entry : streams_) {
+                const Stream& stream = entry.second;
+                if (!subscriber.message_ids.empty() && !subscriber.message_ids.count(stream.message_id)) {
+                    continue;
+                }
+                uint64_t& sent = subscriber.sent[entry.first];
+                if (stream.count == sent) {
+                    continue;
+                }
+                const StoredFrame& newest = stream.ring[(stream.count - 1) % stream.ring.size()];
+                payload.append(reinterpret_cast<const char*>(newest.bytes.data()), newest.size);
+                subscriber.frames_sent++;
+                subscriber.frames_skipped += stream.count - sent - 1;
+                sent = stream.count;
+            }
+            if (!payload.empty()) {
+                batches.emplace_back(pair.first, std::move(payload));
+            }
+
+            // A late tick does not cause a burst of catch-up ticks
+            subscriber.next_due += subscriber.interval;
+            if (subscriber.next_due <= now) {
+                subscriber.next_due = now + subscriber.interval;
+            }
+            next = std::min(next, subscriber.next_due);
+        }
+    }
+
+    for (const auto& batch : batches) {
+        sender_(batch.first, batch.second);
+    }
+    return next;
+}
+
+} // namespace BackendDatalink
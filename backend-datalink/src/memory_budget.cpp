@@ -0,0 +1,135 @@
+#include "memory_budget.h"
+#include "backend_log.h"
+#include <cstdio>
+#include <utility>
+#include <unistd.h>
+
+namespace BackendDatalink {
+
+namespace {
+
+// Resident set of this process in bytes; 0 when statm cannot be read
+size_t residentSetBytes() {
+    FILE* file = std::fopen("/proc/self/statm", "re");
+    if (!file) {
+        return 0;
+    }
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (std::fscanf(file, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    std::fclose(file);
+    long page = sysconf(_SC_PAGESIZE);
+    return static_cast<size_t>(resident) * static_cast<size_t>(page > 0 ? page : 4096);
+}
+
+} // namespace
+
+MemoryBudget::MemoryBudget(Degrade degrade)
+    : degrade_(std::move(degrade)) {
+}
+
+void MemoryBudget::addSource(const std::string& name, Source source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry entry;
+    entry.name = name;
+    entry.source = std::move(source);
+    sources_.push_back(std::move(entry));
+}
+
+void MemoryBudget::setSettings(const Settings& settings) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    settings_ = settings;
+}
+
+void MemoryBudget::evaluate() {
+    // Sources take their subsystems' locks, so they run outside mutex_;
+    // the list itself no longer changes once evaluation started
+    std::vector<size_t> bytes;
+    bytes.reserve(sources_.size());
+    for (const auto& entry : sources_) {
+        bytes.push_back(entry.source ? entry.source() : 0);
+    }
+    size_t resident = residentSetBytes();
+
+    Level previous;
+    Level level;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < sources_.size(); ++i) {
+            sources_[i].bytes = bytes[i];
+        }
+        resident_bytes_ = resident;
+        previous = level_;
+        level = classify(resident);
+        level_ = level;
+    }
+    if (level == previous) {
+        return;
+    }
+
+    BACKEND_LOG_WARN("[MemoryBudget] " << toString(previous) << " -> " << toString(level) << " at "
+                     << resident / (1024 * 1024) << " MB resident");
+    if (degrade_) {
+        degrade_(level);
+    }
+}
+
+MemoryBudget::Level MemoryBudget::level() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return level_;
+}
+
+size_t MemoryBudget::residentBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return resident_bytes_;
+}
+
+std::vector<std::string> MemoryBudget::sourceNames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> names;
+    for (const auto& entry : sources_) {
+        names.push_back(entry.name);
+    }
+    return names;
+}
+
+size_t MemoryBudget::sourceBytes(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : sources_) {
+        if (entry.name == name) {
+            return entry.bytes;
+        }
+    }
+    return 0;
+}
+
+const char* MemoryBudget::toString(Level level) {
+    switch (level) {
+        case Level::Soft: return "soft";
+        case Level::Hard: return "hard";
+        default: return "normal";
+    }
+}
+
+// Caller holds mutex_. A limit is crossed going up at 100% and going back
+// down at 90%; a hard limit alone still degrades at Hard.
+MemoryBudget::Level MemoryBudget::classify(size_t resident) const {
+    auto over = [this, resident](size_t limit, Level at) {
+        if (limit == 0) {
+            return false;
+        }
+        size_t threshold = level_ >= at ? limit / 10 * 9 : limit;
+        return resident > threshold;
+    };
+    if (over(settings_.hardLimitBytes, Level::Hard)) {
+        return Level::Hard;
+    }
+    if (over(settings_.softLimitBytes, Level::Soft)) {
+        return Level::Soft;
+    }
+    return Level::Normal;
+}
+
+} // namespace BackendDatalink
@@ -0,0 +1,87 @@
+#include "message_arena.h"
+#include <algorithm>
+
+namespace BackendDatalink {
+
+namespace {
+
+thread_local MessageArena* t_active_arena = nullptr;
+
+MessageArena& threadArena() {
+    thread_local MessageArena arena;
+    return arena;
+}
+
+} // namespace
+
+MessageArena::MessageArena(size_t block_size) : block_size_(block_size) {
+}
+
+MessageArena::~MessageArena() {
+    for (const Block& block : blocks_) {
+        ::operator delete(block.data);
+    }
+}
+
+void* MessageArena::allocate(size_t size, size_t alignment) {
+    if (!blocks_.empty()) {
+        const Block& block = blocks_.back();
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+        uintptr_t start = (base + used_ + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+        if (start + size <= base + block.size) {
+            used_ = start + size - base;
+            return reinterpret_cast<void*>(start);
+        }
+    }
+
+    // Blocks come from operator new, aligned for any fundamental type
+    addBlock(size + alignment);
+    Block& block = blocks_.back();
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+    uintptr_t start = (base + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    used_ = start + size - base;
+    return reinterpret_cast<void*>(start);
+}
+
+bool MessageArena::owns(const void* pointer) const {
+    const char* p = static_cast<const char*>(pointer);
+    for (const Block& block : blocks_) {
+        if (p >= block.data && p < block.data + block.size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MessageArena::reset() {
+    while (blocks_.size() > 1 || (!blocks_.empty() && blocks_.back().size > block_size_)) {
+        ::operator delete(blocks_.back().data);
+        blocks_.pop_back();
+    }
+    used_ = 0;
+}
+
+void MessageArena::addBlock(size_t min_size) {
+    size_t size = std::max(block_size_, min_size);
+    blocks_.push_back(Block{static_cast<char*>(::operator new(size)), size});
+    used_ = 0;
+}
+
+MessageArena* MessageArena::current() {
+    return t_active_arena;
+}
+
+MessageArena::Scope::Scope() : outermost_(t_active_arena == nullptr) {
+    if (outermost_) {
+        t_active_arena = &threadArena();
+    }
+}
+
+MessageArena::Scope::~Scope() {
+    if (outermost_) {
+        t_active_arena->reset();
+        t_active_arena = nullptr;
+    }
+}
+
+} // namespace BackendDatalink
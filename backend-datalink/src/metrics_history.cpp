@@ -0,0 +1,605 @@
+#include "metrics_history.h"
+#include "database_manager.h"
+#include "backend_log.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+struct Field {
+    const char* name;
+    double MetricsSample::* member;
+};
+
+// Column order of metrics_history after (resolution, ts)
+const Field kFields[] = {
+    {"cpu_percent", &MetricsSample::cpu_percent},
+    {"cpu_temperature_c", &MetricsSample::cpu_temperature_c},
+    {"ram_percent", &MetricsSample::ram_percent},
+    {"swap_percent", &MetricsSample::swap_percent},
+    {"latency_ms", &MetricsSample::latency_ms},
+    {"rssi_dbm", &MetricsSample::rssi_dbm},
+    {"sinr_db", &MetricsSample::sinr_db}
+};
+
+std::string columnList() {
+    std::string columns;
+    for (const auto& field : kFields) {
+        columns += std::string(", ") + field.name;
+    }
+    return columns;
+}
+
+double numberAt(const json& metrics, const char* section, const char* key) {
+    auto it = metrics.find(section);
+    if (it == metrics.end() || !it->is_object()) {
+        return 0.0;
+    }
+    auto value = it->find(key);
+    return (value != it->end() && value->is_number()) ? value->get<double>() : 0.0;
+}
+
+double numberAt(const json& metrics, const char* section, const char* group, const char* key) {
+    auto it = metrics.find(section);
+    if (it == metrics.end() || !it->is_object()) {
+        return 0.0;
+    }
+    return numberAt(*it, group, key);
+}
+
+// Independent accumulators per lane keep the loops free of a serial
+// dependency, so the compiler vectorizes them without reassociating
+// floating-point sums (no -ffast-math needed)
+const size_t kLanes = 8;
+
+struct Summary {
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0.0;
+    size_t count = 0;
+};
+
+void summarize(const double* values, size_t count, Summary& summary) {
+    double lo[kLanes];
+    double hi[kLanes];
+    double sum[kLanes];
+    for (size_t j = 0; j < kLanes; ++j) {
+        lo[j] = summary.min;
+        hi[j] = summary.max;
+        sum[j] = 0.0;
+    }
+
+    size_t i = 0;
+    for (; i + kLanes <= count; i += kLanes) {
+        for (size_t j = 0; j < kLanes; ++j) {
+            double value = values[i + j];
+            lo[j] = value < lo[j] ? value : lo[j];
+            hi[j] = value > hi[j] ? value : hi[j];
+            sum[j] += value;
+        }
+    }
+    for (; i < count; ++i) {
+        lo[0] = values[i] < lo[0] ? values[i] : lo[0];
+        hi[0] = values[i] > hi[0] ? values[i] : hi[0];
+        sum[0] += values[i];
+    }
+
+    for (size_t j = 0; j < kLanes; ++j) {
+        summary.min = std::min(summary.min, lo[j]);
+        summary.max = std::max(summary.max, hi[j]);
+        summary.sum += sum[j];
+    }
+    summary.count += count;
+}
+
+} // namespace
+
+MetricsHistory::MetricsHistory(DatabaseManager* database, const ConfigLoader::MetricsHistoryConfig& config)
+    : database_(database), config_(config), ring_capacity_(static_cast<size_t>(std::max(1, config.ring_capacity))),
+      ring_timestamps_(ring_capacity_), last_flush_(std::chrono::steady_clock::now()) {
+    static_assert(sizeof(kFields) / sizeof(kFields[0]) == kFieldCount, "kFieldCount out of date");
+    for (auto& column : ring_columns_) {
+        column.resize(ring_capacity_);
+    }
+}
+
+bool MetricsHistory::initialize() {
+    if (!database_ || !database_->isInitialized()) {
+        log("Database not available, history is kept in memory only");
+        return false;
+    }
+
+    // WITHOUT ROWID keeps rows clustered by (resolution, ts), so range reads and
+    // retention deletes touch contiguous pages
+    std::string sql = "CREATE TABLE IF NOT EXISTS metrics_history ("
+                      "resolution INTEGER NOT NULL, "
+                      "ts INTEGER NOT NULL";
+    for (const auto& field : kFields) {
+        sql += std::string(", ") + field.name + " REAL NOT NULL";
+    }
+    sql += ", PRIMARY KEY (resolution, ts)) WITHOUT ROWID";
+
+    if (!database_->execute(sql)) {
+        log("Failed to create metrics_history table");
+        return false;
+    }
+
+    // Continue after the newest raw row persisted by a previous run
+    database_->query("SELECT MAX(ts) FROM metrics_history WHERE resolution = 0", {},
+                     [this](sqlite3_stmt* stmt) {
+                         persisted_until_ = sqlite3_column_int64(stmt, 0);
+                     });
+
+    log("Initialized (ring " + std::to_string(ring_capacity_) + " samples, flush every " +
+        std::to_string(config_.flush_interval_seconds) + "s)");
+    return true;
+}
+
+void MetricsHistory::record(const json& metrics) {
+    MetricsSample sample;
+    sample.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    sample.cpu_percent = numberAt(metrics, "cpu", "usage_percent");
+    sample.cpu_temperature_c = numberAt(metrics, "cpu", "temperature_celsius");
+    sample.ram_percent = numberAt(metrics, "ram", "usage_percent");
+    sample.swap_percent = numberAt(metrics, "swap", "usage_percent");
+    sample.latency_ms = numberAt(metrics, "network", "internet", "latency_ms");
+    sample.rssi_dbm = numberAt(metrics, "signal", "strength", "rssi_dbm");
+    sample.sinr_db = numberAt(metrics, "signal", "strength", "sinr_db");
+    record(sample);
+}
+
+void MetricsHistory::record(const MetricsSample& sample) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ring_timestamps_[ring_head_] = sample.timestamp;
+    for (size_t i = 0; i < kFieldCount; ++i) {
+        ring_columns_[i][ring_head_] = sample.*kFields[i].member;
+    }
+    ring_head_ = (ring_head_ + 1) % ring_capacity_;
+    ring_size_ = std::min(ring_size_ + 1, ring_capacity_);
+
+    accumulate(minute_bucket_, Minute, sample);
+    accumulate(hour_bucket_, Hour, sample);
+
+    // Bound memory while the database is unavailable
+    if (pending_rollups_.size() > ring_capacity_) {
+        pending_rollups_.erase(pending_rollups_.begin(),
+                               pending_rollups_.begin() + (pending_rollups_.size() - ring_capacity_));
+    }
+}
+
+void MetricsHistory::resizeRing(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity == 0) {
+        capacity = static_cast<size_t>(std::max(1, config_.ring_capacity));
+    }
+    if (capacity == ring_capacity_) {
+        return;
+    }
+
+    size_t kept = std::min(ring_size_, capacity);
+    size_t skipped = ring_size_ - kept;
+    std::vector<int64_t> timestamps(capacity);
+    for (size_t i = 0; i < kept; ++i) {
+        timestamps[i] = ring_timestamps_[ringSlot(skipped + i)];
+    }
+    for (auto& column : ring_columns_) {
+        std::vector<double> resized(capacity);
+        for (size_t i = 0; i < kept; ++i) {
+            resized[i] = column[ringSlot(skipped + i)];
+        }
+        column.swap(resized);
+    }
+    ring_timestamps_.swap(timestamps);
+    ring_capacity_ = capacity;
+    ring_size_ = kept;
+    ring_head_ = kept % capacity;
+    std::vector<double>().swap(scratch_);
+
+    log("Ring now " + std::to_string(capacity) + " samples");
+}
+
+size_t MetricsHistory::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t bytes = ring_timestamps_.capacity() * sizeof(int64_t) + scratch_.capacity() * sizeof(double) +
+                   pending_rollups_.capacity() * sizeof(pending_rollups_[0]);
+    for (const auto& column : ring_columns_) {
+        bytes += column.capacity() * sizeof(double);
+    }
+    return bytes;
+}
+
+void MetricsHistory::accumulate(Bucket& bucket, int width, const MetricsSample& sample) {
+    int64_t start = sample.timestamp - (sample.timestamp % width);
+
+    if (bucket.start != start) {
+        if (bucket.count > 0) {
+            MetricsSample average;
+            average.timestamp = bucket.start;
+            for (const auto& field : kFields) {
+                average.*field.member = bucket.sum.*field.member / static_cast<double>(bucket.count);
+            }
+            pending_rollups_.emplace_back(width, average);
+        }
+        bucket = Bucket();
+        bucket.start = start;
+    }
+
+    for (const auto& field : kFields) {
+        bucket.sum.*field.member += sample.*field.member;
+    }
+    bucket.count++;
+}
+
+size_t MetricsHistory::ringSlot(size_t index) const {
+    size_t oldest = (ring_head_ + ring_capacity_ - ring_size_) % ring_capacity_;
+    return (oldest + index) % ring_capacity_;
+}
+
+MetricsSample MetricsHistory::ringAt(size_t index) const {
+    size_t slot = ringSlot(index);
+    MetricsSample sample;
+    sample.timestamp = ring_timestamps_[slot];
+    for (size_t i = 0; i < kFieldCount; ++i) {
+        sample.*kFields[i].member = ring_columns_[i][slot];
+    }
+    return sample;
+}
+
+// Ring index (0 = oldest) of the first sample at or after timestamp;
+// samples are recorded in time order
+size_t MetricsHistory::firstAtOrAfter(int64_t timestamp) const {
+    size_t low = 0;
+    size_t high = ring_size_;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (ring_timestamps_[ringSlot(middle)] < timestamp) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Calls function(slot, length) for the contiguous runs of slots holding
+// ring indexes [begin, end): one run, or two where the ring wraps
+template <typename Function>
+void MetricsHistory::forEachSpan(size_t begin, size_t end, Function function) const {
+    if (begin >= end) {
+        return;
+    }
+    size_t first = ringSlot(begin);
+    size_t length = end - begin;
+    size_t until_wrap = ring_capacity_ - first;
+    if (length <= until_wrap) {
+        function(first, length);
+    } else {
+        function(first, until_wrap);
+        function(0, length - until_wrap);
+    }
+}
+
+bool MetricsHistory::flushIfDue() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_flush_ < std::chrono::seconds(config_.flush_interval_seconds)) {
+        return true;
+    }
+    return flush();
+}
+
+bool MetricsHistory::flush() {
+    last_flush_ = std::chrono::steady_clock::now();
+
+    if (!database_ || !database_->isInitialized()) {
+        return false;
+    }
+
+    std::vector<std::vector<std::string>> rows;
+    int64_t newest_raw = 0;
+    size_t rollup_count = 0;
+
+    auto addRow = [&rows](int resolution, const MetricsSample& sample) {
+        std::vector<std::string> row;
+        row.reserve(2 + sizeof(kFields) / sizeof(kFields[0]));
+        row.push_back(std::to_string(resolution));
+        row.push_back(std::to_string(sample.timestamp));
+        for (const auto& field : kFields) {
+            row.push_back(std::to_string(sample.*field.member));
+        }
+        rows.push_back(std::move(row));
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        newest_raw = persisted_until_;
+        for (size_t i = firstAtOrAfter(persisted_until_ + 1); i < ring_size_; ++i) {
+            MetricsSample sample = ringAt(i);
+            if (sample.timestamp > persisted_until_) {
+                addRow(Raw, sample);
+                newest_raw = std::max(newest_raw, sample.timestamp);
+            }
+        }
+        rollup_count = pending_rollups_.size();
+        for (const auto& rollup : pending_rollups_) {
+            addRow(rollup.first, rollup.second);
+        }
+    }
+
+    if (rows.empty()) {
+        return true;
+    }
+
+    std::string sql = "INSERT OR REPLACE INTO metrics_history (resolution, ts" + columnList() +
+                      ") VALUES (?, ?";
+    for (size_t i = 0; i < sizeof(kFields) / sizeof(kFields[0]); ++i) {
+        sql += ", ?";
+    }
+    sql += ")";
+
+    if (!database_->executeBatch(sql, rows)) {
+        log("Failed to flush " + std::to_string(rows.size()) + " rows, will retry");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        persisted_until_ = newest_raw;
+        pending_rollups_.erase(pending_rollups_.begin(), pending_rollups_.begin() + rollup_count);
+    }
+
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::pair<int, int> retention[] = {
+        {Raw, config_.raw_retention_seconds},
+        {Minute, config_.minute_retention_seconds},
+        {Hour, config_.hour_retention_seconds}
+    };
+    for (const auto& entry : retention) {
+        database_->executeWithParams("DELETE FROM metrics_history WHERE resolution = ? AND ts < ?",
+                                     {std::to_string(entry.first), std::to_string(now - entry.second)});
+    }
+
+    return true;
+}
+
+std::vector<MetricsSample> MetricsHistory::query(int resolution, int64_t from, int64_t to, size_t limit) const {
+    std::vector<MetricsSample> samples;
+    int64_t persisted_until = 0;
+    bool need_database = true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        persisted_until = persisted_until_;
+
+        if (resolution == Raw) {
+            // The ring covers the range on its own when it reaches back far enough
+            need_database = ring_size_ == 0 || from < ring_timestamps_[ringSlot(0)];
+            for (size_t i = firstAtOrAfter(from); i < ring_size_; ++i) {
+                MetricsSample sample = ringAt(i);
+                if (sample.timestamp > to) {
+                    break;
+                }
+                if (!need_database || sample.timestamp > persisted_until) {
+                    samples.push_back(sample);
+                }
+            }
+        } else {
+            for (const auto& rollup : pending_rollups_) {
+                if (rollup.first == resolution && rollup.second.timestamp >= from &&
+                    rollup.second.timestamp <= to) {
+                    samples.push_back(rollup.second);
+                }
+            }
+        }
+    }
+
+    if (need_database && database_ && database_->isInitialized()) {
+        database_->query("SELECT ts" + columnList() + " FROM metrics_history "
+                         "WHERE resolution = ? AND ts >= ? AND ts <= ? ORDER BY ts DESC LIMIT ?",
+                         {std::to_string(resolution), std::to_string(from), std::to_string(to),
+                          std::to_string(limit)},
+                         [&samples](sqlite3_stmt* stmt) {
+                             MetricsSample sample;
+                             sample.timestamp = sqlite3_column_int64(stmt, 0);
+                             int column = 1;
+                             for (const auto& field : kFields) {
+                                 sample.*field.member = sqlite3_column_double(stmt, column++);
+                             }
+                             samples.push_back(sample);
+                         });
+    }
+
+    // A flush between the two reads can return a row from both sources
+    std::sort(samples.begin(), samples.end(), [](const MetricsSample& a, const MetricsSample& b) {
+        return a.timestamp < b.timestamp;
+    });
+    samples.erase(std::unique(samples.begin(), samples.end(),
+                              [](const MetricsSample& a, const MetricsSample& b) {
+                                  return a.timestamp == b.timestamp;
+                              }),
+                  samples.end());
+
+    if (samples.size() > limit) {
+        samples.erase(samples.begin(), samples.end() - limit);
+    }
+
+    return samples;
+}
+
+bool MetricsHistory::aggregate(int64_t from, int64_t to, size_t buckets, const std::vector<std::string>& fields,
+                               HistoryAggregate& result) const {
+    std::vector<size_t> columns;
+    for (const auto& name : fields) {
+        auto it = std::find_if(std::begin(kFields), std::end(kFields),
+                               [&name](const Field& field) { return name == field.name; });
+        if (it == std::end(kFields)) {
+            return false;
+        }
+        columns.push_back(static_cast<size_t>(it - std::begin(kFields)));
+    }
+    if (fields.empty()) {
+        for (size_t i = 0; i < kFieldCount; ++i) {
+            columns.push_back(i);
+        }
+    }
+
+    result = HistoryAggregate();
+    result.from = from;
+    result.to = to;
+    result.bucket_seconds = buckets > 0 && to >= from
+                                ? std::max<int64_t>(1, (to - from + static_cast<int64_t>(buckets)) /
+                                                           static_cast<int64_t>(buckets))
+                                : 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    result.covered_from = ring_size_ > 0 ? ring_timestamps_[ringSlot(0)] : 0;
+
+    size_t begin = firstAtOrAfter(from);
+    size_t end = to < std::numeric_limits<int64_t>::max() ? firstAtOrAfter(to + 1) : ring_size_;
+    end = std::max(begin, end);
+    result.count = end - begin;
+
+    // Bucket b covers [from + b * width, from + (b + 1) * width)
+    std::vector<size_t> bounds;
+    if (result.bucket_seconds > 0) {
+        bounds.reserve(buckets + 1);
+        bounds.push_back(begin);
+        for (size_t b = 0; b < buckets; ++b) {
+            int64_t start = from + static_cast<int64_t>(b) * result.bucket_seconds;
+            result.bucket_start.push_back(start);
+            size_t bound = std::min(end, std::max(begin, firstAtOrAfter(start + result.bucket_seconds)));
+            result.bucket_count.push_back(static_cast<uint32_t>(bound - bounds.back()));
+            bounds.push_back(bound);
+        }
+    }
+
+    for (size_t column : columns) {
+        const double* values = ring_columns_[column].data();
+        HistorySeries series;
+        series.field = kFields[column].name;
+
+        Summary overall;
+        forEachSpan(begin, end, [&](size_t slot, size_t length) { summarize(values + slot, length, overall); });
+        if (overall.count > 0) {
+            series.min = overall.min;
+            series.max = overall.max;
+            series.avg = overall.sum / static_cast<double>(overall.count);
+
+            scratch_.clear();
+            forEachSpan(begin, end, [&](size_t slot, size_t length) {
+                scratch_.insert(scratch_.end(), values + slot, values + slot + length);
+            });
+            size_t rank = static_cast<size_t>(std::ceil(0.95 * static_cast<double>(scratch_.size())));
+            auto nth = scratch_.begin() + static_cast<std::ptrdiff_t>(std::max<size_t>(rank, 1) - 1);
+            std::nth_element(scratch_.begin(), nth, scratch_.end());
+            series.p95 = *nth;
+        }
+
+        size_t bucket_count = bounds.empty() ? 0 : bounds.size() - 1;
+        series.bucket_min.assign(bucket_count, 0.0);
+        series.bucket_avg.assign(bucket_count, 0.0);
+        series.bucket_max.assign(bucket_count, 0.0);
+        for (size_t b = 0; b < bucket_count; ++b) {
+            Summary bucket;
+            forEachSpan(bounds[b], bounds[b + 1],
+                        [&](size_t slot, size_t length) { summarize(values + slot, length, bucket); });
+            if (bucket.count > 0) {
+                series.bucket_min[b] = bucket.min;
+                series.bucket_avg[b] = bucket.sum / static_cast<double>(bucket.count);
+                series.bucket_max[b] = bucket.max;
+            }
+        }
+
+        result.series.push_back(std::move(series));
+    }
+    return true;
+}
+
+json MetricsHistory::toJson(const std::vector<MetricsSample>& samples) {
+    json series = json::object();
+    json timestamps = json::array();
+    for (const auto& sample : samples) {
+        timestamps.push_back(sample.timestamp);
+    }
+    series["timestamp"] = std::move(timestamps);
+
+    for (const auto& field : kFields) {
+        json values = json::array();
+        for (const auto& sample : samples) {
+            values.push_back(sample.*field.member);
+        }
+        series[field.name] = std::move(values);
+    }
+
+    return series;
+}
+
+json MetricsHistory::toJson(const HistoryAggregate& aggregate) {
+    json fields = json::object();
+    for (const auto& series : aggregate.series) {
+        fields[series.field] = {
+            {"min", series.min},
+            {"max", series.max},
+            {"avg", series.avg},
+            {"p95", series.p95},
+            {"bucket_min", series.bucket_min},
+            {"bucket_avg", series.bucket_avg},
+            {"bucket_max", series.bucket_max}
+        };
+    }
+
+    return {
+        {"from", aggregate.from},
+        {"to", aggregate.to},
+        {"covered_from", aggregate.covered_from},
+        {"count", aggregate.count},
+        {"bucket_seconds", aggregate.bucket_seconds},
+        {"bucket_start", aggregate.bucket_start},
+        {"bucket_count", aggregate.bucket_count},
+        {"fields", std::move(fields)}
+    };
+}
+
+bool MetricsHistory::parseResolution(const json& value, int& resolution) {
+    if (value.is_string()) {
+        std::string name = value.get<std::string>();
+        if (name == "raw") {
+            resolution = Raw;
+        } else if (name == "1m") {
+            resolution = Minute;
+        } else if (name == "1h") {
+            resolution = Hour;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    if (value.is_number_integer()) {
+        int seconds = value.get<int>();
+        if (seconds == Raw || seconds == Minute || seconds == Hour) {
+            resolution = seconds;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::string MetricsHistory::resolutionName(int resolution) {
+    switch (resolution) {
+    case Minute:
+        return "1m";
+    case Hour:
+        return "1h";
+    default:
+        return "raw";
+    }
+}
+
+void MetricsHistory::log(const std::string& message) const {
+    BACKEND_LOG_INFO("[MetricsHistory] " << message);
+}
@@ -0,0 +1,150 @@
+#include "outbound_publisher.h"
+#include "direct_template.h"
+#include "backend_log.h"
+#include <utility>
+
+namespace BackendDatalink {
+
+namespace {
+
+// Messages published per pass before the lanes are looked at again
+const size_t kMaxBatch = 64;
+
+// How long one publish waits for room in a full publish window
+const int kWindowWaitMs = 100;
+
+} // namespace
+
+OutboundPublisher::OutboundPublisher(size_t laneCapacity) {
+    for (auto& lane : lanes_) {
+        lane.reset(new BoundedMpscQueue<Message>(laneCapacity));
+    }
+}
+
+OutboundPublisher::~OutboundPublisher() {
+    stop();
+}
+
+void OutboundPublisher::start() {
+    if (thread_.joinable()) {
+        return;
+    }
+
+    running_ = true;
+    thread_ = std::thread(&OutboundPublisher::run, this);
+}
+
+void OutboundPublisher::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        running_ = false;
+    }
+    wakeCv_.notify_one();
+    thread_.join();
+
+    // Anything queued after the last pass still goes out
+    while (drainBatch() > 0) {
+    }
+}
+
+bool OutboundPublisher::publish(std::string topic, std::string payload, int qos) {
+    Message message;
+    message.topic = std::move(topic);
+    message.payload = std::move(payload);
+    message.qos = qos;
+
+    Lane lane = qos == 0 ? kBestEffortLane : kReliableLane;
+    size_t before = pending_.fetch_add(1);
+    if (!lanes_[lane]->push(std::move(message))) {
+        pending_.fetch_sub(1);
+        uint64_t dropped = dropped_.fetch_add(1, std::memory_order_relaxed) + 1;
+        // Report the first drop and then every 1000th
+        if (dropped == 1 || dropped % 1000 == 0) {
+            BACKEND_LOG_ERROR("[OutboundPublisher] Queue full, dropped " << dropped << " messages so far");
+        }
+        return false;
+    }
+
+    // Only the push that finds the queue empty can find the publisher asleep
+    if (before == 0) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+        }
+        wakeCv_.notify_one();
+    }
+    return true;
+}
+
+void OutboundPublisher::run() {
+    for (;;) {
+        if (drainBatch() > 0) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        if (!running_) {
+            return;
+        }
+        wakeCv_.wait(lock, [this]() {
+            return pending_.load() > 0 || !running_;
+        });
+    }
+}
+
+// Publishes up to one batch, a held message first, then reliable lane first.
+// Returns 0 while the publish window stays full.
+size_t OutboundPublisher::drainBatch() {
+    if (hasHeld_) {
+        if (!send(held_)) {
+            return 0;
+        }
+        hasHeld_ = false;
+        pending_.fetch_sub(1);
+    }
+
+    size_t published = 0;
+    Message message;
+    for (auto& lane : lanes_) {
+        while (published < kMaxBatch && lane->pop(message)) {
+            if (!send(message)) {
+                held_ = std::move(message);
+                hasHeld_ = true;
+                return published;
+            }
+            pending_.fetch_sub(1);
+            ++published;
+        }
+    }
+    return published;
+}
+
+bool OutboundPublisher::send(const Message& message) {
+    // Once stopping, the rest goes straight to the MQTT client so shutdown
+    // isn't held up by a slow broker
+    int result;
+    if (running_.load(std::memory_order_relaxed)) {
+        result = direct_client_publish_raw_message_window(message.topic.c_str(), message.payload.c_str(),
+                                                          message.payload.size(), message.qos, kWindowWaitMs);
+        if (result == UR_RPC_ERROR_WOULD_BLOCK) {
+            return false;
+        }
+    } else {
+        result = direct_client_publish_raw_message_qos(message.topic.c_str(), message.payload.c_str(),
+                                                       message.payload.size(), message.qos);
+    }
+
+    if (result != UR_RPC_SUCCESS) {
+        uint64_t failed = failed_.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (failed == 1 || failed % 1000 == 0) {
+            BACKEND_LOG_ERROR("[OutboundPublisher] Publish to " << message.topic << " failed (error: "
+                              << result << "), " << failed << " failures so far");
+        }
+    }
+    return true;
+}
+
+} // namespace BackendDatalink
@@ -0,0 +1,100 @@
+#include "pipeline_stage.h"
+#include "backend_log.h"
+#include "ur-metrics/ur_metrics.hpp"
+#include <utility>
+
+namespace BackendDatalink {
+
+PipelineStage::PipelineStage(std::string name, Action action)
+    : name_(std::move(name)), action_(std::move(action)) {
+}
+
+PipelineStage::~PipelineStage() {
+    stop();
+}
+
+void PipelineStage::start(std::chrono::milliseconds min_interval) {
+    if (thread_.joinable()) {
+        return;
+    }
+
+    setMinInterval(min_interval);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    thread_ = std::thread(&PipelineStage::run, this);
+}
+
+void PipelineStage::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void PipelineStage::notify() {
+    notified_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_) {
+            return;
+        }
+        pending_ = true;
+    }
+    cv_.notify_one();
+}
+
+void PipelineStage::setMinInterval(std::chrono::milliseconds min_interval) {
+    min_interval_ms_.store(min_interval.count() > 0 ? min_interval.count() : 0, std::memory_order_relaxed);
+}
+
+uint64_t PipelineStage::getCoalescedCount() const {
+    uint64_t notified = notified_.load(std::memory_order_relaxed);
+    uint64_t runs = runs_.load(std::memory_order_relaxed);
+    return notified > runs ? notified - runs : 0;
+}
+
+void PipelineStage::run() {
+    UrMetrics::Histogram& duration = UrMetrics::Registry::instance().histogram(
+        "backend_pipeline_stage_duration_seconds", "Time one pipeline stage run took",
+        UrMetrics::latencyBuckets(), {{"stage", name_}});
+
+    // Far enough back that the first notification runs at once
+    std::chrono::steady_clock::time_point last_run = std::chrono::steady_clock::time_point::min();
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this]() { return pending_ || !running_; });
+        if (!running_) {
+            return;
+        }
+
+        // Rate limit: later notifications only keep pending_ set
+        if (last_run != std::chrono::steady_clock::time_point::min()) {
+            auto due = last_run + std::chrono::milliseconds(min_interval_ms_.load(std::memory_order_relaxed));
+            if (cv_.wait_until(lock, due, [this]() { return !running_; })) {
+                return;
+            }
+        }
+
+        pending_ = false;
+        lock.unlock();
+        last_run = std::chrono::steady_clock::now();
+        try {
+            UrMetrics::ScopedTimer timer(duration);
+            action_();
+        } catch (const std::exception& e) {
+            BACKEND_LOG_EVERY(LOG_ERROR, 60000, "[PipelineStage:" << name_ << "] " << e.what());
+        }
+        runs_.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+    }
+}
+
+} // namespace BackendDatalink
@@ -0,0 +1,78 @@
+#include "request_router.h"
+
+namespace BackendDatalink {
+
+const char* transportName(Transport transport) {
+    return transport == Transport::WebSocket ? "websocket" : "mqtt";
+}
+
+RequestRouter::RequestRouter(const RpcMethodRegistry& methods)
+    : methods_(methods) {
+}
+
+void RequestRouter::coalesce(const std::string& method, std::function<uint64_t()> version) {
+    Coalesced& entry = coalesced_[method];
+    entry.version = std::move(version);
+    entry.results = std::make_unique<SingleFlight<json>>();
+}
+
+json RequestRouter::invoke(Transport transport, std::string_view method, const json& params) const {
+    auto it = coalesced_.find(method);
+    if (it == coalesced_.end()) {
+        try {
+            json result = methods_.invoke(method, params);
+            record(transport, false, false);
+            return result;
+        } catch (...) {
+            record(transport, true, false);
+            throw;
+        }
+    }
+
+    // Keyed by the parameters as text, so equal requests meet whatever
+    // order their fields came in
+    bool shared = false;
+    try {
+        SingleFlight<json>::ValuePtr result = it->second.results->get(
+            params.dump(), it->second.version(), [this, method, &params]() {
+                return std::make_shared<const json>(methods_.invoke(method, params));
+            }, &shared);
+        record(transport, false, shared);
+        return *result;
+    } catch (...) {
+        record(transport, true, shared);
+        throw;
+    }
+}
+
+RequestRouter::Failure RequestRouter::describe(std::string_view method, const std::exception& e) {
+    if (dynamic_cast<const UnknownMethodError*>(&e)) {
+        return {kMethodNotFoundCode, e.what()};
+    }
+    return {kHandlerErrorCode, "Error executing method '" + std::string(method) + "': " + e.what()};
+}
+
+uint64_t RequestRouter::getCallCount(Transport transport) const {
+    return stats_[static_cast<size_t>(transport)].calls.load(std::memory_order_relaxed);
+}
+
+uint64_t RequestRouter::getErrorCount(Transport transport) const {
+    return stats_[static_cast<size_t>(transport)].errors.load(std::memory_order_relaxed);
+}
+
+uint64_t RequestRouter::getCoalescedCount(Transport transport) const {
+    return stats_[static_cast<size_t>(transport)].coalesced.load(std::memory_order_relaxed);
+}
+
+void RequestRouter::record(Transport transport, bool failed, bool shared) const {
+    TransportStats& stats = stats_[static_cast<size_t>(transport)];
+    stats.calls.fetch_add(1, std::memory_order_relaxed);
+    if (failed) {
+        stats.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (shared) {
+        stats.coalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace BackendDatalink
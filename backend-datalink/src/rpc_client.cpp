@@ -3,7 +3,9 @@
 #include "database_manager.h"
 #include "SystemDataCollector.h"
 #include "NetworkPriorityManager.h"
-#include <iostream>
+#include "ur-metrics/ur_metrics.hpp"
+#include "ur-trace/ur_trace.hpp"
+#include "backend_log.h"
 #include <chrono>
 #include <cstring>
 #include <memory>
@@ -18,12 +20,36 @@ extern std::unique_ptr<NetworkPriorityManager> g_network_priority_manager;
 
 } // namespace BackendDatalink
 
+namespace {
+
+UrMetrics::Histogram& rpcQueueWaitSeconds() {
+    static UrMetrics::Histogram& histogram = UrMetrics::Registry::instance().histogram(
+        "backend_rpc_queue_wait_seconds", "Time an RPC request waited for a worker");
+    return histogram;
+}
+
+UrMetrics::Histogram& rpcRequestSeconds() {
+    static UrMetrics::Histogram& histogram = UrMetrics::Registry::instance().histogram(
+        "backend_rpc_request_duration_seconds", "Time to run an RPC method and queue its response");
+    return histogram;
+}
+
+UrMetrics::Counter& rpcRequests(bool success) {
+    static UrMetrics::Counter& ok = UrMetrics::Registry::instance().counter(
+        "backend_rpc_requests_total", "RPC requests answered by a worker", {{"result", "ok"}});
+    static UrMetrics::Counter& error = UrMetrics::Registry::instance().counter(
+        "backend_rpc_requests_total", "RPC requests answered by a worker", {{"result", "error"}});
+    return success ? ok : error;
+}
+
+} // namespace
+
 namespace BackendDatalink {
 
 // RpcClient Implementation
 
-RpcClient::RpcClient(const std::string& configPath, const std::string& clientId)
-    : configPath_(configPath), clientId_(clientId) {
+RpcClient::RpcClient(const std::string& configPath, const std::string& clientId, size_t outboundCapacity)
+    : configPath_(configPath), clientId_(clientId), outbound_(outboundCapacity) {
     // Initialize thread manager with configurable pool size
     threadManager_ = std::make_unique<ThreadMgr::ThreadManager>(10);
     logInfo("RpcClient created with config: " + configPath + ", client ID: " + clientId);
@@ -43,23 +69,26 @@ bool RpcClient::start() {
     }
 
     try {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            startupDone_ = false;
+        }
+
         // Create RPC client thread using ThreadManager
-        rpcThreadId_ = threadManager_->createThread([this]() {
+        rpcThreadId_ = threadManager_->createThreadWithAttributes([this]() {
             this->rpcClientThreadFunc();
-        });
+        }, threadAttr_);
 
         // Wait for thread initialization with timeout
-        const int MAX_WAIT_MS = 3000;
-        const int POLL_INTERVAL_MS = 100;
-        int elapsed = 0;
-        
-        while (elapsed < MAX_WAIT_MS && !running_.load()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
-            elapsed += POLL_INTERVAL_MS;
+        const auto MAX_WAIT = std::chrono::milliseconds(3000);
+        {
+            std::unique_lock<std::mutex> lock(stateMutex_);
+            stateCv_.wait_for(lock, MAX_WAIT, [this]() { return startupDone_; });
         }
 
         bool success = running_.load();
         if (success) {
+            outbound_.start();
             logInfo("RpcClient started successfully");
         } else {
             logError("RpcClient failed to start within timeout");
@@ -79,19 +108,27 @@ void RpcClient::stop() {
     }
 
     logInfo("Stopping RpcClient...");
-    running_.store(false);
     
-    if (rpcContext_) {
-        direct_client_thread_stop(rpcContext_);
-        direct_client_thread_destroy(rpcContext_);
-        rpcContext_ = nullptr;
+    // Queued responses go out while the connection is still up
+    outbound_.stop();
+    
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        running_.store(false);
     }
+    stateCv_.notify_all();
     
-    // Wait for thread to finish
+    // The RPC thread owns the context and tears it down on its way out
     if (threadManager_ && threadManager_->isThreadAlive(rpcThreadId_)) {
         threadManager_->joinThread(rpcThreadId_, std::chrono::seconds(5));
     }
     
+    if (rpcContext_ && !(threadManager_ && threadManager_->isThreadAlive(rpcThreadId_))) {
+        direct_client_thread_stop(rpcContext_);
+        direct_client_thread_destroy(rpcContext_);
+        rpcContext_ = nullptr;
+    }
+    
     connected_.store(false);
     logInfo("RpcClient stopped");
 }
@@ -104,9 +141,9 @@ bool RpcClient::isConnected() const {
     return connected_.load();
 }
 
-void RpcClient::setMessageHandler(std::function<void(const std::string&, const std::string&)> handler) {
+void RpcClient::setMessageHandler(MessageHandler handler) {
     std::lock_guard<std::mutex> lock(handlerMutex_);
-    messageHandler_ = handler;
+    messageHandler_ = std::move(handler);
     logInfo("Message handler set");
 }
 
@@ -116,12 +153,31 @@ void RpcClient::sendResponse(const std::string& topic, const std::string& respon
         return;
     }
     
-    int result = direct_client_publish_raw_message(topic.c_str(), response.c_str(), response.length());
-    if (result == 0) {
-        logInfo("Response sent to topic: " + topic);
-    } else {
-        logError("Failed to send response to topic: " + topic + " (error: " + std::to_string(result) + ")");
+    if (!queueMessage(topic, response)) {
+        BACKEND_LOG_EVERY(LOG_ERROR, 1000, "[RpcClient:" << clientId_ << "] Outbound queue full, dropping response to topic: "
+                          << topic);
+    }
+}
+
+bool RpcClient::queueMessage(std::string topic, std::string payload, int qos) {
+    if (!isRunning()) {
+        return false;
+    }
+    return outbound_.publish(std::move(topic), std::move(payload), qos);
+}
+
+bool RpcClient::sendNotification(const std::string& method, const std::string& service, const nlohmann::json& params) {
+    if (!isRunning() || !isConnected()) {
+        return false;
+    }
+    
+    cJSON* cparams = cJSON_Parse(params.dump().c_str());
+    if (!cparams) {
+        return false;
     }
+    int result = direct_client_send_notification(method.c_str(), service.c_str(), cparams, UR_RPC_AUTHORITY_SYSTEM);
+    cJSON_Delete(cparams);
+    return result == UR_RPC_SUCCESS;
 }
 
 int RpcClient::sendRawMessage(const char* topic, const char* payload, size_t payload_len) {
@@ -154,6 +210,7 @@ void RpcClient::rpcClientThreadFunc() {
             if (!messageHandler_) {
                 logError("ERROR: No message handler set!");
                 running_.store(false);
+                finishStartup();
                 return;
             }
         }
@@ -164,11 +221,16 @@ void RpcClient::rpcClientThreadFunc() {
         if (!rpcContext_) {
             logError("Failed to create client thread context");
             running_.store(false);
+            finishStartup();
             return;
         }
 
-        // Set message handler BEFORE starting the thread
+        // Set handlers BEFORE starting the thread
         direct_client_set_message_handler(rpcContext_, staticMessageHandler, this);
+        direct_client_set_connection_handler(rpcContext_, staticConnectionHandler, this);
+        if (heartbeatRttHandler_) {
+            direct_client_set_heartbeat_rtt_handler(rpcContext_, staticHeartbeatRttHandler, this);
+        }
 
         // Start the client thread
         if (direct_client_thread_start(rpcContext_) != 0) {
@@ -176,6 +238,7 @@ void RpcClient::rpcClientThreadFunc() {
             direct_client_thread_destroy(rpcContext_);
             rpcContext_ = nullptr;
             running_.store(false);
+            finishStartup();
             return;
         }
 
@@ -186,24 +249,28 @@ void RpcClient::rpcClientThreadFunc() {
             direct_client_thread_destroy(rpcContext_);
             rpcContext_ = nullptr;
             running_.store(false);
+            finishStartup();
             return;
         }
 
+        // Loaded by the client thread before it connected
+        const ur_rpc_client_config_t* config = rpcContext_->config;
+        brokerHost_ = config->broker_host ? config->broker_host : "";
+        brokerPort_ = config->broker_port;
+        brokerTls_ = config->use_tls;
+        heartbeatIntervalSeconds_ = config->heartbeat.enabled ? config->heartbeat.interval_seconds : 0;
+        heartbeatEcho_ = config->heartbeat.enabled && config->heartbeat.echo;
+
         running_.store(true);
         connected_.store(true);
         logInfo("RPC client connected and running");
+        finishStartup();
 
-        // Main thread loop
-        while (running_.load()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            
-            // Update connection status
-            if (rpcContext_) {
-                bool currentlyConnected = direct_client_thread_is_connected(rpcContext_);
-                if (currentlyConnected != connected_.load()) {
-                    updateConnectionStatus(currentlyConnected);
-                }
-            }
+        // Connection changes arrive through staticConnectionHandler; this
+        // thread only sleeps until stop()
+        {
+            std::unique_lock<std::mutex> lock(stateMutex_);
+            stateCv_.wait(lock, [this]() { return !running_.load(); });
         }
 
         // Cleanup
@@ -219,11 +286,20 @@ void RpcClient::rpcClientThreadFunc() {
         logError("Thread function error: " + std::string(e.what()));
         running_.store(false);
         connected_.store(false);
+        finishStartup();
     }
     
     logInfo("RPC client thread finished");
 }
 
+void RpcClient::finishStartup() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        startupDone_ = true;
+    }
+    stateCv_.notify_all();
+}
+
 void RpcClient::staticMessageHandler(const char *topic, const char *payload,
                                      size_t payload_len, void *user_data) {
     RpcClient *self = static_cast<RpcClient *>(user_data);
@@ -231,21 +307,35 @@ void RpcClient::staticMessageHandler(const char *topic, const char *payload,
         return;
     }
 
-    // Convert C strings to C++ strings safely
-    const std::string topicStr(topic ? topic : "");
-    const std::string payloadStr(payload ? payload : "", payload_len);
+    // Views into the message, which outlives the handler call
+    const std::string_view topicView(topic ? topic : "");
+    const std::string_view payloadView(payload ? payload : "", payload ? payload_len : 0);
 
     // Delegate to instance handler
     std::lock_guard<std::mutex> lock(self->handlerMutex_);
     if (self->messageHandler_) {
         try {
-            self->messageHandler_(topicStr, payloadStr);
+            self->messageHandler_(topicView, payloadView);
         } catch (const std::exception& e) {
             self->logError("Exception in message handler: " + std::string(e.what()));
         }
     }
 }
 
+void RpcClient::staticConnectionHandler(bool connected, void *user_data) {
+    RpcClient *self = static_cast<RpcClient *>(user_data);
+    if (self) {
+        self->updateConnectionStatus(connected);
+    }
+}
+
+void RpcClient::staticHeartbeatRttHandler(double rtt_ms, void *user_data) {
+    RpcClient *self = static_cast<RpcClient *>(user_data);
+    if (self && self->heartbeatRttHandler_) {
+        self->heartbeatRttHandler_(rtt_ms);
+    }
+}
+
 void RpcClient::updateConnectionStatus(bool connected) {
     connected_.store(connected);
     if (connected) {
@@ -256,20 +346,22 @@ void RpcClient::updateConnectionStatus(bool connected) {
 }
 
 void RpcClient::logInfo(const std::string& message) const {
-    std::cout << "[RpcClient:" << clientId_ << "] " << message << std::endl;
+    BACKEND_LOG_INFO("[RpcClient:" << clientId_ << "] " << message);
 }
 
 void RpcClient::logError(const std::string& message) const {
-    std::cerr << "[RpcClient:" << clientId_ << "] ERROR: " << message << std::endl;
+    BACKEND_LOG_ERROR("[RpcClient:" << clientId_ << "] " << message);
 }
 
 // RpcOperationProcessor Implementation
 
-RpcOperationProcessor::RpcOperationProcessor(bool verbose)
-    : verbose_(verbose) {
-    // Initialize thread manager with appropriate pool size
-    threadManager_ = std::make_shared<ThreadMgr::ThreadManager>(100);
-    logInfo("RpcOperationProcessor created");
+RpcOperationProcessor::RpcOperationProcessor(bool verbose, size_t workerCount, size_t queueCapacity)
+    : executor_(ThreadMgr::TaskExecutor::instance()), maxDrains_(workerCount == 0 ? 1 : workerCount),
+      queue_(kLaneCount, queueCapacity), verbose_(verbose) {
+    // Requests run on the process-wide executor; none of them creates a thread
+    logInfo("RpcOperationProcessor created with " + std::to_string(maxDrains_) + " concurrent requests on " +
+            std::to_string(executor_.workerCount()) + " executor workers, queue capacity " +
+            std::to_string(queue_.laneCapacity()) + " per lane");
 }
 
 RpcOperationProcessor::~RpcOperationProcessor() {
@@ -278,26 +370,33 @@ RpcOperationProcessor::~RpcOperationProcessor() {
 }
 
 void RpcOperationProcessor::processRequest(const char* payload, size_t payload_len) {
+    UR_TRACE_SPAN("rpc.processRequest");
+    
     // Input validation
     if (!payload || payload_len == 0) {
-        logError("Empty payload received");
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[RpcOperationProcessor] Empty payload received");
         return;
     }
 
     // Size validation (prevent memory exhaustion)
     const size_t MAX_PAYLOAD_SIZE = 1024 * 1024; // 1MB
     if (payload_len > MAX_PAYLOAD_SIZE) {
-        logError("Payload too large: " + std::to_string(payload_len) + " bytes");
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[RpcOperationProcessor] Payload too large: " << payload_len << " bytes");
         return;
     }
 
+    // Peers configured with payload_encoding "cbor" send a CBOR map, whose
+    // first byte JSON text can never start with
+    const unsigned char first = static_cast<unsigned char>(payload[0]);
+    const bool cbor = first >= 0x80 && first <= 0xBF;
+
     try {
-        // JSON parsing
-        nlohmann::json root = nlohmann::json::parse(payload, payload + payload_len);
+        nlohmann::json root = cbor ? nlohmann::json::from_cbor(payload, payload + payload_len)
+                                   : nlohmann::json::parse(payload, payload + payload_len);
 
         // JSON-RPC 2.0 validation
         if (!root.contains("jsonrpc") || root["jsonrpc"].get<std::string>() != "2.0") {
-            logError("Invalid or missing JSON-RPC version");
+            BACKEND_LOG_EVERY(LOG_WARN, 1000, "[RpcOperationProcessor] Invalid or missing JSON-RPC version");
             return;
         }
 
@@ -306,63 +405,128 @@ void RpcOperationProcessor::processRequest(const char* payload, size_t payload_l
 
         // Extract method
         if (!root.contains("method") || !root["method"].is_string()) {
-            sendResponse(transactionId, false, "", "Missing method in request");
+            sendResponse(transactionId, false, nullptr, "Missing method in request", -1, cbor);
             return;
         }
         std::string method = root["method"].get<std::string>();
 
         // Extract parameters
         if (!root.contains("params") || !root["params"].is_object()) {
-            sendResponse(transactionId, false, "", "Missing or invalid params in request");
+            sendResponse(transactionId, false, nullptr, "Missing or invalid params in request", -1, cbor);
+            return;
+        }
+
+        // Acks pace a chunked response and get no answer
+        if (method == kChunkAckMethod) {
+            handleChunkAck(root["params"]);
+            return;
+        }
+
+        // Check shutdown state
+        if (isShuttingDown_.load()) {
+            sendResponse(transactionId, false, nullptr, "Server is shutting down", -1, cbor);
             return;
         }
 
-        // Create processing context
-        std::string requestJson(payload, payload_len);
+        size_t chunkWindow = 0;
+        if (root.contains("chunk_window") && root["chunk_window"].is_number_unsigned()) {
+            chunkWindow = root["chunk_window"].get<size_t>();
+        }
+
+        // A redelivery of a request already seen does not run again
+        std::string replayKey;
+        if (replay_ && transactionId != "unknown") {
+            replayKey = method + '\n' + transactionId;
+            std::string stored;
+            switch (replay_->begin(replayKey, stored, std::chrono::steady_clock::now())) {
+                case ReplayCache::Seen::Answered:
+                    replayedRequests_.fetch_add(1, std::memory_order_relaxed);
+                    BACKEND_LOG_EVERY(LOG_INFO, 1000, "[RpcOperationProcessor] Replaying response to redelivered request "
+                                      << transactionId);
+                    deliverResponse(responseTopic_, std::move(stored), transactionId, cbor, chunkWindow);
+                    return;
+                case ReplayCache::Seen::InFlight:
+                    duplicateInFlight_.fetch_add(1, std::memory_order_relaxed);
+                    BACKEND_LOG_EVERY(LOG_INFO, 1000, "[RpcOperationProcessor] Dropping redelivered request "
+                                      << transactionId << ", the first delivery is still running");
+                    return;
+                case ReplayCache::Seen::New:
+                    break;
+            }
+        }
+
+        // Create processing context; the parsed request moves to the worker
+        // as is, so the payload is parsed exactly once
         auto context = std::make_shared<RequestContext>();
-        context->requestJson = requestJson;
+        context->method = std::move(method);
+        context->params = std::move(root["params"]);
         context->transactionId = transactionId;
         context->responseTopic = responseTopic_;
+        context->cbor = cbor;
         context->verbose = verbose_;
-        context->threadIdPromise = std::make_shared<std::promise<unsigned int>>();
-        context->threadIdFuture = context->threadIdPromise->get_future();
-
-        // Launch asynchronous processing
-        try {
-            // Check shutdown state
-            bool shuttingDown = isShuttingDown_.load();
-            if (shuttingDown) {
-                sendResponse(transactionId, false, "", "Server is shutting down");
-                return;
+        context->lane = laneFor(root);
+        context->replayKey = std::move(replayKey);
+        context->chunkWindow = chunkWindow;
+        context->queuedAt = std::chrono::steady_clock::now();
+
+        // The deadline orders the lane; only a caller's own timeout makes a
+        // request expire, and the time it spent in transit counts against it
+        auto deadline = context->queuedAt + kDefaultRequestBudget;
+        bool expires = false;
+        if (root.contains("timeout_ms") && root["timeout_ms"].is_number_integer() &&
+            root["timeout_ms"].get<int64_t>() > 0) {
+            int64_t budgetMs = root["timeout_ms"].get<int64_t>();
+            if (root.contains("timestamp") && root["timestamp"].is_number_unsigned()) {
+                int64_t ageMs = static_cast<int64_t>(ur_rpc_get_timestamp_ms()) -
+                                static_cast<int64_t>(root["timestamp"].get<uint64_t>());
+                budgetMs -= std::min(std::max<int64_t>(ageMs, 0), budgetMs);
             }
+            deadline = context->queuedAt + std::chrono::milliseconds(budgetMs);
+            expires = true;
+        }
 
-            // Create processing thread
-            unsigned int threadId = threadManager_->createThread([context, this]() {
-                RpcOperationProcessor::processOperationThreadStatic(context, this);
-            });
-            
-            // Register thread in tracking set
-            {
-                std::lock_guard<std::mutex> lock(threadsMutex_);
-                activeThreads_.insert(threadId);
+        // Hand over to the pool; a full queue means the workers are saturated
+        pendingRequests_.fetch_add(1);
+        if (!queue_.push(context->lane, deadline, expires, context)) {
+            pendingRequests_.fetch_sub(1);
+            if (!context->replayKey.empty()) {
+                replay_->abandon(context->replayKey);
             }
-            
-            // Set thread ID for worker access
-            context->threadIdPromise->set_value(threadId);
-
-        } catch (const std::exception& e) {
-            logError("Failed to create thread: " + std::string(e.what()));
-            
-            // Fallback to synchronous processing
-            context->threadIdPromise->set_value(0);
-            RpcOperationProcessor::processOperationThreadStatic(context, this);
+            uint64_t rejected = rejectedRequests_.fetch_add(1, std::memory_order_relaxed) + 1;
+            BACKEND_LOG_EVERY(LOG_WARN, 1000, "[RpcOperationProcessor] Work queue full, rejecting request "
+                              << transactionId << " (" << rejected << " rejected so far)");
+            sendResponse(transactionId, false, nullptr, "Server busy, retry later", kServerBusyCode, cbor);
+            return;
         }
 
+        scheduleDrain();
+
     } catch (const nlohmann::json::parse_error& e) {
-        logError("JSON parse error: " + std::string(e.what()));
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[RpcOperationProcessor] " << (cbor ? "CBOR" : "JSON")
+                          << " parse error: " << e.what());
     } catch (const std::exception& e) {
-        logError("Exception processing request: " + std::string(e.what()));
+        BACKEND_LOG_EVERY(LOG_ERROR, 1000, "[RpcOperationProcessor] Exception processing request: " << e.what());
+    }
+}
+
+void RpcOperationProcessor::setReplayWindow(size_t capacity, std::chrono::seconds ttl) {
+    if (capacity == 0) {
+        replay_.reset();
+        return;
+    }
+    replay_ = std::make_unique<ReplayCache>(capacity, ttl);
+    logInfo("Replaying responses to redelivered requests: last " + std::to_string(capacity) + " for " +
+            std::to_string(ttl.count()) + "s");
+}
+
+void RpcOperationProcessor::setChunking(size_t chunkBytes, size_t maxWindow, const std::string& ackTopic) {
+    if (chunkBytes == 0) {
+        chunks_.reset();
+        return;
     }
+    chunks_ = std::make_unique<ChunkedResponses>(chunkBytes, maxWindow, ackTopic);
+    logInfo("Responses over " + std::to_string(chunkBytes) + " bytes sent in chunks, at most " +
+            std::to_string(maxWindow) + " unacked, acks on " + ackTopic);
 }
 
 void RpcOperationProcessor::setResponseTopic(const std::string& topic) {
@@ -371,122 +535,247 @@ void RpcOperationProcessor::setResponseTopic(const std::string& topic) {
 }
 
 void RpcOperationProcessor::shutdown() {
-    // Set shutdown flag to prevent new thread creation
-    isShuttingDown_.store(true);
+    // Reject new requests, then wait for the drains to answer what is queued
+    if (isShuttingDown_.exchange(true)) {
+        return;
+    }
     
-    // Collect all active threads for joining
-    std::vector<unsigned int> threadsToJoin;
-    {
-        std::lock_guard<std::mutex> lock(threadsMutex_);
-        threadsToJoin.assign(activeThreads_.begin(), activeThreads_.end());
+    std::unique_lock<std::mutex> lock(idleMutex_);
+    bool idle = idleCv_.wait_for(lock, std::chrono::minutes(5), [this]() {
+        return activeDrains_.load() == 0 && pendingRequests_.load() == 0;
+    });
+    if (!idle) {
+        logError("WARNING: Requests still running after 5 minutes");
     }
     
-    // Join all threads with timeout
-    for (unsigned int threadId : threadsToJoin) {
-        if (threadManager_->isThreadAlive(threadId)) {
-            bool completed = threadManager_->joinThread(threadId, std::chrono::minutes(5));
-            if (!completed) {
-                logError("WARNING: Thread " + std::to_string(threadId) + " did not complete after 5 minutes");
+    logInfo("RpcOperationProcessor shutdown completed");
+}
+
+bool RpcOperationProcessor::acquireDrainSlot() {
+    size_t active = activeDrains_.load();
+    while (active < maxDrains_) {
+        if (activeDrains_.compare_exchange_weak(active, active + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RpcOperationProcessor::scheduleDrain() {
+    if (acquireDrainSlot()) {
+        executor_.post("rpc-request", [this]() { drainQueue(); });
+    }
+}
+
+void RpcOperationProcessor::drainQueue() {
+    // A bounded batch per task keeps other executor users from starving
+    // while requests keep arriving
+    const int kBatch = 16;
+    auto dropExpired = [this](size_t lane, std::shared_ptr<RequestContext> expired) {
+        pendingRequests_.fetch_sub(1);
+        if (!expired->replayKey.empty()) {
+            replay_->abandon(expired->replayKey);
+        }
+        uint64_t count = expiredRequests_[lane].fetch_add(1, std::memory_order_relaxed) + 1;
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[RpcOperationProcessor] Dropping request " << expired->transactionId
+                          << " (" << expired->method << "), its caller timed out (" << count << " in the "
+                          << laneName(lane) << " lane so far)");
+    };
+    for (int processed = 0; processed < kBatch; ++processed) {
+        std::shared_ptr<RequestContext> context;
+        if (!queue_.pop(context, std::chrono::steady_clock::now(), dropExpired)) {
+            // Give the slot back, then take it again if a request slipped in
+            activeDrains_.fetch_sub(1);
+            if (pendingRequests_.load() > 0 && acquireDrainSlot()) {
+                continue;
             }
+            std::lock_guard<std::mutex> lock(idleMutex_);
+            idleCv_.notify_all();
+            return;
         }
+        pendingRequests_.fetch_sub(1);
+        processOperationThreadStatic(context, this);
     }
     
-    logInfo("RpcOperationProcessor shutdown completed");
+    // Keep the slot and continue in a fresh task at the back of the line
+    executor_.post("rpc-request", [this]() { drainQueue(); });
 }
 
 void RpcOperationProcessor::processOperationThreadStatic(std::shared_ptr<RequestContext> context, RpcOperationProcessor* processor) {
-    // Wait for thread ID synchronization
-    unsigned int threadId = context->threadIdFuture.get();
-    
-    // Extract context data safely
-    const std::string& requestJson = context->requestJson;
+    const std::string& method = context->method;
     const std::string& transactionId = context->transactionId;
-    bool verbose = context->verbose;
+    
+    auto started = std::chrono::steady_clock::now();
+    rpcQueueWaitSeconds().observe(std::chrono::duration<double>(started - context->queuedAt).count());
+    UrMetrics::ScopedTimer timer(rpcRequestSeconds());
+    UR_TRACE_SPAN("rpc.execute");
+    
+    // Process backend-datalink specific operations
+    nlohmann::json result;
+    bool success = true;
+    std::string errorMessage;
+    int errorCode = -1;
     
     try {
-        // Parse request in thread context
-        nlohmann::json root = nlohmann::json::parse(requestJson);
-        
-        // Extract method and parameters
-        std::string method = root["method"].get<std::string>();
-        nlohmann::json paramsObj = root["params"];
-        
-        // Process backend-datalink specific operations
-        nlohmann::json result;
-        bool success = true;
-        std::string errorMessage;
-        
-        try {
-            success = false;
-            errorMessage = "Unknown method: " + method;
-        } catch (const std::exception& e) {
-            success = false;
-            errorMessage = "Error executing method '" + method + "': " + std::string(e.what());
-        }
-        
-        // Send response based on execution result
-        if (success) {
-            sendResponseStatic(transactionId, true, result.dump(), "", context->responseTopic);
-        } else {
-            sendResponseStatic(transactionId, false, "", errorMessage, context->responseTopic);
+        if (!processor->router_) {
+            throw UnknownMethodError(method);
         }
-        
+        result = processor->router_->invoke(Transport::Mqtt, method, context->params);
     } catch (const std::exception& e) {
-        sendResponseStatic(transactionId, false, "", 
-                          std::string("Exception: ") + e.what(), 
-                          context->responseTopic);
+        success = false;
+        RequestRouter::Failure failure = RequestRouter::describe(method, e);
+        errorMessage = std::move(failure.message);
+        errorCode = failure.code;
     }
-
-    // Cleanup thread from tracking using processor instance
-    if (threadId != 0 && processor) {
-        std::lock_guard<std::mutex> lock(processor->threadsMutex_);
-        processor->activeThreads_.erase(threadId);
+    
+    rpcRequests(success).inc();
+    
+    // Send response based on execution result, keeping a copy for redeliveries
+    std::string response;
+    try {
+        response = encodeResponse(transactionId, success, std::move(result), errorMessage, errorCode, context->cbor);
+    } catch (const std::exception& e) {
+        BACKEND_LOG_EVERY(LOG_ERROR, 1000, "[RpcOperationProcessor] Failed to send response: " << e.what());
+        if (!context->replayKey.empty()) {
+            processor->replay_->abandon(context->replayKey);
+        }
+        return;
+    }
+    if (!context->replayKey.empty()) {
+        processor->replay_->complete(context->replayKey, response, std::chrono::steady_clock::now());
     }
+    processor->deliverResponse(context->responseTopic, std::move(response), transactionId, context->cbor,
+                               context->chunkWindow);
 }
 
-void RpcOperationProcessor::sendResponse(const std::string& transactionId, bool success, 
-                                        const std::string& result, const std::string& error) {
-    sendResponseStatic(transactionId, success, result, error, responseTopic_);
+void RpcOperationProcessor::sendResponse(const std::string& transactionId, bool success, nlohmann::json result,
+                                         const std::string& error, int errorCode, bool cbor) {
+    sendResponseStatic(publisher_, transactionId, success, std::move(result), error, responseTopic_, errorCode, cbor);
 }
 
-void RpcOperationProcessor::sendResponseStatic(const std::string& transactionId, bool success,
-                                               const std::string& result, const std::string& error,
-                                               const std::string& responseTopic) {
+void RpcOperationProcessor::sendResponseStatic(RpcClient* publisher, const std::string& transactionId, bool success,
+                                               nlohmann::json result, const std::string& error,
+                                               const std::string& responseTopic, int errorCode, bool cbor) {
     try {
-        nlohmann::json response;
-        response["jsonrpc"] = "2.0";
-        response["id"] = transactionId;
+        publishResponse(publisher, responseTopic,
+                        encodeResponse(transactionId, success, std::move(result), error, errorCode, cbor),
+                        transactionId);
+    } catch (const std::exception& e) {
+        BACKEND_LOG_EVERY(LOG_ERROR, 1000, "[RpcOperationProcessor] Failed to send response: " << e.what());
+    }
+}
 
-        if (success) {
-            // Handle JSON result parsing
-            if (!result.empty() && result[0] == '{') {
-                try {
-                    nlohmann::json parsedResult = nlohmann::json::parse(result);
-                    response["result"] = parsedResult;
-                } catch (const nlohmann::json::parse_error&) {
-                    response["result"] = result;
-                }
-            } else if (!result.empty()) {
-                response["result"] = result;
-            } else {
-                response["result"] = "Operation completed successfully";
-            }
+std::string RpcOperationProcessor::encodeResponse(const std::string& transactionId, bool success,
+                                                  nlohmann::json result, const std::string& error, int errorCode,
+                                                  bool cbor) {
+    nlohmann::json response;
+    response["jsonrpc"] = "2.0";
+    response["id"] = transactionId;
+
+    if (success) {
+        // Handlers hand back JSON; nothing to parse or re-serialize here
+        if (result.is_null()) {
+            response["result"] = "Operation completed successfully";
         } else {
-            // Error response format
-            nlohmann::json errorObj;
-            errorObj["code"] = -1;
-            errorObj["message"] = error;
-            response["error"] = errorObj;
+            response["result"] = std::move(result);
         }
+    } else {
+        // Error response format
+        nlohmann::json errorObj;
+        errorObj["code"] = errorCode;
+        errorObj["message"] = error;
+        response["error"] = errorObj;
+    }
 
-        // Publish response
-        std::string responseJson = response.dump();
-        direct_client_publish_raw_message(responseTopic.c_str(), 
-                                         responseJson.c_str(), 
-                                         responseJson.size());
+    // In the encoding the request came in
+    std::string responseJson;
+    if (cbor) {
+        nlohmann::json::to_cbor(response, responseJson);
+    } else {
+        responseJson = response.dump();
+    }
+    return responseJson;
+}
 
+void RpcOperationProcessor::deliverResponse(const std::string& responseTopic, std::string payload,
+                                            const std::string& transactionId, bool cbor, size_t chunkWindow) {
+    if (!chunks_ || chunkWindow == 0 || !chunks_->needsChunks(payload.size())) {
+        publishResponse(publisher_, responseTopic, std::move(payload), transactionId);
+        return;
+    }
+    try {
+        // Chunks carry JSON text whatever the request's encoding
+        std::string text = cbor ? nlohmann::json::from_cbor(payload).dump() : std::move(payload);
+        for (std::string& chunk : chunks_->start(transactionId, std::move(text), cbor, chunkWindow,
+                                                 std::chrono::steady_clock::now())) {
+            publishResponse(publisher_, responseTopic, std::move(chunk), transactionId);
+        }
     } catch (const std::exception& e) {
-        std::cerr << "Failed to send response: " << e.what() << std::endl;
+        BACKEND_LOG_EVERY(LOG_ERROR, 1000, "[RpcOperationProcessor] Failed to send chunked response: " << e.what());
+    }
+}
+
+void RpcOperationProcessor::handleChunkAck(const nlohmann::json& params) {
+    auto id = params.find("id");
+    auto received = params.find("received");
+    if (id == params.end() || !id->is_string() || received == params.end() || !received->is_number_unsigned()) {
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[RpcOperationProcessor] Malformed " << kChunkAckMethod << " ignored");
+        return;
+    }
+    if (!chunks_) {
+        return;
+    }
+    const std::string& transactionId = id->get_ref<const std::string&>();
+    for (std::string& chunk : chunks_->ack(transactionId, received->get<size_t>(), std::chrono::steady_clock::now())) {
+        publishResponse(publisher_, responseTopic_, std::move(chunk), transactionId);
+    }
+}
+
+void RpcOperationProcessor::publishResponse(RpcClient* publisher, const std::string& responseTopic,
+                                            std::string payload, const std::string& transactionId) {
+    if (publisher) {
+        if (!publisher->queueMessage(responseTopic, std::move(payload))) {
+            BACKEND_LOG_EVERY(LOG_ERROR, 1000, "[RpcOperationProcessor] Failed to queue response " << transactionId);
+        }
+    } else {
+        direct_client_publish_raw_message(responseTopic.c_str(), 
+                                         payload.c_str(), 
+                                         payload.size());
+    }
+}
+
+const char* RpcOperationProcessor::laneName(size_t lane) {
+    switch (lane) {
+        case kControlLane: return "control";
+        case kInteractiveLane: return "interactive";
+        case kBulkLane: return "bulk";
+        default: return "unknown";
+    }
+}
+
+// "authority" is a ur_rpc_authority_t from ur-rpc-template peers, or its
+// name
+size_t RpcOperationProcessor::laneFor(const nlohmann::json& request) {
+    auto it = request.find("authority");
+    if (it == request.end()) {
+        return kInteractiveLane;
+    }
+    ur_rpc_authority_t authority;
+    if (it->is_number_integer()) {
+        authority = static_cast<ur_rpc_authority_t>(it->get<int>());
+    } else if (it->is_string()) {
+        authority = ur_rpc_authority_from_string(it->get_ref<const std::string&>().c_str());
+    } else {
+        return kInteractiveLane;
+    }
+    switch (authority) {
+        case UR_RPC_AUTHORITY_ADMIN:
+        case UR_RPC_AUTHORITY_SYSTEM:
+            return kControlLane;
+        case UR_RPC_AUTHORITY_GUEST:
+            return kBulkLane;
+        default:
+            return kInteractiveLane;
     }
 }
 
@@ -501,21 +790,14 @@ std::string RpcOperationProcessor::extractTransactionId(const nlohmann::json& re
     return "unknown";
 }
 
-void RpcOperationProcessor::cleanupThreadTracking(unsigned int threadId, std::shared_ptr<RequestContext> /*context*/) {
-    if (threadId != 0) {
-        std::lock_guard<std::mutex> lock(threadsMutex_);
-        activeThreads_.erase(threadId);
-    }
-}
-
 void RpcOperationProcessor::logInfo(const std::string& message) const {
     if (verbose_) {
-        std::cout << "[RpcOperationProcessor] " << message << std::endl;
+        BACKEND_LOG_INFO("[RpcOperationProcessor] " << message);
     }
 }
 
 void RpcOperationProcessor::logError(const std::string& message) const {
-    std::cerr << "[RpcOperationProcessor] ERROR: " << message << std::endl;
+    BACKEND_LOG_ERROR("[RpcOperationProcessor] " << message);
 }
 
 // Backend-datalink specific operation handlers
@@ -0,0 +1,97 @@
+#include "rpc_method_registry.h"
+#include "backend_log.h"
+#include <algorithm>
+#include <chrono>
+
+namespace BackendDatalink {
+
+bool RpcMethodRegistry::add(const std::string& name, Handler handler) {
+    if (frozen_) {
+        BACKEND_LOG_ERROR("[RpcMethodRegistry] Cannot register " << name << " after freeze");
+        return false;
+    }
+
+    for (const auto& entry : entries_) {
+        if (entry->name == name) {
+            BACKEND_LOG_ERROR("[RpcMethodRegistry] Duplicate method " << name);
+            return false;
+        }
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->name = name;
+    entry->handler = std::move(handler);
+    entries_.push_back(std::move(entry));
+    return true;
+}
+
+void RpcMethodRegistry::freeze() {
+    std::sort(entries_.begin(), entries_.end(),
+              [](const std::unique_ptr<Entry>& a, const std::unique_ptr<Entry>& b) { return a->name < b->name; });
+    frozen_ = true;
+    BACKEND_LOG_INFO("[RpcMethodRegistry] " << entries_.size() << " methods registered");
+}
+
+const RpcMethodRegistry::Entry* RpcMethodRegistry::find(std::string_view name) const {
+    if (!frozen_) {
+        return nullptr;
+    }
+
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), name,
+                               [](const std::unique_ptr<Entry>& entry, std::string_view key) {
+                                   return std::string_view(entry->name) < key;
+                               });
+    return it != entries_.end() && (*it)->name == name ? it->get() : nullptr;
+}
+
+bool RpcMethodRegistry::contains(std::string_view name) const {
+    return find(name) != nullptr;
+}
+
+json RpcMethodRegistry::invoke(std::string_view name, const json& params) const {
+    const Entry* entry = find(name);
+    if (!entry) {
+        throw UnknownMethodError(std::string(name));
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto record = [entry, started](bool failed) {
+        uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count());
+        entry->calls.fetch_add(1, std::memory_order_relaxed);
+        entry->total_ns.fetch_add(elapsed, std::memory_order_relaxed);
+        if (failed) {
+            entry->errors.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        uint64_t max = entry->max_ns.load(std::memory_order_relaxed);
+        while (elapsed > max && !entry->max_ns.compare_exchange_weak(max, elapsed, std::memory_order_relaxed)) {
+        }
+    };
+
+    try {
+        json result = entry->handler(params);
+        record(false);
+        return result;
+    } catch (...) {
+        record(true);
+        throw;
+    }
+}
+
+json RpcMethodRegistry::getStats() const {
+    json stats = json::object();
+    for (const auto& entry : entries_) {
+        uint64_t calls = entry->calls.load(std::memory_order_relaxed);
+        uint64_t total_ns = entry->total_ns.load(std::memory_order_relaxed);
+        stats[entry->name] = {
+            {"calls", calls},
+            {"errors", entry->errors.load(std::memory_order_relaxed)},
+            {"avg_ms", calls > 0 ? static_cast<double>(total_ns) / calls / 1e6 : 0.0},
+            {"max_ms", static_cast<double>(entry->max_ns.load(std::memory_order_relaxed)) / 1e6}
+        };
+    }
+    return stats;
+}
+
+} // namespace BackendDatalink
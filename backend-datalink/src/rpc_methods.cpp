@@ -0,0 +1,392 @@
+#include "rpc_methods.h"
+#include "database_manager.h"
+#include "dashboard_delta.h"
+#include "metrics_history.h"
+#include "camera_discovery.h"
+#include "wireless_scanner.h"
+#include "collector_governor.h"
+#include "SystemDataCollector.h"
+#include "NetworkPriorityManager.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace BackendDatalink {
+
+// Forward declarations of global variables defined in main.cpp
+extern std::unique_ptr<DatabaseManager> g_database;
+extern std::unique_ptr<SystemDataCollector> g_system_collector;
+extern std::unique_ptr<NetworkPriorityManager> g_network_priority_manager;
+extern DashboardDeltaEngine g_dashboard_delta;
+extern std::unique_ptr<MetricsHistory> g_metrics_history;
+extern std::unique_ptr<CameraDiscovery> g_camera_discovery;
+extern std::unique_ptr<WirelessScanner> g_wireless_scanner;
+extern std::unique_ptr<CollectorGovernor> g_collector_governor;
+
+namespace {
+
+DatabaseManager& database() {
+    if (!g_database || !g_database->isInitialized()) {
+        throw std::runtime_error("Database not available");
+    }
+    return *g_database;
+}
+
+SystemDataCollector& collector() {
+    if (!g_system_collector) {
+        throw std::runtime_error("System data collector not available");
+    }
+    return *g_system_collector;
+}
+
+// Not before its startup phase has loaded the tables and restored the rules
+NetworkPriorityManager& networkPriority() {
+    if (!g_network_priority_manager || !g_network_priority_manager->isRunning()) {
+        throw std::runtime_error("Network priority manager not available");
+    }
+    return *g_network_priority_manager;
+}
+
+MetricsHistory& metricsHistory() {
+    if (!g_metrics_history) {
+        throw std::runtime_error("Metrics history not available");
+    }
+    return *g_metrics_history;
+}
+
+CameraDiscovery& cameraDiscovery() {
+    if (!g_camera_discovery) {
+        throw std::runtime_error("Camera discovery not available");
+    }
+    return *g_camera_discovery;
+}
+
+WirelessScanner& wirelessScanner() {
+    if (!g_wireless_scanner) {
+        throw std::runtime_error("Wireless scanner not available");
+    }
+    return *g_wireless_scanner;
+}
+
+json outcome(bool success, const char* succeeded, const char* failed) {
+    return {
+        {"success", success},
+        {"message", success ? succeeded : failed}
+    };
+}
+
+RoutingRule ruleFromParams(const json& params) {
+    RoutingRule rule;
+    rule.destination = params.value("destination", "");
+    rule.gateway = params.value("gateway", "");
+    rule.interface = params.value("interface", "");
+    rule.metric = params.value("metric", 100);
+    rule.priority = params.value("priority", 1);
+    return rule;
+}
+
+// Upper bound on operations in one network_priority.bulk_apply
+const size_t kMaxBulkOperations = 1000;
+
+RoutingRuleOperation operationFromParams(const json& params, size_t position) {
+    if (!params.is_object()) {
+        throw std::invalid_argument("operations[" + std::to_string(position) + "] must be an object");
+    }
+    
+    RoutingRuleOperation operation;
+    std::string op = params.value("op", "");
+    if (op == "add") {
+        operation.kind = RoutingRuleOperation::Add;
+    } else if (op == "update") {
+        operation.kind = RoutingRuleOperation::Update;
+    } else if (op == "delete") {
+        operation.kind = RoutingRuleOperation::Delete;
+    } else {
+        throw std::invalid_argument("operations[" + std::to_string(position) + "]: unknown op \"" + op + "\"");
+    }
+    operation.rule_id = params.value("rule_id", "");
+    if (operation.kind != RoutingRuleOperation::Delete) {
+        operation.rule = ruleFromParams(params);
+    }
+    return operation;
+}
+
+// Upper bound on buckets in one metrics_history.get_history
+const size_t kMaxHistoryBuckets = 5000;
+
+// start() and stop() own the collector thread; RPC workers take turns
+std::mutex collector_control_mutex;
+
+} // namespace
+
+void registerDashboardMethods(RpcMethodRegistry& registry) {
+    registry.add("dashboard.get_data", [](const json& params) {
+        DatabaseManager& db = database();
+
+        // Requested categories, or all of them; unknown names get an empty
+        // object
+        std::vector<DashboardCategory> categories;
+        json dashboard_data = json::object();
+        json sequence = json::object();
+        if (params.contains("categories") && params["categories"].is_array()) {
+            for (const auto& cat : params["categories"]) {
+                DashboardCategory category;
+                if (!cat.is_string()) {
+                    continue;
+                }
+                if (parseDashboardCategory(cat.get_ref<const std::string&>().c_str(), category)) {
+                    categories.push_back(category);
+                } else {
+                    dashboard_data[cat.get<std::string>()] = json::object();
+                    sequence[cat.get<std::string>()] = 0;
+                }
+            }
+        } else {
+            for (const auto& info : kDashboardCategories) {
+                if (info.in_full_reply) {
+                    categories.push_back(info.id);
+                }
+            }
+        }
+
+        // Each category comes with the delta sequence its snapshot
+        // corresponds to, so the client can apply later patches. A reader
+        // over MQTT subscribes to nothing; its polls keep the collectors up.
+        auto now = std::chrono::steady_clock::now();
+        for (DashboardCategory category : categories) {
+            const char* name = categoryName(category);
+            if (g_collector_governor) {
+                g_collector_governor->noteRequest(category, now);
+            }
+            sequence[name] = g_dashboard_delta.getSequence(category);
+            json data;
+            if (db.getDashboardDataJson(name, data)) {
+                dashboard_data[name] = std::move(data);
+            } else {
+                dashboard_data[name] = json::object();
+            }
+        }
+
+        return json{{"data", std::move(dashboard_data)}, {"sequence", std::move(sequence)}};
+    });
+}
+
+void registerNetworkPriorityMethods(RpcMethodRegistry& registry) {
+    registry.add("network_priority.get_data", [](const json&) {
+        return networkPriority().getAllDataAsJson();
+    });
+
+    registry.add("network_priority.set_interface_priority", [](const json& params) {
+        bool success = networkPriority().setInterfacePriority(params.value("interface_name", ""),
+                                                              params.value("priority", 0));
+        return outcome(success, "Interface priority updated", "Failed to update interface priority");
+    });
+
+    registry.add("network_priority.add_routing_rule", [](const json& params) {
+        bool success = networkPriority().addRoutingRule(ruleFromParams(params));
+        return outcome(success, "Routing rule added", "Failed to add routing rule");
+    });
+
+    registry.add("network_priority.update_routing_rule", [](const json& params) {
+        bool success = networkPriority().updateRoutingRule(params.value("rule_id", ""), ruleFromParams(params));
+        return outcome(success, "Routing rule updated", "Failed to update routing rule");
+    });
+
+    registry.add("network_priority.delete_routing_rule", [](const json& params) {
+        bool success = networkPriority().deleteRoutingRule(params.value("rule_id", ""));
+        return outcome(success, "Routing rule deleted", "Failed to delete routing rule");
+    });
+
+    // {"operations": [{"op": "add" | "update" | "delete", "rule_id": ..., rule
+    // fields as above}, ...]}, applied together or not at all
+    registry.add("network_priority.bulk_apply", [](const json& params) {
+        if (!params.contains("operations") || !params["operations"].is_array()) {
+            throw std::invalid_argument("operations must be an array");
+        }
+        const json& items = params["operations"];
+        if (items.size() > kMaxBulkOperations) {
+            throw std::invalid_argument("At most " + std::to_string(kMaxBulkOperations) + " operations per call");
+        }
+        
+        std::vector<RoutingRuleOperation> operations;
+        operations.reserve(items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+            operations.push_back(operationFromParams(items[i], i));
+        }
+        
+        std::vector<RoutingRuleOperationResult> results;
+        bool success = networkPriority().applyRoutingRuleOperations(operations, results);
+        
+        json result_items = json::array();
+        for (const auto& result : results) {
+            json item = {{"success", result.success}, {"rule_id", result.rule_id}};
+            if (!result.error.empty()) {
+                item["error"] = result.error;
+            }
+            result_items.push_back(std::move(item));
+        }
+        json response = outcome(success, "Routing rule operations applied", "Routing rule operations not applied");
+        response["results"] = std::move(result_items);
+        return response;
+    });
+
+    registry.add("network_priority.apply_configuration", [](const json&) {
+        bool success = networkPriority().applyRoutingConfiguration();
+        return outcome(success, "Configuration applied", "Failed to apply configuration");
+    });
+
+    registry.add("network_priority.reset_to_defaults", [](const json&) {
+        bool success = networkPriority().resetToDefaults();
+        return outcome(success, "Reset to defaults", "Failed to reset to defaults");
+    });
+}
+
+void registerCollectorMethods(RpcMethodRegistry& registry) {
+    // Latest published metrics; {"section": "cpu"} narrows to one section
+    registry.add("collector.get_metrics", [](const json& params) {
+        auto snapshot = collector().getJsonSnapshot();
+        if (!snapshot) {
+            return json::object();
+        }
+
+        std::string section = params.value("section", "");
+        if (section.empty()) {
+            return snapshot->metrics();
+        }
+        if (!snapshot->metrics().contains(section)) {
+            throw std::invalid_argument("Unknown section: " + section);
+        }
+        return snapshot->metrics()[section];
+    });
+
+    registry.add("collector.get_status", [](const json&) {
+        SystemDataCollector& sdc = collector();
+        auto snapshot = sdc.getJsonSnapshot();
+        return json{
+            {"running", sdc.isRunning()},
+            {"poll_interval_seconds", sdc.getPollInterval()},
+            {"generation", snapshot ? snapshot->generation() : 0}
+        };
+    });
+
+    registry.add("collector.start", [](const json&) {
+        SystemDataCollector& sdc = collector();
+        std::lock_guard<std::mutex> lock(collector_control_mutex);
+        bool success = sdc.isRunning() || sdc.start(sdc.getPollInterval());
+        return outcome(success, "Collector running", "Failed to start collector");
+    });
+
+    registry.add("collector.stop", [](const json&) {
+        SystemDataCollector& sdc = collector();
+        std::lock_guard<std::mutex> lock(collector_control_mutex);
+        sdc.stop();
+        return outcome(true, "Collector stopped", "");
+    });
+}
+
+void registerHistoryMethods(RpcMethodRegistry& registry) {
+    // Defaults to the last 24 hours in 300 buckets, every field
+    registry.add("metrics_history.get_history", [](const json& params) {
+        int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        for (const char* key : {"from", "to"}) {
+            if (params.contains(key) && !params[key].is_number_integer()) {
+                throw std::invalid_argument(std::string(key) + " must be a Unix timestamp in seconds");
+            }
+        }
+        int64_t to = params.value("to", now);
+        int64_t from = params.value("from", to - 86400);
+        if (from > to) {
+            throw std::invalid_argument("from must not be after to");
+        }
+
+        size_t buckets = 300;
+        if (params.contains("buckets")) {
+            if (!params["buckets"].is_number_unsigned() || params["buckets"].get<size_t>() == 0 ||
+                params["buckets"].get<size_t>() > kMaxHistoryBuckets) {
+                throw std::invalid_argument("buckets must be between 1 and " + std::to_string(kMaxHistoryBuckets));
+            }
+            buckets = params["buckets"].get<size_t>();
+        }
+
+        std::vector<std::string> fields;
+        if (params.contains("fields")) {
+            if (!params["fields"].is_array()) {
+                throw std::invalid_argument("fields must be an array of field names");
+            }
+            for (const auto& field : params["fields"]) {
+                if (!field.is_string()) {
+                    throw std::invalid_argument("fields must be an array of field names");
+                }
+                fields.push_back(field.get<std::string>());
+            }
+        }
+
+        HistoryAggregate aggregate;
+        if (!metricsHistory().aggregate(from, to, buckets, fields, aggregate)) {
+            throw std::invalid_argument("Unknown field in fields");
+        }
+        return MetricsHistory::toJson(aggregate);
+    });
+}
+
+void registerCameraMethods(RpcMethodRegistry& registry) {
+    // Rescans only subnets missing from the cache unless forced; the reply
+    // carries the cache either way, and the rest streams as "cameras"
+    // dashboard updates
+    registry.add("cameras.scan", [](const json& params) {
+        if (params.contains("subnet") && !params["subnet"].is_string()) {
+            throw std::invalid_argument("subnet must be a string such as 192.168.1.0/24");
+        }
+        bool force = params.contains("force") && params["force"].is_boolean() && params["force"].get<bool>();
+        CameraDiscovery& discovery = cameraDiscovery();
+        bool started = discovery.requestScan(params.value("subnet", ""), force);
+        return json{
+            {"scan_started", started},
+            {"sequence", g_dashboard_delta.getSequence(DashboardCategory::Cameras)},
+            {"data", discovery.getCameras()}
+        };
+    });
+
+    registry.add("cameras.get", [](const json&) {
+        return json{
+            {"sequence", g_dashboard_delta.getSequence(DashboardCategory::Cameras)},
+            {"data", cameraDiscovery().getCameras()}
+        };
+    });
+}
+
+void registerWirelessMethods(RpcMethodRegistry& registry) {
+    // Joins a scan in progress or serves the cache when it is fresh; new
+    // results stream as "wireless" dashboard updates
+    registry.add("wireless.scan", [](const json& params) {
+        bool force = params.contains("force") && params["force"].is_boolean() && params["force"].get<bool>();
+        WirelessScanner& scanner = wirelessScanner();
+        bool started = scanner.requestScan(force);
+        return json{
+            {"scan_started", started},
+            {"sequence", g_dashboard_delta.getSequence(DashboardCategory::Wireless)},
+            {"data", scanner.getNetworks()}
+        };
+    });
+
+    registry.add("wireless.get", [](const json&) {
+        return json{
+            {"sequence", g_dashboard_delta.getSequence(DashboardCategory::Wireless)},
+            {"data", wirelessScanner().getNetworks()}
+        };
+    });
+}
+
+void registerRegistryMethods(RpcMethodRegistry& registry) {
+    // The registry outlives every call made through it
+    RpcMethodRegistry* self = &registry;
+    registry.add("rpc.get_stats", [self](const json&) {
+        return self->getStats();
+    });
+}
+
+} // namespace BackendDatalink
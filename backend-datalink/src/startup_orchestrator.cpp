@@ -0,0 +1,161 @@
+#include "startup_orchestrator.h"
+#include "backend_log.h"
+#include <stdexcept>
+#include <thread>
+
+namespace BackendDatalink {
+
+namespace {
+
+int64_t toMs(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+} // namespace
+
+void StartupOrchestrator::add(const std::string& name, const std::vector<std::string>& after, Task task) {
+    Phase phase;
+    phase.name = name;
+    phase.task = std::move(task);
+    for (const auto& dependency : after) {
+        size_t index = 0;
+        while (index < phases_.size() && phases_[index].name != dependency) {
+            ++index;
+        }
+        if (index == phases_.size()) {
+            throw std::logic_error("Startup phase " + name + " runs after unknown phase " + dependency);
+        }
+        phase.after.push_back(index);
+    }
+    phases_.push_back(std::move(phase));
+}
+
+// Phases can only name earlier phases, so there are no cycles and every
+// pending phase eventually becomes ready or is skipped
+bool StartupOrchestrator::run() {
+    started_ = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    bool ok = true;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        size_t running = 0;
+        for (size_t i = 0; i < phases_.size(); ++i) {
+            Phase& phase = phases_[i];
+            if (phase.state == State::Running) {
+                ++running;
+            }
+            if (phase.state != State::Pending) {
+                continue;
+            }
+
+            bool ready = true;
+            for (size_t dependency : phase.after) {
+                State state = phases_[dependency].state;
+                if (state == State::Failed || state == State::Skipped) {
+                    phase.state = State::Skipped;
+                    phase.error = phases_[dependency].name + " did not start";
+                    BACKEND_LOG_ERROR("[Startup] " << phase.name << " skipped: " << phase.error);
+                    ok = false;
+                    break;
+                }
+                ready = ready && state == State::Succeeded;
+            }
+            if (phase.state == State::Pending && ready) {
+                phase.state = State::Running;
+                phase.start = std::chrono::steady_clock::now() - started_;
+                threads.emplace_back(&StartupOrchestrator::runPhase, this, i);
+                ++running;
+            }
+        }
+        if (!running) {
+            break;
+        }
+        finished_.wait(lock);
+    }
+
+    for (const auto& phase : phases_) {
+        ok = ok && phase.state == State::Succeeded;
+    }
+    auto total = std::chrono::steady_clock::now() - started_;
+    lock.unlock();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    BACKEND_LOG_INFO("[Startup] " << (ok ? "Ready" : "Failed") << " after " << toMs(total) << " ms");
+    return ok;
+}
+
+void StartupOrchestrator::runPhase(size_t index) {
+    Task task;
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task = phases_[index].task;
+        name = phases_[index].name;
+    }
+
+    bool ok = false;
+    std::string error;
+    try {
+        ok = task();
+        if (!ok) {
+            error = "failed";
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    auto end = std::chrono::steady_clock::now() - started_;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Phase& phase = phases_[index];
+        phase.state = ok ? State::Succeeded : State::Failed;
+        phase.duration = end - phase.start;
+        phase.error = error;
+        if (ok) {
+            BACKEND_LOG_INFO("[Startup] " << name << " ready at +" << toMs(phase.start) << " ms, took "
+                             << toMs(phase.duration) << " ms");
+        } else {
+            BACKEND_LOG_ERROR("[Startup] " << name << " failed after " << toMs(phase.duration) << " ms: " << error);
+        }
+    }
+    finished_.notify_all();
+}
+
+json StartupOrchestrator::report() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json phases = json::array();
+    for (const auto& phase : phases_) {
+        json after = json::array();
+        for (size_t dependency : phase.after) {
+            after.push_back(phases_[dependency].name);
+        }
+        json entry = {
+            {"phase", phase.name},
+            {"after", after},
+            {"state", stateName(phase.state)},
+            {"start_ms", toMs(phase.start)},
+            {"duration_ms", toMs(phase.duration)}
+        };
+        if (!phase.error.empty()) {
+            entry["error"] = phase.error;
+        }
+        phases.push_back(std::move(entry));
+    }
+    return phases;
+}
+
+const char* StartupOrchestrator::stateName(State state) {
+    switch (state) {
+        case State::Pending: return "pending";
+        case State::Running: return "running";
+        case State::Succeeded: return "ready";
+        case State::Failed: return "failed";
+        case State::Skipped: return "skipped";
+    }
+    return "unknown";
+}
+
+} // namespace BackendDatalink
@@ -0,0 +1,117 @@
+#include "telemetry_publisher.h"
+#include "rpc_client.h"
+#include "backend_log.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+namespace BackendDatalink {
+
+namespace {
+
+typedef SystemDataCollector::SystemMetrics SystemMetrics;
+
+struct Field {
+    const char* name;
+    double (*read)(const SystemMetrics& metrics);
+};
+
+// Same names as the metrics_history columns
+const Field kFields[] = {
+    {"cpu_percent", [](const SystemMetrics& m) { return m.cpu.usage_percent; }},
+    {"cpu_temperature_c", [](const SystemMetrics& m) { return m.cpu.temperature_celsius; }},
+    {"ram_percent", [](const SystemMetrics& m) { return m.ram.usage_percent; }},
+    {"swap_percent", [](const SystemMetrics& m) { return m.swap.usage_percent; }},
+    {"latency_ms", [](const SystemMetrics& m) { return m.network.internet.latency_ms; }},
+    {"rssi_dbm", [](const SystemMetrics& m) { return m.signal.strength.rssi_dbm; }},
+    {"sinr_db", [](const SystemMetrics& m) { return m.signal.strength.sinr_db; }}
+};
+
+// Two decimals are plenty for a dashboard and keep the payload short
+double rounded(double value) {
+    return std::round(value * 100.0) / 100.0;
+}
+
+} // namespace
+
+TelemetryPublisher::TelemetryPublisher(const ConfigLoader::TelemetryConfig& config, RpcClient* client)
+    : config_(config), client_(client) {
+    static_assert(sizeof(kFields) / sizeof(kFields[0]) == kFieldCount, "kFieldCount out of date");
+    for (size_t i = 0; i < kFieldCount; ++i) {
+        auto it = config_.deadbands.find(kFields[i].name);
+        deadbands_[i] = it != config_.deadbands.end() ? it->second : 0.0;
+        last_published_[i] = 0.0;
+    }
+}
+
+void TelemetryPublisher::record(const SystemMetrics& metrics) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    if (samples_ == 0) {
+        window_start_ = now;
+    }
+
+    for (size_t i = 0; i < kFieldCount; ++i) {
+        double value = kFields[i].read(metrics);
+        Aggregate& aggregate = window_[i];
+        if (samples_ == 0) {
+            aggregate.min = aggregate.max = aggregate.sum = value;
+        } else {
+            aggregate.min = std::min(aggregate.min, value);
+            aggregate.max = std::max(aggregate.max, value);
+            aggregate.sum += value;
+        }
+    }
+    ++samples_;
+
+    if (now - window_start_ >= std::chrono::seconds(config_.window_seconds)) {
+        closeWindow();
+    }
+}
+
+void TelemetryPublisher::closeWindow() {
+    bool full = !has_published_ ||
+                (config_.full_report_windows > 0 && windows_since_full_ + 1 >= config_.full_report_windows);
+
+    nlohmann::json fields = nlohmann::json::object();
+    double averages[kFieldCount];
+    for (size_t i = 0; i < kFieldCount; ++i) {
+        averages[i] = window_[i].sum / static_cast<double>(samples_);
+        double moved = std::fabs(averages[i] - last_published_[i]);
+        bool changed = deadbands_[i] > 0.0 ? moved >= deadbands_[i] : moved > 0.0;
+        if (full || changed) {
+            fields[kFields[i].name] = {rounded(window_[i].min), rounded(averages[i]), rounded(window_[i].max)};
+        } else {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!fields.empty()) {
+        nlohmann::json params = {
+            {"window_s", config_.window_seconds},
+            {"samples", samples_},
+            {"ts", static_cast<int64_t>(std::time(nullptr))},
+            {"fields", std::move(fields)}
+        };
+        if (client_ && client_->sendNotification(config_.method, config_.service, params)) {
+            // Later windows are compared with what subscribers last saw
+            for (size_t i = 0; i < kFieldCount; ++i) {
+                if (params["fields"].contains(kFields[i].name)) {
+                    last_published_[i] = averages[i];
+                }
+            }
+            has_published_ = true;
+            windows_since_full_ = full ? 0 : windows_since_full_ + 1;
+            published_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            uint64_t failed = failed_.fetch_add(1, std::memory_order_relaxed) + 1;
+            BACKEND_LOG_EVERY(LOG_WARN, 60000, "[Telemetry] Notification not sent (" << failed << " so far)");
+        }
+    } else {
+        ++windows_since_full_;
+    }
+
+    samples_ = 0;
+}
+
+} // namespace BackendDatalink
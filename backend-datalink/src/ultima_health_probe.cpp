@@ -0,0 +1,83 @@
+#include "ultima_health_probe.h"
+#include "rpc_client.h"
+#include <algorithm>
+#include <cmath>
+
+namespace BackendDatalink {
+
+UltimaHealthProbe::UltimaHealthProbe(const RpcClient* client)
+    : client_(client) {
+    window_.reserve(kWindow);
+}
+
+void UltimaHealthProbe::recordRtt(double rtt_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (window_.size() < kWindow) {
+        window_.push_back(rtt_ms);
+    } else {
+        window_[next_] = rtt_ms;
+    }
+    next_ = (next_ + 1) % kWindow;
+
+    ewma_ms_ = echoes_.load(std::memory_order_relaxed) == 0 ? rtt_ms : ewma_ms_ + kEwmaWeight * (rtt_ms - ewma_ms_);
+    last_ms_ = rtt_ms;
+    last_echo_ = std::chrono::steady_clock::now();
+    echoes_.fetch_add(1, std::memory_order_relaxed);
+}
+
+double UltimaHealthProbe::getAverageMs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ewma_ms_;
+}
+
+void UltimaHealthProbe::sample(SystemDataCollector::SystemMetrics::UltimaServer& server) {
+    if (!client_ || client_->getBrokerHost().empty()) {
+        return;
+    }
+
+    server.server = client_->getBrokerHost();
+    server.port = client_->getBrokerPort();
+    server.protocol = client_->usesTls() ? "MQTTS" : "MQTT";
+
+    bool connected = client_->isConnected();
+    if (connected) {
+        was_connected_ = true;
+    }
+    server.session = connected ? SessionState::Active : was_connected_ ? SessionState::Reconnecting : SessionState::None;
+
+    std::vector<double> sorted;
+    std::chrono::steady_clock::time_point last_echo;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        server.last_ping_ms = last_ms_;
+        server.ping_avg_ms = ewma_ms_;
+        sorted = window_;
+        last_echo = last_echo_;
+    }
+    if (!sorted.empty()) {
+        std::sort(sorted.begin(), sorted.end());
+        server.ping_p50_ms = percentile(sorted, 0.50);
+        server.ping_p95_ms = percentile(sorted, 0.95);
+        server.ping_p99_ms = percentile(sorted, 0.99);
+    }
+
+    // Echoes that stop while the session stays up point at the path to the
+    // server (or the broker's bridge to it), not at this box
+    if (!connected) {
+        server.status = LinkStatus::Disconnected;
+    } else if (client_->isHeartbeatEchoEnabled() && !sorted.empty() &&
+               std::chrono::steady_clock::now() - last_echo >
+                   std::chrono::seconds(kStaleBeats * client_->getHeartbeatIntervalSeconds())) {
+        server.status = LinkStatus::Degraded;
+    } else {
+        server.status = LinkStatus::Connected;
+    }
+}
+
+// Nearest-rank percentile of an ascending, non-empty sample
+double UltimaHealthProbe::percentile(const std::vector<double>& sorted, double fraction) {
+    size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+} // namespace BackendDatalink
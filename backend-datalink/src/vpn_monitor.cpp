@@ -0,0 +1,756 @@
+#include "vpn_monitor.h"
+#include "backend_log.h"
+#include "netlink_message.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <arpa/inet.h>
+#include <linux/if_link.h>
+#include <linux/rtnetlink.h>
+#include <linux/wireguard.h>
+#include <net/if.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace BackendDatalink {
+
+constexpr std::chrono::seconds VpnMonitor::kReconnectInterval;
+
+namespace {
+
+// How long a request or dump on the netlink sockets may take
+const int kCommandTimeoutMs = 2000;
+// WireGuard drops a session this long after its handshake (REJECT_AFTER_TIME)
+const int64_t kSessionLifetimeSeconds = 180;
+
+struct LinkRequest {
+    nlmsghdr header;
+    ifinfomsg info;
+};
+
+int64_t unixSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string base64(const char* data, size_t length) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string text;
+    text.reserve((length + 2) / 3 * 4);
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t chunk = static_cast<uint8_t>(data[i]) << 16;
+        if (i + 1 < length) {
+            chunk |= static_cast<uint8_t>(data[i + 1]) << 8;
+        }
+        if (i + 2 < length) {
+            chunk |= static_cast<uint8_t>(data[i + 2]);
+        }
+        text += kAlphabet[(chunk >> 18) & 0x3F];
+        text += kAlphabet[(chunk >> 12) & 0x3F];
+        text += i + 1 < length ? kAlphabet[(chunk >> 6) & 0x3F] : '=';
+        text += i + 2 < length ? kAlphabet[chunk & 0x3F] : '=';
+    }
+    return text;
+}
+
+// "address:port" of a WGPEER_A_ENDPOINT sockaddr, "[address]:port" for IPv6
+std::string endpointText(const char* data, size_t length) {
+    char address[INET6_ADDRSTRLEN] = "";
+    if (length >= sizeof(sockaddr_in6)) {
+        sockaddr_in6 peer;
+        std::memcpy(&peer, data, sizeof(peer));
+        if (peer.sin6_family == AF_INET6 && inet_ntop(AF_INET6, &peer.sin6_addr, address, sizeof(address))) {
+            return std::string("[") + address + "]:" + std::to_string(ntohs(peer.sin6_port));
+        }
+    }
+    if (length >= sizeof(sockaddr_in)) {
+        sockaddr_in peer;
+        std::memcpy(&peer, data, sizeof(peer));
+        if (peer.sin_family == AF_INET && inet_ntop(AF_INET, &peer.sin_addr, address, sizeof(address))) {
+            return std::string(address) + ":" + std::to_string(ntohs(peer.sin_port));
+        }
+    }
+    return "";
+}
+
+// "address/cidr" of one WGPEER_A_ALLOWEDIPS entry
+std::string allowedIpText(const char* data, size_t length) {
+    uint16_t family = 0;
+    const char* address = nullptr;
+    size_t address_length = 0;
+    int cidr = 0;
+    Netlink::forEachAttribute(data, length, [&](uint16_t type, const char* value, size_t size) {
+        if (type == WGALLOWEDIP_A_FAMILY && size >= sizeof(uint16_t)) {
+            std::memcpy(&family, value, sizeof(uint16_t));
+        } else if (type == WGALLOWEDIP_A_IPADDR) {
+            address = value;
+            address_length = size;
+        } else if (type == WGALLOWEDIP_A_CIDR_MASK && size >= 1) {
+            cidr = static_cast<uint8_t>(value[0]);
+        }
+    });
+
+    char text[INET6_ADDRSTRLEN] = "";
+    if (!address || (family == AF_INET && address_length < sizeof(in_addr)) ||
+        (family == AF_INET6 && address_length < sizeof(in6_addr)) ||
+        (family != AF_INET && family != AF_INET6) || !inet_ntop(family, address, text, sizeof(text))) {
+        return "";
+    }
+    return std::string(text) + "/" + std::to_string(cidr);
+}
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+bool startsWith(const std::string& text, const char* prefix) {
+    return text.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+} // namespace
+
+VpnMonitor::VpnMonitor(const ConfigLoader::VpnMonitorConfig& config, UpdateHandler on_update)
+    : config_(config), on_update_(std::move(on_update)), status_{{"tunnels", json::object()}} {
+    for (const auto& address : config_.openvpn_management) {
+        OpenvpnEndpoint endpoint;
+        endpoint.address = address;
+        endpoints_.push_back(std::move(endpoint));
+    }
+}
+
+VpnMonitor::~VpnMonitor() {
+    stop();
+}
+
+bool VpnMonitor::start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+
+    link_events_fd_ = Netlink::openSocket(NETLINK_ROUTE, RTMGRP_LINK);
+    route_fd_ = Netlink::openSocket(NETLINK_ROUTE);
+    genl_fd_ = Netlink::openSocket();
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (link_events_fd_ < 0 || route_fd_ < 0 || genl_fd_ < 0 || wake_fd_ < 0) {
+        BACKEND_LOG_ERROR("[VpnMonitor] Cannot open netlink sockets: " << std::strerror(errno));
+        for (int* fd : {&link_events_fd_, &route_fd_, &genl_fd_, &wake_fd_}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        return false;
+    }
+    timeval timeout{kCommandTimeoutMs / 1000, (kCommandTimeoutMs % 1000) * 1000};
+    setsockopt(route_fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(genl_fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    thread_ = std::thread(&VpnMonitor::run, this);
+    return true;
+}
+
+void VpnMonitor::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake();
+    thread_.join();
+
+    for (auto& endpoint : endpoints_) {
+        if (endpoint.fd >= 0) {
+            close(endpoint.fd);
+            endpoint.fd = -1;
+        }
+    }
+    for (int* fd : {&link_events_fd_, &route_fd_, &genl_fd_, &wake_fd_}) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+json VpnMonitor::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return status_;
+}
+
+void VpnMonitor::wake() {
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        // The counter is already non-zero; the loop wakes anyway
+    }
+}
+
+void VpnMonitor::run() {
+    listLinks();
+    refreshWireguard();
+    for (auto& endpoint : endpoints_) {
+        connectEndpoint(endpoint);
+    }
+    publish();
+
+    std::vector<pollfd> fds;
+    std::vector<OpenvpnEndpoint*> polled;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) {
+                return;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto next = now + std::chrono::seconds(1);
+        if (!devices_.empty()) {
+            next = std::min(next, refresh_at_);
+        }
+        fds.assign({{wake_fd_, POLLIN, 0}, {link_events_fd_, POLLIN, 0}});
+        polled.clear();
+        for (auto& endpoint : endpoints_) {
+            if (endpoint.fd >= 0) {
+                fds.push_back({endpoint.fd, static_cast<short>(endpoint.connecting ? POLLOUT : POLLIN), 0});
+                polled.push_back(&endpoint);
+            } else {
+                next = std::min(next, endpoint.retry_at);
+            }
+        }
+        int timeout_ms = static_cast<int>(std::max<int64_t>(
+            0, std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count()));
+
+        int ready = poll(fds.data(), fds.size(), timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            BACKEND_LOG_EVERY(LOG_ERROR, 60000, "[VpnMonitor] poll failed: " << std::strerror(errno));
+        } else if (ready > 0) {
+            if (fds[0].revents & POLLIN) {
+                uint64_t count;
+                if (read(wake_fd_, &count, sizeof(count)) < 0) {
+                    // Spurious wakeup
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                handleLinkEvents();
+            }
+            for (size_t i = 0; i < polled.size(); ++i) {
+                short revents = fds[i + 2].revents;
+                if (!revents) {
+                    continue;
+                }
+                if (polled[i]->connecting) {
+                    finishConnect(*polled[i]);
+                } else {
+                    receiveEndpoint(*polled[i]);
+                }
+            }
+        }
+
+        now = std::chrono::steady_clock::now();
+        if (!devices_.empty() && now >= refresh_at_) {
+            refreshWireguard();
+        }
+        for (auto& endpoint : endpoints_) {
+            if (endpoint.fd < 0 && now >= endpoint.retry_at) {
+                connectEndpoint(endpoint);
+            }
+        }
+        publish();
+    }
+}
+
+// Rebuilds the device table from a link dump, keeping what was read of
+// devices that are still there
+void VpnMonitor::listLinks() {
+    LinkRequest request{};
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(ifinfomsg));
+    request.header.nlmsg_type = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = sequence_++;
+    request.info.ifi_family = AF_UNSPEC;
+
+    std::map<int, WireguardDevice> listed;
+    int result = Netlink::transact(route_fd_, request, [this, &listed](const nlmsghdr* header) {
+        handleLink(header, listed);
+    });
+    if (result != 0) {
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[VpnMonitor] Listing links failed: " << std::strerror(-result));
+        return;
+    }
+
+    for (auto& entry : listed) {
+        auto known = devices_.find(entry.first);
+        if (known != devices_.end()) {
+            entry.second.listen_port = known->second.listen_port;
+            entry.second.public_key = std::move(known->second.public_key);
+            entry.second.peers = std::move(known->second.peers);
+            entry.second.error = std::move(known->second.error);
+        }
+    }
+    bool added = listed.size() > devices_.size();
+    devices_ = std::move(listed);
+    if (added) {
+        refresh_at_ = std::chrono::steady_clock::now();
+    }
+}
+
+void VpnMonitor::handleLinkEvents() {
+    bool relist = false;
+    std::vector<char> buffer(Netlink::kReceiveBufferSize);
+
+    for (;;) {
+        ssize_t length = recv(link_events_fd_, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                // Lost notifications; list the links again
+                relist = true;
+                continue;
+            }
+            break;
+        }
+
+        int remaining = static_cast<int>(length);
+        for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(buffer.data());
+             NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            handleLink(header, devices_);
+        }
+    }
+
+    if (relist) {
+        listLinks();
+    }
+}
+
+// Applies one RTM_NEWLINK or RTM_DELLINK to devices; links that are not
+// WireGuard devices are ignored
+void VpnMonitor::handleLink(const nlmsghdr* header, std::map<int, WireguardDevice>& devices) {
+    if ((header->nlmsg_type != RTM_NEWLINK && header->nlmsg_type != RTM_DELLINK) ||
+        header->nlmsg_len < NLMSG_LENGTH(sizeof(ifinfomsg))) {
+        return;
+    }
+    const ifinfomsg* info = static_cast<const ifinfomsg*>(NLMSG_DATA(header));
+
+    if (header->nlmsg_type == RTM_DELLINK) {
+        devices.erase(info->ifi_index);
+        return;
+    }
+
+    std::string name;
+    std::string kind;
+    Netlink::forEachMessageAttribute(header, sizeof(ifinfomsg), [&](uint16_t type, const char* data, size_t length) {
+        if (type == IFLA_IFNAME) {
+            name.assign(data, strnlen(data, length));
+        } else if (type == IFLA_LINKINFO) {
+            Netlink::forEachAttribute(data, length, [&](uint16_t field, const char* value, size_t size) {
+                if (field == IFLA_INFO_KIND) {
+                    kind.assign(value, strnlen(value, size));
+                }
+            });
+        }
+    });
+    if (kind != "wireguard") {
+        return;
+    }
+
+    bool added = devices.find(info->ifi_index) == devices.end();
+    WireguardDevice& device = devices[info->ifi_index];
+    device.name = name;
+    device.up = (info->ifi_flags & IFF_UP) != 0;
+    if (added && &devices == &devices_) {
+        // Show a new tunnel's peers without waiting for the next refresh
+        refresh_at_ = std::chrono::steady_clock::now();
+    }
+}
+
+void VpnMonitor::refreshWireguard() {
+    refresh_at_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.wireguard_refresh_ms);
+    if (devices_.empty()) {
+        return;
+    }
+
+    if (wireguard_family_ == 0) {
+        int result = Netlink::resolveFamily(genl_fd_, WG_GENL_NAME, sequence_++, wireguard_family_);
+        if (result != 0) {
+            wireguard_family_ = 0;
+            for (auto& entry : devices_) {
+                entry.second.error = std::string("WireGuard netlink family not available: ") + std::strerror(-result);
+            }
+            return;
+        }
+    }
+
+    for (auto& entry : devices_) {
+        readDevice(entry.first, entry.second);
+    }
+}
+
+// WG_CMD_GET_DEVICE is a dump: a device with many peers or allowed IPs
+// spans several messages, and a peer cut in two repeats its public key
+void VpnMonitor::readDevice(int index, WireguardDevice& device) {
+    Netlink::Request request;
+    Netlink::initRequest(request, wireguard_family_, WG_CMD_GET_DEVICE, NLM_F_DUMP, sequence_++);
+    Netlink::addU32(request, WGDEVICE_A_IFINDEX, static_cast<uint32_t>(index));
+
+    int listen_port = 0;
+    std::string public_key;
+    std::map<std::string, Peer> peers;
+    int result = Netlink::transact(genl_fd_, request, [&](const nlmsghdr* header) {
+        Netlink::forEachMessageAttribute(header, [&](uint16_t attribute, const char* data, size_t length) {
+            if (attribute == WGDEVICE_A_LISTEN_PORT && length >= sizeof(uint16_t)) {
+                uint16_t port;
+                std::memcpy(&port, data, sizeof(port));
+                listen_port = port;
+            } else if (attribute == WGDEVICE_A_PUBLIC_KEY && length == WG_KEY_LEN) {
+                public_key = base64(data, length);
+            } else if (attribute == WGDEVICE_A_PEERS) {
+                Netlink::forEachAttribute(data, length, [&](uint16_t, const char* peer_data, size_t peer_length) {
+                    std::string key;
+                    Peer parsed;
+                    Netlink::forEachAttribute(peer_data, peer_length, [&](uint16_t field, const char* value, size_t size) {
+                        switch (field) {
+                            case WGPEER_A_PUBLIC_KEY:
+                                if (size == WG_KEY_LEN) {
+                                    key = base64(value, size);
+                                }
+                                break;
+                            case WGPEER_A_ENDPOINT:
+                                parsed.endpoint = endpointText(value, size);
+                                break;
+                            case WGPEER_A_LAST_HANDSHAKE_TIME:
+                                // struct __kernel_timespec; seconds first
+                                parsed.last_handshake = static_cast<int64_t>(Netlink::readU64(value, size));
+                                break;
+                            case WGPEER_A_RX_BYTES:
+                                parsed.rx_bytes = Netlink::readU64(value, size);
+                                break;
+                            case WGPEER_A_TX_BYTES:
+                                parsed.tx_bytes = Netlink::readU64(value, size);
+                                break;
+                            case WGPEER_A_ALLOWEDIPS:
+                                Netlink::forEachAttribute(value, size, [&](uint16_t, const char* ip, size_t ip_length) {
+                                    std::string text = allowedIpText(ip, ip_length);
+                                    if (!text.empty()) {
+                                        parsed.allowed_ips.push_back(std::move(text));
+                                    }
+                                });
+                                break;
+                            default:
+                                break;
+                        }
+                    });
+                    if (key.empty()) {
+                        return;
+                    }
+                    auto existing = peers.find(key);
+                    if (existing == peers.end()) {
+                        peers.emplace(key, std::move(parsed));
+                    } else {
+                        existing->second.allowed_ips.insert(existing->second.allowed_ips.end(),
+                                                            parsed.allowed_ips.begin(), parsed.allowed_ips.end());
+                    }
+                });
+            }
+        });
+    });
+
+    if (result == -EPERM) {
+        device.error = "reading WireGuard devices needs CAP_NET_ADMIN";
+        return;
+    }
+    if (result != 0) {
+        if (result == -ENOENT || result == -EOPNOTSUPP) {
+            // The module was unloaded; resolve the family again next time
+            wireguard_family_ = 0;
+        }
+        device.error = std::string("reading ") + device.name + " failed: " + std::strerror(-result);
+        return;
+    }
+    device.listen_port = listen_port;
+    device.public_key = std::move(public_key);
+    device.peers = std::move(peers);
+    device.error.clear();
+}
+
+void VpnMonitor::connectEndpoint(OpenvpnEndpoint& endpoint) {
+    endpoint.retry_at = std::chrono::steady_clock::now() + kReconnectInterval;
+
+    sockaddr_storage address{};
+    socklen_t address_length = 0;
+    if (endpoint.address[0] == '/') {
+        sockaddr_un* unix_address = reinterpret_cast<sockaddr_un*>(&address);
+        if (endpoint.address.size() >= sizeof(unix_address->sun_path)) {
+            endpoint.error = "socket path too long";
+            return;
+        }
+        unix_address->sun_family = AF_UNIX;
+        std::memcpy(unix_address->sun_path, endpoint.address.c_str(), endpoint.address.size() + 1);
+        address_length = sizeof(sockaddr_un);
+    } else {
+        size_t colon = endpoint.address.rfind(':');
+        if (colon == std::string::npos || colon == 0) {
+            endpoint.error = "expected a socket path or host:port";
+            return;
+        }
+        std::string host = endpoint.address.substr(0, colon);
+        if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+        addrinfo hints{};
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_NUMERICSERV;
+        addrinfo* resolved = nullptr;
+        int status = getaddrinfo(host.c_str(), endpoint.address.c_str() + colon + 1, &hints, &resolved);
+        if (status != 0 || !resolved) {
+            endpoint.error = std::string("cannot resolve: ") + gai_strerror(status);
+            return;
+        }
+        std::memcpy(&address, resolved->ai_addr, resolved->ai_addrlen);
+        address_length = resolved->ai_addrlen;
+        freeaddrinfo(resolved);
+    }
+
+    endpoint.fd = socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (endpoint.fd < 0) {
+        endpoint.error = std::strerror(errno);
+        return;
+    }
+    if (connect(endpoint.fd, reinterpret_cast<sockaddr*>(&address), address_length) == 0) {
+        finishConnect(endpoint);
+    } else if (errno == EINPROGRESS) {
+        endpoint.connecting = true;
+    } else {
+        closeEndpoint(endpoint, std::strerror(errno));
+    }
+}
+
+void VpnMonitor::finishConnect(OpenvpnEndpoint& endpoint) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(endpoint.fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0) {
+        error = errno;
+    }
+    if (error != 0) {
+        closeEndpoint(endpoint, std::strerror(error));
+        return;
+    }
+    endpoint.connecting = false;
+    endpoint.error.clear();
+
+    // Pushes for state changes, the current state, then byte counters
+    std::string commands = "state on\nstate\nbytecount " + std::to_string(config_.bytecount_interval_seconds) + "\n";
+    if (send(endpoint.fd, commands.data(), commands.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(commands.size())) {
+        closeEndpoint(endpoint, "cannot send to the management interface");
+        return;
+    }
+    BACKEND_LOG_INFO("[VpnMonitor] Connected to OpenVPN management at " << endpoint.address);
+}
+
+void VpnMonitor::closeEndpoint(OpenvpnEndpoint& endpoint, const std::string& error) {
+    if (endpoint.fd >= 0) {
+        close(endpoint.fd);
+        endpoint.fd = -1;
+    }
+    if (endpoint.error != error) {
+        BACKEND_LOG_WARN("[VpnMonitor] OpenVPN management at " << endpoint.address << ": " << error);
+    }
+    endpoint.connecting = false;
+    endpoint.buffer.clear();
+    endpoint.retry_at = std::chrono::steady_clock::now() + kReconnectInterval;
+    endpoint.state = "UNREACHABLE";
+    endpoint.description.clear();
+    endpoint.local_ip.clear();
+    endpoint.remote_ip.clear();
+    endpoint.since = 0;
+    endpoint.rx_bytes = 0;
+    endpoint.tx_bytes = 0;
+    endpoint.error = error;
+}
+
+void VpnMonitor::receiveEndpoint(OpenvpnEndpoint& endpoint) {
+    char chunk[4096];
+    for (;;) {
+        ssize_t length = recv(endpoint.fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (length == 0) {
+            closeEndpoint(endpoint, "management connection closed");
+            return;
+        }
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                closeEndpoint(endpoint, std::strerror(errno));
+                return;
+            }
+            break;
+        }
+        endpoint.buffer.append(chunk, static_cast<size_t>(length));
+    }
+
+    size_t start = 0;
+    for (size_t end; (end = endpoint.buffer.find('\n', start)) != std::string::npos; start = end + 1) {
+        size_t line_end = end > start && endpoint.buffer[end - 1] == '\r' ? end - 1 : end;
+        handleLine(endpoint, endpoint.buffer.substr(start, line_end - start));
+    }
+    endpoint.buffer.erase(0, start);
+
+    // The password prompt has no line end
+    if (startsWith(endpoint.buffer, "ENTER PASSWORD:")) {
+        closeEndpoint(endpoint, "the management interface asks for a password");
+    } else if (endpoint.buffer.size() > kMaxLineLength) {
+        closeEndpoint(endpoint, "unexpected data on the management interface");
+    }
+}
+
+// Management lines: ">STATE:" and ">BYTECOUNT:" pushes, the reply to
+// "state" (a bare state line and END), SUCCESS/ERROR acknowledgements and
+// log or info pushes that are ignored
+void VpnMonitor::handleLine(OpenvpnEndpoint& endpoint, const std::string& line) {
+    if (startsWith(line, ">BYTECOUNT:")) {
+        // Bytes in, bytes out; a server reports per client instead
+        // (>BYTECOUNT_CLI) and is only followed by state
+        unsigned long long in = 0;
+        unsigned long long out = 0;
+        if (std::sscanf(line.c_str() + 11, "%llu,%llu", &in, &out) == 2) {
+            endpoint.rx_bytes = in;
+            endpoint.tx_bytes = out;
+        }
+    } else if (startsWith(line, ">STATE:")) {
+        setState(endpoint, line.substr(7));
+    } else if (startsWith(line, ">HOLD:")) {
+        endpoint.state = "HOLD";
+        endpoint.description = line.substr(6);
+    } else if (startsWith(line, ">FATAL:")) {
+        endpoint.error = line.substr(7);
+    } else if (!line.empty() && std::isdigit(static_cast<unsigned char>(line[0])) &&
+               line.find(',') != std::string::npos) {
+        setState(endpoint, line);
+    }
+}
+
+// "time,STATE,description,local ip,remote ip,..."
+void VpnMonitor::setState(OpenvpnEndpoint& endpoint, const std::string& fields) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;) {
+        size_t comma = fields.find(',', start);
+        parts.push_back(fields.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    if (parts.size() < 2 || parts[1].empty()) {
+        return;
+    }
+
+    endpoint.since = std::strtoll(parts[0].c_str(), nullptr, 10);
+    endpoint.state = parts[1];
+    endpoint.description = parts.size() > 2 ? parts[2] : "";
+    endpoint.local_ip = parts.size() > 3 ? parts[3] : "";
+    endpoint.remote_ip = parts.size() > 4 ? parts[4] : "";
+    endpoint.error.clear();
+}
+
+void VpnMonitor::publish() {
+    json value = toJson();
+    if (value == published_) {
+        return;
+    }
+    published_ = value;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_ = value;
+    }
+    if (on_update_) {
+        on_update_(value);
+    }
+}
+
+json VpnMonitor::toJson() const {
+    const int64_t now = unixSeconds();
+    json tunnels = json::object();
+
+    for (const auto& entry : devices_) {
+        const WireguardDevice& device = entry.second;
+        json peers = json::object();
+        uint64_t rx_bytes = 0;
+        uint64_t tx_bytes = 0;
+        bool any_connected = false;
+        for (const auto& peer_entry : device.peers) {
+            const Peer& peer = peer_entry.second;
+            bool connected = peer.last_handshake != 0 && now - peer.last_handshake < kSessionLifetimeSeconds;
+            any_connected = any_connected || connected;
+            rx_bytes += peer.rx_bytes;
+            tx_bytes += peer.tx_bytes;
+            peers[peer_entry.first] = {
+                {"endpoint", peer.endpoint},
+                {"last_handshake", peer.last_handshake},
+                {"connected", connected},
+                {"rx_bytes", peer.rx_bytes},
+                {"tx_bytes", peer.tx_bytes},
+                {"allowed_ips", peer.allowed_ips}
+            };
+        }
+
+        std::string state;
+        if (!device.up) {
+            state = "down";
+        } else if (device.peers.empty()) {
+            state = device.error.empty() ? "no_peers" : "unknown";
+        } else {
+            state = any_connected ? "connected" : "waiting";
+        }
+        tunnels[device.name] = {
+            {"type", "wireguard"},
+            {"interface", device.name},
+            {"state", state},
+            {"connected", any_connected && device.up},
+            {"rx_bytes", rx_bytes},
+            {"tx_bytes", tx_bytes},
+            {"listen_port", device.listen_port},
+            {"public_key", device.public_key},
+            {"peers", peers},
+            {"error", device.error}
+        };
+    }
+
+    for (const auto& endpoint : endpoints_) {
+        tunnels["openvpn:" + endpoint.address] = {
+            {"type", "openvpn"},
+            {"management", endpoint.address},
+            {"state", lowercase(endpoint.state)},
+            {"connected", endpoint.state == "CONNECTED"},
+            {"description", endpoint.description},
+            {"local_ip", endpoint.local_ip},
+            {"remote_ip", endpoint.remote_ip},
+            {"since", endpoint.since},
+            {"rx_bytes", endpoint.rx_bytes},
+            {"tx_bytes", endpoint.tx_bytes},
+            {"error", endpoint.error}
+        };
+    }
+
+    return json{{"tunnels", tunnels}};
+}
+
+} // namespace BackendDatalink
@@ -1,34 +1,116 @@
 #include "websocket_server.h"
+#include "ur-metrics/ur_metrics.hpp"
+#include "ur-trace/ur_trace.hpp"
+#include "backend_log.h"
 #include <iostream>
 #include <sstream>
 #include <chrono>
-#include <random>
+#include <vector>
+#include <future>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 
-WebSocketServer::WebSocketServer() : running_(false) {
+namespace {
+
+// Status sent to the connections drain() closes
+const websocketpp::close::status::value kCloseServiceRestart = 1012;
+
+// Listening sockets passed by systemd socket activation, one TCP and one
+// AF_UNIX at most. This is sd_listen_fds() without libsystemd: LISTEN_FDS
+// sockets from fd 3 on, meant for this process if LISTEN_PID says so. Read
+// once and cleared from the environment; start() listens on copies, so a
+// restart of the server finds them again.
+struct InheritedSockets {
+    int tcp = -1;
+    int tcp_family = AF_INET;
+    int local = -1;
+};
+
+const InheritedSockets& inheritedSockets() {
+    static const InheritedSockets sockets = [] {
+        InheritedSockets result;
+        const char* pid = std::getenv("LISTEN_PID");
+        const char* count = std::getenv("LISTEN_FDS");
+        if (pid && count && std::strtol(pid, nullptr, 10) == getpid()) {
+            long fds = std::strtol(count, nullptr, 10);
+            for (int fd = 3; fd < 3 + fds; ++fd) {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                struct sockaddr_storage address = {};
+                socklen_t length = sizeof(address);
+                int listening = 0;
+                socklen_t option_length = sizeof(listening);
+                if (getsockname(fd, reinterpret_cast<struct sockaddr*>(&address), &length) != 0 ||
+                    getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &option_length) != 0 || !listening) {
+                    continue;
+                }
+                if ((address.ss_family == AF_INET || address.ss_family == AF_INET6) && result.tcp < 0) {
+                    result.tcp = fd;
+                    result.tcp_family = address.ss_family;
+                } else if (address.ss_family == AF_UNIX && result.local < 0) {
+                    result.local = fd;
+                }
+            }
+        }
+        unsetenv("LISTEN_PID");
+        unsetenv("LISTEN_FDS");
+        unsetenv("LISTEN_FDNAMES");
+        return result;
+    }();
+    return sockets;
+}
+
+UrMetrics::Histogram& fanoutSeconds() {
+    static UrMetrics::Histogram& histogram = UrMetrics::Registry::instance().histogram(
+        "backend_ws_fanout_duration_seconds", "Time to encode and queue one broadcast or publish for every target");
+    return histogram;
+}
+
+UrMetrics::Histogram& fanoutTargets() {
+    static UrMetrics::Histogram& histogram = UrMetrics::Registry::instance().histogram(
+        "backend_ws_fanout_targets", "Connections a broadcast or publish was sent to",
+        {1, 2, 5, 10, 25, 50, 100, 250, 1000});
+    return histogram;
+}
+
+} // namespace
+
+WebSocketServer::WebSocketServer()
+    : running_(false),
+      paused_(false),
+      admission_closed_(false),
+      max_send_buffer_bytes_(1024 * 1024),
+      disconnect_slow_consumers_(false),
+      compression_enabled_(false),
+      compression_min_size_(0),
+      logging_enabled_(true),
+      messages_sent_(0),
+      messages_coalesced_(0),
+      messages_dropped_(0),
+      connections_evicted_(0),
+      max_connections_(100),
+      admitted_connections_(0),
+      idle_timeout_ms_(0),
+      max_message_elements_(10000),
+      connections_rejected_(0),
+      connections_timed_out_(0) {
     try {
         server_.set_access_channels(websocketpp::log::alevel::all);
         server_.clear_access_channels(websocketpp::log::alevel::frame_payload);
         
         server_.init_asio();
         
-        server_.set_open_handler([this](websocketpp::connection_hdl hdl) {
-            this->onOpen(hdl);
+        server_.set_validate_handler([this](websocketpp::connection_hdl hdl) {
+            return this->validateHandshake(hdl);
         });
         
-        server_.set_close_handler([this](websocketpp::connection_hdl hdl) {
-            this->onClose(hdl);
-        });
-        
-        server_.set_message_handler([this](websocketpp::connection_hdl hdl, message_ptr msg) {
-            this->onMessage(hdl, msg);
-        });
-        
-        server_.set_fail_handler([this](websocketpp::connection_hdl hdl) {
-            this->onError(hdl);
-        });
+        // Open, close, fail and message handlers are installed per
+        // connection in validateHandshake() so they carry the connection id
         
     } catch (const std::exception& e) {
-        std::cerr << "WebSocket server initialization error: " << e.what() << std::endl;
+        BACKEND_LOG_ERROR("WebSocket server initialization error: " << e.what());
         throw;
     }
 }
@@ -37,13 +119,24 @@ WebSocketServer::~WebSocketServer() {
     stop();
 }
 
-bool WebSocketServer::start(const ConfigLoader::WebSocketConfig& config) {
+bool WebSocketServer::start(const ConfigLoader::WebSocketConfig& config, bool caller_runs_io) {
     if (running_.load()) {
         log("Server is already running");
         return false;
     }
 
     config_ = config;
+    applyConfig(config_);
+    compression_enabled_ = config_.compression_enabled;
+    
+#ifdef HAVE_PERMESSAGE_DEFLATE
+    ws_config::permessage_deflate_type::offered().store(compression_enabled_);
+#else
+    if (compression_enabled_) {
+        log("Compression requested but this build has no permessage-deflate support");
+        compression_enabled_ = false;
+    }
+#endif
     
     try {
         log("Step 1: Setting reuse address");
@@ -52,43 +145,45 @@ bool WebSocketServer::start(const ConfigLoader::WebSocketConfig& config) {
         log("Step 2: Setting listen backlog");
         server_.set_listen_backlog(128);
         
-        log("Step 3: Creating endpoint for " + config_.host + ":" + std::to_string(config_.port));
-        // Bind to specific host and port
-        websocketpp::lib::asio::ip::tcp::endpoint endpoint;
-        if (config_.host == "0.0.0.0") {
-            // Bind to all interfaces
-            endpoint = websocketpp::lib::asio::ip::tcp::endpoint(
-                websocketpp::lib::asio::ip::tcp::v4(), config_.port);
-            log("Step 3a: Created IPv4 any address endpoint");
-        } else {
-            // Bind to specific host
-            log("Step 3b: Parsing host address: " + config_.host);
-            websocketpp::lib::asio::ip::address address = 
-                websocketpp::lib::asio::ip::address::from_string(config_.host);
-            endpoint = websocketpp::lib::asio::ip::tcp::endpoint(address, config_.port);
-            log("Step 3c: Created specific host endpoint");
-        }
-        
-        log("Step 4: Starting to listen on endpoint");
-        server_.listen(endpoint);
+        // Copied into each connection as it is created. A client that stalls
+        // in the opening or closing handshake, or stops answering pings, is
+        // dropped instead of holding its buffers and fan-out slot.
+        server_.set_open_handshake_timeout(config_.timeout_ms);
+        server_.set_close_handshake_timeout(config_.timeout_ms);
+        server_.set_pong_timeout(config_.pong_timeout_ms);
         
-        log("Step 5: Starting accept connections");
-        server_.start_accept();
+        if (!listen()) {
+            return false;
+        }
         
         log("Step 6: Setting running state to true");
         running_.store(true);
+        {
+            std::lock_guard<std::mutex> lock(paused_mutex_);
+            paused_.store(false);
+            held_updates_.clear();
+        }
+        scheduleFlush();
+        scheduleKeepalive();
         
-        log("Step 7: Starting server thread");
-        server_thread_ = std::thread([this]() {
-            try {
-                log("WebSocket server thread started");
-                server_.run();
-                log("WebSocket server thread finished");
-            } catch (const std::exception& e) {
-                log("WebSocket server thread error: " + std::string(e.what()));
-                running_.store(false);
-            }
-        });
+        // websocketpp's asio config wraps every connection's handlers in its
+        // own strand, so running the io_service on several threads keeps
+        // per-connection ordering while handshakes and frame parsing spread
+        // across cores. With caller_runs_io the caller's run() is one of them.
+        int spawned = caller_runs_io ? config_.io_threads - 1 : config_.io_threads;
+        log("Step 7: Starting " + std::to_string(spawned) + " server thread(s)");
+        for (int i = 0; i < spawned; ++i) {
+            server_threads_.emplace_back([this, i]() {
+                try {
+                    log("WebSocket server thread " + std::to_string(i) + " started");
+                    server_.run();
+                    log("WebSocket server thread " + std::to_string(i) + " finished");
+                } catch (const std::exception& e) {
+                    log("WebSocket server thread error: " + std::string(e.what()));
+                    running_.store(false);
+                }
+            });
+        }
         
         log("WebSocket server started on " + config_.host + ":" + std::to_string(config_.port));
         return true;
@@ -100,6 +195,112 @@ bool WebSocketServer::start(const ConfigLoader::WebSocketConfig& config) {
     }
 }
 
+void WebSocketServer::run() {
+    try {
+        log("WebSocket server running on the caller's thread");
+        server_.run();
+    } catch (const std::exception& e) {
+        log("WebSocket server thread error: " + std::string(e.what()));
+        running_.store(false);
+    }
+}
+
+// Steps 3 to 5 of start(), and again on resume()
+bool WebSocketServer::listen() {
+    log("Step 3: Creating endpoint for " + config_.host + ":" + std::to_string(config_.port));
+    // Bind to specific host and port
+    websocketpp::lib::asio::ip::tcp::endpoint endpoint;
+    if (config_.host == "0.0.0.0") {
+        // Bind to all interfaces
+        endpoint = websocketpp::lib::asio::ip::tcp::endpoint(
+            websocketpp::lib::asio::ip::tcp::v4(), config_.port);
+        log("Step 3a: Created IPv4 any address endpoint");
+    } else {
+        // Bind to specific host
+        log("Step 3b: Parsing host address: " + config_.host);
+        websocketpp::lib::asio::ip::address address = 
+            websocketpp::lib::asio::ip::address::from_string(config_.host);
+        endpoint = websocketpp::lib::asio::ip::tcp::endpoint(address, config_.port);
+        log("Step 3c: Created specific host endpoint");
+    }
+    
+    if (inheritedSockets().tcp >= 0 || config_.reuse_port) {
+        log("Step 4: Listening on " + std::string(inheritedSockets().tcp >= 0 ? "the socket passed by systemd"
+                                                                               : "a SO_REUSEPORT socket"));
+        if (!listenTcp(endpoint)) {
+            return false;
+        }
+    } else {
+        log("Step 4: Starting to listen on endpoint");
+        server_.listen(endpoint);
+        
+        log("Step 5: Starting accept connections");
+        server_.start_accept();
+    }
+    if ((!config_.unix_socket_path.empty() || inheritedSockets().local >= 0) &&
+        !listenUnix(config_.unix_socket_path)) {
+        if (tcp_acceptor_) {
+            tcp_acceptor_.reset();
+        } else {
+            server_.stop_listening();
+        }
+        return false;
+    }
+    return true;
+}
+
+// Closes every listener; established connections are left alone
+void WebSocketServer::stopListening() {
+    websocketpp::lib::asio::error_code ec;
+    if (tcp_acceptor_) {
+        tcp_acceptor_->close(ec);
+    } else {
+        server_.stop_listening(ec);
+    }
+    if (unix_acceptor_) {
+        unix_acceptor_->close(ec);
+    }
+}
+
+void WebSocketServer::pause() {
+    if (!running_.load() || paused_.exchange(true)) {
+        return;
+    }
+    runOnIoThread([this]() { stopListening(); });
+    BACKEND_LOG_INFO("[WebSocketServer] Paused with " << getConnectionCount() << " connection(s) kept open");
+}
+
+bool WebSocketServer::resume() {
+    if (!running_.load() || !paused_.load()) {
+        return false;
+    }
+    bool listening = false;
+    runOnIoThread([this, &listening]() {
+        try {
+            listening = listen();
+        } catch (const std::exception& e) {
+            log("Failed to listen again: " + std::string(e.what()));
+        }
+    });
+    
+    std::unordered_map<std::string, HeldUpdate> held;
+    {
+        std::lock_guard<std::mutex> lock(paused_mutex_);
+        paused_.store(false);
+        held.swap(held_updates_);
+    }
+    // The latest update per category; clients that see a sequence gap resync
+    for (const auto& update : held) {
+        if (update.second.raw) {
+            publish(update.first, update.second.payload);
+        } else {
+            publish(update.first, update.second.message);
+        }
+    }
+    BACKEND_LOG_INFO("[WebSocketServer] Resumed, " << held.size() << " held update(s) sent");
+    return listening;
+}
+
 void WebSocketServer::stop() {
     if (!running_.load()) {
         return;
@@ -108,10 +309,31 @@ void WebSocketServer::stop() {
     running_.store(false);
     
     try {
+        websocketpp::lib::asio::error_code ec;
+        if (unix_acceptor_) {
+            unix_acceptor_->close(ec);
+        }
+        if (tcp_acceptor_) {
+            tcp_acceptor_->close(ec);
+        }
         server_.stop();
         
-        if (server_thread_.joinable()) {
-            server_thread_.join();
+        for (auto& thread : server_threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        server_threads_.clear();
+        tcp_acceptor_.reset();
+        if (unix_acceptor_) {
+            unix_acceptor_.reset();
+            // Unless a process started since has bound the path again
+            struct stat file;
+            if (unix_socket_inode_ && ::stat(config_.unix_socket_path.c_str(), &file) == 0 &&
+                file.st_ino == unix_socket_inode_) {
+                ::unlink(config_.unix_socket_path.c_str());
+            }
+            unix_socket_inode_ = 0;
         }
         
         log("WebSocket server stopped");
@@ -120,36 +342,251 @@ void WebSocketServer::stop() {
     }
 }
 
-void WebSocketServer::onOpen(websocketpp::connection_hdl hdl) {
+bool WebSocketServer::listenUnix(const std::string& path) {
+    using local = websocketpp::lib::asio::local::stream_protocol;
+    
+    websocketpp::lib::asio::error_code ec;
+    unix_acceptor_.reset(new local::acceptor(server_.get_io_service()));
+    if (inheritedSockets().local >= 0) {
+        int fd = fcntl(inheritedSockets().local, F_DUPFD_CLOEXEC, 3);
+        unix_acceptor_->assign(local(), fd, ec);
+        if (ec && fd >= 0) {
+            ::close(fd);
+        }
+        if (!ec) {
+            log("Also accepting on the unix socket passed by systemd");
+            acceptUnix();
+            return true;
+        }
+    } else {
+        // A socket file left by an earlier run would make bind() fail; one
+        // of a process still draining is replaced, it keeps its clients
+        ::unlink(path.c_str());
+        unix_acceptor_->open(local(), ec);
+        if (!ec) {
+            unix_acceptor_->bind(local::endpoint(path), ec);
+        }
+        if (!ec) {
+            unix_acceptor_->listen(128, ec);
+        }
+    }
+    if (ec) {
+        log("Failed to listen on unix:" + path + ": " + ec.message());
+        unix_acceptor_.reset();
+        return false;
+    }
+    
+    struct stat file;
+    unix_socket_inode_ = ::stat(path.c_str(), &file) == 0 ? file.st_ino : 0;
+    log("Also accepting on unix:" + path);
+    acceptUnix();
+    return true;
+}
+
+// Replaces websocketpp's listener when the socket comes from systemd or
+// needs SO_REUSEPORT, which websocketpp cannot set; accepted sockets are
+// started like websocketpp's own accepts
+bool WebSocketServer::listenTcp(const websocketpp::lib::asio::ip::tcp::endpoint& endpoint) {
+    using tcp = websocketpp::lib::asio::ip::tcp;
+    
+    websocketpp::lib::asio::error_code ec;
+    tcp_acceptor_.reset(new tcp::acceptor(server_.get_io_service()));
+    const InheritedSockets& inherited = inheritedSockets();
+    if (inherited.tcp >= 0) {
+        int fd = fcntl(inherited.tcp, F_DUPFD_CLOEXEC, 3);
+        tcp_acceptor_->assign(inherited.tcp_family == AF_INET6 ? tcp::v6() : tcp::v4(), fd, ec);
+        if (ec && fd >= 0) {
+            ::close(fd);
+        }
+    } else {
+        tcp_acceptor_->open(endpoint.protocol(), ec);
+        if (!ec) {
+            tcp_acceptor_->set_option(tcp::acceptor::reuse_address(true), ec);
+        }
+        int enable = 1;
+        if (!ec && setsockopt(tcp_acceptor_->native_handle(), SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0) {
+            ec = websocketpp::lib::asio::error_code(errno, websocketpp::lib::asio::error::get_system_category());
+        }
+        if (!ec) {
+            tcp_acceptor_->bind(endpoint, ec);
+        }
+        if (!ec) {
+            tcp_acceptor_->listen(128, ec);
+        }
+    }
+    if (ec) {
+        log("Failed to listen on " + config_.host + ":" + std::to_string(config_.port) + ": " + ec.message());
+        tcp_acceptor_.reset();
+        return false;
+    }
+    
+    acceptTcp();
+    return true;
+}
+
+void WebSocketServer::acceptTcp() {
+    server::connection_ptr con = server_.get_connection();
+    if (!con) {
+        log("Cannot create a connection, no longer accepting");
+        return;
+    }
+    tcp_acceptor_->async_accept(con->get_raw_socket(), [this, con](const websocketpp::lib::asio::error_code& ec) {
+        if (ec == websocketpp::lib::asio::error::operation_aborted || !running_.load()) {
+            return;
+        }
+        if (ec) {
+            log("Accept error: " + ec.message());
+        } else {
+            con->start();
+        }
+        acceptTcp();
+    });
+}
+
+void WebSocketServer::drain(std::chrono::seconds window) {
+    if (!running_.load()) {
+        return;
+    }
+    auto deadline = std::chrono::steady_clock::now() + window;
+    
+    if (!paused_.load()) {
+        runOnIoThread([this]() { stopListening(); });
+    }
+    
+    std::vector<connection_hdl> handles;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        for (const auto& info : slots_) {
+            if (info.state == ConnectionInfo::State::Open) {
+                handles.push_back(info.hdl);
+            }
+        }
+    }
+    BACKEND_LOG_INFO("[WebSocketServer] Draining " << handles.size() << " connection(s) over " << window.count() << "s");
+    
+    std::chrono::milliseconds spacing(0);
+    if (!handles.empty()) {
+        spacing = std::chrono::duration_cast<std::chrono::milliseconds>(window / 2) / handles.size();
+    }
+    for (const auto& hdl : handles) {
+        websocketpp::lib::error_code ec;
+        server_.close(hdl, kCloseServiceRestart, "Service restart", ec);
+        std::this_thread::sleep_for(spacing);
+    }
+    while (getConnectionCount() > 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    
+    stop();
+}
+
+void WebSocketServer::runOnIoThread(const std::function<void()>& fn) {
+    std::promise<void> done;
+    server_.set_timer(0, [&fn, &done](const websocketpp::lib::error_code&) {
+        fn();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+// websocketpp's transport only knows TCP sockets, but it only ever reads and
+// writes them, so an accepted AF_UNIX descriptor is handed to a connection's
+// socket object and started like a TCP accept would be
+void WebSocketServer::acceptUnix() {
+    using local = websocketpp::lib::asio::local::stream_protocol;
+    
+    auto socket = std::make_shared<local::socket>(server_.get_io_service());
+    unix_acceptor_->async_accept(*socket, [this, socket](const websocketpp::lib::asio::error_code& ec) {
+        if (ec == websocketpp::lib::asio::error::operation_aborted || !running_.load()) {
+            return;
+        }
+        if (ec) {
+            log("Unix socket accept error: " + ec.message());
+        } else {
+            // asio 1.10 cannot release a descriptor from its socket
+            int fd = ::dup(socket->native_handle());
+            websocketpp::lib::asio::error_code assign_ec;
+            socket->close(assign_ec);
+            
+            server::connection_ptr con = fd >= 0 ? server_.get_connection() : server::connection_ptr();
+            if (con) {
+                con->get_raw_socket().assign(websocketpp::lib::asio::ip::tcp::v4(), fd, assign_ec);
+            }
+            if (con && !assign_ec) {
+                con->start();
+            } else {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+                log("Dropped unix socket connection");
+            }
+        }
+        acceptUnix();
+    });
+}
+
+void WebSocketServer::applyConfig(const ConfigLoader::WebSocketConfig& config) {
+    logging_enabled_.store(config.enable_logging);
+    max_send_buffer_bytes_.store(static_cast<size_t>(config.max_send_buffer_kb) * 1024);
+    disconnect_slow_consumers_.store(config.slow_consumer_policy == "disconnect");
+    compression_min_size_.store(static_cast<size_t>(config.compression_min_size_bytes));
+    max_connections_.store(static_cast<size_t>(config.max_connections));
+    idle_timeout_ms_.store(config.idle_timeout_ms);
+    max_message_elements_.store(static_cast<size_t>(config.max_message_elements));
+}
+
+void WebSocketServer::onOpen(websocketpp::connection_hdl hdl, BackendDatalink::ConnectionId connection_id) {
     auto con = server_.get_con_from_hdl(hdl);
-    std::string connection_id = generateConnectionId();
+    
+    // Hixie-76 clients send no version header and use a different framing
+    bool hybi_framing = !con->get_request_header("Sec-WebSocket-Version").empty();
+    
+    const std::string& subprotocol = con->get_subprotocol();
+    WireEncoding encoding = WireEncoding::Json;
+    if (subprotocol == "msgpack") {
+        encoding = WireEncoding::MessagePack;
+    } else if (subprotocol == "cbor") {
+        encoding = WireEncoding::Cbor;
+    }
     
     {
         std::lock_guard<std::mutex> lock(connections_mutex_);
-        connections_[hdl] = connection_id;
+        ConnectionInfo* info = findLocked(connection_id);
+        if (!info || info->state != ConnectionInfo::State::Handshake) {
+            return;
+        }
+        info->state = ConnectionInfo::State::Open;
+        info->hdl = hdl;
+        info->hybi_framing = hybi_framing;
+        info->encoding = encoding;
+        info->last_activity = std::chrono::steady_clock::now();
+        open_connections_++;
     }
     
-    log("Client connected: " + connection_id + " from " + con->get_remote_endpoint());
+    BACKEND_LOG_DEBUG("[WebSocketServer] Client connected: " << BackendDatalink::connectionIdString(connection_id)
+                      << " from " << con->get_remote_endpoint());
     
     if (connection_open_handler_) {
         connection_open_handler_(connection_id);
     }
 }
 
-void WebSocketServer::onClose(websocketpp::connection_hdl hdl) {
-    std::string connection_id;
+// Also for connections a failed send already took out of the fan-out, so
+// the close handler sees every connection the open handler saw
+void WebSocketServer::onClose(BackendDatalink::ConnectionId connection_id) {
+    bool known = false;
     
     {
         std::lock_guard<std::mutex> lock(connections_mutex_);
-        auto it = connections_.find(hdl);
-        if (it != connections_.end()) {
-            connection_id = it->second;
-            connections_.erase(it);
+        ConnectionInfo* info = findLocked(connection_id);
+        if (info) {
+            known = info->state != ConnectionInfo::State::Handshake;
+            releaseSlotLocked(*info);
         }
     }
     
-    if (!connection_id.empty()) {
-        log("Client disconnected: " + connection_id);
+    if (known) {
+        BACKEND_LOG_DEBUG("[WebSocketServer] Client disconnected: " << BackendDatalink::connectionIdString(connection_id));
         
         if (connection_close_handler_) {
             connection_close_handler_(connection_id);
@@ -157,136 +594,782 @@ void WebSocketServer::onClose(websocketpp::connection_hdl hdl) {
     }
 }
 
-void WebSocketServer::onMessage(websocketpp::connection_hdl hdl, message_ptr msg) {
-    std::string connection_id;
+void WebSocketServer::onMessage(BackendDatalink::ConnectionId connection_id, message_ptr msg) {
+    WireEncoding encoding = WireEncoding::Json;
     
     {
         std::lock_guard<std::mutex> lock(connections_mutex_);
-        auto it = connections_.find(hdl);
-        if (it != connections_.end()) {
-            connection_id = it->second;
+        ConnectionInfo* info = findOpenLocked(connection_id);
+        if (!info) {
+            BACKEND_LOG_DEBUG("[WebSocketServer] Received message from unknown connection");
+            return;
         }
+        encoding = info->encoding;
+        info->last_activity = std::chrono::steady_clock::now();
     }
     
-    if (connection_id.empty()) {
-        log("Received message from unknown connection");
+    if (msg->get_opcode() != websocketpp::frame::opcode::text && encoding == WireEncoding::Json) {
+        BACKEND_LOG_DEBUG("[WebSocketServer] Received binary message from "
+                          << BackendDatalink::connectionIdString(connection_id));
         return;
     }
     
-    try {
-        if (msg->get_opcode() == websocketpp::frame::opcode::text) {
-            json message = json::parse(msg->get_payload());
-            log("Received message from " + connection_id + ": " + message.dump());
-            
-            if (message_handler_) {
-                message_handler_(connection_id, message);
-            }
-        } else {
-            log("Received binary message from " + connection_id);
-        }
-    } catch (const json::parse_error& e) {
-        log("JSON parse error from " + connection_id + ": " + std::string(e.what()));
-        
+    // Routing fields come from one SAX pass; the tree is only built if the
+    // handler asks for body(), and then in the thread's arena, released in
+    // one go when the scope closes
+    BackendDatalink::MessageArena::Scope arena_scope;
+    BackendDatalink::InboundMessage message(msg->get_payload(),
+        msg->get_opcode() == websocketpp::frame::opcode::text ? WireEncoding::Json : encoding);
+    
+    const char* error = nullptr;
+    switch (message.scan(max_message_elements_.load(std::memory_order_relaxed))) {
+    case BackendDatalink::InboundMessage::ScanResult::Ok:
+        break;
+    case BackendDatalink::InboundMessage::ScanResult::Malformed:
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[WebSocketServer] Malformed message from "
+                          << BackendDatalink::connectionIdString(connection_id));
+        error = "Invalid JSON format";
+        break;
+    case BackendDatalink::InboundMessage::ScanResult::TooLarge:
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[WebSocketServer] Message from "
+                          << BackendDatalink::connectionIdString(connection_id) << " exceeds "
+                          << max_message_elements_.load(std::memory_order_relaxed) << " elements");
+        error = "Message too large";
+        break;
+    }
+    
+    if (error) {
         json error_response = {
             {"type", "error"},
-            {"message", "Invalid JSON format"},
+            {"message", error},
             {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
                 std::chrono::system_clock::now().time_since_epoch()).count()}
         };
         
-        try {
-            server_.send(hdl, error_response.dump(), websocketpp::frame::opcode::text);
-        } catch (...) {
-            log("Failed to send error response to " + connection_id);
+        // In the connection's own codec, like every other reply
+        sendToClient(connection_id, error_response);
+        return;
+    }
+    
+    BACKEND_LOG_DEBUG("[WebSocketServer] Received " << (message.type().empty() ? "untyped" : message.type())
+                      << " message from " << BackendDatalink::connectionIdString(connection_id) << " ("
+                      << message.payloadSize() << " bytes, " << message.elementCount() << " elements)");
+    
+    try {
+        if (message_handler_) {
+            message_handler_(connection_id, message);
         }
     } catch (const std::exception& e) {
-        log("Error handling message from " + connection_id + ": " + std::string(e.what()));
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[WebSocketServer] Error handling message from "
+                          << BackendDatalink::connectionIdString(connection_id) << ": " << e.what());
     }
 }
 
-void WebSocketServer::onError(websocketpp::connection_hdl hdl) {
-    std::string connection_id;
+void WebSocketServer::onError(BackendDatalink::ConnectionId connection_id) {
+    bool known = false;
     
     {
         std::lock_guard<std::mutex> lock(connections_mutex_);
-        auto it = connections_.find(hdl);
-        if (it != connections_.end()) {
-            connection_id = it->second;
-            connections_.erase(it);
+        ConnectionInfo* info = findLocked(connection_id);
+        if (info) {
+            known = info->state != ConnectionInfo::State::Handshake;
+            releaseSlotLocked(*info);
         }
     }
     
-    if (!connection_id.empty()) {
-        log("Connection error for " + connection_id);
+    if (known) {
+        BACKEND_LOG_DEBUG("[WebSocketServer] Connection error for " << BackendDatalink::connectionIdString(connection_id));
+    }
+}
+
+void WebSocketServer::onPong(BackendDatalink::ConnectionId connection_id) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    ConnectionInfo* info = findOpenLocked(connection_id);
+    if (info) {
+        info->last_activity = std::chrono::steady_clock::now();
+    }
+}
+
+void WebSocketServer::onPongTimeout(connection_hdl hdl, BackendDatalink::ConnectionId connection_id) {
+    websocketpp::lib::error_code ec;
+    server_.close(hdl, websocketpp::close::status::going_away, "Pong timeout", ec);
+    connections_timed_out_++;
+    BACKEND_LOG_DEBUG("[WebSocketServer] Pong timeout for " << BackendDatalink::connectionIdString(connection_id));
+}
+
+ConnectionInfo* WebSocketServer::findLocked(BackendDatalink::ConnectionId connection_id) {
+    uint32_t slot = BackendDatalink::connectionSlot(connection_id);
+    if (slot >= slots_.size() || slots_[slot].id != connection_id || connection_id == BackendDatalink::kNoConnection) {
+        return nullptr;
+    }
+    return &slots_[slot];
+}
+
+ConnectionInfo* WebSocketServer::findOpenLocked(BackendDatalink::ConnectionId connection_id) {
+    ConnectionInfo* info = findLocked(connection_id);
+    return info && info->state == ConnectionInfo::State::Open ? info : nullptr;
+}
+
+BackendDatalink::ConnectionId WebSocketServer::reserveSlotLocked() {
+    uint32_t slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
     }
+    uint32_t serial = next_serial_++;
+    if (next_serial_ == 0) {
+        next_serial_ = 1;       // Keeps kNoConnection unused
+    }
+    ConnectionInfo& info = slots_[slot];
+    info.id = BackendDatalink::makeConnectionId(serial, slot);
+    info.state = ConnectionInfo::State::Handshake;
+    return info.id;
+}
+
+void WebSocketServer::releaseSlotLocked(ConnectionInfo& info) {
+    if (info.state == ConnectionInfo::State::Open) {
+        open_connections_--;
+    }
+    uint32_t slot = BackendDatalink::connectionSlot(info.id);
+    info = ConnectionInfo();    // Also frees what the parked snapshots held
+    free_slots_.push_back(slot);
+}
+
+int WebSocketServer::categoryBitLocked(const std::string& category, bool add) {
+    auto it = category_bits_.find(category);
+    if (it != category_bits_.end()) {
+        return it->second;
+    }
+    if (!add || category_bits_.size() >= kMaxCategories) {
+        return -1;
+    }
+    int bit = static_cast<int>(category_bits_.size());
+    category_bits_.emplace(category, bit);
+    return bit;
 }
 
 void WebSocketServer::broadcast(const json& message) {
-    std::string message_str = message.dump();
-    
+    if (paused_.load()) {
+        messages_dropped_++;
+        return;
+    }
+    UR_TRACE_SPAN("ws.broadcast");
+    Outbound outbound(message);
+    sendToTargets(snapshotAllTargets(), outbound);
+}
+
+void WebSocketServer::broadcast(const std::string& payload) {
+    if (paused_.load()) {
+        messages_dropped_++;
+        return;
+    }
+    UR_TRACE_SPAN("ws.broadcast");
+    Outbound outbound(payload);
+    sendToTargets(snapshotAllTargets(), outbound);
+}
+
+void WebSocketServer::publish(const std::string& category, const json& message) {
+    if (holdWhilePaused(category, HeldUpdate{message, std::string(), false})) {
+        return;
+    }
+    UR_TRACE_SPAN("ws.publish");
+    Outbound outbound(message);
+    sendToTargets(snapshotSubscribers(category), outbound, category);
+}
+
+void WebSocketServer::publish(const std::string& category, const std::string& payload) {
+    if (holdWhilePaused(category, HeldUpdate{json(), payload, true})) {
+        return;
+    }
+    UR_TRACE_SPAN("ws.publish");
+    Outbound outbound(payload);
+    sendToTargets(snapshotSubscribers(category), outbound, category);
+}
+
+// Keeps only the latest update per category while paused, unencoded
+bool WebSocketServer::holdWhilePaused(const std::string& category, HeldUpdate update) {
+    if (!paused_.load()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(paused_mutex_);
+    if (!paused_.load()) {
+        return false;     // resume() took the held updates meanwhile
+    }
+    auto result = held_updates_.insert_or_assign(category, std::move(update));
+    if (!result.second) {
+        messages_coalesced_++;
+    }
+    return true;
+}
+
+// Snapshot the connection list so no lock is held during I/O
+std::vector<WebSocketServer::SendTarget> WebSocketServer::snapshotAllTargets() {
+    std::vector<SendTarget> targets;
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    targets.reserve(open_connections_);
+    for (const auto& info : slots_) {
+        if (info.state == ConnectionInfo::State::Open) {
+            targets.push_back(makeTarget(info));
+        }
+    }
+    return targets;
+}
+
+std::vector<WebSocketServer::SendTarget> WebSocketServer::snapshotSubscribers(const std::string& category) {
+    std::vector<SendTarget> targets;
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    targets.reserve(open_connections_);
+    int bit = categoryBitLocked(category, false);
+    uint64_t mask = bit >= 0 ? uint64_t(1) << bit : 0;
+    for (const auto& info : slots_) {
+        if (info.state == ConnectionInfo::State::Open && (info.subscribe_all || (info.categories & mask))) {
+            targets.push_back(makeTarget(info));
+        }
+    }
+    return targets;
+}
+
+WebSocketServer::SendTarget WebSocketServer::makeTarget(const ConnectionInfo& info) {
+    return SendTarget{info.hdl, info.id, info.hybi_framing, info.encoding};
+}
+
+bool WebSocketServer::setSubscriptions(BackendDatalink::ConnectionId connection_id,
+                                       const std::vector<std::string>& categories) {
     std::lock_guard<std::mutex> lock(connections_mutex_);
     
-    for (auto it = connections_.begin(); it != connections_.end();) {
-        try {
-            server_.send(it->first, message_str, websocketpp::frame::opcode::text);
-            ++it;
-        } catch (const std::exception& e) {
-            log("Failed to send broadcast message to " + it->second + ": " + std::string(e.what()));
-            it = connections_.erase(it);
+    ConnectionInfo* info = findOpenLocked(connection_id);
+    if (!info) {
+        return false;
+    }
+    
+    info->subscribe_all = categories.empty();
+    info->categories = 0;
+    for (const auto& category : categories) {
+        int bit = categoryBitLocked(category, true);
+        if (bit < 0) {
+            BACKEND_LOG_EVERY(LOG_WARN, 1000, "[WebSocketServer] Over " << kMaxCategories
+                              << " categories, not subscribing to " << category);
+            continue;
         }
+        info->categories |= uint64_t(1) << bit;
+    }
+    return true;
+}
+
+// Already JSON: goes out as is to JSON connections
+WebSocketServer::Outbound::Outbound(const std::string& json_text) {
+    int index = static_cast<int>(WireEncoding::Json);
+    payloads[index] = json_text;
+    encoded[index] = true;
+}
+
+WebSocketServer::Outbound::Outbound(const std::string& payload, WireEncoding encoding)
+    : has_fixed_encoding(true), fixed_encoding(encoding) {
+    int index = static_cast<int>(encoding);
+    payloads[index] = payload;
+    encoded[index] = true;
+}
+
+WireEncoding WebSocketServer::Outbound::encodingFor(const SendTarget& target) const {
+    return has_fixed_encoding ? fixed_encoding : target.encoding;
+}
+
+namespace {
+
+std::string encodeMessage(const json& message, WireEncoding encoding) {
+    if (encoding == WireEncoding::MessagePack) {
+        std::vector<uint8_t> bytes = json::to_msgpack(message);
+        return std::string(bytes.begin(), bytes.end());
+    }
+    if (encoding == WireEncoding::Cbor) {
+        std::vector<uint8_t> bytes = json::to_cbor(message);
+        return std::string(bytes.begin(), bytes.end());
     }
+    return message.dump();
 }
 
-void WebSocketServer::sendToClient(const std::string& connection_id, const json& message) {
-    std::string message_str = message.dump();
-    websocketpp::connection_hdl target_hdl;
+} // namespace
+
+const std::string& SharedMessage::payload(WireEncoding encoding) const {
+    int index = static_cast<int>(encoding);
+    std::call_once(encoded_[index], [this, encoding, index]() {
+        payloads_[index] = encodeMessage(message_, encoding);
+    });
+    return payloads_[index];
+}
+
+const std::string& WebSocketServer::Outbound::payload(WireEncoding encoding) {
+    if (shared) {
+        return shared->payload(encoding);
+    }
+    int index = static_cast<int>(encoding);
+    if (!encoded[index] && !message && !has_fixed_encoding) {
+        // MessagePack/CBOR for JSON text; text that doesn't parse leaves
+        // the payload empty and those connections are skipped
+        parsed = json::parse(payloads[static_cast<int>(WireEncoding::Json)], nullptr, false);
+        if (!parsed.is_discarded()) {
+            message = &parsed;
+        }
+    }
+    if (!encoded[index] && message) {
+        payloads[index] = encodeMessage(*message, encoding);
+    }
+    encoded[index] = true;
+    return payloads[index];
+}
+
+void WebSocketServer::sendToTargets(const std::vector<SendTarget>& targets, Outbound& outbound,
+                                    const std::string& category) {
+    if (targets.empty()) {
+        return;
+    }
+    
+    std::vector<BackendDatalink::ConnectionId> failed;
     
     {
+        UrMetrics::ScopedTimer timer(fanoutSeconds());
+        for (const auto& target : targets) {
+            if (!sendWithBackpressure(target, outbound, category)) {
+                failed.push_back(target.id);
+            }
+        }
+    }
+    fanoutTargets().observe(static_cast<double>(targets.size()));
+    
+    // Out of the fan-out until the close handler frees the slot
+    if (!failed.empty()) {
         std::lock_guard<std::mutex> lock(connections_mutex_);
-        for (const auto& pair : connections_) {
-            if (pair.second == connection_id) {
-                target_hdl = pair.first;
-                break;
+        for (BackendDatalink::ConnectionId id : failed) {
+            ConnectionInfo* info = findOpenLocked(id);
+            if (info) {
+                info->state = ConnectionInfo::State::Gone;
+                info->pending.clear();
+                open_connections_--;
             }
         }
     }
+}
+
+// Sends unless the connection already has more than max_send_buffer_bytes_
+// queued in asio. Over the limit, category snapshots are parked (replacing any
+// older one for the same category) until the flush timer sees the socket
+// drain; everything else falls under the slow consumer policy. Dropped or
+// replaced deltas show up as a sequence gap on the client, which resyncs.
+// Returns false only on a send error, meaning the connection is gone.
+bool WebSocketServer::sendWithBackpressure(const SendTarget& target, Outbound& outbound,
+                                           const std::string& category) {
+    websocketpp::lib::error_code ec;
+    server::connection_ptr con = server_.get_con_from_hdl(target.hdl, ec);
+    if (ec || !con) {
+        return false;
+    }
     
-    if (target_hdl.lock()) {
-        try {
-            server_.send(target_hdl, message_str, websocketpp::frame::opcode::text);
-        } catch (const std::exception& e) {
-            log("Failed to send message to " + connection_id + ": " + std::string(e.what()));
+    WireEncoding encoding = outbound.encodingFor(target);
+    const std::string& payload = outbound.payload(encoding);
+    if (payload.empty() && encoding != WireEncoding::Json) {
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[WebSocketServer] Dropped a message that is not valid JSON for "
+                          << BackendDatalink::connectionIdString(target.id) << ", which expects binary frames");
+        messages_dropped_++;
+        return true;
+    }
+    
+    if (con->get_buffered_amount() + payload.size() > max_send_buffer_bytes_) {
+        if (!category.empty()) {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            ConnectionInfo* info = findOpenLocked(target.id);
+            if (info) {
+                auto result = info->pending.insert_or_assign(category, PendingMessage{payload, encoding});
+                if (!result.second) {
+                    messages_coalesced_++;
+                }
+            }
+            
+            if (!disconnect_slow_consumers_) {
+                return true;
+            }
+        } else {
+            messages_dropped_++;
+        }
+        
+        handleSlowConsumer(target);
+        return true;
+    }
+    
+    websocketpp::frame::opcode::value opcode = (encoding == WireEncoding::Json)
+        ? websocketpp::frame::opcode::text
+        : websocketpp::frame::opcode::binary;
+    
+    // Pre-framed messages bypass the extension and go out uncompressed
+    // (RSV1 clear), which RFC 7692 allows even after deflate was negotiated.
+    // Only payloads worth compressing take the per-connection framing path.
+    if (target.hybi_framing && !shouldCompress(payload.size())) {
+        int index = static_cast<int>(encoding);
+        if (!outbound.frames[index]) {
+            outbound.frames[index] = prepareFrame(payload, opcode);
         }
+        ec = con->send(outbound.frames[index]);
     } else {
-        log("Client not found: " + connection_id);
+        ec = con->send(payload, opcode);
+    }
+    
+    if (ec) {
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[WebSocketServer] Failed to send message to "
+                          << BackendDatalink::connectionIdString(target.id) << ": " << ec.message());
+        return false;
+    }
+    
+    messages_sent_++;
+    return true;
+}
+
+bool WebSocketServer::shouldCompress(size_t payload_size) const {
+    return compression_enabled_ && payload_size >= compression_min_size_;
+}
+
+void WebSocketServer::handleSlowConsumer(const SendTarget& target) {
+    if (!disconnect_slow_consumers_) {
+        return;
+    }
+    
+    websocketpp::lib::error_code ec;
+    server_.close(target.hdl, websocketpp::close::status::policy_violation, "Slow consumer", ec);
+    if (!ec) {
+        connections_evicted_++;
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[WebSocketServer] Evicted slow consumer "
+                          << BackendDatalink::connectionIdString(target.id));
+    }
+}
+
+void WebSocketServer::scheduleFlush() {
+    server_.set_timer(100, [this](const websocketpp::lib::error_code& ec) {
+        if (ec || !running_.load()) {
+            return;
+        }
+        flushPending();
+        scheduleFlush();
+    });
+}
+
+// Runs every ping interval, or every 5 s with pings off so an idle timeout
+// set by a reload still takes effect
+void WebSocketServer::scheduleKeepalive() {
+    long interval_ms = config_.ping_interval_ms > 0 ? config_.ping_interval_ms : 5000;
+    server_.set_timer(interval_ms, [this](const websocketpp::lib::error_code& ec) {
+        if (ec || !running_.load()) {
+            return;
+        }
+        sweepConnections();
+        scheduleKeepalive();
+    });
+}
+
+// Closes connections idle past idle_timeout_ms and pings the rest; a ping
+// left unanswered for pong_timeout_ms ends in onPongTimeout()
+void WebSocketServer::sweepConnections() {
+    int idle_timeout_ms = idle_timeout_ms_.load();
+    bool ping = config_.ping_interval_ms > 0;
+    if (!ping && idle_timeout_ms <= 0) {
+        return;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    std::vector<connection_hdl> idle;
+    std::vector<connection_hdl> live;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        for (const auto& info : slots_) {
+            if (info.state != ConnectionInfo::State::Open) {
+                continue;
+            }
+            if (idle_timeout_ms > 0 && now - info.last_activity > std::chrono::milliseconds(idle_timeout_ms)) {
+                idle.push_back(info.hdl);
+            } else if (ping && info.hybi_framing) {
+                live.push_back(info.hdl);
+            }
+        }
+    }
+    
+    for (const auto& hdl : idle) {
+        websocketpp::lib::error_code ec;
+        server_.close(hdl, websocketpp::close::status::going_away, "Idle timeout", ec);
+        connections_timed_out_++;
+    }
+    for (const auto& hdl : live) {
+        websocketpp::lib::error_code ec;
+        server_.ping(hdl, std::string(), ec);
+    }
+}
+
+// Sends parked snapshots for connections whose buffer has drained
+void WebSocketServer::flushPending() {
+    struct Ready {
+        SendTarget target;
+        uint64_t epoch;
+        std::unordered_map<std::string, PendingMessage> pending;
+    };
+    std::vector<Ready> ready;
+    
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        for (auto& info : slots_) {
+            if (info.state != ConnectionInfo::State::Open || info.pending.empty()) {
+                continue;
+            }
+            
+            websocketpp::lib::error_code ec;
+            server::connection_ptr con = server_.get_con_from_hdl(info.hdl, ec);
+            if (ec || !con || con->get_buffered_amount() > max_send_buffer_bytes_ / 2) {
+                continue;
+            }
+            
+            ready.push_back(Ready{makeTarget(info), info.snapshot_epoch, std::move(info.pending)});
+            info.pending.clear();
+        }
+    }
+    
+    for (auto& entry : ready) {
+        for (const auto& pending : entry.pending) {
+            // A reply sent since they were taken may be newer; the rest are
+            // dropped, and any it didn't cover show up as a sequence gap
+            if (snapshotsSuperseded(entry.target.id, entry.epoch)) {
+                break;
+            }
+            Outbound outbound(pending.second.payload, pending.second.encoding);
+            if (!sendWithBackpressure(entry.target, outbound, pending.first)) {
+                break;
+            }
+        }
+    }
+}
+
+// True once a reply carrying full snapshots went to the connection after
+// epoch was read; what flushPending() took out before that is older
+bool WebSocketServer::snapshotsSuperseded(BackendDatalink::ConnectionId connection_id, uint64_t epoch) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    ConnectionInfo* info = findOpenLocked(connection_id);
+    return !info || info->snapshot_epoch != epoch;
+}
+
+SendQueueStats WebSocketServer::getSendQueueStats() const {
+    SendQueueStats stats;
+    stats.messages_sent = messages_sent_.load();
+    stats.messages_coalesced = messages_coalesced_.load();
+    stats.messages_dropped = messages_dropped_.load();
+    stats.connections_evicted = connections_evicted_.load();
+    stats.connections_rejected = connections_rejected_.load();
+    stats.connections_timed_out = connections_timed_out_.load();
+    return stats;
+}
+
+size_t WebSocketServer::getQueuedBytes() const {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    size_t bytes = 0;
+    for (const auto& info : slots_) {
+        if (info.state != ConnectionInfo::State::Open) {
+            continue;
+        }
+        // What get_con_from_hdl() does, which the endpoint only offers non-const
+        server::connection_ptr con = websocketpp::lib::static_pointer_cast<server::connection_type>(
+            info.hdl.lock());
+        if (con) {
+            bytes += con->get_buffered_amount();
+        }
+        for (const auto& pending : info.pending) {
+            bytes += pending.second.payload.size();
+        }
+    }
+    return bytes;
+}
+
+void WebSocketServer::sendToClient(BackendDatalink::ConnectionId connection_id, const json& message) {
+    SendTarget target;
+    
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        ConnectionInfo* info = findOpenLocked(connection_id);
+        if (!info) {
+            BACKEND_LOG_DEBUG("[WebSocketServer] Client not found: " << BackendDatalink::connectionIdString(connection_id));
+            return;
+        }
+        target = makeTarget(*info);
+    }
+    
+    Outbound outbound(message);
+    sendWithBackpressure(target, outbound, "");
+}
+
+// Same as above, but the encodings are shared with every other send of
+// this message
+void WebSocketServer::sendToClient(BackendDatalink::ConnectionId connection_id,
+                                   const std::shared_ptr<const SharedMessage>& message) {
+    if (!message) {
+        return;
+    }
+    SendTarget target;
+    
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        ConnectionInfo* info = findOpenLocked(connection_id);
+        if (!info) {
+            BACKEND_LOG_DEBUG("[WebSocketServer] Client not found: " << BackendDatalink::connectionIdString(connection_id));
+            return;
+        }
+        target = makeTarget(*info);
+        // A parked snapshot flushed after this reply would roll the client
+        // back to older data
+        if (!message->supersedes().empty()) {
+            info->snapshot_epoch++;
+        }
+        for (const auto& category : message->supersedes()) {
+            if (info->pending.erase(category) > 0) {
+                messages_coalesced_++;
+            }
+        }
     }
+    
+    Outbound outbound(*message);
+    sendWithBackpressure(target, outbound, "");
+}
+
+void WebSocketServer::sendBinaryToClient(BackendDatalink::ConnectionId connection_id, const std::string& payload,
+                                         const std::string& key) {
+    SendTarget target;
+    
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        ConnectionInfo* info = findOpenLocked(connection_id);
+        if (!info) {
+            BACKEND_LOG_DEBUG("[WebSocketServer] Client not found: " << BackendDatalink::connectionIdString(connection_id));
+            return;
+        }
+        target = makeTarget(*info);
+    }
+    
+    // Any fixed encoding other than JSON goes out with the binary opcode
+    Outbound outbound(payload, WireEncoding::MessagePack);
+    sendWithBackpressure(target, outbound, key);
+}
+
+size_t WebSocketServer::getConnectionCount() const {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    return open_connections_;
+}
+
+size_t WebSocketServer::getSubscriberCount(const std::string& category) const {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    auto it = category_bits_.find(category);
+    uint64_t mask = it != category_bits_.end() ? uint64_t(1) << it->second : 0;
+    size_t count = 0;
+    for (const auto& info : slots_) {
+        if (info.state == ConnectionInfo::State::Open && (info.subscribe_all || (info.categories & mask))) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Builds a complete unmasked RFC 6455 frame marked as prepared, so
+// connection::send() queues it as-is instead of copying and re-framing the
+// payload for every recipient.
+message_ptr WebSocketServer::prepareFrame(const std::string& payload, websocketpp::frame::opcode::value opcode) const {
+    typedef ws_config::message_type message_type;
+    typedef ws_config::con_msg_manager_type con_msg_manager_type;
+    
+    message_ptr frame = websocketpp::lib::make_shared<message_type>(
+        websocketpp::lib::make_shared<con_msg_manager_type>(), opcode, payload.size());
+    
+    websocketpp::frame::basic_header header(opcode, payload.size(), true, false);
+    websocketpp::frame::extended_header extended(payload.size());
+    
+    frame->set_header(websocketpp::frame::prepare_header(header, extended));
+    frame->set_payload(payload);
+    frame->set_prepared(true);
+    return frame;
 }
 
-std::string WebSocketServer::generateConnectionId() const {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(100000, 999999);
+// Admits the connection if admission is open and it fits under
+// max_connections (answering 503 otherwise), picks the wire encoding from the client's
+// Sec-WebSocket-Protocol offer, in the client's order of preference (clients
+// that offer none get JSON text), and reserves the connection's slot.
+bool WebSocketServer::validateHandshake(connection_hdl hdl) {
+    websocketpp::lib::error_code ec;
+    server::connection_ptr con = server_.get_con_from_hdl(hdl, ec);
+    if (ec || !con) {
+        return false;
+    }
     
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    if (admission_closed_.load()) {
+        con->set_status(websocketpp::http::status_code::service_unavailable);
+        connections_rejected_++;
+        BACKEND_LOG_EVERY(LOG_WARN, 1000, "[WebSocketServer] Rejected connection from "
+                          << con->get_remote_endpoint() << ", admission closed");
+        return false;
+    }
     
-    return "conn_" + std::to_string(timestamp) + "_" + std::to_string(dis(gen));
+    // Counting handshakes in progress too keeps a burst of them from
+    // overshooting the cap before any reaches onOpen()
+    size_t admitted = admitted_connections_.load();
+    do {
+        if (admitted >= max_connections_.load()) {
+            con->set_status(websocketpp::http::status_code::service_unavailable);
+            connections_rejected_++;
+            BACKEND_LOG_EVERY(LOG_WARN, 1000, "[WebSocketServer] Rejected connection from "
+                              << con->get_remote_endpoint() << ", " << admitted << " connections open");
+            return false;
+        }
+    } while (!admitted_connections_.compare_exchange_weak(admitted, admitted + 1));
+    
+    for (const auto& protocol : con->get_requested_subprotocols()) {
+        if (protocol == "json" || protocol == "msgpack" || protocol == "cbor") {
+            con->select_subprotocol(protocol, ec);
+            break;
+        }
+    }
+    
+    // Bind the remaining handlers to this connection's id
+    BackendDatalink::ConnectionId connection_id;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connection_id = reserveSlotLocked();
+    }
+    
+    con->set_open_handler([this, connection_id](websocketpp::connection_hdl h) {
+        this->onOpen(h, connection_id);
+    });
+    
+    // Exactly one of these runs for every admitted connection
+    con->set_close_handler([this, connection_id](websocketpp::connection_hdl) {
+        admitted_connections_--;
+        this->onClose(connection_id);
+    });
+    
+    con->set_fail_handler([this, connection_id](websocketpp::connection_hdl) {
+        admitted_connections_--;
+        this->onError(connection_id);
+    });
+    
+    con->set_pong_handler([this, connection_id](websocketpp::connection_hdl, std::string) {
+        this->onPong(connection_id);
+    });
+    
+    con->set_pong_timeout_handler([this, connection_id](websocketpp::connection_hdl h, std::string) {
+        this->onPongTimeout(h, connection_id);
+    });
+    
+    con->set_message_handler([this, connection_id](websocketpp::connection_hdl, message_ptr msg) {
+        this->onMessage(connection_id, msg);
+    });
+    
+    return true;
 }
 
+// Lifecycle messages; per-connection and per-message lines go straight to
+// BACKEND_LOG_DEBUG so they cost nothing at the default level
 void WebSocketServer::log(const std::string& message) const {
-    if (config_.enable_logging) {
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()) % 1000;
-        
-        std::tm tm = *std::localtime(&time_t);
-        
-        std::ostringstream oss;
-        oss << "[" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-        oss << "." << std::setfill('0') << std::setw(3) << ms.count() << "] ";
-        oss << "[WebSocketServer] " << message;
-        
-        std::cout << oss.str() << std::endl;
+    if (logging_enabled_.load(std::memory_order_relaxed)) {
+        BACKEND_LOG_INFO("[WebSocketServer] " << message);
     }
 }
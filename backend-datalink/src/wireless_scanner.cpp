@@ -0,0 +1,665 @@
+#include "wireless_scanner.h"
+#include "backend_log.h"
+#include "netlink_message.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <linux/nl80211.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace BackendDatalink {
+
+namespace {
+
+// How long a request or dump on the command socket may take
+const int kCommandTimeoutMs = 2000;
+
+const uint8_t kElementSsid = 0;
+const uint8_t kElementRsn = 48;
+const uint8_t kElementVendor = 221;
+const uint16_t kCapabilityPrivacy = 0x0010;
+
+int64_t unixSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t unixMilliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int channelFor(int frequency) {
+    if (frequency == 2484) {
+        return 14;
+    }
+    if (frequency >= 2412 && frequency <= 2472) {
+        return (frequency - 2407) / 5;
+    }
+    if (frequency >= 5955 && frequency <= 7115) {
+        return (frequency - 5950) / 5;
+    }
+    if (frequency >= 5000 && frequency < 5955) {
+        return (frequency - 5000) / 5;
+    }
+    return 0;
+}
+
+bool validUtf8(const std::string& text) {
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char byte = static_cast<unsigned char>(text[i]);
+        size_t extra;
+        if (byte < 0x80) {
+            if (byte < 0x20 || byte == 0x7F) {
+                return false;
+            }
+            extra = 0;
+        } else if ((byte & 0xE0) == 0xC0 && byte >= 0xC2) {
+            extra = 1;
+        } else if ((byte & 0xF0) == 0xE0) {
+            extra = 2;
+        } else if ((byte & 0xF8) == 0xF0 && byte <= 0xF4) {
+            extra = 3;
+        } else {
+            return false;
+        }
+        if (extra > text.size() - i - 1) {
+            return false;
+        }
+        for (size_t k = 1; k <= extra; ++k) {
+            if ((static_cast<unsigned char>(text[i + k]) & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        i += extra + 1;
+    }
+    return true;
+}
+
+// SSIDs are arbitrary bytes; anything that is not printable UTF-8 is
+// escaped the way iw prints it
+std::string ssidText(const char* data, size_t length) {
+    std::string ssid(data, length);
+    if (validUtf8(ssid)) {
+        return ssid;
+    }
+    std::string escaped;
+    for (unsigned char byte : ssid) {
+        if (byte >= 0x20 && byte < 0x7F && byte != '\\') {
+            escaped += static_cast<char>(byte);
+        } else {
+            char hex[5];
+            std::snprintf(hex, sizeof(hex), "\\x%02x", byte);
+            escaped += hex;
+        }
+    }
+    return escaped;
+}
+
+// RSN AKM suites (00-0F-AC:n) of one RSN element
+void rsnAkms(const uint8_t* data, size_t length, bool& psk, bool& sae, bool& enterprise, bool& owe) {
+    // Version, group cipher, pairwise cipher list, then the AKM list
+    size_t offset = 2 + 4;
+    if (offset + 2 > length) {
+        return;
+    }
+    size_t pairwise = data[offset] | (data[offset + 1] << 8);
+    offset += 2 + pairwise * 4;
+    if (offset + 2 > length) {
+        return;
+    }
+    size_t akms = data[offset] | (data[offset + 1] << 8);
+    offset += 2;
+    for (size_t i = 0; i < akms && offset + 4 <= length; ++i, offset += 4) {
+        if (data[offset] != 0x00 || data[offset + 1] != 0x0F || data[offset + 2] != 0xAC) {
+            continue;
+        }
+        switch (data[offset + 3]) {
+            case 2: case 6: psk = true; break;
+            case 8: case 9: case 24: sae = true; break;
+            case 1: case 3: case 5: case 11: case 12: case 13: enterprise = true; break;
+            case 18: owe = true; break;
+            default: break;
+        }
+    }
+}
+
+std::string securityOf(const uint8_t* elements, size_t length, uint16_t capability, std::string& ssid) {
+    bool rsn = false;
+    bool wpa = false;
+    bool psk = false;
+    bool sae = false;
+    bool enterprise = false;
+    bool owe = false;
+
+    size_t offset = 0;
+    while (offset + 2 <= length) {
+        uint8_t id = elements[offset];
+        uint8_t size = elements[offset + 1];
+        if (offset + 2 + size > length) {
+            break;
+        }
+        const uint8_t* body = elements + offset + 2;
+        if (id == kElementSsid) {
+            bool hidden = std::all_of(body, body + size, [](uint8_t byte) { return byte == 0; });
+            ssid = hidden ? "" : ssidText(reinterpret_cast<const char*>(body), size);
+        } else if (id == kElementRsn) {
+            rsn = true;
+            rsnAkms(body, size, psk, sae, enterprise, owe);
+        } else if (id == kElementVendor && size >= 4 && body[0] == 0x00 && body[1] == 0x50 &&
+                   body[2] == 0xF2 && body[3] == 0x01) {
+            wpa = true;
+        }
+        offset += 2 + size;
+    }
+
+    if (rsn) {
+        if (enterprise) {
+            return sae ? "WPA3-Enterprise" : "WPA2-Enterprise";
+        }
+        if (sae) {
+            return psk ? "WPA2/WPA3" : "WPA3";
+        }
+        if (owe) {
+            return "OWE";
+        }
+        return "WPA2";
+    }
+    if (wpa) {
+        return "WPA";
+    }
+    return (capability & kCapabilityPrivacy) ? "WEP" : "None";
+}
+
+} // namespace
+
+WirelessScanner::WirelessScanner(const ConfigLoader::WirelessScanConfig& config, UpdateHandler on_update)
+    : config_(config), on_update_(std::move(on_update)) {
+}
+
+WirelessScanner::~WirelessScanner() {
+    stop();
+}
+
+bool WirelessScanner::start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+
+    command_fd_ = Netlink::openSocket();
+    event_fd_ = Netlink::openSocket();
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    bool ready = command_fd_ >= 0 && event_fd_ >= 0 && wake_fd_ >= 0;
+    if (ready) {
+        timeval timeout{kCommandTimeoutMs / 1000, (kCommandTimeoutMs % 1000) * 1000};
+        setsockopt(command_fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ready = resolveFamily() &&
+                setsockopt(event_fd_, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &scan_group_, sizeof(scan_group_)) == 0;
+    }
+    if (!ready) {
+        BACKEND_LOG_ERROR("[WirelessScanner] nl80211 is not available: " << std::strerror(errno));
+        for (int* fd : {&command_fd_, &event_fd_, &wake_fd_}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+    }
+    thread_ = std::thread(&WirelessScanner::run, this);
+    return true;
+}
+
+void WirelessScanner::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    wake();
+    thread_.join();
+
+    for (int* fd : {&command_fd_, &event_fd_, &wake_fd_}) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+bool WirelessScanner::requestScan(bool force) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            throw std::runtime_error("Wireless scanner is not running");
+        }
+        if (scanning_) {
+            return false;
+        }
+        if (!force && last_scan_ != 0 &&
+            std::chrono::steady_clock::now() - last_scan_steady_ < std::chrono::seconds(config_.cache_ttl_seconds)) {
+            return false;
+        }
+        scan_requested_ = true;
+        scanning_ = true;
+    }
+    wake();
+    return true;
+}
+
+json WirelessScanner::getNetworks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return toJsonLocked();
+}
+
+// Looks up the nl80211 family id and its "scan" multicast group
+bool WirelessScanner::resolveFamily() {
+    std::map<std::string, uint32_t> groups;
+    int result = Netlink::resolveFamily(command_fd_, NL80211_GENL_NAME, sequence_++, family_, &groups);
+    if (result != 0) {
+        errno = -result;
+        return false;
+    }
+    scan_group_ = groups[NL80211_MULTICAST_GROUP_SCAN];
+    if (scan_group_ == 0) {
+        errno = ENOENT;
+        return false;
+    }
+    return true;
+}
+
+void WirelessScanner::wake() {
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        // Counter already pending; the loop wakes anyway
+    }
+}
+
+void WirelessScanner::run() {
+    // Seed the cache with what the kernel already knows; no scan needed
+    std::vector<Interface> interfaces = listInterfaces();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        interfaces_ = interfaces;
+    }
+    for (const auto& interface : interfaces) {
+        std::vector<Network> networks;
+        if (dumpResults(interface, networks)) {
+            replaceNetworks(interface, std::move(networks));
+        }
+    }
+    publish();
+
+    pollfd fds[2] = {
+        {wake_fd_, POLLIN, 0},
+        {event_fd_, POLLIN, 0}
+    };
+
+    for (;;) {
+        int timeout_ms = 1000;
+        bool requested;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) {
+                return;
+            }
+            requested = scan_requested_;
+            scan_requested_ = false;
+            if (scanning_ && !requested) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline_ - std::chrono::steady_clock::now()).count();
+                timeout_ms = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(left, timeout_ms)));
+            }
+        }
+
+        if (requested) {
+            startScan();
+            continue;
+        }
+
+        int ready = poll(fds, 2, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            BACKEND_LOG_EVERY(LOG_ERROR, 60000, "[WirelessScanner] poll failed: " << std::strerror(errno));
+        } else if (ready > 0) {
+            if (fds[0].revents & POLLIN) {
+                uint64_t count;
+                if (read(wake_fd_, &count, sizeof(count)) < 0) {
+                    // Spurious wakeup
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                handleEvents();
+            }
+        }
+
+        // Interfaces that never reported back keep the results they have
+        std::set<int> overdue;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (scanning_ && !pending_.empty() && std::chrono::steady_clock::now() >= deadline_) {
+                overdue = pending_;
+            }
+        }
+        for (int index : overdue) {
+            BACKEND_LOG_WARN("[WirelessScanner] Scan on interface " << index << " timed out");
+            finishScan(index);
+        }
+    }
+}
+
+void WirelessScanner::startScan() {
+    std::vector<Interface> interfaces = listInterfaces();
+    std::set<int> pending;
+    std::vector<Interface> failed;
+    std::string error;
+
+    for (const auto& interface : interfaces) {
+        int result = triggerScan(interface.index, true);
+        if (result == -EOPNOTSUPP || result == -EINVAL) {
+            // Driver without low priority scans
+            result = triggerScan(interface.index, false);
+        }
+        // EBUSY: a scan is already running there, and its results will do
+        if (result == 0 || result == -EBUSY) {
+            pending.insert(interface.index);
+            continue;
+        }
+        error = interface.name + ": " + (result == -EPERM ? std::string("scanning needs CAP_NET_ADMIN")
+                                                          : std::string(std::strerror(-result)));
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[WirelessScanner] Cannot scan on " << error);
+        failed.push_back(interface);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        interfaces_ = interfaces;
+        error_ = interfaces.empty() ? "No wireless interface" : error;
+        pending_ = pending;
+        deadline_ = std::chrono::steady_clock::now() + std::chrono::seconds(config_.scan_timeout_seconds);
+        if (pending.empty()) {
+            scanning_ = false;
+            last_scan_ = unixSeconds();
+            last_scan_steady_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    // Serve what the kernel has from other scans
+    for (const auto& interface : failed) {
+        std::vector<Network> networks;
+        if (dumpResults(interface, networks)) {
+            replaceNetworks(interface, std::move(networks));
+        }
+    }
+    publish();
+}
+
+void WirelessScanner::handleEvents() {
+    std::set<int> finished;
+    std::vector<char> buffer(Netlink::kReceiveBufferSize);
+
+    for (;;) {
+        ssize_t length = recv(event_fd_, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                // Lost notifications; refresh every interface
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto& interface : interfaces_) {
+                    finished.insert(interface.index);
+                }
+                continue;
+            }
+            break;
+        }
+
+        int remaining = static_cast<int>(length);
+        for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(buffer.data());
+             NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_type != family_ || header->nlmsg_len < NLMSG_LENGTH(GENL_HDRLEN)) {
+                continue;
+            }
+            uint8_t command = static_cast<const genlmsghdr*>(NLMSG_DATA(header))->cmd;
+            if (command != NL80211_CMD_NEW_SCAN_RESULTS && command != NL80211_CMD_SCAN_ABORTED) {
+                continue;
+            }
+            int index = 0;
+            Netlink::forEachMessageAttribute(header, [&index](uint16_t type, const char* data, size_t size) {
+                if (type == NL80211_ATTR_IFINDEX) {
+                    index = static_cast<int>(Netlink::readU32(data, size));
+                }
+            });
+            if (index > 0) {
+                finished.insert(index);
+            }
+        }
+    }
+
+    for (int index : finished) {
+        finishScan(index);
+    }
+}
+
+// Results for one interface are in (or it gave up): refresh its networks
+// and end the scan when it was the last one awaited
+void WirelessScanner::finishScan(int index) {
+    Interface interface;
+    if (findInterface(index, interface)) {
+        std::vector<Network> networks;
+        if (dumpResults(interface, networks)) {
+            replaceNetworks(interface, std::move(networks));
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.erase(index) > 0 && pending_.empty() && scanning_) {
+            scanning_ = false;
+            last_scan_ = unixSeconds();
+            last_scan_steady_ = std::chrono::steady_clock::now();
+        }
+    }
+    publish();
+}
+
+std::vector<WirelessScanner::Interface> WirelessScanner::listInterfaces() {
+    std::vector<Interface> interfaces;
+    Netlink::Request request;
+    Netlink::initRequest(request, family_, NL80211_CMD_GET_INTERFACE, NLM_F_DUMP, sequence_++);
+
+    int result = Netlink::transact(command_fd_, request, [this, &interfaces](const nlmsghdr* header) {
+        Interface interface;
+        uint32_t type = 0;
+        Netlink::forEachMessageAttribute(header, [&](uint16_t attribute, const char* data, size_t length) {
+            if (attribute == NL80211_ATTR_IFINDEX) {
+                interface.index = static_cast<int>(Netlink::readU32(data, length));
+            } else if (attribute == NL80211_ATTR_IFNAME) {
+                interface.name.assign(data, strnlen(data, length));
+            } else if (attribute == NL80211_ATTR_IFTYPE) {
+                type = Netlink::readU32(data, length);
+            }
+        });
+        bool wanted = config_.interface.empty() ? type == NL80211_IFTYPE_STATION : interface.name == config_.interface;
+        if (interface.index > 0 && wanted) {
+            interfaces.push_back(interface);
+        }
+    });
+    if (result != 0) {
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[WirelessScanner] Cannot list interfaces: " << std::strerror(-result));
+    }
+    return interfaces;
+}
+
+int WirelessScanner::triggerScan(int index, bool low_priority) {
+    Netlink::Request request;
+    Netlink::initRequest(request, family_, NL80211_CMD_TRIGGER_SCAN, NLM_F_ACK, sequence_++);
+    Netlink::addU32(request, NL80211_ATTR_IFINDEX, static_cast<uint32_t>(index));
+    if (low_priority) {
+        Netlink::addU32(request, NL80211_ATTR_SCAN_FLAGS, NL80211_SCAN_FLAG_LOW_PRIORITY);
+    }
+    return Netlink::transact(command_fd_, request, [](const nlmsghdr*) {});
+}
+
+bool WirelessScanner::dumpResults(const Interface& interface, std::vector<Network>& networks) {
+    Netlink::Request request;
+    Netlink::initRequest(request, family_, NL80211_CMD_GET_SCAN, NLM_F_DUMP, sequence_++);
+    Netlink::addU32(request, NL80211_ATTR_IFINDEX, static_cast<uint32_t>(interface.index));
+    int64_t now_ms = unixMilliseconds();
+
+    int result = Netlink::transact(command_fd_, request, [&](const nlmsghdr* header) {
+        Netlink::forEachMessageAttribute(header, [&](uint16_t attribute, const char* data, size_t length) {
+            if (attribute != NL80211_ATTR_BSS) {
+                return;
+            }
+            Network network;
+            network.interface = interface.name;
+            uint16_t capability = 0;
+            const uint8_t* elements = nullptr;
+            size_t elements_length = 0;
+            bool has_bssid = false;
+            uint32_t seen_ms_ago = 0;
+            Netlink::forEachAttribute(data, length, [&](uint16_t field, const char* value, size_t size) {
+                switch (field) {
+                    case NL80211_BSS_BSSID:
+                        if (size == 6) {
+                            char text[18];
+                            const uint8_t* mac = reinterpret_cast<const uint8_t*>(value);
+                            std::snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+                                          mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+                            network.bssid = text;
+                            has_bssid = true;
+                        }
+                        break;
+                    case NL80211_BSS_FREQUENCY:
+                        network.frequency = static_cast<int>(Netlink::readU32(value, size));
+                        break;
+                    case NL80211_BSS_CAPABILITY:
+                        if (size >= sizeof(uint16_t)) {
+                            std::memcpy(&capability, value, sizeof(uint16_t));
+                        }
+                        break;
+                    case NL80211_BSS_INFORMATION_ELEMENTS:
+                        elements = reinterpret_cast<const uint8_t*>(value);
+                        elements_length = size;
+                        break;
+                    case NL80211_BSS_SIGNAL_MBM:
+                        network.signal_dbm = static_cast<int32_t>(Netlink::readU32(value, size)) / 100;
+                        break;
+                    case NL80211_BSS_STATUS:
+                        network.associated = Netlink::readU32(value, size) == NL80211_BSS_STATUS_ASSOCIATED;
+                        break;
+                    case NL80211_BSS_SEEN_MS_AGO:
+                        seen_ms_ago = Netlink::readU32(value, size);
+                        break;
+                    default:
+                        break;
+                }
+            });
+            if (!has_bssid) {
+                return;
+            }
+            network.channel = channelFor(network.frequency);
+            network.security = securityOf(elements, elements ? elements_length : 0, capability, network.ssid);
+            network.last_seen = now_ms - seen_ms_ago;
+            networks.push_back(std::move(network));
+        });
+    });
+    if (result != 0) {
+        BACKEND_LOG_EVERY(LOG_WARN, 60000, "[WirelessScanner] Cannot read scan results of " << interface.name
+                          << ": " << std::strerror(-result));
+        return false;
+    }
+    return true;
+}
+
+// The dump is the kernel's whole list for the interface, so networks that
+// are missing from it have expired
+void WirelessScanner::replaceNetworks(const Interface& interface, std::vector<Network> networks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = networks_.begin(); it != networks_.end();) {
+        if (it->second.interface == interface.name) {
+            it = networks_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto& network : networks) {
+        // Seen by two interfaces: keep the stronger
+        auto existing = networks_.find(network.bssid);
+        if (existing == networks_.end() || existing->second.signal_dbm < network.signal_dbm) {
+            std::string bssid = network.bssid;
+            networks_[bssid] = std::move(network);
+        }
+    }
+}
+
+bool WirelessScanner::findInterface(int index, Interface& interface) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& candidate : interfaces_) {
+        if (candidate.index == index) {
+            interface = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WirelessScanner::publish() {
+    json value = getNetworks();
+    if (value == published_) {
+        return;
+    }
+    published_ = value;
+    if (on_update_) {
+        on_update_(value);
+    }
+}
+
+json WirelessScanner::toJsonLocked() const {
+    json interfaces = json::array();
+    for (const auto& interface : interfaces_) {
+        interfaces.push_back(interface.name);
+    }
+
+    json networks = json::object();
+    for (const auto& pair : networks_) {
+        const Network& network = pair.second;
+        networks[pair.first] = {
+            {"bssid", network.bssid},
+            {"ssid", network.ssid},
+            {"interface", network.interface},
+            {"frequency", network.frequency},
+            {"channel", network.channel},
+            {"signal_dbm", network.signal_dbm},
+            // Linear 0-100 over -100..-50 dBm, as NetworkManager shows it
+            {"signal", std::max(0, std::min(100, 2 * (network.signal_dbm + 100)))},
+            {"security", network.security},
+            {"associated", network.associated},
+            {"last_seen", network.last_seen}
+        };
+    }
+
+    return {
+        {"scanning", scanning_},
+        {"last_scan", last_scan_},
+        {"interfaces", std::move(interfaces)},
+        {"error", error_},
+        {"networks", std::move(networks)}
+    };
+}
+
+} // namespace BackendDatalink
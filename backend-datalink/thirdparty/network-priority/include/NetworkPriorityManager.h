@@ -9,9 +9,14 @@
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <unordered_map>
+#include <cstdint>
 #include "nlohmann/json.hpp"
 #include "ThreadManager.hpp"
 #include "database_manager.h"
+#include "RtnetlinkMonitor.h"
+#include "RouteProgrammer.h"
+#include "ReachabilityProber.h"
 
 // Network Interface data structure matching frontend
 struct NetworkInterface {
@@ -20,14 +25,15 @@ struct NetworkInterface {
     std::string ipAddress;
     std::string gateway;
     std::string netmask;
-    std::string status;        // "online" | "offline"
+    std::string status;        // "online" | "offline" (link state)
+    std::string reachability;  // "reachable" | "unreachable" | "unknown" (not probed)
     int metric;                // Route metric (lower = higher priority)
     int priority;              // User-defined priority order
     std::string type;          // "wired" | "wireless" | "vpn"
     int speed;                 // Interface speed in Mbps
     bool isDefault;            // Whether this is the default route
     
-    NetworkInterface() : metric(0), priority(0), speed(0), isDefault(false) {}
+    NetworkInterface() : reachability("unknown"), metric(0), priority(0), speed(0), isDefault(false) {}
 };
 
 // Routing Rule data structure matching frontend
@@ -45,20 +51,68 @@ struct RoutingRule {
     RoutingRule() : metric(0), priority(0) {}
 };
 
+// One step of a bulk routing change
+struct RoutingRuleOperation {
+    enum Kind { Add, Update, Delete };
+    
+    Kind kind;
+    std::string rule_id;       // Rule to update or delete
+    RoutingRule rule;          // New contents for add and update
+    
+    RoutingRuleOperation() : kind(Add) {}
+};
+
+struct RoutingRuleOperationResult {
+    bool success;
+    std::string rule_id;       // Id of the rule after the operation
+    std::string error;         // Why the operation (or the batch) failed
+    
+    RoutingRuleOperationResult() : success(false) {}
+};
+
 // Statistics structure matching frontend
 struct NetworkStatistics {
     int total;                 // Total interfaces
     int online;                // Online interfaces
     int offline;               // Offline interfaces
+    int reachable;             // Interfaces the internet answers through
     int activeRules;           // Active routing rules
     std::string lastUpdated;   // Last refresh timestamp
     
-    NetworkStatistics() : total(0), online(0), offline(0), activeRules(0) {}
+    NetworkStatistics() : total(0), online(0), offline(0), reachable(0), activeRules(0) {}
+};
+
+// Published view of the manager's data. Immutable once published; carries the
+// entries' JSON so readers don't convert them again.
+struct NetworkPrioritySnapshot {
+    uint64_t generation;
+    std::vector<NetworkInterface> interfaces;
+    std::vector<RoutingRule> rules;
+    NetworkStatistics statistics;
+    nlohmann::json interfaces_json;   // Array, same order as interfaces
+    nlohmann::json rules_json;        // Array, same order as rules
+    
+    NetworkPrioritySnapshot() : generation(0), interfaces_json(nlohmann::json::array()),
+                                rules_json(nlohmann::json::array()) {}
+};
+
+// Automatic failover: an uplink that loses its link, stops reaching the
+// internet or answers slower than max_latency_ms is moved below every
+// healthy uplink, and back once it stayed healthy for restore_hold_ms
+struct FailoverSettings {
+    bool enabled;
+    int restore_hold_ms;
+    int max_latency_ms;        // 0: latency does not count
+    
+    FailoverSettings() : enabled(false), restore_hold_ms(30000), max_latency_ms(0) {}
 };
 
 class NetworkPriorityManager {
 public:
     typedef std::function<void(const nlohmann::json&)> DataUpdateHandler;
+    // Current traffic of each interface (rates, errors, drops), as an object
+    // keyed by interface name
+    typedef std::function<nlohmann::json()> TrafficSource;
     
     NetworkPriorityManager();
     NetworkPriorityManager(DatabaseManager* db_manager);
@@ -75,8 +129,11 @@ public:
     bool restart();
     ThreadMgr::ThreadState getState() const;
     unsigned int getThreadId() const { return thread_id_; }
+    ThreadMgr::ThreadStats getThreadStats() const { return thread_manager_->getThreadStats(thread_id_); }
     
-    // Data access methods
+    // Data access methods. Readers load the latest snapshot and never wait on
+    // the collector or a routing change in progress.
+    std::shared_ptr<const NetworkPrioritySnapshot> getSnapshot() const;
     std::vector<NetworkInterface> getNetworkInterfaces() const;
     std::vector<RoutingRule> getRoutingRules() const;
     NetworkStatistics getStatistics() const;
@@ -87,77 +144,153 @@ public:
     bool addRoutingRule(const RoutingRule& rule);
     bool updateRoutingRule(const std::string& rule_id, const RoutingRule& rule);
     bool deleteRoutingRule(const std::string& rule_id);
+    // Applies the operations as one change: each is checked against the
+    // rules as the ones before it leave them, then the kernel is programmed
+    // in a single netlink batch and the database saved in one transaction.
+    // All or nothing; results has one entry per operation either way.
+    bool applyRoutingRuleOperations(const std::vector<RoutingRuleOperation>& operations,
+                                    std::vector<RoutingRuleOperationResult>& results);
     bool applyRoutingConfiguration();
     bool resetToDefaults();
     
     // Database operations
     bool initializeDatabaseTables();
     bool loadConfigurationFromDatabase();
+    // Writes the interfaces and static rules that changed since the last
+    // save in one transaction; does nothing when none did
     bool saveConfigurationToDatabase();
     
-    // WebSocket data push handler
+    // WebSocket data push handler. Receives interfaces and rules as objects
+    // keyed by id, so the dashboard merge patches carry only the entries that
+    // changed; it is not called when nothing changed since the last push.
     void setDataUpdateHandler(DataUpdateHandler handler) { data_update_handler_ = handler; }
     
+    // Adds a "traffic" object to each interface in getAllDataAsJson(). Read
+    // per request rather than stored in the snapshot, so live rates do not
+    // turn every collection into a change pushed to the dashboard.
+    void setTrafficSource(TrafficSource source) { traffic_source_ = std::move(source); }
+    
     // Collection control
     void forceDataCollection();
     void setPollInterval(int seconds);
+    // Stretches the netlink resync, and the poll interval when there is no
+    // event socket, by factor (1 for none), from the next collection. Kernel
+    // changes are still followed as they happen.
+    void setSlowdown(int factor);
+    // Internet reachability probing of the uplinks (interfaces with a
+    // default route); false when a target does not parse. From the next round.
+    bool setReachabilitySettings(const ReachabilityProber::Settings& settings);
+    // Live; disabling it moves demoted uplinks back to their priority
+    void setFailoverSettings(const FailoverSettings& settings);
+    // Name, CPUs and scheduling of the collection thread, from the next start()
+    void setThreadAttributes(const thread_attr_t& attr) { thread_attr_ = attr; }
 
 private:
     // Thread management
     std::unique_ptr<ThreadMgr::ThreadManager> thread_manager_;
     unsigned int thread_id_;
+    thread_attr_t thread_attr_{};
     std::atomic<bool> running_;
     int poll_interval_seconds_;
+    std::atomic<int> slowdown_{1};
     
-    // Data storage
+    // Data storage, written under data_mutex_. The indexes map interface
+    // names and rule ids to vector positions.
     mutable std::mutex data_mutex_;
     std::vector<NetworkInterface> network_interfaces_;
     std::vector<RoutingRule> routing_rules_;
     NetworkStatistics statistics_;
+    std::unordered_map<std::string, size_t> interface_index_;
+    std::unordered_map<std::string, size_t> rule_index_;
+    
+    // What readers see, swapped with std::atomic_store by publishSnapshot()
+    std::shared_ptr<const NetworkPrioritySnapshot> snapshot_;
+    uint64_t snapshot_generation_;
     
-    // Database
-    std::shared_ptr<DatabaseManager> db_manager_;
+    // Kernel link/address/route mirror (guarded by data_mutex_)
+    RtnetlinkMonitor netlink_monitor_;
+    RouteProgrammer route_programmer_;
+    static constexpr int kNetlinkResyncSeconds = 60; // Full dump even while events flow
+    static constexpr int kEventSettleMs = 20;        // Coalesces bursts of notifications
+    
+    // Per-uplink reachability; rounds start and end under data_mutex_, its
+    // sockets are polled with the event socket on the collection thread
+    ReachabilityProber reachability_prober_;
+    
+    // Failover state per uplink (guarded by data_mutex_). A demoted uplink's
+    // default route sits kDemotionPenalty above its priority; it stays
+    // installed, so flows and probes bound to the link keep working.
+    struct UplinkHealth {
+        bool demoted;
+        std::chrono::steady_clock::time_point healthy_since; // Epoch while unhealthy
+        
+        UplinkHealth() : demoted(false) {}
+    };
+    static constexpr int kDemotionPenalty = 10000;
+    FailoverSettings failover_settings_;
+    std::unordered_map<std::string, UplinkHealth> uplink_health_;
+    
+    // Database, owned by the caller
+    DatabaseManager* db_manager_;
     
     // Handlers
     DataUpdateHandler data_update_handler_;
+    TrafficSource traffic_source_;
+    
+    // Last state handed to data_update_handler_, used to skip unchanged pushes
+    std::mutex push_mutex_;
+    nlohmann::json last_pushed_;
+    uint64_t last_pushed_generation_;
     
     // Internal methods
     void collectionLoop();
+    bool waitForEvents(std::chrono::steady_clock::time_point deadline);
+    bool updateReachability();
+    bool evaluateFailover();
+    int targetMetric(const NetworkInterface& interface) const;
+    std::vector<std::string> uplinkNames() const;
     void collectAllData();
-    void collectNetworkInterfaces();
-    void collectRoutingRules();
+    void rebuildFromKernelState();
     void updateStatistics();
+    void reindex();
+    void publishSnapshot();
+    static std::string prefixToNetmask(int prefix_length);
     
-    // System command execution
-    std::string executeCommand(const std::string& command) const;
-    std::vector<std::string> parseIpRouteOutput() const;
-    std::vector<std::string> parseInterfaceList() const;
-    
-    // JSON parsing methods
-    NetworkInterface parseInterfaceFromJson(const nlohmann::json& iface_json) const;
-    void collectNetworkInterfacesFallback();
+    // Database helpers. The persisted maps hold the row last written or
+    // loaded per id (without last_updated); an entry is dirty when its
+    // current row differs, and a save writes only dirty or removed entries.
+    typedef std::vector<std::string> Row;
+    typedef std::unordered_map<std::string, Row> RowMap;
+    std::mutex persist_mutex_;
+    RowMap persisted_interfaces_;
+    RowMap persisted_rules_;
     
-    // Database helpers
     bool createNetworkPriorityTables();
-    bool saveInterfacesToDatabase();
-    bool saveRulesToDatabase();
     bool loadInterfacesFromDatabase();
     bool loadRulesFromDatabase();
+    void restoreConfiguration();
+    static Row interfaceRow(const NetworkInterface& interface);
+    static Row ruleRow(const RoutingRule& rule);
+    static void appendRowChanges(const RowMap& current, const RowMap& persisted,
+                                 const std::string& upsert_sql, const std::string& delete_sql,
+                                 const std::string& timestamp,
+                                 std::vector<DatabaseManager::Statement>& statements);
     
     // Routing operations
+    bool applyRoutingConfigurationLocked();
     bool applyInterfaceMetrics();
-    bool applyRoutingRules();
-    std::string generateRouteCommand(const RoutingRule& rule, bool add = true) const;
+    bool applyRoutingRules(const std::vector<RouteSpec>& replaced = std::vector<RouteSpec>());
+    void syncKernelState();
+    static RouteSpec toRouteSpec(const RoutingRule& rule);
+    static std::string ruleId(const std::string& destination, int metric);
     
     // Utility methods
-    std::string generateId() const;
     std::string getCurrentTimestamp() const;
     void log(const std::string& message) const;
-    void pushDataToFrontend() const;
+    void pushDataToFrontend();
+    static nlohmann::json buildPushState(const NetworkPrioritySnapshot& snapshot);
     
     // Data conversion
-    NetworkInterface parseInterfaceFromSystem(const std::string& interface_data) const;
-    RoutingRule parseRouteFromSystem(const std::string& route_data) const;
     nlohmann::json interfaceToJson(const NetworkInterface& interface) const;
     nlohmann::json ruleToJson(const RoutingRule& rule) const;
     nlohmann::json statisticsToJson(const NetworkStatistics& stats) const;
@@ -0,0 +1,110 @@
+#ifndef REACHABILITY_PROBER_H
+#define REACHABILITY_PROBER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <sys/socket.h>
+#include <poll.h>
+
+// Checks per uplink whether the internet answers through it. A round opens
+// one non-blocking TCP connect per interface and target, each socket bound
+// to its interface with SO_BINDTODEVICE, and the owner waits for all of them
+// in its own poll loop, so every uplink is checked within one timeout. A
+// SYN-ACK or RST from any target makes the interface good for the round.
+// The reported state flips only after down_after failed or up_after good
+// rounds in a row; the first round of an interface sets it directly.
+// Not thread-safe; the owner serializes access.
+class ReachabilityProber {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum class State { Unknown, Reachable, Unreachable };
+
+    struct Settings {
+        std::vector<std::string> targets;  // Numeric "address:port"; none disables probing
+        int interval_ms;                   // Start to start of rounds
+        int timeout_ms;                    // A probe not answered by then failed
+        int down_after;                    // Failed rounds before Unreachable
+        int up_after;                      // Good rounds before Reachable
+
+        Settings() : targets({"8.8.8.8:53", "1.1.1.1:53"}), interval_ms(5000), timeout_ms(1500),
+                     down_after(3), up_after(2) {}
+    };
+
+    struct Status {
+        State state;
+        double latency_ms;         // Fastest answer of the last round, -1 without one
+
+        Status() : state(State::Unknown), latency_ms(-1.0) {}
+    };
+
+    ReachabilityProber();
+    ~ReachabilityProber();
+
+    ReachabilityProber(const ReachabilityProber&) = delete;
+    ReachabilityProber& operator=(const ReachabilityProber&) = delete;
+
+    // False, keeping the current settings, when a target does not parse.
+    // Applies from the next round.
+    bool setSettings(const Settings& settings);
+    bool isEnabled() const { return !targets_.empty() && permitted_; }
+
+    bool roundDue(Clock::time_point now) const { return isEnabled() && !in_round_ && now >= next_round_; }
+    // Opens the round's sockets on the given interfaces; interfaces no
+    // longer listed are forgotten
+    void startRound(const std::vector<std::string>& interfaces, Clock::time_point now);
+    // When the owner must look again: the running round's deadline, or when
+    // the next round is due
+    Clock::time_point nextWakeup() const;
+
+    // The sockets of the running round, for the owner's poll(); handle the
+    // same array back. handlePollFds() returns true once every probe of the
+    // round settled.
+    void appendPollFds(std::vector<pollfd>& fds) const;
+    bool handlePollFds(const pollfd* fds, size_t count, Clock::time_point now);
+    // Ends the running round when every probe settled or its deadline
+    // passed. True when an interface's state changed.
+    bool finishRound(Clock::time_point now);
+
+    Status status(const std::string& interface) const;
+    static const char* toString(State state);
+
+private:
+    struct Target {
+        sockaddr_storage address;
+        socklen_t length;
+    };
+
+    struct Interface {
+        Status status;
+        int good_rounds;           // Consecutive, current streak
+        int failed_rounds;
+        double round_ms;           // Fastest answer of the running round, -1 without one
+
+        Interface() : good_rounds(0), failed_rounds(0), round_ms(-1.0) {}
+    };
+
+    struct Probe {
+        Interface* interface;      // unordered_map nodes do not move
+        int fd;
+    };
+
+    Settings settings_;
+    std::vector<Target> targets_;
+    bool permitted_;               // Cleared when SO_BINDTODEVICE is refused
+    std::unordered_map<std::string, Interface> interfaces_;
+    std::vector<Probe> probes_;    // Of the running round, fd -1 once settled
+    size_t pending_;
+    bool in_round_;
+    Clock::time_point round_started_;
+    Clock::time_point next_round_;
+
+    int openProbe(const std::string& interface, const Target& target);
+    void closeProbes();
+    static bool parseTarget(const std::string& name, Target& target);
+    void log(const std::string& message) const;
+};
+
+#endif // REACHABILITY_PROBER_H
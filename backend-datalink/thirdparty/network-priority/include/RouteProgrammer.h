@@ -0,0 +1,66 @@
+#ifndef ROUTE_PROGRAMMER_H
+#define ROUTE_PROGRAMMER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "RtnetlinkMonitor.h"
+
+// A route as the manager wants it in the kernel
+struct RouteSpec {
+    std::string destination;   // CIDR ("0.0.0.0/0" for default)
+    std::string gateway;       // Empty for a directly connected route
+    std::string interface;     // Output interface name
+    uint32_t metric;
+    uint32_t table;
+
+    RouteSpec();
+
+    // Same identity as RouteState::key()
+    std::string key() const;
+};
+
+struct RouteChange {
+    enum Action { Add, Delete };
+
+    Action action;
+    RouteSpec route;
+
+    RouteChange(Action change_action, const RouteSpec& change_route)
+        : action(change_action), route(change_route) {}
+};
+
+// Programs IPv4 routes over rtnetlink. A commit sends every change in one
+// batch (one sendmsg, one ack per message); if any change is rejected the
+// ones already applied are reverted, so the kernel ends up either fully
+// updated or unchanged.
+class RouteProgrammer {
+public:
+    // rtm_protocol of the routes this manager installs, so it never mistakes
+    // kernel, DHCP or administrator routes for its own
+    static constexpr unsigned char kManagedProtocol = 186;
+
+    RouteProgrammer();
+
+    bool commit(const std::vector<RouteChange>& changes, std::string& error);
+
+    // Changes that turn the managed routes of the current table into desired.
+    // Routes owned by other protocols are left alone.
+    static std::vector<RouteChange> diff(const std::vector<RouteSpec>& desired,
+                                         const std::map<std::string, RouteState>& current,
+                                         const std::map<int, LinkState>& links);
+
+    static RouteSpec fromState(const RouteState& route, const std::map<int, LinkState>& links);
+    static bool parseDestination(const std::string& cidr, std::string& network, int& prefix_length);
+
+private:
+    uint32_t sequence_;
+
+    // Sends the batch; failed receives the index of each rejected change
+    bool sendBatch(const std::vector<RouteChange>& changes, std::vector<size_t>& failed, std::string& error);
+    bool encode(const RouteChange& change, uint32_t sequence, std::vector<char>& buffer, std::string& error) const;
+    void log(const std::string& message) const;
+};
+
+#endif // ROUTE_PROGRAMMER_H
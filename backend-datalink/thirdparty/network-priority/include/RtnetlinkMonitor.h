@@ -0,0 +1,92 @@
+#ifndef RTNETLINK_MONITOR_H
+#define RTNETLINK_MONITOR_H
+
+#include <string>
+#include <map>
+#include <cstdint>
+
+// Kernel view of one network link (RTM_NEWLINK)
+struct LinkState {
+    int index;
+    std::string name;
+    unsigned int flags;        // IFF_* flags
+    unsigned char operstate;   // IF_OPER_* value
+
+    LinkState() : index(0), flags(0), operstate(0) {}
+};
+
+// One IPv4 address assigned to a link (RTM_NEWADDR)
+struct AddressState {
+    int index;
+    std::string address;
+    int prefix_length;
+
+    AddressState() : index(0), prefix_length(0) {}
+};
+
+// One IPv4 route (RTM_NEWROUTE)
+struct RouteState {
+    uint32_t table;
+    std::string destination;   // Network address without the prefix length
+    int prefix_length;
+    std::string gateway;       // Empty for directly connected routes
+    int oif;                   // Output interface index
+    uint32_t metric;           // RTA_PRIORITY
+    unsigned char protocol;    // RTPROT_*
+    unsigned char scope;       // RT_SCOPE_*
+    unsigned char type;        // RTN_*
+
+    RouteState() : table(0), prefix_length(0), oif(0), metric(0), protocol(0), scope(0), type(0) {}
+
+    // Kernel identity of a route: table, destination and metric
+    std::string key() const;
+};
+
+// Mirrors the kernel's links, IPv4 addresses and IPv4 routes. A full dump
+// seeds the state, then a socket subscribed to RTMGRP_LINK, RTMGRP_IPV4_IFADDR
+// and RTMGRP_IPV4_ROUTE keeps it current one change at a time. Not
+// thread-safe; the owner serializes access.
+class RtnetlinkMonitor {
+public:
+    RtnetlinkMonitor();
+    ~RtnetlinkMonitor();
+
+    RtnetlinkMonitor(const RtnetlinkMonitor&) = delete;
+    RtnetlinkMonitor& operator=(const RtnetlinkMonitor&) = delete;
+
+    // Opens the event socket; poll fd() for POLLIN
+    bool open();
+    void close();
+    bool isOpen() const { return event_fd_ >= 0; }
+    int fd() const { return event_fd_; }
+
+    // Replaces the state with a fresh dump of links, addresses and routes
+    bool dumpAll();
+
+    // Applies every queued change notification without blocking. Returns
+    // true when the state changed. Lost notifications (socket overrun)
+    // trigger a full dump.
+    bool processEvents();
+
+    const std::map<int, LinkState>& links() const { return links_; }
+    const std::multimap<int, AddressState>& addresses() const { return addresses_; }
+    const std::map<std::string, RouteState>& routes() const { return routes_; }
+
+    std::string linkName(int index) const;
+
+private:
+    int event_fd_;
+    uint32_t sequence_;
+
+    std::map<int, LinkState> links_;
+    std::multimap<int, AddressState> addresses_; // Keyed by link index
+    std::map<std::string, RouteState> routes_;   // Keyed by RouteState::key()
+
+    bool dump(int request_type);
+    bool applyMessages(const char* buffer, size_t length, uint32_t sequence, bool& done);
+    bool applyMessage(const struct nlmsghdr* header);
+    void eraseRoutesVia(int index);
+    void log(const std::string& message) const;
+};
+
+#endif // RTNETLINK_MONITOR_H
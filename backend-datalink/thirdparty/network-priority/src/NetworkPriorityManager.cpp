@@ -1,4 +1,5 @@
 #include "NetworkPriorityManager.h"
+#include "ur-clock/ur_clock.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -6,10 +7,41 @@
 #include <cstdio>
 #include <memory>
 #include <iomanip>
-#include <regex>
+#include <map>
+#include <poll.h>
+#include <net/if.h>
+#include <linux/if.h>
+#include <linux/rtnetlink.h>
+
+namespace {
+
+const char* const kInterfaceUpsertSql =
+    "INSERT OR REPLACE INTO network_interfaces (id, name, ip_address, gateway, netmask, status, metric, "
+    "priority, type, speed, is_default, last_updated) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+const char* const kInterfaceDeleteSql = "DELETE FROM network_interfaces WHERE id = ?";
+const char* const kInterfaceSelectSql =
+    "SELECT id, name, ip_address, gateway, netmask, status, metric, priority, type, speed, is_default "
+    "FROM network_interfaces";
+
+const char* const kRuleUpsertSql =
+    "INSERT OR REPLACE INTO routing_rules (id, destination, gateway, interface, metric, priority, status, "
+    "type, table_name, last_updated) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+const char* const kRuleDeleteSql = "DELETE FROM routing_rules WHERE id = ?";
+const char* const kRuleSelectSql =
+    "SELECT id, destination, gateway, interface, metric, priority, status, type, table_name "
+    "FROM routing_rules";
+
+std::string columnText(sqlite3_stmt* stmt, int column) {
+    const unsigned char* text = sqlite3_column_text(stmt, column);
+    return text ? reinterpret_cast<const char*>(text) : "";
+}
+
+} // namespace
 
 NetworkPriorityManager::NetworkPriorityManager() 
-    : thread_id_(0), running_(false), poll_interval_seconds_(5) {
+    : thread_id_(0), running_(false), poll_interval_seconds_(5),
+      snapshot_(std::make_shared<NetworkPrioritySnapshot>()), snapshot_generation_(0),
+      last_pushed_generation_(0) {
     
     // Initialize data with default values
     statistics_ = NetworkStatistics{};
@@ -30,7 +62,9 @@ NetworkPriorityManager::NetworkPriorityManager()
 }
 
 NetworkPriorityManager::NetworkPriorityManager(DatabaseManager* db_manager) 
-    : thread_id_(0), running_(false), poll_interval_seconds_(5), db_manager_(db_manager) {
+    : thread_id_(0), running_(false), poll_interval_seconds_(5),
+      snapshot_(std::make_shared<NetworkPrioritySnapshot>()), snapshot_generation_(0),
+      db_manager_(db_manager), last_pushed_generation_(0) {
     
     std::cerr << "[CRITICAL] NetworkPriorityManager constructor called with db_manager: " 
               << (db_manager ? "VALID" : "NULL") << std::endl;
@@ -71,15 +105,17 @@ bool NetworkPriorityManager::start(int poll_interval_seconds) {
             return false;
         }
         
-        // Load existing configuration
-        loadConfigurationFromDatabase();
+        // Load existing configuration and put it back into the kernel
+        if (loadConfigurationFromDatabase()) {
+            restoreConfiguration();
+        }
         
         // Create the collection thread using ur-threadder-api
         std::function<void()> thread_func = [this]() {
             collectionLoop();
         };
         
-        thread_id_ = thread_manager_->createThread(thread_func);
+        thread_id_ = thread_manager_->createThreadWithAttributes(thread_func, thread_attr_);
         running_.store(true);
         
         log("Network Priority Manager started with thread ID: " + std::to_string(thread_id_));
@@ -168,7 +204,7 @@ bool NetworkPriorityManager::restart() {
             collectionLoop();
         };
         
-        thread_id_ = thread_manager_->createThread(thread_func);
+        thread_id_ = thread_manager_->createThreadWithAttributes(thread_func, thread_attr_);
         log("Network Priority Manager restarted successfully with thread ID: " + std::to_string(thread_id_));
         return true;
         
@@ -191,140 +227,196 @@ ThreadMgr::ThreadState NetworkPriorityManager::getState() const {
     }
 }
 
+std::shared_ptr<const NetworkPrioritySnapshot> NetworkPriorityManager::getSnapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
 std::vector<NetworkInterface> NetworkPriorityManager::getNetworkInterfaces() const {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    return network_interfaces_;
+    return getSnapshot()->interfaces;
 }
 
 std::vector<RoutingRule> NetworkPriorityManager::getRoutingRules() const {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    return routing_rules_;
+    return getSnapshot()->rules;
 }
 
 NetworkStatistics NetworkPriorityManager::getStatistics() const {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    return statistics_;
+    return getSnapshot()->statistics;
 }
 
 nlohmann::json NetworkPriorityManager::getAllDataAsJson() const {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    nlohmann::json interfaces_json = nlohmann::json::array();
-    for (const auto& interface : network_interfaces_) {
-        interfaces_json.push_back(interfaceToJson(interface));
-    }
-    
-    nlohmann::json rules_json = nlohmann::json::array();
-    for (const auto& rule : routing_rules_) {
-        rules_json.push_back(ruleToJson(rule));
+    auto snapshot = getSnapshot();
+    
+    nlohmann::json interfaces_json = snapshot->interfaces_json;
+    if (traffic_source_) {
+        nlohmann::json traffic = traffic_source_();
+        for (auto& interface : interfaces_json) {
+            auto it = traffic.find(interface["name"].get<std::string>());
+            if (it != traffic.end()) {
+                interface["traffic"] = *it;
+            }
+        }
     }
     
     return {
         {"networkInterfaces", interfaces_json},
-        {"routingRules", rules_json},
-        {"statistics", statisticsToJson(statistics_)},
+        {"routingRules", snapshot->rules_json},
+        {"statistics", statisticsToJson(snapshot->statistics)},
         {"lastUpdated", getCurrentTimestamp()}
     };
 }
 
 bool NetworkPriorityManager::setInterfacePriority(const std::string& interface_name, int priority) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    // Find interface by name
-    auto it = std::find_if(network_interfaces_.begin(), network_interfaces_.end(),
-                          [&interface_name](const NetworkInterface& iface) {
-                              return iface.name == interface_name;
-                          });
-    
-    if (it != network_interfaces_.end()) {
-        it->priority = priority;
+    bool success = false;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
         
-        // Apply the priority change to system
-        if (applyInterfaceMetrics()) {
-            saveInterfacesToDatabase();
-            pushDataToFrontend();
-            log("Set priority for interface " + interface_name + " to " + std::to_string(priority));
-            return true;
+        auto found = interface_index_.find(interface_name);
+        if (found != interface_index_.end()) {
+            size_t index = found->second;
+            int previous = network_interfaces_[index].priority;
+            network_interfaces_[index].priority = priority;
+            
+            // Apply the priority change to system
+            success = applyInterfaceMetrics();
+            if (success) {
+                publishSnapshot();
+            } else {
+                network_interfaces_[index].priority = previous;
+            }
         }
     }
     
+    if (success) {
+        saveConfigurationToDatabase();
+        pushDataToFrontend();
+        log("Set priority for interface " + interface_name + " to " + std::to_string(priority));
+        return true;
+    }
+    
     log("Failed to set priority for interface: " + interface_name);
     return false;
 }
 
 bool NetworkPriorityManager::addRoutingRule(const RoutingRule& rule) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
     // Validate rule
     if (rule.destination.empty() || rule.gateway.empty() || rule.interface.empty()) {
         log("Invalid routing rule: missing required fields");
         return false;
     }
     
-    // Add ID if not present
-    RoutingRule new_rule = rule;
-    if (new_rule.id.empty()) {
-        new_rule.id = generateId();
+    bool success = false;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        
+        RoutingRule new_rule = rule;
+        new_rule.id = ruleId(new_rule.destination, new_rule.metric);
+        new_rule.status = "Active";
+        new_rule.type = "static";
+        new_rule.table = "main";
+        
+        if (rule_index_.count(new_rule.id) > 0) {
+            log("Routing rule already exists: " + new_rule.id);
+        } else {
+            routing_rules_.push_back(new_rule);
+            rule_index_[new_rule.id] = routing_rules_.size() - 1;
+            
+            // Apply to system
+            success = applyRoutingRules();
+            if (success) {
+                publishSnapshot();
+            } else {
+                // Rollback on failure
+                routing_rules_.pop_back();
+                rule_index_.erase(new_rule.id);
+            }
+        }
     }
-    new_rule.status = "Active";
-    new_rule.type = "static";
-    new_rule.table = "main";
-    
-    routing_rules_.push_back(new_rule);
     
-    // Apply to system
-    if (applyRoutingRules()) {
-        saveRulesToDatabase();
+    if (success) {
+        saveConfigurationToDatabase();
         pushDataToFrontend();
         log("Added routing rule for " + rule.destination);
         return true;
     }
     
-    // Rollback on failure
-    routing_rules_.pop_back();
     log("Failed to add routing rule for " + rule.destination);
     return false;
 }
 
 bool NetworkPriorityManager::updateRoutingRule(const std::string& rule_id, const RoutingRule& rule) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    auto it = std::find_if(routing_rules_.begin(), routing_rules_.end(),
-                          [&rule_id](const RoutingRule& r) {
-                              return r.id == rule_id;
-                          });
-    
-    if (it != routing_rules_.end()) {
-        *it = rule;
-        it->id = rule_id; // Ensure ID is preserved
+    bool success = false;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
         
-        if (applyRoutingRules()) {
-            saveRulesToDatabase();
-            pushDataToFrontend();
-            log("Updated routing rule " + rule_id);
-            return true;
+        auto found = rule_index_.find(rule_id);
+        std::string new_id = ruleId(rule.destination, rule.metric);
+        
+        if (found != rule_index_.end() && new_id != rule_id && rule_index_.count(new_id) > 0) {
+            log("Routing rule already exists: " + new_id);
+        } else if (found != rule_index_.end()) {
+            size_t index = found->second;
+            RoutingRule previous = routing_rules_[index];
+            RoutingRule& updated = routing_rules_[index];
+            updated = rule;
+            updated.id = new_id;
+            updated.status = "Active";
+            updated.type = "static";
+            updated.table = "main";
+            reindex();
+            
+            // Routes the manager doesn't own are only removed when asked to
+            std::vector<RouteSpec> replaced;
+            if (previous.type != "static") {
+                replaced.push_back(toRouteSpec(previous));
+            }
+            
+            // A successful apply may rebuild the vectors; a failed one leaves
+            // them alone, so index still points at the rule
+            success = applyRoutingRules(replaced);
+            if (success) {
+                publishSnapshot();
+            } else {
+                routing_rules_[index] = previous;
+                reindex();
+            }
         }
     }
     
+    if (success) {
+        saveConfigurationToDatabase();
+        pushDataToFrontend();
+        log("Updated routing rule " + rule_id);
+        return true;
+    }
+    
     log("Failed to update routing rule: " + rule_id);
     return false;
 }
 
 bool NetworkPriorityManager::deleteRoutingRule(const std::string& rule_id) {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    auto it = std::find_if(routing_rules_.begin(), routing_rules_.end(),
-                          [&rule_id](const RoutingRule& r) {
-                              return r.id == rule_id;
-                          });
-    
-    if (it != routing_rules_.end()) {
-        // Remove from system first
-        std::string cmd = generateRouteCommand(*it, false);
-        executeCommand(cmd);
+    bool success = false;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
         
-        routing_rules_.erase(it);
-        saveRulesToDatabase();
+        auto found = rule_index_.find(rule_id);
+        if (found != rule_index_.end()) {
+            // Remove from system first
+            std::string error;
+            const RoutingRule& rule = routing_rules_[found->second];
+            success = route_programmer_.commit({RouteChange(RouteChange::Delete, toRouteSpec(rule))}, error);
+            if (success) {
+                routing_rules_.erase(routing_rules_.begin() + found->second);
+                reindex();
+                syncKernelState();
+                publishSnapshot();
+            } else {
+                log("Failed to remove route: " + error);
+            }
+        }
+    }
+    
+    if (success) {
+        saveConfigurationToDatabase();
         pushDataToFrontend();
         log("Deleted routing rule " + rule_id);
         return true;
@@ -334,19 +426,136 @@ bool NetworkPriorityManager::deleteRoutingRule(const std::string& rule_id) {
     return false;
 }
 
-bool NetworkPriorityManager::applyRoutingConfiguration() {
-    std::lock_guard<std::mutex> lock(data_mutex_);
+bool NetworkPriorityManager::applyRoutingRuleOperations(const std::vector<RoutingRuleOperation>& operations,
+                                                        std::vector<RoutingRuleOperationResult>& results) {
+    results.assign(operations.size(), RoutingRuleOperationResult());
+    if (operations.empty()) {
+        return true;
+    }
     
-    bool success = true;
+    bool success = false;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        
+        // Operations run against a copy; the live rules only change once all
+        // of them are valid
+        std::vector<RoutingRule> working = routing_rules_;
+        std::unordered_map<std::string, size_t> index;
+        for (size_t i = 0; i < working.size(); ++i) {
+            index[working[i].id] = i;
+        }
+        std::vector<RouteSpec> replaced;
+        bool valid = true;
+        
+        for (size_t i = 0; i < operations.size(); ++i) {
+            const RoutingRuleOperation& operation = operations[i];
+            RoutingRuleOperationResult& result = results[i];
+            
+            if (operation.kind == RoutingRuleOperation::Delete) {
+                auto found = index.find(operation.rule_id);
+                if (found == index.end()) {
+                    result.error = "Routing rule not found: " + operation.rule_id;
+                } else {
+                    // Routes the manager doesn't own are only removed when asked to
+                    if (working[found->second].type != "static") {
+                        replaced.push_back(toRouteSpec(working[found->second]));
+                    }
+                    working.erase(working.begin() + found->second);
+                    index.clear();
+                    for (size_t j = 0; j < working.size(); ++j) {
+                        index[working[j].id] = j;
+                    }
+                    result.rule_id = operation.rule_id;
+                    result.success = true;
+                }
+            } else if (operation.rule.destination.empty() || operation.rule.gateway.empty() ||
+                       operation.rule.interface.empty()) {
+                result.error = "Missing required fields";
+            } else {
+                std::string new_id = ruleId(operation.rule.destination, operation.rule.metric);
+                auto found = operation.kind == RoutingRuleOperation::Update ? index.find(operation.rule_id)
+                                                                            : index.end();
+                
+                if (operation.kind == RoutingRuleOperation::Update && found == index.end()) {
+                    result.error = "Routing rule not found: " + operation.rule_id;
+                } else if (index.count(new_id) > 0 && (found == index.end() || new_id != operation.rule_id)) {
+                    result.error = "Routing rule already exists: " + new_id;
+                } else {
+                    RoutingRule rule = operation.rule;
+                    rule.id = new_id;
+                    rule.status = "Active";
+                    rule.type = "static";
+                    rule.table = "main";
+                    
+                    if (found != index.end()) {
+                        size_t position = found->second;
+                        if (working[position].type != "static") {
+                            replaced.push_back(toRouteSpec(working[position]));
+                        }
+                        index.erase(found);
+                        working[position] = rule;
+                        index[new_id] = position;
+                    } else {
+                        working.push_back(rule);
+                        index[new_id] = working.size() - 1;
+                    }
+                    result.rule_id = new_id;
+                    result.success = true;
+                }
+            }
+            
+            if (!result.success) {
+                valid = false;
+            }
+        }
+        
+        if (valid) {
+            std::vector<RoutingRule> previous;
+            previous.swap(routing_rules_);
+            routing_rules_ = std::move(working);
+            reindex();
+            
+            success = applyRoutingRules(replaced);
+            if (success) {
+                publishSnapshot();
+            } else {
+                routing_rules_.swap(previous);
+                reindex();
+                for (auto& result : results) {
+                    result.success = false;
+                    result.error = "Kernel rejected the routing changes";
+                }
+            }
+        } else {
+            // Valid operations are not applied on their own either
+            for (auto& result : results) {
+                if (result.success) {
+                    result.success = false;
+                    result.error = "Not applied: another operation in the batch failed";
+                }
+            }
+        }
+    }
     
-    // Apply interface metrics
-    if (!applyInterfaceMetrics()) {
-        success = false;
+    if (success) {
+        saveConfigurationToDatabase();
+        pushDataToFrontend();
+        log("Applied " + std::to_string(operations.size()) + " routing rule operations");
+        return true;
     }
     
-    // Apply routing rules
-    if (!applyRoutingRules()) {
-        success = false;
+    log("Failed to apply " + std::to_string(operations.size()) + " routing rule operations");
+    return false;
+}
+
+bool NetworkPriorityManager::applyRoutingConfiguration() {
+    bool success = false;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        success = applyRoutingConfigurationLocked();
+        if (success) {
+            publishSnapshot();
+        }
     }
     
     if (success) {
@@ -360,19 +569,46 @@ bool NetworkPriorityManager::applyRoutingConfiguration() {
     return success;
 }
 
-bool NetworkPriorityManager::resetToDefaults() {
-    std::lock_guard<std::mutex> lock(data_mutex_);
+bool NetworkPriorityManager::applyRoutingConfigurationLocked() {
+    bool success = true;
     
-    // Clear custom routing rules
-    routing_rules_.clear();
+    // Apply interface metrics
+    if (!applyInterfaceMetrics()) {
+        success = false;
+    }
     
-    // Reset interface priorities to defaults based on metric
-    for (auto& interface : network_interfaces_) {
-        interface.priority = interface.metric;
+    // Apply routing rules
+    if (!applyRoutingRules()) {
+        success = false;
     }
     
-    // Apply default configuration
-    if (applyRoutingConfiguration()) {
+    return success;
+}
+
+bool NetworkPriorityManager::resetToDefaults() {
+    bool success = false;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        
+        // Clear custom routing rules
+        routing_rules_.erase(std::remove_if(routing_rules_.begin(), routing_rules_.end(),
+                                            [](const RoutingRule& rule) { return rule.type == "static"; }),
+                             routing_rules_.end());
+        reindex();
+        
+        // Reset interface priorities to defaults based on metric
+        for (auto& interface : network_interfaces_) {
+            interface.priority = interface.metric;
+        }
+        
+        // Apply default configuration
+        success = applyRoutingConfigurationLocked();
+        publishSnapshot();
+    }
+    
+    if (success) {
+        saveConfigurationToDatabase();
+        pushDataToFrontend();
         log("Reset to default routing configuration");
         return true;
     }
@@ -391,18 +627,25 @@ bool NetworkPriorityManager::initializeDatabaseTables() {
 }
 
 bool NetworkPriorityManager::loadConfigurationFromDatabase() {
-    if (!db_manager_->isInitialized()) {
+    if (!db_manager_ || !db_manager_->isInitialized()) {
         return false;
     }
     
     bool success = true;
-    
-    if (!loadInterfacesFromDatabase()) {
-        success = false;
-    }
-    
-    if (!loadRulesFromDatabase()) {
-        success = false;
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        
+        if (!loadInterfacesFromDatabase()) {
+            success = false;
+        }
+        
+        if (!loadRulesFromDatabase()) {
+            success = false;
+        }
+        
+        reindex();
+        updateStatistics();
+        publishSnapshot();
     }
     
     if (success) {
@@ -415,27 +658,44 @@ bool NetworkPriorityManager::loadConfigurationFromDatabase() {
 }
 
 bool NetworkPriorityManager::saveConfigurationToDatabase() {
-    if (!db_manager_->isInitialized()) {
+    if (!db_manager_ || !db_manager_->isInitialized()) {
         return false;
     }
     
-    bool success = true;
-    
-    if (!saveInterfacesToDatabase()) {
-        success = false;
+    // Only the static rules are configuration; the rest mirror the kernel
+    auto snapshot = getSnapshot();
+    RowMap interfaces;
+    RowMap rules;
+    for (const auto& interface : snapshot->interfaces) {
+        interfaces[interface.id] = interfaceRow(interface);
+    }
+    for (const auto& rule : snapshot->rules) {
+        if (rule.type == "static") {
+            rules[rule.id] = ruleRow(rule);
+        }
     }
     
-    if (!saveRulesToDatabase()) {
-        success = false;
+    std::lock_guard<std::mutex> lock(persist_mutex_);
+    
+    std::vector<DatabaseManager::Statement> statements;
+    std::string timestamp = getCurrentTimestamp();
+    appendRowChanges(interfaces, persisted_interfaces_, kInterfaceUpsertSql, kInterfaceDeleteSql,
+                     timestamp, statements);
+    appendRowChanges(rules, persisted_rules_, kRuleUpsertSql, kRuleDeleteSql, timestamp, statements);
+    
+    if (statements.empty()) {
+        return true;
     }
     
-    if (success) {
-        log("Saved configuration to database");
-    } else {
+    if (!db_manager_->executeTransaction(statements)) {
         log("Failed to save configuration to database");
+        return false;
     }
     
-    return success;
+    persisted_interfaces_ = std::move(interfaces);
+    persisted_rules_ = std::move(rules);
+    log("Saved " + std::to_string(statements.size()) + " configuration change(s) to database");
+    return true;
 }
 
 void NetworkPriorityManager::forceDataCollection() {
@@ -453,190 +713,319 @@ void NetworkPriorityManager::setPollInterval(int seconds) {
     }
 }
 
+void NetworkPriorityManager::setSlowdown(int factor) {
+    if (factor > 0 && slowdown_.exchange(factor) != factor) {
+        log("Set slowdown to " + std::to_string(factor) + "x");
+    }
+}
+
+bool NetworkPriorityManager::setReachabilitySettings(const ReachabilityProber::Settings& settings) {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    if (!reachability_prober_.setSettings(settings)) {
+        return false;
+    }
+    log(settings.targets.empty() ? "Reachability probing disabled"
+                                 : "Probing reachability of " + std::to_string(settings.targets.size()) +
+                                   " target(s) every " + std::to_string(settings.interval_ms) + "ms");
+    return true;
+}
+
+void NetworkPriorityManager::setFailoverSettings(const FailoverSettings& settings) {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    failover_settings_ = settings;
+    if (!settings.enabled && !uplink_health_.empty()) {
+        uplink_health_.clear();
+        applyInterfaceMetrics();
+    }
+    log(std::string("Automatic failover ") + (settings.enabled ? "enabled" : "disabled"));
+}
+
 void NetworkPriorityManager::collectionLoop() {
     int collection_count = 0;
+    auto next_resync = std::chrono::steady_clock::now();
     
-    log("Collection loop started - Network Priority Manager is now collecting data");
+    log("Collection loop started - following rtnetlink link, address and route changes");
     
     while (running_.load()) {
+        ThreadMgr::ThreadManager::heartbeat();
+        bool changed = false;
+        
         try {
-            collectAllData();
-            collection_count++;
+            if (!netlink_monitor_.isOpen()) {
+                std::lock_guard<std::mutex> lock(data_mutex_);
+                netlink_monitor_.open();
+            }
             
-            // Log collection progress every time for debugging
-            log("Collection #" + std::to_string(collection_count) + 
-                " (Interfaces: " + std::to_string(statistics_.total) + 
-                ", Online: " + std::to_string(statistics_.online) + 
-                ", Rules: " + std::to_string(routing_rules_.size()) + ")");
+            // Full dump at start, then only as a safety net; without the event
+            // socket this degrades to polling every poll interval
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_resync) {
+                collectAllData();
+                changed = true;
+                int resync_seconds = (netlink_monitor_.isOpen() ? kNetlinkResyncSeconds : poll_interval_seconds_) *
+                                     slowdown_.load();
+                next_resync = now + std::chrono::seconds(resync_seconds);
+            } else if (waitForEvents(std::min(next_resync, reachability_prober_.nextWakeup()))) {
+                // Let a burst (e.g. a failover replacing several routes) settle
+                std::this_thread::sleep_for(std::chrono::milliseconds(kEventSettleMs));
+                
+                std::lock_guard<std::mutex> lock(data_mutex_);
+                if (netlink_monitor_.processEvents()) {
+                    rebuildFromKernelState();
+                    changed = true;
+                }
+            }
             
-            // Push data to frontend
-            pushDataToFrontend();
+            if (updateReachability()) {
+                changed = true;
+            }
+            if (evaluateFailover()) {
+                changed = true;
+            }
+            
+            if (changed) {
+                collection_count++;
+                const NetworkStatistics stats = getStatistics();
+                log("Collection #" + std::to_string(collection_count) + 
+                    " (Interfaces: " + std::to_string(stats.total) + 
+                    ", Online: " + std::to_string(stats.online) + 
+                    ", Rules: " + std::to_string(stats.activeRules) + ")");
+                
+                // Push data to frontend
+                pushDataToFrontend();
+                saveConfigurationToDatabase();
+            }
             
         } catch (const std::exception& e) {
             log("Error in collection loop: " + std::string(e.what()));
+            std::this_thread::sleep_for(std::chrono::seconds(poll_interval_seconds_));
         }
-        
-        // Sleep for the configured interval
-        std::this_thread::sleep_for(std::chrono::seconds(poll_interval_seconds_));
     }
     
     log("Collection loop stopped after " + std::to_string(collection_count) + " collections");
 }
 
-void NetworkPriorityManager::collectAllData() {
-    std::lock_guard<std::mutex> lock(data_mutex_);
-    
-    collectNetworkInterfaces();
-    collectRoutingRules();
-    updateStatistics();
-}
-
-void NetworkPriorityManager::collectNetworkInterfaces() {
-    network_interfaces_.clear();
-    
-    // Get interface list from system using JSON output for robust parsing
-    std::string cmd = "ip -j addr show";
-    log("Executing command: " + cmd);
-    std::string output = executeCommand(cmd);
-    
-    if (output.empty()) {
-        log("Failed to get network interfaces - command returned empty output");
-        return;
-    }
-    
-    log("Raw interface command output length: " + std::to_string(output.length()));
-    log("Raw JSON output preview: " + output.substr(0, 200) + "...");
-    
-    try {
-        // Parse JSON output
-        nlohmann::json interfaces_json = nlohmann::json::parse(output);
-        
-        for (const auto& iface_json : interfaces_json) {
-            try {
-                NetworkInterface interface = parseInterfaceFromJson(iface_json);
-                if (!interface.name.empty()) {
-                    network_interfaces_.push_back(interface);
-                    log("Parsed interface: " + interface.name + " (" + interface.ipAddress + ") - " + interface.status);
-                }
-            } catch (const std::exception& e) {
-                log("Error parsing interface JSON entry: " + std::string(e.what()));
-            }
+// Waits until the event socket is readable or the deadline passes, in short
+// slices so stop() is noticed promptly. The sockets of a running reachability
+// round are polled alongside; the wait also ends once they all settled.
+bool NetworkPriorityManager::waitForEvents(std::chrono::steady_clock::time_point deadline) {
+    std::vector<pollfd> descriptors;
+    while (running_.load()) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
         }
         
-    } catch (const std::exception& e) {
-        log("Error parsing interface JSON: " + std::string(e.what()));
-        // Fallback to simple parsing if JSON fails
-        log("Attempting fallback to simple interface parsing...");
-        collectNetworkInterfacesFallback();
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+        int timeout_ms = static_cast<int>(std::min<long long>(remaining, 500));
+        
+        descriptors.clear();
+        if (netlink_monitor_.isOpen()) {
+            descriptors.push_back({netlink_monitor_.fd(), POLLIN, 0});
+        }
+        size_t first_probe = descriptors.size();
+        {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            reachability_prober_.appendPollFds(descriptors);
+        }
+        
+        if (descriptors.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+            continue;
+        }
+        
+        if (poll(descriptors.data(), descriptors.size(), timeout_ms) <= 0) {
+            continue;
+        }
+        
+        bool round_settled = false;
+        if (descriptors.size() > first_probe) {
+            std::lock_guard<std::mutex> lock(data_mutex_);
+            round_settled = reachability_prober_.handlePollFds(descriptors.data() + first_probe,
+                                                               descriptors.size() - first_probe,
+                                                               std::chrono::steady_clock::now());
+        }
+        if (first_probe > 0 && (descriptors[0].revents & POLLIN)) {
+            return true;
+        }
+        if (round_settled) {
+            return false;
+        }
     }
-    
-    log("Collected " + std::to_string(network_interfaces_.size()) + " network interfaces");
+    return false;
 }
 
-void NetworkPriorityManager::collectRoutingRules() {
-    routing_rules_.clear();
-    
-    // Get routing table from system
-    std::string cmd = "ip route show";
-    log("Executing routing command: " + cmd);
-    std::string output = executeCommand(cmd);
-    
-    if (output.empty()) {
-        log("Failed to get routing rules - command returned empty output");
-        return;
-    }
-    
-    log("Raw routing command output length: " + std::to_string(output.length()));
-    log("Raw routing output preview: " + output.substr(0, 200) + "...");
-    
-    // Parse routing data
-    std::istringstream iss(output);
-    std::string line;
-    
-    while (std::getline(iss, line)) {
-        try {
-            RoutingRule rule = parseRouteFromSystem(line);
-            if (!rule.destination.empty()) {
-                routing_rules_.push_back(rule);
-                log("Parsed route: " + rule.destination + " via " + rule.gateway + " dev " + rule.interface);
+// Ends the running probe round once it settled or timed out, then starts the
+// next one when due. True when an uplink's reachability changed; the
+// snapshot already shows it.
+bool NetworkPriorityManager::updateReachability() {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    auto now = std::chrono::steady_clock::now();
+    bool changed = false;
+    
+    if (reachability_prober_.finishRound(now)) {
+        for (auto& interface : network_interfaces_) {
+            if (interface.isDefault) {
+                interface.reachability =
+                    ReachabilityProber::toString(reachability_prober_.status(interface.name).state);
             }
-        } catch (const std::exception& e) {
-            log("Error parsing routing data: " + std::string(e.what()));
         }
+        updateStatistics();
+        publishSnapshot();
+        changed = true;
     }
     
-    log("Collected " + std::to_string(routing_rules_.size()) + " routing rules");
+    if (reachability_prober_.roundDue(now)) {
+        reachability_prober_.startRound(uplinkNames(), now);
+    }
+    return changed;
 }
 
-void NetworkPriorityManager::updateStatistics() {
-    statistics_.total = network_interfaces_.size();
-    statistics_.online = 0;
-    statistics_.offline = 0;
-    statistics_.activeRules = 0;
+// Demotes an uplink the moment it turns unhealthy; restores it only after it
+// stayed healthy for restore_hold_ms, so a flapping uplink is not switched
+// back and forth. Unknown reachability (not probed yet, or probing off)
+// counts as healthy. True when default routes moved.
+bool NetworkPriorityManager::evaluateFailover() {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    if (!failover_settings_.enabled) {
+        return false;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    auto previous = uplink_health_;
+    std::unordered_map<std::string, UplinkHealth> health;
+    bool moved = false;
     
     for (const auto& interface : network_interfaces_) {
-        if (interface.status == "online") {
-            statistics_.online++;
+        if (!interface.isDefault) {
+            continue;
+        }
+        
+        auto found = previous.find(interface.name);
+        UplinkHealth uplink = found != previous.end() ? found->second : UplinkHealth();
+        ReachabilityProber::Status probe = reachability_prober_.status(interface.name);
+        const char* problem = nullptr;
+        if (interface.status != "online") {
+            problem = "link down";
+        } else if (probe.state == ReachabilityProber::State::Unreachable) {
+            problem = "unreachable";
+        } else if (failover_settings_.max_latency_ms > 0 && probe.latency_ms > failover_settings_.max_latency_ms) {
+            problem = "slow";
+        }
+        
+        if (problem) {
+            uplink.healthy_since = std::chrono::steady_clock::time_point();
+            if (!uplink.demoted) {
+                uplink.demoted = true;
+                moved = true;
+                log("Failover: demoting " + interface.name + " (" + problem + ")");
+            }
         } else {
-            statistics_.offline++;
+            if (uplink.healthy_since == std::chrono::steady_clock::time_point()) {
+                uplink.healthy_since = now;
+            }
+            if (uplink.demoted &&
+                now - uplink.healthy_since >= std::chrono::milliseconds(failover_settings_.restore_hold_ms)) {
+                uplink.demoted = false;
+                moved = true;
+                log("Failover: restoring " + interface.name);
+            }
         }
+        health[interface.name] = uplink;
     }
     
-    for (const auto& rule : routing_rules_) {
-        if (rule.status == "Active") {
-            statistics_.activeRules++;
-        }
+    uplink_health_ = std::move(health);
+    if (!moved) {
+        return false;
     }
     
-    statistics_.lastUpdated = getCurrentTimestamp();
+    // Keep the old state on failure so the next pass tries again
+    if (!applyInterfaceMetrics()) {
+        uplink_health_ = std::move(previous);
+        log("Failover: failed to move the default routes");
+        return false;
+    }
+    return true;
 }
 
-std::string NetworkPriorityManager::executeCommand(const std::string& command) const {
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(command.c_str(), "r"), pclose);
-    
-    if (!pipe) {
-        return "";
+// Metric an uplink's default route should have: its priority, pushed below
+// every healthy uplink while demoted
+int NetworkPriorityManager::targetMetric(const NetworkInterface& interface) const {
+    auto health = uplink_health_.find(interface.name);
+    bool demoted = health != uplink_health_.end() && health->second.demoted;
+    return demoted ? interface.priority + kDemotionPenalty : interface.priority;
+}
+
+// Links that are up with a default route of the main table; caller holds
+// data_mutex_
+std::vector<std::string> NetworkPriorityManager::uplinkNames() const {
+    std::vector<std::string> names;
+    for (const auto& interface : network_interfaces_) {
+        if (interface.isDefault && interface.status == "online") {
+            names.push_back(interface.name);
+        }
     }
+    return names;
+}
+
+void NetworkPriorityManager::collectAllData() {
+    std::lock_guard<std::mutex> lock(data_mutex_);
     
-    char buffer[128];
-    std::string result;
-    
-    while (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-        result += buffer;
+    if (!netlink_monitor_.dumpAll()) {
+        log("Failed to dump kernel network state");
     }
-    
-    return result;
+    rebuildFromKernelState();
 }
 
-NetworkInterface NetworkPriorityManager::parseInterfaceFromJson(const nlohmann::json& iface_json) const {
-    NetworkInterface interface;
-    
-    try {
-        // Extract basic interface information
-        interface.id = generateId();
-        interface.name = iface_json.value("ifname", "");
-        
-        // Get interface state and flags
-        std::string operstate = iface_json.value("operstate", "DOWN");
-        std::vector<std::string> flags = iface_json.value("flags", std::vector<std::string>());
-        
-        // Determine status
-        interface.status = (operstate == "UP" || operstate == "UNKNOWN") ? "online" : "offline";
-        
-        // Extract IP addresses (use the first valid IPv4 address)
-        interface.ipAddress = "";
-        if (iface_json.contains("addr_info")) {
-            for (const auto& addr : iface_json["addr_info"]) {
-                if (addr.value("family", "") == "inet") {
-                    interface.ipAddress = addr.value("local", "");
-                    break; // Use first IPv4 address
-                }
+// Derives the frontend view from the mirrored kernel state. Interface and
+// rule priorities survive the rebuild; everything else comes from the kernel.
+void NetworkPriorityManager::rebuildFromKernelState() {
+    // The indexes still point into the previous vectors until reindex()
+    std::vector<NetworkInterface> previous_interfaces;
+    std::vector<RoutingRule> previous_rules;
+    previous_interfaces.swap(network_interfaces_);
+    previous_rules.swap(routing_rules_);
+    
+    // Default routes of the main table decide gateway, metric and isDefault
+    std::map<int, const RouteState*> default_routes;
+    for (const auto& entry : netlink_monitor_.routes()) {
+        const RouteState& route = entry.second;
+        if (route.table == RT_TABLE_MAIN && route.prefix_length == 0 && route.type == RTN_UNICAST) {
+            auto it = default_routes.find(route.oif);
+            if (it == default_routes.end() || route.metric < it->second->metric) {
+                default_routes[route.oif] = &route;
             }
         }
+    }
+    
+    network_interfaces_.reserve(netlink_monitor_.links().size());
+    for (const auto& entry : netlink_monitor_.links()) {
+        const LinkState& link = entry.second;
+        
+        NetworkInterface interface;
+        interface.id = "if_" + link.name;
+        interface.name = link.name;
+        interface.status = (link.operstate == IF_OPER_UP || link.operstate == IF_OPER_UNKNOWN) &&
+                           (link.flags & IFF_UP) ? "online" : "offline";
         
-        // Set default metric and priority
-        interface.metric = 100;
-        interface.priority = interface.metric;
+        // First IPv4 address of the link
+        auto address = netlink_monitor_.addresses().find(link.index);
+        if (address != netlink_monitor_.addresses().end()) {
+            interface.ipAddress = address->second.address;
+            interface.netmask = prefixToNetmask(address->second.prefix_length);
+        }
+        
+        auto route = default_routes.find(link.index);
+        interface.isDefault = route != default_routes.end();
+        interface.gateway = interface.isDefault ? route->second->gateway : "";
+        interface.metric = interface.isDefault ? static_cast<int>(route->second->metric) : 100;
+        // Only uplinks are probed
+        interface.reachability = ReachabilityProber::toString(
+            interface.isDefault ? reachability_prober_.status(interface.name).state : ReachabilityProber::State::Unknown);
+        
+        auto previous = interface_index_.find(interface.name);
+        interface.priority = previous != interface_index_.end() ? previous_interfaces[previous->second].priority
+                                                                : interface.metric;
         
         // Determine interface type
         if (interface.name.find("eth") != std::string::npos || 
@@ -652,90 +1041,108 @@ NetworkInterface NetworkPriorityManager::parseInterfaceFromJson(const nlohmann::
             interface.type = "unknown";
         }
         
-        // Get gateway for this interface
-        if (!interface.name.empty()) {
-            std::string gateway_cmd = "ip route show dev " + interface.name + " | grep default | awk '{print $3}'";
-            interface.gateway = executeCommand(gateway_cmd);
-            interface.gateway.erase(std::remove_if(interface.gateway.begin(), interface.gateway.end(), ::isspace), interface.gateway.end());
-            
-            // Check if this is the default route
-            std::string default_check = executeCommand("ip route show default | grep " + interface.name);
-            interface.isDefault = !default_check.empty();
-        }
-        
         // Set default speed
         interface.speed = 1000;
         
-        log("Successfully parsed JSON interface: " + interface.name + " with IP: " + interface.ipAddress);
+        network_interfaces_.push_back(interface);
+    }
+    
+    // The main table, as `ip route show` lists it
+    for (const auto& entry : netlink_monitor_.routes()) {
+        const RouteState& route = entry.second;
+        if (route.table != RT_TABLE_MAIN || route.type != RTN_UNICAST) {
+            continue;
+        }
+        
+        RoutingRule rule;
+        rule.destination = route.destination + "/" + std::to_string(route.prefix_length);
+        rule.gateway = route.gateway;
+        rule.interface = netlink_monitor_.linkName(route.oif);
+        rule.metric = static_cast<int>(route.metric);
+        rule.status = "Active";
+        rule.type = route.protocol == RouteProgrammer::kManagedProtocol ? "static" : "dynamic";
+        rule.table = "main";
+        rule.id = ruleId(rule.destination, rule.metric);
         
-    } catch (const std::exception& e) {
-        log("Error parsing interface JSON: " + std::string(e.what()));
+        auto previous = rule_index_.find(rule.id);
+        rule.priority = previous != rule_index_.end() ? previous_rules[previous->second].priority : rule.metric;
+        
+        routing_rules_.push_back(rule);
     }
     
-    return interface;
+    reindex();
+    updateStatistics();
+    publishSnapshot();
 }
 
-void NetworkPriorityManager::collectNetworkInterfacesFallback() {
-    // Simple fallback using basic ip command
-    std::string cmd = "ip link show | grep '^[0-9]:' | awk '{print $2}' | sed 's/://'";
-    std::string output = executeCommand(cmd);
-    
-    if (output.empty()) {
-        log("Fallback interface collection failed");
-        return;
+std::string NetworkPriorityManager::prefixToNetmask(int prefix_length) {
+    if (prefix_length <= 0) {
+        return "0.0.0.0";
     }
     
-    std::istringstream iss(output);
-    std::string line;
+    uint32_t mask = prefix_length >= 32 ? 0xFFFFFFFFu : ~((1u << (32 - prefix_length)) - 1);
+    return std::to_string((mask >> 24) & 0xFF) + "." + std::to_string((mask >> 16) & 0xFF) + "." +
+           std::to_string((mask >> 8) & 0xFF) + "." + std::to_string(mask & 0xFF);
+}
+
+void NetworkPriorityManager::updateStatistics() {
+    statistics_.total = network_interfaces_.size();
+    statistics_.online = 0;
+    statistics_.offline = 0;
+    statistics_.reachable = 0;
+    statistics_.activeRules = 0;
     
-    while (std::getline(iss, line)) {
-        if (!line.empty()) {
-            NetworkInterface interface;
-            interface.id = generateId();
-            interface.name = line;
-            interface.status = "unknown"; // Could be enhanced with status checking
-            interface.ipAddress = "";
-            interface.metric = 100;
-            interface.priority = 100;
-            interface.type = "unknown";
-            interface.gateway = "";
-            interface.isDefault = false;
-            interface.speed = 1000;
-            
-            network_interfaces_.push_back(interface);
-            log("Fallback parsed interface: " + interface.name);
+    for (const auto& interface : network_interfaces_) {
+        if (interface.status == "online") {
+            statistics_.online++;
+        } else {
+            statistics_.offline++;
+        }
+        if (interface.reachability == "reachable") {
+            statistics_.reachable++;
         }
     }
+    
+    for (const auto& rule : routing_rules_) {
+        if (rule.status == "Active") {
+            statistics_.activeRules++;
+        }
+    }
+    
+    statistics_.lastUpdated = getCurrentTimestamp();
 }
 
-// ... (rest of the code remains the same)
-RoutingRule NetworkPriorityManager::parseRouteFromSystem(const std::string& route_data) const {
-    RoutingRule rule;
+void NetworkPriorityManager::reindex() {
+    interface_index_.clear();
+    interface_index_.reserve(network_interfaces_.size());
+    for (size_t i = 0; i < network_interfaces_.size(); ++i) {
+        interface_index_[network_interfaces_[i].name] = i;
+    }
     
-    // Parse route data using regex
-    std::regex route_regex(R"((default|([^/\s]+/\d+))\s+(via\s+(\S+)\s+)?dev\s+(\S+)(\s+metric\s+(\d+))?)");
-    std::smatch match;
+    rule_index_.clear();
+    rule_index_.reserve(routing_rules_.size());
+    for (size_t i = 0; i < routing_rules_.size(); ++i) {
+        rule_index_[routing_rules_[i].id] = i;
+    }
+}
+
+// Copies the current data into a new snapshot and swaps it in; called with
+// data_mutex_ held after every change readers should see
+void NetworkPriorityManager::publishSnapshot() {
+    auto snapshot = std::make_shared<NetworkPrioritySnapshot>();
+    snapshot->generation = ++snapshot_generation_;
+    snapshot->interfaces = network_interfaces_;
+    snapshot->rules = routing_rules_;
+    snapshot->statistics = statistics_;
     
-    if (std::regex_search(route_data, match, route_regex)) {
-        rule.id = generateId();
-        rule.destination = (match[1].str() == "default") ? "0.0.0.0/0" : match[2].str();
-        rule.gateway = match[4].str();
-        rule.interface = match[5].str();
-        
-        // Extract metric
-        try {
-            rule.metric = match[7].matched ? std::stoi(match[7].str()) : 100;
-        } catch (...) {
-            rule.metric = 100;
-        }
-        
-        rule.priority = rule.metric;
-        rule.status = "Active";
-        rule.type = "dynamic";
-        rule.table = "main";
+    for (const auto& interface : network_interfaces_) {
+        snapshot->interfaces_json.push_back(interfaceToJson(interface));
+    }
+    for (const auto& rule : routing_rules_) {
+        snapshot->rules_json.push_back(ruleToJson(rule));
     }
     
-    return rule;
+    std::atomic_store(&snapshot_, std::shared_ptr<const NetworkPrioritySnapshot>(std::move(snapshot)));
 }
 
 bool NetworkPriorityManager::createNetworkPriorityTables() {
@@ -774,8 +1181,11 @@ bool NetworkPriorityManager::createNetworkPriorityTables() {
             )
         )";
         
-        // Execute table creation (this would need to be implemented in DatabaseManager)
-        // For now, return true as placeholder
+        if (!db_manager_->execute(interfaces_sql) || !db_manager_->execute(rules_sql)) {
+            log("Failed to create network priority database tables");
+            return false;
+        }
+        
         log("Created network priority database tables");
         return true;
         
@@ -785,101 +1195,302 @@ bool NetworkPriorityManager::createNetworkPriorityTables() {
     }
 }
 
-bool NetworkPriorityManager::saveInterfacesToDatabase() {
-    // Placeholder implementation
-    // Would need to implement actual database operations
+bool NetworkPriorityManager::loadInterfacesFromDatabase() {
+    std::vector<NetworkInterface> interfaces;
+    RowMap rows;
+    
+    bool success = db_manager_->query(kInterfaceSelectSql, {}, [&](sqlite3_stmt* stmt) {
+        NetworkInterface interface;
+        interface.id = columnText(stmt, 0);
+        interface.name = columnText(stmt, 1);
+        interface.ipAddress = columnText(stmt, 2);
+        interface.gateway = columnText(stmt, 3);
+        interface.netmask = columnText(stmt, 4);
+        interface.status = columnText(stmt, 5);
+        interface.metric = sqlite3_column_int(stmt, 6);
+        interface.priority = sqlite3_column_int(stmt, 7);
+        interface.type = columnText(stmt, 8);
+        interface.speed = sqlite3_column_int(stmt, 9);
+        interface.isDefault = sqlite3_column_int(stmt, 10) != 0;
+        
+        rows[interface.id] = interfaceRow(interface);
+        interfaces.push_back(interface);
+    });
+    
+    if (!success) {
+        return false;
+    }
+    
+    network_interfaces_ = std::move(interfaces);
+    std::lock_guard<std::mutex> lock(persist_mutex_);
+    persisted_interfaces_ = std::move(rows);
     return true;
 }
 
-bool NetworkPriorityManager::saveRulesToDatabase() {
-    // Placeholder implementation
-    // Would need to implement actual database operations
+bool NetworkPriorityManager::loadRulesFromDatabase() {
+    std::vector<RoutingRule> rules;
+    RowMap rows;
+    
+    bool success = db_manager_->query(kRuleSelectSql, {}, [&](sqlite3_stmt* stmt) {
+        RoutingRule rule;
+        rule.id = columnText(stmt, 0);
+        rule.destination = columnText(stmt, 1);
+        rule.gateway = columnText(stmt, 2);
+        rule.interface = columnText(stmt, 3);
+        rule.metric = sqlite3_column_int(stmt, 4);
+        rule.priority = sqlite3_column_int(stmt, 5);
+        rule.status = columnText(stmt, 6);
+        rule.type = columnText(stmt, 7);
+        rule.table = columnText(stmt, 8);
+        
+        rows[rule.id] = ruleRow(rule);
+        rules.push_back(rule);
+    });
+    
+    if (!success) {
+        return false;
+    }
+    
+    routing_rules_ = std::move(rules);
+    std::lock_guard<std::mutex> lock(persist_mutex_);
+    persisted_rules_ = std::move(rows);
     return true;
 }
 
-bool NetworkPriorityManager::loadInterfacesFromDatabase() {
-    // Placeholder implementation
-    // Would need to implement actual database operations
-    return true;
+// Brings the kernel in line with the loaded configuration, e.g. after a
+// reboot flushed the managed routes: interface priorities carry over through
+// the rebuild and static rules missing from the kernel are installed again
+void NetworkPriorityManager::restoreConfiguration() {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    
+    std::vector<RoutingRule> saved_rules;
+    for (const auto& rule : routing_rules_) {
+        if (rule.type == "static") {
+            saved_rules.push_back(rule);
+        }
+    }
+    
+    if (!netlink_monitor_.dumpAll()) {
+        log("Failed to dump kernel network state");
+        return;
+    }
+    rebuildFromKernelState();
+    
+    for (const auto& rule : saved_rules) {
+        if (rule_index_.count(rule.id) == 0) {
+            routing_rules_.push_back(rule);
+        }
+    }
+    reindex();
+    
+    if (!applyRoutingConfigurationLocked()) {
+        log("Failed to restore saved routing configuration");
+    }
+    publishSnapshot();
 }
 
-bool NetworkPriorityManager::loadRulesFromDatabase() {
-    // Placeholder implementation
-    // Would need to implement actual database operations
-    return true;
+NetworkPriorityManager::Row NetworkPriorityManager::interfaceRow(const NetworkInterface& interface) {
+    return {interface.id, interface.name, interface.ipAddress, interface.gateway, interface.netmask,
+            interface.status, std::to_string(interface.metric), std::to_string(interface.priority),
+            interface.type, std::to_string(interface.speed), interface.isDefault ? "1" : "0"};
 }
 
-bool NetworkPriorityManager::applyInterfaceMetrics() {
-    // Placeholder for applying interface metrics to system
-    // This would involve using `ip link set` and `ip route change` commands
-    return true;
+NetworkPriorityManager::Row NetworkPriorityManager::ruleRow(const RoutingRule& rule) {
+    return {rule.id, rule.destination, rule.gateway, rule.interface, std::to_string(rule.metric),
+            std::to_string(rule.priority), rule.status, rule.type, rule.table};
 }
 
-bool NetworkPriorityManager::applyRoutingRules() {
-    // Placeholder for applying routing rules to system
-    // This would involve using `ip route add/del` commands
+// Upserts the rows that are new or differ from what was persisted and
+// deletes the ids that went away
+void NetworkPriorityManager::appendRowChanges(const RowMap& current, const RowMap& persisted,
+                                              const std::string& upsert_sql, const std::string& delete_sql,
+                                              const std::string& timestamp,
+                                              std::vector<DatabaseManager::Statement>& statements) {
+    for (const auto& entry : current) {
+        auto it = persisted.find(entry.first);
+        if (it == persisted.end() || it->second != entry.second) {
+            Row params = entry.second;
+            params.push_back(timestamp);
+            statements.emplace_back(upsert_sql, std::move(params));
+        }
+    }
+    
+    for (const auto& entry : persisted) {
+        if (current.count(entry.first) == 0) {
+            statements.emplace_back(delete_sql, Row{entry.first});
+        }
+    }
+}
+
+// Moves each interface's default route to the metric its priority (and
+// failover state, see targetMetric()) asks for. All moves go to the kernel in
+// one batch, each new route before the old one goes.
+bool NetworkPriorityManager::applyInterfaceMetrics() {
+    std::vector<RouteChange> changes;
+    
+    for (const auto& interface : network_interfaces_) {
+        int target = targetMetric(interface);
+        if (!interface.isDefault || target == interface.metric || interface.priority < 0) {
+            continue;
+        }
+        
+        for (const auto& entry : netlink_monitor_.routes()) {
+            const RouteState& route = entry.second;
+            if (route.table != RT_TABLE_MAIN || route.prefix_length != 0 || route.type != RTN_UNICAST ||
+                static_cast<int>(route.metric) != interface.metric ||
+                netlink_monitor_.linkName(route.oif) != interface.name) {
+                continue;
+            }
+            
+            RouteSpec installed = RouteProgrammer::fromState(route, netlink_monitor_.links());
+            RouteSpec moved = installed;
+            moved.metric = static_cast<uint32_t>(target);
+            changes.emplace_back(RouteChange::Add, moved);
+            changes.emplace_back(RouteChange::Delete, installed);
+            break;
+        }
+    }
+    
+    if (changes.empty()) {
+        return true;
+    }
+    
+    std::string error;
+    if (!route_programmer_.commit(changes, error)) {
+        log("Failed to apply interface metrics: " + error);
+        return false;
+    }
+    
+    syncKernelState();
     return true;
 }
 
-std::string NetworkPriorityManager::generateRouteCommand(const RoutingRule& rule, bool add) const {
-    std::string cmd = "ip route ";
-    cmd += add ? "add" : "del";
-    cmd += " " + rule.destination;
+// Makes the kernel's managed routes match the static rules, sending only the
+// difference; replaced lists unmanaged routes to remove in the same batch
+bool NetworkPriorityManager::applyRoutingRules(const std::vector<RouteSpec>& replaced) {
+    std::vector<RouteSpec> desired;
+    for (const auto& rule : routing_rules_) {
+        if (rule.type == "static") {
+            desired.push_back(toRouteSpec(rule));
+        }
+    }
     
-    if (!rule.gateway.empty()) {
-        cmd += " via " + rule.gateway;
+    std::vector<RouteChange> changes = RouteProgrammer::diff(desired, netlink_monitor_.routes(),
+                                                             netlink_monitor_.links());
+    for (const auto& route : replaced) {
+        changes.emplace_back(RouteChange::Delete, route);
     }
     
-    cmd += " dev " + rule.interface;
-    cmd += " metric " + std::to_string(rule.metric);
+    if (changes.empty()) {
+        return true;
+    }
     
-    return cmd;
+    std::string error;
+    if (!route_programmer_.commit(changes, error)) {
+        log("Failed to apply routing rules: " + error);
+        return false;
+    }
+    
+    syncKernelState();
+    return true;
+}
+
+// Notifications for a commit are queued before its acks, so draining the
+// event socket right after brings the mirror up to date
+void NetworkPriorityManager::syncKernelState() {
+    if (!netlink_monitor_.isOpen() || !netlink_monitor_.processEvents()) {
+        netlink_monitor_.dumpAll();
+    }
+    rebuildFromKernelState();
+}
+
+RouteSpec NetworkPriorityManager::toRouteSpec(const RoutingRule& rule) {
+    RouteSpec spec;
+    spec.destination = rule.destination;
+    spec.gateway = rule.gateway;
+    spec.interface = rule.interface;
+    spec.metric = rule.metric > 0 ? static_cast<uint32_t>(rule.metric) : 0;
+    return spec;
 }
 
-std::string NetworkPriorityManager::generateId() const {
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
-    return "np_" + std::to_string(timestamp);
+std::string NetworkPriorityManager::ruleId(const std::string& destination, int metric) {
+    std::string network;
+    int prefix_length = 0;
+    std::string normalized = RouteProgrammer::parseDestination(destination, network, prefix_length)
+                                 ? network + "/" + std::to_string(prefix_length)
+                                 : destination;
+    return "rt_" + normalized + "_" + std::to_string(metric);
 }
 
 std::string NetworkPriorityManager::getCurrentTimestamp() const {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    
-    std::tm tm = *std::localtime(&time_t);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    
-    return oss.str();
+    return UrClock::timestamp();
 }
 
 void NetworkPriorityManager::log(const std::string& message) const {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::tm tm = *std::localtime(&time_t);
+    char timestamp[UrClock::kMillisLength + 1];
+    UrClock::formatMillis(timestamp, std::chrono::system_clock::now());
     
-    std::ostringstream oss;
-    oss << "[" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    oss << "." << std::setfill('0') << std::setw(3) << ms.count() << "] ";
-    oss << "[NetworkPriorityManager] " << message;
-    
-    std::cout << oss.str() << std::endl;
+    std::string line;
+    line.reserve(message.size() + 52);
+    line.append("[").append(timestamp).append("] [NetworkPriorityManager] ").append(message).append("\n");
+    std::cout << line << std::flush;
 }
 
-void NetworkPriorityManager::pushDataToFrontend() const {
-    if (data_update_handler_) {
-        try {
-            nlohmann::json data = getAllDataAsJson();
-            data_update_handler_(data);
-        } catch (const std::exception& e) {
-            log("Error pushing data to frontend: " + std::string(e.what()));
+void NetworkPriorityManager::pushDataToFrontend() {
+    if (!data_update_handler_) {
+        return;
+    }
+    
+    try {
+        // Serialized so concurrent pushes compare against the state the
+        // handler saw last, and reach it in order
+        std::lock_guard<std::mutex> lock(push_mutex_);
+        auto snapshot = getSnapshot();
+        if (snapshot->generation == last_pushed_generation_) {
+            return;
+        }
+        
+        nlohmann::json state = buildPushState(*snapshot);
+        last_pushed_generation_ = snapshot->generation;
+        if (state == last_pushed_) {
+            return;
         }
+        
+        data_update_handler_(state);
+        last_pushed_ = std::move(state);
+    } catch (const std::exception& e) {
+        log("Error pushing data to frontend: " + std::string(e.what()));
     }
 }
 
+// Interfaces and rules keyed by id, without the refresh timestamps, so two
+// collections of the same kernel state compare equal and a change to one
+// entry only touches that entry's key
+nlohmann::json NetworkPriorityManager::buildPushState(const NetworkPrioritySnapshot& snapshot) {
+    nlohmann::json interfaces_json = nlohmann::json::object();
+    for (const auto& interface : snapshot.interfaces_json) {
+        interfaces_json[interface["id"].get<std::string>()] = interface;
+    }
+    
+    nlohmann::json rules_json = nlohmann::json::object();
+    for (const auto& rule : snapshot.rules_json) {
+        rules_json[rule["id"].get<std::string>()] = rule;
+    }
+    
+    const NetworkStatistics& stats = snapshot.statistics;
+    return {
+        {"networkInterfaces", interfaces_json},
+        {"routingRules", rules_json},
+        {"statistics", {
+            {"total", stats.total},
+            {"online", stats.online},
+            {"offline", stats.offline},
+            {"reachable", stats.reachable},
+            {"activeRules", stats.activeRules}
+        }}
+    };
+}
+
 nlohmann::json NetworkPriorityManager::interfaceToJson(const NetworkInterface& interface) const {
     return {
         {"id", interface.id},
@@ -888,6 +1499,7 @@ nlohmann::json NetworkPriorityManager::interfaceToJson(const NetworkInterface& i
         {"gateway", interface.gateway},
         {"netmask", interface.netmask},
         {"status", interface.status},
+        {"reachability", interface.reachability},
         {"metric", interface.metric},
         {"priority", interface.priority},
         {"type", interface.type},
@@ -915,6 +1527,7 @@ nlohmann::json NetworkPriorityManager::statisticsToJson(const NetworkStatistics&
         {"total", stats.total},
         {"online", stats.online},
         {"offline", stats.offline},
+        {"reachable", stats.reachable},
         {"activeRules", stats.activeRules},
         {"lastUpdated", stats.lastUpdated}
     };
@@ -0,0 +1,222 @@
+#include "ReachabilityProber.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unordered_set>
+#include <netdb.h>
+#include <unistd.h>
+
+ReachabilityProber::ReachabilityProber()
+    : permitted_(true), pending_(0), in_round_(false) {
+    setSettings(Settings());
+}
+
+ReachabilityProber::~ReachabilityProber() {
+    closeProbes();
+}
+
+bool ReachabilityProber::setSettings(const Settings& settings) {
+    std::vector<Target> targets;
+    for (const auto& name : settings.targets) {
+        Target target;
+        if (!parseTarget(name, target)) {
+            log("Invalid reachability target (expected numeric address:port): " + name);
+            return false;
+        }
+        targets.push_back(target);
+    }
+
+    settings_ = settings;
+    settings_.down_after = std::max(1, settings_.down_after);
+    settings_.up_after = std::max(1, settings_.up_after);
+    targets_ = std::move(targets);
+    return true;
+}
+
+void ReachabilityProber::startRound(const std::vector<std::string>& interfaces, Clock::time_point now) {
+    std::unordered_set<std::string> listed(interfaces.begin(), interfaces.end());
+    for (auto it = interfaces_.begin(); it != interfaces_.end(); ) {
+        it = listed.count(it->first) ? std::next(it) : interfaces_.erase(it);
+    }
+
+    round_started_ = now;
+    next_round_ = now + std::chrono::milliseconds(settings_.interval_ms);
+    pending_ = 0;
+
+    for (const auto& name : interfaces) {
+        Interface& interface = interfaces_[name];
+        interface.round_ms = -1.0;
+        for (const auto& target : targets_) {
+            int fd = openProbe(name, target);
+            if (!permitted_) {
+                log("SO_BINDTODEVICE not permitted (needs CAP_NET_RAW), reachability probing disabled");
+                closeProbes();
+                interfaces_.clear();
+                return;
+            }
+            if (fd == -2) {
+                // Answered (refused) straight away
+                interface.round_ms = 0.0;
+            } else if (fd >= 0) {
+                probes_.push_back(Probe{&interface, fd});
+                pending_++;
+            }
+        }
+    }
+    in_round_ = !interfaces.empty();
+}
+
+ReachabilityProber::Clock::time_point ReachabilityProber::nextWakeup() const {
+    if (in_round_) {
+        return pending_ == 0 ? round_started_ : round_started_ + std::chrono::milliseconds(settings_.timeout_ms);
+    }
+    return isEnabled() ? next_round_ : Clock::time_point::max();
+}
+
+void ReachabilityProber::appendPollFds(std::vector<pollfd>& fds) const {
+    for (const auto& probe : probes_) {
+        if (probe.fd >= 0) {
+            fds.push_back({probe.fd, POLLOUT, 0});
+        }
+    }
+}
+
+bool ReachabilityProber::handlePollFds(const pollfd* fds, size_t count, Clock::time_point now) {
+    double elapsed_ms = std::chrono::duration<double, std::milli>(now - round_started_).count();
+    for (size_t i = 0; i < count; ++i) {
+        if (fds[i].revents == 0) {
+            continue;
+        }
+        for (auto& probe : probes_) {
+            if (probe.fd != fds[i].fd) {
+                continue;
+            }
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(probe.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error == 0 || error == ECONNREFUSED) {
+                double& best = probe.interface->round_ms;
+                best = best < 0.0 ? elapsed_ms : std::min(best, elapsed_ms);
+            }
+            close(probe.fd);
+            probe.fd = -1;
+            pending_--;
+            break;
+        }
+    }
+    return in_round_ && pending_ == 0;
+}
+
+bool ReachabilityProber::finishRound(Clock::time_point now) {
+    if (!in_round_ || (pending_ > 0 && now < round_started_ + std::chrono::milliseconds(settings_.timeout_ms))) {
+        return false;
+    }
+    closeProbes();
+    in_round_ = false;
+
+    bool changed = false;
+    for (auto& entry : interfaces_) {
+        Interface& interface = entry.second;
+        bool good = interface.round_ms >= 0.0;
+        interface.status.latency_ms = interface.round_ms;
+        interface.good_rounds = good ? interface.good_rounds + 1 : 0;
+        interface.failed_rounds = good ? 0 : interface.failed_rounds + 1;
+
+        State state = interface.status.state;
+        if (state == State::Unknown) {
+            state = good ? State::Reachable : State::Unreachable;
+        } else if (good && interface.good_rounds >= settings_.up_after) {
+            state = State::Reachable;
+        } else if (!good && interface.failed_rounds >= settings_.down_after) {
+            state = State::Unreachable;
+        }
+
+        if (state != interface.status.state) {
+            log(entry.first + " " + toString(state));
+            interface.status.state = state;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+ReachabilityProber::Status ReachabilityProber::status(const std::string& interface) const {
+    auto it = interfaces_.find(interface);
+    return it != interfaces_.end() ? it->second.status : Status();
+}
+
+const char* ReachabilityProber::toString(State state) {
+    switch (state) {
+        case State::Reachable: return "reachable";
+        case State::Unreachable: return "unreachable";
+        default: return "unknown";
+    }
+}
+
+// The socket of a connect in progress; -2 when the target answered at once,
+// -1 when the probe could not start (no route through the interface counts
+// as a failed probe)
+int ReachabilityProber::openProbe(const std::string& interface, const Target& target) {
+    int fd = socket(target.address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, interface.c_str(),
+                   static_cast<socklen_t>(interface.size() + 1)) != 0) {
+        permitted_ = errno != EPERM;
+        close(fd);
+        return -1;
+    }
+
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&target.address), target.length) != 0 &&
+        errno != EINPROGRESS) {
+        int error = errno;
+        close(fd);
+        return error == ECONNREFUSED ? -2 : -1;
+    }
+    return fd;
+}
+
+void ReachabilityProber::closeProbes() {
+    for (auto& probe : probes_) {
+        if (probe.fd >= 0) {
+            close(probe.fd);
+        }
+    }
+    probes_.clear();
+    pending_ = 0;
+}
+
+// Numeric only, so a round never waits on DNS: "a.b.c.d:port" or "[v6]:port"
+bool ReachabilityProber::parseTarget(const std::string& name, Target& target) {
+    size_t colon = name.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 >= name.size()) {
+        return false;
+    }
+
+    std::string host = name.substr(0, colon);
+    std::string port = name.substr(colon + 1);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result) {
+        return false;
+    }
+    std::memcpy(&target.address, result->ai_addr, result->ai_addrlen);
+    target.length = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+void ReachabilityProber::log(const std::string& message) const {
+    std::cout << "[ReachabilityProber] " << message << std::endl;
+}
@@ -0,0 +1,322 @@
+#include "RouteProgrammer.h"
+#include <iostream>
+#include <algorithm>
+#include <set>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+void appendAttribute(std::vector<char>& buffer, nlmsghdr*& header, unsigned short type,
+                     const void* data, size_t length) {
+    size_t offset = NLMSG_ALIGN(header->nlmsg_len);
+    size_t attr_length = RTA_LENGTH(length);
+    size_t header_offset = reinterpret_cast<char*>(header) - buffer.data();
+
+    buffer.resize(header_offset + offset + RTA_ALIGN(attr_length));
+    header = reinterpret_cast<nlmsghdr*>(buffer.data() + header_offset);
+
+    rtattr* attr = reinterpret_cast<rtattr*>(buffer.data() + header_offset + offset);
+    attr->rta_type = type;
+    attr->rta_len = static_cast<unsigned short>(attr_length);
+    std::memcpy(RTA_DATA(attr), data, length);
+    header->nlmsg_len = static_cast<uint32_t>(offset + RTA_ALIGN(attr_length));
+}
+
+} // namespace
+
+RouteSpec::RouteSpec() : metric(0), table(RT_TABLE_MAIN) {
+}
+
+std::string RouteSpec::key() const {
+    RouteState state;
+    state.table = table;
+    state.metric = metric;
+    if (!RouteProgrammer::parseDestination(destination, state.destination, state.prefix_length)) {
+        return "";
+    }
+    return state.key();
+}
+
+RouteProgrammer::RouteProgrammer() : sequence_(1) {
+}
+
+bool RouteProgrammer::commit(const std::vector<RouteChange>& changes, std::string& error) {
+    if (changes.empty()) {
+        return true;
+    }
+
+    std::vector<size_t> failed;
+    if (!sendBatch(changes, failed, error)) {
+        return false;
+    }
+
+    if (failed.empty()) {
+        log("Committed " + std::to_string(changes.size()) + " route change(s)");
+        return true;
+    }
+
+    // Undo the changes that went through, newest first
+    std::vector<RouteChange> rollback;
+    for (size_t i = changes.size(); i-- > 0;) {
+        if (std::find(failed.begin(), failed.end(), i) == failed.end()) {
+            rollback.emplace_back(changes[i].action == RouteChange::Add ? RouteChange::Delete : RouteChange::Add,
+                                  changes[i].route);
+        }
+    }
+
+    std::vector<size_t> rollback_failed;
+    std::string rollback_error;
+    if (!rollback.empty() && (!sendBatch(rollback, rollback_failed, rollback_error) || !rollback_failed.empty())) {
+        log("Rollback incomplete: " + (rollback_error.empty() ? std::to_string(rollback_failed.size()) +
+                                       " change(s) could not be reverted" : rollback_error));
+    }
+
+    log("Route batch rejected, " + std::to_string(rollback.size()) + " applied change(s) rolled back: " + error);
+    return false;
+}
+
+bool RouteProgrammer::sendBatch(const std::vector<RouteChange>& changes, std::vector<size_t>& failed,
+                                std::string& error) {
+    std::vector<char> buffer;
+    uint32_t first_sequence = sequence_;
+    for (const auto& change : changes) {
+        if (!encode(change, sequence_++, buffer, error)) {
+            return false;
+        }
+    }
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        error = "netlink socket: " + std::string(std::strerror(errno));
+        return false;
+    }
+
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+    iovec iov = {buffer.data(), buffer.size()};
+    msghdr message{};
+    message.msg_name = &kernel;
+    message.msg_namelen = sizeof(kernel);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+
+    if (sendmsg(fd, &message, 0) < 0) {
+        error = "netlink send: " + std::string(std::strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    // The kernel handles each message in turn and acks every one
+    size_t acked = 0;
+    char reply[8192];
+    while (acked < changes.size()) {
+        ssize_t length = recv(fd, reply, sizeof(reply), 0);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = "netlink receive: " + std::string(std::strerror(errno));
+            close(fd);
+            return false;
+        }
+
+        int remaining = static_cast<int>(length);
+        for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(reply);
+             NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_type != NLMSG_ERROR) {
+                continue;
+            }
+
+            const nlmsgerr* ack = static_cast<const nlmsgerr*>(NLMSG_DATA(header));
+            size_t index = header->nlmsg_seq - first_sequence;
+            if (index >= changes.size()) {
+                continue;
+            }
+
+            acked++;
+            if (ack->error != 0) {
+                const RouteChange& change = changes[index];
+                failed.push_back(index);
+                if (error.empty()) {
+                    error = std::string(change.action == RouteChange::Add ? "add " : "delete ") +
+                            change.route.destination + " dev " + change.route.interface + " metric " +
+                            std::to_string(change.route.metric) + ": " + std::strerror(-ack->error);
+                }
+            }
+        }
+    }
+
+    close(fd);
+    return true;
+}
+
+bool RouteProgrammer::encode(const RouteChange& change, uint32_t sequence, std::vector<char>& buffer,
+                             std::string& error) const {
+    const RouteSpec& route = change.route;
+
+    std::string network;
+    int prefix_length = 0;
+    in_addr destination{};
+    if (!parseDestination(route.destination, network, prefix_length) ||
+        inet_pton(AF_INET, network.c_str(), &destination) != 1) {
+        error = "invalid destination: " + route.destination;
+        return false;
+    }
+
+    in_addr gateway{};
+    if (!route.gateway.empty() && inet_pton(AF_INET, route.gateway.c_str(), &gateway) != 1) {
+        error = "invalid gateway: " + route.gateway;
+        return false;
+    }
+
+    int oif = 0;
+    if (!route.interface.empty()) {
+        oif = static_cast<int>(if_nametoindex(route.interface.c_str()));
+        if (oif == 0) {
+            error = "unknown interface: " + route.interface;
+            return false;
+        }
+    }
+
+    size_t offset = buffer.size();
+    buffer.resize(offset + NLMSG_SPACE(sizeof(rtmsg)));
+    nlmsghdr* header = reinterpret_cast<nlmsghdr*>(buffer.data() + offset);
+    std::memset(header, 0, NLMSG_SPACE(sizeof(rtmsg)));
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(rtmsg));
+    header->nlmsg_seq = sequence;
+
+    rtmsg* info = static_cast<rtmsg*>(NLMSG_DATA(header));
+    info->rtm_family = AF_INET;
+    info->rtm_dst_len = static_cast<unsigned char>(prefix_length);
+    info->rtm_table = route.table < 256 ? static_cast<unsigned char>(route.table)
+                                          : static_cast<unsigned char>(RT_TABLE_UNSPEC);
+
+    if (change.action == RouteChange::Add) {
+        header->nlmsg_type = RTM_NEWROUTE;
+        header->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_EXCL;
+        info->rtm_protocol = kManagedProtocol;
+        info->rtm_scope = route.gateway.empty() ? RT_SCOPE_LINK : RT_SCOPE_UNIVERSE;
+        info->rtm_type = RTN_UNICAST;
+    } else {
+        header->nlmsg_type = RTM_DELROUTE;
+        header->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+        info->rtm_scope = RT_SCOPE_NOWHERE;
+    }
+
+    if (prefix_length > 0) {
+        appendAttribute(buffer, header, RTA_DST, &destination, sizeof(destination));
+    }
+    if (!route.gateway.empty()) {
+        appendAttribute(buffer, header, RTA_GATEWAY, &gateway, sizeof(gateway));
+    }
+    if (oif != 0) {
+        appendAttribute(buffer, header, RTA_OIF, &oif, sizeof(oif));
+    }
+    appendAttribute(buffer, header, RTA_PRIORITY, &route.metric, sizeof(route.metric));
+    appendAttribute(buffer, header, RTA_TABLE, &route.table, sizeof(route.table));
+
+    buffer.resize(offset + NLMSG_ALIGN(header->nlmsg_len));
+    return true;
+}
+
+std::vector<RouteChange> RouteProgrammer::diff(const std::vector<RouteSpec>& desired,
+                                               const std::map<std::string, RouteState>& current,
+                                               const std::map<int, LinkState>& links) {
+    std::vector<RouteChange> changes;
+    std::set<std::string> wanted;
+
+    // A route whose gateway or interface moved keeps its key (destination,
+    // metric, table), so the old one is deleted before the new one is added,
+    // which would otherwise be refused as a duplicate. Both go in the same
+    // batch, which is reverted as a whole if either fails.
+    for (const auto& route : desired) {
+        std::string key = route.key();
+        wanted.insert(key);
+
+        auto it = current.find(key);
+        if (it == current.end()) {
+            changes.emplace_back(RouteChange::Add, route);
+            continue;
+        }
+
+        // A kernel, DHCP or administrator route holds the key; it is not
+        // ours to replace
+        if (it->second.protocol != kManagedProtocol) {
+            continue;
+        }
+
+        RouteSpec installed = fromState(it->second, links);
+        if (installed.gateway != route.gateway || installed.interface != route.interface) {
+            changes.emplace_back(RouteChange::Delete, installed);
+            changes.emplace_back(RouteChange::Add, route);
+        }
+    }
+
+    for (const auto& entry : current) {
+        if (entry.second.protocol == kManagedProtocol && wanted.count(entry.first) == 0) {
+            changes.emplace_back(RouteChange::Delete, fromState(entry.second, links));
+        }
+    }
+
+    return changes;
+}
+
+RouteSpec RouteProgrammer::fromState(const RouteState& route, const std::map<int, LinkState>& links) {
+    RouteSpec spec;
+    spec.destination = route.destination + "/" + std::to_string(route.prefix_length);
+    spec.gateway = route.gateway;
+    spec.metric = route.metric;
+    spec.table = route.table;
+
+    auto link = links.find(route.oif);
+    if (link != links.end()) {
+        spec.interface = link->second.name;
+    }
+    return spec;
+}
+
+// Splits "a.b.c.d/len"; "default" and a bare address (/32) are accepted too
+bool RouteProgrammer::parseDestination(const std::string& cidr, std::string& network, int& prefix_length) {
+    if (cidr == "default") {
+        network = "0.0.0.0";
+        prefix_length = 0;
+        return true;
+    }
+
+    size_t slash = cidr.find('/');
+    network = cidr.substr(0, slash);
+    prefix_length = 32;
+
+    if (slash != std::string::npos) {
+        std::string length = cidr.substr(slash + 1);
+        if (length.empty() || length.size() > 2 ||
+            !std::all_of(length.begin(), length.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            return false;
+        }
+        prefix_length = std::stoi(length);
+    }
+
+    in_addr address{};
+    if (prefix_length > 32 || inet_pton(AF_INET, network.c_str(), &address) != 1) {
+        return false;
+    }
+
+    // Normalize to the network address so keys match the kernel's
+    uint32_t mask = prefix_length == 0 ? 0 : htonl(~((prefix_length == 32 ? 0u : (1u << (32 - prefix_length)) - 1)));
+    address.s_addr &= mask;
+    char text[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &address, text, sizeof(text));
+    network = text;
+    return true;
+}
+
+void RouteProgrammer::log(const std::string& message) const {
+    std::cout << "[RouteProgrammer] " << message << std::endl;
+}
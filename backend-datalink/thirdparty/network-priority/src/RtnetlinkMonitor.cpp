@@ -0,0 +1,340 @@
+#include "RtnetlinkMonitor.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kReceiveBufferSize = 32 * 1024;
+
+std::string ipv4ToString(const void* data) {
+    char text[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, data, text, sizeof(text));
+    return text;
+}
+
+int openSocket(uint32_t groups) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        return -1;
+    }
+
+    sockaddr_nl address{};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = groups;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+} // namespace
+
+std::string RouteState::key() const {
+    return std::to_string(table) + "|" + destination + "/" + std::to_string(prefix_length) +
+           "|" + std::to_string(metric);
+}
+
+RtnetlinkMonitor::RtnetlinkMonitor() : event_fd_(-1), sequence_(1) {
+}
+
+RtnetlinkMonitor::~RtnetlinkMonitor() {
+    close();
+}
+
+bool RtnetlinkMonitor::open() {
+    if (event_fd_ >= 0) {
+        return true;
+    }
+
+    event_fd_ = openSocket(RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV4_ROUTE);
+    if (event_fd_ < 0) {
+        log("Failed to open netlink event socket: " + std::string(std::strerror(errno)));
+        return false;
+    }
+
+    // Room for a burst of route changes (e.g. a failover flushing a table)
+    int buffer_size = 1024 * 1024;
+    setsockopt(event_fd_, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    return true;
+}
+
+void RtnetlinkMonitor::close() {
+    if (event_fd_ >= 0) {
+        ::close(event_fd_);
+        event_fd_ = -1;
+    }
+}
+
+bool RtnetlinkMonitor::dumpAll() {
+    links_.clear();
+    addresses_.clear();
+    routes_.clear();
+
+    return dump(RTM_GETLINK) && dump(RTM_GETADDR) && dump(RTM_GETROUTE);
+}
+
+// Runs one dump request on its own socket so replies never interleave with
+// change notifications
+bool RtnetlinkMonitor::dump(int request_type) {
+    int fd = openSocket(0);
+    if (fd < 0) {
+        log("Failed to open netlink dump socket: " + std::string(std::strerror(errno)));
+        return false;
+    }
+
+    struct {
+        nlmsghdr header;
+        rtgenmsg message;
+    } request{};
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(rtgenmsg));
+    request.header.nlmsg_type = static_cast<uint16_t>(request_type);
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = sequence_++;
+    request.message.rtgen_family = request_type == RTM_GETLINK ? AF_UNSPEC : AF_INET;
+
+    if (send(fd, &request, request.header.nlmsg_len, 0) < 0) {
+        log("Failed to send netlink dump request: " + std::string(std::strerror(errno)));
+        ::close(fd);
+        return false;
+    }
+
+    char buffer[kReceiveBufferSize];
+    bool done = false;
+    bool ok = true;
+    while (!done && ok) {
+        ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log("Failed to read netlink dump: " + std::string(std::strerror(errno)));
+            ok = false;
+            break;
+        }
+        ok = applyMessages(buffer, static_cast<size_t>(length), request.header.nlmsg_seq, done);
+    }
+
+    ::close(fd);
+    return ok;
+}
+
+bool RtnetlinkMonitor::processEvents() {
+    if (event_fd_ < 0) {
+        return false;
+    }
+
+    char buffer[kReceiveBufferSize];
+    bool changed = false;
+
+    for (;;) {
+        ssize_t length = recv(event_fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                // The kernel dropped notifications; only a full dump is exact
+                log("Netlink event socket overran, resynchronizing");
+                dumpAll();
+                changed = true;
+                continue;
+            }
+            break; // EAGAIN: queue drained
+        }
+        if (length == 0) {
+            break;
+        }
+
+        bool done = false;
+        if (applyMessages(buffer, static_cast<size_t>(length), 0, done)) {
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+// Applies a datagram of netlink messages. For dumps (sequence != 0) returns
+// false on an error reply and sets done at NLMSG_DONE; for notifications
+// returns whether anything changed.
+bool RtnetlinkMonitor::applyMessages(const char* buffer, size_t length, uint32_t sequence, bool& done) {
+    bool changed = false;
+    int remaining = static_cast<int>(length);
+
+    for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(buffer);
+         NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+        if (sequence != 0 && header->nlmsg_seq != sequence) {
+            continue;
+        }
+
+        if (header->nlmsg_type == NLMSG_DONE) {
+            done = true;
+            return true;
+        }
+
+        if (header->nlmsg_type == NLMSG_ERROR) {
+            const nlmsgerr* error = static_cast<const nlmsgerr*>(NLMSG_DATA(header));
+            if (error->error != 0) {
+                log("Netlink error reply: " + std::string(std::strerror(-error->error)));
+                done = true;
+                return false;
+            }
+            continue;
+        }
+
+        if (applyMessage(header)) {
+            changed = true;
+        }
+    }
+
+    return sequence != 0 ? true : changed;
+}
+
+bool RtnetlinkMonitor::applyMessage(const nlmsghdr* header) {
+    switch (header->nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK: {
+        const ifinfomsg* info = static_cast<const ifinfomsg*>(NLMSG_DATA(header));
+        if (header->nlmsg_type == RTM_DELLINK) {
+            addresses_.erase(info->ifi_index);
+            eraseRoutesVia(info->ifi_index);
+            return links_.erase(info->ifi_index) > 0;
+        }
+
+        LinkState link;
+        link.index = info->ifi_index;
+        link.flags = info->ifi_flags;
+
+        int attr_length = static_cast<int>(IFLA_PAYLOAD(header));
+        for (const rtattr* attr = IFLA_RTA(info); RTA_OK(attr, attr_length); attr = RTA_NEXT(attr, attr_length)) {
+            if (attr->rta_type == IFLA_IFNAME) {
+                link.name = static_cast<const char*>(RTA_DATA(attr));
+            } else if (attr->rta_type == IFLA_OPERSTATE) {
+                link.operstate = *static_cast<const unsigned char*>(RTA_DATA(attr));
+            }
+        }
+
+        // IPv4 flushes the routes of a link that goes down without sending
+        // RTM_DELROUTE for each of them
+        auto previous = links_.find(link.index);
+        if (previous != links_.end() && (previous->second.flags & IFF_UP) && !(link.flags & IFF_UP)) {
+            eraseRoutesVia(link.index);
+        }
+
+        links_[link.index] = link;
+        return true;
+    }
+
+    case RTM_NEWADDR:
+    case RTM_DELADDR: {
+        const ifaddrmsg* info = static_cast<const ifaddrmsg*>(NLMSG_DATA(header));
+        if (info->ifa_family != AF_INET) {
+            return false;
+        }
+
+        AddressState address;
+        address.index = static_cast<int>(info->ifa_index);
+        address.prefix_length = info->ifa_prefixlen;
+
+        int attr_length = static_cast<int>(IFA_PAYLOAD(header));
+        for (const rtattr* attr = IFA_RTA(info); RTA_OK(attr, attr_length); attr = RTA_NEXT(attr, attr_length)) {
+            // IFA_LOCAL is the interface address; IFA_ADDRESS is the peer on
+            // point-to-point links and only used when there is no local one
+            if (attr->rta_type == IFA_LOCAL || (attr->rta_type == IFA_ADDRESS && address.address.empty())) {
+                address.address = ipv4ToString(RTA_DATA(attr));
+            }
+        }
+
+        auto range = addresses_.equal_range(address.index);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.address == address.address) {
+                addresses_.erase(it);
+                break;
+            }
+        }
+
+        if (header->nlmsg_type == RTM_NEWADDR) {
+            addresses_.emplace(address.index, address);
+        }
+        return true;
+    }
+
+    case RTM_NEWROUTE:
+    case RTM_DELROUTE: {
+        const rtmsg* info = static_cast<const rtmsg*>(NLMSG_DATA(header));
+        if (info->rtm_family != AF_INET) {
+            return false;
+        }
+
+        RouteState route;
+        route.table = info->rtm_table;
+        route.prefix_length = info->rtm_dst_len;
+        route.protocol = info->rtm_protocol;
+        route.scope = info->rtm_scope;
+        route.type = info->rtm_type;
+        route.destination = "0.0.0.0";
+
+        int attr_length = static_cast<int>(RTM_PAYLOAD(header));
+        for (const rtattr* attr = RTM_RTA(info); RTA_OK(attr, attr_length); attr = RTA_NEXT(attr, attr_length)) {
+            switch (attr->rta_type) {
+            case RTA_TABLE:
+                route.table = *static_cast<const uint32_t*>(RTA_DATA(attr));
+                break;
+            case RTA_DST:
+                route.destination = ipv4ToString(RTA_DATA(attr));
+                break;
+            case RTA_GATEWAY:
+                route.gateway = ipv4ToString(RTA_DATA(attr));
+                break;
+            case RTA_OIF:
+                route.oif = *static_cast<const int*>(RTA_DATA(attr));
+                break;
+            case RTA_PRIORITY:
+                route.metric = *static_cast<const uint32_t*>(RTA_DATA(attr));
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (header->nlmsg_type == RTM_DELROUTE) {
+            return routes_.erase(route.key()) > 0;
+        }
+
+        routes_[route.key()] = route;
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+void RtnetlinkMonitor::eraseRoutesVia(int index) {
+    for (auto it = routes_.begin(); it != routes_.end();) {
+        if (it->second.oif == index) {
+            it = routes_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::string RtnetlinkMonitor::linkName(int index) const {
+    auto it = links_.find(index);
+    return it != links_.end() ? it->second.name : "";
+}
+
+void RtnetlinkMonitor::log(const std::string& message) const {
+    std::cout << "[RtnetlinkMonitor] " << message << std::endl;
+}
@@ -0,0 +1,66 @@
+#ifndef EXTERNAL_IP_RESOLVER_H
+#define EXTERNAL_IP_RESOLVER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <sys/types.h>
+
+// Looks up the public address on its own thread and caches it. A lookup
+// asks the endpoints in order ("curl <url>", whose whole answer must be an
+// IPv4 or IPv6 address) until one answers. The cached address is refreshed
+// once per TTL, and as soon as the kernel reports (over rtnetlink) that the
+// default route or an interface address changed. Failed lookups are retried
+// with backoff, from 30 s up to the TTL.
+class ExternalIpResolver {
+public:
+    // Called on the resolver thread after every lookup, with the address or
+    // "N/A" when no endpoint answered
+    using ResultCallback = std::function<void(const std::string& address)>;
+
+    ExternalIpResolver();
+    ~ExternalIpResolver();
+
+    ExternalIpResolver(const ExternalIpResolver&) = delete;
+    ExternalIpResolver& operator=(const ExternalIpResolver&) = delete;
+
+    // Configuration; takes effect on start(). Endpoints must be http(s) URLs.
+    bool setEndpoints(const std::vector<std::string>& endpoints);
+    void setTtl(int ttl_ms) { ttl_ms_ = ttl_ms; }
+    void setResultCallback(ResultCallback callback) { callback_ = std::move(callback); }
+
+    bool start();
+    // Kills a lookup in progress
+    void stop();
+    bool isRunning() const { return running_.load(); }
+
+    // Last looked-up address, "N/A" before the first answer
+    std::string getAddress() const;
+
+private:
+    std::atomic<bool> running_;
+    std::thread resolver_thread_;
+    std::vector<std::string> endpoints_;
+    int ttl_ms_;
+    ResultCallback callback_;
+
+    int wake_fd_;                  // eventfd, readable once stopping
+    std::mutex child_mutex_;       // Held while child_pid_ is killed or cleared
+    pid_t child_pid_;              // curl in progress, 0 when none
+
+    mutable std::mutex address_mutex_;
+    std::string address_;
+
+    void resolveLoop();
+    std::string lookup();
+    std::string fetch(const std::string& url);
+    static int openRouteMonitor();
+    static bool routeChanged(int netlink_fd);
+    static bool isAddress(const std::string& text);
+    void logError(const std::string& message);
+};
+
+#endif // EXTERNAL_IP_RESOLVER_H
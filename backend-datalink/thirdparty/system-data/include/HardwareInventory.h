@@ -0,0 +1,59 @@
+#ifndef HARDWARE_INVENTORY_H
+#define HARDWARE_INVENTORY_H
+
+#include <string>
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+// The parts of the hardware that only change on hotplug: online CPU count,
+// sensor and cpufreq files, and network interface MAC addresses. Discovered
+// once on construction; after start() a thread follows kernel uevents
+// (NETLINK_KOBJECT_UEVENT) for the cpu, net, thermal and hwmon subsystems
+// and rediscovers when one arrives. Samplers read the current inventory and
+// only touch the values that change between ticks.
+class HardwareInventory {
+public:
+    struct Inventory {
+        uint64_t generation = 0;       // Bumped on every rediscovery
+        int cpu_cores = 1;             // Online CPUs
+        std::string temperature_path;  // Empty when the board has no sensor
+        std::string frequency_path;    // Empty without a cpufreq driver
+        std::map<std::string, std::string> mac_addresses; // Ethernet-type interfaces by name
+    };
+
+    HardwareInventory();
+    ~HardwareInventory();
+
+    HardwareInventory(const HardwareInventory&) = delete;
+    HardwareInventory& operator=(const HardwareInventory&) = delete;
+
+    bool start();
+    void stop();
+    bool isRunning() const { return running_.load(); }
+
+    // Samplers compare generation with the one they last saw
+    std::shared_ptr<const Inventory> get() const;
+
+private:
+    std::atomic<bool> running_;
+    std::thread monitor_thread_;
+    int wake_fd_;                      // eventfd, readable once stopping
+
+    // Swapped with std::atomic_store; written by the inventory thread only
+    std::shared_ptr<const Inventory> inventory_;
+
+    void monitorLoop();
+    void rediscover();
+    static std::shared_ptr<Inventory> discover();
+    static int countOnlineCpus();
+    static std::string firstReadablePath(const char* const* paths);
+    static std::map<std::string, std::string> readMacAddresses();
+    static int openUeventSocket();
+    static bool hardwareChanged(int uevent_fd);
+    void logError(const std::string& message);
+};
+
+#endif // HARDWARE_INVENTORY_H
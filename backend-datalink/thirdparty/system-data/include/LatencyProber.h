@@ -0,0 +1,85 @@
+#ifndef LATENCY_PROBER_H
+#define LATENCY_PROBER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "MetricsTypes.h"
+
+// Measures round-trip latency to a set of "host:port" targets with
+// non-blocking TCP connects on its own thread. A SYN answered by SYN-ACK or
+// RST counts as one round trip; anything else within the timeout is a loss.
+// Every target keeps a rolling window of results for min/avg/max/jitter.
+class LatencyProber {
+public:
+    struct TargetStats {
+        FixedString<64> target;  // "host:port", truncated for display
+        bool reachable = false;  // Last probe got an answer
+        double last_ms = 0.0;
+        double min_ms = 0.0;
+        double avg_ms = 0.0;
+        double max_ms = 0.0;
+        double jitter_ms = 0.0;  // Mean difference between consecutive answers
+        double loss_percent = 0.0;
+        int samples = 0;         // Probes in the window
+    };
+
+    using ResultCallback = std::function<void(const std::vector<TargetStats>&)>;
+
+    LatencyProber();
+    ~LatencyProber();
+
+    LatencyProber(const LatencyProber&) = delete;
+    LatencyProber& operator=(const LatencyProber&) = delete;
+
+    // Configuration; takes effect on start()
+    bool setTargets(const std::vector<std::string>& targets);
+    void setInterval(int interval_ms) { interval_ms_ = interval_ms; }
+    void setTimeout(int timeout_ms) { timeout_ms_ = timeout_ms; }
+    void setWindowSize(size_t window_size) { window_size_ = window_size > 0 ? window_size : 1; }
+
+    // Called on the prober thread after every round
+    void setResultCallback(ResultCallback callback) { callback_ = std::move(callback); }
+
+    bool start();
+    void stop();
+    bool isRunning() const { return running_.load(); }
+
+    std::vector<TargetStats> getStats() const;
+
+private:
+    struct Target {
+        std::string name;
+        std::string host;
+        std::string port;
+        std::vector<double> window; // Round trips in ms, negative for a loss
+        size_t next = 0;            // Slot the next result goes into
+        size_t count = 0;
+    };
+
+    std::atomic<bool> running_;
+    std::thread prober_thread_;
+    int interval_ms_;
+    std::atomic<int> timeout_ms_;      // May change while probing
+    size_t window_size_;
+    ResultCallback callback_;
+
+    mutable std::mutex targets_mutex_;
+    std::vector<Target> targets_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+
+    void probeLoop();
+    std::vector<double> probeRound(const std::vector<Target>& targets);
+    static TargetStats summarize(const Target& target);
+    static bool splitTarget(const std::string& target, std::string& host, std::string& port);
+    void logError(const std::string& message);
+};
+
+#endif // LATENCY_PROBER_H
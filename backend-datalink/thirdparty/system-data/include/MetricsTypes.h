@@ -0,0 +1,122 @@
+#ifndef METRICS_TYPES_H
+#define METRICS_TYPES_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Building blocks that keep SystemMetrics trivially copyable: a snapshot
+// copy is one memcpy, with no heap allocation per string or list.
+
+// NUL-terminated string stored inline, truncated to N - 1 characters
+template <size_t N>
+class FixedString {
+public:
+    FixedString() { data_[0] = '\0'; }
+    FixedString(const char* value) { assign(value, std::strlen(value)); }
+    FixedString(const std::string& value) { assign(value.data(), value.size()); }
+
+    FixedString& operator=(const char* value) {
+        assign(value, std::strlen(value));
+        return *this;
+    }
+    FixedString& operator=(const std::string& value) {
+        assign(value.data(), value.size());
+        return *this;
+    }
+
+    void assign(const char* value, size_t length) {
+        length = std::min(length, N - 1);
+        std::memmove(data_, value, length);
+        data_[length] = '\0';
+    }
+
+    const char* c_str() const { return data_; }
+    size_t size() const { return std::strlen(data_); }
+    bool empty() const { return data_[0] == '\0'; }
+    static constexpr size_t capacity() { return N - 1; }
+
+    bool operator==(const char* other) const { return std::strcmp(data_, other) == 0; }
+    bool operator==(const std::string& other) const { return other == data_; }
+    template <size_t M>
+    bool operator==(const FixedString<M>& other) const { return std::strcmp(data_, other.c_str()) == 0; }
+    template <typename Other>
+    bool operator!=(const Other& other) const { return !(*this == other); }
+
+private:
+    char data_[N];
+};
+
+// Up to N elements stored inline; push_back() drops what does not fit
+template <typename T, size_t N>
+class FixedVector {
+public:
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    static constexpr size_t capacity() { return N; }
+
+    void clear() { size_ = 0; }
+    bool push_back(const T& value) {
+        if (size_ == N) {
+            return false;
+        }
+        items_[size_++] = value;
+        return true;
+    }
+    // New elements are value-initialized; count is clamped to N
+    void resize(size_t count) {
+        count = std::min(count, N);
+        for (size_t i = size_; i < count; ++i) {
+            items_[i] = T();
+        }
+        size_ = count;
+    }
+
+    T& operator[](size_t index) { return items_[index]; }
+    const T& operator[](size_t index) const { return items_[index]; }
+    T* begin() { return items_; }
+    T* end() { return items_ + size_; }
+    const T* begin() const { return items_; }
+    const T* end() const { return items_ + size_; }
+
+private:
+    size_t size_ = 0;
+    T items_[N];
+};
+
+// Status fields are enums; the names are what the dashboard shows
+
+enum class LinkStatus : uint8_t { Unknown, Connected, Degraded, Disconnected };
+constexpr const char* kLinkStatusNames[] = {"Unknown", "Connected", "Degraded", "Disconnected"};
+constexpr const char* toString(LinkStatus status) { return kLinkStatusNames[static_cast<size_t>(status)]; }
+
+enum class SwapStatus : uint8_t { Normal, High };
+constexpr const char* kSwapStatusNames[] = {"Normal", "High"};
+constexpr const char* toString(SwapStatus status) { return kSwapStatusNames[static_cast<size_t>(status)]; }
+
+enum class SignalQuality : uint8_t { NoSignal, Poor, Fair, Good, Excellent };
+constexpr const char* kSignalQualityNames[] = {"No Signal", "Poor", "Fair", "Good", "Excellent"};
+constexpr const char* toString(SignalQuality quality) { return kSignalQualityNames[static_cast<size_t>(quality)]; }
+
+// Cellular network registration
+enum class Registration : uint8_t { Disconnected, Connected, Roaming, Searching, Denied };
+constexpr const char* kRegistrationNames[] = {"Disconnected", "Connected", "Roaming", "Searching", "Denied"};
+constexpr const char* toString(Registration registration) {
+    return kRegistrationNames[static_cast<size_t>(registration)];
+}
+
+enum class SessionState : uint8_t { None, Active, Reconnecting };
+constexpr const char* kSessionStateNames[] = {"N/A", "Active", "Reconnecting"};
+constexpr const char* toString(SessionState state) { return kSessionStateNames[static_cast<size_t>(state)]; }
+
+// eMMC pre-EOL information: how far the reserved blocks are used up
+enum class FlashWear : uint8_t { Unknown, Normal, Warning, Urgent };
+constexpr const char* kFlashWearNames[] = {"N/A", "Normal", "Warning", "Urgent"};
+constexpr const char* toString(FlashWear wear) { return kFlashWearNames[static_cast<size_t>(wear)]; }
+
+// Textual IPv4 or IPv6 address (INET6_ADDRSTRLEN)
+typedef FixedString<46> IpAddressString;
+
+#endif // METRICS_TYPES_H
@@ -0,0 +1,110 @@
+#ifndef MODEM_MONITOR_H
+#define MODEM_MONITOR_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <functional>
+
+// Watches a cellular modem over its AT command port on its own thread. The
+// port stays open (non-blocking, raw) for the monitor's lifetime and is
+// reopened when the modem drops off the bus. Registration, technology and
+// cell changes arrive as unsolicited +CREG/+CEREG/+C5GREG indications, and
+// Quectel modems also push +QIND "csq" on signal changes; only the radio
+// measurements are polled, once per interval, with +CESQ/+CSQ plus the
+// Quectel +QENG serving-cell report (SINR, band) where the modem answers it.
+// The port must not be claimed by ModemManager at the same time.
+class ModemMonitor {
+public:
+    struct Status {
+        bool present = false;          // Port open and answering
+        int registration = 0;          // 3GPP <stat>: 1 home, 2 searching, 3 denied, 5 roaming
+        std::string network;           // Operator name
+        std::string technology;        // "LTE", "5G NR", "UMTS", ...
+        std::string band;
+        std::string cell_id;           // Hex, as the modem reports it
+        std::string apn;
+        bool measured = false;         // Any of the values below is known
+        double rssi_dbm = 0.0;
+        double rsrp_dbm = 0.0;
+        double rsrq_db = 0.0;
+        double sinr_db = 0.0;
+        double data_usage_mb = 0.0;    // Data interface rx + tx since boot
+
+        bool operator==(const Status& other) const;
+        bool operator!=(const Status& other) const { return !(*this == other); }
+    };
+
+    // Called on the monitor thread whenever the status changed
+    using ResultCallback = std::function<void(const Status& status)>;
+
+    ModemMonitor();
+    ~ModemMonitor();
+
+    ModemMonitor(const ModemMonitor&) = delete;
+    ModemMonitor& operator=(const ModemMonitor&) = delete;
+
+    // Configuration; takes effect on start(). The data interface (e.g.
+    // "wwan0") only feeds data_usage_mb and may be empty.
+    void setDevice(const std::string& device) { device_ = device; }
+    void setDataInterface(const std::string& interface) { data_interface_ = interface; }
+    void setInterval(int interval_ms) { interval_ms_ = interval_ms; }
+    void setResultCallback(ResultCallback callback) { callback_ = std::move(callback); }
+
+    bool start();
+    void stop();
+    bool isRunning() const { return running_.load(); }
+
+    Status getStatus() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    std::atomic<bool> running_;
+    std::thread monitor_thread_;
+    std::string device_;
+    std::string data_interface_;
+    int interval_ms_;
+    ResultCallback callback_;
+    int wake_fd_;                      // eventfd, readable once stopping
+
+    // Monitor thread only
+    int port_fd_;
+    std::string rx_buffer_;            // Bytes after the last complete line
+    std::deque<std::string> pending_;  // Commands waiting to be sent
+    std::string in_flight_;            // Sent, awaiting OK/ERROR
+    Clock::time_point deadline_;
+    int timeouts_;                     // Consecutive unanswered commands
+    bool qeng_supported_;
+    int registrations_[3];             // Last <stat> of CREG, CEREG, C5GREG
+    Status current_;
+
+    mutable std::mutex status_mutex_;
+    Status reported_;
+
+    void monitorLoop();
+    bool openPort();
+    void closePort();
+    void queueInit();
+    void queuePoll();
+    void sendNext();
+    bool readPort();
+    void handleLine(const std::string& line);
+    void finishCommand(bool ok);
+    void parseRegistration(int domain, const std::vector<std::string>& fields, bool query);
+    void parseOperator(const std::vector<std::string>& fields);
+    void parseSignalQuality(const std::vector<std::string>& fields);
+    void parseServingCell(const std::vector<std::string>& fields);
+    void readDataUsage();
+    void report();
+    bool waitForStop(int timeout_ms);
+    static std::vector<std::string> splitFields(const std::string& text);
+    static std::string technologyName(int access_technology);
+    void logError(const std::string& message);
+};
+
+#endif // MODEM_MONITOR_H
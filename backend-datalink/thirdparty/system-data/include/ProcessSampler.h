@@ -0,0 +1,120 @@
+#ifndef PROCESS_SAMPLER_H
+#define PROCESS_SAMPLER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include "MetricsTypes.h"
+
+// Per-process and cgroup resource accounting, run on the collector thread.
+// A scan reads /proc/<pid>/stat of every process through openat() on a
+// /proc directory fd held open for the sampler's lifetime, into buffers that
+// are reused between scans; CPU shares come from the tick deltas since the
+// previous scan. Our own cgroup (v2) and the PSI files are likewise kept
+// open and re-read with pread. The first scan only primes the deltas.
+class ProcessSampler {
+public:
+    struct ProcessStats {
+        int pid = 0;
+        FixedString<16> name;          // comm, at most 15 characters
+        double cpu_percent = 0.0;      // Of one core, as top shows it
+        double rss_mb = 0.0;
+    };
+
+    // Our cgroup's CPU and memory accounting between two scans
+    struct CgroupStats {
+        FixedString<128> path = "N/A"; // Relative to /sys/fs/cgroup
+        double cpu_percent = 0.0;      // Of one core
+        double cpu_quota_cores = 0.0;  // cpu.max quota / period; 0 when unlimited
+        double throttled_percent = 0.0; // Of the enforcement periods
+        double throttled_ms = 0.0;
+        double memory_mb = 0.0;
+        double memory_limit_mb = 0.0;  // 0 when unlimited
+    };
+
+    // One resource of /proc/pressure: share of time some (or all) runnable
+    // tasks were stalled on it
+    struct Pressure {
+        double some_avg10 = 0.0;
+        double some_avg60 = 0.0;
+        double full_avg10 = 0.0;
+        double full_avg60 = 0.0;
+    };
+
+    // Longest list a Result holds
+    static const size_t kMaxListed = 16;
+
+    struct Result {
+        int process_count = 0;
+        FixedVector<ProcessStats, kMaxListed> top_cpu;
+        FixedVector<ProcessStats, kMaxListed> top_memory;
+        FixedVector<ProcessStats, kMaxListed> watched; // Processes named in the watch list
+        CgroupStats cgroup;
+        Pressure cpu_pressure;
+        Pressure memory_pressure;
+        Pressure io_pressure;
+        double scan_ms = 0.0;
+    };
+
+    ProcessSampler();
+    ~ProcessSampler();
+
+    ProcessSampler(const ProcessSampler&) = delete;
+    ProcessSampler& operator=(const ProcessSampler&) = delete;
+
+    // Length of the top lists (at most kMaxListed) and the process names
+    // (comm) to always report
+    void setTopCount(size_t count) { top_count_ = std::min(count, kMaxListed); }
+    void setWatchedNames(const std::vector<std::string>& names) { watched_names_ = names; }
+
+    bool sample(Result& result);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Previous {
+        unsigned long long start_time = 0; // Tells a reused pid apart
+        unsigned long long ticks = 0;      // utime + stime
+        uint64_t scan = 0;                 // Last scan the pid was seen in
+    };
+
+    int proc_fd_;
+    int cgroup_cpu_max_fd_;
+    int cgroup_cpu_stat_fd_;
+    int cgroup_memory_current_fd_;
+    int cgroup_memory_max_fd_;
+    int pressure_fds_[3];              // cpu, memory, io
+    std::string cgroup_path_;
+
+    size_t top_count_;
+    std::vector<std::string> watched_names_;
+    double ticks_per_second_;
+    double page_mb_;
+
+    std::vector<char> dirents_;
+    char stat_buffer_[1024];
+    std::vector<ProcessStats> processes_;
+    std::unordered_map<int, Previous> previous_;
+    uint64_t scan_;
+    Clock::time_point previous_time_;
+
+    bool cgroup_primed_;
+    unsigned long long cgroup_usage_usec_;
+    unsigned long long cgroup_periods_;
+    unsigned long long cgroup_throttled_;
+    unsigned long long cgroup_throttled_usec_;
+
+    void scanProcesses(double seconds, Result& result);
+    bool readProcess(const char* pid_name, int pid, double seconds, ProcessStats& stats);
+    void sampleCgroup(double seconds, CgroupStats& cgroup);
+    void openCgroup();
+    static bool readPressure(int fd, Pressure& pressure);
+    static long readAt(int fd, char* buffer, size_t size);
+    static int openAt(int dir_fd, const std::string& path);
+    void logError(const std::string& message) const;
+};
+
+#endif // PROCESS_SAMPLER_H
@@ -0,0 +1,36 @@
+#ifndef SHARED_METRICS_WRITER_H
+#define SHARED_METRICS_WRITER_H
+
+#include <string>
+#include "system_metrics_shm.h"
+
+// Writer side of the segment described in system_metrics_shm.h. Creates the
+// POSIX shared-memory object (or reuses one a previous run left behind) and
+// keeps it mapped until close(); the object itself is not unlinked, so
+// readers that have it mapped carry on across a backend restart. There must
+// be one writer at a time; write() never blocks.
+class SharedMetricsWriter {
+public:
+    SharedMetricsWriter();
+    ~SharedMetricsWriter();
+
+    SharedMetricsWriter(const SharedMetricsWriter&) = delete;
+    SharedMetricsWriter& operator=(const SharedMetricsWriter&) = delete;
+
+    // name as for shm_open(), e.g. "/backend-datalink-metrics"
+    bool open(const std::string& name);
+    void close();
+    bool isOpen() const { return shm_ != nullptr; }
+
+    // Replaces the latest record and appends it to the history ring
+    void write(const sysdata_shm_metrics_t& record);
+
+private:
+    sysdata_shm_t* shm_;
+
+    void beginWrite();
+    void endWrite();
+    void logError(const std::string& message) const;
+};
+
+#endif // SHARED_METRICS_WRITER_H
@@ -0,0 +1,108 @@
+#ifndef STORAGE_SAMPLER_H
+#define STORAGE_SAMPLER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include "MetricsTypes.h"
+
+// Filesystem fill, disk I/O and flash wear, run on the collector thread.
+// /proc/diskstats is kept open, re-read with pread and parsed in one pass
+// over the buffer; rates and latencies are deltas since the previous sample
+// (the first only primes them). Only whole disks are reported, not their
+// partitions, loop or RAM devices. For eMMC devices the sysfs life_time and
+// pre_eol_info files are opened once, when the device is first seen. Mount
+// usage is one statvfs() per configured mount point.
+class StorageSampler {
+public:
+    struct MountStats {
+        FixedString<64> path;
+        bool mounted = false;          // statvfs() succeeded
+        bool read_only = false;
+        double total_gb = 0.0;
+        double used_gb = 0.0;
+        double available_gb = 0.0;     // To unprivileged users
+        double usage_percent = 0.0;    // Of what is not reserved for root
+        double inodes_used_percent = 0.0;
+    };
+
+    struct DeviceStats {
+        FixedString<32> name;
+        double read_iops = 0.0;
+        double write_iops = 0.0;
+        double read_bytes_per_sec = 0.0;
+        double write_bytes_per_sec = 0.0;
+        double read_latency_ms = 0.0;  // Mean per completed request
+        double write_latency_ms = 0.0;
+        double busy_percent = 0.0;     // Time with requests in flight
+        int in_flight = 0;
+        // eMMC estimates (JESD84-B51): life used, in 10% steps, of the two
+        // memory types; -1 where the device does not report it
+        int life_used_a_percent = -1;
+        int life_used_b_percent = -1;
+        FlashWear pre_eol = FlashWear::Unknown;
+    };
+
+    // Longest lists a Result holds
+    static const size_t kMaxMounts = 8;
+    static const size_t kMaxDevices = 16;
+
+    struct Result {
+        FixedVector<MountStats, kMaxMounts> mounts;
+        FixedVector<DeviceStats, kMaxDevices> devices;
+        double scan_ms = 0.0;
+    };
+
+    StorageSampler();
+    ~StorageSampler();
+
+    StorageSampler(const StorageSampler&) = delete;
+    StorageSampler& operator=(const StorageSampler&) = delete;
+
+    // Mount points to report usage for, at most kMaxMounts
+    void setMounts(const std::vector<std::string>& mounts) { mounts_ = mounts; }
+
+    bool sample(Result& result);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // Cumulative /proc/diskstats counters of one device
+    struct Counters {
+        unsigned long long reads = 0;
+        unsigned long long read_sectors = 0;
+        unsigned long long read_ms = 0;
+        unsigned long long writes = 0;
+        unsigned long long write_sectors = 0;
+        unsigned long long write_ms = 0;
+        unsigned long long in_flight = 0;
+        unsigned long long io_ms = 0;
+    };
+
+    struct Device {
+        bool disk = false;             // Listed in /sys/block
+        int life_time_fd = -1;
+        int pre_eol_fd = -1;
+        Counters previous;
+        uint64_t scan = 0;             // Last scan it was seen in
+    };
+
+    int diskstats_fd_;
+    int sys_block_fd_;
+    std::vector<std::string> mounts_;
+    std::vector<char> buffer_;
+    std::unordered_map<std::string, Device> devices_;
+    uint64_t scan_;
+    Clock::time_point previous_time_;
+
+    void sampleMounts(Result& result);
+    void sampleDevices(double seconds, Result& result);
+    Device& device(const char* name, size_t length);
+    static void readWear(const Device& device, DeviceStats& stats);
+    static void closeDevice(Device& device);
+    void logError(const std::string& message) const;
+};
+
+#endif // STORAGE_SAMPLER_H
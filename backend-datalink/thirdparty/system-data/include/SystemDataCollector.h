@@ -6,16 +6,46 @@
 #include <atomic>
 #include <chrono>
 #include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include <type_traits>
 #include <nlohmann/json.hpp>
+#include "MetricsTypes.h"
+#include "LatencyProber.h"
+#include "ExternalIpResolver.h"
+#include "ModemMonitor.h"
+#include "HardwareInventory.h"
+#include "ProcessSampler.h"
+#include "StorageSampler.h"
+#include "SharedMetricsWriter.h"
 
 using json = nlohmann::json;
 
 class SystemDataCollector {
 public:
+    // Trivially copyable: strings and lists are stored inline (MetricsTypes.h),
+    // so copying a snapshot never allocates. Lists longer than their
+    // capacity are truncated.
     struct SystemMetrics {
         // CPU Metrics
         struct CPU {
+            // Share of time per state since the previous sample, in percent
+            struct Breakdown {
+                double usage_percent = 0.0; // Everything but idle and iowait
+                double user_percent = 0.0;  // Includes nice
+                double system_percent = 0.0;
+                double iowait_percent = 0.0;
+                double irq_percent = 0.0;   // Hard and soft interrupts
+                double steal_percent = 0.0;
+            };
+            
             double usage_percent = 0.0;
+            Breakdown total;
+            FixedVector<Breakdown, 64> per_core; // Indexed by cpuN
             int cores = 0;
             double temperature_celsius = 0.0;
             double frequency_ghz = 0.0;
@@ -33,60 +63,114 @@ public:
             double usage_percent = 0.0;
             double used_mb = 0.0;
             double total_gb = 0.0;
-            std::string status = "Normal";
+            SwapStatus status = SwapStatus::Normal;
         } swap;
         
         // Network Metrics
         struct Network {
             struct Internet {
-                std::string status = "Unknown";
-                std::string external_ip = "N/A";
-                std::string dns_primary = "N/A";
-                std::string dns_secondary = "N/A";
-                double latency_ms = 0.0;
-                std::string bandwidth = "N/A";
+                LinkStatus status = LinkStatus::Unknown;
+                IpAddressString external_ip = "N/A";
+                IpAddressString dns_primary = "N/A";
+                IpAddressString dns_secondary = "N/A";
+                double latency_ms = 0.0; // Average of the best reachable target
+                double latency_jitter_ms = 0.0;
+                FixedVector<LatencyProber::TargetStats, 8> latency_targets;
+                FixedString<64> bandwidth = "N/A";
             } internet;
             
             struct Connection {
-                std::string status = "Unknown";
-                std::string interface_name = "N/A";
-                std::string mac_address = "N/A";
-                std::string local_ip = "N/A";
-                std::string gateway = "N/A";
-                std::string speed = "N/A";
+                LinkStatus status = LinkStatus::Unknown;
+                FixedString<16> interface_name = "N/A"; // IFNAMSIZ
+                FixedString<18> mac_address = "N/A";
+                IpAddressString local_ip = "N/A";
+                IpAddressString gateway = "N/A";
+                FixedString<16> speed = "N/A";
             } connection;
+            
+            // Per-interface rates between the last two /proc/net/dev reads
+            struct InterfaceTraffic {
+                FixedString<16> name;
+                double rx_bytes_per_sec = 0.0;
+                double tx_bytes_per_sec = 0.0;
+                double rx_packets_per_sec = 0.0;
+                double tx_packets_per_sec = 0.0;
+                double rx_errors_per_sec = 0.0;
+                double tx_errors_per_sec = 0.0;
+                double rx_drops_per_sec = 0.0;
+                double tx_drops_per_sec = 0.0;
+                uint64_t rx_bytes = 0;      // Totals since the interface came up
+                uint64_t tx_bytes = 0;
+            };
+            FixedVector<InterfaceTraffic, 32> interfaces;
         } network;
         
-        // Ultima Server Metrics (placeholder)
+        // Ultima Server Metrics, filled in by the source set with
+        // setUltimaServerSource()
         struct UltimaServer {
-            std::string status = "Unknown";
-            std::string server = "N/A";
+            LinkStatus status = LinkStatus::Unknown;
+            FixedString<256> server = "N/A"; // Host name, at most 253 characters
             int port = 0;
-            std::string protocol = "N/A";
+            FixedString<8> protocol = "N/A";
             double last_ping_ms = 0.0;
-            std::string session = "N/A";
+            double ping_avg_ms = 0.0;   // EWMA
+            double ping_p50_ms = 0.0;
+            double ping_p95_ms = 0.0;
+            double ping_p99_ms = 0.0;
+            SessionState session = SessionState::None;
         } ultima_server;
         
         // Signal Metrics (cellular modem specific)
         struct Signal {
             struct Strength {
-                std::string status = "No Signal";
+                SignalQuality status = SignalQuality::NoSignal;
                 double rssi_dbm = 0.0;
                 double rsrp_dbm = 0.0;
                 double rsrq_db = 0.0;
                 double sinr_db = 0.0;
-                std::string cell_id = "N/A";
+                FixedString<32> cell_id = "N/A";
             } strength;
             
             struct Connection {
-                std::string status = "Disconnected";
-                std::string network = "N/A";
-                std::string technology = "N/A";
-                std::string band = "N/A";
-                std::string apn = "N/A";
+                Registration status = Registration::Disconnected;
+                FixedString<64> network = "N/A";
+                FixedString<32> technology = "N/A";
+                FixedString<32> band = "N/A";
+                FixedString<101> apn = "N/A"; // At most 100 characters (3GPP TS 23.003)
                 double data_usage_mb = 0.0;
             } connection;
         } signal;
+        
+        // Top processes, watched daemons, our cgroup and pressure stall info
+        ProcessSampler::Result processes;
+        
+        // Mount usage, per-disk I/O and flash wear
+        StorageSampler::Result storage;
+        
+        uint64_t generation = 0; // Bumped on every publish
+    };
+    static_assert(std::is_trivially_copyable<SystemMetrics>::value, "SystemMetrics must stay trivially copyable");
+    
+    // JSON view of one snapshot generation, built once and shared by every
+    // consumer (database writer, broadcaster, request handlers)
+    class JsonSnapshot {
+    public:
+        JsonSnapshot(uint64_t generation, json metrics);
+        
+        uint64_t generation() const { return generation_; }
+        const json& metrics() const { return metrics_; }
+        
+        // dump() of one top-level section ("cpu", "ram", ...), serialized on
+        // first use; empty for an unknown section
+        const std::string& serialized(const std::string& section) const;
+        
+    private:
+        static const char* const kSections[8];
+        
+        uint64_t generation_;
+        json metrics_;
+        mutable std::once_flag serialized_once_[8];
+        mutable std::string serialized_[8];
     };
 
     SystemDataCollector();
@@ -98,59 +182,253 @@ public:
     bool isRunning() const { return running_.load(); }
     
     // Data access
+    // Readers never wait on a collector: each call loads the latest published
+    // snapshot, which is immutable once published
+    std::shared_ptr<const SystemMetrics> getSnapshot() const;
     SystemMetrics getCurrentMetrics() const;
+    std::shared_ptr<const JsonSnapshot> getJsonSnapshot() const;
     json getMetricsAsJson() const;
     
-    // Configuration
-    void setPollInterval(int seconds) { poll_interval_seconds_ = seconds; }
+    // Called with the new generation right after every publish, on the
+    // collector or prober thread that published it; a listener should only
+    // hand the news on (wake a consumer), not do the work itself. Returns an
+    // id for removePublishListener().
+    typedef std::function<void(uint64_t generation)> PublishListener;
+    int addPublishListener(PublishListener listener);
+    void removePublishListener(int id);
+    
+    // Configuration. The poll interval is the CPU sampling period; the other
+    // collectors run on their own periods (see setCollectorInterval). A new
+    // poll interval takes effect at once, also while running.
+    void setPollInterval(int seconds);
     int getPollInterval() const { return poll_interval_seconds_; }
+    
+    // Period of one collector: "cpu", "memory", "network_link",
+    // "network_traffic", "latency", "external_ip", "ultima_server", "signal",
+    // "processes" or "storage". For "external_ip" it is
+    // the cache TTL; route changes refresh it sooner. For "signal" it is the
+    // modem measurement poll; registration changes arrive as they happen.
+    // Takes effect on start().
+    bool setCollectorInterval(const std::string& name, int interval_ms);
+    // Runs one collector factor times slower than its period, live; 1 is
+    // its period again, and a sample now overdue runs at once. Only the
+    // collectors on the shared schedule ("cpu", "memory", "network_link",
+    // "network_traffic", "ultima_server", "processes", "storage") can be
+    // slowed.
+    bool setCollectorSlowdown(const std::string& name, int factor);
+    
+    // Latency probing ("latency" sets its period). Targets are "host:port";
+    // takes effect on start().
+    bool setLatencyTargets(const std::vector<std::string>& targets) { return latency_prober_.setTargets(targets); }
+    void setLatencyProbeTimeout(int timeout_ms) { latency_prober_.setTimeout(timeout_ms); }     // Live
+    void setLatencyWindowSize(size_t window_size) { latency_prober_.setWindowSize(window_size); }
+    
+    // URLs answering with the caller's public address; takes effect on start()
+    bool setExternalIpEndpoints(const std::vector<std::string>& endpoints) { return external_ip_resolver_.setEndpoints(endpoints); }
+    
+    // Fills the ultima_server section on every "ultima_server" period, on the
+    // collector thread; without one it keeps its defaults. Set before start().
+    typedef std::function<void(SystemMetrics::UltimaServer& server)> UltimaServerSource;
+    void setUltimaServerSource(UltimaServerSource source) { ultima_server_source_ = std::move(source); }
+    
+    // Cellular modem AT port (e.g. "/dev/ttyUSB2") and its data interface
+    // (e.g. "wwan0"); an empty device leaves the signal section at its
+    // defaults. Takes effect on start().
+    void setModem(const std::string& device, const std::string& data_interface) {
+        modem_monitor_.setDevice(device);
+        modem_monitor_.setDataInterface(data_interface);
+        modem_enabled_ = !device.empty();
+    }
+    // Process accounting ("processes" sets its period): length of the top
+    // CPU and memory lists, and the process names always reported (our own
+    // daemons). Set before start().
+    void setProcessTopCount(size_t count) { process_sampler_.setTopCount(count); }
+    void setWatchedProcesses(const std::vector<std::string>& names) { process_sampler_.setWatchedNames(names); }
+    // Mount points whose usage the storage section reports ("storage" sets
+    // its period); disks are found on their own. Set before start().
+    void setStorageMounts(const std::vector<std::string>& mounts) { storage_sampler_.setMounts(mounts); }
+    // POSIX shared-memory object every publish is also written to, for
+    // local readers (see system_metrics_shm.h); empty disables it. Takes
+    // effect on start().
+    void setSharedMemoryName(const std::string& name) { shared_memory_name_ = name; }
     void setCollectionProgressLogInterval(int interval) { collection_progress_log_interval_ = interval; }
     int getCollectionProgressLogInterval() const { return collection_progress_log_interval_; }
 
 private:
     std::atomic<bool> running_;
     std::thread collector_thread_;
-    int poll_interval_seconds_;
-    int collection_progress_log_interval_;
+    std::atomic<int> poll_interval_seconds_;
+    std::atomic<int> collection_progress_log_interval_;
     
-    // Current metrics (thread-safe access)
-    mutable std::mutex metrics_mutex_;
-    SystemMetrics current_metrics_;
+    // Kernel file kept open for the collector's lifetime and re-read from
+    // offset 0 with pread, so each sample costs one syscall and no allocation
+    class ProcFile {
+    public:
+        explicit ProcFile(const std::string& path);
+        ~ProcFile();
+        
+        ProcFile(const ProcFile&) = delete;
+        ProcFile& operator=(const ProcFile&) = delete;
+        
+        // Fills buffer (NUL-terminated); returns the length or -1
+        long read(char* buffer, size_t size);
+        // Switches to another file (after hotplug); empty closes it
+        void reopen(const std::string& path);
+        bool isOpen() const { return fd_ >= 0; }
+        
+    private:
+        std::string path_;
+        int fd_;
+    };
+    
+    // Turns the cumulative cpu/cpuN counters of /proc/stat into per-state
+    // percentages between two calls. Each instance keeps its own previous
+    // sample, so the first call only primes the baseline.
+    class CpuSampler {
+    public:
+        CpuSampler();
+        
+        bool sample(SystemMetrics::CPU& cpu);
+        
+    private:
+        struct Counters {
+            unsigned long long user = 0;
+            unsigned long long system = 0;
+            unsigned long long idle = 0;
+            unsigned long long iowait = 0;
+            unsigned long long irq = 0;
+            unsigned long long steal = 0;
+            unsigned long long total = 0;
+        };
+        
+        static SystemMetrics::CPU::Breakdown delta(const Counters& previous, const Counters& current);
+        
+        ProcFile stat_file_;
+        std::vector<char> buffer_; // Grows until every cpu line fits
+        bool primed_;
+        Counters total_;
+        std::vector<Counters> cores_;
+        std::vector<Counters> current_cores_;
+    };
+    
+    // Turns the cumulative counters of /proc/net/dev into per-second rates
+    // between two calls, for every interface in one read. An interface seen
+    // for the first time, or whose counters went backwards (re-created,
+    // 32-bit wrap), reports zero rates until the next call.
+    class TrafficSampler {
+    public:
+        TrafficSampler();
+        
+        bool sample(FixedVector<SystemMetrics::Network::InterfaceTraffic, 32>& interfaces);
+        
+    private:
+        struct Counters {
+            uint64_t values[8] = {0}; // rx bytes, packets, errors, drops; tx the same
+        };
+        
+        ProcFile dev_file_;
+        std::vector<char> buffer_; // Grows until every interface fits
+        std::chrono::steady_clock::time_point previous_time_;
+        std::map<std::string, Counters> previous_;
+        std::map<std::string, Counters> current_;
+    };
+    
+    struct MemInfo {
+        long mem_total_kb = 0;
+        long mem_available_kb = 0;
+        long swap_total_kb = 0;
+        long swap_free_kb = 0;
+    };
+    
+    // Before the files it names, which open from it on construction
+    HardwareInventory hardware_inventory_;
+    uint64_t hardware_generation_ = 0;          // Collector thread only
+    
+    CpuSampler cpu_sampler_;
+    TrafficSampler traffic_sampler_;
+    ProcessSampler process_sampler_;
+    StorageSampler storage_sampler_;
+    ProcFile meminfo_file_;
+    ProcFile temperature_file_;
+    ProcFile frequency_file_;
+    
+    LatencyProber latency_prober_;
+    ExternalIpResolver external_ip_resolver_;
+    ModemMonitor modem_monitor_;
+    bool modem_enabled_ = false;
+    UltimaServerSource ultima_server_source_;
+    
+    // Current metrics, swapped with std::atomic_store. Writers (collector and
+    // prober threads) copy the snapshot, apply their section and publish the
+    // copy; publish_mutex_ only orders writers against each other.
+    std::shared_ptr<const SystemMetrics> snapshot_;
+    std::mutex publish_mutex_;
+    std::string shared_memory_name_;
+    SharedMetricsWriter shared_memory_;         // Written under publish_mutex_
+    
+    void publish(const std::function<void(SystemMetrics&)>& update);
+    
+    std::vector<std::pair<int, PublishListener>> publish_listeners_;
+    int next_listener_id_ = 1;
+    std::mutex listeners_mutex_;                // Guards the two above
+    
+    // JSON of the latest generation, rebuilt by the first reader after a publish
+    mutable std::shared_ptr<const JsonSnapshot> json_cache_;
+    mutable std::mutex json_cache_mutex_;
+    
+    static json buildMetricsJson(const SystemMetrics& metrics);
+    
+    // Each collector runs on its own period against absolute deadlines, kept
+    // in a min-heap ordered by the next deadline
+    struct ScheduledCollector {
+        std::string name;
+        std::chrono::milliseconds base_period;  // Before the slowdown
+        std::chrono::milliseconds period;
+        std::chrono::steady_clock::time_point next_due;
+        void (SystemDataCollector::*run)();
+    };
+    std::map<std::string, int> collector_intervals_ms_;
+    std::vector<ScheduledCollector> schedule_;
+    bool cpu_follows_poll_interval_ = true;     // No explicit "cpu" period
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool poll_interval_changed_ = false;        // Or a slowdown; guarded by wake_mutex_
+    std::map<std::string, int> collector_slowdowns_;   // Guarded by wake_mutex_
     
     // Collection methods
     void collectLoop();
-    void collectAllMetrics();
+    void buildSchedule();
+    
+    // Scheduled collectors: sample first, then publish the result
+    void sampleCPU();
+    void sampleMemory();
+    void sampleNetworkLink();
+    void sampleNetworkTraffic();
+    void sampleProcesses();
+    void sampleStorage();
+    void publishLatency(const std::vector<LatencyProber::TargetStats>& stats);
+    void publishExternalIP(const std::string& external_ip);
+    void sampleUltimaServer();
+    void publishSignal(const ModemMonitor::Status& status);
     
     // Individual metric collectors
     void collectCPUMetrics(SystemMetrics::CPU& cpu);
-    void collectRAMMetrics(SystemMetrics::RAM& ram);
-    void collectSwapMetrics(SystemMetrics::Swap& swap);
-    void collectNetworkMetrics(SystemMetrics::Network& network);
+    void collectMemoryMetrics(SystemMetrics::RAM& ram, SystemMetrics::Swap& swap);
     void collectUltimaServerMetrics(SystemMetrics::UltimaServer& server);
-    void collectSignalMetrics(SystemMetrics::Signal& signal);
     
     // Utility methods
-    double getCPUUsage();
-    int getCPUCoreCount();
     double getCPUTemperature();
     double getCPUFrequency();
-    double getRAMUsagePercent();
-    double getRAMUsedGB();
-    double getRAMTotalGB();
-    double getSwapUsagePercent();
-    double getSwapUsedMB();
-    double getSwapTotalGB();
-    std::string getExternalIP();
+    bool readMemInfo(MemInfo& info);
     std::string getLocalIP();
     std::string getGateway();
     std::string getMACAddress();
-    double getNetworkLatency();
     std::string getNetworkInterface();
+    std::string getLinkSpeed(const std::string& iface);
+    bool readDefaultRoute(std::string& iface, std::string& gateway);
     
     // File reading utilities
     std::string readFile(const std::string& path);
-    double parseDoubleFromProc(const std::string& content, const std::string& key);
-    long parseLongFromProc(const std::string& content, const std::string& key);
     
     // Error handling
     void logError(const std::string& message) const;
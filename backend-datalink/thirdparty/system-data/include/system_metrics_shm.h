@@ -0,0 +1,155 @@
+/*
+ * Layout of the shared-memory segment SystemDataCollector writes its
+ * metrics to, and the functions local readers need. Plain C, header only.
+ *
+ * The segment holds the latest record and a ring of the last
+ * SYSDATA_SHM_HISTORY records, one per collector publish. One writer
+ * updates it under a sequence lock: seq is odd while a write is in
+ * progress, so a reader copies what it needs and retries if seq was odd or
+ * changed meanwhile. Readers never block the writer or each other.
+ *
+ * The segment outlives the backend; a record whose timestamp_ms stops
+ * advancing means the writer is gone.
+ *
+ *     const sysdata_shm_t* shm = sysdata_shm_open(SYSDATA_SHM_DEFAULT_NAME);
+ *     sysdata_shm_metrics_t metrics;
+ *     if (shm && sysdata_shm_read_latest(shm, &metrics) == 0) { ... }
+ */
+#ifndef SYSTEM_METRICS_SHM_H
+#define SYSTEM_METRICS_SHM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SYSDATA_SHM_DEFAULT_NAME "/backend-datalink-metrics"
+#define SYSDATA_SHM_MAGIC 0x53444d31u /* "SDM1" */
+#define SYSDATA_SHM_VERSION 1u
+#define SYSDATA_SHM_HISTORY 128u
+
+/* Numbers and short strings only; strings are NUL-terminated */
+typedef struct {
+    uint64_t generation;            /* SystemMetrics::generation */
+    int64_t timestamp_ms;           /* CLOCK_REALTIME of the publish */
+
+    double cpu_usage_percent;
+    double cpu_temperature_celsius;
+    double cpu_frequency_ghz;
+    int32_t cpu_cores;
+
+    int32_t internet_reachable;     /* 1 when a latency target answered */
+    double ram_usage_percent;
+    double ram_used_gb;
+    double ram_total_gb;
+    double swap_usage_percent;
+    double swap_used_mb;
+    double swap_total_gb;
+
+    double latency_ms;
+    double latency_jitter_ms;
+    double rx_bytes_per_sec;        /* Default-route interface */
+    double tx_bytes_per_sec;
+    char interface_name[16];
+    char local_ip[48];
+
+    int32_t ultima_connected;
+    int32_t cellular_registered;
+    double ultima_last_ping_ms;
+    double ultima_ping_avg_ms;
+
+    double rssi_dbm;
+    double rsrp_dbm;
+    double rsrq_db;
+    double sinr_db;
+} sysdata_shm_metrics_t;
+
+typedef struct {
+    uint32_t magic;                 /* SYSDATA_SHM_MAGIC once initialised */
+    uint32_t version;               /* SYSDATA_SHM_VERSION */
+    uint32_t record_size;           /* sizeof(sysdata_shm_metrics_t) */
+    uint32_t history_capacity;      /* SYSDATA_SHM_HISTORY */
+    uint64_t seq;                   /* Odd while the writer is updating */
+    uint64_t history_count;         /* Records ever written; the newest is at (history_count - 1) % capacity */
+    sysdata_shm_metrics_t latest;
+    sysdata_shm_metrics_t history[SYSDATA_SHM_HISTORY];
+} sysdata_shm_t;
+
+/* Maps the segment read-only; NULL if it does not exist or does not match
+ * this header. Unmap with munmap(shm, sizeof(sysdata_shm_t)). */
+static inline const sysdata_shm_t* sysdata_shm_open(const char* name) {
+    int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    void* base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(sysdata_shm_t)) {
+        base = mmap(NULL, sizeof(sysdata_shm_t), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+
+    const sysdata_shm_t* shm = (const sysdata_shm_t*)base;
+    if (shm->magic != SYSDATA_SHM_MAGIC || shm->version != SYSDATA_SHM_VERSION ||
+        shm->record_size != sizeof(sysdata_shm_metrics_t)) {
+        munmap(base, sizeof(sysdata_shm_t));
+        return NULL;
+    }
+    return shm;
+}
+
+/* Copies the latest record; 0 on success, -1 if the writer kept it busy */
+static inline int sysdata_shm_read_latest(const sysdata_shm_t* shm, sysdata_shm_metrics_t* out) {
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        uint64_t before = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+        memcpy(out, (const void*)&shm->latest, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == before) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Copies up to max records, newest first; returns how many, or -1 if the
+ * writer kept the ring busy */
+static inline int sysdata_shm_read_history(const sysdata_shm_t* shm, sysdata_shm_metrics_t* out, uint32_t max) {
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        uint64_t before = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+
+        uint64_t count = shm->history_count;
+        uint32_t available = count < SYSDATA_SHM_HISTORY ? (uint32_t)count : SYSDATA_SHM_HISTORY;
+        uint32_t copied = available < max ? available : max;
+        for (uint32_t i = 0; i < copied; ++i) {
+            memcpy(&out[i], (const void*)&shm->history[(count - 1 - i) % SYSDATA_SHM_HISTORY], sizeof(out[i]));
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == before) {
+            return (int)copied;
+        }
+    }
+    return -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYSTEM_METRICS_SHM_H */
@@ -0,0 +1,307 @@
+#include "ExternalIpResolver.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+
+// First retry after a failed lookup; doubles up to the TTL
+const int kRetryMinMs = 30000;
+
+// Route and address changes come in bursts (DHCP renew, PPP up); look up
+// once things have settled
+const int kSettleMs = 2000;
+
+// Longest answer read from an endpoint
+const size_t kMaxAnswer = 256;
+
+} // namespace
+
+ExternalIpResolver::ExternalIpResolver()
+    : running_(false), endpoints_{"https://ifconfig.me", "https://api.ipify.org"}, ttl_ms_(300000),
+      wake_fd_(-1), child_pid_(0), address_("N/A") {
+}
+
+ExternalIpResolver::~ExternalIpResolver() {
+    stop();
+}
+
+bool ExternalIpResolver::setEndpoints(const std::vector<std::string>& endpoints) {
+    if (endpoints.empty()) {
+        logError("No external IP endpoints given");
+        return false;
+    }
+    for (const auto& url : endpoints) {
+        bool http = url.compare(0, 7, "http://") == 0 || url.compare(0, 8, "https://") == 0;
+        if (!http || std::any_of(url.begin(), url.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); })) {
+            logError("Invalid external IP endpoint (expected an http or https URL): " + url);
+            return false;
+        }
+    }
+
+    endpoints_ = endpoints;
+    return true;
+}
+
+bool ExternalIpResolver::start() {
+    if (running_.load()) {
+        logError("ExternalIpResolver is already running");
+        return false;
+    }
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0) {
+        logError("eventfd: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    running_.store(true);
+    resolver_thread_ = std::thread(&ExternalIpResolver::resolveLoop, this);
+    return true;
+}
+
+void ExternalIpResolver::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        logError("Failed to wake resolver: " + std::string(strerror(errno)));
+    }
+    {
+        std::lock_guard<std::mutex> lock(child_mutex_);
+        if (child_pid_ > 0) {
+            kill(child_pid_, SIGTERM);
+        }
+    }
+
+    if (resolver_thread_.joinable()) {
+        resolver_thread_.join();
+    }
+    close(wake_fd_);
+    wake_fd_ = -1;
+}
+
+std::string ExternalIpResolver::getAddress() const {
+    std::lock_guard<std::mutex> lock(address_mutex_);
+    return address_;
+}
+
+void ExternalIpResolver::resolveLoop() {
+    typedef std::chrono::steady_clock Clock;
+
+    // Without rtnetlink (containers, old kernels) only the TTL applies
+    int netlink_fd = openRouteMonitor();
+    auto next_due = Clock::now();
+    int retry_ms = kRetryMinMs;
+
+    while (running_.load()) {
+        auto now = Clock::now();
+        if (now < next_due) {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_due - now).count() + 1;
+            pollfd fds[2] = {{wake_fd_, POLLIN, 0}, {netlink_fd, POLLIN, 0}};
+            int ready = poll(fds, netlink_fd >= 0 ? 2 : 1, static_cast<int>(std::min<long long>(wait, 60000)));
+            if (ready < 0 && errno != EINTR) {
+                logError("poll: " + std::string(strerror(errno)));
+                break;
+            }
+            if (fds[0].revents) {
+                break;
+            }
+            if (netlink_fd >= 0 && fds[1].revents && routeChanged(netlink_fd)) {
+                next_due = std::min(next_due, Clock::now() + std::chrono::milliseconds(kSettleMs));
+            }
+            continue;
+        }
+
+        std::string address = lookup();
+        if (!running_.load()) {
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(address_mutex_);
+            address_ = address;
+        }
+        if (callback_) {
+            callback_(address);
+        }
+
+        if (address == "N/A") {
+            next_due = Clock::now() + std::chrono::milliseconds(retry_ms);
+            retry_ms = std::min(retry_ms * 2, std::max(ttl_ms_, kRetryMinMs));
+        } else {
+            next_due = Clock::now() + std::chrono::milliseconds(ttl_ms_);
+            retry_ms = kRetryMinMs;
+        }
+    }
+
+    if (netlink_fd >= 0) {
+        close(netlink_fd);
+    }
+}
+
+std::string ExternalIpResolver::lookup() {
+    for (const auto& url : endpoints_) {
+        std::string answer = fetch(url);
+        if (!running_.load()) {
+            break;
+        }
+
+        answer.erase(std::remove_if(answer.begin(), answer.end(), ::isspace), answer.end());
+        if (isAddress(answer)) {
+            return answer;
+        }
+    }
+    return "N/A";
+}
+
+// Runs curl without a shell and returns what it printed
+std::string ExternalIpResolver::fetch(const std::string& url) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        logError("pipe2: " + std::string(strerror(errno)));
+        return "";
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    // The calling thread may block signals the child must not inherit
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t no_signals;
+    sigemptyset(&no_signals);
+    posix_spawnattr_setsigmask(&attr, &no_signals);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    const char* argv[] = {
+        "curl", "-s", "--proto", "=http,https", "--connect-timeout", "5", "--max-time", "10",
+        "--max-filesize", "256", url.c_str(), nullptr
+    };
+
+    pid_t pid = 0;
+    int result;
+    {
+        std::lock_guard<std::mutex> lock(child_mutex_);
+        result = posix_spawnp(&pid, "curl", &actions, &attr, const_cast<char* const*>(argv), environ);
+        if (result == 0) {
+            child_pid_ = pid;
+        }
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[1]);
+
+    if (result != 0) {
+        close(fds[0]);
+        logError("Failed to run curl: " + std::string(strerror(result)));
+        return "";
+    }
+
+    // curl's --max-time bounds this; stop() kills it sooner
+    std::string answer;
+    char buffer[128];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (answer.size() < kMaxAnswer) {
+            answer.append(buffer, static_cast<size_t>(n));
+        }
+    }
+    close(fds[0]);
+
+    // Cleared before reaping, so stop() never signals a recycled pid
+    {
+        std::lock_guard<std::mutex> lock(child_mutex_);
+        child_pid_ = 0;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? answer : "";
+}
+
+int ExternalIpResolver::openRouteMonitor() {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (fd < 0) {
+        return -1;
+    }
+
+    sockaddr_nl local{};
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Drains pending notifications; true if one was about the default route or
+// a non-local interface address
+bool ExternalIpResolver::routeChanged(int netlink_fd) {
+    bool changed = false;
+    alignas(nlmsghdr) char buffer[8192];
+
+    for (;;) {
+        ssize_t len = recv(netlink_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (len < 0) {
+            // ENOBUFS: notifications were lost, so assume the worst
+            return changed || errno == ENOBUFS;
+        }
+        if (len == 0) {
+            return changed;
+        }
+
+        int remaining = static_cast<int>(len);
+        for (nlmsghdr* header = reinterpret_cast<nlmsghdr*>(buffer); NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_type == RTM_NEWROUTE || header->nlmsg_type == RTM_DELROUTE) {
+                const rtmsg* route = static_cast<const rtmsg*>(NLMSG_DATA(header));
+                if (route->rtm_dst_len == 0 && route->rtm_table == RT_TABLE_MAIN) {
+                    changed = true;
+                }
+            } else if (header->nlmsg_type == RTM_NEWADDR || header->nlmsg_type == RTM_DELADDR) {
+                const ifaddrmsg* address = static_cast<const ifaddrmsg*>(NLMSG_DATA(header));
+                if (address->ifa_scope == RT_SCOPE_UNIVERSE) {
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+bool ExternalIpResolver::isAddress(const std::string& text) {
+    unsigned char address[sizeof(in6_addr)];
+    return !text.empty() && text.size() < INET6_ADDRSTRLEN &&
+           (inet_pton(AF_INET, text.c_str(), address) == 1 || inet_pton(AF_INET6, text.c_str(), address) == 1);
+}
+
+void ExternalIpResolver::logError(const std::string& message) {
+    std::cerr << "[ExternalIpResolver] ERROR: " << message << std::endl;
+}
@@ -0,0 +1,277 @@
+#include "HardwareInventory.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <linux/netlink.h>
+#include <net/if_arp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Hotplug comes in bursts (a USB modem brings several interfaces, a CPU
+// going offline touches its thermal zone); rediscover once they settle
+const int kSettleMs = 500;
+
+const char* const kTemperaturePaths[] = {
+    "/sys/class/thermal/thermal_zone0/temp",
+    "/sys/class/hwmon/hwmon0/temp1_input",
+    "/sys/devices/virtual/thermal/thermal_zone0/temp",
+    nullptr
+};
+
+const char* const kFrequencyPaths[] = {
+    "/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq",
+    nullptr
+};
+
+std::string readLine(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+} // namespace
+
+HardwareInventory::HardwareInventory()
+    : running_(false), wake_fd_(-1), inventory_(discover()) {
+}
+
+HardwareInventory::~HardwareInventory() {
+    stop();
+}
+
+bool HardwareInventory::start() {
+    if (running_.load()) {
+        logError("HardwareInventory is already running");
+        return false;
+    }
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0) {
+        logError("eventfd: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    running_.store(true);
+    monitor_thread_ = std::thread(&HardwareInventory::monitorLoop, this);
+    return true;
+}
+
+void HardwareInventory::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        logError("Failed to wake inventory thread: " + std::string(strerror(errno)));
+    }
+    if (monitor_thread_.joinable()) {
+        monitor_thread_.join();
+    }
+    close(wake_fd_);
+    wake_fd_ = -1;
+}
+
+std::shared_ptr<const HardwareInventory::Inventory> HardwareInventory::get() const {
+    return std::atomic_load(&inventory_);
+}
+
+void HardwareInventory::monitorLoop() {
+    typedef std::chrono::steady_clock Clock;
+
+    // Without uevents (containers) the inventory stays as discovered
+    int uevent_fd = openUeventSocket();
+    if (uevent_fd < 0) {
+        logError("Kernel uevents unavailable, hotplug will not be followed: " + std::string(strerror(errno)));
+    }
+
+    // Devices may have come or gone between construction and start()
+    rediscover();
+
+    bool pending = false;
+    Clock::time_point due;
+    while (running_.load()) {
+        int timeout_ms = -1;
+        if (pending) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(due - Clock::now()).count();
+            timeout_ms = static_cast<int>(std::max<long long>(remaining, 0));
+        }
+
+        pollfd fds[2] = {{wake_fd_, POLLIN, 0}, {uevent_fd, POLLIN, 0}};
+        int ready = poll(fds, uevent_fd >= 0 ? 2 : 1, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            logError("poll: " + std::string(strerror(errno)));
+            break;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+        if (uevent_fd >= 0 && fds[1].revents && hardwareChanged(uevent_fd) && !pending) {
+            pending = true;
+            due = Clock::now() + std::chrono::milliseconds(kSettleMs);
+        }
+        if (pending && Clock::now() >= due) {
+            pending = false;
+            rediscover();
+        }
+    }
+
+    if (uevent_fd >= 0) {
+        close(uevent_fd);
+    }
+}
+
+void HardwareInventory::rediscover() {
+    auto previous = get();
+    auto inventory = discover();
+    if (inventory->cpu_cores == previous->cpu_cores && inventory->temperature_path == previous->temperature_path &&
+        inventory->frequency_path == previous->frequency_path &&
+        inventory->mac_addresses == previous->mac_addresses) {
+        return;
+    }
+
+    inventory->generation = previous->generation + 1;
+    std::shared_ptr<const Inventory> published = std::move(inventory);
+    std::atomic_store(&inventory_, published);
+    std::cout << "[HardwareInventory] Hardware changed: " << published->cpu_cores << " CPUs, "
+              << published->mac_addresses.size() << " Ethernet-type interfaces" << std::endl;
+}
+
+std::shared_ptr<HardwareInventory::Inventory> HardwareInventory::discover() {
+    auto inventory = std::make_shared<Inventory>();
+    inventory->cpu_cores = countOnlineCpus();
+    inventory->temperature_path = firstReadablePath(kTemperaturePaths);
+    inventory->frequency_path = firstReadablePath(kFrequencyPaths);
+    inventory->mac_addresses = readMacAddresses();
+    return inventory;
+}
+
+// Parses the CPU list in /sys/devices/system/cpu/online ("0-3,6")
+int HardwareInventory::countOnlineCpus() {
+    std::string online = readLine("/sys/devices/system/cpu/online");
+    int count = 0;
+    const char* p = online.c_str();
+    while (*p) {
+        char* end = nullptr;
+        long first = std::strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = std::strtol(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+        }
+        count += static_cast<int>(std::max(0L, last - first + 1));
+        p = *end == ',' ? end + 1 : end;
+    }
+
+    if (count > 0) {
+        return count;
+    }
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? static_cast<int>(cores) : 1;
+}
+
+std::string HardwareInventory::firstReadablePath(const char* const* paths) {
+    for (; *paths; ++paths) {
+        if (access(*paths, R_OK) == 0) {
+            return *paths;
+        }
+    }
+    return "";
+}
+
+std::map<std::string, std::string> HardwareInventory::readMacAddresses() {
+    std::map<std::string, std::string> addresses;
+    DIR* directory = opendir("/sys/class/net");
+    if (!directory) {
+        return addresses;
+    }
+
+    while (dirent* entry = readdir(directory)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::string base = std::string("/sys/class/net/") + entry->d_name;
+        if (std::atoi(readLine(base + "/type").c_str()) != ARPHRD_ETHER) {
+            continue;
+        }
+        std::string address = readLine(base + "/address");
+        if (!address.empty() && address != "00:00:00:00:00:00") {
+            addresses[entry->d_name] = address;
+        }
+    }
+    closedir(directory);
+    return addresses;
+}
+
+int HardwareInventory::openUeventSocket() {
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Group 1 carries the kernel's own events, without udev in between
+    sockaddr_nl local{};
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = 1;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+// Drains queued uevents; true if one was for a subsystem the inventory
+// covers. A uevent is "ACTION@DEVPATH" followed by NUL-separated KEY=VALUE
+// pairs.
+bool HardwareInventory::hardwareChanged(int uevent_fd) {
+    static const char* const kSubsystems[] = {"SUBSYSTEM=cpu", "SUBSYSTEM=net", "SUBSYSTEM=thermal",
+                                              "SUBSYSTEM=hwmon"};
+    bool changed = false;
+    char buffer[8192];
+
+    for (;;) {
+        ssize_t len = recv(uevent_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (len < 0) {
+            // ENOBUFS: events were lost, so assume the worst
+            return changed || errno == ENOBUFS;
+        }
+        if (len == 0) {
+            return changed;
+        }
+
+        const char* end = buffer + len;
+        for (const char* field = buffer; field < end; field += std::strlen(field) + 1) {
+            const char* terminator = static_cast<const char*>(std::memchr(field, '\0', end - field));
+            if (!terminator) {
+                break;
+            }
+            for (const char* subsystem : kSubsystems) {
+                if (std::strcmp(field, subsystem) == 0) {
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+void HardwareInventory::logError(const std::string& message) {
+    std::cerr << "[HardwareInventory] ERROR: " << message << std::endl;
+}
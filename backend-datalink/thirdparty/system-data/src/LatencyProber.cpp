@@ -0,0 +1,285 @@
+#include "LatencyProber.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+struct PendingProbe {
+    int fd = -1;
+    std::chrono::steady_clock::time_point started;
+};
+
+// Starts a non-blocking connect; returns the socket or -1
+int startConnect(const std::string& host, const std::string& port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result) {
+        return -1;
+    }
+
+    int fd = socket(result->ai_family, result->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    result->ai_protocol);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) != 0 && errno != EINPROGRESS) {
+        // Refused straight away (loopback) still proves the host answered
+        if (errno != ECONNREFUSED) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    freeaddrinfo(result);
+    return fd;
+}
+
+} // namespace
+
+LatencyProber::LatencyProber()
+    : running_(false), interval_ms_(10000), timeout_ms_(2000), window_size_(10) {
+    setTargets({"8.8.8.8:53", "1.1.1.1:53"});
+}
+
+LatencyProber::~LatencyProber() {
+    stop();
+}
+
+bool LatencyProber::setTargets(const std::vector<std::string>& targets) {
+    std::vector<Target> parsed;
+    for (const auto& name : targets) {
+        Target target;
+        if (!splitTarget(name, target.host, target.port)) {
+            logError("Invalid latency target (expected host:port): " + name);
+            return false;
+        }
+        target.name = name;
+        target.window.assign(window_size_, 0.0);
+        parsed.push_back(std::move(target));
+    }
+
+    std::lock_guard<std::mutex> lock(targets_mutex_);
+    targets_ = std::move(parsed);
+    return true;
+}
+
+bool LatencyProber::start() {
+    if (running_.load()) {
+        logError("LatencyProber is already running");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(targets_mutex_);
+        for (auto& target : targets_) {
+            target.window.assign(window_size_, 0.0);
+            target.next = 0;
+            target.count = 0;
+        }
+    }
+
+    running_.store(true);
+    prober_thread_ = std::thread(&LatencyProber::probeLoop, this);
+    return true;
+}
+
+void LatencyProber::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        if (!running_.load()) {
+            return;
+        }
+        running_.store(false);
+    }
+    wake_cv_.notify_all();
+
+    if (prober_thread_.joinable()) {
+        prober_thread_.join();
+    }
+}
+
+std::vector<LatencyProber::TargetStats> LatencyProber::getStats() const {
+    std::lock_guard<std::mutex> lock(targets_mutex_);
+    std::vector<TargetStats> stats;
+    stats.reserve(targets_.size());
+    for (const auto& target : targets_) {
+        stats.push_back(summarize(target));
+    }
+    return stats;
+}
+
+void LatencyProber::probeLoop() {
+    auto next_due = std::chrono::steady_clock::now();
+
+    while (running_.load()) {
+        std::vector<Target> targets;
+        {
+            std::lock_guard<std::mutex> lock(targets_mutex_);
+            targets = targets_;
+        }
+
+        std::vector<double> results = probeRound(targets);
+        if (!running_.load()) {
+            break;
+        }
+
+        std::vector<TargetStats> stats;
+        {
+            std::lock_guard<std::mutex> lock(targets_mutex_);
+            for (size_t i = 0; i < targets_.size() && i < results.size(); ++i) {
+                Target& target = targets_[i];
+                target.window[target.next] = results[i];
+                target.next = (target.next + 1) % target.window.size();
+                target.count = std::min(target.count + 1, target.window.size());
+                stats.push_back(summarize(target));
+            }
+        }
+
+        if (callback_) {
+            callback_(stats);
+        }
+
+        next_due += std::chrono::milliseconds(interval_ms_);
+        auto now = std::chrono::steady_clock::now();
+        if (next_due <= now) {
+            next_due = now + std::chrono::milliseconds(interval_ms_);
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait_until(lock, next_due, [this] { return !running_.load(); });
+    }
+}
+
+// Probes all targets in parallel and waits at most timeout_ms_ in total
+std::vector<double> LatencyProber::probeRound(const std::vector<Target>& targets) {
+    std::vector<double> results(targets.size(), -1.0);
+    std::vector<PendingProbe> probes(targets.size());
+
+    for (size_t i = 0; i < targets.size(); ++i) {
+        probes[i].started = std::chrono::steady_clock::now();
+        probes[i].fd = startConnect(targets[i].host, targets[i].port);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms_.load());
+    for (;;) {
+        std::vector<pollfd> fds;
+        std::vector<size_t> owners;
+        for (size_t i = 0; i < probes.size(); ++i) {
+            if (probes[i].fd >= 0) {
+                fds.push_back({probes[i].fd, POLLOUT, 0});
+                owners.push_back(i);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (fds.empty() || now >= deadline || !running_.load()) {
+            break;
+        }
+
+        // Short slices keep stop() responsive during a long timeout
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+        int ready = poll(fds.data(), fds.size(), static_cast<int>(std::min<long long>(remaining, 100)));
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (size_t j = 0; ready > 0 && j < fds.size(); ++j) {
+            if (fds[j].revents == 0) {
+                continue;
+            }
+
+            PendingProbe& probe = probes[owners[j]];
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(probe.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error == 0 || error == ECONNREFUSED) {
+                results[owners[j]] = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - probe.started).count();
+            }
+
+            close(probe.fd);
+            probe.fd = -1;
+        }
+    }
+
+    for (auto& probe : probes) {
+        if (probe.fd >= 0) {
+            close(probe.fd);
+        }
+    }
+
+    return results;
+}
+
+LatencyProber::TargetStats LatencyProber::summarize(const Target& target) {
+    TargetStats stats;
+    stats.target = target.name;
+    stats.samples = static_cast<int>(target.count);
+    if (target.count == 0) {
+        return stats;
+    }
+
+    size_t size = target.window.size();
+    size_t oldest = (target.next + size - target.count) % size;
+    size_t answered = 0;
+    double sum = 0.0;
+    double jitter_sum = 0.0;
+    double previous = -1.0;
+
+    for (size_t i = 0; i < target.count; ++i) {
+        double rtt = target.window[(oldest + i) % size];
+        if (rtt < 0.0) {
+            continue;
+        }
+
+        if (answered == 0 || rtt < stats.min_ms) {
+            stats.min_ms = rtt;
+        }
+        stats.max_ms = std::max(stats.max_ms, rtt);
+        sum += rtt;
+        if (previous >= 0.0) {
+            jitter_sum += std::fabs(rtt - previous);
+        }
+        previous = rtt;
+        answered++;
+    }
+
+    double last = target.window[(target.next + size - 1) % size];
+    stats.reachable = last >= 0.0;
+    stats.last_ms = stats.reachable ? last : 0.0;
+    stats.loss_percent = 100.0 * static_cast<double>(target.count - answered) / target.count;
+    if (answered > 0) {
+        stats.avg_ms = sum / answered;
+    }
+    if (answered > 1) {
+        stats.jitter_ms = jitter_sum / (answered - 1);
+    }
+    return stats;
+}
+
+// Accepts "host:port" and "[v6-address]:port"
+bool LatencyProber::splitTarget(const std::string& target, std::string& host, std::string& port) {
+    size_t colon = target.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 >= target.size()) {
+        return false;
+    }
+
+    host = target.substr(0, colon);
+    port = target.substr(colon + 1);
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    return std::all_of(port.begin(), port.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+void LatencyProber::logError(const std::string& message) {
+    std::cerr << "[LatencyProber] ERROR: " << message << std::endl;
+}
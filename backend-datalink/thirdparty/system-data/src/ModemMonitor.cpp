@@ -0,0 +1,574 @@
+#include "ModemMonitor.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+// Longest wait for OK/ERROR; +COPS? can take a few seconds while searching
+const int kCommandTimeoutMs = 5000;
+
+// Unanswered commands in a row before the port is reopened
+const int kMaxTimeouts = 3;
+
+// Wait before reopening a port that failed or disappeared
+const int kReopenMs = 10000;
+
+// A line longer than this is noise (wrong baud rate, binary protocol)
+const size_t kMaxLine = 1024;
+
+// Enables the indications the monitor relies on. Anything a modem does not
+// support just answers ERROR and is skipped.
+const char* const kInitCommands[] = {
+    "ATE0",                      // No echo
+    "AT+CMEE=1",                 // Numeric +CME ERROR
+    "AT+COPS=3,0",               // Long alphanumeric operator names
+    "AT+CREG=2",                 // Unsolicited registration with cell id
+    "AT+CEREG=2",
+    "AT+C5GREG=2",
+    "AT+QINDCFG=\"csq\",1,0",    // Quectel: push +QIND "csq" on change
+    "AT+CREG?",
+    "AT+CEREG?",
+    "AT+C5GREG?",
+    "AT+COPS?",
+    "AT+CGDCONT?"
+};
+
+bool startsWith(const std::string& text, const char* prefix) {
+    return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+bool toInt(const std::string& text, int& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (*end != '\0') {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+bool registered(int stat) {
+    return stat == 1 || stat == 5;
+}
+
+} // namespace
+
+bool ModemMonitor::Status::operator==(const Status& other) const {
+    return present == other.present && registration == other.registration && network == other.network &&
+           technology == other.technology && band == other.band && cell_id == other.cell_id &&
+           apn == other.apn && measured == other.measured && rssi_dbm == other.rssi_dbm &&
+           rsrp_dbm == other.rsrp_dbm && rsrq_db == other.rsrq_db && sinr_db == other.sinr_db &&
+           data_usage_mb == other.data_usage_mb;
+}
+
+ModemMonitor::ModemMonitor()
+    : running_(false), interval_ms_(5000), wake_fd_(-1), port_fd_(-1), timeouts_(0),
+      qeng_supported_(true), registrations_{0, 0, 0} {
+}
+
+ModemMonitor::~ModemMonitor() {
+    stop();
+}
+
+bool ModemMonitor::start() {
+    if (running_.load()) {
+        logError("ModemMonitor is already running");
+        return false;
+    }
+    if (device_.empty()) {
+        logError("No modem device configured");
+        return false;
+    }
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0) {
+        logError("eventfd: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    running_.store(true);
+    monitor_thread_ = std::thread(&ModemMonitor::monitorLoop, this);
+    return true;
+}
+
+void ModemMonitor::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        logError("Failed to wake monitor: " + std::string(strerror(errno)));
+    }
+    if (monitor_thread_.joinable()) {
+        monitor_thread_.join();
+    }
+    close(wake_fd_);
+    wake_fd_ = -1;
+}
+
+ModemMonitor::Status ModemMonitor::getStatus() const {
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    return reported_;
+}
+
+void ModemMonitor::monitorLoop() {
+    bool open_failed = false;
+    auto next_poll = Clock::now();
+
+    while (running_.load()) {
+        if (port_fd_ < 0) {
+            if (!openPort()) {
+                // Reported once, then retried quietly until the modem shows up
+                if (!open_failed) {
+                    logError("Cannot open " + device_ + ": " + std::string(strerror(errno)) +
+                             " (retrying every " + std::to_string(kReopenMs / 1000) + "s)");
+                    open_failed = true;
+                }
+                current_ = Status();
+                report();
+                if (waitForStop(kReopenMs)) {
+                    break;
+                }
+                continue;
+            }
+            open_failed = false;
+            std::cout << "[ModemMonitor] Opened " << device_ << std::endl;
+            queueInit();
+            next_poll = Clock::now();
+        }
+
+        auto now = Clock::now();
+        if (in_flight_.empty()) {
+            if (pending_.empty() && now >= next_poll) {
+                queuePoll();
+                next_poll = now + std::chrono::milliseconds(interval_ms_);
+            }
+            if (!pending_.empty()) {
+                sendNext();
+                if (port_fd_ < 0) {
+                    continue;
+                }
+            } else {
+                // Idle between rounds: whatever changed goes out now
+                report();
+            }
+        } else if (now >= deadline_) {
+            if (++timeouts_ >= kMaxTimeouts) {
+                logError("Modem stopped answering on " + device_ + ", reopening");
+                closePort();
+                current_ = Status();
+                report();
+                continue;
+            }
+            finishCommand(false);
+            continue;
+        }
+
+        auto until = in_flight_.empty() ? next_poll : deadline_;
+        long long wait = std::chrono::duration_cast<std::chrono::milliseconds>(until - Clock::now()).count() + 1;
+        pollfd fds[2] = {{wake_fd_, POLLIN, 0}, {port_fd_, POLLIN, 0}};
+        int ready = poll(fds, 2, static_cast<int>(std::max(0LL, std::min(wait, 60000LL))));
+        if (ready < 0 && errno != EINTR) {
+            logError("poll: " + std::string(strerror(errno)));
+            break;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+        if (fds[1].revents && !readPort()) {
+            // USB modems vanish on reset; the port comes back under the same name
+            logError("Lost " + device_ + ", reopening");
+            closePort();
+            current_ = Status();
+            report();
+            if (waitForStop(kReopenMs)) {
+                break;
+            }
+        }
+    }
+
+    closePort();
+}
+
+bool ModemMonitor::openPort() {
+    int fd = open(device_.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    termios tio{};
+    if (tcgetattr(fd, &tio) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return false;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cflag |= CLOCAL | CREAD;
+    // VMIN 1 so an empty non-blocking read fails with EAGAIN and 0 means hangup
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return false;
+    }
+    tcflush(fd, TCIOFLUSH);
+
+    port_fd_ = fd;
+    rx_buffer_.clear();
+    pending_.clear();
+    in_flight_.clear();
+    timeouts_ = 0;
+    qeng_supported_ = true;
+    std::fill(std::begin(registrations_), std::end(registrations_), 0);
+    current_ = Status();
+    current_.present = true;
+    return true;
+}
+
+void ModemMonitor::closePort() {
+    if (port_fd_ >= 0) {
+        close(port_fd_);
+        port_fd_ = -1;
+    }
+    pending_.clear();
+    in_flight_.clear();
+}
+
+void ModemMonitor::queueInit() {
+    pending_.assign(std::begin(kInitCommands), std::end(kInitCommands));
+}
+
+void ModemMonitor::queuePoll() {
+    pending_.push_back("AT+CSQ");
+    pending_.push_back("AT+CESQ");
+    if (qeng_supported_) {
+        pending_.push_back("AT+QENG=\"servingcell\"");
+    }
+    readDataUsage();
+}
+
+void ModemMonitor::sendNext() {
+    in_flight_ = pending_.front();
+    pending_.pop_front();
+
+    // A few dozen bytes always fit the tty buffer; a short write means the
+    // port is gone
+    std::string line = in_flight_ + "\r";
+    ssize_t written = write(port_fd_, line.data(), line.size());
+    if (written != static_cast<ssize_t>(line.size())) {
+        logError("Write to " + device_ + " failed: " + std::string(strerror(errno)));
+        closePort();
+        return;
+    }
+    deadline_ = Clock::now() + std::chrono::milliseconds(kCommandTimeoutMs);
+}
+
+// Returns false once the port reports an error or hangup
+bool ModemMonitor::readPort() {
+    char buffer[512];
+    for (;;) {
+        ssize_t n = read(port_fd_, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (n == 0) {
+            return false;
+        }
+
+        rx_buffer_.append(buffer, static_cast<size_t>(n));
+        size_t start = 0;
+        size_t end;
+        while ((end = rx_buffer_.find_first_of("\r\n", start)) != std::string::npos) {
+            if (end > start) {
+                handleLine(rx_buffer_.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+        rx_buffer_.erase(0, start);
+        if (rx_buffer_.size() > kMaxLine) {
+            rx_buffer_.clear();
+        }
+    }
+}
+
+void ModemMonitor::handleLine(const std::string& line) {
+    if (line == "OK") {
+        finishCommand(true);
+        return;
+    }
+    if (line == "ERROR" || startsWith(line, "+CME ERROR") || startsWith(line, "+CMS ERROR")) {
+        finishCommand(false);
+        return;
+    }
+    if (line == in_flight_) {
+        return; // Echo, until ATE0 takes effect
+    }
+
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+        return;
+    }
+    std::string prefix = line.substr(0, colon);
+    std::vector<std::string> fields = splitFields(line.substr(colon + 1));
+
+    // A query answer has the same prefix as the indication but leads with <n>
+    bool query = !in_flight_.empty() && in_flight_.back() == '?' && in_flight_.compare(2, prefix.size(), prefix) == 0;
+    if (prefix == "+CREG") {
+        parseRegistration(0, fields, query);
+    } else if (prefix == "+CEREG") {
+        parseRegistration(1, fields, query);
+    } else if (prefix == "+C5GREG") {
+        parseRegistration(2, fields, query);
+    } else if (prefix == "+COPS") {
+        parseOperator(fields);
+    } else if (prefix == "+CSQ" || prefix == "+CESQ") {
+        if (prefix == "+CESQ") {
+            fields.insert(fields.begin(), "cesq");
+        }
+        parseSignalQuality(fields);
+    } else if (prefix == "+QIND" && !fields.empty() && fields[0] == "csq") {
+        parseSignalQuality(fields);
+        report();
+    } else if (prefix == "+QENG" && !fields.empty() && fields[0] == "servingcell") {
+        parseServingCell(fields);
+    } else if (prefix == "+CGDCONT" && fields.size() >= 3 && fields[0] == "1") {
+        current_.apn = fields[2];
+    }
+}
+
+void ModemMonitor::finishCommand(bool ok) {
+    if (in_flight_.empty()) {
+        return;
+    }
+    if (!ok && startsWith(in_flight_, "AT+QENG")) {
+        qeng_supported_ = false;
+    }
+    // An answer of any kind proves the modem is alive
+    if (Clock::now() < deadline_) {
+        timeouts_ = 0;
+    }
+    in_flight_.clear();
+}
+
+// Indication: <stat>[,<lac/tac>,<ci>[,<AcT>]]; query: <n>,<stat>[,...]
+void ModemMonitor::parseRegistration(int domain, const std::vector<std::string>& fields, bool query) {
+    size_t first = query ? 1 : 0;
+    int stat = 0;
+    if (fields.size() <= first || !toInt(fields[first], stat)) {
+        return;
+    }
+
+    bool was_registered = registered(current_.registration);
+    registrations_[domain] = stat;
+
+    // The newest registered domain wins (5G over LTE over 2G/3G)
+    int best = registrations_[0];
+    for (int i = 2; i >= 0; --i) {
+        if (registered(registrations_[i])) {
+            best = registrations_[i];
+            if (i == domain && fields.size() >= first + 3) {
+                current_.cell_id = fields[first + 2];
+                int access_technology = 0;
+                if (fields.size() >= first + 4 && toInt(fields[first + 3], access_technology)) {
+                    current_.technology = technologyName(access_technology);
+                }
+            }
+            break;
+        }
+        if (registrations_[i] != 0) {
+            best = registrations_[i];
+        }
+    }
+    current_.registration = best;
+
+    // Operator and APN only change with registration; refresh them then
+    if (!query && registered(best) != was_registered) {
+        pending_.push_back("AT+COPS?");
+        pending_.push_back("AT+CGDCONT?");
+    }
+    if (!registered(best)) {
+        current_.cell_id.clear();
+        current_.network.clear();
+    }
+}
+
+// <mode>[,<format>,<oper>[,<AcT>]]
+void ModemMonitor::parseOperator(const std::vector<std::string>& fields) {
+    if (fields.size() >= 3) {
+        current_.network = fields[2];
+    }
+    int access_technology = 0;
+    if (fields.size() >= 4 && toInt(fields[3], access_technology)) {
+        current_.technology = technologyName(access_technology);
+    }
+}
+
+// +CSQ: <rssi>,<ber>; +QIND: "csq",<rssi>,<ber>;
+// +CESQ: <rxlev>,<ber>,<rscp>,<ecno>,<rsrq>,<rsrp> (tagged "cesq" by handleLine)
+void ModemMonitor::parseSignalQuality(const std::vector<std::string>& fields) {
+    int value = 0;
+    if (fields.size() >= 7 && fields[0] == "cesq") {
+        if (toInt(fields[5], value) && value != 255) {
+            current_.rsrq_db = -20.0 + value * 0.5;
+            current_.measured = true;
+        }
+        if (toInt(fields[6], value) && value != 255) {
+            current_.rsrp_dbm = -141.0 + value;
+            current_.measured = true;
+        }
+        return;
+    }
+
+    size_t first = fields.size() >= 3 && fields[0] == "csq" ? 1 : 0;
+    if (fields.size() > first && toInt(fields[first], value)) {
+        if (value == 99) {
+            current_.rssi_dbm = 0.0;
+        } else {
+            current_.rssi_dbm = -113.0 + 2.0 * value;
+            current_.measured = true;
+        }
+    }
+}
+
+// "servingcell",<state>,"LTE",<duplex>,<mcc>,<mnc>,<cellid>,<pcid>,<earfcn>,
+//     <band>,<ul_bw>,<dl_bw>,<tac>,<rsrp>,<rsrq>,<rssi>,<sinr>,...
+// "servingcell",<state>,"NR5G-SA",<duplex>,<mcc>,<mnc>,<cellid>,<pcid>,<tac>,
+//     <arfcn>,<band>,<dl_bw>,<rsrp>,<rsrq>,<sinr>,...
+void ModemMonitor::parseServingCell(const std::vector<std::string>& fields) {
+    if (fields.size() < 3) {
+        return;
+    }
+
+    int rsrp = 0;
+    int rsrq = 0;
+    int sinr = 0;
+    if (fields[2] == "LTE" && fields.size() >= 17) {
+        current_.band = "LTE B" + fields[9];
+        if (toInt(fields[13], rsrp) && toInt(fields[14], rsrq)) {
+            current_.rsrp_dbm = rsrp;
+            current_.rsrq_db = rsrq;
+            current_.measured = true;
+        }
+        // LTE SINR comes in fifths of a dB offset by -20 dB
+        if (toInt(fields[16], sinr)) {
+            current_.sinr_db = sinr / 5.0 - 20.0;
+        }
+    } else if (fields[2] == "NR5G-SA" && fields.size() >= 15) {
+        current_.band = "n" + fields[10];
+        if (toInt(fields[12], rsrp) && toInt(fields[13], rsrq)) {
+            current_.rsrp_dbm = rsrp;
+            current_.rsrq_db = rsrq;
+            current_.measured = true;
+        }
+        if (toInt(fields[14], sinr)) {
+            current_.sinr_db = sinr;
+        }
+    }
+}
+
+void ModemMonitor::readDataUsage() {
+    if (data_interface_.empty()) {
+        return;
+    }
+
+    unsigned long long total = 0;
+    for (const char* counter : {"rx_bytes", "tx_bytes"}) {
+        std::ifstream file("/sys/class/net/" + data_interface_ + "/statistics/" + counter);
+        unsigned long long bytes = 0;
+        if (file >> bytes) {
+            total += bytes;
+        }
+    }
+    current_.data_usage_mb = static_cast<double>(total) / (1024.0 * 1024.0);
+}
+
+void ModemMonitor::report() {
+    {
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        if (current_ == reported_) {
+            return;
+        }
+        reported_ = current_;
+    }
+    if (callback_) {
+        callback_(current_);
+    }
+}
+
+// Returns true if stop() was called within timeout_ms
+bool ModemMonitor::waitForStop(int timeout_ms) {
+    pollfd fd = {wake_fd_, POLLIN, 0};
+    return poll(&fd, 1, timeout_ms) > 0 || !running_.load();
+}
+
+// Splits "1,\"0A1B\",\"00C3D4E5\",7" into unquoted, trimmed fields
+std::vector<std::string> ModemMonitor::splitFields(const std::string& text) {
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    for (char c : text) {
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != ' ' || quoted) {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+// 3GPP TS 27.007 <AcT>
+std::string ModemMonitor::technologyName(int access_technology) {
+    switch (access_technology) {
+    case 0:
+    case 1:
+        return "GSM";
+    case 3:
+        return "EDGE";
+    case 2:
+        return "UMTS";
+    case 4:
+    case 5:
+    case 6:
+        return "HSPA";
+    case 7:
+    case 9:
+    case 10:
+        return "LTE";
+    case 11:
+    case 12:
+        return "5G NR";
+    case 13:
+        return "5G NSA";
+    default:
+        return "Unknown";
+    }
+}
+
+void ModemMonitor::logError(const std::string& message) {
+    std::cerr << "[ModemMonitor] ERROR: " << message << std::endl;
+}
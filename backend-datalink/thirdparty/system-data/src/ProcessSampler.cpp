@@ -0,0 +1,329 @@
+#include "ProcessSampler.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Layout of the records getdents64 fills in
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+// comm is at most 15 characters; longer watch names match their prefix
+const size_t kCommLength = 15;
+
+// Skips blanks, then reads an unsigned decimal; nullptr when there is none
+const char* parseUnsigned(const char* p, unsigned long long& value) {
+    while (*p == ' ' || *p == '\t') {
+        ++p;
+    }
+    if (*p < '0' || *p > '9') {
+        return nullptr;
+    }
+    char* end = nullptr;
+    value = std::strtoull(p, &end, 10);
+    return end;
+}
+
+// Value of "key value" in a flat-keyed file such as cpu.stat
+bool keyedValue(const char* text, const char* key, unsigned long long& value) {
+    size_t length = std::strlen(key);
+    for (const char* line = text; *line; ) {
+        if (std::strncmp(line, key, length) == 0 && line[length] == ' ') {
+            return parseUnsigned(line + length, value) != nullptr;
+        }
+        const char* next = std::strchr(line, '\n');
+        if (!next) {
+            break;
+        }
+        line = next + 1;
+    }
+    return false;
+}
+
+} // namespace
+
+ProcessSampler::ProcessSampler()
+    : proc_fd_(open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      cgroup_cpu_max_fd_(-1), cgroup_cpu_stat_fd_(-1), cgroup_memory_current_fd_(-1), cgroup_memory_max_fd_(-1),
+      pressure_fds_{open("/proc/pressure/cpu", O_RDONLY | O_CLOEXEC),
+                    open("/proc/pressure/memory", O_RDONLY | O_CLOEXEC),
+                    open("/proc/pressure/io", O_RDONLY | O_CLOEXEC)},
+      top_count_(5), dirents_(32768), scan_(0), cgroup_primed_(false), cgroup_usage_usec_(0),
+      cgroup_periods_(0), cgroup_throttled_(0), cgroup_throttled_usec_(0) {
+    long ticks = sysconf(_SC_CLK_TCK);
+    long page = sysconf(_SC_PAGESIZE);
+    ticks_per_second_ = ticks > 0 ? static_cast<double>(ticks) : 100.0;
+    page_mb_ = (page > 0 ? static_cast<double>(page) : 4096.0) / (1024.0 * 1024.0);
+
+    if (proc_fd_ < 0) {
+        logError("Failed to open /proc: " + std::string(strerror(errno)));
+    }
+    openCgroup();
+}
+
+ProcessSampler::~ProcessSampler() {
+    for (int fd : {proc_fd_, cgroup_cpu_max_fd_, cgroup_cpu_stat_fd_, cgroup_memory_current_fd_,
+                   cgroup_memory_max_fd_, pressure_fds_[0], pressure_fds_[1], pressure_fds_[2]}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool ProcessSampler::sample(Result& result) {
+    if (proc_fd_ < 0) {
+        return false;
+    }
+
+    auto started = Clock::now();
+    double seconds = scan_ > 0 ? std::chrono::duration<double>(started - previous_time_).count() : 0.0;
+    previous_time_ = started;
+    ++scan_;
+
+    scanProcesses(seconds, result);
+    sampleCgroup(seconds, result.cgroup);
+    readPressure(pressure_fds_[0], result.cpu_pressure);
+    readPressure(pressure_fds_[1], result.memory_pressure);
+    readPressure(pressure_fds_[2], result.io_pressure);
+
+    result.scan_ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    return true;
+}
+
+void ProcessSampler::scanProcesses(double seconds, Result& result) {
+    processes_.clear();
+    if (lseek(proc_fd_, 0, SEEK_SET) < 0) {
+        logError("Failed to rewind /proc: " + std::string(strerror(errno)));
+        return;
+    }
+
+    for (;;) {
+        long length = syscall(SYS_getdents64, proc_fd_, dirents_.data(), dirents_.size());
+        if (length <= 0) {
+            if (length < 0) {
+                logError("Failed to list /proc: " + std::string(strerror(errno)));
+            }
+            break;
+        }
+
+        for (long offset = 0; offset < length; ) {
+            const LinuxDirent64* entry = reinterpret_cast<const LinuxDirent64*>(dirents_.data() + offset);
+            offset += entry->d_reclen;
+            if (entry->d_name[0] < '1' || entry->d_name[0] > '9') {
+                continue;
+            }
+
+            ProcessStats stats;
+            int pid = std::atoi(entry->d_name);
+            if (readProcess(entry->d_name, pid, seconds, stats)) {
+                processes_.push_back(std::move(stats));
+            }
+        }
+    }
+
+    // Forget processes that exited
+    for (auto it = previous_.begin(); it != previous_.end(); ) {
+        it = it->second.scan == scan_ ? std::next(it) : previous_.erase(it);
+    }
+
+    result.process_count = static_cast<int>(processes_.size());
+    size_t count = std::min(top_count_, processes_.size());
+
+    result.top_cpu.resize(count);
+    std::partial_sort_copy(processes_.begin(), processes_.end(), result.top_cpu.begin(), result.top_cpu.end(),
+                           [](const ProcessStats& a, const ProcessStats& b) { return a.cpu_percent > b.cpu_percent; });
+    result.top_memory.resize(count);
+    std::partial_sort_copy(processes_.begin(), processes_.end(), result.top_memory.begin(), result.top_memory.end(),
+                           [](const ProcessStats& a, const ProcessStats& b) { return a.rss_mb > b.rss_mb; });
+
+    result.watched.clear();
+    for (const auto& process : processes_) {
+        for (const auto& name : watched_names_) {
+            if (std::strncmp(process.name.c_str(), name.c_str(), kCommLength) == 0) {
+                result.watched.push_back(process);
+                break;
+            }
+        }
+    }
+}
+
+// One read of /proc/<pid>/stat: "pid (comm) state ppid ..." with utime and
+// stime in fields 14 and 15, starttime in 22 and rss (pages) in 24
+bool ProcessSampler::readProcess(const char* pid_name, int pid, double seconds, ProcessStats& stats) {
+    char path[32];
+    std::snprintf(path, sizeof(path), "%s/stat", pid_name);
+    int fd = openat(proc_fd_, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false; // Exited since the listing
+    }
+    long length = readAt(fd, stat_buffer_, sizeof(stat_buffer_));
+    close(fd);
+    if (length <= 0) {
+        return false;
+    }
+
+    // comm may itself contain ')' and spaces; it ends at the last ')'
+    const char* open_paren = std::strchr(stat_buffer_, '(');
+    const char* close_paren = std::strrchr(stat_buffer_, ')');
+    if (!open_paren || !close_paren || close_paren < open_paren || close_paren[1] != ' ') {
+        return false;
+    }
+
+    // Fields from 4 on (after the state character) are numbers
+    unsigned long long fields[21] = {0};
+    const char* p = close_paren + 3;
+    for (int i = 0; i < 21 && p; ++i) {
+        unsigned long long value = 0;
+        p = parseUnsigned(p, value);
+        fields[i] = value;
+        if (p && *p == ' ' && p[1] == '-') {
+            p += 2; // Negative fields (priority, nice) do not matter here
+        }
+    }
+    if (!p) {
+        return false;
+    }
+
+    unsigned long long ticks = fields[10] + fields[11];
+    unsigned long long start_time = fields[18];
+
+    stats.pid = pid;
+    stats.name.assign(open_paren + 1, static_cast<size_t>(close_paren - open_paren - 1));
+    stats.rss_mb = static_cast<double>(fields[20]) * page_mb_;
+
+    Previous& previous = previous_[pid];
+    if (previous.scan == scan_ - 1 && previous.start_time == start_time && seconds > 0.0 && ticks >= previous.ticks) {
+        stats.cpu_percent = 100.0 * static_cast<double>(ticks - previous.ticks) / ticks_per_second_ / seconds;
+    }
+    previous.start_time = start_time;
+    previous.ticks = ticks;
+    previous.scan = scan_;
+    return true;
+}
+
+void ProcessSampler::sampleCgroup(double seconds, CgroupStats& cgroup) {
+    cgroup.path = cgroup_path_.empty() ? "N/A" : cgroup_path_;
+    char buffer[1024];
+
+    // "max 100000" when unlimited, else "<quota> <period>"
+    if (readAt(cgroup_cpu_max_fd_, buffer, sizeof(buffer)) > 0 && std::strncmp(buffer, "max", 3) != 0) {
+        unsigned long long quota = 0;
+        unsigned long long period = 0;
+        const char* p = parseUnsigned(buffer, quota);
+        if (p && parseUnsigned(p, period) && period > 0) {
+            cgroup.cpu_quota_cores = static_cast<double>(quota) / static_cast<double>(period);
+        }
+    }
+
+    unsigned long long usage_usec = 0;
+    unsigned long long periods = 0;
+    unsigned long long throttled = 0;
+    unsigned long long throttled_usec = 0;
+    if (readAt(cgroup_cpu_stat_fd_, buffer, sizeof(buffer)) > 0 && keyedValue(buffer, "usage_usec", usage_usec)) {
+        // The throttling keys exist only with the cpu controller enabled
+        keyedValue(buffer, "nr_periods", periods);
+        keyedValue(buffer, "nr_throttled", throttled);
+        keyedValue(buffer, "throttled_usec", throttled_usec);
+
+        if (cgroup_primed_ && seconds > 0.0 && usage_usec >= cgroup_usage_usec_) {
+            cgroup.cpu_percent = 100.0 * static_cast<double>(usage_usec - cgroup_usage_usec_) / (seconds * 1e6);
+            if (periods > cgroup_periods_ && throttled >= cgroup_throttled_) {
+                cgroup.throttled_percent = 100.0 * static_cast<double>(throttled - cgroup_throttled_) /
+                                           static_cast<double>(periods - cgroup_periods_);
+            }
+            if (throttled_usec >= cgroup_throttled_usec_) {
+                cgroup.throttled_ms = static_cast<double>(throttled_usec - cgroup_throttled_usec_) / 1000.0;
+            }
+        }
+        cgroup_usage_usec_ = usage_usec;
+        cgroup_periods_ = periods;
+        cgroup_throttled_ = throttled;
+        cgroup_throttled_usec_ = throttled_usec;
+        cgroup_primed_ = true;
+    }
+
+    unsigned long long bytes = 0;
+    if (readAt(cgroup_memory_current_fd_, buffer, sizeof(buffer)) > 0 && parseUnsigned(buffer, bytes)) {
+        cgroup.memory_mb = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+    if (readAt(cgroup_memory_max_fd_, buffer, sizeof(buffer)) > 0 && parseUnsigned(buffer, bytes)) {
+        cgroup.memory_limit_mb = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+// Finds our cgroup v2 directory ("0::/path" in /proc/self/cgroup) and opens
+// its accounting files. On a v1-only host the cgroup section stays empty.
+void ProcessSampler::openCgroup() {
+    std::ifstream file("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, 3, "0::") == 0) {
+            cgroup_path_ = line.substr(3);
+            break;
+        }
+    }
+    if (cgroup_path_.empty()) {
+        return;
+    }
+
+    int dir_fd = open(("/sys/fs/cgroup" + cgroup_path_).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        logError("Failed to open cgroup " + cgroup_path_ + ": " + std::string(strerror(errno)));
+        cgroup_path_.clear();
+        return;
+    }
+    cgroup_cpu_max_fd_ = openAt(dir_fd, "cpu.max");
+    cgroup_cpu_stat_fd_ = openAt(dir_fd, "cpu.stat");
+    cgroup_memory_current_fd_ = openAt(dir_fd, "memory.current");
+    cgroup_memory_max_fd_ = openAt(dir_fd, "memory.max");
+    close(dir_fd);
+}
+
+// "some avg10=0.00 avg60=0.00 avg300=0.00 total=0" and a "full" line,
+// which the cpu file lacks before Linux 5.13
+bool ProcessSampler::readPressure(int fd, Pressure& pressure) {
+    char buffer[256];
+    if (readAt(fd, buffer, sizeof(buffer)) <= 0) {
+        return false;
+    }
+
+    const char* full = std::strstr(buffer, "full ");
+    std::sscanf(buffer, "some avg10=%lf avg60=%lf", &pressure.some_avg10, &pressure.some_avg60);
+    if (full) {
+        std::sscanf(full, "full avg10=%lf avg60=%lf", &pressure.full_avg10, &pressure.full_avg60);
+    }
+    return true;
+}
+
+long ProcessSampler::readAt(int fd, char* buffer, size_t size) {
+    if (fd < 0 || size == 0) {
+        return -1;
+    }
+
+    ssize_t length = pread(fd, buffer, size - 1, 0);
+    if (length < 0) {
+        return -1;
+    }
+    buffer[length] = '\0';
+    return static_cast<long>(length);
+}
+
+int ProcessSampler::openAt(int dir_fd, const std::string& path) {
+    return openat(dir_fd, path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+void ProcessSampler::logError(const std::string& message) const {
+    std::cerr << "[ProcessSampler] ERROR: " << message << std::endl;
+}
@@ -0,0 +1,90 @@
+#include "SharedMetricsWriter.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+
+SharedMetricsWriter::SharedMetricsWriter()
+    : shm_(nullptr) {
+}
+
+SharedMetricsWriter::~SharedMetricsWriter() {
+    close();
+}
+
+bool SharedMetricsWriter::open(const std::string& name) {
+    if (shm_) {
+        logError("Shared memory is already open");
+        return false;
+    }
+
+    // World-readable: the readers are other local daemons
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        logError("shm_open " + name + ": " + std::string(strerror(errno)));
+        return false;
+    }
+    if (ftruncate(fd, sizeof(sysdata_shm_t)) != 0) {
+        logError("ftruncate " + name + ": " + std::string(strerror(errno)));
+        ::close(fd);
+        return false;
+    }
+
+    void* base = mmap(nullptr, sizeof(sysdata_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        logError("mmap " + name + ": " + std::string(strerror(errno)));
+        return false;
+    }
+    shm_ = static_cast<sysdata_shm_t*>(base);
+
+    // A segment from a previous run keeps its history; anything else
+    // (new, or another layout) starts empty. seq carries on either way so
+    // a reader mid-copy notices.
+    if (shm_->magic != SYSDATA_SHM_MAGIC || shm_->version != SYSDATA_SHM_VERSION ||
+        shm_->record_size != sizeof(sysdata_shm_metrics_t) || shm_->history_capacity != SYSDATA_SHM_HISTORY) {
+        beginWrite();
+        shm_->history_count = 0;
+        std::memset(&shm_->latest, 0, sizeof(shm_->latest));
+        std::memset(shm_->history, 0, sizeof(shm_->history));
+        shm_->version = SYSDATA_SHM_VERSION;
+        shm_->record_size = sizeof(sysdata_shm_metrics_t);
+        shm_->history_capacity = SYSDATA_SHM_HISTORY;
+        shm_->magic = SYSDATA_SHM_MAGIC;
+        endWrite();
+    }
+    return true;
+}
+
+void SharedMetricsWriter::close() {
+    if (shm_) {
+        munmap(shm_, sizeof(sysdata_shm_t));
+        shm_ = nullptr;
+    }
+}
+
+void SharedMetricsWriter::write(const sysdata_shm_metrics_t& record) {
+    if (!shm_) {
+        return;
+    }
+
+    beginWrite();
+    shm_->latest = record;
+    shm_->history[shm_->history_count % SYSDATA_SHM_HISTORY] = record;
+    ++shm_->history_count;
+    endWrite();
+}
+
+// Odd seq, then the stores; readers that saw the even value before see it
+// change and retry
+void SharedMetricsWriter::beginWrite() {
+    __atomic_store_n(&shm_->seq, shm_->seq | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void SharedMetricsWriter::endWrite() {
+    __atomic_store_n(&shm_->seq, shm_->seq + 1, __ATOMIC_RELEASE);
+}
+
+void SharedMetricsWriter::logError(const std::string& message) const {
+    std::cerr << "[SharedMetricsWriter] ERROR: " << message << std::endl;
+}
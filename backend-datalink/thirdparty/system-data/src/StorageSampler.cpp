@@ -0,0 +1,251 @@
+#include "StorageSampler.h"
+#include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+namespace {
+
+const double kSectorBytes = 512.0;     // diskstats counts 512-byte sectors whatever the device's
+const double kGigabyte = 1024.0 * 1024.0 * 1024.0;
+
+// Skips blanks, then reads an unsigned decimal; nullptr when there is none
+const char* parseUnsigned(const char* p, unsigned long long& value) {
+    while (*p == ' ' || *p == '\t') {
+        ++p;
+    }
+    if (*p < '0' || *p > '9') {
+        return nullptr;
+    }
+    char* end = nullptr;
+    value = std::strtoull(p, &end, 10);
+    return end;
+}
+
+// Reads an fd from offset 0 into buffer (NUL-terminated); the length or -1
+long readAt(int fd, char* buffer, size_t size) {
+    if (fd < 0 || size == 0) {
+        return -1;
+    }
+    ssize_t length = pread(fd, buffer, size - 1, 0);
+    if (length < 0) {
+        return -1;
+    }
+    buffer[length] = '\0';
+    return static_cast<long>(length);
+}
+
+// An eMMC "0x01".."0x0B" life time level as the upper bound of the life
+// used, in percent (0x0B: exceeded, reported as 110); -1 when undefined
+int lifeUsedPercent(unsigned long level) {
+    return level >= 0x01 && level <= 0x0B ? static_cast<int>(level) * 10 : -1;
+}
+
+double delta(unsigned long long now, unsigned long long before) {
+    return now >= before ? static_cast<double>(now - before) : 0.0;
+}
+
+} // namespace
+
+StorageSampler::StorageSampler()
+    : diskstats_fd_(open("/proc/diskstats", O_RDONLY | O_CLOEXEC)),
+      sys_block_fd_(open("/sys/block", O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      buffer_(16384), scan_(0) {
+    if (diskstats_fd_ < 0) {
+        logError("Failed to open /proc/diskstats: " + std::string(strerror(errno)));
+    }
+}
+
+StorageSampler::~StorageSampler() {
+    for (auto& entry : devices_) {
+        closeDevice(entry.second);
+    }
+    for (int fd : {diskstats_fd_, sys_block_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool StorageSampler::sample(Result& result) {
+    auto started = Clock::now();
+    double seconds = scan_ > 0 ? std::chrono::duration<double>(started - previous_time_).count() : 0.0;
+    previous_time_ = started;
+    ++scan_;
+
+    sampleMounts(result);
+    sampleDevices(seconds, result);
+
+    result.scan_ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    return true;
+}
+
+void StorageSampler::sampleMounts(Result& result) {
+    result.mounts.clear();
+    for (const auto& path : mounts_) {
+        MountStats stats;
+        stats.path = path;
+        struct statvfs fs;
+        if (statvfs(path.c_str(), &fs) == 0 && fs.f_blocks > 0) {
+            double block = static_cast<double>(fs.f_frsize);
+            double total = static_cast<double>(fs.f_blocks) * block;
+            double used = static_cast<double>(fs.f_blocks - fs.f_bfree) * block;
+            double available = static_cast<double>(fs.f_bavail) * block;
+            stats.mounted = true;
+            stats.read_only = (fs.f_flag & ST_RDONLY) != 0;
+            stats.total_gb = total / kGigabyte;
+            stats.used_gb = used / kGigabyte;
+            stats.available_gb = available / kGigabyte;
+            // As df computes it: root's reserve does not count as free
+            stats.usage_percent = used + available > 0 ? 100.0 * used / (used + available) : 0.0;
+            if (fs.f_files > 0) {
+                stats.inodes_used_percent = 100.0 * static_cast<double>(fs.f_files - fs.f_ffree) /
+                                            static_cast<double>(fs.f_files);
+            }
+        }
+        if (!result.mounts.push_back(stats)) {
+            break;
+        }
+    }
+}
+
+// One pass over /proc/diskstats: "major minor name" then the counters,
+// reads completed, merged, sectors, ms in fields 4-7, writes in 8-11,
+// requests in flight in 12 and ms busy in 13
+void StorageSampler::sampleDevices(double seconds, Result& result) {
+    result.devices.clear();
+    long length = readAt(diskstats_fd_, buffer_.data(), buffer_.size());
+    while (length >= 0 && static_cast<size_t>(length) + 1 >= buffer_.size()) {
+        buffer_.resize(buffer_.size() * 2);
+        length = readAt(diskstats_fd_, buffer_.data(), buffer_.size());
+    }
+    if (length <= 0) {
+        return;
+    }
+
+    for (const char* line = buffer_.data(); *line; ) {
+        const char* end = std::strchr(line, '\n');
+        const char* next = end ? end + 1 : line + std::strlen(line);
+
+        unsigned long long major = 0;
+        unsigned long long minor = 0;
+        const char* p = parseUnsigned(line, major);
+        p = p ? parseUnsigned(p, minor) : nullptr;
+        if (p) {
+            while (*p == ' ') {
+                ++p;
+            }
+            const char* name = p;
+            while (*p && *p != ' ' && *p != '\n') {
+                ++p;
+            }
+            size_t name_length = static_cast<size_t>(p - name);
+
+            unsigned long long fields[10] = {0};
+            for (int i = 0; i < 10 && p; ++i) {
+                p = parseUnsigned(p, fields[i]);
+            }
+            Device& state = device(name, name_length);
+            if (p && state.disk) {
+                Counters now;
+                now.reads = fields[0];
+                now.read_sectors = fields[2];
+                now.read_ms = fields[3];
+                now.writes = fields[4];
+                now.write_sectors = fields[6];
+                now.write_ms = fields[7];
+                now.in_flight = fields[8];
+                now.io_ms = fields[9];
+
+                DeviceStats stats;
+                stats.name.assign(name, name_length);
+                stats.in_flight = static_cast<int>(now.in_flight);
+                if (state.scan == scan_ - 1 && seconds > 0.0) {
+                    const Counters& before = state.previous;
+                    double reads = delta(now.reads, before.reads);
+                    double writes = delta(now.writes, before.writes);
+                    stats.read_iops = reads / seconds;
+                    stats.write_iops = writes / seconds;
+                    stats.read_bytes_per_sec = delta(now.read_sectors, before.read_sectors) * kSectorBytes / seconds;
+                    stats.write_bytes_per_sec = delta(now.write_sectors, before.write_sectors) * kSectorBytes / seconds;
+                    stats.read_latency_ms = reads > 0 ? delta(now.read_ms, before.read_ms) / reads : 0.0;
+                    stats.write_latency_ms = writes > 0 ? delta(now.write_ms, before.write_ms) / writes : 0.0;
+                    stats.busy_percent = std::min(100.0, delta(now.io_ms, before.io_ms) / (seconds * 10.0));
+                }
+                readWear(state, stats);
+                state.previous = now;
+                state.scan = scan_;
+                result.devices.push_back(stats);
+            } else {
+                state.scan = scan_;
+            }
+        }
+        line = next;
+    }
+
+    // Forget devices that went away (a removed SD card), closing their files
+    for (auto it = devices_.begin(); it != devices_.end(); ) {
+        if (it->second.scan != scan_) {
+            closeDevice(it->second);
+            it = devices_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// A device seen for the first time is looked up in /sys/block, which lists
+// whole disks only; loop and RAM disks are left out like partitions
+StorageSampler::Device& StorageSampler::device(const char* name, size_t length) {
+    auto found = devices_.emplace(std::string(name, length), Device());
+    Device& state = found.first->second;
+    if (!found.second) {
+        return state;
+    }
+
+    const std::string& key = found.first->first;
+    bool virtual_device = key.compare(0, 4, "loop") == 0 || key.compare(0, 3, "ram") == 0 ||
+                          key.compare(0, 4, "zram") == 0;
+    struct stat info;
+    state.disk = !virtual_device && sys_block_fd_ >= 0 && fstatat(sys_block_fd_, key.c_str(), &info, 0) == 0;
+    if (state.disk) {
+        state.life_time_fd = openat(sys_block_fd_, (key + "/device/life_time").c_str(), O_RDONLY | O_CLOEXEC);
+        state.pre_eol_fd = openat(sys_block_fd_, (key + "/device/pre_eol_info").c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    return state;
+}
+
+// life_time is "0xAA 0xBB" (types A and B), pre_eol_info "0x01" (normal),
+// "0x02" (80% of the reserved blocks used) or "0x03" (90%)
+void StorageSampler::readWear(const Device& device, DeviceStats& stats) {
+    char buffer[64];
+    if (readAt(device.life_time_fd, buffer, sizeof(buffer)) > 0) {
+        char* end = nullptr;
+        unsigned long a = std::strtoul(buffer, &end, 16);
+        unsigned long b = end ? std::strtoul(end, nullptr, 16) : 0;
+        stats.life_used_a_percent = lifeUsedPercent(a);
+        stats.life_used_b_percent = lifeUsedPercent(b);
+    }
+    if (readAt(device.pre_eol_fd, buffer, sizeof(buffer)) > 0) {
+        unsigned long level = std::strtoul(buffer, nullptr, 16);
+        stats.pre_eol = level >= 1 && level <= 3 ? static_cast<FlashWear>(level) : FlashWear::Unknown;
+    }
+}
+
+void StorageSampler::closeDevice(Device& device) {
+    for (int* fd : {&device.life_time_fd, &device.pre_eol_fd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void StorageSampler::logError(const std::string& message) const {
+    std::cerr << "[StorageSampler] ERROR: " << message << std::endl;
+}
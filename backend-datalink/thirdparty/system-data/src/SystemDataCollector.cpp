@@ -1,16 +1,218 @@
 #include "SystemDataCollector.h"
+#include "ur-trace/ur_trace.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <mutex>
 #include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 #include <memory>
+#include <cstring>
+#include <cerrno>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace {
+
+// Route flags from <linux/route.h>, which clashes with <net/if.h>
+const unsigned int RTF_UP_FLAG = 0x0001;
+const unsigned int RTF_GATEWAY_FLAG = 0x0002;
+
+// Parses an unsigned decimal at p (after any blanks); returns the position
+// after the digits, or nullptr if there are none
+const char* parseNumber(const char* p, const char* end, long long& value) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    
+    if (p >= end || *p < '0' || *p > '9') {
+        return nullptr;
+    }
+    
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+    return p;
+}
+
+// Advances to the start of the next line
+const char* nextLine(const char* p, const char* end) {
+    while (p < end && *p != '\n') {
+        ++p;
+    }
+    return p < end ? p + 1 : end;
+}
+
+json breakdownToJson(const SystemDataCollector::SystemMetrics::CPU::Breakdown& breakdown) {
+    return {
+        {"usage_percent", breakdown.usage_percent},
+        {"user_percent", breakdown.user_percent},
+        {"system_percent", breakdown.system_percent},
+        {"iowait_percent", breakdown.iowait_percent},
+        {"irq_percent", breakdown.irq_percent},
+        {"steal_percent", breakdown.steal_percent}
+    };
+}
+
+// Fixed-size copy of a snapshot for the shared-memory segment, bounded by
+// the smaller of the two buffers
+template <size_t N>
+void copyString(char* target, size_t size, const FixedString<N>& source) {
+    size_t length = strnlen(source.c_str(), std::min(size, N) - 1);
+    std::memcpy(target, source.c_str(), length);
+    target[length] = '\0';
+}
+
+sysdata_shm_metrics_t toSharedRecord(const SystemDataCollector::SystemMetrics& metrics) {
+    sysdata_shm_metrics_t record;
+    std::memset(&record, 0, sizeof(record));
+    record.generation = metrics.generation;
+    record.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    record.cpu_usage_percent = metrics.cpu.usage_percent;
+    record.cpu_temperature_celsius = metrics.cpu.temperature_celsius;
+    record.cpu_frequency_ghz = metrics.cpu.frequency_ghz;
+    record.cpu_cores = metrics.cpu.cores;
+    record.ram_usage_percent = metrics.ram.usage_percent;
+    record.ram_used_gb = metrics.ram.used_gb;
+    record.ram_total_gb = metrics.ram.total_gb;
+    record.swap_usage_percent = metrics.swap.usage_percent;
+    record.swap_used_mb = metrics.swap.used_mb;
+    record.swap_total_gb = metrics.swap.total_gb;
+    
+    const auto& network = metrics.network;
+    record.internet_reachable = std::any_of(network.internet.latency_targets.begin(), network.internet.latency_targets.end(),
+                                            [](const LatencyProber::TargetStats& target) { return target.reachable; });
+    record.latency_ms = network.internet.latency_ms;
+    record.latency_jitter_ms = network.internet.latency_jitter_ms;
+    for (const auto& traffic : network.interfaces) {
+        if (traffic.name == network.connection.interface_name) {
+            record.rx_bytes_per_sec = traffic.rx_bytes_per_sec;
+            record.tx_bytes_per_sec = traffic.tx_bytes_per_sec;
+        }
+    }
+    copyString(record.interface_name, sizeof(record.interface_name), network.connection.interface_name);
+    copyString(record.local_ip, sizeof(record.local_ip), network.connection.local_ip);
+    
+    record.ultima_connected = metrics.ultima_server.status == LinkStatus::Connected ||
+                              metrics.ultima_server.status == LinkStatus::Degraded;
+    record.ultima_last_ping_ms = metrics.ultima_server.last_ping_ms;
+    record.ultima_ping_avg_ms = metrics.ultima_server.ping_avg_ms;
+    
+    record.cellular_registered = metrics.signal.connection.status == Registration::Connected ||
+                                 metrics.signal.connection.status == Registration::Roaming;
+    record.rssi_dbm = metrics.signal.strength.rssi_dbm;
+    record.rsrp_dbm = metrics.signal.strength.rsrp_dbm;
+    record.rsrq_db = metrics.signal.strength.rsrq_db;
+    record.sinr_db = metrics.signal.strength.sinr_db;
+    return record;
+}
+
+} // namespace
+
+SystemDataCollector::ProcFile::ProcFile(const std::string& path)
+    : path_(path), fd_(path.empty() ? -1 : open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+}
+
+SystemDataCollector::ProcFile::~ProcFile() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+long SystemDataCollector::ProcFile::read(char* buffer, size_t size) {
+    if (fd_ < 0 || size == 0) {
+        return -1;
+    }
+    
+    ssize_t length = pread(fd_, buffer, size - 1, 0);
+    if (length < 0) {
+        return -1;
+    }
+    
+    buffer[length] = '\0';
+    return static_cast<long>(length);
+}
+
+void SystemDataCollector::ProcFile::reopen(const std::string& path) {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    path_ = path;
+    fd_ = path.empty() ? -1 : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
 
 SystemDataCollector::SystemDataCollector() 
-    : running_(false), poll_interval_seconds_(2), collection_progress_log_interval_(30) {
+    : running_(false), poll_interval_seconds_(2), collection_progress_log_interval_(30),
+      meminfo_file_("/proc/meminfo"),
+      temperature_file_(hardware_inventory_.get()->temperature_path),
+      frequency_file_(hardware_inventory_.get()->frequency_path) {
     // Initialize metrics with default values
-    current_metrics_ = SystemMetrics{};
+    snapshot_ = std::make_shared<const SystemMetrics>();
+    
+    // Default periods; cheap procfs reads run often, anything that leaves the
+    // box runs rarely. "cpu" follows the poll interval unless set explicitly.
+    collector_intervals_ms_ = {
+        {"memory", 2000},
+        {"network_link", 10000},
+        {"network_traffic", 2000},
+        {"latency", 10000},
+        {"external_ip", 300000},
+        {"ultima_server", 5000},
+        {"signal", 5000},
+        {"processes", 5000},
+        {"storage", 30000}
+    };
+}
+
+void SystemDataCollector::setPollInterval(int seconds) {
+    poll_interval_seconds_ = seconds;
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        poll_interval_changed_ = true;
+    }
+    wake_cv_.notify_all();
+}
+
+bool SystemDataCollector::setCollectorInterval(const std::string& name, int interval_ms) {
+    static const char* known[] = {
+        "cpu", "memory", "network_link", "network_traffic", "latency", "external_ip", "ultima_server", "signal", "processes",
+        "storage"
+    };
+    
+    if (interval_ms < 100 || std::find(std::begin(known), std::end(known), name) == std::end(known)) {
+        return false;
+    }
+    
+    collector_intervals_ms_[name] = interval_ms;
+    return true;
+}
+
+bool SystemDataCollector::setCollectorSlowdown(const std::string& name, int factor) {
+    static const char* scheduled[] = {
+        "cpu", "memory", "network_link", "network_traffic", "ultima_server", "processes", "storage"
+    };
+    
+    if (factor < 1 || std::find(std::begin(scheduled), std::end(scheduled), name) == std::end(scheduled)) {
+        return false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        collector_slowdowns_[name] = factor;
+        poll_interval_changed_ = true;
+    }
+    wake_cv_.notify_all();
+    return true;
 }
 
 SystemDataCollector::~SystemDataCollector() {
@@ -24,10 +226,41 @@ bool SystemDataCollector::start(int poll_interval_seconds) {
     }
     
     poll_interval_seconds_ = poll_interval_seconds;
+    buildSchedule();
+    
+    // Before any collector publishes
+    if (!shared_memory_name_.empty()) {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        shared_memory_.open(shared_memory_name_);
+    }
     running_.store(true);
     
     collector_thread_ = std::thread(&SystemDataCollector::collectLoop, this);
     
+    latency_prober_.setInterval(collector_intervals_ms_["latency"]);
+    latency_prober_.setResultCallback([this](const std::vector<LatencyProber::TargetStats>& stats) {
+        publishLatency(stats);
+    });
+    latency_prober_.start();
+    
+    hardware_inventory_.start();
+    
+    // The public address is looked up off the collector thread and cached
+    external_ip_resolver_.setTtl(collector_intervals_ms_["external_ip"]);
+    external_ip_resolver_.setResultCallback([this](const std::string& external_ip) {
+        publishExternalIP(external_ip);
+    });
+    external_ip_resolver_.start();
+    
+    // The modem pushes registration changes; "signal" paces the measurements
+    if (modem_enabled_) {
+        modem_monitor_.setInterval(collector_intervals_ms_["signal"]);
+        modem_monitor_.setResultCallback([this](const ModemMonitor::Status& status) {
+            publishSignal(status);
+        });
+        modem_monitor_.start();
+    }
+    
     std::cout << "[SystemDataCollector] Started with " << poll_interval_seconds_ << "s interval" << std::endl;
     return true;
 }
@@ -37,281 +270,875 @@ void SystemDataCollector::stop() {
         return;
     }
     
-    running_.store(false);
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        running_.store(false);
+    }
+    wake_cv_.notify_all();
     
+    latency_prober_.stop();
+    external_ip_resolver_.stop();
+    modem_monitor_.stop();
+    hardware_inventory_.stop();
     if (collector_thread_.joinable()) {
         collector_thread_.join();
     }
+    {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        shared_memory_.close();
+    }
     
     std::cout << "[SystemDataCollector] Stopped" << std::endl;
 }
 
+std::shared_ptr<const SystemDataCollector::SystemMetrics> SystemDataCollector::getSnapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
 SystemDataCollector::SystemMetrics SystemDataCollector::getCurrentMetrics() const {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-    return current_metrics_;
+    return *getSnapshot();
+}
+
+void SystemDataCollector::publish(const std::function<void(SystemMetrics&)>& update) {
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        auto next = std::make_shared<SystemMetrics>(*std::atomic_load(&snapshot_));
+        update(*next);
+        generation = ++next->generation;
+        if (shared_memory_.isOpen()) {
+            shared_memory_.write(toSharedRecord(*next));
+        }
+        std::atomic_store(&snapshot_, std::shared_ptr<const SystemMetrics>(std::move(next)));
+    }
+    
+    std::lock_guard<std::mutex> lock(listeners_mutex_);
+    for (const auto& listener : publish_listeners_) {
+        listener.second(generation);
+    }
+}
+
+int SystemDataCollector::addPublishListener(PublishListener listener) {
+    std::lock_guard<std::mutex> lock(listeners_mutex_);
+    int id = next_listener_id_++;
+    publish_listeners_.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void SystemDataCollector::removePublishListener(int id) {
+    std::lock_guard<std::mutex> lock(listeners_mutex_);
+    for (auto it = publish_listeners_.begin(); it != publish_listeners_.end(); ++it) {
+        if (it->first == id) {
+            publish_listeners_.erase(it);
+            return;
+        }
+    }
+}
+
+const char* const SystemDataCollector::JsonSnapshot::kSections[8] = {
+    "cpu", "ram", "swap", "network", "ultima_server", "signal", "processes", "storage"
+};
+
+SystemDataCollector::JsonSnapshot::JsonSnapshot(uint64_t generation, json metrics)
+    : generation_(generation), metrics_(std::move(metrics)) {
+}
+
+const std::string& SystemDataCollector::JsonSnapshot::serialized(const std::string& section) const {
+    static const std::string empty;
+    for (size_t i = 0; i < 8; ++i) {
+        if (section == kSections[i]) {
+            std::call_once(serialized_once_[i], [this, i] {
+                serialized_[i] = metrics_.at(kSections[i]).dump();
+            });
+            return serialized_[i];
+        }
+    }
+    return empty;
+}
+
+std::shared_ptr<const SystemDataCollector::JsonSnapshot> SystemDataCollector::getJsonSnapshot() const {
+    std::shared_ptr<const SystemMetrics> snapshot = getSnapshot();
+    
+    std::lock_guard<std::mutex> lock(json_cache_mutex_);
+    if (!json_cache_ || json_cache_->generation() != snapshot->generation) {
+        json_cache_ = std::make_shared<const JsonSnapshot>(snapshot->generation, buildMetricsJson(*snapshot));
+    }
+    return json_cache_;
 }
 
 json SystemDataCollector::getMetricsAsJson() const {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    return getJsonSnapshot()->metrics();
+}
+
+json SystemDataCollector::buildMetricsJson(const SystemMetrics& metrics) {
+    json latencyTargets = json::array();
+    for (const auto& target : metrics.network.internet.latency_targets) {
+        latencyTargets.push_back({
+            {"target", target.target.c_str()},
+            {"reachable", target.reachable},
+            {"last_ms", target.last_ms},
+            {"min_ms", target.min_ms},
+            {"avg_ms", target.avg_ms},
+            {"max_ms", target.max_ms},
+            {"jitter_ms", target.jitter_ms},
+            {"loss_percent", target.loss_percent},
+            {"samples", target.samples}
+        });
+    }
+    
+    json interfaces = json::array();
+    for (const auto& traffic : metrics.network.interfaces) {
+        interfaces.push_back({
+            {"name", traffic.name.c_str()},
+            {"rx_bytes_per_sec", traffic.rx_bytes_per_sec},
+            {"tx_bytes_per_sec", traffic.tx_bytes_per_sec},
+            {"rx_packets_per_sec", traffic.rx_packets_per_sec},
+            {"tx_packets_per_sec", traffic.tx_packets_per_sec},
+            {"rx_errors_per_sec", traffic.rx_errors_per_sec},
+            {"tx_errors_per_sec", traffic.tx_errors_per_sec},
+            {"rx_drops_per_sec", traffic.rx_drops_per_sec},
+            {"tx_drops_per_sec", traffic.tx_drops_per_sec},
+            {"rx_bytes", traffic.rx_bytes},
+            {"tx_bytes", traffic.tx_bytes}
+        });
+    }
+    
+    auto processesToJson = [](const FixedVector<ProcessSampler::ProcessStats, ProcessSampler::kMaxListed>& processes) {
+        json list = json::array();
+        for (const auto& process : processes) {
+            list.push_back({
+                {"pid", process.pid},
+                {"name", process.name.c_str()},
+                {"cpu_percent", process.cpu_percent},
+                {"rss_mb", process.rss_mb}
+            });
+        }
+        return list;
+    };
+    auto pressureToJson = [](const ProcessSampler::Pressure& pressure) {
+        return json{
+            {"some_avg10", pressure.some_avg10},
+            {"some_avg60", pressure.some_avg60},
+            {"full_avg10", pressure.full_avg10},
+            {"full_avg60", pressure.full_avg60}
+        };
+    };
+    auto mountsToJson = [](const FixedVector<StorageSampler::MountStats, StorageSampler::kMaxMounts>& mounts) {
+        json list = json::array();
+        for (const auto& mount : mounts) {
+            list.push_back({
+                {"path", mount.path.c_str()},
+                {"mounted", mount.mounted},
+                {"read_only", mount.read_only},
+                {"total_gb", mount.total_gb},
+                {"used_gb", mount.used_gb},
+                {"available_gb", mount.available_gb},
+                {"usage_percent", mount.usage_percent},
+                {"inodes_used_percent", mount.inodes_used_percent}
+            });
+        }
+        return list;
+    };
+    auto devicesToJson = [](const FixedVector<StorageSampler::DeviceStats, StorageSampler::kMaxDevices>& devices) {
+        json list = json::array();
+        for (const auto& device : devices) {
+            list.push_back({
+                {"name", device.name.c_str()},
+                {"read_iops", device.read_iops},
+                {"write_iops", device.write_iops},
+                {"read_bytes_per_sec", device.read_bytes_per_sec},
+                {"write_bytes_per_sec", device.write_bytes_per_sec},
+                {"read_latency_ms", device.read_latency_ms},
+                {"write_latency_ms", device.write_latency_ms},
+                {"busy_percent", device.busy_percent},
+                {"in_flight", device.in_flight},
+                {"life_used_a_percent", device.life_used_a_percent},
+                {"life_used_b_percent", device.life_used_b_percent},
+                {"pre_eol", toString(device.pre_eol)}
+            });
+        }
+        return list;
+    };
+
+    json perCore = json::array();
+    for (const auto& core : metrics.cpu.per_core) {
+        perCore.push_back(breakdownToJson(core));
+    }
     
     return {
         {"cpu", {
-            {"usage_percent", current_metrics_.cpu.usage_percent},
-            {"cores", current_metrics_.cpu.cores},
-            {"temperature_celsius", current_metrics_.cpu.temperature_celsius},
-            {"frequency_ghz", current_metrics_.cpu.frequency_ghz}
+            {"usage_percent", metrics.cpu.usage_percent},
+            {"breakdown", breakdownToJson(metrics.cpu.total)},
+            {"per_core", perCore},
+            {"cores", metrics.cpu.cores},
+            {"temperature_celsius", metrics.cpu.temperature_celsius},
+            {"frequency_ghz", metrics.cpu.frequency_ghz}
         }},
         {"ram", {
-            {"usage_percent", current_metrics_.ram.usage_percent},
-            {"used_gb", current_metrics_.ram.used_gb},
-            {"total_gb", current_metrics_.ram.total_gb}
+            {"usage_percent", metrics.ram.usage_percent},
+            {"used_gb", metrics.ram.used_gb},
+            {"total_gb", metrics.ram.total_gb}
         }},
         {"swap", {
-            {"usage_percent", current_metrics_.swap.usage_percent},
-            {"used_mb", current_metrics_.swap.used_mb},
-            {"total_gb", current_metrics_.swap.total_gb},
-            {"status", current_metrics_.swap.status}
+            {"usage_percent", metrics.swap.usage_percent},
+            {"used_mb", metrics.swap.used_mb},
+            {"total_gb", metrics.swap.total_gb},
+            {"status", toString(metrics.swap.status)}
         }},
         {"network", {
             {"internet", {
-                {"status", current_metrics_.network.internet.status},
-                {"external_ip", current_metrics_.network.internet.external_ip},
-                {"dns_primary", current_metrics_.network.internet.dns_primary},
-                {"dns_secondary", current_metrics_.network.internet.dns_secondary},
-                {"latency_ms", current_metrics_.network.internet.latency_ms},
-                {"bandwidth", current_metrics_.network.internet.bandwidth}
+                {"status", toString(metrics.network.internet.status)},
+                {"external_ip", metrics.network.internet.external_ip.c_str()},
+                {"dns_primary", metrics.network.internet.dns_primary.c_str()},
+                {"dns_secondary", metrics.network.internet.dns_secondary.c_str()},
+                {"latency_ms", metrics.network.internet.latency_ms},
+                {"latency_jitter_ms", metrics.network.internet.latency_jitter_ms},
+                {"latency_targets", latencyTargets},
+                {"bandwidth", metrics.network.internet.bandwidth.c_str()}
             }},
             {"connection", {
-                {"status", current_metrics_.network.connection.status},
-                {"interface", current_metrics_.network.connection.interface_name},
-                {"mac_address", current_metrics_.network.connection.mac_address},
-                {"local_ip", current_metrics_.network.connection.local_ip},
-                {"gateway", current_metrics_.network.connection.gateway},
-                {"speed", current_metrics_.network.connection.speed}
-            }}
+                {"status", toString(metrics.network.connection.status)},
+                {"interface", metrics.network.connection.interface_name.c_str()},
+                {"mac_address", metrics.network.connection.mac_address.c_str()},
+                {"local_ip", metrics.network.connection.local_ip.c_str()},
+                {"gateway", metrics.network.connection.gateway.c_str()},
+                {"speed", metrics.network.connection.speed.c_str()}
+            }},
+            {"interfaces", interfaces}
         }},
         {"ultima_server", {
-            {"status", current_metrics_.ultima_server.status},
-            {"server", current_metrics_.ultima_server.server},
-            {"port", current_metrics_.ultima_server.port},
-            {"protocol", current_metrics_.ultima_server.protocol},
-            {"last_ping_ms", current_metrics_.ultima_server.last_ping_ms},
-            {"session", current_metrics_.ultima_server.session}
+            {"status", toString(metrics.ultima_server.status)},
+            {"server", metrics.ultima_server.server.c_str()},
+            {"port", metrics.ultima_server.port},
+            {"protocol", metrics.ultima_server.protocol.c_str()},
+            {"last_ping_ms", metrics.ultima_server.last_ping_ms},
+            {"ping_avg_ms", metrics.ultima_server.ping_avg_ms},
+            {"ping_p50_ms", metrics.ultima_server.ping_p50_ms},
+            {"ping_p95_ms", metrics.ultima_server.ping_p95_ms},
+            {"ping_p99_ms", metrics.ultima_server.ping_p99_ms},
+            {"session", toString(metrics.ultima_server.session)}
         }},
         {"signal", {
             {"strength", {
-                {"status", current_metrics_.signal.strength.status},
-                {"rssi_dbm", current_metrics_.signal.strength.rssi_dbm},
-                {"rsrp_dbm", current_metrics_.signal.strength.rsrp_dbm},
-                {"rsrq_db", current_metrics_.signal.strength.rsrq_db},
-                {"sinr_db", current_metrics_.signal.strength.sinr_db},
-                {"cell_id", current_metrics_.signal.strength.cell_id}
+                {"status", toString(metrics.signal.strength.status)},
+                {"rssi_dbm", metrics.signal.strength.rssi_dbm},
+                {"rsrp_dbm", metrics.signal.strength.rsrp_dbm},
+                {"rsrq_db", metrics.signal.strength.rsrq_db},
+                {"sinr_db", metrics.signal.strength.sinr_db},
+                {"cell_id", metrics.signal.strength.cell_id.c_str()}
             }},
             {"connection", {
-                {"status", current_metrics_.signal.connection.status},
-                {"network", current_metrics_.signal.connection.network},
-                {"technology", current_metrics_.signal.connection.technology},
-                {"band", current_metrics_.signal.connection.band},
-                {"apn", current_metrics_.signal.connection.apn},
-                {"data_usage_mb", current_metrics_.signal.connection.data_usage_mb}
+                {"status", toString(metrics.signal.connection.status)},
+                {"network", metrics.signal.connection.network.c_str()},
+                {"technology", metrics.signal.connection.technology.c_str()},
+                {"band", metrics.signal.connection.band.c_str()},
+                {"apn", metrics.signal.connection.apn.c_str()},
+                {"data_usage_mb", metrics.signal.connection.data_usage_mb}
             }}
+        }},
+        {"processes", {
+            {"count", metrics.processes.process_count},
+            {"top_cpu", processesToJson(metrics.processes.top_cpu)},
+            {"top_memory", processesToJson(metrics.processes.top_memory)},
+            {"watched", processesToJson(metrics.processes.watched)},
+            {"cgroup", {
+                {"path", metrics.processes.cgroup.path.c_str()},
+                {"cpu_percent", metrics.processes.cgroup.cpu_percent},
+                {"cpu_quota_cores", metrics.processes.cgroup.cpu_quota_cores},
+                {"throttled_percent", metrics.processes.cgroup.throttled_percent},
+                {"throttled_ms", metrics.processes.cgroup.throttled_ms},
+                {"memory_mb", metrics.processes.cgroup.memory_mb},
+                {"memory_limit_mb", metrics.processes.cgroup.memory_limit_mb}
+            }},
+            {"pressure", {
+                {"cpu", pressureToJson(metrics.processes.cpu_pressure)},
+                {"memory", pressureToJson(metrics.processes.memory_pressure)},
+                {"io", pressureToJson(metrics.processes.io_pressure)}
+            }},
+            {"scan_ms", metrics.processes.scan_ms}
+        }},
+        {"storage", {
+            {"mounts", mountsToJson(metrics.storage.mounts)},
+            {"devices", devicesToJson(metrics.storage.devices)},
+            {"scan_ms", metrics.storage.scan_ms}
         }}
     };
 }
 
+void SystemDataCollector::buildSchedule() {
+    auto now = std::chrono::steady_clock::now();
+    cpu_follows_poll_interval_ = !collector_intervals_ms_.count("cpu");
+    int cpu_ms = cpu_follows_poll_interval_ ? poll_interval_seconds_ * 1000 : collector_intervals_ms_["cpu"];
+    
+    auto entry = [&](const char* name, int period_ms, void (SystemDataCollector::*run)()) {
+        std::chrono::milliseconds period(period_ms);
+        return ScheduledCollector{name, period, period, now, run};
+    };
+    schedule_ = {
+        entry("cpu", cpu_ms, &SystemDataCollector::sampleCPU),
+        entry("memory", collector_intervals_ms_["memory"], &SystemDataCollector::sampleMemory),
+        entry("network_link", collector_intervals_ms_["network_link"], &SystemDataCollector::sampleNetworkLink),
+        entry("network_traffic", collector_intervals_ms_["network_traffic"], &SystemDataCollector::sampleNetworkTraffic),
+        entry("ultima_server", collector_intervals_ms_["ultima_server"], &SystemDataCollector::sampleUltimaServer),
+        entry("processes", collector_intervals_ms_["processes"], &SystemDataCollector::sampleProcesses),
+        entry("storage", collector_intervals_ms_["storage"], &SystemDataCollector::sampleStorage)
+    };
+    
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    poll_interval_changed_ = false;
+    for (auto& scheduled : schedule_) {
+        auto slowdown = collector_slowdowns_.find(scheduled.name);
+        if (slowdown != collector_slowdowns_.end()) {
+            scheduled.period = scheduled.base_period * slowdown->second;
+        }
+    }
+}
+
 void SystemDataCollector::collectLoop() {
     int collection_count = 0;
+    auto later = [](const ScheduledCollector& a, const ScheduledCollector& b) {
+        return a.next_due > b.next_due;
+    };
+    std::make_heap(schedule_.begin(), schedule_.end(), later);
     
     while (running_.load()) {
-        try {
-            collectAllMetrics();
-            collection_count++;
-            
-            // Log collection progress periodically (configurable interval)
-            if (collection_count % collection_progress_log_interval_ == 1) {
-                std::cout << "[SystemDataCollector] Collected metrics #" << collection_count 
-                         << " (CPU: " << current_metrics_.cpu.usage_percent << "%, "
-                         << "RAM: " << current_metrics_.ram.usage_percent << "%)" << std::endl;
+        std::pop_heap(schedule_.begin(), schedule_.end(), later);
+        ScheduledCollector& task = schedule_.back();
+        
+        bool reschedule = false;
+        std::map<std::string, int> slowdowns;
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait_until(lock, task.next_due, [this] { return !running_.load() || poll_interval_changed_; });
+            std::swap(reschedule, poll_interval_changed_);
+            if (reschedule) {
+                slowdowns = collector_slowdowns_;
             }
-            
+        }
+        if (!running_.load()) {
+            break;
+        }
+        if (reschedule) {
+            // Only the CPU period follows the poll interval; any period may be
+            // slowed down. A sample that is now overdue runs next.
+            auto now = std::chrono::steady_clock::now();
+            for (auto& scheduled : schedule_) {
+                if (cpu_follows_poll_interval_ && scheduled.run == &SystemDataCollector::sampleCPU) {
+                    scheduled.base_period = std::chrono::milliseconds(std::max(1, poll_interval_seconds_.load()) * 1000);
+                }
+                auto slowdown = slowdowns.find(scheduled.name);
+                scheduled.period = scheduled.base_period * (slowdown != slowdowns.end() ? slowdown->second : 1);
+                scheduled.next_due = std::min(scheduled.next_due, now + scheduled.period);
+            }
+            std::make_heap(schedule_.begin(), schedule_.end(), later);
+            continue;
+        }
+        
+        try {
+            (this->*task.run)();
         } catch (const std::exception& e) {
-            logError("Error in collection loop: " + std::string(e.what()));
+            logError("Error in " + task.name + " collector: " + std::string(e.what()));
         }
         
-        // Sleep for the configured interval
-        std::this_thread::sleep_for(std::chrono::seconds(poll_interval_seconds_));
+        // Advance by whole periods from the previous deadline so sampling does
+        // not drift; periods missed while a slow collector ran are skipped
+        auto now = std::chrono::steady_clock::now();
+        do {
+            task.next_due += task.period;
+        } while (task.next_due <= now);
+        
+        bool is_cpu = task.run == &SystemDataCollector::sampleCPU;
+        std::push_heap(schedule_.begin(), schedule_.end(), later);
+        
+        // Log collection progress periodically (configurable interval)
+        if (is_cpu && ++collection_count % collection_progress_log_interval_ == 1) {
+            SystemMetrics snapshot = getCurrentMetrics();
+            std::cout << "[SystemDataCollector] Collected metrics #" << collection_count 
+                     << " (CPU: " << snapshot.cpu.usage_percent << "%, "
+                     << "RAM: " << snapshot.ram.usage_percent << "%)" << std::endl;
+        }
     }
     
     std::cout << "[SystemDataCollector] Collection loop stopped after " << collection_count << " collections" << std::endl;
 }
 
-void SystemDataCollector::collectAllMetrics() {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
+void SystemDataCollector::sampleCPU() {
+    UR_TRACE_SPAN("system_data.sampleCPU");
+    SystemMetrics::CPU cpu;
+    collectCPUMetrics(cpu);
+    
+    publish([&](SystemMetrics& metrics) {
+        metrics.cpu = cpu;
+    });
+}
+
+void SystemDataCollector::sampleMemory() {
+    UR_TRACE_SPAN("system_data.sampleMemory");
+    SystemMetrics::RAM ram;
+    SystemMetrics::Swap swap;
+    collectMemoryMetrics(ram, swap);
+    
+    publish([&](SystemMetrics& metrics) {
+        metrics.ram = ram;
+        metrics.swap = swap;
+    });
+}
+
+void SystemDataCollector::sampleNetworkLink() {
+    UR_TRACE_SPAN("system_data.sampleNetworkLink");
+    SystemMetrics::Network::Connection connection;
+    connection.local_ip = getLocalIP();
+    connection.gateway = getGateway();
+    connection.interface_name = getNetworkInterface();
+    connection.mac_address = getMACAddress();
+    connection.speed = getLinkSpeed(connection.interface_name.c_str());
+    connection.status = connection.local_ip != "N/A" ? LinkStatus::Connected : LinkStatus::Unknown;
+    
+    publish([&](SystemMetrics& metrics) {
+        metrics.network.connection = connection;
+    });
+}
+
+void SystemDataCollector::sampleNetworkTraffic() {
+    UR_TRACE_SPAN("system_data.sampleNetworkTraffic");
+    FixedVector<SystemMetrics::Network::InterfaceTraffic, 32> interfaces;
+    if (!traffic_sampler_.sample(interfaces)) {
+        return;
+    }
+    
+    publish([&](SystemMetrics& metrics) {
+        // Internet bandwidth is what the default-route interface carries now
+        metrics.network.internet.bandwidth = "N/A";
+        for (const auto& traffic : interfaces) {
+            if (traffic.name == metrics.network.connection.interface_name) {
+                char bandwidth[64];
+                std::snprintf(bandwidth, sizeof(bandwidth), "%.2f Mbps down / %.2f Mbps up",
+                              traffic.rx_bytes_per_sec * 8.0 / 1e6, traffic.tx_bytes_per_sec * 8.0 / 1e6);
+                metrics.network.internet.bandwidth = bandwidth;
+            }
+        }
+        metrics.network.interfaces = interfaces;
+    });
+}
+
+void SystemDataCollector::sampleProcesses() {
+    UR_TRACE_SPAN("system_data.sampleProcesses");
+    ProcessSampler::Result processes;
+    if (!process_sampler_.sample(processes)) {
+        return;
+    }
+    
+    publish([&](SystemMetrics& metrics) {
+        metrics.processes = processes;
+    });
+}
+
+void SystemDataCollector::sampleStorage() {
+    UR_TRACE_SPAN("system_data.sampleStorage");
+    StorageSampler::Result storage;
+    if (!storage_sampler_.sample(storage)) {
+        return;
+    }
+    
+    publish([&](SystemMetrics& metrics) {
+        metrics.storage = storage;
+    });
+}
+
+// Runs on the prober thread once per probe round
+void SystemDataCollector::publishLatency(const std::vector<LatencyProber::TargetStats>& stats) {
+    UR_TRACE_SPAN("system_data.publishLatency");
+    const LatencyProber::TargetStats* best = nullptr;
+    for (const auto& target : stats) {
+        if (target.reachable && (!best || target.avg_ms < best->avg_ms)) {
+            best = &target;
+        }
+    }
+    
+    publish([&](SystemMetrics& metrics) {
+        metrics.network.internet.latency_ms = best ? best->avg_ms : 0.0;
+        metrics.network.internet.latency_jitter_ms = best ? best->jitter_ms : 0.0;
+        metrics.network.internet.latency_targets.clear();
+        for (const auto& target : stats) {
+            metrics.network.internet.latency_targets.push_back(target);
+        }
+    });
+}
+
+// Runs on the resolver thread after every lookup
+void SystemDataCollector::publishExternalIP(const std::string& external_ip) {
+    UR_TRACE_SPAN("system_data.publishExternalIP");
+    publish([&](SystemMetrics& metrics) {
+        metrics.network.internet.external_ip = external_ip;
+        metrics.network.internet.status = external_ip != "N/A" ? LinkStatus::Connected : LinkStatus::Unknown;
+    });
+}
+
+void SystemDataCollector::sampleUltimaServer() {
+    UR_TRACE_SPAN("system_data.sampleUltimaServer");
+    SystemMetrics::UltimaServer server;
+    collectUltimaServerMetrics(server);
+    
+    publish([&](SystemMetrics& metrics) {
+        metrics.ultima_server = server;
+    });
+}
+
+// Runs on the modem thread whenever the modem status changed
+void SystemDataCollector::publishSignal(const ModemMonitor::Status& status) {
+    UR_TRACE_SPAN("system_data.publishSignal");
+    SystemMetrics::Signal signal;
+    
+    if (status.present && status.measured) {
+        // RSRP where the modem reports it (LTE/NR), else the legacy RSSI
+        if (status.rsrp_dbm != 0.0) {
+            signal.strength.status = status.rsrp_dbm >= -80.0 ? SignalQuality::Excellent :
+                                     status.rsrp_dbm >= -90.0 ? SignalQuality::Good :
+                                     status.rsrp_dbm >= -100.0 ? SignalQuality::Fair : SignalQuality::Poor;
+        } else if (status.rssi_dbm != 0.0) {
+            signal.strength.status = status.rssi_dbm >= -65.0 ? SignalQuality::Excellent :
+                                     status.rssi_dbm >= -75.0 ? SignalQuality::Good :
+                                     status.rssi_dbm >= -85.0 ? SignalQuality::Fair : SignalQuality::Poor;
+        }
+        signal.strength.rssi_dbm = status.rssi_dbm;
+        signal.strength.rsrp_dbm = status.rsrp_dbm;
+        signal.strength.rsrq_db = status.rsrq_db;
+        signal.strength.sinr_db = status.sinr_db;
+    }
+    if (!status.cell_id.empty()) {
+        signal.strength.cell_id = status.cell_id;
+    }
+    
+    switch (status.registration) {
+    case 1:
+        signal.connection.status = Registration::Connected;
+        break;
+    case 5:
+        signal.connection.status = Registration::Roaming;
+        break;
+    case 2:
+        signal.connection.status = Registration::Searching;
+        break;
+    case 3:
+        signal.connection.status = Registration::Denied;
+        break;
+    default:
+        break;
+    }
+    if (!status.network.empty()) {
+        signal.connection.network = status.network;
+    }
+    if (!status.technology.empty()) {
+        signal.connection.technology = status.technology;
+    }
+    if (!status.band.empty()) {
+        signal.connection.band = status.band;
+    }
+    if (!status.apn.empty()) {
+        signal.connection.apn = status.apn;
+    }
+    signal.connection.data_usage_mb = status.data_usage_mb;
     
-    collectCPUMetrics(current_metrics_.cpu);
-    collectRAMMetrics(current_metrics_.ram);
-    collectSwapMetrics(current_metrics_.swap);
-    collectNetworkMetrics(current_metrics_.network);
-    collectUltimaServerMetrics(current_metrics_.ultima_server);
-    collectSignalMetrics(current_metrics_.signal);
+    publish([&](SystemMetrics& metrics) {
+        metrics.signal = signal;
+    });
 }
 
 void SystemDataCollector::collectCPUMetrics(SystemMetrics::CPU& cpu) {
-    cpu.usage_percent = getCPUUsage();
-    cpu.cores = getCPUCoreCount();
+    cpu_sampler_.sample(cpu);
+    
+    // Sensor files move only on hotplug; the inventory says when
+    auto hardware = hardware_inventory_.get();
+    if (hardware->generation != hardware_generation_) {
+        temperature_file_.reopen(hardware->temperature_path);
+        frequency_file_.reopen(hardware->frequency_path);
+        hardware_generation_ = hardware->generation;
+    }
+    cpu.cores = hardware->cpu_cores;
     cpu.temperature_celsius = getCPUTemperature();
     cpu.frequency_ghz = getCPUFrequency();
 }
 
-void SystemDataCollector::collectRAMMetrics(SystemMetrics::RAM& ram) {
-    ram.usage_percent = getRAMUsagePercent();
-    ram.used_gb = getRAMUsedGB();
-    ram.total_gb = getRAMTotalGB();
-}
-
-void SystemDataCollector::collectSwapMetrics(SystemMetrics::Swap& swap) {
-    swap.usage_percent = getSwapUsagePercent();
-    swap.used_mb = getSwapUsedMB();
-    swap.total_gb = getSwapTotalGB();
-    swap.status = swap.usage_percent > 80.0 ? "High" : "Normal";
+// One read and parse of /proc/meminfo serves both RAM and swap
+void SystemDataCollector::collectMemoryMetrics(SystemMetrics::RAM& ram, SystemMetrics::Swap& swap) {
+    MemInfo info;
+    if (!readMemInfo(info)) {
+        return;
+    }
+    
+    if (info.mem_total_kb > 0) {
+        long used_kb = info.mem_total_kb - info.mem_available_kb;
+        ram.usage_percent = 100.0 * (double)used_kb / info.mem_total_kb;
+        ram.used_gb = used_kb / (1024.0 * 1024.0); // Convert to GB
+    }
+    ram.total_gb = info.mem_total_kb / (1024.0 * 1024.0);
+    
+    if (info.swap_total_kb > 0) {
+        long used_kb = info.swap_total_kb - info.swap_free_kb;
+        swap.usage_percent = 100.0 * (double)used_kb / info.swap_total_kb;
+        swap.used_mb = used_kb / 1024.0; // Convert to MB
+    }
+    swap.total_gb = info.swap_total_kb / (1024.0 * 1024.0);
+    swap.status = swap.usage_percent > 80.0 ? SwapStatus::High : SwapStatus::Normal;
 }
 
-void SystemDataCollector::collectNetworkMetrics(SystemMetrics::Network& network) {
-    network.internet.external_ip = getExternalIP();
-    network.internet.latency_ms = getNetworkLatency();
-    network.connection.local_ip = getLocalIP();
-    network.connection.gateway = getGateway();
-    network.connection.interface_name = getNetworkInterface();
-    network.connection.mac_address = getMACAddress();
+bool SystemDataCollector::readMemInfo(MemInfo& info) {
+    char buffer[4096];
+    long length = meminfo_file_.read(buffer, sizeof(buffer));
+    if (length <= 0) {
+        logError("Failed to read /proc/meminfo");
+        return false;
+    }
+    
+    struct Key {
+        const char* name;
+        size_t length;
+        long* target;
+    };
+    const Key keys[] = {
+        {"MemTotal:", 9, &info.mem_total_kb},
+        {"MemAvailable:", 13, &info.mem_available_kb},
+        {"SwapTotal:", 10, &info.swap_total_kb},
+        {"SwapFree:", 9, &info.swap_free_kb}
+    };
     
-    // Set status based on connectivity
-    network.internet.status = network.internet.external_ip != "N/A" ? "Connected" : "Unknown";
-    network.connection.status = network.connection.local_ip != "N/A" ? "Connected" : "Unknown";
+    const char* end = buffer + length;
+    int found = 0;
+    for (const char* line = buffer; line < end && found < 4; line = nextLine(line, end)) {
+        for (const auto& key : keys) {
+            if (static_cast<size_t>(end - line) > key.length && std::memcmp(line, key.name, key.length) == 0) {
+                long long value = 0;
+                if (parseNumber(line + key.length, end, value)) {
+                    *key.target = static_cast<long>(value);
+                    ++found;
+                }
+                break;
+            }
+        }
+    }
+    
+    return true;
 }
 
 void SystemDataCollector::collectUltimaServerMetrics(SystemMetrics::UltimaServer& server) {
-    // Placeholder implementation - keep default values
-    server.status = "Unknown";
-    server.server = "N/A";
-    server.port = 0;
-    server.protocol = "N/A";
-    server.last_ping_ms = 0.0;
-    server.session = "N/A";
-}
-
-void SystemDataCollector::collectSignalMetrics(SystemMetrics::Signal& signal) {
-    // Placeholder implementation - cellular modem specific metrics
-    // These would require specific modem hardware and APIs
-    signal.strength.status = "No Signal";
-    signal.strength.rssi_dbm = 0.0;
-    signal.strength.rsrp_dbm = 0.0;
-    signal.strength.rsrq_db = 0.0;
-    signal.strength.sinr_db = 0.0;
-    signal.strength.cell_id = "N/A";
-    
-    signal.connection.status = "Disconnected";
-    signal.connection.network = "N/A";
-    signal.connection.technology = "N/A";
-    signal.connection.band = "N/A";
-    signal.connection.apn = "N/A";
-    signal.connection.data_usage_mb = 0.0;
-}
-
-double SystemDataCollector::getCPUUsage() {
-    try {
-        std::string stat = readFile("/proc/stat");
-        if (stat.empty()) return 0.0;
-        
-        std::istringstream iss(stat);
-        std::string cpu_label;
-        long user, nice, system, idle, iowait, irq, softirq, steal;
-        
-        iss >> cpu_label >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
+    if (ultima_server_source_) {
+        ultima_server_source_(server);
+    }
+}
+
+SystemDataCollector::CpuSampler::CpuSampler()
+    : stat_file_("/proc/stat"), buffer_(4096), primed_(false) {
+}
+
+bool SystemDataCollector::CpuSampler::sample(SystemMetrics::CPU& cpu) {
+    // The cpu lines lead the file; keep doubling the buffer while the read
+    // ends inside them (large core counts)
+    long length = -1;
+    for (;;) {
+        length = stat_file_.read(buffer_.data(), buffer_.size());
+        if (length <= 0) {
+            return false;
+        }
+        if (static_cast<size_t>(length) < buffer_.size() - 1 || buffer_.size() >= 256 * 1024 ||
+            std::strstr(buffer_.data(), "\nintr") != nullptr) {
+            break;
+        }
+        buffer_.resize(buffer_.size() * 2);
+    }
+    
+    Counters total;
+    current_cores_.clear();
+    bool found_total = false;
+    
+    const char* end = buffer_.data() + length;
+    for (const char* line = buffer_.data(); line + 3 < end && std::strncmp(line, "cpu", 3) == 0;
+         line = nextLine(line, end)) {
+        const char* p = line + 3;
+        long long index = -1;
+        if (*p != ' ') {
+            p = parseNumber(p, end, index);
+            if (!p) {
+                break;
+            }
+        }
         
-        long total = user + nice + system + idle + iowait + irq + softirq + steal;
-        long idle_time = idle + iowait;
+        // user nice system idle iowait irq softirq steal
+        long long fields[8] = {0};
+        for (int i = 0; i < 8 && p; ++i) {
+            p = parseNumber(p, end, fields[i]);
+        }
         
-        static long prev_total = 0, prev_idle = 0;
+        Counters counters;
+        counters.user = fields[0] + fields[1];
+        counters.system = fields[2];
+        counters.idle = fields[3];
+        counters.iowait = fields[4];
+        counters.irq = fields[5] + fields[6];
+        counters.steal = fields[7];
+        counters.total = counters.user + counters.system + counters.idle + counters.iowait +
+                         counters.irq + counters.steal;
         
-        if (prev_total > 0) {
-            long total_diff = total - prev_total;
-            long idle_diff = idle_time - prev_idle;
-            
-            if (total_diff > 0) {
-                double usage = 100.0 * (1.0 - (double)idle_diff / total_diff);
-                prev_total = total;
-                prev_idle = idle_time;
-                return std::max(0.0, std::min(100.0, usage));
+        if (index < 0) {
+            total = counters;
+            found_total = true;
+        } else {
+            if (current_cores_.size() <= static_cast<size_t>(index)) {
+                current_cores_.resize(static_cast<size_t>(index) + 1);
             }
+            current_cores_[static_cast<size_t>(index)] = counters;
         }
+    }
+    
+    if (!found_total) {
+        return false;
+    }
+    
+    if (primed_) {
+        cpu.total = delta(total_, total);
+        cpu.usage_percent = cpu.total.usage_percent;
         
-        prev_total = total;
-        prev_idle = idle_time;
-        return 0.0;
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get CPU usage: " + std::string(e.what()));
-        return 0.0;
+        // A core that went offline or came back has no usable baseline
+        cpu.per_core.clear();
+        cpu.per_core.resize(current_cores_.size());
+        for (size_t i = 0; i < cpu.per_core.size() && i < cores_.size(); ++i) {
+            cpu.per_core[i] = delta(cores_[i], current_cores_[i]);
+        }
     }
+    
+    total_ = total;
+    cores_.swap(current_cores_);
+    primed_ = true;
+    return true;
 }
 
-int SystemDataCollector::getCPUCoreCount() {
-    try {
-        std::string cpuinfo = readFile("/proc/cpuinfo");
-        if (cpuinfo.empty()) return 1;
+SystemDataCollector::SystemMetrics::CPU::Breakdown SystemDataCollector::CpuSampler::delta(const Counters& previous,
+                                                                      const Counters& current) {
+    SystemMetrics::CPU::Breakdown breakdown;
+    if (current.total <= previous.total) {
+        return breakdown;
+    }
+    
+    double span = static_cast<double>(current.total - previous.total);
+    auto share = [span](unsigned long long now, unsigned long long before) {
+        return now > before ? std::min(100.0, 100.0 * static_cast<double>(now - before) / span) : 0.0;
+    };
+    
+    breakdown.user_percent = share(current.user, previous.user);
+    breakdown.system_percent = share(current.system, previous.system);
+    breakdown.iowait_percent = share(current.iowait, previous.iowait);
+    breakdown.irq_percent = share(current.irq, previous.irq);
+    breakdown.steal_percent = share(current.steal, previous.steal);
+    breakdown.usage_percent = std::min(100.0, breakdown.user_percent + breakdown.system_percent +
+                                                  breakdown.irq_percent + breakdown.steal_percent);
+    return breakdown;
+}
+
+SystemDataCollector::TrafficSampler::TrafficSampler()
+    : dev_file_("/proc/net/dev"), buffer_(4096) {
+}
+
+bool SystemDataCollector::TrafficSampler::sample(FixedVector<SystemMetrics::Network::InterfaceTraffic, 32>& interfaces) {
+    long length = -1;
+    for (;;) {
+        length = dev_file_.read(buffer_.data(), buffer_.size());
+        if (length <= 0) {
+            return false;
+        }
+        if (static_cast<size_t>(length) < buffer_.size() - 1 || buffer_.size() >= 1024 * 1024) {
+            break;
+        }
+        buffer_.resize(buffer_.size() * 2);
+    }
+    auto now = std::chrono::steady_clock::now();
+    
+    // Two header lines, then "name: rx bytes packets errs drop fifo frame
+    // compressed multicast tx bytes packets errs drop ..."
+    current_.clear();
+    const char* end = buffer_.data() + length;
+    for (const char* line = nextLine(nextLine(buffer_.data(), end), end); line < end; line = nextLine(line, end)) {
+        const char* colon = line;
+        while (colon < end && *colon != ':' && *colon != '\n') {
+            ++colon;
+        }
+        if (colon >= end || *colon != ':') {
+            continue;
+        }
+        const char* name = line;
+        while (name < colon && *name == ' ') {
+            ++name;
+        }
         
-        std::istringstream iss(cpuinfo);
-        std::string line;
-        int core_count = 0;
+        long long fields[12] = {0};
+        const char* p = colon + 1;
+        for (int i = 0; i < 12 && p; ++i) {
+            p = parseNumber(p, end, fields[i]);
+        }
+        if (!p) {
+            continue;
+        }
         
-        while (std::getline(iss, line)) {
-            if (line.find("processor") == 0) {
-                core_count++;
+        Counters& counters = current_[std::string(name, colon)];
+        const int columns[8] = {0, 1, 2, 3, 8, 9, 10, 11};
+        for (int i = 0; i < 8; ++i) {
+            counters.values[i] = static_cast<uint64_t>(fields[columns[i]]);
+        }
+    }
+    
+    double seconds = std::chrono::duration<double>(now - previous_time_).count();
+    interfaces.clear();
+    for (const auto& entry : current_) {
+        const uint64_t* values = entry.second.values;
+        double rates[8] = {0.0};
+        auto previous = previous_.find(entry.first);
+        if (previous != previous_.end() && seconds > 0.0) {
+            const uint64_t* before = previous->second.values;
+            if (std::equal(values, values + 8, before, [](uint64_t a, uint64_t b) { return a >= b; })) {
+                for (int i = 0; i < 8; ++i) {
+                    rates[i] = static_cast<double>(values[i] - before[i]) / seconds;
+                }
             }
         }
         
-        return std::max(1, core_count);
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get CPU core count: " + std::string(e.what()));
-        return 1;
+        SystemMetrics::Network::InterfaceTraffic traffic;
+        traffic.name = entry.first;
+        traffic.rx_bytes_per_sec = rates[0];
+        traffic.rx_packets_per_sec = rates[1];
+        traffic.rx_errors_per_sec = rates[2];
+        traffic.rx_drops_per_sec = rates[3];
+        traffic.tx_bytes_per_sec = rates[4];
+        traffic.tx_packets_per_sec = rates[5];
+        traffic.tx_errors_per_sec = rates[6];
+        traffic.tx_drops_per_sec = rates[7];
+        traffic.rx_bytes = values[0];
+        traffic.tx_bytes = values[4];
+        interfaces.push_back(traffic);
     }
+    
+    previous_.swap(current_);
+    previous_time_ = now;
+    return true;
 }
 
 double SystemDataCollector::getCPUTemperature() {
-    try {
-        // Try common thermal zones
-        std::vector<std::string> thermal_paths = {
-            "/sys/class/thermal/thermal_zone0/temp",
-            "/sys/class/hwmon/hwmon0/temp1_input",
-            "/sys/devices/virtual/thermal/thermal_zone0/temp"
-        };
-        
-        for (const auto& path : thermal_paths) {
-            std::string temp_str = readFile(path);
-            if (!temp_str.empty()) {
-                double temp_millidegrees = std::stod(temp_str);
-                return temp_millidegrees / 1000.0; // Convert to Celsius
-            }
-        }
-        
+    char buffer[32];
+    long long millidegrees = 0;
+    long length = temperature_file_.read(buffer, sizeof(buffer));
+    if (length <= 0 || !parseNumber(buffer, buffer + length, millidegrees)) {
         return 0.0; // Temperature not available
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get CPU temperature: " + std::string(e.what()));
-        return 0.0;
     }
+    return millidegrees / 1000.0; // Convert to Celsius
 }
 
 double SystemDataCollector::getCPUFrequency() {
     try {
-        std::string freq_str = readFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq");
-        if (!freq_str.empty()) {
-            double freq_khz = std::stod(freq_str);
+        char buffer[32];
+        long long freq_khz = 0;
+        long length = frequency_file_.read(buffer, sizeof(buffer));
+        if (length > 0 && parseNumber(buffer, buffer + length, freq_khz)) {
             return freq_khz / 1000000.0; // Convert to GHz
         }
         
-        // Fallback to /proc/cpuinfo
+        // Fallback to /proc/cpuinfo (no cpufreq driver)
         std::string cpuinfo = readFile("/proc/cpuinfo");
         if (!cpuinfo.empty()) {
             size_t pos = cpuinfo.find("cpu MHz");
@@ -337,251 +1164,131 @@ double SystemDataCollector::getCPUFrequency() {
     }
 }
 
-double SystemDataCollector::getRAMUsagePercent() {
-    try {
-        std::string meminfo = readFile("/proc/meminfo");
-        if (meminfo.empty()) return 0.0;
-        
-        long total_kb = parseLongFromProc(meminfo, "MemTotal:");
-        long available_kb = parseLongFromProc(meminfo, "MemAvailable:");
-        
-        if (total_kb > 0) {
-            long used_kb = total_kb - available_kb;
-            return 100.0 * (double)used_kb / total_kb;
-        }
-        
-        return 0.0;
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get RAM usage: " + std::string(e.what()));
-        return 0.0;
+// IPv4 address of the default-route interface, falling back to the first
+// non-loopback address (what `hostname -I | awk '{print $1}'` reported)
+std::string SystemDataCollector::getLocalIP() {
+    std::string default_iface;
+    std::string gateway;
+    readDefaultRoute(default_iface, gateway);
+    
+    struct ifaddrs* addrs = nullptr;
+    if (getifaddrs(&addrs) != 0) {
+        logError("Failed to get local IP: getifaddrs: " + std::string(strerror(errno)));
+        return "N/A";
     }
-}
-
-double SystemDataCollector::getRAMUsedGB() {
-    try {
-        std::string meminfo = readFile("/proc/meminfo");
-        if (meminfo.empty()) return 0.0;
-        
-        long total_kb = parseLongFromProc(meminfo, "MemTotal:");
-        long available_kb = parseLongFromProc(meminfo, "MemAvailable:");
-        
-        if (total_kb > 0) {
-            long used_kb = total_kb - available_kb;
-            return used_kb / (1024.0 * 1024.0); // Convert to GB
+    
+    std::string first;
+    std::string preferred;
+    for (struct ifaddrs* ifa = addrs; ifa != nullptr; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || ifa->ifa_addr->sa_family != AF_INET || (ifa->ifa_flags & IFF_LOOPBACK)) {
+            continue;
         }
         
-        return 0.0;
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get RAM used: " + std::string(e.what()));
-        return 0.0;
-    }
-}
-
-double SystemDataCollector::getRAMTotalGB() {
-    try {
-        std::string meminfo = readFile("/proc/meminfo");
-        if (meminfo.empty()) return 0.0;
-        
-        long total_kb = parseLongFromProc(meminfo, "MemTotal:");
-        return total_kb / (1024.0 * 1024.0); // Convert to GB
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get RAM total: " + std::string(e.what()));
-        return 0.0;
-    }
-}
-
-double SystemDataCollector::getSwapUsagePercent() {
-    try {
-        std::string meminfo = readFile("/proc/meminfo");
-        if (meminfo.empty()) return 0.0;
-        
-        long total_kb = parseLongFromProc(meminfo, "SwapTotal:");
-        long free_kb = parseLongFromProc(meminfo, "SwapFree:");
-        
-        if (total_kb > 0) {
-            long used_kb = total_kb - free_kb;
-            return 100.0 * (double)used_kb / total_kb;
+        char buffer[INET_ADDRSTRLEN];
+        const struct sockaddr_in* sin = reinterpret_cast<const struct sockaddr_in*>(ifa->ifa_addr);
+        if (!inet_ntop(AF_INET, &sin->sin_addr, buffer, sizeof(buffer))) {
+            continue;
         }
         
-        return 0.0;
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get swap usage: " + std::string(e.what()));
-        return 0.0;
-    }
-}
-
-double SystemDataCollector::getSwapUsedMB() {
-    try {
-        std::string meminfo = readFile("/proc/meminfo");
-        if (meminfo.empty()) return 0.0;
-        
-        long total_kb = parseLongFromProc(meminfo, "SwapTotal:");
-        long free_kb = parseLongFromProc(meminfo, "SwapFree:");
-        
-        if (total_kb > 0) {
-            long used_kb = total_kb - free_kb;
-            return used_kb / 1024.0; // Convert to MB
+        if (first.empty()) {
+            first = buffer;
+        }
+        if (!default_iface.empty() && default_iface == ifa->ifa_name) {
+            preferred = buffer;
+            break;
         }
-        
-        return 0.0;
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get swap used: " + std::string(e.what()));
-        return 0.0;
     }
-}
-
-double SystemDataCollector::getSwapTotalGB() {
-    try {
-        std::string meminfo = readFile("/proc/meminfo");
-        if (meminfo.empty()) return 0.0;
-        
-        long total_kb = parseLongFromProc(meminfo, "SwapTotal:");
-        return total_kb / (1024.0 * 1024.0); // Convert to GB
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get swap total: " + std::string(e.what()));
-        return 0.0;
+    freeifaddrs(addrs);
+    
+    if (!preferred.empty()) {
+        return preferred;
     }
+    return first.empty() ? "N/A" : first;
 }
 
-std::string SystemDataCollector::getExternalIP() {
-    try {
-        // Use curl to get external IP (cached result)
-        std::string cmd = "curl -s --connect-timeout 5 --max-time 10 ifconfig.me 2>/dev/null";
-        std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-        
-        if (!pipe) return "N/A";
-        
-        char buffer[128];
-        std::string result;
-        while (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-            result += buffer;
-        }
-        
-        // Remove whitespace
-        result.erase(std::remove_if(result.begin(), result.end(), ::isspace), result.end());
-        
-        return result.empty() ? "N/A" : result;
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get external IP: " + std::string(e.what()));
-        return "N/A";
-    }
+std::string SystemDataCollector::getGateway() {
+    std::string iface;
+    std::string gateway;
+    return readDefaultRoute(iface, gateway) && !gateway.empty() ? gateway : "N/A";
 }
 
-std::string SystemDataCollector::getLocalIP() {
-    try {
-        std::string cmd = "hostname -I | awk '{print $1}' 2>/dev/null";
-        std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-        
-        if (!pipe) return "N/A";
-        
-        char buffer[128];
-        std::string result;
-        if (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-            result = buffer;
-            result.erase(std::remove_if(result.begin(), result.end(), ::isspace), result.end());
-        }
-        
-        return result.empty() ? "N/A" : result;
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get local IP: " + std::string(e.what()));
-        return "N/A";
+// Hardware address of the default-route interface, else of the first
+// Ethernet-type interface
+std::string SystemDataCollector::getMACAddress() {
+    std::string default_iface;
+    std::string gateway;
+    readDefaultRoute(default_iface, gateway);
+    
+    auto hardware = hardware_inventory_.get();
+    auto it = hardware->mac_addresses.find(default_iface);
+    if (it == hardware->mac_addresses.end()) {
+        it = hardware->mac_addresses.begin();
     }
+    return it != hardware->mac_addresses.end() ? it->second : "N/A";
 }
 
-std::string SystemDataCollector::getGateway() {
-    try {
-        std::string cmd = "ip route | grep default | awk '{print $3}' 2>/dev/null";
-        std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-        
-        if (!pipe) return "N/A";
-        
-        char buffer[128];
-        std::string result;
-        if (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-            result = buffer;
-            result.erase(std::remove_if(result.begin(), result.end(), ::isspace), result.end());
-        }
-        
-        return result.empty() ? "N/A" : result;
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get gateway: " + std::string(e.what()));
-        return "N/A";
-    }
+std::string SystemDataCollector::getNetworkInterface() {
+    std::string iface;
+    std::string gateway;
+    return readDefaultRoute(iface, gateway) ? iface : "N/A";
 }
 
-std::string SystemDataCollector::getMACAddress() {
-    try {
-        std::string cmd = "ip link show | grep -E 'link/ether' | head -1 | awk '{print $2}' 2>/dev/null";
-        std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-        
-        if (!pipe) return "N/A";
-        
-        char buffer[128];
-        std::string result;
-        if (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-            result = buffer;
-            result.erase(std::remove_if(result.begin(), result.end(), ::isspace), result.end());
-        }
-        
-        return result.empty() ? "N/A" : result;
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get MAC address: " + std::string(e.what()));
+// Negotiated rate from sysfs; not known for wireless and virtual links
+std::string SystemDataCollector::getLinkSpeed(const std::string& iface) {
+    if (iface == "N/A" || iface.find('/') != std::string::npos) {
         return "N/A";
     }
+    
+    std::string speed = readFile("/sys/class/net/" + iface + "/speed");
+    int mbps = std::atoi(speed.c_str());
+    return mbps > 0 ? std::to_string(mbps) + " Mbps" : "N/A";
 }
 
-double SystemDataCollector::getNetworkLatency() {
-    try {
-        std::string cmd = "ping -c 1 8.8.8.8 2>/dev/null | grep 'time=' | awk -F'time=' '{print $2}' | awk '{print $1}'";
-        std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-        
-        if (!pipe) return 0.0;
-        
-        char buffer[128];
-        std::string result;
-        if (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-            result = buffer;
-            result.erase(std::remove_if(result.begin(), result.end(), ::isspace), result.end());
-        }
-        
-        return result.empty() ? 0.0 : std::stod(result);
-        
-    } catch (const std::exception& e) {
-        logError("Failed to get network latency: " + std::string(e.what()));
-        return 0.0;
+// Picks the lowest-metric default route from /proc/net/route. Addresses in
+// that file are hex in network byte order as stored in memory.
+bool SystemDataCollector::readDefaultRoute(std::string& iface, std::string& gateway) {
+    std::string routes = readFile("/proc/net/route");
+    if (routes.empty()) {
+        return false;
     }
-}
-
-std::string SystemDataCollector::getNetworkInterface() {
-    try {
-        std::string cmd = "ip route | grep default | awk '{print $5}' 2>/dev/null";
-        std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd.c_str(), "r"), pclose);
-        
-        if (!pipe) return "N/A";
+    
+    std::istringstream iss(routes);
+    std::string line;
+    std::getline(iss, line); // Header
+    
+    long best_metric = -1;
+    while (std::getline(iss, line)) {
+        char name[IFNAMSIZ + 1] = {0};
+        unsigned int destination = 0;
+        unsigned int via = 0;
+        unsigned int flags = 0;
+        int refcnt = 0;
+        int use = 0;
+        long metric = 0;
+        if (std::sscanf(line.c_str(), "%16s %x %x %x %d %d %ld", name, &destination, &via, &flags,
+                        &refcnt, &use, &metric) != 7) {
+            continue;
+        }
         
-        char buffer[128];
-        std::string result;
-        if (fgets(buffer, sizeof(buffer), pipe.get()) != nullptr) {
-            result = buffer;
-            result.erase(std::remove_if(result.begin(), result.end(), ::isspace), result.end());
+        if (destination != 0 || !(flags & RTF_UP_FLAG) || (best_metric >= 0 && metric >= best_metric)) {
+            continue;
         }
         
-        return result.empty() ? "N/A" : result;
+        best_metric = metric;
+        iface = name;
         
-    } catch (const std::exception& e) {
-        logError("Failed to get network interface: " + std::string(e.what()));
-        return "N/A";
+        gateway.clear();
+        if (flags & RTF_GATEWAY_FLAG) {
+            struct in_addr addr;
+            addr.s_addr = via;
+            char buffer[INET_ADDRSTRLEN];
+            if (inet_ntop(AF_INET, &addr, buffer, sizeof(buffer))) {
+                gateway = buffer;
+            }
+        }
     }
+    
+    return best_metric >= 0;
 }
 
 std::string SystemDataCollector::readFile(const std::string& path) {
@@ -595,50 +1302,6 @@ std::string SystemDataCollector::readFile(const std::string& path) {
     return buffer.str();
 }
 
-double SystemDataCollector::parseDoubleFromProc(const std::string& content, const std::string& key) {
-    size_t pos = content.find(key);
-    if (pos == std::string::npos) return 0.0;
-    
-    size_t start = pos + key.length();
-    while (start < content.length() && isspace(content[start])) {
-        start++;
-    }
-    
-    size_t end = start;
-    while (end < content.length() && !isspace(content[end])) {
-        end++;
-    }
-    
-    std::string value = content.substr(start, end - start);
-    try {
-        return std::stod(value);
-    } catch (...) {
-        return 0.0;
-    }
-}
-
-long SystemDataCollector::parseLongFromProc(const std::string& content, const std::string& key) {
-    size_t pos = content.find(key);
-    if (pos == std::string::npos) return 0;
-    
-    size_t start = pos + key.length();
-    while (start < content.length() && isspace(content[start])) {
-        start++;
-    }
-    
-    size_t end = start;
-    while (end < content.length() && !isspace(content[end])) {
-        end++;
-    }
-    
-    std::string value = content.substr(start, end - start);
-    try {
-        return std::stol(value);
-    } catch (...) {
-        return 0;
-    }
-}
-
 void SystemDataCollector::logError(const std::string& message) const {
     std::cerr << "[SystemDataCollector] ERROR: " << message << std::endl;
 }
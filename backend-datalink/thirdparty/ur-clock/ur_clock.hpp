@@ -0,0 +1,154 @@
+/**
+ * @file ur_clock.hpp
+ * @brief Wall-clock timestamps for log lines and database rows without a
+ *        localtime() and a stream per call
+ *
+ * Header-only, shared by backend-datalink and frontendpp. Each thread
+ * keeps the formatted "YYYY-MM-DD HH:MM:SS" of the last second it asked
+ * for, per zone, so localtime_r (and the time zone lock it takes) runs
+ * once per second and thread; within the second a timestamp is a copy of
+ * that prefix plus the milliseconds. Nothing here takes a lock of its own.
+ *
+ * wallFromSteady() converts steady_clock readings (deadlines, event
+ * times) to wall time through an offset refreshed at most once per
+ * second, so a step of the wall clock (NTP after boot without an RTC) is
+ * picked up within a second.
+ */
+
+#ifndef UR_CLOCK_HPP
+#define UR_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+namespace UrClock {
+
+enum class Zone { Local, Utc };
+
+typedef std::chrono::system_clock WallClock;
+typedef std::chrono::steady_clock SteadyClock;
+
+// Length of "YYYY-MM-DD HH:MM:SS" and of "YYYY-MM-DD HH:MM:SS.mmm"
+constexpr size_t kSecondsLength = 19;
+constexpr size_t kMillisLength = 23;
+
+namespace detail {
+
+struct SecondCache {
+    std::time_t second = static_cast<std::time_t>(-1);
+    char text[kSecondsLength + 1] = {0};
+};
+
+inline const SecondCache& cachedSecond(std::time_t second, Zone zone) {
+    thread_local SecondCache caches[2];
+    SecondCache& cache = caches[zone == Zone::Utc ? 1 : 0];
+    if (cache.second != second) {
+        std::tm tm;
+        if (zone == Zone::Utc) {
+            gmtime_r(&second, &tm);
+        } else {
+            localtime_r(&second, &tm);
+        }
+        if (std::strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &tm) != kSecondsLength) {
+            std::memset(cache.text, '0', kSecondsLength);   // Year past 9999
+            cache.text[kSecondsLength] = '\0';
+        }
+        cache.second = second;
+    }
+    return cache;
+}
+
+inline std::atomic<int64_t>& wallOffsetNs() {
+    static std::atomic<int64_t> offset{0};
+    return offset;
+}
+
+inline std::atomic<int64_t>& offsetSampledAtNs() {
+    static std::atomic<int64_t> sampled{0};          // 0: never
+    return sampled;
+}
+
+inline int64_t sinceEpochNs(WallClock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+inline int64_t sinceEpochNs(SteadyClock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace detail
+
+// "YYYY-MM-DD HH:MM:SS" of the second; valid until the calling thread asks
+// for another second in the same zone
+inline const char* formatSeconds(std::time_t second, Zone zone = Zone::Local) {
+    return detail::cachedSecond(second, zone).text;
+}
+
+// Writes "YYYY-MM-DD HH:MM:SS.mmm" and a NUL into out, which holds at
+// least kMillisLength + 1 chars; returns kMillisLength
+inline size_t formatMillis(char* out, WallClock::time_point time, Zone zone = Zone::Local) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    std::time_t second = static_cast<std::time_t>(ms / 1000);
+    int millis = static_cast<int>(ms % 1000);
+    if (millis < 0) {
+        second -= 1;
+        millis += 1000;
+    }
+    std::memcpy(out, detail::cachedSecond(second, zone).text, kSecondsLength);
+    out[kSecondsLength] = '.';
+    out[kSecondsLength + 1] = static_cast<char>('0' + millis / 100);
+    out[kSecondsLength + 2] = static_cast<char>('0' + millis / 10 % 10);
+    out[kSecondsLength + 3] = static_cast<char>('0' + millis % 10);
+    out[kMillisLength] = '\0';
+    return kMillisLength;
+}
+
+// "YYYY-MM-DD HH:MM:SS" of now
+inline std::string timestamp(Zone zone = Zone::Local) {
+    return std::string(formatSeconds(WallClock::to_time_t(WallClock::now()), zone), kSecondsLength);
+}
+
+// "YYYY-MM-DD HH:MM:SS.mmm" of time
+inline std::string timestampMillis(WallClock::time_point time, Zone zone = Zone::Local) {
+    char buffer[kMillisLength + 1];
+    return std::string(buffer, formatMillis(buffer, time, zone));
+}
+
+inline std::string timestampMillis(Zone zone = Zone::Local) {
+    return timestampMillis(WallClock::now(), zone);
+}
+
+// ISO 8601 in UTC, "YYYY-MM-DDTHH:MM:SSZ", which sorts as text
+inline std::string iso8601(WallClock::time_point time) {
+    std::string text(formatSeconds(WallClock::to_time_t(time), Zone::Utc), kSecondsLength);
+    text[10] = 'T';
+    text.push_back('Z');
+    return text;
+}
+
+inline std::string iso8601() {
+    return iso8601(WallClock::now());
+}
+
+// The wall time a steady_clock reading corresponds to
+inline WallClock::time_point wallFromSteady(SteadyClock::time_point time) {
+    int64_t now_ns = detail::sinceEpochNs(SteadyClock::now());
+    int64_t sampled_ns = detail::offsetSampledAtNs().load(std::memory_order_relaxed);
+    if (sampled_ns == 0 || now_ns - sampled_ns >= 1000000000 || now_ns < sampled_ns) {
+        // Racing refreshes store near-identical offsets; either one will do
+        int64_t offset = detail::sinceEpochNs(WallClock::now()) - detail::sinceEpochNs(SteadyClock::now());
+        detail::wallOffsetNs().store(offset, std::memory_order_relaxed);
+        detail::offsetSampledAtNs().store(now_ns, std::memory_order_relaxed);
+    }
+    int64_t wall_ns = detail::sinceEpochNs(time) + detail::wallOffsetNs().load(std::memory_order_relaxed);
+    return WallClock::time_point(std::chrono::duration_cast<WallClock::duration>(std::chrono::nanoseconds(wall_ns)));
+}
+
+} // namespace UrClock
+
+#endif // UR_CLOCK_HPP
@@ -0,0 +1,310 @@
+/**
+ * @file ur_concurrency.h
+ * @brief Bounded lock-free rings, padded counters and an eventfd wakeup
+ *
+ * Header-only C, also compiled as C++ (see ur_concurrency.hpp for typed
+ * wrappers), so the C libraries (ur-threadder-api, ur-rpc-template) and the
+ * C++ modules share one implementation. Atomics are GCC/Clang __atomic
+ * builtins on plain fields, which both languages accept.
+ *
+ * - ur_mpmc_ring_t: Vyukov's bounded queue of pointers; any number of
+ *   producers and consumers, neither side ever blocks or allocates.
+ * - ur_spsc_ring_t: one producer, one consumer; each side keeps a cached
+ *   copy of the other's index and only reads the shared one when the
+ *   cache says full or empty.
+ * - ur_padded_counter_t: a counter alone on its cache line, for the
+ *   statistics several threads bump.
+ * - ur_wakeup_t: lets a consumer sleep on an eventfd (or its own poll
+ *   loop) while producers pay for the write() only when it sleeps.
+ *
+ * Rings hold void pointers; NULL can be queued like any other value.
+ * Capacities are rounded up to a power of two.
+ */
+
+#ifndef UR_CONCURRENCY_H
+#define UR_CONCURRENCY_H
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UR_CACHE_LINE 64
+#define UR_CACHE_ALIGNED __attribute__((aligned(UR_CACHE_LINE)))
+
+static inline size_t ur_ring_round_up(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    return size;
+}
+
+/* ---- MPMC ring ---------------------------------------------------------- */
+
+typedef struct {
+    size_t sequence;
+    void* item;
+} ur_mpmc_cell_t;
+
+typedef struct {
+    UR_CACHE_ALIGNED size_t enqueue_pos;
+    UR_CACHE_ALIGNED size_t dequeue_pos;
+    UR_CACHE_ALIGNED size_t mask;
+    ur_mpmc_cell_t* cells;
+} ur_mpmc_ring_t;
+
+/** @brief 0, or -1 when the cells cannot be allocated */
+static inline int ur_mpmc_ring_init(ur_mpmc_ring_t* ring, size_t capacity) {
+    size_t size = ur_ring_round_up(capacity);
+    ring->cells = (ur_mpmc_cell_t*)malloc(size * sizeof(ur_mpmc_cell_t));
+    if (!ring->cells) {
+        return -1;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        ring->cells[i].sequence = i;
+        ring->cells[i].item = NULL;
+    }
+    ring->mask = size - 1;
+    ring->enqueue_pos = 0;
+    ring->dequeue_pos = 0;
+    return 0;
+}
+
+/** @brief Frees the cells; items still queued are the caller's */
+static inline void ur_mpmc_ring_destroy(ur_mpmc_ring_t* ring) {
+    free(ring->cells);
+    ring->cells = NULL;
+}
+
+/** @brief False when the ring is full */
+static inline bool ur_mpmc_ring_push(ur_mpmc_ring_t* ring, void* item) {
+    size_t pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+    ur_mpmc_cell_t* cell;
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->enqueue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    cell->item = item;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/** @brief False when the ring is empty */
+static inline bool ur_mpmc_ring_pop(ur_mpmc_ring_t* ring, void** item) {
+    size_t pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+    ur_mpmc_cell_t* cell;
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->dequeue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+    *item = cell->item;
+    __atomic_store_n(&cell->sequence, pos + ring->mask + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/** @brief Items queued, exact only while nobody pushes or pops */
+static inline size_t ur_mpmc_ring_size(const ur_mpmc_ring_t* ring) {
+    size_t dequeue = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+    size_t enqueue = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+    return enqueue > dequeue ? enqueue - dequeue : 0;
+}
+
+static inline size_t ur_mpmc_ring_capacity(const ur_mpmc_ring_t* ring) {
+    return ring->mask + 1;
+}
+
+/* ---- SPSC ring ---------------------------------------------------------- */
+
+typedef struct {
+    UR_CACHE_ALIGNED size_t head;       /* Next to pop; written by the consumer */
+    size_t cached_tail;                 /* Consumer's copy of tail */
+    UR_CACHE_ALIGNED size_t tail;       /* Next to push; written by the producer */
+    size_t cached_head;                 /* Producer's copy of head */
+    UR_CACHE_ALIGNED size_t mask;
+    void** items;
+} ur_spsc_ring_t;
+
+/** @brief 0, or -1 when the slots cannot be allocated */
+static inline int ur_spsc_ring_init(ur_spsc_ring_t* ring, size_t capacity) {
+    size_t size = ur_ring_round_up(capacity);
+    ring->items = (void**)calloc(size, sizeof(void*));
+    if (!ring->items) {
+        return -1;
+    }
+    ring->mask = size - 1;
+    ring->head = ring->cached_tail = 0;
+    ring->tail = ring->cached_head = 0;
+    return 0;
+}
+
+static inline void ur_spsc_ring_destroy(ur_spsc_ring_t* ring) {
+    free(ring->items);
+    ring->items = NULL;
+}
+
+/** @brief Producer side only; false when the ring is full */
+static inline bool ur_spsc_ring_push(ur_spsc_ring_t* ring, void* item) {
+    size_t tail = ring->tail;
+    if (tail - ring->cached_head > ring->mask) {
+        ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (tail - ring->cached_head > ring->mask) {
+            return false;
+        }
+    }
+    ring->items[tail & ring->mask] = item;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/** @brief Consumer side only; false when the ring is empty */
+static inline bool ur_spsc_ring_pop(ur_spsc_ring_t* ring, void** item) {
+    size_t head = ring->head;
+    if (head == ring->cached_tail) {
+        ring->cached_tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head == ring->cached_tail) {
+            return false;
+        }
+    }
+    *item = ring->items[head & ring->mask];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static inline size_t ur_spsc_ring_size(const ur_spsc_ring_t* ring) {
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    return tail > head ? tail - head : 0;
+}
+
+static inline size_t ur_spsc_ring_capacity(const ur_spsc_ring_t* ring) {
+    return ring->mask + 1;
+}
+
+/* ---- Padded counter ----------------------------------------------------- */
+
+typedef struct {
+    UR_CACHE_ALIGNED uint64_t value;    /* The alignment pads it to a whole line */
+} ur_padded_counter_t;
+
+static inline void ur_padded_counter_add(ur_padded_counter_t* counter, uint64_t delta) {
+    __atomic_fetch_add(&counter->value, delta, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t ur_padded_counter_load(const ur_padded_counter_t* counter) {
+    return __atomic_load_n(&counter->value, __ATOMIC_RELAXED);
+}
+
+/* ---- Eventfd wakeup ----------------------------------------------------- */
+
+/*
+ * The consumer announces it is about to sleep with ur_wakeup_prepare(),
+ * checks its queue once more, then sleeps in ur_wakeup_wait() (or polls
+ * ur_wakeup_fd() in its own loop and calls ur_wakeup_consume()). A
+ * producer's ur_wakeup_signal() after its push writes the eventfd only when
+ * a consumer announced itself, so a busy queue costs no syscalls.
+ */
+typedef struct {
+    int fd;
+    UR_CACHE_ALIGNED int sleeping;
+} ur_wakeup_t;
+
+/** @brief 0, or -1 with errno from eventfd() */
+static inline int ur_wakeup_init(ur_wakeup_t* wakeup) {
+    wakeup->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    wakeup->sleeping = 0;
+    return wakeup->fd >= 0 ? 0 : -1;
+}
+
+static inline void ur_wakeup_destroy(ur_wakeup_t* wakeup) {
+    if (wakeup->fd >= 0) {
+        close(wakeup->fd);
+        wakeup->fd = -1;
+    }
+}
+
+static inline int ur_wakeup_fd(const ur_wakeup_t* wakeup) {
+    return wakeup->fd;
+}
+
+/** @brief Consumer: about to sleep; check the queue again before waiting */
+static inline void ur_wakeup_prepare(ur_wakeup_t* wakeup) {
+    __atomic_store_n(&wakeup->sleeping, 1, __ATOMIC_RELAXED);
+    /* Orders the announcement before the consumer's last look at the queue */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/** @brief Producer: after a push */
+static inline void ur_wakeup_signal(ur_wakeup_t* wakeup) {
+    /* Orders the push before the look at the announcement */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&wakeup->sleeping, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&wakeup->sleeping, 0, __ATOMIC_SEQ_CST)) {
+        uint64_t one = 1;
+        ssize_t written;
+        do {
+            written = write(wakeup->fd, &one, sizeof(one));
+        } while (written < 0 && errno == EINTR);
+    }
+}
+
+/** @brief Consumer: clears the eventfd and the announcement */
+static inline void ur_wakeup_consume(ur_wakeup_t* wakeup) {
+    uint64_t count;
+    ssize_t got = read(wakeup->fd, &count, sizeof(count));
+    (void)got;
+    __atomic_store_n(&wakeup->sleeping, 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Consumer: sleeps until signalled or timeout_ms passes (-1 waits
+ *        indefinitely); true when signalled
+ */
+static inline bool ur_wakeup_wait(ur_wakeup_t* wakeup, int timeout_ms) {
+    struct pollfd descriptor;
+    descriptor.fd = wakeup->fd;
+    descriptor.events = POLLIN;
+    descriptor.revents = 0;
+    int ready;
+    do {
+        ready = poll(&descriptor, 1, timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+    ur_wakeup_consume(wakeup);
+    return ready > 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UR_CONCURRENCY_H */
@@ -0,0 +1,204 @@
+/**
+ * @file ur_concurrency.hpp
+ * @brief Typed C++ counterparts of ur_concurrency.h
+ *
+ * The rings here hold values of any movable T in their cells instead of
+ * pointers; the algorithms are the ones of the C rings. Wakeup is the C
+ * eventfd wakeup with RAII, so a C producer and a C++ consumer (or the
+ * other way round) can share one through native().
+ */
+
+#ifndef UR_CONCURRENCY_HPP
+#define UR_CONCURRENCY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+#include <utility>
+#include "ur_concurrency.h"
+
+namespace UrConcurrency {
+
+// Bounded multi-producer multi-consumer ring (Vyukov). Neither push() nor
+// pop() blocks: push() returns false when the ring is full, pop() when it
+// is empty. Capacity is rounded up to a power of two.
+template <typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t capacity)
+        : mask_(ur_ring_round_up(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    bool push(T value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Exact only while nobody pushes or pops
+    size_t size() const {
+        size_t dequeue = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t enqueue = enqueue_pos_.load(std::memory_order_relaxed);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(UR_CACHE_LINE) std::atomic<size_t> enqueue_pos_{0};
+    alignas(UR_CACHE_LINE) std::atomic<size_t> dequeue_pos_{0};
+};
+
+// Bounded single-producer single-consumer ring: push() from one thread,
+// pop() from one other. Each side reads the other's index only when its
+// cached copy says full or empty.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : mask_(ur_ring_round_up(capacity) - 1), slots_(new T[mask_ + 1]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side only
+    bool push(T value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side only
+    bool pop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+    alignas(UR_CACHE_LINE) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;            // Consumer's copy of tail_
+    alignas(UR_CACHE_LINE) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;            // Producer's copy of head_
+};
+
+// Relaxed counter alone on its cache line, so counters bumped by
+// different threads do not share one
+class alignas(UR_CACHE_LINE) PaddedCounter {
+public:
+    void add(uint64_t delta = 1) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    uint64_t load() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+// Eventfd wakeup; see ur_wakeup_t for the protocol. Throws std::system_error
+// when the eventfd cannot be created.
+class Wakeup {
+public:
+    Wakeup() {
+        if (ur_wakeup_init(&wakeup_) != 0) {
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+        }
+    }
+    ~Wakeup() { ur_wakeup_destroy(&wakeup_); }
+
+    Wakeup(const Wakeup&) = delete;
+    Wakeup& operator=(const Wakeup&) = delete;
+
+    int fd() const { return ur_wakeup_fd(&wakeup_); }
+    void prepare() { ur_wakeup_prepare(&wakeup_); }
+    void signal() { ur_wakeup_signal(&wakeup_); }
+    void consume() { ur_wakeup_consume(&wakeup_); }
+    bool wait(int timeout_ms) { return ur_wakeup_wait(&wakeup_, timeout_ms); }
+
+    // For a C side sharing the wakeup
+    ur_wakeup_t* native() { return &wakeup_; }
+
+private:
+    ur_wakeup_t wakeup_;
+};
+
+} // namespace UrConcurrency
+
+#endif // UR_CONCURRENCY_HPP
@@ -0,0 +1,334 @@
+/**
+ * @file ur_metrics.hpp
+ * @brief Lock-free counters, gauges and fixed-bucket histograms with a
+ *        Prometheus text exposition renderer
+ *
+ * Header-only, shared by backend-datalink and frontendpp. Series are
+ * created once (under the registry mutex) and the returned references are
+ * updated with relaxed atomics, so the hot path never looks anything up.
+ * Values kept elsewhere, such as queue depths, are registered as callbacks
+ * and read at scrape time.
+ */
+
+#ifndef UR_METRICS_HPP
+#define UR_METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace UrMetrics {
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+namespace detail {
+
+inline void atomicAdd(std::atomic<double>& target, double delta) {
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + delta, std::memory_order_relaxed)) {
+    }
+}
+
+inline std::string formatValue(double value) {
+    if (std::isnan(value)) {
+        return "NaN";
+    }
+    if (std::isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    // Shortest of the two that reads back as the same double
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    if (std::strtod(buffer, nullptr) != value) {
+        std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    }
+    return buffer;
+}
+
+inline std::string escape(const std::string& text, bool quotes) {
+    std::string result;
+    result.reserve(text.size());
+    for (char c : text) {
+        if (c == '\\') {
+            result += "\\\\";
+        } else if (c == '\n') {
+            result += "\\n";
+        } else if (c == '"' && quotes) {
+            result += "\\\"";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+// {a="1",b="2"} with an optional extra pair appended (the histogram "le")
+inline std::string formatLabels(const Labels& labels, const char* extra_name = nullptr,
+                                const std::string& extra_value = std::string()) {
+    if (labels.empty() && !extra_name) {
+        return std::string();
+    }
+    std::string result = "{";
+    bool first = true;
+    for (const auto& label : labels) {
+        if (!first) {
+            result += ',';
+        }
+        first = false;
+        result += label.first + "=\"" + escape(label.second, true) + "\"";
+    }
+    if (extra_name) {
+        if (!first) {
+            result += ',';
+        }
+        result += std::string(extra_name) + "=\"" + extra_value + "\"";
+    }
+    return result + "}";
+}
+
+} // namespace detail
+
+// Monotonic count
+class Counter {
+public:
+    void inc(uint64_t delta = 1) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+// Value that goes up and down
+class Gauge {
+public:
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    void add(double delta) { detail::atomicAdd(value_, delta); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// Cumulative histogram over fixed upper bounds; observations above the last
+// bound land in the implicit +Inf bucket
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds)
+        : bounds_(std::move(bounds)),
+          buckets_(new std::atomic<uint64_t>[bounds_.size() + 1]) {
+        for (size_t i = 0; i <= bounds_.size(); ++i) {
+            buckets_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void observe(double value) {
+        // Bucket lists are short, a linear scan beats a binary search
+        size_t index = 0;
+        while (index < bounds_.size() && value > bounds_[index]) {
+            ++index;
+        }
+        buckets_[index].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        detail::atomicAdd(sum_, value);
+    }
+
+    const std::vector<double>& bounds() const { return bounds_; }
+    uint64_t bucketCount(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double sum() const { return sum_.load(std::memory_order_relaxed); }
+
+private:
+    const std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+    std::atomic<uint64_t> count_{0};
+    std::atomic<double> sum_{0.0};
+};
+
+// Records the lifetime of the scope, in seconds, into a histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        histogram_.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Latency buckets in seconds, 50 us to 10 s
+inline const std::vector<double>& latencyBuckets() {
+    static const std::vector<double> buckets = {
+        0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+        0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 10.0
+    };
+    return buckets;
+}
+
+class Registry {
+public:
+    enum class Type { Counter, Gauge, Histogram };
+
+    // Process-wide registry rendered by the exporters
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    Registry() = default;
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    // The same name and labels always return the same series, so callers
+    // may look one up once and keep the reference
+    Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {}) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& series = seriesLocked(name, help, Type::Counter, labels);
+        if (!series.counter) {
+            series.counter.reset(new Counter());
+        }
+        return *series.counter;
+    }
+
+    Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = {}) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& series = seriesLocked(name, help, Type::Gauge, labels);
+        if (!series.gauge) {
+            series.gauge.reset(new Gauge());
+        }
+        return *series.gauge;
+    }
+
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         const std::vector<double>& bounds = latencyBuckets(), const Labels& labels = {}) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& series = seriesLocked(name, help, Type::Histogram, labels);
+        if (!series.histogram) {
+            series.histogram.reset(new Histogram(bounds));
+        }
+        return *series.histogram;
+    }
+
+    // Counter or gauge read by calling fn at scrape time. Registering the
+    // same name and labels again replaces the function; fn must stay
+    // callable until it is replaced or removed.
+    void callback(const std::string& name, const std::string& help, Type type,
+                  std::function<double()> fn, const Labels& labels = {}) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        seriesLocked(name, help, type, labels).callback = std::move(fn);
+    }
+
+    // Drops the callback series registered under name and labels
+    void removeCallback(const std::string& name, const Labels& labels = {}) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto family = families_.find(name);
+        if (family == families_.end()) {
+            return;
+        }
+        auto series = family->second.series.find(detail::formatLabels(labels));
+        if (series != family->second.series.end() && series->second.callback) {
+            family->second.series.erase(series);
+        }
+        if (family->second.series.empty()) {
+            families_.erase(family);
+        }
+    }
+
+    // Prometheus text exposition format 0.0.4
+    std::string render() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string out;
+        out.reserve(families_.size() * 256);
+        for (const auto& entry : families_) {
+            const std::string& name = entry.first;
+            const Family& family = entry.second;
+            out += "# HELP " + name + " " + detail::escape(family.help, false) + "\n";
+            out += "# TYPE " + name + " " + typeName(family.type) + "\n";
+            for (const auto& item : family.series) {
+                renderSeries(out, name, item.first, item.second);
+            }
+        }
+        return out;
+    }
+
+private:
+    struct Series {
+        Labels labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> callback;
+    };
+
+    struct Family {
+        std::string help;
+        Type type;
+        std::map<std::string, Series> series;  // Keyed by rendered labels
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+
+    Series& seriesLocked(const std::string& name, const std::string& help, Type type, const Labels& labels) {
+        auto family = families_.find(name);
+        if (family == families_.end()) {
+            family = families_.emplace(name, Family{help, type, {}}).first;
+        }
+        Series& series = family->second.series[detail::formatLabels(labels)];
+        series.labels = labels;
+        return series;
+    }
+
+    static const char* typeName(Type type) {
+        switch (type) {
+            case Type::Counter: return "counter";
+            case Type::Gauge: return "gauge";
+            case Type::Histogram: return "histogram";
+        }
+        return "untyped";
+    }
+
+    static void renderSeries(std::string& out, const std::string& name, const std::string& labels,
+                             const Series& series) {
+        if (series.callback) {
+            out += name + labels + " " + detail::formatValue(series.callback()) + "\n";
+        } else if (series.counter) {
+            out += name + labels + " " + std::to_string(series.counter->value()) + "\n";
+        } else if (series.gauge) {
+            out += name + labels + " " + detail::formatValue(series.gauge->value()) + "\n";
+        } else if (series.histogram) {
+            const Histogram& histogram = *series.histogram;
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < histogram.bounds().size(); ++i) {
+                cumulative += histogram.bucketCount(i);
+                out += name + "_bucket" +
+                       detail::formatLabels(series.labels, "le", detail::formatValue(histogram.bounds()[i])) +
+                       " " + std::to_string(cumulative) + "\n";
+            }
+            cumulative += histogram.bucketCount(histogram.bounds().size());
+            out += name + "_bucket" + detail::formatLabels(series.labels, "le", "+Inf") + " " +
+                   std::to_string(cumulative) + "\n";
+            out += name + "_sum" + labels + " " + detail::formatValue(histogram.sum()) + "\n";
+            out += name + "_count" + labels + " " + std::to_string(cumulative) + "\n";
+        }
+    }
+};
+
+} // namespace UrMetrics
+
+#endif // UR_METRICS_HPP
@@ -0,0 +1,98 @@
+/*
+ * Request and response JSON encode/decode throughput, on a request shaped
+ * like the backend's (method, service, a small params object).
+ * Usage: bench_codec [scale]
+ */
+
+#include "ur-rpc-template.h"
+#include "logger.h"
+#include "bench_common.h"
+#include <string.h>
+
+static ur_rpc_request_t* make_request(void) {
+    ur_rpc_request_t* request = ur_rpc_request_create();
+    cJSON* params = cJSON_CreateObject();
+    cJSON_AddStringToObject(params, "interface", "wlan0");
+    cJSON_AddNumberToObject(params, "priority", 3);
+    cJSON_AddBoolToObject(params, "persistent", 1);
+    ur_rpc_request_set_method(request, "set_priority", "network-priority");
+    ur_rpc_request_set_authority(request, UR_RPC_AUTHORITY_ADMIN);
+    ur_rpc_request_set_params(request, params);
+    ur_rpc_request_set_timeout(request, 5000);
+    cJSON_Delete(params);
+    return request;
+}
+
+static ur_rpc_response_t* make_response(void) {
+    ur_rpc_response_t* response = ur_rpc_response_create();
+    response->transaction_id = strdup("bench-0000000000000001");
+    response->success = true;
+    response->result = cJSON_CreateObject();
+    cJSON_AddStringToObject(response->result, "status", "applied");
+    cJSON_AddNumberToObject(response->result, "metric", 200);
+    response->timestamp = ur_rpc_get_timestamp_ms();
+    response->processing_time_ms = 2;
+    return response;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long iterations = 200000 * bench_scale(argc, argv);
+    char buffer[1024];
+    size_t length = 0;
+
+    ur_rpc_init();
+    logger_set_level(LOG_ERROR);
+
+    ur_rpc_request_t* request = make_request();
+    ur_rpc_response_t* response = make_response();
+    char* request_json = ur_rpc_request_to_json(request);
+    char* response_json = ur_rpc_response_to_json(response);
+    if (!request_json || !response_json) {
+        fprintf(stderr, "encoding failed\n");
+        return 1;
+    }
+
+    uint64_t start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        ur_rpc_free_string(ur_rpc_request_to_json(request));
+    }
+    bench_report("request_to_json", iterations, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        ur_rpc_request_write_json(request, buffer, sizeof(buffer), &length);
+    }
+    bench_report("request_write_json", iterations, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        ur_rpc_request_destroy(ur_rpc_request_from_json(request_json));
+    }
+    bench_report("request_from_json", iterations, bench_now_ns() - start);
+
+    size_t request_len = strlen(request_json);
+    start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        ur_rpc_request_destroy(ur_rpc_request_from_payload(request_json, request_len));
+    }
+    bench_report("request_from_payload", iterations, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        ur_rpc_free_string(ur_rpc_response_to_json(response));
+    }
+    bench_report("response_to_json", iterations, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        ur_rpc_response_destroy(ur_rpc_response_from_json(response_json));
+    }
+    bench_report("response_from_json", iterations, bench_now_ns() - start);
+
+    ur_rpc_free_string(request_json);
+    ur_rpc_free_string(response_json);
+    ur_rpc_request_destroy(request);
+    ur_rpc_response_destroy(response);
+    ur_rpc_cleanup();
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Timing and reporting shared by the ur-rpc-template microbenchmarks.
+ *
+ * Every result is one JSON object on its own line of stdout, so runs can
+ * be collected and compared by a script:
+ *   {"suite": "ur-rpc-template", "name": ..., "iterations": n,
+ *    "ns_per_op": x, "ops_per_sec": y}
+ * Latency results add "p50_us", "p99_us" and "max_us"; a benchmark that
+ * cannot run (no broker) reports "skipped" with the reason. Past the two
+ * lines ur_rpc_init() logs, the library's output is limited to errors,
+ * which go to stderr; a script keeps the stdout lines starting with '{'.
+ */
+
+#ifndef UR_RPC_BENCH_COMMON_H
+#define UR_RPC_BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Iteration scale from argv[1], 1 if absent */
+static inline unsigned long bench_scale(int argc, char* argv[]) {
+    unsigned long scale = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+    return scale ? scale : 1;
+}
+
+static inline void bench_report(const char* name, unsigned long iterations, uint64_t elapsed_ns) {
+    double ns_per_op = iterations ? (double)elapsed_ns / (double)iterations : 0.0;
+    printf("{\"suite\": \"ur-rpc-template\", \"name\": \"%s\", \"iterations\": %lu, "
+           "\"ns_per_op\": %.1f, \"ops_per_sec\": %.1f}\n",
+           name, iterations, ns_per_op, ns_per_op > 0.0 ? 1e9 / ns_per_op : 0.0);
+    fflush(stdout);
+}
+
+static inline int bench_compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/* samples (nanoseconds) are sorted in place */
+static inline void bench_report_latency(const char* name, uint64_t* samples, unsigned long count) {
+    if (count == 0) return;
+    qsort(samples, count, sizeof(uint64_t), bench_compare_u64);
+    uint64_t total = 0;
+    for (unsigned long i = 0; i < count; i++) total += samples[i];
+    double mean = (double)total / (double)count;
+    printf("{\"suite\": \"ur-rpc-template\", \"name\": \"%s\", \"iterations\": %lu, "
+           "\"ns_per_op\": %.1f, \"ops_per_sec\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f}\n",
+           name, count, mean, mean > 0.0 ? 1e9 / mean : 0.0,
+           samples[count / 2] / 1000.0, samples[count * 99 / 100] / 1000.0, samples[count - 1] / 1000.0);
+    fflush(stdout);
+}
+
+static inline void bench_report_skipped(const char* name, const char* reason) {
+    printf("{\"suite\": \"ur-rpc-template\", \"name\": \"%s\", \"skipped\": \"%s\"}\n", name, reason);
+    fflush(stdout);
+}
+
+#endif /* UR_RPC_BENCH_COMMON_H */
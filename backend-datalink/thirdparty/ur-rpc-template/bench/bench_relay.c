@@ -0,0 +1,82 @@
+/*
+ * Relay rule matching: the topic lookup the relay does for every message
+ * it receives, at 10, 100 and UR_RPC_MAX_RELAY_RULES (256) rules. A third
+ * of the rules are exact topics, a third use '+' and a third '#'; the
+ * topics looked up hit one rule, several, or none.
+ * Usage: bench_relay [scale]
+ */
+
+#include "ur-rpc-template.h"
+#include "logger.h"
+#include "bench_common.h"
+#include <string.h>
+
+static const char* const kTopics[] = {
+    "fleet/node7/telemetry",
+    "fleet/node42/status",
+    "logs/3/backend/error",
+    "camera/front/frame",       // No rule
+    "fleet/node7/status",
+    "$SYS/broker/uptime"        // No rule: wildcards skip '$' topics
+};
+#define TOPIC_COUNT (sizeof(kTopics) / sizeof(kTopics[0]))
+
+// rule_count includes the two rules every count has
+static void bench_rules(int rule_count, unsigned long iterations) {
+    ur_rpc_client_config_t* config = ur_rpc_config_create();
+    config->relay.enabled = true;
+    ur_rpc_relay_config_add_broker(&config->relay, "127.0.0.1", 1883, "bench-relay", true);
+
+    char source[64];
+    char dest[64];
+    for (int i = 0; i < rule_count - 2; i++) {
+        switch (i % 3) {
+            case 0: snprintf(source, sizeof(source), "fleet/node%d/telemetry", i); break;
+            case 1: snprintf(source, sizeof(source), "fleet/+/status%d", i); break;
+            default: snprintf(source, sizeof(source), "logs/%d/#", i); break;
+        }
+        snprintf(dest, sizeof(dest), "relayed/%d", i);
+        ur_rpc_relay_config_add_rule(&config->relay, source, dest, NULL, 0, 0, false);
+    }
+    // Rules every lookup of its topic reaches whatever the count
+    ur_rpc_relay_config_add_rule(&config->relay, "fleet/+/status", "relayed/status", NULL, 0, 0, false);
+    ur_rpc_relay_config_add_rule(&config->relay, "logs/#", "relayed/logs", NULL, 0, 0, false);
+
+    ur_rpc_relay_client_t* relay = ur_rpc_relay_client_create(config);
+    ur_rpc_config_destroy(config);
+    if (!relay) {
+        fprintf(stderr, "relay client with %d rules could not be created\n", rule_count);
+        return;
+    }
+
+    int matches[UR_RPC_MAX_RELAY_RULES];
+    unsigned long matched = 0;
+    uint64_t start = bench_now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        matched += (unsigned long)ur_rpc_relay_client_match(relay, kTopics[i % TOPIC_COUNT], matches);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char name[64];
+    snprintf(name, sizeof(name), "relay_match_%d_rules", rule_count);
+    bench_report(name, iterations, elapsed);
+    if (matched == 0) {
+        fprintf(stderr, "%s matched nothing\n", name);
+    }
+
+    ur_rpc_relay_client_destroy(relay);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long iterations = 1000000 * bench_scale(argc, argv);
+
+    ur_rpc_init();
+    logger_set_level(LOG_ERROR);
+
+    bench_rules(10, iterations);
+    bench_rules(100, iterations);
+    bench_rules(UR_RPC_MAX_RELAY_RULES, iterations);
+
+    ur_rpc_cleanup();
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * Publish/subscribe through a running broker: the round trip of a QoS 0
+ * message to a topic the client subscribes to itself (p50/p99/max), and
+ * the rate a burst of QoS 0 messages comes back at. Without a broker at
+ * the address both report "skipped".
+ * Usage: bench_roundtrip [scale] [host] [port], default 127.0.0.1 1883
+ */
+
+#include "ur-rpc-template.h"
+#include "logger.h"
+#include "bench_common.h"
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ROUNDTRIP_TOPIC "bench/ur-rpc-template/roundtrip"
+#define BURST_TOPIC "bench/ur-rpc-template/burst"
+#define REPLY_TIMEOUT_MS 1000
+#define BURST_TIMEOUT_MS 10000
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned long last_seq;       // Sequence number of the last round trip back
+    unsigned long burst_received;
+} bench_state_t;
+
+static bench_state_t g_state = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0};
+
+// Runs on the MQTT loop thread
+static void on_message(const char* topic, const char* payload, size_t payload_len, void* user_data) {
+    (void)user_data;
+    pthread_mutex_lock(&g_state.mutex);
+    if (strcmp(topic, ROUNDTRIP_TOPIC) == 0) {
+        char text[32];
+        size_t len = payload_len < sizeof(text) - 1 ? payload_len : sizeof(text) - 1;
+        memcpy(text, payload, len);
+        text[len] = '\0';
+        g_state.last_seq = strtoul(text, NULL, 10);
+    } else if (strcmp(topic, BURST_TOPIC) == 0) {
+        g_state.burst_received++;
+    }
+    pthread_cond_broadcast(&g_state.cond);
+    pthread_mutex_unlock(&g_state.mutex);
+}
+
+static struct timespec deadline_after_ms(int timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void bench_roundtrip(ur_rpc_client_t* client, unsigned long iterations) {
+    uint64_t* samples = malloc(iterations * sizeof(uint64_t));
+    if (!samples) return;
+
+    unsigned long count = 0;
+    char payload[32];
+    for (unsigned long seq = 1; seq <= iterations; seq++) {
+        int len = snprintf(payload, sizeof(payload), "%lu", seq);
+        uint64_t start = bench_now_ns();
+        if (ur_rpc_publish_message_qos(client, ROUNDTRIP_TOPIC, payload, (size_t)len, 0) != UR_RPC_SUCCESS) {
+            continue;
+        }
+
+        struct timespec deadline = deadline_after_ms(REPLY_TIMEOUT_MS);
+        int rc = 0;
+        pthread_mutex_lock(&g_state.mutex);
+        while (g_state.last_seq != seq && rc == 0) {
+            rc = pthread_cond_timedwait(&g_state.cond, &g_state.mutex, &deadline);
+        }
+        bool received = g_state.last_seq == seq;
+        pthread_mutex_unlock(&g_state.mutex);
+        if (received) {
+            samples[count++] = bench_now_ns() - start;
+        }
+    }
+
+    if (count < iterations) {
+        fprintf(stderr, "roundtrip: %lu of %lu messages lost or late\n", iterations - count, iterations);
+    }
+    bench_report_latency("publish_roundtrip_qos0", samples, count);
+    free(samples);
+}
+
+static void bench_burst(ur_rpc_client_t* client, unsigned long messages) {
+    static const char payload[] = "{\"jsonrpc\":\"2.0\",\"method\":\"bench\",\"params\":{\"seq\":0}}";
+
+    pthread_mutex_lock(&g_state.mutex);
+    g_state.burst_received = 0;
+    pthread_mutex_unlock(&g_state.mutex);
+
+    uint64_t start = bench_now_ns();
+    for (unsigned long i = 0; i < messages; i++) {
+        ur_rpc_publish_message_qos(client, BURST_TOPIC, payload, sizeof(payload) - 1, 0);
+    }
+
+    // QoS 0 may drop some under load; the rate counts what came back
+    struct timespec deadline = deadline_after_ms(BURST_TIMEOUT_MS);
+    int rc = 0;
+    pthread_mutex_lock(&g_state.mutex);
+    while (g_state.burst_received < messages && rc == 0) {
+        rc = pthread_cond_timedwait(&g_state.cond, &g_state.mutex, &deadline);
+    }
+    unsigned long received = g_state.burst_received;
+    pthread_mutex_unlock(&g_state.mutex);
+    uint64_t elapsed = bench_now_ns() - start;
+
+    if (received < messages) {
+        fprintf(stderr, "burst: %lu of %lu messages came back\n", received, messages);
+    }
+    bench_report("publish_burst_qos0", received, elapsed);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long scale = bench_scale(argc, argv);
+    const char* host = argc > 2 ? argv[2] : "127.0.0.1";
+    int port = argc > 3 ? atoi(argv[3]) : 1883;
+
+    ur_rpc_init();
+    logger_set_level(LOG_ERROR);
+
+    ur_rpc_client_config_t* config = ur_rpc_config_create();
+    ur_rpc_topic_config_t* topic_config = ur_rpc_topic_config_create();
+    char client_id[64];
+    snprintf(client_id, sizeof(client_id), "bench-roundtrip-%d", (int)getpid());
+    ur_rpc_config_set_broker(config, host, port);
+    ur_rpc_config_set_client_id(config, client_id);
+
+    ur_rpc_client_t* client = ur_rpc_client_create(config, topic_config);
+    ur_rpc_config_destroy(config);
+    ur_rpc_topic_config_destroy(topic_config);
+    if (!client) {
+        bench_report_skipped("publish_roundtrip_qos0", "client could not be created");
+        bench_report_skipped("publish_burst_qos0", "client could not be created");
+        ur_rpc_cleanup();
+        return 0;
+    }
+    ur_rpc_client_set_message_handler(client, on_message, NULL);
+
+    bool connected = false;
+    if (ur_rpc_client_connect(client) == UR_RPC_SUCCESS && ur_rpc_client_start(client) == UR_RPC_SUCCESS) {
+        for (int i = 0; i < 30 && !(connected = ur_rpc_client_is_connected(client)); i++) {
+            usleep(100000);
+        }
+    }
+    if (!connected) {
+        bench_report_skipped("publish_roundtrip_qos0", "no broker reachable");
+        bench_report_skipped("publish_burst_qos0", "no broker reachable");
+        ur_rpc_client_destroy(client);
+        ur_rpc_cleanup();
+        return 0;
+    }
+
+    ur_rpc_subscribe_topic(client, ROUNDTRIP_TOPIC);
+    ur_rpc_subscribe_topic(client, BURST_TOPIC);
+    usleep(200000);     // SUBACK before the first publish
+
+    bench_roundtrip(client, 1000 * scale);
+    bench_burst(client, 20000 * scale);
+
+    ur_rpc_client_stop(client);
+    ur_rpc_client_disconnect(client);
+    ur_rpc_client_destroy(client);
+    ur_rpc_cleanup();
+    return 0;
+}
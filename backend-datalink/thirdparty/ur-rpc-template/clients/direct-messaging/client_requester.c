@@ -60,8 +60,7 @@ void* request_thread(void* arg) {
         snprintf(transaction_id, sizeof(transaction_id), "req_%d_%ld", g_request_counter, time(NULL));
         
         ur_rpc_request_set_method(request, method_name, "data_service");
-        if (request->transaction_id) free(request->transaction_id);
-        request->transaction_id = strdup(transaction_id);
+        ur_rpc_request_set_transaction_id(request, transaction_id);
         ur_rpc_request_set_timeout(request, 10000); // 10 seconds
         
         // Add some parameters
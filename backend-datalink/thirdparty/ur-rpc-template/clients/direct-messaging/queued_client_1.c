@@ -7,6 +7,7 @@
 #include <pthread.h>
 #include <stdatomic.h>
 #include "../../ur-rpc-template/ur-rpc-template.h"
+#include "../../ur-rpc-template/extensions/offline_queue.h"
 
 static atomic_bool g_running = true;
 static ur_rpc_client_t* g_client = NULL;
@@ -14,6 +15,7 @@ static int g_current_request = 0;
 static atomic_bool g_waiting_for_response = false;
 static atomic_bool g_response_received = false;
 static atomic_bool g_last_response_success = false;
+static ur_rpc_offline_queue_t* g_offline_queue = NULL;
 
 void signal_handler(int sig) {
     printf("\nReceived signal %d, shutting down gracefully...\n", sig);
@@ -51,10 +53,84 @@ void response_handler(const ur_rpc_response_t* response, void* user_data) {
     atomic_store(&g_waiting_for_response, false);
 }
 
+// Opens the store-and-forward queue from the "offline_queue" section of the
+// config file; requests made while the broker is unreachable are kept there
+static ur_rpc_offline_queue_t* open_offline_queue(const char* config_file) {
+    FILE* file = fopen(config_file, "r");
+    if (!file) return NULL;
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = size > 0 ? malloc((size_t)size + 1) : NULL;
+    if (!text) {
+        fclose(file);
+        return NULL;
+    }
+    size_t read = fread(text, 1, (size_t)size, file);
+    text[read] = '\0';
+    fclose(file);
+    
+    cJSON* root = cJSON_Parse(text);
+    free(text);
+    cJSON* section = root ? cJSON_GetObjectItem(root, "offline_queue") : NULL;
+    cJSON* directory = section ? cJSON_GetObjectItem(section, "directory") : NULL;
+    if (!cJSON_IsString(directory)) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    
+    ur_rpc_offline_queue_config_t queue_config = { .directory = directory->valuestring };
+    cJSON* item = cJSON_GetObjectItem(section, "segment_size");
+    if (cJSON_IsNumber(item) && item->valuedouble > 0) queue_config.segment_size = (size_t)item->valuedouble;
+    item = cJSON_GetObjectItem(section, "max_bytes");
+    if (cJSON_IsNumber(item) && item->valuedouble > 0) queue_config.max_bytes = (size_t)item->valuedouble;
+    item = cJSON_GetObjectItem(section, "drain_rate");
+    if (cJSON_IsNumber(item) && item->valueint > 0) queue_config.drain_rate = item->valueint;
+    
+    ur_rpc_offline_queue_t* queue = ur_rpc_offline_queue_open(&queue_config);
+    cJSON_Delete(root);
+    return queue;
+}
+
+// Stores a request for delivery after reconnecting; nobody waits for its response
+static void queue_request_offline(const ur_rpc_request_t* request) {
+    char* topic = ur_rpc_generate_request_topic(g_client, request->method, request->service, request->transaction_id);
+    char* payload = ur_rpc_request_to_json(request);
+    
+    if (topic && payload &&
+        ur_rpc_offline_queue_push(g_offline_queue, topic, payload, strlen(payload), -1) == UR_RPC_SUCCESS) {
+        printf("💾 [Queued Client 1] Broker unreachable, request %d stored offline (%zu pending)\n",
+               g_current_request, ur_rpc_offline_queue_pending(g_offline_queue));
+    } else {
+        printf("❌ [Queued Client 1] Failed to store request %d offline\n", g_current_request);
+    }
+    free(topic);
+    free(payload);
+}
+
 void* queued_messaging_thread(void* arg) {
     printf("🚀 [Queued Client 1] Starting sequential request processing...\n");
     
-    while (atomic_load(&g_running) && ur_rpc_client_is_connected(g_client)) {
+    while (atomic_load(&g_running)) {
+        bool connected = ur_rpc_client_is_connected(g_client);
+        if (!connected && !g_offline_queue) {
+            break;
+        }
+        
+        // Forward whatever was stored while offline before anything new
+        if (connected && g_offline_queue && ur_rpc_offline_queue_pending(g_offline_queue) > 0) {
+            int forwarded = ur_rpc_offline_queue_drain(g_offline_queue, g_client, 0);
+            if (forwarded > 0) {
+                printf("📨 [Queued Client 1] Forwarded %d stored request(s), %zu still pending\n",
+                       forwarded, ur_rpc_offline_queue_pending(g_offline_queue));
+            }
+            if (ur_rpc_offline_queue_pending(g_offline_queue) > 0) {
+                usleep(100000); // 100ms, let the drain rate refill
+                continue;
+            }
+        }
+        
         if (atomic_load(&g_waiting_for_response)) {
             // Wait for response before sending next request
             usleep(100000); // 100ms
@@ -78,8 +154,7 @@ void* queued_messaging_thread(void* arg) {
         snprintf(transaction_id, sizeof(transaction_id), "seq_%d_%ld", g_current_request, time(NULL));
         
         ur_rpc_request_set_method(request, method_name, "queued_service");
-        if (request->transaction_id) free(request->transaction_id);
-        request->transaction_id = strdup(transaction_id);
+        ur_rpc_request_set_transaction_id(request, transaction_id);
         ur_rpc_request_set_timeout(request, 15000); // 15 seconds
         
         // Add parameters with sequence information
@@ -90,6 +165,17 @@ void* queued_messaging_thread(void* arg) {
         cJSON_AddStringToObject(params, "client_id", "queued_client_1");
         ur_rpc_request_set_params(request, params);
         
+        if (!connected) {
+            queue_request_offline(request);
+            ur_rpc_request_destroy(request);
+            sleep(1);
+            if (g_current_request >= 10) {
+                printf("🏁 [Queued Client 1] Completed 10 sequential requests, stopping\n");
+                break;
+            }
+            continue;
+        }
+        
         printf("📤 [Queued Client 1] Sending sequential request %d (waiting for response before next)\n", 
                g_current_request);
         
@@ -238,6 +324,12 @@ int main(int argc, char* argv[]) {
     }
     
     printf("🔗 [Queued Client 1] Connected to MQTT broker\n");
+    
+    g_offline_queue = open_offline_queue(argv[1]);
+    if (g_offline_queue) {
+        printf("💾 [Queued Client 1] Offline queue enabled (%zu stored request(s) to forward)\n",
+               ur_rpc_offline_queue_pending(g_offline_queue));
+    }
     printf("🔢 [Queued Client 1] Starting queued direct messaging (sequential requests)...\n");
     
     // Start queued messaging thread
@@ -259,6 +351,7 @@ int main(int argc, char* argv[]) {
         pthread_join(messaging_thread_id, NULL);
     }
     
+    ur_rpc_offline_queue_close(g_offline_queue);
     ur_rpc_client_stop(g_client);
     ur_rpc_client_disconnect(g_client);
     ur_rpc_client_destroy(g_client);
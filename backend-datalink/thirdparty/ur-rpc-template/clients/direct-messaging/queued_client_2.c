@@ -7,16 +7,70 @@
 #include <pthread.h>
 #include <stdatomic.h>
 #include "../../ur-rpc-template/ur-rpc-template.h"
+#include "../../ur-rpc-template/extensions/offline_queue.h"
 
 static atomic_bool g_running = true;
 static ur_rpc_client_t* g_client = NULL;
 static int g_processed_requests = 0;
+static ur_rpc_offline_queue_t* g_offline_queue = NULL;
 
 void signal_handler(int sig) {
     printf("\nReceived signal %d, shutting down gracefully...\n", sig);
     atomic_store(&g_running, false);
 }
 
+// Opens the store-and-forward queue from the "offline_queue" section of the
+// config file; responses that can't reach the broker are kept there
+static ur_rpc_offline_queue_t* open_offline_queue(const char* config_file) {
+    FILE* file = fopen(config_file, "r");
+    if (!file) return NULL;
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = size > 0 ? malloc((size_t)size + 1) : NULL;
+    if (!text) {
+        fclose(file);
+        return NULL;
+    }
+    size_t read = fread(text, 1, (size_t)size, file);
+    text[read] = '\0';
+    fclose(file);
+    
+    cJSON* root = cJSON_Parse(text);
+    free(text);
+    cJSON* section = root ? cJSON_GetObjectItem(root, "offline_queue") : NULL;
+    cJSON* directory = section ? cJSON_GetObjectItem(section, "directory") : NULL;
+    if (!cJSON_IsString(directory)) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    
+    ur_rpc_offline_queue_config_t queue_config = { .directory = directory->valuestring };
+    cJSON* item = cJSON_GetObjectItem(section, "segment_size");
+    if (cJSON_IsNumber(item) && item->valuedouble > 0) queue_config.segment_size = (size_t)item->valuedouble;
+    item = cJSON_GetObjectItem(section, "max_bytes");
+    if (cJSON_IsNumber(item) && item->valuedouble > 0) queue_config.max_bytes = (size_t)item->valuedouble;
+    item = cJSON_GetObjectItem(section, "drain_rate");
+    if (cJSON_IsNumber(item) && item->valueint > 0) queue_config.drain_rate = item->valueint;
+    
+    ur_rpc_offline_queue_t* queue = ur_rpc_offline_queue_open(&queue_config);
+    cJSON_Delete(root);
+    return queue;
+}
+
+// Stores a response for delivery after reconnecting, so the requester still
+// gets it once the broker is back
+static bool queue_response_offline(const char* topic, const char* payload, int sequence_number) {
+    if (!g_offline_queue ||
+        ur_rpc_offline_queue_push(g_offline_queue, topic, payload, strlen(payload), -1) != UR_RPC_SUCCESS) {
+        return false;
+    }
+    printf("💾 [Queued Client 2] Broker unreachable, response for sequence %d stored offline (%zu pending)\n",
+           sequence_number, ur_rpc_offline_queue_pending(g_offline_queue));
+    return true;
+}
+
 void message_handler(const char* topic, const char* payload, size_t payload_len, void* user_data) {
     if (!topic || !payload) return;
     
@@ -108,11 +162,16 @@ void message_handler(const char* topic, const char* payload, size_t payload_len,
            sequence_number, 
            transaction_id && cJSON_IsString(transaction_id) ? cJSON_GetStringValue(transaction_id) : "unknown");
     
-    // Send response
+    // Send response, or keep it for later while the broker is unreachable
     char* response_str = cJSON_Print(response);
     if (response_str) {
-        int send_result = ur_rpc_publish_message(g_client, response_topic, response_str, strlen(response_str));
-        if (send_result != UR_RPC_SUCCESS) {
+        int send_result = UR_RPC_ERROR_NOT_CONNECTED;
+        if (ur_rpc_client_is_connected(g_client)) {
+            send_result = ur_rpc_publish_message(g_client, response_topic, response_str, strlen(response_str));
+        }
+        if (send_result != UR_RPC_SUCCESS && queue_response_offline(response_topic, response_str, sequence_number)) {
+            // Forwarded by the main loop after reconnecting
+        } else if (send_result != UR_RPC_SUCCESS) {
             printf("❌ [Queued Client 2] Failed to send response for sequence %d (error: %d)\n", 
                    sequence_number, send_result);
         } else {
@@ -227,8 +286,25 @@ int main(int argc, char* argv[]) {
     printf("🔗 [Queued Client 2] Connected to MQTT broker\n");
     printf("🔢 [Queued Client 2] Ready to process sequential requests in queue order...\n");
     
-    // Main loop - wait for sequential requests
+    g_offline_queue = open_offline_queue(argv[1]);
+    if (g_offline_queue) {
+        printf("💾 [Queued Client 2] Offline queue enabled (%zu stored response(s) to forward)\n",
+               ur_rpc_offline_queue_pending(g_offline_queue));
+    }
+    
+    // Main loop - wait for sequential requests, forwarding responses stored
+    // while the broker was unreachable
     while (atomic_load(&g_running)) {
+        if (g_offline_queue && ur_rpc_offline_queue_pending(g_offline_queue) > 0 &&
+            ur_rpc_client_is_connected(g_client)) {
+            int forwarded = ur_rpc_offline_queue_drain(g_offline_queue, g_client, 0);
+            if (forwarded > 0) {
+                printf("📨 [Queued Client 2] Forwarded %d stored response(s), %zu still pending\n",
+                       forwarded, ur_rpc_offline_queue_pending(g_offline_queue));
+            }
+            usleep(100000); // 100ms, let the drain rate refill
+            continue;
+        }
         sleep(1);
     }
     
@@ -241,6 +317,7 @@ int main(int argc, char* argv[]) {
     ur_rpc_client_destroy(g_client);
     ur_rpc_topic_config_destroy(topic_config);
     ur_rpc_config_destroy(config);
+    ur_rpc_offline_queue_close(g_offline_queue);
     ur_rpc_cleanup();
     
     printf("🔗 Queued Direct Messaging Client 2 session completed\n");
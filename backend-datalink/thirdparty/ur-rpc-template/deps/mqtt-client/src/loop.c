@@ -198,6 +198,8 @@ int mosquitto_loop_forever(struct mosquitto *mosq, int timeout, int max_packets)
 	int rc;
 	unsigned int reconnects = 0;
 	unsigned long reconnect_delay;
+	unsigned long reconnect_delay_ms = 0;
+	unsigned long base_ms, max_ms;
 #ifndef WIN32
 	struct timespec req, rem;
 #endif
@@ -245,23 +247,39 @@ int mosquitto_loop_forever(struct mosquitto *mosq, int timeout, int max_packets)
 			}else{
 				pthread_mutex_unlock(&mosq->state_mutex);
 
-				if(mosq->reconnect_delay > 0 && mosq->reconnect_exponential_backoff){
-					reconnect_delay = mosq->reconnect_delay*reconnects*reconnects;
+				if(mosq->reconnect_jitter && mosq->reconnect_delay > 0){
+					/* Decorrelated jitter: anywhere between the base delay
+					 * and three times the previous delay, up to the cap. */
+					base_ms = mosq->reconnect_delay*1000UL;
+					max_ms = mosq->reconnect_delay_max*1000UL;
+					if(reconnects == 0 || reconnect_delay_ms < base_ms){
+						reconnect_delay_ms = base_ms;
+					}
+					reconnect_delay_ms = base_ms + (unsigned long)rand() % (reconnect_delay_ms*3 - base_ms + 1);
+					if(reconnect_delay_ms > max_ms){
+						reconnect_delay_ms = max_ms;
+					}
+					reconnects++;
 				}else{
-					reconnect_delay = mosq->reconnect_delay;
-				}
+					if(mosq->reconnect_delay > 0 && mosq->reconnect_exponential_backoff){
+						reconnect_delay = mosq->reconnect_delay*reconnects*reconnects;
+					}else{
+						reconnect_delay = mosq->reconnect_delay;
+					}
 
-				if(reconnect_delay > mosq->reconnect_delay_max){
-					reconnect_delay = mosq->reconnect_delay_max;
-				}else{
-					reconnects++;
+					if(reconnect_delay > mosq->reconnect_delay_max){
+						reconnect_delay = mosq->reconnect_delay_max;
+					}else{
+						reconnects++;
+					}
+					reconnect_delay_ms = reconnect_delay*1000UL;
 				}
 
 #ifdef WIN32
-				Sleep(reconnect_delay*1000);
+				Sleep(reconnect_delay_ms);
 #else
-				req.tv_sec = reconnect_delay;
-				req.tv_nsec = 0;
+				req.tv_sec = reconnect_delay_ms/1000;
+				req.tv_nsec = (reconnect_delay_ms%1000)*1000000L;
 				while(nanosleep(&req, &rem) == -1 && errno == EINTR){
 					req = rem;
 				}
@@ -403,3 +403,16 @@ int mosquitto_max_inflight_messages_set(struct mosquitto *mosq, unsigned int max
 	return MOSQ_ERR_SUCCESS;
 }
 
+
+int mosquitto_out_queue_len(struct mosquitto *mosq)
+{
+	int len;
+
+	if(!mosq) return 0;
+
+	pthread_mutex_lock(&mosq->out_message_mutex);
+	len = mosq->out_queue_len;
+	pthread_mutex_unlock(&mosq->out_message_mutex);
+
+	return len;
+}
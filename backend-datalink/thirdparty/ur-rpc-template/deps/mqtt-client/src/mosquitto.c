@@ -184,6 +184,7 @@ int mosquitto_reinitialise(struct mosquitto *mosq, const char *id, bool clean_se
 	mosq->tls_insecure = false;
 	mosq->want_write = false;
 #endif
+	packet__pool_init(&mosq->packet_pool);
 #ifdef WITH_THREADING
 	pthread_mutex_init(&mosq->callback_mutex, NULL);
 	pthread_mutex_init(&mosq->log_callback_mutex, NULL);
@@ -204,8 +205,12 @@ int mosquitto_reinitialise(struct mosquitto *mosq, const char *id, bool clean_se
 void mosquitto__destroy(struct mosquitto *mosq)
 {
 	struct mosquitto__packet *packet;
+	bool initialised;
 	if(!mosq) return;
 
+	/* The packet pool, like the mutexes, exists once mosq->id is set */
+	initialised = (mosq->id != NULL);
+
 #ifdef WITH_THREADING
 	if(mosq->threaded == mosq_ts_self && !pthread_equal(mosq->thread_id, pthread_self())){
 		pthread_cancel(mosq->thread_id);
@@ -249,6 +254,10 @@ void mosquitto__destroy(struct mosquitto *mosq)
 	mosquitto__free(mosq->tls_ciphers);
 	mosquitto__free(mosq->tls_psk);
 	mosquitto__free(mosq->tls_psk_identity);
+	mosquitto__free(mosq->tls_out_batch);
+	if(mosq->tls_session){
+		SSL_SESSION_free(mosq->tls_session);
+	}
 #endif
 
 	mosquitto__free(mosq->address);
@@ -287,6 +296,9 @@ void mosquitto__destroy(struct mosquitto *mosq)
 	}
 
 	packet__cleanup(&mosq->in_packet);
+	if(initialised){
+		packet__pool_cleanup(&mosq->packet_pool);
+	}
 	if(mosq->sockpairR != INVALID_SOCKET){
 		COMPAT_CLOSE(mosq->sockpairR);
 		mosq->sockpairR = INVALID_SOCKET;
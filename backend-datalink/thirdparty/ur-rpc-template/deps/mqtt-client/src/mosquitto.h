@@ -1341,6 +1341,29 @@ libmosq_EXPORT void mosquitto_log_callback_set(struct mosquitto *mosq, void (*on
  */
 libmosq_EXPORT int mosquitto_reconnect_delay_set(struct mosquitto *mosq, unsigned int reconnect_delay, unsigned int reconnect_delay_max, bool reconnect_exponential_backoff);
 
+/*
+ * Function: mosquitto_reconnect_jitter_set
+ *
+ * Randomise the delay between reconnection attempts, so that many clients
+ * losing the same broker do not all come back at the same moment. With
+ * jitter enabled each delay is drawn at random between reconnect_delay and
+ * three times the previous delay, capped at reconnect_delay_max (see
+ * <mosquitto_reconnect_delay_set>), with millisecond resolution.
+ * reconnect_exponential_backoff is ignored while jitter is enabled.
+ *
+ * Parameters:
+ *  mosq -             a valid mosquitto instance.
+ *  reconnect_jitter - set to true to enable randomised delays.
+ *
+ * Returns:
+ *	MOSQ_ERR_SUCCESS - on success.
+ * 	MOSQ_ERR_INVAL -   if the input parameters were invalid.
+ *
+ * See Also:
+ *	<mosquitto_reconnect_delay_set>
+ */
+libmosq_EXPORT int mosquitto_reconnect_jitter_set(struct mosquitto *mosq, bool reconnect_jitter);
+
 /*
  * Function: mosquitto_max_inflight_messages_set
  *
@@ -1366,6 +1389,22 @@ libmosq_EXPORT int mosquitto_reconnect_delay_set(struct mosquitto *mosq, unsigne
  */
 libmosq_EXPORT int mosquitto_max_inflight_messages_set(struct mosquitto *mosq, unsigned int max_inflight_messages);
 
+/*
+ * Function: mosquitto_out_queue_len
+ *
+ * Get the number of outgoing QoS 1 and 2 messages that have not yet
+ * completed their delivery flow, whether in flight or still queued behind
+ * <mosquitto_max_inflight_messages_set>. These are the messages that are
+ * sent again after a reconnect. QoS 0 messages are not counted.
+ *
+ * Parameters:
+ *  mosq - a valid mosquitto instance.
+ *
+ * Returns:
+ *	The number of messages, or 0 if mosq is NULL.
+ */
+libmosq_EXPORT int mosquitto_out_queue_len(struct mosquitto *mosq);
+
 /*
  * Function: mosquitto_message_retry_set
  *
@@ -133,8 +133,25 @@ enum mosquitto__transport {
 	mosq_t_sctp = 3
 };
 
+/* Packet payload buffers are recycled per client through free lists, one
+ * per power of two size class from 2^MOSQ_PACKET_POOL_MIN_SHIFT bytes up.
+ * Payloads larger than the biggest class are plain allocations. At most
+ * MOSQ_PACKET_POOL_MAX_RETAINED bytes sit on the free lists at any time. */
+#define MOSQ_PACKET_POOL_MIN_SHIFT 6
+#define MOSQ_PACKET_POOL_CLASSES 11
+#define MOSQ_PACKET_POOL_MAX_RETAINED (256*1024)
+
+struct mosquitto__packet_pool{
+	void *free_list[MOSQ_PACKET_POOL_CLASSES];
+	uint32_t retained;
+#if defined(WITH_THREADING) && !defined(WITH_BROKER)
+	pthread_mutex_t mutex;
+#endif
+};
+
 struct mosquitto__packet{
 	uint8_t *payload;
+	struct mosquitto__packet_pool *pool; /* Owner of payload, NULL if it came from mosquitto__malloc */
 	struct mosquitto__packet *next;
 	uint32_t remaining_mult;
 	uint32_t remaining_length;
@@ -144,6 +161,7 @@ struct mosquitto__packet{
 	uint16_t mid;
 	uint8_t command;
 	int8_t remaining_count;
+	int8_t pool_class;
 };
 
 struct mosquitto_message_all{
@@ -175,6 +193,7 @@ struct mosquitto {
 	time_t next_msg_out;
 	time_t ping_t;
 	struct mosquitto__packet in_packet;
+	struct mosquitto__packet_pool packet_pool;
 	struct mosquitto__packet *current_out_packet;
 	struct mosquitto__packet *out_packet;
 	struct mosquitto_message *will;
@@ -193,6 +212,16 @@ struct mosquitto {
 	int tls_cert_reqs;
 	bool tls_insecure;
 	bool ssl_ctx_defaults;
+	/* Last session the broker issued, offered again on reconnect so the
+	 * handshake can be resumed rather than repeated in full */
+	SSL_SESSION *tls_session;
+	/* Queued packets copied into one SSL_write, see packet__write_queued().
+	 * An SSL_write that would block must be repeated with the same bytes:
+	 * tls_out_batch_len stays set until the batch is written, and
+	 * tls_out_retry marks a single packet written in place. */
+	uint8_t *tls_out_batch;
+	uint32_t tls_out_batch_len;
+	bool tls_out_retry;
 #endif
 	bool want_write;
 	bool want_connect;
@@ -269,6 +298,7 @@ struct mosquitto {
 	unsigned int reconnect_delay;
 	unsigned int reconnect_delay_max;
 	bool reconnect_exponential_backoff;
+	bool reconnect_jitter;
 	char threaded;
 	struct mosquitto__packet *out_packet_last;
 	int inflight_messages;
@@ -145,6 +145,8 @@ int net__socket_close(struct mosquitto *mosq)
 			SSL_free(mosq->ssl);
 			mosq->ssl = NULL;
 		}
+		mosq->tls_out_batch_len = 0;
+		mosq->tls_out_retry = false;
 		if(mosq->ssl_ctx){
 			SSL_CTX_free(mosq->ssl_ctx);
 			mosq->ssl_ctx = NULL;
@@ -437,6 +439,22 @@ int net__socket_connect_tls(struct mosquitto *mosq)
 
 
 #ifdef WITH_TLS
+/* Keeps the newest session (or TLS 1.3 ticket) the broker hands out so the
+ * next connection can resume it. Returning 1 keeps our reference. */
+static int net__tls_new_session(SSL *ssl, SSL_SESSION *session)
+{
+	struct mosquitto *mosq;
+
+	mosq = SSL_get_ex_data(ssl, tls_ex_index_mosq);
+	if(!mosq) return 0;
+
+	if(mosq->tls_session){
+		SSL_SESSION_free(mosq->tls_session);
+	}
+	mosq->tls_session = session;
+	return 1;
+}
+
 static int net__init_ssl_ctx(struct mosquitto *mosq)
 {
 	int ret;
@@ -488,6 +506,12 @@ static int net__init_ssl_ctx(struct mosquitto *mosq)
 		/* Disable compression */
 		SSL_CTX_set_options(mosq->ssl_ctx, SSL_OP_NO_COMPRESSION);
 
+		/* Cache sessions on the client only, and only through
+		 * net__tls_new_session(), as the context lives no longer than
+		 * the connection. */
+		SSL_CTX_set_session_cache_mode(mosq->ssl_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+		SSL_CTX_sess_set_new_cb(mosq->ssl_ctx, net__tls_new_session);
+
 #ifdef SSL_MODE_RELEASE_BUFFERS
 			/* Use even less memory per SSL connection. */
 			SSL_CTX_set_mode(mosq->ssl_ctx, SSL_MODE_RELEASE_BUFFERS);
@@ -608,6 +632,16 @@ int net__socket_connect_step3(struct mosquitto *mosq, const char *host, uint16_t
 		}
 
 		SSL_set_ex_data(mosq->ssl, tls_ex_index_mosq, mosq);
+		if(mosq->tls_session){
+			/* A session from a different context or host just gets
+			 * a full handshake */
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+			if(SSL_SESSION_is_resumable(mosq->tls_session))
+#endif
+			{
+				SSL_set_session(mosq->ssl, mosq->tls_session);
+			}
+		}
 		bio = BIO_new_socket(mosq->sock, BIO_NOCLOSE);
 		if(!bio){
 			COMPAT_CLOSE(mosq->sock);
@@ -749,6 +783,20 @@ ssize_t net__write(struct mosquitto *mosq, void *buf, size_t count)
 }
 
 
+#ifndef WIN32
+/* Plain sockets only; TLS connections go through net__write(). */
+ssize_t net__writev(struct mosquitto *mosq, const struct iovec *iov, int iovcnt)
+{
+	assert(mosq);
+#ifdef WITH_TLS
+	assert(!mosq->ssl);
+#endif
+
+	errno = 0;
+	return writev(mosq->sock, iov, iovcnt);
+}
+#endif
+
 int net__socket_nonblock(mosq_sock_t *sock)
 {
 #ifndef WIN32
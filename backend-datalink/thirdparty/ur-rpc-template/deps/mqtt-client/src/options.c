@@ -85,6 +85,16 @@ int mosquitto_reconnect_delay_set(struct mosquitto *mosq, unsigned int reconnect
 }
 
 
+int mosquitto_reconnect_jitter_set(struct mosquitto *mosq, bool reconnect_jitter)
+{
+	if(!mosq) return MOSQ_ERR_INVAL;
+
+	mosq->reconnect_jitter = reconnect_jitter;
+
+	return MOSQ_ERR_SUCCESS;
+}
+
+
 int mosquitto_tls_set(struct mosquitto *mosq, const char *cafile, const char *capath, const char *certfile, const char *keyfile, int (*pw_callback)(char *buf, int size, int rwflag, void *userdata))
 {
 #ifdef WITH_TLS
@@ -43,7 +43,89 @@ Contributors:
 #  define G_PUB_MSGS_SENT_INC(A)
 #endif
 
-int packet__alloc(struct mosquitto__packet *packet)
+void packet__pool_init(struct mosquitto__packet_pool *pool)
+{
+	memset(pool->free_list, 0, sizeof(pool->free_list));
+	pool->retained = 0;
+	pthread_mutex_init(&pool->mutex, NULL);
+}
+
+void packet__pool_cleanup(struct mosquitto__packet_pool *pool)
+{
+	void *buf;
+	int i;
+
+	for(i=0; i<MOSQ_PACKET_POOL_CLASSES; i++){
+		while(pool->free_list[i]){
+			buf = pool->free_list[i];
+			pool->free_list[i] = *(void **)buf;
+			mosquitto__free(buf);
+		}
+	}
+	pool->retained = 0;
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+/* Sets packet->payload to a buffer of at least size bytes, taken from the
+ * free list of its size class when one is waiting there. */
+int packet__payload_alloc(struct mosquitto *mosq, struct mosquitto__packet *packet, uint32_t size)
+{
+	struct mosquitto__packet_pool *pool = &mosq->packet_pool;
+	int8_t pool_class = 0;
+	void *buf;
+
+	while(pool_class < MOSQ_PACKET_POOL_CLASSES && ((uint32_t)1 << (pool_class + MOSQ_PACKET_POOL_MIN_SHIFT)) < size){
+		pool_class++;
+	}
+	if(pool_class == MOSQ_PACKET_POOL_CLASSES){
+		packet->payload = mosquitto__malloc(size);
+		packet->pool = NULL;
+		return packet->payload?MOSQ_ERR_SUCCESS:MOSQ_ERR_NOMEM;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	buf = pool->free_list[pool_class];
+	if(buf){
+		pool->free_list[pool_class] = *(void **)buf;
+		pool->retained -= (uint32_t)1 << (pool_class + MOSQ_PACKET_POOL_MIN_SHIFT);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if(!buf){
+		buf = mosquitto__malloc((size_t)1 << (pool_class + MOSQ_PACKET_POOL_MIN_SHIFT));
+		if(!buf) return MOSQ_ERR_NOMEM;
+	}
+	packet->payload = buf;
+	packet->pool = pool;
+	packet->pool_class = pool_class;
+	return MOSQ_ERR_SUCCESS;
+}
+
+/* Gives a pooled payload back to its client's free list, or to the
+ * allocator once the pool holds its cap. */
+static void packet__payload_free(struct mosquitto__packet *packet)
+{
+	struct mosquitto__packet_pool *pool = packet->pool;
+	uint32_t size;
+
+	if(!pool || !packet->payload){
+		mosquitto__free(packet->payload);
+		return;
+	}
+
+	size = (uint32_t)1 << (packet->pool_class + MOSQ_PACKET_POOL_MIN_SHIFT);
+	pthread_mutex_lock(&pool->mutex);
+	if(pool->retained + size <= MOSQ_PACKET_POOL_MAX_RETAINED){
+		*(void **)packet->payload = pool->free_list[packet->pool_class];
+		pool->free_list[packet->pool_class] = packet->payload;
+		pool->retained += size;
+		packet->payload = NULL;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	mosquitto__free(packet->payload);
+}
+
+int packet__alloc(struct mosquitto *mosq, struct mosquitto__packet *packet)
 {
 	uint8_t remaining_bytes[5], byte;
 	uint32_t remaining_length;
@@ -68,10 +150,11 @@ int packet__alloc(struct mosquitto__packet *packet)
 	packet->packet_length = packet->remaining_length + 1 + packet->remaining_count;
 #ifdef WITH_WEBSOCKETS
 	packet->payload = mosquitto__malloc(sizeof(uint8_t)*packet->packet_length + LWS_SEND_BUFFER_PRE_PADDING + LWS_SEND_BUFFER_POST_PADDING);
+	packet->pool = NULL;
+	if(!packet->payload) return MOSQ_ERR_NOMEM;
 #else
-	packet->payload = mosquitto__malloc(sizeof(uint8_t)*packet->packet_length);
+	if(packet__payload_alloc(mosq, packet, packet->packet_length)) return MOSQ_ERR_NOMEM;
 #endif
-	if(!packet->payload) return MOSQ_ERR_NOMEM;
 
 	packet->payload[0] = packet->command;
 	for(i=0; i<packet->remaining_count; i++){
@@ -91,8 +174,9 @@ void packet__cleanup(struct mosquitto__packet *packet)
 	packet->remaining_count = 0;
 	packet->remaining_mult = 1;
 	packet->remaining_length = 0;
-	mosquitto__free(packet->payload);
+	packet__payload_free(packet);
 	packet->payload = NULL;
+	packet->pool = NULL;
 	packet->to_process = 0;
 	packet->pos = 0;
 }
@@ -252,6 +336,131 @@ void packet__write_uint16(struct mosquitto__packet *packet, uint16_t word)
 }
 
 
+/* Outgoing packets are written several at a time. Over plain TCP the rest
+ * of the current packet and those queued behind it go out in one writev();
+ * with TLS, packets that fit in PACKET_WRITE_TLS_BATCH bytes are copied into
+ * one buffer so they share an SSL_write and a record. A DISCONNECT ends a
+ * batch, as the socket closes once it is sent. */
+#define PACKET_WRITE_MAX_IOV 64
+#define PACKET_WRITE_TLS_BATCH 16384
+
+/* Marks count bytes as written, starting at the current packet and running
+ * on into the queue. */
+static void packet__consume(struct mosquitto *mosq, struct mosquitto__packet *packet, size_t count)
+{
+	uint32_t n;
+
+	n = count < packet->to_process ? (uint32_t)count : packet->to_process;
+	packet->to_process -= n;
+	packet->pos += n;
+	count -= n;
+	if(count == 0) return;
+
+	pthread_mutex_lock(&mosq->out_packet_mutex);
+	for(packet = mosq->out_packet; packet && count > 0; packet = packet->next){
+		n = count < packet->to_process ? (uint32_t)count : packet->to_process;
+		packet->to_process -= n;
+		packet->pos += n;
+		count -= n;
+	}
+	pthread_mutex_unlock(&mosq->out_packet_mutex);
+}
+
+#ifdef WITH_TLS
+static ssize_t packet__write_tls(struct mosquitto *mosq, struct mosquitto__packet *packet)
+{
+	struct mosquitto__packet *next;
+	ssize_t write_length;
+	uint32_t len;
+
+	if(mosq->tls_out_retry){
+		write_length = net__write(mosq, &(packet->payload[packet->pos]), packet->to_process);
+		mosq->tls_out_retry = (write_length <= 0 && errno == EAGAIN);
+		if(write_length > 0) packet__consume(mosq, packet, (size_t)write_length);
+		return write_length;
+	}
+
+	if(mosq->tls_out_batch_len == 0 && packet->to_process < PACKET_WRITE_TLS_BATCH
+			&& (packet->command&0xF0) != DISCONNECT){
+
+		pthread_mutex_lock(&mosq->out_packet_mutex);
+		next = mosq->out_packet;
+		if(next && packet->to_process + next->to_process <= PACKET_WRITE_TLS_BATCH){
+			if(!mosq->tls_out_batch){
+				mosq->tls_out_batch = mosquitto__malloc(PACKET_WRITE_TLS_BATCH);
+			}
+			if(mosq->tls_out_batch){
+				memcpy(mosq->tls_out_batch, &(packet->payload[packet->pos]), packet->to_process);
+				len = packet->to_process;
+				for(; next; next = next->next){
+					if(len + next->to_process > PACKET_WRITE_TLS_BATCH) break;
+					memcpy(&(mosq->tls_out_batch[len]), &(next->payload[next->pos]), next->to_process);
+					len += next->to_process;
+					if((next->command&0xF0) == DISCONNECT) break;
+				}
+				mosq->tls_out_batch_len = len;
+			}
+		}
+		pthread_mutex_unlock(&mosq->out_packet_mutex);
+	}
+
+	if(mosq->tls_out_batch_len == 0){
+		write_length = net__write(mosq, &(packet->payload[packet->pos]), packet->to_process);
+		mosq->tls_out_retry = (write_length <= 0 && errno == EAGAIN);
+		if(write_length > 0) packet__consume(mosq, packet, (size_t)write_length);
+		return write_length;
+	}
+
+	write_length = net__write(mosq, mosq->tls_out_batch, mosq->tls_out_batch_len);
+	if(write_length > 0){
+		/* SSL_write only reports a batch once all of it is written */
+		mosq->tls_out_batch_len = 0;
+		packet__consume(mosq, packet, (size_t)write_length);
+	}
+	return write_length;
+}
+#endif
+
+/* Writes from the current packet onwards; returns as net__write(). */
+static ssize_t packet__write_queued(struct mosquitto *mosq, struct mosquitto__packet *packet)
+{
+#ifndef WIN32
+	struct iovec iov[PACKET_WRITE_MAX_IOV];
+	struct mosquitto__packet *next;
+	int iovcnt;
+#endif
+	ssize_t write_length;
+
+#ifdef WITH_TLS
+	if(mosq->ssl){
+		return packet__write_tls(mosq, packet);
+	}
+#endif
+
+#ifndef WIN32
+	iov[0].iov_base = &(packet->payload[packet->pos]);
+	iov[0].iov_len = packet->to_process;
+	iovcnt = 1;
+	if((packet->command&0xF0) != DISCONNECT){
+		pthread_mutex_lock(&mosq->out_packet_mutex);
+		for(next = mosq->out_packet; next && iovcnt < PACKET_WRITE_MAX_IOV; next = next->next){
+			iov[iovcnt].iov_base = &(next->payload[next->pos]);
+			iov[iovcnt].iov_len = next->to_process;
+			iovcnt++;
+			if((next->command&0xF0) == DISCONNECT) break;
+		}
+		pthread_mutex_unlock(&mosq->out_packet_mutex);
+	}
+	write_length = net__writev(mosq, iov, iovcnt);
+#else
+	write_length = net__write(mosq, &(packet->payload[packet->pos]), packet->to_process);
+#endif
+	if(write_length > 0){
+		packet__consume(mosq, packet, (size_t)write_length);
+	}
+	return write_length;
+}
+
 int packet__write(struct mosquitto *mosq)
 {
 	ssize_t write_length;
@@ -284,11 +493,9 @@ int packet__write(struct mosquitto *mosq)
 		packet = mosq->current_out_packet;
 
 		while(packet->to_process > 0){
-			write_length = net__write(mosq, &(packet->payload[packet->pos]), packet->to_process);
+			write_length = packet__write_queued(mosq, packet);
 			if(write_length > 0){
 				G_BYTES_SENT_INC(write_length);
-				packet->to_process -= write_length;
-				packet->pos += write_length;
 			}else{
 #ifdef WIN32
 				errno = WSAGetLastError();
@@ -481,8 +688,7 @@ int packet__read(struct mosquitto *mosq)
 		mosq->in_packet.remaining_count *= -1;
 
 		if(mosq->in_packet.remaining_length > 0){
-			mosq->in_packet.payload = mosquitto__malloc(mosq->in_packet.remaining_length*sizeof(uint8_t));
-			if(!mosq->in_packet.payload) return MOSQ_ERR_NOMEM;
+			if(packet__payload_alloc(mosq, &mosq->in_packet, mosq->in_packet.remaining_length)) return MOSQ_ERR_NOMEM;
 			mosq->in_packet.to_process = mosq->in_packet.remaining_length;
 		}
 	}
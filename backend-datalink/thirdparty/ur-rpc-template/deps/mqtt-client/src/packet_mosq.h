@@ -23,7 +23,10 @@ Contributors:
 struct mosquitto_db;
 #endif
 
-int packet__alloc(struct mosquitto__packet *packet);
+void packet__pool_init(struct mosquitto__packet_pool *pool);
+void packet__pool_cleanup(struct mosquitto__packet_pool *pool);
+int packet__payload_alloc(struct mosquitto *mosq, struct mosquitto__packet *packet, uint32_t size);
+int packet__alloc(struct mosquitto *mosq, struct mosquitto__packet *packet);
 void packet__cleanup(struct mosquitto__packet *packet);
 int packet__queue(struct mosquitto *mosq, struct mosquitto__packet *packet);
 
@@ -89,7 +89,7 @@ int send__connect(struct mosquitto *mosq, uint16_t keepalive, bool clean_session
 
 	packet->command = CONNECT;
 	packet->remaining_length = headerlen+payloadlen;
-	rc = packet__alloc(packet);
+	rc = packet__alloc(mosq, packet);
 	if(rc){
 		mosquitto__free(packet);
 		return rc;
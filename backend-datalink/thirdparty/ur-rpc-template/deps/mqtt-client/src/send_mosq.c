@@ -120,7 +120,7 @@ int send__command_with_mid(struct mosquitto *mosq, uint8_t command, uint16_t mid
 		packet->command |= 8;
 	}
 	packet->remaining_length = 2;
-	rc = packet__alloc(packet);
+	rc = packet__alloc(mosq, packet);
 	if(rc){
 		mosquitto__free(packet);
 		return rc;
@@ -145,7 +145,7 @@ int send__simple_command(struct mosquitto *mosq, uint8_t command)
 	packet->command = command;
 	packet->remaining_length = 0;
 
-	rc = packet__alloc(packet);
+	rc = packet__alloc(mosq, packet);
 	if(rc){
 		mosquitto__free(packet);
 		return rc;
@@ -145,7 +145,7 @@ int send__real_publish(struct mosquitto *mosq, uint16_t mid, const char *topic,
 	packet->mid = mid;
 	packet->command = PUBLISH | ((dup&0x1)<<3) | (qos<<1) | retain;
 	packet->remaining_length = packetlen;
-	rc = packet__alloc(packet);
+	rc = packet__alloc(mosq, packet);
 	if(rc){
 		mosquitto__free(packet);
 		return rc;
@@ -50,7 +50,7 @@ int send__subscribe(struct mosquitto *mosq, int *mid, const char *topic, uint8_t
 
 	packet->command = SUBSCRIBE | (1<<1);
 	packet->remaining_length = packetlen;
-	rc = packet__alloc(packet);
+	rc = packet__alloc(mosq, packet);
 	if(rc){
 		mosquitto__free(packet);
 		return rc;
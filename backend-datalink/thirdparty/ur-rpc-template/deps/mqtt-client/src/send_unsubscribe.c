@@ -49,7 +49,7 @@ int send__unsubscribe(struct mosquitto *mosq, int *mid, const char *topic)
 
 	packet->command = UNSUBSCRIBE | (1<<1);
 	packet->remaining_length = packetlen;
-	rc = packet__alloc(packet);
+	rc = packet__alloc(mosq, packet);
 	if(rc){
 		mosquitto__free(packet);
 		return rc;
@@ -1,4 +1,5 @@
 #include "logger.h"
+#include <sched.h>
 
 /* Global logger configuration */
 static logger_config_t g_logger = {
@@ -20,6 +21,46 @@ static const char* level_colors[] = {
     COLOR_DEBUG, COLOR_INFO, COLOR_WARN, COLOR_ERROR, COLOR_FATAL
 };
 
+/* Async mode. Callers format straight into a slot of a bounded ring; each
+ * slot carries a sequence number, so claiming one is a single CAS and
+ * publishing it a single store. The writer thread drains the ring in order
+ * under g_logger.mutex and flushes once per batch. */
+typedef struct {
+    size_t sequence;
+    log_level_t level;
+    time_t time;
+    unsigned long thread_id;
+    char message[LOGGER_ASYNC_MESSAGE_MAX];
+} log_slot_t;
+
+static struct {
+    log_slot_t *slots;
+    size_t mask;
+    size_t enqueue_pos;         /* Next slot producers claim */
+    size_t dequeue_pos;         /* Next slot the writer reads */
+    size_t drained_pos;         /* Everything below has been written */
+    int enabled;                /* Producers use the ring */
+    int active;                 /* Producers between check and publish */
+    unsigned long long dropped;
+    unsigned long long dropped_reported;
+    unsigned int flush_interval_ms;
+    int stopping;
+    int wake_pending;
+    pthread_t thread;
+    pthread_mutex_t control_mutex;  /* Serializes enable/disable */
+    pthread_mutex_t wake_mutex;
+    pthread_cond_t wake_cond;       /* Wakes the writer early */
+    pthread_cond_t drained_cond;    /* Signalled after every batch */
+} g_async = {
+    .control_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake_cond = PTHREAD_COND_INITIALIZER,
+    .drained_cond = PTHREAD_COND_INITIALIZER
+};
+
+static void logger_output(log_level_t level, const char *message, time_t when,
+                          unsigned long thread_id, int flush);
+
 int logger_init(log_level_t min_level, log_flags_t flags, const char *filename) {
     pthread_mutex_lock(&g_logger.mutex);
     
@@ -36,7 +77,7 @@ int logger_init(log_level_t min_level, log_flags_t flags, const char *filename)
     }
     
     /* Set configuration */
-    g_logger.min_level = min_level;
+    __atomic_store_n(&g_logger.min_level, min_level, __ATOMIC_RELAXED);
     g_logger.flags = flags;
     
     /* Initialize file logging if requested */
@@ -61,6 +102,9 @@ int logger_init(log_level_t min_level, log_flags_t flags, const char *filename)
 }
 
 void logger_destroy(void) {
+    /* Queued messages still go out to the file being closed */
+    logger_disable_async();
+
     pthread_mutex_lock(&g_logger.mutex);
     
     if (g_logger.initialized) {
@@ -82,7 +126,7 @@ void logger_destroy(void) {
 
 void logger_set_level(log_level_t level) {
     pthread_mutex_lock(&g_logger.mutex);
-    g_logger.min_level = level;
+    __atomic_store_n(&g_logger.min_level, level, __ATOMIC_RELAXED);
     pthread_mutex_unlock(&g_logger.mutex);
 }
 
@@ -93,6 +137,10 @@ log_level_t logger_get_level(void) {
     return level;
 }
 
+int logger_is_enabled(log_level_t level) {
+    return level >= __atomic_load_n(&g_logger.min_level, __ATOMIC_RELAXED);
+}
+
 void logger_set_flags(log_flags_t flags) {
     pthread_mutex_lock(&g_logger.mutex);
     g_logger.flags = flags;
@@ -120,29 +168,36 @@ const char* logger_level_color(log_level_t level) {
     return COLOR_RESET;
 }
 
-static void format_timestamp(char *buffer, size_t buffer_size) {
-    time_t raw_time;
-    struct tm *time_info;
+/* Caller holds g_logger.mutex, which also guards the cache: localtime_r
+ * (and the time zone lock it takes) runs once per second, not per line */
+static void format_timestamp(char *buffer, size_t buffer_size, time_t when) {
+    static time_t cached_when = (time_t)-1;
+    static char cached[32];
     
-    time(&raw_time);
-    time_info = localtime(&raw_time);
-    
-    strftime(buffer, buffer_size, "%Y-%m-%d %H:%M:%S", time_info);
+    if (when != cached_when) {
+        struct tm time_info;
+        localtime_r(&when, &time_info);
+        strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &time_info);
+        cached_when = when;
+    }
+    snprintf(buffer, buffer_size, "%s", cached);
 }
 
-static void logger_output(log_level_t level, const char *message) {
+/* Caller holds g_logger.mutex. The async writer passes the time and thread
+ * of the original call and flushes once per batch instead of per line. */
+static void logger_output(log_level_t level, const char *message, time_t when,
+                          unsigned long thread_id, int flush) {
     char timestamp[32] = {0};
     char thread_id_str[32] = {0};
     
     /* Format timestamp if requested */
     if (g_logger.flags & LOG_FLAG_TIMESTAMP) {
-        format_timestamp(timestamp, sizeof(timestamp));
+        format_timestamp(timestamp, sizeof(timestamp), when);
     }
     
     /* Format thread ID if requested */
     if (g_logger.flags & LOG_FLAG_THREAD_ID) {
-        snprintf(thread_id_str, sizeof(thread_id_str), "[%lu] ", 
-                (unsigned long)pthread_self());
+        snprintf(thread_id_str, sizeof(thread_id_str), "[%lu] ", thread_id);
     }
     
     /* Output to console */
@@ -168,7 +223,7 @@ static void logger_output(log_level_t level, const char *message) {
         }
         
         fprintf(output, "\n");
-        fflush(output);
+        if (flush) fflush(output);
     }
     
     /* Output to file */
@@ -183,13 +238,254 @@ static void logger_output(log_level_t level, const char *message) {
         
         fprintf(g_logger.file_handle, "[%5s] %s\n", 
                 logger_level_string(level), message);
-        fflush(g_logger.file_handle);
+        if (flush) fflush(g_logger.file_handle);
+    }
+}
+
+/* ---- Async mode ---- */
+
+/* Claims the next free slot, or returns NULL when the ring is full */
+static log_slot_t *async_claim(size_t *position) {
+    size_t pos = __atomic_load_n(&g_async.enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        log_slot_t *slot = &g_async.slots[pos & g_async.mask];
+        size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        long diff = (long)(sequence - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&g_async.enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *position = pos;
+                return slot;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&g_async.enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void async_wake_writer(void) {
+    pthread_mutex_lock(&g_async.wake_mutex);
+    g_async.wake_pending = 1;
+    pthread_cond_signal(&g_async.wake_cond);
+    pthread_mutex_unlock(&g_async.wake_mutex);
+}
+
+/* Formats one message into the ring. Returns 0 when async mode is off and
+ * the caller should write synchronously. */
+static int async_log(log_level_t level, const char *suffix_file, int suffix_line,
+                     const char *suffix_func, const char *format, va_list args) {
+    __atomic_add_fetch(&g_async.active, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&g_async.enabled, __ATOMIC_SEQ_CST)) {
+        __atomic_sub_fetch(&g_async.active, 1, __ATOMIC_SEQ_CST);
+        return 0;
+    }
+
+    size_t pos;
+    log_slot_t *slot = async_claim(&pos);
+    if (!slot) {
+        __atomic_add_fetch(&g_async.dropped, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&g_async.active, 1, __ATOMIC_SEQ_CST);
+        return 1;
+    }
+
+    slot->level = level;
+    slot->time = time(NULL);
+    slot->thread_id = (unsigned long)pthread_self();
+    int length = vsnprintf(slot->message, sizeof(slot->message), format, args);
+    if (suffix_file && length >= 0 && (size_t)length < sizeof(slot->message)) {
+        snprintf(slot->message + length, sizeof(slot->message) - (size_t)length,
+                 " (%s:%d in %s())", suffix_file, suffix_line, suffix_func);
+    }
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&g_async.active, 1, __ATOMIC_SEQ_CST);
+
+    /* The writer sleeps for the flush interval unless the ring is half full
+     * or something serious needs to reach the disk */
+    size_t backlog = pos - __atomic_load_n(&g_async.dequeue_pos, __ATOMIC_RELAXED);
+    if (level >= LOG_ERROR || backlog >= (g_async.mask + 1) / 2) {
+        async_wake_writer();
+    }
+    if (level == LOG_FATAL) {
+        logger_flush();
     }
+    return 1;
+}
+
+/* Writes every published slot in order */
+static void async_drain(void) {
+    pthread_mutex_lock(&g_logger.mutex);
+    if (!g_logger.initialized) {
+        g_logger.flags = LOG_FLAG_CONSOLE | LOG_FLAG_TIMESTAMP;
+    }
+
+    int wrote = 0;
+    size_t pos = g_async.dequeue_pos;
+    for (;;) {
+        log_slot_t *slot = &g_async.slots[pos & g_async.mask];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != pos + 1) break;
+
+        logger_output(slot->level, slot->message, slot->time, slot->thread_id, 0);
+        __atomic_store_n(&slot->sequence, pos + g_async.mask + 1, __ATOMIC_RELEASE);
+        pos++;
+        __atomic_store_n(&g_async.dequeue_pos, pos, __ATOMIC_RELAXED);
+        wrote = 1;
+    }
+
+    unsigned long long dropped = __atomic_load_n(&g_async.dropped, __ATOMIC_RELAXED);
+    if (dropped != g_async.dropped_reported) {
+        char message[96];
+        snprintf(message, sizeof(message), "Log ring full: %llu messages dropped",
+                 dropped - g_async.dropped_reported);
+        logger_output(LOG_WARN, message, time(NULL), (unsigned long)pthread_self(), 0);
+        g_async.dropped_reported = dropped;
+        wrote = 1;
+    }
+
+    if (wrote) {
+        if (g_logger.flags & LOG_FLAG_CONSOLE) {
+            fflush(stdout);
+            fflush(stderr);
+        }
+        if (g_logger.file_handle) fflush(g_logger.file_handle);
+    }
+    pthread_mutex_unlock(&g_logger.mutex);
+}
+
+static void *async_writer_main(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_async.wake_mutex);
+    for (;;) {
+        int stopping = g_async.stopping;
+        pthread_mutex_unlock(&g_async.wake_mutex);
+        async_drain();
+        pthread_mutex_lock(&g_async.wake_mutex);
+
+        g_async.drained_pos = g_async.dequeue_pos;
+        pthread_cond_broadcast(&g_async.drained_cond);
+        if (stopping) break;
+
+        if (!g_async.wake_pending && !g_async.stopping) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += g_async.flush_interval_ms / 1000;
+            deadline.tv_nsec += (long)(g_async.flush_interval_ms % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&g_async.wake_cond, &g_async.wake_mutex, &deadline);
+        }
+        g_async.wake_pending = 0;
+    }
+    pthread_mutex_unlock(&g_async.wake_mutex);
+
+    return NULL;
+}
+
+int logger_enable_async(size_t capacity, unsigned int flush_interval_ms) {
+    pthread_mutex_lock(&g_async.control_mutex);
+
+    if (__atomic_load_n(&g_async.enabled, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_unlock(&g_async.control_mutex);
+        return 0;
+    }
+
+    size_t slots = 2;
+    while (slots < capacity) slots <<= 1;
+    g_async.slots = malloc(slots * sizeof(log_slot_t));
+    if (!g_async.slots) {
+        pthread_mutex_unlock(&g_async.control_mutex);
+        return -1;
+    }
+    for (size_t i = 0; i < slots; i++) {
+        g_async.slots[i].sequence = i;
+    }
+    g_async.mask = slots - 1;
+    g_async.enqueue_pos = 0;
+    g_async.dequeue_pos = 0;
+    g_async.drained_pos = 0;
+    g_async.flush_interval_ms = flush_interval_ms ? flush_interval_ms : LOGGER_ASYNC_DEFAULT_FLUSH_MS;
+    g_async.stopping = 0;
+    g_async.wake_pending = 0;
+
+    if (pthread_create(&g_async.thread, NULL, async_writer_main, NULL) != 0) {
+        free(g_async.slots);
+        g_async.slots = NULL;
+        pthread_mutex_unlock(&g_async.control_mutex);
+        return -1;
+    }
+
+    __atomic_store_n(&g_async.enabled, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&g_async.control_mutex);
+    return 0;
+}
+
+void logger_disable_async(void) {
+    pthread_mutex_lock(&g_async.control_mutex);
+
+    if (!__atomic_load_n(&g_async.enabled, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_unlock(&g_async.control_mutex);
+        return;
+    }
+
+    /* New calls write synchronously; wait out the ones already formatting */
+    __atomic_store_n(&g_async.enabled, 0, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&g_async.active, __ATOMIC_SEQ_CST) != 0) {
+        sched_yield();
+    }
+
+    pthread_mutex_lock(&g_async.wake_mutex);
+    g_async.stopping = 1;
+    g_async.wake_pending = 1;
+    pthread_cond_signal(&g_async.wake_cond);
+    pthread_mutex_unlock(&g_async.wake_mutex);
+    pthread_join(g_async.thread, NULL);
+
+    free(g_async.slots);
+    g_async.slots = NULL;
+    pthread_mutex_unlock(&g_async.control_mutex);
+}
+
+void logger_flush(void) {
+    if (!__atomic_load_n(&g_async.enabled, __ATOMIC_SEQ_CST)) {
+        return;
+    }
+    if (pthread_equal(pthread_self(), g_async.thread)) {
+        return;
+    }
+
+    size_t target = __atomic_load_n(&g_async.enqueue_pos, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&g_async.wake_mutex);
+    g_async.wake_pending = 1;
+    pthread_cond_signal(&g_async.wake_cond);
+    while ((long)(g_async.drained_pos - target) < 0 && !g_async.stopping) {
+        pthread_cond_wait(&g_async.drained_cond, &g_async.wake_mutex);
+    }
+    pthread_mutex_unlock(&g_async.wake_mutex);
+}
+
+unsigned long long logger_get_dropped_count(void) {
+    return __atomic_load_n(&g_async.dropped, __ATOMIC_RELAXED);
 }
 
 void logger_log(log_level_t level, const char *file, int line, const char *func, const char *format, ...) {
     /* Check if we should log this level */
-    if (level < g_logger.min_level) {
+    if (!logger_is_enabled(level)) {
+        return;
+    }
+    
+    /* Add file/line/function information */
+    const char *basename = strrchr(file, '/');
+    basename = basename ? basename + 1 : file;
+    
+    va_list args;
+    va_start(args, format);
+    int queued = async_log(level, basename, line, func, format, args);
+    va_end(args);
+    if (queued) {
         return;
     }
     
@@ -202,28 +498,31 @@ void logger_log(log_level_t level, const char *file, int line, const char *func,
     
     char message[2048];
     char formatted_message[2560];
-    va_list args;
     
     /* Format the user message */
     va_start(args, format);
     vsnprintf(message, sizeof(message), format, args);
     va_end(args);
     
-    /* Add file/line/function information */
-    const char *basename = strrchr(file, '/');
-    basename = basename ? basename + 1 : file;
-    
     snprintf(formatted_message, sizeof(formatted_message), 
              "%s (%s:%d in %s())", message, basename, line, func);
     
-    logger_output(level, formatted_message);
+    logger_output(level, formatted_message, time(NULL), (unsigned long)pthread_self(), 1);
     
     pthread_mutex_unlock(&g_logger.mutex);
 }
 
 void logger_log_simple(log_level_t level, const char *format, ...) {
     /* Check if we should log this level */
-    if (level < g_logger.min_level) {
+    if (!logger_is_enabled(level)) {
+        return;
+    }
+    
+    va_list args;
+    va_start(args, format);
+    int queued = async_log(level, NULL, 0, NULL, format, args);
+    va_end(args);
+    if (queued) {
         return;
     }
     
@@ -235,14 +534,13 @@ void logger_log_simple(log_level_t level, const char *format, ...) {
     }
     
     char message[2048];
-    va_list args;
     
     /* Format the user message */
     va_start(args, format);
     vsnprintf(message, sizeof(message), format, args);
     va_end(args);
     
-    logger_output(level, message);
+    logger_output(level, message, time(NULL), (unsigned long)pthread_self(), 1);
     
     pthread_mutex_unlock(&g_logger.mutex);
 }
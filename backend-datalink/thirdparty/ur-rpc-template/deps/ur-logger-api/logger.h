@@ -8,6 +8,10 @@
 #include <stdarg.h>
 #include <pthread.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* Log levels */
 typedef enum {
     LOG_DEBUG = 0,
@@ -38,6 +42,10 @@ typedef struct {
     int initialized;            /* Initialization flag */
 } logger_config_t;
 
+/* Async mode: longer messages are truncated, 0 flush interval picks the default */
+#define LOGGER_ASYNC_MESSAGE_MAX 1024
+#define LOGGER_ASYNC_DEFAULT_FLUSH_MS 200
+
 /* Color codes for console output */
 #define COLOR_RESET   "\033[0m"
 #define COLOR_DEBUG   "\033[36m"    /* Cyan */
@@ -74,6 +82,43 @@ void logger_set_level(log_level_t level);
  */
 log_level_t logger_get_level(void);
 
+/**
+ * Check whether a level would be logged, without locking. Lets callers skip
+ * building expensive log arguments.
+ * @param level Log level
+ * @return Non-zero if messages at this level are logged
+ */
+int logger_is_enabled(log_level_t level);
+
+/**
+ * Switch to asynchronous output. Callers format into a lock-free ring and
+ * return; a writer thread writes the queued messages in batches every
+ * flush_interval_ms, or sooner when the ring is half full or an ERROR or
+ * FATAL message arrives. FATAL calls wait until the ring is written out.
+ * Messages that find the ring full are dropped, counted, and reported.
+ * @param capacity Ring size in messages, rounded up to a power of two
+ * @param flush_interval_ms Longest time a message waits to be written
+ * @return 0 on success, -1 on error
+ */
+int logger_enable_async(size_t capacity, unsigned int flush_interval_ms);
+
+/**
+ * Write out the ring, stop the writer thread and return to synchronous
+ * output. Also done by logger_destroy.
+ */
+void logger_disable_async(void);
+
+/**
+ * Wait until every message queued so far has been written (async mode)
+ */
+void logger_flush(void);
+
+/**
+ * Number of messages dropped because the async ring was full
+ * @return Dropped message count
+ */
+unsigned long long logger_get_dropped_count(void);
+
 /**
  * Set logger flags
  * @param flags New configuration flags
@@ -98,14 +143,15 @@ log_flags_t logger_get_flags(void);
 void logger_log(log_level_t level, const char *file, int line, const char *func, const char *format, ...);
 
 /* Convenience macros for logging */
-#define LOG_DEBUG_MSG(format, ...) logger_log(LOG_DEBUG, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__)
+#define LOG_DEBUG_MSG(format, ...) do { if (logger_is_enabled(LOG_DEBUG)) logger_log(LOG_DEBUG, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__); } while (0)
 #define LOG_INFO_MSG(format, ...)  logger_log(LOG_INFO,  __FILE__, __LINE__, __func__, format, ##__VA_ARGS__)
 #define LOG_WARN_MSG(format, ...)  logger_log(LOG_WARN,  __FILE__, __LINE__, __func__, format, ##__VA_ARGS__)
 #define LOG_ERROR_MSG(format, ...) logger_log(LOG_ERROR, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__)
 #define LOG_FATAL_MSG(format, ...) logger_log(LOG_FATAL, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__)
 
-/* Simplified macros without file/line info */
-#define LOG_DEBUG_SIMPLE(format, ...) logger_log_simple(LOG_DEBUG, format, ##__VA_ARGS__)
+/* Simplified macros without file/line info. Debug messages are the hot-path
+ * ones, so their arguments are not even evaluated when debug is off. */
+#define LOG_DEBUG_SIMPLE(format, ...) do { if (logger_is_enabled(LOG_DEBUG)) logger_log_simple(LOG_DEBUG, format, ##__VA_ARGS__); } while (0)
 #define LOG_INFO_SIMPLE(format, ...)  logger_log_simple(LOG_INFO,  format, ##__VA_ARGS__)
 #define LOG_WARN_SIMPLE(format, ...)  logger_log_simple(LOG_WARN,  format, ##__VA_ARGS__)
 #define LOG_ERROR_SIMPLE(format, ...) logger_log_simple(LOG_ERROR, format, ##__VA_ARGS__)
@@ -133,4 +179,8 @@ const char* logger_level_string(log_level_t level);
  */
 const char* logger_level_color(log_level_t level);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* LOGGER_H */
@@ -22,6 +22,68 @@ void handle_data(const char* topic, const char* payload, size_t payload_len) {
     printf("Override this function to implement custom message handling\n");
 }
 
+/* Wakes the client thread out of direct_client_wait() */
+static void direct_client_wake(direct_client_thread_t* thread_ctx) {
+    pthread_mutex_lock(&thread_ctx->wake_mutex);
+    thread_ctx->wake_pending = true;
+    pthread_cond_broadcast(&thread_ctx->wake_cv);
+    pthread_mutex_unlock(&thread_ctx->wake_mutex);
+}
+
+/* Blocks until woken, stopped or timeout_ms passes (forever when negative) */
+static void direct_client_wait(direct_client_thread_t* thread_ctx, int timeout_ms) {
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&thread_ctx->wake_mutex);
+    while (!thread_ctx->wake_pending && thread_ctx->running) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&thread_ctx->wake_cv, &thread_ctx->wake_mutex);
+        } else if (pthread_cond_timedwait(&thread_ctx->wake_cv, &thread_ctx->wake_mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    thread_ctx->wake_pending = false;
+    pthread_mutex_unlock(&thread_ctx->wake_mutex);
+}
+
+/* Called on the MQTT loop thread; must not take thread_ctx->mutex */
+static void direct_client_connection_callback(ur_rpc_connection_status_t status, void* user_data) {
+    (void)status;
+    direct_client_wake((direct_client_thread_t*)user_data);
+}
+
+static void direct_client_heartbeat_rtt_callback(uint64_t seq, double rtt_ms, void* user_data) {
+    (void)seq;
+    direct_client_thread_t* thread_ctx = (direct_client_thread_t*)user_data;
+    if (thread_ctx->rtt_handler) {
+        thread_ctx->rtt_handler(rtt_ms, thread_ctx->rtt_handler_user_data);
+    }
+}
+
+/* Records the connection state and reports changes to the handler */
+static void direct_client_set_connected(direct_client_thread_t* thread_ctx, bool connected) {
+    pthread_mutex_lock(&thread_ctx->mutex);
+    bool changed = thread_ctx->connected != connected;
+    thread_ctx->connected = connected;
+    pthread_cond_broadcast(&thread_ctx->connection_cv);
+    direct_connection_handler_t handler = thread_ctx->connection_handler;
+    void* handler_user_data = thread_ctx->connection_handler_user_data;
+    pthread_mutex_unlock(&thread_ctx->mutex);
+
+    if (changed && handler) {
+        handler(connected, handler_user_data);
+    }
+}
+
 /* Internal thread function */
 static void* direct_client_thread_func(void* arg) {
     direct_client_thread_t* thread_ctx = (direct_client_thread_t*)arg;
@@ -91,6 +153,10 @@ static void* direct_client_thread_func(void* arg) {
                 ur_rpc_client_set_message_handler(thread_ctx->client, direct_default_message_handler, thread_ctx);
                 direct_client_log_info("RPC client created with default message handler");
             }
+            ur_rpc_client_set_connection_callback(thread_ctx->client, direct_client_connection_callback, thread_ctx);
+            if (thread_ctx->rtt_handler) {
+                ur_rpc_client_set_heartbeat_rtt_callback(thread_ctx->client, direct_client_heartbeat_rtt_callback, thread_ctx);
+            }
 
             // Set as global client
             pthread_mutex_lock(&g_global_client_mutex);
@@ -114,10 +180,7 @@ static void* direct_client_thread_func(void* arg) {
                     int connection_attempts = 0;
                     while (connection_attempts < 20 && thread_ctx->running) {
                         if (ur_rpc_client_is_connected(thread_ctx->client)) {
-                            pthread_mutex_lock(&thread_ctx->mutex);
-                            thread_ctx->connected = true;
-                            pthread_cond_broadcast(&thread_ctx->connection_cv);
-                            pthread_mutex_unlock(&thread_ctx->mutex);
+                            direct_client_set_connected(thread_ctx, true);
                             
                             direct_client_log_info("Successfully connected to broker");
                             
@@ -129,7 +192,7 @@ static void* direct_client_thread_func(void* arg) {
                             
                             break;
                         }
-                        sleep(1);
+                        direct_client_wait(thread_ctx, 1000);
                         connection_attempts++;
                     }
                     
@@ -150,15 +213,13 @@ static void* direct_client_thread_func(void* arg) {
         pthread_mutex_unlock(&thread_ctx->mutex);
         
         if (is_connected && ur_rpc_client_is_connected(thread_ctx->client)) {
-            // Client is connected and running
-            sleep(5); // Check every 5 seconds
+            // Nothing to supervise until the connection changes or stop is
+            // requested; the MQTT loop thread serves the socket meanwhile
+            direct_client_wait(thread_ctx, -1);
         } else {
             // Connection lost, try to reconnect
             if (g_reconnect_enabled && thread_ctx->reconnect_attempts < thread_ctx->max_reconnect_attempts) {
-                pthread_mutex_lock(&thread_ctx->mutex);
-                thread_ctx->connected = false;
-                pthread_cond_broadcast(&thread_ctx->connection_cv);
-                pthread_mutex_unlock(&thread_ctx->mutex);
+                direct_client_set_connected(thread_ctx, false);
                 
                 thread_ctx->reconnect_attempts++;
                 
@@ -177,8 +238,8 @@ static void* direct_client_thread_func(void* arg) {
                     pthread_mutex_unlock(&g_global_client_mutex);
                 }
                 
-                // Wait before reconnect
-                sleep(thread_ctx->reconnect_delay_ms / 1000);
+                // Wait before reconnect; stop cuts the delay short
+                direct_client_wait(thread_ctx, thread_ctx->reconnect_delay_ms);
             } else {
                 direct_client_log_error("Max reconnection attempts reached or reconnection disabled");
                 break;
@@ -193,8 +254,8 @@ static void* direct_client_thread_func(void* arg) {
         ur_rpc_client_stop(thread_ctx->client);
         ur_rpc_client_disconnect(thread_ctx->client);
     }
-    thread_ctx->connected = false;
     pthread_mutex_unlock(&thread_ctx->mutex);
+    direct_client_set_connected(thread_ctx, false);
 
     direct_client_log_info("Client thread terminated");
     return NULL;
@@ -305,6 +366,11 @@ direct_client_thread_t* direct_client_thread_create(const char* config_path) {
     thread_ctx->reconnect_delay_ms = 5000;
     thread_ctx->custom_handler = NULL;
     thread_ctx->custom_handler_user_data = NULL;
+    thread_ctx->connection_handler = NULL;
+    thread_ctx->connection_handler_user_data = NULL;
+    thread_ctx->rtt_handler = NULL;
+    thread_ctx->rtt_handler_user_data = NULL;
+    thread_ctx->wake_pending = false;
     
     if (pthread_mutex_init(&thread_ctx->mutex, NULL) != 0) {
         free(thread_ctx->config_path);
@@ -319,6 +385,20 @@ direct_client_thread_t* direct_client_thread_create(const char* config_path) {
         return NULL;
     }
     
+    pthread_condattr_t wake_attr;
+    pthread_condattr_init(&wake_attr);
+    pthread_condattr_setclock(&wake_attr, CLOCK_MONOTONIC);
+    int wake_result = pthread_cond_init(&thread_ctx->wake_cv, &wake_attr);
+    pthread_condattr_destroy(&wake_attr);
+    if (wake_result != 0 || pthread_mutex_init(&thread_ctx->wake_mutex, NULL) != 0) {
+        if (wake_result == 0) pthread_cond_destroy(&thread_ctx->wake_cv);
+        pthread_cond_destroy(&thread_ctx->connection_cv);
+        pthread_mutex_destroy(&thread_ctx->mutex);
+        free(thread_ctx->config_path);
+        free(thread_ctx);
+        return NULL;
+    }
+    
     return thread_ctx;
 }
 
@@ -346,6 +426,8 @@ void direct_client_thread_destroy(direct_client_thread_t* thread_ctx) {
     free(thread_ctx->config_path);
     
     pthread_mutex_unlock(&thread_ctx->mutex);
+    pthread_cond_destroy(&thread_ctx->wake_cv);
+    pthread_mutex_destroy(&thread_ctx->wake_mutex);
     pthread_cond_destroy(&thread_ctx->connection_cv);
     pthread_mutex_destroy(&thread_ctx->mutex);
     
@@ -370,6 +452,7 @@ int direct_client_thread_stop(direct_client_thread_t* thread_ctx) {
     if (!thread_ctx || !thread_ctx->running) return UR_RPC_ERROR_INVALID_PARAM;
     
     thread_ctx->running = false;
+    direct_client_wake(thread_ctx);
     
     // Wait for thread to finish
     pthread_join(thread_ctx->thread_id, NULL);
@@ -435,9 +518,10 @@ int direct_client_trigger_reconnect(direct_client_thread_t* thread_ctx) {
     if (!thread_ctx) return UR_RPC_ERROR_INVALID_PARAM;
     
     pthread_mutex_lock(&thread_ctx->mutex);
-    thread_ctx->connected = false;
     thread_ctx->reconnect_attempts = 0; // Reset attempt counter
     pthread_mutex_unlock(&thread_ctx->mutex);
+    direct_client_set_connected(thread_ctx, false);
+    direct_client_wake(thread_ctx);
     
     return UR_RPC_SUCCESS;
 }
@@ -460,6 +544,24 @@ void direct_client_set_message_handler(direct_client_thread_t* thread_ctx, direc
     pthread_mutex_unlock(&thread_ctx->mutex);
 }
 
+void direct_client_set_connection_handler(direct_client_thread_t* thread_ctx, direct_connection_handler_t handler, void* user_data) {
+    if (!thread_ctx) return;
+    
+    pthread_mutex_lock(&thread_ctx->mutex);
+    thread_ctx->connection_handler = handler;
+    thread_ctx->connection_handler_user_data = user_data;
+    pthread_mutex_unlock(&thread_ctx->mutex);
+}
+
+void direct_client_set_heartbeat_rtt_handler(direct_client_thread_t* thread_ctx, direct_heartbeat_rtt_handler_t handler, void* user_data) {
+    if (!thread_ctx) return;
+    
+    pthread_mutex_lock(&thread_ctx->mutex);
+    thread_ctx->rtt_handler = handler;
+    thread_ctx->rtt_handler_user_data = user_data;
+    pthread_mutex_unlock(&thread_ctx->mutex);
+}
+
 void direct_default_message_handler(const char* topic, const char* payload, size_t payload_len, void* user_data) {
     // Call the weak symbol function that can be overridden
     handle_data(topic, payload, payload_len);
@@ -527,12 +629,25 @@ int direct_client_send_notification(const char* method, const char* service, con
 }
 
 int direct_client_publish_raw_message(const char* topic, const char* payload, size_t payload_len) {
+    return direct_client_publish_raw_message_qos(topic, payload, payload_len, -1);
+}
+
+int direct_client_publish_raw_message_qos(const char* topic, const char* payload, size_t payload_len, int qos) {
+    ur_rpc_client_t* client = direct_client_get_global();
+    if (!client || !ur_rpc_client_is_connected(client)) {
+        return UR_RPC_ERROR_NOT_CONNECTED;
+    }
+    
+    return ur_rpc_publish_message_qos(client, topic, payload, payload_len, qos);
+}
+
+int direct_client_publish_raw_message_window(const char* topic, const char* payload, size_t payload_len, int qos, int timeout_ms) {
     ur_rpc_client_t* client = direct_client_get_global();
     if (!client || !ur_rpc_client_is_connected(client)) {
         return UR_RPC_ERROR_NOT_CONNECTED;
     }
     
-    return ur_rpc_publish_message(client, topic, payload, payload_len);
+    return ur_rpc_publish_message_window(client, topic, payload, payload_len, qos, timeout_ms);
 }
 
 /* Topic subscription management */
@@ -549,14 +664,18 @@ int direct_client_load_and_subscribe_topics(direct_client_thread_t* thread_ctx)
         direct_client_log_info("Found %d subscription topics in configuration", sub_topics->count);
         
         for (int i = 0; i < sub_topics->count; i++) {
-            if (sub_topics->topics[i]) {
-                int result = ur_rpc_subscribe_topic(thread_ctx->client, sub_topics->topics[i]);
+            /* With a shared group the broker spreads these over every
+             * instance in it, so each request reaches exactly one */
+            char* filter = ur_rpc_config_subscription_filter(thread_ctx->config, sub_topics->topics[i]);
+            if (filter) {
+                int result = ur_rpc_subscribe_topic(thread_ctx->client, filter);
                 if (result == UR_RPC_SUCCESS) {
-                    direct_client_log_info("Subscribed to: %s", sub_topics->topics[i]);
+                    direct_client_log_info("Subscribed to: %s", filter);
                 } else {
                     direct_client_log_error("Failed to subscribe to %s: %s", 
-                                          sub_topics->topics[i], ur_rpc_error_string(result));
+                                          filter, ur_rpc_error_string(result));
                 }
+                free(filter);
             }
         }
     } else {
@@ -635,6 +754,12 @@ int direct_client_get_statistics(direct_client_statistics_t* stats) {
         stats->uptime_seconds = ur_stats.uptime_seconds;
         stats->last_activity = ur_stats.last_activity;
         stats->is_connected = ur_rpc_client_is_connected(client);
+        stats->outstanding_messages = ur_stats.outstanding_messages;
+        stats->peak_outstanding = ur_stats.peak_outstanding;
+        stats->publish_would_block = ur_stats.publish_would_block;
+        stats->heartbeats_sent = ur_stats.heartbeats_sent;
+        stats->heartbeats_echoed = ur_stats.heartbeats_echoed;
+        stats->heartbeat_rtt_us = ur_stats.heartbeat_rtt_us;
     }
     
     return result;
@@ -651,6 +776,10 @@ void direct_client_print_statistics(const direct_client_statistics_t* stats) {
     printf("Errors: %lu\n", stats->errors_count);
     printf("Uptime: %lu seconds\n", stats->uptime_seconds);
     printf("Connected: %s\n", stats->is_connected ? "Yes" : "No");
+    printf("Outstanding: %lu (peak %lu, refused %lu)\n", stats->outstanding_messages,
+           stats->peak_outstanding, stats->publish_would_block);
+    printf("Heartbeats: %lu sent, %lu echoed (last %.3f ms)\n", stats->heartbeats_sent,
+           stats->heartbeats_echoed, stats->heartbeat_rtt_us / 1000.0);
     printf("Last activity: %s", ctime(&stats->last_activity));
     printf("========================\n");
 }
@@ -14,6 +14,12 @@ extern "C" {
 /* Message handler callback function type - defined before struct that uses it */
 typedef void (*direct_message_handler_t)(const char* topic, const char* payload, size_t payload_len, void* user_data);
 
+/* Connection state change callback, called from the client thread */
+typedef void (*direct_connection_handler_t)(bool connected, void* user_data);
+
+/* Heartbeat echo handler, see ur_rpc_client_set_heartbeat_rtt_callback */
+typedef void (*direct_heartbeat_rtt_handler_t)(double rtt_ms, void* user_data);
+
 /* Thread control structure */
 typedef struct {
     pthread_t thread_id;
@@ -31,6 +37,18 @@ typedef struct {
     /* Custom message handler - set before thread starts */
     direct_message_handler_t custom_handler;
     void* custom_handler_user_data;
+    /* Connection state handler - set before thread starts */
+    direct_connection_handler_t connection_handler;
+    void* connection_handler_user_data;
+    /* Heartbeat echo handler, kept across reconnects - set before thread starts */
+    direct_heartbeat_rtt_handler_t rtt_handler;
+    void* rtt_handler_user_data;
+    /* The client thread sleeps on wake_cv until the MQTT connection
+     * callback, a reconnect request or stop wakes it. Separate from mutex,
+     * which is held while the MQTT loop thread is joined. */
+    pthread_mutex_t wake_mutex;
+    pthread_cond_t wake_cv;
+    bool wake_pending;
 } direct_client_thread_t;
 
 /* Global client instance for multi-place usage */
@@ -60,6 +78,8 @@ int direct_client_trigger_reconnect(direct_client_thread_t* thread_ctx);
 
 /* Message handling */
 void direct_client_set_message_handler(direct_client_thread_t* thread_ctx, direct_message_handler_t handler, void* user_data);
+void direct_client_set_connection_handler(direct_client_thread_t* thread_ctx, direct_connection_handler_t handler, void* user_data);
+void direct_client_set_heartbeat_rtt_handler(direct_client_thread_t* thread_ctx, direct_heartbeat_rtt_handler_t handler, void* user_data);
 void direct_default_message_handler(const char* topic, const char* payload, size_t payload_len, void* user_data);
 
 /* Async data sending functions */
@@ -68,6 +88,9 @@ int direct_client_send_async_rpc_with_callback(const char* method, const char* s
                                               ur_rpc_authority_t authority, ur_rpc_response_handler_t callback, void* user_data);
 int direct_client_send_notification(const char* method, const char* service, const cJSON* params, ur_rpc_authority_t authority);
 int direct_client_publish_raw_message(const char* topic, const char* payload, size_t payload_len);
+int direct_client_publish_raw_message_qos(const char* topic, const char* payload, size_t payload_len, int qos);
+/* Honors the configured publish_window, see ur_rpc_publish_message_window */
+int direct_client_publish_raw_message_window(const char* topic, const char* payload, size_t payload_len, int qos, int timeout_ms);
 
 /* Topic subscription management */
 int direct_client_load_and_subscribe_topics(direct_client_thread_t* thread_ctx);
@@ -88,6 +111,12 @@ typedef struct {
     uint64_t uptime_seconds;
     time_t last_activity;
     bool is_connected;
+    uint64_t outstanding_messages;
+    uint64_t peak_outstanding;
+    uint64_t publish_would_block;
+    uint64_t heartbeats_sent;
+    uint64_t heartbeats_echoed;
+    uint64_t heartbeat_rtt_us;
 } direct_client_statistics_t;
 
 int direct_client_get_statistics(direct_client_statistics_t* stats);
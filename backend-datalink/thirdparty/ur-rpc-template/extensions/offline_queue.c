@@ -0,0 +1,485 @@
+
+#include "offline_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Segment file layout: a header, then records back to back, each padded to
+ * 4 bytes. A record is
+ *     u32 body length | u32 CRC32 of body | body
+ * with body = u8 qos | u8 reserved | u16 topic length | topic | payload.
+ * The length is stored last, so a zero length marks the end of the data
+ * and a record cut short by a crash fails its CRC. Segment files are
+ * created zero-filled at full size and never grow. */
+
+#define OFFLINE_QUEUE_MAGIC 0x31515255u   /* "URQ1" */
+#define OFFLINE_QUEUE_HEADER_SIZE 64
+#define OFFLINE_QUEUE_RECORD_HEADER 8
+#define OFFLINE_QUEUE_BODY_HEADER 4
+#define OFFLINE_QUEUE_DEFAULT_SEGMENT (1024 * 1024)
+#define OFFLINE_QUEUE_DEFAULT_MAX (64 * 1024 * 1024)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t segment_size;
+    uint64_t sequence;
+    uint32_t read_offset;     // First record not yet drained
+} offline_segment_header_t;
+
+typedef struct {
+    uint64_t sequence;
+    uint8_t* base;            // Whole file, mapped shared
+    uint32_t size;
+    uint32_t write_offset;    // End of the valid records
+    size_t pending;           // Records between read_offset and write_offset
+} offline_segment_t;
+
+struct ur_rpc_offline_queue {
+    pthread_mutex_t mutex;
+    char* directory;
+    uint32_t segment_size;
+    size_t max_segments;
+    int drain_rate;
+    offline_segment_t* segments;   // Oldest first; the last one takes new records
+    size_t segment_count;
+    size_t pending;
+    uint64_t dropped;
+    double drain_tokens;
+    uint64_t drain_refill_ms;
+};
+
+static uint32_t g_crc_table[256];
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+
+static void crc32_init_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        g_crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32_compute(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        crc = g_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t record_size(uint32_t body_length) {
+    return (OFFLINE_QUEUE_RECORD_HEADER + body_length + 3u) & ~3u;
+}
+
+static offline_segment_header_t* segment_header(const offline_segment_t* segment) {
+    return (offline_segment_header_t*)segment->base;
+}
+
+static void segment_path(const ur_rpc_offline_queue_t* queue, uint64_t sequence, char* path, size_t path_size) {
+    snprintf(path, path_size, "%s/%020llu.urq", queue->directory, (unsigned long long)sequence);
+}
+
+/* Length of the valid record at offset, 0 at the end of the data */
+static uint32_t segment_record_at(const offline_segment_t* segment, uint32_t offset) {
+    uint32_t length, crc;
+
+    if (offset + OFFLINE_QUEUE_RECORD_HEADER > segment->size) return 0;
+    memcpy(&length, segment->base + offset, sizeof(length));
+    memcpy(&crc, segment->base + offset + 4, sizeof(crc));
+    if (length < OFFLINE_QUEUE_BODY_HEADER || length > segment->size - offset - OFFLINE_QUEUE_RECORD_HEADER) {
+        return 0;
+    }
+    if (crc32_compute(segment->base + offset + OFFLINE_QUEUE_RECORD_HEADER, length) != crc) {
+        return 0;
+    }
+    return length;
+}
+
+/* Finds the end of the records and counts those not yet drained */
+static void segment_recover(offline_segment_t* segment) {
+    offline_segment_header_t* header = segment_header(segment);
+    uint32_t offset = OFFLINE_QUEUE_HEADER_SIZE;
+    uint32_t length;
+
+    if (header->read_offset < OFFLINE_QUEUE_HEADER_SIZE || header->read_offset > segment->size) {
+        header->read_offset = OFFLINE_QUEUE_HEADER_SIZE;
+    }
+    segment->pending = 0;
+    while ((length = segment_record_at(segment, offset)) != 0) {
+        if (offset >= header->read_offset) {
+            segment->pending++;
+        }
+        offset += record_size(length);
+    }
+    segment->write_offset = offset;
+    if (header->read_offset > offset) {
+        header->read_offset = offset;
+    }
+}
+
+static int segment_map(ur_rpc_offline_queue_t* queue, offline_segment_t* segment, bool create) {
+    char path[4096];
+    int fd;
+    void* base;
+
+    segment_path(queue, segment->sequence, path, sizeof(path));
+    fd = open(path, create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0644);
+    if (fd < 0) return UR_RPC_ERROR_CONFIG;
+
+    if (create) {
+        if (ftruncate(fd, (off_t)queue->segment_size) != 0) {
+            close(fd);
+            unlink(path);
+            return UR_RPC_ERROR_MEMORY;
+        }
+        segment->size = queue->segment_size;
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < OFFLINE_QUEUE_HEADER_SIZE || st.st_size > UINT32_MAX) {
+            close(fd);
+            return UR_RPC_ERROR_CONFIG;
+        }
+        segment->size = (uint32_t)st.st_size;
+    }
+
+    base = mmap(NULL, segment->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        if (create) unlink(path);
+        return UR_RPC_ERROR_MEMORY;
+    }
+    segment->base = (uint8_t*)base;
+
+    if (create) {
+        offline_segment_header_t* header = segment_header(segment);
+        header->magic = OFFLINE_QUEUE_MAGIC;
+        header->segment_size = segment->size;
+        header->sequence = segment->sequence;
+        header->read_offset = OFFLINE_QUEUE_HEADER_SIZE;
+        segment->write_offset = OFFLINE_QUEUE_HEADER_SIZE;
+        segment->pending = 0;
+    } else if (segment_header(segment)->magic != OFFLINE_QUEUE_MAGIC) {
+        munmap(segment->base, segment->size);
+        segment->base = NULL;
+        return UR_RPC_ERROR_CONFIG;
+    } else {
+        segment_recover(segment);
+    }
+    return UR_RPC_SUCCESS;
+}
+
+/* Unmaps and deletes the oldest segment */
+static void queue_drop_oldest(ur_rpc_offline_queue_t* queue) {
+    char path[4096];
+    offline_segment_t* oldest = &queue->segments[0];
+
+    queue->pending -= oldest->pending;
+    queue->dropped += oldest->pending;
+    munmap(oldest->base, oldest->size);
+    segment_path(queue, oldest->sequence, path, sizeof(path));
+    unlink(path);
+
+    memmove(&queue->segments[0], &queue->segments[1], (queue->segment_count - 1) * sizeof(offline_segment_t));
+    queue->segment_count--;
+}
+
+static int queue_add_segment(ur_rpc_offline_queue_t* queue) {
+    offline_segment_t segment;
+    offline_segment_t* grown;
+    int result;
+
+    /* Make room under the cap first; drained segments go before any with
+     * messages left */
+    while (queue->segment_count > 0 && queue->segment_count + 1 > queue->max_segments) {
+        queue_drop_oldest(queue);
+    }
+
+    memset(&segment, 0, sizeof(segment));
+    segment.sequence = queue->segment_count > 0 ? queue->segments[queue->segment_count - 1].sequence + 1 : 1;
+    result = segment_map(queue, &segment, true);
+    if (result != UR_RPC_SUCCESS) return result;
+
+    grown = realloc(queue->segments, (queue->segment_count + 1) * sizeof(offline_segment_t));
+    if (!grown) {
+        char path[4096];
+        munmap(segment.base, segment.size);
+        segment_path(queue, segment.sequence, path, sizeof(path));
+        unlink(path);
+        return UR_RPC_ERROR_MEMORY;
+    }
+    queue->segments = grown;
+    queue->segments[queue->segment_count++] = segment;
+    return UR_RPC_SUCCESS;
+}
+
+static int compare_sequence(const void* a, const void* b) {
+    uint64_t left = *(const uint64_t*)a;
+    uint64_t right = *(const uint64_t*)b;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+/* Maps the segments an earlier run left behind, oldest first */
+static int queue_load_segments(ur_rpc_offline_queue_t* queue) {
+    DIR* dir;
+    struct dirent* entry;
+    uint64_t* sequences = NULL;
+    size_t count = 0, capacity = 0;
+    int result = UR_RPC_SUCCESS;
+
+    dir = opendir(queue->directory);
+    if (!dir) return UR_RPC_ERROR_CONFIG;
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned long long sequence;
+        char suffix[8];
+        if (sscanf(entry->d_name, "%20llu.%4s", &sequence, suffix) != 2 || strcmp(suffix, "urq") != 0) {
+            continue;
+        }
+        if (count == capacity) {
+            size_t new_capacity = capacity ? capacity * 2 : 16;
+            uint64_t* grown = realloc(sequences, new_capacity * sizeof(uint64_t));
+            if (!grown) {
+                result = UR_RPC_ERROR_MEMORY;
+                break;
+            }
+            sequences = grown;
+            capacity = new_capacity;
+        }
+        sequences[count++] = sequence;
+    }
+    closedir(dir);
+
+    if (result == UR_RPC_SUCCESS && count > 0) {
+        qsort(sequences, count, sizeof(uint64_t), compare_sequence);
+        queue->segments = calloc(count, sizeof(offline_segment_t));
+        if (!queue->segments) {
+            result = UR_RPC_ERROR_MEMORY;
+        }
+        for (size_t i = 0; result == UR_RPC_SUCCESS && i < count; i++) {
+            offline_segment_t* segment = &queue->segments[queue->segment_count];
+            segment->sequence = sequences[i];
+            if (segment_map(queue, segment, false) != UR_RPC_SUCCESS) {
+                /* Not ours or damaged beyond its header: leave it alone */
+                LOG_WARN_SIMPLE("Offline queue: skipping unreadable segment %llu", (unsigned long long)sequences[i]);
+                continue;
+            }
+            queue->pending += segment->pending;
+            queue->segment_count++;
+        }
+    }
+    free(sequences);
+    return result;
+}
+
+ur_rpc_offline_queue_t* ur_rpc_offline_queue_open(const ur_rpc_offline_queue_config_t* config) {
+    ur_rpc_offline_queue_t* queue;
+    size_t max_bytes;
+
+    if (!config || !config->directory || config->drain_rate < 0) return NULL;
+    if (config->segment_size != 0 && (config->segment_size < 4096 || config->segment_size > UINT32_MAX)) return NULL;
+
+    pthread_once(&g_crc_once, crc32_init_table);
+
+    if (mkdir(config->directory, 0755) != 0 && errno != EEXIST) {
+        LOG_ERROR_SIMPLE("Offline queue: cannot create %s: %s", config->directory, strerror(errno));
+        return NULL;
+    }
+
+    queue = calloc(1, sizeof(ur_rpc_offline_queue_t));
+    if (!queue) return NULL;
+    queue->directory = strdup(config->directory);
+    queue->segment_size = config->segment_size ? (uint32_t)config->segment_size : OFFLINE_QUEUE_DEFAULT_SEGMENT;
+    max_bytes = config->max_bytes ? config->max_bytes : OFFLINE_QUEUE_DEFAULT_MAX;
+    queue->max_segments = max_bytes / queue->segment_size;
+    if (queue->max_segments < 1) queue->max_segments = 1;
+    queue->drain_rate = config->drain_rate;
+    queue->drain_tokens = config->drain_rate;
+    queue->drain_refill_ms = ur_rpc_get_timestamp_ms();
+    pthread_mutex_init(&queue->mutex, NULL);
+
+    if (!queue->directory || queue_load_segments(queue) != UR_RPC_SUCCESS) {
+        ur_rpc_offline_queue_close(queue);
+        return NULL;
+    }
+
+    if (queue->pending > 0) {
+        LOG_INFO_SIMPLE("Offline queue: %zu message(s) waiting in %s", queue->pending, queue->directory);
+    }
+    return queue;
+}
+
+void ur_rpc_offline_queue_close(ur_rpc_offline_queue_t* queue) {
+    if (!queue) return;
+
+    for (size_t i = 0; i < queue->segment_count; i++) {
+        msync(queue->segments[i].base, queue->segments[i].size, MS_ASYNC);
+        munmap(queue->segments[i].base, queue->segments[i].size);
+    }
+    free(queue->segments);
+    free(queue->directory);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue);
+}
+
+int ur_rpc_offline_queue_push(ur_rpc_offline_queue_t* queue, const char* topic, const char* payload, size_t payload_len, int qos) {
+    offline_segment_t* tail;
+    size_t topic_len, full_size, room;
+    uint32_t body_length, crc;
+    uint16_t topic_length16;
+    uint8_t* record;
+    int result;
+
+    if (!queue || !topic || (!payload && payload_len > 0) || qos > 2) return UR_RPC_ERROR_INVALID_PARAM;
+
+    /* Sizes are checked against the segment one at a time before they are
+     * added, so neither the sum nor the room left can wrap */
+    topic_len = strlen(topic);
+    room = queue->segment_size - OFFLINE_QUEUE_HEADER_SIZE;
+    if (topic_len == 0 || topic_len > UINT16_MAX || topic_len > room || payload_len > room) {
+        return UR_RPC_ERROR_INVALID_PARAM;
+    }
+    full_size = (OFFLINE_QUEUE_RECORD_HEADER + OFFLINE_QUEUE_BODY_HEADER + topic_len + payload_len + 3) & ~(size_t)3;
+    if (full_size > room) {
+        return UR_RPC_ERROR_INVALID_PARAM;
+    }
+    body_length = (uint32_t)(OFFLINE_QUEUE_BODY_HEADER + topic_len + payload_len);
+
+    pthread_mutex_lock(&queue->mutex);
+
+    tail = queue->segment_count > 0 ? &queue->segments[queue->segment_count - 1] : NULL;
+    if (!tail || tail->write_offset + record_size(body_length) > tail->size) {
+        result = queue_add_segment(queue);
+        if (result != UR_RPC_SUCCESS) {
+            pthread_mutex_unlock(&queue->mutex);
+            return result;
+        }
+        tail = &queue->segments[queue->segment_count - 1];
+    }
+
+    /* Body and CRC first, length last: a crash in between leaves a record
+     * that recovery rejects */
+    record = tail->base + tail->write_offset;
+    record[OFFLINE_QUEUE_RECORD_HEADER] = (uint8_t)(qos < 0 ? 0xFF : qos);
+    record[OFFLINE_QUEUE_RECORD_HEADER + 1] = 0;
+    topic_length16 = (uint16_t)topic_len;
+    memcpy(record + OFFLINE_QUEUE_RECORD_HEADER + 2, &topic_length16, sizeof(topic_length16));
+    memcpy(record + OFFLINE_QUEUE_RECORD_HEADER + OFFLINE_QUEUE_BODY_HEADER, topic, topic_len);
+    if (payload_len > 0) {
+        memcpy(record + OFFLINE_QUEUE_RECORD_HEADER + OFFLINE_QUEUE_BODY_HEADER + topic_len, payload, payload_len);
+    }
+    crc = crc32_compute(record + OFFLINE_QUEUE_RECORD_HEADER, body_length);
+    memcpy(record + 4, &crc, sizeof(crc));
+    __atomic_store_n((uint32_t*)record, body_length, __ATOMIC_RELEASE);
+
+    tail->write_offset += record_size(body_length);
+    tail->pending++;
+    queue->pending++;
+
+    pthread_mutex_unlock(&queue->mutex);
+    return UR_RPC_SUCCESS;
+}
+
+int ur_rpc_offline_queue_drain(ur_rpc_offline_queue_t* queue, ur_rpc_client_t* client, int max_messages) {
+    char topic_buffer[256];
+    int published = 0;
+    int budget;
+
+    if (!queue || !client) return UR_RPC_ERROR_INVALID_PARAM;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    budget = max_messages > 0 ? max_messages : INT32_MAX;
+    if (queue->drain_rate > 0) {
+        /* Token bucket holding at most one second's worth */
+        uint64_t now = ur_rpc_get_timestamp_ms();
+        queue->drain_tokens += (double)(now - queue->drain_refill_ms) * queue->drain_rate / 1000.0;
+        if (queue->drain_tokens > queue->drain_rate) {
+            queue->drain_tokens = queue->drain_rate;
+        }
+        queue->drain_refill_ms = now;
+        if ((double)budget > queue->drain_tokens) {
+            budget = (int)queue->drain_tokens;
+        }
+    }
+
+    while (published < budget && queue->segment_count > 0) {
+        offline_segment_t* head = &queue->segments[0];
+        offline_segment_header_t* header = segment_header(head);
+        uint32_t offset = header->read_offset;
+        uint32_t length;
+        uint16_t topic_len;
+        const uint8_t* body;
+        char* topic;
+        int qos;
+        int result;
+
+        if (offset >= head->write_offset) {
+            if (queue->segment_count == 1) {
+                /* Everything drained: rewind the only segment in place */
+                memset(head->base + OFFLINE_QUEUE_HEADER_SIZE, 0, head->write_offset - OFFLINE_QUEUE_HEADER_SIZE);
+                header->read_offset = OFFLINE_QUEUE_HEADER_SIZE;
+                head->write_offset = OFFLINE_QUEUE_HEADER_SIZE;
+                break;
+            }
+            queue_drop_oldest(queue);
+            continue;
+        }
+
+        memcpy(&length, head->base + offset, sizeof(length));
+        body = head->base + offset + OFFLINE_QUEUE_RECORD_HEADER;
+        qos = body[0] == 0xFF ? -1 : body[0];
+        memcpy(&topic_len, body + 2, sizeof(topic_len));
+
+        /* The topic needs a terminator; it is copied, the payload is not */
+        topic = topic_len < sizeof(topic_buffer) ? topic_buffer : malloc((size_t)topic_len + 1);
+        if (!topic) break;
+        memcpy(topic, body + OFFLINE_QUEUE_BODY_HEADER, topic_len);
+        topic[topic_len] = '\0';
+
+        result = ur_rpc_publish_message_qos(client, topic,
+                                            (const char*)body + OFFLINE_QUEUE_BODY_HEADER + topic_len,
+                                            length - OFFLINE_QUEUE_BODY_HEADER - topic_len, qos);
+        if (topic != topic_buffer) free(topic);
+        if (result != UR_RPC_SUCCESS) break;
+
+        header->read_offset = offset + record_size(length);
+        head->pending--;
+        queue->pending--;
+        published++;
+    }
+
+    if (queue->drain_rate > 0) {
+        queue->drain_tokens -= published;
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+    return published;
+}
+
+size_t ur_rpc_offline_queue_pending(ur_rpc_offline_queue_t* queue) {
+    size_t pending;
+
+    if (!queue) return 0;
+    pthread_mutex_lock(&queue->mutex);
+    pending = queue->pending;
+    pthread_mutex_unlock(&queue->mutex);
+    return pending;
+}
+
+uint64_t ur_rpc_offline_queue_dropped(ur_rpc_offline_queue_t* queue) {
+    uint64_t dropped;
+
+    if (!queue) return 0;
+    pthread_mutex_lock(&queue->mutex);
+    dropped = queue->dropped;
+    pthread_mutex_unlock(&queue->mutex);
+    return dropped;
+}
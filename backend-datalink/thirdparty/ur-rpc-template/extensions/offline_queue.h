@@ -0,0 +1,62 @@
+#ifndef OFFLINE_QUEUE_H
+#define OFFLINE_QUEUE_H
+
+#include "ur-rpc-template.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Store-and-forward queue for messages published while the broker is out of
+ * reach. Messages are appended to memory-mapped segment files in a
+ * directory, one record each with a CRC32 over it, so they survive restarts
+ * without being held on the heap. On reconnect they are published again in
+ * the order they were queued, at a bounded rate.
+ *
+ * Each segment remembers how far it has been drained, so a message is sent
+ * again after a restart only if the process stopped between publishing it
+ * and recording that. A record torn by a crash fails its CRC and ends the
+ * segment. When the segments would grow past max_bytes the oldest one is
+ * deleted, together with any messages left in it.
+ *
+ * All functions are thread safe. */
+
+typedef struct {
+    const char* directory;   // Segment files live here; created if missing
+    size_t segment_size;     // Bytes per segment file (0 = 1 MiB)
+    size_t max_bytes;        // Disk cap over all segments (0 = 64 MiB)
+    int drain_rate;          // Messages per second while draining (0 = unlimited)
+} ur_rpc_offline_queue_config_t;
+
+typedef struct ur_rpc_offline_queue ur_rpc_offline_queue_t;
+
+/* Opens the queue in config->directory, picking up segments left by an
+ * earlier run. Returns NULL when the directory or a segment can't be used. */
+ur_rpc_offline_queue_t* ur_rpc_offline_queue_open(const ur_rpc_offline_queue_config_t* config);
+void ur_rpc_offline_queue_close(ur_rpc_offline_queue_t* queue);
+
+/* Appends a message. qos < 0 publishes it with the client's default QoS.
+ * Fails with UR_RPC_ERROR_INVALID_PARAM for a message larger than a
+ * segment. */
+int ur_rpc_offline_queue_push(ur_rpc_offline_queue_t* queue, const char* topic, const char* payload, size_t payload_len, int qos);
+
+/* Publishes queued messages in order through client, as many as the drain
+ * rate allows since the last call and at most max_messages (<= 0 for no
+ * limit). Stops at the first message that can't be published, which stays
+ * queued. Returns the number of messages published. */
+int ur_rpc_offline_queue_drain(ur_rpc_offline_queue_t* queue, ur_rpc_client_t* client, int max_messages);
+
+/* Messages waiting to be drained */
+size_t ur_rpc_offline_queue_pending(ur_rpc_offline_queue_t* queue);
+
+/* Messages lost to the disk cap since the queue was opened */
+uint64_t ur_rpc_offline_queue_dropped(ur_rpc_offline_queue_t* queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OFFLINE_QUEUE_H */
@@ -9,7 +9,10 @@
 #include "ur-rpc-template.h"
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <type_traits>
+#include <cstdint>
 #include <functional>
 #include <map>
 #include <optional>
@@ -42,6 +45,103 @@ public:
 
 // C++ wrapper classes
 
+// Non-owning, read-only view of a cJSON node. Valid while the tree it points
+// into is; strings are returned as views into that tree, not copies.
+class JsonView {
+private:
+    const cJSON* json_;
+
+public:
+    JsonView() : json_(nullptr) {}
+    explicit JsonView(const cJSON* json) : json_(json) {}
+
+    const cJSON* get() const { return json_; }
+    bool valid() const { return json_ != nullptr; }
+
+    bool isNull() const { return json_ && cJSON_IsNull(json_); }
+    bool isBool() const { return json_ && cJSON_IsBool(json_); }
+    bool isNumber() const { return json_ && cJSON_IsNumber(json_); }
+    bool isString() const { return json_ && cJSON_IsString(json_); }
+    bool isArray() const { return json_ && cJSON_IsArray(json_); }
+    bool isObject() const { return json_ && cJSON_IsObject(json_); }
+
+    // Member or element; an invalid view when missing
+    JsonView operator[](const std::string& key) const {
+        return JsonView(json_ ? cJSON_GetObjectItemCaseSensitive(json_, key.c_str()) : nullptr);
+    }
+    JsonView operator[](int index) const {
+        return JsonView(json_ ? cJSON_GetArrayItem(json_, index) : nullptr);
+    }
+    int size() const { return json_ ? cJSON_GetArraySize(json_) : 0; }
+
+    std::optional<std::string_view> asString() const {
+        if (!isString()) return std::nullopt;
+        return std::string_view(json_->valuestring);
+    }
+
+    std::optional<double> asNumber() const {
+        if (!isNumber()) return std::nullopt;
+        return json_->valuedouble;
+    }
+
+    std::optional<bool> asBool() const {
+        if (!isBool()) return std::nullopt;
+        return cJSON_IsTrue(json_) != 0;
+    }
+
+    std::optional<std::string_view> getString(const std::string& key) const { return (*this)[key].asString(); }
+    std::optional<double> getNumber(const std::string& key) const { return (*this)[key].asNumber(); }
+    std::optional<bool> getBool(const std::string& key) const { return (*this)[key].asBool(); }
+
+    std::string toString() const {
+        if (!json_) return "{}";
+        char* str = cJSON_PrintUnformatted(json_);
+        if (!str) return "{}";
+        std::string result(str);
+        free(str);
+        return result;
+    }
+};
+
+// Builds a Json value (nlohmann::json, or any type with its interface)
+// straight from a cJSON tree, without printing it and parsing it again.
+// Integral numbers become integers, the rest doubles.
+template <typename Json>
+Json toJson(JsonView view) {
+    const cJSON* item = view.get();
+    if (!item || cJSON_IsNull(item)) {
+        return Json(nullptr);
+    }
+    if (cJSON_IsBool(item)) {
+        return Json(cJSON_IsTrue(item) != 0);
+    }
+    if (cJSON_IsNumber(item)) {
+        double number = item->valuedouble;
+        if (number >= -9.2e18 && number <= 9.2e18 && number == static_cast<double>(static_cast<int64_t>(number))) {
+            return Json(static_cast<int64_t>(number));
+        }
+        return Json(number);
+    }
+    if (cJSON_IsString(item)) {
+        return Json(std::string(item->valuestring));
+    }
+    if (cJSON_IsRaw(item)) {
+        return Json::parse(item->valuestring);
+    }
+    if (cJSON_IsArray(item)) {
+        Json array = Json::array();
+        for (const cJSON* child = item->child; child; child = child->next) {
+            array.push_back(toJson<Json>(JsonView(child)));
+        }
+        return array;
+    }
+    Json object = Json::object();
+    for (const cJSON* child = item->child; child; child = child->next) {
+        object[child->string] = toJson<Json>(JsonView(child));
+    }
+    return object;
+}
+
 // Smart pointer wrapper for cJSON with automatic cleanup
 class JsonValue {
 private:
@@ -51,8 +151,10 @@ private:
 public:
     JsonValue() : json_(cJSON_CreateObject()), owner_(true) {}
     explicit JsonValue(cJSON* json, bool take_ownership = false) : json_(json), owner_(take_ownership) {}
-    explicit JsonValue(const std::string& json_string) : owner_(true) {
-        json_ = cJSON_Parse(json_string.c_str());
+    // Parses straight from the buffer; it need not be NUL-terminated. CBOR
+    // payloads are decoded too, so message handlers read either encoding.
+    explicit JsonValue(std::string_view json_string) : owner_(true) {
+        json_ = ur_rpc_payload_parse(json_string.data(), json_string.size());
         if (!json_) {
             throw Exception("Invalid JSON string");
         }
@@ -88,6 +190,7 @@ public:
     JsonValue& operator=(const JsonValue&) = delete;
 
     cJSON* get() const { return json_; }
+    JsonView view() const { return JsonView(json_); }
 
     std::string toString() const {
         if (!json_) return "{}";
@@ -167,7 +270,9 @@ class Client;
 class RelayClient;
 
 // Callback function types
-using MessageHandler = std::function<void(const std::string& topic, const std::string& payload)>;
+// Topic and payload are views into the received MQTT message, valid for the
+// duration of the call
+using MessageHandler = std::function<void(std::string_view topic, std::string_view payload)>;
 using ResponseHandler = std::function<void(bool success, const JsonValue& result, const std::string& error_message, int error_code)>;
 using ConnectionCallback = std::function<void(ConnectionStatus status)>;
 
@@ -251,6 +356,49 @@ public:
         return *this;
     }
 
+    ClientConfig& setReconnectJitter(bool jitter) {
+        int result = ur_rpc_config_set_reconnect_jitter(config_.get(), jitter);
+        if (result != UR_RPC_SUCCESS) {
+            throw ConfigException("Failed to set reconnect jitter");
+        }
+        return *this;
+    }
+
+    ClientConfig& setPayloadEncoding(ur_rpc_encoding_t encoding) {
+        int result = ur_rpc_config_set_payload_encoding(config_.get(), encoding);
+        if (result != UR_RPC_SUCCESS) {
+            throw ConfigException("Invalid payload encoding");
+        }
+        return *this;
+    }
+
+    // 0 leaves windowed publishes unlimited
+    ClientConfig& setPublishWindow(int window) {
+        int result = ur_rpc_config_set_publish_window(config_.get(), window);
+        if (result != UR_RPC_SUCCESS) {
+            throw ConfigException("Invalid publish window");
+        }
+        return *this;
+    }
+
+    // 0 asks servers for whole responses only
+    ClientConfig& setChunkWindow(int window) {
+        int result = ur_rpc_config_set_chunk_window(config_.get(), window);
+        if (result != UR_RPC_SUCCESS) {
+            throw ConfigException("Invalid chunk window");
+        }
+        return *this;
+    }
+
+    // Empty turns shared subscriptions off
+    ClientConfig& setSharedGroup(const std::string& group) {
+        int result = ur_rpc_config_set_shared_group(config_.get(), group.c_str());
+        if (result != UR_RPC_SUCCESS) {
+            throw ConfigException("Invalid shared subscription group: " + group);
+        }
+        return *this;
+    }
+
     ClientConfig& setHeartbeat(const std::string& topic, int interval_seconds, const std::string& payload) {
         int result = ur_rpc_config_set_heartbeat(config_.get(), topic.c_str(), interval_seconds, payload.c_str());
         if (result != UR_RPC_SUCCESS) {
@@ -259,6 +407,15 @@ public:
         return *this;
     }
 
+    // Times every beat's round trip through the broker
+    ClientConfig& setHeartbeatEcho(bool echo) {
+        int result = ur_rpc_config_set_heartbeat_echo(config_.get(), echo);
+        if (result != UR_RPC_SUCCESS) {
+            throw ConfigException("Failed to set heartbeat echo");
+        }
+        return *this;
+    }
+
     ClientConfig& loadFromFile(const std::string& filename) {
         int result = ur_rpc_config_load_from_file(config_.get(), filename.c_str());
         if (result != UR_RPC_SUCCESS) {
@@ -301,6 +458,30 @@ public:
     const ur_rpc_topic_config_t* get() const { return config_.get(); }
 };
 
+// Arena class (RAII). Requests and responses built from it share its
+// blocks and must be destroyed before reset() or the arena itself.
+class Arena {
+private:
+    std::unique_ptr<ur_rpc_arena_t, decltype(&ur_rpc_arena_destroy)> arena_;
+
+public:
+    explicit Arena(size_t block_size = 0) : arena_(ur_rpc_arena_create(block_size), ur_rpc_arena_destroy) {
+        if (!arena_) {
+            throw Exception("Failed to create arena");
+        }
+    }
+
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    // Releases everything allocated since the last reset, keeping the first block
+    void reset() {
+        ur_rpc_arena_reset(arena_.get());
+    }
+
+    ur_rpc_arena_t* get() const { return arena_.get(); }
+};
+
 // Request class
 class Request {
 private:
@@ -320,6 +501,12 @@ public:
         }
     }
 
+    explicit Request(Arena& arena) : request_(ur_rpc_arena_request_create(arena.get()), ur_rpc_request_destroy) {
+        if (!request_) {
+            throw Exception("Failed to create request");
+        }
+    }
+
     Request& setMethod(const std::string& method, const std::string& service) {
         int result = ur_rpc_request_set_method(request_.get(), method.c_str(), service.c_str());
         if (result != UR_RPC_SUCCESS) {
@@ -364,6 +551,12 @@ private:
 public:
     explicit Response(ur_rpc_response_t* response, bool take_ownership = true) : response_(response, take_ownership ? ur_rpc_response_destroy : nullptr) {}
 
+    explicit Response(Arena& arena) : response_(ur_rpc_arena_response_create(arena.get()), ur_rpc_response_destroy) {
+        if (!response_) {
+            throw Exception("Failed to create response");
+        }
+    }
+
     bool isSuccess() const {
         return response_ && response_->success;
     }
@@ -417,6 +610,12 @@ struct Statistics {
     uint64_t connectionCount = 0;
     uint64_t uptimeSeconds = 0;
     time_t lastActivity = 0;
+    uint64_t outstandingMessages = 0;
+    uint64_t peakOutstanding = 0;
+    uint64_t publishWouldBlock = 0;
+    uint64_t heartbeatsSent = 0;
+    uint64_t heartbeatsEchoed = 0;
+    uint64_t heartbeatRttUs = 0;
 
     Statistics() = default;
 
@@ -430,6 +629,12 @@ struct Statistics {
         connectionCount = stats.connection_count;
         uptimeSeconds = stats.uptime_seconds;
         lastActivity = stats.last_activity;
+        outstandingMessages = stats.outstanding_messages;
+        peakOutstanding = stats.peak_outstanding;
+        publishWouldBlock = stats.publish_would_block;
+        heartbeatsSent = stats.heartbeats_sent;
+        heartbeatsEchoed = stats.heartbeats_echoed;
+        heartbeatRttUs = stats.heartbeat_rtt_us;
     }
 };
 
@@ -440,13 +645,13 @@ private:
     MessageHandler message_handler_;
     std::map<std::string, ResponseHandler> pending_responses_;
     ConnectionCallback connection_callback_;
+    std::function<void()> capacity_callback_;
+    std::function<void(uint64_t, double)> heartbeat_rtt_callback_;
 
     static void message_callback_wrapper(const char* topic, const char* payload, size_t payload_len, void* user_data) {
         auto* client = static_cast<Client*>(user_data);
         if (client && client->message_handler_) {
-            std::string topic_str(topic);
-            std::string payload_str(payload, payload_len);
-            client->message_handler_(topic_str, payload_str);
+            client->message_handler_(std::string_view(topic ? topic : ""), std::string_view(payload, payload_len));
         }
     }
 
@@ -491,6 +696,20 @@ private:
         }
     }
 
+    static void capacity_callback_wrapper(void* user_data) {
+        auto* client = static_cast<Client*>(user_data);
+        if (client && client->capacity_callback_) {
+            client->capacity_callback_();
+        }
+    }
+
+    static void heartbeat_rtt_callback_wrapper(uint64_t seq, double rtt_ms, void* user_data) {
+        auto* client = static_cast<Client*>(user_data);
+        if (client && client->heartbeat_rtt_callback_) {
+            client->heartbeat_rtt_callback_(seq, rtt_ms);
+        }
+    }
+
 
 public:
     Client(const ClientConfig& config, const TopicConfig& topic_config) {
@@ -513,7 +732,9 @@ public:
     // Move constructor and assignment
     Client(Client&& other) noexcept : client_(other.client_), message_handler_(std::move(other.message_handler_)),
                                       pending_responses_(std::move(other.pending_responses_)),
-                                      connection_callback_(std::move(other.connection_callback_)) {
+                                      connection_callback_(std::move(other.connection_callback_)),
+                                      capacity_callback_(std::move(other.capacity_callback_)),
+                                      heartbeat_rtt_callback_(std::move(other.heartbeat_rtt_callback_)) {
         other.client_ = nullptr;
     }
 
@@ -526,6 +747,8 @@ public:
             message_handler_ = std::move(other.message_handler_);
             pending_responses_ = std::move(other.pending_responses_);
             connection_callback_ = std::move(other.connection_callback_);
+            capacity_callback_ = std::move(other.capacity_callback_);
+            heartbeat_rtt_callback_ = std::move(other.heartbeat_rtt_callback_);
             other.client_ = nullptr;
         }
         return *this;
@@ -567,8 +790,17 @@ public:
         return static_cast<ConnectionStatus>(ur_rpc_client_get_status(client_));
     }
 
-    void setMessageHandler(MessageHandler handler) {
-        message_handler_ = std::move(handler);
+    // Takes a MessageHandler, or a handler of (const std::string&, const
+    // std::string&) which then gets its own copies of topic and payload
+    template <typename Handler>
+    void setMessageHandler(Handler handler) {
+        if constexpr (std::is_invocable_v<Handler&, std::string_view, std::string_view>) {
+            message_handler_ = std::move(handler);
+        } else {
+            message_handler_ = [handler = std::move(handler)](std::string_view topic, std::string_view payload) mutable {
+                handler(std::string(topic), std::string(payload));
+            };
+        }
         ur_rpc_client_set_message_handler(client_, message_callback_wrapper, this);
     }
 
@@ -577,6 +809,20 @@ public:
         ur_rpc_client_set_connection_callback(client_, connection_callback_wrapper, this);
     }
 
+    // Runs on the MQTT loop thread when a refused tryPublishMessage could
+    // now succeed; must not block
+    void setCapacityCallback(std::function<void()> callback) {
+        capacity_callback_ = std::move(callback);
+        ur_rpc_client_set_capacity_callback(client_, capacity_callback_wrapper, this);
+    }
+
+    // Runs on the MQTT loop thread with (seq, rtt_ms) for every echoed
+    // heartbeat; must not block
+    void setHeartbeatRttCallback(std::function<void(uint64_t, double)> callback) {
+        heartbeat_rtt_callback_ = std::move(callback);
+        ur_rpc_client_set_heartbeat_rtt_callback(client_, heartbeat_rtt_callback_wrapper, this);
+    }
+
     void callAsync(const Request& request, ResponseHandler callback) {
         std::string transaction_id = generateTransactionId();
         pending_responses_[transaction_id] = std::move(callback);
@@ -613,6 +859,19 @@ public:
         }
     }
 
+    // Returns false while the publish window stays full for timeout_ms
+    bool tryPublishMessage(std::string_view topic_name, std::string_view payload, int qos = -1, int timeout_ms = 0) {
+        std::string topic(topic_name);
+        int result = ur_rpc_publish_message_window(client_, topic.c_str(), payload.data(), payload.size(), qos, timeout_ms);
+        if (result == UR_RPC_ERROR_WOULD_BLOCK) {
+            return false;
+        }
+        if (result != UR_RPC_SUCCESS) {
+            throw Exception("Failed to publish message: " + getErrorString(result));
+        }
+        return true;
+    }
+
     void subscribeTopic(const std::string& topic) {
         int result = ur_rpc_subscribe_topic(client_, topic.c_str());
         if (result != UR_RPC_SUCCESS) {
@@ -778,6 +1037,58 @@ public:
     }
 };
 
+// Timer class (RAII) on the shared timer thread. Callbacks must be short and
+// must not destroy or restart their own Timer; the destructor cancels and
+// waits for a callback in progress.
+class Timer {
+private:
+    std::unique_ptr<std::function<void()>> callback_;
+    ur_rpc_timer_id_t id_ = 0;
+
+    static void trampoline(void* user_data) {
+        try {
+            (*static_cast<std::function<void()>*>(user_data))();
+        } catch (...) {
+            // Nothing may unwind into the C timer thread
+        }
+    }
+
+public:
+    Timer() = default;
+
+    Timer(uint64_t delay_ms, uint64_t interval_ms, std::function<void()> callback) {
+        start(delay_ms, interval_ms, std::move(callback));
+    }
+
+    ~Timer() {
+        cancel();
+    }
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    // interval_ms 0 fires once
+    void start(uint64_t delay_ms, uint64_t interval_ms, std::function<void()> callback) {
+        cancel();
+        callback_ = std::make_unique<std::function<void()>>(std::move(callback));
+        id_ = ur_rpc_timer_schedule(delay_ms, interval_ms, trampoline, callback_.get());
+        if (!id_) {
+            callback_.reset();
+            throw Exception("Failed to schedule timer");
+        }
+    }
+
+    void cancel() {
+        if (id_) {
+            ur_rpc_timer_cancel(id_);
+            id_ = 0;
+        }
+        callback_.reset();
+    }
+
+    bool isActive() const { return id_ != 0; }
+};
+
 // Library initialization class (RAII)
 class Library {
 public:
@@ -936,6 +1247,35 @@ inline Response responseFromJson(const std::string& json_str) {
     return Response(response, true);
 }
 
+// Payloads in either encoding (JSON or CBOR)
+inline Request requestFromPayload(std::string_view payload) {
+    ur_rpc_request_t* request = ur_rpc_request_from_payload(payload.data(), payload.size());
+    if (!request) {
+        throw Exception("Failed to decode request payload");
+    }
+    return Request(request, true);
+}
+
+inline Response responseFromPayload(std::string_view payload) {
+    ur_rpc_response_t* response = ur_rpc_response_from_payload(payload.data(), payload.size());
+    if (!response) {
+        throw Exception("Failed to decode response payload");
+    }
+    return Response(response, true);
+}
+
+// Response in the client's payload encoding; may hold NUL bytes
+inline std::string encodeResponse(const Client& client, const Response& response) {
+    size_t length = 0;
+    char* encoded = ur_rpc_response_encode(client.get(), response.getNativeHandle(), &length);
+    if (!encoded) {
+        throw Exception("Failed to encode response");
+    }
+    std::string result(encoded, length);
+    ur_rpc_free_string(encoded);
+    return result;
+}
+
 } // namespace UrRpc
 
 #endif // UR_RPC_TEMPLATE_HPP
\ No newline at end of file
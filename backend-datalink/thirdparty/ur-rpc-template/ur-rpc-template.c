@@ -2,12 +2,1691 @@
 #include <sys/time.h>
 #include <errno.h>
 #include <limits.h>
+#include <math.h>
+#include <fcntl.h>
 
 /* Global variable for conditional relay control */
 bool g_sec_conn_ready = false;
 
+/* ============================================================================
+ * Shared Timer Service
+ * ============================================================================ */
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void monotonic_timespec(uint64_t ms, struct timespec* ts) {
+    ts->tv_sec = (time_t)(ms / 1000);
+    ts->tv_nsec = (long)(ms % 1000) * 1000000;
+}
+
+static int init_monotonic_cond(pthread_cond_t* cond) {
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr) != 0) return -1;
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int result = pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return result;
+}
+
+/* Every timer in the process lives in one min-heap ordered by due time.
+ * The timer thread sleeps until the earliest one is due, so an idle process
+ * has no periodic wakeups at all. Callbacks run on the timer thread with no
+ * lock held and must not block for long. */
+typedef struct {
+    ur_rpc_timer_id_t id;
+    uint64_t due_ms;
+    uint64_t interval_ms;      // 0 for one-shot timers
+    ur_rpc_timer_callback_t callback;
+    void* user_data;
+} ur_rpc_timer_entry_t;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t wake_cond;   // Earliest deadline changed, or shutdown
+    pthread_cond_t idle_cond;   // A callback returned
+    pthread_t thread;
+    bool started;
+    bool stopping;
+    ur_rpc_timer_entry_t* heap;
+    size_t count;
+    size_t capacity;
+    ur_rpc_timer_id_t next_id;
+    ur_rpc_timer_id_t running_id; // Timer whose callback is executing
+} g_timers = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+static pthread_once_t g_timers_once = PTHREAD_ONCE_INIT;
+
+static void timers_init_conds(void) {
+    init_monotonic_cond(&g_timers.wake_cond);
+    pthread_cond_init(&g_timers.idle_cond, NULL);
+}
+
+static void timer_heap_swap(size_t a, size_t b) {
+    ur_rpc_timer_entry_t tmp = g_timers.heap[a];
+    g_timers.heap[a] = g_timers.heap[b];
+    g_timers.heap[b] = tmp;
+}
+
+static void timer_heap_up(size_t i) {
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (g_timers.heap[parent].due_ms <= g_timers.heap[i].due_ms) break;
+        timer_heap_swap(parent, i);
+        i = parent;
+    }
+}
+
+static void timer_heap_down(size_t i) {
+    for (;;) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < g_timers.count && g_timers.heap[left].due_ms < g_timers.heap[smallest].due_ms) smallest = left;
+        if (right < g_timers.count && g_timers.heap[right].due_ms < g_timers.heap[smallest].due_ms) smallest = right;
+        if (smallest == i) break;
+        timer_heap_swap(i, smallest);
+        i = smallest;
+    }
+}
+
+static void timer_heap_remove(size_t i) {
+    g_timers.heap[i] = g_timers.heap[--g_timers.count];
+    if (i < g_timers.count) {
+        timer_heap_up(i);
+        timer_heap_down(i);
+    }
+}
+
+static void* timer_thread_main(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_timers.mutex);
+    while (!g_timers.stopping) {
+        if (g_timers.count == 0) {
+            pthread_cond_wait(&g_timers.wake_cond, &g_timers.mutex);
+            continue;
+        }
+
+        uint64_t now = monotonic_ms();
+        ur_rpc_timer_entry_t entry = g_timers.heap[0];
+        if (entry.due_ms > now) {
+            struct timespec wake;
+            monotonic_timespec(entry.due_ms, &wake);
+            pthread_cond_timedwait(&g_timers.wake_cond, &g_timers.mutex, &wake);
+            continue;
+        }
+
+        if (entry.interval_ms) {
+            // Keep the period; after a long stall skip the missed runs
+            g_timers.heap[0].due_ms += entry.interval_ms;
+            if (g_timers.heap[0].due_ms <= now) g_timers.heap[0].due_ms = now + entry.interval_ms;
+            timer_heap_down(0);
+        } else {
+            timer_heap_remove(0);
+        }
+
+        g_timers.running_id = entry.id;
+        pthread_mutex_unlock(&g_timers.mutex);
+        entry.callback(entry.user_data);
+        pthread_mutex_lock(&g_timers.mutex);
+        g_timers.running_id = 0;
+        pthread_cond_broadcast(&g_timers.idle_cond);
+    }
+    pthread_mutex_unlock(&g_timers.mutex);
+
+    return NULL;
+}
+
+ur_rpc_timer_id_t ur_rpc_timer_schedule(uint64_t delay_ms, uint64_t interval_ms,
+                                        ur_rpc_timer_callback_t callback, void* user_data) {
+    if (!callback) return 0;
+
+    pthread_once(&g_timers_once, timers_init_conds);
+    pthread_mutex_lock(&g_timers.mutex);
+
+    if (!g_timers.started) {
+        g_timers.stopping = false;
+        if (pthread_create(&g_timers.thread, NULL, timer_thread_main, NULL) != 0) {
+            pthread_mutex_unlock(&g_timers.mutex);
+            LOG_ERROR_SIMPLE("Failed to start timer thread");
+            return 0;
+        }
+        g_timers.started = true;
+    }
+
+    if (g_timers.count == g_timers.capacity) {
+        size_t capacity = g_timers.capacity ? g_timers.capacity * 2 : 16;
+        ur_rpc_timer_entry_t* heap = realloc(g_timers.heap, capacity * sizeof(ur_rpc_timer_entry_t));
+        if (!heap) {
+            pthread_mutex_unlock(&g_timers.mutex);
+            return 0;
+        }
+        g_timers.heap = heap;
+        g_timers.capacity = capacity;
+    }
+
+    ur_rpc_timer_id_t id = ++g_timers.next_id;
+    size_t index = g_timers.count++;
+    g_timers.heap[index].id = id;
+    g_timers.heap[index].due_ms = monotonic_ms() + delay_ms;
+    g_timers.heap[index].interval_ms = interval_ms;
+    g_timers.heap[index].callback = callback;
+    g_timers.heap[index].user_data = user_data;
+    timer_heap_up(index);
+
+    // Only a new earliest deadline changes how long the thread sleeps
+    if (g_timers.heap[0].id == id) pthread_cond_signal(&g_timers.wake_cond);
+
+    pthread_mutex_unlock(&g_timers.mutex);
+    return id;
+}
+
+int ur_rpc_timer_cancel(ur_rpc_timer_id_t id) {
+    if (id == 0) return UR_RPC_ERROR_INVALID_PARAM;
+
+    pthread_mutex_lock(&g_timers.mutex);
+
+    bool found = false;
+    for (size_t i = 0; i < g_timers.count; i++) {
+        if (g_timers.heap[i].id == id) {
+            timer_heap_remove(i);
+            found = true;
+            break;
+        }
+    }
+
+    // Once this returns the callback is neither queued nor running, except
+    // when a callback cancels itself
+    if (g_timers.started && !pthread_equal(pthread_self(), g_timers.thread)) {
+        while (g_timers.running_id == id) {
+            found = true;
+            pthread_cond_wait(&g_timers.idle_cond, &g_timers.mutex);
+        }
+    } else if (g_timers.running_id == id) {
+        found = true;
+    }
+
+    pthread_mutex_unlock(&g_timers.mutex);
+    return found ? UR_RPC_SUCCESS : UR_RPC_ERROR_INVALID_PARAM;
+}
+
+void ur_rpc_timer_shutdown(void) {
+    pthread_mutex_lock(&g_timers.mutex);
+    if (!g_timers.started || g_timers.count > 0 ||
+        pthread_equal(pthread_self(), g_timers.thread)) {
+        // Timers still scheduled keep the thread
+        pthread_mutex_unlock(&g_timers.mutex);
+        return;
+    }
+    g_timers.stopping = true;
+    pthread_cond_signal(&g_timers.wake_cond);
+    pthread_t thread = g_timers.thread;
+    g_timers.started = false;
+    pthread_mutex_unlock(&g_timers.mutex);
+
+    pthread_join(thread, NULL);
+
+    pthread_mutex_lock(&g_timers.mutex);
+    if (g_timers.count == 0 && !g_timers.started) {
+        free(g_timers.heap);
+        g_timers.heap = NULL;
+        g_timers.capacity = 0;
+    }
+    pthread_mutex_unlock(&g_timers.mutex);
+}
+
+/* ============================================================================
+ * Pending Request Tracking
+ * ============================================================================ */
+
+static ur_rpc_response_t* response_from_cjson(const cJSON* json);
+static void pending_timer_arm(ur_rpc_client_t* client);
+static bool payload_is_cbor(const char* payload, size_t payload_len);
+static cJSON* scratch_parse(const char* payload, size_t payload_len, bool* scratch);
+static void scratch_release(cJSON* json, bool scratch);
+static bool arena_owns(const ur_rpc_arena_t* arena, const void* pointer);
+
+/* FNV-1a */
+static size_t pending_hash(const char* transaction_id) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)transaction_id; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static ur_rpc_pending_request_t** pending_slot(ur_rpc_client_t* client, const char* transaction_id) {
+    ur_rpc_pending_request_t** slot = &client->pending_buckets[pending_hash(transaction_id) & (client->pending_bucket_count - 1)];
+    while (*slot && strcmp((*slot)->transaction_id, transaction_id) != 0) {
+        slot = &(*slot)->next;
+    }
+    return slot;
+}
+
+/* Doubles the bucket array; on allocation failure the table just stays denser */
+static void pending_grow(ur_rpc_client_t* client) {
+    size_t count = client->pending_bucket_count * 2;
+    ur_rpc_pending_request_t** buckets = calloc(count, sizeof(*buckets));
+    if (!buckets) return;
+
+    for (size_t i = 0; i < client->pending_bucket_count; i++) {
+        ur_rpc_pending_request_t* entry = client->pending_buckets[i];
+        while (entry) {
+            ur_rpc_pending_request_t* next = entry->next;
+            size_t index = pending_hash(entry->transaction_id) & (count - 1);
+            entry->next = buckets[index];
+            buckets[index] = entry;
+            entry = next;
+        }
+    }
+
+    free(client->pending_buckets);
+    client->pending_buckets = buckets;
+    client->pending_bucket_count = count;
+}
+
+static void wheel_link(ur_rpc_client_t* client, ur_rpc_pending_request_t* entry) {
+    // First tick at or after the deadline, so the entry is due when visited
+    uint64_t tick = (entry->deadline_ms + UR_RPC_TIMER_TICK_MS - 1) / UR_RPC_TIMER_TICK_MS;
+    if (tick <= client->timer_wheel_tick) {
+        tick = client->timer_wheel_tick + 1;
+    }
+
+    entry->wheel_slot = (unsigned int)(tick & (UR_RPC_TIMER_WHEEL_SLOTS - 1));
+    ur_rpc_pending_request_t** head = &client->timer_wheel[entry->wheel_slot];
+    entry->wheel_prev = NULL;
+    entry->wheel_next = *head;
+    if (*head) (*head)->wheel_prev = entry;
+    *head = entry;
+}
+
+static void wheel_unlink(ur_rpc_client_t* client, ur_rpc_pending_request_t* entry) {
+    if (entry->wheel_prev) {
+        entry->wheel_prev->wheel_next = entry->wheel_next;
+    } else {
+        client->timer_wheel[entry->wheel_slot] = entry->wheel_next;
+    }
+    if (entry->wheel_next) entry->wheel_next->wheel_prev = entry->wheel_prev;
+    entry->wheel_prev = entry->wheel_next = NULL;
+}
+
+/* Caller holds pending_mutex. Fails for a transaction_id already pending. */
+static int pending_insert(ur_rpc_client_t* client, ur_rpc_pending_request_t* entry) {
+    if (client->pending_count >= client->pending_bucket_count) {
+        pending_grow(client);
+    }
+
+    ur_rpc_pending_request_t** slot = pending_slot(client, entry->transaction_id);
+    if (*slot) return UR_RPC_ERROR_INVALID_PARAM;
+
+    entry->next = NULL;
+    *slot = entry;
+    client->pending_count++;
+
+    if (!entry->done_cond) {
+        wheel_link(client, entry);
+        pending_timer_arm(client);
+    }
+    return UR_RPC_SUCCESS;
+}
+
+/* Caller holds pending_mutex. Unlinks from the table and the wheel. */
+static ur_rpc_pending_request_t* pending_remove(ur_rpc_client_t* client, const char* transaction_id) {
+    ur_rpc_pending_request_t** slot = pending_slot(client, transaction_id);
+    ur_rpc_pending_request_t* entry = *slot;
+    if (!entry) return NULL;
+
+    *slot = entry->next;
+    entry->next = NULL;
+    client->pending_count--;
+
+    if (!entry->done_cond) {
+        wheel_unlink(client, entry);
+    }
+    return entry;
+}
+
+/* A chunked response being joined. QoS 1 may deliver a chunk twice, and
+ * out of order across a reconnect, so each is kept in its slot until the
+ * ones before it are in. */
+typedef struct ur_rpc_chunk_buffer {
+    char** pieces;          // By seq, NULL until received
+    size_t* lengths;
+    size_t count;
+    size_t size;            // Bytes of the whole response
+    size_t stored;          // Bytes received so far
+    size_t received;        // Chunks received in order
+    size_t acked;           // received as of the last ack sent
+    size_t window;          // Chunks the server sends unacked
+    char* ack_topic;
+} ur_rpc_chunk_buffer_t;
+
+static void chunk_buffer_free(ur_rpc_chunk_buffer_t* buffer) {
+    if (!buffer) return;
+    if (buffer->pieces) {
+        for (size_t i = 0; i < buffer->count; i++) free(buffer->pieces[i]);
+    }
+    free(buffer->pieces);
+    free(buffer->lengths);
+    free(buffer->ack_topic);
+    free(buffer);
+}
+
+static void pending_free(ur_rpc_pending_request_t* entry) {
+    chunk_buffer_free(entry->chunks);
+    free(entry->transaction_id);
+    free(entry->response_topic);
+    free(entry);
+}
+
+static void pending_fire_timeout(ur_rpc_pending_request_t* entry) {
+    ur_rpc_response_t* response = ur_rpc_response_create();
+    if (response) {
+        response->transaction_id = strdup(entry->transaction_id);
+        response->success = false;
+        response->error_code = UR_RPC_ERROR_TIMEOUT;
+        response->error_message = strdup("Request timed out");
+    }
+
+    LOG_WARN_SIMPLE("RPC request %s timed out after %d ms", entry->transaction_id, entry->timeout_ms);
+    if (response) {
+        entry->callback(response, entry->user_data);
+        ur_rpc_response_destroy(response);
+    }
+    pending_free(entry);
+}
+
+/* Expires async requests a tick at a time. Each slot holds the entries whose
+ * deadline falls on that tick modulo the wheel size; ones due on a later turn
+ * stay where they are. Runs on the shared timer thread only while requests
+ * are pending. */
+static void pending_timer_tick(void* arg) {
+    ur_rpc_client_t* client = (ur_rpc_client_t*)arg;
+
+    pthread_mutex_lock(&client->pending_mutex);
+    if (client->pending_count == 0 || !ur_atomic_load(&client->timer_running)) {
+        if (client->pending_timer) {
+            ur_rpc_timer_cancel(client->pending_timer);
+            client->pending_timer = 0;
+        }
+        pthread_mutex_unlock(&client->pending_mutex);
+        return;
+    }
+
+    uint64_t now = monotonic_ms();
+    uint64_t now_tick = now / UR_RPC_TIMER_TICK_MS;
+    uint64_t first = client->timer_wheel_tick + 1;
+    if (now_tick >= first + UR_RPC_TIMER_WHEEL_SLOTS) {
+        first = now_tick - UR_RPC_TIMER_WHEEL_SLOTS + 1;
+    }
+
+    ur_rpc_pending_request_t* expired = NULL;
+    for (uint64_t tick = first; tick <= now_tick; tick++) {
+        ur_rpc_pending_request_t* entry = client->timer_wheel[tick & (UR_RPC_TIMER_WHEEL_SLOTS - 1)];
+        while (entry) {
+            ur_rpc_pending_request_t* next = entry->wheel_next;
+            if (entry->deadline_ms <= now) {
+                pending_remove(client, entry->transaction_id);
+                entry->next = expired;
+                expired = entry;
+            }
+            entry = next;
+        }
+    }
+    client->timer_wheel_tick = now_tick;
+    pthread_mutex_unlock(&client->pending_mutex);
+
+    // Callbacks run unlocked so they may issue new calls
+    while (expired) {
+        ur_rpc_pending_request_t* next = expired->next;
+        pending_fire_timeout(expired);
+        expired = next;
+    }
+}
+
+/* Caller holds pending_mutex. Starts ticking when the first async request is
+ * queued; the tick stops itself once nothing is pending. */
+static void pending_timer_arm(ur_rpc_client_t* client) {
+    if (client->pending_timer || !ur_atomic_load(&client->timer_running)) return;
+
+    // Nothing was due while idle; resume with the current tick
+    client->timer_wheel_tick = monotonic_ms() / UR_RPC_TIMER_TICK_MS - 1;
+    client->pending_timer = ur_rpc_timer_schedule(UR_RPC_TIMER_TICK_MS, UR_RPC_TIMER_TICK_MS,
+                                                  pending_timer_tick, client);
+    if (!client->pending_timer) {
+        LOG_ERROR_SIMPLE("Failed to schedule request timeouts");
+    }
+}
+
+/* Caller holds pending_mutex, which this releases, and has taken entry out
+ * of the table */
+static void pending_finish(ur_rpc_client_t* client, ur_rpc_pending_request_t* entry, ur_rpc_response_t* response) {
+    if (entry->done_cond) {
+        entry->response = response;
+        entry->completed = true;
+        pthread_cond_signal(entry->done_cond);
+        pthread_mutex_unlock(&client->pending_mutex);
+        return;
+    }
+    pthread_mutex_unlock(&client->pending_mutex);
+
+    if (response) {
+        entry->callback(response, entry->user_data);
+        ur_rpc_response_destroy(response);
+    }
+    pending_free(entry);
+}
+
+static ur_rpc_chunk_buffer_t* chunk_buffer_create(size_t count, size_t size, size_t window, const char* ack_topic) {
+    ur_rpc_chunk_buffer_t* buffer = calloc(1, sizeof(ur_rpc_chunk_buffer_t));
+    if (!buffer) return NULL;
+    buffer->count = count;
+    buffer->size = size;
+    buffer->window = window > 0 ? window : 1;
+    buffer->pieces = calloc(count, sizeof(char*));
+    buffer->lengths = calloc(count, sizeof(size_t));
+    buffer->ack_topic = ack_topic ? strdup(ack_topic) : NULL;
+    if (!buffer->pieces || !buffer->lengths || (ack_topic && !buffer->ack_topic)) {
+        chunk_buffer_free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+/* The pieces joined and parsed, or a failed response when they do not
+ * make one */
+static ur_rpc_response_t* chunk_buffer_response(const ur_rpc_chunk_buffer_t* buffer, const char* transaction_id) {
+    cJSON* json = NULL;
+    char* text = malloc(buffer->size + 1);
+    bool joined = text != NULL;
+    if (text) {
+        size_t length = 0;
+        for (size_t i = 0; i < buffer->count; i++) {
+            memcpy(text + length, buffer->pieces[i], buffer->lengths[i]);
+            length += buffer->lengths[i];
+        }
+        text[length] = '\0';
+        json = length == buffer->size ? cJSON_ParseWithLength(text, length) : NULL;
+        free(text);
+    }
+
+    ur_rpc_response_t* response = NULL;
+    if (cJSON_IsObject(json)) {
+        response = response_from_cjson(json);
+    } else if ((response = ur_rpc_response_create())) {
+        response->transaction_id = strdup(transaction_id);
+        response->success = false;
+        response->error_code = joined ? UR_RPC_ERROR_JSON : UR_RPC_ERROR_MEMORY;
+        response->error_message = strdup("Chunked response could not be joined");
+    }
+    cJSON_Delete(json);
+    return response;
+}
+
+/* Adds one chunk of a response to the pending request it answers, acks
+ * what has arrived in order once half the sender's window has, and
+ * completes the request with the last one. Returns false when no request
+ * is waiting for it. */
+static bool pending_add_chunk(ur_rpc_client_t* client, const char* transaction_id, const cJSON* chunk,
+                              const cJSON* data) {
+    const cJSON* seq = cJSON_GetObjectItem(chunk, "seq");
+    const cJSON* count = cJSON_GetObjectItem(chunk, "count");
+    const cJSON* size = cJSON_GetObjectItem(chunk, "size");
+    const cJSON* window = cJSON_GetObjectItem(chunk, "window");
+    const cJSON* ack_topic = cJSON_GetObjectItem(chunk, "ack_topic");
+    if (!cJSON_IsNumber(seq) || !cJSON_IsNumber(count) || !cJSON_IsNumber(size) || !cJSON_IsString(data) ||
+        count->valuedouble < 1 || size->valuedouble > UR_RPC_MAX_CHUNKED_RESPONSE ||
+        count->valuedouble > size->valuedouble || seq->valuedouble < 0 || seq->valuedouble >= count->valuedouble) {
+        LOG_WARN_SIMPLE("Malformed response chunk for %s ignored", transaction_id);
+        return false;
+    }
+    size_t index = (size_t)seq->valuedouble;
+
+    pthread_mutex_lock(&client->pending_mutex);
+    ur_rpc_pending_request_t* entry = *pending_slot(client, transaction_id);
+    if (!entry) {
+        pthread_mutex_unlock(&client->pending_mutex);
+        return false;
+    }
+
+    ur_rpc_chunk_buffer_t* buffer = entry->chunks;
+    if (!buffer) {
+        buffer = chunk_buffer_create((size_t)count->valuedouble, (size_t)size->valuedouble,
+                                     cJSON_IsNumber(window) && window->valuedouble >= 1 ? (size_t)window->valuedouble : 1,
+                                     cJSON_IsString(ack_topic) ? ack_topic->valuestring : NULL);
+        entry->chunks = buffer;
+    }
+    size_t length = strlen(data->valuestring);
+    if (!buffer || buffer->count != (size_t)count->valuedouble || buffer->size != (size_t)size->valuedouble ||
+        (!buffer->pieces[index] && length > buffer->size - buffer->stored)) {
+        pthread_mutex_unlock(&client->pending_mutex);
+        LOG_WARN_SIMPLE("Response chunk %zu for %s does not fit, ignored", index, transaction_id);
+        return true;
+    }
+    if (!buffer->pieces[index]) {
+        buffer->pieces[index] = strdup(data->valuestring);
+        if (!buffer->pieces[index]) {
+            pthread_mutex_unlock(&client->pending_mutex);
+            return true;
+        }
+        buffer->lengths[index] = length;
+        buffer->stored += length;
+    }
+    while (buffer->received < buffer->count && buffer->pieces[buffer->received]) {
+        buffer->received++;
+    }
+
+    // Acking half a window at a time keeps the sender from ever waiting
+    // on a full one; the last ack lets it forget the response
+    char* ack = NULL;
+    char* ack_to = NULL;
+    size_t step = buffer->window > 1 ? buffer->window / 2 : 1;
+    if (buffer->ack_topic && buffer->received > buffer->acked &&
+        (buffer->received - buffer->acked >= step || buffer->received == buffer->count)) {
+        cJSON* message = cJSON_CreateObject();
+        cJSON* params = cJSON_CreateObject();
+        cJSON_AddStringToObject(message, "jsonrpc", "2.0");
+        cJSON_AddStringToObject(message, "method", "rpc.chunk_ack");
+        cJSON_AddStringToObject(params, "id", transaction_id);
+        cJSON_AddNumberToObject(params, "received", (double)buffer->received);
+        cJSON_AddItemToObject(message, "params", params);
+        ack = cJSON_PrintUnformatted(message);
+        cJSON_Delete(message);
+        ack_to = strdup(buffer->ack_topic);
+        buffer->acked = buffer->received;
+    }
+
+    if (buffer->received == buffer->count) {
+        pending_remove(client, transaction_id);
+        ur_rpc_response_t* response = chunk_buffer_response(buffer, transaction_id);
+        chunk_buffer_free(buffer);
+        entry->chunks = NULL;
+        pending_finish(client, entry, response);
+    } else {
+        pthread_mutex_unlock(&client->pending_mutex);
+    }
+
+    if (ack && ack_to) {
+        ur_rpc_publish_message(client, ack_to, ack, strlen(ack));
+    }
+    free(ack);
+    free(ack_to);
+    return true;
+}
+
+/* Hands one response object, or one chunk of one, to the request waiting
+ * for it. Returns false when it does not answer a pending request. */
+static bool pending_complete(ur_rpc_client_t* client, const cJSON* json) {
+    // Requests carry a transaction_id too; only answers are matched
+    const cJSON* transaction_id = cJSON_GetObjectItem(json, "transaction_id");
+    if (!cJSON_IsString(transaction_id) || cJSON_GetObjectItem(json, "method")) {
+        return false;
+    }
+
+    const cJSON* chunk = cJSON_GetObjectItem(json, "chunk");
+    if (cJSON_IsObject(chunk)) {
+        return pending_add_chunk(client, transaction_id->valuestring, chunk, cJSON_GetObjectItem(json, "data"));
+    }
+
+    pthread_mutex_lock(&client->pending_mutex);
+    ur_rpc_pending_request_t* entry = pending_remove(client, transaction_id->valuestring);
+    if (!entry) {
+        pthread_mutex_unlock(&client->pending_mutex);
+        return false;
+    }
+
+    pending_finish(client, entry, response_from_cjson(json));
+    return true;
+}
+
+static const char* skip_json_space(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+/* Caller holds pending_mutex. Looks for the transaction_id of a pending
+ * request in the raw payload, so messages that answer nothing (requests,
+ * notifications, other clients' responses) are never parsed. Ids are
+ * matched on their literal form; one it cannot read that way (escaped or
+ * very long) counts as a possible match and is left to the parser. */
+/* CBOR form of the scan below: the text "transaction_id" followed by a
+ * short text value */
+static bool pending_cbor_matches(ur_rpc_client_t* client, const char* payload, size_t payload_len) {
+    static const char key[] = "\x6etransaction_id";
+    const size_t key_len = sizeof(key) - 1;
+    const uint8_t* end = (const uint8_t*)payload + payload_len;
+    const uint8_t* cursor = (const uint8_t*)payload;
+    char id[128];
+
+    while ((size_t)(end - cursor) > key_len) {
+        const uint8_t* found = memchr(cursor, 0x6e, (size_t)(end - cursor));
+        if (!found || (size_t)(end - found) <= key_len) return false;
+        cursor = found + 1;
+        if (memcmp(found, key, key_len) != 0) continue;
+
+        const uint8_t* p = found + key_len;
+        size_t length;
+        if (*p >= 0x60 && *p <= 0x77) {
+            length = *p++ - 0x60;
+        } else if (*p == 0x78 && end - p > 1) {
+            length = p[1];
+            p += 2;
+        } else {
+            continue;   // Not a short text value; the parser will not match it either
+        }
+        if ((size_t)(end - p) < length) return false;
+        if (length >= sizeof(id)) return true;
+
+        memcpy(id, p, length);
+        id[length] = '\0';
+        if (*pending_slot(client, id)) return true;
+        cursor = p + length;
+    }
+    return false;
+}
+
+static bool pending_payload_matches(ur_rpc_client_t* client, const char* payload, size_t payload_len) {
+    if (payload_is_cbor(payload, payload_len)) {
+        return pending_cbor_matches(client, payload, payload_len);
+    }
+
+    static const char key[] = "\"transaction_id\"";
+    const size_t key_len = sizeof(key) - 1;
+    const char* end = payload + payload_len;
+    const char* cursor = payload;
+    char id[128];
+
+    while ((size_t)(end - cursor) > key_len) {
+        const char* quote = memchr(cursor, '"', (size_t)(end - cursor));
+        if (!quote || (size_t)(end - quote) <= key_len) return false;
+        cursor = quote + 1;
+        if (memcmp(quote, key, key_len) != 0) continue;
+
+        const char* p = skip_json_space(quote + key_len, end);
+        if (p == end || *p != ':') continue;
+        p = skip_json_space(p + 1, end);
+        if (p == end || *p != '"') continue;
+
+        const char* value = ++p;
+        while (p < end && *p != '"' && *p != '\\') p++;
+        if (p == end || *p == '\\' || (size_t)(p - value) >= sizeof(id)) return true;
+
+        memcpy(id, value, (size_t)(p - value));
+        id[p - value] = '\0';
+        if (*pending_slot(client, id)) return true;
+        cursor = p + 1;
+    }
+    return false;
+}
+
+/* Matches a response, or each element of a batch response, to its request.
+ * Returns the number of responses delivered. */
+static int pending_dispatch_response(ur_rpc_client_t* client, const char* payload, size_t payload_len) {
+    pthread_mutex_lock(&client->pending_mutex);
+    bool waiting = client->pending_count > 0 && pending_payload_matches(client, payload, payload_len);
+    pthread_mutex_unlock(&client->pending_mutex);
+    if (!waiting) return 0;
+
+    // The tree only lives while it is matched; answers are copied out
+    bool scratch;
+    cJSON* json = scratch_parse(payload, payload_len, &scratch);
+    if (!json) return 0;
+
+    int delivered = 0;
+    if (cJSON_IsArray(json)) {
+        const cJSON* item = NULL;
+        cJSON_ArrayForEach(item, json) {
+            if (pending_complete(client, item)) delivered++;
+        }
+    } else if (pending_complete(client, json)) {
+        delivered = 1;
+    }
+
+    scratch_release(json, scratch);
+    return delivered;
+}
+
+/* Registers an async request before it is published, so a fast response
+ * cannot be missed */
+static int pending_register_async(ur_rpc_client_t* client, const ur_rpc_request_t* request,
+                                  ur_rpc_response_handler_t callback, void* user_data) {
+    ur_rpc_pending_request_t* pending = calloc(1, sizeof(ur_rpc_pending_request_t));
+    if (pending) {
+        int timeout_ms = request->timeout_ms > 0 ? request->timeout_ms : UR_RPC_DEFAULT_TIMEOUT_MS;
+        pending->transaction_id = strdup(request->transaction_id);
+        pending->response_topic = ur_rpc_generate_response_topic(client, request->method, request->service, request->transaction_id);
+        pending->callback = callback;
+        pending->user_data = user_data;
+        pending->created_time = time(NULL);
+        pending->timeout_ms = timeout_ms;
+        pending->deadline_ms = monotonic_ms() + (uint64_t)timeout_ms;
+    }
+    if (!pending || !pending->transaction_id) {
+        if (pending) pending_free(pending);
+        return UR_RPC_ERROR_MEMORY;
+    }
+
+    pthread_mutex_lock(&client->pending_mutex);
+    int result = pending_insert(client, pending);
+    pthread_mutex_unlock(&client->pending_mutex);
+    if (result != UR_RPC_SUCCESS) {
+        LOG_ERROR_SIMPLE("Transaction %s is already pending", request->transaction_id);
+        pending_free(pending);
+    }
+    return result;
+}
+
+/* Drops a registered request whose publish failed */
+static void pending_cancel(ur_rpc_client_t* client, const char* transaction_id) {
+    pthread_mutex_lock(&client->pending_mutex);
+    ur_rpc_pending_request_t* pending = pending_remove(client, transaction_id);
+    pthread_mutex_unlock(&client->pending_mutex);
+    if (pending) pending_free(pending);
+}
+
+/* ============================================================================
+ * JSON Encoding
+ * ============================================================================ */
+
+/* Compact JSON written straight into a buffer. A fixed writer fails once the
+ * caller's buffer is full; otherwise the buffer grows as needed. Caller
+ * supplied cJSON values (params, result) are printed in place, never copied. */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    bool fixed;
+    bool failed;
+} json_writer_t;
+
+static bool jw_reserve(json_writer_t* w, size_t extra) {
+    if (w->failed) return false;
+
+    size_t needed = w->length + extra + 1;   // Room for the terminator
+    if (needed <= w->capacity) return true;
+    if (w->fixed) {
+        w->failed = true;
+        return false;
+    }
+
+    size_t capacity = w->capacity ? w->capacity : 256;
+    while (capacity < needed) capacity *= 2;
+    char* data = realloc(w->data, capacity);
+    if (!data) {
+        w->failed = true;
+        return false;
+    }
+    w->data = data;
+    w->capacity = capacity;
+    return true;
+}
+
+static void jw_append(json_writer_t* w, const char* s, size_t n) {
+    if (!jw_reserve(w, n)) return;
+    memcpy(w->data + w->length, s, n);
+    w->length += n;
+    w->data[w->length] = '\0';
+}
+
+static void jw_char(json_writer_t* w, char c) {
+    jw_append(w, &c, 1);
+}
+
+static void jw_string(json_writer_t* w, const char* s) {
+    static const char hex[] = "0123456789abcdef";
+
+    jw_char(w, '"');
+    const char* run = s;
+    for (const char* p = s; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        jw_append(w, run, (size_t)(p - run));
+        run = p + 1;
+        switch (c) {
+            case '"':  jw_append(w, "\\\"", 2); break;
+            case '\\': jw_append(w, "\\\\", 2); break;
+            case '\b': jw_append(w, "\\b", 2); break;
+            case '\f': jw_append(w, "\\f", 2); break;
+            case '\n': jw_append(w, "\\n", 2); break;
+            case '\r': jw_append(w, "\\r", 2); break;
+            case '\t': jw_append(w, "\\t", 2); break;
+            default: {
+                char escaped[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0f] };
+                jw_append(w, escaped, sizeof(escaped));
+                break;
+            }
+        }
+    }
+    jw_append(w, run, strlen(run));
+    jw_char(w, '"');
+}
+
+/* Object member name, with the separating comma after the first member */
+static void jw_key(json_writer_t* w, const char* key) {
+    if (w->length > 0 && w->data[w->length - 1] != '{') jw_char(w, ',');
+    jw_string(w, key);
+    jw_char(w, ':');
+}
+
+static void jw_int(json_writer_t* w, long long value) {
+    char number[24];
+    int n = snprintf(number, sizeof(number), "%lld", value);
+    jw_append(w, number, (size_t)n);
+}
+
+static void jw_uint64(json_writer_t* w, uint64_t value) {
+    char number[24];
+    int n = snprintf(number, sizeof(number), "%llu", (unsigned long long)value);
+    jw_append(w, number, (size_t)n);
+}
+
+static void jw_bool(json_writer_t* w, bool value) {
+    if (value) jw_append(w, "true", 4);
+    else jw_append(w, "false", 5);
+}
+
+static void jw_cjson(json_writer_t* w, const cJSON* item) {
+    // cJSON_PrintPreallocated needs a few spare bytes beyond the output
+    for (;;) {
+        if (w->failed) return;
+
+        size_t room = w->capacity - w->length;
+        if (room > 8 && room <= INT_MAX &&
+            cJSON_PrintPreallocated((cJSON*)item, w->data + w->length, (int)room, false)) {
+            w->length += strlen(w->data + w->length);
+            return;
+        }
+        if (w->fixed) {
+            w->failed = true;
+            if (w->length < w->capacity) w->data[w->length] = '\0';
+            return;
+        }
+        jw_reserve(w, room * 2 + 256);
+    }
+}
+
+/* Hands a growable writer's buffer to the caller, NULL on failure */
+static char* jw_take(json_writer_t* w) {
+    if (w->failed || !w->data) {
+        free(w->data);
+        return NULL;
+    }
+    return w->data;
+}
+
+/* Per-thread buffer for the publish paths. mosquitto copies the payload, so
+ * it can be reused as soon as the publish returns. */
+#define UR_RPC_POOLED_JSON_MAX (64 * 1024)
+
+static pthread_key_t pooled_writer_key;
+static pthread_once_t pooled_writer_once = PTHREAD_ONCE_INIT;
+
+static void pooled_writer_free(void* arg) {
+    json_writer_t* w = (json_writer_t*)arg;
+    free(w->data);
+    free(w);
+}
+
+static void pooled_writer_key_create(void) {
+    pthread_key_create(&pooled_writer_key, pooled_writer_free);
+}
+
+static json_writer_t* jw_pooled(void) {
+    pthread_once(&pooled_writer_once, pooled_writer_key_create);
+
+    json_writer_t* w = pthread_getspecific(pooled_writer_key);
+    if (!w) {
+        w = calloc(1, sizeof(json_writer_t));
+        if (!w) return NULL;
+        pthread_setspecific(pooled_writer_key, w);
+    }
+    w->length = 0;
+    w->failed = false;
+    return w;
+}
+
+/* An unusually large payload does not stay pinned to the thread */
+static void jw_pooled_release(json_writer_t* w) {
+    if (w && w->capacity > UR_RPC_POOLED_JSON_MAX) {
+        free(w->data);
+        w->data = NULL;
+        w->capacity = 0;
+    }
+}
+
+/* chunk_window > 0 offers to take a large response in chunks */
+static void request_write(json_writer_t* w, const ur_rpc_request_t* request, int chunk_window) {
+    jw_char(w, '{');
+    jw_key(w, "method");
+    jw_string(w, request->method ? request->method : "unknown");
+    jw_key(w, "service");
+    jw_string(w, request->service ? request->service : "default");
+    jw_key(w, "transaction_id");
+    jw_string(w, request->transaction_id ? request->transaction_id : "");
+    jw_key(w, "authority");
+    jw_int(w, request->authority);
+    jw_key(w, "timeout_ms");
+    jw_int(w, request->timeout_ms);
+    if (chunk_window > 0) {
+        jw_key(w, "chunk_window");
+        jw_int(w, chunk_window);
+    }
+    if (request->params) {
+        jw_key(w, "params");
+        jw_cjson(w, request->params);
+    }
+    jw_char(w, '}');
+}
+
+static void response_write(json_writer_t* w, const ur_rpc_response_t* response) {
+    jw_char(w, '{');
+    jw_key(w, "transaction_id");
+    jw_string(w, response->transaction_id ? response->transaction_id : "");
+    jw_key(w, "success");
+    jw_bool(w, response->success);
+    jw_key(w, "timestamp");
+    jw_uint64(w, response->timestamp);
+    jw_key(w, "error_code");
+    jw_int(w, response->error_code);
+    jw_key(w, "processing_time_ms");
+    jw_uint64(w, response->processing_time_ms);
+    if (response->error_message) {
+        jw_key(w, "error_message");
+        jw_string(w, response->error_message);
+    }
+    if (response->result) {
+        jw_key(w, "result");
+        jw_cjson(w, response->result);
+    }
+    jw_char(w, '}');
+}
+
+static void notification_write(json_writer_t* w, const char* method, const char* service,
+                               ur_rpc_authority_t authority, const cJSON* params) {
+    jw_char(w, '{');
+    jw_key(w, "method");
+    jw_string(w, method);
+    jw_key(w, "service");
+    jw_string(w, service);
+    jw_key(w, "authority");
+    jw_string(w, ur_rpc_authority_to_string(authority));
+    jw_key(w, "timestamp");
+    jw_uint64(w, ur_rpc_get_timestamp_ms());
+    jw_key(w, "type");
+    jw_string(w, "notification");
+    if (params) {
+        jw_key(w, "params");
+        jw_cjson(w, params);
+    }
+    jw_char(w, '}');
+}
+
+/* ============================================================================
+ * CBOR Encoding
+ * ============================================================================ */
+
+/* CBOR (RFC 8949) forms of the writers above, written into the same kind of
+ * buffer and carrying the same fields. Whole numbers go out as integers,
+ * others as doubles. The buffer keeps a trailing NUL like the JSON one, but
+ * payloads may contain NUL bytes: use the length. */
+static void cw_head(json_writer_t* w, uint8_t major, uint64_t value) {
+    uint8_t head[9];
+    size_t n;
+
+    if (value < 24) {
+        head[0] = (uint8_t)(major << 5 | value);
+        n = 1;
+    } else if (value <= 0xFF) {
+        head[0] = (uint8_t)(major << 5 | 24);
+        n = 2;
+    } else if (value <= 0xFFFF) {
+        head[0] = (uint8_t)(major << 5 | 25);
+        n = 3;
+    } else if (value <= 0xFFFFFFFFu) {
+        head[0] = (uint8_t)(major << 5 | 26);
+        n = 5;
+    } else {
+        head[0] = (uint8_t)(major << 5 | 27);
+        n = 9;
+    }
+    for (size_t i = 1; i < n; i++) {
+        head[i] = (uint8_t)(value >> (8 * (n - 1 - i)));
+    }
+    jw_append(w, (const char*)head, n);
+}
+
+static void cw_string(json_writer_t* w, const char* s) {
+    size_t length = strlen(s);
+    cw_head(w, 3, length);
+    jw_append(w, s, length);
+}
+
+static void cw_int(json_writer_t* w, long long value) {
+    if (value >= 0) cw_head(w, 0, (uint64_t)value);
+    else cw_head(w, 1, (uint64_t)(-1 - value));
+}
+
+static void cw_uint64(json_writer_t* w, uint64_t value) {
+    cw_head(w, 0, value);
+}
+
+static void cw_simple(json_writer_t* w, uint8_t byte) {
+    jw_append(w, (const char*)&byte, 1);
+}
+
+static void cw_bool(json_writer_t* w, bool value) {
+    cw_simple(w, value ? 0xF5 : 0xF4);
+}
+
+static void cw_double(json_writer_t* w, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    cw_simple(w, 0xFB);
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    jw_append(w, (const char*)bytes, sizeof(bytes));
+}
+
+static void cw_cjson(json_writer_t* w, const cJSON* item) {
+    switch (item->type & 0xFF) {
+        case cJSON_False: cw_bool(w, false); break;
+        case cJSON_True:  cw_bool(w, true); break;
+        case cJSON_Number: {
+            double value = item->valuedouble;
+            if (value >= -9.2e18 && value <= 9.2e18 && (double)(long long)value == value) {
+                cw_int(w, (long long)value);
+            } else {
+                cw_double(w, value);
+            }
+            break;
+        }
+        case cJSON_String:
+        case cJSON_Raw:
+            cw_string(w, item->valuestring ? item->valuestring : "");
+            break;
+        case cJSON_Array:
+        case cJSON_Object: {
+            bool object = (item->type & 0xFF) == cJSON_Object;
+            uint64_t count = 0;
+            for (const cJSON* child = item->child; child; child = child->next) count++;
+            cw_head(w, object ? 5 : 4, count);
+            for (const cJSON* child = item->child; child; child = child->next) {
+                if (object) cw_string(w, child->string ? child->string : "");
+                cw_cjson(w, child);
+            }
+            break;
+        }
+        default:
+            cw_simple(w, 0xF6);   // null
+            break;
+    }
+}
+
+static void request_write_cbor(json_writer_t* w, const ur_rpc_request_t* request, int chunk_window) {
+    cw_head(w, 5, 5 + (chunk_window > 0 ? 1 : 0) + (request->params ? 1 : 0));
+    cw_string(w, "method");
+    cw_string(w, request->method ? request->method : "unknown");
+    cw_string(w, "service");
+    cw_string(w, request->service ? request->service : "default");
+    cw_string(w, "transaction_id");
+    cw_string(w, request->transaction_id ? request->transaction_id : "");
+    cw_string(w, "authority");
+    cw_int(w, request->authority);
+    cw_string(w, "timeout_ms");
+    cw_int(w, request->timeout_ms);
+    if (chunk_window > 0) {
+        cw_string(w, "chunk_window");
+        cw_int(w, chunk_window);
+    }
+    if (request->params) {
+        cw_string(w, "params");
+        cw_cjson(w, request->params);
+    }
+}
+
+static void response_write_cbor(json_writer_t* w, const ur_rpc_response_t* response) {
+    cw_head(w, 5, 5 + (response->error_message ? 1 : 0) + (response->result ? 1 : 0));
+    cw_string(w, "transaction_id");
+    cw_string(w, response->transaction_id ? response->transaction_id : "");
+    cw_string(w, "success");
+    cw_bool(w, response->success);
+    cw_string(w, "timestamp");
+    cw_uint64(w, response->timestamp);
+    cw_string(w, "error_code");
+    cw_int(w, response->error_code);
+    cw_string(w, "processing_time_ms");
+    cw_uint64(w, response->processing_time_ms);
+    if (response->error_message) {
+        cw_string(w, "error_message");
+        cw_string(w, response->error_message);
+    }
+    if (response->result) {
+        cw_string(w, "result");
+        cw_cjson(w, response->result);
+    }
+}
+
+static void notification_write_cbor(json_writer_t* w, const char* method, const char* service,
+                                    ur_rpc_authority_t authority, const cJSON* params) {
+    cw_head(w, 5, params ? 6 : 5);
+    cw_string(w, "method");
+    cw_string(w, method);
+    cw_string(w, "service");
+    cw_string(w, service);
+    cw_string(w, "authority");
+    cw_string(w, ur_rpc_authority_to_string(authority));
+    cw_string(w, "timestamp");
+    cw_uint64(w, ur_rpc_get_timestamp_ms());
+    cw_string(w, "type");
+    cw_string(w, "notification");
+    if (params) {
+        cw_string(w, "params");
+        cw_cjson(w, params);
+    }
+}
+
+static void request_encode(json_writer_t* w, const ur_rpc_request_t* request, const ur_rpc_client_config_t* config) {
+    if (config->payload_encoding == UR_RPC_ENCODING_CBOR) request_write_cbor(w, request, config->chunk_window);
+    else request_write(w, request, config->chunk_window);
+}
+
+/* Array framing for batches: definite-length CBOR arrays would need the
+ * count up front, so CBOR batches use the indefinite form (0x9F ... 0xFF) */
+static void batch_open(json_writer_t* w, ur_rpc_encoding_t encoding) {
+    if (encoding == UR_RPC_ENCODING_CBOR) cw_simple(w, 0x9F);
+    else jw_char(w, '[');
+}
+
+static void batch_separator(json_writer_t* w, ur_rpc_encoding_t encoding) {
+    if (encoding != UR_RPC_ENCODING_CBOR) jw_char(w, ',');
+}
+
+static void batch_close(json_writer_t* w, ur_rpc_encoding_t encoding) {
+    if (encoding == UR_RPC_ENCODING_CBOR) cw_simple(w, 0xFF);
+    else jw_char(w, ']');
+}
+
+static bool payload_is_cbor(const char* payload, size_t payload_len) {
+    if (payload_len == 0) return false;
+    uint8_t first = (uint8_t)payload[0];
+    return first >= 0x80 && first <= 0xBF;
+}
+
+/* CBOR to cJSON. Definite and indefinite arrays and maps, text keys,
+ * integers, floats of every width and the simple values; tags are skipped.
+ * Byte strings and indefinite text have no cJSON form and fail the parse. */
+typedef struct {
+    const uint8_t* p;
+    const uint8_t* end;
+    int depth;
+} cbor_reader_t;
+
+#define CBOR_INDEFINITE UINT64_MAX
+
+static bool cr_head(cbor_reader_t* r, uint8_t* major, uint8_t* info, uint64_t* value) {
+    if (r->p >= r->end) return false;
+    uint8_t initial = *r->p++;
+    *major = initial >> 5;
+    *info = initial & 0x1F;
+
+    if (*info < 24) {
+        *value = *info;
+        return true;
+    }
+    if (*info == 31) {
+        *value = CBOR_INDEFINITE;
+        return *major >= 2 && *major != 6;
+    }
+    if (*info > 27) return false;
+
+    size_t n = (size_t)1 << (*info - 24);
+    if ((size_t)(r->end - r->p) < n) return false;
+    *value = 0;
+    for (size_t i = 0; i < n; i++) {
+        *value = *value << 8 | r->p[i];
+    }
+    r->p += n;
+    return true;
+}
+
+static bool cr_break(cbor_reader_t* r) {
+    if (r->p < r->end && *r->p == 0xFF) {
+        r->p++;
+        return true;
+    }
+    return false;
+}
+
+static double cr_half(uint16_t half) {
+    int exponent = (half >> 10) & 0x1F;
+    int mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0) value = ldexp(mantissa, -24);
+    else if (exponent != 31) value = ldexp(mantissa + 1024, exponent - 25);
+    else value = mantissa == 0 ? INFINITY : NAN;
+    return (half & 0x8000) ? -value : value;
+}
+
+static cJSON* cr_item(cbor_reader_t* r);
+
+static cJSON* cr_container(cbor_reader_t* r, bool object, uint64_t count) {
+    if (++r->depth > CJSON_NESTING_LIMIT) return NULL;
+
+    cJSON* container = object ? cJSON_CreateObject() : cJSON_CreateArray();
+    for (uint64_t i = 0; container && (count == CBOR_INDEFINITE || i < count); i++) {
+        if (count == CBOR_INDEFINITE && cr_break(r)) break;
+
+        char* key = NULL;
+        if (object) {
+            uint8_t major, info;
+            uint64_t length;
+            if (!cr_head(r, &major, &info, &length) || major != 3 || length == CBOR_INDEFINITE ||
+                length > (uint64_t)(r->end - r->p) || !(key = malloc((size_t)length + 1))) {
+                cJSON_Delete(container);
+                return NULL;
+            }
+            memcpy(key, r->p, (size_t)length);
+            key[length] = '\0';
+            r->p += length;
+        }
+
+        cJSON* item = cr_item(r);
+        if (!item) {
+            free(key);
+            cJSON_Delete(container);
+            return NULL;
+        }
+        if (object) cJSON_AddItemToObject(container, key, item);
+        else cJSON_AddItemToArray(container, item);
+        free(key);
+    }
+
+    r->depth--;
+    return container;
+}
+
+static cJSON* cr_item(cbor_reader_t* r) {
+    uint8_t major, info;
+    uint64_t value;
+
+    // Tags only annotate the item that follows
+    do {
+        if (!cr_head(r, &major, &info, &value)) return NULL;
+    } while (major == 6);
+
+    switch (major) {
+        case 0:
+            return cJSON_CreateNumber((double)value);
+        case 1:
+            return cJSON_CreateNumber(-1.0 - (double)value);
+        case 3: {
+            if (value == CBOR_INDEFINITE || value > (uint64_t)(r->end - r->p)) return NULL;
+            char stack[128];
+            char* text = value < sizeof(stack) ? stack : malloc((size_t)value + 1);
+            if (!text) return NULL;
+            memcpy(text, r->p, (size_t)value);
+            text[value] = '\0';
+            r->p += value;
+            cJSON* item = cJSON_CreateString(text);
+            if (text != stack) free(text);
+            return item;
+        }
+        case 4:
+        case 5:
+            return cr_container(r, major == 5, value);
+        case 7:
+            switch (info) {
+                case 20: return cJSON_CreateFalse();
+                case 21: return cJSON_CreateTrue();
+                case 22:
+                case 23: return cJSON_CreateNull();
+                case 25: return cJSON_CreateNumber(cr_half((uint16_t)value));
+                case 26: {
+                    uint32_t bits = (uint32_t)value;
+                    float number;
+                    memcpy(&number, &bits, sizeof(number));
+                    return cJSON_CreateNumber(number);
+                }
+                case 27: {
+                    double number;
+                    memcpy(&number, &value, sizeof(number));
+                    return cJSON_CreateNumber(number);
+                }
+                default: return NULL;
+            }
+        default:
+            return NULL;   // Byte strings
+    }
+}
+
+cJSON* ur_rpc_payload_parse(const char* payload, size_t payload_len) {
+    if (!payload || payload_len == 0) return NULL;
+    if (!payload_is_cbor(payload, payload_len)) {
+        return cJSON_ParseWithLength(payload, payload_len);
+    }
+
+    cbor_reader_t reader = { (const uint8_t*)payload, (const uint8_t*)payload + payload_len, 0 };
+    cJSON* json = cr_item(&reader);
+    if (json && reader.p != reader.end) {
+        cJSON_Delete(json);   // Trailing bytes
+        json = NULL;
+    }
+    return json;
+}
+
+/* ============================================================================
+ * Notification Coalescing
+ * ============================================================================ */
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/* Publishes a detached buffer and frees it. One notification goes out as
+ * before; several as an array. The buffer holds "[a,b,..." (JSON) or
+ * 0x9F a b ... (CBOR), so a lone notification just drops the first byte. */
+static int notify_publish(ur_rpc_client_t* client, ur_rpc_notify_buffer_t* buffer) {
+    int count = buffer->count;
+    const char* payload = buffer->payload;
+    size_t length = buffer->length;
+    if (count == 0) {
+        payload = NULL;   // Only the failed first append ever landed here
+    } else if (count == 1) {
+        payload++;
+        length--;
+    } else {
+        json_writer_t w = { buffer->payload, buffer->length, buffer->capacity, false, false };
+        batch_close(&w, client->config.payload_encoding);
+        buffer->payload = w.data;
+        buffer->capacity = w.capacity;
+        payload = w.failed ? NULL : w.data;
+        length = w.length;
+    }
+
+    int result = count == 0 ? UR_RPC_SUCCESS : UR_RPC_ERROR_JSON;
+    if (payload) {
+        result = ur_rpc_publish_message(client, buffer->topic, payload, length);
+        if (result == UR_RPC_SUCCESS) {
+            LOG_DEBUG_SIMPLE("Published %d coalesced notification(s) to topic: %s", count, buffer->topic);
+        } else {
+            LOG_ERROR_SIMPLE("Failed to publish %d notification(s) to broker (error: %d)", count, result);
+        }
+    }
+
+    free(buffer->topic);
+    free(buffer->payload);
+    memset(buffer, 0, sizeof(ur_rpc_notify_buffer_t));
+    return result;
+}
+
+/* Caller holds notify_mutex. Moves buffer index out of the table. */
+static ur_rpc_notify_buffer_t notify_detach(ur_rpc_client_t* client, int index) {
+    ur_rpc_notify_buffer_t buffer = client->notify_buffers[index];
+    client->notify_buffers[index] = client->notify_buffers[--client->notify_buffer_count];
+    memset(&client->notify_buffers[client->notify_buffer_count], 0, sizeof(ur_rpc_notify_buffer_t));
+    return buffer;
+}
+
+/* Appends an encoded notification to its topic's buffer. Full buffers, and
+ * the oldest one when every slot is taken, are published on the way out. */
+static int notify_enqueue(ur_rpc_client_t* client, const char* topic, const char* encoded, size_t length) {
+    ur_rpc_notify_buffer_t ready[2];
+    int ready_count = 0;
+
+    pthread_mutex_lock(&client->notify_mutex);
+
+    int index = -1;
+    for (int i = 0; i < client->notify_buffer_count; i++) {
+        if (strcmp(client->notify_buffers[i].topic, topic) == 0) {
+            index = i;
+            break;
+        }
+    }
+
+    if (index < 0) {
+        if (client->notify_buffer_count == UR_RPC_MAX_NOTIFY_TOPICS) {
+            int oldest = 0;
+            for (int i = 1; i < client->notify_buffer_count; i++) {
+                if (client->notify_buffers[i].first_queued_us < client->notify_buffers[oldest].first_queued_us) {
+                    oldest = i;
+                }
+            }
+            ready[ready_count++] = notify_detach(client, oldest);
+        }
+
+        ur_rpc_notify_buffer_t* buffer = &client->notify_buffers[client->notify_buffer_count];
+        buffer->topic = strdup(topic);
+        if (!buffer->topic) {
+            pthread_mutex_unlock(&client->notify_mutex);
+            for (int i = 0; i < ready_count; i++) notify_publish(client, &ready[i]);
+            return UR_RPC_ERROR_MEMORY;
+        }
+        buffer->first_queued_us = monotonic_us();
+        index = client->notify_buffer_count++;
+
+        // The flusher sleeps while nothing is queued
+        pthread_cond_signal(&client->notify_cond);
+    }
+
+    ur_rpc_notify_buffer_t* buffer = &client->notify_buffers[index];
+    json_writer_t w = { buffer->payload, buffer->length, buffer->capacity, false, false };
+    if (buffer->count == 0) batch_open(&w, client->config.payload_encoding);
+    else batch_separator(&w, client->config.payload_encoding);
+    jw_append(&w, encoded, length);
+    buffer->payload = w.data;
+    buffer->capacity = w.capacity;
+
+    int result = UR_RPC_SUCCESS;
+    if (w.failed) {
+        // Keep what was queued before; the partial append is dropped
+        result = UR_RPC_ERROR_MEMORY;
+    } else {
+        buffer->length = w.length;
+        buffer->count++;
+    }
+    if (buffer->count >= client->config.notification_batch.max_messages) {
+        ready[ready_count++] = notify_detach(client, index);
+    }
+
+    pthread_mutex_unlock(&client->notify_mutex);
+
+    for (int i = 0; i < ready_count; i++) {
+        int publish_result = notify_publish(client, &ready[i]);
+        if (publish_result != UR_RPC_SUCCESS) result = publish_result;
+    }
+    return result;
+}
+
+/* Publishes each buffer once its oldest notification is max_delay_us old */
+static void* notify_flush_thread(void* arg) {
+    ur_rpc_client_t* client = (ur_rpc_client_t*)arg;
+    uint64_t delay_us = (uint64_t)client->config.notification_batch.max_delay_us;
+
+    pthread_mutex_lock(&client->notify_mutex);
+    while (ur_atomic_load(&client->notify_running)) {
+        if (client->notify_buffer_count == 0) {
+            pthread_cond_wait(&client->notify_cond, &client->notify_mutex);
+            continue;
+        }
+
+        uint64_t now = monotonic_us();
+        uint64_t next_due = UINT64_MAX;
+        ur_rpc_notify_buffer_t ready[UR_RPC_MAX_NOTIFY_TOPICS];
+        int ready_count = 0;
+        for (int i = 0; i < client->notify_buffer_count;) {
+            uint64_t due = client->notify_buffers[i].first_queued_us + delay_us;
+            if (due <= now) {
+                ready[ready_count++] = notify_detach(client, i);
+                continue;
+            }
+            if (due < next_due) next_due = due;
+            i++;
+        }
+
+        if (ready_count > 0) {
+            pthread_mutex_unlock(&client->notify_mutex);
+            for (int i = 0; i < ready_count; i++) {
+                notify_publish(client, &ready[i]);
+            }
+            pthread_mutex_lock(&client->notify_mutex);
+            continue;
+        }
+
+        struct timespec wake;
+        wake.tv_sec = (time_t)(next_due / 1000000);
+        wake.tv_nsec = (long)(next_due % 1000000) * 1000;
+        pthread_cond_timedwait(&client->notify_cond, &client->notify_mutex, &wake);
+    }
+    pthread_mutex_unlock(&client->notify_mutex);
+
+    return NULL;
+}
+
+int ur_rpc_flush_notifications(ur_rpc_client_t* client) {
+    if (!client) return UR_RPC_ERROR_INVALID_PARAM;
+
+    ur_rpc_notify_buffer_t ready[UR_RPC_MAX_NOTIFY_TOPICS];
+    int ready_count = 0;
+
+    pthread_mutex_lock(&client->notify_mutex);
+    while (client->notify_buffer_count > 0) {
+        ready[ready_count++] = notify_detach(client, client->notify_buffer_count - 1);
+    }
+    pthread_mutex_unlock(&client->notify_mutex);
+
+    int result = UR_RPC_SUCCESS;
+    for (int i = 0; i < ready_count; i++) {
+        int publish_result = ur_atomic_load(&client->connected) ? notify_publish(client, &ready[i])
+                                                                 : UR_RPC_ERROR_NOT_CONNECTED;
+        if (publish_result == UR_RPC_ERROR_NOT_CONNECTED) {
+            free(ready[i].topic);
+            free(ready[i].payload);
+        }
+        if (publish_result != UR_RPC_SUCCESS) result = publish_result;
+    }
+    return result;
+}
+
 /* MQTT Callback Functions */
 
+/* Statistics are relaxed atomics so the mosquitto loop thread never takes
+ * client->mutex for bookkeeping; last_activity is only written when the
+ * second changes. */
+static void touch_activity(ur_rpc_client_t* client) {
+    time_t now = time(NULL);
+    if (ur_atomic_load_relaxed(&client->last_activity) != now) {
+        ur_atomic_store_relaxed(&client->last_activity, now);
+    }
+}
+
+/* ============================================================================
+ * Publish Window
+ * ============================================================================ */
+
+/* Wakes windowed publishers once the window has room and, if one was turned
+ * away, reports the freed capacity. Called with window_mutex held; returns
+ * true when the capacity callback is due, to be run after unlocking. */
+static bool window_signal_locked(ur_rpc_client_t* client) {
+    int window = client->config.publish_window;
+    if (window > 0 && client->outstanding >= window) return false;
+
+    if (client->window_waiters > 0) pthread_cond_broadcast(&client->window_cond);
+    if (!client->window_full) return false;
+    client->window_full = false;
+    return client->capacity_callback != NULL;
+}
+
+static void window_notify_capacity(ur_rpc_client_t* client) {
+    pthread_mutex_lock(&client->window_mutex);
+    ur_rpc_capacity_callback_t callback = client->capacity_callback;
+    void* user_data = client->capacity_user_data;
+    pthread_mutex_unlock(&client->window_mutex);
+
+    if (callback) callback(user_data);
+}
+
+/* Counts a message about to be handed to mosquitto. Without enforce it is
+ * only counted; internal publishes are never held back. Otherwise a full
+ * window is refused at once for timeout_ms 0, or waited on for timeout_ms
+ * (< 0 without limit). */
+static int window_acquire(ur_rpc_client_t* client, int timeout_ms, bool enforce) {
+    pthread_mutex_lock(&client->window_mutex);
+
+    int window = client->config.publish_window;
+    if (enforce && window > 0 && client->outstanding >= window) {
+        if (timeout_ms == 0) {
+            client->window_full = true;
+            pthread_mutex_unlock(&client->window_mutex);
+            ur_atomic_add_relaxed(&client->publish_would_block, 1);
+            return UR_RPC_ERROR_WOULD_BLOCK;
+        }
+
+        struct timespec deadline;
+        if (timeout_ms > 0) monotonic_timespec(monotonic_ms() + (uint64_t)timeout_ms, &deadline);
+
+        client->window_waiters++;
+        int wait_result = 0;
+        while (client->outstanding >= window && ur_atomic_load(&client->connected) && wait_result != ETIMEDOUT) {
+            if (timeout_ms > 0) {
+                wait_result = pthread_cond_timedwait(&client->window_cond, &client->window_mutex, &deadline);
+            } else {
+                pthread_cond_wait(&client->window_cond, &client->window_mutex);
+            }
+        }
+        client->window_waiters--;
+
+        if (!ur_atomic_load(&client->connected)) {
+            pthread_mutex_unlock(&client->window_mutex);
+            return UR_RPC_ERROR_NOT_CONNECTED;
+        }
+        if (client->outstanding >= window) {
+            client->window_full = true;
+            pthread_mutex_unlock(&client->window_mutex);
+            ur_atomic_add_relaxed(&client->publish_would_block, 1);
+            return UR_RPC_ERROR_WOULD_BLOCK;
+        }
+    }
+
+    client->outstanding++;
+    if (client->outstanding > client->peak_outstanding) {
+        client->peak_outstanding = client->outstanding;
+    }
+    pthread_mutex_unlock(&client->window_mutex);
+    return UR_RPC_SUCCESS;
+}
+
+/* A counted message completed, or never made it into mosquitto */
+static void window_release(ur_rpc_client_t* client) {
+    pthread_mutex_lock(&client->window_mutex);
+    if (client->outstanding > 0) client->outstanding--;
+    bool notify = window_signal_locked(client);
+    pthread_mutex_unlock(&client->window_mutex);
+
+    if (notify) window_notify_capacity(client);
+}
+
+/* A reconnect drops QoS 0 packets that were never written, without a
+ * publish callback, while QoS 1 and 2 messages stay queued and are sent
+ * again. Recount from what mosquitto still holds so they don't leak. */
+static void window_reset(ur_rpc_client_t* client) {
+    pthread_mutex_lock(&client->window_mutex);
+    client->outstanding = mosquitto_out_queue_len(client->mosq);
+    bool notify = window_signal_locked(client);
+    pthread_mutex_unlock(&client->window_mutex);
+
+    if (notify) window_notify_capacity(client);
+}
+
 static void on_connect_callback(struct mosquitto *mosq, void *obj, int rc) {
     ur_rpc_client_t *client = (ur_rpc_client_t *)obj;
     if (!client) return;
@@ -17,7 +1696,7 @@ static void on_connect_callback(struct mosquitto *mosq, void *obj, int rc) {
     if (rc == MOSQ_ERR_SUCCESS) {
         ur_atomic_store(&client->connected, true);
         client->status = UR_RPC_CONN_CONNECTED;
-        client->last_activity = time(NULL);
+        touch_activity(client);
         LOG_INFO_SIMPLE("MQTT connected successfully (rc=%d)", rc);
 
         // Subscribe to topics from json_added_subs configuration
@@ -25,28 +1704,41 @@ static void on_connect_callback(struct mosquitto *mosq, void *obj, int rc) {
         if (sub_topics->topics && sub_topics->count > 0) {
             LOG_INFO_SIMPLE("Subscribing to %d topics from json_added_subs", sub_topics->count);
             for (int i = 0; i < sub_topics->count; i++) {
-                if (sub_topics->topics[i]) {
-                    int sub_result = mosquitto_subscribe(mosq, NULL, sub_topics->topics[i], client->config.qos);
+                char* filter = ur_rpc_config_subscription_filter(&client->config, sub_topics->topics[i]);
+                if (filter) {
+                    int sub_result = mosquitto_subscribe(mosq, NULL, filter, client->config.qos);
                     if (sub_result == MOSQ_ERR_SUCCESS) {
-                        LOG_INFO_SIMPLE("Subscribed to topic: %s (QoS: %d)", sub_topics->topics[i], client->config.qos);
+                        LOG_INFO_SIMPLE("Subscribed to topic: %s (QoS: %d)", filter, client->config.qos);
                     } else {
                         LOG_ERROR_SIMPLE("Failed to subscribe to topic %s: %s", 
-                                       sub_topics->topics[i], mosquitto_strerror(sub_result));
+                                       filter, mosquitto_strerror(sub_result));
                     }
+                    free(filter);
                 }
             }
         } else {
             LOG_INFO_SIMPLE("No subscription topics found in json_added_subs");
         }
+
+        // Our own beats come back through the broker to be timed
+        if (client->config.heartbeat.enabled && client->config.heartbeat.echo && client->config.heartbeat.topic) {
+            int sub_result = mosquitto_subscribe(mosq, NULL, client->config.heartbeat.topic, 0);
+            if (sub_result != MOSQ_ERR_SUCCESS) {
+                LOG_ERROR_SIMPLE("Failed to subscribe to heartbeat echo %s: %s",
+                               client->config.heartbeat.topic, mosquitto_strerror(sub_result));
+            }
+        }
     } else {
         ur_atomic_store(&client->connected, false);
         client->status = UR_RPC_CONN_ERROR;
-        client->errors_count++;
+        ur_atomic_add_relaxed(&client->errors_count, 1);
         LOG_ERROR_SIMPLE("MQTT connection failed (rc=%d)", rc);
     }
 
     pthread_mutex_unlock(&client->mutex);
 
+    if (rc == MOSQ_ERR_SUCCESS) window_reset(client);
+
     /* Call user callback if set */
     if (client->connection_callback) {
         client->connection_callback(client->status, client->connection_user_data);
@@ -72,43 +1764,88 @@ static void on_disconnect_callback(struct mosquitto *mosq, void *obj, int rc) {
         LOG_INFO_SIMPLE("MQTT disconnected gracefully");
     } else {
         client->status = UR_RPC_CONN_ERROR;
-        client->errors_count++;
+        ur_atomic_add_relaxed(&client->errors_count, 1);
         LOG_WARN_SIMPLE("MQTT disconnected unexpectedly (rc=%d - %s)", rc, mosquitto_strerror(rc));
         LOG_WARN_SIMPLE("Disconnect reason: Error code 7 typically means the broker closed the connection");
     }
 
     pthread_mutex_unlock(&client->mutex);
 
+    // Windowed publishers waiting for room give up with NOT_CONNECTED
+    pthread_mutex_lock(&client->window_mutex);
+    if (client->window_waiters > 0) pthread_cond_broadcast(&client->window_cond);
+    pthread_mutex_unlock(&client->window_mutex);
+
     /* Call user callback if set */
     if (client->connection_callback) {
         client->connection_callback(client->status, client->connection_user_data);
     }
 }
 
+/* Times a beat that came back on the heartbeat topic. Only the beat sent
+ * last counts; an older one arriving late was already given up. */
+static void heartbeat_echo(ur_rpc_client_t* client, const char* payload, size_t payload_len) {
+    char text[512];
+    if (payload_len >= sizeof(text)) return;
+    memcpy(text, payload, payload_len);
+    text[payload_len] = '\0';
+
+    const char* seq_field = strstr(text, "\"seq\":");
+    if (!seq_field || !strstr(text, "\"type\":\"heartbeat\"")) return;
+    uint64_t seq = strtoull(seq_field + 6, NULL, 10);
+
+    uint64_t now = monotonic_us();
+    pthread_mutex_lock(&client->mutex);
+    uint64_t sent = seq == client->heartbeat_seq ? client->heartbeat_sent_us : 0;
+    if (sent) client->heartbeat_sent_us = 0;
+    ur_rpc_heartbeat_rtt_callback_t callback = client->heartbeat_rtt_callback;
+    void* user_data = client->heartbeat_rtt_user_data;
+    pthread_mutex_unlock(&client->mutex);
+    if (!sent) return;
+
+    uint64_t rtt_us = now > sent ? now - sent : 0;
+    ur_atomic_add_relaxed(&client->heartbeats_echoed, 1);
+    ur_atomic_store_relaxed(&client->heartbeat_rtt_us, rtt_us);
+    LOG_DEBUG_SIMPLE("Heartbeat %llu echoed in %.3f ms", (unsigned long long)seq, rtt_us / 1000.0);
+
+    if (callback) callback(seq, rtt_us / 1000.0, user_data);
+}
+
 static void on_message_callback(struct mosquitto *mosq, void *obj, const struct mosquitto_message *message) {
     ur_rpc_client_t *client = (ur_rpc_client_t *)obj;
     if (!client || !message || !message->payload) return;
 
-    pthread_mutex_lock(&client->mutex);
-    client->messages_received++;
-    client->last_activity = time(NULL);
-    pthread_mutex_unlock(&client->mutex);
+    ur_atomic_add_relaxed(&client->messages_received, 1);
+    touch_activity(client);
+
+    LOG_DEBUG_SIMPLE("RECEIVED from %s: %.*s", message->topic, message->payloadlen, (char*)message->payload);
+
+    if (client->config.heartbeat.echo && client->config.heartbeat.topic &&
+        strcmp(message->topic, client->config.heartbeat.topic) == 0) {
+        heartbeat_echo(client, (const char*)message->payload, (size_t)message->payloadlen);
+        return;
+    }
+
+    /* Responses to our own calls go to the caller, everything else to the
+     * user message handler */
+    int delivered = pending_dispatch_response(client, (const char*)message->payload, (size_t)message->payloadlen);
+    if (delivered > 0) {
+        ur_atomic_add_relaxed(&client->responses_received, (uint64_t)delivered);
+        return;
+    }
 
     /* Call user message handler if set */
     if (client->message_handler) {
         client->message_handler(message->topic, (const char*)message->payload, message->payloadlen, client->message_user_data);
     }
-
-    LOG_DEBUG_SIMPLE("RECEIVED from %s: %.*s", message->topic, message->payloadlen, (char*)message->payload);
 }
 
 static void on_publish_callback(struct mosquitto *mosq, void *obj, int mid) {
     ur_rpc_client_t *client = (ur_rpc_client_t *)obj;
     if (!client) return;
 
-    pthread_mutex_lock(&client->mutex);
-    client->last_activity = time(NULL);
-    pthread_mutex_unlock(&client->mutex);
+    touch_activity(client);
+    window_release(client);
 
     LOG_DEBUG_SIMPLE("Message published successfully (mid=%d)", mid);
 }
@@ -117,9 +1854,7 @@ static void on_subscribe_callback(struct mosquitto *mosq, void *obj, int mid, in
     ur_rpc_client_t *client = (ur_rpc_client_t *)obj;
     if (!client) return;
 
-    pthread_mutex_lock(&client->mutex);
-    client->last_activity = time(NULL);
-    pthread_mutex_unlock(&client->mutex);
+    touch_activity(client);
 
     LOG_DEBUG_SIMPLE("Subscribed successfully (mid=%d, qos=%d)", mid, granted_qos ? granted_qos[0] : -1);
 }
@@ -159,6 +1894,9 @@ int ur_rpc_init(void) {
     // Initialize random seed for transaction IDs
     srand((unsigned int)time(NULL));
 
+    // Swap cJSON's allocator before client threads start using it
+    ur_rpc_arena_bind_cjson(NULL);
+
     g_library_initialized = true;
     LOG_INFO_SIMPLE("UR-RPC framework initialized successfully");
     pthread_mutex_unlock(&g_init_mutex);
@@ -171,6 +1909,7 @@ void ur_rpc_cleanup(void) {
     if (g_library_initialized) {
         LOG_INFO_SIMPLE("Cleaning up UR-RPC framework");
         mosquitto_lib_cleanup();
+        ur_rpc_timer_shutdown();
         g_library_initialized = false;
         logger_destroy();
     }
@@ -193,6 +1932,7 @@ const char* ur_rpc_error_string(ur_rpc_error_t error) {
         case UR_RPC_ERROR_NOT_CONNECTED: return "Not connected";
         case UR_RPC_ERROR_CONFIG: return "Configuration error";
         case UR_RPC_ERROR_THREAD: return "Thread error";
+        case UR_RPC_ERROR_WOULD_BLOCK: return "Publish window full";
         default: return "Unknown error";
     }
 }
@@ -207,24 +1947,91 @@ uint64_t ur_rpc_get_timestamp_ms(void) {
     return (uint64_t)tv.tv_sec * 1000 + (uint64_t)tv.tv_usec / 1000;
 }
 
+/* Transaction IDs are random version 4 UUIDs from a per-thread
+ * xoshiro256** generator. Every thread seeds its own state from a process
+ * nonce and a thread sequence number, so generation takes no lock, makes no
+ * system call and never allocates. */
+static uint64_t txid_nonce;
+static ur_atomic_u64 txid_thread_seq;
+static pthread_once_t txid_nonce_once = PTHREAD_ONCE_INIT;
+static __thread uint64_t txid_state[4];
+static __thread bool txid_seeded;
+
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t xoshiro256ss(uint64_t s[4]) {
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+static void txid_nonce_init(void) {
+    uint64_t nonce = 0;
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        if (read(fd, &nonce, sizeof(nonce)) != (ssize_t)sizeof(nonce)) nonce = 0;
+        close(fd);
+    }
+    if (nonce == 0) {
+        // No entropy device: boot-relative and wall clock time plus the pid
+        struct timespec mono, real;
+        clock_gettime(CLOCK_MONOTONIC, &mono);
+        clock_gettime(CLOCK_REALTIME, &real);
+        nonce = ((uint64_t)real.tv_sec << 32) ^ (uint64_t)real.tv_nsec ^
+                ((uint64_t)mono.tv_nsec << 20) ^ (uint64_t)mono.tv_sec ^ ((uint64_t)getpid() << 48);
+    }
+    txid_nonce = nonce;
+}
+
+int ur_rpc_format_transaction_id(char* buffer, size_t buffer_size) {
+    static const char hex[] = "0123456789abcdef";
+
+    if (!buffer || buffer_size < UR_RPC_MAX_TRANSACTION_ID_LENGTH) return UR_RPC_ERROR_INVALID_PARAM;
+
+    if (!txid_seeded) {
+        pthread_once(&txid_nonce_once, txid_nonce_init);
+        uint64_t seed = txid_nonce ^ ((ur_atomic_add_relaxed(&txid_thread_seq, 1) + 1) * 0xD1B54A32D192ED03ULL);
+        for (int i = 0; i < 4; i++) txid_state[i] = splitmix64(&seed);
+        txid_seeded = true;
+    }
+
+    uint64_t hi = xoshiro256ss(txid_state);
+    uint64_t lo = xoshiro256ss(txid_state);
+    hi = (hi & ~0xF000ULL) | 0x4000ULL;                     // version 4
+    lo = (lo & ~(0xC000ULL << 48)) | (0x8000ULL << 48);     // RFC 4122 variant
+
+    char* out = buffer;
+    for (int i = 0; i < 16; i++) {
+        uint64_t word = i < 8 ? hi : lo;
+        unsigned int byte = (unsigned int)(word >> (56 - 8 * (i & 7))) & 0xFF;
+        if (i == 4 || i == 6 || i == 8 || i == 10) *out++ = '-';
+        *out++ = hex[byte >> 4];
+        *out++ = hex[byte & 0x0F];
+    }
+    *out = '\0';
+    return UR_RPC_SUCCESS;
+}
+
 char* ur_rpc_generate_transaction_id(void) {
     char* transaction_id = malloc(UR_RPC_MAX_TRANSACTION_ID_LENGTH);
     if (!transaction_id) return NULL;
 
-    // Simple UUID-like generation using timestamp and random
-    uint64_t timestamp = ur_rpc_get_timestamp_ms();
-    int rand1 = rand();
-    int rand2 = rand();
-
-    snprintf(transaction_id, UR_RPC_MAX_TRANSACTION_ID_LENGTH,
-             "%08x-%04x-%04x-%04x-%08x%04x",
-             (unsigned int)(timestamp & 0xFFFFFFFF),
-             (unsigned short)(rand1 & 0xFFFF),
-             (unsigned short)(4000 | (rand1 >> 16 & 0x0FFF)), // version 4
-             (unsigned short)(0x8000 | (rand2 & 0x3FFF)),     // variant
-             (unsigned int)(timestamp >> 32),
-             (unsigned short)(rand2 >> 16 & 0xFFFF));
-
+    ur_rpc_format_transaction_id(transaction_id, UR_RPC_MAX_TRANSACTION_ID_LENGTH);
     return transaction_id;
 }
 
@@ -299,6 +2106,11 @@ ur_rpc_client_config_t* ur_rpc_config_create(void) {
     config->auto_reconnect = true;
     config->reconnect_delay_min = 1;
     config->reconnect_delay_max = 60;
+    config->reconnect_jitter = true;
+    config->shared_group = NULL;
+    config->payload_encoding = UR_RPC_ENCODING_JSON;
+    config->publish_window = 0;
+    config->chunk_window = 0;
 
     // Initialize topic lists
     ur_rpc_topic_list_init(&config->json_added_pubs);
@@ -309,6 +2121,11 @@ ur_rpc_client_config_t* ur_rpc_config_create(void) {
     config->heartbeat.topic = NULL;
     config->heartbeat.interval_seconds = 30;
     config->heartbeat.payload = NULL;
+    config->heartbeat.echo = false;
+
+    // Notifications go out one by one unless batching is configured
+    config->notification_batch.max_messages = 1;
+    config->notification_batch.max_delay_us = 0;
 
     // Initialize relay configuration
     ur_rpc_relay_config_init(&config->relay);
@@ -327,6 +2144,7 @@ void ur_rpc_config_destroy(ur_rpc_client_config_t* config) {
     free(config->cert_file);
     free(config->key_file);
     free(config->tls_version);
+    free(config->shared_group);
 
     // Cleanup topic lists
     ur_rpc_topic_list_cleanup(&config->json_added_pubs);
@@ -448,6 +2266,64 @@ int ur_rpc_config_set_reconnect(ur_rpc_client_config_t* config, bool auto_reconn
     return UR_RPC_SUCCESS;
 }
 
+int ur_rpc_config_set_reconnect_jitter(ur_rpc_client_config_t* config, bool jitter) {
+    if (!config) return UR_RPC_ERROR_INVALID_PARAM;
+
+    config->reconnect_jitter = jitter;
+    return UR_RPC_SUCCESS;
+}
+
+int ur_rpc_config_set_shared_group(ur_rpc_client_config_t* config, const char* group) {
+    if (!config) return UR_RPC_ERROR_INVALID_PARAM;
+    if (group && strpbrk(group, "/+#")) {
+        LOG_ERROR_SIMPLE("Shared subscription group '%s' may not contain '/', '+' or '#'", group);
+        return UR_RPC_ERROR_INVALID_PARAM;
+    }
+
+    free(config->shared_group);
+    config->shared_group = NULL;
+    if (group && group[0]) {
+        config->shared_group = strdup(group);
+        if (!config->shared_group) return UR_RPC_ERROR_MEMORY;
+    }
+    return UR_RPC_SUCCESS;
+}
+
+int ur_rpc_config_set_payload_encoding(ur_rpc_client_config_t* config, ur_rpc_encoding_t encoding) {
+    if (!config || (encoding != UR_RPC_ENCODING_JSON && encoding != UR_RPC_ENCODING_CBOR)) {
+        return UR_RPC_ERROR_INVALID_PARAM;
+    }
+
+    config->payload_encoding = encoding;
+    return UR_RPC_SUCCESS;
+}
+
+int ur_rpc_config_set_publish_window(ur_rpc_client_config_t* config, int window) {
+    if (!config || window < 0) return UR_RPC_ERROR_INVALID_PARAM;
+
+    config->publish_window = window;
+    return UR_RPC_SUCCESS;
+}
+
+int ur_rpc_config_set_chunk_window(ur_rpc_client_config_t* config, int window) {
+    if (!config || window < 0) return UR_RPC_ERROR_INVALID_PARAM;
+
+    config->chunk_window = window;
+    return UR_RPC_SUCCESS;
+}
+
+char* ur_rpc_config_subscription_filter(const ur_rpc_client_config_t* config, const char* topic) {
+    if (!config || !topic) return NULL;
+    if (!config->shared_group) return strdup(topic);
+
+    size_t length = strlen("$share/") + strlen(config->shared_group) + 1 + strlen(topic) + 1;
+    char* filter = malloc(length);
+    if (filter) {
+        snprintf(filter, length, "$share/%s/%s", config->shared_group, topic);
+    }
+    return filter;
+}
+
 /* ============================================================================
  * Topic List Management
  * ============================================================================ */
@@ -526,6 +2402,21 @@ int ur_rpc_config_set_heartbeat(ur_rpc_client_config_t* config, const char* topi
     return UR_RPC_SUCCESS;
 }
 
+int ur_rpc_config_set_heartbeat_echo(ur_rpc_client_config_t* config, bool echo) {
+    if (!config) return UR_RPC_ERROR_INVALID_PARAM;
+
+    config->heartbeat.echo = echo;
+    return UR_RPC_SUCCESS;
+}
+
+int ur_rpc_config_set_notification_batching(ur_rpc_client_config_t* config, int max_messages, int max_delay_us) {
+    if (!config || max_messages < 1 || max_delay_us < 0) return UR_RPC_ERROR_INVALID_PARAM;
+
+    config->notification_batch.max_messages = max_messages;
+    config->notification_batch.max_delay_us = max_delay_us;
+    return UR_RPC_SUCCESS;
+}
+
 /* ============================================================================
  * JSON Configuration Loading
  * ============================================================================ */
@@ -647,6 +2538,32 @@ int ur_rpc_config_load_from_file(ur_rpc_client_config_t* config, const char* fil
             cJSON_IsNumber(reconnect_delay_min) ? reconnect_delay_min->valueint : config->reconnect_delay_min,
             cJSON_IsNumber(reconnect_delay_max) ? reconnect_delay_max->valueint : config->reconnect_delay_max);
     }
+    cJSON* reconnect_jitter = cJSON_GetObjectItem(json, "reconnect_jitter");
+    if (cJSON_IsBool(reconnect_jitter)) {
+        config->reconnect_jitter = cJSON_IsTrue(reconnect_jitter);
+    }
+    cJSON* shared_group = cJSON_GetObjectItem(json, "shared_subscription_group");
+    if (cJSON_IsString(shared_group)) {
+        ur_rpc_config_set_shared_group(config, shared_group->valuestring);
+    }
+    cJSON* payload_encoding = cJSON_GetObjectItem(json, "payload_encoding");
+    if (cJSON_IsString(payload_encoding)) {
+        if (strcmp(payload_encoding->valuestring, "cbor") == 0) {
+            config->payload_encoding = UR_RPC_ENCODING_CBOR;
+        } else if (strcmp(payload_encoding->valuestring, "json") == 0) {
+            config->payload_encoding = UR_RPC_ENCODING_JSON;
+        } else {
+            LOG_WARN_SIMPLE("Unknown payload_encoding '%s', using json", payload_encoding->valuestring);
+        }
+    }
+    cJSON* publish_window = cJSON_GetObjectItem(json, "publish_window");
+    if (cJSON_IsNumber(publish_window)) {
+        ur_rpc_config_set_publish_window(config, publish_window->valueint);
+    }
+    cJSON* chunk_window = cJSON_GetObjectItem(json, "chunk_window");
+    if (cJSON_IsNumber(chunk_window)) {
+        ur_rpc_config_set_chunk_window(config, chunk_window->valueint);
+    }
 
     // Parse topic lists
     cJSON* json_added_pubs = cJSON_GetObjectItem(json, "json_added_pubs");
@@ -700,6 +2617,7 @@ int ur_rpc_config_load_from_file(ur_rpc_client_config_t* config, const char* fil
         cJSON* topic = cJSON_GetObjectItem(heartbeat, "topic");
         cJSON* interval = cJSON_GetObjectItem(heartbeat, "interval_seconds");
         cJSON* payload = cJSON_GetObjectItem(heartbeat, "payload");
+        cJSON* echo = cJSON_GetObjectItem(heartbeat, "echo");
 
         if (cJSON_IsString(topic) && cJSON_IsNumber(interval)) {
             ur_rpc_config_set_heartbeat(config, topic->valuestring, interval->valueint,
@@ -708,6 +2626,20 @@ int ur_rpc_config_load_from_file(ur_rpc_client_config_t* config, const char* fil
             if (cJSON_IsBool(enabled)) {
                 config->heartbeat.enabled = cJSON_IsTrue(enabled);
             }
+            if (cJSON_IsBool(echo)) {
+                config->heartbeat.echo = cJSON_IsTrue(echo);
+            }
+        }
+    }
+
+    // Parse notification coalescing
+    cJSON* notification_batch = cJSON_GetObjectItem(json, "notification_batch");
+    if (cJSON_IsObject(notification_batch)) {
+        cJSON* max_messages = cJSON_GetObjectItem(notification_batch, "max_messages");
+        cJSON* max_delay_us = cJSON_GetObjectItem(notification_batch, "max_delay_us");
+        if (cJSON_IsNumber(max_messages) && cJSON_IsNumber(max_delay_us) &&
+            ur_rpc_config_set_notification_batching(config, max_messages->valueint, max_delay_us->valueint) != UR_RPC_SUCCESS) {
+            LOG_WARN_SIMPLE("Ignoring invalid notification_batch configuration");
         }
     }
 
@@ -786,82 +2718,64 @@ int ur_rpc_config_load_from_file(ur_rpc_client_config_t* config, const char* fil
 }
 
 /* ============================================================================
- * Heartbeat Thread Implementation
+ * Heartbeat
  * ============================================================================ */
 
-static void* heartbeat_thread(void* arg) {
+/* Runs on the shared timer every interval. A disconnect clears
+ * heartbeat_running and the beats stop until the heartbeat is restarted. */
+static void heartbeat_tick(void* arg) {
     ur_rpc_client_t* client = (ur_rpc_client_t*)arg;
-    if (!client || !client->config.heartbeat.enabled) return NULL;
-
-    while (ur_atomic_load(&client->heartbeat_running) && ur_atomic_load(&client->running)) {
-        // Wait for the interval
-        for (int i = 0; i < client->config.heartbeat.interval_seconds &&
-             ur_atomic_load(&client->heartbeat_running); i++) {
-            sleep(1);
-        }
-
-        // Send heartbeat if still running and connected
-        if (ur_atomic_load(&client->heartbeat_running) &&
-            ur_atomic_load(&client->connected)) {
-
-            pthread_mutex_lock(&client->mutex);
-
-            // Build a simple, clean JSON heartbeat payload
-            // Use only ASCII-safe strings to avoid UTF-8 issues
-            char payload[512];
-            char timestamp_str[32];
-            
-            // Get timestamp as string
-            snprintf(timestamp_str, sizeof(timestamp_str), "%llu",
-                     (unsigned long long)ur_rpc_get_timestamp_ms());
-            
-            // Build JSON manually to ensure UTF-8 safety
-            const char* client_id = client->config.client_id ? client->config.client_id : "unknown";
-            const char* status = "alive";
-            const char* ssl_str = client->config.use_tls ? "true" : "false";
-            
-            // Construct clean JSON payload with proper formatting
-            int written = snprintf(payload, sizeof(payload),
-                "{\"type\":\"heartbeat\",\"client\":\"%s\",\"status\":\"%s\",\"ssl\":%s,\"timestamp\":\"%s\"}",
-                client_id, status, ssl_str, timestamp_str);
-            
-            if (written < 0 || written >= (int)sizeof(payload)) {
-                LOG_ERROR_SIMPLE("Failed to generate heartbeat payload - buffer too small");
-                pthread_mutex_unlock(&client->mutex);
-                continue;
-            }
 
-            size_t payload_len = strlen(payload);
-            LOG_DEBUG_SIMPLE("HEARTBEAT to %s: %s", client->config.heartbeat.topic, payload);
-
-            // Publish heartbeat message
-            int result = mosquitto_publish(client->mosq, NULL, client->config.heartbeat.topic,
-                                         (int)payload_len, payload, client->config.qos, false);
-            if (result == MOSQ_ERR_SUCCESS) {
-                client->messages_sent++;
-                LOG_DEBUG_SIMPLE("Heartbeat published successfully");
-            } else if (result == MOSQ_ERR_NO_CONN) {
-                // Connection lost, stop trying
-                LOG_WARN_SIMPLE("Connection lost, stopping heartbeat");
-                ur_atomic_store(&client->heartbeat_running, false);
-            } else {
-                client->errors_count++;
-                LOG_ERROR_SIMPLE("Failed to publish heartbeat: %d (%s)", result, mosquitto_strerror(result));
+    if (!ur_atomic_load(&client->heartbeat_running) || !ur_atomic_load(&client->running) ||
+        !ur_atomic_load(&client->connected)) {
+        return;
+    }
 
-                // If we get ERRNO errors repeatedly, back off
-                if (result == MOSQ_ERR_ERRNO) {
-                    usleep(500000); // 500ms backoff on socket errors
-                }
-            }
+    pthread_mutex_lock(&client->mutex);
+
+    // Build a simple, clean JSON heartbeat payload
+    // Use only ASCII-safe strings to avoid UTF-8 issues
+    char payload[512];
+    const char* client_id = client->config.client_id ? client->config.client_id : "unknown";
+    uint64_t seq = client->heartbeat_seq + 1;
+    int written = snprintf(payload, sizeof(payload),
+        "{\"type\":\"heartbeat\",\"client\":\"%s\",\"status\":\"alive\",\"ssl\":%s,\"timestamp\":\"%llu\",\"seq\":%llu}",
+        client_id, client->config.use_tls ? "true" : "false",
+        (unsigned long long)ur_rpc_get_timestamp_ms(), (unsigned long long)seq);
+
+    if (written < 0 || written >= (int)sizeof(payload)) {
+        LOG_ERROR_SIMPLE("Failed to generate heartbeat payload - buffer too small");
+        pthread_mutex_unlock(&client->mutex);
+        return;
+    }
 
-            client->last_activity = time(NULL);
-            // Don't free stack-allocated buffer!
+    LOG_DEBUG_SIMPLE("HEARTBEAT to %s: %s", client->config.heartbeat.topic, payload);
 
-            pthread_mutex_unlock(&client->mutex);
-        }
+    // Publish heartbeat message; the echo may arrive before publish returns
+    client->heartbeat_seq = seq;
+    client->heartbeat_sent_us = monotonic_us();
+    window_acquire(client, 0, false);
+    int result = mosquitto_publish(client->mosq, NULL, client->config.heartbeat.topic,
+                                   written, payload, client->config.qos, false);
+    if (result != MOSQ_ERR_SUCCESS) {
+        window_release(client);
+        client->heartbeat_sent_us = 0;
+    }
+    if (result == MOSQ_ERR_SUCCESS) {
+        ur_atomic_add_relaxed(&client->messages_sent, 1);
+        ur_atomic_add_relaxed(&client->heartbeats_sent, 1);
+        LOG_DEBUG_SIMPLE("Heartbeat published successfully");
+    } else if (result == MOSQ_ERR_NO_CONN) {
+        // Connection lost, stop trying
+        LOG_WARN_SIMPLE("Connection lost, stopping heartbeat");
+        ur_atomic_store(&client->heartbeat_running, false);
+    } else {
+        ur_atomic_add_relaxed(&client->errors_count, 1);
+        LOG_ERROR_SIMPLE("Failed to publish heartbeat: %d (%s)", result, mosquitto_strerror(result));
     }
 
-    return NULL;
+    touch_activity(client);
+    pthread_mutex_unlock(&client->mutex);
 }
 
 int ur_rpc_heartbeat_start(ur_rpc_client_t* client) {
@@ -878,10 +2792,15 @@ int ur_rpc_heartbeat_start(ur_rpc_client_t* client) {
 
     ur_atomic_store(&client->heartbeat_running, true);
 
-    if (pthread_create(&client->heartbeat_thread, NULL, heartbeat_thread, client) != 0) {
-        ur_atomic_store(&client->heartbeat_running, false);
-        pthread_mutex_unlock(&client->mutex);
-        return UR_RPC_ERROR_THREAD;
+    // A heartbeat paused by a disconnect still has its timer
+    if (!client->heartbeat_timer) {
+        uint64_t interval_ms = (uint64_t)client->config.heartbeat.interval_seconds * 1000;
+        client->heartbeat_timer = ur_rpc_timer_schedule(interval_ms, interval_ms, heartbeat_tick, client);
+        if (!client->heartbeat_timer) {
+            ur_atomic_store(&client->heartbeat_running, false);
+            pthread_mutex_unlock(&client->mutex);
+            return UR_RPC_ERROR_THREAD;
+        }
     }
 
     LOG_INFO_SIMPLE("Heartbeat started: topic=%s, interval=%ds",
@@ -896,18 +2815,16 @@ int ur_rpc_heartbeat_stop(ur_rpc_client_t* client) {
 
     pthread_mutex_lock(&client->mutex);
 
-    if (!ur_atomic_load(&client->heartbeat_running)) {
-        pthread_mutex_unlock(&client->mutex);
-        return UR_RPC_SUCCESS;
-    }
-
+    bool was_running = ur_atomic_load(&client->heartbeat_running);
     ur_atomic_store(&client->heartbeat_running, false);
+    ur_rpc_timer_id_t timer = client->heartbeat_timer;
+    client->heartbeat_timer = 0;
     pthread_mutex_unlock(&client->mutex);
 
-    // Wait for heartbeat thread to finish
-    pthread_join(client->heartbeat_thread, NULL);
+    // Waits out a beat in progress, which needs client->mutex
+    if (timer) ur_rpc_timer_cancel(timer);
 
-    LOG_INFO_SIMPLE("Heartbeat stopped");
+    if (was_running) LOG_INFO_SIMPLE("Heartbeat stopped");
     return UR_RPC_SUCCESS;
 }
 
@@ -943,38 +2860,44 @@ int ur_rpc_request_set_timeout(ur_rpc_request_t* request, int timeout_ms) {
     return UR_RPC_SUCCESS;
 }
 
-char* ur_rpc_request_to_json(const ur_rpc_request_t* request) {
-    if (!request) return NULL;
-
-    cJSON* json = cJSON_CreateObject();
-    if (!json) return NULL;
+int ur_rpc_request_set_transaction_id(ur_rpc_request_t* request, const char* transaction_id) {
+    if (!request || !transaction_id) return UR_RPC_ERROR_INVALID_PARAM;
 
-    cJSON_AddStringToObject(json, "method", request->method ? request->method : "unknown");
-    cJSON_AddStringToObject(json, "service", request->service ? request->service : "default");
-    cJSON_AddStringToObject(json, "transaction_id", request->transaction_id ? request->transaction_id : "");
-    cJSON_AddNumberToObject(json, "authority", request->authority);
-    cJSON_AddNumberToObject(json, "timeout_ms", request->timeout_ms);
+    size_t length = strnlen(transaction_id, sizeof(request->transaction_id_buf));
+    if (length >= sizeof(request->transaction_id_buf)) return UR_RPC_ERROR_INVALID_PARAM;
 
-    if (request->params) {
-        cJSON_AddItemToObject(json, "params", cJSON_Duplicate(request->params, 1));
+    // A longer ID taken from JSON may have been duplicated onto the heap
+    if (request->transaction_id != request->transaction_id_buf) {
+        if (!request->arena) free(request->transaction_id);
+        request->transaction_id = request->transaction_id_buf;
     }
+    memcpy(request->transaction_id_buf, transaction_id, length + 1);
+    return UR_RPC_SUCCESS;
+}
 
-    char* result = cJSON_Print(json);
-    cJSON_Delete(json);
-    return result;
+char* ur_rpc_request_to_json(const ur_rpc_request_t* request) {
+    if (!request) return NULL;
+
+    json_writer_t writer = {0};
+    request_write(&writer, request, 0);
+    return jw_take(&writer);
 }
 
-ur_rpc_request_t* ur_rpc_request_from_json(const char* json_str) {
-    if (!json_str) return NULL;
+int ur_rpc_request_write_json(const ur_rpc_request_t* request, char* buffer, size_t buffer_size, size_t* length) {
+    if (!request || !buffer || buffer_size == 0) return UR_RPC_ERROR_INVALID_PARAM;
 
-    cJSON* json = cJSON_Parse(json_str);
-    if (!json) return NULL;
+    json_writer_t writer = { buffer, 0, buffer_size, true, false };
+    buffer[0] = '\0';
+    request_write(&writer, request, 0);
+    if (writer.failed) return UR_RPC_ERROR_MEMORY;
+
+    if (length) *length = writer.length;
+    return UR_RPC_SUCCESS;
+}
 
+static ur_rpc_request_t* request_from_cjson(const cJSON* json) {
     ur_rpc_request_t* request = ur_rpc_request_create();
-    if (!request) {
-        cJSON_Delete(json);
-        return NULL;
-    }
+    if (!request) return NULL;
 
     cJSON* method = cJSON_GetObjectItem(json, "method");
     cJSON* service = cJSON_GetObjectItem(json, "service");
@@ -992,8 +2915,13 @@ ur_rpc_request_t* ur_rpc_request_from_json(const char* json_str) {
         request->service = strdup(service->valuestring);
     }
     if (cJSON_IsString(transaction_id)) {
-        free(request->transaction_id);
-        request->transaction_id = strdup(transaction_id->valuestring);
+        // IDs from other implementations may not fit the inline buffer
+        size_t length = strlen(transaction_id->valuestring);
+        if (length < sizeof(request->transaction_id_buf)) {
+            memcpy(request->transaction_id_buf, transaction_id->valuestring, length + 1);
+        } else {
+            request->transaction_id = strdup(transaction_id->valuestring);
+        }
     }
     if (cJSON_IsNumber(authority)) {
         request->authority = authority->valueint;
@@ -1005,24 +2933,48 @@ ur_rpc_request_t* ur_rpc_request_from_json(const char* json_str) {
         request->params = cJSON_Duplicate(params, 1);
     }
 
-    cJSON_Delete(json);
     return request;
 }
 
-ur_rpc_response_t* ur_rpc_response_create(void) {
-    ur_rpc_response_t* response = calloc(1, sizeof(ur_rpc_response_t));
-    if (!response) return NULL;
+ur_rpc_request_t* ur_rpc_request_from_json(const char* json_str) {
+    if (!json_str) return NULL;
 
+    return ur_rpc_request_from_payload(json_str, strlen(json_str));
+}
+
+ur_rpc_request_t* ur_rpc_request_from_payload(const char* payload, size_t payload_len) {
+    bool scratch;
+    cJSON* json = scratch_parse(payload, payload_len, &scratch);
+    if (!json) return NULL;
+
+    ur_rpc_request_t* request = request_from_cjson(json);
+    scratch_release(json, scratch);
+    return request;
+}
+
+static void response_init(ur_rpc_response_t* response) {
     response->timestamp = ur_rpc_get_timestamp_ms();
     response->success = true;
     response->error_code = UR_RPC_SUCCESS;
+}
 
+ur_rpc_response_t* ur_rpc_response_create(void) {
+    ur_rpc_response_t* response = calloc(1, sizeof(ur_rpc_response_t));
+    if (!response) return NULL;
+
+    response_init(response);
     return response;
 }
 
 void ur_rpc_response_destroy(ur_rpc_response_t* response) {
     if (!response) return;
 
+    if (response->arena) {
+        if (!arena_owns(response->arena, response->result)) cJSON_Delete(response->result);
+        response->result = NULL;
+        return;
+    }
+
     free(response->transaction_id);
     free(response->error_message);
 
@@ -1034,39 +2986,55 @@ void ur_rpc_response_destroy(ur_rpc_response_t* response) {
 char* ur_rpc_response_to_json(const ur_rpc_response_t* response) {
     if (!response) return NULL;
 
-    cJSON* json = cJSON_CreateObject();
-    if (!json) return NULL;
-
-    cJSON_AddStringToObject(json, "transaction_id", response->transaction_id ? response->transaction_id : "");
-    cJSON_AddBoolToObject(json, "success", response->success);
-    cJSON_AddNumberToObject(json, "timestamp", response->timestamp);
-    cJSON_AddNumberToObject(json, "error_code", response->error_code);
-    cJSON_AddNumberToObject(json, "processing_time_ms", response->processing_time_ms);
+    json_writer_t writer = {0};
+    response_write(&writer, response);
+    return jw_take(&writer);
+}
 
-    if (response->error_message) {
-        cJSON_AddStringToObject(json, "error_message", response->error_message);
-    }
+int ur_rpc_response_write_json(const ur_rpc_response_t* response, char* buffer, size_t buffer_size, size_t* length) {
+    if (!response || !buffer || buffer_size == 0) return UR_RPC_ERROR_INVALID_PARAM;
 
-    if (response->result) {
-        cJSON_AddItemToObject(json, "result", cJSON_Duplicate(response->result, 1));
-    }
+    json_writer_t writer = { buffer, 0, buffer_size, true, false };
+    buffer[0] = '\0';
+    response_write(&writer, response);
+    if (writer.failed) return UR_RPC_ERROR_MEMORY;
 
-    char* result = cJSON_Print(json);
-    cJSON_Delete(json);
-    return result;
+    if (length) *length = writer.length;
+    return UR_RPC_SUCCESS;
 }
 
 ur_rpc_response_t* ur_rpc_response_from_json(const char* json_str) {
     if (!json_str) return NULL;
 
-    cJSON* json = cJSON_Parse(json_str);
+    return ur_rpc_response_from_payload(json_str, strlen(json_str));
+}
+
+ur_rpc_response_t* ur_rpc_response_from_payload(const char* payload, size_t payload_len) {
+    bool scratch;
+    cJSON* json = scratch_parse(payload, payload_len, &scratch);
     if (!json) return NULL;
 
-    ur_rpc_response_t* response = ur_rpc_response_create();
-    if (!response) {
-        cJSON_Delete(json);
-        return NULL;
+    ur_rpc_response_t* response = response_from_cjson(json);
+    scratch_release(json, scratch);
+    return response;
+}
+
+char* ur_rpc_response_encode(const ur_rpc_client_t* client, const ur_rpc_response_t* response, size_t* length) {
+    if (!client || !response || !length) return NULL;
+
+    json_writer_t writer = {0};
+    if (client->config.payload_encoding == UR_RPC_ENCODING_CBOR) {
+        response_write_cbor(&writer, response);
+    } else {
+        response_write(&writer, response);
     }
+    *length = writer.length;
+    return jw_take(&writer);
+}
+
+static ur_rpc_response_t* response_from_cjson(const cJSON* json) {
+    ur_rpc_response_t* response = ur_rpc_response_create();
+    if (!response) return NULL;
 
     cJSON* transaction_id = cJSON_GetObjectItem(json, "transaction_id");
     cJSON* success = cJSON_GetObjectItem(json, "success");
@@ -1098,34 +3066,97 @@ ur_rpc_response_t* ur_rpc_response_from_json(const char* json_str) {
         response->processing_time_ms = processing_time_ms->valuedouble;
     }
 
-    cJSON_Delete(json);
     return response;
 }
 
 int ur_rpc_call_sync(ur_rpc_client_t* client, const ur_rpc_request_t* request, ur_rpc_response_t** response, int timeout_ms) {
-    if (!client || !request || !response) return UR_RPC_ERROR_INVALID_PARAM;
+    if (!client || !request || !response || !request->transaction_id) return UR_RPC_ERROR_INVALID_PARAM;
+    if (!ur_atomic_load(&client->connected)) return UR_RPC_ERROR_NOT_CONNECTED;
+
+    *response = NULL;
+    if (timeout_ms <= 0) {
+        timeout_ms = request->timeout_ms > 0 ? request->timeout_ms : UR_RPC_DEFAULT_TIMEOUT_MS;
+    }
+
+    char* request_topic = ur_rpc_generate_request_topic(client, request->method, request->service, request->transaction_id);
+    json_writer_t writer = {0};
+    request_encode(&writer, request, &client->config);
+    size_t payload_length = writer.length;
+    char* json_payload = jw_take(&writer);
+    ur_rpc_pending_request_t* pending = calloc(1, sizeof(ur_rpc_pending_request_t));
+    pthread_cond_t done;
+    if (!request_topic || !json_payload || !pending || init_monotonic_cond(&done) != 0) {
+        free(request_topic);
+        free(json_payload);
+        free(pending);
+        return json_payload || !request_topic ? UR_RPC_ERROR_MEMORY : UR_RPC_ERROR_JSON;
+    }
+
+    pending->transaction_id = strdup(request->transaction_id);
+    pending->response_topic = ur_rpc_generate_response_topic(client, request->method, request->service, request->transaction_id);
+    pending->created_time = time(NULL);
+    pending->timeout_ms = timeout_ms;
+    pending->deadline_ms = monotonic_ms() + (uint64_t)timeout_ms;
+    pending->done_cond = &done;
+
+    // A per-transaction response topic is only ours for the length of the call
+    bool own_topic = client->topic_config.include_transaction_id && pending->response_topic;
+    if (own_topic) {
+        ur_rpc_subscribe_topic(client, pending->response_topic);
+    }
 
-    // For now, create a stub response to prevent linking errors
-    // In a full implementation, this would perform actual RPC call and wait for response
-    *response = ur_rpc_response_create();
-    if (!*response) return UR_RPC_ERROR_MEMORY;
+    LOG_INFO_SIMPLE("SYNC RPC CALL: %s.%s (authority: %s, transaction: %s, timeout: %d ms)",
+           request->service ? request->service : "unknown",
+           request->method ? request->method : "unknown",
+           ur_rpc_authority_to_string(request->authority),
+           request->transaction_id, timeout_ms);
+
+    // Registered before publishing so a fast response cannot be missed
+    pthread_mutex_lock(&client->pending_mutex);
+    int result = pending_insert(client, pending);
+    pthread_mutex_unlock(&client->pending_mutex);
+
+    if (result == UR_RPC_SUCCESS) {
+        result = ur_rpc_publish_message(client, request_topic, json_payload, payload_length);
+        if (result == UR_RPC_SUCCESS) {
+            ur_atomic_add_relaxed(&client->requests_sent, 1);
+        } else {
+            LOG_ERROR_SIMPLE("Failed to publish sync request to broker (error: %d)", result);
+        }
 
-    (*response)->transaction_id = strdup(request->transaction_id ? request->transaction_id : "stub");
-    (*response)->success = true;
-    (*response)->error_code = UR_RPC_SUCCESS;
-    (*response)->processing_time_ms = 1; // Minimal processing time for stub
+        struct timespec deadline;
+        monotonic_timespec(pending->deadline_ms, &deadline);
 
-    // Create a simple success result
-    (*response)->result = cJSON_CreateObject();
-    cJSON_AddStringToObject((*response)->result, "status", "stub_success");
-    cJSON_AddStringToObject((*response)->result, "message", "Stub implementation - actual RPC not performed");
+        pthread_mutex_lock(&client->pending_mutex);
+        while (result == UR_RPC_SUCCESS && !pending->completed) {
+            if (pthread_cond_timedwait(&done, &client->pending_mutex, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        if (!pending->completed) {
+            pending_remove(client, pending->transaction_id);
+            if (result == UR_RPC_SUCCESS) {
+                result = UR_RPC_ERROR_TIMEOUT;
+                LOG_WARN_SIMPLE("Sync RPC %s timed out after %d ms", pending->transaction_id, timeout_ms);
+            }
+        }
+        pthread_mutex_unlock(&client->pending_mutex);
+    }
 
-    LOG_INFO_SIMPLE("ur_rpc_call_sync: Stub implementation called for method %s", request->method ? request->method : "unknown");
+    if (pending->completed) {
+        *response = pending->response;
+        result = pending->response ? UR_RPC_SUCCESS : UR_RPC_ERROR_MEMORY;
+    }
 
-    // Suppress unused parameter warning
-    (void)timeout_ms;
+    if (own_topic) {
+        ur_rpc_unsubscribe_topic(client, pending->response_topic);
+    }
 
-    return UR_RPC_SUCCESS;
+    pthread_cond_destroy(&done);
+    pending_free(pending);
+    free(request_topic);
+    free(json_payload);
+    return result;
 }
 
 /* ============================================================================
@@ -1242,27 +3273,34 @@ char* ur_rpc_generate_response_topic(const ur_rpc_client_t* client, const char*
  * RPC Request/Response Management
  * ============================================================================ */
 
-ur_rpc_request_t* ur_rpc_request_create(void) {
-    ur_rpc_request_t* request = calloc(1, sizeof(ur_rpc_request_t));
-    if (!request) return NULL;
-
-    request->transaction_id = ur_rpc_generate_transaction_id();
-    if (!request->transaction_id) {
-        free(request);
-        return NULL;
-    }
-
+static void request_init(ur_rpc_request_t* request) {
+    ur_rpc_format_transaction_id(request->transaction_id_buf, sizeof(request->transaction_id_buf));
+    request->transaction_id = request->transaction_id_buf;
+
     request->timestamp = ur_rpc_get_timestamp_ms();
     request->timeout_ms = UR_RPC_DEFAULT_TIMEOUT_MS;
     request->authority = UR_RPC_AUTHORITY_USER;
+}
+
+ur_rpc_request_t* ur_rpc_request_create(void) {
+    ur_rpc_request_t* request = calloc(1, sizeof(ur_rpc_request_t));
+    if (!request) return NULL;
 
+    request_init(request);
     return request;
 }
 
 void ur_rpc_request_destroy(ur_rpc_request_t* request) {
     if (!request) return;
 
-    free(request->transaction_id);
+    // Arena memory goes back with the arena; only params may be heap owned
+    if (request->arena) {
+        if (!arena_owns(request->arena, request->params)) cJSON_Delete(request->params);
+        request->params = NULL;
+        return;
+    }
+
+    if (request->transaction_id != request->transaction_id_buf) free(request->transaction_id);
     free(request->method);
     free(request->service);
     free(request->response_topic);
@@ -1273,6 +3311,15 @@ void ur_rpc_request_destroy(ur_rpc_request_t* request) {
 int ur_rpc_request_set_method(ur_rpc_request_t* request, const char* method, const char* service) {
     if (!request || !method || !service) return UR_RPC_ERROR_INVALID_PARAM;
 
+    if (request->arena) {
+        char* arena_method = ur_rpc_arena_strdup(request->arena, method);
+        char* arena_service = ur_rpc_arena_strdup(request->arena, service);
+        if (!arena_method || !arena_service) return UR_RPC_ERROR_MEMORY;
+        request->method = arena_method;
+        request->service = arena_service;
+        return UR_RPC_SUCCESS;
+    }
+
     free(request->method);
     free(request->service);
 
@@ -1290,34 +3337,297 @@ int ur_rpc_request_set_method(ur_rpc_request_t* request, const char* method, con
     return UR_RPC_SUCCESS;
 }
 
+/* ============================================================================
+ * Request/Response Arenas
+ * ============================================================================ */
+
+#define UR_RPC_ARENA_DEFAULT_BLOCK 4096
+#define UR_RPC_ARENA_ALIGN 16
+
+typedef struct ur_rpc_arena_block {
+    struct ur_rpc_arena_block* next;
+    size_t capacity;
+    size_t used;
+} ur_rpc_arena_block_t;
+
+/* Objects whose cJSON member is released when the arena is reset */
+typedef struct ur_rpc_arena_object {
+    struct ur_rpc_arena_object* next;
+    ur_rpc_request_t* request;
+    ur_rpc_response_t* response;
+} ur_rpc_arena_object_t;
+
+struct ur_rpc_arena {
+    ur_rpc_arena_block_t* head;    // Block allocations are carved from
+    ur_rpc_arena_block_t* first;   // Kept across resets
+    size_t block_size;
+    ur_rpc_arena_object_t* objects;
+};
+
+static ur_rpc_arena_block_t* arena_block_create(size_t capacity) {
+    ur_rpc_arena_block_t* block = malloc(sizeof(ur_rpc_arena_block_t) + capacity);
+    if (!block) return NULL;
+
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+ur_rpc_arena_t* ur_rpc_arena_create(size_t block_size) {
+    ur_rpc_arena_t* arena = calloc(1, sizeof(ur_rpc_arena_t));
+    if (!arena) return NULL;
+
+    arena->block_size = block_size ? block_size : UR_RPC_ARENA_DEFAULT_BLOCK;
+    arena->first = arena_block_create(arena->block_size);
+    if (!arena->first) {
+        free(arena);
+        return NULL;
+    }
+    arena->head = arena->first;
+    return arena;
+}
+
+void ur_rpc_arena_reset(ur_rpc_arena_t* arena) {
+    if (!arena) return;
+
+    // Trees parsed into the arena go with its blocks, without a walk
+    for (ur_rpc_arena_object_t* object = arena->objects; object; object = object->next) {
+        if (object->request && !arena_owns(arena, object->request->params)) cJSON_Delete(object->request->params);
+        if (object->response && !arena_owns(arena, object->response->result)) cJSON_Delete(object->response->result);
+    }
+    arena->objects = NULL;
+
+    // Overflow blocks are pushed in front of the first one
+    while (arena->head != arena->first) {
+        ur_rpc_arena_block_t* next = arena->head->next;
+        free(arena->head);
+        arena->head = next;
+    }
+    arena->first->used = 0;
+}
+
+void ur_rpc_arena_destroy(ur_rpc_arena_t* arena) {
+    if (!arena) return;
+
+    ur_rpc_arena_reset(arena);
+    free(arena->first);
+    free(arena);
+}
+
+void* ur_rpc_arena_alloc(ur_rpc_arena_t* arena, size_t size) {
+    if (!arena || size == 0) return NULL;
+
+    size = (size + UR_RPC_ARENA_ALIGN - 1) & ~(size_t)(UR_RPC_ARENA_ALIGN - 1);
+    ur_rpc_arena_block_t* block = arena->head;
+    uintptr_t base = (uintptr_t)(block + 1);
+    size_t offset = ((base + block->used + UR_RPC_ARENA_ALIGN - 1) & ~(uintptr_t)(UR_RPC_ARENA_ALIGN - 1)) - base;
+
+    if (offset + size > block->capacity) {
+        size_t capacity = size + UR_RPC_ARENA_ALIGN > arena->block_size ? size + UR_RPC_ARENA_ALIGN : arena->block_size;
+        block = arena_block_create(capacity);
+        if (!block) return NULL;
+        block->next = arena->head;
+        arena->head = block;
+        base = (uintptr_t)(block + 1);
+        offset = ((base + UR_RPC_ARENA_ALIGN - 1) & ~(uintptr_t)(UR_RPC_ARENA_ALIGN - 1)) - base;
+    }
+
+    block->used = offset + size;
+    return (char*)(block + 1) + offset;
+}
+
+char* ur_rpc_arena_strdup(ur_rpc_arena_t* arena, const char* str) {
+    if (!arena || !str) return NULL;
+
+    size_t length = strlen(str) + 1;
+    char* copy = ur_rpc_arena_alloc(arena, length);
+    if (copy) memcpy(copy, str, length);
+    return copy;
+}
+
+static ur_rpc_arena_object_t* arena_track(ur_rpc_arena_t* arena, size_t object_size, void** object) {
+    // The object follows its entry at the next aligned offset
+    size_t header = (sizeof(ur_rpc_arena_object_t) + UR_RPC_ARENA_ALIGN - 1) & ~(size_t)(UR_RPC_ARENA_ALIGN - 1);
+    ur_rpc_arena_object_t* entry = ur_rpc_arena_alloc(arena, header + object_size);
+    if (!entry) return NULL;
+
+    memset(entry, 0, header + object_size);
+    *object = (char*)entry + header;
+    entry->next = arena->objects;
+    arena->objects = entry;
+    return entry;
+}
+
+ur_rpc_request_t* ur_rpc_arena_request_create(ur_rpc_arena_t* arena) {
+    void* memory = NULL;
+    ur_rpc_arena_object_t* entry = arena ? arena_track(arena, sizeof(ur_rpc_request_t), &memory) : NULL;
+    if (!entry) return NULL;
+
+    ur_rpc_request_t* request = memory;
+    entry->request = request;
+    request->arena = arena;
+    request_init(request);
+    return request;
+}
+
+ur_rpc_response_t* ur_rpc_arena_response_create(ur_rpc_arena_t* arena) {
+    void* memory = NULL;
+    ur_rpc_arena_object_t* entry = arena ? arena_track(arena, sizeof(ur_rpc_response_t), &memory) : NULL;
+    if (!entry) return NULL;
+
+    ur_rpc_response_t* response = memory;
+    entry->response = response;
+    response->arena = arena;
+    response_init(response);
+    return response;
+}
+
+/* ============================================================================
+ * cJSON in Arenas
+ * ============================================================================ */
+
+/* cJSON allocates through process-wide hooks. These give each thread's
+ * allocations to the arena bound on that thread, if any, and everything
+ * else to the heap, so threads that bind nothing are unaffected. */
+
+#define UR_RPC_SCRATCH_ARENA_BLOCK (16 * 1024)
+
+static __thread ur_rpc_arena_t* t_cjson_arena;
+static __thread bool t_scratch_busy;
+static pthread_once_t cjson_hooks_once = PTHREAD_ONCE_INIT;
+static pthread_key_t scratch_arena_key;
+
+static bool arena_owns(const ur_rpc_arena_t* arena, const void* pointer) {
+    if (!pointer) return false;
+    for (const ur_rpc_arena_block_t* block = arena->head; block; block = block->next) {
+        const char* start = (const char*)(block + 1);
+        if ((const char*)pointer >= start && (const char*)pointer < start + block->capacity) return true;
+    }
+    return false;
+}
+
+static void* cjson_arena_malloc(size_t size) {
+    ur_rpc_arena_t* arena = t_cjson_arena;
+    return arena ? ur_rpc_arena_alloc(arena, size) : malloc(size);
+}
+
+static void cjson_arena_free(void* pointer) {
+    ur_rpc_arena_t* arena = t_cjson_arena;
+    if (arena && arena_owns(arena, pointer)) return;   // Goes with the next reset
+    free(pointer);
+}
+
+static void scratch_arena_free(void* arg) {
+    ur_rpc_arena_destroy((ur_rpc_arena_t*)arg);
+}
+
+static void cjson_hooks_install(void) {
+    cJSON_Hooks hooks = { cjson_arena_malloc, cjson_arena_free };
+    cJSON_InitHooks(&hooks);
+    pthread_key_create(&scratch_arena_key, scratch_arena_free);
+}
+
+ur_rpc_arena_t* ur_rpc_arena_bind_cjson(ur_rpc_arena_t* arena) {
+    pthread_once(&cjson_hooks_once, cjson_hooks_install);
+
+    ur_rpc_arena_t* previous = t_cjson_arena;
+    t_cjson_arena = arena;
+    return previous;
+}
+
+cJSON* ur_rpc_arena_payload_parse(ur_rpc_arena_t* arena, const char* payload, size_t payload_len) {
+    if (!arena) return NULL;
+
+    ur_rpc_arena_t* previous = ur_rpc_arena_bind_cjson(arena);
+    cJSON* json = ur_rpc_payload_parse(payload, payload_len);
+    ur_rpc_arena_bind_cjson(previous);
+    return json;
+}
+
+/* Parses a tree that is only read before it is released, into the thread's
+ * scratch arena unless that already holds one (a callback parsing while a
+ * message is matched); those trees come from the heap. *scratch tells
+ * scratch_release which it was. */
+static cJSON* scratch_parse(const char* payload, size_t payload_len, bool* scratch) {
+    *scratch = false;
+    if (t_scratch_busy) return ur_rpc_payload_parse(payload, payload_len);
+
+    pthread_once(&cjson_hooks_once, cjson_hooks_install);
+    ur_rpc_arena_t* arena = pthread_getspecific(scratch_arena_key);
+    if (!arena) {
+        arena = ur_rpc_arena_create(UR_RPC_SCRATCH_ARENA_BLOCK);
+        if (!arena) return ur_rpc_payload_parse(payload, payload_len);
+        pthread_setspecific(scratch_arena_key, arena);
+    }
+
+    cJSON* json = ur_rpc_arena_payload_parse(arena, payload, payload_len);
+    if (!json) {
+        ur_rpc_arena_reset(arena);
+        return NULL;
+    }
+    *scratch = true;
+    t_scratch_busy = true;
+    return json;
+}
+
+static void scratch_release(cJSON* json, bool scratch) {
+    if (!scratch) {
+        cJSON_Delete(json);
+        return;
+    }
+    ur_rpc_arena_reset(pthread_getspecific(scratch_arena_key));
+    t_scratch_busy = false;
+}
+
 /* ============================================================================
  * Basic RPC Client Operations
  * ============================================================================ */
 
 int ur_rpc_publish_message(ur_rpc_client_t* client, const char* topic, const char* payload, size_t payload_len) {
-    if (!client || !topic || !payload || !ur_atomic_load(&client->connected)) {
+    return ur_rpc_publish_message_qos(client, topic, payload, payload_len, -1);
+}
+
+static int publish_counted(ur_rpc_client_t* client, const char* topic, const char* payload, size_t payload_len,
+                           int qos, int timeout_ms, bool enforce_window) {
+    if (!client || !topic || !payload || qos > 2 || !ur_atomic_load(&client->connected)) {
         return UR_RPC_ERROR_INVALID_PARAM;
     }
+    if (qos < 0) qos = client->config.qos;
+
+    // Count the message before mosquitto can complete it on the loop thread
+    int window_result = window_acquire(client, timeout_ms, enforce_window);
+    if (window_result != UR_RPC_SUCCESS) return window_result;
 
     pthread_mutex_lock(&client->mutex);
 
     // Publish using mosquitto
-    int result = mosquitto_publish(client->mosq, NULL, topic, (int)payload_len, payload, client->config.qos, false);
+    int result = mosquitto_publish(client->mosq, NULL, topic, (int)payload_len, payload, qos, false);
     if (result != MOSQ_ERR_SUCCESS) {
         pthread_mutex_unlock(&client->mutex);
+        window_release(client);
         return UR_RPC_ERROR_MQTT;
     }
 
-    LOG_DEBUG_SIMPLE("PUBLISH to %s: %.*s", topic, (int)payload_len, payload);
+    pthread_mutex_unlock(&client->mutex);
 
-    client->messages_sent++;
-    client->last_activity = time(NULL);
+    ur_atomic_add_relaxed(&client->messages_sent, 1);
+    touch_activity(client);
 
-    pthread_mutex_unlock(&client->mutex);
+    LOG_DEBUG_SIMPLE("PUBLISH to %s: %.*s", topic, (int)payload_len, payload);
 
     return UR_RPC_SUCCESS;
 }
 
+/* qos < 0 publishes with the configured QoS */
+int ur_rpc_publish_message_qos(ur_rpc_client_t* client, const char* topic, const char* payload, size_t payload_len, int qos) {
+    return publish_counted(client, topic, payload, payload_len, qos, 0, false);
+}
+
+int ur_rpc_publish_message_window(ur_rpc_client_t* client, const char* topic, const char* payload, size_t payload_len, int qos, int timeout_ms) {
+    return publish_counted(client, topic, payload, payload_len, qos, timeout_ms, true);
+}
+
 bool ur_rpc_client_is_connected(const ur_rpc_client_t* client) {
     return client ? ur_atomic_load(&client->connected) : false;
 }
@@ -1372,6 +3682,7 @@ static void deep_copy_config(ur_rpc_client_config_t* dest, const ur_rpc_client_c
     dest->cert_file = safe_strdup(src->cert_file);
     dest->key_file = safe_strdup(src->key_file);
     dest->tls_version = safe_strdup(src->tls_version);
+    dest->shared_group = safe_strdup(src->shared_group);
     
     deep_copy_topic_list(&dest->json_added_pubs, &src->json_added_pubs);
     deep_copy_topic_list(&dest->json_added_subs, &src->json_added_subs);
@@ -1399,6 +3710,7 @@ static void cleanup_deep_copied_config(ur_rpc_client_config_t* config) {
     free(config->cert_file);
     free(config->key_file);
     free(config->tls_version);
+    free(config->shared_group);
     
     free_topic_list(&config->json_added_pubs);
     free_topic_list(&config->json_added_subs);
@@ -1464,13 +3776,48 @@ ur_rpc_client_t* ur_rpc_client_create(const ur_rpc_client_config_t* config, cons
         return NULL;
     }
 
+    // Pending request table; the shared timer expires it while it is in use
+    client->pending_bucket_count = UR_RPC_PENDING_INITIAL_BUCKETS;
+    client->pending_buckets = calloc(client->pending_bucket_count, sizeof(*client->pending_buckets));
+    client->timer_wheel_tick = monotonic_ms() / UR_RPC_TIMER_TICK_MS;
+    client->pending_timer = 0;
+    ur_atomic_init(&client->timer_running, true);
+    if (!client->pending_buckets) {
+        pthread_mutex_destroy(&client->pending_mutex);
+        pthread_mutex_destroy(&client->mutex);
+        mosquitto_destroy(client->mosq);
+        cleanup_deep_copied_config(&client->config);
+        cleanup_deep_copied_topic_config(&client->topic_config);
+        free(client);
+        return NULL;
+    }
+
+    // Notification coalescing; without its flusher thread notifications
+    // simply go out one by one
+    pthread_mutex_init(&client->notify_mutex, NULL);
+    init_monotonic_cond(&client->notify_cond);
+    ur_atomic_init(&client->notify_running, false);
+
+    // Publish window accounting, see window_acquire
+    pthread_mutex_init(&client->window_mutex, NULL);
+    init_monotonic_cond(&client->window_cond);
+    if (client->config.notification_batch.max_messages > 1) {
+        ur_atomic_store(&client->notify_running, true);
+        if (pthread_create(&client->notify_thread, NULL, notify_flush_thread, client) != 0) {
+            LOG_WARN_SIMPLE("Notification coalescing disabled: flusher thread could not start");
+            ur_atomic_store(&client->notify_running, false);
+            client->config.notification_batch.max_messages = 1;
+        }
+    }
+
     // Initialize atomic variables
     ur_atomic_init(&client->connected, false);
     ur_atomic_init(&client->running, false);
     ur_atomic_init(&client->heartbeat_running, false);
+    client->heartbeat_timer = 0;
 
     client->status = UR_RPC_CONN_DISCONNECTED;
-    client->last_activity = time(NULL);
+    ur_atomic_store_relaxed(&client->last_activity, time(NULL));
 
     return client;
 }
@@ -1485,17 +3832,36 @@ void ur_rpc_client_destroy(ur_rpc_client_t* client) {
     ur_rpc_client_stop(client);
     ur_rpc_client_disconnect(client);
 
-    // Clean up pending requests
-    pthread_mutex_lock(&client->pending_mutex);
-    ur_rpc_pending_request_t* req = client->pending_requests;
-    while (req) {
-        ur_rpc_pending_request_t* next = req->next;
-        free(req->transaction_id);
-        free(req->response_topic);
-        free(req);
-        req = next;
+    // Queued notifications were flushed by ur_rpc_client_stop
+    if (ur_atomic_load(&client->notify_running)) {
+        pthread_mutex_lock(&client->notify_mutex);
+        ur_atomic_store(&client->notify_running, false);
+        pthread_cond_signal(&client->notify_cond);
+        pthread_mutex_unlock(&client->notify_mutex);
+        pthread_join(client->notify_thread, NULL);
     }
+    for (int i = 0; i < client->notify_buffer_count; i++) {
+        free(client->notify_buffers[i].topic);
+        free(client->notify_buffers[i].payload);
+    }
+
+    // Stop the timeout tick, then drop whatever is still pending
+    pthread_mutex_lock(&client->pending_mutex);
+    ur_atomic_store(&client->timer_running, false);
+    ur_rpc_timer_id_t pending_timer = client->pending_timer;
+    client->pending_timer = 0;
     pthread_mutex_unlock(&client->pending_mutex);
+    if (pending_timer) ur_rpc_timer_cancel(pending_timer);
+
+    for (size_t i = 0; i < client->pending_bucket_count; i++) {
+        ur_rpc_pending_request_t* req = client->pending_buckets[i];
+        while (req) {
+            ur_rpc_pending_request_t* next = req->next;
+            pending_free(req);
+            req = next;
+        }
+    }
+    free(client->pending_buckets);
 
     // Destroy mosquitto instance
     if (client->mosq) {
@@ -1509,6 +3875,10 @@ void ur_rpc_client_destroy(ur_rpc_client_t* client) {
     // Destroy mutexes
     pthread_mutex_destroy(&client->mutex);
     pthread_mutex_destroy(&client->pending_mutex);
+    pthread_mutex_destroy(&client->notify_mutex);
+    pthread_cond_destroy(&client->notify_cond);
+    pthread_mutex_destroy(&client->window_mutex);
+    pthread_cond_destroy(&client->window_cond);
 
     free(client);
 }
@@ -1592,6 +3962,15 @@ int ur_rpc_client_connect(ur_rpc_client_t* client) {
         }
     }
 
+    // Reconnects happen inside the mosquitto loop thread. With jitter, a
+    // fleet that lost the same broker spreads its reconnects out instead
+    // of arriving together; TLS sessions are resumed across them.
+    mosquitto_reconnect_delay_set(client->mosq,
+                                  (unsigned int)client->config.reconnect_delay_min,
+                                  (unsigned int)client->config.reconnect_delay_max,
+                                  true);
+    mosquitto_reconnect_jitter_set(client->mosq, client->config.reconnect_jitter);
+
     // Connect to MQTT broker using mosquitto
     LOG_INFO_SIMPLE("Connecting to MQTT broker %s:%d (TLS: %s)",
            client->config.broker_host ? client->config.broker_host : "localhost",
@@ -1612,7 +3991,7 @@ int ur_rpc_client_connect(ur_rpc_client_t* client) {
 
     LOG_INFO_SIMPLE("Connection initiated successfully, waiting for callback confirmation");
     // Note: actual connection status will be updated in the connect callback
-    client->last_activity = time(NULL);
+    touch_activity(client);
 
     pthread_mutex_unlock(&client->mutex);
     return UR_RPC_SUCCESS;
@@ -1698,6 +4077,9 @@ int ur_rpc_client_start(ur_rpc_client_t* client) {
 int ur_rpc_client_stop(ur_rpc_client_t* client) {
     if (!client) return UR_RPC_ERROR_INVALID_PARAM;
 
+    // Send coalesced notifications while the loop can still deliver them
+    ur_rpc_flush_notifications(client);
+
     pthread_mutex_lock(&client->mutex);
 
     if (!ur_atomic_load(&client->running)) {
@@ -1737,6 +4119,24 @@ void ur_rpc_client_set_message_handler(ur_rpc_client_t* client, ur_rpc_message_h
     pthread_mutex_unlock(&client->mutex);
 }
 
+void ur_rpc_client_set_capacity_callback(ur_rpc_client_t* client, ur_rpc_capacity_callback_t callback, void* user_data) {
+    if (!client) return;
+
+    pthread_mutex_lock(&client->window_mutex);
+    client->capacity_callback = callback;
+    client->capacity_user_data = user_data;
+    pthread_mutex_unlock(&client->window_mutex);
+}
+
+void ur_rpc_client_set_heartbeat_rtt_callback(ur_rpc_client_t* client, ur_rpc_heartbeat_rtt_callback_t callback, void* user_data) {
+    if (!client) return;
+
+    pthread_mutex_lock(&client->mutex);
+    client->heartbeat_rtt_callback = callback;
+    client->heartbeat_rtt_user_data = user_data;
+    pthread_mutex_unlock(&client->mutex);
+}
+
 /* ============================================================================
  * Additional Request/Response Functions
  * ============================================================================ */
@@ -1770,7 +4170,7 @@ int ur_rpc_request_set_params(ur_rpc_request_t* request, const cJSON* params) {
  * ============================================================================ */
 
 int ur_rpc_call_async(ur_rpc_client_t* client, const ur_rpc_request_t* request, ur_rpc_response_handler_t callback, void* user_data) {
-    if (!client || !request || !ur_atomic_load(&client->connected)) {
+    if (!client || !request || !request->transaction_id || !ur_atomic_load(&client->connected)) {
         return UR_RPC_ERROR_INVALID_PARAM;
     }
 
@@ -1778,9 +4178,11 @@ int ur_rpc_call_async(ur_rpc_client_t* client, const ur_rpc_request_t* request,
     char* request_topic = ur_rpc_generate_request_topic(client, request->method, request->service, request->transaction_id);
     if (!request_topic) return UR_RPC_ERROR_MEMORY;
 
-    // Serialize request to JSON
-    char* json_payload = ur_rpc_request_to_json(request);
-    if (!json_payload) {
+    // Serialize request in the configured encoding
+    json_writer_t* payload = jw_pooled();
+    if (payload) request_encode(payload, request, &client->config);
+    if (!payload || payload->failed) {
+        jw_pooled_release(payload);
         free(request_topic);
         return UR_RPC_ERROR_JSON;
     }
@@ -1791,7 +4193,8 @@ int ur_rpc_call_async(ur_rpc_client_t* client, const ur_rpc_request_t* request,
            ur_rpc_authority_to_string(request->authority),
            request->transaction_id ? request->transaction_id : "unknown");
 
-    if (request->params) {
+    /* Only pay for pretty-printing when the line will be written */
+    if (request->params && logger_is_enabled(LOG_DEBUG)) {
         char* params_str = cJSON_Print(request->params);
         if (params_str) {
             LOG_DEBUG_SIMPLE("  Params: %s", params_str);
@@ -1799,43 +4202,98 @@ int ur_rpc_call_async(ur_rpc_client_t* client, const ur_rpc_request_t* request,
         }
     }
 
-    // Add to pending requests if callback provided
     if (callback) {
-        pthread_mutex_lock(&client->pending_mutex);
-
-        ur_rpc_pending_request_t* pending = malloc(sizeof(ur_rpc_pending_request_t));
-        if (pending) {
-            pending->transaction_id = strdup(request->transaction_id);
-            pending->response_topic = ur_rpc_generate_response_topic(client, request->method, request->service, request->transaction_id);
-            pending->callback = callback;
-            pending->user_data = user_data;
-            pending->created_time = time(NULL);
-            pending->timeout_ms = request->timeout_ms;
-            pending->next = client->pending_requests;
-            client->pending_requests = pending;
+        int register_result = pending_register_async(client, request, callback, user_data);
+        if (register_result != UR_RPC_SUCCESS) {
+            jw_pooled_release(payload);
+            free(request_topic);
+            return register_result;
         }
-
-        pthread_mutex_unlock(&client->pending_mutex);
     }
 
     // Publish the JSON request to the broker
-    int result = ur_rpc_publish_message(client, request_topic, json_payload, strlen(json_payload));
+    int result = ur_rpc_publish_message(client, request_topic, payload->data, payload->length);
+    jw_pooled_release(payload);
     if (result != UR_RPC_SUCCESS) {
         LOG_ERROR_SIMPLE("Failed to publish async request to broker (error: %d)", result);
+        if (callback) pending_cancel(client, request->transaction_id);
         free(request_topic);
-        free(json_payload);
         return result;
     }
 
     LOG_DEBUG_SIMPLE("Published async request to topic: %s", request_topic);
-    client->requests_sent++;
+    ur_atomic_add_relaxed(&client->requests_sent, 1);
 
     // Cleanup
     free(request_topic);
-    free(json_payload);
     return UR_RPC_SUCCESS;
 }
 
+int ur_rpc_call_batch(ur_rpc_client_t* client, const ur_rpc_request_t* const* requests, int count, ur_rpc_response_handler_t callback, void* user_data) {
+    if (!client || !requests || count <= 0 || !ur_atomic_load(&client->connected)) {
+        return UR_RPC_ERROR_INVALID_PARAM;
+    }
+
+    // One request topic carries the batch, so every request targets the same service
+    const char* service = requests[0] ? requests[0]->service : NULL;
+    for (int i = 0; i < count; i++) {
+        if (!requests[i] || !requests[i]->transaction_id || !requests[i]->method || !requests[i]->service ||
+            strcmp(requests[i]->service, service) != 0) {
+            return UR_RPC_ERROR_INVALID_PARAM;
+        }
+    }
+
+    char* request_topic = ur_rpc_generate_request_topic(client, "batch", service, NULL);
+    if (!request_topic) return UR_RPC_ERROR_MEMORY;
+
+    ur_rpc_encoding_t encoding = client->config.payload_encoding;
+    json_writer_t* payload = jw_pooled();
+    if (payload) {
+        batch_open(payload, encoding);
+        for (int i = 0; i < count; i++) {
+            if (i > 0) batch_separator(payload, encoding);
+            request_encode(payload, requests[i], &client->config);
+        }
+        batch_close(payload, encoding);
+    }
+    if (!payload || payload->failed) {
+        jw_pooled_release(payload);
+        free(request_topic);
+        return UR_RPC_ERROR_JSON;
+    }
+
+    LOG_INFO_SIMPLE("BATCH RPC CALL: %s, %d request(s)", service, count);
+
+    int registered = 0;
+    int result = UR_RPC_SUCCESS;
+    if (callback) {
+        for (; registered < count; registered++) {
+            result = pending_register_async(client, requests[registered], callback, user_data);
+            if (result != UR_RPC_SUCCESS) break;
+        }
+    }
+
+    if (result == UR_RPC_SUCCESS) {
+        result = ur_rpc_publish_message(client, request_topic, payload->data, payload->length);
+        if (result != UR_RPC_SUCCESS) {
+            LOG_ERROR_SIMPLE("Failed to publish batch request to broker (error: %d)", result);
+        }
+    }
+    jw_pooled_release(payload);
+
+    if (result != UR_RPC_SUCCESS) {
+        for (int i = 0; i < registered; i++) {
+            pending_cancel(client, requests[i]->transaction_id);
+        }
+    } else {
+        LOG_DEBUG_SIMPLE("Published batch request to topic: %s", request_topic);
+        ur_atomic_add_relaxed(&client->requests_sent, (uint64_t)count);
+    }
+
+    free(request_topic);
+    return result;
+}
+
 int ur_rpc_send_notification(ur_rpc_client_t* client, const char* method, const char* service, ur_rpc_authority_t authority, const cJSON* params) {
     if (!client || !method || !service || !ur_atomic_load(&client->connected)) {
         return UR_RPC_ERROR_INVALID_PARAM;
@@ -1845,36 +4303,34 @@ int ur_rpc_send_notification(ur_rpc_client_t* client, const char* method, const
     char* notification_topic = ur_rpc_generate_notification_topic(client, method, service);
     if (!notification_topic) return UR_RPC_ERROR_MEMORY;
 
-    // Create notification JSON structure
-    cJSON* notification_json = cJSON_CreateObject();
-    if (!notification_json) {
+    // Serialize in the configured encoding
+    json_writer_t* payload = jw_pooled();
+    if (payload) {
+        if (client->config.payload_encoding == UR_RPC_ENCODING_CBOR) {
+            notification_write_cbor(payload, method, service, authority, params);
+        } else {
+            notification_write(payload, method, service, authority, params);
+        }
+    }
+    if (!payload || payload->failed) {
+        jw_pooled_release(payload);
         free(notification_topic);
         return UR_RPC_ERROR_JSON;
     }
 
-    cJSON_AddStringToObject(notification_json, "method", method);
-    cJSON_AddStringToObject(notification_json, "service", service);
-    cJSON_AddStringToObject(notification_json, "authority", ur_rpc_authority_to_string(authority));
-    cJSON_AddNumberToObject(notification_json, "timestamp", ur_rpc_get_timestamp_ms());
-    cJSON_AddStringToObject(notification_json, "type", "notification");
-
-    if (params) {
-        cJSON_AddItemToObject(notification_json, "params", cJSON_Duplicate(params, 1));
-    }
-
-    // Serialize to JSON string
-    char* json_payload = cJSON_Print(notification_json);
-    cJSON_Delete(notification_json);
-
-    if (!json_payload) {
+    if (client->config.notification_batch.max_messages > 1) {
+        LOG_DEBUG_SIMPLE("NOTIFICATION (queued): %s.%s", service, method);
+        int result = notify_enqueue(client, notification_topic, payload->data, payload->length);
+        jw_pooled_release(payload);
         free(notification_topic);
-        return UR_RPC_ERROR_JSON;
+        return result;
     }
 
     LOG_INFO_SIMPLE("NOTIFICATION: %s.%s (authority: %s)",
            service, method, ur_rpc_authority_to_string(authority));
 
-    if (params) {
+    /* Only pay for pretty-printing when the line will be written */
+    if (params && logger_is_enabled(LOG_DEBUG)) {
         char* params_str = cJSON_Print(params);
         if (params_str) {
             LOG_DEBUG_SIMPLE("  Params: %s", params_str);
@@ -1883,20 +4339,19 @@ int ur_rpc_send_notification(ur_rpc_client_t* client, const char* method, const
     }
 
     // Publish the notification to the broker
-    int result = ur_rpc_publish_message(client, notification_topic, json_payload, strlen(json_payload));
+    int result = ur_rpc_publish_message(client, notification_topic, payload->data, payload->length);
+    jw_pooled_release(payload);
     if (result != UR_RPC_SUCCESS) {
         LOG_ERROR_SIMPLE("Failed to publish notification to broker (error: %d)", result);
         free(notification_topic);
-        free(json_payload);
         return result;
     }
 
     LOG_DEBUG_SIMPLE("Published notification to topic: %s", notification_topic);
-    client->messages_sent++;
+    ur_atomic_add_relaxed(&client->messages_sent, 1);
 
     // Cleanup
     free(notification_topic);
-    free(json_payload);
     return UR_RPC_SUCCESS;
 }
 
@@ -1950,35 +4405,43 @@ int ur_rpc_unsubscribe_topic(ur_rpc_client_t* client, const char* topic) {
 int ur_rpc_client_get_statistics(const ur_rpc_client_t* client, ur_rpc_statistics_t* stats) {
     if (!client || !stats) return UR_RPC_ERROR_INVALID_PARAM;
 
-    pthread_mutex_lock((pthread_mutex_t*)&client->mutex);
-
-    stats->messages_sent = client->messages_sent;
-    stats->messages_received = client->messages_received;
-    stats->requests_sent = client->requests_sent;
-    stats->responses_received = client->responses_received;
+    stats->messages_sent = ur_atomic_load_relaxed(&client->messages_sent);
+    stats->messages_received = ur_atomic_load_relaxed(&client->messages_received);
+    stats->requests_sent = ur_atomic_load_relaxed(&client->requests_sent);
+    stats->responses_received = ur_atomic_load_relaxed(&client->responses_received);
     stats->notifications_sent = 0; // TODO: track separately
-    stats->errors_count = client->errors_count;
+    stats->errors_count = ur_atomic_load_relaxed(&client->errors_count);
     stats->connection_count = 1; // TODO: track reconnections
-    stats->uptime_seconds = time(NULL) - client->last_activity;
-    stats->last_activity = client->last_activity;
-
-    pthread_mutex_unlock((pthread_mutex_t*)&client->mutex);
+    stats->last_activity = ur_atomic_load_relaxed(&client->last_activity);
+    stats->uptime_seconds = time(NULL) - stats->last_activity;
+    stats->publish_would_block = ur_atomic_load_relaxed(&client->publish_would_block);
+    stats->heartbeats_sent = ur_atomic_load_relaxed(&client->heartbeats_sent);
+    stats->heartbeats_echoed = ur_atomic_load_relaxed(&client->heartbeats_echoed);
+    stats->heartbeat_rtt_us = ur_atomic_load_relaxed(&client->heartbeat_rtt_us);
+
+    pthread_mutex_lock((pthread_mutex_t*)&client->window_mutex);
+    stats->outstanding_messages = (uint64_t)client->outstanding;
+    stats->peak_outstanding = (uint64_t)client->peak_outstanding;
+    pthread_mutex_unlock((pthread_mutex_t*)&client->window_mutex);
     return UR_RPC_SUCCESS;
 }
 
 int ur_rpc_client_reset_statistics(ur_rpc_client_t* client) {
     if (!client) return UR_RPC_ERROR_INVALID_PARAM;
 
-    pthread_mutex_lock(&client->mutex);
-
-    client->messages_sent = 0;
-    client->messages_received = 0;
-    client->requests_sent = 0;
-    client->responses_received = 0;
-    client->errors_count = 0;
-    client->last_activity = time(NULL);
-
-    pthread_mutex_unlock(&client->mutex);
+    ur_atomic_store_relaxed(&client->messages_sent, 0);
+    ur_atomic_store_relaxed(&client->messages_received, 0);
+    ur_atomic_store_relaxed(&client->requests_sent, 0);
+    ur_atomic_store_relaxed(&client->responses_received, 0);
+    ur_atomic_store_relaxed(&client->errors_count, 0);
+    ur_atomic_store_relaxed(&client->publish_would_block, 0);
+    ur_atomic_store_relaxed(&client->heartbeats_sent, 0);
+    ur_atomic_store_relaxed(&client->heartbeats_echoed, 0);
+    ur_atomic_store_relaxed(&client->last_activity, time(NULL));
+
+    pthread_mutex_lock(&client->window_mutex);
+    client->peak_outstanding = client->outstanding;
+    pthread_mutex_unlock(&client->window_mutex);
     return UR_RPC_SUCCESS;
 }
 
@@ -2087,46 +4550,252 @@ int ur_rpc_relay_config_set_prefix(ur_rpc_relay_config_t* config, const char* pr
     return config->relay_prefix ? UR_RPC_SUCCESS : UR_RPC_ERROR_MEMORY;
 }
 
+/* ----------------------------------------------------------------------------
+ * Relay rule trie
+ *
+ * Source topics are MQTT filters split on '/'. Each level keeps its literal
+ * children sorted for binary search, plus dedicated '+' and '#' children, and
+ * each node lists the rules whose filter ends there. Matching a topic is one
+ * walk down the levels, branching only where a '+' child exists.
+ * ---------------------------------------------------------------------------- */
+
+struct ur_rpc_topic_node {
+    char* segment;
+    size_t segment_len;
+    struct ur_rpc_topic_node** children;   // Literal levels, sorted
+    int child_count;
+    int child_capacity;
+    struct ur_rpc_topic_node* plus;        // '+' level
+    struct ur_rpc_topic_node* hash;        // '#' level
+    int* rules;                            // Indices into config.rules
+    int rule_count;
+};
+
+static struct ur_rpc_topic_node* topic_node_create(const char* segment, size_t len) {
+    struct ur_rpc_topic_node* node = calloc(1, sizeof(struct ur_rpc_topic_node));
+    if (!node) return NULL;
+
+    node->segment = malloc(len + 1);
+    if (!node->segment) {
+        free(node);
+        return NULL;
+    }
+    memcpy(node->segment, segment, len);
+    node->segment[len] = '\0';
+    node->segment_len = len;
+    return node;
+}
+
+static void topic_node_free(struct ur_rpc_topic_node* node) {
+    if (!node) return;
+
+    for (int i = 0; i < node->child_count; i++) {
+        topic_node_free(node->children[i]);
+    }
+    topic_node_free(node->plus);
+    topic_node_free(node->hash);
+    free(node->children);
+    free(node->rules);
+    free(node->segment);
+    free(node);
+}
+
+static int topic_segment_compare(const char* a, size_t a_len, const char* b, size_t b_len) {
+    int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (cmp != 0) return cmp;
+    return a_len < b_len ? -1 : (a_len > b_len ? 1 : 0);
+}
+
+/* Binary search over the literal children; returns the match or NULL and
+ * sets *insert_at to where the segment belongs */
+static struct ur_rpc_topic_node* topic_node_find(const struct ur_rpc_topic_node* node,
+                                                 const char* segment, size_t len, int* insert_at) {
+    int lo = 0, hi = node->child_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const struct ur_rpc_topic_node* child = node->children[mid];
+        int cmp = topic_segment_compare(child->segment, child->segment_len, segment, len);
+        if (cmp == 0) return node->children[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (insert_at) *insert_at = lo;
+    return NULL;
+}
+
+static struct ur_rpc_topic_node* topic_node_child(struct ur_rpc_topic_node* node, const char* segment, size_t len) {
+    struct ur_rpc_topic_node** wildcard = NULL;
+    if (len == 1 && segment[0] == '+') wildcard = &node->plus;
+    if (len == 1 && segment[0] == '#') wildcard = &node->hash;
+    if (wildcard) {
+        if (!*wildcard) *wildcard = topic_node_create(segment, len);
+        return *wildcard;
+    }
+
+    int insert_at = 0;
+    struct ur_rpc_topic_node* child = topic_node_find(node, segment, len, &insert_at);
+    if (child) return child;
+
+    if (node->child_count == node->child_capacity) {
+        int capacity = node->child_capacity ? node->child_capacity * 2 : 4;
+        struct ur_rpc_topic_node** children = realloc(node->children, (size_t)capacity * sizeof(*children));
+        if (!children) return NULL;
+        node->children = children;
+        node->child_capacity = capacity;
+    }
+
+    child = topic_node_create(segment, len);
+    if (!child) return NULL;
+
+    memmove(&node->children[insert_at + 1], &node->children[insert_at],
+            (size_t)(node->child_count - insert_at) * sizeof(*node->children));
+    node->children[insert_at] = child;
+    node->child_count++;
+    return child;
+}
+
+static int topic_trie_insert(struct ur_rpc_topic_node* root, const char* filter, int rule_index) {
+    struct ur_rpc_topic_node* node = root;
+    const char* segment = filter;
+
+    for (;;) {
+        const char* end = strchr(segment, '/');
+        size_t len = end ? (size_t)(end - segment) : strlen(segment);
+
+        // '#' is only valid as the whole last level
+        if (memchr(segment, '#', len) && (len != 1 || end)) return UR_RPC_ERROR_INVALID_PARAM;
+        if (memchr(segment, '+', len) && len != 1) return UR_RPC_ERROR_INVALID_PARAM;
+
+        node = topic_node_child(node, segment, len);
+        if (!node) return UR_RPC_ERROR_MEMORY;
+
+        if (!end) break;
+        segment = end + 1;
+    }
+
+    int* rules = realloc(node->rules, (size_t)(node->rule_count + 1) * sizeof(int));
+    if (!rules) return UR_RPC_ERROR_MEMORY;
+    node->rules = rules;
+    node->rules[node->rule_count++] = rule_index;
+    return UR_RPC_SUCCESS;
+}
+
+static void topic_trie_collect(const struct ur_rpc_topic_node* node, int* matches, int* match_count) {
+    for (int i = 0; i < node->rule_count && *match_count < UR_RPC_MAX_RELAY_RULES; i++) {
+        matches[(*match_count)++] = node->rules[i];
+    }
+}
+
+/* segment points at the start of the level to match, or is NULL once the
+ * whole topic has been consumed */
+static void topic_trie_match(const struct ur_rpc_topic_node* node, const char* segment,
+                             int* matches, int* match_count) {
+    // "a/#" also matches "a" itself
+    if (node->hash) topic_trie_collect(node->hash, matches, match_count);
+
+    if (!segment) {
+        topic_trie_collect(node, matches, match_count);
+        return;
+    }
+
+    const char* end = strchr(segment, '/');
+    size_t len = end ? (size_t)(end - segment) : strlen(segment);
+    const char* next = end ? end + 1 : NULL;
+
+    const struct ur_rpc_topic_node* child = topic_node_find(node, segment, len, NULL);
+    if (child) topic_trie_match(child, next, matches, match_count);
+    if (node->plus) topic_trie_match(node->plus, next, matches, match_count);
+}
+
+static int compare_rule_index(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+/* Rule indices matching topic, in configuration order */
+static int topic_trie_lookup(const struct ur_rpc_topic_node* root, const char* topic, int* matches) {
+    int match_count = 0;
+    if (!root) return 0;
+
+    // Wildcards at the first level never match "$SYS"-style topics
+    if (topic[0] == '$') {
+        const char* end = strchr(topic, '/');
+        size_t len = end ? (size_t)(end - topic) : strlen(topic);
+        const struct ur_rpc_topic_node* child = topic_node_find(root, topic, len, NULL);
+        if (child) topic_trie_match(child, end ? end + 1 : NULL, matches, &match_count);
+    } else {
+        topic_trie_match(root, topic, matches, &match_count);
+    }
+
+    if (match_count > 1) qsort(matches, (size_t)match_count, sizeof(int), compare_rule_index);
+    return match_count;
+}
+
+static struct ur_rpc_topic_node* topic_trie_build(const ur_rpc_relay_config_t* config) {
+    struct ur_rpc_topic_node* root = topic_node_create("", 0);
+    if (!root) return NULL;
+
+    for (int i = 0; i < config->rule_count; i++) {
+        const char* filter = config->rules[i].source_topic;
+        if (!filter || !*filter) continue;
+
+        int result = topic_trie_insert(root, filter, i);
+        if (result == UR_RPC_ERROR_MEMORY) {
+            topic_node_free(root);
+            return NULL;
+        }
+        if (result != UR_RPC_SUCCESS) {
+            LOG_WARN_SIMPLE("Ignoring relay rule %d: invalid source topic filter '%s'", i, filter);
+        }
+    }
+    return root;
+}
+
+/* Destination topic of a rule with its prefix applied, computed once at
+ * create so forwarding does no string work */
+static char* relay_resolve_destination(const ur_rpc_relay_config_t* config, const ur_rpc_relay_rule_t* rule) {
+    const char* prefix = rule->topic_prefix ? rule->topic_prefix : config->relay_prefix;
+    if (!rule->destination_topic) return NULL;
+    if (!prefix) return strdup(rule->destination_topic);
+
+    size_t prefix_len = strlen(prefix);
+    size_t dest_len = strlen(rule->destination_topic);
+    char* topic = malloc(prefix_len + dest_len + 1);
+    if (!topic) return NULL;
+    memcpy(topic, prefix, prefix_len);
+    memcpy(topic + prefix_len, rule->destination_topic, dest_len + 1);
+    return topic;
+}
+
 /* Relay message handler */
 static void relay_message_handler(const char* topic, const char* payload, size_t payload_len, void* user_data) {
     ur_rpc_relay_client_t* relay_client = (ur_rpc_relay_client_t*)user_data;
     if (!relay_client || !topic || !payload) return;
 
-    pthread_mutex_lock(&relay_client->relay_mutex);
-
-    // Find matching relay rules
-    for (int i = 0; i < relay_client->config.rule_count; i++) {
-        ur_rpc_relay_rule_t* rule = &relay_client->config.rules[i];
-
-        // Simple topic matching (can be enhanced with wildcards)
-        if (strstr(topic, rule->source_topic) == NULL) continue;
+    // The trie is read-only once built
+    int matches[UR_RPC_MAX_RELAY_RULES];
+    int match_count = topic_trie_lookup(relay_client->rule_trie, topic, matches);
+    if (match_count == 0) return;
 
-        // Build destination topic
-        char dest_topic[UR_RPC_MAX_TOPIC_LENGTH];
-        if (rule->topic_prefix) {
-            snprintf(dest_topic, sizeof(dest_topic), "%s%s", rule->topic_prefix, rule->destination_topic);
-        } else if (relay_client->config.relay_prefix) {
-            snprintf(dest_topic, sizeof(dest_topic), "%s%s", relay_client->config.relay_prefix, rule->destination_topic);
-        } else {
-            strncpy(dest_topic, rule->destination_topic, sizeof(dest_topic) - 1);
-            dest_topic[sizeof(dest_topic) - 1] = '\0';
-        }
+    for (int m = 0; m < match_count; m++) {
+        ur_rpc_relay_rule_t* rule = &relay_client->config.rules[matches[m]];
+        const char* dest_topic = relay_client->dest_topics[matches[m]];
 
         // Get destination client
         ur_rpc_client_t* dest_client = relay_client->clients[rule->dest_broker_index];
-        if (!dest_client || !ur_rpc_client_is_connected(dest_client)) {
-            relay_client->relay_errors++;
+        if (!dest_topic || !dest_client || !ur_rpc_client_is_connected(dest_client)) {
+            ur_atomic_add_relaxed(&relay_client->relay_errors, 1);
             continue;
         }
 
-        // Forward the message
+        // Forward the incoming payload buffer as is; mosquitto takes its
+        // own copy when it queues the packet
         int result = ur_rpc_publish_message(dest_client, dest_topic, payload, payload_len);
         if (result == UR_RPC_SUCCESS) {
-            relay_client->messages_relayed++;
-            LOG_INFO_SIMPLE("RELAYED: %s -> %s (broker %d -> %d)",
+            ur_atomic_add_relaxed(&relay_client->messages_relayed, 1);
+            LOG_DEBUG_SIMPLE("RELAYED: %s -> %s (broker %d -> %d)",
                    topic, dest_topic, rule->source_broker_index, rule->dest_broker_index);
         } else {
-            relay_client->relay_errors++;
+            ur_atomic_add_relaxed(&relay_client->relay_errors, 1);
             LOG_ERROR_SIMPLE("RELAY FAILED: %s -> %s (error: %d)", topic, dest_topic, result);
         }
 
@@ -2135,8 +4804,6 @@ static void relay_message_handler(const char* topic, const char* payload, size_t
             // TODO: Implement bidirectional relay logic to prevent loops
         }
     }
-
-    pthread_mutex_unlock(&relay_client->relay_mutex);
 }
 
 /* Create relay client */
@@ -2194,8 +4861,19 @@ ur_rpc_relay_client_t* ur_rpc_relay_client_create(const ur_rpc_client_config_t*
         dst->bidirectional = src->bidirectional;
     }
 
+    for (int i = 0; i < relay_client->config.rule_count; i++) {
+        relay_client->dest_topics[i] = relay_resolve_destination(&relay_client->config, &relay_client->config.rules[i]);
+    }
+
+    relay_client->rule_trie = topic_trie_build(&relay_client->config);
+
     // Initialize mutex
-    if (pthread_mutex_init(&relay_client->relay_mutex, NULL) != 0) {
+    if (!relay_client->rule_trie || pthread_mutex_init(&relay_client->relay_mutex, NULL) != 0) {
+        topic_node_free(relay_client->rule_trie);
+        for (int i = 0; i < relay_client->config.rule_count; i++) {
+            free(relay_client->dest_topics[i]);
+        }
+        ur_rpc_relay_config_cleanup(&relay_client->config);
         free(relay_client);
         return NULL;
     }
@@ -2264,6 +4942,10 @@ void ur_rpc_relay_client_destroy(ur_rpc_relay_client_t* relay_client) {
     }
 
     // Cleanup configuration
+    topic_node_free(relay_client->rule_trie);
+    for (int i = 0; i < UR_RPC_MAX_RELAY_RULES; i++) {
+        free(relay_client->dest_topics[i]);
+    }
     ur_rpc_relay_config_cleanup(&relay_client->config);
 
     // Destroy mutex
@@ -2364,6 +5046,11 @@ int ur_rpc_relay_client_stop(ur_rpc_relay_client_t* relay_client) {
     return UR_RPC_SUCCESS;
 }
 
+int ur_rpc_relay_client_match(const ur_rpc_relay_client_t* relay_client, const char* topic, int* matches) {
+    if (!relay_client || !topic || !matches) return 0;
+    return topic_trie_lookup(relay_client->rule_trie, topic, matches);
+}
+
 /* Conditional relay control functions */
 int ur_rpc_relay_set_secondary_connection_ready(bool ready) {
     g_sec_conn_ready = ready;
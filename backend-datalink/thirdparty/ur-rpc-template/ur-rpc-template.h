@@ -21,6 +21,11 @@ extern "C" {
     #define ur_atomic_init(x, val) ((*(x)) = (val))
     typedef volatile int ur_atomic_int;
     typedef volatile bool ur_atomic_bool;
+    typedef volatile uint64_t ur_atomic_u64;
+    typedef volatile time_t ur_atomic_time;
+    #define ur_atomic_add_relaxed(x, n) ((*(x)) += (n))
+    #define ur_atomic_load_relaxed(x) (*(x))
+    #define ur_atomic_store_relaxed(x, val) ((*(x)) = (val))
 #else
     // C mode - handle atomic operations properly
     #ifdef __STDC_NO_ATOMICS__
@@ -28,16 +33,27 @@ extern "C" {
         #define ur_atomic_load(x) (*(x))
         #define ur_atomic_store(x, val) ((*(x)) = (val))
         #define ur_atomic_init(x, val) ((*(x)) = (val))
+        #define ur_atomic_add_relaxed(x, n) ((*(x)) += (n))
+        #define ur_atomic_load_relaxed(x) (*(x))
+        #define ur_atomic_store_relaxed(x, val) ((*(x)) = (val))
         typedef volatile int ur_atomic_int;
         typedef volatile bool ur_atomic_bool;
+        typedef volatile uint64_t ur_atomic_u64;
+        typedef volatile time_t ur_atomic_time;
     #else
         // Use C11 atomics
         #include <stdatomic.h>
         #define ur_atomic_load(x) atomic_load(x)
         #define ur_atomic_store(x, val) atomic_store(x, val)
         #define ur_atomic_init(x, val) atomic_init(x, val)
+        // Statistics counters: no ordering needed, just no torn or lost updates
+        #define ur_atomic_add_relaxed(x, n) atomic_fetch_add_explicit(x, n, memory_order_relaxed)
+        #define ur_atomic_load_relaxed(x) atomic_load_explicit(x, memory_order_relaxed)
+        #define ur_atomic_store_relaxed(x, val) atomic_store_explicit(x, val, memory_order_relaxed)
         typedef atomic_int ur_atomic_int;
         typedef atomic_bool ur_atomic_bool;
+        typedef _Atomic uint64_t ur_atomic_u64;
+        typedef _Atomic time_t ur_atomic_time;
     #endif
 #endif
 
@@ -51,7 +67,8 @@ typedef enum {
     UR_RPC_ERROR_TIMEOUT = -5,
     UR_RPC_ERROR_NOT_CONNECTED = -6,
     UR_RPC_ERROR_CONFIG = -7,
-    UR_RPC_ERROR_THREAD = -8
+    UR_RPC_ERROR_THREAD = -8,
+    UR_RPC_ERROR_WOULD_BLOCK = -9
 } ur_rpc_error_t;
 
 /* Request authority levels */
@@ -88,7 +105,12 @@ typedef enum {
 #define UR_RPC_DEFAULT_TIMEOUT_MS 30000
 #define UR_RPC_MAX_BROKERS 16
 #define UR_RPC_MAX_PREFIX_LENGTH 128
-#define UR_RPC_MAX_RELAY_RULES 32
+#define UR_RPC_MAX_RELAY_RULES 256
+#define UR_RPC_PENDING_INITIAL_BUCKETS 64  // Pending request hash table, grows by doubling
+#define UR_RPC_TIMER_WHEEL_SLOTS 256       // Timeout wheel: slots x tick covers 25.6s per turn
+#define UR_RPC_TIMER_TICK_MS 100
+#define UR_RPC_MAX_NOTIFY_TOPICS 16        // Topics with notifications waiting to be coalesced
+#define UR_RPC_MAX_CHUNKED_RESPONSE (16 * 1024 * 1024)  // Largest response accepted in chunks
 
 /* Topic list structure for JSON configuration */
 typedef struct {
@@ -103,8 +125,26 @@ typedef struct {
     char* topic;               // Heartbeat topic
     int interval_seconds;      // Heartbeat interval in seconds
     char* payload;            // Custom heartbeat payload (JSON string)
+    bool echo;                 // Subscribe to the topic and time each beat's round trip
 } ur_rpc_heartbeat_config_t;
 
+/* Notification coalescing: notifications for one topic are held until
+ * max_messages are queued or the oldest has waited max_delay_us, then go out
+ * as a single publish (a JSON array when more than one). max_messages <= 1
+ * sends each notification on its own. */
+typedef struct {
+    int max_messages;
+    int max_delay_us;
+} ur_rpc_notification_batch_config_t;
+
+/* Encoding of the requests, notifications and responses a client sends.
+ * Payloads are read in either: CBOR ones start with an array or map byte
+ * (0x80-0xBF), which JSON never does, so peers can switch one at a time. */
+typedef enum {
+    UR_RPC_ENCODING_JSON = 0,
+    UR_RPC_ENCODING_CBOR = 1    // RFC 8949; same fields as the JSON form
+} ur_rpc_encoding_t;
+
 /* Broker configuration for relay */
 typedef struct {
     char* host;                // Broker hostname
@@ -159,6 +199,11 @@ typedef struct {
     bool auto_reconnect;       // Enable automatic reconnection
     int reconnect_delay_min;   // Minimum reconnect delay (seconds)
     int reconnect_delay_max;   // Maximum reconnect delay (seconds)
+    bool reconnect_jitter;     // Randomise reconnect delays between min and max (decorrelated jitter)
+    char* shared_group;        // Join json_added_subs as "$share/<group>/<topic>" (optional)
+    ur_rpc_encoding_t payload_encoding; // Encoding of outgoing payloads ("payload_encoding": "json" / "cbor")
+    int publish_window;        // Messages awaiting write or ack before windowed publishes block (0 = unlimited)
+    int chunk_window;          // Chunks of a large response taken before acking them (0 = whole responses only)
 
     /* Topic configuration from JSON */
     ur_rpc_topic_list_t json_added_pubs;  // Topics to publish from JSON config
@@ -167,13 +212,19 @@ typedef struct {
     /* Heartbeat configuration */
     ur_rpc_heartbeat_config_t heartbeat;
 
+    /* Notification coalescing */
+    ur_rpc_notification_batch_config_t notification_batch;
+
     /* Relay configuration */
     ur_rpc_relay_config_t relay;
 } ur_rpc_client_config_t;
 
+/* Block allocator for requests, responses and their strings (opaque) */
+typedef struct ur_rpc_arena ur_rpc_arena_t;
+
 /* RPC request structure */
 typedef struct {
-    char* transaction_id;      // Unique transaction identifier
+    char* transaction_id;      // Unique transaction identifier, normally transaction_id_buf
     char* method;              // RPC method name
     char* service;             // Target service name
     ur_rpc_authority_t authority; // Request authority level
@@ -181,6 +232,8 @@ typedef struct {
     char* response_topic;      // Response topic for this request
     uint64_t timestamp;        // Request timestamp
     int timeout_ms;            // Request timeout in milliseconds
+    char transaction_id_buf[UR_RPC_MAX_TRANSACTION_ID_LENGTH]; // Inline storage for transaction_id
+    ur_rpc_arena_t* arena;     // Owning arena, NULL when heap allocated
 } ur_rpc_request_t;
 
 /* RPC response structure */
@@ -192,6 +245,7 @@ typedef struct {
     int error_code;            // Error code (if failed)
     uint64_t timestamp;        // Response timestamp
     uint64_t processing_time_ms; // Processing time in milliseconds
+    ur_rpc_arena_t* arena;     // Owning arena, NULL when heap allocated
 } ur_rpc_response_t;
 
 /* Topic configuration structure */
@@ -213,6 +267,17 @@ typedef void (*ur_rpc_response_handler_t)(const ur_rpc_response_t* response, voi
 /* Connection status callback function */
 typedef void (*ur_rpc_connection_callback_t)(ur_rpc_connection_status_t status, void* user_data);
 
+/* Publish window capacity callback, see ur_rpc_publish_message_window */
+typedef void (*ur_rpc_capacity_callback_t)(void* user_data);
+
+/* Heartbeat echo callback: beat seq came back from the broker rtt_ms after
+ * it was published */
+typedef void (*ur_rpc_heartbeat_rtt_callback_t)(uint64_t seq, double rtt_ms, void* user_data);
+
+/* Shared timer callback function and handle (0 is never a valid timer) */
+typedef void (*ur_rpc_timer_callback_t)(void* user_data);
+typedef uint64_t ur_rpc_timer_id_t;
+
 /* Thread monitor structure */
 typedef struct {
     pthread_t thread_id;
@@ -223,7 +288,9 @@ typedef struct {
     uint64_t error_count;
 } ur_rpc_thread_monitor_t;
 
-/* Pending request structure (for tracking responses) */
+/* Pending request structure (for tracking responses). Each entry sits in a
+ * hash bucket chain keyed by transaction_id; async entries are also linked
+ * into the timer wheel slot of their deadline. */
 typedef struct ur_rpc_pending_request {
     char* transaction_id;
     char* response_topic;
@@ -231,9 +298,33 @@ typedef struct ur_rpc_pending_request {
     void* user_data;
     time_t created_time;
     int timeout_ms;
-    struct ur_rpc_pending_request* next;
+    uint64_t deadline_ms;      // Monotonic expiry time
+    struct ur_rpc_pending_request* next;   // Hash bucket chain
+
+    /* Timer wheel slot list (async requests only) */
+    struct ur_rpc_pending_request* wheel_prev;
+    struct ur_rpc_pending_request* wheel_next;
+    unsigned int wheel_slot;
+
+    /* A chunked response, from its first chunk until it is whole */
+    struct ur_rpc_chunk_buffer* chunks;
+
+    /* Sync requests: the caller waits on done_cond for response */
+    pthread_cond_t* done_cond;
+    ur_rpc_response_t* response;
+    bool completed;
 } ur_rpc_pending_request_t;
 
+/* Notifications queued for one topic */
+typedef struct {
+    char* topic;
+    char* payload;             // Encoded notifications, "[a,b,..." unterminated array
+    size_t length;
+    size_t capacity;
+    int count;
+    uint64_t first_queued_us;  // Monotonic time the oldest was queued
+} ur_rpc_notify_buffer_t;
+
 /* Main RPC client structure */
 typedef struct {
     struct mosquitto* mosq;
@@ -249,8 +340,12 @@ typedef struct {
 
     /* Threading */
     pthread_t mqtt_thread;
-    pthread_t heartbeat_thread;
+    ur_rpc_timer_id_t heartbeat_timer;  // Shared timer, 0 when not started
     ur_atomic_bool heartbeat_running;
+    uint64_t heartbeat_seq;             // Last beat sent, under mutex
+    uint64_t heartbeat_sent_us;         // Monotonic send time of that beat, 0 once echoed
+    ur_rpc_heartbeat_rtt_callback_t heartbeat_rtt_callback;
+    void* heartbeat_rtt_user_data;
     pthread_mutex_t mutex;
     ur_rpc_thread_monitor_t thread_monitor;
 
@@ -258,32 +353,68 @@ typedef struct {
     ur_rpc_message_handler_t message_handler;
     void* message_user_data;
 
-    /* Pending requests tracking */
-    ur_rpc_pending_request_t* pending_requests;
+    /* Pending requests tracking: transaction_id hash table plus a timer
+     * wheel the shared timer advances every UR_RPC_TIMER_TICK_MS while
+     * async requests are pending */
+    ur_rpc_pending_request_t** pending_buckets;
+    size_t pending_bucket_count;
+    size_t pending_count;
+    ur_rpc_pending_request_t* timer_wheel[UR_RPC_TIMER_WHEEL_SLOTS];
+    uint64_t timer_wheel_tick;    // Last tick expired
     pthread_mutex_t pending_mutex;
-
-    /* Statistics */
-    uint64_t messages_sent;
-    uint64_t messages_received;
-    uint64_t requests_sent;
-    uint64_t responses_received;
-    uint64_t errors_count;
-    time_t last_activity;
+    ur_rpc_timer_id_t pending_timer;  // Ticks the wheel, 0 while idle
+    ur_atomic_bool timer_running;
+
+    /* Notification coalescing; the flusher thread only runs when enabled */
+    ur_rpc_notify_buffer_t notify_buffers[UR_RPC_MAX_NOTIFY_TOPICS];
+    int notify_buffer_count;
+    pthread_mutex_t notify_mutex;
+    pthread_cond_t notify_cond;
+    pthread_t notify_thread;
+    ur_atomic_bool notify_running;
+
+    /* Publish window: messages handed to mosquitto whose publish callback
+     * has not run yet, i.e. not yet written (QoS 0) or acknowledged */
+    int outstanding;
+    int peak_outstanding;
+    int window_waiters;
+    bool window_full;             // A windowed publish was refused since capacity last freed
+    pthread_mutex_t window_mutex;
+    pthread_cond_t window_cond;
+    ur_rpc_capacity_callback_t capacity_callback;
+    void* capacity_user_data;
+
+    /* Statistics, updated with relaxed atomics off the message path locks */
+    ur_atomic_u64 messages_sent;
+    ur_atomic_u64 messages_received;
+    ur_atomic_u64 requests_sent;
+    ur_atomic_u64 responses_received;
+    ur_atomic_u64 errors_count;
+    ur_atomic_u64 publish_would_block;
+    ur_atomic_u64 heartbeats_sent;
+    ur_atomic_u64 heartbeats_echoed;
+    ur_atomic_u64 heartbeat_rtt_us;
+    ur_atomic_time last_activity;
 } ur_rpc_client_t;
 
+/* Topic filter trie node, private to the implementation */
+struct ur_rpc_topic_node;
+
 /* Multi-broker relay client structure */
 typedef struct {
     ur_rpc_client_t* clients[UR_RPC_MAX_BROKERS];  // Array of client connections
     ur_rpc_relay_config_t config;                  // Relay configuration
+    struct ur_rpc_topic_node* rule_trie;           // Rule source topics, built once at create
+    char* dest_topics[UR_RPC_MAX_RELAY_RULES];     // Prefixed destination topic per rule
 
     /* Threading */
     pthread_t relay_thread;
     ur_atomic_bool relay_running;
     pthread_mutex_t relay_mutex;
 
-    /* Statistics */
-    uint64_t messages_relayed;
-    uint64_t relay_errors;
+    /* Statistics (relaxed atomics, updated from each broker's loop thread) */
+    ur_atomic_u64 messages_relayed;
+    ur_atomic_u64 relay_errors;
     time_t relay_start_time;
 
     /* Message handling */
@@ -310,6 +441,32 @@ int ur_rpc_config_set_tls_version(ur_rpc_client_config_t* config, const char* tl
 int ur_rpc_config_set_tls_insecure(ur_rpc_client_config_t* config, bool insecure);
 int ur_rpc_config_set_timeouts(ur_rpc_client_config_t* config, int connect_timeout, int message_timeout);
 int ur_rpc_config_set_reconnect(ur_rpc_client_config_t* config, bool auto_reconnect, int min_delay, int max_delay);
+int ur_rpc_config_set_reconnect_jitter(ur_rpc_client_config_t* config, bool jitter);
+
+/* Subscribes the json_added_subs topics as MQTT shared subscriptions: the
+ * broker hands each message to one member of the group, so instances with
+ * the same group split the load instead of all seeing every message.
+ * Needs a broker that accepts "$share/" filters from MQTT 3.1.1 clients
+ * (mosquitto 1.6+, EMQX, HiveMQ). NULL or "" turns it off. The group may not contain '/', '+' or '#'. */
+int ur_rpc_config_set_shared_group(ur_rpc_client_config_t* config, const char* group);
+
+int ur_rpc_config_set_payload_encoding(ur_rpc_client_config_t* config, ur_rpc_encoding_t encoding);
+
+/* Maximum messages outstanding before ur_rpc_publish_message_window
+ * refuses or waits; 0 for no limit */
+int ur_rpc_config_set_publish_window(ur_rpc_client_config_t* config, int window);
+
+/* Lets servers that support it answer this client's calls with a large
+ * result as a run of chunks, window at a time; 0 (the default) asks for
+ * whole responses. Calls send "chunk_window"; the chunks are joined and
+ * acked by the client and the call completes as for a whole response,
+ * within the same timeout. */
+int ur_rpc_config_set_chunk_window(ur_rpc_client_config_t* config, int window);
+
+/* Filter to subscribe for a json_added_subs topic: the topic itself, or
+ * its "$share/<group>/" form when a shared group is set. Caller frees. */
+char* ur_rpc_config_subscription_filter(const ur_rpc_client_config_t* config, const char* topic);
+
 int ur_rpc_config_load_from_file(ur_rpc_client_config_t* config, const char* filename);
 
 /* Topic list management */
@@ -317,10 +474,26 @@ int ur_rpc_topic_list_init(ur_rpc_topic_list_t* list);
 void ur_rpc_topic_list_cleanup(ur_rpc_topic_list_t* list);
 int ur_rpc_topic_list_add(ur_rpc_topic_list_t* list, const char* topic);
 
+/* Shared timer service. One thread runs every timer in the process and
+ * sleeps until the next is due; heartbeats and request timeouts use it.
+ * interval_ms 0 makes a one-shot timer. Callbacks run on the timer thread
+ * and should only do short, non-blocking work. ur_rpc_timer_cancel waits
+ * for a callback in progress unless it is called from a timer callback. */
+ur_rpc_timer_id_t ur_rpc_timer_schedule(uint64_t delay_ms, uint64_t interval_ms,
+                                        ur_rpc_timer_callback_t callback, void* user_data);
+int ur_rpc_timer_cancel(ur_rpc_timer_id_t id);
+/* Joins the timer thread once no timers remain; called by ur_rpc_cleanup */
+void ur_rpc_timer_shutdown(void);
+
 /* Heartbeat management */
 int ur_rpc_heartbeat_start(ur_rpc_client_t* client);
 int ur_rpc_heartbeat_stop(ur_rpc_client_t* client);
 int ur_rpc_config_set_heartbeat(ur_rpc_client_config_t* config, const char* topic, int interval_seconds, const char* payload);
+/* With echo the client subscribes to its own heartbeat topic and times every
+ * beat from publish to delivery back through the broker. A beat not back
+ * before the next one is counted as lost. */
+int ur_rpc_config_set_heartbeat_echo(ur_rpc_client_config_t* config, bool echo);
+int ur_rpc_config_set_notification_batching(ur_rpc_client_config_t* config, int max_messages, int max_delay_us);
 
 /* Topic configuration management */
 ur_rpc_topic_config_t* ur_rpc_topic_config_create(void);
@@ -341,6 +514,12 @@ ur_rpc_connection_status_t ur_rpc_client_get_status(const ur_rpc_client_t* clien
 /* Callback management */
 void ur_rpc_client_set_connection_callback(ur_rpc_client_t* client, ur_rpc_connection_callback_t callback, void* user_data);
 void ur_rpc_client_set_message_handler(ur_rpc_client_t* client, ur_rpc_message_handler_t handler, void* user_data);
+/* Called once the publish window has room again after a windowed publish
+ * was refused. Runs on the MQTT loop thread; must not block. */
+void ur_rpc_client_set_capacity_callback(ur_rpc_client_t* client, ur_rpc_capacity_callback_t callback, void* user_data);
+/* Called for every echoed heartbeat (see ur_rpc_config_set_heartbeat_echo).
+ * Runs on the MQTT loop thread; must not block. */
+void ur_rpc_client_set_heartbeat_rtt_callback(ur_rpc_client_t* client, ur_rpc_heartbeat_rtt_callback_t callback, void* user_data);
 
 /* Request/Response management */
 ur_rpc_request_t* ur_rpc_request_create(void);
@@ -349,15 +528,75 @@ int ur_rpc_request_set_method(ur_rpc_request_t* request, const char* method, con
 int ur_rpc_request_set_authority(ur_rpc_request_t* request, ur_rpc_authority_t authority);
 int ur_rpc_request_set_params(ur_rpc_request_t* request, const cJSON* params);
 int ur_rpc_request_set_timeout(ur_rpc_request_t* request, int timeout_ms);
+/* Copies transaction_id into the request's inline buffer; IDs of
+ * UR_RPC_MAX_TRANSACTION_ID_LENGTH chars or more are refused. Use this
+ * instead of assigning request->transaction_id, which is not heap owned. */
+int ur_rpc_request_set_transaction_id(ur_rpc_request_t* request, const char* transaction_id);
 
 ur_rpc_response_t* ur_rpc_response_create(void);
 void ur_rpc_response_destroy(ur_rpc_response_t* response);
 
-/* RPC operations */
+/* Arenas. Requests and responses created from an arena, and the strings the
+ * setters give them, are carved from its blocks and all released at once by
+ * ur_rpc_arena_reset or ur_rpc_arena_destroy (which also free params and
+ * result). Destroying such an object only frees its cJSON member. String
+ * fields assigned by hand must come from ur_rpc_arena_strdup or outlive the
+ * arena. An arena is not thread safe; keep one per worker thread.
+ * block_size 0 picks a default. */
+ur_rpc_arena_t* ur_rpc_arena_create(size_t block_size);
+void ur_rpc_arena_destroy(ur_rpc_arena_t* arena);
+void ur_rpc_arena_reset(ur_rpc_arena_t* arena);
+void* ur_rpc_arena_alloc(ur_rpc_arena_t* arena, size_t size);
+char* ur_rpc_arena_strdup(ur_rpc_arena_t* arena, const char* str);
+ur_rpc_request_t* ur_rpc_arena_request_create(ur_rpc_arena_t* arena);
+ur_rpc_response_t* ur_rpc_arena_response_create(ur_rpc_arena_t* arena);
+
+/* cJSON in an arena. While an arena is bound on a thread, every cJSON node,
+ * string and printed buffer made on that thread is carved from it, and
+ * cJSON_Delete of them does nothing: the next reset releases the whole
+ * tree at once. Other threads keep using the heap. Rules:
+ *   - Keep such a tree inside the arena's lifetime; do not cJSON_Delete
+ *     it, or print it into a buffer freed with free(), once unbound.
+ *   - Do not mix it with heap trees: moving items between the two leaves
+ *     one freeing memory of the other.
+ * ur_rpc_arena_bind_cjson returns the arena bound before, to restore;
+ * NULL unbinds. ur_rpc_arena_payload_parse parses a payload (JSON or
+ * CBOR) into arena, without changing the binding; an arena request whose
+ * params come from it, or response with such a result, gives them back
+ * on reset without walking them.
+ * ur_rpc_request_from_json/_from_payload, ur_rpc_response_from_json/
+ * _from_payload and response matching parse into a per-thread arena of
+ * their own and copy the result out, so they need nothing from callers. */
+ur_rpc_arena_t* ur_rpc_arena_bind_cjson(ur_rpc_arena_t* arena);
+cJSON* ur_rpc_arena_payload_parse(ur_rpc_arena_t* arena, const char* payload, size_t payload_len);
+
+/* RPC operations. Responses are matched to requests by transaction_id (on any
+ * subscribed topic); an async callback receives a UR_RPC_ERROR_TIMEOUT
+ * response when none arrives within request->timeout_ms. ur_rpc_call_sync
+ * blocks until the response or timeout_ms and hands back the response, which
+ * the caller destroys. */
 int ur_rpc_call_async(ur_rpc_client_t* client, const ur_rpc_request_t* request, ur_rpc_response_handler_t callback, void* user_data);
 int ur_rpc_call_sync(ur_rpc_client_t* client, const ur_rpc_request_t* request, ur_rpc_response_t** response, int timeout_ms);
+
+/* Sends requests for one service as a single publish: a JSON array of
+ * requests on the "<service>/batch" request topic. Each response (alone or
+ * in a response array) is matched by transaction_id and passed to callback,
+ * as with ur_rpc_call_async. */
+int ur_rpc_call_batch(ur_rpc_client_t* client, const ur_rpc_request_t* const* requests, int count, ur_rpc_response_handler_t callback, void* user_data);
 int ur_rpc_send_notification(ur_rpc_client_t* client, const char* method, const char* service, ur_rpc_authority_t authority, const cJSON* params);
+/* Publishes every coalesced notification now */
+int ur_rpc_flush_notifications(ur_rpc_client_t* client);
 int ur_rpc_publish_message(ur_rpc_client_t* client, const char* topic, const char* payload, size_t payload_len);
+int ur_rpc_publish_message_qos(ur_rpc_client_t* client, const char* topic, const char* payload, size_t payload_len, int qos);
+
+/* Publishes only while fewer than publish_window messages are outstanding
+ * (every publish counts, until it is written for QoS 0 or acknowledged for
+ * QoS 1 and 2). With a full window, timeout_ms 0 returns
+ * UR_RPC_ERROR_WOULD_BLOCK at once; otherwise the call waits up to
+ * timeout_ms (< 0 for no limit) and returns UR_RPC_ERROR_WOULD_BLOCK if
+ * the window is still full, or UR_RPC_ERROR_NOT_CONNECTED if the
+ * connection drops meanwhile. */
+int ur_rpc_publish_message_window(ur_rpc_client_t* client, const char* topic, const char* payload, size_t payload_len, int qos, int timeout_ms);
 int ur_rpc_subscribe_topic(ur_rpc_client_t* client, const char* topic);
 int ur_rpc_unsubscribe_topic(ur_rpc_client_t* client, const char* topic);
 
@@ -369,6 +608,9 @@ void ur_rpc_free_string(char* str);
 
 /* Transaction management */
 char* ur_rpc_generate_transaction_id(void);
+/* Allocation-free and safe from any thread; buffer_size must be at least
+ * UR_RPC_MAX_TRANSACTION_ID_LENGTH */
+int ur_rpc_format_transaction_id(char* buffer, size_t buffer_size);
 bool ur_rpc_validate_transaction_id(const char* transaction_id);
 
 /* JSON utilities */
@@ -377,6 +619,21 @@ ur_rpc_request_t* ur_rpc_request_from_json(const char* json_str);
 char* ur_rpc_response_to_json(const ur_rpc_response_t* response);
 ur_rpc_response_t* ur_rpc_response_from_json(const char* json_str);
 
+/* Encode compact JSON into a caller buffer without allocating. Returns
+ * UR_RPC_ERROR_MEMORY when buffer_size is too small; length excludes the
+ * terminator. */
+int ur_rpc_request_write_json(const ur_rpc_request_t* request, char* buffer, size_t buffer_size, size_t* length);
+int ur_rpc_response_write_json(const ur_rpc_response_t* response, char* buffer, size_t buffer_size, size_t* length);
+
+/* Payloads in either encoding. ur_rpc_payload_parse returns the payload as
+ * a cJSON tree (CBOR byte strings are not supported). A response encoded
+ * for client uses the client's payload_encoding; *length receives its size,
+ * as CBOR may contain NUL bytes. */
+cJSON* ur_rpc_payload_parse(const char* payload, size_t payload_len);
+ur_rpc_request_t* ur_rpc_request_from_payload(const char* payload, size_t payload_len);
+ur_rpc_response_t* ur_rpc_response_from_payload(const char* payload, size_t payload_len);
+char* ur_rpc_response_encode(const ur_rpc_client_t* client, const ur_rpc_response_t* response, size_t* length);
+
 /* Statistics and monitoring */
 typedef struct {
     uint64_t messages_sent;
@@ -388,6 +645,12 @@ typedef struct {
     uint64_t connection_count;
     uint64_t uptime_seconds;
     time_t last_activity;
+    uint64_t outstanding_messages; // Published, not yet written or acknowledged
+    uint64_t peak_outstanding;     // Highest outstanding_messages since reset
+    uint64_t publish_would_block;  // Windowed publishes refused for a full window
+    uint64_t heartbeats_sent;
+    uint64_t heartbeats_echoed;    // Beats back from the broker (heartbeat echo)
+    uint64_t heartbeat_rtt_us;     // Round trip of the last echoed beat
 } ur_rpc_statistics_t;
 
 int ur_rpc_client_get_statistics(const ur_rpc_client_t* client, ur_rpc_statistics_t* stats);
@@ -398,6 +661,10 @@ ur_rpc_relay_client_t* ur_rpc_relay_client_create(const ur_rpc_client_config_t*
 void ur_rpc_relay_client_destroy(ur_rpc_relay_client_t* relay_client);
 int ur_rpc_relay_client_start(ur_rpc_relay_client_t* relay_client);
 int ur_rpc_relay_client_stop(ur_rpc_relay_client_t* relay_client);
+/* Indices of the rules whose source filter matches topic, in configuration
+ * order, as the relay forwards a message; matches holds
+ * UR_RPC_MAX_RELAY_RULES. Returns the count. */
+int ur_rpc_relay_client_match(const ur_rpc_relay_client_t* relay_client, const char* topic, int* matches);
 int ur_rpc_relay_config_add_broker(ur_rpc_relay_config_t* config, const char* host, int port, const char* client_id, bool is_primary);
 int ur_rpc_relay_config_add_rule(ur_rpc_relay_config_t* config, const char* source_topic, const char* dest_topic, const char* prefix, int source_broker, int dest_broker, bool bidirectional);
 int ur_rpc_relay_config_set_prefix(ur_rpc_relay_config_t* config, const char* prefix);
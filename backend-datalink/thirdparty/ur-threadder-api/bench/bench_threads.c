@@ -0,0 +1,122 @@
+/**
+ * @file bench_threads.c
+ * @brief Microbenchmarks of the thread lifecycle and the in-loop checks
+ *
+ * Prints one JSON object per line, for a script to compare runs:
+ *   {"suite": "ur-threadder-api", "name": ..., "iterations": n,
+ *    "ns_per_op": x, "ops_per_sec": y}
+ * Usage: bench_threads [scale], scale multiplying the iteration counts
+ * (default 1).
+ */
+
+#include "../include/thread_manager.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void report(const char *name, unsigned long iterations, uint64_t elapsed_ns) {
+    double ns_per_op = iterations ? (double)elapsed_ns / (double)iterations : 0.0;
+    printf("{\"suite\": \"ur-threadder-api\", \"name\": \"%s\", \"iterations\": %lu, "
+           "\"ns_per_op\": %.1f, \"ops_per_sec\": %.1f}\n",
+           name, iterations, ns_per_op, ns_per_op > 0.0 ? 1e9 / ns_per_op : 0.0);
+    fflush(stdout);
+}
+
+static void *return_immediately(void *arg) {
+    return arg;
+}
+
+/* Created, started and joined, the slot released for the next round */
+static void bench_create_join(thread_manager_t *manager, unsigned long iterations) {
+    uint64_t start = now_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        unsigned int id = 0;
+        if (thread_create(manager, return_immediately, NULL, &id) < 0) {
+            fprintf(stderr, "thread_create failed after %lu threads\n", i);
+            return;
+        }
+        thread_join(manager, id, NULL);
+        thread_release(manager, id);
+    }
+    report("thread_create_join", iterations, now_ns() - start);
+}
+
+/* The loop of a managed thread timing the calls it makes every iteration */
+typedef struct {
+    thread_manager_t *manager;
+    unsigned int thread_id;     /* Written by the creator, read once it is set */
+    unsigned long iterations;
+    uint64_t pause_ns;
+    uint64_t should_exit_ns;
+    uint64_t heartbeat_ns;
+} loop_bench_t;
+
+static void *checking_loop(void *arg) {
+    loop_bench_t *bench = arg;
+    unsigned int id;
+    while ((id = __atomic_load_n(&bench->thread_id, __ATOMIC_ACQUIRE)) == 0) {
+    }
+
+    uint64_t start = now_ns();
+    for (unsigned long i = 0; i < bench->iterations; i++) {
+        thread_check_pause(bench->manager, id);
+    }
+    bench->pause_ns = now_ns() - start;
+
+    start = now_ns();
+    for (unsigned long i = 0; i < bench->iterations; i++) {
+        if (thread_should_exit(bench->manager, id)) {
+            break;
+        }
+    }
+    bench->should_exit_ns = now_ns() - start;
+
+    start = now_ns();
+    for (unsigned long i = 0; i < bench->iterations; i++) {
+        thread_heartbeat();
+    }
+    bench->heartbeat_ns = now_ns() - start;
+    return NULL;
+}
+
+static void bench_loop_checks(thread_manager_t *manager, unsigned long iterations) {
+    loop_bench_t bench = {manager, 0, iterations, 0, 0, 0};
+    unsigned int id = 0;
+    if (thread_create(manager, checking_loop, &bench, &id) < 0) {
+        fprintf(stderr, "thread_create failed\n");
+        return;
+    }
+    __atomic_store_n(&bench.thread_id, id, __ATOMIC_RELEASE);
+    thread_join(manager, id, NULL);
+    thread_release(manager, id);
+
+    report("thread_check_pause", iterations, bench.pause_ns);
+    report("thread_should_exit", iterations, bench.should_exit_ns);
+    report("thread_heartbeat", iterations, bench.heartbeat_ns);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long scale = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+    if (scale == 0) {
+        scale = 1;
+    }
+
+    thread_manager_t manager;
+    if (thread_manager_init(&manager, 16) != 0) {
+        fprintf(stderr, "thread_manager_init failed\n");
+        return 1;
+    }
+
+    bench_create_join(&manager, 2000 * scale);
+    bench_loop_checks(&manager, 10000000 * scale);
+
+    thread_manager_destroy(&manager);
+    return 0;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file TaskExecutor.hpp
+ * @brief Shared work-stealing executor for short tasks
+ *
+ * ThreadManager gives every job an OS thread of its own. Short jobs are
+ * better served by a fixed set of workers, one per hardware thread, that
+ * pass tasks around instead of creating threads.
+ */
+
+#ifndef TASK_EXECUTOR_HPP
+#define TASK_EXECUTOR_HPP
+
+#include "ThreadManager.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace ThreadMgr {
+
+/**
+ * @brief Work item queued on the executor
+ */
+struct ExecutorTask {
+    std::string name;
+    ThreadCallable fn;
+};
+
+/**
+ * @brief Chase-Lev work-stealing deque
+ *
+ * The owning worker pushes and pops at the bottom without locks; other
+ * workers steal from the top. Arrays replaced on growth are kept until the
+ * deque is destroyed, as a thief may still be reading one.
+ */
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(int64_t capacity = 256);
+    ~WorkStealingDeque();
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /** @brief Owner only */
+    void push(ExecutorTask* task);
+
+    /** @brief Owner only; nullptr when empty */
+    ExecutorTask* pop();
+
+    /** @brief Any thread; nullptr when empty or when another thief won */
+    ExecutorTask* steal();
+
+private:
+    struct Array {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<ExecutorTask*>[]> slots;
+
+        explicit Array(int64_t cap) : capacity(cap), slots(new std::atomic<ExecutorTask*>[cap]) {}
+        ExecutorTask* get(int64_t i) const { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(int64_t i, ExecutorTask* t) { slots[i & (capacity - 1)].store(t, std::memory_order_relaxed); }
+    };
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Array*> array_;
+    std::vector<std::unique_ptr<Array>> retired_;
+
+    Array* grow(Array* array, int64_t bottom, int64_t top);
+};
+
+/**
+ * @brief Executor counters and the names of the tasks running right now
+ */
+struct ExecutorStats {
+    size_t workers = 0;
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    uint64_t failed = 0;        // Posted tasks that threw
+    uint64_t stolen = 0;
+    size_t queued = 0;
+    std::vector<std::string> running;
+};
+
+/**
+ * @brief Fixed pool of workers, each with a work-stealing deque
+ *
+ * Tasks submitted from a worker go onto that worker's deque and are run
+ * newest first; tasks from other threads go through a shared injection
+ * queue. Idle workers steal before they sleep. The destructor runs every
+ * queued task before joining the workers.
+ */
+class TaskExecutor {
+public:
+    /**
+     * @brief Constructor
+     * @param workers Number of workers, 0 for one per hardware thread
+     */
+    explicit TaskExecutor(size_t workers = 0);
+    ~TaskExecutor();
+
+    TaskExecutor(const TaskExecutor&) = delete;
+    TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+    /**
+     * @brief Process-wide executor sized to the hardware threads
+     */
+    static TaskExecutor& instance();
+
+    /**
+     * @brief Queue a task and get its result through a future
+     * @param name Shown by stats() while the task runs
+     * @param func Callable; exceptions end up in the future
+     * @param args Arguments, copied into the task
+     */
+    template<typename Func, typename... Args>
+    auto submit(std::string name, Func&& func, Args&&... args)
+        -> std::future<std::invoke_result_t<std::decay_t<Func>, std::decay_t<Args>...>>;
+
+    /**
+     * @brief Queue a task without a future; exceptions are counted as failed
+     */
+    void post(std::string name, ThreadCallable fn);
+
+    size_t workerCount() const { return workers_.size(); }
+
+    ExecutorStats stats() const;
+
+private:
+    struct Worker {
+        WorkStealingDeque deque;
+        std::thread thread;
+        mutable std::mutex currentMutex;
+        std::string current;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex injectMutex_;
+    std::deque<ExecutorTask*> inject_;
+
+    // queued_ counts tasks in the deques and the injection queue; a worker
+    // only sleeps while it is zero
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> sleepers_{0};
+    std::mutex parkMutex_;
+    std::condition_variable parkCv_;
+    std::atomic<bool> stopping_{false};
+
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> stolen_{0};
+
+    void enqueue(ExecutorTask* task);
+    ExecutorTask* findTask(size_t index);
+    void workerLoop(size_t index);
+};
+
+} // namespace ThreadMgr
+
+// Template implementations
+#include "TaskExecutor.tpp"
+
+#endif // TASK_EXECUTOR_HPP
@@ -0,0 +1,28 @@
+/**
+ * @file TaskExecutor.tpp
+ * @brief Template implementations for TaskExecutor
+ */
+
+#ifndef TASK_EXECUTOR_TPP
+#define TASK_EXECUTOR_TPP
+
+namespace ThreadMgr {
+
+template<typename Func, typename... Args>
+auto TaskExecutor::submit(std::string name, Func&& func, Args&&... args)
+    -> std::future<std::invoke_result_t<std::decay_t<Func>, std::decay_t<Args>...>> {
+    using Result = std::invoke_result_t<std::decay_t<Func>, std::decay_t<Args>...>;
+
+    // The packaged task is move-only, which ThreadCallable takes as is
+    std::packaged_task<Result()> task(
+        [func = std::forward<Func>(func), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            return std::apply(func, std::move(args));
+        });
+    std::future<Result> future = task.get_future();
+    enqueue(new ExecutorTask{std::move(name), std::move(task)});
+    return future;
+}
+
+} // namespace ThreadMgr
+
+#endif // TASK_EXECUTOR_TPP
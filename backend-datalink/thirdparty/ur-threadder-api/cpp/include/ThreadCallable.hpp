@@ -0,0 +1,124 @@
+/**
+ * @file ThreadCallable.hpp
+ * @brief Move-only callable for thread and task bodies
+ *
+ * std::function insists on a copyable target and allocates for anything
+ * larger than a couple of pointers. A thread or task body is started once
+ * and never copied, so ThreadCallable only moves, and keeps a callable of
+ * up to kInlineSize bytes (a lambda capturing a few pointers, or a
+ * std::string and a pointer) inside itself. Larger callables, and ones
+ * whose move may throw, go to the heap.
+ */
+
+#ifndef THREAD_CALLABLE_HPP
+#define THREAD_CALLABLE_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ThreadMgr {
+
+class ThreadCallable {
+public:
+    static constexpr size_t kInlineSize = 6 * sizeof(void*);
+
+    ThreadCallable() noexcept = default;
+    ThreadCallable(std::nullptr_t) noexcept {}
+
+    template<typename F,
+             typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, ThreadCallable> &&
+                                         std::is_invocable_v<std::decay_t<F>&>>>
+    ThreadCallable(F&& func) {
+        using Target = std::decay_t<F>;
+        // An empty std::function or null function pointer stays empty
+        if constexpr (std::is_constructible_v<bool, const Target&>) {
+            if (!static_cast<bool>(func)) {
+                return;
+            }
+        }
+        if constexpr (storedInline<Target>()) {
+            ::new (static_cast<void*>(storage_)) Target(std::forward<F>(func));
+            ops_ = &kInlineOps<Target>;
+        } else {
+            *reinterpret_cast<Target**>(storage_) = new Target(std::forward<F>(func));
+            ops_ = &kHeapOps<Target>;
+        }
+    }
+
+    ThreadCallable(ThreadCallable&& other) noexcept { take(other); }
+
+    ThreadCallable& operator=(ThreadCallable&& other) noexcept {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    ThreadCallable(const ThreadCallable&) = delete;
+    ThreadCallable& operator=(const ThreadCallable&) = delete;
+
+    ~ThreadCallable() { reset(); }
+
+    /** @brief Calls the target; the callable must not be empty */
+    void operator()() { ops_->invoke(storage_); }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*relocate)(void* from, void* to) noexcept;    // Moves into to, destroys from
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template<typename T>
+    static constexpr bool storedInline() {
+        return sizeof(T) <= kInlineSize && alignof(T) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<T>;
+    }
+
+    template<typename T>
+    static T& inlineTarget(void* storage) { return *std::launder(reinterpret_cast<T*>(storage)); }
+
+    template<typename T>
+    static constexpr Ops kInlineOps = {
+        [](void* storage) { inlineTarget<T>(storage)(); },
+        [](void* from, void* to) noexcept {
+            ::new (to) T(std::move(inlineTarget<T>(from)));
+            inlineTarget<T>(from).~T();
+        },
+        [](void* storage) noexcept { inlineTarget<T>(storage).~T(); },
+    };
+
+    template<typename T>
+    static constexpr Ops kHeapOps = {
+        [](void* storage) { (**reinterpret_cast<T**>(storage))(); },
+        [](void* from, void* to) noexcept { *reinterpret_cast<T**>(to) = *reinterpret_cast<T**>(from); },
+        [](void* storage) noexcept { delete *reinterpret_cast<T**>(storage); },
+    };
+
+    void take(ThreadCallable& other) noexcept {
+        if (other.ops_) {
+            other.ops_->relocate(other.storage_, storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    void reset() noexcept {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+    const Ops* ops_ = nullptr;
+};
+
+} // namespace ThreadMgr
+
+#endif // THREAD_CALLABLE_HPP
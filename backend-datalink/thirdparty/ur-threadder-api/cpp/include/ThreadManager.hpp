@@ -22,9 +22,13 @@
 #include <stdexcept>
 #include <future>
 #include <chrono>
+#include <cstdint>
 #include <mutex>
+#include <tuple>
 #include <type_traits>
 
+#include "ThreadCallable.hpp"
+
 // Forward declarations for C library
 extern "C" {
     #include "thread_manager.h"
@@ -34,21 +38,15 @@ extern "C" {
 
 namespace ThreadMgr {
 
-// Forward declaration
+// Binds a function and its arguments into one callable; a result is discarded
 template<typename Func, typename... Args>
 struct ThreadFunctionWrapper {
-    std::function<void()> callable;
-
-    ThreadFunctionWrapper(Func&& func, Args&&... args) {
-        callable = [func = std::forward<Func>(func), args...]() mutable {
-            if constexpr (std::is_void_v<std::invoke_result_t<Func, Args...>>) {
-                std::invoke(func, args...);
-            } else {
-                auto result = std::invoke(func, args...);
-                // Store result somewhere if needed
-                (void)result; // Suppress unused variable warning
-            }
-        };
+    ThreadCallable callable;
+
+    ThreadFunctionWrapper(Func&& func, Args&&... args)
+        : callable([func = std::forward<Func>(func), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+              std::apply(func, args);
+          }) {
     }
 };
 
@@ -104,6 +102,27 @@ struct ThreadInfo {
     int exitStatus; // For process threads
 };
 
+/**
+ * @brief Registry snapshot from ThreadManager::getSnapshot, released with the last copy
+ */
+using ThreadSnapshot = std::shared_ptr<const thread_snapshot_t>;
+
+/**
+ * @brief Runtime statistics of a thread
+ */
+struct ThreadStats {
+    unsigned int id;
+    ThreadState state;
+    ThreadType type;
+    std::string name;
+    pid_t tid;                          // Kernel thread ID, 0 before the thread starts
+    std::chrono::nanoseconds cpuTime;
+    uint64_t voluntarySwitches;
+    uint64_t involuntarySwitches;
+    uint64_t iterations;                // Reported through heartbeat()
+    std::chrono::system_clock::time_point lastActivity;
+};
+
 /**
  * @brief Process I/O data structure
  */
@@ -142,11 +161,20 @@ public:
     ThreadManager& operator=(ThreadManager&& other) noexcept;
 
     /**
-     * @brief Create a thread using std::function
-     * @param func std::function to execute
+     * @brief Create a thread running a callable
+     * @param func Lambda, std::function or other callable; moved into the
+     * thread, which allocates once to start
+     * @return Thread ID
+     */
+    unsigned int createThread(ThreadCallable func);
+
+    /**
+     * @brief Create a thread with placement and scheduling attributes
+     * @param func Callable to execute
+     * @param attr Name, CPU affinity, policy and nice value, applied by the new thread
      * @return Thread ID
      */
-    unsigned int createThread(std::function<void()> func);
+    unsigned int createThreadWithAttributes(ThreadCallable func, const thread_attr_t& attr);
 
     /**
      * @brief Create and start a new thread
@@ -165,6 +193,27 @@ public:
      */
     unsigned int createProcess(const std::string& command, const std::vector<std::string>& args = {});
 
+    /**
+     * @brief Create a system process whose output is pushed to a handler
+     *
+     * The handler runs on the manager's shared I/O thread with each chunk of
+     * stdout (stream 1) or stderr (stream 2); data is nullptr at the end of a
+     * stream. It must not block and is kept until the manager is destroyed.
+     * @param command Command to execute
+     * @param args Arguments for the command
+     * @param onOutput Output handler
+     * @return Thread ID
+     */
+    unsigned int createProcess(const std::string& command, const std::vector<std::string>& args,
+                               std::function<void(int stream, const char* data, size_t size)> onOutput);
+
+    /**
+     * @brief Launch processes from a helper forked now, instead of from this process
+     *
+     * Call early, before other threads exist and before creating processes.
+     */
+    void startSpawnHelper();
+
     /**
      * @brief Stop a thread
      * @param threadId Thread ID
@@ -206,6 +255,18 @@ public:
      */
     ThreadInfo getThreadInfo(unsigned int threadId) const;
 
+    /**
+     * @brief Get CPU time, context switches and activity of a thread
+     * @param threadId Thread ID
+     * @return ThreadStats structure
+     */
+    ThreadStats getThreadStats(unsigned int threadId) const;
+
+    /**
+     * @brief Count one loop iteration of the calling managed thread
+     */
+    static void heartbeat() { thread_heartbeat(); }
+
     /**
      * @brief Check if thread is alive
      * @param threadId Thread ID
@@ -221,6 +282,12 @@ public:
      */
     bool joinThread(unsigned int threadId, std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
 
+    /**
+     * @brief Forget a finished thread so its slot can be reused
+     * @param threadId Thread ID
+     */
+    void releaseThread(unsigned int threadId);
+
     /**
      * @brief Get all active thread IDs
      * @return Vector of thread IDs
@@ -233,6 +300,12 @@ public:
      */
     unsigned int getThreadCount() const;
 
+    /**
+     * @brief Get a consistent copy of all threads and attachments without waiting for the manager lock
+     * @return Snapshot, possibly a little behind a busy manager; see thread_snapshot_acquire
+     */
+    ThreadSnapshot getSnapshot() const;
+
     /**
      * @brief Write data to process stdin
      * @param threadId Thread ID
@@ -280,6 +353,13 @@ public:
      */
     unsigned int createThreadFromJson(const std::string& jsonConfig);
 
+    /**
+     * @brief Parse thread attributes from a JSON object
+     * @param jsonConfig Object with the optional "name", "cpus", "policy", "priority" and "nice" keys
+     * @return Attributes for createThreadWithAttributes
+     */
+    static thread_attr_t threadAttributesFromJson(const std::string& jsonConfig);
+
     /**
      * @brief Create process from JSON configuration
      * @param jsonConfig JSON configuration string
@@ -366,6 +446,7 @@ private:
 
     // Helper methods
     void checkThreadExists(unsigned int threadId) const;
+    unsigned int createThreadWithAttributes(ThreadCallable func, const thread_attr_t* attr);
     void handleCError(int result, const std::string& operation) const;
 };
 
@@ -14,8 +14,7 @@ unsigned int ThreadManager::createThread(Func&& func, Args&&... args) {
     auto wrapper = ThreadFunctionWrapper<Func, Args...>(
         std::forward<Func>(func), std::forward<Args>(args)...);
     
-    // Convert to std::function and delegate to the existing method
-    return createThread(wrapper.callable);
+    return createThreadWithAttributes(std::move(wrapper.callable), nullptr);
 }
 
 template<typename Func, typename... Args>
@@ -31,7 +30,7 @@ void ThreadManager::restartThreadByAttachment(const std::string& attachmentArg,
     stopThread(threadId);
     
     // Create new thread with same attachment
-    unsigned int newThreadId = createThread(wrapper.callable);
+    unsigned int newThreadId = createThreadWithAttributes(std::move(wrapper.callable), nullptr);
     
     // Unregister old and register new
     unregisterThread(attachmentArg);
@@ -0,0 +1,236 @@
+/**
+ * @file TaskExecutor.cpp
+ * @brief Implementation of the work-stealing executor
+ */
+
+#include "TaskExecutor.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace ThreadMgr {
+
+namespace {
+
+// Executor and worker index of the calling thread, when it is a worker
+thread_local TaskExecutor* currentExecutor = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+// WorkStealingDeque
+
+WorkStealingDeque::WorkStealingDeque(int64_t capacity) {
+    int64_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    array_.store(new Array(size), std::memory_order_relaxed);
+}
+
+WorkStealingDeque::~WorkStealingDeque() {
+    delete array_.load(std::memory_order_relaxed);
+}
+
+WorkStealingDeque::Array* WorkStealingDeque::grow(Array* array, int64_t bottom, int64_t top) {
+    Array* bigger = new Array(array->capacity * 2);
+    for (int64_t i = top; i < bottom; ++i) {
+        bigger->put(i, array->get(i));
+    }
+    retired_.emplace_back(array);
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+}
+
+void WorkStealingDeque::push(ExecutorTask* task) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    Array* a = array_.load(std::memory_order_relaxed);
+    if (b - t > a->capacity - 1) {
+        a = grow(a, b, t);
+    }
+    a->put(b, task);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+}
+
+ExecutorTask* WorkStealingDeque::pop() {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* a = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    ExecutorTask* task = a->get(b);
+    if (t == b) {
+        // Last element: race the thieves for it
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            task = nullptr;
+        }
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+ExecutorTask* WorkStealingDeque::steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+        return nullptr;
+    }
+    Array* a = array_.load(std::memory_order_acquire);
+    ExecutorTask* task = a->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return task;
+}
+
+// TaskExecutor
+
+TaskExecutor::TaskExecutor(size_t workers) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        workers_[i]->thread = std::thread(&TaskExecutor::workerLoop, this, i);
+    }
+}
+
+TaskExecutor::~TaskExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        stopping_.store(true);
+    }
+    parkCv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+TaskExecutor& TaskExecutor::instance() {
+    static TaskExecutor executor;
+    return executor;
+}
+
+void TaskExecutor::post(std::string name, ThreadCallable fn) {
+    enqueue(new ExecutorTask{std::move(name), std::move(fn)});
+}
+
+void TaskExecutor::enqueue(ExecutorTask* task) {
+    if (currentExecutor == this) {
+        // Spawned by a task: keep it local, where the cache is warm
+        workers_[currentWorker]->deque.push(task);
+    } else {
+        if (stopping_.load()) {
+            delete task;
+            throw ThreadManagerException("TaskExecutor is shutting down");
+        }
+        std::lock_guard<std::mutex> lock(injectMutex_);
+        inject_.push_back(task);
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+
+    // Paired with the check in workerLoop: either the sleeper sees queued_
+    // or we see the sleeper
+    queued_.fetch_add(1);
+    if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        parkCv_.notify_one();
+    }
+}
+
+ExecutorTask* TaskExecutor::findTask(size_t index) {
+    if (ExecutorTask* task = workers_[index]->deque.pop()) {
+        return task;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(injectMutex_);
+        if (!inject_.empty()) {
+            ExecutorTask* task = inject_.front();
+            inject_.pop_front();
+            return task;
+        }
+    }
+
+    // Steal, starting after ourselves so victims are spread out
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        size_t victim = (index + i) % workers_.size();
+        if (ExecutorTask* task = workers_[victim]->deque.steal()) {
+            stolen_.fetch_add(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void TaskExecutor::workerLoop(size_t index) {
+    currentExecutor = this;
+    currentWorker = index;
+    Worker& worker = *workers_[index];
+
+    for (;;) {
+        ExecutorTask* task = findTask(index);
+        if (!task) {
+            std::unique_lock<std::mutex> lock(parkMutex_);
+            if (queued_.load() > 0) {
+                // Something is queued that we lost a race for; look again
+                continue;
+            }
+            if (stopping_.load()) {
+                return;
+            }
+            sleepers_.fetch_add(1);
+            parkCv_.wait(lock, [this]() { return queued_.load() > 0 || stopping_.load(); });
+            sleepers_.fetch_sub(1);
+            continue;
+        }
+        queued_.fetch_sub(1);
+
+        {
+            std::lock_guard<std::mutex> lock(worker.currentMutex);
+            worker.current = task->name;
+        }
+        try {
+            task->fn();
+        } catch (...) {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock(worker.currentMutex);
+            worker.current.clear();
+        }
+        delete task;
+        completed_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+ExecutorStats TaskExecutor::stats() const {
+    ExecutorStats stats;
+    stats.workers = workers_.size();
+    stats.submitted = submitted_.load(std::memory_order_relaxed);
+    stats.completed = completed_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    stats.stolen = stolen_.load(std::memory_order_relaxed);
+    stats.queued = queued_.load(std::memory_order_relaxed);
+    for (const auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->currentMutex);
+        if (!worker->current.empty()) {
+            stats.running.push_back(worker->current);
+        }
+    }
+    return stats;
+}
+
+} // namespace ThreadMgr
@@ -12,6 +12,7 @@
  #include <any> // Required for std::any
  #include <functional> // Required for std::function and std::bind
  #include <atomic> // Required for std::atomic
+ #include <limits>
  
  namespace ThreadMgr {
  
@@ -56,57 +57,42 @@
      return *this;
  }
  
- unsigned int ThreadManager::createThread(std::function<void()> func) {
+ unsigned int ThreadManager::createThread(ThreadCallable func) {
+     return createThreadWithAttributes(std::move(func), nullptr);
+ }
+ 
+ unsigned int ThreadManager::createThreadWithAttributes(ThreadCallable func, const thread_attr_t& attr) {
+     return createThreadWithAttributes(std::move(func), &attr);
+ }
+ 
+ unsigned int ThreadManager::createThreadWithAttributes(ThreadCallable func, const thread_attr_t* attr) {
      // CRITICAL: Use pImpl.get() directly each time instead of caching to avoid stale pointers
      // This follows the same defensive pattern as RpcClient which validates state before each operation
-     
-     // First validation - check pImpl exists
      if (!pImpl) {
          throw ThreadManagerException("ThreadManager is being destroyed or has been destroyed");
      }
-     
-     // Get fresh pointer each time - don't cache it
-     Impl* impl = pImpl.get();
-     if (!impl) {
-         throw ThreadManagerException("ThreadManager implementation is invalid");
+     if (!func) {
+         throw ThreadManagerException("Cannot create thread: empty thread function");
      }
      
-     // Note: We don't check isDestroying here because:
-     // 1. With shared_ptr, the object stays alive as long as referenced
-     // 2. The pImpl null check is sufficient to detect actual destruction
-     // 3. isDestroying is only set during explicit shutdown, not automatic destruction
-     
      INFO_LOG("ThreadManager::createThread - Starting thread creation");
-     
-     auto wrapper = std::make_shared<std::function<void()>>(std::move(func));
  
-     // Re-get impl pointer before locking (defensive programming)
-     impl = pImpl.get();
-     if (!impl) {
-         throw ThreadManagerException("ThreadManager implementation became invalid");
-     }
-     
-     // Store the wrapper to keep it alive
-     std::lock_guard<std::mutex> lock(impl->wrappersMutex);
-     
-     // Re-validate after acquiring lock - get fresh pointer
-     impl = pImpl.get();
-     if (!impl) {
-         ERROR_LOG("ThreadManager::createThread - ThreadManager is being destroyed");
-         throw ThreadManagerException("Cannot create thread: ThreadManager is being destroyed");
-     }
-     
-     auto wrapperId = impl->nextWrapperId++;
-     impl->functionWrappers[wrapperId] = wrapper;
-     
-     INFO_LOG("ThreadManager::createThread - Stored function wrapper with ID %u", wrapperId);
+     // The whole launch context is this one allocation: the callable, with
+     // its captures inline unless they are large. The new thread owns it
+     // and frees it when the function returns.
+     auto* body = new ThreadCallable(std::move(func));
  
      // Create C-style thread function
      auto cFunc = [](void* arg) -> void* {
-         auto* wrapperInfo = static_cast<std::pair<std::shared_ptr<std::function<void()>>, ThreadManager::Impl*>*>(arg);
+         auto* body = static_cast<ThreadCallable*>(arg);
+         if (!body) {
+             // Restarted from a JSON command, which has no C++ function to give
+             ERROR_LOG("Thread function missing");
+             return nullptr;
+         }
          try {
              INFO_LOG("Thread function starting execution");
-             (*wrapperInfo->first)();
+             (*body)();
              INFO_LOG("Thread function completed execution");
          } catch (const std::exception& e) {
              ERROR_LOG("Thread function threw exception: %s", e.what());
@@ -114,51 +100,26 @@
              ERROR_LOG("Thread function threw unknown exception");
          }
  
-         delete wrapperInfo;
+         delete body;
          return nullptr;
      };
  
-     // Re-get impl pointer before creating arg pair
-     impl = pImpl.get();
-     if (!impl) {
-         throw ThreadManagerException("ThreadManager implementation became invalid");
-     }
-     
-     // Create argument pair
-     auto* argPair = new std::pair<std::shared_ptr<std::function<void()>>, ThreadManager::Impl*>(wrapper, impl);
- 
      unsigned int threadId;
      INFO_LOG("ThreadManager::createThread - Calling thread_create");
      
      // Final check before calling thread_create - get fresh pointer
-     impl = pImpl.get();
+     Impl* impl = pImpl.get();
      if (!impl) {
          ERROR_LOG("ThreadManager::createThread - ThreadManager is being destroyed (before thread_create)");
-         delete argPair;
-         // Try to clean up wrapper if impl is still valid
-         impl = pImpl.get();
-         if (impl) {
-             std::lock_guard<std::mutex> lock2(impl->wrappersMutex);
-             impl->functionWrappers.erase(wrapperId);
-         }
+         delete body;
          throw ThreadManagerException("Cannot create thread: ThreadManager is being destroyed");
      }
      
-     // Final validation - ensure manager structure is valid before calling thread_create
-     impl = pImpl.get();
-     if (!impl) {
-         ERROR_LOG("ThreadManager::createThread - ThreadManager became invalid before thread_create");
-         delete argPair;
-         throw ThreadManagerException("ThreadManager became invalid");
-     }
-     
      // Validate manager structure is initialized (check that threads array exists)
      // This ensures the mutex is valid
      if (!impl->manager.threads) {
          ERROR_LOG("ThreadManager::createThread - Manager structure is not initialized");
-         delete argPair;
-         std::lock_guard<std::mutex> lock2(impl->wrappersMutex);
-         impl->functionWrappers.erase(wrapperId);
+         delete body;
          throw ThreadManagerException("ThreadManager structure is not initialized");
      }
      
@@ -167,9 +128,7 @@
      int mutex_test = pthread_mutex_trylock(&impl->manager.mutex);
      if (mutex_test == EINVAL) {
          ERROR_LOG("ThreadManager::createThread - Manager mutex is invalid (EINVAL)");
-         delete argPair;
-         std::lock_guard<std::mutex> lock2(impl->wrappersMutex);
-         impl->functionWrappers.erase(wrapperId);
+         delete body;
          throw ThreadManagerException("ThreadManager mutex is invalid - manager may be destroyed");
      } else if (mutex_test == 0) {
          // Successfully locked, unlock it immediately
@@ -179,25 +138,16 @@
          // Just proceed to thread_create which will wait for the lock
      } else {
          ERROR_LOG("ThreadManager::createThread - Unexpected mutex_test result: %d", mutex_test);
-         delete argPair;
-         std::lock_guard<std::mutex> lock2(impl->wrappersMutex);
-         impl->functionWrappers.erase(wrapperId);
+         delete body;
          throw ThreadManagerException("ThreadManager mutex test failed with code: " + std::to_string(mutex_test));
      }
      
-     // Use fresh impl pointer to access manager
-     int result = thread_create(&impl->manager, cFunc, argPair, &threadId);
+     int result = thread_create_with_attr(&impl->manager, cFunc, body, attr, &threadId);
      INFO_LOG("ThreadManager::createThread - thread_create returned result=%d, threadId=%u", result, result >= 0 ? threadId : 0);
  
      if (result < 0) {
          ERROR_LOG("ThreadManager::createThread - Failed to create thread with error code %d", result);
-         delete argPair;
-         // Re-validate impl before accessing - get fresh pointer
-         impl = pImpl.get();
-         if (impl) {
-             std::lock_guard<std::mutex> lock2(impl->wrappersMutex);
-             impl->functionWrappers.erase(wrapperId);
-         }
+         delete body;
          handleCError(result, "createThread");
      }
      
@@ -206,6 +156,13 @@
      return threadId;
  }
  
+ void ThreadManager::startSpawnHelper() {
+     int result = thread_manager_start_spawn_helper(&pImpl->manager);
+     if (result < 0) {
+         handleCError(result, "startSpawnHelper");
+     }
+ }
+ 
  unsigned int ThreadManager::createProcess(const std::string& command, const std::vector<std::string>& args) {
      if (command.empty()) {
          throw ThreadManagerException("Command cannot be empty");
@@ -230,6 +187,52 @@
  
      return threadId;
  }
+
+ unsigned int ThreadManager::createProcess(const std::string& command, const std::vector<std::string>& args,
+                                           std::function<void(int stream, const char* data, size_t size)> onOutput) {
+     if (command.empty()) {
+         throw ThreadManagerException("Command cannot be empty");
+     }
+     if (!onOutput) {
+         return createProcess(command, args);
+     }
+ 
+     std::vector<char*> cArgs;
+     cArgs.push_back(const_cast<char*>(command.c_str()));
+     std::vector<std::string> argsCopy = args;
+     for (auto& arg : argsCopy) {
+         cArgs.push_back(const_cast<char*>(arg.c_str()));
+     }
+     cArgs.push_back(nullptr);
+ 
+     // Kept with the other wrappers: a restart reuses it, so it lives as long as the manager
+     using OutputHandler = std::function<void(int, const char*, size_t)>;
+     auto handler = std::make_shared<OutputHandler>(std::move(onOutput));
+     {
+         std::lock_guard<std::mutex> lock(pImpl->wrappersMutex);
+         pImpl->functionWrappers[pImpl->nextWrapperId++] = handler;
+     }
+ 
+     auto cCallback = [](unsigned int, int stream, const char* data, size_t size, void* userData) {
+         try {
+             (*static_cast<OutputHandler*>(userData))(stream, data, size);
+         } catch (const std::exception& e) {
+             ERROR_LOG("Process output handler threw exception: %s", e.what());
+         } catch (...) {
+             ERROR_LOG("Process output handler threw unknown exception");
+         }
+     };
+ 
+     unsigned int threadId;
+     int result = thread_create_process_with_output(&pImpl->manager, command.c_str(), cArgs.data(),
+                                                    cCallback, handler.get(), &threadId);
+ 
+     if (result < 0) {
+         handleCError(result, "createProcess");
+     }
+ 
+     return threadId;
+ }
  
  void ThreadManager::stopThread(unsigned int threadId) {
      checkThreadExists(threadId);
@@ -298,6 +301,27 @@
      return threadInfo;
  }
  
+ ThreadStats ThreadManager::getThreadStats(unsigned int threadId) const {
+     thread_stats_t stats;
+     int result = thread_get_stats(&pImpl->manager, threadId, &stats);
+     if (result < 0) {
+         handleCError(result, "getThreadStats");
+     }
+ 
+     ThreadStats threadStats;
+     threadStats.id = stats.id;
+     threadStats.state = static_cast<ThreadState>(stats.state);
+     threadStats.type = static_cast<ThreadType>(stats.type);
+     threadStats.name = stats.name;
+     threadStats.tid = stats.tid;
+     threadStats.cpuTime = std::chrono::nanoseconds(stats.cpu_time_ns);
+     threadStats.voluntarySwitches = stats.voluntary_switches;
+     threadStats.involuntarySwitches = stats.involuntary_switches;
+     threadStats.iterations = stats.iterations;
+     threadStats.lastActivity = std::chrono::system_clock::time_point(std::chrono::milliseconds(stats.last_activity_ms));
+     return threadStats;
+ }
+ 
  bool ThreadManager::isThreadAlive(unsigned int threadId) const {
      return thread_is_alive(&pImpl->manager, threadId);
  }
@@ -314,18 +338,23 @@
          }
          return true;
      } else {
-         // Poll with timeout
-         auto start = std::chrono::steady_clock::now();
-         while (std::chrono::steady_clock::now() - start < timeout) {
-             if (!isThreadAlive(threadId)) {
-                 // Thread has finished - join it
-                 void* result;
-                 thread_join(&pImpl->manager, threadId, &result);
-                 return true;
-             }
-             std::this_thread::sleep_for(std::chrono::milliseconds(10));
+         // Sleep until the thread finishes or the timeout passes
+         auto timeoutMs = std::min<std::chrono::milliseconds::rep>(
+             timeout.count(), std::numeric_limits<unsigned int>::max());
+         void* result;
+         int ret = thread_join_timeout(&pImpl->manager, threadId, static_cast<unsigned int>(timeoutMs), &result);
+         if (ret < 0) {
+             handleCError(ret, "joinThread");
          }
-         return false; // Timeout
+         return ret == 0;
+     }
+ }
+ 
+ void ThreadManager::releaseThread(unsigned int threadId) {
+     checkThreadExists(threadId);
+     int result = thread_release(&pImpl->manager, threadId);
+     if (result < 0) {
+         handleCError(result, "releaseThread");
      }
  }
  
@@ -349,6 +378,14 @@
  unsigned int ThreadManager::getThreadCount() const {
      return thread_get_count(&pImpl->manager);
  }
+
+ ThreadSnapshot ThreadManager::getSnapshot() const {
+     const thread_snapshot_t* snapshot = thread_snapshot_acquire(&pImpl->manager);
+     if (!snapshot) {
+         handleCError(-1, "getSnapshot");
+     }
+     return ThreadSnapshot(snapshot, thread_snapshot_release);
+ }
  
  void ThreadManager::writeToProcess(unsigned int threadId, const std::vector<uint8_t>& data) {
      checkThreadExists(threadId);
@@ -440,6 +477,14 @@
      return threadId;
  }
  
+ thread_attr_t ThreadManager::threadAttributesFromJson(const std::string& jsonConfig) {
+     thread_attr_t attr;
+     if (thread_attr_from_json(jsonConfig.c_str(), &attr) != 0) {
+         throw ThreadManagerException("Invalid thread attributes: " + jsonConfig);
+     }
+     return attr;
+ }
+ 
  unsigned int ThreadManager::createProcessFromJson(const std::string& jsonConfig) {
      if (jsonConfig.empty()) {
          throw ThreadManagerException("JSON config cannot be empty");
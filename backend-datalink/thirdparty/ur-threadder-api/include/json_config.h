@@ -37,6 +37,18 @@ int thread_manager_save_config(const thread_manager_t *manager, const char *file
  */
 int thread_create_from_json(thread_manager_t *manager, const char *json_config, unsigned int *thread_id);
 
+/**
+ * @brief Parse thread attributes from a JSON object
+ * 
+ * Reads the optional "name", "cpus", "policy", "priority" and "nice" keys
+ * accepted by thread_create_from_json.
+ * 
+ * @param json_config The JSON object string
+ * @param attr Attributes to fill
+ * @return int 0 on success, -1 on failure
+ */
+int thread_attr_from_json(const char *json_config, thread_attr_t *attr);
+
 /**
  * @brief Create a process from a JSON configuration
  * 
@@ -35,6 +35,48 @@ typedef enum {
     THREAD_TYPE_PROCESS  /**< Thread executing a system binary */
 } thread_type_t;
 
+/**
+ * @brief Scheduling policies a thread can be started with
+ */
+typedef enum {
+    THREAD_SCHED_DEFAULT,  /**< Keep the policy inherited from the creator */
+    THREAD_SCHED_OTHER,    /**< Time sharing (SCHED_OTHER), weighted by nice */
+    THREAD_SCHED_BATCH,    /**< CPU-bound background work (SCHED_BATCH) */
+    THREAD_SCHED_IDLE,     /**< Runs only when the CPU is otherwise idle (SCHED_IDLE) */
+    THREAD_SCHED_FIFO,     /**< Real-time, first in first out (SCHED_FIFO) */
+    THREAD_SCHED_RR        /**< Real-time, round robin (SCHED_RR) */
+} thread_sched_policy_t;
+
+/** Longest thread name the kernel keeps, including the terminator */
+#define THREAD_NAME_MAX 16
+
+/**
+ * @brief Placement and scheduling of a thread
+ * 
+ * A zeroed structure, or one set up by thread_attr_init, changes nothing.
+ */
+typedef struct {
+    char name[THREAD_NAME_MAX];      /**< Thread name shown by top and ps, empty to inherit */
+    unsigned long long cpu_mask;     /**< CPUs the thread may run on (bit n is CPU n), 0 for all */
+    thread_sched_policy_t policy;    /**< Scheduling policy */
+    int priority;                    /**< Real-time priority for FIFO and RR, 1 to 99 */
+    int nice;                        /**< Nice value for OTHER, BATCH and DEFAULT, -20 to 19 */
+} thread_attr_t;
+
+/**
+ * @brief Receives output of a process created with thread_create_process_with_output
+ * 
+ * Called on the manager's I/O thread with each chunk as it is read. A call
+ * with data NULL and size 0 marks the end of that stream.
+ * 
+ * @param thread_id Thread ID of the process
+ * @param stream 1 for stdout, 2 for stderr
+ * @param data Output bytes, not NUL-terminated
+ * @param size Number of bytes
+ * @param user_data Pointer given when the process was created
+ */
+typedef void (*thread_output_cb_t)(unsigned int thread_id, int stream, const char *data, size_t size, void *user_data);
+
 /**
  * @brief Thread information structure
  */
@@ -47,7 +89,7 @@ typedef struct {
     thread_state_t state;       /**< Thread state */
     unsigned int id;            /**< Unique identifier for the thread */
     bool should_exit;           /**< Flag to indicate if thread should exit */
-    bool is_paused;             /**< Flag to indicate if thread is paused */
+    bool is_paused;             /**< Flag to indicate if thread is paused, accessed atomically */
     thread_type_t type;         /**< Thread type (normal or process) */
     pid_t process_id;           /**< Process ID for binary execution */
     char *command;              /**< Command to execute for binary threads */
@@ -56,8 +98,39 @@ typedef struct {
     int stdout_pipe[2];         /**< Pipe for stdout of the process */
     int stderr_pipe[2];         /**< Pipe for stderr of the process */
     int stdin_pipe[2];          /**< Pipe for stdin of the process */
+    bool joined;                /**< Set once pthread_join has reaped the thread */
+    const void *owner;          /**< Thread manager the thread belongs to */
+    int wake_fd;                /**< eventfd that wakes the process monitor */
+    int status_fd;              /**< Exit status pipe from the spawn helper, -1 for our own children */
+    thread_attr_t attr;         /**< Placement and scheduling applied at start */
+    pid_t tid;                  /**< Kernel thread ID once started, 0 before */
+    unsigned long long iterations;        /**< Loop iterations reported by thread_heartbeat */
+    unsigned long long last_activity_ms;  /**< Wall clock (ms) of the start or the last heartbeat */
+    unsigned long long cpu_time_ns;       /**< CPU time, captured when the thread finishes */
+    unsigned long long voluntary_switches;   /**< Captured when the thread finishes */
+    unsigned long long involuntary_switches; /**< Captured when the thread finishes */
+    thread_output_cb_t output_cb;         /**< Receives process output, NULL to read it with thread_read_from_process */
+    void *output_user_data;               /**< Passed to output_cb */
+    unsigned int pause_waiters; /**< Other threads inside thread_check_pause on this one, under mutex */
+    bool released;              /**< Dropped by the manager while waited on; the last waiter frees it */
 } thread_info_t;
 
+/**
+ * @brief Runtime statistics of a managed thread
+ */
+typedef struct {
+    unsigned int id;                      /**< Thread ID */
+    thread_state_t state;                 /**< Thread state */
+    thread_type_t type;                   /**< Thread type */
+    char name[THREAD_NAME_MAX];           /**< Name from the thread attributes */
+    pid_t tid;                            /**< Kernel thread ID, 0 before the thread starts */
+    unsigned long long cpu_time_ns;       /**< CPU time used (CLOCK_THREAD_CPUTIME_ID) */
+    unsigned long long voluntary_switches;   /**< Times the thread blocked */
+    unsigned long long involuntary_switches; /**< Times the thread was preempted */
+    unsigned long long iterations;        /**< Loop iterations reported by thread_heartbeat */
+    unsigned long long last_activity_ms;  /**< Wall clock (ms since the epoch) of the start or the last heartbeat */
+} thread_stats_t;
+
 /**
  * @brief Thread registration structure for tracking threads by attachment ID
  */
@@ -66,6 +139,47 @@ typedef struct {
     unsigned int thread_id;     /**< Associated thread ID */
 } thread_registration_t;
 
+/**
+ * @brief Bucket of the thread ID index (id 0 marks an empty bucket)
+ */
+typedef struct {
+    unsigned int id;            /**< Thread ID */
+    unsigned int slot;          /**< Position of the thread in the threads array */
+} thread_index_entry_t;
+
+/**
+ * @brief Bucket of the attachment index (slot 0 marks an empty bucket)
+ */
+typedef struct {
+    unsigned int hash;          /**< Hash of the attachment identifier */
+    unsigned int slot;          /**< Position of the registration plus one */
+} thread_attachment_index_entry_t;
+
+/**
+ * @brief One thread as it was when a registry snapshot was taken
+ */
+typedef struct {
+    unsigned int id;                 /**< Thread ID */
+    thread_state_t state;            /**< Thread state */
+    thread_type_t type;              /**< Thread type */
+    char name[THREAD_NAME_MAX];      /**< Name from the thread attributes */
+    pid_t tid;                       /**< Kernel thread ID, 0 before the thread starts */
+    pid_t process_id;                /**< Process ID of a process thread, 0 otherwise */
+} thread_snapshot_entry_t;
+
+/**
+ * @brief Immutable copy of the thread registry, see thread_snapshot_acquire
+ */
+typedef struct thread_snapshot {
+    unsigned long long version;      /**< Grows by one with every copy taken */
+    unsigned int count;              /**< Number of entries */
+    const thread_snapshot_entry_t *entries;          /**< Threads, in slot order */
+    unsigned int registration_count; /**< Number of registrations */
+    const thread_registration_t *registrations;      /**< Attachment identifiers and their threads */
+    unsigned int refs;               /**< Holders: the manager while current, and each reader */
+    struct thread_snapshot *next_retired;            /**< Replaced snapshots awaiting release */
+} thread_snapshot_t;
+
 /**
  * @brief Thread manager structure
  */
@@ -73,11 +187,25 @@ typedef struct {
     thread_info_t **threads;    /**< Array of thread information structures */
     unsigned int thread_count;  /**< Number of threads */
     unsigned int capacity;      /**< Capacity of the threads array */
+    thread_index_entry_t *index; /**< Open-addressed map from thread ID to slot */
+    unsigned int index_size;    /**< Buckets in the index, a power of two */
+    unsigned int *free_slots;   /**< Stack of unused slots in the threads array */
+    unsigned int free_count;    /**< Number of entries in free_slots */
     pthread_mutex_t mutex;      /**< Mutex for thread manager synchronization */
     unsigned int next_id;       /**< Next thread ID */
     thread_registration_t **registrations; /**< Array of thread registrations */
     unsigned int registration_count;        /**< Number of registrations */
     unsigned int registration_capacity;     /**< Capacity of registrations array */
+    thread_attachment_index_entry_t *attachment_index; /**< Open-addressed map from attachment identifier to slot */
+    unsigned int attachment_index_size;     /**< Buckets in the attachment index, a power of two */
+    unsigned int *free_registration_slots;  /**< Stack of unused slots in the registrations array */
+    unsigned int free_registration_count;   /**< Number of entries in free_registration_slots */
+    struct spawn_helper *spawn_helper;      /**< Helper launching processes, NULL to spawn directly */
+    struct process_io *process_io;          /**< I/O thread for output callbacks, started on first use */
+    thread_snapshot_t *snapshot;            /**< Latest registry snapshot, swapped atomically */
+    thread_snapshot_t *retired_snapshots;   /**< Replaced snapshots a reader may still be picking up */
+    unsigned int snapshot_readers;          /**< Readers between loading snapshot and referencing it */
+    bool snapshot_stale;                    /**< Registry changed since snapshot was taken */
 } thread_manager_t;
 
 /**
@@ -97,6 +225,20 @@ int thread_manager_init(thread_manager_t *manager, unsigned int initial_capacity
  */
 int thread_manager_destroy(thread_manager_t *manager);
 
+/**
+ * @brief Launch processes from a long-lived helper process
+ * 
+ * thread_create_process normally starts commands with posix_spawn from
+ * this process. With the helper they are started by a small process forked
+ * here once, which keeps launching cheap however large this process grows.
+ * Call it early, before other threads exist and before creating processes;
+ * the helper exits in thread_manager_destroy.
+ * 
+ * @param manager Pointer to thread manager structure
+ * @return int 0 on success, -1 on failure
+ */
+int thread_manager_start_spawn_helper(thread_manager_t *manager);
+
 /**
  * @brief Create and start a new thread
  * 
@@ -108,6 +250,40 @@ int thread_manager_destroy(thread_manager_t *manager);
  */
 int thread_create(thread_manager_t *manager, void *(*func)(void *), void *arg, unsigned int *thread_id);
 
+/**
+ * @brief Reset thread attributes to "inherit everything"
+ * 
+ * @param attr Attributes to initialize
+ */
+void thread_attr_init(thread_attr_t *attr);
+
+/**
+ * @brief Apply thread attributes to the calling thread
+ * 
+ * Every attribute is attempted even when an earlier one fails; real-time
+ * policies and negative nice values need CAP_SYS_NICE.
+ * 
+ * @param attr Attributes to apply
+ * @return int 0 on success, -1 if any attribute could not be applied
+ */
+int thread_attr_apply(const thread_attr_t *attr);
+
+/**
+ * @brief Create and start a new thread with placement and scheduling attributes
+ * 
+ * The attributes are applied by the new thread before func runs, and kept
+ * across thread_restart.
+ * 
+ * @param manager Pointer to thread manager structure
+ * @param func Thread function
+ * @param arg Thread function arguments
+ * @param attr Thread attributes, or NULL for none
+ * @param thread_id Pointer to store the thread ID
+ * @return int Thread ID on success, -1 on failure
+ */
+int thread_create_with_attr(thread_manager_t *manager, void *(*func)(void *), void *arg,
+                            const thread_attr_t *attr, unsigned int *thread_id);
+
 /**
  * @brief Stop a thread
  * 
@@ -192,6 +368,31 @@ bool thread_is_alive(thread_manager_t *manager, unsigned int thread_id);
  */
 int thread_join(thread_manager_t *manager, unsigned int thread_id, void **result);
 
+/**
+ * @brief Wait for thread to complete, giving up after a timeout
+ * 
+ * Sleeps until the thread finishes instead of polling its state.
+ * 
+ * @param manager Pointer to thread manager structure
+ * @param thread_id Thread ID
+ * @param timeout_ms Longest time to wait in milliseconds
+ * @param result Pointer to store the thread result
+ * @return int 0 on success, 1 if the thread is still running, -1 on failure
+ */
+int thread_join_timeout(thread_manager_t *manager, unsigned int thread_id, unsigned int timeout_ms, void **result);
+
+/**
+ * @brief Release a finished thread and reuse its slot
+ * 
+ * The thread must no longer be running. It is joined if that has not
+ * happened yet, and its ID becomes unknown to the manager afterwards.
+ * 
+ * @param manager Pointer to thread manager structure
+ * @param thread_id Thread ID
+ * @return int 0 on success, -1 on failure
+ */
+int thread_release(thread_manager_t *manager, unsigned int thread_id);
+
 /**
  * @brief Get a list of all thread IDs
  * 
@@ -202,6 +403,31 @@ int thread_join(thread_manager_t *manager, unsigned int thread_id, void **result
  */
 int thread_get_all_ids(thread_manager_t *manager, unsigned int *ids, unsigned int size);
 
+/**
+ * @brief Get a consistent copy of the thread registry without waiting for the manager lock
+ * 
+ * Meant for monitoring, which would otherwise take the manager lock once
+ * for the IDs and once per thread for its details, in the way of threads
+ * being created. The registry is copied at most once per change, by the
+ * first reader after it, and only if the lock is free at that moment;
+ * otherwise the previous copy is returned, so a snapshot can lag briefly
+ * behind a busy manager. Compare versions to skip unchanged snapshots.
+ * 
+ * The snapshot stays valid, and unchanged, until thread_snapshot_release,
+ * also after the manager is destroyed.
+ * 
+ * @param manager Pointer to thread manager structure
+ * @return const thread_snapshot_t* Snapshot, NULL on failure
+ */
+const thread_snapshot_t *thread_snapshot_acquire(thread_manager_t *manager);
+
+/**
+ * @brief Give back a snapshot from thread_snapshot_acquire
+ * 
+ * @param snapshot Snapshot, NULL does nothing
+ */
+void thread_snapshot_release(const thread_snapshot_t *snapshot);
+
 /**
  * @brief Helper function for thread functions to check if they should exit or pause
  * 
@@ -214,11 +440,36 @@ int thread_should_exit(thread_manager_t *manager, unsigned int thread_id);
 /**
  * @brief Helper function for thread functions to check and handle pause
  * 
+ * Called from the thread itself this only reads the pause flag, without
+ * taking any lock, unless a pause has been requested.
+ * 
  * @param manager Pointer to thread manager structure
  * @param thread_id Thread ID
  */
 void thread_check_pause(thread_manager_t *manager, unsigned int thread_id);
 
+/**
+ * @brief Get runtime statistics of a thread
+ * 
+ * CPU time and context switches are read live while the thread runs and
+ * keep their final values once it has finished. Process threads report
+ * state only.
+ * 
+ * @param manager Pointer to thread manager structure
+ * @param thread_id Thread ID
+ * @param stats Pointer to store the statistics
+ * @return int 0 on success, -1 on failure
+ */
+int thread_get_stats(thread_manager_t *manager, unsigned int thread_id, thread_stats_t *stats);
+
+/**
+ * @brief Count one loop iteration of the calling managed thread
+ * 
+ * Updates the iteration count and last-activity time without locking;
+ * does nothing when called from a thread the library did not start.
+ */
+void thread_heartbeat(void);
+
 /**
  * @brief Create and execute a system binary as a thread
  * 
@@ -230,6 +481,25 @@ void thread_check_pause(thread_manager_t *manager, unsigned int thread_id);
  */
 int thread_create_process(thread_manager_t *manager, const char *command, char **args, unsigned int *thread_id);
 
+/**
+ * @brief Create and execute a system binary, streaming its output to a callback
+ * 
+ * The process's stdout and stderr are read by one I/O thread shared by
+ * every such process of the manager, so no thread has to poll
+ * thread_read_from_process. user_data must stay valid until both streams
+ * have ended or the manager is destroyed. A restart keeps the callback.
+ * 
+ * @param manager Pointer to thread manager structure
+ * @param command Command to execute
+ * @param args Arguments for the command (NULL-terminated array)
+ * @param on_output Output callback, NULL to behave like thread_create_process
+ * @param user_data Passed to on_output
+ * @param thread_id Pointer to store the thread ID
+ * @return int Thread ID on success, -1 on failure
+ */
+int thread_create_process_with_output(thread_manager_t *manager, const char *command, char **args,
+                                      thread_output_cb_t on_output, void *user_data, unsigned int *thread_id);
+
 /**
  * @brief Write data to the stdin of a process thread
  * 
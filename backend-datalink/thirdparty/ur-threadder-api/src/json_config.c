@@ -28,6 +28,135 @@ extern char *strdup(const char *s);
 extern int nanosleep(const struct timespec *req, struct timespec *rem);
 #endif
 
+static const char *const sched_policy_names[] = {"default", "other", "batch", "idle", "fifo", "rr"};
+
+/**
+ * @brief Read the optional placement and scheduling keys of a thread object
+ * 
+ * @param root Thread JSON object
+ * @param attr Attributes to fill
+ * @return int 0 on success, -1 if a key has an invalid value
+ */
+static int parse_thread_attr(const cJSON *root, thread_attr_t *attr) {
+    thread_attr_init(attr);
+    
+    cJSON *name = cJSON_GetObjectItem(root, "name");
+    if (name) {
+        if (!cJSON_IsString(name)) {
+            ERROR_LOG("Invalid JSON: 'name' must be a string");
+            return -1;
+        }
+        strncpy(attr->name, name->valuestring, THREAD_NAME_MAX - 1);
+        attr->name[THREAD_NAME_MAX - 1] = '\0';
+    }
+    
+    cJSON *cpus = cJSON_GetObjectItem(root, "cpus");
+    if (cpus) {
+        if (!cJSON_IsArray(cpus)) {
+            ERROR_LOG("Invalid JSON: 'cpus' must be an array of CPU numbers");
+            return -1;
+        }
+        cJSON *cpu = NULL;
+        cJSON_ArrayForEach(cpu, cpus) {
+            if (!cJSON_IsNumber(cpu) || cpu->valueint < 0 || cpu->valueint > 63) {
+                ERROR_LOG("Invalid JSON: 'cpus' entries must be between 0 and 63");
+                return -1;
+            }
+            attr->cpu_mask |= 1ULL << cpu->valueint;
+        }
+    }
+    
+    cJSON *policy = cJSON_GetObjectItem(root, "policy");
+    if (policy) {
+        int found = 0;
+        if (cJSON_IsString(policy)) {
+            for (size_t i = 0; i < sizeof(sched_policy_names) / sizeof(sched_policy_names[0]); i++) {
+                if (strcmp(policy->valuestring, sched_policy_names[i]) == 0) {
+                    attr->policy = (thread_sched_policy_t)i;
+                    found = 1;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            ERROR_LOG("Invalid JSON: 'policy' must be one of default, other, batch, idle, fifo, rr");
+            return -1;
+        }
+    }
+    
+    cJSON *priority = cJSON_GetObjectItem(root, "priority");
+    if (priority) {
+        if (!cJSON_IsNumber(priority) || priority->valueint < 1 || priority->valueint > 99) {
+            ERROR_LOG("Invalid JSON: 'priority' must be between 1 and 99");
+            return -1;
+        }
+        attr->priority = priority->valueint;
+    }
+    
+    cJSON *nice = cJSON_GetObjectItem(root, "nice");
+    if (nice) {
+        if (!cJSON_IsNumber(nice) || nice->valueint < -20 || nice->valueint > 19) {
+            ERROR_LOG("Invalid JSON: 'nice' must be between -20 and 19");
+            return -1;
+        }
+        attr->nice = nice->valueint;
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Write the non-default thread attributes into a thread object
+ */
+static void add_thread_attr(cJSON *root, const thread_attr_t *attr) {
+    if (attr->name[0] != '\0') {
+        cJSON_AddStringToObject(root, "name", attr->name);
+    }
+    if (attr->cpu_mask != 0) {
+        cJSON *cpus = cJSON_CreateArray();
+        if (cpus) {
+            for (int cpu = 0; cpu < 64; cpu++) {
+                if (attr->cpu_mask & (1ULL << cpu)) {
+                    cJSON_AddItemToArray(cpus, cJSON_CreateNumber(cpu));
+                }
+            }
+            cJSON_AddItemToObject(root, "cpus", cpus);
+        }
+    }
+    if (attr->policy != THREAD_SCHED_DEFAULT && (size_t)attr->policy < sizeof(sched_policy_names) / sizeof(sched_policy_names[0])) {
+        cJSON_AddStringToObject(root, "policy", sched_policy_names[attr->policy]);
+    }
+    if (attr->priority != 0) {
+        cJSON_AddNumberToObject(root, "priority", attr->priority);
+    }
+    if (attr->nice != 0) {
+        cJSON_AddNumberToObject(root, "nice", attr->nice);
+    }
+}
+
+int thread_attr_from_json(const char *json_config, thread_attr_t *attr) {
+    if (!json_config || !attr) {
+        ERROR_LOG("Invalid parameters");
+        return -1;
+    }
+    
+    cJSON *root = cJSON_Parse(json_config);
+    if (!root) {
+        ERROR_LOG("Failed to parse JSON: %s", cJSON_GetErrorPtr());
+        return -1;
+    }
+    
+    int result = -1;
+    if (cJSON_IsObject(root)) {
+        result = parse_thread_attr(root, attr);
+    } else {
+        ERROR_LOG("Invalid JSON: thread attributes must be an object");
+    }
+    
+    cJSON_Delete(root);
+    return result;
+}
+
 /**
  * @brief Load thread configuration from a JSON file
  * 
@@ -262,9 +391,17 @@ int thread_manager_save_config(const thread_manager_t *manager, const char *file
  *   "args": {
  *     "param1": "value1",
  *     "param2": 42
- *   }
+ *   },
+ *   "name": "collector",
+ *   "cpus": [2, 3],
+ *   "policy": "batch",
+ *   "nice": 10
  * }
  * 
+ * "name", "cpus", "policy" (default, other, batch, idle, fifo or rr),
+ * "priority" (1 to 99, for fifo and rr) and "nice" (-20 to 19) are
+ * optional; see thread_attr_t.
+ * 
  * Note: Since we can't directly specify a function pointer in JSON,
  * we use a string identifier for the function and then map it to
  * the actual function pointer in the implementation.
@@ -311,6 +448,13 @@ int thread_create_from_json(thread_manager_t *manager, const char *json_config,
         return -1;
     }
     
+    // Get placement and scheduling
+    thread_attr_t attr;
+    if (parse_thread_attr(root, &attr) != 0) {
+        cJSON_Delete(root);
+        return -1;
+    }
+    
     // Create thread args object (this would be a custom struct for each function)
     // For now, we'll use a simple structure to hold the JSON args
     struct json_thread_args {
@@ -333,7 +477,7 @@ int thread_create_from_json(thread_manager_t *manager, const char *json_config,
     extern void *generic_json_thread_function(void *arg);
     
     // Create the thread
-    result = thread_create(manager, generic_json_thread_function, thread_args, thread_id);
+    result = thread_create_with_attr(manager, generic_json_thread_function, thread_args, &attr, thread_id);
     
     cJSON_Delete(root);
     
@@ -509,6 +653,7 @@ char *thread_get_json_config(thread_manager_t *manager, unsigned int thread_id)
     // Add thread type
     if (info.type == THREAD_TYPE_NORMAL) {
         cJSON_AddStringToObject(root, "type", "thread");
+        add_thread_attr(root, &info.attr);
     } else if (info.type == THREAD_TYPE_PROCESS) {
         cJSON_AddStringToObject(root, "type", "process");
         
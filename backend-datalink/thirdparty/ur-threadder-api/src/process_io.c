@@ -0,0 +1,254 @@
+/**
+ * @file process_io.c
+ * @brief Shared epoll loop streaming process output to callbacks
+ *
+ * One thread per manager reads the stdout and stderr of every process
+ * created with an output callback, instead of one reader per process.
+ */
+
+#define _GNU_SOURCE  /* epoll, eventfd */
+
+#include "process_io.h"
+#include "../include/utils.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#define PROCESS_IO_READ_SIZE 4096
+#define PROCESS_IO_MAX_EVENTS 32
+
+typedef struct process_io_watch {
+    unsigned int thread_id;
+    int stream;
+    int fd;
+    thread_output_cb_t on_output;
+    void *user_data;
+    struct process_io_watch *prev;
+    struct process_io_watch *next;
+} process_io_watch_t;
+
+struct process_io {
+    int epoll_fd;
+    int wake_fd;                     /* eventfd; readable once stopping */
+    pthread_t thread;
+    pthread_mutex_t mutex;           /* Guards the watch list */
+    process_io_watch_t *watches;
+};
+
+#ifdef __linux__
+
+static void unlink_watch(process_io_t *io, process_io_watch_t *watch) {
+    pthread_mutex_lock(&io->mutex);
+    if (watch->prev) {
+        watch->prev->next = watch->next;
+    } else {
+        io->watches = watch->next;
+    }
+    if (watch->next) {
+        watch->next->prev = watch->prev;
+    }
+    pthread_mutex_unlock(&io->mutex);
+}
+
+static void remove_watch(process_io_t *io, process_io_watch_t *watch) {
+    unlink_watch(io, watch);
+    epoll_ctl(io->epoll_fd, EPOLL_CTL_DEL, watch->fd, NULL);
+    close(watch->fd);
+    free(watch);
+}
+
+/**
+ * @brief Pass on everything readable now
+ *
+ * @return int 1 once the stream has ended, 0 otherwise
+ */
+static int drain_watch(process_io_watch_t *watch) {
+    char buffer[PROCESS_IO_READ_SIZE];
+    for (;;) {
+        ssize_t received = read(watch->fd, buffer, sizeof(buffer));
+        if (received > 0) {
+            watch->on_output(watch->thread_id, watch->stream, buffer, (size_t)received, watch->user_data);
+            continue;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (received < 0) {
+            WARN_LOG("Failed to read output of process %u: %s", watch->thread_id, strerror(errno));
+        }
+        watch->on_output(watch->thread_id, watch->stream, NULL, 0, watch->user_data);
+        return 1;
+    }
+}
+
+static void *process_io_loop(void *arg) {
+    process_io_t *io = (process_io_t *)arg;
+    struct epoll_event events[PROCESS_IO_MAX_EVENTS];
+    bool stopping = false;
+
+    while (!stopping) {
+        int count = epoll_wait(io->epoll_fd, events, PROCESS_IO_MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ERROR_LOG("epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            process_io_watch_t *watch = (process_io_watch_t *)events[i].data.ptr;
+            if (!watch) {
+                stopping = true;
+                continue;
+            }
+            if (drain_watch(watch)) {
+                remove_watch(io, watch);
+            }
+        }
+    }
+
+    // Deliver what is still buffered; the processes are gone by now
+    while (io->watches) {
+        process_io_watch_t *watch = io->watches;
+        drain_watch(watch);
+        remove_watch(io, watch);
+    }
+    return NULL;
+}
+
+int process_io_start(process_io_t **io) {
+    process_io_t *result = (process_io_t *)calloc(1, sizeof(process_io_t));
+    if (!result) {
+        ERROR_LOG("Failed to allocate memory for process I/O");
+        return -1;
+    }
+
+    result->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    result->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (result->epoll_fd < 0 || result->wake_fd < 0) {
+        ERROR_LOG("Failed to create process I/O descriptors: %s", strerror(errno));
+        goto fail;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    if (epoll_ctl(result->epoll_fd, EPOLL_CTL_ADD, result->wake_fd, &event) != 0) {
+        ERROR_LOG("Failed to watch process I/O wake descriptor: %s", strerror(errno));
+        goto fail;
+    }
+
+    if (pthread_mutex_init(&result->mutex, NULL) != 0) {
+        ERROR_LOG("Failed to initialize process I/O mutex");
+        goto fail;
+    }
+
+    if (pthread_create(&result->thread, NULL, process_io_loop, result) != 0) {
+        ERROR_LOG("Failed to create process I/O thread");
+        pthread_mutex_destroy(&result->mutex);
+        goto fail;
+    }
+
+    *io = result;
+    return 0;
+
+fail:
+    if (result->epoll_fd >= 0) {
+        close(result->epoll_fd);
+    }
+    if (result->wake_fd >= 0) {
+        close(result->wake_fd);
+    }
+    free(result);
+    return -1;
+}
+
+void process_io_stop(process_io_t *io) {
+    if (!io) {
+        return;
+    }
+
+    uint64_t one = 1;
+    ssize_t written = write(io->wake_fd, &one, sizeof(one));
+    (void)written;
+    pthread_join(io->thread, NULL);
+
+    close(io->epoll_fd);
+    close(io->wake_fd);
+    pthread_mutex_destroy(&io->mutex);
+    free(io);
+}
+
+int process_io_watch(process_io_t *io, unsigned int thread_id, int stream, int fd,
+                     thread_output_cb_t on_output, void *user_data) {
+    process_io_watch_t *watch = (process_io_watch_t *)calloc(1, sizeof(process_io_watch_t));
+    if (!watch) {
+        ERROR_LOG("Failed to allocate memory for output watch");
+        close(fd);
+        return -1;
+    }
+    watch->thread_id = thread_id;
+    watch->stream = stream;
+    watch->fd = fd;
+    watch->on_output = on_output;
+    watch->user_data = user_data;
+
+    // Listed before it can fire, so the loop may unlink it at once
+    pthread_mutex_lock(&io->mutex);
+    watch->next = io->watches;
+    if (io->watches) {
+        io->watches->prev = watch;
+    }
+    io->watches = watch;
+    pthread_mutex_unlock(&io->mutex);
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = watch;
+    if (epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        ERROR_LOG("Failed to watch output of process %u: %s", thread_id, strerror(errno));
+        unlink_watch(io, watch);
+        close(fd);
+        free(watch);
+        return -1;
+    }
+    return 0;
+}
+
+#else
+
+int process_io_start(process_io_t **io) {
+    (void)io;
+    ERROR_LOG("Process output callbacks need epoll");
+    return -1;
+}
+
+void process_io_stop(process_io_t *io) {
+    (void)io;
+}
+
+int process_io_watch(process_io_t *io, unsigned int thread_id, int stream, int fd,
+                     thread_output_cb_t on_output, void *user_data) {
+    (void)io;
+    (void)thread_id;
+    (void)stream;
+    (void)on_output;
+    (void)user_data;
+    close(fd);
+    return -1;
+}
+
+#endif
@@ -0,0 +1,46 @@
+/**
+ * @file process_io.h
+ * @brief Shared epoll loop streaming process output to callbacks (internal)
+ */
+
+#ifndef PROCESS_IO_H
+#define PROCESS_IO_H
+
+#include "../include/thread_manager.h"
+
+/**
+ * @brief I/O thread of a thread manager
+ */
+typedef struct process_io process_io_t;
+
+/**
+ * @brief Start the I/O thread
+ *
+ * @param io Pointer to store the I/O loop
+ * @return int 0 on success, -1 on failure
+ */
+int process_io_start(process_io_t **io);
+
+/**
+ * @brief Deliver what is still buffered, close every watched stream and join the thread
+ */
+void process_io_stop(process_io_t *io);
+
+/**
+ * @brief Hand a process output stream to the I/O thread
+ *
+ * The loop takes ownership of fd, which must be non-blocking, and closes it
+ * after reporting end of stream.
+ *
+ * @param io I/O loop
+ * @param thread_id Thread ID passed to the callback
+ * @param stream 1 for stdout, 2 for stderr
+ * @param fd Read end of the output pipe
+ * @param on_output Callback
+ * @param user_data Passed to the callback
+ * @return int 0 on success, -1 on failure (fd is closed)
+ */
+int process_io_watch(process_io_t *io, unsigned int thread_id, int stream, int fd,
+                     thread_output_cb_t on_output, void *user_data);
+
+#endif /* PROCESS_IO_H */
@@ -0,0 +1,415 @@
+/**
+ * @file process_spawn.c
+ * @brief posix_spawn launching and the spawn helper process
+ *
+ * posix_spawnp starts the child without copying the caller's page tables
+ * (glibc uses CLONE_VFORK), so its cost does not grow with the caller's RSS.
+ * The spawn helper goes further: it is forked once, while the caller is
+ * still small, and launches every later command itself. Requests reach it
+ * over a SOCK_SEQPACKET socket carrying the command, its arguments and, as
+ * SCM_RIGHTS, the child's stdin/stdout/stderr plus the write end of a pipe
+ * on which the helper reports the exit status.
+ */
+
+#define _GNU_SOURCE  /* SOCK_CLOEXEC, MSG_CMSG_CLOEXEC */
+
+#include "process_spawn.h"
+#include "../include/utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+#define SPAWN_REQUEST_MAX 16384      /* Command plus arguments, NUL separated */
+#define SPAWN_MAX_ARGS 256
+#define HELPER_MAX_CHILDREN 256      /* Processes the helper runs at once */
+#define HELPER_MAX_FD 65536          /* Inherited descriptors closed up to here */
+
+struct spawn_helper {
+    pid_t pid;
+    int sock;
+    pthread_mutex_t mutex;           /* One request in flight at a time */
+};
+
+/**
+ * @brief posix_spawnp with the child's standard descriptors and signal state set
+ *
+ * @param sigdefault Signals to reset to their default action, or NULL
+ */
+static int spawn_command(const char *command, char *const args[], const int fds[3],
+                         const sigset_t *sigdefault, pid_t *pid) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    int result = posix_spawn_file_actions_init(&actions);
+    if (result != 0) {
+        return result;
+    }
+    result = posix_spawnattr_init(&attr);
+    if (result != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return result;
+    }
+
+    for (int i = 0; i < 3 && result == 0; i++) {
+        result = posix_spawn_file_actions_adddup2(&actions, fds[i], i);
+    }
+
+    // The launching thread may run with signals blocked
+    short flags = POSIX_SPAWN_SETSIGMASK;
+    sigset_t mask;
+    sigemptyset(&mask);
+    if (result == 0) {
+        result = posix_spawnattr_setsigmask(&attr, &mask);
+    }
+    if (result == 0 && sigdefault) {
+        flags |= POSIX_SPAWN_SETSIGDEF;
+        result = posix_spawnattr_setsigdefault(&attr, sigdefault);
+    }
+    if (result == 0) {
+        result = posix_spawnattr_setflags(&attr, flags);
+    }
+    if (result == 0) {
+        result = posix_spawnp(pid, command, &actions, &attr, args, environ);
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return result;
+}
+
+int process_spawn(const char *command, char *const args[], const int fds[3], pid_t *pid) {
+    return spawn_command(command, args, fds, NULL, pid);
+}
+
+/* Helper process side. It is forked from a possibly multithreaded process,
+ * so it sticks to static buffers and system calls. */
+
+typedef struct {
+    pid_t pid;
+    int status_fd;
+} helper_child_t;
+
+static int helper_wake_fd = -1;
+
+static void helper_sigchld(int sig) {
+    (void)sig;
+    int saved_errno = errno;
+    char byte = 0;
+    ssize_t written = write(helper_wake_fd, &byte, 1);
+    (void)written;
+    errno = saved_errno;
+}
+
+/**
+ * @brief Report exited children on their status pipes
+ */
+static void helper_reap(helper_child_t *children, unsigned int *count) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (unsigned int i = 0; i < *count; i++) {
+            if (children[i].pid == pid) {
+                ssize_t written = write(children[i].status_fd, &status, sizeof(status));
+                (void)written;
+                close(children[i].status_fd);
+                children[i] = children[--*count];
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Receive one spawn request, launch it and reply with the PID or -errno
+ *
+ * @return int 0 to keep serving, -1 once the manager has gone away
+ */
+static int helper_serve(int sock, helper_child_t *children, unsigned int *count, const sigset_t *sigdefault) {
+    static char buffer[SPAWN_REQUEST_MAX];
+    static char *argv[SPAWN_MAX_ARGS + 2];
+    union {
+        char buf[CMSG_SPACE(4 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {buffer, sizeof(buffer)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t received = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if (received < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (received == 0) {
+        return -1;
+    }
+
+    int fds[4] = {-1, -1, -1, -1};
+    int fd_count = 0;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        fd_count = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        if (fd_count > 4) {
+            fd_count = 4;
+        }
+        memcpy(fds, CMSG_DATA(cmsg), (size_t)fd_count * sizeof(int));
+    }
+
+    int32_t reply = -EINVAL;
+    if (fd_count == 4 && !(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) && buffer[received - 1] == '\0') {
+        // Split "command\0arg0\0arg1\0..." in place
+        int argc = 0;
+        char *command = buffer;
+        for (char *p = buffer + strlen(buffer) + 1; p < buffer + received && argc <= SPAWN_MAX_ARGS;
+             p += strlen(p) + 1) {
+            argv[argc++] = p;
+        }
+        argv[argc] = NULL;
+
+        pid_t pid;
+        int error = *count >= HELPER_MAX_CHILDREN ? EAGAIN : spawn_command(command, argv, fds, sigdefault, &pid);
+        if (error == 0) {
+            children[*count].pid = pid;
+            children[*count].status_fd = fds[3];
+            ++*count;
+            fds[3] = -1;
+            reply = (int32_t)pid;
+        } else {
+            reply = -error;
+        }
+    }
+
+    for (int i = 0; i < fd_count; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+
+    return send(sock, &reply, sizeof(reply), MSG_NOSIGNAL) == (ssize_t)sizeof(reply) ? 0 : -1;
+}
+
+static void helper_main(int sock) {
+    static helper_child_t children[HELPER_MAX_CHILDREN];
+    unsigned int count = 0;
+
+    // Interrupts aimed at the process group are the manager's to handle;
+    // the helper leaves once the manager closes the socket
+    signal(SIGINT, SIG_IGN);
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGTERM, SIG_DFL);
+    sigset_t sigdefault;
+    sigemptyset(&sigdefault);
+    sigaddset(&sigdefault, SIGINT);
+    sigaddset(&sigdefault, SIGHUP);
+    sigaddset(&sigdefault, SIGPIPE);
+
+    int wake[2];
+    if (pipe(wake) != 0) {
+        _exit(EXIT_FAILURE);
+    }
+    fcntl(wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake[1], F_SETFL, O_NONBLOCK);
+    fcntl(wake[0], F_SETFD, FD_CLOEXEC);
+    fcntl(wake[1], F_SETFD, FD_CLOEXEC);
+    helper_wake_fd = wake[1];
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = helper_sigchld;
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+
+    for (;;) {
+        struct pollfd fds[2] = {{sock, POLLIN, 0}, {wake[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (read(wake[0], drain, sizeof(drain)) > 0) {
+            }
+            helper_reap(children, &count);
+        }
+
+        if ((fds[0].revents & (POLLIN | POLLHUP | POLLERR)) &&
+            helper_serve(sock, children, &count, &sigdefault) != 0) {
+            break;
+        }
+    }
+
+    _exit(0);
+}
+
+/* Manager side */
+
+int spawn_helper_start(spawn_helper_t **helper) {
+    if (!helper) {
+        return -1;
+    }
+
+    spawn_helper_t *result = (spawn_helper_t *)calloc(1, sizeof(spawn_helper_t));
+    if (!result) {
+        ERROR_LOG("Failed to allocate memory for spawn helper");
+        return -1;
+    }
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+        ERROR_LOG("Failed to create spawn helper socket: %s", strerror(errno));
+        free(result);
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        ERROR_LOG("Failed to fork spawn helper: %s", strerror(errno));
+        close(sv[0]);
+        close(sv[1]);
+        free(result);
+        return -1;
+    }
+
+    if (pid == 0) {
+        // Keep only stdio and the socket: the helper must not hold the
+        // caller's listening sockets or database files open
+        long max_fd = sysconf(_SC_OPEN_MAX);
+        if (max_fd < 0 || max_fd > HELPER_MAX_FD) {
+            max_fd = HELPER_MAX_FD;
+        }
+        for (int fd = 3; fd < max_fd; fd++) {
+            if (fd != sv[1]) {
+                close(fd);
+            }
+        }
+        helper_main(sv[1]);
+    }
+
+    close(sv[1]);
+    if (pthread_mutex_init(&result->mutex, NULL) != 0) {
+        ERROR_LOG("Failed to initialize spawn helper mutex");
+        close(sv[0]);
+        waitpid(pid, NULL, 0);
+        free(result);
+        return -1;
+    }
+    result->sock = sv[0];
+    result->pid = pid;
+    *helper = result;
+
+    DEBUG_LOG("Spawn helper started with PID %d", (int)pid);
+    return 0;
+}
+
+void spawn_helper_stop(spawn_helper_t *helper) {
+    if (!helper) {
+        return;
+    }
+
+    close(helper->sock);
+    while (waitpid(helper->pid, NULL, 0) < 0 && errno == EINTR) {
+    }
+    pthread_mutex_destroy(&helper->mutex);
+    free(helper);
+}
+
+int spawn_helper_spawn(spawn_helper_t *helper, const char *command, char *const args[], const int fds[3],
+                       pid_t *pid, int *status_fd) {
+    size_t length = strlen(command) + 1;
+    int argc = 0;
+    for (; args[argc] != NULL; argc++) {
+        length += strlen(args[argc]) + 1;
+    }
+    if (length > SPAWN_REQUEST_MAX || argc > SPAWN_MAX_ARGS) {
+        return E2BIG;
+    }
+
+    char *request = (char *)malloc(length);
+    if (!request) {
+        return ENOMEM;
+    }
+    char *p = request;
+    size_t size = strlen(command) + 1;
+    memcpy(p, command, size);
+    p += size;
+    for (int i = 0; i < argc; i++) {
+        size = strlen(args[i]) + 1;
+        memcpy(p, args[i], size);
+        p += size;
+    }
+
+    int status_pipe[2];
+    if (pipe(status_pipe) != 0) {
+        int error = errno;
+        free(request);
+        return error;
+    }
+    fcntl(status_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(status_pipe[1], F_SETFD, FD_CLOEXEC);
+
+    int passed[4] = {fds[0], fds[1], fds[2], status_pipe[1]};
+    union {
+        char buf[CMSG_SPACE(sizeof(passed))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = {request, length};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(passed));
+    memcpy(CMSG_DATA(cmsg), passed, sizeof(passed));
+
+    int32_t reply = -EPIPE;
+    pthread_mutex_lock(&helper->mutex);
+    if (sendmsg(helper->sock, &msg, MSG_NOSIGNAL) == (ssize_t)length) {
+        ssize_t received;
+        do {
+            received = recv(helper->sock, &reply, sizeof(reply), 0);
+        } while (received < 0 && errno == EINTR);
+        if (received != (ssize_t)sizeof(reply)) {
+            reply = -EPIPE;
+        }
+    }
+    pthread_mutex_unlock(&helper->mutex);
+
+    free(request);
+    close(status_pipe[1]);
+
+    if (reply <= 0) {
+        close(status_pipe[0]);
+        return reply < 0 ? -reply : EPIPE;
+    }
+
+    *pid = (pid_t)reply;
+    *status_fd = status_pipe[0];
+    return 0;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file process_spawn.h
+ * @brief Process launching used by thread_create_process (internal)
+ */
+
+#ifndef PROCESS_SPAWN_H
+#define PROCESS_SPAWN_H
+
+#include <sys/types.h>
+
+/**
+ * @brief Long-lived helper process that launches commands for the manager
+ */
+typedef struct spawn_helper spawn_helper_t;
+
+/**
+ * @brief Start a command with posix_spawnp
+ *
+ * @param command Command, looked up in PATH
+ * @param args Arguments (NULL-terminated array, args[0] is the program name)
+ * @param fds Descriptors to become the child's stdin, stdout and stderr
+ * @param pid Pointer to store the process ID
+ * @return int 0 on success, an errno value on failure
+ */
+int process_spawn(const char *command, char *const args[], const int fds[3], pid_t *pid);
+
+/**
+ * @brief Fork the helper process
+ *
+ * @param helper Pointer to store the helper
+ * @return int 0 on success, -1 on failure
+ */
+int spawn_helper_start(spawn_helper_t **helper);
+
+/**
+ * @brief Close the helper's socket and reap it
+ */
+void spawn_helper_stop(spawn_helper_t *helper);
+
+/**
+ * @brief Start a command through the helper
+ *
+ * The process is a child of the helper, not of the caller: its exit status
+ * arrives as an int on status_fd, which reaches end of file without one if
+ * the helper dies.
+ *
+ * @param helper Spawn helper
+ * @param command Command, looked up in PATH
+ * @param args Arguments (NULL-terminated array, args[0] is the program name)
+ * @param fds Descriptors to become the child's stdin, stdout and stderr
+ * @param pid Pointer to store the process ID
+ * @param status_fd Pointer to store the exit status descriptor
+ * @return int 0 on success, an errno value on failure
+ */
+int spawn_helper_spawn(spawn_helper_t *helper, const char *command, char *const args[], const int fds[3],
+                       pid_t *pid, int *status_fd);
+
+#endif /* PROCESS_SPAWN_H */
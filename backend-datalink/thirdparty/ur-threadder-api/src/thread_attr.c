@@ -0,0 +1,148 @@
+/**
+ * @file thread_attr.c
+ * @brief CPU placement, scheduling class and naming of managed threads
+ */
+
+#define _GNU_SOURCE  /* pthread_setaffinity_np, pthread_setname_np, SCHED_BATCH/IDLE */
+
+#include "../include/thread_manager.h"
+#include "../include/utils.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+void thread_attr_init(thread_attr_t *attr) {
+    if (attr) {
+        memset(attr, 0, sizeof(*attr));
+        attr->policy = THREAD_SCHED_DEFAULT;
+    }
+}
+
+/**
+ * @brief Restrict the calling thread to the CPUs in mask
+ */
+static int apply_cpu_mask(unsigned long long mask) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < 64; cpu++) {
+        if (mask & (1ULL << cpu)) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        WARN_LOG("Failed to set CPU affinity 0x%llx: %s", mask, strerror(result));
+        return -1;
+    }
+    return 0;
+#else
+    (void)mask;
+    WARN_LOG("CPU affinity is not supported on this platform");
+    return -1;
+#endif
+}
+
+/**
+ * @brief Switch the calling thread to a scheduling policy
+ */
+static int apply_policy(thread_sched_policy_t policy, int priority) {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    int native;
+
+    switch (policy) {
+        case THREAD_SCHED_OTHER:
+            native = SCHED_OTHER;
+            break;
+#ifdef SCHED_BATCH
+        case THREAD_SCHED_BATCH:
+            native = SCHED_BATCH;
+            break;
+#endif
+#ifdef SCHED_IDLE
+        case THREAD_SCHED_IDLE:
+            native = SCHED_IDLE;
+            break;
+#endif
+        case THREAD_SCHED_FIFO:
+            native = SCHED_FIFO;
+            break;
+        case THREAD_SCHED_RR:
+            native = SCHED_RR;
+            break;
+        default:
+            WARN_LOG("Scheduling policy %d is not supported", (int)policy);
+            return -1;
+    }
+
+    if (native == SCHED_FIFO || native == SCHED_RR) {
+        int min = sched_get_priority_min(native);
+        int max = sched_get_priority_max(native);
+        param.sched_priority = priority < min ? min : (priority > max ? max : priority);
+    }
+
+    int result = pthread_setschedparam(pthread_self(), native, &param);
+    if (result != 0) {
+        WARN_LOG("Failed to set scheduling policy %d: %s", (int)policy, strerror(result));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Set the nice value of the calling thread only
+ *
+ * On Linux setpriority() with a thread ID affects just that thread.
+ */
+static int apply_nice(int nice) {
+#ifdef __linux__
+    id_t tid = (id_t)syscall(SYS_gettid);
+#else
+    id_t tid = 0;
+#endif
+    if (setpriority(PRIO_PROCESS, tid, nice) != 0) {
+        WARN_LOG("Failed to set nice value %d: %s", nice, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int thread_attr_apply(const thread_attr_t *attr) {
+    if (!attr) {
+        return 0;
+    }
+
+    int result = 0;
+
+    if (attr->name[0] != '\0') {
+        char name[THREAD_NAME_MAX];
+        strncpy(name, attr->name, sizeof(name) - 1);
+        name[sizeof(name) - 1] = '\0';
+        int rc = pthread_setname_np(pthread_self(), name);
+        if (rc != 0) {
+            WARN_LOG("Failed to set thread name '%s': %s", name, strerror(rc));
+            result = -1;
+        }
+    }
+
+    if (attr->cpu_mask != 0 && apply_cpu_mask(attr->cpu_mask) != 0) {
+        result = -1;
+    }
+
+    if (attr->policy != THREAD_SCHED_DEFAULT && apply_policy(attr->policy, attr->priority) != 0) {
+        result = -1;
+    }
+
+    // Nice only weighs time-sharing threads
+    bool realtime = (attr->policy == THREAD_SCHED_FIFO || attr->policy == THREAD_SCHED_RR);
+    if (attr->nice != 0 && !realtime && apply_nice(attr->nice) != 0) {
+        result = -1;
+    }
+
+    return result;
+}
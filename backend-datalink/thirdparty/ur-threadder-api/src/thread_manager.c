@@ -7,6 +7,9 @@
 
 #include "../include/thread_manager.h"
 #include "../include/utils.h"
+#include "process_io.h"
+#include "process_spawn.h"
+#include "thread_snapshot.h"
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,6 +23,10 @@
 #include <poll.h>
 #include <stdint.h>
 #include <time.h>    /* For nanosleep() */
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
 
 /* Function declarations for better portability */
 #if defined(__APPLE__) || !defined(_GNU_SOURCE)
@@ -33,9 +40,124 @@ extern int nanosleep(const struct timespec *req, struct timespec *rem);
 extern int kill(pid_t pid, int sig);
 #endif
 
+/* syscall() is hidden by _POSIX_C_SOURCE; used for pidfd_open */
+#ifdef __linux__
+extern long syscall(long number, ...);
+#endif
+
 #define INITIAL_CAPACITY 10
 #define GROWTH_FACTOR 2
 
+/* is_paused is read without locks by thread_check_pause */
+#define PAUSE_FLAG_GET(info) __atomic_load_n(&(info)->is_paused, __ATOMIC_ACQUIRE)
+#define PAUSE_FLAG_SET(info, value) __atomic_store_n(&(info)->is_paused, (value), __ATOMIC_RELEASE)
+
+static void remove_registration(thread_manager_t *manager, unsigned int slot);
+
+/* Thread info of the managed thread running on this thread, if any */
+static _Thread_local thread_info_t *current_thread_info = NULL;
+
+/**
+ * @brief Change the state of a thread, caller holding its mutex
+ * 
+ * Marks the registry snapshot stale only when the state really changes.
+ */
+static void set_thread_state(thread_info_t *info, thread_state_t state) {
+    if (info->state != state) {
+        info->state = state;
+        thread_snapshot_invalidate((thread_manager_t *)info->owner);
+    }
+}
+
+/**
+ * @brief Move a thread into a final state and wake everyone waiting on it
+ * 
+ * Broadcast rather than signal: thread_join_timeout callers wait on the
+ * same condition variable as the pause logic.
+ */
+static void finish_thread(thread_info_t *info, thread_state_t state) {
+    pthread_mutex_lock(&info->mutex);
+    set_thread_state(info, state);
+    pthread_cond_broadcast(&info->cond);
+    pthread_mutex_unlock(&info->mutex);
+}
+
+/**
+ * @brief Wall-clock time in milliseconds since the epoch
+ */
+static unsigned long long realtime_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000ULL + (unsigned long long)ts.tv_nsec / 1000000ULL;
+}
+
+/**
+ * @brief Read a thread's context switch counts from /proc/self/task/<tid>/status
+ */
+static int read_context_switches(pid_t tid, unsigned long long *voluntary, unsigned long long *involuntary) {
+#ifdef __linux__
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/status", (int)tid);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    
+    char line[128];
+    int found = 0;
+    while (found < 2 && fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "voluntary_ctxt_switches: %llu", voluntary) == 1 ||
+            sscanf(line, "nonvoluntary_ctxt_switches: %llu", involuntary) == 1) {
+            found++;
+        }
+    }
+    fclose(file);
+    return found == 2 ? 0 : -1;
+#else
+    (void)tid;
+    (void)voluntary;
+    (void)involuntary;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Keep the calling thread's CPU time and switch counts before it ends
+ * 
+ * Once the thread is gone neither its CPU clock nor its /proc entry exist.
+ */
+static void capture_final_stats(thread_info_t *info) {
+    struct timespec cpu;
+    unsigned long long voluntary = 0;
+    unsigned long long involuntary = 0;
+    bool have_cpu = clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu) == 0;
+    bool have_switches = read_context_switches(info->tid, &voluntary, &involuntary) == 0;
+    
+    pthread_mutex_lock(&info->mutex);
+    if (have_cpu) {
+        info->cpu_time_ns = (unsigned long long)cpu.tv_sec * 1000000000ULL + (unsigned long long)cpu.tv_nsec;
+    }
+    if (have_switches) {
+        info->voluntary_switches = voluntary;
+        info->involuntary_switches = involuntary;
+    }
+    pthread_mutex_unlock(&info->mutex);
+}
+
+/**
+ * @brief Initialize a thread's condition variable on the monotonic clock
+ */
+static int init_thread_cond(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr) != 0) {
+        return -1;
+    }
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int result = pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return result;
+}
+
 /**
  * @brief Wrapper function for thread execution
  * 
@@ -49,9 +171,16 @@ static void *thread_wrapper(void *arg) {
     thread_info_t *info = (thread_info_t *)arg;
     void *result = NULL;
     
+    current_thread_info = info;
+    thread_attr_apply(&info->attr);
+    __atomic_store_n(&info->last_activity_ms, realtime_ms(), __ATOMIC_RELAXED);
+    
     // Set thread state to running
     pthread_mutex_lock(&info->mutex);
-    info->state = THREAD_RUNNING;
+#ifdef __linux__
+    info->tid = (pid_t)syscall(SYS_gettid);
+#endif
+    set_thread_state(info, THREAD_RUNNING);
     pthread_mutex_unlock(&info->mutex);
     
     // Execute thread function while checking for pause and exit conditions
@@ -59,10 +188,10 @@ static void *thread_wrapper(void *arg) {
         // Check if thread is paused
         pthread_mutex_lock(&info->mutex);
         while (info->is_paused && !info->should_exit) {
-            info->state = THREAD_PAUSED;
+            set_thread_state(info, THREAD_PAUSED);
             pthread_cond_wait(&info->cond, &info->mutex);
         }
-        info->state = THREAD_RUNNING;
+        set_thread_state(info, THREAD_RUNNING);
         pthread_mutex_unlock(&info->mutex);
         
         // If thread should exit, break the loop
@@ -79,13 +208,102 @@ static void *thread_wrapper(void *arg) {
     }
     
     // Set thread state to stopped
-    pthread_mutex_lock(&info->mutex);
-    info->state = THREAD_STOPPED;
-    pthread_mutex_unlock(&info->mutex);
+    capture_final_stats(info);
+    finish_thread(info, THREAD_STOPPED);
     
     return result;
 }
 
+/**
+ * @brief Open a pidfd that becomes readable when the process exits
+ * 
+ * @return int File descriptor, or -1 where the kernel has no pidfd_open
+ */
+static int open_pidfd(pid_t pid) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Collect the exit status of a process thread's process
+ * 
+ * Processes started by the spawn helper are not our children; their status
+ * comes over info->status_fd instead of from waitpid.
+ * 
+ * @return pid_t pid once reaped, 0 while it runs, -1 on error
+ */
+static pid_t reap_process(thread_info_t *info, pid_t pid, int *status, bool block) {
+    if (info->status_fd < 0) {
+        return waitpid(pid, status, block ? 0 : WNOHANG);
+    }
+    
+    if (!block) {
+        struct pollfd pfd = {info->status_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 0) <= 0) {
+            return 0;
+        }
+    }
+    ssize_t received;
+    do {
+        received = read(info->status_fd, status, sizeof(*status));
+    } while (received < 0 && errno == EINTR);
+    if (received == (ssize_t)sizeof(*status)) {
+        return pid;
+    }
+    // The helper went away without reporting
+    errno = ECHILD;
+    return -1;
+}
+
+/**
+ * @brief Wait up to timeout_ms for a process to exit and reap it
+ * 
+ * @param exit_fd Descriptor readable once the process has exited, or -1
+ * @return int 1 if the process was reaped, 0 otherwise
+ */
+static int wait_for_exit(thread_info_t *info, pid_t pid, int exit_fd, int timeout_ms, int *status) {
+    if (exit_fd >= 0) {
+        struct pollfd pfd = {exit_fd, POLLIN, 0};
+        poll(&pfd, 1, timeout_ms);
+        return reap_process(info, pid, status, false) > 0;
+    }
+    
+    for (int waited = 0; waited < timeout_ms; waited += 100) {
+        if (reap_process(info, pid, status, false) != 0) {
+            return 1;
+        }
+        struct timespec ts = {0, 100000000}; // 100ms
+        nanosleep(&ts, NULL);
+    }
+    return reap_process(info, pid, status, false) > 0;
+}
+
+/**
+ * @brief Interrupt the process monitor so it sees a new control request
+ * 
+ * Must be called with info->mutex held, after changing the request flags.
+ */
+static void wake_process_monitor(thread_info_t *info) {
+    if (info->type == THREAD_TYPE_PROCESS && info->wake_fd > 0) {
+        uint64_t one = 1;
+        ssize_t written = write(info->wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+static void close_wake_fd(thread_info_t *info) {
+    pthread_mutex_lock(&info->mutex);
+    if (info->wake_fd > 0) {
+        close(info->wake_fd);
+    }
+    info->wake_fd = -1;
+    pthread_mutex_unlock(&info->mutex);
+}
+
 /**
  * @brief Wrapper function for process execution
  * 
@@ -97,12 +315,15 @@ static void *thread_wrapper(void *arg) {
  */
 static void *process_wrapper(void *arg) {
     thread_info_t *info = (thread_info_t *)arg;
-    int status;
+    int status = 0;
     pid_t pid;
     
     // Set thread state to running
     pthread_mutex_lock(&info->mutex);
-    info->state = THREAD_RUNNING;
+    set_thread_state(info, THREAD_RUNNING);
+#ifdef __linux__
+    info->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
     pthread_mutex_unlock(&info->mutex);
     
     // Create pipes for communication with the process
@@ -112,10 +333,9 @@ static void *process_wrapper(void *arg) {
         ERROR_LOG("Failed to create pipes for process %u: %s", info->id, strerror(errno));
         
         // Set thread state to error
-        pthread_mutex_lock(&info->mutex);
-        info->state = THREAD_ERROR;
-        pthread_mutex_unlock(&info->mutex);
+        finish_thread(info, THREAD_ERROR);
         
+        close_wake_fd(info);
         return NULL;
     }
     
@@ -123,12 +343,23 @@ static void *process_wrapper(void *arg) {
     fcntl(info->stdout_pipe[0], F_SETFL, O_NONBLOCK);
     fcntl(info->stderr_pipe[0], F_SETFL, O_NONBLOCK);
     
-    // Fork a child process
-    pid = fork();
+    // No pipe end may leak into this or any other child; the child's own
+    // ends lose the flag when they are duplicated onto 0, 1 and 2
+    int *pipes[3] = {info->stdin_pipe, info->stdout_pipe, info->stderr_pipe};
+    for (int i = 0; i < 3; i++) {
+        fcntl(pipes[i][0], F_SETFD, FD_CLOEXEC);
+        fcntl(pipes[i][1], F_SETFD, FD_CLOEXEC);
+    }
+    
+    // Start the command, from the spawn helper when the manager has one
+    const int child_fds[3] = {info->stdin_pipe[0], info->stdout_pipe[1], info->stderr_pipe[1]};
+    spawn_helper_t *helper = ((const thread_manager_t *)info->owner)->spawn_helper;
+    info->status_fd = -1;
+    int spawn_error = helper ? spawn_helper_spawn(helper, info->command, info->args, child_fds, &pid, &info->status_fd)
+                             : process_spawn(info->command, info->args, child_fds, &pid);
     
-    if (pid < 0) {
-        // Fork failed
-        ERROR_LOG("Failed to fork process for thread %u: %s", info->id, strerror(errno));
+    if (spawn_error != 0) {
+        ERROR_LOG("Failed to start '%s' for thread %u: %s", info->command, info->id, strerror(spawn_error));
         
         // Close pipes
         close(info->stdout_pipe[0]);
@@ -139,48 +370,53 @@ static void *process_wrapper(void *arg) {
         close(info->stdin_pipe[1]);
         
         // Set thread state to error
-        pthread_mutex_lock(&info->mutex);
-        info->state = THREAD_ERROR;
-        pthread_mutex_unlock(&info->mutex);
+        finish_thread(info, THREAD_ERROR);
         
+        close_wake_fd(info);
         return NULL;
-    } else if (pid == 0) {
-        // Child process
-        
-        // Redirect stdin, stdout, and stderr
-        dup2(info->stdin_pipe[0], STDIN_FILENO);
-        dup2(info->stdout_pipe[1], STDOUT_FILENO);
-        dup2(info->stderr_pipe[1], STDERR_FILENO);
-        
-        // Close unused pipe ends
-        close(info->stdin_pipe[1]);
-        close(info->stdout_pipe[0]);
-        close(info->stderr_pipe[0]);
-        close(info->stdin_pipe[0]);
-        close(info->stdout_pipe[1]);
-        close(info->stderr_pipe[1]);
-        
-        // Execute command
-        execvp(info->command, info->args);
-        
-        // If execvp returns, it failed
-        fprintf(stderr, "Failed to execute command '%s': %s\n", info->command, strerror(errno));
-        exit(EXIT_FAILURE);
     } else {
         // Parent process
         
         // Store process ID
         info->process_id = pid;
+        thread_snapshot_invalidate((thread_manager_t *)info->owner);
         
         // Close unused pipe ends
         close(info->stdin_pipe[0]);
         close(info->stdout_pipe[1]);
         close(info->stderr_pipe[1]);
         
-        // Monitor the process
-        while (!info->should_exit) {
+        // Hand copies of the output ends to the I/O thread, which closes
+        // them at end of stream; ours stay open until the process is reaped
+        if (info->output_cb) {
+            process_io_t *io = ((const thread_manager_t *)info->owner)->process_io;
+            process_io_watch(io, info->id, 1, fcntl(info->stdout_pipe[0], F_DUPFD_CLOEXEC, 0),
+                             info->output_cb, info->output_user_data);
+            process_io_watch(io, info->id, 2, fcntl(info->stderr_pipe[0], F_DUPFD_CLOEXEC, 0),
+                             info->output_cb, info->output_user_data);
+        }
+        
+        // Monitor the process: sleep until it exits or a control request
+        // arrives, rather than polling waitpid. The helper's status pipe
+        // turns readable on exit just like a pidfd.
+        int pidfd = info->status_fd >= 0 ? -1 : open_pidfd(pid);
+        int exit_fd = info->status_fd >= 0 ? info->status_fd : pidfd;
+        struct pollfd fds[2];
+        nfds_t nfds = 0;
+        if (info->wake_fd > 0) {
+            fds[nfds].fd = info->wake_fd;
+            fds[nfds++].events = POLLIN;
+        }
+        if (exit_fd >= 0) {
+            fds[nfds].fd = exit_fd;
+            fds[nfds++].events = POLLIN;
+        }
+        // Without both descriptors fall back to the old 50ms tick
+        int poll_timeout = (exit_fd >= 0 && info->wake_fd > 0) ? -1 : 50;
+        
+        for (;;) {
             // Check if process has exited
-            int ret = waitpid(pid, &status, WNOHANG);
+            pid_t ret = reap_process(info, pid, &status, false);
             
             if (ret > 0) {
                 // Process has exited
@@ -196,55 +432,56 @@ static void *process_wrapper(void *arg) {
                 break;
             }
             
-            // Check if thread is paused
+            // Apply pause and resume requests
             pthread_mutex_lock(&info->mutex);
-            if (info->is_paused) {
+            bool should_exit = info->should_exit;
+            bool was_paused = (info->state == THREAD_PAUSED);
+            if (!should_exit && info->is_paused && !was_paused) {
                 // Pause process by sending SIGSTOP
                 kill(pid, SIGSTOP);
-                info->state = THREAD_PAUSED;
+                set_thread_state(info, THREAD_PAUSED);
                 DEBUG_LOG("Process %u (PID %d) paused", info->id, pid);
-                
-                // Wait for resume signal
-                while (info->is_paused && !info->should_exit) {
-                    pthread_cond_wait(&info->cond, &info->mutex);
-                }
-                
-                // Resume process if not exiting
-                if (!info->should_exit) {
-                    kill(pid, SIGCONT);
-                    info->state = THREAD_RUNNING;
-                    DEBUG_LOG("Process %u (PID %d) resumed", info->id, pid);
-                }
+            } else if (!should_exit && !info->is_paused && was_paused) {
+                kill(pid, SIGCONT);
+                set_thread_state(info, THREAD_RUNNING);
+                DEBUG_LOG("Process %u (PID %d) resumed", info->id, pid);
             }
             pthread_mutex_unlock(&info->mutex);
             
             // If thread should exit, terminate the process
-            if (info->should_exit) {
+            if (should_exit) {
                 DEBUG_LOG("Terminating process %u (PID %d)", info->id, pid);
                 kill(pid, SIGTERM);
-                
-                // Wait for process to terminate
-                int count = 0;
-                while (waitpid(pid, &status, WNOHANG) == 0 && count < 10) {
-                    struct timespec ts = {0, 100000000}; // 100ms
-                    nanosleep(&ts, NULL);
-                    count++;
+                if (was_paused) {
+                    // A stopped process only acts on SIGTERM once continued
+                    kill(pid, SIGCONT);
                 }
                 
-                // If process didn't terminate, kill it
-                if (count >= 10) {
+                // If process didn't terminate within a second, kill it
+                if (!wait_for_exit(info, pid, exit_fd, 1000, &status)) {
                     DEBUG_LOG("Process %u (PID %d) didn't terminate, killing", info->id, pid);
                     kill(pid, SIGKILL);
-                    waitpid(pid, &status, 0);
+                    reap_process(info, pid, &status, true);
                 }
                 
                 info->exit_status = WEXITSTATUS(status);
                 break;
             }
             
-            // Sleep briefly to avoid busy-waiting
-            struct timespec ts2 = {0, 50000000}; // 50ms
-            nanosleep(&ts2, NULL);
+            // Sleep until the process exits or the manager wakes us
+            if (poll(fds, nfds, poll_timeout) > 0 && info->wake_fd > 0 && (fds[0].revents & POLLIN)) {
+                uint64_t wakeups;
+                ssize_t drained = read(info->wake_fd, &wakeups, sizeof(wakeups));
+                (void)drained;
+            }
+        }
+        
+        if (pidfd >= 0) {
+            close(pidfd);
+        }
+        if (info->status_fd >= 0) {
+            close(info->status_fd);
+            info->status_fd = -1;
         }
         
         // Close remaining pipe ends
@@ -253,14 +490,149 @@ static void *process_wrapper(void *arg) {
         close(info->stderr_pipe[0]);
         
         // Set thread state to stopped
-        pthread_mutex_lock(&info->mutex);
-        info->state = THREAD_STOPPED;
-        pthread_mutex_unlock(&info->mutex);
+        finish_thread(info, THREAD_STOPPED);
     }
     
+    close_wake_fd(info);
     return NULL;
 }
 
+/**
+ * @brief Home bucket of a thread ID in the index
+ */
+static unsigned int index_bucket(unsigned int thread_id, unsigned int index_size) {
+    return (thread_id * 2654435761u) & (index_size - 1);
+}
+
+/**
+ * @brief Smallest power of two holding capacity threads at half load
+ */
+static unsigned int index_size_for(unsigned int capacity) {
+    unsigned int size = 16;
+    while (size < capacity * 2) {
+        size *= 2;
+    }
+    return size;
+}
+
+static void index_insert(thread_index_entry_t *index, unsigned int index_size,
+                         unsigned int thread_id, unsigned int slot) {
+    unsigned int i = index_bucket(thread_id, index_size);
+    while (index[i].id != 0) {
+        i = (i + 1) & (index_size - 1);
+    }
+    index[i].id = thread_id;
+    index[i].slot = slot;
+}
+
+/**
+ * @brief Remove a thread ID from the index
+ * 
+ * Later entries of the probe run are shifted back so lookups never need
+ * tombstones.
+ */
+static void index_remove(thread_manager_t *manager, unsigned int thread_id) {
+    unsigned int mask = manager->index_size - 1;
+    unsigned int i = index_bucket(thread_id, manager->index_size);
+    while (manager->index[i].id != thread_id) {
+        if (manager->index[i].id == 0) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    
+    unsigned int j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (manager->index[j].id == 0) {
+            break;
+        }
+        // Move the entry back unless its home bucket lies in (i, j]
+        unsigned int home = index_bucket(manager->index[j].id, manager->index_size);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            manager->index[i] = manager->index[j];
+            i = j;
+        }
+    }
+    manager->index[i].id = 0;
+}
+
+/**
+ * @brief Find the slot of a thread in the threads array
+ * 
+ * @return int Slot index, or -1 if no thread has this ID
+ */
+static int find_thread_slot(thread_manager_t *manager, unsigned int thread_id) {
+    if (thread_id == 0 || !manager->index) {
+        return -1;
+    }
+    unsigned int i = index_bucket(thread_id, manager->index_size);
+    while (manager->index[i].id != 0) {
+        if (manager->index[i].id == thread_id) {
+            return (int)manager->index[i].slot;
+        }
+        i = (i + 1) & (manager->index_size - 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief Free a thread information structure and everything it owns
+ */
+static void free_thread_info(thread_info_t *info) {
+    // Destroy mutex and condition variable
+    pthread_mutex_destroy(&info->mutex);
+    pthread_cond_destroy(&info->cond);
+    
+    // Free process-specific resources
+    if (info->type == THREAD_TYPE_PROCESS) {
+        // Close any open pipes
+        if (info->stdin_pipe[1] > 0) close(info->stdin_pipe[1]);
+        if (info->stdout_pipe[0] > 0) close(info->stdout_pipe[0]);
+        if (info->stderr_pipe[0] > 0) close(info->stderr_pipe[0]);
+        
+        // Free command and arguments
+        if (info->command) free(info->command);
+        
+        if (info->args) {
+            for (int j = 0; info->args[j] != NULL; j++) {
+                free(info->args[j]);
+            }
+            free(info->args);
+        }
+    }
+    
+    free(info);
+}
+
+/**
+ * @brief Free a thread information structure the manager no longer holds,
+ * or leave that to the last thread_check_pause still waiting on it
+ */
+static void release_thread_info(thread_info_t *info) {
+    pthread_mutex_lock(&info->mutex);
+    if (info->pause_waiters > 0) {
+        info->released = true;
+        pthread_cond_broadcast(&info->cond);
+        pthread_mutex_unlock(&info->mutex);
+        return;
+    }
+    pthread_mutex_unlock(&info->mutex);
+    free_thread_info(info);
+}
+
+/**
+ * @brief Free the thread and registration arrays and their indexes
+ */
+static void free_manager_arrays(thread_manager_t *manager) {
+    free(manager->threads);
+    free(manager->index);
+    free(manager->free_slots);
+    free(manager->registrations);
+    free(manager->attachment_index);
+    free(manager->free_registration_slots);
+}
+
 int thread_manager_init(thread_manager_t *manager, unsigned int initial_capacity) {
     if (!manager) {
         ERROR_LOG("Invalid manager pointer");
@@ -271,10 +643,18 @@ int thread_manager_init(thread_manager_t *manager, unsigned int initial_capacity
     manager->threads = NULL;
     manager->thread_count = 0;
     manager->capacity = 0;
+    manager->index = NULL;
+    manager->index_size = 0;
+    manager->free_slots = NULL;
+    manager->free_count = 0;
     manager->next_id = 0;
     manager->registrations = NULL;
     manager->registration_count = 0;
     manager->registration_capacity = 0;
+    manager->attachment_index = NULL;
+    manager->attachment_index_size = 0;
+    manager->free_registration_slots = NULL;
+    manager->free_registration_count = 0;
     
     if (initial_capacity == 0) {
         initial_capacity = INITIAL_CAPACITY;
@@ -287,24 +667,55 @@ int thread_manager_init(thread_manager_t *manager, unsigned int initial_capacity
         return -1;
     }
     
-    // Initialize registrations
+    // Initialize the ID index and the free slot stack, slot 0 on top
+    manager->index_size = index_size_for(initial_capacity);
+    manager->index = (thread_index_entry_t *)calloc(manager->index_size, sizeof(thread_index_entry_t));
+    manager->free_slots = (unsigned int *)malloc(initial_capacity * sizeof(unsigned int));
+    if (!manager->index || !manager->free_slots) {
+        ERROR_LOG("Failed to allocate memory for thread index");
+        free_manager_arrays(manager);
+        return -1;
+    }
+    for (unsigned int i = 0; i < initial_capacity; i++) {
+        manager->free_slots[i] = initial_capacity - 1 - i;
+    }
+    manager->free_count = initial_capacity;
+    
+    // Initialize registrations, their attachment index and free slot stack
     manager->registrations = (thread_registration_t **)calloc(initial_capacity, sizeof(thread_registration_t *));
-    if (!manager->registrations) {
+    manager->attachment_index_size = index_size_for(initial_capacity);
+    manager->attachment_index = (thread_attachment_index_entry_t *)calloc(manager->attachment_index_size,
+                                                                         sizeof(thread_attachment_index_entry_t));
+    manager->free_registration_slots = (unsigned int *)malloc(initial_capacity * sizeof(unsigned int));
+    if (!manager->registrations || !manager->attachment_index || !manager->free_registration_slots) {
         ERROR_LOG("Failed to allocate memory for thread registrations");
-        free(manager->threads);
+        free_manager_arrays(manager);
         return -1;
     }
+    for (unsigned int i = 0; i < initial_capacity; i++) {
+        manager->free_registration_slots[i] = initial_capacity - 1 - i;
+    }
+    manager->free_registration_count = initial_capacity;
     
     manager->thread_count = 0;
     manager->capacity = initial_capacity;
     manager->next_id = 1;  // Start with ID 1
     manager->registration_count = 0;
     manager->registration_capacity = initial_capacity;
+    manager->spawn_helper = NULL;
+    manager->process_io = NULL;
+    
+    // Readers start from an empty registry
+    if (thread_snapshot_init(manager) != 0) {
+        free_manager_arrays(manager);
+        return -1;
+    }
     
     // Initialize mutex
     if (pthread_mutex_init(&manager->mutex, NULL) != 0) {
         ERROR_LOG("Failed to initialize mutex");
-        free(manager->threads);
+        thread_snapshot_cleanup(manager);
+        free_manager_arrays(manager);
         return -1;
     }
     
@@ -312,6 +723,22 @@ int thread_manager_init(thread_manager_t *manager, unsigned int initial_capacity
     return 0;
 }
 
+int thread_manager_start_spawn_helper(thread_manager_t *manager) {
+    if (!manager) {
+        ERROR_LOG("Invalid manager pointer");
+        return -1;
+    }
+    
+    pthread_mutex_lock(&manager->mutex);
+    int result = 0;
+    if (!manager->spawn_helper) {
+        result = spawn_helper_start(&manager->spawn_helper);
+    }
+    pthread_mutex_unlock(&manager->mutex);
+    
+    return result;
+}
+
 int thread_manager_destroy(thread_manager_t *manager) {
     if (!manager) {
         ERROR_LOG("Invalid manager pointer");
@@ -328,37 +755,18 @@ int thread_manager_destroy(thread_manager_t *manager) {
             // Set thread to exit
             pthread_mutex_lock(&info->mutex);
             info->should_exit = true;
-            info->is_paused = false;
+            PAUSE_FLAG_SET(info, false);
             pthread_cond_signal(&info->cond);
+            wake_process_monitor(info);
             pthread_mutex_unlock(&info->mutex);
             
-            // Join thread
-            pthread_join(info->thread_id, NULL);
-            
-            // Destroy mutex and condition variable
-            pthread_mutex_destroy(&info->mutex);
-            pthread_cond_destroy(&info->cond);
-            
-            // Free process-specific resources
-            if (info->type == THREAD_TYPE_PROCESS) {
-                // Close any open pipes
-                if (info->stdin_pipe[1] > 0) close(info->stdin_pipe[1]);
-                if (info->stdout_pipe[0] > 0) close(info->stdout_pipe[0]);
-                if (info->stderr_pipe[0] > 0) close(info->stderr_pipe[0]);
-                
-                // Free command and arguments
-                if (info->command) free(info->command);
-                
-                if (info->args) {
-                    for (int j = 0; info->args[j] != NULL; j++) {
-                        free(info->args[j]);
-                    }
-                    free(info->args);
-                }
+            // Join thread unless thread_join already reaped it
+            if (!info->joined) {
+                pthread_join(info->thread_id, NULL);
             }
             
             // Free thread info
-            free(info);
+            release_thread_info(info);
             manager->threads[i] = NULL;
         }
     }
@@ -367,7 +775,6 @@ int thread_manager_destroy(thread_manager_t *manager) {
     for (unsigned int i = 0; i < manager->registration_capacity; i++) {
         thread_registration_t *reg = manager->registrations[i];
         if (reg) {
-            free(reg->attachment_arg);
             free(reg);
             manager->registrations[i] = NULL;
         }
@@ -375,23 +782,50 @@ int thread_manager_destroy(thread_manager_t *manager) {
     
     // Free arrays
     void* threads_ptr = manager->threads;
+    void* index_ptr = manager->index;
+    void* free_slots_ptr = manager->free_slots;
     void* registrations_ptr = manager->registrations;
+    void* attachment_index_ptr = manager->attachment_index;
+    void* free_registration_slots_ptr = manager->free_registration_slots;
+    spawn_helper_t *spawn_helper = manager->spawn_helper;
+    process_io_t *process_io = manager->process_io;
     
     // Reset manager structure WHILE HOLDING THE LOCK
     // This ensures any thread that wakes up after unlock will see threads == NULL
     manager->threads = NULL;
+    manager->index = NULL;
+    manager->free_slots = NULL;
     manager->registrations = NULL;
+    manager->attachment_index = NULL;
+    manager->free_registration_slots = NULL;
+    manager->spawn_helper = NULL;
+    manager->process_io = NULL;
     manager->thread_count = 0;
     manager->capacity = 0;
+    manager->index_size = 0;
+    manager->free_count = 0;
     manager->registration_count = 0;
     manager->registration_capacity = 0;
+    manager->attachment_index_size = 0;
+    manager->free_registration_count = 0;
+    
+    // Snapshots still held by readers stay valid until they release them
+    thread_snapshot_cleanup(manager);
     
     // Unlock mutex - after this point, any thread trying to lock will see threads == NULL
     pthread_mutex_unlock(&manager->mutex);
     
     // Now free the arrays (safe to do outside the lock since we've marked manager as invalid)
     free(threads_ptr);
+    free(index_ptr);
+    free(free_slots_ptr);
     free(registrations_ptr);
+    free(attachment_index_ptr);
+    free(free_registration_slots_ptr);
+    
+    // Every process it launched has been reaped by now
+    spawn_helper_stop(spawn_helper);
+    process_io_stop(process_io);
     
     // CRITICAL: Wait a short time to ensure any threads that passed the threads != NULL
     // check have either successfully locked the mutex (and will see threads == NULL) or
@@ -434,28 +868,73 @@ int thread_manager_destroy(thread_manager_t *manager) {
     return 0;
 }
 
+/**
+ * @brief Grow the threads array once every slot is taken
+ * 
+ * Released slots are reused first, so this only runs when more threads
+ * are alive at once than ever before.
+ */
 static int resize_thread_array(thread_manager_t *manager) {
     unsigned int new_capacity = manager->capacity * GROWTH_FACTOR;
-    thread_info_t **new_threads = (thread_info_t **)realloc(manager->threads, new_capacity * sizeof(thread_info_t *));
+    unsigned int new_index_size = index_size_for(new_capacity);
+    thread_index_entry_t *new_index = (thread_index_entry_t *)calloc(new_index_size, sizeof(thread_index_entry_t));
+    unsigned int *new_free_slots = (unsigned int *)realloc(manager->free_slots, new_capacity * sizeof(unsigned int));
+    if (new_free_slots) {
+        manager->free_slots = new_free_slots;
+    }
+    thread_info_t **new_threads = NULL;
+    if (new_index && new_free_slots) {
+        new_threads = (thread_info_t **)realloc(manager->threads, new_capacity * sizeof(thread_info_t *));
+    }
     
     if (!new_threads) {
         ERROR_LOG("Failed to resize thread array");
+        free(new_index);
         return -1;
     }
     
-    // Initialize new memory to NULL
+    // Initialize new memory to NULL and stack the new slots, lowest on top
     for (unsigned int i = manager->capacity; i < new_capacity; i++) {
         new_threads[i] = NULL;
     }
+    for (unsigned int i = new_capacity; i > manager->capacity; i--) {
+        manager->free_slots[manager->free_count++] = i - 1;
+    }
+    
+    // Rehash every thread into the larger index
+    for (unsigned int i = 0; i < manager->capacity; i++) {
+        if (new_threads[i]) {
+            index_insert(new_index, new_index_size, new_threads[i]->id, i);
+        }
+    }
+    free(manager->index);
     
     manager->threads = new_threads;
     manager->capacity = new_capacity;
+    manager->index = new_index;
+    manager->index_size = new_index_size;
     
     DEBUG_LOG("Thread array resized to capacity %u", new_capacity);
     return 0;
 }
 
+/**
+ * @brief Take a slot for a new thread and index it under its ID
+ */
+static void store_thread(thread_manager_t *manager, thread_info_t *info) {
+    unsigned int slot = manager->free_slots[--manager->free_count];
+    manager->threads[slot] = info;
+    index_insert(manager->index, manager->index_size, info->id, slot);
+    manager->thread_count++;
+    thread_snapshot_invalidate(manager);
+}
+
 int thread_create(thread_manager_t *manager, void *(*func)(void *), void *arg, unsigned int *thread_id) {
+    return thread_create_with_attr(manager, func, arg, NULL, thread_id);
+}
+
+int thread_create_with_attr(thread_manager_t *manager, void *(*func)(void *), void *arg,
+                            const thread_attr_t *attr, unsigned int *thread_id) {
     if (!manager || !func) {
         ERROR_LOG("Invalid parameters");
         return -1;
@@ -493,29 +972,14 @@ int thread_create(thread_manager_t *manager, void *(*func)(void *), void *arg, u
         return -1;
     }
     
-    // Check if we need to resize the thread array
-    if (manager->thread_count >= manager->capacity) {
+    // Grow the thread array only when no released slot is left
+    if (manager->free_count == 0) {
         if (resize_thread_array(manager) != 0) {
             pthread_mutex_unlock(&manager->mutex);
             return -1;
         }
     }
     
-    // Find an empty slot for the new thread
-    int slot = -1;
-    for (unsigned int i = 0; i < manager->capacity; i++) {
-        if (manager->threads[i] == NULL) {
-            slot = i;
-            break;
-        }
-    }
-    
-    if (slot == -1) {
-        ERROR_LOG("Failed to find empty slot for thread");
-        pthread_mutex_unlock(&manager->mutex);
-        return -1;
-    }
-    
     // Create thread info structure
     thread_info_t *info = (thread_info_t *)malloc(sizeof(thread_info_t));
     if (!info) {
@@ -533,6 +997,10 @@ int thread_create(thread_manager_t *manager, void *(*func)(void *), void *arg, u
     info->should_exit = false;
     info->is_paused = false;
     info->type = THREAD_TYPE_NORMAL;
+    info->owner = manager;
+    if (attr) {
+        info->attr = *attr;
+    }
     
     // Initialize mutex and condition variable
     if (pthread_mutex_init(&info->mutex, NULL) != 0) {
@@ -542,7 +1010,7 @@ int thread_create(thread_manager_t *manager, void *(*func)(void *), void *arg, u
         return -1;
     }
     
-    if (pthread_cond_init(&info->cond, NULL) != 0) {
+    if (init_thread_cond(&info->cond) != 0) {
         ERROR_LOG("Failed to initialize thread condition variable");
         pthread_mutex_destroy(&info->mutex);
         free(info);
@@ -561,8 +1029,7 @@ int thread_create(thread_manager_t *manager, void *(*func)(void *), void *arg, u
     }
     
     // Store thread info
-    manager->threads[slot] = info;
-    manager->thread_count++;
+    store_thread(manager, info);
     
     // Store thread ID for return
     if (thread_id) {
@@ -587,6 +1054,11 @@ int thread_create(thread_manager_t *manager, void *(*func)(void *), void *arg, u
  * @return int Thread ID on success, -1 on failure
  */
 int thread_create_process(thread_manager_t *manager, const char *command, char **args, unsigned int *thread_id) {
+    return thread_create_process_with_output(manager, command, args, NULL, NULL, thread_id);
+}
+
+int thread_create_process_with_output(thread_manager_t *manager, const char *command, char **args,
+                                      thread_output_cb_t on_output, void *user_data, unsigned int *thread_id) {
     if (!manager || !command || !args) {
         ERROR_LOG("Invalid parameters");
         return -1;
@@ -595,29 +1067,20 @@ int thread_create_process(thread_manager_t *manager, const char *command, char *
     // Lock manager mutex
     pthread_mutex_lock(&manager->mutex);
     
-    // Check if we need to resize the thread array
-    if (manager->thread_count >= manager->capacity) {
+    // The I/O thread starts with the first process that needs it
+    if (on_output && !manager->process_io && process_io_start(&manager->process_io) != 0) {
+        pthread_mutex_unlock(&manager->mutex);
+        return -1;
+    }
+    
+    // Grow the thread array only when no released slot is left
+    if (manager->free_count == 0) {
         if (resize_thread_array(manager) != 0) {
             pthread_mutex_unlock(&manager->mutex);
             return -1;
         }
     }
     
-    // Find an empty slot for the new thread
-    int slot = -1;
-    for (unsigned int i = 0; i < manager->capacity; i++) {
-        if (manager->threads[i] == NULL) {
-            slot = i;
-            break;
-        }
-    }
-    
-    if (slot == -1) {
-        ERROR_LOG("Failed to find empty slot for thread");
-        pthread_mutex_unlock(&manager->mutex);
-        return -1;
-    }
-    
     // Create thread info structure
     thread_info_t *info = (thread_info_t *)malloc(sizeof(thread_info_t));
     if (!info) {
@@ -635,7 +1098,10 @@ int thread_create_process(thread_manager_t *manager, const char *command, char *
     info->should_exit = false;
     info->is_paused = false;
     info->type = THREAD_TYPE_PROCESS;
+    info->owner = manager;
     info->exit_status = -1;
+    info->output_cb = on_output;
+    info->output_user_data = user_data;
     
     // Duplicate command string
     info->command = strdup(command);
@@ -698,7 +1164,7 @@ int thread_create_process(thread_manager_t *manager, const char *command, char *
         return -1;
     }
     
-    if (pthread_cond_init(&info->cond, NULL) != 0) {
+    if (init_thread_cond(&info->cond) != 0) {
         ERROR_LOG("Failed to initialize thread condition variable");
         
         // Free allocated memory
@@ -731,8 +1197,7 @@ int thread_create_process(thread_manager_t *manager, const char *command, char *
     }
     
     // Store thread info
-    manager->threads[slot] = info;
-    manager->thread_count++;
+    store_thread(manager, info);
     
     // Store thread ID for return
     if (thread_id) {
@@ -748,12 +1213,8 @@ int thread_create_process(thread_manager_t *manager, const char *command, char *
 }
 
 static thread_info_t *find_thread_by_id(thread_manager_t *manager, unsigned int thread_id) {
-    for (unsigned int i = 0; i < manager->capacity; i++) {
-        if (manager->threads[i] && manager->threads[i]->id == thread_id) {
-            return manager->threads[i];
-        }
-    }
-    return NULL;
+    int slot = find_thread_slot(manager, thread_id);
+    return slot >= 0 ? manager->threads[slot] : NULL;
 }
 
 int thread_stop(thread_manager_t *manager, unsigned int thread_id) {
@@ -778,8 +1239,9 @@ int thread_stop(thread_manager_t *manager, unsigned int thread_id) {
     // Set thread to exit
     pthread_mutex_lock(&info->mutex);
     info->should_exit = true;
-    info->is_paused = false;
+    PAUSE_FLAG_SET(info, false);
     pthread_cond_signal(&info->cond);
+    wake_process_monitor(info);
     pthread_mutex_unlock(&info->mutex);
     
     DEBUG_LOG("Thread %u set to stop", thread_id);
@@ -810,7 +1272,8 @@ int thread_pause(thread_manager_t *manager, unsigned int thread_id) {
     // Set thread to pause
     pthread_mutex_lock(&info->mutex);
     if (info->state == THREAD_RUNNING) {
-        info->is_paused = true;
+        PAUSE_FLAG_SET(info, true);
+        wake_process_monitor(info);
         DEBUG_LOG("Thread %u set to pause", thread_id);
     } else {
         DEBUG_LOG("Thread %u is not running, cannot pause", thread_id);
@@ -843,8 +1306,9 @@ int thread_resume(thread_manager_t *manager, unsigned int thread_id) {
     // Resume thread
     pthread_mutex_lock(&info->mutex);
     if (info->is_paused) {
-        info->is_paused = false;
+        PAUSE_FLAG_SET(info, false);
         pthread_cond_signal(&info->cond);
+        wake_process_monitor(info);
         DEBUG_LOG("Thread %u resumed", thread_id);
     } else {
         DEBUG_LOG("Thread %u is not paused, cannot resume", thread_id);
@@ -882,21 +1346,16 @@ int thread_restart(thread_manager_t *manager, unsigned int thread_id, void *new_
         // Stop the old thread
         pthread_mutex_lock(&old_info->mutex);
         old_info->should_exit = true;
-        old_info->is_paused = false;
+        PAUSE_FLAG_SET(old_info, false);
         pthread_cond_signal(&old_info->cond);
+        wake_process_monitor(old_info);
         pthread_mutex_unlock(&old_info->mutex);
         
         // Wait for thread to stop
         pthread_join(old_info->thread_id, NULL);
         
-        // Find the slot for the old thread
-        int slot = -1;
-        for (unsigned int i = 0; i < manager->capacity; i++) {
-            if (manager->threads[i] == old_info) {
-                slot = i;
-                break;
-            }
-        }
+        // The new thread keeps the ID, and with it the slot
+        int slot = find_thread_slot(manager, thread_id);
         
         if (slot == -1) {
             ERROR_LOG("Failed to find slot for thread %u", thread_id);
@@ -923,6 +1382,8 @@ int thread_restart(thread_manager_t *manager, unsigned int thread_id, void *new_
         new_info->should_exit = false;
         new_info->is_paused = false;
         new_info->type = THREAD_TYPE_NORMAL;
+        new_info->owner = manager;
+        new_info->attr = old_info->attr;
         
         // Initialize mutex and condition variable
         if (pthread_mutex_init(&new_info->mutex, NULL) != 0) {
@@ -932,7 +1393,7 @@ int thread_restart(thread_manager_t *manager, unsigned int thread_id, void *new_
             return -1;
         }
         
-        if (pthread_cond_init(&new_info->cond, NULL) != 0) {
+        if (init_thread_cond(&new_info->cond) != 0) {
             ERROR_LOG("Failed to initialize thread condition variable");
             pthread_mutex_destroy(&new_info->mutex);
             free(new_info);
@@ -957,6 +1418,7 @@ int thread_restart(thread_manager_t *manager, unsigned int thread_id, void *new_
         
         // Store new thread info
         manager->threads[slot] = new_info;
+        thread_snapshot_invalidate(manager);
         
         DEBUG_LOG("Thread %u restarted with new arguments", thread_id);
     } else if (old_info->type == THREAD_TYPE_PROCESS) {
@@ -974,21 +1436,16 @@ int thread_restart(thread_manager_t *manager, unsigned int thread_id, void *new_
         // Stop the old process
         pthread_mutex_lock(&old_info->mutex);
         old_info->should_exit = true;
-        old_info->is_paused = false;
+        PAUSE_FLAG_SET(old_info, false);
         pthread_cond_signal(&old_info->cond);
+        wake_process_monitor(old_info);
         pthread_mutex_unlock(&old_info->mutex);
         
         // Wait for thread to stop
         pthread_join(old_info->thread_id, NULL);
         
-        // Find the slot for the old thread
-        int slot = -1;
-        for (unsigned int i = 0; i < manager->capacity; i++) {
-            if (manager->threads[i] == old_info) {
-                slot = i;
-                break;
-            }
-        }
+        // The new thread keeps the ID, and with it the slot
+        int slot = find_thread_slot(manager, thread_id);
         
         if (slot == -1) {
             ERROR_LOG("Failed to find slot for process thread %u", thread_id);
@@ -1013,7 +1470,10 @@ int thread_restart(thread_manager_t *manager, unsigned int thread_id, void *new_
         new_info->should_exit = false;
         new_info->is_paused = false;
         new_info->type = THREAD_TYPE_PROCESS;
+        new_info->owner = manager;
         new_info->exit_status = -1;
+        new_info->output_cb = old_info->output_cb;
+        new_info->output_user_data = old_info->output_user_data;
         
         // Duplicate command string
         new_info->command = strdup(command);
@@ -1076,7 +1536,7 @@ int thread_restart(thread_manager_t *manager, unsigned int thread_id, void *new_
             return -1;
         }
         
-        if (pthread_cond_init(&new_info->cond, NULL) != 0) {
+        if (init_thread_cond(&new_info->cond) != 0) {
             ERROR_LOG("Failed to initialize thread condition variable");
             
             // Free allocated memory
@@ -1130,6 +1590,7 @@ int thread_restart(thread_manager_t *manager, unsigned int thread_id, void *new_
         
         // Store new thread info
         manager->threads[slot] = new_info;
+        thread_snapshot_invalidate(manager);
         
         DEBUG_LOG("Process thread %u restarted with command '%s'", thread_id, command);
     } else {
@@ -1216,6 +1677,8 @@ int thread_get_info(thread_manager_t *manager, unsigned int thread_id, thread_in
     info->id = thread_info->id;
     info->should_exit = thread_info->should_exit;
     info->is_paused = thread_info->is_paused;
+    info->type = thread_info->type;
+    info->attr = thread_info->attr;
     pthread_mutex_unlock(&thread_info->mutex);
     
     // Unlock manager mutex
@@ -1252,6 +1715,18 @@ bool thread_is_alive(thread_manager_t *manager, unsigned int thread_id) {
     return alive;
 }
 
+/**
+ * @brief Record that a thread has been reaped so it is never joined twice
+ */
+static void mark_joined(thread_manager_t *manager, unsigned int thread_id) {
+    pthread_mutex_lock(&manager->mutex);
+    thread_info_t *info = find_thread_by_id(manager, thread_id);
+    if (info) {
+        info->joined = true;
+    }
+    pthread_mutex_unlock(&manager->mutex);
+}
+
 int thread_join(thread_manager_t *manager, unsigned int thread_id, void **result) {
     if (!manager) {
         ERROR_LOG("Invalid manager pointer");
@@ -1269,6 +1744,12 @@ int thread_join(thread_manager_t *manager, unsigned int thread_id, void **result
         return -1;
     }
     
+    // A thread can only be reaped once
+    if (info->joined) {
+        pthread_mutex_unlock(&manager->mutex);
+        return 0;
+    }
+    
     // Handle differently based on thread type
     if (info->type == THREAD_TYPE_NORMAL) {
         // Get thread ID
@@ -1282,6 +1763,7 @@ int thread_join(thread_manager_t *manager, unsigned int thread_id, void **result
             ERROR_LOG("Failed to join thread %u", thread_id);
             return -1;
         }
+        mark_joined(manager, thread_id);
     } else if (info->type == THREAD_TYPE_PROCESS) {
         // For processes, we just wait for the thread monitoring the process to complete
         pthread_t thread_to_join = info->thread_id;
@@ -1295,6 +1777,7 @@ int thread_join(thread_manager_t *manager, unsigned int thread_id, void **result
             ERROR_LOG("Failed to join process thread %u", thread_id);
             return -1;
         }
+        mark_joined(manager, thread_id);
         
         // Set exit status as result if requested
         if (result) {
@@ -1310,6 +1793,112 @@ int thread_join(thread_manager_t *manager, unsigned int thread_id, void **result
     return 0;
 }
 
+int thread_join_timeout(thread_manager_t *manager, unsigned int thread_id, unsigned int timeout_ms, void **result) {
+    if (!manager) {
+        ERROR_LOG("Invalid manager pointer");
+        return -1;
+    }
+    
+    // Lock manager mutex
+    pthread_mutex_lock(&manager->mutex);
+    
+    // Find thread info
+    thread_info_t *info = find_thread_by_id(manager, thread_id);
+    
+    // Unlock manager mutex before waiting
+    pthread_mutex_unlock(&manager->mutex);
+    if (!info) {
+        ERROR_LOG("Thread with ID %u not found", thread_id);
+        return -1;
+    }
+    
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    
+    // Sleep until the thread reaches a final state; finish_thread wakes us
+    pthread_mutex_lock(&info->mutex);
+    bool finished = false;
+    for (;;) {
+        finished = (info->state == THREAD_STOPPED || info->state == THREAD_ERROR);
+        if (finished || pthread_cond_timedwait(&info->cond, &info->mutex, &deadline) == ETIMEDOUT) {
+            finished = (info->state == THREAD_STOPPED || info->state == THREAD_ERROR);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&info->mutex);
+    
+    if (!finished) {
+        DEBUG_LOG("Thread %u still running after %u ms", thread_id, timeout_ms);
+        return 1;
+    }
+    
+    // The thread is on its way out, so this join returns promptly
+    return thread_join(manager, thread_id, result);
+}
+
+int thread_release(thread_manager_t *manager, unsigned int thread_id) {
+    if (!manager) {
+        ERROR_LOG("Invalid manager pointer");
+        return -1;
+    }
+    
+    // Lock manager mutex
+    pthread_mutex_lock(&manager->mutex);
+    
+    // Find thread info
+    int slot = find_thread_slot(manager, thread_id);
+    if (slot < 0) {
+        ERROR_LOG("Thread with ID %u not found", thread_id);
+        pthread_mutex_unlock(&manager->mutex);
+        return -1;
+    }
+    thread_info_t *info = manager->threads[slot];
+    
+    // Refuse threads that are still running
+    pthread_mutex_lock(&info->mutex);
+    bool finished = (info->state == THREAD_STOPPED || info->state == THREAD_ERROR);
+    pthread_mutex_unlock(&info->mutex);
+    if (!finished) {
+        ERROR_LOG("Thread %u is still running and cannot be released", thread_id);
+        pthread_mutex_unlock(&manager->mutex);
+        return -1;
+    }
+    
+    // The thread has returned, so this join does not block
+    if (!info->joined) {
+        pthread_join(info->thread_id, NULL);
+    }
+    
+    // Forget the ID and hand the slot to the next thread
+    index_remove(manager, thread_id);
+    manager->threads[slot] = NULL;
+    manager->free_slots[manager->free_count++] = (unsigned int)slot;
+    manager->thread_count--;
+    thread_snapshot_invalidate(manager);
+    
+    // Drop attachments that still point at the released thread
+    for (unsigned int i = 0; i < manager->registration_capacity; i++) {
+        thread_registration_t *reg = manager->registrations[i];
+        if (reg && reg->thread_id == thread_id) {
+            remove_registration(manager, i);
+        }
+    }
+    
+    // Unlock manager mutex
+    pthread_mutex_unlock(&manager->mutex);
+    
+    release_thread_info(info);
+    
+    DEBUG_LOG("Thread %u released", thread_id);
+    return 0;
+}
+
 int thread_get_all_ids(thread_manager_t *manager, unsigned int *ids, unsigned int size) {
     if (!manager || !ids || size == 0) {
         ERROR_LOG("Invalid parameters");
@@ -1361,12 +1950,14 @@ int thread_should_exit(thread_manager_t *manager, unsigned int thread_id) {
     return should_exit;
 }
 
-void thread_check_pause(thread_manager_t *manager, unsigned int thread_id) {
-    if (!manager) {
-        ERROR_LOG("Invalid manager pointer");
-        return;
+int thread_get_stats(thread_manager_t *manager, unsigned int thread_id, thread_stats_t *stats) {
+    if (!manager || !stats) {
+        ERROR_LOG("Invalid parameters");
+        return -1;
     }
     
+    memset(stats, 0, sizeof(*stats));
+    
     // Lock manager mutex
     pthread_mutex_lock(&manager->mutex);
     
@@ -1375,20 +1966,98 @@ void thread_check_pause(thread_manager_t *manager, unsigned int thread_id) {
     if (!info) {
         ERROR_LOG("Thread with ID %u not found", thread_id);
         pthread_mutex_unlock(&manager->mutex);
-        return;
+        return -1;
     }
     
-    // Check if thread is paused
     pthread_mutex_lock(&info->mutex);
-    while (info->is_paused && !info->should_exit) {
-        info->state = THREAD_PAUSED;
-        pthread_cond_wait(&info->cond, &info->mutex);
+    stats->id = info->id;
+    stats->state = info->state;
+    stats->type = info->type;
+    memcpy(stats->name, info->attr.name, sizeof(stats->name));
+    stats->tid = info->tid;
+    stats->iterations = __atomic_load_n(&info->iterations, __ATOMIC_RELAXED);
+    stats->last_activity_ms = __atomic_load_n(&info->last_activity_ms, __ATOMIC_RELAXED);
+    
+    if (info->type == THREAD_TYPE_NORMAL) {
+        if (info->state == THREAD_STOPPED || info->state == THREAD_ERROR) {
+            stats->cpu_time_ns = info->cpu_time_ns;
+            stats->voluntary_switches = info->voluntary_switches;
+            stats->involuntary_switches = info->involuntary_switches;
+        } else if (info->tid != 0) {
+            // Still running: it cannot finish while we hold its mutex
+            clockid_t clock;
+            struct timespec cpu;
+            if (pthread_getcpuclockid(info->thread_id, &clock) == 0 && clock_gettime(clock, &cpu) == 0) {
+                stats->cpu_time_ns = (unsigned long long)cpu.tv_sec * 1000000000ULL + (unsigned long long)cpu.tv_nsec;
+            }
+            read_context_switches(info->tid, &stats->voluntary_switches, &stats->involuntary_switches);
+        }
     }
-    info->state = THREAD_RUNNING;
     pthread_mutex_unlock(&info->mutex);
     
     // Unlock manager mutex
     pthread_mutex_unlock(&manager->mutex);
+    
+    return 0;
+}
+
+void thread_heartbeat(void) {
+    thread_info_t *info = current_thread_info;
+    if (info) {
+        __atomic_add_fetch(&info->iterations, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&info->last_activity_ms, realtime_ms(), __ATOMIC_RELAXED);
+    }
+}
+
+void thread_check_pause(thread_manager_t *manager, unsigned int thread_id) {
+    if (!manager) {
+        ERROR_LOG("Invalid manager pointer");
+        return;
+    }
+    
+    // A thread checking itself needs no lookup, and its info outlives the call
+    thread_info_t *info = current_thread_info;
+    bool self = info && info->owner == manager && info->id == thread_id;
+    if (self) {
+        if (!PAUSE_FLAG_GET(info)) {
+            return;
+        }
+        pthread_mutex_lock(&info->mutex);
+    } else {
+        // Another thread's info: counted as waited on before the manager
+        // mutex goes, so a release meanwhile leaves freeing it to us. The
+        // manager mutex is not held while sleeping, or thread_resume could
+        // not get in.
+        pthread_mutex_lock(&manager->mutex);
+        info = find_thread_by_id(manager, thread_id);
+        if (!info) {
+            pthread_mutex_unlock(&manager->mutex);
+            ERROR_LOG("Thread with ID %u not found", thread_id);
+            return;
+        }
+        pthread_mutex_lock(&info->mutex);
+        info->pause_waiters++;
+        pthread_mutex_unlock(&manager->mutex);
+    }
+    
+    // Check if thread is paused
+    while (info->is_paused && !info->should_exit && !info->released) {
+        set_thread_state(info, THREAD_PAUSED);
+        pthread_cond_wait(&info->cond, &info->mutex);
+    }
+    if (!info->released) {
+        set_thread_state(info, THREAD_RUNNING);
+    }
+    
+    bool free_info = false;
+    if (!self) {
+        info->pause_waiters--;
+        free_info = info->released && info->pause_waiters == 0;
+    }
+    pthread_mutex_unlock(&info->mutex);
+    if (free_info) {
+        free_thread_info(info);
+    }
 }
 
 /**
@@ -1591,25 +2260,119 @@ int thread_get_exit_status(thread_manager_t *manager, unsigned int thread_id, in
 // Thread Registration Functions Implementation
 
 /**
- * @brief Resize registration array when needed
+ * @brief FNV-1a hash of an attachment identifier
+ */
+static unsigned int attachment_hash(const char *attachment_arg) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *)attachment_arg; *c; c++) {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Home bucket of an attachment hash in the index
+ */
+static unsigned int attachment_bucket(unsigned int hash, unsigned int index_size) {
+    return (hash * 2654435761u) & (index_size - 1);
+}
+
+static void attachment_index_insert(thread_attachment_index_entry_t *index, unsigned int index_size,
+                                    unsigned int hash, unsigned int slot) {
+    unsigned int i = attachment_bucket(hash, index_size);
+    while (index[i].slot != 0) {
+        i = (i + 1) & (index_size - 1);
+    }
+    index[i].hash = hash;
+    index[i].slot = slot + 1;
+}
+
+/**
+ * @brief Find the index bucket of an attachment identifier
+ * 
+ * @return int Bucket, or -1 if it is not registered
+ */
+static int attachment_index_find(thread_manager_t *manager, const char *attachment_arg, unsigned int hash) {
+    if (!manager->attachment_index) {
+        return -1;
+    }
+    unsigned int i = attachment_bucket(hash, manager->attachment_index_size);
+    while (manager->attachment_index[i].slot != 0) {
+        const thread_attachment_index_entry_t *entry = &manager->attachment_index[i];
+        if (entry->hash == hash && strcmp(manager->registrations[entry->slot - 1]->attachment_arg, attachment_arg) == 0) {
+            return (int)i;
+        }
+        i = (i + 1) & (manager->attachment_index_size - 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief Empty an attachment index bucket, shifting its probe run back as index_remove does
+ */
+static void attachment_index_remove_at(thread_manager_t *manager, unsigned int i) {
+    unsigned int mask = manager->attachment_index_size - 1;
+    unsigned int j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (manager->attachment_index[j].slot == 0) {
+            break;
+        }
+        unsigned int home = attachment_bucket(manager->attachment_index[j].hash, manager->attachment_index_size);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            manager->attachment_index[i] = manager->attachment_index[j];
+            i = j;
+        }
+    }
+    manager->attachment_index[i].slot = 0;
+}
+
+/**
+ * @brief Grow the registrations array, its index and free slot stack once every slot is taken
  */
 static int resize_registration_array(thread_manager_t *manager) {
     unsigned int new_capacity = manager->registration_capacity * GROWTH_FACTOR;
-    thread_registration_t **new_registrations = (thread_registration_t **)realloc(
-        manager->registrations, new_capacity * sizeof(thread_registration_t *));
+    unsigned int new_index_size = index_size_for(new_capacity);
+    thread_attachment_index_entry_t *new_index = (thread_attachment_index_entry_t *)calloc(
+        new_index_size, sizeof(thread_attachment_index_entry_t));
+    unsigned int *new_free_slots = (unsigned int *)realloc(manager->free_registration_slots,
+                                                           new_capacity * sizeof(unsigned int));
+    if (new_free_slots) {
+        manager->free_registration_slots = new_free_slots;
+    }
+    thread_registration_t **new_registrations = NULL;
+    if (new_index && new_free_slots) {
+        new_registrations = (thread_registration_t **)realloc(
+            manager->registrations, new_capacity * sizeof(thread_registration_t *));
+    }
     
     if (!new_registrations) {
         ERROR_LOG("Failed to resize registration array");
+        free(new_index);
         return -1;
     }
     
-    // Initialize new memory to NULL
+    // Initialize new memory to NULL and stack the new slots, lowest on top
     for (unsigned int i = manager->registration_capacity; i < new_capacity; i++) {
         new_registrations[i] = NULL;
     }
+    for (unsigned int i = new_capacity; i > manager->registration_capacity; i--) {
+        manager->free_registration_slots[manager->free_registration_count++] = i - 1;
+    }
+    
+    // Move every entry into the larger index; the hashes are kept, not recomputed
+    for (unsigned int i = 0; i < manager->attachment_index_size; i++) {
+        const thread_attachment_index_entry_t *entry = &manager->attachment_index[i];
+        if (entry->slot != 0) {
+            attachment_index_insert(new_index, new_index_size, entry->hash, entry->slot - 1);
+        }
+    }
+    free(manager->attachment_index);
     
     manager->registrations = new_registrations;
     manager->registration_capacity = new_capacity;
+    manager->attachment_index = new_index;
+    manager->attachment_index_size = new_index_size;
     
     DEBUG_LOG("Registration array resized to capacity %u", new_capacity);
     return 0;
@@ -1619,25 +2382,24 @@ static int resize_registration_array(thread_manager_t *manager) {
  * @brief Find registration by attachment identifier
  */
 static thread_registration_t *find_registration_by_attachment(thread_manager_t *manager, const char *attachment_arg) {
-    for (unsigned int i = 0; i < manager->registration_capacity; i++) {
-        thread_registration_t *reg = manager->registrations[i];
-        if (reg && reg->attachment_arg && strcmp(reg->attachment_arg, attachment_arg) == 0) {
-            return reg;
-        }
-    }
-    return NULL;
+    int bucket = attachment_index_find(manager, attachment_arg, attachment_hash(attachment_arg));
+    return bucket < 0 ? NULL : manager->registrations[manager->attachment_index[bucket].slot - 1];
 }
 
 /**
- * @brief Find empty slot in registration array
+ * @brief Forget the registration in a slot and hand the slot to the next one
  */
-static int find_empty_registration_slot(thread_manager_t *manager) {
-    for (unsigned int i = 0; i < manager->registration_capacity; i++) {
-        if (manager->registrations[i] == NULL) {
-            return (int)i;
-        }
-    }
-    return -1;
+static void remove_registration(thread_manager_t *manager, unsigned int slot) {
+    thread_registration_t *reg = manager->registrations[slot];
+    int bucket = attachment_index_find(manager, reg->attachment_arg, attachment_hash(reg->attachment_arg));
+    if (bucket >= 0) {
+        attachment_index_remove_at(manager, (unsigned int)bucket);
+    }
+    free(reg);
+    manager->registrations[slot] = NULL;
+    manager->free_registration_slots[manager->free_registration_count++] = slot;
+    manager->registration_count--;
+    thread_snapshot_invalidate(manager);
 }
 
 int thread_register(thread_manager_t *manager, unsigned int thread_id, const char *attachment_arg) {
@@ -1658,47 +2420,37 @@ int thread_register(thread_manager_t *manager, unsigned int thread_id, const cha
     }
     
     // Check if attachment already exists
-    if (find_registration_by_attachment(manager, attachment_arg) != NULL) {
+    unsigned int hash = attachment_hash(attachment_arg);
+    if (attachment_index_find(manager, attachment_arg, hash) >= 0) {
         ERROR_LOG("Attachment ID already registered", attachment_arg);
         pthread_mutex_unlock(&manager->mutex);
         return -1;
     }
     
     // Check if we need to resize registration array
-    if (manager->registration_count >= manager->registration_capacity) {
+    if (manager->free_registration_count == 0) {
         if (resize_registration_array(manager) != 0) {
             pthread_mutex_unlock(&manager->mutex);
             return -1;
         }
     }
     
-    // Find empty slot
-    int slot = find_empty_registration_slot(manager);
-    if (slot < 0) {
-        ERROR_LOG("No empty slot found for registration");
-        pthread_mutex_unlock(&manager->mutex);
-        return -1;
-    }
-    
-    // Create new registration
-    thread_registration_t *reg = (thread_registration_t *)malloc(sizeof(thread_registration_t));
+    // Create new registration, the identifier stored right behind it
+    size_t length = strlen(attachment_arg) + 1;
+    thread_registration_t *reg = (thread_registration_t *)malloc(sizeof(thread_registration_t) + length);
     if (!reg) {
         ERROR_LOG("Failed to allocate memory for registration");
         pthread_mutex_unlock(&manager->mutex);
         return -1;
     }
-    
-    reg->attachment_arg = strdup(attachment_arg);
-    if (!reg->attachment_arg) {
-        ERROR_LOG("Failed to duplicate attachment string");
-        free(reg);
-        pthread_mutex_unlock(&manager->mutex);
-        return -1;
-    }
-    
+    reg->attachment_arg = memcpy(reg + 1, attachment_arg, length);
     reg->thread_id = thread_id;
+    
+    unsigned int slot = manager->free_registration_slots[--manager->free_registration_count];
     manager->registrations[slot] = reg;
+    attachment_index_insert(manager->attachment_index, manager->attachment_index_size, hash, slot);
     manager->registration_count++;
+    thread_snapshot_invalidate(manager);
     
     DEBUG_LOG("Thread %u registered with attachment ID", thread_id);
     
@@ -1715,24 +2467,19 @@ int thread_unregister(thread_manager_t *manager, const char *attachment_arg) {
     pthread_mutex_lock(&manager->mutex);
     
     // Find registration
-    for (unsigned int i = 0; i < manager->registration_capacity; i++) {
-        thread_registration_t *reg = manager->registrations[i];
-        if (reg && reg->attachment_arg && strcmp(reg->attachment_arg, attachment_arg) == 0) {
-            // Free registration
-            free(reg->attachment_arg);
-            free(reg);
-            manager->registrations[i] = NULL;
-            manager->registration_count--;
-            
-            DEBUG_LOG("Unregistered attachment ID");
-            pthread_mutex_unlock(&manager->mutex);
-            return 0;
-        }
+    int bucket = attachment_index_find(manager, attachment_arg, attachment_hash(attachment_arg));
+    if (bucket < 0) {
+        ERROR_LOG("Attachment ID not found");
+        pthread_mutex_unlock(&manager->mutex);
+        return -1;
     }
     
-    ERROR_LOG("Attachment ID not found");
+    // Free registration
+    remove_registration(manager, manager->attachment_index[bucket].slot - 1);
+    
+    DEBUG_LOG("Unregistered attachment ID");
     pthread_mutex_unlock(&manager->mutex);
-    return -1;
+    return 0;
 }
 
 int thread_find_by_attachment(thread_manager_t *manager, const char *attachment_arg, unsigned int *thread_id) {
@@ -1805,8 +2552,8 @@ int thread_kill_by_attachment(thread_manager_t *manager, const char *attachment_
     // Set thread to stopped state
     pthread_mutex_lock(&info->mutex);
     info->should_exit = true;
-    info->state = THREAD_STOPPED;
-    pthread_cond_signal(&info->cond);
+    set_thread_state(info, THREAD_STOPPED);
+    pthread_cond_broadcast(&info->cond);
     pthread_mutex_unlock(&info->mutex);
     
     pthread_mutex_unlock(&manager->mutex);
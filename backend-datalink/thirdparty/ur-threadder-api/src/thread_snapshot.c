@@ -0,0 +1,202 @@
+/**
+ * @file thread_snapshot.c
+ * @brief Lock-free copies of the thread registry for readers
+ *
+ * The manager points at an immutable snapshot that readers pick up with
+ * atomic operations only. A snapshot is freed when its last holder lets
+ * go: the manager holds one reference while it is current, and each reader
+ * one until it releases it. A reader that has loaded the pointer but not
+ * yet taken its reference is counted in snapshot_readers, so a replaced
+ * snapshot is only unreferenced by the manager once that count has been
+ * seen at zero after the swap.
+ */
+
+#include "thread_snapshot.h"
+#include "../include/utils.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Round a size up to what the next member needs
+ */
+static size_t align_size(size_t size) {
+    const size_t alignment = sizeof(void *) > sizeof(unsigned long long) ? sizeof(void *) : sizeof(unsigned long long);
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @brief Copy the registry into one allocation
+ *
+ * Caller holds the manager lock.
+ */
+static thread_snapshot_t *snapshot_build(const thread_manager_t *manager) {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < manager->capacity; i++) {
+        if (manager->threads[i]) count++;
+    }
+    unsigned int registration_count = 0;
+    size_t strings_size = 0;
+    for (unsigned int i = 0; i < manager->registration_capacity; i++) {
+        const thread_registration_t *reg = manager->registrations[i];
+        if (reg) {
+            registration_count++;
+            strings_size += strlen(reg->attachment_arg) + 1;
+        }
+    }
+
+    size_t entries_offset = align_size(sizeof(thread_snapshot_t));
+    size_t registrations_offset = entries_offset + align_size(count * sizeof(thread_snapshot_entry_t));
+    size_t strings_offset = registrations_offset + align_size(registration_count * sizeof(thread_registration_t));
+    char *memory = (char *)malloc(strings_offset + strings_size);
+    if (!memory) {
+        ERROR_LOG("Failed to allocate memory for thread snapshot");
+        return NULL;
+    }
+
+    thread_snapshot_t *snapshot = (thread_snapshot_t *)memory;
+    thread_snapshot_entry_t *entries = (thread_snapshot_entry_t *)(memory + entries_offset);
+    thread_registration_t *registrations = (thread_registration_t *)(memory + registrations_offset);
+    char *strings = memory + strings_offset;
+
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < manager->capacity; i++) {
+        thread_info_t *info = manager->threads[i];
+        if (!info) continue;
+        thread_snapshot_entry_t *entry = &entries[n++];
+        entry->id = info->id;
+        entry->type = info->type;
+        memcpy(entry->name, info->attr.name, THREAD_NAME_MAX);
+        entry->name[THREAD_NAME_MAX - 1] = '\0';
+        // The thread itself updates these, under its own mutex
+        pthread_mutex_lock(&info->mutex);
+        entry->state = info->state;
+        entry->tid = info->tid;
+        entry->process_id = info->type == THREAD_TYPE_PROCESS ? info->process_id : 0;
+        pthread_mutex_unlock(&info->mutex);
+    }
+
+    n = 0;
+    for (unsigned int i = 0; i < manager->registration_capacity; i++) {
+        const thread_registration_t *reg = manager->registrations[i];
+        if (!reg) continue;
+        size_t length = strlen(reg->attachment_arg) + 1;
+        memcpy(strings, reg->attachment_arg, length);
+        registrations[n].attachment_arg = strings;
+        registrations[n].thread_id = reg->thread_id;
+        strings += length;
+        n++;
+    }
+
+    snapshot->version = 0;
+    snapshot->count = count;
+    snapshot->entries = entries;
+    snapshot->registration_count = registration_count;
+    snapshot->registrations = registrations;
+    snapshot->refs = 1;
+    snapshot->next_retired = NULL;
+    return snapshot;
+}
+
+/**
+ * @brief Drop the manager's reference to replaced snapshots no reader can still be picking up
+ *
+ * Caller holds the manager lock.
+ */
+static void snapshot_reclaim(thread_manager_t *manager) {
+    if (__atomic_load_n(&manager->snapshot_readers, __ATOMIC_SEQ_CST) != 0) {
+        return;     // Retried on the next copy
+    }
+    thread_snapshot_t *retired = manager->retired_snapshots;
+    manager->retired_snapshots = NULL;
+    while (retired) {
+        thread_snapshot_t *next = retired->next_retired;
+        thread_snapshot_release(retired);
+        retired = next;
+    }
+}
+
+/**
+ * @brief Replace the current snapshot with a fresh copy
+ *
+ * Caller holds the manager lock.
+ */
+static void snapshot_publish(thread_manager_t *manager) {
+    // Cleared first, so a change made while copying is caught by the next reader
+    __atomic_store_n(&manager->snapshot_stale, false, __ATOMIC_SEQ_CST);
+    thread_snapshot_t *fresh = snapshot_build(manager);
+    if (!fresh) {
+        thread_snapshot_invalidate(manager);
+        return;
+    }
+
+    thread_snapshot_t *current = manager->snapshot;
+    fresh->version = current ? current->version + 1 : 1;
+    __atomic_store_n(&manager->snapshot, fresh, __ATOMIC_SEQ_CST);
+    if (current) {
+        current->next_retired = manager->retired_snapshots;
+        manager->retired_snapshots = current;
+    }
+    snapshot_reclaim(manager);
+}
+
+int thread_snapshot_init(thread_manager_t *manager) {
+    manager->snapshot = NULL;
+    manager->retired_snapshots = NULL;
+    manager->snapshot_readers = 0;
+    manager->snapshot_stale = false;
+
+    manager->snapshot = snapshot_build(manager);
+    return manager->snapshot ? 0 : -1;
+}
+
+void thread_snapshot_cleanup(thread_manager_t *manager) {
+    thread_snapshot_t *current = manager->snapshot;
+    __atomic_store_n(&manager->snapshot, NULL, __ATOMIC_SEQ_CST);
+    thread_snapshot_release(current);
+
+    thread_snapshot_t *retired = manager->retired_snapshots;
+    manager->retired_snapshots = NULL;
+    while (retired) {
+        thread_snapshot_t *next = retired->next_retired;
+        thread_snapshot_release(retired);
+        retired = next;
+    }
+}
+
+const thread_snapshot_t *thread_snapshot_acquire(thread_manager_t *manager) {
+    if (!manager) {
+        ERROR_LOG("Invalid manager pointer");
+        return NULL;
+    }
+
+    // Refresh if the registry changed, unless that would mean waiting
+    if (__atomic_load_n(&manager->snapshot_stale, __ATOMIC_ACQUIRE) &&
+        pthread_mutex_trylock(&manager->mutex) == 0) {
+        if (manager->threads && __atomic_load_n(&manager->snapshot_stale, __ATOMIC_ACQUIRE)) {
+            snapshot_publish(manager);
+        }
+        pthread_mutex_unlock(&manager->mutex);
+    }
+
+    __atomic_add_fetch(&manager->snapshot_readers, 1, __ATOMIC_SEQ_CST);
+    thread_snapshot_t *snapshot = __atomic_load_n(&manager->snapshot, __ATOMIC_SEQ_CST);
+    if (snapshot) {
+        __atomic_add_fetch(&snapshot->refs, 1, __ATOMIC_SEQ_CST);
+    }
+    __atomic_sub_fetch(&manager->snapshot_readers, 1, __ATOMIC_SEQ_CST);
+
+    return snapshot;
+}
+
+void thread_snapshot_release(const thread_snapshot_t *snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    thread_snapshot_t *owned = (thread_snapshot_t *)snapshot;
+    if (__atomic_sub_fetch(&owned->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(owned);
+    }
+}
@@ -0,0 +1,39 @@
+/**
+ * @file thread_snapshot.h
+ * @brief Lock-free copies of the thread registry for readers (internal)
+ */
+
+#ifndef THREAD_SNAPSHOT_H
+#define THREAD_SNAPSHOT_H
+
+#include "../include/thread_manager.h"
+
+/**
+ * @brief Note that the registry changed, so the next reader copies it again
+ *
+ * Cheap enough for any path: it only sets a flag, and takes no lock.
+ *
+ * @param manager Thread manager
+ */
+static inline void thread_snapshot_invalidate(thread_manager_t *manager) {
+    __atomic_store_n(&manager->snapshot_stale, true, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Set up an empty snapshot for a new manager
+ *
+ * @param manager Thread manager
+ * @return int 0 on success, -1 on failure
+ */
+int thread_snapshot_init(thread_manager_t *manager);
+
+/**
+ * @brief Drop the manager's references; readers keep theirs
+ *
+ * Called with the manager lock held, once no reader can reach the manager.
+ *
+ * @param manager Thread manager
+ */
+void thread_snapshot_cleanup(thread_manager_t *manager);
+
+#endif /* THREAD_SNAPSHOT_H */
@@ -0,0 +1,286 @@
+/**
+ * @file ur_trace.hpp
+ * @brief Scoped trace spans recorded into per-thread ring buffers and
+ *        dumped as Chrome trace-event JSON
+ *
+ * Header-only, shared by backend-datalink and frontendpp. A span costs one
+ * relaxed load while tracing is off; while on, two clock reads and a few
+ * relaxed stores into the calling thread's ring, with no locks and no
+ * allocation. Each ring keeps the most recent events of its thread and is
+ * read by dumpChromeJson() without stopping the writers: a slot that is
+ * being rewritten during the dump is skipped.
+ *
+ * Define UR_TRACE_DISABLED to compile UR_TRACE_SPAN out entirely.
+ * Span names must be string literals (or otherwise live forever).
+ */
+
+#ifndef UR_TRACE_HPP
+#define UR_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace UrTrace {
+
+namespace detail {
+
+inline std::atomic<bool> g_enabled{false};
+
+inline int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Seqlock slot: sequence is 0 while being written and index + 1 after
+struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> duration_ns{0};
+    std::atomic<int32_t> tid{0};
+};
+
+// Written only by the thread that holds it; handed to another thread after
+// its owner exits, keeping the events already recorded
+class ThreadBuffer {
+public:
+    explicit ThreadBuffer(size_t capacity) : slots_(new Slot[capacity]), capacity_(capacity) {}
+
+    void record(const char* name, int64_t start_ns, int64_t duration_ns) {
+        uint64_t index = head_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[index % capacity_];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start_ns.store(start_ns, std::memory_order_relaxed);
+        slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+        slot.tid.store(tid, std::memory_order_relaxed);
+        slot.sequence.store(index + 1, std::memory_order_release);
+        head_.store(index + 1, std::memory_order_release);
+    }
+
+    struct Event {
+        const char* name;
+        int64_t start_ns;
+        int64_t duration_ns;
+        int32_t tid;
+    };
+
+    // Consistent copies of the events still in the ring
+    void collect(std::vector<Event>& events) const {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t first = head > capacity_ ? head - capacity_ : 0;
+        for (uint64_t index = first; index < head; ++index) {
+            const Slot& slot = slots_[index % capacity_];
+            if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+                continue;
+            }
+            Event event;
+            event.name = slot.name.load(std::memory_order_relaxed);
+            event.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+            event.duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+            event.tid = slot.tid.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == index + 1 && event.name) {
+                events.push_back(event);
+            }
+        }
+    }
+
+    int32_t tid = 0;                     // Owner; set while it holds the buffer
+    std::atomic<bool> in_use{true};
+
+private:
+    std::unique_ptr<Slot[]> slots_;
+    size_t capacity_;
+    std::atomic<uint64_t> head_{0};
+};
+
+struct State {
+    std::atomic<size_t> capacity{2048};
+    std::mutex mutex;                    // Guards buffers
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+inline State& state() {
+    static State instance;
+    return instance;
+}
+
+inline ThreadBuffer* acquireBuffer() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    ThreadBuffer* buffer = nullptr;
+    for (auto& candidate : s.buffers) {
+        if (!candidate->in_use.load(std::memory_order_acquire)) {
+            buffer = candidate.get();
+            buffer->in_use.store(true, std::memory_order_relaxed);
+            break;
+        }
+    }
+    if (!buffer) {
+        s.buffers.emplace_back(new ThreadBuffer(s.capacity.load(std::memory_order_relaxed)));
+        buffer = s.buffers.back().get();
+    }
+    buffer->tid = static_cast<int32_t>(::syscall(SYS_gettid));
+    return buffer;
+}
+
+// Returns the thread's buffer to the pool when the thread exits
+struct ThreadHandle {
+    ThreadBuffer* buffer = nullptr;
+    ~ThreadHandle() {
+        if (buffer) {
+            buffer->in_use.store(false, std::memory_order_release);
+        }
+    }
+};
+
+inline thread_local ThreadHandle t_handle;
+
+inline void record(const char* name, int64_t start_ns, int64_t duration_ns) {
+    ThreadHandle& handle = t_handle;
+    if (!handle.buffer) {
+        handle.buffer = acquireBuffer();
+    }
+    handle.buffer->record(name, start_ns, duration_ns);
+}
+
+inline void appendEscaped(std::string& out, const char* text) {
+    for (; *text; ++text) {
+        char c = *text;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+}
+
+} // namespace detail
+
+// Tracing is off until enabled; spans opened while off are never recorded
+inline void setEnabled(bool enabled) { detail::g_enabled.store(enabled, std::memory_order_relaxed); }
+inline bool isEnabled() { return detail::g_enabled.load(std::memory_order_relaxed); }
+
+// Events kept per thread; applies to threads that record their first span
+// after the call
+inline void setBufferCapacity(size_t events) {
+    detail::state().capacity.store(events > 0 ? events : 1, std::memory_order_relaxed);
+}
+
+// Times its own lifetime
+class Span {
+public:
+    explicit Span(const char* name)
+        : name_(detail::g_enabled.load(std::memory_order_relaxed) ? name : nullptr),
+          start_ns_(name_ ? detail::nowNs() : 0) {}
+    ~Span() {
+        if (name_) {
+            detail::record(name_, start_ns_, detail::nowNs() - start_ns_);
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name_;
+    int64_t start_ns_;
+};
+
+// Every event still buffered, as a Chrome trace-event document for
+// chrome://tracing or Perfetto. Times are microseconds of the steady clock.
+inline std::string dumpChromeJson() {
+    std::vector<detail::ThreadBuffer::Event> events;
+    {
+        detail::State& s = detail::state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (const auto& buffer : s.buffers) {
+            buffer->collect(events);
+        }
+    }
+
+    const long pid = static_cast<long>(::getpid());
+    std::string out;
+    out.reserve(64 + events.size() * 112);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    std::vector<int32_t> tids;
+    char number[96];
+    bool first = true;
+    for (const auto& event : events) {
+        out += first ? "" : ",";
+        first = false;
+        out += "{\"name\":\"";
+        detail::appendEscaped(out, event.name);
+        std::snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%d}",
+                      static_cast<double>(event.start_ns) / 1000.0, static_cast<double>(event.duration_ns) / 1000.0,
+                      pid, static_cast<int>(event.tid));
+        out += number;
+        bool seen = false;
+        for (int32_t tid : tids) {
+            seen = seen || tid == event.tid;
+        }
+        if (!seen) {
+            tids.push_back(event.tid);
+        }
+    }
+
+    // Thread names, for the threads still running
+    for (int32_t tid : tids) {
+        std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+        std::string name;
+        if (!std::getline(comm, name) || name.empty()) {
+            continue;
+        }
+        out += first ? "" : ",";
+        first = false;
+        std::snprintf(number, sizeof(number), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%d,",
+                      pid, static_cast<int>(tid));
+        out += number;
+        out += "\"args\":{\"name\":\"";
+        detail::appendEscaped(out, name.c_str());
+        out += "\"}}";
+    }
+
+    out += "]}";
+    return out;
+}
+
+inline bool dumpChromeJsonToFile(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    file << dumpChromeJson();
+    return static_cast<bool>(file);
+}
+
+} // namespace UrTrace
+
+#define UR_TRACE_CONCAT_INNER(a, b) a##b
+#define UR_TRACE_CONCAT(a, b) UR_TRACE_CONCAT_INNER(a, b)
+
+#ifdef UR_TRACE_DISABLED
+#define UR_TRACE_SPAN(name) ((void)0)
+#else
+// Records the rest of the enclosing scope under name
+#define UR_TRACE_SPAN(name) UrTrace::Span UR_TRACE_CONCAT(ur_trace_span_, __LINE__)(name)
+#endif
+
+#endif // UR_TRACE_HPP
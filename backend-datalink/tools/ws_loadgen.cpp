@@ -0,0 +1,471 @@
+// WebSocket load generator and soak test for backend-datalink.
+//
+// Opens N client connections, sends get_dashboard_data, subscribe_updates
+// and network_priority requests at configurable per-connection rates, and
+// reports at a fixed interval:
+//   - round-trip latency per request type (request sent -> matching response)
+//   - broadcast delivery delay of dashboard_update/dashboard_delta messages,
+//     from their timestamp_ms (or timestamp, whole seconds) to arrival. The
+//     generator and the gateway must share a clock for this to be meaningful.
+//
+// Responses carry no request id, so each connection matches them to its
+// requests of the same type in order, which is the order the server answers
+// them in.
+
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+typedef websocketpp::client<websocketpp::config::asio_client> ws_client;
+typedef std::chrono::steady_clock steady;
+
+namespace {
+
+std::atomic<bool> g_running(true);
+
+enum RequestType {
+    DashboardData = 0,
+    SubscribeUpdates = 1,
+    NetworkPriority = 2,
+    RequestTypeCount = 3
+};
+
+const char* const kRequestNames[RequestTypeCount] = {"get_dashboard_data", "subscribe_updates", "network_priority"};
+const char* const kResponseTypes[RequestTypeCount] = {"dashboard_data", "subscription_confirmed",
+                                                      "network_priority_response"};
+
+struct Options {
+    std::string url = "ws://127.0.0.1:9002";
+    int connections = 10;
+    int connect_rate = 50;          // New connections per second
+    int duration_seconds = 60;      // 0 runs until interrupted
+    int report_seconds = 10;
+    int io_threads = 1;
+    double rates[RequestTypeCount] = {1.0, 0.0, 0.2}; // Requests per second per connection
+    bool json_output = false;
+};
+
+// Latency samples of one reporting interval
+class Samples {
+public:
+    void add(double value_ms) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        values_.push_back(value_ms);
+    }
+
+    // Returns and clears the collected samples
+    std::vector<double> take() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<double> result;
+        result.swap(values_);
+        return result;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<double> values_;
+};
+
+struct Counters {
+    std::atomic<uint64_t> opened{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> closed{0};
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> broadcasts{0};
+};
+
+struct Session {
+    websocketpp::connection_hdl hdl;
+    bool open = false;
+    std::deque<steady::time_point> pending[RequestTypeCount];
+    steady::time_point next_due[RequestTypeCount];
+    std::mutex mutex;
+};
+
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const Options& options) : options_(options) {
+        client_.clear_access_channels(websocketpp::log::alevel::all);
+        client_.clear_error_channels(websocketpp::log::elevel::all);
+        client_.init_asio();
+        client_.start_perpetual();
+    }
+
+    void run() {
+        for (int i = 0; i < options_.io_threads; ++i) {
+            io_threads_.emplace_back([this]() { client_.run(); });
+        }
+
+        auto start = steady::now();
+        auto next_report = start + std::chrono::seconds(options_.report_seconds);
+        auto deadline = start + std::chrono::seconds(options_.duration_seconds);
+        auto connect_interval = std::chrono::microseconds(1000000 / std::max(1, options_.connect_rate));
+        auto next_connect = start;
+
+        while (g_running.load()) {
+            auto now = steady::now();
+            if (options_.duration_seconds > 0 && now >= deadline) {
+                break;
+            }
+
+            // Ramp up at connect_rate
+            while (sessions_.size() < static_cast<size_t>(options_.connections) && now >= next_connect) {
+                connect();
+                next_connect += connect_interval;
+            }
+
+            sendDue(now);
+
+            if (now >= next_report) {
+                report(now - start, false);
+                next_report += std::chrono::seconds(options_.report_seconds);
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        report(steady::now() - start, true);
+        shutdown();
+    }
+
+private:
+    Options options_;
+    ws_client client_;
+    std::vector<std::thread> io_threads_;
+    std::vector<std::shared_ptr<Session>> sessions_;
+    Counters counters_;
+    Samples rtt_[RequestTypeCount];
+    Samples broadcast_delay_;
+    // Whole run, for the final report
+    std::vector<double> total_rtt_[RequestTypeCount];
+    std::vector<double> total_broadcast_delay_;
+
+    void connect() {
+        auto session = std::make_shared<Session>();
+        websocketpp::lib::error_code ec;
+        ws_client::connection_ptr con = client_.get_connection(options_.url, ec);
+        if (ec) {
+            std::cerr << "Failed to create connection: " << ec.message() << std::endl;
+            counters_.failed++;
+            g_running.store(false);
+            return;
+        }
+
+        con->set_open_handler([this, session](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            session->open = true;
+            // Spread the first requests over one period so connections don't send in lockstep
+            auto now = steady::now();
+            for (int type = 0; type < RequestTypeCount; ++type) {
+                session->next_due[type] = now + randomOffset(options_.rates[type]);
+            }
+            counters_.opened++;
+        });
+        con->set_fail_handler([this](websocketpp::connection_hdl) {
+            counters_.failed++;
+        });
+        con->set_close_handler([this, session](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            session->open = false;
+            counters_.closed++;
+        });
+        con->set_message_handler([this, session](websocketpp::connection_hdl, ws_client::message_ptr msg) {
+            onMessage(*session, msg->get_payload());
+        });
+
+        session->hdl = con->get_handle();
+        sessions_.push_back(session);
+        client_.connect(con);
+    }
+
+    static steady::duration randomOffset(double rate) {
+        if (rate <= 0.0) {
+            return steady::duration::zero();
+        }
+        double period_us = 1000000.0 / rate;
+        return std::chrono::microseconds(static_cast<int64_t>(period_us * (std::rand() / (RAND_MAX + 1.0))));
+    }
+
+    void sendDue(steady::time_point now) {
+        for (auto& session : sessions_) {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (!session->open) {
+                continue;
+            }
+            for (int type = 0; type < RequestTypeCount; ++type) {
+                double rate = options_.rates[type];
+                if (rate <= 0.0 || now < session->next_due[type]) {
+                    continue;
+                }
+                session->next_due[type] += std::chrono::microseconds(static_cast<int64_t>(1000000.0 / rate));
+                // A connection that fell behind skips ahead instead of bursting
+                if (session->next_due[type] < now) {
+                    session->next_due[type] = now;
+                }
+
+                websocketpp::lib::error_code ec;
+                client_.send(session->hdl, requestPayload(static_cast<RequestType>(type)),
+                             websocketpp::frame::opcode::text, ec);
+                if (ec) {
+                    counters_.errors++;
+                    continue;
+                }
+                session->pending[type].push_back(steady::now());
+                counters_.sent++;
+            }
+        }
+    }
+
+    static const std::string& requestPayload(RequestType type) {
+        static const std::string payloads[RequestTypeCount] = {
+            json{{"type", "get_dashboard_data"}}.dump(),
+            json{{"type", "subscribe_updates"}}.dump(),
+            json{{"type", "network_priority"}, {"action", "get_data"}}.dump()
+        };
+        return payloads[type];
+    }
+
+    void onMessage(Session& session, const std::string& payload) {
+        auto arrived = steady::now();
+        counters_.received++;
+
+        json message = json::parse(payload, nullptr, false);
+        if (message.is_discarded() || !message.is_object()) {
+            counters_.errors++;
+            return;
+        }
+        std::string type = message.value("type", "");
+
+        if (type == "dashboard_update" || type == "dashboard_delta") {
+            counters_.broadcasts++;
+            int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            int64_t sent_ms = 0;
+            if (message.contains("timestamp_ms") && message["timestamp_ms"].is_number_integer()) {
+                sent_ms = message["timestamp_ms"].get<int64_t>();
+            } else if (message.contains("timestamp") && message["timestamp"].is_number_integer()) {
+                sent_ms = message["timestamp"].get<int64_t>() * 1000;
+            }
+            if (sent_ms > 0) {
+                broadcast_delay_.add(static_cast<double>(now_ms - sent_ms));
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(session.mutex);
+        if (type == "error") {
+            // Unattributable: retire the oldest outstanding request so later
+            // responses still pair up with theirs
+            counters_.errors++;
+            int oldest = -1;
+            for (int i = 0; i < RequestTypeCount; ++i) {
+                if (!session.pending[i].empty() &&
+                    (oldest < 0 || session.pending[i].front() < session.pending[oldest].front())) {
+                    oldest = i;
+                }
+            }
+            if (oldest >= 0) {
+                session.pending[oldest].pop_front();
+            }
+            return;
+        }
+
+        for (int i = 0; i < RequestTypeCount; ++i) {
+            if (type == kResponseTypes[i] && !session.pending[i].empty()) {
+                std::chrono::duration<double, std::milli> rtt = arrived - session.pending[i].front();
+                session.pending[i].pop_front();
+                rtt_[i].add(rtt.count());
+                return;
+            }
+        }
+    }
+
+    static json summarize(std::vector<double> values) {
+        json summary = {{"count", values.size()}};
+        if (values.empty()) {
+            return summary;
+        }
+        std::sort(values.begin(), values.end());
+        auto percentile = [&values](double p) {
+            size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+            return values[std::min(index, values.size() - 1)];
+        };
+        summary["p50"] = percentile(0.50);
+        summary["p90"] = percentile(0.90);
+        summary["p99"] = percentile(0.99);
+        summary["max"] = values.back();
+        return summary;
+    }
+
+    void report(steady::duration elapsed, bool final_report) {
+        json latency = json::object();
+        for (int i = 0; i < RequestTypeCount; ++i) {
+            std::vector<double> values = rtt_[i].take();
+            total_rtt_[i].insert(total_rtt_[i].end(), values.begin(), values.end());
+            if (options_.rates[i] > 0.0) {
+                latency[kRequestNames[i]] = summarize(final_report ? total_rtt_[i] : values);
+            }
+        }
+        std::vector<double> delays = broadcast_delay_.take();
+        total_broadcast_delay_.insert(total_broadcast_delay_.end(), delays.begin(), delays.end());
+
+        uint64_t open = counters_.opened.load() - counters_.closed.load();
+        json result = {
+            {"final", final_report},
+            {"elapsed_s", std::chrono::duration_cast<std::chrono::seconds>(elapsed).count()},
+            {"connections_open", open},
+            {"connections_failed", counters_.failed.load()},
+            {"connections_closed", counters_.closed.load()},
+            {"sent", counters_.sent.load()},
+            {"received", counters_.received.load()},
+            {"errors", counters_.errors.load()},
+            {"broadcasts", counters_.broadcasts.load()},
+            {"rtt_ms", latency},
+            {"broadcast_delay_ms", summarize(final_report ? total_broadcast_delay_ : delays)}
+        };
+
+        if (options_.json_output) {
+            std::cout << result.dump() << std::endl;
+            return;
+        }
+
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1);
+        line << (final_report ? "[total] " : "") << "t=" << result["elapsed_s"] << "s open=" << open
+             << " failed=" << result["connections_failed"] << " closed=" << result["connections_closed"]
+             << " sent=" << result["sent"] << " recv=" << result["received"] << " errors=" << result["errors"];
+        auto append = [&line](const std::string& name, const json& summary) {
+            line << " | " << name << " n=" << summary["count"];
+            if (summary.contains("p50")) {
+                line << " p50=" << summary["p50"].get<double>() << " p99=" << summary["p99"].get<double>()
+                     << " max=" << summary["max"].get<double>() << "ms";
+            }
+        };
+        for (auto it = latency.begin(); it != latency.end(); ++it) {
+            append(it.key(), it.value());
+        }
+        append("broadcast", result["broadcast_delay_ms"]);
+        std::cout << line.str() << std::endl;
+    }
+
+    void shutdown() {
+        client_.stop_perpetual();
+        for (auto& session : sessions_) {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (session->open) {
+                websocketpp::lib::error_code ec;
+                client_.close(session->hdl, websocketpp::close::status::going_away, "load test done", ec);
+            }
+        }
+        for (auto& thread : io_threads_) {
+            thread.join();
+        }
+    }
+};
+
+void signalHandler(int) {
+    g_running.store(false);
+}
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -url <ws://host:port>         Server to load (default ws://127.0.0.1:9002)" << std::endl;
+    std::cout << "  -connections <n>              Client connections (default 10)" << std::endl;
+    std::cout << "  -connect_rate <n>             New connections per second (default 50)" << std::endl;
+    std::cout << "  -duration <seconds>           Run time, 0 until interrupted (default 60)" << std::endl;
+    std::cout << "  -report <seconds>             Reporting interval (default 10)" << std::endl;
+    std::cout << "  -dashboard_rate <per_second>  get_dashboard_data per connection (default 1)" << std::endl;
+    std::cout << "  -subscribe_rate <per_second>  subscribe_updates per connection (default 0)" << std::endl;
+    std::cout << "  -network_rate <per_second>    network_priority get_data per connection (default 0.2)" << std::endl;
+    std::cout << "  -io_threads <n>               Client io threads (default 1)" << std::endl;
+    std::cout << "  -json                         One JSON object per report instead of text" << std::endl;
+    std::cout << "  -h, --help                    Show this help message" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Example:" << std::endl;
+    std::cout << "  " << program_name << " -connections 200 -dashboard_rate 0.5 -duration 0 -json" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "-json") {
+            options.json_output = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: " << arg << " requires a value" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "-url") {
+            options.url = value;
+        } else if (arg == "-connections") {
+            options.connections = std::atoi(value);
+        } else if (arg == "-connect_rate") {
+            options.connect_rate = std::atoi(value);
+        } else if (arg == "-duration") {
+            options.duration_seconds = std::atoi(value);
+        } else if (arg == "-report") {
+            options.report_seconds = std::max(1, std::atoi(value));
+        } else if (arg == "-dashboard_rate") {
+            options.rates[DashboardData] = std::atof(value);
+        } else if (arg == "-subscribe_rate") {
+            options.rates[SubscribeUpdates] = std::atof(value);
+        } else if (arg == "-network_rate") {
+            options.rates[NetworkPriority] = std::atof(value);
+        } else if (arg == "-io_threads") {
+            options.io_threads = std::max(1, std::atoi(value));
+        } else {
+            std::cerr << "Error: Unknown argument '" << arg << "'" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.connections <= 0) {
+        std::cerr << "Error: -connections must be positive" << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    try {
+        LoadGenerator generator(options);
+        generator.run();
+    } catch (const std::exception& e) {
+        std::cerr << "Load generator failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
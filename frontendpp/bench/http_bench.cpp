@@ -0,0 +1,513 @@
+// HTTP benchmark harness for frontendpp.
+//
+// Starts HttpServer in-process on loopback with the real auth routes, an
+// AssetCache over a generated static tree and the streaming upload route,
+// then drives it with keep-alive client threads. Each scenario reports
+// throughput, p50/p90/p99 latency and the process RSS afterwards (client
+// and server share the process, the client side is small).
+//
+//   ./frontendpp_http_bench -concurrency 16 -duration 10 -json > bench.json
+
+#include "http_server.h"
+#include "auth_handler.h"
+#include "jwt_manager.h"
+#include "asset_cache.h"
+#include "logger.h"
+#include "frontendpp/cmake/attributes.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    int port = 18080;
+    int concurrency = 8;
+    int duration_seconds = 5;
+    int server_threads = 4;
+    std::string threading_mode = "thread_pool";
+    int upload_mb = 8;
+    bool json_output = false;
+};
+
+// One keep-alive HTTP/1.1 connection to the server under test
+class HttpConnection {
+public:
+    explicit HttpConnection(int port) : port_(port) {}
+    ~HttpConnection() { disconnect(); }
+
+    // Sends a complete request and reads the response; returns the status
+    // code, or 0 on a transport error
+    int exchange(const std::string& request, size_t& body_bytes, std::string* body = nullptr) {
+        body_bytes = 0;
+        if (fd_ < 0 && !connect()) {
+            return 0;
+        }
+        if (!sendAll(request)) {
+            disconnect();
+            return 0;
+        }
+        int status = readResponse(body_bytes, body);
+        if (status == 0 || close_after_) {
+            disconnect();
+        }
+        return status;
+    }
+
+private:
+    int port_;
+    int fd_ = -1;
+    std::string buffer_;    // Received but not yet consumed
+    bool close_after_ = false;
+
+    bool connect() {
+        fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) {
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port_));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            disconnect();
+            return false;
+        }
+        return true;
+    }
+
+    void disconnect() {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        buffer_.clear();
+    }
+
+    bool sendAll(const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool fill() {
+        char chunk[65536];
+        ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+        if (n <= 0) {
+            return false;
+        }
+        buffer_.append(chunk, static_cast<size_t>(n));
+        return true;
+    }
+
+    // Consumes size bytes of body, keeping them only when asked to
+    bool consume(size_t size, std::string* body) {
+        while (buffer_.size() < size) {
+            if (body) {
+                body->append(buffer_);
+            }
+            size -= buffer_.size();
+            buffer_.clear();
+            if (!fill()) {
+                return false;
+            }
+        }
+        if (body) {
+            body->append(buffer_, 0, size);
+        }
+        buffer_.erase(0, size);
+        return true;
+    }
+
+    bool readLine(std::string& line) {
+        size_t end;
+        while ((end = buffer_.find("\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        line = buffer_.substr(0, end);
+        buffer_.erase(0, end + 2);
+        return true;
+    }
+
+    int readResponse(size_t& body_bytes, std::string* body) {
+        size_t header_end;
+        while ((header_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return 0;
+            }
+        }
+        std::string head = buffer_.substr(0, header_end);
+        buffer_.erase(0, header_end + 4);
+        for (char& c : head) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        int status = 0;
+        if (head.size() > 12) {
+            status = std::atoi(head.c_str() + 9);
+        }
+        close_after_ = head.find("\r\nconnection: close") != std::string::npos;
+
+        size_t length_pos = head.find("\r\ncontent-length:");
+        if (length_pos != std::string::npos) {
+            body_bytes = std::strtoull(head.c_str() + length_pos + 17, nullptr, 10);
+            return consume(body_bytes, body) ? status : 0;
+        }
+        if (head.find("\r\ntransfer-encoding: chunked") != std::string::npos) {
+            std::string line;
+            for (;;) {
+                if (!readLine(line)) {
+                    return 0;
+                }
+                size_t size = std::strtoull(line.c_str(), nullptr, 16);
+                if (size == 0) {
+                    return readLine(line) ? status : 0;    // Trailing CRLF
+                }
+                if (!consume(size, body) || !readLine(line)) {
+                    return 0;
+                }
+                body_bytes += size;
+            }
+        }
+        return status;
+    }
+};
+
+struct ScenarioResult {
+    std::string name;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;         // Response bodies, or request bodies for uploads
+    double seconds = 0.0;
+    std::vector<double> latencies_ms;
+};
+
+// Runs make_request on every client thread until the duration is up
+ScenarioResult runScenario(const std::string& name, const Options& options, int concurrency,
+                           const std::function<std::string()>& make_request, bool count_request_bytes) {
+    ScenarioResult result;
+    result.name = name;
+    std::mutex result_mutex;
+    std::atomic<bool> stop(false);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (int i = 0; i < concurrency; ++i) {
+        clients.emplace_back([&]() {
+            HttpConnection connection(options.port);
+            std::vector<double> latencies;
+            uint64_t requests = 0, errors = 0, bytes = 0;
+            std::string request = make_request();
+            while (!stop.load(std::memory_order_relaxed)) {
+                size_t body_bytes = 0;
+                auto sent = std::chrono::steady_clock::now();
+                int status = connection.exchange(request, body_bytes);
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - sent;
+                requests++;
+                if (status < 200 || status >= 400) {
+                    errors++;
+                    continue;
+                }
+                latencies.push_back(elapsed.count());
+                bytes += count_request_bytes ? request.size() : body_bytes;
+            }
+            std::lock_guard<std::mutex> lock(result_mutex);
+            result.requests += requests;
+            result.errors += errors;
+            result.bytes += bytes;
+            result.latencies_ms.insert(result.latencies_ms.end(), latencies.begin(), latencies.end());
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.duration_seconds));
+    stop.store(true);
+    for (auto& client : clients) {
+        client.join();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// VmRSS and VmHWM of this process, in kB
+void readMemory(long& rss_kb, long& peak_kb) {
+    rss_kb = peak_kb = 0;
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            rss_kb = std::atol(line.c_str() + 6);
+        } else if (line.compare(0, 6, "VmHWM:") == 0) {
+            peak_kb = std::atol(line.c_str() + 6);
+        }
+    }
+}
+
+json summarize(ScenarioResult& result) {
+    std::vector<double>& values = result.latencies_ms;
+    std::sort(values.begin(), values.end());
+    auto percentile = [&values](double p) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+        return values[std::min(index, values.size() - 1)];
+    };
+    long rss_kb, peak_kb;
+    readMemory(rss_kb, peak_kb);
+    return {
+        {"scenario", result.name},
+        {"requests", result.requests},
+        {"errors", result.errors},
+        {"requests_per_second", result.requests / result.seconds},
+        {"mb_per_second", result.bytes / result.seconds / (1024.0 * 1024.0)},
+        {"p50_ms", percentile(0.50)},
+        {"p90_ms", percentile(0.90)},
+        {"p99_ms", percentile(0.99)},
+        {"max_ms", values.empty() ? 0.0 : values.back()},
+        {"rss_kb", rss_kb},
+        {"peak_rss_kb", peak_kb}
+    };
+}
+
+void writeFile(const fs::path& path, size_t size, char fill) {
+    std::ofstream out(path, std::ios::binary);
+    std::string content(size, fill);
+    out.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+std::string getRequest(const std::string& path, const std::string& extra_headers = "") {
+    return "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n" + extra_headers + "\r\n";
+}
+
+std::string postRequest(const std::string& path, const std::string& content_type, const std::string& body,
+                        const std::string& extra_headers = "") {
+    return "POST " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Type: " + content_type +
+           "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n" + extra_headers + "\r\n" + body;
+}
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -port <n>              Loopback port for the server (default 18080)" << std::endl;
+    std::cout << "  -concurrency <n>       Client connections per scenario (default 8)" << std::endl;
+    std::cout << "  -duration <seconds>    Length of each scenario (default 5)" << std::endl;
+    std::cout << "  -server_threads <n>    HttpServer thread pool size (default 4)" << std::endl;
+    std::cout << "  -threading_mode <m>    select, thread_pool or thread_per_connection" << std::endl;
+    std::cout << "  -upload_mb <n>         Size of each uploaded file (default 8)" << std::endl;
+    std::cout << "  -json                  Print the results as one JSON document" << std::endl;
+    std::cout << "  -h, --help             Show this help message" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "-json") {
+            options.json_output = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: " << arg << " requires a value" << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "-port") {
+            options.port = std::atoi(value.c_str());
+        } else if (arg == "-concurrency") {
+            options.concurrency = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "-duration") {
+            options.duration_seconds = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "-server_threads") {
+            options.server_threads = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "-threading_mode") {
+            options.threading_mode = value;
+        } else if (arg == "-upload_mb") {
+            options.upload_mb = std::max(1, std::atoi(value.c_str()));
+        } else {
+            std::cerr << "Error: Unknown argument '" << arg << "'" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    ThreadingMode threading_mode;
+    if (!HttpServer::parse_threading_mode(options.threading_mode, threading_mode)) {
+        std::cerr << "Error: Unknown threading mode '" << options.threading_mode << "'" << std::endl;
+        return 1;
+    }
+
+    // Handlers log at INFO per request; keep that out of the numbers
+    FrontendPP::Logger::get_instance().set_min_level(FrontendPP::LogLevel::WARNING);
+
+    char temp_template[] = "/tmp/frontendpp-bench-XXXXXX";
+    if (!mkdtemp(temp_template)) {
+        std::cerr << "Failed to create a temporary directory" << std::endl;
+        return 1;
+    }
+    fs::path root(temp_template);
+    fs::create_directories(root / "www");
+    fs::create_directories(root / "uploads");
+    writeFile(root / "www" / "index.html", 2 * 1024, 'h');
+    writeFile(root / "www" / "app.js", 64 * 1024, 'j');
+    writeFile(root / "www" / "large.bin", 1024 * 1024, 'b');
+
+    json results = json::array();
+    {
+        JWTManager jwt_manager(AuthHandler::generate_jwt_secret(), "frontendpp-bench", "frontendpp-bench", 60, 1440);
+        AuthHandler auth_handler((root / "auth.db").string(), jwt_manager);
+        auto asset_cache = std::make_shared<AssetCache>((root / "www").string());
+        asset_cache->load();
+
+        HttpServer server("127.0.0.1", options.port, 10000, options.server_threads);
+        server.set_threading_mode(threading_mode);
+        server.post("/api/auth/login", [&auth_handler](const HttpRequest& request) {
+            return auth_handler.handle_login(request);
+        });
+        server.get("/api/auth/validate", [&auth_handler](const HttpRequest& request) {
+            return auth_handler.handle_validate_token(request);
+        });
+        UploadOptions upload_options;
+        upload_options.upload_dir = (root / "uploads").string();
+        upload_options.max_file_bytes = static_cast<size_t>(options.upload_mb + 1) * 1024 * 1024;
+        upload_options.max_total_bytes = upload_options.max_file_bytes;
+        upload_options.authorize = [&auth_handler](const HttpRequest& request) {
+            UserInfo user_info;
+            return auth_handler.authenticate_request(request, user_info);
+        };
+        server.post_upload("/api/auth/upload-files", upload_options, [&auth_handler](const HttpRequest& request) {
+            return auth_handler.handle_upload_files(request);
+        });
+        server.serve_static_files("/", asset_cache);
+
+        if (!server.start()) {
+            std::cerr << "Failed to start the server on port " << options.port << std::endl;
+            return 1;
+        }
+
+        json credentials = {{"username", FrontendPP::BuildAttributes::DEFAULT_ADMIN_USERNAME},
+                            {"password", FrontendPP::BuildAttributes::DEFAULT_ADMIN_PASSWORD}};
+        std::string login_request = postRequest("/api/auth/login", "application/json", credentials.dump());
+
+        // A token for the authenticated scenarios
+        std::string token;
+        {
+            HttpConnection connection(options.port);
+            size_t body_bytes = 0;
+            std::string body;
+            if (connection.exchange(login_request, body_bytes, &body) == 200) {
+                json response = json::parse(body, nullptr, false);
+                if (!response.is_discarded()) {
+                    token = response.value("access_token", "");
+                }
+            }
+        }
+        if (token.empty()) {
+            std::cerr << "Login with the default credentials failed" << std::endl;
+            server.stop();
+            return 1;
+        }
+        std::string bearer = "Authorization: Bearer " + token + "\r\n";
+
+        std::string boundary = "----frontendppbench";
+        std::string multipart = "--" + boundary + "\r\n"
+                                "Content-Disposition: form-data; name=\"files\"; filename=\"bench.bin\"\r\n"
+                                "Content-Type: application/octet-stream\r\n\r\n" +
+                                std::string(static_cast<size_t>(options.upload_mb) * 1024 * 1024, 'u') +
+                                "\r\n--" + boundary + "--\r\n";
+        std::string upload_request = postRequest("/api/auth/upload-files",
+                                                 "multipart/form-data; boundary=" + boundary, multipart, bearer);
+        multipart.clear();
+
+        struct Scenario {
+            const char* name;
+            std::function<std::string()> request;
+            bool count_request_bytes;
+        };
+        std::vector<Scenario> scenarios = {
+            {"static_small", [] { return getRequest("/index.html"); }, false},
+            {"static_medium", [] { return getRequest("/app.js"); }, false},
+            {"static_large", [] { return getRequest("/large.bin"); }, false},
+            {"auth_login", [&] { return login_request; }, false},
+            {"auth_validate", [&] { return getRequest("/api/auth/validate", bearer); }, false},
+            {"multipart_upload", [&] { return upload_request; }, true}
+        };
+
+        for (const auto& scenario : scenarios) {
+            ScenarioResult result = runScenario(scenario.name, options, options.concurrency, scenario.request,
+                                                scenario.count_request_bytes);
+            json summary = summarize(result);
+            summary["concurrency"] = options.concurrency;
+            results.push_back(summary);
+
+            // Uploads pile up otherwise
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(root / "uploads", ec)) {
+                fs::remove_all(entry.path(), ec);
+            }
+
+            if (!options.json_output) {
+                std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(18) << scenario.name
+                          << " req/s=" << summary["requests_per_second"].get<double>()
+                          << " MB/s=" << summary["mb_per_second"].get<double>()
+                          << " p50=" << summary["p50_ms"].get<double>() << "ms"
+                          << " p99=" << summary["p99_ms"].get<double>() << "ms"
+                          << " errors=" << result.errors
+                          << " rss=" << summary["rss_kb"].get<long>() << "kB" << std::endl;
+            }
+        }
+
+        server.stop();
+    }
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+
+    if (options.json_output) {
+        json report = {
+            {"server_threads", options.server_threads},
+            {"threading_mode", options.threading_mode},
+            {"duration_seconds", options.duration_seconds},
+            {"upload_mb", options.upload_mb},
+            {"scenarios", results}
+        };
+        std::cout << report.dump(2) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "http_server.h"
+#include "file_handler.h"
+#include <string>
+#include <map>
+#include <vector>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+// Static tree served from memory. Every file is read once at startup,
+// text assets also get gzip and brotli variants (or use the .gz/.br files
+// deployed next to them), and each request picks the smallest variant its
+// Accept-Encoding allows. Paths not in the cache, files over 4 MB and Range
+// requests fall through to disk.
+//
+// A directory of HTML fragments can also be served as one bundle (see
+// set_bundle()), so a page that needs all of them makes one request, and
+// every other file under a content-hashed name (see set_fingerprinting()),
+// so a repeat visit revalidates only its HTML.
+class AssetCache {
+public:
+    struct Asset {
+        std::string content_type;
+        std::string last_modified;
+        time_t mtime = 0;
+        std::string etag;       // Strong, of identity; each variant has its own
+        std::shared_ptr<const std::string> identity;
+        std::shared_ptr<const std::string> gzip;      // Null when not worth it
+        std::shared_ptr<const std::string> brotli;
+        bool immutable = false;     // Served under its fingerprinted name
+    };
+    
+    explicit AssetCache(const std::string& root);
+    ~AssetCache();
+    
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+    
+    // Reads the whole tree, replacing what was cached; returns the file count
+    size_t load();
+    // Reloads files as they change on disk (inotify); false if unavailable
+    bool start_watching();
+    void stop_watching();
+    
+    // relative_path as in FileHandler::serve_static_file
+    HttpResponse serve(const HttpRequest& request, const std::string& relative_path);
+    
+    size_t size() const;
+    
+    // As FileHandler::set_cache_policy; set before serving
+    void set_cache_policy(const std::vector<std::pair<std::string, std::string>>& rules);
+    // The .html files directly in directory (relative to the root) are also
+    // served as one JSON object {file name: content} at
+    // directory/bundle.json, compressed like any asset, with an ETag of its
+    // content. Rebuilt whenever one of them changes. Set before load().
+    void set_bundle(const std::string& directory);
+    // Every file but .html pages is also served as name.<hash>.ext, cached
+    // as immutable, and src/href references to it in the pages (and in the
+    // bundle) are rewritten to that name. A changed file gets a new name and
+    // the pages referring to it are rewritten again. Set before load().
+    void set_fingerprinting(bool enabled) { fingerprint_ = enabled; }
+    
+private:
+    using AssetMap = std::map<std::string, std::shared_ptr<const Asset>>;
+    
+    std::string root_;
+    FileHandler file_handler_;              // MIME types and the disk fallback
+    std::shared_ptr<const AssetMap> assets_;
+    mutable std::mutex assets_mutex_;       // Guards the assets_ pointer; maps are immutable
+    std::string bundle_dir_;                // Empty: no bundle
+    bool fingerprint_ = false;
+    // Path -> fingerprinted path; only load() and then the watch thread use it
+    std::map<std::string, std::string> manifest_;
+    
+    int inotify_fd_;
+    int stop_pipe_[2];
+    std::map<int, std::string> watch_dirs_; // Watch descriptor -> relative directory
+    std::thread watch_thread_;
+    std::atomic<bool> watching_;
+    
+    std::shared_ptr<const Asset> load_asset(const std::string& relative_path) const;
+    std::shared_ptr<const Asset> find(const std::string& relative_path) const;
+    bool in_bundle(const std::string& relative_path) const;
+    void add_bundle(AssetMap& assets) const;
+    // Points relative_path's fingerprinted alias at asset in assets and
+    // manifest_ (null: removes it); true if the alias name changed
+    bool update_alias(AssetMap& assets, const std::string& relative_path, const std::shared_ptr<const Asset>& asset);
+    std::string rewrite_references(const std::string& html, const std::string& relative_path) const;
+    void update(const std::string& relative_path);
+    void add_watches(const std::string& relative_dir);
+    void watch_loop();
+};
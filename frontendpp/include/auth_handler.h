@@ -1,7 +1,12 @@
 #pragma once
 
 #include "jwt_manager.h"
+#include "login_recorder.h"
 #include "http_server.h"
+#include "sqlite_pool.h"
+#include "password_hasher.h"
+#include "base64.h"
+#include "cipher_stream.h"
 #include <sqlite3.h>
 #include <memory>
 #include "logger.h"
@@ -41,7 +46,8 @@ struct TransferRecord {
 
 class AuthHandler {
 public:
-    AuthHandler(const std::string& db_path, const JWTManager& jwt_manager);
+    AuthHandler(const std::string& db_path, const JWTManager& jwt_manager,
+                const PasswordHasher::Options& hasher_options = PasswordHasher::Options());
     ~AuthHandler();
     
     // HTTP request handlers
@@ -64,19 +70,37 @@ public:
     
     // Authentication
     bool authenticate_request(const HttpRequest& request, UserInfo& user_info);
+    // Same, keeping every claim of the token
+    bool authenticate_request(const HttpRequest& request, VerifiedToken& token);
     
     // Public initialization methods
+    // The schema is at kSchemaVersion; checked at construction
+    bool schema_ready() const { return schema_ready_; }
+    // Integrity check, statistics and cleanup of non-admin data; slow on a
+    // large database, so main runs them once the server is listening
+    void run_deferred_checks();
     bool validate_database_integrity();
     static std::string generate_jwt_secret();
     static bool update_config_jwt_secret(const std::string& config_path, const std::string& new_secret);
 
 private:
+    // PRAGMA user_version of a database init_database() has brought up to
+    // date. Bump it when init_database() changes, so existing files run
+    // it once more.
+    static const int kSchemaVersion = 1;
+
     std::string db_path_;
     std::unique_ptr<JWTManager> jwt_manager_;
-    sqlite3* db_;
+    sqlite3* db_;                           // Schema setup and maintenance
+    std::unique_ptr<SqlitePool> db_pool_;   // Queries made by request handlers
+    std::unique_ptr<PasswordHasher> password_hasher_;
+    std::string dummy_hash_;                // Checked for unknown users, at the same cost as a real hash
+    std::unique_ptr<LoginRecorder> login_recorder_;   // last_login and login_audit writes
+    bool schema_ready_ = false;
     
     // Database operations
     bool init_database();
+    int schema_version();
     bool create_user_tables();
     bool create_auth_tables();
     void log_database_statistics();
@@ -97,10 +121,12 @@ private:
     
     // User management (internal)
     bool user_exists(const std::string& username);
-    bool verify_user_credentials(const std::string& username, const std::string& password);
+    // busy is set when the hashing pool turned the check away
+    bool verify_user_credentials(const std::string& username, const std::string& password, bool* busy = nullptr);
     UserInfo get_user_info(const std::string& username);
     bool create_user(const std::string& username, const std::string& password, const std::string& email, const std::string& role);
-    bool change_user_password(const std::string& username, const std::string& old_password, const std::string& new_password);
+    bool change_user_password(const std::string& username, const std::string& old_password, const std::string& new_password, bool* busy = nullptr);
+    bool store_password_hash(const std::string& username, const std::string& password_hash);
     
     // Auth key management (internal)
     std::string generate_secure_key();
@@ -119,7 +145,12 @@ private:
     
     // Transfer history
     bool add_transfer_record(const std::string& user_id, int file_count, long total_size);
-    std::vector<TransferRecord> get_user_transfer_history(const std::string& user_id);
+    // Newest first, starting after (after_created_at, after_id) when given.
+    // ok reports whether the query ran to completion.
+    std::vector<TransferRecord> get_user_transfer_history(const std::string& user_id,
+                                                          const std::string& after_created_at = "",
+                                                          const std::string& after_id = "",
+                                                          int limit = -1, bool* ok = nullptr);
     
     // Error handling
     HttpResponse create_auth_response(bool success, const std::string& message, const std::string& token = "", const UserInfo& user_info = UserInfo());
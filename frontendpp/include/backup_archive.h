@@ -0,0 +1,85 @@
+#pragma once
+
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// A tar archive of configuration files and database snapshots, produced
+// while it is sent (gzip-compressed when zlib is available).
+//   - Each database is copied with the SQLite online backup API, a few
+//     pages per step, into an in-memory database; writers get the source
+//     between steps. The archive is then read straight out of that image,
+//     so no copy is ever staged on flash.
+//   - Files and snapshots are opened by prepare(), so a missing database
+//     is an error response rather than a truncated download. After that,
+//     write() produces the archive one buffer at a time.
+class BackupArchive {
+public:
+    struct Options {
+        std::vector<std::string> files;
+        std::vector<std::string> databases;
+        int step_pages = 64;                // Pages copied per backup step
+        size_t max_snapshot_bytes = 64 * 1024 * 1024;
+    };
+
+    BackupArchive();
+    ~BackupArchive();
+
+    BackupArchive(const BackupArchive&) = delete;
+    BackupArchive& operator=(const BackupArchive&) = delete;
+
+    // Snapshots the databases and opens the files. On failure error says
+    // why and status is the HTTP status to answer with.
+    bool prepare(const Options& options, std::string& error, int& status);
+
+    bool compressed() const;
+    // A BodyWriter: fills buffer with up to max bytes, 0 once complete
+    size_t write(char* buffer, size_t max);
+
+    // "path/inside/archive" for a configured path: no leading slash and no
+    // "." or ".." segments
+    static std::string archive_name(const std::string& path);
+
+private:
+    struct Snapshot;
+
+    struct Entry {
+        std::string name;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        int fd = -1;                        // A file, or
+        std::unique_ptr<Snapshot> snapshot; // a database image
+    };
+
+    enum class Phase { Header, Body, Padding, Trailer, Done };
+
+    std::vector<Entry> entries_;
+    size_t entry_ = 0;
+    Phase phase_ = Phase::Header;
+    uint64_t offset_ = 0;                   // Into the current entry's body
+
+    char header_[512];
+    std::vector<char> chunk_;               // File reads
+    const char* pending_ = nullptr;         // Raw tar bytes not yet consumed
+    size_t pending_size_ = 0;
+
+#ifdef HAVE_ZLIB
+    z_stream zlib_{};
+    bool zlib_ready_ = false;
+    bool input_done_ = false;
+    bool finished_ = false;
+#endif
+
+    static bool snapshot_database(const std::string& path, const Options& options, Entry& entry,
+                                  std::string& error, int& status);
+    bool add_file(const std::string& path);
+    // Points pending_ at the next piece of the raw tar stream; false at the end
+    bool next_chunk();
+    void fill_header(const Entry& entry);
+};
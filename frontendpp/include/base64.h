@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Table-driven standard base64. The one-shot calls size their output up
+// front; the encoder and decoder carry partial groups between chunks so a
+// large payload can be converted piece by piece.
+class Base64 {
+public:
+    static std::string encode(const std::string& data);
+    static std::string encode(const char* data, size_t size);
+    // Skips characters outside the alphabet and stops at the first '='
+    static std::string decode(const std::string& encoded);
+
+    static size_t encoded_size(size_t size) { return (size + 2) / 3 * 4; }
+
+    class Encoder {
+    public:
+        // Appends the encoding of every complete 3-byte group seen so far
+        void update(const char* data, size_t size, std::string& out);
+        // Appends the last group with its padding
+        void finish(std::string& out);
+
+    private:
+        unsigned char carry_[3];
+        size_t carried_ = 0;
+    };
+
+    class Decoder {
+    public:
+        void update(const char* data, size_t size, std::string& out);
+        void finish(std::string& out);
+
+    private:
+        unsigned int bits_ = 0;
+        int bit_count_ = 0;
+        bool ended_ = false;
+    };
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <openssl/evp.h>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <cstddef>
+
+// AES-256-CBC in either direction, fed in chunks. Output is appended to the
+// caller's string as it is produced, so the working memory is one chunk
+// plus a cipher block however long the input is.
+class CipherStream {
+public:
+    enum class Mode { Encrypt, Decrypt };
+
+    static const size_t kKeySize = 32;
+    static const size_t kIvSize = 16;
+
+    // key holds kKeySize bytes and iv kIvSize bytes
+    CipherStream(Mode mode, const unsigned char* key, const unsigned char* iv);
+    ~CipherStream();
+
+    CipherStream(const CipherStream&) = delete;
+    CipherStream& operator=(const CipherStream&) = delete;
+
+    // Once either call fails the stream stays failed
+    bool update(const char* data, size_t size, std::string& out);
+    // Applies or checks the padding; a wrong key or truncated input fails here
+    bool finish(std::string& out);
+
+    // Pumps in to out chunk by chunk and finishes the stream
+    bool transform(std::istream& in, std::ostream& out);
+
+    bool ok() const { return ctx_ != nullptr && !failed_; }
+
+private:
+    EVP_CIPHER_CTX* ctx_;
+    Mode mode_;
+    bool failed_ = false;
+};
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <unordered_map>
+#include <utility>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -11,23 +14,62 @@ struct ServerConfig {
     int port;
     int max_connections;
     int thread_pool_size;
+    std::string threading_mode;     // "thread_pool", "thread_per_connection" or "select"
     std::vector<std::string> domain_names;
+    // Bind with SO_REUSEPORT, so a new process can listen before this one
+    // stops; a socket passed by systemd (LISTEN_FDS) is used instead when
+    // there is one
+    bool reuse_port = false;
+    // On SIGTERM, time to stop accepting, close WebSockets a few at a time
+    // and let requests finish; 0 stops at once
+    int drain_seconds = 10;
+    // Route responses of at least this size with a listed Content-Type go
+    // out br or gzip encoded; 0 turns it off
+    int compress_min_bytes = 1024;
+    std::vector<std::string> compress_types = {"application/json", "text/"};
+    // Per connection: memory for request headers and the read buffer, and
+    // the step that buffer grows by. Bounds memory at max_connections times
+    // the limit.
+    int connection_memory_limit = 32768;
+    int connection_memory_increment = 1024;
+    int per_ip_connection_limit = 0;        // 0: no limit
+    int listen_backlog = 0;                 // 0: the system default
+    // Idle connections, keep-alive ones between requests included, are
+    // closed after this long and free their slot
+    int connection_timeout_seconds = 30;
 };
 
 struct PathsConfig {
     std::string frontend_root;
     std::string static_files;
     std::string templates;
+    std::string uploads;
+    bool cache_static_assets = true;    // Serve frontend_root from memory
+    bool watch_static_assets = true;    // Reload cached files when they change
+    // Directory under frontend_root whose .html fragments are also served
+    // together as <dir>/bundle.json (cached assets only); empty disables
+    std::string component_bundle = "components";
+    // Also serve every non-page file as name.<hash>.ext, immutable, and
+    // point page references at those names (cached assets only)
+    bool fingerprint_assets = true;
+    // Cache-Control by regex on the file path, first match wins
+    std::vector<std::pair<std::string, std::string>> cache_control;
 };
 
 struct AuthConfig {
     std::string jwt_secret;
+    // Secrets rotated out of jwt_secret whose tokens are still accepted
+    // until they expire
+    std::vector<std::string> previous_jwt_secrets;
     int token_expiry_minutes;
     int refresh_token_expiry_minutes;
     std::string issuer;
     std::string audience;
     bool enable_sliding_expiration;
     int token_refresh_threshold_minutes;
+    int password_hash_iterations = 100000;  // PBKDF2-HMAC-SHA256 rounds for new hashes
+    int password_hash_workers = 2;          // Threads that hash and verify passwords
+    int password_hash_queue = 32;           // Checks waiting beyond this get 503
     
     // Backward compatibility
     int token_expiry_hours;
@@ -40,7 +82,9 @@ struct SecurityConfig {
     std::vector<std::string> allowed_methods;
     std::vector<std::string> allowed_headers;
     int max_file_size_mb;
-    int rate_limit_requests_per_minute;
+    int max_request_body_kb;    // Bodies of ordinary (non-upload) routes
+    int rate_limit_requests_per_minute;   // Per client address, 0 disables
+    int rate_limit_burst = 0;           // 0 allows a minute's worth at once
     bool enable_security_headers;
     std::string strict_transport_security;
     std::string content_security_policy;
@@ -50,6 +94,26 @@ struct LoggingConfig {
     std::string level;
     std::string file;
     bool console;
+    bool access_log = false;
+    unsigned int access_log_body_sample_rate = 0;   // 0 never captures request bodies
+    size_t access_log_body_sample_bytes = 256;
+};
+
+struct BackupConfig {
+    bool enabled = true;
+    std::vector<std::string> config_files;      // Empty: the loaded config file
+    std::vector<std::string> databases;         // Empty: the database path
+    int step_pages = 64;                        // Pages copied per online backup step
+    int max_snapshot_mb = 64;                   // Snapshots are staged in memory
+};
+
+struct FirmwareConfig {
+    bool enabled = true;
+    std::vector<std::string> partitions;        // A/B slots; the one not mounted at / is written
+    std::string public_key;                     // PEM file; uploads must be signed when set
+    int ring_buffers = 8;                       // Buffers between upload, hash and write
+    int buffer_kb = 1024;                       // Each a multiple of 4 KiB, for O_DIRECT
+    int max_image_mb = 512;
 };
 
 struct DatabaseConfig {
@@ -57,9 +121,37 @@ struct DatabaseConfig {
     std::string path;
 };
 
+struct WebSocketProxyConfig {
+    bool enabled = false;
+    std::string path = "/ws";                   // Upgrades here go to the backend
+    std::string backend = "127.0.0.1:9002";     // "host:port" or "unix:/path/to/socket"
+};
+
+struct MetricsConfig {
+    bool enabled = true;
+    std::string path = "/metrics";              // Prometheus text format
+    bool allow_remote = false;                  // Otherwise loopback clients only
+};
+
+struct TlsConfig {
+    bool enabled = false;                       // Serve HTTPS instead of HTTP on server.port
+    std::string cert_file;                      // PEM, the certificate then its chain; ECDSA preferred
+    std::string key_file;                       // Reloaded with cert_file on SIGHUP
+    std::string priorities;                     // GnuTLS priority string; empty for the default
+};
+
+struct TraceConfig {
+    bool enabled = true;
+    int buffer_events = 2048;                   // Most recent spans kept per thread
+    std::string path = "/debug/trace";          // Chrome trace JSON, loopback clients only
+};
+
 class ConfigManager {
 private:
     std::unique_ptr<json> config_data_;
+    // Every member of config_data_ by dotted path, built once by
+    // load_config(), so get_config_*() are one lookup
+    std::unordered_map<std::string, const json*> values_;
     
     ServerConfig server_config_;
     PathsConfig paths_config_;
@@ -67,6 +159,15 @@ private:
     SecurityConfig security_config_;
     LoggingConfig logging_config_;
     DatabaseConfig database_config_;
+    BackupConfig backup_config_;
+    FirmwareConfig firmware_config_;
+    WebSocketProxyConfig websocket_proxy_config_;
+    MetricsConfig metrics_config_;
+    TlsConfig tls_config_;
+    TraceConfig trace_config_;
+    
+    void index_values(const json& node, const std::string& prefix);
+    const json* find_value(const std::string& path) const;
 
 public:
     ConfigManager();
@@ -81,10 +182,34 @@ public:
     const SecurityConfig& get_security_config() const { return security_config_; }
     const LoggingConfig& get_logging_config() const { return logging_config_; }
     const DatabaseConfig& get_database_config() const { return database_config_; }
+    const BackupConfig& get_backup_config() const { return backup_config_; }
+    const FirmwareConfig& get_firmware_config() const { return firmware_config_; }
+    const WebSocketProxyConfig& get_websocket_proxy_config() const { return websocket_proxy_config_; }
+    const MetricsConfig& get_metrics_config() const { return metrics_config_; }
+    const TlsConfig& get_tls_config() const { return tls_config_; }
+    const TraceConfig& get_trace_config() const { return trace_config_; }
     
-    // Utility methods
+    // Values by dotted path ("server.port"); the default when missing or of
+    // another type. Prefer the typed getters above on hot paths.
     std::string get_config_string(const std::string& path, const std::string& default_value = "") const;
     int get_config_int(const std::string& path, int default_value = 0) const;
     bool get_config_bool(const std::string& path, bool default_value = false) const;
     std::vector<std::string> get_config_array(const std::string& path) const;
 };
+
+// The configuration in effect, replaced as a whole by reload(). A snapshot
+// from current() never changes, so holders read it without locking.
+class ConfigStore {
+private:
+    std::string config_path_;
+    std::shared_ptr<const ConfigManager> current_;
+
+public:
+    explicit ConfigStore(std::string config_path) : config_path_(std::move(config_path)) {}
+    
+    // Parses the file into a new snapshot and publishes it; null if the
+    // file cannot be loaded, in which case the previous one stays current
+    std::shared_ptr<const ConfigManager> reload();
+    std::shared_ptr<const ConfigManager> current() const { return std::atomic_load(&current_); }
+    const std::string& path() const { return config_path_; }
+};
@@ -5,6 +5,12 @@
 #include <map>
 #include <vector>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <ctime>
+#include <regex>
+#include <utility>
+#include <sys/stat.h>
 
 struct FileInfo {
     std::string name;
@@ -16,22 +22,36 @@ struct FileInfo {
 
 class FileHandler {
 private:
+    // Small static files, kept while their size and mtime are unchanged
+    struct CachedFile {
+        std::shared_ptr<const std::string> data;
+        off_t size;
+        struct timespec mtime;
+    };
+    // Content hash of a file, kept while its size and mtime are unchanged
+    struct FileTag {
+        off_t size;
+        struct timespec mtime;
+        std::string etag;
+    };
+    
     std::string static_root_;
     std::map<std::string, std::string> mime_types_;
+    std::map<std::string, CachedFile> file_cache_;
+    size_t file_cache_bytes_;
+    std::map<std::string, FileTag> etag_cache_;
+    std::mutex file_cache_mutex_;       // Guards file_cache_ and etag_cache_
+    std::vector<std::pair<std::regex, std::string>> cache_policy_;
+    
+    // Points the response body at full_path: sendfile() for large files,
+    // a shared cached buffer for small ones
+    bool load_file_body(const std::string& full_path, HttpResponse& response);
     
     void init_mime_types();
-    std::string get_mime_type(const std::string& file_extension);
-    std::string get_file_extension(const std::string& file_path);
     std::string format_file_size(size_t size);
-    std::string get_last_modified(const std::string& file_path);
     bool file_exists(const std::string& file_path);
     bool is_directory(const std::string& file_path);
     
-    // File upload handling
-    std::vector<std::string> parse_multipart_boundary(const std::string& content_type);
-    std::map<std::string, std::string> parse_multipart_data(const std::string& body, const std::string& boundary);
-    std::string save_uploaded_file(const std::string& filename, const std::string& content, const std::string& upload_dir);
-    
 public:
     FileHandler(const std::string& static_root);
     ~FileHandler() = default;
@@ -45,12 +65,33 @@ public:
     std::vector<FileInfo> process_uploaded_files(const std::string& body, const std::string& content_type, const std::string& upload_dir);
     
     // Utility methods
+    std::string get_mime_type(const std::string& file_extension) const;
+    std::string get_file_extension(const std::string& file_path) const;
+    std::string get_last_modified(const std::string& file_path) const;
+    // Strong ETag of the file's content, hashed once per size/mtime
+    std::string get_etag(const std::string& full_path, const struct stat& st);
+    static std::string compute_etag(const std::string& data);
+    // The hash compute_etag() uses, for content-addressed names
+    static uint64_t content_hash(const std::string& data);
+    // True when If-None-Match, or failing that If-Modified-Since, says the
+    // client's copy is current
+    static bool is_not_modified(const HttpRequest& request, const std::string& etag, time_t last_modified);
+    // Each encoding is a different representation and needs its own ETag
+    static std::string variant_etag(const std::string& etag, const char* coding);
+    // True when an Accept-Encoding value lists coding without q=0
+    static bool accepts_encoding(std::string_view accept_encoding, const std::string& coding);
+    static std::string format_http_date(time_t when);
     bool validate_file_size(size_t size, size_t max_size);
     bool validate_file_type(const std::string& filename, const std::vector<std::string>& allowed_types);
     std::string generate_unique_filename(const std::string& original_name);
     bool create_directory(const std::string& dir_path);
     bool delete_file(const std::string& file_path);
     
+    // Cache-Control by path: the first rule whose regex matches the relative
+    // path wins; unmatched paths get "public, max-age=3600". Set before serving.
+    void set_cache_policy(const std::vector<std::pair<std::string, std::string>>& rules);
+    std::string get_cache_control(const std::string& relative_path) const;
+    
     // CORS and security headers
     void add_security_headers(HttpResponse& response);
     void add_cors_headers(HttpResponse& response, const std::string& origin = "*");
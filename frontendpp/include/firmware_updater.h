@@ -0,0 +1,56 @@
+#pragma once
+
+#include "http_server.h"
+#include "config_manager.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Writes uploaded firmware to the inactive A/B partition while the upload
+// is still arriving. The body goes through a ring of ring_buffers aligned
+// buffers of buffer_kb each in three stages, one thread apiece:
+//   receive (server thread) -> hash + signature check -> O_DIRECT write
+// so an upgrade takes about as long as the slower of network and flash,
+// and memory stays bounded by the ring. A full ring holds the receiving
+// thread, which in turn slows the client through TCP.
+//   - The partition written is the first configured one that is not
+//     mounted at /.
+//   - With public_key set, X-Firmware-Signature must carry the base64
+//     signature of the whole image (SHA-256). It can only be checked once
+//     the last byte is hashed; an image that fails it, or an upload that
+//     ends early, has its first block wiped so it is never booted.
+//   - Progress goes to every subscribed WebSocket as
+//       {"type": "firmware_progress", "state", "total", "received", "hashed", "written", ...}
+//     at most every 250 ms and on each state change.
+class FirmwareUpdater {
+public:
+    explicit FirmwareUpdater(FirmwareConfig config);
+    ~FirmwareUpdater();
+
+    FirmwareUpdater(const FirmwareUpdater&) = delete;
+    FirmwareUpdater& operator=(const FirmwareUpdater&) = delete;
+
+    // StreamOptions::open for the upload route: one upgrade at a time
+    std::shared_ptr<BodySink> begin(const HttpRequest& request, int& status, std::string& message);
+    // Waits for the sink's pipeline to drain and answers the upload
+    HttpResponse finish(const std::shared_ptr<BodySink>& sink);
+
+    void subscribe(std::shared_ptr<WebSocketChannel> channel);
+    nlohmann::json status() const;
+
+private:
+    class Session;
+    friend class Session;
+
+    FirmwareConfig config_;
+
+    mutable std::mutex mutex_;
+    std::weak_ptr<Session> active_;
+    nlohmann::json last_status_;
+    std::vector<std::shared_ptr<WebSocketChannel>> subscribers_;
+
+    std::string select_partition(std::string& error) const;
+    void publish(const nlohmann::json& progress);
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Small ordered list of name/value pairs for headers and query arguments.
+// The first N entries live inline, so a typical request or response never
+// allocates for it; lookups are a linear scan, which beats a tree at these
+// sizes. With String = std::string_view nothing is copied and the viewed
+// memory (for requests, libmicrohttpd's) must outlive the map.
+template <typename String, bool IgnoreCase, size_t N>
+class FlatStringMap {
+public:
+    using value_type = std::pair<String, String>;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + size_; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    void clear() {
+        size_ = 0;
+        heap_.clear();
+    }
+
+    iterator find(std::string_view name) {
+        for (iterator it = begin(); it != end(); ++it) {
+            if (names_equal(it->first, name)) {
+                return it;
+            }
+        }
+        return end();
+    }
+
+    const_iterator find(std::string_view name) const {
+        return const_cast<FlatStringMap*>(this)->find(name);
+    }
+
+    size_t count(std::string_view name) const { return find(name) != end() ? 1 : 0; }
+
+    const String& at(std::string_view name) const {
+        const_iterator it = find(name);
+        if (it == end()) {
+            throw std::out_of_range("FlatStringMap::at");
+        }
+        return it->second;
+    }
+
+    // Value of name, inserted empty if absent
+    String& operator[](std::string_view name) {
+        iterator it = find(name);
+        if (it != end()) {
+            return it->second;
+        }
+        return append(String(name), String()).second;
+    }
+
+    // Replaces the value of name, or appends it
+    void set(std::string_view name, String value) {
+        iterator it = find(name);
+        if (it != end()) {
+            it->second = std::move(value);
+        } else {
+            append(String(name), std::move(value));
+        }
+    }
+
+    void erase(std::string_view name) {
+        iterator it = find(name);
+        if (it == end()) {
+            return;
+        }
+        for (iterator next = it + 1; next != end(); ++it, ++next) {
+            *it = std::move(*next);
+        }
+        if (!heap_.empty()) {
+            heap_.pop_back();
+        }
+        --size_;
+    }
+
+private:
+    std::array<value_type, N> inline_;
+    std::vector<value_type> heap_;      // All entries, once there are more than N
+    size_t size_ = 0;
+
+    value_type* data() { return heap_.empty() ? inline_.data() : heap_.data(); }
+    const value_type* data() const { return heap_.empty() ? inline_.data() : heap_.data(); }
+
+    value_type& append(String name, String value) {
+        if (heap_.empty() && size_ < N) {
+            inline_[size_] = value_type(std::move(name), std::move(value));
+            return inline_[size_++];
+        }
+        if (heap_.empty()) {
+            heap_.reserve(2 * N);
+            for (auto& entry : inline_) {
+                heap_.push_back(std::move(entry));
+            }
+        }
+        heap_.emplace_back(std::move(name), std::move(value));
+        ++size_;
+        return heap_.back();
+    }
+
+    static bool names_equal(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        if (!IgnoreCase) {
+            return a == b;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            char x = a[i];
+            char y = b[i];
+            if (x != y) {
+                if (x >= 'A' && x <= 'Z') x = static_cast<char>(x - 'A' + 'a');
+                if (y >= 'A' && y <= 'Z') y = static_cast<char>(y - 'A' + 'a');
+                if (x != y) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// Response headers own their strings; request headers and query arguments
+// view libmicrohttpd's copies, which last as long as the request
+using HeaderMap = FlatStringMap<std::string, true, 8>;
+using HeaderViewMap = FlatStringMap<std::string_view, true, 16>;
+using ParamViewMap = FlatStringMap<std::string_view, false, 4>;
@@ -2,37 +2,152 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <functional>
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+#include "route_table.h"
+#include "flat_string_map.h"
 
 #ifdef HAVE_MICROHTTPD
 #include <microhttpd.h>
 #endif
 
+// A multipart file part written to disk while the request was arriving
+class AssetCache;
+class FileHandler;
+class RateLimiter;
+class ResponseCompressor;
+class WebSocketProxy;
+class WebSocketChannel;
+
+struct UploadedFile {
+    std::string field_name;
+    std::string filename;       // As sent by the client
+    std::string content_type;
+    std::string path;           // Where it was stored
+    size_t size = 0;
+    std::string sha256;         // Hex digest, computed while it was written
+};
+
+// Takes the body of a stream route piece by piece as it arrives, on the
+// server thread that reads it
+class BodySink {
+public:
+    virtual ~BodySink() = default;
+    // False stops the body from reaching the sink; the route handler still
+    // runs and reports why
+    virtual bool write(const char* data, size_t size) = 0;
+    // The request ended before the handler ran (client gone, timeout)
+    virtual void abort() = 0;
+};
+
 struct HttpRequest {
     std::string method;
     std::string path;
     std::string query_string;
-    std::map<std::string, std::string> headers;
-    std::map<std::string, std::string> query_params;
+    // Views into libmicrohttpd's memory, valid while the request is handled
+    HeaderViewMap headers;
+    ParamViewMap query_params;
+    std::map<std::string, std::string> path_params;     // ":name" segments of the route
     std::string body;
     std::string client_ip;
+    
+    // Upload routes only: body stays empty, parts arrive here instead
+    std::vector<UploadedFile> uploaded_files;
+    std::map<std::string, std::string> form_fields;
+    // Stream routes only: the sink the body was written to
+    std::shared_ptr<BodySink> body_sink;
+    
+    // Header value by case-insensitive name, empty when absent
+    std::string_view get_header(std::string_view name) const;
+};
+
+// An open file a response sends with sendfile(). Closed here unless the
+// server hands it to libmicrohttpd.
+struct FileBody {
+    int fd = -1;
+    uint64_t size = 0;
+    uint64_t offset = 0;        // Where in the file the body starts
+    
+    ~FileBody();
 };
 
+// Produces a body on demand: fills buffer with up to max bytes and returns
+// how many it wrote, 0 once the body is complete
+using BodyWriter = std::function<size_t(char* buffer, size_t max)>;
+
 struct HttpResponse {
     int status_code = 200;
-    std::map<std::string, std::string> headers;
+    HeaderMap headers;
+    // Fixed headers shared by many responses, sent unless headers has them
+    std::shared_ptr<const HeaderMap> shared_headers;
     std::string body;
+    // Alternatives to body, sent without copying the content into it
+    std::shared_ptr<FileBody> file;
+    std::shared_ptr<const std::string> shared_body;
+    std::shared_ptr<BodyWriter> stream;     // Sent chunked, length unknown
     
     void set_json_content(const std::string& json_data);
     void set_file_content(const std::string& file_path, const std::string& content_type = "");
     void set_error(int status_code, const std::string& message);
+    // Takes ownership of fd; sends size bytes starting at offset
+    void set_file_descriptor(int fd, uint64_t size, uint64_t offset = 0);
+    void set_shared_body(std::shared_ptr<const std::string> data);
+    // Called from the server thread after the handler returns, so whatever
+    // writer captures must stay valid until the response is sent
+    void set_stream(BodyWriter writer);
+    uint64_t content_length() const;
 };
 
-using RouteHandler = std::function<HttpResponse(const HttpRequest&)>;
+// Where an upload route stores file parts and how much it accepts
+struct UploadOptions {
+    std::string upload_dir = "uploads";
+    size_t max_file_bytes = 100 * 1024 * 1024;
+    size_t max_total_bytes = 100 * 1024 * 1024;
+    // Sees the request headers before any of the body is read; returning
+    // false answers 401 without storing anything
+    std::function<bool(const HttpRequest&)> authorize;
+};
+
+// A route whose raw body goes to a sink instead of memory or disk
+struct StreamOptions {
+    size_t max_bytes = 100 * 1024 * 1024;
+    // Sees the request headers before any of the body is read; returns the
+    // sink, or null with the status and message to refuse the request with
+    std::function<std::shared_ptr<BodySink>(const HttpRequest&, int& status, std::string& message)> open;
+};
+
+// A WebSocket answered by this server rather than the backend proxy
+struct WebSocketOptions {
+    // Sees the upgrade request; returning false answers 401
+    std::function<bool(const HttpRequest&)> authorize;
+    // Gets the channel once the connection has switched protocols
+    std::function<void(std::shared_ptr<WebSocketChannel>)> on_open;
+};
+
+// How libmicrohttpd runs request handlers
+enum class ThreadingMode {
+    SELECT,                 // One internal select() thread for every client
+    THREAD_POOL,            // thread_pool_size epoll (or poll) threads
+    THREAD_PER_CONNECTION   // A thread for each open connection
+};
+
+// What libmicrohttpd allows each connection; 0 leaves its default
+struct ConnectionLimits {
+    size_t memory_limit = 0;            // Request headers and read buffer, per connection
+    size_t memory_increment = 0;        // Step the read buffer grows by
+    unsigned per_ip = 0;                // Open connections from one client address
+    unsigned listen_backlog = 0;
+    unsigned idle_timeout_seconds = 120;    // Also keep-alive waits between requests
+};
+
+class TlsCredentials;
 
 class HttpServer {
 private:
@@ -41,12 +156,37 @@ private:
     std::atomic<bool> running_;
     int max_connections_;
     int thread_pool_size_;
+    ThreadingMode threading_mode_;
+    bool reuse_port_ = false;
+    ConnectionLimits connection_limits_;
+    std::shared_ptr<TlsCredentials> tls_credentials_;   // Null: plain HTTP
+    std::string tls_priorities_;
+    size_t max_body_bytes_;     // Limit for bodies buffered in memory
     
 #ifdef HAVE_MICROHTTPD
     struct MHD_Daemon* daemon_;
+    // Built in start() for each configured origin and for requests without
+    // one, then queued again and again; MHD refcounts them
+    std::unordered_map<std::string, struct MHD_Response*> preflight_responses_;
 #endif
     
-    std::map<std::string, std::map<std::string, RouteHandler>> routes_;
+    std::map<std::string, RouteTable> routes_;             // By method
+    std::unordered_map<std::string, UploadOptions> upload_routes_;   // POST paths streamed to disk
+    std::unordered_map<std::string, StreamOptions> stream_routes_;   // POST paths streamed to a sink
+    std::unordered_map<std::string, WebSocketOptions> websocket_routes_;
+    std::mutex channels_mutex_;
+    std::vector<std::weak_ptr<WebSocketChannel>> channels_;  // Closed by stop()
+    std::unique_ptr<RateLimiter> rate_limiter_;     // Per client address, kept once created
+    std::atomic<bool> rate_limit_enabled_{false};
+    std::unique_ptr<ResponseCompressor> compressor_;   // Null: responses go out as built
+    std::unique_ptr<WebSocketProxy> websocket_proxy_;
+    std::string websocket_proxy_path_;
+    HeaderMap default_headers_;     // Added to every response that lacks them
+    
+    // CORS preflights are answered before routing
+    bool cors_enabled_ = false;
+    std::vector<std::string> cors_origins_;
+    std::shared_ptr<const HeaderMap> cors_headers_;     // All but Allow-Origin
     
     // libmicrohttpd callback functions
     static enum MHD_Result access_handler_callback(void* cls,
@@ -57,6 +197,20 @@ private:
                                                    const char* upload_data,
                                                    size_t* upload_data_size,
                                                    void** con_cls);
+    static void request_completed_callback(void* cls,
+                                           struct MHD_Connection* connection,
+                                           void** con_cls,
+                                           enum MHD_RequestTerminationCode toe);
+    static void upgrade_callback(void* cls,
+                                 struct MHD_Connection* connection,
+                                 void* con_cls,
+                                 const char* extra_in,
+                                 size_t extra_in_size,
+                                 MHD_socket sock,
+                                 struct MHD_UpgradeResponseHandle* urh);
+    
+    // Wraps a route handler to record its latency and response status
+    static RouteHandler instrument(const char* method, const std::string& path, RouteHandler handler);
     
     // Helper functions for libmicrohttpd
     void convert_mhd_request(const char* url, const char* method, 
@@ -65,14 +219,39 @@ private:
                              HttpRequest& request);
     struct MHD_Response* create_mhd_response(const HttpResponse& response);
     void add_response_headers(struct MHD_Response* mhd_response, const HttpResponse& response);
+    HttpResponse make_preflight_response(const std::string& origin) const;
+    void build_preflight_responses();
+    void free_preflight_responses();
     
 public:
     HttpServer(const std::string& host, int port, int max_connections = 1000, int thread_pool_size = 4);
     ~HttpServer();
     
-    // Server control
+    // Server control; the threading mode applies from the next start()
+    void set_threading_mode(ThreadingMode mode) { threading_mode_ = mode; }
+    // "select", "thread_pool" or "thread_per_connection"; false if unknown
+    static bool parse_threading_mode(const std::string& name, ThreadingMode& mode);
+    // SO_REUSEPORT on the listening socket, from the next start(). Not
+    // needed under systemd socket activation, where start() takes the
+    // socket passed in LISTEN_FDS.
+    void set_reuse_port(bool enabled) { reuse_port_ = enabled; }
+    // From the next start()
+    void set_connection_limits(const ConnectionLimits& limits) { connection_limits_ = limits; }
+    // Serve HTTPS with these credentials from the next start(); they are
+    // asked on every handshake, so loading new ones applies right away.
+    // priorities is a GnuTLS priority string, empty for MHD's default.
+    void set_tls(std::shared_ptr<TlsCredentials> credentials, std::string priorities = "") {
+        tls_credentials_ = std::move(credentials);
+        tls_priorities_ = std::move(priorities);
+    }
     bool start();
     void stop();
+    // Graceful stop for a restart: stops accepting (new connections go to
+    // the next process or wait in systemd's socket), closes WebSockets a
+    // few at a time over the first half of window so their clients do not
+    // reconnect all at once, gives requests in progress the rest of it,
+    // then stops
+    void drain(std::chrono::seconds window);
     bool is_running() const { return running_; }
     
     // Route registration
@@ -81,11 +260,42 @@ public:
     void put(const std::string& path, RouteHandler handler);
     void del(const std::string& path, RouteHandler handler);
     void options(const std::string& path, RouteHandler handler);
+    // POST route whose multipart/form-data body is written to disk part by
+    // part as it arrives; the handler gets the stored files in
+    // request.uploaded_files and the other fields in request.form_fields
+    void post_upload(const std::string& path, UploadOptions options, RouteHandler handler);
+    // POST route whose raw body is passed to a sink while it arrives, with
+    // nothing buffered; the handler gets the sink in request.body_sink
+    void post_stream(const std::string& path, StreamOptions options, RouteHandler handler);
+    // WebSocket served here; set before start()
+    void websocket(const std::string& path, WebSocketOptions options);
+    // Larger bodies on ordinary routes are refused with 413
+    void set_max_body_size(size_t bytes) { max_body_bytes_ = bytes; }
+    // Requests beyond the rate of one client address get 429; burst 0 is a
+    // minute's worth and requests_per_minute 0 turns limiting off. Safe
+    // to call again while running.
+    void set_rate_limit(unsigned requests_per_minute, unsigned burst = 0);
+    // WebSocket upgrades to path are relayed to backend ("host:port" or
+    // "unix:/path"), so clients need no second port; set before start()
+    void proxy_websocket(const std::string& path, const std::string& backend);
+    // Route responses of at least min_bytes whose Content-Type is listed
+    // ("text/" matches the family) are sent br or gzip encoded when the
+    // client accepts it; min_bytes 0 turns this off. Set before start().
+    void set_compression(size_t min_bytes, std::vector<std::string> content_types);
+    // Built once at startup (security headers, say); set before start()
+    void set_default_headers(HeaderMap headers) { default_headers_ = std::move(headers); }
     
     // Static file serving
     void serve_static_files(const std::string& url_prefix, const std::string& file_system_path);
+    // Same, through a handler already set up (e.g. with a cache policy)
+    void serve_static_files(const std::string& url_prefix, std::shared_ptr<FileHandler> file_handler);
+    // Same, from a tree already loaded into memory
+    void serve_static_files(const std::string& url_prefix, std::shared_ptr<AssetCache> cache);
     
-    // CORS support
+    // CORS support: OPTIONS requests get a preflight answer without
+    // reaching a route. Listed origins (and requests without an Origin)
+    // are served from prebuilt responses, any other origin is echoed.
+    // Call before start().
     void enable_cors(const std::vector<std::string>& allowed_origins,
                     const std::vector<std::string>& allowed_methods,
                     const std::vector<std::string>& allowed_headers);
@@ -3,6 +3,7 @@
 #include <string>
 #include <memory>
 #include <chrono>
+#include <vector>
 #include <jwt-cpp/jwt.h>
 
 struct UserInfo {
@@ -15,6 +16,19 @@ struct UserInfo {
     std::string auth_method;
 };
 
+// Claims of one token, read in a single decode
+struct VerifiedToken {
+    bool valid = false;     // Signature, issuer, audience, expiry and revocation all checked
+    UserInfo user_info;
+    std::string type;       // "access" or "refresh"
+    std::string jti;
+    std::chrono::system_clock::time_point issued_at;
+    std::chrono::system_clock::time_point expires_at;
+    
+    std::string expiry_time() const;    // "YYYY-MM-DD HH:MM:SS UTC"
+    bool is_expired() const;
+};
+
 // Utility function declaration
 std::string get_current_timestamp();
 
@@ -33,6 +47,17 @@ private:
                                const std::string& token_type = "access") const;
     std::string generate_jti() const;
     
+    // Signer and verifiers, built once per secret and only read after
+    // that, so every server thread uses them without locking; copies of a
+    // manager share them
+    struct KeySet;
+    std::shared_ptr<const KeySet> keys_;
+    
+    // Verified tokens and revocations; copies of a manager share them
+    struct TokenCache;
+    std::shared_ptr<TokenCache> token_cache_;
+    bool find_cached(const std::string& token, VerifiedToken& result) const;
+    
 public:
     JWTManager(const std::string& secret, 
                const std::string& issuer, 
@@ -40,7 +65,8 @@ public:
                int token_expiry_minutes,
                int refresh_token_expiry_minutes,
                bool enable_sliding_expiration = true,
-               int token_refresh_threshold_minutes = 10);
+               int token_refresh_threshold_minutes = 10,
+               const std::vector<std::string>& previous_secrets = {});
     
     ~JWTManager() = default;
     
@@ -51,6 +77,23 @@ public:
     // Token validation
     bool validate_token(const std::string& token) const;
     UserInfo extract_user_info(const std::string& token) const;
+    // Checks signature, issuer, audience, expiry and revocation and returns
+    // every claim. A token is decoded only the first time it is seen; later
+    // calls are answered from a small LRU cache. Tokens are signed with
+    // secret and name it by key ID (kid); those naming one of
+    // previous_secrets are still accepted, so a rotated secret does not log
+    // everyone out. Tokens without a kid are checked against secret.
+    VerifiedToken verify_token(const std::string& token) const;
+    // Claims without any checks; valid stays false
+    VerifiedToken decode_token(const std::string& token) const;
+    
+    // Revocation: one token (logout), or every token of a user issued
+    // before now (password change)
+    void revoke_token(const std::string& token);
+    void revoke_user_tokens(const std::string& username);
+    // Keeps revocations in db_path's token_revocations table, loading those
+    // still in force; otherwise they last until restart
+    bool persist_revocations(const std::string& db_path);
     
     // Token refresh
     std::string refresh_access_token(const std::string& refresh_token) const;
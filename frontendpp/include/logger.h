@@ -5,8 +5,11 @@
 #include <string>
 #include <mutex>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <vector>
 
 namespace FrontendPP {
     enum class LogLevel {
@@ -19,23 +22,56 @@ namespace FrontendPP {
 
     class Logger {
     private:
+        struct Entry {
+            std::string line;
+            bool to_console;
+        };
+
         static Logger* instance_;
         static std::mutex mutex_;
-        bool verbose_mode_;
+        std::atomic<bool> verbose_mode_;
         bool file_logging_;
         std::ofstream log_file_;
-        LogLevel min_level_;
-        std::mutex log_mutex_;
+        std::atomic<LogLevel> min_level_;
+        std::mutex log_mutex_;      // Guards the console and log_file_
 
-        Logger() : verbose_mode_(false), file_logging_(false), min_level_(LogLevel::INFO) {}
+        // Async sink: callers append finished lines to queue_ and the writer
+        // thread swaps it out and does all console and file I/O
+        std::atomic<bool> async_enabled_;
+        size_t queue_capacity_;
+        std::chrono::milliseconds flush_interval_;
+        std::vector<Entry> queue_;
+        std::mutex queue_mutex_;
+        std::condition_variable queue_cv_;
+        std::condition_variable drained_cv_;
+        uint64_t queued_sequence_;
+        uint64_t written_sequence_;
+        bool wake_pending_;
+        bool stopping_;
+        bool writer_running_;
+        std::thread::id writer_id_;
+        std::atomic<uint64_t> dropped_count_;
+        uint64_t dropped_reported_;
+        std::thread writer_thread_;
+        std::mutex control_mutex_;  // Serializes enable_async/disable_async
 
-        std::string get_timestamp() const {
-            auto now = std::chrono::system_clock::now();
-            auto time_t = std::chrono::system_clock::to_time_t(now);
-            std::stringstream ss;
-            ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-            return ss.str();
-        }
+        // Access log: one line per request, every Nth request body attached
+        std::atomic<bool> access_log_;
+        std::atomic<unsigned int> body_sample_rate_;
+        std::atomic<size_t> body_sample_bytes_;
+        std::atomic<uint64_t> access_count_;
+
+        Logger() : verbose_mode_(false), file_logging_(false), min_level_(LogLevel::INFO),
+                   async_enabled_(false), queue_capacity_(0), flush_interval_(0),
+                   queued_sequence_(0), written_sequence_(0), wake_pending_(false), stopping_(false), writer_running_(false),
+                   dropped_count_(0), dropped_reported_(0),
+                   access_log_(false), body_sample_rate_(0), body_sample_bytes_(256), access_count_(0) {}
+
+        // "YYYY-MM-DD HH:MM:SS", formatted once per second per thread
+        static const char* get_timestamp();
+
+        void write_entry(const Entry& entry);
+        void writer_loop();
 
         std::string level_to_string(LogLevel level) const {
             switch (level) {
@@ -67,6 +103,20 @@ namespace FrontendPP {
             // Don't log here to avoid deadlock - caller can log separately if needed
         }
 
+        // Moves all console and file output to a background thread. log()
+        // only formats and queues the line; the writer flushes once per
+        // batch, every flush_interval or sooner for errors and a queue half
+        // full. Lines that find capacity entries already queued are dropped
+        // and counted.
+        bool enable_async(size_t capacity = 4096,
+                          std::chrono::milliseconds flush_interval = std::chrono::milliseconds(200));
+        // Writes out the queue and goes back to synchronous output
+        void disable_async();
+        // Blocks until every line queued so far has been written
+        void flush();
+
+        uint64_t get_dropped_count() const { return dropped_count_.load(std::memory_order_relaxed); }
+
         void enable_file_logging(const std::string& filename) {
             std::lock_guard<std::mutex> lock(log_mutex_);
             log_file_.open(filename, std::ios::app);
@@ -77,31 +127,40 @@ namespace FrontendPP {
             }
         }
 
-        void set_min_level(LogLevel level) {
+        bool file_logging_enabled() {
             std::lock_guard<std::mutex> lock(log_mutex_);
-            min_level_ = level;
+            return file_logging_;
         }
 
-        void log(LogLevel level, const std::string& message) {
-            if (level < min_level_) return;
+        void set_min_level(LogLevel level) {
+            min_level_.store(level);
+        }
 
-            std::lock_guard<std::mutex> lock(log_mutex_);
-            std::string timestamp = get_timestamp();
-            std::string level_str = level_to_string(level);
-            std::string log_entry = "[" + timestamp + "] [" + level_str + "] " + message;
+        // "debug", "info", "warning", "error" or "critical"; false if unknown
+        static bool parse_level(const std::string& name, LogLevel& level);
 
-            // Always log to console if verbose mode is enabled or level is high enough
-            if (verbose_mode_ || level >= LogLevel::WARNING) {
-                std::cout << log_entry << std::endl;
-            }
+        bool is_enabled(LogLevel level) const {
+            return level >= min_level_.load(std::memory_order_relaxed);
+        }
 
-            // Log to file if enabled
-            if (file_logging_ && log_file_.is_open()) {
-                log_file_ << log_entry << std::endl;
-                log_file_.flush();
-            }
+        void log(LogLevel level, const std::string& message);
+
+        // body_sample_rate 0 never captures bodies; otherwise the first
+        // body_sample_bytes of every Nth request body are logged, escaped.
+        // Bodies of credential endpoints are never captured.
+        void set_access_log(bool enabled, unsigned int body_sample_rate = 0, size_t body_sample_bytes = 256) {
+            body_sample_rate_.store(body_sample_rate);
+            body_sample_bytes_.store(body_sample_bytes);
+            access_log_.store(enabled);
         }
 
+        bool access_log_enabled() const { return access_log_.load(std::memory_order_relaxed); }
+
+        // "access method=POST path=/x status=200 ip=... req_bytes=... resp_bytes=... ms=..."
+        void log_access(const std::string& method, const std::string& path, const std::string& client_ip,
+                        int status_code, size_t request_bytes, size_t response_bytes,
+                        double duration_ms, const std::string& body);
+
         void log_http_request(const std::string& method, const std::string& path, const std::string& client_ip) {
             if (verbose_mode_) {
                 log(LogLevel::DEBUG, "HTTP " + method + " " + path + " from " + client_ip);
@@ -153,6 +212,7 @@ namespace FrontendPP {
         }
 
         ~Logger() {
+            disable_async();
             if (log_file_.is_open()) {
                 log_file_.close();
             }
@@ -166,6 +226,28 @@ namespace FrontendPP {
     #define LOG_ERROR(message)    FrontendPP::Logger::get_instance().log(FrontendPP::LogLevel::ERROR, message)
     #define LOG_CRITICAL(message) FrontendPP::Logger::get_instance().log(FrontendPP::LogLevel::CRITICAL, message)
 
+    // Per-request tracing. Compiled out unless FRONTENDPP_HTTP_TRACE is
+    // defined, and even then the message is only built at DEBUG level.
+    #ifdef FRONTENDPP_HTTP_TRACE
+    #define LOG_TRACE(message) \
+        do { \
+            if (FrontendPP::Logger::get_instance().is_enabled(FrontendPP::LogLevel::DEBUG)) \
+                FrontendPP::Logger::get_instance().log(FrontendPP::LogLevel::DEBUG, message); \
+        } while (0)
+    #else
+    #define LOG_TRACE(message) do { } while (0)
+    #endif
+
+    #define LOG_HTTP_ACCESS(req, status, response_bytes, started) \
+        do { \
+            auto& access_logger_ = FrontendPP::Logger::get_instance(); \
+            if (access_logger_.access_log_enabled()) { \
+                std::chrono::duration<double, std::milli> elapsed_ = std::chrono::steady_clock::now() - (started); \
+                access_logger_.log_access((req).method, (req).path, (req).client_ip, status, \
+                                          (req).body.size(), response_bytes, elapsed_.count(), (req).body); \
+            } \
+        } while (0)
+
     #define LOG_HTTP_REQUEST(method, path, ip) \
         FrontendPP::Logger::get_instance().log_http_request(method, path, ip)
     #define LOG_HTTP_RESPONSE(status, size) \
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "sqlite_pool.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The writes a successful login causes, kept off the request path: the
+// user's last_login and a login_audit row are queued and written by one
+// background thread, a batch per transaction, so a login answers after
+// the credential check instead of after a SQLite commit.
+//   - record() never waits for the database. Past max_queued pending
+//     logins it drops the record and counts it.
+//   - A batch is written once the first login in it is kBatchDelay old,
+//     so a burst of logins costs one commit.
+//   - stop() (and the destructor) writes whatever is still queued;
+//     later records are dropped.
+class LoginRecorder {
+public:
+    struct Login {
+        std::string username;
+        std::string method;         // "password" or "key"
+        std::string client_ip;
+        std::string key_id;         // Auth key used, for method "key"
+        std::string at;             // Same format as users.last_login
+    };
+
+    explicit LoginRecorder(const std::string& db_path, size_t max_queued = 1024);
+    ~LoginRecorder();
+
+    LoginRecorder(const LoginRecorder&) = delete;
+    LoginRecorder& operator=(const LoginRecorder&) = delete;
+
+    void record(Login login);
+    // Returns once every login recorded before the call is written
+    void flush();
+    void stop();
+
+private:
+    static constexpr std::chrono::milliseconds kBatchDelay{200};
+    // login_audit rows older than this are deleted, at most once an hour
+    static constexpr std::chrono::hours kAuditRetention{24 * 90};
+
+    std::unique_ptr<SqlitePool> db_pool_;
+    size_t max_queued_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable written_;
+    std::vector<Login> queue_;
+    uint64_t queued_total_ = 0;     // Logins ever queued
+    uint64_t written_total_ = 0;    // Of those, how many were handled
+    uint64_t dropped_ = 0;          // Since the last warning
+    bool flushing_ = false;         // flush() is waiting; skip kBatchDelay
+    bool stopping_ = false;
+    std::thread thread_;
+
+    void run();
+    void write_batch(const std::vector<Login>& batch);
+    void prune_audit();
+};
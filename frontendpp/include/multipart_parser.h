@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cstddef>
+
+// Incremental multipart/form-data reader. Bytes are fed in whatever chunks
+// the connection delivers; part bodies are handed on as they are scanned,
+// without being collected, and a delimiter split across chunks is still
+// found. The delimiter search is Boyer-Moore-Horspool, so long bodies are
+// skipped over in strides of up to the delimiter's length.
+class MultipartParser {
+public:
+    // Each callback returns false to stop the parse
+    using PartBegin = std::function<bool(std::string_view headers)>;
+    using PartData = std::function<bool(const char* data, size_t size)>;
+    using PartEnd = std::function<bool()>;
+
+    MultipartParser(const std::string& boundary, PartBegin on_begin, PartData on_data, PartEnd on_end);
+
+    // False once the body is malformed or a callback refused it
+    bool feed(const char* data, size_t size);
+    // True when the closing delimiter has been seen
+    bool finish() const { return state_ == State::Done; }
+    bool failed() const { return state_ == State::Failed; }
+
+    // Boundary parameter of a multipart Content-Type, empty if there is none
+    static std::string boundary_from_content_type(std::string_view content_type);
+    // Value of a header in a part's header block, matched case-insensitively
+    static std::string_view header_value(std::string_view headers, std::string_view name);
+    // A parameter such as name or filename of a header value, unquoted;
+    // found reports whether it was present at all
+    static std::string header_param(std::string_view value, std::string_view param, bool* found = nullptr);
+
+private:
+    enum class State { Preamble, Delimiter, Headers, Body, Done, Failed };
+
+    static const size_t kMaxHeaderBytes = 16 * 1024;
+
+    std::string delimiter_;         // "\r\n--" + boundary
+    size_t skip_[256];
+    State state_ = State::Preamble;
+    std::string carry_;             // Body bytes that may start a delimiter
+    std::string buffer_;            // Delimiter suffix or headers seen so far
+    PartBegin on_begin_;
+    PartData on_data_;
+    PartEnd on_end_;
+
+    size_t search(const char* data, size_t size) const;
+    // Each returns the bytes of data it used
+    size_t scan_body(const char* data, size_t size);
+    size_t scan_delimiter_end(const char* data, size_t size);
+    size_t scan_headers(const char* data, size_t size);
+    bool emit(const char* data, size_t size);
+};
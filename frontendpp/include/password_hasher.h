@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+
+// Password hashing on a small pool of its own threads, so a burst of
+// logins costs those threads and not the HTTP workers. Stored hashes carry
+// their algorithm and cost:
+//
+//     $pbkdf2-sha256$i=<iterations>$<salt hex>$<key hex>
+//
+// The unsalted SHA-256 hex written by earlier versions still verifies and
+// is reported as needing a rehash, as is any hash below the current cost.
+class PasswordHasher {
+public:
+    struct Options {
+        int iterations = 100000;    // PBKDF2-HMAC-SHA256 rounds
+        size_t workers = 2;
+        size_t max_queued = 32;     // Jobs beyond this are refused
+    };
+    
+    struct Result {
+        bool matched = false;
+        std::string rehash;         // Set when matched on an outdated hash
+    };
+    
+    explicit PasswordHasher(const Options& options);
+    ~PasswordHasher();
+    
+    PasswordHasher(const PasswordHasher&) = delete;
+    PasswordHasher& operator=(const PasswordHasher&) = delete;
+    
+    // Run inline on the calling thread
+    std::string hash(const std::string& password) const;
+    Result verify(const std::string& password, const std::string& stored) const;
+    
+    // Run on the pool; the returned future is invalid when the queue is full
+    std::future<std::string> hash_async(std::string password);
+    std::future<Result> verify_async(std::string password, std::string stored);
+    
+private:
+    Options options_;
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> jobs_;
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_cv_;
+    bool stopping_;
+    
+    bool submit(std::function<void()> job);
+    void worker_loop();
+};
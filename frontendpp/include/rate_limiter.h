@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+// Per-client token buckets in a fixed table, safe to call from every MHD
+// thread without locks. Each bucket is one 64-bit word updated by CAS. The
+// table is split into shards that each have a clock hand; lookups advance
+// the hand and free buckets that have refilled completely, which are the
+// same as a client never seen. A client whose probe window is full of busy
+// buckets shares the shard's overflow bucket, so memory never grows.
+class RateLimiter {
+public:
+    // burst is the bucket size; 0 means one minute's worth of requests
+    explicit RateLimiter(unsigned requests_per_minute, unsigned burst = 0);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // New rate and burst for every client, safe while allow() runs; buckets
+    // above the new burst are cut down on their next refill
+    void set_rate(unsigned requests_per_minute, unsigned burst = 0);
+
+    // key identifies the client and must not be 0. Takes a token, or
+    // returns false with the seconds until one is available.
+    bool allow(uint64_t key, unsigned* retry_after_seconds = nullptr);
+
+    // Hashes a client address into a key
+    static uint64_t key_for(const void* address, size_t size);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> key{0};
+        // Refill time in ms since start_ (high bits) and milli-tokens
+        std::atomic<uint64_t> state{0};
+    };
+
+    struct Shard {
+        std::unique_ptr<Slot[]> slots;
+        Slot overflow;
+        std::atomic<uint32_t> hand{0};
+    };
+
+    static const size_t kShardCount = 16;
+
+    std::atomic<uint64_t> requests_per_minute_;     // Also milli-tokens gained per 60 ms
+    std::atomic<uint64_t> capacity_;                // Milli-tokens
+    std::chrono::steady_clock::time_point start_;
+    Shard shards_[kShardCount];
+
+    uint64_t now_ms() const;
+    // Milli-tokens and refill time of a bucket state as of now
+    void refill(uint64_t state, uint64_t now, uint64_t& tokens, uint64_t& time) const;
+    bool is_idle(const Slot& slot, uint64_t now) const;
+    Slot& find_slot(Shard& shard, uint64_t key, uint64_t now);
+    void sweep(Shard& shard, uint64_t now);
+    bool take(Slot& slot, uint64_t now, unsigned* retry_after_seconds);
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "http_server.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace UrMetrics { class Counter; }
+
+// Compresses route responses built in memory (set_json_content() and the
+// like) for clients that accept it, brotli before gzip.
+//   - Only bodies of at least min_bytes whose Content-Type is listed are
+//     compressed; an entry ending in '/' ("text/") matches the family.
+//   - File, shared and streamed bodies are left alone: static assets come
+//     precompressed from AssetCache, and the others are large or chunked.
+//   - Each server thread keeps one zlib stream and resets it between
+//     responses instead of setting up the compressor every time.
+// Safe to call from every MHD thread at once.
+class ResponseCompressor {
+public:
+    ResponseCompressor(size_t min_bytes, std::vector<std::string> content_types);
+
+    ResponseCompressor(const ResponseCompressor&) = delete;
+    ResponseCompressor& operator=(const ResponseCompressor&) = delete;
+
+    // Replaces response.body with its encoding when the request accepts
+    // one and the response qualifies; true if it did. Responses that
+    // qualify get Vary: Accept-Encoding either way.
+    bool compress(const HttpRequest& request, HttpResponse& response) const;
+
+private:
+    size_t min_bytes_;
+    std::vector<std::string> content_types_;
+    UrMetrics::Counter* gzip_responses_;
+    UrMetrics::Counter* brotli_responses_;
+    UrMetrics::Counter* saved_bytes_;
+
+    bool is_listed(std::string_view content_type) const;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "sqlite_pool.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Revoked token IDs (logout) and users whose older tokens are revoked
+// (password change), kept in the token_revocations table so a restart does
+// not bring them back.
+//   - In memory they are an exact map behind a bloom filter of fixed size.
+//     A token that was never revoked, the common case, is answered by
+//     probing the filter, without a lock or a query.
+//   - An entry is dropped once every token it can match has expired: a
+//     revoked ID with its token, a user with the longest token lifetime.
+//     Expired entries are swept at most once a minute, on a revocation,
+//     and the filter is rebuilt from what is left.
+// Safe to use from every server thread.
+class RevocationList {
+public:
+    using Clock = std::chrono::system_clock;
+
+    RevocationList();
+
+    RevocationList(const RevocationList&) = delete;
+    RevocationList& operator=(const RevocationList&) = delete;
+
+    // Loads the unexpired rows of token_revocations in db_path and writes
+    // later revocations there; without it revocations last until restart
+    bool attach(const std::string& db_path);
+
+    void revoke_token(const std::string& jti, Clock::time_point expires_at);
+    // Tokens of username issued before before; remembered until until
+    void revoke_user(const std::string& username, Clock::time_point before, Clock::time_point until);
+
+    bool is_revoked(const std::string& jti, const std::string& username, Clock::time_point issued_at) const;
+
+private:
+    struct UserEntry {
+        Clock::time_point before;
+        Clock::time_point until;
+    };
+
+    // 64 Kbit: a false positive rate well under 1% up to a few thousand
+    // live revocations, which only costs a locked map lookup
+    static const size_t kFilterBits = 1 << 16;
+    static const int kFilterHashes = 4;
+    static constexpr std::chrono::minutes kSweepInterval{1};
+
+    std::array<std::atomic<uint64_t>, kFilterBits / 64> filter_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Clock::time_point> tokens_;     // jti -> token expiry
+    std::unordered_map<std::string, UserEntry> users_;
+    std::unique_ptr<SqlitePool> db_pool_;
+    Clock::time_point next_sweep_;
+
+    static size_t filter_bit(uint64_t hash, int i);
+    void add_to_filter(uint64_t hash);
+    bool filter_contains(uint64_t hash) const;
+    bool persist(const std::string& kind, const std::string& key, Clock::time_point before, Clock::time_point until);
+    // Caller holds mutex_
+    void sweep(Clock::time_point now);
+};
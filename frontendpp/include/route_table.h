@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <utility>
+
+struct HttpRequest;
+struct HttpResponse;
+
+using RouteHandler = std::function<HttpResponse(const HttpRequest&)>;
+
+// Routes of one HTTP method. Exact paths sit in a hash table; paths with
+// ":name" segments or a trailing "/*" go into a segment trie, which is
+// walked once per request over views of the path. The most specific
+// route wins: exact, then literal segments over parameters, then the
+// longest wildcard prefix.
+class RouteTable {
+public:
+    static constexpr size_t kMaxParams = 8;
+    
+    struct Match {
+        const RouteHandler* handler = nullptr;
+        size_t param_count = 0;
+        // Views into the matched path, valid while it is
+        std::pair<const std::string*, std::string_view> params[kMaxParams];
+    };
+    
+    RouteTable();
+    ~RouteTable();
+    RouteTable(RouteTable&&) noexcept;
+    RouteTable& operator=(RouteTable&&) noexcept;
+    
+    // "/api/users", "/api/users/:id" or "/static/*" ("/*" matches the
+    // prefix itself and anything below it). Re-adding a pattern replaces it.
+    void add(const std::string& pattern, RouteHandler handler);
+    
+    bool match(const std::string& path, Match& match) const;
+    
+private:
+    struct Node;
+    
+    std::unordered_map<std::string, RouteHandler> exact_;
+    std::unique_ptr<Node> root_;
+    
+    static bool match_node(const Node& node, std::string_view rest, bool done, Match& match);
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// SQLite connections for concurrent request threads. Each caller leases a
+// connection of its own for the length of a query, so the MHD thread pool
+// never serialises on a shared handle, and every connection keeps its
+// prepared statements for reuse. The database runs in WAL mode, which lets
+// readers proceed alongside a writer.
+class SqlitePool {
+public:
+    class Lease {
+    public:
+        ~Lease();
+        Lease(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+        
+        explicit operator bool() const { return connection_ != nullptr; }
+        sqlite3* db() const;
+        // Prepared on first use per connection, then reused; reset with
+        // its bindings cleared when the lease ends. sql must be a string
+        // literal, as it is the cache key. Null if it fails to prepare.
+        sqlite3_stmt* prepare(const char* sql);
+        
+    private:
+        friend class SqlitePool;
+        struct Connection;
+        
+        Lease(SqlitePool* pool, std::unique_ptr<Connection> connection);
+        
+        SqlitePool* pool_;
+        std::unique_ptr<Connection> connection_;
+        std::vector<sqlite3_stmt*> used_;
+    };
+    
+    // Keeps at most max_idle connections open between leases
+    explicit SqlitePool(const std::string& path, size_t max_idle = 8);
+    ~SqlitePool();
+    
+    SqlitePool(const SqlitePool&) = delete;
+    SqlitePool& operator=(const SqlitePool&) = delete;
+    
+    // An idle connection, or a new one; test the lease before use
+    Lease acquire();
+    
+private:
+    std::string path_;
+    size_t max_idle_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Lease::Connection>> idle_;
+    
+    void release(std::unique_ptr<Lease::Connection> connection);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The certificate chain and private key HttpServer presents over HTTPS.
+// libmicrohttpd asks for them on every handshake through handshake_callback(),
+// so load() can swap in a renewed certificate while the server runs.
+//   - Any key type GnuTLS supports works; an ECDSA (P-256) key makes the
+//     cheapest handshakes on small devices.
+//   - A load() that fails keeps the certificate in use.
+//   - Handshakes may still hold a replaced certificate, so every one
+//     loaded stays in memory until the process exits; renewals are rare.
+// Only one instance serves handshakes at a time, the last activate()d.
+// Without GnuTLS (HAVE_GNUTLS) load() always fails.
+class TlsCredentials {
+public:
+    TlsCredentials();
+    ~TlsCredentials();
+
+    TlsCredentials(const TlsCredentials&) = delete;
+    TlsCredentials& operator=(const TlsCredentials&) = delete;
+
+    // PEM files: the certificate followed by its chain, and its key
+    bool load(const std::string& cert_file, const std::string& key_file);
+    bool loaded() const { return current_.load(std::memory_order_acquire) != nullptr; }
+
+    void activate();
+    // A gnutls_certificate_retrieve_function2, for MHD_OPTION_HTTPS_CERT_CALLBACK
+    static void* handshake_callback();
+
+private:
+    struct Bundle;
+    friend struct TlsHandshake;     // The callback, which needs GnuTLS types
+
+    std::mutex load_mutex_;
+    std::vector<std::unique_ptr<Bundle>> bundles_;     // Every one loaded, the last in use
+    std::atomic<const Bundle*> current_{nullptr};
+
+    static std::atomic<TlsCredentials*> active_;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// The server side of a WebSocket answered by this server itself (not
+// proxied). Push only: text frames are sent without blocking and anything
+// the client sends is ignored, which is all a progress feed needs. A
+// client that is gone or too slow to take a frame closes the channel.
+class WebSocketChannel {
+public:
+    // on_closed hands the socket back to the server; it runs once, from
+    // close() or the destructor
+    WebSocketChannel(int fd, std::function<void()> on_closed);
+    ~WebSocketChannel();
+
+    WebSocketChannel(const WebSocketChannel&) = delete;
+    WebSocketChannel& operator=(const WebSocketChannel&) = delete;
+
+    // Sec-WebSocket-Accept for a client's Sec-WebSocket-Key
+    static std::string accept_key(std::string_view client_key);
+
+    // False once the channel is closed
+    bool send_text(std::string_view text);
+    bool is_open() const;
+    // Sends a close frame, with status unless it is 0, and releases the
+    // socket
+    void close(uint16_t status = 0);
+
+private:
+    int fd_;
+    std::function<void()> on_closed_;
+    mutable std::mutex mutex_;
+    bool open_ = true;
+
+    bool send_frame(unsigned char opcode, std::string_view payload);
+    void close_locked();
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "flat_string_map.h"
+
+struct HttpRequest;
+
+// A client upgrade accepted by the backend, waiting for the server to
+// switch the client connection over
+struct ProxyTunnel {
+    int backend_fd = -1;
+    HeaderMap response_headers;     // From the backend's 101, for the client
+    std::string backend_extra;      // Sent by the backend after its headers
+
+    ProxyTunnel() = default;
+    ProxyTunnel(const ProxyTunnel&) = delete;
+    ProxyTunnel& operator=(const ProxyTunnel&) = delete;
+    ~ProxyTunnel();
+};
+
+// Forwards WebSocket upgrades to backend-datalink, so the browser reaches
+// both daemons through the frontend's port. The client's upgrade request
+// is replayed to the backend and the backend's handshake answer is handed
+// back; once the server has switched protocols, frames are moved between
+// the two sockets with splice() and never copied into user space.
+class WebSocketProxy {
+public:
+    // backend is "host:port" or "unix:/path/to/socket"
+    explicit WebSocketProxy(std::string backend);
+    ~WebSocketProxy();
+
+    WebSocketProxy(const WebSocketProxy&) = delete;
+    WebSocketProxy& operator=(const WebSocketProxy&) = delete;
+
+    const std::string& backend() const { return backend_; }
+
+    // Connects and replays the upgrade request. Null when the backend is
+    // unreachable or does not answer 101 Switching Protocols.
+    std::unique_ptr<ProxyTunnel> open(const HttpRequest& request) const;
+
+    // Relays between client_fd and the tunnel on threads of their own until
+    // both directions are closed; extra_in holds client bytes read past the
+    // request. on_closed runs last, on the relay thread, and must release
+    // client_fd.
+    void relay(std::unique_ptr<ProxyTunnel> tunnel, int client_fd,
+               const char* extra_in, size_t extra_in_size,
+               std::function<void()> on_closed);
+
+    // Ends every open relay and waits for them to finish
+    void close_all();
+    // Ends the oldest relay not already ending, without waiting; false if
+    // there is none
+    bool close_one();
+    size_t relay_count();
+
+private:
+    struct Relay {
+        int client_fd;
+        int backend_fd;
+        bool closing;
+    };
+
+    std::string backend_;
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    std::vector<Relay> relays_;     // Running relays, oldest first
+    size_t active_ = 0;
+
+    int connect_backend() const;
+};
@@ -0,0 +1,610 @@
+#include "asset_cache.h"
+#include "logger.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <nlohmann/json.hpp>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Smaller text files gain too little from compression to bother
+const size_t kMinCompressBytes = 512;
+// Larger files (backups, firmware images) stay on disk and go out with sendfile()
+const uintmax_t kMaxAssetBytes = 4 * 1024 * 1024;
+
+const uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE;
+
+// A fingerprinted name never gets different content
+const char* const kImmutableCacheControl = "public, max-age=31536000, immutable";
+
+bool is_compressible(const std::string& content_type) {
+    return content_type.compare(0, 5, "text/") == 0 ||
+           content_type == "application/javascript" ||
+           content_type == "application/json" ||
+           content_type == "application/xml" ||
+           content_type == "image/svg+xml";
+}
+
+bool ends_with(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::shared_ptr<const std::string> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    return std::make_shared<const std::string>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// A variant deployed next to the source, if it is at least as new
+std::shared_ptr<const std::string> read_precompressed(const std::string& path, const struct stat& source) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || st.st_mtime < source.st_mtime) {
+        return nullptr;
+    }
+    return read_file(path);
+}
+
+std::shared_ptr<const std::string> gzip_compress(const std::string& data) {
+#ifdef HAVE_ZLIB
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return nullptr;
+    }
+    std::string out(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    int result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        return nullptr;
+    }
+    return std::make_shared<const std::string>(std::move(out));
+#else
+    (void)data;
+    return nullptr;
+#endif
+}
+
+std::shared_ptr<const std::string> brotli_compress(const std::string& data) {
+#ifdef HAVE_BROTLI
+    size_t length = BrotliEncoderMaxCompressedSize(data.size());
+    if (length == 0) {
+        return nullptr;
+    }
+    std::string out(length, '\0');
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               data.size(), reinterpret_cast<const uint8_t*>(data.data()),
+                               &length, reinterpret_cast<uint8_t*>(&out[0]))) {
+        return nullptr;
+    }
+    out.resize(length);
+    return std::make_shared<const std::string>(std::move(out));
+#else
+    (void)data;
+    return nullptr;
+#endif
+}
+
+// Pages keep their names; everything they load is fingerprinted
+bool is_page(const std::string& path) {
+    return ends_with(path, ".html") || ends_with(path, ".htm");
+}
+
+// "assets/js/app.js" -> "assets/js/app.<hash>.js"
+std::string fingerprinted_path(const std::string& path, const std::string& content) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(FileHandler::content_hash(content)));
+    size_t name = path.rfind('/');
+    name = name == std::string::npos ? 0 : name + 1;
+    size_t dot = path.rfind('.');
+    if (dot == std::string::npos || dot <= name) {
+        return path + "." + hash;
+    }
+    return path.substr(0, dot) + "." + hash + path.substr(dot);
+}
+
+// The root-relative path a reference from page_path points at, as a
+// browser resolves it; empty for other sites and schemes (data:, mailto:)
+std::string resolve_reference(const std::string& page_path, const std::string& reference) {
+    size_t colon = reference.find(':');
+    if (reference.empty() || reference.compare(0, 2, "//") == 0 ||
+        (colon != std::string::npos && colon < reference.find('/'))) {
+        return "";
+    }
+    std::string joined = reference;
+    if (joined.front() == '/') {
+        joined.erase(0, 1);
+    } else {
+        size_t slash = page_path.rfind('/');
+        if (slash != std::string::npos) {
+            joined = page_path.substr(0, slash + 1) + joined;
+        }
+    }
+    
+    std::vector<std::string> segments;
+    size_t pos = 0;
+    while (pos <= joined.size()) {
+        size_t end = joined.find('/', pos);
+        if (end == std::string::npos) {
+            end = joined.size();
+        }
+        std::string segment = joined.substr(pos, end - pos);
+        pos = end + 1;
+        if (segment == "..") {
+            if (!segments.empty()) {
+                segments.pop_back();
+            }
+        } else if (!segment.empty() && segment != ".") {
+            segments.push_back(std::move(segment));
+        }
+    }
+    std::string resolved;
+    for (const auto& segment : segments) {
+        resolved += resolved.empty() ? segment : "/" + segment;
+    }
+    return resolved;
+}
+
+// Fills in the variants not deployed precompressed and keeps only those
+// that actually save bytes
+void add_compressed_variants(AssetCache::Asset& asset) {
+    if (!is_compressible(asset.content_type) || asset.identity->size() < kMinCompressBytes) {
+        return;
+    }
+    if (!asset.gzip) {
+        asset.gzip = gzip_compress(*asset.identity);
+    }
+    if (!asset.brotli) {
+        asset.brotli = brotli_compress(*asset.identity);
+    }
+    if (asset.gzip && asset.gzip->size() >= asset.identity->size()) {
+        asset.gzip.reset();
+    }
+    if (asset.brotli && asset.brotli->size() >= asset.identity->size()) {
+        asset.brotli.reset();
+    }
+}
+
+} // namespace
+
+AssetCache::AssetCache(const std::string& root)
+    : root_(root), file_handler_(root), assets_(std::make_shared<const AssetMap>()),
+      inotify_fd_(-1), stop_pipe_{-1, -1}, watching_(false) {
+}
+
+AssetCache::~AssetCache() {
+    stop_watching();
+}
+
+size_t AssetCache::load() {
+    auto assets = std::make_shared<AssetMap>();
+    size_t bytes = 0;
+    // Pages are loaded last, once the names they are rewritten to are known
+    std::vector<std::string> pages;
+    
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(root_, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec) || it->file_size(ec) > kMaxAssetBytes) {
+            continue;
+        }
+        std::string relative_path = fs::relative(it->path(), root_, ec).generic_string();
+        // Precompressed variants belong to the file they were made from
+        if (ec || ends_with(relative_path, ".gz") || ends_with(relative_path, ".br")) {
+            continue;
+        }
+        if (fingerprint_ && is_page(relative_path)) {
+            pages.push_back(relative_path);
+            continue;
+        }
+        auto asset = load_asset(relative_path);
+        if (asset) {
+            bytes += asset->identity->size();
+            (*assets)[relative_path] = std::move(asset);
+        }
+    }
+    
+    manifest_.clear();
+    if (fingerprint_) {
+        AssetMap files = *assets;
+        for (const auto& file : files) {
+            update_alias(*assets, file.first, file.second);
+        }
+        for (const auto& page : pages) {
+            auto asset = load_asset(page);
+            if (asset) {
+                bytes += asset->identity->size();
+                (*assets)[page] = std::move(asset);
+            }
+        }
+    }
+    if (!bundle_dir_.empty()) {
+        add_bundle(*assets);
+    }
+    
+    size_t count = assets->size() - manifest_.size();
+    {
+        std::lock_guard<std::mutex> lock(assets_mutex_);
+        assets_ = std::move(assets);
+    }
+    LOG_INFO("Asset cache: " + std::to_string(count) + " files, " + std::to_string(bytes / 1024) + " KB from " + root_ +
+             (fingerprint_ ? ", " + std::to_string(manifest_.size()) + " fingerprinted" : ""));
+    return count;
+}
+
+void AssetCache::set_cache_policy(const std::vector<std::pair<std::string, std::string>>& rules) {
+    file_handler_.set_cache_policy(rules);
+}
+
+size_t AssetCache::size() const {
+    std::lock_guard<std::mutex> lock(assets_mutex_);
+    return assets_->size();
+}
+
+std::shared_ptr<const AssetCache::Asset> AssetCache::load_asset(const std::string& relative_path) const {
+    std::string full_path = root_ + "/" + relative_path;
+    struct stat st;
+    if (::stat(full_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) ||
+        static_cast<uintmax_t>(st.st_size) > kMaxAssetBytes) {
+        return nullptr;
+    }
+    
+    auto asset = std::make_shared<Asset>();
+    asset->identity = read_file(full_path);
+    if (!asset->identity) {
+        return nullptr;
+    }
+    // .gz and .br files next to a rewritten page do not match it any more
+    bool rewritten = false;
+    if (fingerprint_ && is_page(relative_path) && !manifest_.empty()) {
+        std::string html = rewrite_references(*asset->identity, relative_path);
+        if (html != *asset->identity) {
+            asset->identity = std::make_shared<const std::string>(std::move(html));
+            rewritten = true;
+        }
+    }
+    asset->content_type = file_handler_.get_mime_type(file_handler_.get_file_extension(relative_path));
+    asset->mtime = st.st_mtime;
+    asset->last_modified = FileHandler::format_http_date(st.st_mtime);
+    asset->etag = FileHandler::compute_etag(*asset->identity);
+    
+    if (is_compressible(asset->content_type) && asset->identity->size() >= kMinCompressBytes && !rewritten) {
+        asset->gzip = read_precompressed(full_path + ".gz", st);
+        asset->brotli = read_precompressed(full_path + ".br", st);
+    }
+    add_compressed_variants(*asset);
+    return asset;
+}
+
+bool AssetCache::update_alias(AssetMap& assets, const std::string& relative_path,
+                              const std::shared_ptr<const Asset>& asset) {
+    std::string alias = asset ? fingerprinted_path(relative_path, *asset->identity) : "";
+    auto previous = manifest_.find(relative_path);
+    std::string previous_alias = previous != manifest_.end() ? previous->second : "";
+    if (!previous_alias.empty() && previous_alias != alias) {
+        assets.erase(previous_alias);
+    }
+    if (asset) {
+        auto immutable = std::make_shared<Asset>(*asset);
+        immutable->immutable = true;
+        assets[alias] = std::move(immutable);
+        manifest_[relative_path] = alias;
+    } else {
+        manifest_.erase(relative_path);
+    }
+    return previous_alias != alias;
+}
+
+// src= and href= values naming a fingerprinted file get its name, keeping
+// the directory part, query and fragment as written
+std::string AssetCache::rewrite_references(const std::string& html, const std::string& relative_path) const {
+    std::string out;
+    out.reserve(html.size());
+    size_t pos = 0;
+    for (;;) {
+        size_t src = html.find("src=", pos);
+        size_t href = html.find("href=", pos);
+        size_t attribute = std::min(src, href);
+        if (attribute == std::string::npos) {
+            break;
+        }
+        size_t quote = attribute + (attribute == src ? 4 : 5);
+        if (attribute == 0 || !std::isspace(static_cast<unsigned char>(html[attribute - 1])) ||
+            quote >= html.size() || (html[quote] != '"' && html[quote] != '\'')) {
+            out.append(html, pos, quote - pos);
+            pos = quote;
+            continue;
+        }
+        size_t end = html.find(html[quote], quote + 1);
+        if (end == std::string::npos) {
+            break;
+        }
+        
+        out.append(html, pos, quote + 1 - pos);
+        std::string value = html.substr(quote + 1, end - quote - 1);
+        size_t suffix = value.find_first_of("?#");
+        std::string target = value.substr(0, suffix);
+        auto alias = manifest_.find(resolve_reference(relative_path, target));
+        if (alias != manifest_.end()) {
+            size_t slash = target.rfind('/');
+            out += target.substr(0, slash == std::string::npos ? 0 : slash + 1);
+            out += alias->second.substr(alias->second.rfind('/') + 1);
+            out += suffix == std::string::npos ? "" : value.substr(suffix);
+        } else {
+            out += value;
+        }
+        pos = end;
+    }
+    out.append(html, pos, std::string::npos);
+    return out;
+}
+
+void AssetCache::set_bundle(const std::string& directory) {
+    bundle_dir_ = directory;
+    while (!bundle_dir_.empty() && bundle_dir_.back() == '/') {
+        bundle_dir_.pop_back();
+    }
+}
+
+bool AssetCache::in_bundle(const std::string& relative_path) const {
+    return !bundle_dir_.empty() && relative_path.size() > bundle_dir_.size() + 1 &&
+           relative_path.compare(0, bundle_dir_.size() + 1, bundle_dir_ + "/") == 0 &&
+           relative_path.find('/', bundle_dir_.size() + 1) == std::string::npos && ends_with(relative_path, ".html");
+}
+
+void AssetCache::add_bundle(AssetMap& assets) const {
+    std::string prefix = bundle_dir_ + "/";
+    std::string bundle_path = prefix + "bundle.json";
+    nlohmann::json fragments = nlohmann::json::object();
+    time_t mtime = 0;
+    for (auto it = assets.lower_bound(prefix); it != assets.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        if (!in_bundle(it->first)) {
+            continue;
+        }
+        fragments[it->first.substr(bundle_dir_.size() + 1)] = *it->second->identity;
+        mtime = std::max(mtime, it->second->mtime);
+    }
+    if (fragments.empty()) {
+        assets.erase(bundle_path);
+        return;
+    }
+    
+    auto bundle = std::make_shared<Asset>();
+    bundle->content_type = "application/json";
+    bundle->identity = std::make_shared<const std::string>(
+        fragments.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace));
+    bundle->mtime = mtime;
+    bundle->last_modified = FileHandler::format_http_date(mtime);
+    bundle->etag = FileHandler::compute_etag(*bundle->identity);
+    add_compressed_variants(*bundle);
+    LOG_DEBUG("Asset cache: bundled " + std::to_string(fragments.size()) + " files into " + bundle_path);
+    assets[bundle_path] = std::move(bundle);
+}
+
+std::shared_ptr<const AssetCache::Asset> AssetCache::find(const std::string& relative_path) const {
+    std::shared_ptr<const AssetMap> assets;
+    {
+        std::lock_guard<std::mutex> lock(assets_mutex_);
+        assets = assets_;
+    }
+    auto it = assets->find(relative_path);
+    return it != assets->end() ? it->second : nullptr;
+}
+
+HttpResponse AssetCache::serve(const HttpRequest& request, const std::string& relative_path) {
+    std::string path = relative_path;
+    while (!path.empty() && path.front() == '/') {
+        path.erase(0, 1);
+    }
+    if (path.empty() || path.back() == '/') {
+        path += "index.html";
+    }
+    
+    // Ranges are served from the file itself, which a fingerprinted name
+    // does not have; those get the whole asset
+    auto asset = path.find("..") == std::string::npos ? find(path) : nullptr;
+    if (!asset || (!asset->immutable && !request.get_header("Range").empty())) {
+        return file_handler_.serve_static_file(request, relative_path);
+    }
+    
+    std::string_view accept_encoding = request.get_header("Accept-Encoding");
+    std::shared_ptr<const std::string> body = asset->identity;
+    std::string encoding;
+    std::string etag = asset->etag;
+    if (asset->brotli && FileHandler::accepts_encoding(accept_encoding, "br")) {
+        body = asset->brotli;
+        encoding = "br";
+        etag = FileHandler::variant_etag(asset->etag, "br");
+    } else if (asset->gzip && FileHandler::accepts_encoding(accept_encoding, "gzip")) {
+        body = asset->gzip;
+        encoding = "gzip";
+        etag = FileHandler::variant_etag(asset->etag, "gzip");
+    }
+    
+    HttpResponse response;
+    response.headers["Content-Type"] = asset->content_type;
+    response.headers["Last-Modified"] = asset->last_modified;
+    response.headers["ETag"] = etag;
+    response.headers["Cache-Control"] = asset->immutable ? kImmutableCacheControl
+                                                         : file_handler_.get_cache_control(path);
+    response.headers["Vary"] = "Accept-Encoding";
+    response.headers["Accept-Ranges"] = "bytes";
+    file_handler_.add_security_headers(response);
+    
+    if (FileHandler::is_not_modified(request, etag, asset->mtime)) {
+        response.status_code = 304;
+        return response;
+    }
+    
+    if (!encoding.empty()) {
+        response.headers["Content-Encoding"] = encoding;
+    }
+    response.set_shared_body(std::move(body));
+    
+    LOG_FILE_REQUEST(path, true);
+    return response;
+}
+
+void AssetCache::update(const std::string& relative_path) {
+    std::string path = relative_path;
+    if (ends_with(path, ".gz") || ends_with(path, ".br")) {
+        path.resize(path.size() - 3);
+    }
+    
+    auto asset = load_asset(path);
+    // Only the watch thread replaces the map once loaded, so it can be
+    // copied and rebuilt without holding up requests
+    std::shared_ptr<AssetMap> assets;
+    {
+        std::lock_guard<std::mutex> lock(assets_mutex_);
+        assets = std::make_shared<AssetMap>(*assets_);
+    }
+    if (asset) {
+        (*assets)[path] = asset;
+    } else {
+        assets->erase(path);
+    }
+    // A file under a new name means every page referring to it changes
+    bool renamed = fingerprint_ && !is_page(path) && update_alias(*assets, path, asset);
+    if (renamed) {
+        for (auto& entry : *assets) {
+            if (is_page(entry.first)) {
+                auto page = load_asset(entry.first);
+                if (page) {
+                    entry.second = std::move(page);
+                }
+            }
+        }
+    }
+    if (renamed || in_bundle(path)) {
+        add_bundle(*assets);
+    }
+    std::lock_guard<std::mutex> lock(assets_mutex_);
+    assets_ = std::move(assets);
+}
+
+bool AssetCache::start_watching() {
+    if (watching_) {
+        return true;
+    }
+    
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+        LOG_WARNING("Asset cache: inotify unavailable, changes need a restart");
+        return false;
+    }
+    if (pipe2(stop_pipe_, O_CLOEXEC) != 0) {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+        return false;
+    }
+    
+    add_watches("");
+    watching_ = true;
+    watch_thread_ = std::thread(&AssetCache::watch_loop, this);
+    return true;
+}
+
+void AssetCache::stop_watching() {
+    if (!watching_) {
+        return;
+    }
+    
+    watching_ = false;
+    char wake = 0;
+    if (write(stop_pipe_[1], &wake, 1) < 0) {
+        // The loop also rechecks watching_ on its poll timeout
+    }
+    watch_thread_.join();
+    
+    close(inotify_fd_);
+    close(stop_pipe_[0]);
+    close(stop_pipe_[1]);
+    inotify_fd_ = -1;
+    stop_pipe_[0] = stop_pipe_[1] = -1;
+    watch_dirs_.clear();
+}
+
+void AssetCache::add_watches(const std::string& relative_dir) {
+    std::string full_dir = relative_dir.empty() ? root_ : root_ + "/" + relative_dir;
+    int wd = inotify_add_watch(inotify_fd_, full_dir.c_str(), kWatchMask);
+    if (wd >= 0) {
+        watch_dirs_[wd] = relative_dir;
+    }
+    
+    std::error_code ec;
+    for (fs::directory_iterator it(full_dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_directory(ec)) {
+            std::string name = it->path().filename().string();
+            add_watches(relative_dir.empty() ? name : relative_dir + "/" + name);
+        }
+    }
+}
+
+void AssetCache::watch_loop() {
+    alignas(struct inotify_event) char buffer[4096];
+    
+    while (watching_) {
+        struct pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+        if (poll(fds, 2, 1000) <= 0 || (fds[1].revents & POLLIN)) {
+            continue;
+        }
+        
+        ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; length > 0 && offset < length; ) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+            
+            if (event->mask & IN_IGNORED) {
+                watch_dirs_.erase(event->wd);
+                continue;
+            }
+            auto dir = watch_dirs_.find(event->wd);
+            if (dir == watch_dirs_.end() || event->len == 0) {
+                continue;
+            }
+            std::string name = event->name;
+            std::string relative_path = dir->second.empty() ? name : dir->second + "/" + name;
+            
+            if (event->mask & IN_ISDIR) {
+                // A new directory (say a deploy moving a tree in) is read whole
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    add_watches(relative_path);
+                    std::error_code ec;
+                    for (fs::recursive_directory_iterator it(root_ + "/" + relative_path, ec), end;
+                         !ec && it != end; it.increment(ec)) {
+                        if (it->is_regular_file(ec)) {
+                            update(fs::relative(it->path(), root_, ec).generic_string());
+                        }
+                    }
+                }
+                continue;
+            }
+            // A file is complete once written or moved in; IN_CREATE alone is not
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)) {
+                update(relative_path);
+                LOG_DEBUG("Asset cache: reloaded " + relative_path);
+            }
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include "auth_handler.h"
 #include "logger.h"
+#include "ur-clock/ur_clock.hpp"
 #include "frontendpp/cmake/attributes.hpp"
 #include <nlohmann/json.hpp>
 #include <openssl/evp.h>
@@ -12,11 +13,174 @@
 #include <fstream>
 #include <cstring>
 #include <algorithm>
+#include <filesystem>
 
 using json = nlohmann::json;
 
-AuthHandler::AuthHandler(const std::string& db_path, const JWTManager& jwt_manager) 
-    : db_path_(db_path), jwt_manager_(std::make_unique<JWTManager>(jwt_manager)), db_(nullptr) {
+namespace {
+
+const int kHistoryDefaultLimit = 50;
+const int kHistoryMaxLimit = 500;
+// Rows serialized per call of the NDJSON writer
+const int kHistoryStreamBatch = 64;
+
+// Newest first; the (created_at, id) index serves both without sorting.
+// A negative LIMIT means no limit.
+const char* const kHistoryFirstPageSql =
+    "SELECT id, file_count, total_size, created_at, status FROM transfer_history "
+    "WHERE user_id = ? ORDER BY created_at DESC, id DESC LIMIT ?";
+const char* const kHistoryNextPageSql =
+    "SELECT id, file_count, total_size, created_at, status FROM transfer_history "
+    "WHERE user_id = ? AND (created_at, id) < (?, ?) ORDER BY created_at DESC, id DESC LIMIT ?";
+
+// Binds the page query for rows after the cursor, or from the newest one
+sqlite3_stmt* prepare_history_page(SqlitePool::Lease& lease, const std::string& user_id,
+                                   const std::string& after_created_at, const std::string& after_id,
+                                   int limit) {
+    bool first_page = after_created_at.empty() && after_id.empty();
+    sqlite3_stmt* stmt = lease.prepare(first_page ? kHistoryFirstPageSql : kHistoryNextPageSql);
+    if (!stmt) {
+        return nullptr;
+    }
+
+    int index = 1;
+    sqlite3_bind_text(stmt, index++, user_id.c_str(), -1, SQLITE_TRANSIENT);
+    if (!first_page) {
+        sqlite3_bind_text(stmt, index++, after_created_at.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, index++, after_id.c_str(), -1, SQLITE_TRANSIENT);
+    }
+    sqlite3_bind_int(stmt, index, limit);
+    return stmt;
+}
+
+TransferRecord read_history_row(sqlite3_stmt* stmt, const std::string& user_id) {
+    auto text = [stmt](int column) {
+        const unsigned char* value = sqlite3_column_text(stmt, column);
+        return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+    };
+
+    TransferRecord record;
+    record.id = text(0);
+    record.user_id = user_id;
+    record.file_count = sqlite3_column_int(stmt, 1);
+    record.total_size = static_cast<long>(sqlite3_column_int64(stmt, 2));
+    record.created_at = text(3);
+    record.status = text(4);
+    return record;
+}
+
+json history_record_json(const TransferRecord& record) {
+    return {
+        {"id", record.id},
+        {"file_count", record.file_count},
+        {"total_size", record.total_size},
+        {"created_at", record.created_at},
+        {"status", record.status}
+    };
+}
+
+// Cursors are the hex of "created_at\nid", which needs no URL escaping
+std::string encode_history_cursor(const TransferRecord& record) {
+    static const char digits[] = "0123456789abcdef";
+    std::string raw = record.created_at + '\n' + record.id;
+    std::string cursor;
+    cursor.reserve(raw.size() * 2);
+    for (unsigned char c : raw) {
+        cursor += digits[c >> 4];
+        cursor += digits[c & 0x0f];
+    }
+    return cursor;
+}
+
+bool decode_history_cursor(const std::string& cursor, std::string& created_at, std::string& id) {
+    if (cursor.size() % 2 != 0) {
+        return false;
+    }
+
+    auto nibble = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
+    std::string raw;
+    raw.reserve(cursor.size() / 2);
+    for (size_t i = 0; i < cursor.size(); i += 2) {
+        int high = nibble(cursor[i]);
+        int low = nibble(cursor[i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        raw += static_cast<char>((high << 4) | low);
+    }
+
+    size_t separator = raw.find('\n');
+    if (separator == std::string::npos) {
+        return false;
+    }
+    created_at = raw.substr(0, separator);
+    id = raw.substr(separator + 1);
+    return true;
+}
+
+// State of one NDJSON response; holds its connection until MHD frees the
+// response
+struct HistoryStream {
+    explicit HistoryStream(SqlitePool::Lease&& held) : lease(std::move(held)) {}
+
+    SqlitePool::Lease lease;
+    sqlite3_stmt* stmt = nullptr;
+    std::string user_id;
+    std::string pending;
+    size_t offset = 0;
+    bool done = false;
+
+    // Serializes the next batch of rows into pending
+    void refill() {
+        pending.clear();
+        offset = 0;
+        for (int i = 0; i < kHistoryStreamBatch && !done; ++i) {
+            int rc = sqlite3_step(stmt);
+            if (rc == SQLITE_ROW) {
+                pending += history_record_json(read_history_row(stmt, user_id)).dump();
+                pending += '\n';
+            } else {
+                if (rc != SQLITE_DONE) {
+                    LOG_ERROR("Transfer history stream failed: " + std::string(sqlite3_errstr(rc)));
+                    pending += json{{"error", "Transfer history query failed"}}.dump();
+                    pending += '\n';
+                }
+                done = true;
+            }
+        }
+    }
+
+    size_t write(char* buffer, size_t max) {
+        if (offset == pending.size()) {
+            if (done) {
+                return 0;
+            }
+            refill();
+            if (pending.empty()) {
+                return 0;
+            }
+        }
+        size_t length = std::min(max, pending.size() - offset);
+        std::memcpy(buffer, pending.data() + offset, length);
+        offset += length;
+        return length;
+    }
+};
+
+} // namespace
+
+AuthHandler::AuthHandler(const std::string& db_path, const JWTManager& jwt_manager,
+                         const PasswordHasher::Options& hasher_options)
+    : db_path_(db_path), jwt_manager_(std::make_unique<JWTManager>(jwt_manager)), db_(nullptr),
+      db_pool_(std::make_unique<SqlitePool>(db_path)),
+      password_hasher_(std::make_unique<PasswordHasher>(hasher_options)),
+      dummy_hash_(password_hasher_->hash("unknown-user")) {
     
     LOG_INIT_STEP("Initializing AuthHandler", true);
     
@@ -30,14 +194,38 @@ AuthHandler::AuthHandler(const std::string& db_path, const JWTManager& jwt_manag
         LOG_ERROR("Failed to open database: " + std::string(sqlite3_errmsg(db_)));
         return;
     }
+    // WAL lets request threads read on their own connections while one writes
+    sqlite3_exec(db_, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+    sqlite3_busy_timeout(db_, 5000);
     
-    if (!init_database()) {
+    // A database already at kSchemaVersion is used as is; creating the
+    // tables and seeding the admin (a password hash) happen once
+    if (schema_version() >= kSchemaVersion) {
+        schema_ready_ = true;
+    } else if (!init_database()) {
         LOG_ERROR("Failed to initialize database");
+    } else {
+        std::string version_sql = "PRAGMA user_version = " + std::to_string(kSchemaVersion);
+        sqlite3_exec(db_, version_sql.c_str(), nullptr, nullptr, nullptr);
+        schema_ready_ = true;
+        LOG_INFO("Database schema initialized (version " + std::to_string(kSchemaVersion) + ")");
+    }
+    if (!jwt_manager_->persist_revocations(db_path)) {
+        LOG_WARNING("Token revocations are kept in memory only");
+    }
+    login_recorder_ = std::make_unique<LoginRecorder>(db_path);
+    
+    LOG_INIT_STEP("AuthHandler initialization completed", true);
+}
+
+void AuthHandler::run_deferred_checks() {
+    if (!db_) {
+        return;
     }
     
     // Enhanced initialization: validate database integrity
     if (!validate_database_integrity()) {
-        LOG_ERROR("Database integrity validation failed");
+        LOG_CRITICAL("Database integrity validation failed");
     }
     
     // Log database statistics for monitoring
@@ -47,11 +235,22 @@ AuthHandler::AuthHandler(const std::string& db_path, const JWTManager& jwt_manag
     if (!cleanup_non_admin_data()) {
         LOG_WARNING("Failed to cleanup non-admin data");
     }
-    
-    LOG_INIT_STEP("AuthHandler initialization completed", true);
+}
+
+int AuthHandler::schema_version() {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version", -1, &stmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    int version = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    return version;
 }
 
 AuthHandler::~AuthHandler() {
+    if (login_recorder_) {
+        login_recorder_->stop();
+    }
     if (db_) {
         sqlite3_close(db_);
     }
@@ -185,140 +384,62 @@ bool AuthHandler::cleanup_non_admin_data() {
 }
 
 std::string AuthHandler::encrypt_sensitive_data(const std::string& data) {
-    // Enhanced AES-256 encryption for sensitive data
+    // AES-256 encryption for sensitive data
     if (data.empty()) return "";
     
-    try {
-        // Generate a secure encryption key from JWT secret
-        std::string encryption_key = jwt_manager_->get_secret().substr(0, 32); // Use first 32 chars as key
-        
-        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-        if (!ctx) return "";
-        
-        // Generate random IV
-        unsigned char iv[16];
-        if (RAND_bytes(iv, sizeof(iv)) != 1) {
-            EVP_CIPHER_CTX_free(ctx);
-            return "";
-        }
-        
-        if (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, 
-                              (const unsigned char*)encryption_key.c_str(), iv) != 1) {
-            EVP_CIPHER_CTX_free(ctx);
-            return "";
-        }
-        
-        unsigned char ciphertext[data.length() + EVP_MAX_BLOCK_LENGTH];
-        int len;
-        if (EVP_EncryptUpdate(ctx, ciphertext, &len, 
-                             (const unsigned char*)data.c_str(), data.length()) != 1) {
-            EVP_CIPHER_CTX_free(ctx);
-            return "";
-        }
-        
-        int ciphertext_len = len;
-        if (EVP_EncryptFinal_ex(ctx, ciphertext + len, &len) != 1) {
-            EVP_CIPHER_CTX_free(ctx);
-            return "";
-        }
-        ciphertext_len += len;
-        
-        EVP_CIPHER_CTX_free(ctx);
-        
-        // Combine IV and ciphertext, then encode as base64
-        std::string combined;
-        combined.append((char*)iv, 16);
-        combined.append((char*)ciphertext, ciphertext_len);
-        
-        return base64_encode(combined);
-        
-    } catch (const std::exception& e) {
+    // Generate a secure encryption key from JWT secret
+    std::string encryption_key = jwt_manager_->get_secret().substr(0, CipherStream::kKeySize);
+    encryption_key.resize(CipherStream::kKeySize, '\0');
+    
+    // Generate random IV
+    unsigned char iv[CipherStream::kIvSize];
+    if (RAND_bytes(iv, sizeof(iv)) != 1) {
         return "";
     }
+    
+    // IV followed by the ciphertext, encoded as base64
+    std::string combined;
+    combined.reserve(sizeof(iv) + data.size() + EVP_MAX_BLOCK_LENGTH);
+    combined.append(reinterpret_cast<const char*>(iv), sizeof(iv));
+    
+    CipherStream cipher(CipherStream::Mode::Encrypt,
+                        reinterpret_cast<const unsigned char*>(encryption_key.data()), iv);
+    if (!cipher.update(data.data(), data.size(), combined) || !cipher.finish(combined)) {
+        return "";
+    }
+    
+    return Base64::encode(combined);
 }
 
 std::string AuthHandler::decrypt_sensitive_data(const std::string& encrypted_data) {
-    // Enhanced decryption for sensitive data
     if (encrypted_data.empty()) return "";
     
-    try {
-        // Generate the same encryption key
-        std::string encryption_key = jwt_manager_->get_secret().substr(0, 32);
-        
-        std::string combined = base64_decode(encrypted_data);
-        if (combined.length() < 16) return ""; // Must have at least IV
-        
-        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-        if (!ctx) return "";
-        
-        // Extract IV and ciphertext
-        unsigned char iv[16];
-        std::memcpy(iv, combined.c_str(), 16);
-        const unsigned char* ciphertext = (const unsigned char*)combined.c_str() + 16;
-        int ciphertext_len = combined.length() - 16;
-        
-        if (EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr,
-                              (const unsigned char*)encryption_key.c_str(), iv) != 1) {
-            EVP_CIPHER_CTX_free(ctx);
-            return "";
-        }
-        
-        unsigned char plaintext[ciphertext_len + EVP_MAX_BLOCK_LENGTH];
-        int len;
-        if (EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len) != 1) {
-            EVP_CIPHER_CTX_free(ctx);
-            return "";
-        }
-        
-        int plaintext_len = len;
-        if (EVP_DecryptFinal_ex(ctx, plaintext + len, &len) != 1) {
-            EVP_CIPHER_CTX_free(ctx);
-            return "";
-        }
-        plaintext_len += len;
-        
-        EVP_CIPHER_CTX_free(ctx);
-        
-        return std::string((char*)plaintext, plaintext_len);
-        
-    } catch (const std::exception& e) {
+    // Generate the same encryption key
+    std::string encryption_key = jwt_manager_->get_secret().substr(0, CipherStream::kKeySize);
+    encryption_key.resize(CipherStream::kKeySize, '\0');
+    
+    std::string combined = Base64::decode(encrypted_data);
+    if (combined.length() < CipherStream::kIvSize) return ""; // Must have at least IV
+    
+    std::string plaintext;
+    plaintext.reserve(combined.size());
+    CipherStream cipher(CipherStream::Mode::Decrypt,
+                        reinterpret_cast<const unsigned char*>(encryption_key.data()),
+                        reinterpret_cast<const unsigned char*>(combined.data()));
+    if (!cipher.update(combined.data() + CipherStream::kIvSize, combined.size() - CipherStream::kIvSize, plaintext) ||
+        !cipher.finish(plaintext)) {
         return "";
     }
+    
+    return plaintext;
 }
 
 std::string AuthHandler::base64_encode(const std::string& data) {
-    const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string encoded;
-    int val = 0, valb = -6;
-    for (unsigned char c : data) {
-        val = (val << 8) + c;
-        valb += 8;
-        while (valb >= 0) {
-            encoded.push_back(chars[(val >> valb) & 0x3F]);
-            valb -= 6;
-        }
-    }
-    if (valb > -6) encoded.push_back(chars[((val << 8) >> (valb + 8)) & 0x3F]);
-    while (encoded.size() % 4) encoded.push_back('=');
-    return encoded;
+    return Base64::encode(data);
 }
 
 std::string AuthHandler::base64_decode(const std::string& encoded) {
-    const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string decoded;
-    int val = 0, valb = -8;
-    for (unsigned char c : encoded) {
-        if (c == '=') break;
-        size_t pos = chars.find(c);
-        if (pos == std::string::npos) continue;
-        val = (val << 6) + pos;
-        valb += 6;
-        if (valb >= 0) {
-            decoded.push_back(char((val >> valb) & 0xFF));
-            valb -= 8;
-        }
-    }
-    return decoded;
+    return Base64::decode(encoded);
 }
 
 bool AuthHandler::ensure_database_exists() {
@@ -600,6 +721,56 @@ bool AuthHandler::init_database() {
         return false;
     }
     
+    // Serves the keyset pagination of the history endpoint
+    const char* transfer_index_sql = R"(
+        CREATE INDEX IF NOT EXISTS idx_transfer_history_user_created
+        ON transfer_history (user_id, created_at DESC, id DESC)
+    )";
+    
+    if (sqlite3_exec(db_, transfer_index_sql, nullptr, nullptr, &error_msg) != SQLITE_OK) {
+        std::cerr << "Failed to create transfer_history index: " << error_msg << std::endl;
+        sqlite3_free(error_msg);
+        return false;
+    }
+    
+    // Logouts (kind 't', key the token ID) and password changes (kind 'u',
+    // key the username) until every token they cover has expired; times
+    // in Unix seconds
+    const char* revocations_sql = R"(
+        CREATE TABLE IF NOT EXISTS token_revocations (
+            kind TEXT NOT NULL,
+            key TEXT NOT NULL,
+            revoked_before INTEGER NOT NULL,
+            expires_at INTEGER NOT NULL,
+            PRIMARY KEY (kind, key)
+        )
+    )";
+    
+    if (sqlite3_exec(db_, revocations_sql, nullptr, nullptr, &error_msg) != SQLITE_OK) {
+        std::cerr << "Failed to create token_revocations table: " << error_msg << std::endl;
+        sqlite3_free(error_msg);
+        return false;
+    }
+    
+    // Written by LoginRecorder; created_at has the format of users.last_login
+    const char* login_audit_sql = R"(
+        CREATE TABLE IF NOT EXISTS login_audit (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            username TEXT NOT NULL,
+            method TEXT NOT NULL,
+            client_ip TEXT,
+            key_id TEXT,
+            created_at TEXT NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_login_audit_created ON login_audit (created_at);
+    )";
+    
+    if (sqlite3_exec(db_, login_audit_sql, nullptr, nullptr, &error_msg) != SQLITE_OK) {
+        std::cerr << "Failed to create login_audit table: " << error_msg << std::endl;
+        sqlite3_free(error_msg);
+        return false;
+    }
+    
     // Insert default admin user only
     const char* insert_users_sql = R"(
         INSERT OR IGNORE INTO users (username, email, password_hash, role, full_name, created_at, auth_method)
@@ -640,9 +811,6 @@ bool AuthHandler::init_database() {
 }
 
 HttpResponse AuthHandler::handle_login(const HttpRequest& request) {
-    std::cerr << "DEBUG: handle_login ENTRY" << std::endl;
-    std::cerr << "DEBUG: About to parse JSON, body length: " << request.body.length() << std::endl;
-    std::cerr << "DEBUG: Request body content: " << request.body << std::endl;
     try {
         json request_json = json::parse(request.body);
         std::string username = request_json.value("username", "");
@@ -652,7 +820,11 @@ HttpResponse AuthHandler::handle_login(const HttpRequest& request) {
             return create_error_response(400, "Username and password are required");
         }
         
-        if (!verify_user_credentials(username, password)) {
+        bool busy = false;
+        if (!verify_user_credentials(username, password, &busy)) {
+            if (busy) {
+                return create_error_response(503, "Too many login attempts in progress, try again");
+            }
             return create_error_response(401, "Invalid credentials");
         }
         
@@ -661,6 +833,9 @@ HttpResponse AuthHandler::handle_login(const HttpRequest& request) {
         
         std::string access_token = jwt_manager_->generate_access_token(user_info);
         std::string refresh_token = jwt_manager_->generate_refresh_token(user_info);
+        if (login_recorder_) {
+            login_recorder_->record({username, "password", request.client_ip, "", user_info.last_login});
+        }
         
         json response_json;
         response_json["success"] = true;
@@ -725,6 +900,9 @@ HttpResponse AuthHandler::handle_login_with_key(const HttpRequest& request) {
         
         std::string access_token = jwt_manager_->generate_access_token(user_info);
         std::string refresh_token = jwt_manager_->generate_refresh_token(user_info);
+        if (login_recorder_) {
+            login_recorder_->record({user_info.username, "key", request.client_ip, auth_key.id, user_info.last_login});
+        }
         
         json response_json;
         response_json["success"] = true;
@@ -776,10 +954,17 @@ HttpResponse AuthHandler::handle_change_password(const HttpRequest& request) {
             return create_error_response(400, "Password must be at least 8 characters long");
         }
         
-        if (!change_user_password(user_info.username, current_password, new_password)) {
+        bool busy = false;
+        if (!change_user_password(user_info.username, current_password, new_password, &busy)) {
+            if (busy) {
+                return create_error_response(503, "Too many password checks in progress, try again");
+            }
             return create_error_response(400, "Current password is incorrect");
         }
         
+        // Sessions opened with the old password have to log in again
+        jwt_manager_->revoke_user_tokens(user_info.username);
+        
         json response_json;
         response_json["success"] = true;
         response_json["message"] = "Password changed successfully";
@@ -945,73 +1130,105 @@ HttpResponse AuthHandler::handle_revoke_auth_key(const HttpRequest& request) {
 
 // Utility methods
 bool AuthHandler::authenticate_request(const HttpRequest& request, UserInfo& user_info) {
+    VerifiedToken token;
+    if (!authenticate_request(request, token)) {
+        return false;
+    }
+    user_info = std::move(token.user_info);
+    return true;
+}
+
+bool AuthHandler::authenticate_request(const HttpRequest& request, VerifiedToken& verified) {
     auto auth_header_it = request.headers.find("Authorization");
     if (auth_header_it == request.headers.end()) {
         return false;
     }
     
-    std::string auth_header = auth_header_it->second;
+    std::string_view auth_header = auth_header_it->second;
     if (auth_header.substr(0, 7) != "Bearer ") {
         return false;
     }
     
-    std::string token = auth_header.substr(7);
-    if (!jwt_manager_->validate_token(token)) {
-        return false;
-    }
-    
-    user_info = jwt_manager_->extract_user_info(token);
-    return !user_info.username.empty();
+    // One decode per token; repeat requests come from the verified cache
+    verified = jwt_manager_->verify_token(std::string(auth_header.substr(7)));
+    return verified.valid && !verified.user_info.username.empty();
 }
 
 std::string AuthHandler::hash_password(const std::string& password) {
-    // Simple SHA-256 hash for demo purposes
-    // In production, use bcrypt or Argon2
-    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
-    const EVP_MD* md = EVP_sha256();
-    unsigned char hash[EVP_MAX_MD_SIZE];
-    unsigned int hash_len;
+    // Inline: only used for setup and for new passwords already on the pool
+    return password_hasher_->hash(password);
+}
+
+bool AuthHandler::verify_user_credentials(const std::string& username, const std::string& password, bool* busy) {
+    std::string stored_hash;
+    {
+        const char* sql = "SELECT password_hash FROM users WHERE username = ?";
+        
+        SqlitePool::Lease lease = db_pool_->acquire();
+        sqlite3_stmt* stmt = lease.prepare(sql);
+        if (!stmt) {
+            return false;
+        }
+        
+        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+        
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* hash_col = (const char*)sqlite3_column_text(stmt, 0);
+            stored_hash = hash_col ? hash_col : "";
+        }
+    }
     
-    EVP_DigestInit_ex(mdctx, md, nullptr);
-    EVP_DigestUpdate(mdctx, password.c_str(), password.length());
-    EVP_DigestFinal_ex(mdctx, hash, &hash_len);
-    EVP_MD_CTX_free(mdctx);
+    // An unknown user still pays for a full verification, so the response
+    // time does not tell which usernames exist
+    bool known_user = !stored_hash.empty();
+    if (!known_user) {
+        stored_hash = dummy_hash_;
+    }
     
-    std::stringstream ss;
-    for (unsigned int i = 0; i < hash_len; i++) {
-        ss << std::hex << std::setw(2) << std::setfill('0') << (int)hash[i];
+    // The connection is back in the pool before the slow part starts
+    auto pending = password_hasher_->verify_async(password, stored_hash);
+    if (!pending.valid()) {
+        LOG_WARNING("Password verification queue full, refusing login for " + username);
+        if (busy) {
+            *busy = true;
+        }
+        return false;
     }
     
-    return ss.str();
+    PasswordHasher::Result result = pending.get();
+    if (!known_user) {
+        return false;
+    }
+    if (result.matched && !result.rehash.empty()) {
+        if (store_password_hash(username, result.rehash)) {
+            LOG_INFO("Upgraded password hash for " + username);
+        }
+    }
+    return result.matched;
 }
 
-bool AuthHandler::verify_user_credentials(const std::string& username, const std::string& password) {
-    sqlite3_stmt* stmt;
-    const char* sql = "SELECT password_hash FROM users WHERE username = ?";
+bool AuthHandler::store_password_hash(const std::string& username, const std::string& password_hash) {
+    const char* sql = "UPDATE users SET password_hash = ? WHERE username = ?";
     
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = lease.prepare(sql);
+    if (!stmt) {
         return false;
     }
     
-    sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-    
-    bool result = false;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        const char* stored_hash = (const char*)sqlite3_column_text(stmt, 0);
-        std::string computed_hash = hash_password(password);
-        result = (stored_hash && computed_hash == stored_hash);
-    }
+    sqlite3_bind_text(stmt, 1, password_hash.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_TRANSIENT);
     
-    sqlite3_finalize(stmt);
-    return result;
+    return sqlite3_step(stmt) == SQLITE_DONE;
 }
 
 UserInfo AuthHandler::get_user_info(const std::string& username) {
     UserInfo user_info;
-    sqlite3_stmt* stmt;
     const char* sql = "SELECT username, email, role, full_name, created_at, last_login, auth_method FROM users WHERE username = ?";
     
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = lease.prepare(sql);
+    if (!stmt) {
         return user_info;
     }
     
@@ -1035,7 +1252,6 @@ UserInfo AuthHandler::get_user_info(const std::string& username) {
         user_info.auth_method = auth_method_col ? auth_method_col : "";
     }
     
-    sqlite3_finalize(stmt);
     return user_info;
 }
 
@@ -1104,27 +1320,19 @@ std::string AuthHandler::generate_key_checksum(const std::string& key) {
 }
 
 std::string AuthHandler::get_current_timestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%SZ");
-    return ss.str();
+    return UrClock::iso8601();
 }
 
 std::string AuthHandler::calculate_expiry_timestamp(int days_from_now) {
-    auto now = std::chrono::system_clock::now();
-    auto expiry = now + std::chrono::hours(24 * days_from_now);
-    auto time_t = std::chrono::system_clock::to_time_t(expiry);
-    std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%SZ");
-    return ss.str();
+    return UrClock::iso8601(std::chrono::system_clock::now() + std::chrono::hours(24 * days_from_now));
 }
 
 bool AuthHandler::store_auth_key(const AuthKey& key) {
-    sqlite3_stmt* stmt;
     const char* sql = "INSERT INTO auth_keys (id, name, key_value, user_id, expiry_days, created_at, expires_at, format, version) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
     
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = lease.prepare(sql);
+    if (!stmt) {
         return false;
     }
     
@@ -1139,16 +1347,65 @@ bool AuthHandler::store_auth_key(const AuthKey& key) {
     sqlite3_bind_text(stmt, 9, key.version.c_str(), -1, SQLITE_TRANSIENT);
     
     bool result = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
     return result;
 }
 
+bool AuthHandler::add_transfer_record(const std::string& user_id, int file_count, long total_size) {
+    const char* sql = "INSERT INTO transfer_history (id, user_id, file_count, total_size, created_at) VALUES (?, ?, ?, ?, ?)";
+    
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = lease.prepare(sql);
+    if (!stmt) {
+        return false;
+    }
+    
+    std::string id = generate_uuid();
+    std::string created_at = get_current_timestamp();
+    sqlite3_bind_text(stmt, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, user_id.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 3, file_count);
+    sqlite3_bind_int64(stmt, 4, total_size);
+    sqlite3_bind_text(stmt, 5, created_at.c_str(), -1, SQLITE_TRANSIENT);
+    
+    return sqlite3_step(stmt) == SQLITE_DONE;
+}
+
+std::vector<TransferRecord> AuthHandler::get_user_transfer_history(const std::string& user_id,
+                                                                   const std::string& after_created_at,
+                                                                   const std::string& after_id,
+                                                                   int limit, bool* ok) {
+    std::vector<TransferRecord> records;
+    if (ok) {
+        *ok = false;
+    }
+    
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = prepare_history_page(lease, user_id, after_created_at, after_id, limit);
+    if (!stmt) {
+        return records;
+    }
+    
+    if (limit > 0) {
+        records.reserve(limit);
+    }
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        records.push_back(read_history_row(stmt, user_id));
+    }
+    
+    if (ok) {
+        *ok = rc == SQLITE_DONE;
+    }
+    return records;
+}
+
 std::vector<AuthKey> AuthHandler::get_user_auth_keys(const std::string& user_id) {
     std::vector<AuthKey> keys;
-    sqlite3_stmt* stmt;
     const char* sql = "SELECT id, name, created_at, expires_at FROM auth_keys WHERE user_id = ? AND revoked = FALSE";
     
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = lease.prepare(sql);
+    if (!stmt) {
         return keys;
     }
     
@@ -1163,15 +1420,15 @@ std::vector<AuthKey> AuthHandler::get_user_auth_keys(const std::string& user_id)
         keys.push_back(key);
     }
     
-    sqlite3_finalize(stmt);
     return keys;
 }
 
 bool AuthHandler::revoke_auth_key(const std::string& key_id, const std::string& user_id) {
-    sqlite3_stmt* stmt;
     const char* sql = "UPDATE auth_keys SET revoked = TRUE WHERE id = ? AND user_id = ?";
     
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = lease.prepare(sql);
+    if (!stmt) {
         return false;
     }
     
@@ -1179,16 +1436,16 @@ bool AuthHandler::revoke_auth_key(const std::string& key_id, const std::string&
     sqlite3_bind_text(stmt, 2, user_id.c_str(), -1, SQLITE_TRANSIENT);
     
     bool result = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
     return result;
 }
 
 AuthKey AuthHandler::validate_auth_key(const std::string& key) {
     AuthKey auth_key;
-    sqlite3_stmt* stmt;
     const char* sql = "SELECT id, name, key_value, user_id, expiry_days, created_at, expires_at, format, version FROM auth_keys WHERE key_value = ? AND revoked = FALSE";
     
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = lease.prepare(sql);
+    if (!stmt) {
         return auth_key;
     }
     
@@ -1214,30 +1471,25 @@ AuthKey AuthHandler::validate_auth_key(const std::string& key) {
         }
     }
     
-    sqlite3_finalize(stmt);
     return auth_key;
 }
 
-bool AuthHandler::change_user_password(const std::string& username, const std::string& old_password, const std::string& new_password) {
+bool AuthHandler::change_user_password(const std::string& username, const std::string& old_password, const std::string& new_password, bool* busy) {
     // First verify old password
-    if (!verify_user_credentials(username, old_password)) {
+    if (!verify_user_credentials(username, old_password, busy)) {
         return false;
     }
     
-    sqlite3_stmt* stmt;
-    const char* sql = "UPDATE users SET password_hash = ? WHERE username = ?";
-    
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    auto pending = password_hasher_->hash_async(new_password);
+    if (!pending.valid()) {
+        if (busy) {
+            *busy = true;
+        }
         return false;
     }
     
-    std::string new_hash = hash_password(new_password);
-    sqlite3_bind_text(stmt, 1, new_hash.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, username.c_str(), -1, SQLITE_TRANSIENT);
-    
-    bool result = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
-    return result;
+    std::string new_hash = pending.get();
+    return !new_hash.empty() && store_password_hash(username, new_hash);
 }
 
 HttpResponse AuthHandler::create_error_response(int status_code, const std::string& message) {
@@ -1290,6 +1542,9 @@ HttpResponse AuthHandler::handle_logout(const HttpRequest& request) {
             return create_error_response(401, "Unauthorized");
         }
         
+        // The token stops working here rather than when it expires
+        jwt_manager_->revoke_token(std::string(request.headers.at("Authorization").substr(7)));
+        
         json response_json;
         response_json["success"] = true;
         response_json["message"] = "Logout successful";
@@ -1362,16 +1617,38 @@ HttpResponse AuthHandler::handle_upload_files(const HttpRequest& request) {
     try {
         UserInfo user_info;
         if (!authenticate_request(request, user_info)) {
+            std::error_code ec;
+            for (const auto& file : request.uploaded_files) {
+                std::filesystem::remove(file.path, ec);
+            }
             return create_error_response(401, "Unauthorized");
         }
         
-        // For demo purposes, simulate file processing
+        // The server has already streamed the parts to disk
+        json files = json::array();
+        size_t total_size = 0;
+        for (const auto& file : request.uploaded_files) {
+            files.push_back({
+                {"name", file.filename},
+                {"size", file.size},
+                {"type", file.content_type},
+                {"sha256", file.sha256}
+            });
+            total_size += file.size;
+        }
+        
+        if (!request.uploaded_files.empty() &&
+            !add_transfer_record(user_info.username, static_cast<int>(request.uploaded_files.size()),
+                                 static_cast<long>(total_size))) {
+            LOG_WARNING("Failed to record transfer for user: " + user_info.username);
+        }
+        
         json response_json;
         response_json["success"] = true;
         response_json["message"] = "Files uploaded successfully";
         response_json["data"] = {
-            {"files", json::array()},
-            {"total_size", 0},
+            {"files", files},
+            {"total_size", total_size},
             {"user_id", user_info.username}
         };
         
@@ -1391,26 +1668,74 @@ HttpResponse AuthHandler::handle_get_transfer_history(const HttpRequest& request
             return create_error_response(401, "Unauthorized");
         }
         
-        // For demo purposes, return mock transfer history
-        json mock_history = json::array();
-        mock_history.push_back({
-            {"id", "transfer_1"},
-            {"file_count", 3},
-            {"total_size", 1024000},
-            {"created_at", "2025-11-14T10:00:00"},
-            {"status", "completed"}
-        });
-        mock_history.push_back({
-            {"id", "transfer_2"},
-            {"file_count", 1},
-            {"total_size", 512000},
-            {"created_at", "2025-11-14T09:30:00"},
-            {"status", "completed"}
-        });
+        auto param = [&request](const char* name) {
+            auto it = request.query_params.find(name);
+            return it != request.query_params.end() ? std::string(it->second) : std::string();
+        };
+        
+        std::string after_created_at;
+        std::string after_id;
+        std::string cursor = param("cursor");
+        if (!cursor.empty() && !decode_history_cursor(cursor, after_created_at, after_id)) {
+            return create_error_response(400, "Invalid cursor");
+        }
+        
+        std::string limit_param = param("limit");
+        int limit = kHistoryDefaultLimit;
+        if (!limit_param.empty()) {
+            try {
+                limit = std::stoi(limit_param);
+            } catch (const std::exception&) {
+                return create_error_response(400, "Invalid limit");
+            }
+            if (limit < 1) {
+                return create_error_response(400, "Invalid limit");
+            }
+            limit = std::min(limit, kHistoryMaxLimit);
+        }
+        
+        bool ndjson = param("format") == "ndjson" ||
+                      request.get_header("Accept").find("application/x-ndjson") != std::string::npos;
+        if (ndjson) {
+            // Streams from the cursor to the oldest record unless a limit was given
+            auto stream = std::make_shared<HistoryStream>(db_pool_->acquire());
+            stream->user_id = user_info.username;
+            stream->stmt = prepare_history_page(stream->lease, user_info.username, after_created_at, after_id,
+                                                limit_param.empty() ? -1 : limit);
+            if (!stream->stmt) {
+                return create_error_response(500, "Internal server error");
+            }
+            
+            HttpResponse response;
+            response.headers["Content-Type"] = "application/x-ndjson";
+            response.set_stream([stream](char* buffer, size_t max) {
+                return stream->write(buffer, max);
+            });
+            return response;
+        }
+        
+        // One extra row tells whether another page follows
+        bool query_ok = true;
+        std::vector<TransferRecord> records =
+            get_user_transfer_history(user_info.username, after_created_at, after_id, limit + 1, &query_ok);
+        if (!query_ok) {
+            return create_error_response(500, "Internal server error");
+        }
+        
+        bool has_more = records.size() > static_cast<size_t>(limit);
+        if (has_more) {
+            records.pop_back();
+        }
+        
+        json history = json::array();
+        for (const auto& record : records) {
+            history.push_back(history_record_json(record));
+        }
         
         json response_json;
         response_json["success"] = true;
-        response_json["data"] = mock_history;
+        response_json["data"] = std::move(history);
+        response_json["next_cursor"] = has_more ? json(encode_history_cursor(records.back())) : json(nullptr);
         
         HttpResponse response;
         response.set_json_content(response_json.dump());
@@ -1423,10 +1748,11 @@ HttpResponse AuthHandler::handle_get_transfer_history(const HttpRequest& request
 
 HttpResponse AuthHandler::handle_validate_token(const HttpRequest& request) {
     try {
-        UserInfo user_info;
-        if (!authenticate_request(request, user_info)) {
+        VerifiedToken token;
+        if (!authenticate_request(request, token)) {
             return create_error_response(401, "Invalid or expired token");
         }
+        const UserInfo& user_info = token.user_info;
         
         json response_json;
         response_json["success"] = true;
@@ -1438,6 +1764,8 @@ HttpResponse AuthHandler::handle_validate_token(const HttpRequest& request) {
             {"full_name", user_info.full_name},
             {"auth_method", user_info.auth_method}
         };
+        response_json["token_type"] = token.type;
+        response_json["expires_at"] = token.expiry_time();
         
         HttpResponse response;
         response.set_json_content(response_json.dump());
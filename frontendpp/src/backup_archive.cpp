@@ -0,0 +1,408 @@
+#include "backup_archive.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kBlockSize = 512;
+const size_t kReadChunkSize = 64 * 1024;
+// A snapshot restarts when another connection writes to the source
+// between steps; after this many restarts it finishes in one step
+const int kMaxRestarts = 3;
+const int kBusyPauseMs = 10;
+const int kBusyTimeoutMs = 5000;
+const std::chrono::seconds kSnapshotDeadline(30);
+
+const char kZeros[kBlockSize * 2] = {};
+
+void write_octal(char* field, size_t width, uint64_t value) {
+    // width - 1 digits and a NUL
+    std::snprintf(field, width, "%0*llo", static_cast<int>(width - 1), static_cast<unsigned long long>(value));
+}
+
+bool query_int(sqlite3* db, const char* sql, int64_t& value) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    bool ok = sqlite3_step(stmt) == SQLITE_ROW;
+    if (ok) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+} // namespace
+
+struct BackupArchive::Snapshot {
+    sqlite3* db = nullptr;              // memdb holding the image
+    const unsigned char* data = nullptr;
+
+    ~Snapshot() {
+        if (db) {
+            sqlite3_close(db);
+        }
+    }
+};
+
+BackupArchive::BackupArchive() = default;
+
+BackupArchive::~BackupArchive() {
+    for (auto& entry : entries_) {
+        if (entry.fd >= 0) {
+            close(entry.fd);
+        }
+    }
+#ifdef HAVE_ZLIB
+    if (zlib_ready_) {
+        deflateEnd(&zlib_);
+    }
+#endif
+}
+
+std::string BackupArchive::archive_name(const std::string& path) {
+    std::vector<std::string> segments;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t slash = path.find('/', start);
+        if (slash == std::string::npos) {
+            slash = path.size();
+        }
+        std::string segment = path.substr(start, slash - start);
+        if (!segment.empty() && segment != "." && segment != "..") {
+            segments.push_back(std::move(segment));
+        }
+        start = slash + 1;
+    }
+
+    std::string name;
+    for (const auto& segment : segments) {
+        if (!name.empty()) {
+            name += '/';
+        }
+        name += segment;
+    }
+    return name;
+}
+
+bool BackupArchive::prepare(const Options& options, std::string& error, int& status) {
+    for (const auto& path : options.databases) {
+        Entry entry;
+        if (!snapshot_database(path, options, entry, error, status)) {
+            return false;
+        }
+        entries_.push_back(std::move(entry));
+    }
+
+    for (const auto& path : options.files) {
+        // A configured file that is not there is left out, not fatal
+        if (!add_file(path)) {
+            LOG_WARNING("Backup: skipping " + path + ": " + std::strerror(errno));
+        }
+    }
+
+    for (const auto& entry : entries_) {
+        // ustar splits a long name into a 155-byte prefix and a 100-byte name
+        if (entry.name.empty() || entry.name.size() > 255) {
+            error = "Cannot archive " + entry.name + ": unsupported name";
+            status = 500;
+            return false;
+        }
+    }
+
+#ifdef HAVE_ZLIB
+    // windowBits 15 + 16: gzip framing
+    if (deflateInit2(&zlib_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        error = "Compression unavailable";
+        status = 500;
+        return false;
+    }
+    zlib_ready_ = true;
+#endif
+    return true;
+}
+
+bool BackupArchive::snapshot_database(const std::string& path, const Options& options, Entry& entry,
+                                      std::string& error, int& status) {
+    status = 500;
+    sqlite3* source = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &source, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK) {
+        error = "Cannot open database " + path;
+        sqlite3_close(source);
+        return false;
+    }
+    sqlite3_busy_timeout(source, kBusyTimeoutMs);
+
+    int64_t page_size = 0;
+    int64_t page_count = 0;
+    if (!query_int(source, "PRAGMA page_size", page_size) || !query_int(source, "PRAGMA page_count", page_count)) {
+        error = "Cannot read database " + path;
+        sqlite3_close(source);
+        return false;
+    }
+    if (static_cast<uint64_t>(page_size * page_count) > options.max_snapshot_bytes) {
+        error = "Database " + path + " is larger than the snapshot limit";
+        status = 507;
+        sqlite3_close(source);
+        return false;
+    }
+
+    // A private memdb: the image lives in memory and can be read in place
+    auto snapshot = std::make_unique<Snapshot>();
+    if (sqlite3_open_v2("file:backup?vfs=memdb", &snapshot->db,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI, nullptr) != SQLITE_OK) {
+        error = "Cannot create an in-memory snapshot";
+        sqlite3_close(source);
+        return false;
+    }
+    std::string page_size_sql = "PRAGMA page_size = " + std::to_string(page_size);
+    sqlite3_exec(snapshot->db, page_size_sql.c_str(), nullptr, nullptr, nullptr);
+
+    sqlite3_backup* backup = sqlite3_backup_init(snapshot->db, "main", source, "main");
+    if (!backup) {
+        error = "Cannot snapshot database " + path + ": " + sqlite3_errmsg(snapshot->db);
+        sqlite3_close(source);
+        return false;
+    }
+
+    // Each step holds the source's read lock only while it copies its pages
+    int pages = std::max(1, options.step_pages);
+    int restarts = 0;
+    int last_remaining = -1;
+    auto deadline = std::chrono::steady_clock::now() + kSnapshotDeadline;
+    int rc;
+    for (;;) {
+        rc = sqlite3_backup_step(backup, pages);
+        if (rc == SQLITE_DONE) {
+            break;
+        }
+        if (rc == SQLITE_OK) {
+            int remaining = sqlite3_backup_remaining(backup);
+            if (last_remaining >= 0 && remaining > last_remaining && ++restarts >= kMaxRestarts) {
+                // Writes keep landing between steps; one read transaction
+                // finishes it (under WAL it still does not block writers)
+                pages = -1;
+            }
+            last_remaining = remaining;
+        } else if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            sqlite3_sleep(kBusyPauseMs);
+        } else {
+            break;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            rc = SQLITE_BUSY;
+            break;
+        }
+    }
+    sqlite3_backup_finish(backup);
+    sqlite3_close(source);
+    if (rc != SQLITE_DONE) {
+        error = "Snapshot of " + path + " failed: " + sqlite3_errstr(rc);
+        status = rc == SQLITE_BUSY || rc == SQLITE_LOCKED ? 503 : 500;
+        return false;
+    }
+
+    sqlite3_int64 size = 0;
+    snapshot->data = sqlite3_serialize(snapshot->db, "main", &size, SQLITE_SERIALIZE_NOCOPY);
+    if (!snapshot->data && size != 0) {
+        error = "Cannot read the snapshot of " + path;
+        return false;
+    }
+
+    struct stat info;
+    entry.name = archive_name(path);
+    entry.size = static_cast<uint64_t>(size);
+    entry.mtime = stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+    entry.snapshot = std::move(snapshot);
+    return true;
+}
+
+bool BackupArchive::add_file(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    Entry entry;
+    entry.name = archive_name(path);
+    entry.size = static_cast<uint64_t>(info.st_size);
+    entry.mtime = info.st_mtime;
+    entry.fd = fd;
+    entries_.push_back(std::move(entry));
+    return true;
+}
+
+void BackupArchive::fill_header(const Entry& entry) {
+    std::memset(header_, 0, sizeof(header_));
+
+    std::string name = entry.name;
+    std::string prefix;
+    if (name.size() > 100) {
+        size_t split = name.rfind('/', 155);
+        if (split != std::string::npos && name.size() - split - 1 <= 100) {
+            prefix = name.substr(0, split);
+            name = name.substr(split + 1);
+        } else {
+            name.resize(100);
+        }
+    }
+
+    std::memcpy(header_, name.data(), name.size());
+    write_octal(header_ + 100, 8, 0644);
+    write_octal(header_ + 108, 8, 0);
+    write_octal(header_ + 116, 8, 0);
+    write_octal(header_ + 124, 12, entry.size);
+    write_octal(header_ + 136, 12, static_cast<uint64_t>(std::max<int64_t>(0, entry.mtime)));
+    header_[156] = '0';
+    std::memcpy(header_ + 257, "ustar", 6);
+    std::memcpy(header_ + 263, "00", 2);
+    std::memcpy(header_ + 265, "root", 4);
+    std::memcpy(header_ + 297, "root", 4);
+    std::memcpy(header_ + 345, prefix.data(), prefix.size());
+
+    // The checksum is taken with its own field as spaces
+    std::memset(header_ + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        checksum += static_cast<unsigned char>(header_[i]);
+    }
+    std::snprintf(header_ + 148, 7, "%06o", checksum);
+    header_[155] = ' ';
+}
+
+bool BackupArchive::next_chunk() {
+    for (;;) {
+        if (phase_ == Phase::Done) {
+            return false;
+        }
+        if (phase_ == Phase::Trailer) {
+            pending_ = kZeros;
+            pending_size_ = sizeof(kZeros);
+            phase_ = Phase::Done;
+            return true;
+        }
+        if (entry_ >= entries_.size()) {
+            phase_ = Phase::Trailer;
+            continue;
+        }
+
+        Entry& entry = entries_[entry_];
+        switch (phase_) {
+            case Phase::Header:
+                fill_header(entry);
+                pending_ = header_;
+                pending_size_ = kBlockSize;
+                phase_ = Phase::Body;
+                offset_ = 0;
+                return true;
+
+            case Phase::Body: {
+                if (offset_ >= entry.size) {
+                    phase_ = Phase::Padding;
+                    continue;
+                }
+                size_t length = static_cast<size_t>(std::min<uint64_t>(entry.size - offset_, kReadChunkSize));
+                if (entry.snapshot) {
+                    // Straight out of the in-memory image
+                    pending_ = reinterpret_cast<const char*>(entry.snapshot->data) + offset_;
+                } else {
+                    chunk_.resize(kReadChunkSize);
+                    ssize_t got = read(entry.fd, chunk_.data(), length);
+                    if (got <= 0) {
+                        // The file shrank since its header went out; the
+                        // size there must still hold
+                        LOG_WARNING("Backup: " + entry.name + " changed while it was archived");
+                        std::memset(chunk_.data(), 0, length);
+                    } else {
+                        length = static_cast<size_t>(got);
+                    }
+                    pending_ = chunk_.data();
+                }
+                pending_size_ = length;
+                offset_ += length;
+                return true;
+            }
+
+            case Phase::Padding: {
+                size_t padding = static_cast<size_t>((kBlockSize - entry.size % kBlockSize) % kBlockSize);
+                if (entry.fd >= 0) {
+                    close(entry.fd);
+                    entry.fd = -1;
+                }
+                entry.snapshot.reset();
+                ++entry_;
+                phase_ = Phase::Header;
+                if (padding == 0) {
+                    continue;
+                }
+                pending_ = kZeros;
+                pending_size_ = padding;
+                return true;
+            }
+
+            default:
+                return false;
+        }
+    }
+}
+
+bool BackupArchive::compressed() const {
+#ifdef HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t BackupArchive::write(char* buffer, size_t max) {
+    size_t written = 0;
+
+#ifdef HAVE_ZLIB
+    while (written < max && !finished_) {
+        if (zlib_.avail_in == 0 && !input_done_) {
+            if (next_chunk()) {
+                zlib_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pending_));
+                zlib_.avail_in = static_cast<uInt>(pending_size_);
+            } else {
+                input_done_ = true;
+            }
+        }
+        zlib_.next_out = reinterpret_cast<Bytef*>(buffer + written);
+        zlib_.avail_out = static_cast<uInt>(max - written);
+        int rc = deflate(&zlib_, input_done_ ? Z_FINISH : Z_NO_FLUSH);
+        written = max - zlib_.avail_out;
+        if (rc == Z_STREAM_END) {
+            finished_ = true;
+        } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            LOG_ERROR("Backup: compression failed");
+            finished_ = true;
+        }
+    }
+#else
+    while (written < max) {
+        if (pending_size_ == 0 && !next_chunk()) {
+            break;
+        }
+        size_t length = std::min(pending_size_, max - written);
+        std::memcpy(buffer + written, pending_, length);
+        pending_ += length;
+        pending_size_ -= length;
+        written += length;
+    }
+#endif
+
+    return written;
+}
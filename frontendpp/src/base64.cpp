@@ -0,0 +1,130 @@
+#include "base64.h"
+
+namespace {
+
+const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// -1 outside the alphabet, -2 for the padding character
+struct DecodeTable {
+    signed char values[256];
+
+    DecodeTable() {
+        for (auto& value : values) {
+            value = -1;
+        }
+        for (int i = 0; i < 64; ++i) {
+            values[static_cast<unsigned char>(kAlphabet[i])] = static_cast<signed char>(i);
+        }
+        values[static_cast<unsigned char>('=')] = -2;
+    }
+};
+
+const DecodeTable kDecodeTable;
+
+// Writes the four characters of each complete group in [data, data + size)
+// to dest; returns the bytes consumed, a multiple of 3
+size_t encode_groups(const unsigned char* data, size_t size, char* dest) {
+    size_t whole = size - size % 3;
+    for (size_t i = 0; i < whole; i += 3) {
+        unsigned int group = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        *dest++ = kAlphabet[(group >> 18) & 0x3f];
+        *dest++ = kAlphabet[(group >> 12) & 0x3f];
+        *dest++ = kAlphabet[(group >> 6) & 0x3f];
+        *dest++ = kAlphabet[group & 0x3f];
+    }
+    return whole;
+}
+
+// Encodes the final one or two bytes with padding
+void encode_tail(const unsigned char* data, size_t size, std::string& out) {
+    if (size == 0) {
+        return;
+    }
+    unsigned int group = data[0] << 16;
+    if (size > 1) {
+        group |= data[1] << 8;
+    }
+    out += kAlphabet[(group >> 18) & 0x3f];
+    out += kAlphabet[(group >> 12) & 0x3f];
+    out += size > 1 ? kAlphabet[(group >> 6) & 0x3f] : '=';
+    out += '=';
+}
+
+} // namespace
+
+std::string Base64::encode(const std::string& data) {
+    return encode(data.data(), data.size());
+}
+
+std::string Base64::encode(const char* data, size_t size) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    std::string encoded;
+    encoded.reserve(encoded_size(size));
+    encoded.resize(size / 3 * 4);
+    size_t consumed = encode_groups(bytes, size, &encoded[0]);
+    encode_tail(bytes + consumed, size - consumed, encoded);
+    return encoded;
+}
+
+std::string Base64::decode(const std::string& encoded) {
+    std::string decoded;
+    decoded.reserve(encoded.size() / 4 * 3 + 2);
+    Decoder decoder;
+    decoder.update(encoded.data(), encoded.size(), decoded);
+    decoder.finish(decoded);
+    return decoded;
+}
+
+void Base64::Encoder::update(const char* data, size_t size, std::string& out) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+
+    // Complete the group left over from the previous chunk
+    while (carried_ > 0 && size > 0) {
+        carry_[carried_++] = *bytes++;
+        --size;
+        if (carried_ == 3) {
+            size_t old_size = out.size();
+            out.resize(old_size + 4);
+            encode_groups(carry_, 3, &out[old_size]);
+            carried_ = 0;
+        }
+    }
+    if (carried_ > 0) {
+        return;
+    }
+
+    size_t old_size = out.size();
+    out.resize(old_size + size / 3 * 4);
+    size_t consumed = encode_groups(bytes, size, &out[old_size]);
+    for (size_t i = consumed; i < size; ++i) {
+        carry_[carried_++] = bytes[i];
+    }
+}
+
+void Base64::Encoder::finish(std::string& out) {
+    encode_tail(carry_, carried_, out);
+    carried_ = 0;
+}
+
+void Base64::Decoder::update(const char* data, size_t size, std::string& out) {
+    for (size_t i = 0; i < size && !ended_; ++i) {
+        int value = kDecodeTable.values[static_cast<unsigned char>(data[i])];
+        if (value == -2) {
+            ended_ = true;
+        } else if (value >= 0) {
+            bits_ = (bits_ << 6) | static_cast<unsigned int>(value);
+            bit_count_ += 6;
+            if (bit_count_ >= 8) {
+                bit_count_ -= 8;
+                out += static_cast<char>((bits_ >> bit_count_) & 0xff);
+            }
+        }
+    }
+}
+
+void Base64::Decoder::finish(std::string&) {
+    // Leftover bits are padding
+    bits_ = 0;
+    bit_count_ = 0;
+    ended_ = false;
+}
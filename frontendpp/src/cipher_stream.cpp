@@ -0,0 +1,95 @@
+#include "cipher_stream.h"
+
+namespace {
+
+// Input handed to OpenSSL per call, which takes int lengths
+const size_t kChunkSize = 64 * 1024;
+
+} // namespace
+
+CipherStream::CipherStream(Mode mode, const unsigned char* key, const unsigned char* iv)
+    : ctx_(EVP_CIPHER_CTX_new()), mode_(mode) {
+    if (!ctx_) {
+        return;
+    }
+
+    int result = mode_ == Mode::Encrypt
+        ? EVP_EncryptInit_ex(ctx_, EVP_aes_256_cbc(), nullptr, key, iv)
+        : EVP_DecryptInit_ex(ctx_, EVP_aes_256_cbc(), nullptr, key, iv);
+    failed_ = result != 1;
+}
+
+CipherStream::~CipherStream() {
+    EVP_CIPHER_CTX_free(ctx_);
+}
+
+bool CipherStream::update(const char* data, size_t size, std::string& out) {
+    while (ok() && size > 0) {
+        size_t chunk = size < kChunkSize ? size : kChunkSize;
+        size_t old_size = out.size();
+        out.resize(old_size + chunk + EVP_MAX_BLOCK_LENGTH);
+
+        auto* dest = reinterpret_cast<unsigned char*>(&out[old_size]);
+        const auto* src = reinterpret_cast<const unsigned char*>(data);
+        int length = 0;
+        int result = mode_ == Mode::Encrypt
+            ? EVP_EncryptUpdate(ctx_, dest, &length, src, static_cast<int>(chunk))
+            : EVP_DecryptUpdate(ctx_, dest, &length, src, static_cast<int>(chunk));
+        if (result != 1) {
+            failed_ = true;
+            length = 0;
+        }
+        out.resize(old_size + length);
+
+        data += chunk;
+        size -= chunk;
+    }
+    return ok();
+}
+
+bool CipherStream::finish(std::string& out) {
+    if (!ok()) {
+        return false;
+    }
+
+    size_t old_size = out.size();
+    out.resize(old_size + EVP_MAX_BLOCK_LENGTH);
+    auto* dest = reinterpret_cast<unsigned char*>(&out[old_size]);
+    int length = 0;
+    int result = mode_ == Mode::Encrypt
+        ? EVP_EncryptFinal_ex(ctx_, dest, &length)
+        : EVP_DecryptFinal_ex(ctx_, dest, &length);
+    if (result != 1) {
+        failed_ = true;
+        length = 0;
+    }
+    out.resize(old_size + length);
+    return ok();
+}
+
+bool CipherStream::transform(std::istream& in, std::ostream& out) {
+    std::string input(kChunkSize, '\0');
+    std::string output;
+    output.reserve(kChunkSize + EVP_MAX_BLOCK_LENGTH);
+
+    while (ok() && in) {
+        in.read(&input[0], input.size());
+        std::streamsize got = in.gcount();
+        if (got <= 0) {
+            break;
+        }
+        output.clear();
+        if (update(input.data(), static_cast<size_t>(got), output)) {
+            out.write(output.data(), output.size());
+        }
+    }
+    if (in.bad()) {
+        failed_ = true;
+    }
+
+    output.clear();
+    if (finish(output)) {
+        out.write(output.data(), output.size());
+    }
+    return ok() && static_cast<bool>(out);
+}
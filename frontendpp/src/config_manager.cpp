@@ -1,7 +1,7 @@
 #include "config_manager.h"
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <algorithm>
 
 ConfigManager::ConfigManager() : config_data_(std::make_unique<json>()) {}
 
@@ -15,14 +15,30 @@ bool ConfigManager::load_config(const std::string& config_path) {
         
         config_file >> *config_data_;
         config_file.close();
+        values_.clear();
+        if (config_data_->is_object()) {
+            index_values(*config_data_, "");
+        }
         
         // Parse server configuration
         if (config_data_->contains("server")) {
-            auto server = (*config_data_)["server"];
+            const json& server = (*config_data_)["server"];
             server_config_.host = server.value("host", "0.0.0.0");
             server_config_.port = server.value("port", 9090);
             server_config_.max_connections = server.value("max_connections", 1000);
             server_config_.thread_pool_size = server.value("thread_pool_size", 4);
+            server_config_.threading_mode = server.value("threading_mode", "thread_pool");
+            server_config_.reuse_port = server.value("reuse_port", false);
+            server_config_.drain_seconds = std::max(0, server.value("drain_seconds", 10));
+            server_config_.compress_min_bytes = std::max(0, server.value("compress_min_bytes", 1024));
+            if (server.contains("compress_types")) {
+                server_config_.compress_types = server["compress_types"].get<std::vector<std::string>>();
+            }
+            server_config_.connection_memory_limit = std::max(8192, server.value("connection_memory_limit", 32768));
+            server_config_.connection_memory_increment = std::max(256, server.value("connection_memory_increment", 1024));
+            server_config_.per_ip_connection_limit = std::max(0, server.value("per_ip_connection_limit", 0));
+            server_config_.listen_backlog = std::max(0, server.value("listen_backlog", 0));
+            server_config_.connection_timeout_seconds = std::max(1, server.value("connection_timeout_seconds", 30));
             
             // Parse domain names
             if (server.contains("domain_names")) {
@@ -34,16 +50,34 @@ bool ConfigManager::load_config(const std::string& config_path) {
         
         // Parse paths configuration
         if (config_data_->contains("paths")) {
-            auto paths = (*config_data_)["paths"];
+            const json& paths = (*config_data_)["paths"];
             paths_config_.frontend_root = paths.value("frontend_root", "../");
             paths_config_.static_files = paths.value("static_files", "../assets");
             paths_config_.templates = paths.value("templates", "../templates");
+            paths_config_.uploads = paths.value("uploads", "data/uploads");
+            paths_config_.cache_static_assets = paths.value("cache_static_assets", true);
+            paths_config_.watch_static_assets = paths.value("watch_static_assets", true);
+            paths_config_.component_bundle = paths.value("component_bundle", "components");
+            paths_config_.fingerprint_assets = paths.value("fingerprint_assets", true);
+            paths_config_.cache_control.clear();
+            if (paths.contains("cache_control") && paths["cache_control"].is_array()) {
+                for (const auto& rule : paths["cache_control"]) {
+                    if (rule.is_object() && rule.contains("pattern") && rule.contains("value")) {
+                        paths_config_.cache_control.emplace_back(rule["pattern"].get<std::string>(),
+                                                                 rule["value"].get<std::string>());
+                    }
+                }
+            }
         }
         
         // Parse auth configuration with backward compatibility
         if (config_data_->contains("auth")) {
-            auto auth = (*config_data_)["auth"];
+            const json& auth = (*config_data_)["auth"];
             auth_config_.jwt_secret = auth.value("jwt_secret", "default-secret-change-this");
+            auth_config_.previous_jwt_secrets.clear();
+            if (auth.contains("previous_jwt_secrets")) {
+                auth_config_.previous_jwt_secrets = auth["previous_jwt_secrets"].get<std::vector<std::string>>();
+            }
             auth_config_.issuer = auth.value("issuer", "frontendpp-auth");
             auth_config_.audience = auth.value("audience", "frontendpp-users");
             
@@ -66,14 +100,19 @@ bool ConfigManager::load_config(const std::string& config_path) {
             
             auth_config_.enable_sliding_expiration = auth.value("enable_sliding_expiration", true);
             auth_config_.token_refresh_threshold_minutes = auth.value("token_refresh_threshold_minutes", 10);
+            auth_config_.password_hash_iterations = std::max(1, auth.value("password_hash_iterations", 100000));
+            auth_config_.password_hash_workers = std::max(1, auth.value("password_hash_workers", 2));
+            auth_config_.password_hash_queue = std::max(1, auth.value("password_hash_queue", 32));
         }
         
         // Parse security configuration
         if (config_data_->contains("security")) {
-            auto security = (*config_data_)["security"];
+            const json& security = (*config_data_)["security"];
             security_config_.enable_cors = security.value("enable_cors", true);
             security_config_.max_file_size_mb = security.value("max_file_size_mb", 100);
+            security_config_.max_request_body_kb = security.value("max_request_body_kb", 1024);
             security_config_.rate_limit_requests_per_minute = security.value("rate_limit_requests_per_minute", 60);
+            security_config_.rate_limit_burst = security.value("rate_limit_burst", 0);
             security_config_.enable_security_headers = security.value("enable_security_headers", true);
             security_config_.strict_transport_security = security.value("strict_transport_security", "max-age=31536000; includeSubDomains");
             security_config_.content_security_policy = security.value("content_security_policy", "default-src 'self'");
@@ -99,19 +138,76 @@ bool ConfigManager::load_config(const std::string& config_path) {
         
         // Parse logging configuration
         if (config_data_->contains("logging")) {
-            auto logging = (*config_data_)["logging"];
+            const json& logging = (*config_data_)["logging"];
             logging_config_.level = logging.value("level", "info");
             logging_config_.file = logging.value("file", "logs/frontendpp.log");
             logging_config_.console = logging.value("console", true);
+            logging_config_.access_log = logging.value("access_log", false);
+            logging_config_.access_log_body_sample_rate = logging.value("access_log_body_sample_rate", 0u);
+            logging_config_.access_log_body_sample_bytes = logging.value("access_log_body_sample_bytes", static_cast<size_t>(256));
         }
         
         // Parse database configuration
         if (config_data_->contains("database")) {
-            auto database = (*config_data_)["database"];
+            const json& database = (*config_data_)["database"];
             database_config_.type = database.value("type", "sqlite");
             database_config_.path = database.value("path", "data/auth.db");
         }
         
+        // Parse backup export configuration
+        if (config_data_->contains("backup")) {
+            const json& backup = (*config_data_)["backup"];
+            backup_config_.enabled = backup.value("enabled", true);
+            backup_config_.config_files = backup.value("config_files", std::vector<std::string>());
+            backup_config_.databases = backup.value("databases", std::vector<std::string>());
+            backup_config_.step_pages = std::max(1, backup.value("step_pages", 64));
+            backup_config_.max_snapshot_mb = std::max(1, backup.value("max_snapshot_mb", 64));
+        }
+        
+        // Parse firmware upgrade configuration
+        if (config_data_->contains("firmware")) {
+            const json& firmware = (*config_data_)["firmware"];
+            firmware_config_.enabled = firmware.value("enabled", true);
+            firmware_config_.partitions = firmware.value("partitions", std::vector<std::string>());
+            firmware_config_.public_key = firmware.value("public_key", "");
+            firmware_config_.ring_buffers = std::max(2, firmware.value("ring_buffers", 8));
+            firmware_config_.buffer_kb = std::max(4, firmware.value("buffer_kb", 1024)) / 4 * 4;
+            firmware_config_.max_image_mb = std::max(1, firmware.value("max_image_mb", 512));
+        }
+        
+        // Parse WebSocket proxy configuration
+        if (config_data_->contains("websocket_proxy")) {
+            const json& proxy = (*config_data_)["websocket_proxy"];
+            websocket_proxy_config_.enabled = proxy.value("enabled", false);
+            websocket_proxy_config_.path = proxy.value("path", "/ws");
+            websocket_proxy_config_.backend = proxy.value("backend", "127.0.0.1:9002");
+        }
+        
+        // Parse metrics endpoint configuration
+        if (config_data_->contains("metrics")) {
+            const json& metrics = (*config_data_)["metrics"];
+            metrics_config_.enabled = metrics.value("enabled", true);
+            metrics_config_.path = metrics.value("path", "/metrics");
+            metrics_config_.allow_remote = metrics.value("allow_remote", false);
+        }
+        
+        // Parse HTTPS configuration
+        if (config_data_->contains("tls")) {
+            const json& tls = (*config_data_)["tls"];
+            tls_config_.enabled = tls.value("enabled", false);
+            tls_config_.cert_file = tls.value("cert_file", "");
+            tls_config_.key_file = tls.value("key_file", "");
+            tls_config_.priorities = tls.value("priorities", "");
+        }
+        
+        // Parse trace span configuration
+        if (config_data_->contains("trace")) {
+            const json& trace = (*config_data_)["trace"];
+            trace_config_.enabled = trace.value("enabled", true);
+            trace_config_.buffer_events = std::max(16, trace.value("buffer_events", 2048));
+            trace_config_.path = trace.value("path", "/debug/trace");
+        }
+        
         return true;
         
     } catch (const std::exception& e) {
@@ -120,89 +216,56 @@ bool ConfigManager::load_config(const std::string& config_path) {
     }
 }
 
-std::string ConfigManager::get_config_string(const std::string& path, const std::string& default_value) const {
-    try {
-        std::istringstream path_stream(path);
-        std::string segment;
-        json* current = config_data_.get();
-        
-        while (std::getline(path_stream, segment, '.')) {
-            if (current->contains(segment)) {
-                current = &(*current)[segment];
-            } else {
-                return default_value;
-            }
-        }
-        
-        return current->get<std::string>();
-    } catch (...) {
-        return default_value;
+std::shared_ptr<const ConfigManager> ConfigStore::reload() {
+    auto next = std::make_shared<ConfigManager>();
+    if (!next->load_config(config_path_)) {
+        return nullptr;
     }
+    std::shared_ptr<const ConfigManager> snapshot = std::move(next);
+    std::atomic_store(&current_, snapshot);
+    return snapshot;
 }
 
-int ConfigManager::get_config_int(const std::string& path, int default_value) const {
-    try {
-        std::istringstream path_stream(path);
-        std::string segment;
-        json* current = config_data_.get();
-        
-        while (std::getline(path_stream, segment, '.')) {
-            if (current->contains(segment)) {
-                current = &(*current)[segment];
-            } else {
-                return default_value;
-            }
+void ConfigManager::index_values(const json& node, const std::string& prefix) {
+    for (auto it = node.begin(); it != node.end(); ++it) {
+        std::string path = prefix.empty() ? it.key() : prefix + "." + it.key();
+        if (it->is_object()) {
+            index_values(*it, path);
         }
-        
-        return current->get<int>();
-    } catch (...) {
-        return default_value;
+        values_.emplace(std::move(path), &*it);
     }
 }
 
+const json* ConfigManager::find_value(const std::string& path) const {
+    auto it = values_.find(path);
+    return it != values_.end() ? it->second : nullptr;
+}
+
+std::string ConfigManager::get_config_string(const std::string& path, const std::string& default_value) const {
+    const json* value = find_value(path);
+    return value && value->is_string() ? value->get<std::string>() : default_value;
+}
+
+int ConfigManager::get_config_int(const std::string& path, int default_value) const {
+    const json* value = find_value(path);
+    return value && value->is_number() ? value->get<int>() : default_value;
+}
+
 bool ConfigManager::get_config_bool(const std::string& path, bool default_value) const {
-    try {
-        std::istringstream path_stream(path);
-        std::string segment;
-        json* current = config_data_.get();
-        
-        while (std::getline(path_stream, segment, '.')) {
-            if (current->contains(segment)) {
-                current = &(*current)[segment];
-            } else {
-                return default_value;
-            }
-        }
-        
-        return current->get<bool>();
-    } catch (...) {
-        return default_value;
-    }
+    const json* value = find_value(path);
+    return value && value->is_boolean() ? value->get<bool>() : default_value;
 }
 
 std::vector<std::string> ConfigManager::get_config_array(const std::string& path) const {
     std::vector<std::string> result;
-    try {
-        std::istringstream path_stream(path);
-        std::string segment;
-        json* current = config_data_.get();
-        
-        while (std::getline(path_stream, segment, '.')) {
-            if (current->contains(segment)) {
-                current = &(*current)[segment];
-            } else {
-                return result;
-            }
-        }
-        
-        if (current->is_array()) {
-            for (const auto& item : *current) {
-                result.push_back(item.get<std::string>());
+    const json* value = find_value(path);
+    if (value && value->is_array()) {
+        for (const auto& item : *value) {
+            if (!item.is_string()) {
+                return {};
             }
+            result.push_back(item.get<std::string>());
         }
-    } catch (...) {
-        // Return empty vector on error
     }
-    
     return result;
 }
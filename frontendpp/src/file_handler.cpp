@@ -1,4 +1,5 @@
 #include "file_handler.h"
+#include "multipart_parser.h"
 #include "logger.h"
 #include <fstream>
 #include <sstream>
@@ -9,10 +10,134 @@
 #include <iomanip>
 #include <algorithm>
 #include <nlohmann/json.hpp>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <strings.h>
 
 namespace fs = std::filesystem;
 
-FileHandler::FileHandler(const std::string& static_root) : static_root_(static_root) {
+namespace {
+
+// Files up to this size are served from memory, larger ones with sendfile()
+const off_t kMaxCachedFileBytes = 256 * 1024;
+// The cache starts over once it would grow past this
+const size_t kMaxFileCacheBytes = 32 * 1024 * 1024;
+
+const char* const kDefaultCacheControl = "public, max-age=3600";
+
+// FNV-1a, fed a chunk at a time
+uint64_t fnv1a(uint64_t hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+
+std::string format_etag(uint64_t hash, size_t size) {
+    char etag[48];
+    std::snprintf(etag, sizeof(etag), "\"%zx-%016llx\"", size, static_cast<unsigned long long>(hash));
+    return etag;
+}
+
+// Whether an If-None-Match list names etag; W/ prefixes are ignored, as
+// the weak comparison GET uses allows
+bool etag_list_matches(std::string_view list, const std::string& etag) {
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string_view::npos) {
+            end = list.size();
+        }
+        std::string_view item = list.substr(pos, end - pos);
+        pos = end + 1;
+        
+        size_t first = item.find_first_not_of(" \t");
+        size_t last = item.find_last_not_of(" \t");
+        if (first == std::string_view::npos) {
+            continue;
+        }
+        item = item.substr(first, last - first + 1);
+        if (item == "*") {
+            return true;
+        }
+        if (item.compare(0, 2, "W/") == 0) {
+            item.remove_prefix(2);
+        }
+        if (item == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+enum class ByteRange { kNone, kSatisfiable, kUnsatisfiable };
+
+// A single "bytes=first-last", "bytes=first-" or "bytes=-suffix" range.
+// Anything else, multiple ranges included, is kNone and gets the whole file.
+ByteRange parse_byte_range(const std::string& header, uint64_t size, uint64_t& first, uint64_t& last) {
+    if (header.compare(0, 6, "bytes=") != 0 || header.find(',') != std::string::npos) {
+        return ByteRange::kNone;
+    }
+    std::string spec = header.substr(6);
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos) {
+        return ByteRange::kNone;
+    }
+    std::string from = spec.substr(0, dash);
+    std::string to = spec.substr(dash + 1);
+    auto all_digits = [](const std::string& value) {
+        return !value.empty() && std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); });
+    };
+    // Twenty digits could overflow; no file here is that large anyway
+    if ((!from.empty() && !all_digits(from)) || (!to.empty() && !all_digits(to)) || (from.empty() && to.empty()) ||
+        from.size() > 19 || to.size() > 19) {
+        return ByteRange::kNone;
+    }
+    
+    if (from.empty()) {
+        uint64_t suffix = std::stoull(to);
+        if (suffix == 0 || size == 0) {
+            return ByteRange::kUnsatisfiable;
+        }
+        first = suffix >= size ? 0 : size - suffix;
+        last = size - 1;
+        return ByteRange::kSatisfiable;
+    }
+    
+    first = std::stoull(from);
+    if (first >= size) {
+        return ByteRange::kUnsatisfiable;
+    }
+    last = to.empty() ? size - 1 : std::min<uint64_t>(std::stoull(to), size - 1);
+    if (last < first) {
+        return ByteRange::kNone;
+    }
+    return ByteRange::kSatisfiable;
+}
+
+// If-Range holds a strong ETag or an exact Last-Modified date
+bool if_range_matches(const std::string& if_range, const std::string& etag, time_t last_modified) {
+    if (if_range.empty()) {
+        return true;
+    }
+    if (if_range.front() == '"') {
+        return if_range == etag;
+    }
+    if (if_range.compare(0, 2, "W/") == 0) {
+        return false;
+    }
+    return if_range == FileHandler::format_http_date(last_modified);
+}
+
+} // namespace
+
+FileHandler::FileHandler(const std::string& static_root) : static_root_(static_root), file_cache_bytes_(0) {
     init_mime_types();
 }
 
@@ -34,7 +159,7 @@ void FileHandler::init_mime_types() {
     mime_types_[".uacc"] = "application/json";
 }
 
-std::string FileHandler::get_mime_type(const std::string& file_extension) {
+std::string FileHandler::get_mime_type(const std::string& file_extension) const {
     auto it = mime_types_.find(file_extension);
     if (it != mime_types_.end()) {
         return it->second;
@@ -42,7 +167,7 @@ std::string FileHandler::get_mime_type(const std::string& file_extension) {
     return "application/octet-stream";
 }
 
-std::string FileHandler::get_file_extension(const std::string& file_path) {
+std::string FileHandler::get_file_extension(const std::string& file_path) const {
     size_t dot_pos = file_path.find_last_of('.');
     if (dot_pos != std::string::npos) {
         return file_path.substr(dot_pos);
@@ -82,20 +207,62 @@ HttpResponse FileHandler::serve_static_file(const HttpRequest& request, const st
         }
     }
     
-    // Get file info
-    std::string content_type = get_mime_type(get_file_extension(full_path));
-    std::string last_modified = get_last_modified(full_path);
+    struct stat st;
+    if (::stat(full_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        response.set_error(500, "Failed to read file");
+        add_security_headers(response);
+        return response;
+    }
+    std::string etag = get_etag(full_path, st);
     
     // Set headers
-    response.headers["Content-Type"] = content_type;
-    response.headers["Last-Modified"] = last_modified;
-    response.headers["Cache-Control"] = "public, max-age=3600";
+    response.headers["Content-Type"] = get_mime_type(get_file_extension(full_path));
+    response.headers["Last-Modified"] = format_http_date(st.st_mtime);
+    response.headers["Cache-Control"] = get_cache_control(relative_path);
+    if (!etag.empty()) {
+        response.headers["ETag"] = etag;
+    }
+    
+    response.headers["Accept-Ranges"] = "bytes";
+    
+    if (is_not_modified(request, etag, st.st_mtime)) {
+        response.status_code = 304;
+        add_security_headers(response);
+        return response;
+    }
+    
+    // Resumed and chunked downloads; a changed file is sent whole
+    std::string range(request.get_header("Range"));
+    if (!range.empty() && if_range_matches(std::string(request.get_header("If-Range")), etag, st.st_mtime)) {
+        uint64_t size = static_cast<uint64_t>(st.st_size);
+        uint64_t first = 0;
+        uint64_t last = 0;
+        ByteRange result = parse_byte_range(range, size, first, last);
+        if (result == ByteRange::kUnsatisfiable) {
+            response.set_error(416, "Requested range not satisfiable");
+            response.headers["Content-Range"] = "bytes */" + std::to_string(size);
+            add_security_headers(response);
+            return response;
+        }
+        if (result == ByteRange::kSatisfiable) {
+            int fd = ::open(full_path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                response.set_error(500, "Failed to read file");
+                add_security_headers(response);
+                return response;
+            }
+            response.status_code = 206;
+            response.headers["Content-Range"] = "bytes " + std::to_string(first) + "-" + std::to_string(last) +
+                                                "/" + std::to_string(size);
+            response.set_file_descriptor(fd, last - first + 1, first);
+            LOG_FILE_REQUEST(relative_path, true);
+            add_security_headers(response);
+            return response;
+        }
+    }
     
     // Read file content
-    std::ifstream file(full_path, std::ios::binary);
-    if (file.is_open()) {
-        response.body = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
-        file.close();
+    if (load_file_body(full_path, response)) {
         LOG_FILE_REQUEST(relative_path, true);
     } else {
         response.set_error(500, "Failed to read file");
@@ -105,6 +272,169 @@ HttpResponse FileHandler::serve_static_file(const HttpRequest& request, const st
     return response;
 }
 
+std::string FileHandler::get_etag(const std::string& full_path, const struct stat& st) {
+    {
+        std::lock_guard<std::mutex> lock(file_cache_mutex_);
+        auto it = etag_cache_.find(full_path);
+        if (it != etag_cache_.end() && it->second.size == st.st_size &&
+            it->second.mtime.tv_sec == st.st_mtim.tv_sec && it->second.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+            return it->second.etag;
+        }
+    }
+    
+    std::ifstream file(full_path, std::ios::binary);
+    if (!file.is_open()) {
+        return "";
+    }
+    uint64_t hash = kFnvOffsetBasis;
+    size_t size = 0;
+    char buffer[64 * 1024];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+        hash = fnv1a(hash, buffer, static_cast<size_t>(file.gcount()));
+        size += static_cast<size_t>(file.gcount());
+    }
+    std::string etag = format_etag(hash, size);
+    
+    std::lock_guard<std::mutex> lock(file_cache_mutex_);
+    etag_cache_[full_path] = FileTag{st.st_size, st.st_mtim, etag};
+    return etag;
+}
+
+std::string FileHandler::compute_etag(const std::string& data) {
+    return format_etag(content_hash(data), data.size());
+}
+
+uint64_t FileHandler::content_hash(const std::string& data) {
+    return fnv1a(kFnvOffsetBasis, data.data(), data.size());
+}
+
+std::string FileHandler::variant_etag(const std::string& etag, const char* coding) {
+    return etag.substr(0, etag.size() - 1) + "-" + coding + "\"";
+}
+
+bool FileHandler::accepts_encoding(std::string_view accept_encoding, const std::string& coding) {
+    size_t pos = 0;
+    while (pos < accept_encoding.size()) {
+        size_t end = accept_encoding.find(',', pos);
+        if (end == std::string::npos) {
+            end = accept_encoding.size();
+        }
+        std::string item(accept_encoding.substr(pos, end - pos));
+        pos = end + 1;
+        
+        std::string params;
+        size_t semicolon = item.find(';');
+        if (semicolon != std::string::npos) {
+            params = item.substr(semicolon + 1);
+            item.resize(semicolon);
+        }
+        item.erase(std::remove_if(item.begin(), item.end(), [](unsigned char c) { return std::isspace(c); }), item.end());
+        params.erase(std::remove_if(params.begin(), params.end(), [](unsigned char c) { return std::isspace(c); }), params.end());
+        if (item != coding) {
+            continue;
+        }
+        return params.compare(0, 2, "q=") != 0 || std::strtod(params.c_str() + 2, nullptr) > 0.0;
+    }
+    return false;
+}
+
+bool FileHandler::is_not_modified(const HttpRequest& request, const std::string& etag, time_t last_modified) {
+    std::string_view if_none_match = request.get_header("If-None-Match");
+    if (!if_none_match.empty()) {
+        return !etag.empty() && etag_list_matches(if_none_match, etag);
+    }
+    
+    std::string if_modified_since(request.get_header("If-Modified-Since"));
+    if (if_modified_since.empty()) {
+        return false;
+    }
+    struct tm tm{};
+    const char* end = strptime(if_modified_since.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == nullptr) {
+        return false;
+    }
+    return last_modified <= timegm(&tm);
+}
+
+std::string FileHandler::format_http_date(time_t when) {
+    struct tm tm;
+    char date[64];
+    if (gmtime_r(&when, &tm) == nullptr || strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm) == 0) {
+        return "";
+    }
+    return date;
+}
+
+void FileHandler::set_cache_policy(const std::vector<std::pair<std::string, std::string>>& rules) {
+    cache_policy_.clear();
+    for (const auto& rule : rules) {
+        try {
+            cache_policy_.emplace_back(std::regex(rule.first, std::regex::ECMAScript | std::regex::optimize), rule.second);
+        } catch (const std::regex_error& e) {
+            LOG_WARNING("Ignoring cache policy pattern " + rule.first + ": " + e.what());
+        }
+    }
+}
+
+std::string FileHandler::get_cache_control(const std::string& relative_path) const {
+    for (const auto& rule : cache_policy_) {
+        if (std::regex_search(relative_path, rule.first)) {
+            return rule.second;
+        }
+    }
+    return kDefaultCacheControl;
+}
+
+bool FileHandler::load_file_body(const std::string& full_path, HttpResponse& response) {
+    struct stat st;
+    if (::stat(full_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    
+    if (st.st_size > kMaxCachedFileBytes) {
+        int fd = ::open(full_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        response.set_file_descriptor(fd, static_cast<uint64_t>(st.st_size));
+        return true;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(file_cache_mutex_);
+        auto it = file_cache_.find(full_path);
+        if (it != file_cache_.end() && it->second.size == st.st_size &&
+            it->second.mtime.tv_sec == st.st_mtim.tv_sec && it->second.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+            response.set_shared_body(it->second.data);
+            return true;
+        }
+    }
+    
+    std::ifstream file(full_path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    auto data = std::make_shared<const std::string>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    
+    {
+        std::lock_guard<std::mutex> lock(file_cache_mutex_);
+        auto it = file_cache_.find(full_path);
+        if (it != file_cache_.end()) {
+            file_cache_bytes_ -= it->second.data->size();
+            file_cache_.erase(it);
+        }
+        if (file_cache_bytes_ + data->size() > kMaxFileCacheBytes) {
+            file_cache_.clear();
+            file_cache_bytes_ = 0;
+        }
+        file_cache_[full_path] = CachedFile{data, st.st_size, st.st_mtim};
+        file_cache_bytes_ += data->size();
+    }
+    
+    response.set_shared_body(std::move(data));
+    return true;
+}
+
 HttpResponse FileHandler::handle_file_upload(const HttpRequest& request, const std::string& upload_dir) {
     HttpResponse response;
     
@@ -115,7 +445,7 @@ HttpResponse FileHandler::handle_file_upload(const HttpRequest& request, const s
         return response;
     }
     
-    std::string content_type = content_type_it->second;
+    std::string content_type(content_type_it->second);
     if (content_type.substr(0, 19) != "multipart/form-data") {
         response.set_error(400, "Content-Type must be multipart/form-data");
         return response;
@@ -158,118 +488,54 @@ HttpResponse FileHandler::handle_file_upload(const HttpRequest& request, const s
 std::vector<FileInfo> FileHandler::process_uploaded_files(const std::string& body, const std::string& content_type, const std::string& upload_dir) {
     std::vector<FileInfo> uploaded_files;
     
-    // Extract boundary from content type
-    std::vector<std::string> boundary_parts = parse_multipart_boundary(content_type);
-    if (boundary_parts.empty()) {
+    std::string boundary = MultipartParser::boundary_from_content_type(content_type);
+    if (boundary.empty()) {
         return uploaded_files;
     }
     
-    std::string boundary = boundary_parts[0];
-    
-    // Parse multipart data
-    std::map<std::string, std::string> form_data = parse_multipart_data(body, boundary);
-    
-    // Process uploaded files
-    for (const auto& [field_name, file_content] : form_data) {
-        if (field_name == "files") {
-            // Extract filename from content disposition
-            std::regex filename_regex("filename=\"([^\"]*)\"");
-            std::smatch filename_match;
-            
-            if (std::regex_search(body, filename_match, filename_regex)) {
-                std::string filename = filename_match[1].str();
-                
-                if (!filename.empty()) {
-                    // Generate unique filename
-                    std::string unique_filename = generate_unique_filename(filename);
-                    std::string saved_path = save_uploaded_file(unique_filename, file_content, upload_dir);
-                    
-                    if (!saved_path.empty()) {
-                        FileInfo file_info;
-                        file_info.name = filename;
-                        file_info.path = saved_path;
-                        file_info.size = file_content.length();
-                        file_info.content_type = get_mime_type(get_file_extension(filename));
-                        file_info.last_modified = get_last_modified(saved_path);
-                        
-                        uploaded_files.push_back(file_info);
-                    }
-                }
+    // Each "files" part is written out as it is scanned, never copied
+    std::ofstream out;
+    FileInfo current;
+    MultipartParser parser(
+        boundary,
+        [&](std::string_view headers) {
+            std::string_view disposition = MultipartParser::header_value(headers, "Content-Disposition");
+            std::string filename = MultipartParser::header_param(disposition, "filename");
+            if (MultipartParser::header_param(disposition, "name") != "files" || filename.empty()) {
+                return true;
             }
-        }
-    }
-    
-    return uploaded_files;
-}
-
-std::vector<std::string> FileHandler::parse_multipart_boundary(const std::string& content_type) {
-    std::vector<std::string> boundaries;
-    
-    std::regex boundary_regex(R"(boundary=([^;]+))");
-    std::smatch boundary_match;
-    
-    if (std::regex_search(content_type, boundary_match, boundary_regex)) {
-        boundaries.push_back("--" + boundary_match[1].str());
-    }
-    
-    return boundaries;
-}
-
-std::map<std::string, std::string> FileHandler::parse_multipart_data(const std::string& body, const std::string& boundary) {
-    std::map<std::string, std::string> form_data;
-    
-    size_t pos = 0;
-    std::string delimiter = boundary + "\r\n";
-    
-    while ((pos = body.find(delimiter, pos)) != std::string::npos) {
-        pos += delimiter.length();
-        
-        // Find end of headers
-        size_t headers_end = body.find("\r\n\r\n", pos);
-        if (headers_end == std::string::npos) break;
-        
-        // Extract headers
-        std::string headers = body.substr(pos, headers_end - pos);
-        
-        // Extract field name from content disposition
-        std::regex name_regex("name=\"([^\"]*)\"");
-        std::smatch name_match;
-        
-        if (std::regex_search(headers, name_match, name_regex)) {
-            std::string field_name = name_match[1].str();
-            
-            // Find end of this part
-            size_t part_end = body.find(boundary, headers_end + 4);
-            if (part_end == std::string::npos) break;
-            
-            // Extract content
-            std::string content = body.substr(headers_end + 4, part_end - headers_end - 4);
-            
-            // Remove trailing \r\n if present
-            if (content.length() >= 2 && content.substr(content.length() - 2) == "\r\n") {
-                content = content.substr(0, content.length() - 2);
+            current = FileInfo();
+            current.name = filename;
+            current.path = upload_dir + "/" + generate_unique_filename(filename);
+            current.size = 0;
+            out.open(current.path, std::ios::binary | std::ios::trunc);
+            return out.is_open();
+        },
+        [&](const char* data, size_t size) {
+            if (out.is_open()) {
+                out.write(data, static_cast<std::streamsize>(size));
+                current.size += size;
             }
-            
-            form_data[field_name] = content;
-        }
-        
-        pos = headers_end;
-    }
-    
-    return form_data;
-}
-
-std::string FileHandler::save_uploaded_file(const std::string& filename, const std::string& content, const std::string& upload_dir) {
-    std::string full_path = upload_dir + "/" + filename;
-    
-    std::ofstream file(full_path, std::ios::binary);
-    if (file.is_open()) {
-        file.write(content.c_str(), content.length());
-        file.close();
-        return full_path;
+            return !out.is_open() || static_cast<bool>(out);
+        },
+        [&]() {
+            if (!out.is_open()) {
+                return true;
+            }
+            out.close();
+            if (!out) {
+                return false;
+            }
+            current.content_type = get_mime_type(get_file_extension(current.name));
+            current.last_modified = get_last_modified(current.path);
+            uploaded_files.push_back(current);
+            return true;
+        });
+    
+    if (!parser.feed(body.data(), body.size()) || !parser.finish()) {
+        LOG_WARNING("Malformed multipart upload body");
     }
-    
-    return "";
+    return uploaded_files;
 }
 
 std::string FileHandler::generate_unique_filename(const std::string& original_name) {
@@ -299,18 +565,13 @@ bool FileHandler::is_directory(const std::string& file_path) {
     return fs::is_directory(file_path);
 }
 
-std::string FileHandler::get_last_modified(const std::string& file_path) {
-    try {
-        auto ftime = fs::last_write_time(file_path);
-        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-        std::time_t cftime = std::chrono::system_clock::to_time_t(sctp);
-        
-        std::stringstream ss;
-        ss << std::put_time(std::gmtime(&cftime), "%a, %d %b %Y %H:%M:%S GMT");
-        return ss.str();
-    } catch (const std::exception& e) {
+std::string FileHandler::get_last_modified(const std::string& file_path) const {
+    // From st_mtime, so it compares exactly against If-Modified-Since
+    struct stat st;
+    if (::stat(file_path.c_str(), &st) != 0) {
         return "";
     }
+    return format_http_date(st.st_mtime);
 }
 
 bool FileHandler::validate_file_size(size_t size, size_t max_size) {
@@ -323,11 +584,17 @@ bool FileHandler::validate_file_type(const std::string& filename, const std::vec
 }
 
 void FileHandler::add_security_headers(HttpResponse& response) {
-    response.headers["X-Content-Type-Options"] = "nosniff";
-    response.headers["X-Frame-Options"] = "DENY";
-    response.headers["X-XSS-Protection"] = "1; mode=block";
-    response.headers["Strict-Transport-Security"] = "max-age=31536000; includeSubDomains";
-    response.headers["Referrer-Policy"] = "strict-origin-when-cross-origin";
+    // Built once and shared by every static response
+    static const std::shared_ptr<const HeaderMap> security_headers = [] {
+        auto headers = std::make_shared<HeaderMap>();
+        headers->set("X-Content-Type-Options", "nosniff");
+        headers->set("X-Frame-Options", "DENY");
+        headers->set("X-XSS-Protection", "1; mode=block");
+        headers->set("Strict-Transport-Security", "max-age=31536000; includeSubDomains");
+        headers->set("Referrer-Policy", "strict-origin-when-cross-origin");
+        return headers;
+    }();
+    response.shared_headers = security_headers;
 }
 
 void FileHandler::add_cors_headers(HttpResponse& response, const std::string& origin) {
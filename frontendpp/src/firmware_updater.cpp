@@ -0,0 +1,543 @@
+#include "firmware_updater.h"
+#include "websocket_channel.h"
+#include "base64.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// O_DIRECT buffers, offsets and lengths are multiples of this
+const size_t kDirectAlignment = 4096;
+const std::chrono::milliseconds kProgressInterval(250);
+
+bool pwrite_all(int fd, const char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+std::string to_hex(const unsigned char* data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; ++i) {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 0x0f];
+    }
+    return hex;
+}
+
+HttpResponse json_response(int status, const nlohmann::json& body) {
+    HttpResponse response;
+    response.status_code = status;
+    response.set_json_content(body.dump());
+    return response;
+}
+
+} // namespace
+
+// One upload: the receiving thread fills ring slots in order, the hasher
+// and the writer follow it. Slot seq lives at slots_[seq % N]; the
+// receiver may only reuse a slot once the writer is past it.
+class FirmwareUpdater::Session : public BodySink {
+public:
+    Session(FirmwareUpdater& owner, std::string target, int fd, bool direct, uint64_t capacity,
+            uint64_t total, EVP_PKEY* key, std::string signature)
+        : owner_(owner), target_(std::move(target)), fd_(fd), direct_(direct), capacity_(capacity),
+          total_(total), key_(key), signature_(std::move(signature)) {}
+
+    ~Session() override {
+        stop("Upload abandoned");
+        join();
+        for (auto& slot : slots_) {
+            std::free(slot.data);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        EVP_MD_CTX_free(digest_);
+        EVP_MD_CTX_free(verify_);
+        EVP_PKEY_free(key_);
+    }
+
+    bool start(size_t buffer_size, size_t buffers) {
+        buffer_size_ = buffer_size;
+        slots_.resize(buffers);
+        for (auto& slot : slots_) {
+            void* data = nullptr;
+            if (posix_memalign(&data, kDirectAlignment, buffer_size_) != 0) {
+                return false;
+            }
+            slot.data = static_cast<char*>(data);
+        }
+
+        digest_ = EVP_MD_CTX_new();
+        if (!digest_ || EVP_DigestInit_ex(digest_, EVP_sha256(), nullptr) != 1) {
+            return false;
+        }
+        if (key_) {
+            verify_ = EVP_MD_CTX_new();
+            if (!verify_ || EVP_DigestVerifyInit(verify_, nullptr, EVP_sha256(), nullptr, key_) != 1) {
+                return false;
+            }
+        }
+
+        hasher_ = std::thread(&Session::hash_loop, this);
+        writer_ = std::thread(&Session::write_loop, this);
+        report("receiving", true);
+        return true;
+    }
+
+    bool write(const char* data, size_t size) override {
+        if (received_ + size > capacity_) {
+            stop("Image larger than the partition");
+            return false;
+        }
+        while (size > 0) {
+            if (fill_ == 0) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                changed_.wait(lock, [this] { return stopped_ || received_slots_ - written_slots_ < slots_.size(); });
+                if (stopped_) {
+                    return false;
+                }
+            }
+            Slot& slot = slots_[received_slots_ % slots_.size()];
+            size_t length = std::min(size, buffer_size_ - fill_);
+            std::memcpy(slot.data + fill_, data, length);
+            fill_ += length;
+            data += length;
+            size -= length;
+            received_ += length;
+            if (fill_ == buffer_size_) {
+                publish_slot();
+            }
+        }
+        report("receiving", false);
+        return true;
+    }
+
+    void abort() override {
+        stop("Upload interrupted");
+        join();
+        wipe();
+        report("failed", true);
+    }
+
+    // Ends the input, waits for both stages and checks the signature
+    HttpResponse finish() {
+        if (fill_ > 0) {
+            publish_slot();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            input_done_ = true;
+        }
+        changed_.notify_all();
+        join();
+
+        std::string error;
+        int status = 500;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error = error_;
+        }
+        if (error.empty() && total_ != 0 && received_ != total_) {
+            error = "Upload incomplete";
+            status = 400;
+        }
+
+        unsigned char hash[EVP_MAX_MD_SIZE];
+        unsigned int hash_length = 0;
+        if (error.empty() && EVP_DigestFinal_ex(digest_, hash, &hash_length) != 1) {
+            error = "Hashing failed";
+        }
+        if (error.empty() && verify_ &&
+            EVP_DigestVerifyFinal(verify_, reinterpret_cast<const unsigned char*>(signature_.data()),
+                                  signature_.size()) != 1) {
+            error = "Firmware signature check failed";
+            status = 400;
+        }
+
+        if (!error.empty()) {
+            LOG_ERROR("Firmware upgrade of " + target_ + " failed: " + error);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                error_ = error;
+            }
+            wipe();
+            report("failed", true);
+            HttpResponse response;
+            response.set_error(status, error);
+            return response;
+        }
+
+        sha256_ = to_hex(hash, hash_length);
+        LOG_INFO("Firmware written to " + target_ + " (" + std::to_string(received_) + " bytes, sha256 " + sha256_ + ")");
+        report("complete", true);
+        return json_response(200, {
+            {"success", true},
+            {"partition", target_},
+            {"bytes", received_.load()},
+            {"sha256", sha256_},
+            {"signature_verified", key_ != nullptr}
+        });
+    }
+
+private:
+    struct Slot {
+        char* data = nullptr;
+        size_t length = 0;
+    };
+
+    FirmwareUpdater& owner_;
+    const std::string target_;
+    int fd_;
+    bool direct_;                       // Writer thread only
+    const uint64_t capacity_;
+    const uint64_t total_;              // Content-Length, 0 if not sent
+    EVP_PKEY* key_;
+    const std::string signature_;
+
+    size_t buffer_size_ = 0;
+    std::vector<Slot> slots_;
+    size_t fill_ = 0;                   // Bytes in the slot being received
+    EVP_MD_CTX* digest_ = nullptr;
+    EVP_MD_CTX* verify_ = nullptr;      // Only with a public key
+    std::string sha256_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    uint64_t received_slots_ = 0;       // Slot sequence numbers, guarded by mutex_
+    uint64_t hashed_slots_ = 0;
+    uint64_t written_slots_ = 0;
+    bool input_done_ = false;
+    bool stopped_ = false;
+    std::string error_;
+
+    std::atomic<uint64_t> received_{0};  // Bytes, for progress
+    std::atomic<uint64_t> hashed_{0};
+    std::atomic<uint64_t> written_{0};
+    std::mutex report_mutex_;
+    std::chrono::steady_clock::time_point reported_at_;
+
+    std::thread hasher_;
+    std::thread writer_;
+
+    void publish_slot() {
+        slots_[received_slots_ % slots_.size()].length = fill_;
+        fill_ = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++received_slots_;
+        }
+        changed_.notify_all();
+    }
+
+    // First error wins; every stage stops at its next slot
+    void stop(const std::string& error) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!stopped_) {
+                stopped_ = true;
+                error_ = error;
+            }
+        }
+        changed_.notify_all();
+    }
+
+    void join() {
+        if (hasher_.joinable()) {
+            hasher_.join();
+        }
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+    }
+
+    void hash_loop() {
+        for (;;) {
+            uint64_t seq;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                changed_.wait(lock, [this] { return stopped_ || hashed_slots_ < received_slots_ || input_done_; });
+                if (stopped_ || hashed_slots_ == received_slots_) {
+                    return;
+                }
+                seq = hashed_slots_;
+            }
+            const Slot& slot = slots_[seq % slots_.size()];
+            if (EVP_DigestUpdate(digest_, slot.data, slot.length) != 1 ||
+                (verify_ && EVP_DigestVerifyUpdate(verify_, slot.data, slot.length) != 1)) {
+                stop("Hashing failed");
+                return;
+            }
+            hashed_ += slot.length;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++hashed_slots_;
+            }
+            changed_.notify_all();
+        }
+    }
+
+    void write_loop() {
+        for (;;) {
+            uint64_t seq;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                changed_.wait(lock, [this] {
+                    return stopped_ || written_slots_ < hashed_slots_ ||
+                           (input_done_ && hashed_slots_ == received_slots_);
+                });
+                if (stopped_) {
+                    return;
+                }
+                if (written_slots_ == hashed_slots_) {
+                    break;
+                }
+                seq = written_slots_;
+            }
+            const Slot& slot = slots_[seq % slots_.size()];
+            if (!write_slot(slot, seq * buffer_size_)) {
+                stop(std::string("Write to partition failed: ") + std::strerror(errno));
+                return;
+            }
+            written_ += slot.length;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++written_slots_;
+            }
+            changed_.notify_all();
+            report("receiving", false);
+        }
+        if (fdatasync(fd_) != 0) {
+            stop(std::string("Flushing the partition failed: ") + std::strerror(errno));
+        }
+    }
+
+    bool write_slot(const Slot& slot, uint64_t offset) {
+        size_t aligned = direct_ ? slot.length / kDirectAlignment * kDirectAlignment : slot.length;
+        if (aligned > 0 && !pwrite_all(fd_, slot.data, aligned, offset)) {
+            return false;
+        }
+        if (aligned < slot.length) {
+            // Only the last slot has a tail, which O_DIRECT cannot write
+            int flags = fcntl(fd_, F_GETFL);
+            if (flags < 0 || fcntl(fd_, F_SETFL, flags & ~O_DIRECT) != 0) {
+                return false;
+            }
+            direct_ = false;
+            return pwrite_all(fd_, slot.data + aligned, slot.length - aligned, offset + aligned);
+        }
+        return true;
+    }
+
+    // A partial or unverified image must not look bootable
+    void wipe() {
+        if (slots_.empty() || !slots_[0].data) {
+            return;
+        }
+        std::memset(slots_[0].data, 0, kDirectAlignment);
+        if (!pwrite_all(fd_, slots_[0].data, kDirectAlignment, 0) || fdatasync(fd_) != 0) {
+            LOG_ERROR("Failed to invalidate " + target_ + ": " + std::strerror(errno));
+        }
+    }
+
+    void report(const char* state, bool force) {
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(report_mutex_);
+            if (!force && now - reported_at_ < kProgressInterval) {
+                return;
+            }
+            reported_at_ = now;
+        }
+
+        nlohmann::json progress = {
+            {"type", "firmware_progress"},
+            {"state", state},
+            {"partition", target_},
+            {"total", total_},
+            {"received", received_.load()},
+            {"hashed", hashed_.load()},
+            {"written", written_.load()}
+        };
+        if (std::strcmp(state, "failed") == 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            progress["error"] = error_;
+        } else if (std::strcmp(state, "complete") == 0) {
+            progress["sha256"] = sha256_;
+        }
+        owner_.publish(progress);
+    }
+};
+
+FirmwareUpdater::FirmwareUpdater(FirmwareConfig config)
+    : config_(std::move(config)),
+      last_status_({{"type", "firmware_progress"}, {"state", "idle"}}) {}
+
+FirmwareUpdater::~FirmwareUpdater() = default;
+
+std::string FirmwareUpdater::select_partition(std::string& error) const {
+    struct stat root;
+    if (stat("/", &root) != 0) {
+        error = "Cannot identify the running partition";
+        return std::string();
+    }
+    for (const auto& partition : config_.partitions) {
+        struct stat info;
+        if (stat(partition.c_str(), &info) != 0) {
+            continue;
+        }
+        if (S_ISBLK(info.st_mode) && info.st_rdev == root.st_dev) {
+            continue;
+        }
+        return partition;
+    }
+    error = config_.partitions.empty() ? "No firmware partitions configured" : "No inactive firmware partition";
+    return std::string();
+}
+
+std::shared_ptr<BodySink> FirmwareUpdater::begin(const HttpRequest& request, int& status, std::string& message) {
+    std::string signature;
+    EVP_PKEY* key = nullptr;
+    if (!config_.public_key.empty()) {
+        signature = Base64::decode(std::string(request.get_header("X-Firmware-Signature")));
+        if (signature.empty()) {
+            status = 400;
+            message = "X-Firmware-Signature is required";
+            return nullptr;
+        }
+        FILE* file = std::fopen(config_.public_key.c_str(), "r");
+        if (file) {
+            key = PEM_read_PUBKEY(file, nullptr, nullptr, nullptr);
+            std::fclose(file);
+        }
+        if (!key) {
+            LOG_ERROR("Cannot load firmware public key " + config_.public_key);
+            status = 500;
+            message = "Firmware signing key unavailable";
+            return nullptr;
+        }
+    }
+
+    uint64_t total = 0;
+    std::string_view length = request.get_header("Content-Length");
+    if (!length.empty()) {
+        total = std::strtoull(std::string(length).c_str(), nullptr, 10);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!active_.expired()) {
+        EVP_PKEY_free(key);
+        status = 409;
+        message = "A firmware upgrade is already in progress";
+        return nullptr;
+    }
+
+    std::string target = select_partition(message);
+    if (target.empty()) {
+        EVP_PKEY_free(key);
+        status = 503;
+        return nullptr;
+    }
+
+    bool direct = true;
+    int fd = open(target.c_str(), O_WRONLY | O_CLOEXEC | O_DIRECT);
+    if (fd < 0 && errno == EINVAL) {
+        // Not every filesystem takes O_DIRECT (tmpfs, for one)
+        direct = false;
+        fd = open(target.c_str(), O_WRONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        EVP_PKEY_free(key);
+        LOG_ERROR("Cannot open " + target + ": " + std::strerror(errno));
+        status = 500;
+        message = "Cannot open the firmware partition";
+        return nullptr;
+    }
+
+    uint64_t capacity = static_cast<uint64_t>(config_.max_image_mb) * 1024 * 1024;
+    uint64_t device_size = 0;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISBLK(info.st_mode) && ioctl(fd, BLKGETSIZE64, &device_size) == 0) {
+        capacity = std::min(capacity, device_size);
+    }
+    if (total > capacity) {
+        close(fd);
+        EVP_PKEY_free(key);
+        status = 413;
+        message = "Image larger than the partition";
+        return nullptr;
+    }
+
+    // The session owns fd and key from here on
+    auto session = std::make_shared<Session>(*this, target, fd, direct, capacity, total, key, std::move(signature));
+    active_ = session;
+    // start() reports progress, which takes mutex_
+    lock.unlock();
+    if (!session->start(static_cast<size_t>(config_.buffer_kb) * 1024, static_cast<size_t>(config_.ring_buffers))) {
+        status = 500;
+        message = "Cannot start the firmware pipeline";
+        return nullptr;
+    }
+    LOG_INFO("Firmware upgrade started: writing " + target + (direct ? " (O_DIRECT)" : ""));
+    return session;
+}
+
+HttpResponse FirmwareUpdater::finish(const std::shared_ptr<BodySink>& sink) {
+    if (!sink) {
+        HttpResponse response;
+        response.set_error(500, "No firmware upload");
+        return response;
+    }
+    // Only sinks made by begin() reach the upload route
+    return static_cast<Session&>(*sink).finish();
+}
+
+void FirmwareUpdater::subscribe(std::shared_ptr<WebSocketChannel> channel) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (channel->send_text(last_status_.dump())) {
+        subscribers_.push_back(std::move(channel));
+    }
+}
+
+nlohmann::json FirmwareUpdater::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_status_;
+}
+
+void FirmwareUpdater::publish(const nlohmann::json& progress) {
+    std::string text = progress.dump();
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_status_ = progress;
+    subscribers_.erase(std::remove_if(subscribers_.begin(), subscribers_.end(),
+                                      [&text](const std::shared_ptr<WebSocketChannel>& channel) {
+                                          return !channel->send_text(text);
+                                      }),
+                       subscribers_.end());
+}
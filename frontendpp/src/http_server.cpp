@@ -1,38 +1,49 @@
 #include "http_server.h"
 #include "file_handler.h"
+#include "asset_cache.h"
+#include "rate_limiter.h"
+#include "response_compressor.h"
+#include "tls_credentials.h"
+#include "multipart_parser.h"
+#include "websocket_proxy.h"
+#include "websocket_channel.h"
 #include "logger.h"
+#include "ur-metrics/ur_metrics.hpp"
+#include "ur-trace/ur_trace.hpp"
 
 #ifdef HAVE_MICROHTTPD
 #include <microhttpd.h>
+#include <cctype>
 #include <cstring>
 #include <sstream>
 #include <iostream>
 #include <arpa/inet.h>
+#include <strings.h>
+#include <openssl/evp.h>
 #endif
 
+#include <array>
+#include <chrono>
 #include <fstream>
 #include <nlohmann/json.hpp>
 
-// Helper function to iterate over headers
-struct HeaderIteratorData {
-    std::map<std::string, std::string>* headers;
-};
-
 #ifdef HAVE_MICROHTTPD
+// Headers and arguments are viewed in place; MHD keeps them for the
+// lifetime of the request
 static enum MHD_Result header_iterator(void* cls, enum MHD_ValueKind kind,
                                        const char* key, const char* value) {
-    HeaderIteratorData* data = static_cast<HeaderIteratorData*>(cls);
-    if (data && data->headers && key && value) {
-        (*data->headers)[std::string(key)] = std::string(value);
+    HeaderViewMap* headers = static_cast<HeaderViewMap*>(cls);
+    if (headers && key && value) {
+        headers->set(key, value);
     }
     return MHD_YES;
 }
 
 static enum MHD_Result get_arg_iterator(void* cls, enum MHD_ValueKind kind,
                                         const char* key, const char* value) {
-    std::map<std::string, std::string>* params = static_cast<std::map<std::string, std::string>*>(cls);
+    ParamViewMap* params = static_cast<ParamViewMap*>(cls);
     if (params && key && value) {
-        (*params)[std::string(key)] = std::string(value);
+        params->set(key, value);
     }
     return MHD_YES;
 }
@@ -44,6 +55,7 @@ static enum MHD_Result get_arg_iterator(void* cls, enum MHD_ValueKind kind,
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <cstdlib>
 #include <sstream>
 #include <iostream>
 #include <regex>
@@ -54,8 +66,52 @@ static enum MHD_Result get_arg_iterator(void* cls, enum MHD_ValueKind kind,
 
 namespace fs = std::filesystem;
 
+#ifdef HAVE_MICROHTTPD
+namespace {
+
+// Status sent to WebSocket clients closed by drain()
+const uint16_t kCloseServiceRestart = 1012;
+
+// The first TCP listening socket passed by systemd socket activation, or -1.
+// This is sd_listen_fds() without libsystemd: LISTEN_FDS sockets from fd 3
+// on, meant for this process if LISTEN_PID says so. The environment is read
+// once and cleared so child processes do not take the sockets too.
+int inherited_listen_socket() {
+    static const int fd = [] {
+        const char* pid = std::getenv("LISTEN_PID");
+        const char* count = std::getenv("LISTEN_FDS");
+        int found = -1;
+        if (pid && count && std::strtol(pid, nullptr, 10) == getpid()) {
+            long fds = std::strtol(count, nullptr, 10);
+            for (int candidate = 3; candidate < 3 + fds; ++candidate) {
+                fcntl(candidate, F_SETFD, FD_CLOEXEC);
+                struct sockaddr_storage address = {};
+                socklen_t length = sizeof(address);
+                int listening = 0;
+                socklen_t option_length = sizeof(listening);
+                if (found < 0 &&
+                    getsockname(candidate, reinterpret_cast<struct sockaddr*>(&address), &length) == 0 &&
+                    (address.ss_family == AF_INET || address.ss_family == AF_INET6) &&
+                    getsockopt(candidate, SOL_SOCKET, SO_ACCEPTCONN, &listening, &option_length) == 0 &&
+                    listening) {
+                    found = candidate;
+                }
+            }
+        }
+        unsetenv("LISTEN_PID");
+        unsetenv("LISTEN_FDS");
+        unsetenv("LISTEN_FDNAMES");
+        return found;
+    }();
+    return fd;
+}
+
+} // namespace
+#endif
+
 HttpServer::HttpServer(const std::string& host, int port, int max_connections, int thread_pool_size)
-    : host_(host), port_(port), running_(false), max_connections_(max_connections), thread_pool_size_(thread_pool_size)
+    : host_(host), port_(port), running_(false), max_connections_(max_connections), thread_pool_size_(thread_pool_size),
+      threading_mode_(ThreadingMode::THREAD_POOL), max_body_bytes_(1024 * 1024)
 #ifdef HAVE_MICROHTTPD
     , daemon_(nullptr)
 #endif
@@ -72,16 +128,104 @@ bool HttpServer::start() {
         return true;
     }
     
+    // After set_default_headers(), so the preflights carry them too
+    build_preflight_responses();
+    
     // Start libmicrohttpd daemon
-    unsigned int flags = MHD_USE_SELECT_INTERNALLY | MHD_USE_ERROR_LOG;
+    // MHD_USE_ITC lets drain() quiesce the daemon in every threading mode
+    unsigned int flags = MHD_USE_ERROR_LOG | MHD_USE_ITC;
+    if (websocket_proxy_ || !websocket_routes_.empty()) {
+        if (MHD_is_feature_supported(MHD_FEATURE_UPGRADE) == MHD_YES) {
+            flags |= MHD_ALLOW_UPGRADE;
+        } else {
+            LOG_WARNING("libmicrohttpd lacks upgrade support, WebSockets disabled");
+        }
+    }
+    const ConnectionLimits& limits = connection_limits_;
+    std::vector<MHD_OptionItem> options = {
+        {MHD_OPTION_CONNECTION_LIMIT, static_cast<intptr_t>(max_connections_), nullptr},
+        {MHD_OPTION_CONNECTION_TIMEOUT, static_cast<intptr_t>(limits.idle_timeout_seconds), nullptr},
+        {MHD_OPTION_NOTIFY_COMPLETED, reinterpret_cast<intptr_t>(&HttpServer::request_completed_callback), this}
+    };
+    // MHD needs the increment well below the limit, or a connection cannot
+    // grow its read buffer at all
+    if (limits.memory_limit > 0) {
+        options.push_back({MHD_OPTION_CONNECTION_MEMORY_LIMIT, static_cast<intptr_t>(limits.memory_limit), nullptr});
+    }
+    if (limits.memory_increment > 0) {
+        size_t increment = limits.memory_limit > 0 ? std::min(limits.memory_increment, limits.memory_limit / 4)
+                                                   : limits.memory_increment;
+        options.push_back({MHD_OPTION_CONNECTION_MEMORY_INCREMENT, static_cast<intptr_t>(increment), nullptr});
+    }
+    if (limits.per_ip > 0) {
+        options.push_back({MHD_OPTION_PER_IP_CONNECTION_LIMIT, static_cast<intptr_t>(limits.per_ip), nullptr});
+    }
+    if (limits.listen_backlog > 0) {
+        options.push_back({MHD_OPTION_LISTEN_BACKLOG_SIZE, static_cast<intptr_t>(limits.listen_backlog), nullptr});
+    }
+    
+    // The certificate comes from a callback rather than MHD_OPTION_HTTPS_MEM_CERT,
+    // so a renewed one is used without restarting the daemon
+    if (tls_credentials_) {
+        if (MHD_is_feature_supported(MHD_FEATURE_HTTPS_CERT_CALLBACK) != MHD_YES || !tls_credentials_->loaded()) {
+            std::cerr << "HTTPS unavailable: libmicrohttpd lacks TLS or no certificate is loaded" << std::endl;
+            return false;
+        }
+        flags |= MHD_USE_TLS;
+        tls_credentials_->activate();
+        options.push_back({MHD_OPTION_HTTPS_CERT_CALLBACK, 0, TlsCredentials::handshake_callback()});
+        if (!tls_priorities_.empty()) {
+            options.push_back({MHD_OPTION_HTTPS_PRIORITIES, 0, const_cast<char*>(tls_priorities_.c_str())});
+        }
+    }
+    
+    // MHD closes its listening socket when it stops; systemd's stays open
+    // for the next start() and the next process
+    int inherited_fd = inherited_listen_socket();
+    int listen_fd = inherited_fd >= 0 ? fcntl(inherited_fd, F_DUPFD_CLOEXEC, 3) : -1;
+    if (listen_fd >= 0) {
+        options.push_back({MHD_OPTION_LISTEN_SOCKET, listen_fd, nullptr});
+        LOG_INFO("Listening on the socket passed by systemd");
+    } else if (reuse_port_) {
+        options.push_back({MHD_OPTION_LISTENING_ADDRESS_REUSE, 1, nullptr});
+    }
+    
+    switch (threading_mode_) {
+        case ThreadingMode::THREAD_POOL:
+            // Slow handlers only hold up the clients sharing their thread
+            if (MHD_is_feature_supported(MHD_FEATURE_EPOLL) == MHD_YES) {
+                flags |= MHD_USE_EPOLL_INTERNALLY;
+            } else if (MHD_is_feature_supported(MHD_FEATURE_POLL) == MHD_YES) {
+                flags |= MHD_USE_POLL_INTERNALLY;
+            } else {
+                flags |= MHD_USE_SELECT_INTERNALLY;
+            }
+            if (thread_pool_size_ > 1) {
+                options.push_back({MHD_OPTION_THREAD_POOL_SIZE, static_cast<intptr_t>(thread_pool_size_), nullptr});
+            }
+            break;
+        case ThreadingMode::THREAD_PER_CONNECTION:
+            flags |= MHD_USE_THREAD_PER_CONNECTION | MHD_USE_SELECT_INTERNALLY;
+            if (MHD_is_feature_supported(MHD_FEATURE_POLL) == MHD_YES) {
+                flags |= MHD_USE_POLL;
+            }
+            break;
+        case ThreadingMode::SELECT:
+        default:
+            flags |= MHD_USE_SELECT_INTERNALLY;
+            break;
+    }
+    options.push_back({MHD_OPTION_END, 0, nullptr});
     
     daemon_ = MHD_start_daemon(flags, port_, nullptr, nullptr,
                               &HttpServer::access_handler_callback, this,
-                              MHD_OPTION_CONNECTION_LIMIT, max_connections_,
-                              MHD_OPTION_CONNECTION_TIMEOUT, 120,
+                              MHD_OPTION_ARRAY, options.data(),
                               MHD_OPTION_END);
     
     if (!daemon_) {
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
         std::cerr << "Failed to start HTTP server with libmicrohttpd" << std::endl;
         return false;
     }
@@ -94,25 +238,331 @@ bool HttpServer::start() {
 #endif
 }
 
+bool HttpServer::parse_threading_mode(const std::string& name, ThreadingMode& mode) {
+    if (name == "select") {
+        mode = ThreadingMode::SELECT;
+    } else if (name == "thread_pool") {
+        mode = ThreadingMode::THREAD_POOL;
+    } else if (name == "thread_per_connection") {
+        mode = ThreadingMode::THREAD_PER_CONNECTION;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 void HttpServer::stop() {
 #ifdef HAVE_MICROHTTPD
     if (running_ && daemon_) {
         running_ = false;
+        // Upgraded connections must be handed back before MHD stops
+        if (websocket_proxy_) {
+            websocket_proxy_->close_all();
+        }
+        std::vector<std::weak_ptr<WebSocketChannel>> channels;
+        {
+            std::lock_guard<std::mutex> lock(channels_mutex_);
+            channels.swap(channels_);
+        }
+        for (auto& weak : channels) {
+            if (auto channel = weak.lock()) {
+                channel->close();
+            }
+        }
         MHD_stop_daemon(daemon_);
         daemon_ = nullptr;
     }
+    free_preflight_responses();
 #endif
 }
 
+void HttpServer::drain(std::chrono::seconds window) {
+#ifdef HAVE_MICROHTTPD
+    if (running_ && daemon_) {
+        auto deadline = std::chrono::steady_clock::now() + window;
+        
+        // Closing this copy of the listening socket leaves new connections
+        // to the other SO_REUSEPORT listener or to systemd's socket
+        MHD_socket listen_fd = MHD_quiesce_daemon(daemon_);
+        if (listen_fd != MHD_INVALID_SOCKET) {
+            close(listen_fd);
+        }
+        
+        std::vector<std::shared_ptr<WebSocketChannel>> channels;
+        {
+            std::lock_guard<std::mutex> lock(channels_mutex_);
+            for (auto& weak : channels_) {
+                if (auto channel = weak.lock()) {
+                    channels.push_back(std::move(channel));
+                }
+            }
+        }
+        size_t relays = websocket_proxy_ ? websocket_proxy_->relay_count() : 0;
+        LOG_INFO("Draining: " + std::to_string(channels.size() + relays) + " WebSocket(s) to close within " +
+                 std::to_string(window.count()) + "s");
+        
+        std::chrono::milliseconds spacing(0);
+        if (!channels.empty() || relays) {
+            spacing = std::chrono::duration_cast<std::chrono::milliseconds>(window / 2) / (channels.size() + relays);
+        }
+        for (auto& channel : channels) {
+            channel->close(kCloseServiceRestart);
+            std::this_thread::sleep_for(spacing);
+        }
+        // Proxied frames pass through untouched, so a relay can only be cut;
+        // the client sees an abnormal close and reconnects the same way
+        while (websocket_proxy_ && relays-- > 0 && websocket_proxy_->close_one()) {
+            std::this_thread::sleep_for(spacing);
+        }
+        
+        while (std::chrono::steady_clock::now() < deadline) {
+            const union MHD_DaemonInfo* info = MHD_get_daemon_info(daemon_, MHD_DAEMON_INFO_CURRENT_CONNECTIONS);
+            if (!info || info->num_connections == 0) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+#endif
+    stop();
+}
+
+#ifdef HAVE_MICROHTTPD
+namespace {
+
+// Non-file fields of an upload form are kept in memory up to this size
+const size_t kMaxFormFieldBytes = 64 * 1024;
+
+// Multipart body of an upload route, written to disk as it arrives
+struct UploadState {
+    const UploadOptions* options = nullptr;
+    std::unique_ptr<MultipartParser> parser;
+    std::vector<UploadedFile> files;
+    std::map<std::string, std::string> fields;
+    std::ofstream out;              // File part being written
+    std::string temp_path;          // Its name until the part is complete
+    EVP_MD_CTX* digest = nullptr;   // SHA-256 of the part so far
+    size_t total_bytes = 0;
+    int error_status = 0;
+    std::string error_message;
+    
+    std::string* field_value = nullptr;     // Non-file part being read
+    
+    ~UploadState() {
+        EVP_MD_CTX_free(digest);
+    }
+    
+    // Starts the next file part under a temporary name
+    bool begin_part(UploadedFile file) {
+        temp_path = file.path + ".part";
+        out.open(temp_path, std::ios::binary | std::ios::trunc);
+        if (!digest) {
+            digest = EVP_MD_CTX_new();
+        }
+        files.push_back(std::move(file));
+        return out.is_open() && digest && EVP_DigestInit_ex(digest, EVP_sha256(), nullptr) == 1;
+    }
+    
+    bool write_part(const char* data, size_t size) {
+        out.write(data, static_cast<std::streamsize>(size));
+        return out && EVP_DigestUpdate(digest, data, size) == 1;
+    }
+    
+    // Records the digest and moves the part to its final name
+    bool finish_part() {
+        if (temp_path.empty()) {
+            return true;
+        }
+        out.close();
+        bool ok = static_cast<bool>(out);
+        
+        unsigned char hash[EVP_MAX_MD_SIZE];
+        unsigned int hash_length = 0;
+        ok = EVP_DigestFinal_ex(digest, hash, &hash_length) == 1 && ok;
+        static const char digits[] = "0123456789abcdef";
+        UploadedFile& file = files.back();
+        file.sha256.clear();
+        for (unsigned int i = 0; i < hash_length; ++i) {
+            file.sha256 += digits[hash[i] >> 4];
+            file.sha256 += digits[hash[i] & 0x0f];
+        }
+        
+        std::error_code ec;
+        fs::rename(temp_path, file.path, ec);
+        if (ec) {
+            fs::remove(temp_path, ec);
+            ok = false;
+        }
+        temp_path.clear();
+        return ok;
+    }
+    
+    void fail(int status, const std::string& message) {
+        if (error_status == 0) {
+            error_status = status;
+            error_message = message;
+        }
+    }
+    
+    // Rejected or interrupted uploads leave nothing behind
+    void discard_files() {
+        out.close();
+        std::error_code ec;
+        if (!temp_path.empty()) {
+            fs::remove(temp_path, ec);
+            temp_path.clear();
+        }
+        for (const auto& file : files) {
+            fs::remove(file.path, ec);
+        }
+        files.clear();
+    }
+};
+
+// Client file names only contribute their last component, made safe
+std::string sanitize_filename(const std::string& name) {
+    std::string safe;
+    for (char c : fs::path(name).filename().string()) {
+        bool allowed = std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '-' || c == '_';
+        safe.push_back(allowed ? c : '_');
+    }
+    if (safe.empty() || safe == "." || safe == "..") {
+        safe = "upload";
+    }
+    return safe;
+}
+
+std::string unique_upload_path(const std::string& upload_dir, const std::string& filename) {
+    static std::atomic<uint64_t> counter{0};
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    return upload_dir + "/" + std::to_string(now) + "_" + std::to_string(counter.fetch_add(1)) + "_" + filename;
+}
+
+// Multipart callbacks of an upload; returning false stops the parse
+bool upload_part_begin(UploadState* state, std::string_view headers) {
+    std::string_view disposition = MultipartParser::header_value(headers, "Content-Disposition");
+    std::string field_name = MultipartParser::header_param(disposition, "name");
+    bool is_file = false;
+    std::string filename = MultipartParser::header_param(disposition, "filename", &is_file);
+    
+    if (!is_file) {
+        state->field_value = &state->fields[field_name];
+        return true;
+    }
+    
+    state->field_value = nullptr;
+    std::string_view content_type = MultipartParser::header_value(headers, "Content-Type");
+    UploadedFile file;
+    file.field_name = field_name;
+    file.filename = filename;
+    file.content_type = content_type.empty() ? "application/octet-stream" : std::string(content_type);
+    file.path = unique_upload_path(state->options->upload_dir, sanitize_filename(filename));
+    if (!state->begin_part(std::move(file))) {
+        state->fail(500, "Failed to store upload");
+        return false;
+    }
+    return true;
+}
+
+bool upload_part_data(UploadState* state, const char* data, size_t size) {
+    if (state->total_bytes + size > state->options->max_total_bytes) {
+        state->fail(413, "Upload too large");
+        return false;
+    }
+    state->total_bytes += size;
+    
+    if (state->field_value) {
+        if (state->field_value->size() + size > kMaxFormFieldBytes) {
+            state->fail(413, "Form field too large");
+            return false;
+        }
+        state->field_value->append(data, size);
+        return true;
+    }
+    
+    UploadedFile& file = state->files.back();
+    if (file.size + size > state->options->max_file_bytes) {
+        state->fail(413, "File too large");
+        return false;
+    }
+    if (!state->write_part(data, size)) {
+        state->fail(500, "Failed to store upload");
+        return false;
+    }
+    file.size += size;
+    return true;
+}
+
+bool upload_part_end(UploadState* state) {
+    if (state->field_value) {
+        state->field_value = nullptr;
+        return true;
+    }
+    if (!state->finish_part()) {
+        state->fail(500, "Failed to store upload");
+        return false;
+    }
+    return true;
+}
+
+size_t declared_content_length(struct MHD_Connection* connection) {
+    const char* value = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_CONTENT_LENGTH);
+    if (!value) {
+        return 0;
+    }
+    try {
+        return static_cast<size_t>(std::stoull(value));
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+// Rate limiter key of the peer address; 0 when it is unknown
+uint64_t client_key(struct MHD_Connection* connection) {
+    const union MHD_ConnectionInfo* info = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+    if (!info || !info->client_addr) {
+        return 0;
+    }
+    const struct sockaddr* addr = info->client_addr;
+    if (addr->sa_family == AF_INET) {
+        const auto* addr_in = reinterpret_cast<const struct sockaddr_in*>(addr);
+        return RateLimiter::key_for(&addr_in->sin_addr, sizeof(addr_in->sin_addr));
+    }
+    if (addr->sa_family == AF_INET6) {
+        const auto* addr_in6 = reinterpret_cast<const struct sockaddr_in6*>(addr);
+        return RateLimiter::key_for(&addr_in6->sin6_addr, sizeof(addr_in6->sin6_addr));
+    }
+    return 0;
+}
+
+bool wants_websocket(struct MHD_Connection* connection) {
+    const char* upgrade = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_UPGRADE);
+    return upgrade && strcasecmp(upgrade, "websocket") == 0;
+}
+
+} // namespace
+
 // Connection context for handling POST data
 struct ConnectionContext {
     std::string post_data;
     bool first_call;
+    std::chrono::steady_clock::time_point started;
+    std::unique_ptr<UploadState> upload;    // Set on upload routes
+    int reject_status;                      // Body outgrew max_body_bytes_
+    bool responded;                         // Refused before the body was read
+    std::unique_ptr<ProxyTunnel> tunnel;    // Backend of an accepted upgrade
+    const WebSocketOptions* websocket;      // Local WebSocket route being upgraded
+    std::shared_ptr<BodySink> sink;         // Set on stream routes
+    size_t sink_limit;
+    size_t sink_bytes;
+    bool sink_stopped;                      // Over the limit or refused by the sink
     
-    ConnectionContext() : first_call(true) {}
+    ConnectionContext() : first_call(true), started(std::chrono::steady_clock::now()),
+                          reject_status(0), responded(false), websocket(nullptr),
+                          sink_limit(0), sink_bytes(0), sink_stopped(false) {}
 };
 
-#ifdef HAVE_MICROHTTPD
 enum MHD_Result HttpServer::access_handler_callback(void* cls,
                                                     struct MHD_Connection* connection,
                                                     const char* url,
@@ -121,6 +571,7 @@ enum MHD_Result HttpServer::access_handler_callback(void* cls,
                                                     const char* upload_data,
                                                     size_t* upload_data_size,
                                                     void** con_cls) {
+    UR_TRACE_SPAN("http.access_handler");
     HttpServer* server = static_cast<HttpServer*>(cls);
     if (!server) {
         return MHD_NO;
@@ -128,23 +579,212 @@ enum MHD_Result HttpServer::access_handler_callback(void* cls,
     
     // Initialize connection context on first call
     if (*con_cls == nullptr) {
-        std::string* post_data = new std::string();
-        *con_cls = post_data;
+        ConnectionContext* context = new ConnectionContext();
+        *con_cls = context;
+        
+        // Requests that cannot succeed are answered before the body is sent
+        auto send_early = [&](const HttpResponse& response) {
+            LOG_HTTP_RESPONSE(response.status_code, response.content_length());
+            context->responded = true;
+            struct MHD_Response* mhd_response = server->create_mhd_response(response);
+            if (!mhd_response) {
+                return MHD_NO;
+            }
+            enum MHD_Result queued = MHD_queue_response(connection, response.status_code, mhd_response);
+            MHD_destroy_response(mhd_response);
+            return queued;
+        };
+        auto refuse = [&](int status_code, const std::string& message) {
+            HttpResponse response;
+            response.set_error(status_code, message);
+            return send_early(response);
+        };
+        
+        // Checked before any routing, so rejected clients cost almost nothing
+        if (server->rate_limit_enabled_.load(std::memory_order_acquire)) {
+            uint64_t key = client_key(connection);
+            unsigned retry_after = 0;
+            if (key != 0 && !server->rate_limiter_->allow(key, &retry_after)) {
+                HttpResponse response;
+                response.set_error(429, "Too many requests");
+                response.headers["Retry-After"] = std::to_string(std::max(1u, retry_after));
+                return send_early(response);
+            }
+        }
+        
+        // The backend answers the handshake; its 101 is passed on and the
+        // socket goes to the proxy in upgrade_callback()
+        if (server->websocket_proxy_ && std::strcmp(method, "GET") == 0 &&
+            server->websocket_proxy_path_ == url && wants_websocket(connection)) {
+            HttpRequest request;
+            server->convert_mhd_request(url, method, connection, nullptr, 0, request);
+            LOG_HTTP_REQUEST(request.method, request.path, request.client_ip);
+            context->tunnel = server->websocket_proxy_->open(request);
+            if (!context->tunnel) {
+                return refuse(502, "WebSocket backend unavailable");
+            }
+            
+            struct MHD_Response* mhd_response = MHD_create_response_for_upgrade(&HttpServer::upgrade_callback, server);
+            if (!mhd_response) {
+                return MHD_NO;
+            }
+            for (const auto& header : context->tunnel->response_headers) {
+                // MHD sets "Connection: Upgrade" itself
+                if (strcasecmp(header.first.c_str(), "Connection") != 0) {
+                    MHD_add_response_header(mhd_response, header.first.c_str(), header.second.c_str());
+                }
+            }
+            LOG_HTTP_RESPONSE(MHD_HTTP_SWITCHING_PROTOCOLS, 0);
+            context->responded = true;
+            enum MHD_Result queued = MHD_queue_response(connection, MHD_HTTP_SWITCHING_PROTOCOLS, mhd_response);
+            MHD_destroy_response(mhd_response);
+            return queued;
+        }
+        
+        // WebSockets of this server: the handshake is answered here
+        auto websocket_route = server->websocket_routes_.end();
+        if (std::strcmp(method, "GET") == 0 && wants_websocket(connection)) {
+            websocket_route = server->websocket_routes_.find(url);
+        }
+        if (websocket_route != server->websocket_routes_.end()) {
+            HttpRequest request;
+            server->convert_mhd_request(url, method, connection, nullptr, 0, request);
+            LOG_HTTP_REQUEST(request.method, request.path, request.client_ip);
+            if (websocket_route->second.authorize && !websocket_route->second.authorize(request)) {
+                return refuse(401, "Unauthorized");
+            }
+            std::string_view key = request.get_header("Sec-WebSocket-Key");
+            if (key.empty()) {
+                return refuse(400, "Missing Sec-WebSocket-Key");
+            }
+            
+            struct MHD_Response* mhd_response = MHD_create_response_for_upgrade(&HttpServer::upgrade_callback, server);
+            if (!mhd_response) {
+                return MHD_NO;
+            }
+            MHD_add_response_header(mhd_response, MHD_HTTP_HEADER_UPGRADE, "websocket");
+            MHD_add_response_header(mhd_response, "Sec-WebSocket-Accept", WebSocketChannel::accept_key(key).c_str());
+            context->websocket = &websocket_route->second;
+            LOG_HTTP_RESPONSE(MHD_HTTP_SWITCHING_PROTOCOLS, 0);
+            context->responded = true;
+            enum MHD_Result queued = MHD_queue_response(connection, MHD_HTTP_SWITCHING_PROTOCOLS, mhd_response);
+            MHD_destroy_response(mhd_response);
+            return queued;
+        }
+        
+        if (server->cors_enabled_ && std::strcmp(method, "OPTIONS") == 0) {
+            const char* origin = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Origin");
+            auto prebuilt = server->preflight_responses_.find(origin ? origin : "*");
+            if (prebuilt == server->preflight_responses_.end()) {
+                return send_early(server->make_preflight_response(origin));
+            }
+            LOG_HTTP_RESPONSE(204, 0);
+            context->responded = true;
+            return MHD_queue_response(connection, 204, prebuilt->second);
+        }
+        
+        std::string path(url);
+        path = path.substr(0, path.find('?'));
+        size_t content_length = declared_content_length(connection);
+        auto upload_route = server->upload_routes_.end();
+        auto stream_route = server->stream_routes_.end();
+        if (std::strcmp(method, "POST") == 0) {
+            upload_route = server->upload_routes_.find(path);
+            stream_route = server->stream_routes_.find(path);
+        }
+        
+        if (stream_route != server->stream_routes_.end()) {
+            const StreamOptions& options = stream_route->second;
+            if (content_length > options.max_bytes) {
+                return refuse(413, "Request body too large");
+            }
+            HttpRequest head;
+            server->convert_mhd_request(url, method, connection, nullptr, 0, head);
+            int status = 500;
+            std::string message;
+            context->sink = options.open(head, status, message);
+            if (!context->sink) {
+                return refuse(status, message);
+            }
+            context->sink_limit = options.max_bytes;
+        } else if (upload_route != server->upload_routes_.end()) {
+            const UploadOptions& options = upload_route->second;
+            if (options.authorize) {
+                HttpRequest head;
+                server->convert_mhd_request(url, method, connection, nullptr, 0, head);
+                if (!options.authorize(head)) {
+                    return refuse(401, "Unauthorized");
+                }
+            }
+            if (content_length > options.max_total_bytes) {
+                return refuse(413, "Upload too large");
+            }
+            
+            std::error_code ec;
+            fs::create_directories(options.upload_dir, ec);
+            context->upload = std::make_unique<UploadState>();
+            context->upload->options = &options;
+            const char* content_type = MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                                   MHD_HTTP_HEADER_CONTENT_TYPE);
+            std::string boundary = MultipartParser::boundary_from_content_type(content_type ? content_type : "");
+            if (boundary.empty()) {
+                return refuse(415, "Content-Type must be multipart/form-data");
+            }
+            UploadState* state = context->upload.get();
+            state->parser = std::make_unique<MultipartParser>(
+                boundary,
+                [state](std::string_view headers) { return upload_part_begin(state, headers); },
+                [state](const char* data, size_t size) { return upload_part_data(state, data, size); },
+                [state]() { return upload_part_end(state); });
+        } else if (content_length > server->max_body_bytes_) {
+            return refuse(413, "Request body too large");
+        }
         return MHD_YES;
     }
     
-    std::string* post_data = static_cast<std::string*>(*con_cls);
-    if (!post_data) {
+    ConnectionContext* context = static_cast<ConnectionContext*>(*con_cls);
+    if (!context) {
         return MHD_NO;
     }
+    std::string* post_data = &context->post_data;
     
     // Handle POST data upload
     if (*upload_data_size > 0) {
-        post_data->append(upload_data, *upload_data_size);
+        if (context->responded) {
+            // Already answered; the connection closes after the response
+        } else if (context->sink) {
+            if (!context->sink_stopped) {
+                context->sink_bytes += *upload_data_size;
+                if (context->sink_bytes > context->sink_limit) {
+                    context->sink_stopped = true;
+                    context->reject_status = 413;
+                } else if (!context->sink->write(upload_data, *upload_data_size)) {
+                    context->sink_stopped = true;
+                }
+            }
+        } else if (context->upload) {
+            UploadState& upload = *context->upload;
+            if (upload.error_status == 0 && !upload.parser->feed(upload_data, *upload_data_size)) {
+                upload.fail(400, "Malformed multipart body");
+            }
+        } else if (context->reject_status == 0) {
+            if (post_data->size() + *upload_data_size > server->max_body_bytes_) {
+                context->reject_status = 413;
+                std::string().swap(*post_data);
+            } else {
+                post_data->append(upload_data, *upload_data_size);
+            }
+        }
         *upload_data_size = 0; // Indicate we've processed all data
         return MHD_YES;
     }
     
+    if (context->responded) {
+        delete context;
+        *con_cls = nullptr;
+        return MHD_YES;
+    }
+    
     // Final call - process the complete request
     struct MHD_Response* mhd_response = nullptr;
     enum MHD_Result result = MHD_NO;
@@ -152,10 +792,9 @@ enum MHD_Result HttpServer::access_handler_callback(void* cls,
     try {
         // Convert MHD request to our HttpRequest format
         HttpRequest request;
-        std::cerr << "DEBUG: POST data length: " << post_data->length() << std::endl;
-        std::cerr << "DEBUG: POST data content: " << *post_data << std::endl;
-        server->convert_mhd_request(url, method, connection, post_data->c_str(), post_data->length(), request);
-        std::cerr << "DEBUG: Request body after conversion: " << request.body << std::endl;
+        server->convert_mhd_request(url, method, connection, nullptr, 0, request);
+        request.body = std::move(*post_data);
+        LOG_TRACE("POST data length: " + std::to_string(request.body.length()));
         
         // Log HTTP request in verbose mode
         LOG_HTTP_REQUEST(request.method, request.path, request.client_ip);
@@ -164,82 +803,81 @@ enum MHD_Result HttpServer::access_handler_callback(void* cls,
         HttpResponse response;
         bool route_found = false;
         
-        auto method_routes = server->routes_.find(request.method);
-        if (method_routes != server->routes_.end()) {
-            auto route_handler = method_routes->second.find(request.path);
-            if (route_handler != method_routes->second.end()) {
-                std::cerr << "DEBUG: Found route handler for " << method << " " << url << std::endl;
-                try {
-                    // Check if we can access the route handler function safely
-                    std::cerr << "DEBUG: About to call route handler" << std::endl;
-                    response = route_handler->second(request);
-                    route_found = true;
-                    std::cerr << "DEBUG: Route handler completed successfully" << std::endl;
-                } catch (const std::exception& e) {
-                    std::cerr << "DEBUG: Route handler threw std::exception: " << e.what() << std::endl;
-                    response.set_error(500, "Route handler exception");
-                    route_found = true;
-                } catch (...) {
-                    std::cerr << "DEBUG: Route handler threw unknown exception" << std::endl;
-                    response.set_error(500, "Route handler unknown exception");
-                    route_found = true;
-                }
+        if (context->reject_status != 0) {
+            if (context->sink) {
+                context->sink->abort();
+                context->sink.reset();
+            }
+            response.set_error(context->reject_status, "Request body too large");
+            route_found = true;
+        } else if (context->sink) {
+            // From here on the handler finishes or drops the sink
+            request.body_sink = std::move(context->sink);
+        } else if (context->upload) {
+            UploadState& upload = *context->upload;
+            if (upload.error_status == 0 && !upload.parser->finish()) {
+                upload.fail(400, "Incomplete multipart body");
             }
             
-            // If no exact match found, try wildcard matching
-            if (!route_found) {
-                for (const auto& route_pair : method_routes->second) {
-                    const std::string& route_pattern = route_pair.first;
-                    if (route_pattern.length() >= 2 && route_pattern.substr(route_pattern.length() - 2) == "/*") {
-                        std::string prefix = route_pattern.substr(0, route_pattern.length() - 2);
-                        if (request.path.length() >= prefix.length() && 
-                            request.path.substr(0, prefix.length()) == prefix) {
-                            std::cerr << "DEBUG: Found wildcard route handler for " << method << " " << url << " matching pattern " << route_pattern << std::endl;
-                            try {
-                                response = route_pair.second(request);
-                                route_found = true;
-                                std::cerr << "DEBUG: Wildcard route handler completed successfully" << std::endl;
-                                break;
-                            } catch (const std::exception& e) {
-                                std::cerr << "DEBUG: Wildcard route handler threw std::exception: " << e.what() << std::endl;
-                                response.set_error(500, "Wildcard route handler exception");
-                                route_found = true;
-                                break;
-                            } catch (...) {
-                                std::cerr << "DEBUG: Wildcard route handler threw unknown exception" << std::endl;
-                                response.set_error(500, "Wildcard route handler unknown exception");
-                                route_found = true;
-                                break;
-                            }
-                        }
-                    }
-                }
+            if (upload.error_status != 0) {
+                upload.discard_files();
+                response.set_error(upload.error_status, upload.error_message);
+                route_found = true;
+            } else {
+                // From here on the stored files belong to the handler
+                request.uploaded_files = std::move(upload.files);
+                request.form_fields = std::move(upload.fields);
+                upload.files.clear();
             }
         }
         
+        auto method_routes = route_found ? server->routes_.end() : server->routes_.find(request.method);
+        RouteTable::Match route;
+        if (method_routes != server->routes_.end() && method_routes->second.match(request.path, route)) {
+            LOG_TRACE("Found route handler for " + std::string(method) + " " + std::string(url));
+            for (size_t i = 0; i < route.param_count; ++i) {
+                request.path_params[*route.params[i].first] = std::string(route.params[i].second);
+            }
+            try {
+                response = (*route.handler)(request);
+                LOG_TRACE("Route handler completed successfully");
+            } catch (const std::exception& e) {
+                LOG_ERROR(std::string("Route handler threw std::exception: ") + e.what());
+                response.set_error(500, "Route handler exception");
+            } catch (...) {
+                LOG_ERROR("Route handler threw unknown exception");
+                response.set_error(500, "Route handler unknown exception");
+            }
+            route_found = true;
+        }
+        
         if (!route_found) {
-            std::cerr << "DEBUG: No route found for " << method << " " << url << std::endl;
+            LOG_TRACE("No route found for " + std::string(method) + " " + std::string(url));
             response.set_error(404, "Not Found");
         }
+        if (server->compressor_) {
+            server->compressor_->compress(request, response);
+        }
         
         // Log HTTP response in verbose mode
-        LOG_HTTP_RESPONSE(response.status_code, response.body.length());
+        LOG_HTTP_RESPONSE(response.status_code, response.content_length());
+        LOG_HTTP_ACCESS(request, response.status_code, response.content_length(), context->started);
         
         // Create and queue MHD response
-        std::cerr << "DEBUG: Creating MHD response" << std::endl;
+        LOG_TRACE("Creating MHD response");
         mhd_response = server->create_mhd_response(response);
         if (!mhd_response) {
-            std::cerr << "DEBUG: Failed to create MHD response" << std::endl;
-            delete post_data;
+            LOG_ERROR("Failed to create MHD response");
+            delete context;
             *con_cls = nullptr;
             return MHD_NO;
         }
         
-        std::cerr << "DEBUG: Queuing MHD response" << std::endl;
+        LOG_TRACE("Queuing MHD response");
         result = MHD_queue_response(connection, response.status_code, mhd_response);
-        std::cerr << "DEBUG: Destroying MHD response" << std::endl;
+        LOG_TRACE("Destroying MHD response");
         MHD_destroy_response(mhd_response);
-        std::cerr << "DEBUG: Response handling completed" << std::endl;
+        LOG_TRACE("Response handling completed");
         
     } catch (const std::exception& e) {
         std::cerr << "Error handling request: " << e.what() << std::endl;
@@ -258,12 +896,70 @@ enum MHD_Result HttpServer::access_handler_callback(void* cls,
     }
     
     // Clean up connection context
-    delete post_data;
+    delete context;
     *con_cls = nullptr;
     
     return result;
 }
 
+void HttpServer::request_completed_callback(void* cls,
+                                            struct MHD_Connection* connection,
+                                            void** con_cls,
+                                            enum MHD_RequestTerminationCode toe) {
+    (void)cls;
+    (void)connection;
+    (void)toe;
+    
+    // Still set only when the request ended before the final callback
+    ConnectionContext* context = static_cast<ConnectionContext*>(*con_cls);
+    if (!context) {
+        return;
+    }
+    if (context->upload) {
+        context->upload->discard_files();
+    }
+    if (context->sink) {
+        context->sink->abort();
+    }
+    delete context;
+    *con_cls = nullptr;
+}
+
+void HttpServer::upgrade_callback(void* cls,
+                                  struct MHD_Connection* connection,
+                                  void* con_cls,
+                                  const char* extra_in,
+                                  size_t extra_in_size,
+                                  MHD_socket sock,
+                                  struct MHD_UpgradeResponseHandle* urh) {
+    (void)connection;
+    
+    HttpServer* server = static_cast<HttpServer*>(cls);
+    ConnectionContext* context = static_cast<ConnectionContext*>(con_cls);
+    if (server && context && context->websocket) {
+        auto channel = std::make_shared<WebSocketChannel>(sock, [urh]() {
+            MHD_upgrade_action(urh, MHD_UPGRADE_ACTION_CLOSE);
+        });
+        {
+            std::lock_guard<std::mutex> lock(server->channels_mutex_);
+            auto& channels = server->channels_;
+            channels.erase(std::remove_if(channels.begin(), channels.end(),
+                                          [](const std::weak_ptr<WebSocketChannel>& weak) { return weak.expired(); }),
+                           channels.end());
+            channels.push_back(channel);
+        }
+        context->websocket->on_open(std::move(channel));
+        return;
+    }
+    if (!server || !context || !context->tunnel) {
+        MHD_upgrade_action(urh, MHD_UPGRADE_ACTION_CLOSE);
+        return;
+    }
+    // Relayed on threads of the proxy; MHD gets the socket back at the end
+    server->websocket_proxy_->relay(std::move(context->tunnel), sock, extra_in, extra_in_size,
+                                    [urh]() { MHD_upgrade_action(urh, MHD_UPGRADE_ACTION_CLOSE); });
+}
+
 void HttpServer::convert_mhd_request(const char* url, const char* method,
                                      struct MHD_Connection* connection,
                                      const char* upload_data, size_t upload_data_size,
@@ -272,32 +968,18 @@ void HttpServer::convert_mhd_request(const char* url, const char* method,
     request.method = std::string(method);
     request.path = std::string(url);
     
-    // Parse query string from URL
+    // MHD passes the path without its query string, which it has already
+    // split into arguments; a '?' only survives in unusual request lines
     std::string url_str(url);
     size_t query_pos = url_str.find('?');
     if (query_pos != std::string::npos) {
         request.query_string = url_str.substr(query_pos + 1);
         request.path = url_str.substr(0, query_pos);
-        
-        // Parse query parameters
-        MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, get_arg_iterator, &request.query_params);
     }
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, get_arg_iterator, &request.query_params);
     
     // Get headers
-    HeaderIteratorData header_data;
-    header_data.headers = &request.headers;
-    MHD_get_connection_values(connection, MHD_HEADER_KIND, header_iterator, &header_data);
-    
-    // Get content length from headers
-    size_t content_length = 0;
-    auto content_length_it = request.headers.find("Content-Length");
-    if (content_length_it != request.headers.end()) {
-        try {
-            content_length = std::stoull(content_length_it->second);
-        } catch (const std::exception&) {
-            content_length = 0;
-        }
-    }
+    MHD_get_connection_values(connection, MHD_HEADER_KIND, header_iterator, &request.headers);
     
     // Get body if present (use the accumulated POST data)
     if (upload_data && upload_data_size > 0) {
@@ -315,13 +997,70 @@ void HttpServer::convert_mhd_request(const char* url, const char* method,
     }
 }
 
+namespace {
+
+// Shared bodies are read out block by block, so each response only costs
+// MHD's send buffer instead of a copy of the whole content
+const size_t kSharedBodyBlockSize = 32 * 1024;
+
+ssize_t shared_body_reader(void* cls, uint64_t pos, char* buf, size_t max) {
+    const std::string& data = **static_cast<std::shared_ptr<const std::string>*>(cls);
+    if (pos >= data.size()) {
+        return MHD_CONTENT_READER_END_OF_STREAM;
+    }
+    size_t length = std::min(max, static_cast<size_t>(data.size() - pos));
+    std::memcpy(buf, data.data() + pos, length);
+    return static_cast<ssize_t>(length);
+}
+
+void shared_body_free(void* cls) {
+    delete static_cast<std::shared_ptr<const std::string>*>(cls);
+}
+
+ssize_t stream_reader(void* cls, uint64_t, char* buf, size_t max) {
+    size_t length = (**static_cast<std::shared_ptr<BodyWriter>*>(cls))(buf, max);
+    return length > 0 ? static_cast<ssize_t>(length) : MHD_CONTENT_READER_END_OF_STREAM;
+}
+
+void stream_free(void* cls) {
+    delete static_cast<std::shared_ptr<BodyWriter>*>(cls);
+}
+
+} // namespace
+
 struct MHD_Response* HttpServer::create_mhd_response(const HttpResponse& response) {
-    // Create response from body
-    struct MHD_Response* mhd_response = MHD_create_response_from_buffer(
-        response.body.length(),
-        const_cast<char*>(response.body.c_str()),
-        MHD_RESPMEM_MUST_COPY
-    );
+    struct MHD_Response* mhd_response = nullptr;
+    
+    if (response.file && response.file->fd >= 0) {
+        // MHD owns the descriptor from here on and sends it with sendfile()
+        int fd = response.file->fd;
+        response.file->fd = -1;
+        mhd_response = MHD_create_response_from_fd_at_offset64(response.file->size, fd, response.file->offset);
+        if (!mhd_response) {
+            close(fd);
+        }
+    } else if (response.shared_body) {
+        auto* holder = new std::shared_ptr<const std::string>(response.shared_body);
+        mhd_response = MHD_create_response_from_callback(response.shared_body->size(), kSharedBodyBlockSize,
+                                                         &shared_body_reader, holder, &shared_body_free);
+        if (!mhd_response) {
+            delete holder;
+        }
+    } else if (response.stream) {
+        auto* holder = new std::shared_ptr<BodyWriter>(response.stream);
+        mhd_response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, kSharedBodyBlockSize,
+                                                         &stream_reader, holder, &stream_free);
+        if (!mhd_response) {
+            delete holder;
+        }
+    } else {
+        // Create response from body
+        mhd_response = MHD_create_response_from_buffer(
+            response.body.length(),
+            const_cast<char*>(response.body.c_str()),
+            MHD_RESPMEM_MUST_COPY
+        );
+    }
     
     if (!mhd_response) {
         return nullptr;
@@ -333,36 +1072,146 @@ struct MHD_Response* HttpServer::create_mhd_response(const HttpResponse& respons
     return mhd_response;
 }
 
+void HttpServer::build_preflight_responses() {
+    free_preflight_responses();
+    if (!cors_enabled_) {
+        return;
+    }
+    
+    std::vector<std::string> origins = cors_origins_;
+    origins.push_back("*");
+    for (const auto& origin : origins) {
+        struct MHD_Response* mhd_response = create_mhd_response(make_preflight_response(origin));
+        if (mhd_response) {
+            preflight_responses_.emplace(origin, mhd_response);
+        }
+    }
+}
+
+void HttpServer::free_preflight_responses() {
+    for (auto& entry : preflight_responses_) {
+        MHD_destroy_response(entry.second);
+    }
+    preflight_responses_.clear();
+}
+
 void HttpServer::add_response_headers(struct MHD_Response* mhd_response, const HttpResponse& response) {
     for (const auto& header : response.headers) {
         MHD_add_response_header(mhd_response, header.first.c_str(), header.second.c_str());
     }
+    if (response.shared_headers) {
+        for (const auto& header : *response.shared_headers) {
+            if (!response.headers.count(header.first)) {
+                MHD_add_response_header(mhd_response, header.first.c_str(), header.second.c_str());
+            }
+        }
+    }
+    for (const auto& header : default_headers_) {
+        if (!response.headers.count(header.first) &&
+            !(response.shared_headers && response.shared_headers->count(header.first))) {
+            MHD_add_response_header(mhd_response, header.first.c_str(), header.second.c_str());
+        }
+    }
 }
 #endif
 
+// Series are created here, at registration, so a request only touches atomics.
+// Routes are labelled by pattern, which keeps the label set bounded.
+RouteHandler HttpServer::instrument(const char* method, const std::string& path, RouteHandler handler) {
+    UrMetrics::Registry& registry = UrMetrics::Registry::instance();
+    UrMetrics::Histogram* latency = &registry.histogram(
+        "frontendpp_http_request_duration_seconds", "Time spent in a route handler",
+        UrMetrics::latencyBuckets(), {{"method", method}, {"route", path}});
+    
+    std::array<UrMetrics::Counter*, 5> responses;
+    for (size_t i = 0; i < responses.size(); ++i) {
+        responses[i] = &registry.counter(
+            "frontendpp_http_responses_total", "Route responses by status class",
+            {{"method", method}, {"route", path}, {"code", std::to_string(i + 1) + "xx"}});
+    }
+    
+    return [latency, responses, handler = std::move(handler)](const HttpRequest& request) {
+        UR_TRACE_SPAN("http.route");
+        UrMetrics::ScopedTimer timer(*latency);
+        HttpResponse response = handler(request);
+        int status_class = response.status_code / 100;
+        if (status_class >= 1 && status_class <= 5) {
+            responses[status_class - 1]->inc();
+        }
+        return response;
+    };
+}
+
 void HttpServer::get(const std::string& path, RouteHandler handler) {
-    routes_["GET"][path] = handler;
+    routes_["GET"].add(path, instrument("GET", path, std::move(handler)));
 }
 
 void HttpServer::post(const std::string& path, RouteHandler handler) {
-    routes_["POST"][path] = handler;
+    routes_["POST"].add(path, instrument("POST", path, std::move(handler)));
 }
 
 void HttpServer::put(const std::string& path, RouteHandler handler) {
-    routes_["PUT"][path] = handler;
+    routes_["PUT"].add(path, instrument("PUT", path, std::move(handler)));
 }
 
 void HttpServer::del(const std::string& path, RouteHandler handler) {
-    routes_["DELETE"][path] = handler;
+    routes_["DELETE"].add(path, instrument("DELETE", path, std::move(handler)));
+}
+
+void HttpServer::post_upload(const std::string& path, UploadOptions options, RouteHandler handler) {
+    upload_routes_[path] = std::move(options);
+    routes_["POST"].add(path, instrument("POST", path, std::move(handler)));
+}
+
+void HttpServer::post_stream(const std::string& path, StreamOptions options, RouteHandler handler) {
+    stream_routes_[path] = std::move(options);
+    routes_["POST"].add(path, instrument("POST", path, std::move(handler)));
+}
+
+void HttpServer::websocket(const std::string& path, WebSocketOptions options) {
+    websocket_routes_[path] = std::move(options);
+}
+
+void HttpServer::set_rate_limit(unsigned requests_per_minute, unsigned burst) {
+    if (requests_per_minute == 0) {
+        rate_limit_enabled_.store(false, std::memory_order_release);
+        return;
+    }
+    // The limiter is created at most once, before it is enabled, so request
+    // threads never see it replaced
+    if (rate_limiter_) {
+        rate_limiter_->set_rate(requests_per_minute, burst);
+    } else {
+        rate_limiter_ = std::make_unique<RateLimiter>(requests_per_minute, burst);
+    }
+    rate_limit_enabled_.store(true, std::memory_order_release);
+}
+
+void HttpServer::set_compression(size_t min_bytes, std::vector<std::string> content_types) {
+    if (min_bytes == 0 || content_types.empty()) {
+        compressor_.reset();
+        return;
+    }
+    compressor_ = std::make_unique<ResponseCompressor>(min_bytes, std::move(content_types));
+}
+
+void HttpServer::proxy_websocket(const std::string& path, const std::string& backend) {
+    websocket_proxy_ = std::make_unique<WebSocketProxy>(backend);
+    websocket_proxy_path_ = path;
 }
 
 void HttpServer::options(const std::string& path, RouteHandler handler) {
-    routes_["OPTIONS"][path] = handler;
+    routes_["OPTIONS"].add(path, instrument("OPTIONS", path, std::move(handler)));
 }
 
 void HttpServer::serve_static_files(const std::string& url_prefix, const std::string& file_system_path) {
+    // One handler per prefix, so its file cache outlives the request
+    serve_static_files(url_prefix, std::make_shared<FileHandler>(file_system_path));
+}
+
+void HttpServer::serve_static_files(const std::string& url_prefix, std::shared_ptr<FileHandler> file_handler) {
     // Register a catch-all handler for the URL prefix
-    get(url_prefix + "/*", [this, file_system_path, url_prefix](const HttpRequest& request) {
+    get(url_prefix + "/*", [file_handler, url_prefix](const HttpRequest& request) {
         // Extract the requested path from the request
         std::string requested_path = request.path.substr(url_prefix.length());
         
@@ -373,20 +1222,57 @@ void HttpServer::serve_static_files(const std::string& url_prefix, const std::st
             return response;
         }
         
-        // Construct the full file system path
-        std::string full_path = file_system_path + requested_path;
+        return file_handler->serve_static_file(request, requested_path);
+    });
+}
+
+void HttpServer::serve_static_files(const std::string& url_prefix, std::shared_ptr<AssetCache> cache) {
+    get(url_prefix + "/*", [cache, url_prefix](const HttpRequest& request) {
+        std::string requested_path = request.path.substr(url_prefix.length());
         
-        // Create a FileHandler to serve the file
-        FileHandler file_handler(file_system_path);
-        return file_handler.serve_static_file(request, requested_path);
+        // Prevent directory traversal attacks
+        if (requested_path.find("..") != std::string::npos) {
+            HttpResponse response;
+            response.set_error(403, "Access denied");
+            return response;
+        }
+        
+        return cache->serve(request, requested_path);
     });
 }
 
 void HttpServer::enable_cors(const std::vector<std::string>& allowed_origins,
                            const std::vector<std::string>& allowed_methods,
                            const std::vector<std::string>& allowed_headers) {
-    // This would need to be implemented to add CORS headers to responses
-    // For now, the CORS handling is done in the individual route handlers
+    auto join = [](const std::vector<std::string>& items, const char* fallback) {
+        std::string joined;
+        for (const auto& item : items) {
+            joined += (joined.empty() ? "" : ", ") + item;
+        }
+        return joined.empty() ? std::string(fallback) : joined;
+    };
+    
+    auto headers = std::make_shared<HeaderMap>();
+    headers->set("Access-Control-Allow-Methods", join(allowed_methods, "GET, POST, PUT, DELETE, OPTIONS"));
+    headers->set("Access-Control-Allow-Headers", join(allowed_headers, "Content-Type, Authorization"));
+    headers->set("Access-Control-Max-Age", "86400");
+    headers->set("Vary", "Origin");
+    cors_headers_ = std::move(headers);
+    cors_origins_ = allowed_origins;
+    cors_enabled_ = true;
+}
+
+HttpResponse HttpServer::make_preflight_response(const std::string& origin) const {
+    HttpResponse response;
+    response.status_code = 204;
+    response.headers.set("Access-Control-Allow-Origin", origin);
+    response.shared_headers = cors_headers_;
+    return response;
+}
+
+std::string_view HttpRequest::get_header(std::string_view name) const {
+    auto it = headers.find(name);
+    return it != headers.end() ? it->second : std::string_view();
 }
 
 // HttpResponse methods
@@ -409,6 +1295,46 @@ void HttpResponse::set_file_content(const std::string& file_path, const std::str
     }
 }
 
+FileBody::~FileBody() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void HttpResponse::set_file_descriptor(int fd, uint64_t size, uint64_t offset) {
+    file = std::make_shared<FileBody>();
+    file->fd = fd;
+    file->size = size;
+    file->offset = offset;
+    body.clear();
+    shared_body.reset();
+    stream.reset();
+}
+
+void HttpResponse::set_shared_body(std::shared_ptr<const std::string> data) {
+    shared_body = std::move(data);
+    body.clear();
+    file.reset();
+    stream.reset();
+}
+
+void HttpResponse::set_stream(BodyWriter writer) {
+    stream = std::make_shared<BodyWriter>(std::move(writer));
+    body.clear();
+    file.reset();
+    shared_body.reset();
+}
+
+uint64_t HttpResponse::content_length() const {
+    if (file) {
+        return file->size;
+    }
+    if (shared_body) {
+        return shared_body->size();
+    }
+    return body.size();
+}
+
 void HttpResponse::set_error(int status_code, const std::string& message) {
     this->status_code = status_code;
     headers["Content-Type"] = "application/json";
@@ -419,4 +1345,6 @@ void HttpResponse::set_error(int status_code, const std::string& message) {
     error_json["status_code"] = status_code;
     
     body = error_json.dump();
+    file.reset();
+    shared_body.reset();
 }
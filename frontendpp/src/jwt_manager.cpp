@@ -1,8 +1,186 @@
 #include "jwt_manager.h"
+#include "revocation_list.h"
+#include "ur-clock/ur_clock.hpp"
 #include <sstream>
 #include <iomanip>
 #include <chrono>
 #include <random>
+#include <list>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif
+
+namespace {
+
+// Sessions live long enough that a few hundred covers every open browser
+const size_t kVerifiedTokenCacheSize = 256;
+
+// HS256 signatures are unique enough to key on; the full token is still
+// compared on a hit
+std::string token_signature(const std::string& token) {
+    size_t dot = token.rfind('.');
+    return dot == std::string::npos ? std::string() : token.substr(dot + 1);
+}
+
+template <typename Decoded>
+std::string string_claim(const Decoded& decoded, const char* name) {
+    return decoded.has_payload_claim(name) ? decoded.get_payload_claim(name).as_string() : std::string();
+}
+
+// Every claim generate_token() writes
+template <typename Decoded>
+void read_claims(const Decoded& decoded, VerifiedToken& token) {
+    token.user_info.username = decoded.has_subject() ? decoded.get_subject() : "";
+    token.user_info.email = string_claim(decoded, "email");
+    token.user_info.role = string_claim(decoded, "role");
+    token.user_info.full_name = string_claim(decoded, "full_name");
+    token.user_info.auth_method = string_claim(decoded, "auth_method");
+    token.user_info.created_at = string_claim(decoded, "created_at");
+    token.user_info.last_login = string_claim(decoded, "last_login");
+    token.type = string_claim(decoded, "type");
+    token.jti = decoded.has_id() ? decoded.get_id() : "";
+    if (decoded.has_issued_at()) {
+        token.issued_at = decoded.get_issued_at();
+    }
+    if (decoded.has_expires_at()) {
+        token.expires_at = decoded.get_expires_at();
+    }
+}
+
+// HS256 for jwt-cpp with the key absorbed once: the keyed HMAC context is
+// built here and duplicated per signature, where jwt-cpp's hs256 hashes the
+// key into a fresh context on every call. The keyed context is only read,
+// so copies share it and any thread may sign or verify.
+class KeyedHs256 {
+public:
+    explicit KeyedHs256(const std::string& secret) : secret_(secret) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        EVP_MAC* mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+        EVP_MAC_CTX* context = mac ? EVP_MAC_CTX_new(mac) : nullptr;
+        EVP_MAC_free(mac);
+        char digest[] = "SHA256";
+        OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+            OSSL_PARAM_construct_end()
+        };
+        if (context && !EVP_MAC_init(context, reinterpret_cast<const unsigned char*>(secret.data()),
+                                     secret.size(), params)) {
+            EVP_MAC_CTX_free(context);
+            context = nullptr;
+        }
+        keyed_.reset(context, &EVP_MAC_CTX_free);
+#endif
+    }
+    
+    std::string name() const { return "HS256"; }
+    
+    std::string sign(const std::string& data, std::error_code& ec) const {
+        ec.clear();
+        std::string signature(EVP_MAX_MD_SIZE, '\0');
+        size_t length = 0;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        EVP_MAC_CTX* context = keyed_ ? EVP_MAC_CTX_dup(keyed_.get()) : nullptr;
+        bool ok = context &&
+            EVP_MAC_update(context, reinterpret_cast<const unsigned char*>(data.data()), data.size()) &&
+            EVP_MAC_final(context, reinterpret_cast<unsigned char*>(&signature[0]), &length, signature.size());
+        EVP_MAC_CTX_free(context);
+#else
+        unsigned int hmac_length = 0;
+        bool ok = HMAC(EVP_sha256(), secret_.data(), static_cast<int>(secret_.size()),
+                       reinterpret_cast<const unsigned char*>(data.data()), data.size(),
+                       reinterpret_cast<unsigned char*>(&signature[0]), &hmac_length) != nullptr;
+        length = hmac_length;
+#endif
+        if (!ok) {
+            ec = jwt::error::signature_generation_error::hmac_failed;
+            return {};
+        }
+        signature.resize(length);
+        return signature;
+    }
+    
+    void verify(const std::string& data, const std::string& signature, std::error_code& ec) const {
+        std::string expected = sign(data, ec);
+        if (ec) {
+            return;
+        }
+        if (expected.size() != signature.size() ||
+            CRYPTO_memcmp(expected.data(), signature.data(), expected.size()) != 0) {
+            ec = jwt::error::signature_verification_error::invalid_signature;
+        }
+    }
+    
+private:
+    std::string secret_;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    std::shared_ptr<EVP_MAC_CTX> keyed_;
+#endif
+};
+
+using Verifier = decltype(jwt::verify());
+
+// Names a secret in the kid header without giving anything of it away
+std::string key_id(const std::string& secret) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    EVP_Digest(secret.data(), secret.size(), digest, &length, EVP_sha256(), nullptr);
+    static const char hex[] = "0123456789abcdef";
+    std::string id;
+    for (unsigned int i = 0; i < 8 && i < length; ++i) {
+        id += hex[digest[i] >> 4];
+        id += hex[digest[i] & 0x0f];
+    }
+    return id;
+}
+
+} // namespace
+
+struct JWTManager::KeySet {
+    std::string current_kid;
+    KeyedHs256 signer;
+    std::map<std::string, Verifier> verifiers;      // By kid
+    
+    explicit KeySet(const std::string& secret) : current_kid(key_id(secret)), signer(secret) {}
+};
+
+std::string VerifiedToken::expiry_time() const {
+    if (expires_at == std::chrono::system_clock::time_point()) {
+        return "";
+    }
+    return std::string(UrClock::formatSeconds(std::chrono::system_clock::to_time_t(expires_at), UrClock::Zone::Utc)) +
+           " UTC";
+}
+
+bool VerifiedToken::is_expired() const {
+    return expires_at < std::chrono::system_clock::now();
+}
+
+struct JWTManager::TokenCache {
+    struct Entry {
+        std::string signature;
+        std::string raw;
+        VerifiedToken token;
+    };
+    
+    std::mutex mutex;
+    std::list<Entry> lru;       // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> by_signature;
+    // Has its own lock and is checked without one for tokens never revoked
+    RevocationList revocations;
+    
+    void erase(std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it) {
+        lru.erase(it->second);
+        by_signature.erase(it);
+    }
+};
 
 JWTManager::JWTManager(const std::string& secret, 
                        const std::string& issuer, 
@@ -10,12 +188,27 @@ JWTManager::JWTManager(const std::string& secret,
                        int token_expiry_minutes,
                        int refresh_token_expiry_minutes,
                        bool enable_sliding_expiration,
-                       int token_refresh_threshold_minutes)
+                       int token_refresh_threshold_minutes,
+                       const std::vector<std::string>& previous_secrets)
     : secret_(secret), issuer_(issuer), audience_(audience),
       token_expiry_minutes_(token_expiry_minutes),
       refresh_token_expiry_minutes_(refresh_token_expiry_minutes),
       enable_sliding_expiration_(enable_sliding_expiration),
-      token_refresh_threshold_minutes_(token_refresh_threshold_minutes) {
+      token_refresh_threshold_minutes_(token_refresh_threshold_minutes),
+      token_cache_(std::make_shared<TokenCache>()) {
+    auto keys = std::make_shared<KeySet>(secret);
+    std::vector<std::string> secrets = previous_secrets;
+    secrets.insert(secrets.begin(), secret);
+    for (const auto& accepted : secrets) {
+        if (accepted.empty() || keys->verifiers.count(key_id(accepted))) {
+            continue;
+        }
+        keys->verifiers.emplace(key_id(accepted), jwt::verify()
+            .allow_algorithm(KeyedHs256(accepted))
+            .with_issuer(issuer_)
+            .with_audience(audience_));
+    }
+    keys_ = std::move(keys);
 }
 
 std::string JWTManager::generate_jti() const {
@@ -40,6 +233,7 @@ std::string JWTManager::generate_token(const UserInfo& user_info,
                                        const std::string& token_type) const {
     auto now = std::chrono::system_clock::now();
     auto token = jwt::create()
+        .set_key_id(keys_->current_kid)
         .set_issuer(issuer_)
         .set_audience(audience_)
         .set_issued_at(now)
@@ -55,7 +249,7 @@ std::string JWTManager::generate_token(const UserInfo& user_info,
         .set_payload_claim("created_at", jwt::claim(user_info.created_at))
         .set_payload_claim("last_login", jwt::claim(user_info.last_login));
     
-    return token.sign(jwt::algorithm::hs256{secret_});
+    return token.sign(keys_->signer);
 }
 
 std::string JWTManager::generate_access_token(const UserInfo& user_info) const {
@@ -68,82 +262,153 @@ std::string JWTManager::generate_refresh_token(const UserInfo& user_info) const
     return generate_token(user_info, expiry, "refresh");
 }
 
+bool JWTManager::find_cached(const std::string& token, VerifiedToken& result) const {
+    TokenCache& cache = *token_cache_;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.by_signature.find(token_signature(token));
+    if (it == cache.by_signature.end() || it->second->raw != token) {
+        return false;
+    }
+    if (it->second->token.is_expired()) {
+        cache.erase(it);
+        return false;
+    }
+    cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+    result = it->second->token;
+    return true;
+}
+
 bool JWTManager::should_refresh_token(const std::string& token) const {
     if (!enable_sliding_expiration_) {
         return false;
     }
     
-    try {
-        auto decoded = jwt::decode(token);
-        auto exp = decoded.get_expires_at();
-        auto now = std::chrono::system_clock::now();
-        auto threshold = std::chrono::minutes(token_refresh_threshold_minutes_);
-        
-        return (exp - now) <= threshold;
-    } catch (...) {
-        return false;
+    VerifiedToken decoded;
+    if (!find_cached(token, decoded)) {
+        decoded = decode_token(token);
+        if (decoded.expires_at == std::chrono::system_clock::time_point()) {
+            return false;
+        }
     }
+    auto now = std::chrono::system_clock::now();
+    auto threshold = std::chrono::minutes(token_refresh_threshold_minutes_);
+    return (decoded.expires_at - now) <= threshold;
 }
 
 bool JWTManager::validate_token(const std::string& token) const {
+    return verify_token(token).valid;
+}
+
+VerifiedToken JWTManager::verify_token(const std::string& token) const {
+    VerifiedToken result;
+    std::string signature = token_signature(token);
+    if (signature.empty()) {
+        return result;
+    }
+    if (find_cached(token, result)) {
+        return result;
+    }
+    
     try {
         auto decoded = jwt::decode(token);
-        
-        auto verifier = jwt::verify()
-            .allow_algorithm(jwt::algorithm::hs256{secret_})
-            .with_issuer(issuer_)
-            .with_audience(audience_);
-        
-        verifier.verify(decoded);
-        
-        // Check if token is expired
-        auto expires_at = decoded.get_expires_at();
-        if (expires_at.time_since_epoch().count() < std::chrono::system_clock::now().time_since_epoch().count()) {
-            return false;
+        auto verifier = keys_->verifiers.find(decoded.has_key_id() ? decoded.get_key_id() : keys_->current_kid);
+        if (verifier == keys_->verifiers.end()) {
+            return VerifiedToken{};
         }
-        
-        return true;
+        verifier->second.verify(decoded);
+        read_claims(decoded, result);
     } catch (const std::exception& e) {
-        return false;
+        return VerifiedToken{};
+    }
+    
+    // Check if token is expired
+    if (result.is_expired()) {
+        return VerifiedToken{};
+    }
+    
+    TokenCache& cache = *token_cache_;
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    // Checked under the cache lock: a revocation racing this call either
+    // shows here or evicts the entry added below once it takes the lock
+    if (cache.revocations.is_revoked(result.jti, result.user_info.username, result.issued_at)) {
+        return VerifiedToken{};
+    }
+    result.valid = true;
+    
+    auto existing = cache.by_signature.find(signature);
+    if (existing != cache.by_signature.end()) {
+        cache.erase(existing);
+    }
+    cache.lru.push_front(TokenCache::Entry{signature, token, result});
+    cache.by_signature[signature] = cache.lru.begin();
+    if (cache.lru.size() > kVerifiedTokenCacheSize) {
+        cache.by_signature.erase(cache.lru.back().signature);
+        cache.lru.pop_back();
     }
+    return result;
 }
 
-UserInfo JWTManager::extract_user_info(const std::string& token) const {
-    UserInfo user_info;
-    
+VerifiedToken JWTManager::decode_token(const std::string& token) const {
+    VerifiedToken result;
     try {
-        auto decoded = jwt::decode(token);
-        
-        user_info.username = decoded.get_subject();
-        user_info.email = decoded.get_payload_claim("email").as_string();
-        user_info.role = decoded.get_payload_claim("role").as_string();
-        user_info.full_name = decoded.get_payload_claim("full_name").as_string();
-        user_info.auth_method = decoded.get_payload_claim("auth_method").as_string();
-        user_info.created_at = decoded.get_payload_claim("created_at").as_string();
-        user_info.last_login = decoded.get_payload_claim("last_login").as_string();
-        
+        read_claims(jwt::decode(token), result);
     } catch (const std::exception& e) {
-        // Return empty user info on error
-        user_info = UserInfo{};
+        // Return empty claims on error
+        result = VerifiedToken{};
+    }
+    return result;
+}
+
+void JWTManager::revoke_token(const std::string& token) {
+    VerifiedToken decoded = decode_token(token);
+    TokenCache& cache = *token_cache_;
+    // Stored before the cache lock is taken, so the write does not hold up
+    // verification
+    cache.revocations.revoke_token(decoded.jti, decoded.expires_at);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    
+    auto it = cache.by_signature.find(token_signature(token));
+    if (it != cache.by_signature.end()) {
+        cache.erase(it);
     }
+}
+
+void JWTManager::revoke_user_tokens(const std::string& username) {
+    // iat has one-second resolution, so tokens issued later in this same
+    // second, such as a login right after a password change, stay valid
+    auto now = std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now());
+    // Until the last token issued before now has expired
+    auto until = now + std::chrono::minutes(std::max(token_expiry_minutes_, refresh_token_expiry_minutes_));
+    TokenCache& cache = *token_cache_;
+    cache.revocations.revoke_user(username, now, until);
+    std::lock_guard<std::mutex> lock(cache.mutex);
     
-    return user_info;
+    for (auto it = cache.by_signature.begin(); it != cache.by_signature.end(); ) {
+        if (it->second->token.user_info.username == username) {
+            cache.lru.erase(it->second);
+            it = cache.by_signature.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool JWTManager::persist_revocations(const std::string& db_path) {
+    return token_cache_->revocations.attach(db_path);
+}
+
+UserInfo JWTManager::extract_user_info(const std::string& token) const {
+    return decode_token(token).user_info;
 }
 
 std::string JWTManager::refresh_access_token(const std::string& refresh_token) const {
     try {
-        if (!validate_token(refresh_token)) {
+        VerifiedToken verified = verify_token(refresh_token);
+        if (!verified.valid || verified.type != "refresh") {
             return "";
         }
         
-        auto decoded = jwt::decode(refresh_token);
-        auto type_claim = decoded.get_payload_claim("type");
-        
-        if (type_claim.as_string() != "refresh") {
-            return "";
-        }
-        
-        UserInfo user_info = extract_user_info(refresh_token);
+        UserInfo user_info = verified.user_info;
         if (user_info.username.empty()) {
             return "";
         }
@@ -159,65 +424,24 @@ std::string JWTManager::refresh_access_token(const std::string& refresh_token) c
 }
 
 std::string JWTManager::get_token_expiry_time(const std::string& token) const {
-    try {
-        auto decoded = jwt::decode(token);
-        auto expires_at = decoded.get_expires_at();
-        
-        auto time_t = std::chrono::system_clock::to_time_t(expires_at);
-        std::stringstream ss;
-        ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%d %H:%M:%S UTC");
-        return ss.str();
-        
-    } catch (const std::exception& e) {
-        // Return empty string on error
-    }
-    
-    return "";
+    return decode_token(token).expiry_time();
 }
 
 std::string JWTManager::get_token_type(const std::string& token) const {
-    try {
-        auto decoded = jwt::decode(token);
-        return decoded.get_payload_claim("type").as_string();
-    } catch (const std::exception& e) {
-        return "";
-    }
+    return decode_token(token).type;
 }
 
 bool JWTManager::is_token_expired(const std::string& token) const {
-    try {
-        auto decoded = jwt::decode(token);
-        auto expires_at = decoded.get_expires_at();
-        
-        return expires_at.time_since_epoch().count() < std::chrono::system_clock::now().time_since_epoch().count();
-        
-    } catch (const std::exception& e) {
-        return true; // Consider invalid tokens as expired
-    }
+    // Invalid tokens decode without an expiry and count as expired
+    return decode_token(token).is_expired();
 }
 
 std::string JWTManager::get_token_subject(const std::string& token) const {
-    try {
-        auto decoded = jwt::decode(token);
-        return decoded.get_subject();
-    } catch (const std::exception& e) {
-        return "";
-    }
+    return decode_token(token).user_info.username;
 }
 
 std::string JWTManager::get_token_jti(const std::string& token) const {
-    try {
-        auto decoded = jwt::decode(token);
-        return decoded.get_id();
-    } catch (const std::exception& e) {
-        // Fallback to payload claim if get_id() doesn't work
-        try {
-            auto decoded = jwt::decode(token);
-            return decoded.get_payload_claim("jti").as_string();
-        } catch (...) {
-            return "";
-        }
-    }
+    return decode_token(token).jti;
 }
 
 std::string JWTManager::get_secret() const {
@@ -226,9 +450,5 @@ std::string JWTManager::get_secret() const {
 
 // Utility function to get current timestamp
 std::string get_current_timestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%SZ");
-    return ss.str();
+    return UrClock::iso8601();
 }
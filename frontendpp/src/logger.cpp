@@ -1,6 +1,243 @@
 #include "logger.h"
+#include "ur-clock/ur_clock.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <strings.h>
+#include <utility>
 
 namespace FrontendPP {
     Logger* Logger::instance_ = nullptr;
     std::mutex Logger::mutex_;
+
+    bool Logger::parse_level(const std::string& name, LogLevel& level) {
+        static const std::pair<const char*, LogLevel> levels[] = {
+            {"debug", LogLevel::DEBUG},
+            {"info", LogLevel::INFO},
+            {"warning", LogLevel::WARNING},
+            {"warn", LogLevel::WARNING},
+            {"error", LogLevel::ERROR},
+            {"critical", LogLevel::CRITICAL}
+        };
+        for (const auto& entry : levels) {
+            if (strcasecmp(name.c_str(), entry.first) == 0) {
+                level = entry.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char* Logger::get_timestamp() {
+        return UrClock::formatSeconds(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    }
+
+    void Logger::log(LogLevel level, const std::string& message) {
+        if (level < min_level_.load(std::memory_order_relaxed)) return;
+
+        Entry entry;
+        const char* timestamp = get_timestamp();
+        std::string level_str = level_to_string(level);
+        entry.line.reserve(message.size() + level_str.size() + 32);
+        entry.line.append("[").append(timestamp).append("] [").append(level_str).append("] ").append(message);
+        // Always log to console if verbose mode is enabled or level is high enough
+        entry.to_console = verbose_mode_.load(std::memory_order_relaxed) || level >= LogLevel::WARNING;
+
+        if (async_enabled_.load(std::memory_order_acquire)) {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            // Re-checked under the lock: disable_async() may have drained already
+            if (writer_running_ && !stopping_) {
+                if (queue_.size() >= queue_capacity_) {
+                    dropped_count_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                queue_.push_back(std::move(entry));
+                ++queued_sequence_;
+                if (level >= LogLevel::ERROR || queue_.size() >= queue_capacity_ / 2) {
+                    wake_pending_ = true;
+                    lock.unlock();
+                    queue_cv_.notify_one();
+                }
+                if (level == LogLevel::CRITICAL) {
+                    flush();
+                }
+                return;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(log_mutex_);
+        if (entry.to_console) {
+            std::cout << entry.line << std::endl;
+        }
+        if (file_logging_ && log_file_.is_open()) {
+            log_file_ << entry.line << '\n';
+            log_file_.flush();
+        }
+    }
+
+    void Logger::log_access(const std::string& method, const std::string& path, const std::string& client_ip,
+                            int status_code, size_t request_bytes, size_t response_bytes,
+                            double duration_ms, const std::string& body) {
+        if (!is_enabled(LogLevel::INFO)) return;
+
+        char timing[32];
+        std::snprintf(timing, sizeof(timing), "%.2f", duration_ms);
+        std::string line;
+        line.reserve(128 + path.size());
+        line.append("access method=").append(method)
+            .append(" path=").append(path)
+            .append(" status=").append(std::to_string(status_code))
+            .append(" ip=").append(client_ip)
+            .append(" req_bytes=").append(std::to_string(request_bytes))
+            .append(" resp_bytes=").append(std::to_string(response_bytes))
+            .append(" ms=").append(timing);
+
+        // Passwords, keys and tokens travel in these bodies
+        static const char* const kRedactedPrefixes[] = {
+            "/api/auth/login", "/api/auth/refresh", "/api/auth/change-password", "/api/auth/verify"
+        };
+        unsigned int rate = body_sample_rate_.load(std::memory_order_relaxed);
+        uint64_t count = access_count_.fetch_add(1, std::memory_order_relaxed);
+        bool capture = rate > 0 && !body.empty() && count % rate == 0;
+        for (const char* prefix : kRedactedPrefixes) {
+            if (capture && path.compare(0, std::strlen(prefix), prefix) == 0) {
+                capture = false;
+            }
+        }
+
+        if (capture) {
+            size_t limit = std::min(body.size(), body_sample_bytes_.load(std::memory_order_relaxed));
+            line.append(" body=\"");
+            for (size_t i = 0; i < limit; ++i) {
+                unsigned char c = static_cast<unsigned char>(body[i]);
+                if (c == '"' || c == '\\') {
+                    line.push_back('\\');
+                    line.push_back(static_cast<char>(c));
+                } else if (c >= 0x20 && c < 0x7f) {
+                    line.push_back(static_cast<char>(c));
+                } else {
+                    char escaped[5];
+                    std::snprintf(escaped, sizeof(escaped), "\\x%02x", c);
+                    line.append(escaped);
+                }
+            }
+            line.append(limit < body.size() ? "\"..." : "\"");
+        }
+
+        log(LogLevel::INFO, line);
+    }
+
+    bool Logger::enable_async(size_t capacity, std::chrono::milliseconds flush_interval) {
+        std::lock_guard<std::mutex> control(control_mutex_);
+        if (writer_thread_.joinable()) {
+            return true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            queue_capacity_ = capacity > 0 ? capacity : 1;
+            flush_interval_ = flush_interval.count() > 0 ? flush_interval : std::chrono::milliseconds(1);
+            queue_.reserve(queue_capacity_);
+            stopping_ = false;
+            wake_pending_ = false;
+            writer_running_ = true;
+        }
+
+        try {
+            writer_thread_ = std::thread(&Logger::writer_loop, this);
+        } catch (const std::system_error& e) {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            writer_running_ = false;
+            std::cerr << "Failed to start log writer thread: " << e.what() << std::endl;
+            return false;
+        }
+        async_enabled_.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void Logger::disable_async() {
+        std::lock_guard<std::mutex> control(control_mutex_);
+        if (!writer_thread_.joinable()) {
+            return;
+        }
+
+        async_enabled_.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            stopping_ = true;
+            wake_pending_ = true;
+        }
+        queue_cv_.notify_one();
+        writer_thread_.join();
+    }
+
+    void Logger::flush() {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if (!writer_running_ || std::this_thread::get_id() == writer_id_) {
+            return;
+        }
+
+        uint64_t target = queued_sequence_;
+        wake_pending_ = true;
+        queue_cv_.notify_one();
+        drained_cv_.wait(lock, [this, target]() {
+            return written_sequence_ >= target || stopping_;
+        });
+    }
+
+    void Logger::write_entry(const Entry& entry) {
+        if (entry.to_console) {
+            std::cout << entry.line << '\n';
+        }
+        if (file_logging_ && log_file_.is_open()) {
+            log_file_ << entry.line << '\n';
+        }
+    }
+
+    void Logger::writer_loop() {
+        std::vector<Entry> batch;
+        batch.reserve(queue_capacity_);
+
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        writer_id_ = std::this_thread::get_id();
+        for (;;) {
+            queue_cv_.wait_for(lock, flush_interval_, [this]() { return wake_pending_; });
+            wake_pending_ = false;
+
+            bool stopping = stopping_;
+            batch.swap(queue_);
+            uint64_t sequence = queued_sequence_;
+            uint64_t dropped = dropped_count_.load(std::memory_order_relaxed);
+            lock.unlock();
+
+            if (!batch.empty() || dropped != dropped_reported_) {
+                std::lock_guard<std::mutex> output(log_mutex_);
+                for (const auto& entry : batch) {
+                    write_entry(entry);
+                }
+                if (dropped != dropped_reported_) {
+                    Entry notice;
+                    notice.line = std::string("[") + get_timestamp() + "] [" + level_to_string(LogLevel::WARNING) +
+                                  "] Log queue full, dropped " + std::to_string(dropped - dropped_reported_) + " entries";
+                    notice.to_console = true;
+                    write_entry(notice);
+                    dropped_reported_ = dropped;
+                }
+                std::cout.flush();
+                if (file_logging_ && log_file_.is_open()) {
+                    log_file_.flush();
+                }
+            }
+            batch.clear();
+
+            lock.lock();
+            written_sequence_ = sequence;
+            drained_cv_.notify_all();
+            if (stopping) {
+                writer_running_ = false;
+                return;
+            }
+        }
+    }
 }
@@ -0,0 +1,143 @@
+#include "login_recorder.h"
+#include "logger.h"
+#include "ur-clock/ur_clock.hpp"
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+constexpr std::chrono::milliseconds LoginRecorder::kBatchDelay;
+constexpr std::chrono::hours LoginRecorder::kAuditRetention;
+
+namespace {
+
+// login_audit.created_at, which sorts as text
+std::string audit_cutoff(std::chrono::hours age) {
+    return UrClock::iso8601(std::chrono::system_clock::now() - age);
+}
+
+} // namespace
+
+LoginRecorder::LoginRecorder(const std::string& db_path, size_t max_queued)
+    : db_pool_(std::make_unique<SqlitePool>(db_path, 1)), max_queued_(max_queued) {
+    thread_ = std::thread(&LoginRecorder::run, this);
+}
+
+LoginRecorder::~LoginRecorder() {
+    stop();
+}
+
+void LoginRecorder::record(Login login) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || queue_.size() >= max_queued_) {
+            ++dropped_;
+            return;
+        }
+        queue_.push_back(std::move(login));
+        ++queued_total_;
+    }
+    wake_.notify_one();
+}
+
+void LoginRecorder::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = queued_total_;
+    flushing_ = true;
+    wake_.notify_one();
+    written_.wait(lock, [this, target] { return written_total_ >= target; });
+}
+
+void LoginRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void LoginRecorder::run() {
+    auto next_prune = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            break;
+        }
+        // Let a burst gather into one transaction, unless shutting down
+        // or someone is waiting in flush()
+        wake_.wait_for(lock, kBatchDelay, [this] { return stopping_ || flushing_; });
+
+        std::vector<Login> batch;
+        batch.swap(queue_);
+        flushing_ = false;
+        uint64_t dropped = dropped_;
+        dropped_ = 0;
+        lock.unlock();
+
+        if (dropped) {
+            LOG_WARNING("Login recorder: queue full, " + std::to_string(dropped) + " logins not recorded");
+        }
+        write_batch(batch);
+        if (std::chrono::steady_clock::now() >= next_prune) {
+            prune_audit();
+            next_prune = std::chrono::steady_clock::now() + std::chrono::hours(1);
+        }
+
+        lock.lock();
+        written_total_ += batch.size();
+        written_.notify_all();
+    }
+}
+
+void LoginRecorder::write_batch(const std::vector<Login>& batch) {
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* begin = lease.prepare("BEGIN IMMEDIATE");
+    sqlite3_stmt* update = lease.prepare("UPDATE users SET last_login = ? WHERE username = ?");
+    sqlite3_stmt* audit = lease.prepare(
+        "INSERT INTO login_audit (username, method, client_ip, key_id, created_at) VALUES (?, ?, ?, ?, ?)");
+    sqlite3_stmt* commit = lease.prepare("COMMIT");
+    if (!begin || !update || !audit || !commit || sqlite3_step(begin) != SQLITE_DONE) {
+        LOG_ERROR("Login recorder: " + std::to_string(batch.size()) + " logins not written");
+        return;
+    }
+
+    for (const auto& login : batch) {
+        sqlite3_reset(update);
+        sqlite3_bind_text(update, 1, login.at.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(update, 2, login.username.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(update);
+
+        sqlite3_reset(audit);
+        sqlite3_bind_text(audit, 1, login.username.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(audit, 2, login.method.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(audit, 3, login.client_ip.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(audit, 4, login.key_id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(audit, 5, login.at.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(audit) != SQLITE_DONE) {
+            LOG_ERROR("Login recorder: audit row for " + login.username + " not written: " +
+                      std::string(sqlite3_errmsg(lease.db())));
+        }
+    }
+
+    if (sqlite3_step(commit) != SQLITE_DONE) {
+        LOG_ERROR("Login recorder: commit failed: " + std::string(sqlite3_errmsg(lease.db())));
+        sqlite3_exec(lease.db(), "ROLLBACK", nullptr, nullptr, nullptr);
+    }
+}
+
+void LoginRecorder::prune_audit() {
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = lease.prepare("DELETE FROM login_audit WHERE created_at < ?");
+    if (!stmt) {
+        return;
+    }
+    std::string cutoff = audit_cutoff(kAuditRetention);
+    sqlite3_bind_text(stmt, 1, cutoff.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_step(stmt);
+}
@@ -3,29 +3,97 @@
 #include "auth_handler.h"
 #include "jwt_manager.h"
 #include "file_handler.h"
+#include "asset_cache.h"
+#include "backup_archive.h"
+#include "firmware_updater.h"
+#include "tls_credentials.h"
 #include "logger.h"
 #include "frontendpp/cmake/attributes.hpp"
+#include "ur-metrics/ur_metrics.hpp"
+#include "ur-trace/ur_trace.hpp"
 #include <iostream>
 #include <memory>
+#include <atomic>
 #include <csignal>
 #include <unistd.h>
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <ctime>
 
 std::unique_ptr<HttpServer> server;
-std::unique_ptr<ConfigManager> config_manager;
+std::unique_ptr<ConfigStore> config_store;
+std::shared_ptr<const ConfigManager> config_manager;     // Snapshot in effect
+std::atomic<bool> reload_requested(false);
+std::atomic<bool> drain_requested(false);
 std::unique_ptr<AuthHandler> auth_handler;
 std::unique_ptr<FileHandler> file_handler;
 std::unique_ptr<JWTManager> jwt_manager;
+std::shared_ptr<AssetCache> asset_cache;
+std::shared_ptr<FirmwareUpdater> firmware_updater;
+std::shared_ptr<TlsCredentials> tls_credentials;        // Null when serving plain HTTP
 
 void signal_handler(int signal) {
     std::cout << "\nReceived signal " << signal << ", shutting down server..." << std::endl;
     if (server) {
         server->stop();
     }
+    if (asset_cache) {
+        asset_cache->stop_watching();
+    }
+    FrontendPP::Logger::get_instance().disable_async();
     exit(0);
 }
 
+// SIGTERM with server.drain_seconds set: the main loop drains the server
+// while the next process (or systemd's socket) takes new connections
+void drain_signal_handler(int) {
+    drain_requested.store(true);
+}
+
+// SIGHUP: the main loop reloads the configuration file
+void reload_signal_handler(int) {
+    reload_requested.store(true);
+}
+
+// Logging and rate limits apply to the running server; everything else
+// is read once at startup
+void apply_logging_config(const LoggingConfig& logging_config) {
+    auto& logger = FrontendPP::Logger::get_instance();
+    FrontendPP::LogLevel level;
+    if (FrontendPP::Logger::parse_level(logging_config.level, level)) {
+        logger.set_min_level(level);
+    } else {
+        LOG_WARNING("Unknown logging.level '" + logging_config.level + "', keeping the current level");
+    }
+    if (logging_config.access_log && !logger.file_logging_enabled()) {
+        logger.enable_file_logging(logging_config.file);
+    }
+    logger.set_access_log(logging_config.access_log, logging_config.access_log_body_sample_rate,
+                          logging_config.access_log_body_sample_bytes);
+}
+
+void reload_config() {
+    auto next = config_store->reload();
+    if (!next) {
+        LOG_ERROR("Reloading " + config_store->path() + " failed, keeping the running configuration");
+        return;
+    }
+    
+    apply_logging_config(next->get_logging_config());
+    const auto& security_config = next->get_security_config();
+    server->set_rate_limit(static_cast<unsigned>(std::max(0, security_config.rate_limit_requests_per_minute)),
+                           static_cast<unsigned>(std::max(0, security_config.rate_limit_burst)));
+    UrTrace::setEnabled(next->get_trace_config().enabled);
+    // A failed load keeps serving the previous certificate
+    if (tls_credentials) {
+        const auto& tls_config = next->get_tls_config();
+        tls_credentials->load(tls_config.cert_file, tls_config.key_file);
+    }
+    config_manager = std::move(next);
+    LOG_INFO("Reloaded " + config_store->path() + "; logging, rate limits, tracing and the TLS certificate applied, other settings need a restart");
+}
+
 void validate_file_serving(const PathsConfig& paths_config) {
     std::cout << "🔍 Validating file serving configuration..." << std::endl;
     
@@ -83,9 +151,8 @@ void validate_file_serving(const PathsConfig& paths_config) {
 }
 
 void setup_routes() {
-    auto server_config = config_manager->get_server_config();
-    auto paths_config = config_manager->get_paths_config();
-    auto security_config = config_manager->get_security_config();
+    const auto& paths_config = config_manager->get_paths_config();
+    const auto& security_config = config_manager->get_security_config();
     
     // Root route handler with authentication-based redirection
     server->get("/", [auth_handler = auth_handler.get()](const HttpRequest& request) {
@@ -108,7 +175,6 @@ void setup_routes() {
     
     // Authentication routes
     server->post("/api/auth/login", [auth_handler = auth_handler.get()](const HttpRequest& request) {
-        std::cerr << "DEBUG: auth_handler pointer: " << (void*)auth_handler << std::endl;
         if (!auth_handler) {
             HttpResponse error_response;
             error_response.set_error(500, "Auth handler is NULL");
@@ -157,50 +223,202 @@ void setup_routes() {
         return auth_handler->handle_revoke_auth_key(request);
     });
     
-    server->post("/api/auth/upload-files", [auth_handler = auth_handler.get()](const HttpRequest& request) {
+    // Uploads stream to disk; only authenticated clients get to send one
+    UploadOptions upload_options;
+    upload_options.upload_dir = paths_config.uploads;
+    upload_options.max_file_bytes = static_cast<size_t>(security_config.max_file_size_mb) * 1024 * 1024;
+    upload_options.max_total_bytes = upload_options.max_file_bytes;
+    upload_options.authorize = [auth_handler = auth_handler.get()](const HttpRequest& request) {
+        UserInfo user_info;
+        return auth_handler->authenticate_request(request, user_info);
+    };
+    server->post_upload("/api/auth/upload-files", upload_options, [auth_handler = auth_handler.get()](const HttpRequest& request) {
         return auth_handler->handle_upload_files(request);
     });
+    server->set_max_body_size(static_cast<size_t>(security_config.max_request_body_kb) * 1024);
+    server->set_rate_limit(static_cast<unsigned>(std::max(0, security_config.rate_limit_requests_per_minute)),
+                           static_cast<unsigned>(std::max(0, security_config.rate_limit_burst)));
     
     server->get("/api/auth/transfer-history", [auth_handler = auth_handler.get()](const HttpRequest& request) {
         return auth_handler->handle_get_transfer_history(request);
     });
     
-    // Static file serving
-    server->serve_static_files("/", paths_config.frontend_root);
+    // Backup download: config files and database snapshots as a tar.gz,
+    // compressed while it is sent
+    const auto& backup_config = config_manager->get_backup_config();
+    if (backup_config.enabled) {
+        BackupArchive::Options backup_options;
+        backup_options.files = backup_config.config_files;
+        if (backup_options.files.empty()) {
+            backup_options.files.push_back(config_store->path());
+        }
+        backup_options.databases = backup_config.databases;
+        if (backup_options.databases.empty()) {
+            backup_options.databases.push_back(config_manager->get_database_config().path);
+        }
+        backup_options.step_pages = backup_config.step_pages;
+        backup_options.max_snapshot_bytes = static_cast<size_t>(backup_config.max_snapshot_mb) * 1024 * 1024;
+
+        server->get("/api/backup/export", [auth_handler = auth_handler.get(), backup_options](const HttpRequest& request) {
+            HttpResponse response;
+            UserInfo user_info;
+            if (!auth_handler->authenticate_request(request, user_info)) {
+                response.set_error(401, "Authentication required");
+                return response;
+            }
+
+            auto archive = std::make_shared<BackupArchive>();
+            std::string error;
+            int status = 500;
+            if (!archive->prepare(backup_options, error, status)) {
+                LOG_ERROR("Backup export failed: " + error);
+                response.set_error(status, error);
+                return response;
+            }
+
+            char stamp[32];
+            std::time_t now = std::time(nullptr);
+            std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::gmtime(&now));
+            std::string filename = std::string("backup-") + stamp + (archive->compressed() ? ".tar.gz" : ".tar");
+
+            LOG_INFO("Backup export for " + user_info.username);
+            response.headers["Content-Type"] = archive->compressed() ? "application/gzip" : "application/x-tar";
+            response.headers["Content-Disposition"] = "attachment; filename=\"" + filename + "\"";
+            response.headers["Cache-Control"] = "no-store";
+            response.set_stream([archive](char* buffer, size_t max) {
+                return archive->write(buffer, max);
+            });
+            return response;
+        });
+    }
     
-    // CORS preflight handler with production security headers
-    server->options("/*", [security_config](const HttpRequest& request) {
-        HttpResponse response;
-        response.status_code = 200;
+    // Firmware upgrades stream straight to the inactive partition; progress
+    // is pushed to WebSocket subscribers. Browsers cannot set headers on a
+    // WebSocket, so that one takes the access token as ?token=.
+    const auto& firmware_config = config_manager->get_firmware_config();
+    if (firmware_config.enabled) {
+        firmware_updater = std::make_shared<FirmwareUpdater>(firmware_config);
         
-        auto origin_it = request.headers.find("Origin");
-        std::string origin = origin_it != request.headers.end() ? origin_it->second : "*";
+        StreamOptions firmware_options;
+        firmware_options.max_bytes = static_cast<size_t>(firmware_config.max_image_mb) * 1024 * 1024;
+        firmware_options.open = [auth_handler = auth_handler.get(), updater = firmware_updater.get()](
+                const HttpRequest& request, int& status, std::string& message) -> std::shared_ptr<BodySink> {
+            UserInfo user_info;
+            if (!auth_handler->authenticate_request(request, user_info)) {
+                status = 401;
+                message = "Unauthorized";
+                return nullptr;
+            }
+            return updater->begin(request, status, message);
+        };
+        server->post_stream("/api/firmware/upload", std::move(firmware_options),
+                            [updater = firmware_updater.get()](const HttpRequest& request) {
+            return updater->finish(request.body_sink);
+        });
         
-        response.headers["Access-Control-Allow-Origin"] = origin;
-        response.headers["Access-Control-Allow-Methods"] = "GET, POST, PUT, DELETE, OPTIONS";
-        response.headers["Access-Control-Allow-Headers"] = "Content-Type, Authorization";
-        response.headers["Access-Control-Max-Age"] = "86400";
-        response.headers["Content-Length"] = "0";
+        server->get("/api/firmware/status", [auth_handler = auth_handler.get(), updater = firmware_updater.get()](const HttpRequest& request) {
+            HttpResponse response;
+            UserInfo user_info;
+            if (!auth_handler->authenticate_request(request, user_info)) {
+                response.set_error(401, "Authentication required");
+                return response;
+            }
+            response.set_json_content(updater->status().dump());
+            return response;
+        });
         
-        // Add production security headers if enabled
-        if (security_config.enable_security_headers) {
-            response.headers["X-Frame-Options"] = "DENY";
-            response.headers["X-Content-Type-Options"] = "nosniff";
-            response.headers["X-XSS-Protection"] = "1; mode=block";
-            response.headers["Referrer-Policy"] = "strict-origin-when-cross-origin";
-            response.headers["Strict-Transport-Security"] = security_config.strict_transport_security;
-            response.headers["Content-Security-Policy"] = security_config.content_security_policy;
+        WebSocketOptions progress_options;
+        progress_options.authorize = [jwt = jwt_manager.get()](const HttpRequest& request) {
+            auto token = request.query_params.find("token");
+            return token != request.query_params.end() && jwt->verify_token(std::string(token->second)).valid;
+        };
+        progress_options.on_open = [updater = firmware_updater.get()](std::shared_ptr<WebSocketChannel> channel) {
+            updater->subscribe(std::move(channel));
+        };
+        server->websocket("/api/firmware/progress", std::move(progress_options));
+    }
+    
+    // Prometheus scrape endpoint; loopback only unless allowed
+    const auto& metrics_config = config_manager->get_metrics_config();
+    if (metrics_config.enabled) {
+        server->get(metrics_config.path, [allow_remote = metrics_config.allow_remote](const HttpRequest& request) {
+            HttpResponse response;
+            if (!allow_remote && request.client_ip.compare(0, 4, "127.") != 0) {
+                response.set_error(403, "Access denied");
+                return response;
+            }
+            response.headers["Content-Type"] = "text/plain; version=0.0.4; charset=utf-8";
+            response.headers["Cache-Control"] = "no-store";
+            response.body = UrMetrics::Registry::instance().render();
+            return response;
+        });
+    }
+    
+    // Trace spans, dumped on demand as Chrome trace-event JSON. Sized before
+    // the server threads record their first span.
+    const auto& trace_config = config_manager->get_trace_config();
+    UrTrace::setBufferCapacity(static_cast<size_t>(trace_config.buffer_events));
+    UrTrace::setEnabled(trace_config.enabled);
+    server->get(trace_config.path, [](const HttpRequest& request) {
+        HttpResponse response;
+        if (request.client_ip.compare(0, 4, "127.") != 0) {
+            response.set_error(403, "Access denied");
+            return response;
         }
-        
+        response.headers["Content-Type"] = "application/json";
+        response.headers["Cache-Control"] = "no-store";
+        response.body = UrTrace::dumpChromeJson();
         return response;
     });
+    
+    // Static file serving, from memory unless disabled
+    if (paths_config.cache_static_assets) {
+        asset_cache = std::make_shared<AssetCache>(paths_config.frontend_root);
+        asset_cache->set_cache_policy(paths_config.cache_control);
+        asset_cache->set_bundle(paths_config.component_bundle);
+        asset_cache->set_fingerprinting(paths_config.fingerprint_assets);
+        asset_cache->load();
+        if (paths_config.watch_static_assets) {
+            asset_cache->start_watching();
+        }
+        server->serve_static_files("/", asset_cache);
+    } else {
+        auto static_files = std::make_shared<FileHandler>(paths_config.frontend_root);
+        static_files->set_cache_policy(paths_config.cache_control);
+        server->serve_static_files("/", static_files);
+    }
+    
+    // Security headers go on every response; they are built once here
+    if (security_config.enable_security_headers) {
+        HeaderMap security_headers;
+        security_headers.set("X-Frame-Options", "DENY");
+        security_headers.set("X-Content-Type-Options", "nosniff");
+        security_headers.set("X-XSS-Protection", "1; mode=block");
+        security_headers.set("Referrer-Policy", "strict-origin-when-cross-origin");
+        security_headers.set("Strict-Transport-Security", security_config.strict_transport_security);
+        security_headers.set("Content-Security-Policy", security_config.content_security_policy);
+        server->set_default_headers(std::move(security_headers));
+    }
+    
+    // Browsers reach backend-datalink through this port as well
+    const auto& websocket_proxy_config = config_manager->get_websocket_proxy_config();
+    if (websocket_proxy_config.enabled) {
+        server->proxy_websocket(websocket_proxy_config.path, websocket_proxy_config.backend);
+    }
+    
+    // CORS preflights are answered by the server from prebuilt responses
+    if (security_config.enable_cors) {
+        server->enable_cors(security_config.allowed_origins, security_config.allowed_methods,
+                            security_config.allowed_headers);
+    }
 }
 
 void print_startup_info() {
-    auto server_config = config_manager->get_server_config();
-    auto paths_config = config_manager->get_paths_config();
-    auto auth_config = config_manager->get_auth_config();
-    auto security_config = config_manager->get_security_config();
+    const auto& server_config = config_manager->get_server_config();
+    const auto& paths_config = config_manager->get_paths_config();
+    const auto& auth_config = config_manager->get_auth_config();
+    const auto& security_config = config_manager->get_security_config();
+    const auto& websocket_proxy_config = config_manager->get_websocket_proxy_config();
     
     std::cout << R"(
 ╔══════════════════════════════════════════════════════════════╗
@@ -211,10 +429,13 @@ void print_startup_info() {
 ║  Port:         )" << server_config.port << R"(
 ║  Max Connections: )" << server_config.max_connections << R"(
 ║  Thread Pool:  )" << server_config.thread_pool_size << R"(
+║  Threading:    )" << server_config.threading_mode << R"(
 ║  Frontend Root: )" << paths_config.frontend_root << R"(
 ║  Static Files: )" << paths_config.static_files << R"(
 ║  JWT Expiry:   )" << auth_config.token_expiry_hours << R"( hours
 ║  CORS:         )" << (security_config.enable_cors ? "Enabled" : "Disabled") << R"(
+║  WebSocket Proxy: )" << (websocket_proxy_config.enabled ?
+                            websocket_proxy_config.path + " -> " + websocket_proxy_config.backend : "Disabled") << R"(
 ╚══════════════════════════════════════════════════════════════╝
 
 🔐 Authentication endpoints:
@@ -234,7 +455,7 @@ void print_startup_info() {
 👤 Default credentials:
    • admin / admin123
 
-🚀 Open http://)" << server_config.host << ":" << server_config.port << R"(/login-page.html in your browser
+🚀 Open )" << (config_manager->get_tls_config().enabled ? "https://" : "http://") << server_config.host << ":" << server_config.port << R"(/login-page.html in your browser
 📝 Configuration: )" << (getenv("PKG_CONFIG") ? getenv("PKG_CONFIG") : "config/server.json") << R"(
 )";
 
@@ -273,21 +494,35 @@ int main(int argc, char* argv[]) {
         LOG_INFO("Log file: logs/frontendpp.log");
     }
     
+    // Keep console and file writes off the request handler threads
+    logger.enable_async();
+    
     // Setup signal handlers
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGHUP, reload_signal_handler);
     
-    // Initialize configuration manager
-    config_manager = std::make_unique<ConfigManager>();
-    if (!config_manager->load_config(config_path)) {
+    // Initialize configuration; SIGHUP publishes a new snapshot later
+    config_store = std::make_unique<ConfigStore>(config_path);
+    config_manager = config_store->reload();
+    if (!config_manager) {
         std::cerr << "Failed to load configuration from: " << config_path << std::endl;
         return 1;
     }
     
-    auto server_config = config_manager->get_server_config();
-    auto auth_config = config_manager->get_auth_config();
-    auto database_config = config_manager->get_database_config();
-    auto paths_config = config_manager->get_paths_config();
+    // Settings that need a restart stay those of the startup snapshot; a
+    // reload replaces config_manager but not this
+    const auto startup_config = config_manager;
+    const auto& server_config = startup_config->get_server_config();
+    if (server_config.drain_seconds > 0) {
+        signal(SIGTERM, drain_signal_handler);
+    }
+    const auto& auth_config = startup_config->get_auth_config();
+    const auto& database_config = startup_config->get_database_config();
+    const auto& paths_config = startup_config->get_paths_config();
+    
+    // Access log goes to the configured log file even without --verbose
+    apply_logging_config(startup_config->get_logging_config());
     
     // Validate and fix JWT secret before creating JWTManager
     std::string validated_jwt_secret = auth_config.jwt_secret;
@@ -307,23 +542,24 @@ int main(int argc, char* argv[]) {
                                               auth_config.token_expiry_minutes,
                                               auth_config.refresh_token_expiry_minutes,
                                               auth_config.enable_sliding_expiration,
-                                              auth_config.token_refresh_threshold_minutes);
+                                              auth_config.token_refresh_threshold_minutes,
+                                              auth_config.previous_jwt_secrets);
     
     // Initialize auth handler
-    auth_handler = std::make_unique<AuthHandler>(database_config.path, *jwt_manager);
-    
-    // Enhanced initialization: validate database integrity
-    if (!auth_handler->validate_database_integrity()) {
-        LOG_CRITICAL("Database integrity validation failed. Server cannot start safely.");
+    PasswordHasher::Options hasher_options;
+    hasher_options.iterations = auth_config.password_hash_iterations;
+    hasher_options.workers = static_cast<size_t>(auth_config.password_hash_workers);
+    hasher_options.max_queued = static_cast<size_t>(auth_config.password_hash_queue);
+    auth_handler = std::make_unique<AuthHandler>(database_config.path, *jwt_manager, hasher_options);
+    
+    if (!auth_handler->schema_ready()) {
+        LOG_CRITICAL("Database schema could not be initialized. Server cannot start safely.");
         return 1;
     }
     
     // Initialize file handler
     file_handler = std::make_unique<FileHandler>(paths_config.static_files);
     
-    // Enhanced initialization: validate file serving configuration
-    validate_file_serving(paths_config);
-    
     // Check critical files exist
     namespace fs = std::filesystem;
     std::vector<std::string> critical_files = {
@@ -346,6 +582,29 @@ int main(int argc, char* argv[]) {
                                          server_config.port,
                                          server_config.max_connections,
                                          server_config.thread_pool_size);
+    ThreadingMode threading_mode = ThreadingMode::THREAD_POOL;
+    if (!HttpServer::parse_threading_mode(server_config.threading_mode, threading_mode)) {
+        LOG_WARNING("Unknown server.threading_mode '" + server_config.threading_mode + "', using thread_pool");
+    }
+    server->set_threading_mode(threading_mode);
+    server->set_reuse_port(server_config.reuse_port);
+    ConnectionLimits connection_limits;
+    connection_limits.memory_limit = static_cast<size_t>(server_config.connection_memory_limit);
+    connection_limits.memory_increment = static_cast<size_t>(server_config.connection_memory_increment);
+    connection_limits.per_ip = static_cast<unsigned>(server_config.per_ip_connection_limit);
+    connection_limits.listen_backlog = static_cast<unsigned>(server_config.listen_backlog);
+    connection_limits.idle_timeout_seconds = static_cast<unsigned>(server_config.connection_timeout_seconds);
+    server->set_connection_limits(connection_limits);
+    const auto& tls_config = config_manager->get_tls_config();
+    if (tls_config.enabled) {
+        tls_credentials = std::make_shared<TlsCredentials>();
+        if (!tls_credentials->load(tls_config.cert_file, tls_config.key_file)) {
+            LOG_CRITICAL("TLS is enabled but no certificate could be loaded");
+            return 1;
+        }
+        server->set_tls(tls_credentials, tls_config.priorities);
+    }
+    server->set_compression(static_cast<size_t>(server_config.compress_min_bytes), server_config.compress_types);
     
     // Setup routes
     setup_routes();
@@ -360,16 +619,34 @@ int main(int argc, char* argv[]) {
     }
     
     std::cout << "✅ Frontend++ server started successfully!" << std::endl;
-    std::cout << "🌐 Listening on http://" << server_config.host << ":" << server_config.port << std::endl;
+    std::cout << "🌐 Listening on " << (tls_credentials ? "https://" : "http://") << server_config.host << ":" << server_config.port << std::endl;
     std::cout << "📁 Serving files from: " << paths_config.frontend_root << std::endl;
+    
+    // Checks that only report, run once requests are already being served
+    auth_handler->run_deferred_checks();
+    validate_file_serving(paths_config);
+    
     std::cout << "\nPress Ctrl+C to stop the server\n";
     std::cout << "=" << std::string(64, '=') << std::endl;
     
     // Keep server running
     while (server->is_running()) {
         sleep(1);
+        if (reload_requested.exchange(false)) {
+            reload_config();
+        }
+        if (drain_requested.load()) {
+            std::cout << "\nReceived SIGTERM, draining for up to " << server_config.drain_seconds << "s..." << std::endl;
+            server->drain(std::chrono::seconds(server_config.drain_seconds));
+        }
+    }
+    if (asset_cache) {
+        asset_cache->stop_watching();
     }
+    // Writes the logins still queued
+    auth_handler.reset();
     
     std::cout << "\n🛑 Frontend++ server stopped" << std::endl;
+    logger.disable_async();
     return 0;
 }
@@ -0,0 +1,273 @@
+#include "multipart_parser.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+} // namespace
+
+MultipartParser::MultipartParser(const std::string& boundary, PartBegin on_begin, PartData on_data, PartEnd on_end)
+    : delimiter_("\r\n--" + boundary), on_begin_(std::move(on_begin)), on_data_(std::move(on_data)),
+      on_end_(std::move(on_end)) {
+    size_t length = delimiter_.size();
+    std::fill(std::begin(skip_), std::end(skip_), length);
+    for (size_t i = 0; i + 1 < length; ++i) {
+        skip_[static_cast<unsigned char>(delimiter_[i])] = length - 1 - i;
+    }
+    // The first delimiter has no line break in front of it
+    carry_ = "\r\n";
+    if (boundary.empty()) {
+        state_ = State::Failed;
+    }
+}
+
+size_t MultipartParser::search(const char* data, size_t size) const {
+    size_t length = delimiter_.size();
+    char last = delimiter_[length - 1];
+    size_t i = 0;
+    while (i + length <= size) {
+        char c = data[i + length - 1];
+        if (c == last && std::memcmp(data + i, delimiter_.data(), length - 1) == 0) {
+            return i;
+        }
+        i += skip_[static_cast<unsigned char>(c)];
+    }
+    return std::string::npos;
+}
+
+bool MultipartParser::emit(const char* data, size_t size) {
+    // Preamble bytes are dropped
+    return size == 0 || state_ != State::Body || on_data_(data, size);
+}
+
+size_t MultipartParser::scan_body(const char* data, size_t size) {
+    size_t length = delimiter_.size();
+    auto delimiter_found = [this]() {
+        bool ok = state_ != State::Body || on_end_();
+        state_ = ok ? State::Delimiter : State::Failed;
+    };
+
+    if (!carry_.empty()) {
+        // Only a delimiter starting in carry_ matters here; one that starts
+        // in data is found by the plain search below
+        size_t take = std::min(size, length - 1);
+        std::string joint = carry_;
+        joint.append(data, take);
+        size_t pos = search(joint.data(), joint.size());
+        if (pos != std::string::npos && pos < carry_.size()) {
+            if (!emit(carry_.data(), pos)) {
+                state_ = State::Failed;
+                return 0;
+            }
+            size_t used = pos + length - carry_.size();
+            carry_.clear();
+            delimiter_found();
+            return used;
+        }
+        if (pos == std::string::npos && take < length - 1) {
+            // Too little data yet to rule one out
+            size_t keep = std::min(joint.size(), length - 1);
+            if (!emit(joint.data(), joint.size() - keep)) {
+                state_ = State::Failed;
+                return 0;
+            }
+            carry_ = joint.substr(joint.size() - keep);
+            return take;
+        }
+        if (!emit(carry_.data(), carry_.size())) {
+            state_ = State::Failed;
+            return 0;
+        }
+        carry_.clear();
+        return 0;
+    }
+
+    size_t pos = search(data, size);
+    if (pos != std::string::npos) {
+        if (!emit(data, pos)) {
+            state_ = State::Failed;
+            return 0;
+        }
+        delimiter_found();
+        return pos + length;
+    }
+
+    // The tail could be the start of a delimiter
+    size_t keep = std::min(size, length - 1);
+    if (!emit(data, size - keep)) {
+        state_ = State::Failed;
+        return 0;
+    }
+    carry_.assign(data + size - keep, keep);
+    return size;
+}
+
+size_t MultipartParser::scan_delimiter_end(const char* data, size_t size) {
+    // "--" closes the body, CRLF starts another part; padding may come first
+    for (size_t i = 0; i < size; ++i) {
+        char c = data[i];
+        if (buffer_.empty()) {
+            if (c == ' ' || c == '\t') {
+                continue;
+            }
+            if (c != '-' && c != '\r') {
+                state_ = State::Failed;
+                return i;
+            }
+            buffer_ += c;
+            continue;
+        }
+
+        buffer_ += c;
+        if (buffer_ == "--") {
+            state_ = State::Done;
+        } else if (buffer_ == "\r\n") {
+            state_ = State::Headers;
+        } else {
+            state_ = State::Failed;
+        }
+        buffer_.clear();
+        return i + 1;
+    }
+    return size;
+}
+
+size_t MultipartParser::scan_headers(const char* data, size_t size) {
+    size_t old_size = buffer_.size();
+    size_t take = std::min(size, kMaxHeaderBytes + 4 - old_size);
+    buffer_.append(data, take);
+
+    size_t end;
+    size_t separator;
+    if (buffer_.compare(0, 2, "\r\n") == 0) {
+        end = 0;                    // A part without headers
+        separator = 2;
+    } else {
+        end = buffer_.find("\r\n\r\n", old_size >= 3 ? old_size - 3 : 0);
+        separator = 4;
+    }
+    if (end == std::string::npos) {
+        if (buffer_.size() >= kMaxHeaderBytes + 4) {
+            state_ = State::Failed;
+        }
+        return take;
+    }
+
+    if (!on_begin_(std::string_view(buffer_.data(), end))) {
+        state_ = State::Failed;
+        return take;
+    }
+    size_t used = end + separator - old_size;
+    buffer_.clear();
+    state_ = State::Body;
+    return used;
+}
+
+bool MultipartParser::feed(const char* data, size_t size) {
+    while (size > 0) {
+        size_t used = 0;
+        switch (state_) {
+            case State::Preamble:
+            case State::Body:
+                used = scan_body(data, size);
+                break;
+            case State::Delimiter:
+                used = scan_delimiter_end(data, size);
+                break;
+            case State::Headers:
+                used = scan_headers(data, size);
+                break;
+            case State::Done:
+                return true;        // Epilogue
+            case State::Failed:
+                return false;
+        }
+        data += used;
+        size -= used;
+    }
+    return state_ != State::Failed;
+}
+
+std::string MultipartParser::boundary_from_content_type(std::string_view content_type) {
+    size_t semicolon = content_type.find(';');
+    if (semicolon == std::string_view::npos ||
+        !iequals(trim(content_type.substr(0, semicolon)), "multipart/form-data")) {
+        return "";
+    }
+    return header_param(content_type, "boundary");
+}
+
+std::string_view MultipartParser::header_value(std::string_view headers, std::string_view name) {
+    while (!headers.empty()) {
+        size_t line_end = headers.find("\r\n");
+        std::string_view line = headers.substr(0, line_end);
+        headers = line_end == std::string_view::npos ? std::string_view() : headers.substr(line_end + 2);
+
+        size_t colon = line.find(':');
+        if (colon != std::string_view::npos && iequals(trim(line.substr(0, colon)), name)) {
+            return trim(line.substr(colon + 1));
+        }
+    }
+    return std::string_view();
+}
+
+std::string MultipartParser::header_param(std::string_view value, std::string_view param, bool* found) {
+    if (found) {
+        *found = false;
+    }
+
+    // Parameters follow the first ';', each name=token or name="quoted"
+    size_t pos = value.find(';');
+    while (pos != std::string_view::npos && pos < value.size()) {
+        ++pos;
+        size_t equals = value.find('=', pos);
+        if (equals == std::string_view::npos) {
+            break;
+        }
+        std::string_view name = trim(value.substr(pos, equals - pos));
+
+        std::string text;
+        size_t next = equals + 1;
+        while (next < value.size() && (value[next] == ' ' || value[next] == '\t')) {
+            ++next;
+        }
+        if (next < value.size() && value[next] == '"') {
+            for (++next; next < value.size() && value[next] != '"'; ++next) {
+                if (value[next] == '\\' && next + 1 < value.size()) {
+                    ++next;
+                }
+                text += value[next];
+            }
+            pos = value.find(';', next);
+        } else {
+            pos = value.find(';', next);
+            text = std::string(trim(value.substr(next, pos == std::string_view::npos ? std::string_view::npos : pos - next)));
+        }
+
+        if (iequals(name, param)) {
+            if (found) {
+                *found = true;
+            }
+            return text;
+        }
+    }
+    return "";
+}
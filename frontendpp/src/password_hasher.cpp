@@ -0,0 +1,185 @@
+#include "password_hasher.h"
+#include "logger.h"
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+
+const char* const kPbkdf2Tag = "$pbkdf2-sha256$";
+const size_t kSaltBytes = 16;
+const size_t kKeyBytes = 32;
+
+std::string to_hex(const unsigned char* data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; ++i) {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 0x0f];
+    }
+    return hex;
+}
+
+bool from_hex(const std::string& hex, std::vector<unsigned char>& out) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    out.clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        char byte[3] = {hex[i], hex[i + 1], '\0'};
+        char* end = nullptr;
+        long value = std::strtol(byte, &end, 16);
+        if (end != byte + 2) {
+            return false;
+        }
+        out.push_back(static_cast<unsigned char>(value));
+    }
+    return true;
+}
+
+bool pbkdf2(const std::string& password, const unsigned char* salt, size_t salt_size, int iterations,
+            unsigned char* key, size_t key_size) {
+    return PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.size()), salt, static_cast<int>(salt_size),
+                             iterations, EVP_sha256(), static_cast<int>(key_size), key) == 1;
+}
+
+// The format written before hashes were salted
+std::string legacy_sha256(const std::string& password) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    if (EVP_Digest(password.data(), password.size(), digest, &length, EVP_sha256(), nullptr) != 1) {
+        return "";
+    }
+    return to_hex(digest, length);
+}
+
+bool equal_hex(const std::string& a, const std::string& b) {
+    return a.size() == b.size() && CRYPTO_memcmp(a.data(), b.data(), a.size()) == 0;
+}
+
+} // namespace
+
+PasswordHasher::PasswordHasher(const Options& options) : options_(options), stopping_(false) {
+    if (options_.iterations < 1) {
+        options_.iterations = 1;
+    }
+    if (options_.workers == 0) {
+        options_.workers = 1;
+    }
+    for (size_t i = 0; i < options_.workers; ++i) {
+        workers_.emplace_back(&PasswordHasher::worker_loop, this);
+    }
+}
+
+PasswordHasher::~PasswordHasher() {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        stopping_ = true;
+    }
+    jobs_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::string PasswordHasher::hash(const std::string& password) const {
+    unsigned char salt[kSaltBytes];
+    unsigned char key[kKeyBytes];
+    if (RAND_bytes(salt, sizeof(salt)) != 1 ||
+        !pbkdf2(password, salt, sizeof(salt), options_.iterations, key, sizeof(key))) {
+        LOG_ERROR("Password hashing failed");
+        return "";
+    }
+    return std::string(kPbkdf2Tag) + "i=" + std::to_string(options_.iterations) + "$" +
+           to_hex(salt, sizeof(salt)) + "$" + to_hex(key, sizeof(key));
+}
+
+PasswordHasher::Result PasswordHasher::verify(const std::string& password, const std::string& stored) const {
+    Result result;
+    
+    if (stored.compare(0, std::char_traits<char>::length(kPbkdf2Tag), kPbkdf2Tag) == 0) {
+        // $pbkdf2-sha256$i=N$salt$key
+        int iterations = 0;
+        char salt_hex[129];
+        char key_hex[129];
+        const char* fields = stored.c_str() + std::char_traits<char>::length(kPbkdf2Tag);
+        if (std::sscanf(fields, "i=%d$%128[0-9a-f]$%128[0-9a-f]", &iterations, salt_hex, key_hex) != 3 ||
+            iterations < 1) {
+            return result;
+        }
+        std::vector<unsigned char> salt;
+        std::vector<unsigned char> expected;
+        if (!from_hex(salt_hex, salt) || !from_hex(key_hex, expected) || expected.empty()) {
+            return result;
+        }
+        std::vector<unsigned char> key(expected.size());
+        if (!pbkdf2(password, salt.data(), salt.size(), iterations, key.data(), key.size())) {
+            return result;
+        }
+        result.matched = CRYPTO_memcmp(key.data(), expected.data(), key.size()) == 0;
+        if (result.matched && iterations < options_.iterations) {
+            result.rehash = hash(password);
+        }
+        return result;
+    }
+    
+    // Unsalted SHA-256 hex from earlier versions; upgraded on the next login
+    result.matched = equal_hex(legacy_sha256(password), stored);
+    if (result.matched) {
+        result.rehash = hash(password);
+    }
+    return result;
+}
+
+std::future<std::string> PasswordHasher::hash_async(std::string password) {
+    auto task = std::make_shared<std::packaged_task<std::string()>>(
+        [this, password = std::move(password)]() { return hash(password); });
+    std::future<std::string> future = task->get_future();
+    if (!submit([task]() { (*task)(); })) {
+        return std::future<std::string>();
+    }
+    return future;
+}
+
+std::future<PasswordHasher::Result> PasswordHasher::verify_async(std::string password, std::string stored) {
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        [this, password = std::move(password), stored = std::move(stored)]() { return verify(password, stored); });
+    std::future<Result> future = task->get_future();
+    if (!submit([task]() { (*task)(); })) {
+        return std::future<Result>();
+    }
+    return future;
+}
+
+bool PasswordHasher::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        if (stopping_ || jobs_.size() >= options_.max_queued) {
+            return false;
+        }
+        jobs_.push_back(std::move(job));
+    }
+    jobs_cv_.notify_one();
+    return true;
+}
+
+void PasswordHasher::worker_loop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex_);
+            jobs_cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            // Queued logins still get their answer before shutdown
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
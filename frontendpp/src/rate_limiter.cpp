@@ -0,0 +1,148 @@
+#include "rate_limiter.h"
+#include <algorithm>
+
+namespace {
+
+const size_t kSlotsPerShard = 1024;
+// Slots a key may occupy, starting at its hash
+const size_t kProbeWindow = 8;
+// Slots the clock hand passes on each lookup
+const size_t kSweepStep = 2;
+
+// state = time << kTokenBits | milli-tokens; time 0 marks a fresh bucket
+const unsigned kTokenBits = 24;
+const uint64_t kTokenMask = (uint64_t(1) << kTokenBits) - 1;
+const uint64_t kMilli = 1000;
+
+uint64_t pack(uint64_t time, uint64_t tokens) {
+    return (time << kTokenBits) | tokens;
+}
+
+} // namespace
+
+RateLimiter::RateLimiter(unsigned requests_per_minute, unsigned burst)
+    : start_(std::chrono::steady_clock::now()) {
+    set_rate(requests_per_minute, burst);
+    for (auto& shard : shards_) {
+        shard.slots.reset(new Slot[kSlotsPerShard]);
+    }
+}
+
+void RateLimiter::set_rate(unsigned requests_per_minute, unsigned burst) {
+    uint64_t rate = std::max(1u, requests_per_minute);
+    uint64_t tokens = burst > 0 ? burst : rate;
+    capacity_.store(std::min(tokens * kMilli, kTokenMask), std::memory_order_relaxed);
+    requests_per_minute_.store(rate, std::memory_order_relaxed);
+}
+
+uint64_t RateLimiter::key_for(const void* address, size_t size) {
+    // FNV-1a, never 0
+    const auto* bytes = static_cast<const unsigned char*>(address);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+uint64_t RateLimiter::now_ms() const {
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) + 1;
+}
+
+void RateLimiter::refill(uint64_t state, uint64_t now, uint64_t& tokens, uint64_t& time) const {
+    uint64_t capacity = capacity_.load(std::memory_order_relaxed);
+    time = state >> kTokenBits;
+    tokens = state & kTokenMask;
+    if (time == 0 || now <= time) {
+        if (time == 0) {
+            tokens = capacity;
+            time = now;
+        } else {
+            tokens = std::min(tokens, capacity);
+        }
+        return;
+    }
+
+    // Only the time that produced whole milli-tokens is used up, so slow
+    // rates still refill when called every few milliseconds
+    uint64_t rate = requests_per_minute_.load(std::memory_order_relaxed);
+    uint64_t gained = (now - time) * rate / 60;
+    if (tokens + gained >= capacity) {
+        tokens = capacity;
+        time = now;
+    } else {
+        tokens += gained;
+        time += gained * 60 / rate;
+    }
+}
+
+bool RateLimiter::is_idle(const Slot& slot, uint64_t now) const {
+    uint64_t tokens;
+    uint64_t time;
+    refill(slot.state.load(std::memory_order_relaxed), now, tokens, time);
+    return tokens >= capacity_.load(std::memory_order_relaxed);
+}
+
+RateLimiter::Slot& RateLimiter::find_slot(Shard& shard, uint64_t key, uint64_t now) {
+    size_t base = static_cast<size_t>(key);
+    for (size_t i = 0; i < kProbeWindow; ++i) {
+        Slot& slot = shard.slots[(base + i) % kSlotsPerShard];
+        if (slot.key.load(std::memory_order_acquire) == key) {
+            return slot;
+        }
+    }
+
+    // A full bucket is as good as a new one, so an idle client's slot can
+    // be taken over without resetting it
+    for (size_t i = 0; i < kProbeWindow; ++i) {
+        Slot& slot = shard.slots[(base + i) % kSlotsPerShard];
+        uint64_t current = slot.key.load(std::memory_order_acquire);
+        if (current != 0 && !is_idle(slot, now)) {
+            continue;
+        }
+        if (slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel) || current == key) {
+            return slot;
+        }
+    }
+    return shard.overflow;
+}
+
+void RateLimiter::sweep(Shard& shard, uint64_t now) {
+    uint32_t hand = shard.hand.fetch_add(kSweepStep, std::memory_order_relaxed);
+    for (size_t i = 0; i < kSweepStep; ++i) {
+        Slot& slot = shard.slots[(hand + i) % kSlotsPerShard];
+        uint64_t current = slot.key.load(std::memory_order_relaxed);
+        if (current != 0 && is_idle(slot, now)) {
+            slot.key.compare_exchange_strong(current, 0, std::memory_order_acq_rel);
+        }
+    }
+}
+
+bool RateLimiter::take(Slot& slot, uint64_t now, unsigned* retry_after_seconds) {
+    uint64_t state = slot.state.load(std::memory_order_relaxed);
+    for (;;) {
+        uint64_t tokens;
+        uint64_t time;
+        refill(state, now, tokens, time);
+        if (tokens < kMilli) {
+            if (retry_after_seconds) {
+                uint64_t rate = requests_per_minute_.load(std::memory_order_relaxed);
+                uint64_t wait_ms = ((kMilli - tokens) * 60 + rate - 1) / rate;
+                *retry_after_seconds = static_cast<unsigned>((wait_ms + 999) / 1000);
+            }
+            return false;
+        }
+        if (slot.state.compare_exchange_weak(state, pack(time, tokens - kMilli), std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+bool RateLimiter::allow(uint64_t key, unsigned* retry_after_seconds) {
+    Shard& shard = shards_[(key >> 56) % kShardCount];
+    uint64_t now = now_ms();
+    sweep(shard, now);
+    return take(find_slot(shard, key, now), now, retry_after_seconds);
+}
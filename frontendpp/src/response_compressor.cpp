@@ -0,0 +1,158 @@
+#include "response_compressor.h"
+#include "file_handler.h"
+#include "ur-metrics/ur_metrics.hpp"
+#include <cctype>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace {
+
+// Responses are compressed while the client waits, so these trade some
+// ratio for speed; static assets get the best levels ahead of time
+#ifdef HAVE_ZLIB
+const int kGzipLevel = 6;
+#endif
+#ifdef HAVE_BROTLI
+const int kBrotliQuality = 4;
+const int kBrotliWindow = 18;
+#endif
+
+#ifdef HAVE_ZLIB
+// One per server thread for its lifetime; deflateReset() keeps the
+// allocated state for the next response
+struct GzipStream {
+    z_stream stream{};
+    bool ready;
+    
+    GzipStream() {
+        // windowBits 15 + 16: gzip framing
+        ready = deflateInit2(&stream, kGzipLevel, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~GzipStream() {
+        if (ready) {
+            deflateEnd(&stream);
+        }
+    }
+};
+#endif
+
+bool gzip_compress(const std::string& data, std::string& out) {
+#ifdef HAVE_ZLIB
+    thread_local GzipStream gzip;
+    if (!gzip.ready || deflateReset(&gzip.stream) != Z_OK) {
+        return false;
+    }
+    out.resize(deflateBound(&gzip.stream, data.size()));
+    gzip.stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    gzip.stream.avail_in = static_cast<uInt>(data.size());
+    gzip.stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    gzip.stream.avail_out = static_cast<uInt>(out.size());
+    if (deflate(&gzip.stream, Z_FINISH) != Z_STREAM_END) {
+        return false;
+    }
+    out.resize(gzip.stream.total_out);
+    return true;
+#else
+    (void)data;
+    (void)out;
+    return false;
+#endif
+}
+
+bool brotli_compress(const std::string& data, std::string& out) {
+#ifdef HAVE_BROTLI
+    size_t length = BrotliEncoderMaxCompressedSize(data.size());
+    if (length == 0) {
+        return false;
+    }
+    out.resize(length);
+    if (!BrotliEncoderCompress(kBrotliQuality, kBrotliWindow, BROTLI_MODE_TEXT,
+                               data.size(), reinterpret_cast<const uint8_t*>(data.data()),
+                               &length, reinterpret_cast<uint8_t*>(&out[0]))) {
+        return false;
+    }
+    out.resize(length);
+    return true;
+#else
+    (void)data;
+    (void)out;
+    return false;
+#endif
+}
+
+} // namespace
+
+ResponseCompressor::ResponseCompressor(size_t min_bytes, std::vector<std::string> content_types)
+    : min_bytes_(min_bytes), content_types_(std::move(content_types)) {
+    UrMetrics::Registry& registry = UrMetrics::Registry::instance();
+    gzip_responses_ = &registry.counter("frontendpp_http_compressed_responses_total",
+                                        "Route responses compressed on the fly", {{"coding", "gzip"}});
+    brotli_responses_ = &registry.counter("frontendpp_http_compressed_responses_total",
+                                          "Route responses compressed on the fly", {{"coding", "br"}});
+    saved_bytes_ = &registry.counter("frontendpp_http_compression_saved_bytes_total",
+                                     "Body bytes saved by compressing route responses");
+}
+
+bool ResponseCompressor::is_listed(std::string_view content_type) const {
+    content_type = content_type.substr(0, content_type.find(';'));
+    while (!content_type.empty() && std::isspace(static_cast<unsigned char>(content_type.back()))) {
+        content_type.remove_suffix(1);
+    }
+    for (const auto& listed : content_types_) {
+        bool family = !listed.empty() && listed.back() == '/';
+        if (family ? content_type.compare(0, listed.size(), listed) == 0 : content_type == listed) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ResponseCompressor::compress(const HttpRequest& request, HttpResponse& response) const {
+    // No body (1xx, 204, 304), a byte range, or already encoded
+    if (response.status_code < 200 || response.status_code == 204 || response.status_code == 206 ||
+        response.status_code == 304 || response.file || response.shared_body || response.stream ||
+        response.body.size() < min_bytes_ || response.headers.count("Content-Encoding")) {
+        return false;
+    }
+    auto content_type = response.headers.find("Content-Type");
+    if (content_type == response.headers.end() || !is_listed(content_type->second)) {
+        return false;
+    }
+    
+    auto vary = response.headers.find("Vary");
+    if (vary == response.headers.end()) {
+        response.headers["Vary"] = "Accept-Encoding";
+    } else if (vary->second.find("Accept-Encoding") == std::string::npos) {
+        vary->second += ", Accept-Encoding";
+    }
+    
+    std::string_view accept_encoding = request.get_header("Accept-Encoding");
+    std::string encoded;
+    const char* coding = nullptr;
+    UrMetrics::Counter* responses = nullptr;
+    if (FileHandler::accepts_encoding(accept_encoding, "br") && brotli_compress(response.body, encoded)) {
+        coding = "br";
+        responses = brotli_responses_;
+    } else if (FileHandler::accepts_encoding(accept_encoding, "gzip") && gzip_compress(response.body, encoded)) {
+        coding = "gzip";
+        responses = gzip_responses_;
+    }
+    if (!coding || encoded.size() >= response.body.size()) {
+        return false;
+    }
+    
+    saved_bytes_->inc(response.body.size() - encoded.size());
+    responses->inc();
+    response.body = std::move(encoded);
+    response.headers["Content-Encoding"] = coding;
+    auto etag = response.headers.find("ETag");
+    if (etag != response.headers.end() && !etag->second.empty() && etag->second.back() == '"') {
+        etag->second = FileHandler::variant_etag(etag->second, coding);
+    }
+    return true;
+}
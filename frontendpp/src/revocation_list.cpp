@@ -0,0 +1,209 @@
+#include "revocation_list.h"
+#include "logger.h"
+
+namespace {
+
+// Tokens and users are hashed apart, so a user named like a token ID does
+// not collide with it
+const char kTokenKind = 't';
+const char kUserKind = 'u';
+
+uint64_t key_hash(char kind, const std::string& key) {
+    uint64_t hash = 14695981039346656037ULL;
+    hash = (hash ^ static_cast<unsigned char>(kind)) * 1099511628211ULL;
+    for (unsigned char c : key) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    // Final mix, so the high half used for the second probe is spread too
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+int64_t to_seconds(RevocationList::Clock::time_point when) {
+    return std::chrono::duration_cast<std::chrono::seconds>(when.time_since_epoch()).count();
+}
+
+RevocationList::Clock::time_point from_seconds(int64_t seconds) {
+    return RevocationList::Clock::time_point(std::chrono::seconds(seconds));
+}
+
+} // namespace
+
+constexpr std::chrono::minutes RevocationList::kSweepInterval;
+
+RevocationList::RevocationList() {
+    for (auto& word : filter_) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool RevocationList::attach(const std::string& db_path) {
+    auto pool = std::make_unique<SqlitePool>(db_path, 1);
+    auto now = Clock::now();
+    size_t loaded = 0;
+    {
+        SqlitePool::Lease lease = pool->acquire();
+        sqlite3_stmt* purge = lease.prepare("DELETE FROM token_revocations WHERE expires_at < ?");
+        sqlite3_stmt* select = lease.prepare("SELECT kind, key, revoked_before, expires_at FROM token_revocations");
+        if (!purge || !select) {
+            return false;
+        }
+        sqlite3_bind_int64(purge, 1, to_seconds(now));
+        sqlite3_step(purge);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (sqlite3_step(select) == SQLITE_ROW) {
+            const char* kind = reinterpret_cast<const char*>(sqlite3_column_text(select, 0));
+            const char* key = reinterpret_cast<const char*>(sqlite3_column_text(select, 1));
+            if (!kind || !key) {
+                continue;
+            }
+            auto until = from_seconds(sqlite3_column_int64(select, 3));
+            if (kind[0] == kTokenKind) {
+                tokens_[key] = until;
+                add_to_filter(key_hash(kTokenKind, key));
+            } else if (kind[0] == kUserKind) {
+                users_[key] = UserEntry{from_seconds(sqlite3_column_int64(select, 2)), until};
+                add_to_filter(key_hash(kUserKind, key));
+            } else {
+                continue;
+            }
+            ++loaded;
+        }
+        next_sweep_ = now + kSweepInterval;
+        db_pool_ = std::move(pool);
+    }
+    LOG_INFO("Token revocations: " + std::to_string(loaded) + " loaded from " + db_path);
+    return true;
+}
+
+void RevocationList::revoke_token(const std::string& jti, Clock::time_point expires_at) {
+    if (jti.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    sweep(Clock::now());
+    tokens_[jti] = expires_at;
+    add_to_filter(key_hash(kTokenKind, jti));
+    if (!persist(std::string(1, kTokenKind), jti, Clock::time_point(), expires_at)) {
+        LOG_WARNING("Token revocation not stored, it lasts until restart");
+    }
+}
+
+void RevocationList::revoke_user(const std::string& username, Clock::time_point before, Clock::time_point until) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sweep(Clock::now());
+    users_[username] = UserEntry{before, until};
+    add_to_filter(key_hash(kUserKind, username));
+    if (!persist(std::string(1, kUserKind), username, before, until)) {
+        LOG_WARNING("Token revocation for " + username + " not stored, it lasts until restart");
+    }
+}
+
+bool RevocationList::is_revoked(const std::string& jti, const std::string& username,
+                                Clock::time_point issued_at) const {
+    bool token_listed = !jti.empty() && filter_contains(key_hash(kTokenKind, jti));
+    bool user_listed = filter_contains(key_hash(kUserKind, username));
+    if (!token_listed && !user_listed) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (token_listed && tokens_.count(jti)) {
+        return true;
+    }
+    if (user_listed) {
+        auto user = users_.find(username);
+        return user != users_.end() && issued_at < user->second.before;
+    }
+    return false;
+}
+
+// Double hashing: probe i is hash + i * step
+size_t RevocationList::filter_bit(uint64_t hash, int i) {
+    return (hash + static_cast<uint64_t>(i) * ((hash >> 32) | 1)) % kFilterBits;
+}
+
+void RevocationList::add_to_filter(uint64_t hash) {
+    for (int i = 0; i < kFilterHashes; ++i) {
+        size_t bit = filter_bit(hash, i);
+        filter_[bit / 64].fetch_or(uint64_t(1) << (bit % 64), std::memory_order_release);
+    }
+}
+
+bool RevocationList::filter_contains(uint64_t hash) const {
+    for (int i = 0; i < kFilterHashes; ++i) {
+        size_t bit = filter_bit(hash, i);
+        if (!(filter_[bit / 64].load(std::memory_order_acquire) & (uint64_t(1) << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RevocationList::persist(const std::string& kind, const std::string& key,
+                             Clock::time_point before, Clock::time_point until) {
+    if (!db_pool_) {
+        return true;
+    }
+    SqlitePool::Lease lease = db_pool_->acquire();
+    sqlite3_stmt* stmt = lease.prepare(
+        "INSERT OR REPLACE INTO token_revocations (kind, key, revoked_before, expires_at) VALUES (?, ?, ?, ?)");
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, kind.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, key.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, to_seconds(before));
+    sqlite3_bind_int64(stmt, 4, to_seconds(until));
+    return sqlite3_step(stmt) == SQLITE_DONE;
+}
+
+// The filter cannot drop single keys, so it is rebuilt aside and stored
+// word by word. Each word of the new filter keeps every bit of the entries
+// still live, so a reader seeing a mix of old and new words misses none.
+void RevocationList::sweep(Clock::time_point now) {
+    if (now < next_sweep_) {
+        return;
+    }
+    next_sweep_ = now + kSweepInterval;
+
+    size_t before = tokens_.size() + users_.size();
+    for (auto it = tokens_.begin(); it != tokens_.end(); ) {
+        it = it->second < now ? tokens_.erase(it) : std::next(it);
+    }
+    for (auto it = users_.begin(); it != users_.end(); ) {
+        it = it->second.until < now ? users_.erase(it) : std::next(it);
+    }
+    if (tokens_.size() + users_.size() == before) {
+        return;
+    }
+
+    std::array<uint64_t, kFilterBits / 64> rebuilt{};
+    auto add = [&rebuilt](uint64_t hash) {
+        for (int i = 0; i < kFilterHashes; ++i) {
+            size_t bit = filter_bit(hash, i);
+            rebuilt[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    };
+    for (const auto& token : tokens_) {
+        add(key_hash(kTokenKind, token.first));
+    }
+    for (const auto& user : users_) {
+        add(key_hash(kUserKind, user.first));
+    }
+    for (size_t i = 0; i < rebuilt.size(); ++i) {
+        filter_[i].store(rebuilt[i], std::memory_order_release);
+    }
+
+    if (db_pool_) {
+        SqlitePool::Lease lease = db_pool_->acquire();
+        sqlite3_stmt* stmt = lease.prepare("DELETE FROM token_revocations WHERE expires_at < ?");
+        if (stmt) {
+            sqlite3_bind_int64(stmt, 1, to_seconds(now));
+            sqlite3_step(stmt);
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#include "route_table.h"
+#include "http_server.h"
+#include <algorithm>
+
+struct RouteTable::Node {
+    // Literal segments, sorted for binary search
+    std::vector<std::pair<std::string, std::unique_ptr<Node>>> children;
+    std::unique_ptr<Node> param_child;
+    std::string param_name;
+    RouteHandler handler;       // A pattern ends here
+    RouteHandler wildcard;      // A "/*" pattern ends here
+    
+    const Node* find_child(std::string_view segment) const {
+        auto it = std::lower_bound(children.begin(), children.end(), segment,
+                                   [](const std::pair<std::string, std::unique_ptr<Node>>& child, std::string_view value) {
+                                       return std::string_view(child.first) < value;
+                                   });
+        return it != children.end() && it->first == segment ? it->second.get() : nullptr;
+    }
+    
+    Node& child(std::string_view segment) {
+        auto it = std::lower_bound(children.begin(), children.end(), segment,
+                                   [](const std::pair<std::string, std::unique_ptr<Node>>& child, std::string_view value) {
+                                       return std::string_view(child.first) < value;
+                                   });
+        if (it == children.end() || it->first != segment) {
+            it = children.emplace(it, std::string(segment), std::make_unique<Node>());
+        }
+        return *it->second;
+    }
+};
+
+RouteTable::RouteTable() : root_(std::make_unique<Node>()) {
+}
+
+RouteTable::~RouteTable() = default;
+RouteTable::RouteTable(RouteTable&&) noexcept = default;
+RouteTable& RouteTable::operator=(RouteTable&&) noexcept = default;
+
+void RouteTable::add(const std::string& pattern, RouteHandler handler) {
+    bool wildcard = pattern.size() >= 2 && pattern.compare(pattern.size() - 2, 2, "/*") == 0;
+    if (!wildcard && pattern.find("/:") == std::string::npos) {
+        exact_[pattern] = std::move(handler);
+        return;
+    }
+    
+    std::string_view path(pattern);
+    if (wildcard) {
+        path.remove_suffix(2);
+        // "//*" (a static tree served at "/") is the root wildcard
+        while (!path.empty() && path.back() == '/') {
+            path.remove_suffix(1);
+        }
+    }
+    
+    Node* node = root_.get();
+    if (!path.empty()) {
+        std::string_view rest = path.front() == '/' ? path.substr(1) : path;
+        for (;;) {
+            size_t slash = rest.find('/');
+            std::string_view segment = rest.substr(0, slash);
+            if (segment.size() > 1 && segment.front() == ':') {
+                if (!node->param_child) {
+                    node->param_child = std::make_unique<Node>();
+                    node->param_name = std::string(segment.substr(1));
+                }
+                node = node->param_child.get();
+            } else {
+                node = &node->child(segment);
+            }
+            if (slash == std::string_view::npos) {
+                break;
+            }
+            rest = rest.substr(slash + 1);
+        }
+    }
+    
+    (wildcard ? node->wildcard : node->handler) = std::move(handler);
+}
+
+bool RouteTable::match(const std::string& path, Match& match) const {
+    match.handler = nullptr;
+    match.param_count = 0;
+    
+    auto exact = exact_.find(path);
+    if (exact != exact_.end()) {
+        match.handler = &exact->second;
+        return true;
+    }
+    
+    if (path.empty() || path.front() != '/') {
+        return false;
+    }
+    std::string_view rest(path);
+    rest.remove_prefix(1);
+    return match_node(*root_, rest, path.size() == 1, match);
+}
+
+// rest is what follows the last '/' consumed; done once it has all been
+bool RouteTable::match_node(const Node& node, std::string_view rest, bool done, Match& match) {
+    if (done) {
+        if (node.handler) {
+            match.handler = &node.handler;
+            return true;
+        }
+    } else {
+        size_t slash = rest.find('/');
+        std::string_view segment = rest.substr(0, slash);
+        bool next_done = slash == std::string_view::npos;
+        std::string_view next = next_done ? std::string_view() : rest.substr(slash + 1);
+        
+        const Node* child = node.find_child(segment);
+        if (child && match_node(*child, next, next_done, match)) {
+            return true;
+        }
+        
+        if (node.param_child && !segment.empty() && match.param_count < kMaxParams) {
+            match.params[match.param_count++] = {&node.param_name, segment};
+            if (match_node(*node.param_child, next, next_done, match)) {
+                return true;
+            }
+            --match.param_count;
+        }
+    }
+    
+    if (node.wildcard) {
+        match.handler = &node.wildcard;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,103 @@
+#include "sqlite_pool.h"
+#include "logger.h"
+
+namespace {
+
+// Long enough to ride out a checkpoint or another writer's transaction
+const int kBusyTimeoutMs = 5000;
+
+} // namespace
+
+struct SqlitePool::Lease::Connection {
+    sqlite3* db = nullptr;
+    std::unordered_map<const char*, sqlite3_stmt*> statements;
+    
+    ~Connection() {
+        for (auto& statement : statements) {
+            sqlite3_finalize(statement.second);
+        }
+        if (db) {
+            sqlite3_close(db);
+        }
+    }
+};
+
+SqlitePool::Lease::Lease(SqlitePool* pool, std::unique_ptr<Connection> connection)
+    : pool_(pool), connection_(std::move(connection)) {
+}
+
+SqlitePool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_), connection_(std::move(other.connection_)), used_(std::move(other.used_)) {
+}
+
+SqlitePool::Lease::~Lease() {
+    if (!connection_) {
+        return;
+    }
+    // A statement left mid-result would hold its read transaction open
+    for (sqlite3_stmt* statement : used_) {
+        sqlite3_reset(statement);
+        sqlite3_clear_bindings(statement);
+    }
+    pool_->release(std::move(connection_));
+}
+
+sqlite3* SqlitePool::Lease::db() const {
+    return connection_ ? connection_->db : nullptr;
+}
+
+sqlite3_stmt* SqlitePool::Lease::prepare(const char* sql) {
+    if (!connection_) {
+        return nullptr;
+    }
+    
+    sqlite3_stmt*& statement = connection_->statements[sql];
+    if (!statement) {
+        if (sqlite3_prepare_v3(connection_->db, sql, -1, SQLITE_PREPARE_PERSISTENT, &statement, nullptr) != SQLITE_OK) {
+            LOG_ERROR("Failed to prepare statement: " + std::string(sqlite3_errmsg(connection_->db)));
+            connection_->statements.erase(sql);
+            return nullptr;
+        }
+    } else {
+        sqlite3_reset(statement);
+        sqlite3_clear_bindings(statement);
+    }
+    used_.push_back(statement);
+    return statement;
+}
+
+SqlitePool::SqlitePool(const std::string& path, size_t max_idle) : path_(path), max_idle_(max_idle) {
+}
+
+SqlitePool::~SqlitePool() = default;
+
+SqlitePool::Lease SqlitePool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty()) {
+            std::unique_ptr<Lease::Connection> connection = std::move(idle_.back());
+            idle_.pop_back();
+            return Lease(this, std::move(connection));
+        }
+    }
+    
+    // Each connection is only ever used by one thread at a time
+    auto connection = std::make_unique<Lease::Connection>();
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+    if (sqlite3_open_v2(path_.c_str(), &connection->db, flags, nullptr) != SQLITE_OK) {
+        LOG_ERROR("Failed to open database connection: " +
+                  std::string(connection->db ? sqlite3_errmsg(connection->db) : "out of memory"));
+        return Lease(this, nullptr);
+    }
+    sqlite3_busy_timeout(connection->db, kBusyTimeoutMs);
+    // WAL sticks to the database file; NORMAL sync is durable enough with it
+    sqlite3_exec(connection->db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
+    return Lease(this, std::move(connection));
+}
+
+void SqlitePool::release(std::unique_ptr<Lease::Connection> connection) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (idle_.size() < max_idle_) {
+        idle_.push_back(std::move(connection));
+    }
+}
@@ -0,0 +1,151 @@
+#include "tls_credentials.h"
+#include "logger.h"
+#include <fstream>
+#include <sstream>
+
+#ifdef HAVE_GNUTLS
+#include <gnutls/gnutls.h>
+#include <gnutls/abstract.h>
+#include <gnutls/x509.h>
+#endif
+
+std::atomic<TlsCredentials*> TlsCredentials::active_{nullptr};
+
+#ifdef HAVE_GNUTLS
+
+namespace {
+
+// Leaf, intermediates and perhaps a root; more is a misconfiguration
+const unsigned int kMaxChain = 8;
+
+bool read_file(const std::string& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+gnutls_datum_t as_datum(std::string& data) {
+    return gnutls_datum_t{reinterpret_cast<unsigned char*>(&data[0]), static_cast<unsigned int>(data.size())};
+}
+
+} // namespace
+
+struct TlsCredentials::Bundle {
+    std::vector<gnutls_pcert_st> chain;
+    gnutls_privkey_t key = nullptr;
+
+    ~Bundle() {
+        for (auto& cert : chain) {
+            gnutls_pcert_deinit(&cert);
+        }
+        if (key) {
+            gnutls_privkey_deinit(key);
+        }
+    }
+};
+
+struct TlsHandshake {
+    static int retrieve_certificate(gnutls_session_t, const gnutls_datum_t*, int, const gnutls_pk_algorithm_t*, int,
+                                    gnutls_pcert_st** pcert, unsigned int* pcert_length, gnutls_privkey_t* privkey) {
+        TlsCredentials* credentials = TlsCredentials::active_.load(std::memory_order_acquire);
+        const TlsCredentials::Bundle* bundle =
+            credentials ? credentials->current_.load(std::memory_order_acquire) : nullptr;
+        if (!bundle) {
+            return -1;
+        }
+        // GnuTLS only reads these; its signature lacks the const
+        *pcert = const_cast<gnutls_pcert_st*>(bundle->chain.data());
+        *pcert_length = static_cast<unsigned int>(bundle->chain.size());
+        *privkey = bundle->key;
+        return 0;
+    }
+};
+
+TlsCredentials::TlsCredentials() = default;
+
+TlsCredentials::~TlsCredentials() {
+    TlsCredentials* self = this;
+    active_.compare_exchange_strong(self, nullptr);
+}
+
+bool TlsCredentials::load(const std::string& cert_file, const std::string& key_file) {
+    std::string cert_pem;
+    std::string key_pem;
+    if (!read_file(cert_file, cert_pem) || !read_file(key_file, key_pem)) {
+        LOG_ERROR("TLS: cannot read " + cert_file + " or " + key_file);
+        return false;
+    }
+    gnutls_datum_t cert_datum = as_datum(cert_pem);
+    gnutls_datum_t key_datum = as_datum(key_pem);
+
+    // A credentials set refuses a key that does not match the certificate,
+    // which the bare imports below would accept
+    gnutls_certificate_credentials_t check;
+    if (gnutls_certificate_allocate_credentials(&check) < 0) {
+        return false;
+    }
+    int ret = gnutls_certificate_set_x509_key_mem2(check, &cert_datum, &key_datum, GNUTLS_X509_FMT_PEM, nullptr, 0);
+    gnutls_certificate_free_credentials(check);
+    if (ret < 0) {
+        LOG_ERROR("TLS: " + cert_file + " and " + key_file + " unusable: " + gnutls_strerror(ret));
+        return false;
+    }
+
+    auto bundle = std::make_unique<Bundle>();
+    unsigned int count = kMaxChain;
+    bundle->chain.resize(count);
+    ret = gnutls_pcert_list_import_x509_raw(bundle->chain.data(), &count, &cert_datum, GNUTLS_X509_FMT_PEM, 0);
+    if (ret < 0) {
+        bundle->chain.clear();
+        LOG_ERROR("TLS: " + cert_file + " unusable: " + gnutls_strerror(ret));
+        return false;
+    }
+    bundle->chain.resize(count);
+    if (gnutls_privkey_init(&bundle->key) < 0 ||
+        (ret = gnutls_privkey_import_x509_raw(bundle->key, &key_datum, GNUTLS_X509_FMT_PEM, nullptr, 0)) < 0) {
+        LOG_ERROR("TLS: " + key_file + " unusable: " + gnutls_strerror(ret));
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(load_mutex_);
+    current_.store(bundle.get(), std::memory_order_release);
+    bundles_.push_back(std::move(bundle));
+    LOG_INFO("TLS: certificate loaded from " + cert_file + " (" + std::to_string(count) + " in chain)");
+    return true;
+}
+
+void TlsCredentials::activate() {
+    active_.store(this, std::memory_order_release);
+}
+
+void* TlsCredentials::handshake_callback() {
+    gnutls_certificate_retrieve_function2* callback = &TlsHandshake::retrieve_certificate;
+    return reinterpret_cast<void*>(callback);
+}
+
+#else
+
+struct TlsCredentials::Bundle {};
+
+TlsCredentials::TlsCredentials() = default;
+TlsCredentials::~TlsCredentials() = default;
+
+bool TlsCredentials::load(const std::string&, const std::string&) {
+    LOG_ERROR("TLS: built without GnuTLS");
+    return false;
+}
+
+void TlsCredentials::activate() {
+    active_.store(this, std::memory_order_release);
+}
+
+void* TlsCredentials::handshake_callback() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include "websocket_channel.h"
+#include "base64.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <openssl/sha.h>
+#include <sys/socket.h>
+
+namespace {
+
+const char kHandshakeGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC11B65";
+const unsigned char kOpcodeText = 0x1;
+const unsigned char kOpcodeClose = 0x8;
+
+} // namespace
+
+WebSocketChannel::WebSocketChannel(int fd, std::function<void()> on_closed)
+    : fd_(fd), on_closed_(std::move(on_closed)) {}
+
+WebSocketChannel::~WebSocketChannel() {
+    close();
+}
+
+std::string WebSocketChannel::accept_key(std::string_view client_key) {
+    std::string input(client_key);
+    input += kHandshakeGuid;
+    unsigned char hash[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(), hash);
+    return Base64::encode(reinterpret_cast<const char*>(hash), sizeof(hash));
+}
+
+bool WebSocketChannel::send_text(std::string_view text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_) {
+        return false;
+    }
+    if (!send_frame(kOpcodeText, text)) {
+        close_locked();
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketChannel::is_open() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_;
+}
+
+void WebSocketChannel::close(uint16_t status) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (open_) {
+        const char payload[2] = {static_cast<char>(status >> 8), static_cast<char>(status & 0xff)};
+        send_frame(kOpcodeClose, std::string_view(payload, status ? sizeof(payload) : 0));
+        close_locked();
+    }
+}
+
+// Server frames are unmasked. A frame is sent whole or the channel is
+// given up: a partial frame cannot be finished later without blocking.
+bool WebSocketChannel::send_frame(unsigned char opcode, std::string_view payload) {
+    std::string frame;
+    frame.reserve(payload.size() + 10);
+    frame += static_cast<char>(0x80 | opcode);
+    if (payload.size() < 126) {
+        frame += static_cast<char>(payload.size());
+    } else if (payload.size() <= 0xffff) {
+        frame += static_cast<char>(126);
+        frame += static_cast<char>(payload.size() >> 8);
+        frame += static_cast<char>(payload.size() & 0xff);
+    } else {
+        frame += static_cast<char>(127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            frame += static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xff);
+        }
+    }
+    frame.append(payload.data(), payload.size());
+
+    ssize_t sent;
+    do {
+        sent = send(fd_, frame.data(), frame.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    } while (sent < 0 && errno == EINTR);
+    return sent == static_cast<ssize_t>(frame.size());
+}
+
+void WebSocketChannel::close_locked() {
+    open_ = false;
+    if (on_closed_) {
+        auto on_closed = std::move(on_closed_);
+        on_closed_ = nullptr;
+        on_closed();
+    }
+}
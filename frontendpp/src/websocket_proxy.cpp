@@ -0,0 +1,335 @@
+#include "websocket_proxy.h"
+#include "http_server.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// The backend must answer the upgrade within this time
+const int kHandshakeTimeoutSeconds = 5;
+const size_t kMaxHandshakeBytes = 8 * 1024;
+// Bytes moved per splice() call, the default pipe capacity
+const size_t kSpliceChunk = 64 * 1024;
+
+bool send_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+void set_blocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags >= 0 && (flags & O_NONBLOCK)) {
+        fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+    }
+}
+
+void set_timeout(int fd, int seconds) {
+    struct timeval timeout = {seconds, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+// MHD hands over query arguments already decoded
+void append_encoded(std::string& out, std::string_view value) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (unsigned char c : value) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        }
+    }
+}
+
+std::string request_head(const HttpRequest& request) {
+    std::string head = "GET " + request.path;
+    char separator = '?';
+    for (const auto& param : request.query_params) {
+        head += separator;
+        append_encoded(head, param.first);
+        if (!param.second.empty()) {
+            head += '=';
+            append_encoded(head, param.second);
+        }
+        separator = '&';
+    }
+    head += " HTTP/1.1\r\n";
+    for (const auto& header : request.headers) {
+        head.append(header.first).append(": ").append(header.second).append("\r\n");
+    }
+    if (!request.client_ip.empty()) {
+        head += "X-Forwarded-For: " + request.client_ip + "\r\n";
+    }
+    head += "\r\n";
+    return head;
+}
+
+// Reads the backend's response head; anything after it stays in extra
+bool read_response(int fd, int& status, HeaderMap& headers, std::string& extra) {
+    std::string data;
+    size_t head_end = std::string::npos;
+    char buffer[2048];
+    while (head_end == std::string::npos) {
+        if (data.size() > kMaxHandshakeBytes) {
+            return false;
+        }
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data.append(buffer, static_cast<size_t>(received));
+        head_end = data.find("\r\n\r\n");
+    }
+    extra = data.substr(head_end + 4);
+
+    // "HTTP/1.1 101 Switching Protocols"
+    size_t line_end = data.find("\r\n");
+    size_t code = data.find(' ');
+    if (code == std::string::npos || code > line_end) {
+        return false;
+    }
+    status = std::atoi(data.c_str() + code + 1);
+
+    size_t pos = line_end + 2;
+    while (pos < head_end) {
+        size_t next = data.find("\r\n", pos);
+        size_t colon = data.find(':', pos);
+        if (colon != std::string::npos && colon < next) {
+            size_t value = data.find_first_not_of(' ', colon + 1);
+            value = std::min(value, next);
+            headers.set(std::string_view(data).substr(pos, colon - pos), data.substr(value, next - value));
+        }
+        pos = next + 2;
+    }
+    return true;
+}
+
+// Copies through user space; for kernels or sockets splice() refuses
+void copy(int from, int to) {
+    char buffer[16 * 1024];
+    for (;;) {
+        ssize_t received = recv(from, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0 || !send_all(to, buffer, static_cast<size_t>(received))) {
+            return;
+        }
+    }
+}
+
+// Moves bytes from one socket to the other through a pipe until from is
+// exhausted, then passes the end of stream on
+void pump(int from, int to) {
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        copy(from, to);
+        shutdown(to, SHUT_WR);
+        return;
+    }
+
+    bool moved = false;
+    for (;;) {
+        ssize_t in = splice(from, nullptr, pipe_fds[1], nullptr, kSpliceChunk, SPLICE_F_MOVE);
+        if (in < 0 && errno == EINTR) {
+            continue;
+        }
+        if (in < 0 && errno == EINVAL && !moved) {
+            copy(from, to);
+            break;
+        }
+        if (in <= 0) {
+            break;
+        }
+        moved = true;
+
+        size_t pending = static_cast<size_t>(in);
+        while (pending > 0) {
+            ssize_t out = splice(pipe_fds[0], nullptr, to, nullptr, pending, SPLICE_F_MOVE);
+            if (out < 0 && errno == EINTR) {
+                continue;
+            }
+            if (out <= 0) {
+                break;
+            }
+            pending -= static_cast<size_t>(out);
+        }
+        if (pending > 0) {
+            break;
+        }
+    }
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    shutdown(to, SHUT_WR);
+}
+
+} // namespace
+
+ProxyTunnel::~ProxyTunnel() {
+    if (backend_fd >= 0) {
+        close(backend_fd);
+    }
+}
+
+WebSocketProxy::WebSocketProxy(std::string backend) : backend_(std::move(backend)) {}
+
+WebSocketProxy::~WebSocketProxy() {
+    close_all();
+}
+
+int WebSocketProxy::connect_backend() const {
+    if (backend_.compare(0, 5, "unix:") == 0) {
+        std::string path = backend_.substr(5);
+        struct sockaddr_un addr = {};
+        if (path.size() >= sizeof(addr.sun_path)) {
+            return -1;
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+
+    size_t colon = backend_.rfind(':');
+    if (colon == std::string::npos) {
+        return -1;
+    }
+    std::string host = backend_.substr(0, colon);
+    std::string port = backend_.substr(colon + 1);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &results) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo* ai = results; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(results);
+    return fd;
+}
+
+std::unique_ptr<ProxyTunnel> WebSocketProxy::open(const HttpRequest& request) const {
+    auto tunnel = std::make_unique<ProxyTunnel>();
+    tunnel->backend_fd = connect_backend();
+    if (tunnel->backend_fd < 0) {
+        LOG_WARNING("WebSocket proxy: cannot connect to " + backend_ + ": " + std::strerror(errno));
+        return nullptr;
+    }
+    set_timeout(tunnel->backend_fd, kHandshakeTimeoutSeconds);
+
+    std::string head = request_head(request);
+    int status = 0;
+    if (!send_all(tunnel->backend_fd, head.data(), head.size()) ||
+        !read_response(tunnel->backend_fd, status, tunnel->response_headers, tunnel->backend_extra)) {
+        LOG_WARNING("WebSocket proxy: no handshake answer from " + backend_);
+        return nullptr;
+    }
+    if (status != 101) {
+        LOG_WARNING("WebSocket proxy: " + backend_ + " refused the upgrade with " + std::to_string(status));
+        return nullptr;
+    }
+    set_timeout(tunnel->backend_fd, 0);
+    return tunnel;
+}
+
+void WebSocketProxy::relay(std::unique_ptr<ProxyTunnel> tunnel, int client_fd,
+                           const char* extra_in, size_t extra_in_size,
+                           std::function<void()> on_closed) {
+    // Copied now; MHD's buffer is only valid during the upgrade callback
+    std::string client_extra(extra_in ? extra_in : "", extra_in ? extra_in_size : 0);
+    int backend_fd = tunnel->backend_fd;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        relays_.push_back({client_fd, backend_fd, false});
+        ++active_;
+    }
+
+    std::thread([this, tunnel = std::move(tunnel), client_fd, backend_fd,
+                 client_extra = std::move(client_extra), on_closed = std::move(on_closed)]() mutable {
+        set_blocking(client_fd);
+        set_blocking(backend_fd);
+        if (send_all(backend_fd, client_extra.data(), client_extra.size()) &&
+            send_all(client_fd, tunnel->backend_extra.data(), tunnel->backend_extra.size())) {
+            std::thread upstream(pump, client_fd, backend_fd);
+            pump(backend_fd, client_fd);
+            upstream.join();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            relays_.erase(std::find_if(relays_.begin(), relays_.end(),
+                                       [client_fd](const Relay& relay) { return relay.client_fd == client_fd; }));
+        }
+        tunnel.reset();     // Closes the backend socket
+        on_closed();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        --active_;
+        idle_.notify_all();
+    }).detach();
+}
+
+void WebSocketProxy::close_all() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (Relay& relay : relays_) {
+        shutdown(relay.client_fd, SHUT_RDWR);
+        shutdown(relay.backend_fd, SHUT_RDWR);
+        relay.closing = true;
+    }
+    idle_.wait(lock, [this] { return active_ == 0; });
+}
+
+bool WebSocketProxy::close_one() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Relay& relay : relays_) {
+        if (!relay.closing) {
+            shutdown(relay.client_fd, SHUT_RDWR);
+            shutdown(relay.backend_fd, SHUT_RDWR);
+            relay.closing = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t WebSocketProxy::relay_count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return relays_.size();
+}
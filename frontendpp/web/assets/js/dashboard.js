@@ -202,6 +202,26 @@ class DashboardManager {
         }
     }
 
+    // Sections come from components/bundle.json, fetched once per page and
+    // revalidated by its ETag; without the bundle each file is fetched
+    async fetchComponent(htmlFile) {
+        if (!this.componentBundle) {
+            this.componentBundle = fetch('components/bundle.json')
+                .then(response => response.ok ? response.json() : {})
+                .catch(() => ({}));
+        }
+        const bundle = await this.componentBundle;
+        if (typeof bundle[htmlFile] === 'string') {
+            return bundle[htmlFile];
+        }
+        
+        const response = await fetch(`components/${htmlFile}`);
+        if (!response.ok) {
+            throw new Error(`HTTP ${response.status}: ${response.statusText}`);
+        }
+        return response.text();
+    }
+
     async loadSection(sectionId) {
         console.log('[DASHBOARD] Loading section:', sectionId);
         this.currentSection = sectionId;
@@ -237,12 +257,7 @@ class DashboardManager {
             `;
             
             // Fetch section HTML
-            const response = await fetch(`components/${htmlFile}`);
-            if (!response.ok) {
-                throw new Error(`HTTP ${response.status}: ${response.statusText}`);
-            }
-            
-            const html = await response.text();
+            const html = await this.fetchComponent(htmlFile);
             console.log('[DASHBOARD] Content loaded successfully, length:', html.length);
             
             // Inject HTML
@@ -121,8 +121,12 @@ class WebSocketClient {
         // Notify callbacks
         this.callbacks.onDisconnect(event);
         
-        // Schedule reconnection if not a normal closure
-        if (event.code !== 1000) {
+        // Schedule reconnection if not a normal closure. 1012 (service
+        // restart) means a new server is already taking connections.
+        if (event.code === 1012) {
+            this.reconnectAttempts = 0;
+            this.scheduleReconnect();
+        } else if (event.code !== 1000) {
             this.scheduleReconnect();
         }
     }
@@ -299,7 +303,10 @@ class WebSocketClient {
     scheduleReconnect() {
         if (this.reconnectAttempts < this.maxReconnectAttempts) {
             this.reconnectAttempts++;
-            const delay = this.reconnectInterval * Math.pow(1.5, this.reconnectAttempts - 1); // Exponential backoff
+            // Exponential backoff, with jitter so clients dropped together
+            // by a restart do not all come back at the same moment
+            const backoff = this.reconnectInterval * Math.pow(1.5, this.reconnectAttempts - 1);
+            const delay = Math.round(backoff * (0.5 + Math.random()));
             
             console.log(`Scheduling reconnection attempt ${this.reconnectAttempts}/${this.maxReconnectAttempts} in ${delay}ms`);
             